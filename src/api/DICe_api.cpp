@@ -44,88 +44,183 @@
 #include <DICe_Parser.h>
 #include <DICe_ParameterUtilities.h>
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-DICE_LIB_DLL_EXPORT const int_t dice_correlate(scalar_t points[], int_t n_points,
-                        int_t subset_size,
-                        intensity_t ref_img[], int_t ref_w, int_t ref_h,
-                        intensity_t def_img[], int_t def_w, int_t def_h,
-                        Teuchos::ParameterList * input_params, const bool update_params){
-
-  static bool initialized = false;
-
-  DEBUG_MSG("dice_correlate() called with the following values:");
-  DEBUG_MSG("n_points               " << n_points);
-  DEBUG_MSG("subset_size            " << subset_size);
-  DEBUG_MSG("ref_w                  " << ref_w);
-  DEBUG_MSG("ref_h                  " << ref_h);
-  DEBUG_MSG("def_w                  " << def_w);
-  DEBUG_MSG("def_h                  " << def_h);
-  DEBUG_MSG("update params          " << update_params);
-  DEBUG_MSG("is initialized         " << initialized);
-
-  // throw an error if the images are not of the same size
-  if(ref_w!=def_w||ref_h!=def_h) return -1;
-  // throw an error if the subset size is less than 1 pixel
-  if(subset_size < 1) return -1;
-  // throw an error if n_points is less than one
-  if(n_points < 1) return -1;
-
-  const int_t imgSize = ref_w*ref_h;
-
-  // create an ArrayRCP to the image
-  Teuchos::ArrayRCP<intensity_t> refRCP(ref_img,0,imgSize,false);
-  Teuchos::ArrayRCP<intensity_t> defRCP(def_img,0,imgSize,false);
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/// correlation context behind a dice_handle
+struct dice_context{
+  dice_context():
+    n_points(0),
+    ref_w(0),
+    ref_h(0),
+    def_buffer_id(0),
+    conformal(false),
+    stream_running(false),
+    stream_capacity(1),
+    stream_budget_ms(0.0),
+    stream_compute_beta(false),
+    stream_callback(0),
+    stream_user_data(0){}
+  /// a frame waiting for the streaming thread
+  struct stream_frame{
+    /// id given to dice_stream_push()
+    int_t frame_id;
+    /// converted intensities owned by the context
+    Teuchos::ArrayRCP<intensity_t> buffer;
+    /// time the frame was pushed
+    std::chrono::steady_clock::time_point push_time;
+  };
+  /// schema that owns the fields and objectives, kept alive across frames
+  Teuchos::RCP<DICe::Schema> schema;
+  /// correlation parameters owned by the context
+  Teuchos::RCP<Teuchos::ParameterList> params;
+  /// number of correlation points
+  int_t n_points;
+  /// reference image width
+  int_t ref_w;
+  /// reference image height
+  int_t ref_h;
+  /// copy of the reference intensities (the schema's reference image wraps this array)
+  Teuchos::ArrayRCP<intensity_t> ref_buffer;
+  /// the deformed frames alternate between two buffers so the previous image stays valid
+  Teuchos::ArrayRCP<intensity_t> def_buffers[2];
+  /// index of the deformed buffer the next frame is copied into
+  int_t def_buffer_id;
+  /// true if the subsets were read from a subset file (the centroids are reported back)
+  bool conformal;
+  /// serializes the calls made on the same handle
+  std::mutex mutex;
+  /// correlates the streamed frames
+  std::thread stream_thread;
+  /// guards the stream queue and buffers (never held while a frame is correlated)
+  std::mutex stream_mutex;
+  /// signals the streaming thread that a frame was pushed or the stream was stopped
+  std::condition_variable stream_cv;
+  /// frames waiting to be correlated, oldest first
+  std::deque<stream_frame> stream_queue;
+  /// ids of the frames dropped by dice_stream_push() that have not been reported yet
+  std::vector<int_t> stream_dropped;
+  /// frame buffers that can be reused
+  std::vector<Teuchos::ArrayRCP<intensity_t> > stream_free_buffers;
+  /// buffer of the last correlated frame (the previous image of the schema)
+  Teuchos::ArrayRCP<intensity_t> stream_prev_buffer;
+  /// the results of the last frame and the initial guess for the next one
+  std::vector<scalar_t> stream_points;
+  /// true between dice_stream_start() and dice_stream_stop()
+  bool stream_running;
+  /// number of frames that can wait in the queue
+  int_t stream_capacity;
+  /// target time from push to callback in milliseconds (0 for no budget)
+  double stream_budget_ms;
+  /// true if beta was requested by the parameters (it is skipped when a frame is over the budget)
+  bool stream_compute_beta;
+  /// receives the result of each frame
+  dice_frame_callback stream_callback;
+  /// passed to the callback
+  void * stream_user_data;
+};
+
+namespace {
+
+/// returns the number of bytes per pixel for the given format or 0 for an unknown format
+int_t
+pixel_size(const int_t pixel_format){
+  if(pixel_format==DICE_PIXEL_INTENSITY) return sizeof(intensity_t);
+  else if(pixel_format==DICE_PIXEL_UINT8) return sizeof(unsigned char);
+  else if(pixel_format==DICE_PIXEL_UINT16) return sizeof(unsigned short);
+  return 0;
+}
 
-  static Teuchos::RCP<Teuchos::ParameterList> params;
-  if(input_params!=0){
-    DEBUG_MSG("Using user specified input parameters in dice_correlate()");
-    params = rcp(input_params,false);
-  }
-  else{
-    DEBUG_MSG("Using default parameters in dice_correlate()");
-    static Teuchos::RCP<Teuchos::ParameterList> defaultParams = rcp(new Teuchos::ParameterList());
-    if(!initialized){
-      // grab the defualt values
-      DICe::tracking_default_params(defaultParams.getRawPtr());
-    }
-    params = defaultParams;
+/// converts a strided buffer of pixels to intensity values in a single pass
+template <typename T>
+void
+convert_rows(const unsigned char * pixels,
+  const int_t width,
+  const int_t height,
+  const int_t row_stride,
+  intensity_t * intensities){
+  for(int_t y=0;y<height;++y){
+    const T * row = reinterpret_cast<const T*>(pixels + y*row_stride);
+    intensity_t * dest = intensities + y*width;
+    for(int_t x=0;x<width;++x)
+      dest[x] = static_cast<intensity_t>(row[x]);
   }
+}
 
-  // construct a schema:
-  // make it static since we want the internal data to hang around
-  static DICe::Schema schema;
-  if(!initialized){
-    // initialize the schema
-    // since the input data array is of a different size and in a different
-    // order, we have to manually plug the values in
-    Teuchos::ArrayRCP<scalar_t> coords_x(n_points,0.0);
-    Teuchos::ArrayRCP<scalar_t> coords_y(n_points,0.0);
-    for(int_t i=0;i<n_points;++i){
-      coords_x[i] = points[i*DICE_API_STRIDE + 0];
-      coords_y[i] = points[i*DICE_API_STRIDE + 1];
-    }
-    schema = DICe::Schema(coords_x,coords_y,subset_size,Teuchos::null,Teuchos::null,params);
-    schema.set_ref_image(ref_w,ref_h,refRCP);
+/// converts the pixels of an externally owned buffer to intensity values, returns 0 on success
+int_t
+convert_pixels(const void * pixels,
+  const int_t pixel_format,
+  const int_t width,
+  const int_t height,
+  int_t row_stride,
+  intensity_t * intensities){
+  const int_t bytes_per_pixel = pixel_size(pixel_format);
+  if(pixels==0 || bytes_per_pixel==0 || width < 1 || height < 1) return -1;
+  if(row_stride==0) row_stride = width*bytes_per_pixel;
+  if(row_stride < width*bytes_per_pixel) return -1;
+  const unsigned char * bytes = static_cast<const unsigned char*>(pixels);
+  if(pixel_format==DICE_PIXEL_INTENSITY)
+    convert_rows<intensity_t>(bytes,width,height,row_stride,intensities);
+  else if(pixel_format==DICE_PIXEL_UINT8)
+    convert_rows<unsigned char>(bytes,width,height,row_stride,intensities);
+  else
+    convert_rows<unsigned short>(bytes,width,height,row_stride,intensities);
+  return 0;
+}
+
+/// hands the (context owned) reference intensities to the schema
+void
+set_context_reference(dice_handle handle,
+  Teuchos::ArrayRCP<intensity_t> ref_buffer,
+  const int_t ref_w,
+  const int_t ref_h){
+  const bool replacing = !handle->ref_buffer.is_null();
+  // the old reference image still wraps the previous buffer so a new one is always used
+  handle->ref_buffer = ref_buffer;
+  handle->ref_w = ref_w;
+  handle->ref_h = ref_h;
+  handle->schema->set_ref_image(ref_w,ref_h,ref_buffer);
+  if(replacing){
+    // the objectives hold the reference intensities of their subsets so they are rebuilt on the next frame
+    handle->schema->obj_vec()->clear();
+    handle->schema->set_prev_image(handle->schema->ref_img());
   }
-  // call set_params on the schema in case the parameter have changed:
-  if(!initialized||update_params)
-    schema.set_params(params);
-  TEUCHOS_TEST_FOR_EXCEPTION(schema.quadratic_shape_function_enabled(),std::runtime_error,"Error, cannot use quadratic shape function for the api routines");
+}
 
+/// returns the context owned buffer the next deformed frame should be copied into
+Teuchos::ArrayRCP<intensity_t>
+next_def_buffer(dice_handle handle){
+  const int_t img_size = handle->ref_w*handle->ref_h;
+  Teuchos::ArrayRCP<intensity_t> & def_buffer = handle->def_buffers[handle->def_buffer_id];
+  if(def_buffer.size()!=img_size)
+    def_buffer = Teuchos::ArrayRCP<intensity_t>(img_size,0.0);
+  handle->def_buffer_id = 1 - handle->def_buffer_id;
+  return def_buffer;
+}
 
-  initialized = true;
-  // set the deformed image manually in case this is not the first image in the set:
-  // the constructor won't get called on the static schema if this is not the first image since it's static
-  schema.set_def_image(def_w,def_h,defRCP);
+/// correlates one frame for the context, the points array is read and written with DICE_API_STRIDE values per point
+int_t
+correlate_context(dice_handle handle,
+  scalar_t points[],
+  Teuchos::ArrayRCP<intensity_t> def_buffer){
+  DICe::Schema & schema = *handle->schema;
+  schema.set_def_image(handle->ref_w,handle->ref_h,def_buffer);
 
   // manually copy values into the schema's field values
-  for(int_t i=0;i<n_points;++i){
-    // leave the coordinates alone
-    schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS)   = points[i*DICE_API_STRIDE + 0];
-    schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS)   = points[i*DICE_API_STRIDE + 1];
+  for(int_t i=0;i<handle->n_points;++i){
+    // the conformal subset centroids come from the subset file
+    if(!handle->conformal){
+      schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS) = points[i*DICE_API_STRIDE + 0];
+      schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS) = points[i*DICE_API_STRIDE + 1];
+    }
     schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_X_FS) = points[i*DICE_API_STRIDE + 2];
     schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_Y_FS) = points[i*DICE_API_STRIDE + 3];
     schema.local_field_value(i,DICe::field_enums::ROTATION_Z_FS)     = points[i*DICE_API_STRIDE + 4];
@@ -138,8 +233,11 @@ DICE_LIB_DLL_EXPORT const int_t dice_correlate(scalar_t points[], int_t n_points
   schema.execute_correlation();
 
   // extract the values from the correlation and put it back in the data array:
-  for(int_t i=0;i<n_points;++i){
-    // leave the coordinates alone
+  for(int_t i=0;i<handle->n_points;++i){
+    if(handle->conformal){
+      points[i*DICE_API_STRIDE + 0] = schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS);
+      points[i*DICE_API_STRIDE + 1] = schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS);
+    }
     points[i*DICE_API_STRIDE + 2] = schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_X_FS);
     points[i*DICE_API_STRIDE + 3] = schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_Y_FS);
     points[i*DICE_API_STRIDE + 4] = schema.local_field_value(i,DICe::field_enums::ROTATION_Z_FS);
@@ -148,136 +246,584 @@ DICE_LIB_DLL_EXPORT const int_t dice_correlate(scalar_t points[], int_t n_points
     points[i*DICE_API_STRIDE + 7] = schema.local_field_value(i,DICe::field_enums::BETA_FS);
     points[i*DICE_API_STRIDE + 8] = schema.local_field_value(i,DICe::field_enums::STATUS_FLAG_FS);
   }
+  return 0;
+}
+
+/// correlates the streamed frames of a context until the stream is stopped and the queue is empty
+void
+stream_loop(dice_handle handle){
+  typedef std::chrono::steady_clock clock;
+  typedef std::chrono::duration<double,std::milli> milliseconds;
+  const double budget = handle->stream_budget_ms;
+  const int_t n_points = handle->n_points;
+  double last_latency = 0.0;
+  while(true){
+    dice_context::stream_frame frame;
+    std::vector<int_t> dropped;
+    {
+      std::unique_lock<std::mutex> lock(handle->stream_mutex);
+      handle->stream_cv.wait(lock,[handle]{return !handle->stream_queue.empty()||!handle->stream_running;});
+      // the queue is only empty here once the stream has been stopped
+      if(handle->stream_queue.empty()){
+        dropped.swap(handle->stream_dropped);
+        lock.unlock();
+        for(size_t i=0;i<dropped.size();++i)
+          handle->stream_callback(dropped[i],0,n_points,DICE_STREAM_DROPPED,handle->stream_user_data);
+        break;
+      }
+      // frames that are already over the budget are skipped in favor of the newer ones
+      const clock::time_point now = clock::now();
+      while(budget>0.0&&handle->stream_queue.size()>1&&
+          milliseconds(now-handle->stream_queue.front().push_time).count()>budget){
+        handle->stream_dropped.push_back(handle->stream_queue.front().frame_id);
+        handle->stream_free_buffers.push_back(handle->stream_queue.front().buffer);
+        handle->stream_queue.pop_front();
+      }
+      frame = handle->stream_queue.front();
+      handle->stream_queue.pop_front();
+      dropped.swap(handle->stream_dropped);
+    }
+    for(size_t i=0;i<dropped.size();++i)
+      handle->stream_callback(dropped[i],0,n_points,DICE_STREAM_DROPPED,handle->stream_user_data);
+    // the optional work is shed for this frame if the last one was over the budget
+    const bool shed = handle->stream_compute_beta&&budget>0.0&&last_latency>budget;
+    int_t status = shed ? DICE_STREAM_DEGRADED : DICE_STREAM_OK;
+    {
+      std::lock_guard<std::mutex> lock(handle->mutex);
+      try{
+        // the reference may have been replaced by one of another size since the frame was pushed
+        if(frame.buffer.size()!=handle->ref_w*handle->ref_h){
+          status = DICE_STREAM_FAILED;
+        }
+        else{
+          handle->schema->set_output_beta(handle->stream_compute_beta&&!shed);
+          if(correlate_context(handle,&handle->stream_points[0],frame.buffer)!=0)
+            status = DICE_STREAM_FAILED;
+        }
+      }
+      catch(std::exception & e){
+        std::cerr << "Error, the streamed correlation of frame " << frame.frame_id << " failed: " << e.what() << std::endl;
+        status = DICE_STREAM_FAILED;
+      }
+    }
+    last_latency = milliseconds(clock::now()-frame.push_time).count();
+    handle->stream_callback(frame.frame_id,&handle->stream_points[0],n_points,status,handle->stream_user_data);
+    {
+      std::lock_guard<std::mutex> lock(handle->stream_mutex);
+      // the previous frame has been replaced as the previous image of the schema, its buffer is reused
+      // unless something else still holds it
+      if(!handle->stream_prev_buffer.is_null()&&handle->stream_prev_buffer.strong_count()==1)
+        handle->stream_free_buffers.push_back(handle->stream_prev_buffer);
+      handle->stream_prev_buffer = frame.buffer;
+      frame.buffer = Teuchos::null;
+    }
+  }
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  handle->schema->set_output_beta(handle->stream_compute_beta);
+}
+
+/// replaces the points of a context in place (the caller holds the handle mutex), returns 0 on success
+/// source_ids holds for each new point the id of the current point it continues (-1 for an added point)
+int_t
+update_context_points(dice_handle handle,
+  Teuchos::ArrayRCP<scalar_t> coords_x,
+  Teuchos::ArrayRCP<scalar_t> coords_y,
+  const std::vector<int_t> & source_ids){
+  if(handle->conformal){
+    std::cerr << "Error, the points of a conformal context cannot be changed" << std::endl;
+    return -1;
+  }
+  {
+    std::lock_guard<std::mutex> stream_lock(handle->stream_mutex);
+    if(handle->stream_running || handle->stream_thread.joinable()) return -1;
+  }
+  handle->schema->update_subsets(coords_x,coords_y,source_ids);
+  handle->n_points = coords_x.size();
+  return 0;
+}
 
+/// returns 0 if the schema of a new context can be used by the api routines
+int_t
+check_context(dice_handle handle){
+  if(handle->schema->quadratic_shape_function_enabled()){
+    std::cerr << "Error, cannot use quadratic shape function for the api routines" << std::endl;
+    return -1;
+  }
   return 0;
 }
 
-DICE_LIB_DLL_EXPORT const int_t dice_correlate_conformal(scalar_t points[],
-                        intensity_t ref_img[], int_t ref_w, int_t ref_h,
-                        intensity_t def_img[], int_t def_w, int_t def_h,
-                        const char* subset_file, const char* param_file,
-                        const bool write_output){
+}
 
-  static bool initialized = false;
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-  DEBUG_MSG("dice_correlate() called with the following values:");
-  DEBUG_MSG("ref_w                  " << ref_w);
-  DEBUG_MSG("ref_h                  " << ref_h);
-  DEBUG_MSG("def_w                  " << def_w);
-  DEBUG_MSG("def_h                  " << def_h);
-  DEBUG_MSG("subset file            " << subset_file);
-  DEBUG_MSG("write output           " << write_output);
-  DEBUG_MSG("is initialized         " << initialized);
+DICE_LIB_DLL_EXPORT dice_handle dice_create(const scalar_t points[], int_t n_points,
+                        int_t subset_size,
+                        Teuchos::ParameterList * input_params){
+
+  DEBUG_MSG("dice_create() called with n_points " << n_points << " subset_size " << subset_size);
+  // the subset size has to be at least one pixel and there has to be at least one point
+  if(subset_size < 1 || n_points < 1 || points==0) return 0;
+
+  dice_handle handle = new dice_context();
+  try{
+    handle->params = Teuchos::rcp(new Teuchos::ParameterList());
+    if(input_params!=0){
+      DEBUG_MSG("Using user specified input parameters in dice_create()");
+      *handle->params = *input_params;
+    }
+    else{
+      DEBUG_MSG("Using default parameters in dice_create()");
+      DICe::tracking_default_params(handle->params.getRawPtr());
+    }
+    // since the input data array is of a different size and in a different
+    // order, we have to manually plug the values in
+    Teuchos::ArrayRCP<scalar_t> coords_x(n_points,0.0);
+    Teuchos::ArrayRCP<scalar_t> coords_y(n_points,0.0);
+    for(int_t i=0;i<n_points;++i){
+      coords_x[i] = points[i*DICE_API_STRIDE + 0];
+      coords_y[i] = points[i*DICE_API_STRIDE + 1];
+    }
+    handle->n_points = n_points;
+    handle->schema = Teuchos::rcp(new DICe::Schema(coords_x,coords_y,subset_size,Teuchos::null,Teuchos::null,handle->params));
+  }
+  catch(std::exception & e){
+    std::cerr << "Error, dice_create() failed: " << e.what() << std::endl;
+    delete handle;
+    return 0;
+  }
+  if(check_context(handle)!=0){
+    delete handle;
+    return 0;
+  }
+  return handle;
+}
 
-  // throw an error if the images are not of the same size
-  if(ref_w!=def_w||ref_h!=def_h) return -1;
+DICE_LIB_DLL_EXPORT dice_handle dice_create_conformal(const char* subset_file,
+                        int_t ref_w, int_t ref_h,
+                        const char* param_file){
 
-  static Teuchos::RCP<Teuchos::ParameterList> corr_params;
+  DEBUG_MSG("dice_create_conformal() called with subset file " << (subset_file ? subset_file : "(null)"));
+  if(subset_file==0 || ref_w < 1 || ref_h < 1) return 0;
 
-  if(!initialized){
+  dice_handle handle = new dice_context();
+  try{
     if(param_file!=0){
-      corr_params = DICe::read_correlation_params(param_file);
+      handle->params = DICe::read_correlation_params(param_file);
       // make sure the use_sl_parameters option is set
-      corr_params->set(DICe::use_tracking_default_params,true);
+      handle->params->set(DICe::use_tracking_default_params,true);
       DEBUG_MSG("User specified correlation Parameters:");
     }
     else{
       DEBUG_MSG("User did not specify correlation parameters (using all sl defaults).");
-      corr_params = rcp(new Teuchos::ParameterList());
-      DICe::tracking_default_params(corr_params.getRawPtr());
+      handle->params = Teuchos::rcp(new Teuchos::ParameterList());
+      DICe::tracking_default_params(handle->params.getRawPtr());
     }
 #ifdef DICE_DEBUG_MSG
-      corr_params->print(std::cout);
+    handle->params->print(std::cout);
 #endif
-  }
-
-  const int_t imgSize = ref_w*ref_h;
-
-  // create an ArrayRCP to the image
-  Teuchos::ArrayRCP<intensity_t> refRCP(ref_img,0,imgSize,false);
-  Teuchos::ArrayRCP<intensity_t> defRCP(def_img,0,imgSize,false);
-
-  // construct a schema:
-  // make it static since we want the internal data to hang around
-  static DICe::Schema schema;
-
-  // if a subset file is specified, copy over the subset centroids into the data array (replacing values)
-  static Teuchos::RCP<std::map<int_t,DICe::Conformal_Area_Def> > conformal_area_defs;
-  static Teuchos::RCP<std::map<int_t,std::vector<int_t> > > blocking_subset_ids;
-  static int_t n_points = -1;
-  static int_t dim = 2; // assumes 2D
-  TEUCHOS_TEST_FOR_EXCEPTION(!subset_file,std::runtime_error,"");
-  if(!initialized){
     DEBUG_MSG("Reading subset information from file: " << subset_file);
     // get the conformal subset defs, blocking subset ids, and coordinates
-    // TODO enable seed and sweep in dice_correlate_conformal
+    // TODO enable seed and sweep in dice_create_conformal
     Teuchos::RCP<DICe::Subset_File_Info> subset_info = DICe::read_subset_file(subset_file,ref_w,ref_h);
     Teuchos::RCP<std::vector<scalar_t> > subset_centroids = subset_info->coordinates_vector;
-    conformal_area_defs = subset_info->conformal_area_defs;
-    blocking_subset_ids = subset_info->id_sets_map;
-    n_points = subset_info->coordinates_vector->size()/dim; // divide by three because the striding is x, y, neighbor_id
+    const int_t dim = 2; // assumes 2D
+    const int_t n_points = subset_centroids->size()/dim;
     // this library call requires that all subsets are defined with a conformal subset
-    TEUCHOS_TEST_FOR_EXCEPTION((int_t)conformal_area_defs->size()!=n_points,std::runtime_error,
+    TEUCHOS_TEST_FOR_EXCEPTION((int_t)subset_info->conformal_area_defs->size()!=n_points,std::runtime_error,
       "Error there is a mismatch between the number of "
         "conformal subsets defined and the number of coordinate sets");
-    // copy over the coordinates to the points array:
+    Teuchos::ArrayRCP<scalar_t> coords_x(n_points,0.0);
+    Teuchos::ArrayRCP<scalar_t> coords_y(n_points,0.0);
     for(int_t i=0;i<n_points;++i){
-      points[i*DICE_API_STRIDE+0] = (*subset_centroids)[i*dim+0];
-      points[i*DICE_API_STRIDE+1] = (*subset_centroids)[i*dim+1];
+      coords_x[i] = (*subset_centroids)[i*dim+0];
+      coords_y[i] = (*subset_centroids)[i*dim+1];
     }
-    // initialize the schema
-    // since the input data array is of a different size and in a different
-    // order, we have to manually plug the values in
+    handle->n_points = n_points;
+    handle->conformal = true;
     // Passing -1 as subset size to require that all subsets are defined in the input file
+    handle->schema = Teuchos::rcp(new DICe::Schema(coords_x,coords_y,-1,subset_info->conformal_area_defs,Teuchos::null,handle->params));
+    handle->schema->set_obstructing_subset_ids(subset_info->id_sets_map);
+  }
+  catch(std::exception & e){
+    std::cerr << "Error, dice_create_conformal() failed: " << e.what() << std::endl;
+    delete handle;
+    return 0;
+  }
+  if(check_context(handle)!=0){
+    delete handle;
+    return 0;
+  }
+  return handle;
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_num_points(dice_handle handle){
+  if(handle==0) return -1;
+  return handle->n_points;
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_set_reference(dice_handle handle,
+                        const intensity_t ref_img[], int_t ref_w, int_t ref_h){
+  return dice_set_reference_buffer(handle,ref_img,DICE_PIXEL_INTENSITY,ref_w,ref_h,0);
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_set_reference_buffer(dice_handle handle,
+                        const void * pixels, int_t pixel_format,
+                        int_t ref_w, int_t ref_h, int_t row_stride){
+  if(handle==0 || pixels==0 || ref_w < 1 || ref_h < 1) return -1;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  try{
+    Teuchos::ArrayRCP<intensity_t> ref_buffer(ref_w*ref_h,0.0);
+    if(convert_pixels(pixels,pixel_format,ref_w,ref_h,row_stride,ref_buffer.getRawPtr())!=0) return -1;
+    set_context_reference(handle,ref_buffer,ref_w,ref_h);
+  }
+  catch(std::exception & e){
+    std::cerr << "Error, dice_set_reference_buffer() failed: " << e.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_correlate_frame(dice_handle handle,
+                        scalar_t points[],
+                        const intensity_t def_img[], int_t def_w, int_t def_h){
+  if(handle==0 || points==0 || def_img==0) return -1;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  // the reference image has to be set first and the frame has to be the same size
+  if(handle->ref_buffer.is_null() || def_w!=handle->ref_w || def_h!=handle->ref_h) return -1;
+  try{
+    Teuchos::ArrayRCP<intensity_t> def_buffer = next_def_buffer(handle);
+    std::copy(def_img,def_img+def_w*def_h,def_buffer.begin());
+    return correlate_context(handle,points,def_buffer);
+  }
+  catch(std::exception & e){
+    std::cerr << "Error, dice_correlate_frame() failed: " << e.what() << std::endl;
+    return -1;
+  }
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_correlate_frame_buffer(dice_handle handle,
+                        scalar_t points[],
+                        const void * pixels, int_t pixel_format,
+                        int_t def_w, int_t def_h, int_t row_stride){
+  if(handle==0 || points==0 || pixels==0) return -1;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  // the reference image has to be set first and the frame has to be the same size
+  if(handle->ref_buffer.is_null() || def_w!=handle->ref_w || def_h!=handle->ref_h) return -1;
+  try{
+    const bool packed = row_stride==0 || row_stride==def_w*(int_t)sizeof(intensity_t);
+    if(pixel_format==DICE_PIXEL_INTENSITY && packed && !handle->schema->gauss_filter_images()){
+      // wrap the caller's frame, the lifetime contract is documented in DICe_api.h
+      Teuchos::ArrayRCP<intensity_t> def_buffer(const_cast<intensity_t*>(static_cast<const intensity_t*>(pixels)),0,def_w*def_h,false);
+      return correlate_context(handle,points,def_buffer);
+    }
+    Teuchos::ArrayRCP<intensity_t> def_buffer = next_def_buffer(handle);
+    if(convert_pixels(pixels,pixel_format,def_w,def_h,row_stride,def_buffer.getRawPtr())!=0) return -1;
+    return correlate_context(handle,points,def_buffer);
+  }
+  catch(std::exception & e){
+    std::cerr << "Error, dice_correlate_frame_buffer() failed: " << e.what() << std::endl;
+    return -1;
+  }
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_stream_start(dice_handle handle,
+                        const scalar_t points[], int_t queue_capacity,
+                        scalar_t latency_budget_ms,
+                        dice_frame_callback callback, void * user_data){
+  if(handle==0 || points==0 || callback==0 || queue_capacity < 1 || latency_budget_ms < 0.0) return -1;
+  bool compute_beta = false;
+  {
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    // the reference image has to be set first
+    if(handle->ref_buffer.is_null()) return -1;
+    compute_beta = handle->schema->output_beta();
+  }
+  std::lock_guard<std::mutex> stream_lock(handle->stream_mutex);
+  if(handle->stream_running || handle->stream_thread.joinable()) return -1;
+  DEBUG_MSG("dice_stream_start() called with queue_capacity " << queue_capacity << " latency_budget_ms " << latency_budget_ms);
+  handle->stream_points.assign(points,points+handle->n_points*DICE_API_STRIDE);
+  handle->stream_capacity = queue_capacity;
+  handle->stream_budget_ms = latency_budget_ms;
+  handle->stream_compute_beta = compute_beta;
+  handle->stream_callback = callback;
+  handle->stream_user_data = user_data;
+  handle->stream_running = true;
+  try{
+    handle->stream_thread = std::thread(stream_loop,handle);
+  }
+  catch(std::system_error & e){
+    std::cerr << "Error, dice_stream_start() could not start the streaming thread: " << e.what() << std::endl;
+    handle->stream_running = false;
+    return -1;
+  }
+  return 0;
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_stream_push(dice_handle handle,
+                        int_t frame_id,
+                        const void * pixels, int_t pixel_format,
+                        int_t def_w, int_t def_h, int_t row_stride){
+  if(handle==0 || pixels==0 || def_w < 1 || def_h < 1) return -1;
+  Teuchos::ArrayRCP<intensity_t> buffer;
+  {
+    std::lock_guard<std::mutex> lock(handle->stream_mutex);
+    if(!handle->stream_running) return -1;
+    if(!handle->stream_free_buffers.empty()){
+      buffer = handle->stream_free_buffers.back();
+      handle->stream_free_buffers.pop_back();
+    }
+  }
+  // the conversion overlaps the correlation of the previous frame on the streaming thread
+  if(buffer.size()!=def_w*def_h)
+    buffer = Teuchos::ArrayRCP<intensity_t>(def_w*def_h,0.0);
+  const int_t error_code = convert_pixels(pixels,pixel_format,def_w,def_h,row_stride,buffer.getRawPtr());
+  {
+    std::lock_guard<std::mutex> lock(handle->stream_mutex);
+    if(error_code!=0 || !handle->stream_running){
+      handle->stream_free_buffers.push_back(buffer);
+      buffer = Teuchos::null;
+      return -1;
+    }
+    // a full queue drops the oldest frame so the results stay current
+    if((int_t)handle->stream_queue.size()>=handle->stream_capacity){
+      handle->stream_dropped.push_back(handle->stream_queue.front().frame_id);
+      handle->stream_free_buffers.push_back(handle->stream_queue.front().buffer);
+      handle->stream_queue.pop_front();
+    }
+    dice_context::stream_frame frame;
+    frame.frame_id = frame_id;
+    frame.buffer = buffer;
+    frame.push_time = std::chrono::steady_clock::now();
+    handle->stream_queue.push_back(frame);
+    // the reference counts are not atomic so the last local copy is released while the lock is held
+    frame.buffer = Teuchos::null;
+    buffer = Teuchos::null;
+  }
+  handle->stream_cv.notify_one();
+  return 0;
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_stream_stop(dice_handle handle,
+                        scalar_t points[]){
+  if(handle==0) return -1;
+  {
+    std::lock_guard<std::mutex> lock(handle->stream_mutex);
+    if(!handle->stream_running) return -1;
+    handle->stream_running = false;
+  }
+  handle->stream_cv.notify_all();
+  handle->stream_thread.join();
+  if(points!=0)
+    std::copy(handle->stream_points.begin(),handle->stream_points.end(),points);
+  return 0;
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_add_points(dice_handle handle,
+                        const scalar_t points[], int_t n_new){
+  if(handle==0 || points==0 || n_new < 1) return -1;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  DEBUG_MSG("dice_add_points() called with n_new " << n_new);
+  try{
+    const int_t n_points = handle->n_points + n_new;
     Teuchos::ArrayRCP<scalar_t> coords_x(n_points,0.0);
     Teuchos::ArrayRCP<scalar_t> coords_y(n_points,0.0);
-    for(int_t i=0;i<n_points;++i){
-      coords_x[i] = points[i*DICE_API_STRIDE + 0];
-      coords_y[i] = points[i*DICE_API_STRIDE + 1];
+    std::vector<int_t> source_ids(n_points,-1);
+    for(int_t i=0;i<handle->n_points;++i){
+      coords_x[i] = handle->schema->local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS);
+      coords_y[i] = handle->schema->local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS);
+      source_ids[i] = i;
+    }
+    for(int_t i=0;i<n_new;++i){
+      coords_x[handle->n_points+i] = points[i*DICE_API_STRIDE + 0];
+      coords_y[handle->n_points+i] = points[i*DICE_API_STRIDE + 1];
     }
-    schema = DICe::Schema(coords_x,coords_y,-1,conformal_area_defs,Teuchos::null,corr_params);
-    schema.set_ref_image(ref_w,ref_h,refRCP);
-    schema.set_obstructing_subset_ids(blocking_subset_ids);
+    return update_context_points(handle,coords_x,coords_y,source_ids);
   }
-  // set the deformed image manually in case this is not the first image in the set:
-  // the constructor won't get called on the static schema if this is not the first image since it's static
-  schema.set_def_image(ref_w,ref_h,defRCP);
+  catch(std::exception & e){
+    std::cerr << "Error, dice_add_points() failed: " << e.what() << std::endl;
+    return -1;
+  }
+}
 
-  initialized = true;
+DICE_LIB_DLL_EXPORT const int_t dice_remove_points(dice_handle handle,
+                        const int_t ids[], int_t n_remove){
+  if(handle==0 || ids==0 || n_remove < 1) return -1;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  DEBUG_MSG("dice_remove_points() called with n_remove " << n_remove);
+  std::vector<bool> removed(handle->n_points,false);
+  for(int_t i=0;i<n_remove;++i){
+    if(ids[i]<0 || ids[i]>=handle->n_points || removed[ids[i]]) return -1;
+    removed[ids[i]] = true;
+  }
+  // at least one point has to remain
+  if(n_remove>=handle->n_points) return -1;
+  try{
+    const int_t n_points = handle->n_points - n_remove;
+    Teuchos::ArrayRCP<scalar_t> coords_x(n_points,0.0);
+    Teuchos::ArrayRCP<scalar_t> coords_y(n_points,0.0);
+    std::vector<int_t> source_ids(n_points,-1);
+    int_t index = 0;
+    for(int_t i=0;i<handle->n_points;++i){
+      if(removed[i]) continue;
+      coords_x[index] = handle->schema->local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS);
+      coords_y[index] = handle->schema->local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS);
+      source_ids[index++] = i;
+    }
+    return update_context_points(handle,coords_x,coords_y,source_ids);
+  }
+  catch(std::exception & e){
+    std::cerr << "Error, dice_remove_points() failed: " << e.what() << std::endl;
+    return -1;
+  }
+}
 
-  // manually copy values into the schema's field values
-  for(int_t i=0;i<n_points;++i){
-    // leave the coordinates alone
-    schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS)   = points[i*DICE_API_STRIDE + 0];
-    schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS)   = points[i*DICE_API_STRIDE + 1];
-    schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_X_FS) = points[i*DICE_API_STRIDE + 2];
-    schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_Y_FS) = points[i*DICE_API_STRIDE + 3];
-    schema.local_field_value(i,DICe::field_enums::ROTATION_Z_FS)     = points[i*DICE_API_STRIDE + 4];
-    schema.local_field_value(i,DICe::field_enums::SIGMA_FS)          = points[i*DICE_API_STRIDE + 5];
-    schema.local_field_value(i,DICe::field_enums::GAMMA_FS)          = points[i*DICE_API_STRIDE + 6];
-    schema.local_field_value(i,DICe::field_enums::BETA_FS)           = points[i*DICE_API_STRIDE + 7];
-    schema.local_field_value(i,DICe::field_enums::STATUS_FLAG_FS)    = points[i*DICE_API_STRIDE + 8];
+DICE_LIB_DLL_EXPORT const int_t dice_move_points(dice_handle handle,
+                        const int_t ids[], const scalar_t points[], int_t n_move){
+  if(handle==0 || ids==0 || points==0 || n_move < 1) return -1;
+  std::lock_guard<std::mutex> lock(handle->mutex);
+  DEBUG_MSG("dice_move_points() called with n_move " << n_move);
+  try{
+    Teuchos::ArrayRCP<scalar_t> coords_x(handle->n_points,0.0);
+    Teuchos::ArrayRCP<scalar_t> coords_y(handle->n_points,0.0);
+    std::vector<int_t> source_ids(handle->n_points,-1);
+    for(int_t i=0;i<handle->n_points;++i){
+      coords_x[i] = handle->schema->local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS);
+      coords_y[i] = handle->schema->local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS);
+      source_ids[i] = i;
+    }
+    for(int_t i=0;i<n_move;++i){
+      if(ids[i]<0 || ids[i]>=handle->n_points) return -1;
+      coords_x[ids[i]] = points[i*DICE_API_STRIDE + 0];
+      coords_y[ids[i]] = points[i*DICE_API_STRIDE + 1];
+    }
+    return update_context_points(handle,coords_x,coords_y,source_ids);
+  }
+  catch(std::exception & e){
+    std::cerr << "Error, dice_move_points() failed: " << e.what() << std::endl;
+    return -1;
   }
-  TEUCHOS_TEST_FOR_EXCEPTION(schema.quadratic_shape_function_enabled(),std::runtime_error,"Error, cannot use quadratic shape function for the api routines");
+}
 
-  schema.execute_correlation();
+DICE_LIB_DLL_EXPORT void dice_destroy(dice_handle handle){
+  if(handle==0) return;
+  dice_stream_stop(handle,0);
+  delete handle;
+}
+
+DICE_LIB_DLL_EXPORT const int_t dice_correlate(scalar_t points[], int_t n_points,
+                        int_t subset_size,
+                        intensity_t ref_img[], int_t ref_w, int_t ref_h,
+                        intensity_t def_img[], int_t def_w, int_t def_h,
+                        Teuchos::ParameterList * input_params, const bool update_params){
 
-  if(write_output)
-    schema.write_output("./");
+  // this signature keeps a single context alive for the life of the process
+  static dice_handle handle = 0;
 
-  // extract the values from the correlation and put it back in the data array:
-  for(int_t i=0;i<n_points;++i){
-    points[i*DICE_API_STRIDE + 0] = schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS);
-    points[i*DICE_API_STRIDE + 1] = schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS);
-    points[i*DICE_API_STRIDE + 2] = schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_X_FS);
-    points[i*DICE_API_STRIDE + 3] = schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_Y_FS);
-    points[i*DICE_API_STRIDE + 4] = schema.local_field_value(i,DICe::field_enums::ROTATION_Z_FS);
-    points[i*DICE_API_STRIDE + 5] = schema.local_field_value(i,DICe::field_enums::SIGMA_FS);
-    points[i*DICE_API_STRIDE + 6] = schema.local_field_value(i,DICe::field_enums::GAMMA_FS);
-    points[i*DICE_API_STRIDE + 7] = schema.local_field_value(i,DICe::field_enums::BETA_FS);
-    points[i*DICE_API_STRIDE + 8] = schema.local_field_value(i,DICe::field_enums::STATUS_FLAG_FS);
+  DEBUG_MSG("dice_correlate() called with the following values:");
+  DEBUG_MSG("n_points               " << n_points);
+  DEBUG_MSG("subset_size            " << subset_size);
+  DEBUG_MSG("ref_w                  " << ref_w);
+  DEBUG_MSG("ref_h                  " << ref_h);
+  DEBUG_MSG("def_w                  " << def_w);
+  DEBUG_MSG("def_h                  " << def_h);
+  DEBUG_MSG("update params          " << update_params);
+  DEBUG_MSG("is initialized         " << (handle!=0));
+
+  // throw an error if the images are not of the same size
+  if(ref_w!=def_w||ref_h!=def_h) return -1;
+  // throw an error if the subset size is less than 1 pixel
+  if(subset_size < 1) return -1;
+  // throw an error if n_points is less than one
+  if(n_points < 1) return -1;
+
+  if(handle==0){
+    handle = dice_create(points,n_points,subset_size,input_params);
+    if(handle==0) return -1;
+    if(dice_set_reference(handle,ref_img,ref_w,ref_h)!=0){
+      dice_destroy(handle);
+      handle = 0;
+      return -1;
+    }
   }
+  else if(update_params){
+    // call set_params on the schema in case the parameters have changed
+    if(input_params!=0)
+      *handle->params = *input_params;
+    try{
+      handle->schema->set_params(handle->params);
+    }
+    catch(std::exception & e){
+      std::cerr << "Error, dice_correlate() failed to update the parameters: " << e.what() << std::endl;
+      return -1;
+    }
+    if(check_context(handle)!=0) return -1;
+  }
+  if(n_points!=handle->n_points){
+    // the points that are still there keep their objectives, the coordinates come from the points array
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    try{
+      Teuchos::ArrayRCP<scalar_t> coords_x(n_points,0.0);
+      Teuchos::ArrayRCP<scalar_t> coords_y(n_points,0.0);
+      std::vector<int_t> source_ids(n_points,-1);
+      for(int_t i=0;i<n_points;++i){
+        coords_x[i] = points[i*DICE_API_STRIDE + 0];
+        coords_y[i] = points[i*DICE_API_STRIDE + 1];
+        if(i<handle->n_points) source_ids[i] = i;
+      }
+      if(update_context_points(handle,coords_x,coords_y,source_ids)!=0) return -1;
+    }
+    catch(std::exception & e){
+      std::cerr << "Error, dice_correlate() failed to change the number of points: " << e.what() << std::endl;
+      return -1;
+    }
+  }
+  return dice_correlate_frame(handle,points,def_img,def_w,def_h);
+}
 
+DICE_LIB_DLL_EXPORT const int_t dice_correlate_conformal(scalar_t points[],
+                        intensity_t ref_img[], int_t ref_w, int_t ref_h,
+                        intensity_t def_img[], int_t def_w, int_t def_h,
+                        const char* subset_file, const char* param_file,
+                        const bool write_output){
+
+  // this signature keeps a single context alive for the life of the process
+  static dice_handle handle = 0;
+
+  DEBUG_MSG("dice_correlate_conformal() called with the following values:");
+  DEBUG_MSG("ref_w                  " << ref_w);
+  DEBUG_MSG("ref_h                  " << ref_h);
+  DEBUG_MSG("def_w                  " << def_w);
+  DEBUG_MSG("def_h                  " << def_h);
+  DEBUG_MSG("write output           " << write_output);
+  DEBUG_MSG("is initialized         " << (handle!=0));
+
+  // throw an error if the images are not of the same size
+  if(ref_w!=def_w||ref_h!=def_h) return -1;
+
+  if(handle==0){
+    handle = dice_create_conformal(subset_file,ref_w,ref_h,param_file);
+    if(handle==0) return -1;
+    if(dice_set_reference(handle,ref_img,ref_w,ref_h)!=0){
+      dice_destroy(handle);
+      handle = 0;
+      return -1;
+    }
+  }
+  const int_t error_code = dice_correlate_frame(handle,points,def_img,def_w,def_h);
+  if(error_code!=0) return error_code;
+
+  if(write_output){
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    try{
+      handle->schema->write_output("./");
+    }
+    catch(std::exception & e){
+      std::cerr << "Error, dice_correlate_conformal() failed to write the output: " << e.what() << std::endl;
+      return -1;
+    }
+  }
   return 0;
 }
 
@@ -174,6 +174,203 @@ DICE_LIB_DLL_EXPORT const int_t dice_correlate_conformal(scalar_t points[],
                         const char* subset_file, const char* param_file=0,
                         const bool write_output=false);
 
+/// Opaque handle to a persistent correlation context
+///
+/// Each handle owns its own schema, parameters and objectives so that several camera
+/// streams can be correlated in one process. The objectives and subsets are created
+/// once and kept alive across frames. A handle may be used from any thread, but calls
+/// on the same handle are serialized.
+typedef struct dice_context * dice_handle;
+
+/// \brief Create a correlation context for a set of square subsets
+/// \param points:       An array of (n_points * DICE_API_STRIDE) values, only x and y are read
+/// \param n_points:     The number of points
+/// \param subset_size:  The subset size to use for correlation
+/// \param input_params: Optional ParameterList (copied into the handle), if null the tracking defaults are used
+///
+/// Returns a null handle if the context could not be created
+DICE_LIB_DLL_EXPORT dice_handle dice_create(const scalar_t points[], int_t n_points,
+                        int_t subset_size,
+                        Teuchos::ParameterList * input_params=0);
+
+/// \brief Create a correlation context for the conformal subsets defined in a subset file
+/// \param subset_file: Required file name containing conformal subset definitions and subset centroids
+/// \param ref_w:       The width of the reference image
+/// \param ref_h:       The height of the reference image
+/// \param param_file:  Optional file name containing the user specified xml correlation parameters
+///
+/// Returns a null handle if the context could not be created. Use dice_num_points() to size
+/// the points array, the subset centroids are written to it by dice_correlate_frame()
+DICE_LIB_DLL_EXPORT dice_handle dice_create_conformal(const char* subset_file,
+                        int_t ref_w, int_t ref_h,
+                        const char* param_file=0);
+
+/// \brief Returns the number of points in the context or -1 for an invalid handle
+DICE_LIB_DLL_EXPORT const int_t dice_num_points(dice_handle handle);
+
+/// \brief Set (or replace) the reference image of the context
+///
+/// The intensities are copied so the caller's buffer can be released once this returns.
+/// Replacing the reference image rebuilds the objectives on the next frame.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_set_reference(dice_handle handle,
+                        const intensity_t ref_img[], int_t ref_w, int_t ref_h);
+
+/// \brief Correlate one deformed frame against the reference image of the context
+///
+/// The points array has the same layout and meaning as for dice_correlate(). The deformed
+/// intensities are copied into a buffer owned by the handle so the caller can reuse
+/// its frame buffer as soon as this returns.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_correlate_frame(dice_handle handle,
+                        scalar_t points[],
+                        const intensity_t def_img[], int_t def_w, int_t def_h);
+
+/// Pixel formats accepted by the buffer based routines
+/// intensity_t values
+#define DICE_PIXEL_INTENSITY 0
+/// unsigned 8-bit integer values
+#define DICE_PIXEL_UINT8 1
+/// unsigned 16-bit integer values
+#define DICE_PIXEL_UINT16 2
+
+/// \brief Set (or replace) the reference image of the context from an externally owned buffer
+/// \param pixels:       The first pixel of the image
+/// \param pixel_format: One of the DICE_PIXEL_* formats
+/// \param ref_w:        The width of the reference image
+/// \param ref_h:        The height of the reference image
+/// \param row_stride:   The number of bytes between the start of two rows (0 for tightly packed rows)
+///
+/// The pixels are converted into the context, so the buffer can be released once this returns.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_set_reference_buffer(dice_handle handle,
+                        const void * pixels, int_t pixel_format,
+                        int_t ref_w, int_t ref_h, int_t row_stride);
+
+/// \brief Correlate one deformed frame held in an externally owned buffer
+/// \param pixels:       The first pixel of the frame
+/// \param pixel_format: One of the DICE_PIXEL_* formats
+/// \param def_w:        The width of the frame (must match the reference)
+/// \param def_h:        The height of the frame (must match the reference)
+/// \param row_stride:   The number of bytes between the start of two rows (0 for tightly packed rows)
+///
+/// Tightly packed DICE_PIXEL_INTENSITY frames are wrapped without copying (unless the
+/// images are gauss filtered, since the filter is applied in place). In that case the
+/// caller must keep the buffer valid and unmodified until the next frame has been
+/// correlated on this handle or the handle is destroyed, since the frame is used as the
+/// previous image for the next frame. A ring of two frame buffers satisfies this.
+/// All other frames are converted in a single pass into a buffer owned by the handle
+/// and the caller's buffer can be reused once this returns.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_correlate_frame_buffer(dice_handle handle,
+                        scalar_t points[],
+                        const void * pixels, int_t pixel_format,
+                        int_t def_w, int_t def_h, int_t row_stride);
+
+/// Status values passed to a dice_frame_callback
+/// the frame was correlated
+#define DICE_STREAM_OK 0
+/// the frame was correlated without beta to stay within the latency budget (beta is reported as 0.0)
+#define DICE_STREAM_DEGRADED 1
+/// the frame was dropped without being correlated because newer frames were waiting (points is null)
+#define DICE_STREAM_DROPPED 2
+/// the correlation of the frame failed
+#define DICE_STREAM_FAILED -1
+
+/// \brief Callback that receives the result of each frame pushed with dice_stream_push()
+/// \param frame_id:  The id the frame was pushed with
+/// \param points:    The results with the same layout as for dice_correlate(), only valid during the call
+/// \param n_points:  The number of points
+/// \param status:    One of the DICE_STREAM_* values
+/// \param user_data: The pointer given to dice_stream_start()
+///
+/// The callbacks are made from the streaming thread in the order the frames were pushed.
+/// A callback must not call the dice_stream_* routines for the same handle.
+typedef void (*dice_frame_callback)(int_t frame_id, const scalar_t points[], int_t n_points,
+                        int_t status, void * user_data);
+
+/// \brief Start correlating the frames pushed to the context on a background thread
+/// \param points:            The initial values (dice_num_points() * DICE_API_STRIDE values, copied), the
+///                           result of each frame is the initial guess for the next one
+/// \param queue_capacity:    The number of frames that can wait to be correlated (at least 1), when the
+///                           queue is full the oldest waiting frame is dropped
+/// \param latency_budget_ms: The target time in milliseconds from dice_stream_push() to the callback
+///                           (0 for no budget). When a frame takes longer, beta is skipped for the next frame
+///                           and waiting frames that are already over the budget are dropped if a newer
+///                           frame is waiting, so the results stay current
+/// \param callback:          Receives the result of each frame
+/// \param user_data:         Passed to the callback unchanged
+///
+/// The reference image has to be set first. While the stream is running the frames are converted
+/// by dice_stream_push() on the caller's thread and correlated on the streaming thread, so the
+/// conversion of the next frame overlaps the correlation of the current one.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_stream_start(dice_handle handle,
+                        const scalar_t points[], int_t queue_capacity,
+                        scalar_t latency_budget_ms,
+                        dice_frame_callback callback, void * user_data);
+
+/// \brief Queue a frame for the streaming thread
+/// \param frame_id:     An id that is passed back to the callback
+/// \param pixels:       The first pixel of the frame
+/// \param pixel_format: One of the DICE_PIXEL_* formats
+/// \param def_w:        The width of the frame (must match the reference)
+/// \param def_h:        The height of the frame (must match the reference)
+/// \param row_stride:   The number of bytes between the start of two rows (0 for tightly packed rows)
+///
+/// The pixels are converted into a buffer owned by the context before this returns, so the caller
+/// can reuse its frame buffer right away. This never waits for the correlation.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_stream_push(dice_handle handle,
+                        int_t frame_id,
+                        const void * pixels, int_t pixel_format,
+                        int_t def_w, int_t def_h, int_t row_stride);
+
+/// \brief Correlate the frames that are still queued and stop the streaming thread
+///
+/// The final results are copied to points if it is not null. Streaming can be started again afterwards.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_stream_stop(dice_handle handle,
+                        scalar_t points[]);
+
+/// \brief Append points to the correlation context
+/// \param points: An array of (n_new * DICE_API_STRIDE) values, only x and y are read
+/// \param n_new:  The number of points to add
+///
+/// The new points get the ids dice_num_points() to dice_num_points() + n_new - 1. The schema,
+/// the images and the objectives of the existing points are kept, only the new subsets are built.
+/// Not available for conformal contexts or while a stream is running.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_add_points(dice_handle handle,
+                        const scalar_t points[], int_t n_new);
+
+/// \brief Remove points from the correlation context
+/// \param ids:      The ids of the points to remove
+/// \param n_remove: The number of ids (fewer than dice_num_points())
+///
+/// The remaining points keep their order and are renumbered from 0, so the points array
+/// passed to the next frame has to be compacted the same way.
+/// Not available for conformal contexts or while a stream is running.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_remove_points(dice_handle handle,
+                        const int_t ids[], int_t n_remove);
+
+/// \brief Move points of the correlation context to new reference locations
+/// \param ids:    The ids of the points to move
+/// \param points: An array of (n_move * DICE_API_STRIDE) values, only x and y are read
+/// \param n_move: The number of points to move
+///
+/// Only the subsets of the moved points are rebuilt, the ids do not change.
+/// Not available for conformal contexts or while a stream is running.
+/// Returns 0 on success, otherwise an error code is returned.
+DICE_LIB_DLL_EXPORT const int_t dice_move_points(dice_handle handle,
+                        const int_t ids[], const scalar_t points[], int_t n_move);
+
+/// \brief Release the context and everything it owns (null handles are ignored)
+///
+/// A running stream is stopped first.
+DICE_LIB_DLL_EXPORT void dice_destroy(dice_handle handle);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -40,16 +40,19 @@
 // @HEADER
 
 #include <DICe.h>
+#include <DICe_SharedFrameCache.h>
 
 #include <iostream>
 #include <string.h>
 
 #if DICE_KOKKOS
   #include <DICe_Kokkos.h>
+  #include <DICe_ImageViewPool.h>
   #include <Kokkos_Core.hpp>
 #endif
 #if DICE_MPI
   #include <mpi.h>
+  #include <DICe_NodeSharedMemory.h>
 #endif
 
 
@@ -90,6 +93,8 @@ void initialize(int argc,
 #if DICE_MPI
   MPI_Init (&argc, &argv);
   MPI_Comm_rank(MPI_COMM_WORLD,&proc_rank);
+  // the node communicator is set up while all processes are here
+  Node_Shared_Memory::node_size();
 #endif
   // initialize kokkos
 #if DICE_KOKKOS
@@ -108,12 +113,18 @@ void initialize(int argc,
 /// Finalize function (mpi and kokkos if enabled):
 DICE_LIB_DLL_EXPORT
 void finalize(){
+  // the shared frames have to be released before their memory is
+  Shared_Frame_Cache::clear();
   // finalize mpi
 #if DICE_MPI
+  // freeing the shared image windows is collective over the node
+  Node_Shared_Memory::clear();
   (void) MPI_Finalize ();
 #endif
   // finalize kokkos
 #if DICE_KOKKOS
+  // the pooled image buffers have to be freed while kokkos is still initialized
+  Image_View_Pool::instance().clear();
   Kokkos::finalize();
 #endif
 }
@@ -90,6 +90,11 @@ namespace DICe{
   typedef float scalar_t;
 #endif
 
+/// type used to accumulate sums over the pixels of a subset and to assemble the optimization
+/// systems (always double so that builds without DICE_USE_DOUBLE only store the images,
+/// gradients and subset intensities in single precision)
+typedef double accumulate_t;
+
 /// integer type
 typedef int int_t;
 
@@ -132,6 +137,12 @@ const char* const gauss_filter_use_hierarchical_parallelism = "gauss_filter_use_
 /// String parameter name
 const char* const gauss_filter_team_size = "gauss_filter_team_size";
 /// String parameter name
+const char* const auto_tune_kokkos_policies = "auto_tune_kokkos_policies";
+/// String parameter name
+const char* const kokkos_policy_cache_file = "kokkos_policy_cache_file";
+/// String parameter name
+const char* const num_threads = "num_threads";
+/// String parameter name
 const char* const gauss_filter_mask_size = "gauss_filter_mask_size";
 /// String parameter name
 const char* const correlation_routine = "correlation_routine";
@@ -150,6 +161,16 @@ const char* const compute_laplacian_image = "compute_laplacian_image";
 /// String parameter name
 const char* const initialization_method = "initialization_method";
 /// String parameter name
+const char* const phase_correlation_window_size = "phase_correlation_window_size";
+/// String parameter name
+const char* const feature_matcher = "feature_matcher";
+/// String parameter name
+const char* const output_feature_matching_image = "output_feature_matching_image";
+/// String parameter name
+const char* const feature_tile_size = "feature_tile_size";
+/// String parameter name
+const char* const max_features_per_tile = "max_features_per_tile";
+/// String parameter name
 const char* const optimization_method = "optimization_method";
 /// String parameter name
 const char* const projection_method = "projection_method";
@@ -192,12 +213,22 @@ const char* const final_gamma_threshold = "final_gamma_threshold";
 /// String parameter name
 const char* const path_distance_threshold = "path_distance_threshold";
 /// String parameter name
+const char* const low_contrast_threshold = "low_contrast_threshold";
+/// String parameter name
+const char* const low_sssig_threshold = "low_sssig_threshold";
+/// String parameter name
+const char* const low_contrast_recheck_interval = "low_contrast_recheck_interval";
+/// String parameter name
 const char* const skip_all_solves = "skip_all_solves";
 /// String parameter name
 const char* const skip_solve_gamma_threshold = "skip_solve_gamma_threshold";
 /// String parameter name
 const char* const fast_solver_tolerance = "fast_solver_tolerance";
 /// String parameter name
+const char* const noise_adaptive_tolerance_factor = "noise_adaptive_tolerance_factor";
+/// String parameter name
+const char* const progressive_sampling_stride = "progressive_sampling_stride";
+/// String parameter name
 const char* const pixel_size_in_mm = "pixel_size_in_mm";
 /// String parameter name
 const char* const disp_jump_tol = "disp_jump_tol";
@@ -218,6 +249,8 @@ const char* const use_subset_evolution = "use_subset_evolution";
 /// String parameter name
 const char* const output_beta = "output_beta";
 /// String parameter name
+const char* const analytic_beta = "analytic_beta";
+/// String parameter name
 const char* const global_regularization_alpha = "global_regularization_alpha";
 /// String parameter name
 const char* const global_stabilization_tau = "global_stabilization_tau";
@@ -244,6 +277,26 @@ const char* const override_force_simplex = "override_force_simplex";
 /// String parameter name
 const char* const use_search_initialization_for_failed_steps = "use_search_initialization_for_failed_steps";
 /// String parameter name
+const char* const search_initialization_radius = "search_initialization_radius";
+/// String parameter name
+const char* const search_initialization_pyramid_levels = "search_initialization_pyramid_levels";
+/// String parameter name
+const char* const pyramid_correlation_levels = "pyramid_correlation_levels";
+/// String parameter name
+const char* const reliability_guided_propagation = "reliability_guided_propagation";
+/// String parameter name
+const char* const adaptive_grid_coarsening = "adaptive_grid_coarsening";
+/// String parameter name
+const char* const adaptive_grid_tolerance = "adaptive_grid_tolerance";
+/// String parameter name
+const char* const adaptive_grid_gamma_threshold = "adaptive_grid_gamma_threshold";
+/// String parameter name
+const char* const motion_window_sample_stride = "motion_window_sample_stride";
+/// String parameter name
+const char* const test_motion_on_raw_pixels = "test_motion_on_raw_pixels";
+/// String parameter name
+const char* const image_frame_cache_size = "image_frame_cache_size";
+/// String parameter name
 const char* const normalize_gamma_with_active_pixels = "normalize_gamma_with_active_pixels";
 /// String parameter name
 const char* const levenberg_marquardt_regularization_factor = "levenberg_marquardt_regularization_factor";
@@ -286,11 +339,53 @@ const char* const estimate_resolution_error_speckle_size = "estimate_resolution_
 /// String parameter name
 const char* const estimate_resolution_error_noise_percent = "estimate_resolution_error_noise_percent";
 /// String parameter name
+const char* const estimate_resolution_error_max_error = "estimate_resolution_error_max_error";
+/// String parameter name
+const char* const tune_throughput = "tune_throughput";
+/// String parameter name
+const char* const tune_throughput_sample_size = "tune_throughput_sample_size";
+/// String parameter name
+const char* const tune_throughput_amplitude = "tune_throughput_amplitude";
+/// String parameter name
+const char* const tune_throughput_noise_percent = "tune_throughput_noise_percent";
+/// String parameter name
+const char* const tune_throughput_max_error = "tune_throughput_max_error";
+/// String parameter name
+const char* const tune_throughput_output_file = "tune_throughput_output_file";
+/// String parameter name
 const char* const use_incremental_formulation = "use_incremental_formulation";
 /// String parameter name
 const char* const use_nonlinear_projection = "use_nonlinear_projection";
 /// String parameter name
 const char* const sort_txt_output = "sort_txt_output";
+/// String parameter name
+const char* const exodus_output_buffer_size = "exodus_output_buffer_size";
+/// String parameter name
+const char* const use_spatial_decomposition = "use_spatial_decomposition";
+/// String parameter name
+const char* const overlap_halo_exchange = "overlap_halo_exchange";
+/// String parameter name
+const char* const use_batched_device_correlation = "use_batched_device_correlation";
+/// String parameter name
+const char* const share_reference_intensities = "share_reference_intensities";
+/// String parameter name
+const char* const use_tiled_image_layout = "use_tiled_image_layout";
+/// String parameter name
+const char* const lazy_image_gradients = "lazy_image_gradients";
+/// String parameter name
+const char* const reference_image_cache_folder = "reference_image_cache_folder";
+/// String parameter name
+const char* const numa_first_touch_images = "numa_first_touch_images";
+/// String parameter name
+const char* const use_huge_pages_for_images = "use_huge_pages_for_images";
+/// String parameter name
+const char* const analytic_def_gradients = "analytic_def_gradients";
+/// String parameter name
+const char* const quantized_interpolation_weights = "quantized_interpolation_weights";
+/// String parameter name
+const char* const node_shared_images = "node_shared_images";
+/// String parameter name
+const char* const shared_frame_cache_size = "shared_frame_cache_size";
 /// String parameter name, only for global DIC
 const char* const global_solver = "global_solver";
 /// String parameter name, only for global DIC
@@ -309,6 +404,24 @@ const char* const num_image_integration_points = "num_image_integration_points";
 const char* const global_element_type = "global_element_type";
 /// String parameter name, only for global DIC
 const char* const use_fixed_point_iterations = "use_fixed_point_iterations";
+/// String parameter name, only for global DIC
+const char* const global_use_matrix_free = "global_use_matrix_free";
+/// String parameter name, only for global DIC
+const char* const global_preconditioner = "global_preconditioner";
+/// String parameter name, only for global DIC
+const char* const global_reuse_preconditioner = "global_reuse_preconditioner";
+/// String parameter name, only for global DIC
+const char* const global_preconditioner_max_reuse = "global_preconditioner_max_reuse";
+/// String parameter name, only for global DIC
+const char* const global_preconditioner_rebuild_iterations = "global_preconditioner_rebuild_iterations";
+/// String parameter name
+const char* const global_output_frequency = "global_output_frequency";
+/// String parameter name, only for global DIC
+const char* const global_mesh_cache_folder = "global_mesh_cache_folder";
+/// String parameter name, only for global DIC
+const char* const global_warm_start_extrapolation = "global_warm_start_extrapolation";
+/// String parameter name, only for global DIC
+const char* const global_warm_start_window_size = "global_warm_start_window_size";
 
 
 /// enums:
@@ -372,6 +485,7 @@ enum Projection_Method {
   DISPLACEMENT_BASED=0,
   VELOCITY_BASED,
   MULTISTEP,
+  POLYNOMIAL_BASED,
   // DON'T ADD ANY BELOW MAX
   MAX_PROJECTION_METHOD,
   NO_SUCH_PROJECTION_METHOD
@@ -380,7 +494,8 @@ enum Projection_Method {
 const static char * projectionMethodStrings[] = {
   "DISPLACEMENT_BASED",
   "VELOCITY_BASED",
-  "MULTISTEP"
+  "MULTISTEP",
+  "POLYNOMIAL_BASED"
 };
 
 /// Initialization method
@@ -392,6 +507,7 @@ enum Initialization_Method {
   USE_OPTICAL_FLOW,
   USE_ZEROS,
   USE_FEATURE_MATCHING,
+  USE_WINDOWED_PHASE_CORRELATION,
   INITIALIZATION_METHOD_NOT_APPLICABLE,
   // DON'T ADD ANY BELOW MAX
   MAX_INITIALIZATION_METHOD,
@@ -406,9 +522,24 @@ const static char * initializationMethodStrings[] = {
   "USE_OPTICAL_FLOW",
   "USE_ZEROS",
   "USE_FEATURE_MATCHING",
+  "USE_WINDOWED_PHASE_CORRELATION",
   "INITIALIZATION_METHOD_NOT_APPLICABLE"
 };
 
+/// Matcher used to pair feature descriptors
+enum Feature_Matcher {
+  BRUTE_FORCE_FEATURE_MATCHER=0,
+  FLANN_LSH_FEATURE_MATCHER,
+  // DON'T ADD ANY BELOW MAX
+  MAX_FEATURE_MATCHER,
+  NO_SUCH_FEATURE_MATCHER
+};
+
+const static char * featureMatcherStrings[] = {
+  "BRUTE_FORCE_FEATURE_MATCHER",
+  "FLANN_LSH_FEATURE_MATCHER"
+};
+
 /// Optimization method
 enum Optimization_Method {
   SIMPLEX=0,
@@ -416,6 +547,8 @@ enum Optimization_Method {
   GRADIENT_THEN_SEARCH,
   SIMPLEX_THEN_GRADIENT_BASED,
   GRADIENT_BASED_THEN_SIMPLEX,
+  INVERSE_COMPOSITIONAL,
+  INVERSE_COMPOSITIONAL_THEN_SIMPLEX,
   OPTIMIZATION_METHOD_NOT_APPLICABLE,
   // DON'T ADD ANY BELOW MAX
   MAX_OPTIMIZATION_METHOD,
@@ -428,6 +561,8 @@ const static char * optimizationMethodStrings[] = {
   "GRADIENT_THEN_SEARCH",
   "SIMPLEX_THEN_GRADIENT_BASED",
   "GRADIENT_BASED_THEN_SIMPLEX",
+  "INVERSE_COMPOSITIONAL",
+  "INVERSE_COMPOSITIONAL_THEN_SIMPLEX",
   "OPTIMIZATION_METHOD_NOT_APPLICABLE"
 };
 
@@ -436,6 +571,8 @@ enum Interpolation_Method {
   BILINEAR=0,
   BICUBIC,
   KEYS_FOURTH,
+  CUBIC_BSPLINE,
+  QUINTIC_BSPLINE,
   // DON'T ADD ANY BELOW MAX
   MAX_INTERPOLATION_METHOD,
   NO_SUCH_INTERPOLATION_METHOD
@@ -444,7 +581,9 @@ enum Interpolation_Method {
 const static char * interpolationMethodStrings[] = {
   "BILINEAR",
   "BICUBIC",
-  "KEYS_FOURTH"
+  "KEYS_FOURTH",
+  "CUBIC_BSPLINE",
+  "QUINTIC_BSPLINE"
 };
 
 /// Gradient method
@@ -545,6 +684,10 @@ enum Status_Flag{
   FRAME_SKIPPED,
   // 31
   FRAME_SKIPPED_DUE_TO_NO_MOTION,
+  // 32
+  SUBSET_REJECTED_DUE_TO_LOW_CONTRAST,
+  // 33
+  SUBSET_INTERPOLATED_FROM_COARSE_GRID,
   // DON'T ADD ANY BELOW MAX
   MAX_STATUS_FLAG,
   NO_SUCH_STATUS_FLAG
@@ -573,6 +716,7 @@ enum Image_File_Type{
   PNG,
   NETCDF,
   CINE,
+  RAWV,
   MAX_IMAGE_FILE_TYPE,
   NO_SUCH_IMAGE_FILE_TYPE
 };
@@ -626,6 +770,15 @@ enum Global_Solver{
   NO_SUCH_GLOBAL_SOLVER
 };
 
+/// Global preconditioner type
+enum Global_Preconditioner{
+  ILU_PRECONDITIONER=0,
+  JACOBI_PRECONDITIONER,
+  AMG_PRECONDITIONER,
+  BLOCK_PRECONDITIONER,
+  NO_SUCH_GLOBAL_PRECONDITIONER
+};
+
 /// \class DICe::Extents
 /// \brief collection of origin x, y and width and height
 struct Extents {
@@ -739,6 +892,23 @@ const Correlation_Parameter gauss_filter_team_size_param(gauss_filter_team_size,
   true,
   "The team size to use for thread teams when computing Gaussian filter.");
 /// Correlation parameter and properties
+const Correlation_Parameter auto_tune_kokkos_policies_param(auto_tune_kokkos_policies,
+  BOOL_PARAM,
+  true,
+  "Benchmark the flat and team policies with a range of team sizes for the Kokkos image kernels the first time they run "
+  "and use the fastest (the kernels given an explicit policy or team size are not tuned, builds with Kokkos only)");
+/// Correlation parameter and properties
+const Correlation_Parameter kokkos_policy_cache_file_param(kokkos_policy_cache_file,
+  STRING_PARAM,
+  true,
+  "File the policies tuned by auto_tune_kokkos_policies are stored in and read from so the benchmarks only run once per machine");
+/// Correlation parameter and properties
+const Correlation_Parameter num_threads_param(num_threads,
+  SIZE_PARAM,
+  true,
+  "The number of threads used to correlate independent subsets concurrently on each processor "
+  "(requires OpenMP, values less than one use all available threads).");
+/// Correlation parameter and properties
 const Correlation_Parameter gauss_filter_mask_size_param(gauss_filter_mask_size,
   SIZE_PARAM,
   true,
@@ -817,6 +987,45 @@ const Correlation_Parameter estimate_resolution_error_noise_percent_param(estima
   true,
   "amount of noise to add in percent of counts to the deformed image in the estimation of resolution error");
 /// Correlation parameter and properties
+const Correlation_Parameter estimate_resolution_error_max_error_param(estimate_resolution_error_max_error,
+  SCALAR_PARAM,
+  true,
+  "stop the estimation of resolution error early once the average relative displacement error (%) of a case exceeds "
+  "this value: the remaining amplitudes of that period are skipped and, if it is the first amplitude, the shorter periods as well");
+/// Correlation parameter and properties
+const Correlation_Parameter tune_throughput_param(tune_throughput,
+  BOOL_PARAM,
+  true,
+  "Only evaluates candidate subset sizes, interpolation methods, shape functions and solver tolerances on a sample of the subsets"
+  " (with a known motion applied to the reference image), reports the Pareto front of throughput vs. error and writes the"
+  " parameters of the selected candidate to tune_throughput_output_file");
+/// Correlation parameter and properties
+const Correlation_Parameter tune_throughput_sample_size_param(tune_throughput_sample_size,
+  SIZE_PARAM,
+  true,
+  "maximum number of subsets the throughput tuning correlates for each candidate (default 200)");
+/// Correlation parameter and properties
+const Correlation_Parameter tune_throughput_amplitude_param(tune_throughput_amplitude,
+  SCALAR_PARAM,
+  true,
+  "amplitude in pixels of the motion applied to the reference image in the throughput tuning (default 1.0)");
+/// Correlation parameter and properties
+const Correlation_Parameter tune_throughput_noise_percent_param(tune_throughput_noise_percent,
+  SCALAR_PARAM,
+  true,
+  "amount of noise to add in percent of counts to the deformed image in the throughput tuning");
+/// Correlation parameter and properties
+const Correlation_Parameter tune_throughput_max_error_param(tune_throughput_max_error,
+  SCALAR_PARAM,
+  true,
+  "accuracy target of the throughput tuning: the fastest candidate with an average displacement error (pixels) at or below"
+  " this value is selected (the most accurate candidate if none meets it or the value is negative)");
+/// Correlation parameter and properties
+const Correlation_Parameter tune_throughput_output_file_param(tune_throughput_output_file,
+  STRING_PARAM,
+  true,
+  "name of the correlation parameters file the throughput tuning writes to the output folder (default tuned_correlation_params.xml)");
+/// Correlation parameter and properties
 const Correlation_Parameter use_incremental_formulation_param(use_incremental_formulation,
   BOOL_PARAM,
   true,
@@ -832,6 +1041,95 @@ const Correlation_Parameter sort_txt_output_param(sort_txt_output,
   true,
   "Sort the text output file according to the subset location in x then y for the full field results");
 /// Correlation parameter and properties
+const Correlation_Parameter exodus_output_buffer_size_param(exodus_output_buffer_size,
+  SIZE_PARAM,
+  true,
+  "The number of time steps of exodus output kept in memory and written to the file together (default 1 writes every step "
+  "as it is computed, larger values avoid flushing the file each step but the buffered steps are lost if the run is killed)");
+/// Correlation parameter and properties
+const Correlation_Parameter use_spatial_decomposition_param(use_spatial_decomposition,
+  BOOL_PARAM,
+  true,
+  "Split the subsets among processors by location so that each processor owns a compact region of the image "
+  "(balanced by the number of pixels in each subset) rather than by subset id");
+/// Correlation parameter and properties
+const Correlation_Parameter overlap_halo_exchange_param(overlap_halo_exchange,
+  BOOL_PARAM,
+  true,
+  "For parallel runs with post processors, correlate the subsets other processors need first and send their values "
+  "while the rest of the subsets are correlated (only for the generic routine without neighbor initialization or the incremental formulation)");
+/// Correlation parameter and properties
+const Correlation_Parameter use_batched_device_correlation_param(use_batched_device_correlation,
+  BOOL_PARAM,
+  true,
+  "Run the gradient based solve for all the subsets of a frame in one batched kernel on the device (only for builds with Kokkos, "
+  "the generic routine, the affine shape function and field value initialization, other subsets are solved as usual)");
+/// Correlation parameter and properties
+const Correlation_Parameter share_reference_intensities_param(share_reference_intensities,
+  BOOL_PARAM,
+  true,
+  "Read the reference intensities of each subset directly from the reference image rather than copying them into the subset "
+  "(saves memory and construction time when the subsets overlap, builds without Kokkos only)");
+/// Correlation parameter and properties
+const Correlation_Parameter use_tiled_image_layout_param(use_tiled_image_layout,
+  BOOL_PARAM,
+  true,
+  "Copy the deformed images into square tiles before the subsets are correlated so that each Keys fourth order "
+  "interpolation stencil reads from one compact block of memory (builds without Kokkos only)");
+/// Correlation parameter and properties
+const Correlation_Parameter lazy_image_gradients_param(lazy_image_gradients,
+  BOOL_PARAM,
+  true,
+  "Compute the image gradients one tile at a time the first time a subset needs them rather than for the whole "
+  "image when it is loaded (saves most of the preprocessing when a few small subsets are tracked in large images, "
+  "builds without Kokkos only)");
+/// Correlation parameter and properties
+const Correlation_Parameter reference_image_cache_folder_param(reference_image_cache_folder,
+  STRING_PARAM,
+  true,
+  "Folder where the filtered reference image and its gradients are cached by the content of the image and the filter "
+  "settings so that repeated runs with the same reference frame skip the preprocessing (builds without Kokkos only)");
+/// Correlation parameter and properties
+const Correlation_Parameter numa_first_touch_images_param(numa_first_touch_images,
+  BOOL_PARAM,
+  true,
+  "The pages of new image arrays are first touched by num_threads threads in contiguous blocks of rows so that on "
+  "multi-socket nodes each block is placed in the memory of the socket whose threads process those rows");
+/// Correlation parameter and properties
+const Correlation_Parameter use_huge_pages_for_images_param(use_huge_pages_for_images,
+  BOOL_PARAM,
+  true,
+  "Back the image arrays of 2 MB or more with transparent huge pages to reduce the TLB misses of the interpolation "
+  "(Linux only, ignored elsewhere)");
+/// Correlation parameter and properties
+const Correlation_Parameter analytic_def_gradients_param(analytic_def_gradients,
+  BOOL_PARAM,
+  true,
+  "When the deformed image gradients are used, take them from the derivative of the interpolant at each mapped pixel "
+  "instead of interpolating stored gradient images (skips the gradient pass and the gradient storage of every "
+  "deformed frame, builds without Kokkos only)");
+/// Correlation parameter and properties
+const Correlation_Parameter quantized_interpolation_weights_param(quantized_interpolation_weights,
+  BOOL_PARAM,
+  true,
+  "Interpolate the deformed images with keys_fourth or bicubic weights read from tables at 1/256 pixel sub-pixel "
+  "offsets rather than evaluating the kernel polynomials for every pixel (the interpolated locations move by at most "
+  "1/512 pixel, builds without Kokkos only)");
+/// Correlation parameter and properties
+const Correlation_Parameter node_shared_images_param(node_shared_images,
+  BOOL_PARAM,
+  true,
+  "When several MPI processes run on one node, read each reference and deformed frame once per node and keep the "
+  "preprocessed pixels in MPI-3 shared memory that all processes on the node use (the whole frame is shared instead "
+  "of each process reading its own portion, builds without Kokkos only, not used with num_prefetch_frames)");
+/// Correlation parameter and properties
+const Correlation_Parameter shared_frame_cache_size_param(shared_frame_cache_size,
+  SIZE_PARAM,
+  true,
+  "Number of read and preprocessed frames kept so that the schemas (stereo) and the sub images (motion windows) that "
+  "read the same frame with the same image settings share one copy instead of each decoding, filtering and computing "
+  "the gradients again (0, the default, turns the sharing off)");
+/// Correlation parameter and properties
 const Correlation_Parameter output_delimiter_param(output_delimiter,
   STRING_PARAM,
   true,
@@ -863,7 +1161,8 @@ const Correlation_Parameter correlation_routine_param(correlation_routine,
 const Correlation_Parameter interpolation_method_param(interpolation_method,
   STRING_PARAM,
   true,
-  "Determines which interpolation method to use (can also affect the image gradients)",
+  "Determines which interpolation method to use (can also affect the image gradients). "
+  "The B-spline methods prefilter each deformed image once and use the spline derivative for the gradients",
   interpolationMethodStrings,
   MAX_INTERPOLATION_METHOD);
 /// Correlation parameter and properties
@@ -881,10 +1180,40 @@ const Correlation_Parameter initialization_method_param(initialization_method,
   initializationMethodStrings,
   MAX_INITIALIZATION_METHOD);
 /// Correlation parameter and properties
+const Correlation_Parameter phase_correlation_window_size_param(phase_correlation_window_size,
+  SIZE_PARAM,
+  true,
+  "The width and height in pixels of the window around each subset used by the USE_WINDOWED_PHASE_CORRELATION initialization method "
+  "(should be larger than twice the expected motion between frames)");
+/// Correlation parameter and properties
+const Correlation_Parameter feature_matcher_param(feature_matcher,
+  STRING_PARAM,
+  true,
+  "Determines how the feature descriptors are matched for the USE_FEATURE_MATCHING initialization method "
+  "(the FLANN LSH matcher is faster when there are many features)",
+  featureMatcherStrings,
+  MAX_FEATURE_MATCHER);
+/// Correlation parameter and properties
+const Correlation_Parameter output_feature_matching_image_param(output_feature_matching_image,
+  BOOL_PARAM,
+  true,
+  "Write an image of the matched features each frame for the USE_FEATURE_MATCHING initialization method (for debugging)");
+/// Correlation parameter and properties
+const Correlation_Parameter feature_tile_size_param(feature_tile_size,
+  SIZE_PARAM,
+  true,
+  "Detect the features for the USE_FEATURE_MATCHING initialization method in square tiles of this many pixels "
+  "on num_threads threads (0 detects the whole region of the subsets at once)");
+/// Correlation parameter and properties
+const Correlation_Parameter max_features_per_tile_param(max_features_per_tile,
+  SIZE_PARAM,
+  true,
+  "Keep only this many of the strongest features in each tile for the USE_FEATURE_MATCHING initialization method (0 keeps all of them)");
+/// Correlation parameter and properties
 const Correlation_Parameter optimization_method_param(optimization_method,
   STRING_PARAM,
   true,
-  "Determines if gradient based (fast, but not as robust) or simplex based (no gradients needed, but requires more iterations) optimization algorithm will be used",
+  "Determines if gradient based (fast, but not as robust), inverse compositional gradient based (the Hessian is computed once from the reference subset), or simplex based (no gradients needed, but requires more iterations) optimization algorithm will be used",
   optimizationMethodStrings,
   MAX_OPTIMIZATION_METHOD);
 /// Correlation parameter and properties
@@ -939,6 +1268,20 @@ const Correlation_Parameter max_solver_iterations_robust_param(max_solver_iterat
 /// Correlation parameter and properties
 const Correlation_Parameter fast_solver_tolerance_param(fast_solver_tolerance,SCALAR_PARAM);
 /// Correlation parameter and properties
+const Correlation_Parameter noise_adaptive_tolerance_factor_param(noise_adaptive_tolerance_factor,
+  SCALAR_PARAM,
+  true,
+  "If greater than zero, the gradient based solver stops once the displacement updates are smaller than this "
+  "fraction of the displacement uncertainty due to image noise (estimated per subset, see sigma). The "
+  "fast_solver_tolerance is still the lower bound and applies to the other shape function parameters.");
+/// Correlation parameter and properties
+const Correlation_Parameter progressive_sampling_stride_param(progressive_sampling_stride,
+  SIZE_PARAM,
+  true,
+  "If greater than one (use 2 or 4), the early iterations of the fast gradient based solver only interpolate and sum "
+  "every stride-th pixel of the subset (a diagonal pattern so all rows and columns are sampled). The stride is halved "
+  "each time the sampled iterations converge and the solution is only accepted once it converges with all pixels.");
+/// Correlation parameter and properties
 const Correlation_Parameter robust_solver_tolerance_param(robust_solver_tolerance,SCALAR_PARAM);
 /// Correlation parameter and properties
 const Correlation_Parameter skip_all_solves_param(skip_all_solves,BOOL_PARAM,true,
@@ -961,6 +1304,18 @@ const Correlation_Parameter path_distance_threshold_param(path_distance_threshol
   "If the final deformation solution is farther than this threshold from a segment in the path file"
   " (which must be specified in the subset file) the step will fail for this subset");
 /// Correlation parameter and properties
+const Correlation_Parameter low_contrast_threshold_param(low_contrast_threshold,SCALAR_PARAM,true,
+  "If the standard deviation of a subset's reference intensities is below this value the subset is not correlated"
+  " (the step is recorded with the SUBSET_REJECTED_DUE_TO_LOW_CONTRAST status) until the check is repeated");
+/// Correlation parameter and properties
+const Correlation_Parameter low_sssig_threshold_param(low_sssig_threshold,SCALAR_PARAM,true,
+  "If the SSSIG (mean of the squared image gradients) of a subset is below this value the subset is not correlated"
+  " (the step is recorded with the SUBSET_REJECTED_DUE_TO_LOW_CONTRAST status) until the check is repeated");
+/// Correlation parameter and properties
+const Correlation_Parameter low_contrast_recheck_interval_param(low_contrast_recheck_interval,SIZE_PARAM,true,
+  "The number of frames between the low_contrast_threshold and low_sssig_threshold checks of a subset"
+  " (the result of a check is reused for the frames in between)");
+/// Correlation parameter and properties
 const Correlation_Parameter pixel_size_in_mm_param(pixel_size_in_mm,
   SCALAR_PARAM,
   true,
@@ -1012,6 +1367,12 @@ const Correlation_Parameter output_beta_param(output_beta,
   "True if the beta parameter should be computed (still needs to be added to the output spec if it should be included in the output file)"
   " This parameter measures the distinguishability of a pattern for template matching");
 /// Correlation parameter and properties
+const Correlation_Parameter analytic_beta_param(analytic_beta,
+  BOOL_PARAM,
+  true,
+  "Estimate beta from the converged Gauss-Newton Hessian rather than from extra gamma evaluations "
+  "(solutions from the simplex method still use finite differences).");
+/// Correlation parameter and properties
 const Correlation_Parameter global_regularization_alpha_param(global_regularization_alpha,
   SCALAR_PARAM,
   true,
@@ -1042,6 +1403,68 @@ const Correlation_Parameter use_fixed_point_iterations_param(use_fixed_point_ite
   "Used only for global, uses the fixed point iteration scheme for the global method."
 );
 /// Correlation parameter and properties
+const Correlation_Parameter global_use_matrix_free_param(global_use_matrix_free,
+  BOOL_PARAM,
+  true,
+  "Used only for global, applies the tangent element by element in the linear solve rather than assembling the matrix "
+  "(not available for mixed formulations, requires the JACOBI_PRECONDITIONER)."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_preconditioner_param(global_preconditioner,
+  STRING_PARAM,
+  true,
+  "Used only for global, this is the preconditioner to use for the linear solve (ILU_PRECONDITIONER, JACOBI_PRECONDITIONER, "
+  "AMG_PRECONDITIONER, which requires Trilinos to be built with ML, or BLOCK_PRECONDITIONER, a Schur complement "
+  "block preconditioner for the mixed formulations that requires the GMRES_SOLVER)."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_reuse_preconditioner_param(global_reuse_preconditioner,
+  BOOL_PARAM,
+  true,
+  "Used only for global, keeps the preconditioner across nonlinear iterations and frames. The ILU symbolic factorization "
+  "is kept as long as the tangent graph does not change, the numeric part is recomputed according to "
+  "global_preconditioner_max_reuse and global_preconditioner_rebuild_iterations."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_preconditioner_max_reuse_param(global_preconditioner_max_reuse,
+  SIZE_PARAM,
+  true,
+  "Used only for global, the number of additional linear solves the numeric preconditioner can be reused for (default 0)."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_preconditioner_rebuild_iterations_param(global_preconditioner_rebuild_iterations,
+  SIZE_PARAM,
+  true,
+  "Used only for global, the numeric preconditioner is recomputed if the last linear solve took more iterations than this (off if 0)."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_output_frequency_param(global_output_frequency,
+  SIZE_PARAM,
+  true,
+  "Used only for global, the exodus output is written (and the strains computed) for every n-th frame (default 1 is every frame)."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_warm_start_extrapolation_param(global_warm_start_extrapolation,
+  BOOL_PARAM,
+  true,
+  "Used only for global, the nonlinear iterations of each frame start from a linear extrapolation of the "
+  "displacements of the last two frames rather than the last solution (not used with the incremental formulation)."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_warm_start_window_size_param(global_warm_start_window_size,
+  SIZE_PARAM,
+  true,
+  "Used only for global, if greater than 0 the displacements of the first frame are seeded by phase correlating a window of this "
+  "size (in pixels) centered on each node, a coarse local DIC estimate (ignored if an initial condition file is given)."
+);
+/// Correlation parameter and properties
+const Correlation_Parameter global_mesh_cache_folder_param(global_mesh_cache_folder,
+  STRING_PARAM,
+  true,
+  "Used only for global, folder where the Triangle output for a given ROI and mesh size is cached so that repeated runs "
+  "skip the mesh generation (default is no cache)"
+);
+/// Correlation parameter and properties
 const Correlation_Parameter global_element_type_param(global_element_type,
   STRING_PARAM,
   true,
@@ -1069,6 +1492,71 @@ const Correlation_Parameter use_search_initialization_for_failed_steps_param(use
   true,
   "Use a searching routine whenever a step fails in the TRACKING_ROUTINE.");
 /// Correlation parameter and properties
+const Correlation_Parameter search_initialization_radius_param(search_initialization_radius,
+  SCALAR_PARAM,
+  true,
+  "The extent in pixels of the search for failed steps in the TRACKING_ROUTINE (see use_search_initialization_for_failed_steps).");
+/// Correlation parameter and properties
+const Correlation_Parameter search_initialization_pyramid_levels_param(search_initialization_pyramid_levels,
+  SIZE_PARAM,
+  true,
+  "The number of downsampled image levels used for coarse-to-fine searches (0 searches only the full resolution images, "
+  "each level halves the image size so large search radii need far fewer evaluations).");
+/// Correlation parameter and properties
+const Correlation_Parameter pyramid_correlation_levels_param(pyramid_correlation_levels,
+  SIZE_PARAM,
+  true,
+  "The number of downsampled image levels each subset is correlated on (translation only, coarse to fine) before the "
+  "full resolution correlation. The results replace the displacement field values used as the initial guess, "
+  "so large motions between frames can be followed without a search (0 turns this off, 1 starts at half resolution, "
+  "2 at quarter resolution and so on).");
+/// Correlation parameter and properties
+const Correlation_Parameter reliability_guided_propagation_param(reliability_guided_propagation,
+  BOOL_PARAM,
+  true,
+  "When subsets are initialized with neighbor values, propagate from the seeds in order of correlation quality: "
+  "each subset is initialized from the already correlated neighbor with the lowest gamma and the best ranked "
+  "subsets are correlated in parallel (GENERIC_ROUTINE only).");
+/// Correlation parameter and properties
+const Correlation_Parameter adaptive_grid_coarsening_param(adaptive_grid_coarsening,
+  SIZE_PARAM,
+  true,
+  "Correlate only every n-th subset of the regular grid in x and y first, the subsets in between are interpolated "
+  "from the corners of their coarse grid cell unless the cell does not resolve the field (see adaptive_grid_tolerance "
+  "and adaptive_grid_gamma_threshold), then they are correlated starting from the interpolated values. Interpolated "
+  "subsets have the SUBSET_INTERPOLATED_FROM_COARSE_GRID status (GENERIC_ROUTINE only, 0 or 1 correlates every subset).");
+/// Correlation parameter and properties
+const Correlation_Parameter adaptive_grid_tolerance_param(adaptive_grid_tolerance,
+  SCALAR_PARAM,
+  true,
+  "The largest error in pixels allowed for the subsets interpolated from a coarse grid cell, estimated from the non-affine "
+  "part of the corner displacements and the spread of the corner strains times the cell size (default 0.05).");
+/// Correlation parameter and properties
+const Correlation_Parameter adaptive_grid_gamma_threshold_param(adaptive_grid_gamma_threshold,
+  SCALAR_PARAM,
+  true,
+  "The subsets of a coarse grid cell are correlated if the gamma of one of the corners is above this value "
+  "(0 does not check gamma).");
+/// Correlation parameter and properties
+const Correlation_Parameter motion_window_sample_stride_param(motion_window_sample_stride,
+  SIZE_PARAM,
+  true,
+  "The pixel sampling interval used when testing a motion window for motion (1 compares every pixel, "
+  "larger values compare every n-th pixel in x and y to make the test cheaper).");
+/// Correlation parameter and properties
+const Correlation_Parameter test_motion_on_raw_pixels_param(test_motion_on_raw_pixels,
+  BOOL_PARAM,
+  true,
+  "If true and motion windows are defined, each deformed frame is first tested for motion on its unfiltered pixels "
+  "against the previous unfiltered frame. The frame is only filtered and its gradients are only computed if a subset "
+  "needs to be correlated, which saves most of the work for frames where nothing moves.");
+/// Correlation parameter and properties
+const Correlation_Parameter image_frame_cache_size_param(image_frame_cache_size,
+  SIZE_PARAM,
+  true,
+  "The number of megabytes used to keep decoded image frames in memory so that frames read more than once "
+  "are not decoded again (0 turns off the frame cache).");
+/// Correlation parameter and properties
 const Correlation_Parameter normalize_gamma_with_active_pixels_param(normalize_gamma_with_active_pixels,
   BOOL_PARAM,
   true,
@@ -1130,13 +1618,18 @@ const Correlation_Parameter filter_failed_cine_pixels_param(filter_failed_cine_p
 // TODO don't forget to update this when adding a new one
 /// The total number of valid correlation parameters
 /// Vector of valid parameter names
-const int_t num_valid_correlation_params = 85;
+const int_t num_valid_correlation_params = 139;
 /// Vector oIf valid parameter names
 const Correlation_Parameter valid_correlation_params[num_valid_correlation_params] = {
   correlation_routine_param,
   interpolation_method_param,
   gradient_method_param,
   initialization_method_param,
+  phase_correlation_window_size_param,
+  feature_matcher_param,
+  output_feature_matching_image_param,
+  feature_tile_size_param,
+  max_features_per_tile_param,
   optimization_method_param,
   projection_method_param,
   compute_ref_gradients_param,
@@ -1153,6 +1646,8 @@ const Correlation_Parameter valid_correlation_params[num_valid_correlation_param
   max_solver_iterations_fast_param,
   max_solver_iterations_robust_param,
   fast_solver_tolerance_param,
+  noise_adaptive_tolerance_factor_param,
+  progressive_sampling_stride_param,
   robust_solver_tolerance_param,
   skip_all_solves_param,
   skip_solve_gamma_threshold_param,
@@ -1160,6 +1655,9 @@ const Correlation_Parameter valid_correlation_params[num_valid_correlation_param
   sssig_threshold_param,
   final_gamma_threshold_param,
   path_distance_threshold_param,
+  low_contrast_threshold_param,
+  low_sssig_threshold_param,
+  low_contrast_recheck_interval_param,
   disp_jump_tol_param,
   theta_jump_tol_param,
   robust_delta_disp_param,
@@ -1169,6 +1667,7 @@ const Correlation_Parameter valid_correlation_params[num_valid_correlation_param
   output_evolved_subset_images_param,
   use_subset_evolution_param,
   output_beta_param,
+  analytic_beta_param,
   output_spec_param,
   output_delimiter_param,
   omit_output_row_id_param,
@@ -1185,10 +1684,41 @@ const Correlation_Parameter valid_correlation_params[num_valid_correlation_param
   estimate_resolution_error_amplitude_step_param,
   estimate_resolution_error_speckle_size_param,
   estimate_resolution_error_noise_percent_param,
+  estimate_resolution_error_max_error_param,
+  tune_throughput_param,
+  tune_throughput_sample_size_param,
+  tune_throughput_amplitude_param,
+  tune_throughput_noise_percent_param,
+  tune_throughput_max_error_param,
+  tune_throughput_output_file_param,
   use_incremental_formulation_param,
   use_nonlinear_projection_param,
   sort_txt_output_param,
+  exodus_output_buffer_size_param,
+  use_spatial_decomposition_param,
+  overlap_halo_exchange_param,
+  use_batched_device_correlation_param,
+  share_reference_intensities_param,
+  use_tiled_image_layout_param,
+  lazy_image_gradients_param,
+  reference_image_cache_folder_param,
+  numa_first_touch_images_param,
+  use_huge_pages_for_images_param,
+  analytic_def_gradients_param,
+  quantized_interpolation_weights_param,
+  node_shared_images_param,
+  shared_frame_cache_size_param,
   use_search_initialization_for_failed_steps_param,
+  search_initialization_radius_param,
+  search_initialization_pyramid_levels_param,
+  pyramid_correlation_levels_param,
+  reliability_guided_propagation_param,
+  adaptive_grid_coarsening_param,
+  adaptive_grid_tolerance_param,
+  adaptive_grid_gamma_threshold_param,
+  motion_window_sample_stride_param,
+  test_motion_on_raw_pixels_param,
+  image_frame_cache_size_param,
   use_tracking_default_params_param,
   override_force_simplex_param,
   normalize_gamma_with_active_pixels_param,
@@ -1200,6 +1730,9 @@ const Correlation_Parameter valid_correlation_params[num_valid_correlation_param
   image_grad_team_size_param,
   gauss_filter_use_hierarchical_parallelism_param,
   gauss_filter_team_size_param,
+  auto_tune_kokkos_policies_param,
+  kokkos_policy_cache_file_param,
+  num_threads_param,
   gauss_filter_mask_size_param,
   rotate_ref_image_90_param,
   rotate_def_image_90_param,
@@ -1217,12 +1750,21 @@ const Correlation_Parameter valid_correlation_params[num_valid_correlation_param
   global_element_type_param,
   num_image_integration_points_param,
   use_fixed_point_iterations_param,
+  global_use_matrix_free_param,
+  global_preconditioner_param,
+  global_reuse_preconditioner_param,
+  global_preconditioner_max_reuse_param,
+  global_preconditioner_rebuild_iterations_param,
+  global_output_frequency_param,
+  global_mesh_cache_folder_param,
+  global_warm_start_extrapolation_param,
+  global_warm_start_window_size_param,
   compute_laplacian_image_param
 };
 
 // TODO don't forget to update this when adding a new one
 /// The total number of valid correlation parameters
-const int_t num_valid_global_correlation_params = 31;
+const int_t num_valid_global_correlation_params = 41;
 /// Vector of valid parameter names
 const Correlation_Parameter valid_global_correlation_params[num_valid_global_correlation_params] = {
   use_global_dic_param,
@@ -1247,6 +1789,7 @@ const Correlation_Parameter valid_global_correlation_params[num_valid_global_cor
   use_incremental_formulation_param,
   use_nonlinear_projection_param,
   sort_txt_output_param,
+  exodus_output_buffer_size_param,
   global_regularization_alpha_param,
   global_stabilization_tau_param,
   global_formulation_param,
@@ -1255,6 +1798,15 @@ const Correlation_Parameter valid_global_correlation_params[num_valid_global_cor
   num_image_integration_points_param,
   global_element_type_param,
   use_fixed_point_iterations_param,
+  global_use_matrix_free_param,
+  global_preconditioner_param,
+  global_reuse_preconditioner_param,
+  global_preconditioner_max_reuse_param,
+  global_preconditioner_rebuild_iterations_param,
+  global_output_frequency_param,
+  global_mesh_cache_folder_param,
+  global_warm_start_extrapolation_param,
+  global_warm_start_window_size_param,
   initial_condition_file_param
 };
 
@@ -0,0 +1,172 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_FrameArena.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+
+namespace DICe {
+
+namespace {
+/// the smallest block the arena allocates
+const size_t min_arena_block_bytes = 64*1024;
+/// block sizes are rounded up to a multiple of this many bytes
+const size_t arena_block_alignment = 64;
+}
+
+std::atomic<long long> Frame_Arena::frame_count_(0);
+
+Frame_Arena::Scope::Scope():
+  arena_(Frame_Arena::instance()){
+  // the arena is compacted when the first scope of a new frame is opened
+  if(arena_.num_open_scopes_==0&&arena_.frame_!=frame_count_.load())
+    arena_.compact();
+  block_ = arena_.block_;
+  offset_ = arena_.offset_;
+  bytes_in_use_ = arena_.bytes_in_use_;
+  arena_.num_open_scopes_++;
+}
+
+Frame_Arena::Scope::~Scope(){
+  arena_.block_ = block_;
+  arena_.offset_ = offset_;
+  arena_.bytes_in_use_ = bytes_in_use_;
+  arena_.num_open_scopes_--;
+}
+
+Frame_Arena &
+Frame_Arena::instance(){
+  static thread_local Frame_Arena arena;
+  return arena;
+}
+
+void
+Frame_Arena::end_frame(){
+  frame_count_++;
+}
+
+Frame_Arena::Frame_Arena():
+  block_(0),
+  offset_(0),
+  bytes_in_use_(0),
+  high_water_(0),
+  num_open_scopes_(0),
+  frame_(0),
+  memory_(MEMORY_CACHES){}
+
+Frame_Arena::~Frame_Arena(){
+  for(size_t i=0;i<blocks_.size();++i)
+    free(blocks_[i].data);
+}
+
+size_t
+Frame_Arena::capacity()const{
+  size_t bytes = 0;
+  for(size_t i=0;i<blocks_.size();++i)
+    bytes += blocks_[i].size;
+  return bytes;
+}
+
+void *
+Frame_Arena::allocate_bytes(const size_t bytes,
+  const size_t alignment){
+  TEUCHOS_TEST_FOR_EXCEPTION(num_open_scopes_==0,std::logic_error,
+    "Error, arrays can only be allocated from the arena inside a Frame_Arena::Scope");
+  // malloc aligns the blocks for any fundamental type
+  assert(alignment<=alignof(std::max_align_t));
+  if(bytes==0) return NULL;
+  if(!blocks_.empty()){
+    const size_t start = (offset_+alignment-1)/alignment*alignment;
+    if(start+bytes<=blocks_[block_].size){
+      bytes_in_use_ += start+bytes-offset_;
+      offset_ = start+bytes;
+      high_water_ = std::max(high_water_,bytes_in_use_);
+      return blocks_[block_].data + start;
+    }
+  }
+  // the array doesn't fit in the rest of the current block, use the next block if it is large enough
+  // (the unused end of the current block still counts as in use until the scope closes)
+  const size_t skipped = blocks_.empty() ? 0 : blocks_[block_].size - offset_;
+  const size_t next = blocks_.empty() ? 0 : block_+1;
+  if(next>=blocks_.size()||blocks_[next].size<bytes){
+    Block block;
+    block.size = std::max(std::max(min_arena_block_bytes,capacity()),bytes);
+    block.size = (block.size+arena_block_alignment-1)/arena_block_alignment*arena_block_alignment;
+    block.data = static_cast<char*>(malloc(block.size));
+    TEUCHOS_TEST_FOR_EXCEPTION(block.data==NULL,std::runtime_error,"Error, could not allocate an arena block of " << block.size << " bytes");
+    blocks_.insert(blocks_.begin()+next,block);
+    memory_.set(capacity());
+  }
+  block_ = next;
+  offset_ = bytes;
+  bytes_in_use_ += skipped + bytes;
+  high_water_ = std::max(high_water_,bytes_in_use_);
+  return blocks_[block_].data;
+}
+
+void
+Frame_Arena::compact(){
+  assert(num_open_scopes_==0);
+  frame_ = frame_count_.load();
+  if(blocks_.size()>1){
+    const size_t bytes = (high_water_+arena_block_alignment-1)/arena_block_alignment*arena_block_alignment;
+    for(size_t i=0;i<blocks_.size();++i)
+      free(blocks_[i].data);
+    blocks_.clear();
+    Block block;
+    block.size = std::max(min_arena_block_bytes,bytes);
+    block.data = static_cast<char*>(malloc(block.size));
+    TEUCHOS_TEST_FOR_EXCEPTION(block.data==NULL,std::runtime_error,"Error, could not allocate an arena block of " << block.size << " bytes");
+    blocks_.push_back(block);
+    memory_.set(capacity());
+  }
+  block_ = 0;
+  offset_ = 0;
+  bytes_in_use_ = 0;
+  high_water_ = 0;
+}
+
+}// End DICe Namespace
@@ -0,0 +1,176 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_FRAMEARENA_H
+#define DICE_FRAMEARENA_H
+
+#include <DICe.h>
+#include <DICe_MemoryTracker.h>
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Frame_Arena
+/// \brief Per-thread bump allocator for the short lived work arrays of a frame
+///
+/// Arrays are taken from the arena inside a Frame_Arena::Scope and are all released when the
+/// scope closes (scopes nest like a stack, so a function can open its own scope while its caller
+/// holds arrays in an outer one). While a frame is processed the arena grows by adding blocks.
+/// After end_frame() the blocks are merged into a single block the next time the arena is empty,
+/// sized for the most the arena held at once, so the frames that follow don't allocate at all.
+///
+/// The values of an array are not initialized and only trivially copyable types can be allocated.
+/// An array must not be used after the scope it was allocated in has closed.
+class DICE_LIB_DLL_EXPORT
+Frame_Arena{
+public:
+  /// \class DICe::Frame_Arena::Scope
+  /// \brief Releases the arrays allocated from the thread's arena while the scope was open
+  class DICE_LIB_DLL_EXPORT
+  Scope{
+  public:
+    /// constructor, opens a scope on the arena of the calling thread
+    Scope();
+    /// destructor, rewinds the arena to where it was when the scope was opened
+    ~Scope();
+    /// returns the arena of this scope
+    Frame_Arena & arena(){
+      return arena_;
+    }
+  private:
+    /// not copyable
+    Scope(const Scope &);
+    /// not assignable
+    Scope & operator=(const Scope &);
+    /// the arena of the thread that opened the scope
+    Frame_Arena & arena_;
+    /// block in use when the scope was opened
+    size_t block_;
+    /// offset into the block when the scope was opened
+    size_t offset_;
+    /// bytes in use when the scope was opened
+    size_t bytes_in_use_;
+  };
+
+  /// returns the arena of the calling thread
+  static Frame_Arena & instance();
+
+  /// marks the end of a frame, the arenas of all threads are compacted the next time they are empty
+  static void end_frame();
+
+  /// returns an uninitialized array of n values that lives until the innermost open scope closes
+  /// \param n the number of values
+  template<typename T>
+  T * allocate(const size_t n){
+    static_assert(std::is_trivially_copyable<T>::value,"Error, only trivially copyable types can be allocated from the arena");
+    return static_cast<T*>(allocate_bytes(n*sizeof(T),alignof(T)));
+  }
+
+  /// returns the number of bytes handed out by the open scopes (including alignment padding)
+  size_t bytes_in_use()const{
+    return bytes_in_use_;
+  }
+
+  /// returns the number of bytes held by the blocks of the arena
+  size_t capacity()const;
+
+  /// returns the number of blocks held by the arena
+  int_t num_blocks()const{
+    return blocks_.size();
+  }
+
+  /// destructor
+  ~Frame_Arena();
+
+private:
+  /// constructor
+  Frame_Arena();
+  /// not copyable
+  Frame_Arena(const Frame_Arena &);
+  /// not assignable
+  Frame_Arena & operator=(const Frame_Arena &);
+
+  /// hands out bytes from the current block, moving to a new block if they don't fit
+  void * allocate_bytes(const size_t bytes,
+    const size_t alignment);
+
+  /// replaces the blocks by a single block large enough for the previous frame (the arena must be empty)
+  void compact();
+
+  /// a contiguous piece of memory the arrays are carved from
+  struct Block{
+    char * data;
+    size_t size;
+  };
+  /// the blocks in the order they are used
+  std::vector<Block> blocks_;
+  /// the block arrays are currently taken from
+  size_t block_;
+  /// the offset of the next free byte in the current block
+  size_t offset_;
+  /// bytes handed out by the open scopes
+  size_t bytes_in_use_;
+  /// the most bytes held at once since the last compaction
+  size_t high_water_;
+  /// number of open scopes
+  int_t num_open_scopes_;
+  /// the frame count the arena was last compacted for
+  long long frame_;
+  /// the number of calls to end_frame() (shared by all threads)
+  static std::atomic<long long> frame_count_;
+  /// bytes held by the blocks
+  Tracked_Memory memory_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -44,14 +44,22 @@
 #include <DICe_Shape.h>
 #if DICE_KOKKOS
   #include <DICe_Kokkos.h>
+  #include <DICe_KokkosPolicyTuner.h>
 #endif
 
 #include <Teuchos_ParameterList.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <mutex>
 
 namespace DICe {
 
+namespace {
+/// guards the lazy construction of the image pyramids
+std::mutex pyramid_mutex;
+}
+
 Image::Image(intensity_t * intensities,
   const int_t width,
   const int_t height,
@@ -65,7 +73,13 @@ Image::Image(intensity_t * intensities,
   has_gauss_filter_(false),
   file_name_("(from raw array)"),
   has_file_name_(false),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   initialize_array_image(intensities);
   default_constructor_tasks(params);
@@ -86,7 +100,13 @@ Image::Image(const int_t width,
   has_gauss_filter_(false),
   file_name_("(from array)"),
   has_file_name_(false),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   initialize_array_image(intensities.getRawPtr());
   default_constructor_tasks(params);
@@ -98,25 +118,62 @@ Image::post_allocation_tasks(const Teuchos::RCP<Teuchos::ParameterList> & params
   gauss_filter_mask_size_ = 7; // default sizes
   gauss_filter_half_mask_ = 4;
   if(params==Teuchos::null) return;
+  set_num_threads(params->get<int_t>(DICe::num_threads,num_threads_));
+  set_lazy_gradients(params->get<bool>(DICe::lazy_image_gradients,lazy_gradients_));
   gradient_method_ = params->get<Gradient_Method>(DICe::gradient_method,FINITE_DIFFERENCE);
   const bool gauss_filter_image =  params->get<bool>(DICe::gauss_filter_images,false);
-  const bool gauss_filter_use_hierarchical_parallelism = params->get<bool>(DICe::gauss_filter_use_hierarchical_parallelism,false);
-  const int gauss_filter_team_size = params->get<int>(DICe::gauss_filter_team_size,256);
+  bool gauss_filter_use_hierarchical_parallelism = params->get<bool>(DICe::gauss_filter_use_hierarchical_parallelism,false);
+  int gauss_filter_team_size = params->get<int>(DICe::gauss_filter_team_size,256);
   gauss_filter_mask_size_ = params->get<int>(DICe::gauss_filter_mask_size,7);
   gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
-  if(gauss_filter_image){
-    gauss_filter(-1,gauss_filter_use_hierarchical_parallelism,gauss_filter_team_size);
-  }
   const bool compute_image_gradients = params->get<bool>(DICe::compute_image_gradients,false);
   DEBUG_MSG("Image::post_allocation_tasks(): compute_image_gradients is " << compute_image_gradients);
-  const bool image_grad_use_hierarchical_parallelism = params->get<bool>(DICe::image_grad_use_hierarchical_parallelism,false);
-  const int image_grad_team_size = params->get<int>(DICe::image_grad_team_size,256);
-  if(compute_image_gradients)
-    compute_gradients(image_grad_use_hierarchical_parallelism,image_grad_team_size);
+  bool image_grad_use_hierarchical_parallelism = params->get<bool>(DICe::image_grad_use_hierarchical_parallelism,false);
+  int image_grad_team_size = params->get<int>(DICe::image_grad_team_size,256);
+#if DICE_KOKKOS
+  // the policies that were not set explicitly are benchmarked once (on a scratch image of the same size)
+  Kokkos_Policy_Tuner & tuner = Kokkos_Policy_Tuner::instance();
+  if(tuner.enabled()){
+    const bool tune_gauss_filter = gauss_filter_image&&!params->isParameter(DICe::gauss_filter_use_hierarchical_parallelism)
+        &&!params->isParameter(DICe::gauss_filter_team_size);
+    const bool tune_gradients = compute_image_gradients&&!params->isParameter(DICe::image_grad_use_hierarchical_parallelism)
+        &&!params->isParameter(DICe::image_grad_team_size);
+    if(tune_gauss_filter||tune_gradients){
+      Image scratch(width_,height_,0.0);
+      if(tune_gauss_filter){
+        const Kokkos_Policy policy = tuner.policy("gauss_filter",[&scratch](const Kokkos_Policy & p){
+          scratch.gauss_filter(-1,p.use_hierarchical_parallelism_,p.team_size_);});
+        gauss_filter_use_hierarchical_parallelism = policy.use_hierarchical_parallelism_;
+        gauss_filter_team_size = policy.team_size_;
+      }
+      if(tune_gradients){
+        const Kokkos_Policy policy = tuner.policy("image_gradients",[&scratch](const Kokkos_Policy & p){
+          scratch.compute_gradients(p.use_hierarchical_parallelism_,p.team_size_);});
+        image_grad_use_hierarchical_parallelism = policy.use_hierarchical_parallelism_;
+        image_grad_team_size = policy.team_size_;
+      }
+    }
+  }
+#endif
+#if !DICE_KOKKOS
+  if(gauss_filter_image&&compute_image_gradients){
+    // filter and gradients are done in one sweep so the image is only streamed through memory once
+    gauss_filter_and_compute_gradients();
+  }
+  else
+#endif
+  {
+    if(gauss_filter_image)
+      gauss_filter(-1,gauss_filter_use_hierarchical_parallelism,gauss_filter_team_size);
+    if(compute_image_gradients)
+      compute_gradients(image_grad_use_hierarchical_parallelism,image_grad_team_size);
+  }
   if(params->isParameter(DICe::compute_laplacian_image)){
     if(params->get<bool>(DICe::compute_laplacian_image)==true){
       TEUCHOS_TEST_FOR_EXCEPTION(laplacian_==Teuchos::null,std::runtime_error,"");
       TEUCHOS_TEST_FOR_EXCEPTION(laplacian_.size()!=width_*height_,std::runtime_error,"");
+      // the laplacian is computed for the whole image so it needs all the gradients
+      compute_gradient_tiles();
       Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
       imgParams->set(DICe::compute_image_gradients,true); // automatically compute the gradients if the ref image is changed
       Teuchos::RCP<Image> grad_x_img = Teuchos::rcp(new Image(width_,height_,grad_x_,imgParams));
@@ -130,11 +187,11 @@ Image::post_allocation_tasks(const Teuchos::RCP<Teuchos::ParameterList> & params
   }
 }
 
-/// returns true if the image is a frame from a video sequence cine or netcdf file
+/// returns true if the image is a frame from a video sequence cine, netcdf or rawv file
 bool
 Image::is_video_frame()const{
   Image_File_Type type = utils::image_file_type(file_name_.c_str());
-  if(type==CINE||type==NETCDF)
+  if(type==CINE||type==NETCDF||type==RAWV)
     return true;
   else
     return false;
@@ -154,6 +211,64 @@ Image::diff(Teuchos::RCP<Image> rhs) const{
   return std::sqrt(diff);
 }
 
+scalar_t
+Image::sum_squared_diff(const Teuchos::RCP<Image> & rhs,
+  const int_t border,
+  const int_t stride,
+  const scalar_t & max_value) const{
+  return sum_squared_diff_region(rhs,0,0,width_-1,height_-1,border,stride,max_value);
+}
+
+scalar_t
+Image::sum_squared_diff_region(const Teuchos::RCP<Image> & rhs,
+  const int_t min_x,
+  const int_t min_y,
+  const int_t max_x,
+  const int_t max_y,
+  const int_t border,
+  const int_t stride,
+  const scalar_t & max_value) const{
+  TEUCHOS_TEST_FOR_EXCEPTION(stride<1,std::runtime_error,"Error, invalid stride " << stride);
+  TEUCHOS_TEST_FOR_EXCEPTION(border<0,std::runtime_error,"Error, invalid border " << border);
+  if(rhs->width()!=width_||rhs->height()!=height_)
+    return -1.0;
+  // the border is measured from the edges of the region, which is clipped to the image
+  const int_t x_begin = std::max(min_x,0) + border;
+  const int_t x_end = std::min(max_x+1,width_) - border;
+  const int_t y_begin = std::max(min_y,0) + border;
+  const int_t y_end = std::min(max_y+1,height_) - border;
+  const intensity_t * lhs_intens = intensities().getRawPtr();
+  const intensity_t * rhs_intens = rhs->intensities().getRawPtr();
+  const scalar_t scale = (scalar_t)(stride*stride);
+  scalar_t sum = 0.0;
+  for(int_t y=y_begin;y<y_end;y+=stride){
+    const intensity_t * lhs_row = lhs_intens + y*width_;
+    const intensity_t * rhs_row = rhs_intens + y*width_;
+    // each row is accumulated separately so the inner loop is a plain reduction
+    // and the early exit test only happens once per row
+    scalar_t row_sum = 0.0;
+    if(stride==1){
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:row_sum)
+#endif
+      for(int_t x=x_begin;x<x_end;++x){
+        const scalar_t d = lhs_row[x] - rhs_row[x];
+        row_sum += d*d;
+      }
+    }
+    else{
+      for(int_t x=x_begin;x<x_end;x+=stride){
+        const scalar_t d = lhs_row[x] - rhs_row[x];
+        row_sum += d*d;
+      }
+    }
+    sum += scale*row_sum;
+    if(max_value>0.0&&sum>max_value)
+      return sum;
+  }
+  return sum;
+}
+
 /// normalize the image intensity values
 Teuchos::RCP<Image>
 Image::normalize(const Teuchos::RCP<Teuchos::ParameterList> & params){
@@ -203,6 +318,43 @@ Image::replace_intensities(Teuchos::ArrayRCP<intensity_t> intensities){
   intensities_.sync<device_space>(); // The template is what needs to be synced
 #endif
   default_constructor_tasks(params);
+  // the pyramid levels are stale now
+  std::lock_guard<std::mutex> lock(pyramid_mutex);
+  pyramid_.clear();
+}
+
+Teuchos::RCP<Image>
+Image::pyramid_level(const int_t level){
+  TEUCHOS_TEST_FOR_EXCEPTION(level<1,std::invalid_argument,"Error, invalid pyramid level " << level);
+  std::lock_guard<std::mutex> lock(pyramid_mutex);
+  while((int_t)pyramid_.size()<level){
+    const Image * fine = pyramid_.empty() ? this : pyramid_.back().get();
+    const int_t fine_ox = fine->offset_x();
+    const int_t fine_oy = fine->offset_y();
+    // coarse pixel K covers the fine pixels 2K and 2K+1 in global coordinates
+    const int_t ox = (fine_ox+1)/2;
+    const int_t oy = (fine_oy+1)/2;
+    const int_t w = (fine_ox + fine->width())/2 - ox;
+    const int_t h = (fine_oy + fine->height())/2 - oy;
+    TEUCHOS_TEST_FOR_EXCEPTION(w<1||h<1,std::invalid_argument,
+      "Error, the image is too small for pyramid level " << pyramid_.size()+1);
+    Teuchos::ArrayRCP<intensity_t> intens(w*h,0.0);
+    for(int_t y=0;y<h;++y){
+      const int_t fy = 2*(oy+y) - fine_oy;
+      for(int_t x=0;x<w;++x){
+        const int_t fx = 2*(ox+x) - fine_ox;
+        intens[y*w+x] = 0.25*((*fine)(fx,fy) + (*fine)(fx+1,fy) + (*fine)(fx,fy+1) + (*fine)(fx+1,fy+1));
+      }
+    }
+    pyramid_.push_back(Teuchos::rcp(new Image(w,h,intens,Teuchos::null,ox,oy)));
+  }
+  return pyramid_[level-1];
+}
+
+int_t
+Image::num_pyramid_levels()const{
+  std::lock_guard<std::mutex> lock(pyramid_mutex);
+  return pyramid_.size();
 }
 
 scalar_t
@@ -215,9 +367,10 @@ Image::mean()const{
 
 void
 Image::write(const std::string & file_name,
-  const bool scale_to_8_bit){
+  const bool scale_to_8_bit,
+  const bool compress_rawi){
   try{
-    utils::write_image(file_name.c_str(),width_,height_,intensities().getRawPtr(),default_is_layout_right(),scale_to_8_bit);
+    utils::write_image(file_name.c_str(),width_,height_,intensities().getRawPtr(),default_is_layout_right(),scale_to_8_bit,compress_rawi);
   }
   catch(std::exception &e){
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, write image failure.");
@@ -241,6 +394,8 @@ Image::write_overlap_image(const std::string & file_name,
 #else
 void
 Image::write_grad_x(const std::string & file_name){
+  TEUCHOS_TEST_FOR_EXCEPTION(analytic_gradients_,std::runtime_error,"Error, the image has analytic gradients so no gradient image is stored");
+  compute_gradient_tiles();
   try{
     utils::write_image(file_name.c_str(),width_,height_,grad_x_array().getRawPtr(),default_is_layout_right());
   }
@@ -251,6 +406,8 @@ Image::write_grad_x(const std::string & file_name){
 
 void
 Image::write_grad_y(const std::string & file_name){
+  TEUCHOS_TEST_FOR_EXCEPTION(analytic_gradients_,std::runtime_error,"Error, the image has analytic gradients so no gradient image is stored");
+  compute_gradient_tiles();
   try{
     utils::write_image(file_name.c_str(),width_,height_,grad_y_array().getRawPtr(),default_is_layout_right());
   }
@@ -267,33 +424,39 @@ Image::apply_rotation(const Rotation_Value rotation,
   if(params!=Teuchos::null){
     params->set(DICe::gauss_filter_images,false);
   }
+  TEUCHOS_TEST_FOR_EXCEPTION(rotation!=NINTY_DEGREES&&rotation!=ONE_HUNDRED_EIGHTY_DEGREES&&rotation!=TWO_HUNDRED_SEVENTY_DEGREES,
+    std::invalid_argument,"Error, unknown rotation requested.");
   Teuchos::RCP<Image> result;
   Teuchos::ArrayRCP<intensity_t> new_intensities(width_*height_,0.0);
-  if(rotation==NINTY_DEGREES){
-    for(int_t y=0;y<height_;++y){
-      for(int_t x=0;x<width_;++x){
-        new_intensities[(width_-1-x)*height_+y] = (*this)(x,y);
-      }
-    }
-    // note the height and width are swapped in the constructor call on purpose due to the transformation
-    result = Teuchos::rcp(new Image(height_,width_,new_intensities,params));
-  }else if(rotation==ONE_HUNDRED_EIGHTY_DEGREES){
-    for(int_t y=0;y<height_;++y){
-      for(int_t x=0;x<width_;++x){
-        new_intensities[y*width_+x] = (*this)(width_-1-x,height_-1-y);
-      }
+  // raw pointers are used in the threaded loops so the reference counts are not touched
+  Teuchos::ArrayRCP<intensity_t> src_intensities = intensities();
+  const intensity_t * src = src_intensities.getRawPtr();
+  intensity_t * dst = new_intensities.getRawPtr();
+  const int_t w = width_;
+  const int_t h = height_;
+  const int_t num_threads = num_threads_;
+  // each source row is read contiguously, the 180 degree rotation also writes contiguously
+#pragma omp parallel for num_threads(num_threads) if(num_threads>1) schedule(static)
+  for(int_t y=0;y<h;++y){
+    const intensity_t * src_row = src + y*w;
+    if(rotation==NINTY_DEGREES){
+      for(int_t x=0;x<w;++x)
+        dst[(w-1-x)*h+y] = src_row[x];
+    }else if(rotation==ONE_HUNDRED_EIGHTY_DEGREES){
+      intensity_t * dst_row = dst + (h-1-y)*w;
+#pragma omp simd
+      for(int_t x=0;x<w;++x)
+        dst_row[w-1-x] = src_row[x];
+    }else{
+      for(int_t x=0;x<w;++x)
+        dst[x*h+(h-1-y)] = src_row[x];
     }
+  }
+  if(rotation==ONE_HUNDRED_EIGHTY_DEGREES){
     result = Teuchos::rcp(new Image(width_,height_,new_intensities,params));
-  }else if(rotation==TWO_HUNDRED_SEVENTY_DEGREES){
-    for(int_t y=0;y<height_;++y){
-      for(int_t x=0;x<width_;++x){
-        new_intensities[x*height_+(height_-1-y)] = (*this)(x,y);
-      }
-    }
+  }else{
     // note the height and width are swapped in the constructor call on purpose due to the transformation
     result = Teuchos::rcp(new Image(height_,width_,new_intensities,params));
-  }else{
-    TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,"Error, unknown rotation requested.");
   }
   return result;
 }
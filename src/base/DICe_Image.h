@@ -42,10 +42,14 @@
 #define DICE_IMAGE_H
 
 #include <DICe.h>
+#include <DICe_MemoryTracker.h>
 #if DICE_KOKKOS
   #include <DICe_Kokkos.h>
 #endif
 #include <Teuchos_ParameterList.hpp>
+
+#include <vector>
+
 namespace DICe {
 
 /// forward declaration of the conformal_area_def
@@ -167,8 +171,11 @@ public:
   /// post allocation tasks
   void post_allocation_tasks(const Teuchos::RCP<Teuchos::ParameterList> & params=Teuchos::null);
 
+  /// update the bytes held by this image in the memory tracker (called after the arrays change)
+  void update_memory_usage();
+
   /// virtual destructor
-  virtual ~Image(){};
+  virtual ~Image();
 
   /// write the image to a file
   /// (tiff, jpeg, or png, depending on which file extension is used in the name)
@@ -177,8 +184,39 @@ public:
   /// The rawi format saves the full intesity_t precision value to file
   /// \param file_name the name of the file to write to
   /// \param scale_to_8_bit scale image to eight bit range if true
+  /// \param compress_rawi store the values compressed if the file is .rawi (requires zlib)
   void write(const std::string & file_name,
-    const bool scale_to_8_bit=true);
+    const bool scale_to_8_bit=true,
+    const bool compress_rawi=false);
+
+  /// write the preprocessed pixels (the filtered intensities and the gradients) to a binary file so that
+  /// read_preprocessed() can restore them without filtering the image or computing the gradients again
+  /// (builds without Kokkos only)
+  /// \param file_name the name of the file to write to
+  void write_preprocessed(const std::string & file_name);
+
+  /// replace the intensities and gradients with the ones written by write_preprocessed(), returns false
+  /// (and leaves the image unchanged) if the file does not exist or was written for an image of another size
+  /// (builds without Kokkos only)
+  /// \param file_name the name of the file to read
+  bool read_preprocessed(const std::string & file_name);
+
+  /// \brief replace the intensities and gradients with arrays that already hold the preprocessed pixels of this image
+  ///
+  /// The image keeps a reference to the arrays rather than copying them, so several images (for example on the
+  /// processes of a node, see read_node_shared_image()) can use the same pixels. The pixels must not be changed
+  /// afterwards (no filtering or replace_intensities()). The intensities don't count toward the memory of
+  /// this image (builds without Kokkos only)
+  /// \param intensities the intensities (width x height values)
+  /// \param grad_x the x gradients (empty if the image has no gradients)
+  /// \param grad_y the y gradients (empty if the image has no gradients)
+  /// \param gauss_filter_mask_size the mask size of the filter that was applied to the intensities (0 if none)
+  /// \param gradient_method the method used to compute the gradients
+  void share_preprocessed_arrays(Teuchos::ArrayRCP<intensity_t> intensities,
+    Teuchos::ArrayRCP<scalar_t> grad_x,
+    Teuchos::ArrayRCP<scalar_t> grad_y,
+    const int_t gauss_filter_mask_size,
+    const Gradient_Method gradient_method);
 
   /// write an image to file that combines this image and another of the same size
   /// with both overlayed using transparency
@@ -335,6 +373,57 @@ public:
   scalar_t interpolate_grad_y_bicubic(const scalar_t & local_x,
     const scalar_t & local_y);
 
+  /// interpolate the intensity and gradients for an array of points in one pass,
+  /// the interpolation weights are computed once per point and shared by all three fields
+  /// (points too close to the image boundary fall back to bilinear like the single point methods)
+  /// \param num_points the number of points
+  /// \param local_x array of local image coordinates x
+  /// \param local_y array of local image coordinates y
+  /// \param intensities [out] array of interpolated intensities
+  /// \param grad_x [out] array of interpolated x gradients (skipped if null or the image has no gradients)
+  /// \param grad_y [out] array of interpolated y gradients (skipped if null or the image has no gradients)
+  /// \param interp the interpolation method
+  /// If the image has analytic gradients (see set_analytic_gradients()) the gradients are the derivatives
+  /// of the interpolant, computed from the same intensity stencil as the interpolated intensity
+  void batch_interpolate(const int_t num_points,
+    const scalar_t * local_x,
+    const scalar_t * local_y,
+    intensity_t * intensities,
+    scalar_t * grad_x,
+    scalar_t * grad_y,
+    const Interpolation_Method interp);
+
+  /// compute the B-spline coefficient image used by the CUBIC_BSPLINE and QUINTIC_BSPLINE interpolants
+  /// (the coefficients are computed once and reused until the intensities change, if the image is
+  /// interpolated by multiple threads this should be called ahead of time since it is not thread safe)
+  /// \param degree the spline degree (3 or 5)
+  /// \param num_threads the number of threads used to filter the rows and columns
+  void compute_bspline_coefficients(const int_t degree,
+    const int_t num_threads=1);
+
+  /// returns the degree of the B-spline coefficient image (zero if the coefficients have not been computed)
+  int_t bspline_degree()const{
+    return bspline_degree_;
+  }
+
+  /// \brief copy the intensities and gradients into square tiles used by the KEYS_FOURTH batch interpolation
+  ///
+  /// In the row-major arrays the 6x6 Keys stencil touches six rows that are a full image width apart
+  /// (for each of the intensity and gradient arrays). Each tile holds a block of pixels plus an apron
+  /// copied from the neighboring tiles, so the whole stencil for any point in the block sits in one
+  /// compact piece of memory. The intensity and gradients of each pixel are interleaved in the tiles so
+  /// the three values read at each stencil position share a cache line. The tiles are rebuilt only when
+  /// this is called again after the intensities or gradients change (the same as the B-spline coefficients,
+  /// if the image is interpolated by multiple threads this should be called ahead of time since it is not
+  /// thread safe). No op in builds with Kokkos.
+  /// \param num_threads the number of threads used to fill the tiles
+  void compute_tiled_layout(const int_t num_threads=1);
+
+  /// returns true if the tiled copy of the intensities and gradients is current
+  bool has_tiled_layout()const{
+    return has_tiled_layout_;
+  }
+
   /// gradient accessors:
   /// note the internal arrays are stored as (row,column) so the indices have to be switched from coordinates x,y to y,x
   /// y is row, x is column
@@ -414,6 +503,17 @@ public:
   Teuchos::RCP<Image> apply_rotation(const Rotation_Value rotation,
       const Teuchos::RCP<Teuchos::ParameterList> & params=Teuchos::null);
 
+  /// returns a downsampled image for the given level of a coarse-to-fine pyramid,
+  /// each level halves the dimensions by averaging 2x2 blocks of the level below
+  /// (the blocks are aligned to the global image coordinates so the offsets are halved as well).
+  /// The levels are built on the first request and kept with this image,
+  /// replace_intensities() discards them. Safe to call from multiple threads.
+  /// \param level the pyramid level (must be at least 1)
+  Teuchos::RCP<Image> pyramid_level(const int_t level);
+
+  /// returns the number of pyramid levels built so far for this image
+  int_t num_pyramid_levels()const;
+
   /// compute the image gradients
   void compute_gradients(const bool use_hierarchical_parallelism=false,
     const int_t team_size=256);
@@ -425,10 +525,78 @@ public:
   void compute_gradients_finite_difference();
 
   /// returns true if the gradients have been computed
+  /// (with lazy gradients this means the gradients are available through compute_gradient_tiles())
   bool has_gradients()const{
     return has_gradients_;
   }
 
+  /// returns true if the gradients are computed one tile at a time when they are first needed
+  bool lazy_gradients()const{
+    return lazy_gradients_;
+  }
+
+  /// defer the gradient computation in compute_gradients() until the gradients of a region are requested
+  /// with compute_gradient_tiles(). This saves computing the gradients of the whole image when only a few small
+  /// subsets are correlated in a large image. Methods that read the gradients of the whole image
+  /// compute the remaining tiles first, but the gradient accessors do not, so code that reads the gradients
+  /// of an image with lazy gradients has to call compute_gradient_tiles() for the region first
+  /// (builds without Kokkos only, ignored otherwise)
+  /// \param lazy true if the gradients should be computed lazily
+  void set_lazy_gradients(const bool lazy){
+    lazy_gradients_ = lazy;
+  }
+
+  /// returns true if the interpolated gradients are the derivatives of the interpolant rather than
+  /// interpolated gradient images (has_gradients() is false for these images since no gradients are stored)
+  bool analytic_gradients()const{
+    return analytic_gradients_;
+  }
+
+  /// take the gradients from the derivative of the intensity interpolant in batch_interpolate() rather than
+  /// from stored gradient images. compute_gradients() then releases the gradient arrays instead of filling them,
+  /// which saves the gradient pass and the gradient memory of images that are only interpolated (the deformed
+  /// images). Code that reads the gradients at the pixels needs stored gradients, so this is turned off before
+  /// the gradients of such an image are computed (builds without Kokkos only, ignored otherwise)
+  /// \param analytic true if the gradients should be taken from the interpolant
+  void set_analytic_gradients(const bool analytic){
+    analytic_gradients_ = analytic;
+  }
+
+  /// returns true if batch_interpolate() reads the KEYS_FOURTH and BICUBIC weights from tables
+  bool quantized_interpolation_weights()const{
+    return quantized_weights_;
+  }
+
+  /// read the KEYS_FOURTH and BICUBIC weights (and their derivatives for analytic gradients) in batch_interpolate()
+  /// from tables at 1/256 pixel sub-pixel offsets instead of evaluating the kernel polynomials for every point. The
+  /// offsets are rounded to the nearest table entry, so the interpolant is evaluated up to 1/512 pixel away from the
+  /// requested location. The single point interpolants always use the exact weights (builds without Kokkos only)
+  /// \param quantized true if the tabulated weights should be used
+  void set_quantized_interpolation_weights(const bool quantized){
+    quantized_weights_ = quantized;
+  }
+
+  /// compute the gradients of the tiles that overlap a region if they have not been computed yet,
+  /// returns right away if the gradients are not lazy or all the tiles are done. Safe to call from multiple threads.
+  /// \param min_x the minimum x coordinate of the region (local image coordinates)
+  /// \param min_y the minimum y coordinate of the region
+  /// \param max_x the maximum x coordinate of the region (inclusive)
+  /// \param max_y the maximum y coordinate of the region (inclusive)
+  void compute_gradient_tiles(const int_t min_x,
+    const int_t min_y,
+    const int_t max_x,
+    const int_t max_y);
+
+  /// compute the gradients of all the tiles that have not been computed yet (see compute_gradient_tiles())
+  void compute_gradient_tiles(){
+    compute_gradient_tiles(0,0,width_-1,height_-1);
+  }
+
+  /// returns the number of gradient tiles that have not been computed yet (zero if the gradients are not lazy)
+  int_t num_pending_gradient_tiles()const{
+    return num_pending_gradient_tiles_;
+  }
+
   /// returns true if the image is a frame from a video sequence cine or netcdf file
   bool is_video_frame()const;
 
@@ -442,10 +610,29 @@ public:
     return has_gauss_filter_;
   }
 
+  /// returns the number of threads used to filter the image and compute the gradients
+  int_t num_threads()const{
+    return num_threads_;
+  }
+
+  /// set the number of threads used to filter the image and compute the gradients
+  /// \param num_threads the number of threads
+  void set_num_threads(const int_t num_threads){
+    num_threads_ = num_threads < 1 ? 1 : num_threads;
+  }
+
   /// filter the image using a 7 point gauss filter
   void gauss_filter(const int_t mask_size=-1,const bool use_hierarchical_parallelism=false,
     const int_t team_size=256);
 
+#if !DICE_KOKKOS
+  /// gauss filter the image and compute the gradients in one pass over the image
+  /// (the result is the same as calling gauss_filter() and then compute_gradients(),
+  /// but the filtered values are still in cache when the gradients are computed)
+  /// \param mask_size the size of the gauss filter mask (-1 uses the current size)
+  void gauss_filter_and_compute_gradients(const int_t mask_size=-1);
+#endif
+
   /// returns the name of the file if available
   std::string file_name()const{
     return file_name_;
@@ -460,11 +647,50 @@ public:
   /// returns the difference of two images:
   scalar_t diff(Teuchos::RCP<Image> rhs)const;
 
+  /// returns the sum of squared intensity differences between this image and another
+  /// of the same size (or -1 if the sizes differ), computed directly on the intensity arrays.
+  /// If the stride is larger than one only every stride-th pixel in x and y is sampled
+  /// and the sum is scaled by stride*stride to estimate the full image value.
+  /// If max_value is positive the sum stops as soon as it exceeds max_value
+  /// (the partial sum is returned, which is enough to know the threshold was exceeded)
+  /// \param rhs the image to compare to
+  /// \param border the number of pixels along each edge to skip
+  /// \param stride the sampling interval in each direction
+  /// \param max_value the early exit threshold (a value <= 0 computes the full sum)
+  scalar_t sum_squared_diff(const Teuchos::RCP<Image> & rhs,
+    const int_t border=0,
+    const int_t stride=1,
+    const scalar_t & max_value=-1.0)const;
+
+  /// same as sum_squared_diff(), but only the pixels in the region [min_x,max_x] x [min_y,max_y] are compared
+  /// so a window of a full frame can be tested without copying it into its own image
+  /// \param rhs the image to compare to (has to be the same size as this one)
+  /// \param min_x the left edge of the region in image coordinates (inclusive)
+  /// \param min_y the top edge of the region in image coordinates (inclusive)
+  /// \param max_x the right edge of the region in image coordinates (inclusive)
+  /// \param max_y the bottom edge of the region in image coordinates (inclusive)
+  /// \param border the number of pixels along each edge of the region to skip
+  /// \param stride the sampling interval in each direction
+  /// \param max_value the early exit threshold (a value <= 0 computes the full sum)
+  scalar_t sum_squared_diff_region(const Teuchos::RCP<Image> & rhs,
+    const int_t min_x,
+    const int_t min_y,
+    const int_t max_x,
+    const int_t max_y,
+    const int_t border=0,
+    const int_t stride=1,
+    const scalar_t & max_value=-1.0)const;
+
   /// returns the size of the gauss filter mask
   int_t gauss_filter_mask_size()const{
     return gauss_filter_mask_size_;
   }
 
+  /// returns the method used to compute the gradients
+  Gradient_Method gradient_method()const{
+    return gradient_method_;
+  }
+
 #if DICE_KOKKOS
   /// tag
   struct Init_Mask_Tag {};
@@ -510,6 +736,13 @@ public:
 #endif
 
 private:
+#if DICE_KOKKOS
+  /// allocates the device work array used by the filters and transformations the first time it is needed
+  void allocate_intensities_temp();
+#else
+  /// allocates the gradient arrays if they were released for analytic gradients
+  void allocate_gradients();
+#endif
   /// pixel container width_
   int_t width_;
   /// pixel container height_
@@ -538,8 +771,6 @@ private:
 #else
   /// pixel container
   Teuchos::ArrayRCP<intensity_t> intensities_;
-  /// device intensity work array
-  Teuchos::ArrayRCP<intensity_t> intensities_temp_;
   /// mask coefficients
   Teuchos::ArrayRCP<scalar_t> mask_;
   /// image gradient x container
@@ -549,6 +780,20 @@ private:
   /// image gradient y container
   Teuchos::ArrayRCP<scalar_t> laplacian_;
 #endif
+#if !DICE_KOKKOS
+  /// B-spline coefficient image (prefiltered intensities)
+  Teuchos::ArrayRCP<scalar_t> bspline_coeffs_;
+  /// tiled copy of the intensities and gradients, interleaved per pixel (see compute_tiled_layout())
+  Teuchos::ArrayRCP<scalar_t> tiled_values_;
+  /// number of values per pixel in the tiles (3 with gradients, 1 without)
+  int_t tile_components_;
+  /// number of tiles in each row of tiles
+  int_t num_tiles_x_;
+#endif
+  /// degree of the B-spline coefficients (zero if not computed)
+  int_t bspline_degree_;
+  /// true if the tiled copy of the intensities and gradients is current
+  bool has_tiled_layout_;
   /// flag that the gradients have been computed
   bool has_gradients_;
   /// flag that the image has been filtered
@@ -569,6 +814,22 @@ private:
   bool has_file_name_;
   /// gradient method
   Gradient_Method gradient_method_;
+  /// number of threads used to filter the image and compute the gradients
+  int_t num_threads_;
+  /// true if the gradients are computed one tile at a time when they are first needed
+  bool lazy_gradients_;
+  /// true if the interpolated gradients are the derivatives of the interpolant (no gradients are stored)
+  bool analytic_gradients_;
+  /// true if batch_interpolate() uses the tabulated kernel weights
+  bool quantized_weights_;
+  /// number of gradient tiles that have not been computed yet
+  int_t num_pending_gradient_tiles_;
+  /// flag for each gradient tile (row major), non-zero once the gradients of the tile have been computed
+  std::vector<char> gradient_tiles_;
+  /// downsampled images of the coarse-to-fine pyramid (index 0 is level 1)
+  std::vector<Teuchos::RCP<Image> > pyramid_;
+  /// bytes held by the pixel arrays
+  Tracked_Memory memory_;
 };
 
 }// End DICe Namespace
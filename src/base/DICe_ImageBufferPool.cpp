@@ -0,0 +1,236 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_ImageBufferPool.h>
+#include <DICe_MemoryTracker.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <cstdlib>
+#if defined(__linux__)
+  #include <sys/mman.h>
+#endif
+
+namespace DICe {
+
+namespace {
+/// by default the free arrays can hold a few frames of a large camera
+const size_t default_image_buffer_pool_bytes = 512*1024*1024;
+/// size of a regular page
+const size_t page_bytes = 4096;
+
+/// allocates an array aligned to a huge page and asks the kernel to back it with huge pages,
+/// returns NULL if huge pages are not available on this platform or the allocation failed
+void * allocate_huge_pages(const size_t bytes,
+  const size_t alignment){
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  void * ptr = NULL;
+  if(posix_memalign(&ptr,alignment,bytes)!=0) return NULL;
+  // only a hint, the kernel falls back to regular pages if no huge pages are free
+  madvise(ptr,bytes,MADV_HUGEPAGE);
+  return ptr;
+#else
+  return NULL;
+#endif
+}
+
+/// touches one byte of each page so that contiguous blocks of pages are placed by each thread
+void first_touch(void * ptr,
+  const size_t bytes,
+  const int_t num_threads){
+  char * data = static_cast<char*>(ptr);
+  const long long num_pages = (bytes + page_bytes - 1)/page_bytes;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) if(num_threads>1) schedule(static)
+#endif
+  for(long long page=0;page<num_pages;++page)
+    data[page*page_bytes] = 0;
+}
+}
+
+Image_Buffer_Pool::Image_Buffer_Pool():
+  stamp_(0),
+  free_bytes_(0),
+  max_bytes_(default_image_buffer_pool_bytes),
+  num_recycled_(0),
+  first_touch_threads_(1),
+  use_huge_pages_(false){}
+
+Image_Buffer_Pool &
+Image_Buffer_Pool::instance(){
+  static Image_Buffer_Pool * pool = new Image_Buffer_Pool();
+  return *pool;
+}
+
+void
+Image_Buffer_Pool::set_max_bytes(const size_t bytes){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  pool.max_bytes_ = bytes;
+  pool.trim(bytes);
+}
+
+size_t
+Image_Buffer_Pool::max_bytes(){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  return pool.max_bytes_;
+}
+
+size_t
+Image_Buffer_Pool::free_bytes(){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  return pool.free_bytes_;
+}
+
+long long
+Image_Buffer_Pool::num_recycled(){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  return pool.num_recycled_;
+}
+
+void
+Image_Buffer_Pool::set_first_touch_threads(const int_t num_threads){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  pool.first_touch_threads_ = std::max((int_t)1,num_threads);
+}
+
+int_t
+Image_Buffer_Pool::first_touch_threads(){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  return pool.first_touch_threads_;
+}
+
+void
+Image_Buffer_Pool::set_use_huge_pages(const bool use_huge_pages){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  pool.use_huge_pages_ = use_huge_pages;
+}
+
+bool
+Image_Buffer_Pool::use_huge_pages(){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  return pool.use_huge_pages_;
+}
+
+void
+Image_Buffer_Pool::clear(){
+  Image_Buffer_Pool & pool = instance();
+  std::lock_guard<std::mutex> lock(pool.mutex_);
+  pool.trim(0);
+}
+
+void *
+Image_Buffer_Pool::take(const size_t bytes){
+  int_t first_touch_threads = 1;
+  bool use_huge_pages = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    first_touch_threads = first_touch_threads_;
+    use_huge_pages = use_huge_pages_;
+    std::multimap<size_t,long long>::iterator it = free_by_size_.find(bytes);
+    if(it!=free_by_size_.end()){
+      std::map<long long,std::pair<size_t,void*> >::iterator entry = free_.find(it->second);
+      void * ptr = entry->second.second;
+      free_.erase(entry);
+      free_by_size_.erase(it);
+      free_bytes_ -= bytes;
+      num_recycled_++;
+      Memory_Tracker::release(MEMORY_CACHES,bytes);
+      return ptr;
+    }
+  }
+  void * ptr = NULL;
+  if(use_huge_pages&&bytes>=huge_page_bytes())
+    ptr = allocate_huge_pages(bytes,huge_page_bytes());
+  // malloc aligns the arrays for any fundamental type
+  if(ptr==NULL)
+    ptr = malloc(bytes);
+  TEUCHOS_TEST_FOR_EXCEPTION(ptr==NULL,std::runtime_error,"Error, could not allocate an image array of " << bytes << " bytes");
+  // recycled arrays keep the placement of their first use
+  if(first_touch_threads>1)
+    first_touch(ptr,bytes,first_touch_threads);
+  return ptr;
+}
+
+void
+Image_Buffer_Pool::give_back(void * ptr,
+  const size_t bytes){
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(bytes>max_bytes_){
+    free(ptr);
+    return;
+  }
+  trim(max_bytes_-bytes);
+  free_[stamp_] = std::make_pair(bytes,ptr);
+  free_by_size_.insert(std::make_pair(bytes,stamp_));
+  stamp_++;
+  free_bytes_ += bytes;
+  Memory_Tracker::allocate(MEMORY_CACHES,bytes);
+}
+
+void
+Image_Buffer_Pool::trim(const size_t bytes){
+  // the caller holds the lock
+  while(free_bytes_>bytes&&!free_.empty()){
+    std::map<long long,std::pair<size_t,void*> >::iterator oldest = free_.begin();
+    const size_t size = oldest->second.first;
+    std::pair<std::multimap<size_t,long long>::iterator,std::multimap<size_t,long long>::iterator> range = free_by_size_.equal_range(size);
+    for(std::multimap<size_t,long long>::iterator it=range.first;it!=range.second;++it){
+      if(it->second==oldest->first){
+        free_by_size_.erase(it);
+        break;
+      }
+    }
+    free(oldest->second.second);
+    free_.erase(oldest);
+    free_bytes_ -= size;
+    Memory_Tracker::release(MEMORY_CACHES,size);
+  }
+}
+
+}// End DICe Namespace
@@ -0,0 +1,211 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_IMAGEBUFFERPOOL_H
+#define DICE_IMAGEBUFFERPOOL_H
+
+#include <DICe.h>
+
+#include <Teuchos_ArrayRCP.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <type_traits>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Image_Buffer_Pool
+/// \brief Recycles the frame sized arrays of the images
+///
+/// An image of a new frame has the same size as the image it replaces, so rather than freeing
+/// the intensity, gradient and mask arrays of a released image and allocating them again for
+/// the next frame, the arrays are handed back to the pool when the last ArrayRCP that refers
+/// to them goes away and the next array of the same size is taken from the pool.
+/// The free arrays are accounted for as MEMORY_CACHES and the pool never holds more than
+/// max_bytes() of them (the oldest arrays are freed first). Arrays smaller than
+/// min_pooled_bytes() are allocated as usual.
+///
+/// The pool is thread safe, arrays can be released on any thread.
+///
+/// On multi-socket nodes the pages of an array are placed in the memory of the socket whose thread
+/// touches them first. With first_touch_threads() > 1 the pages of each newly allocated array are
+/// touched by that many threads in contiguous blocks, the same static partition of the rows the threaded
+/// image loops use, rather than all by the thread that reads the file. Large arrays can also be backed
+/// by transparent huge pages (Linux only).
+class DICE_LIB_DLL_EXPORT
+Image_Buffer_Pool{
+public:
+  /// returns an uninitialized array of n values, recycled from the pool if one of the right size is free
+  /// \param n the number of values
+  template<typename T>
+  static Teuchos::ArrayRCP<T> allocate(const int_t n){
+    static_assert(std::is_trivially_copyable<T>::value,"Error, only trivially copyable types can be pooled");
+    if(n<=0) return Teuchos::ArrayRCP<T>();
+    const size_t bytes = n*sizeof(T);
+    if(bytes<min_pooled_bytes())
+      return Teuchos::ArrayRCP<T>(n);
+    T * data = static_cast<T*>(instance().take(bytes));
+    return Teuchos::arcp<T,Recycler<T> >(data,0,n,Recycler<T>(bytes),true);
+  }
+
+  /// returns an array of n values that are all set to the given value
+  /// \param n the number of values
+  /// \param value the initial value
+  template<typename T>
+  static Teuchos::ArrayRCP<T> allocate(const int_t n,
+    const T & value){
+    Teuchos::ArrayRCP<T> array = allocate<T>(n);
+    std::fill(array.begin(),array.end(),value);
+    return array;
+  }
+
+  /// arrays smaller than this many bytes are not pooled
+  static size_t min_pooled_bytes(){
+    return 64*1024;
+  }
+
+  /// set the most bytes the free arrays of the pool can hold (0 disables the pool)
+  /// \param bytes the number of bytes
+  static void set_max_bytes(const size_t bytes);
+
+  /// returns the most bytes the free arrays of the pool can hold
+  static size_t max_bytes();
+
+  /// returns the number of bytes held by the free arrays of the pool
+  static size_t free_bytes();
+
+  /// returns the number of arrays taken from the pool rather than allocated
+  static long long num_recycled();
+
+  /// frees all the arrays held by the pool
+  static void clear();
+
+  /// set the number of threads that first touch the pages of new arrays (1 leaves the placement to the allocating thread)
+  /// \param num_threads the number of threads
+  static void set_first_touch_threads(const int_t num_threads);
+
+  /// returns the number of threads that first touch the pages of new arrays
+  static int_t first_touch_threads();
+
+  /// back the new arrays of at least huge_page_bytes() with transparent huge pages
+  /// \param use_huge_pages true if huge pages should be requested
+  static void set_use_huge_pages(const bool use_huge_pages);
+
+  /// returns true if huge pages are requested for large arrays
+  static bool use_huge_pages();
+
+  /// size of a huge page, smaller arrays use regular pages
+  static size_t huge_page_bytes(){
+    return 2*1024*1024;
+  }
+
+private:
+  /// deallocation policy of the pooled ArrayRCPs, hands the array back to the pool
+  template<typename T>
+  class Recycler{
+  public:
+    /// type of the pointer (required by Teuchos)
+    typedef T ptr_t;
+    /// constructor
+    /// \param bytes the size of the array in bytes
+    explicit Recycler(const size_t bytes):
+      bytes_(bytes){}
+    /// hands the array back to the pool
+    void free(T * ptr){
+      if(ptr) instance().give_back(ptr,bytes_);
+    }
+  private:
+    /// the size of the array in bytes
+    size_t bytes_;
+  };
+
+  /// constructor
+  Image_Buffer_Pool();
+  /// not copyable
+  Image_Buffer_Pool(const Image_Buffer_Pool &);
+  /// not assignable
+  Image_Buffer_Pool & operator=(const Image_Buffer_Pool &);
+
+  /// returns the pool (never destroyed so that images released during static destruction are safe)
+  static Image_Buffer_Pool & instance();
+
+  /// returns a free array of the given size or allocates a new one
+  void * take(const size_t bytes);
+
+  /// keeps the array for reuse or frees it if the pool is full
+  void give_back(void * ptr,
+    const size_t bytes);
+
+  /// frees the oldest arrays until the free arrays hold no more than the given number of bytes
+  void trim(const size_t bytes);
+
+  /// guards the free arrays
+  std::mutex mutex_;
+  /// the free arrays keyed by the order they were handed back, with their size
+  std::map<long long,std::pair<size_t,void*> > free_;
+  /// the free arrays keyed by their size, with their key in free_
+  std::multimap<size_t,long long> free_by_size_;
+  /// counter used to order the free arrays
+  long long stamp_;
+  /// bytes held by the free arrays
+  size_t free_bytes_;
+  /// the most bytes the free arrays can hold
+  size_t max_bytes_;
+  /// number of arrays taken from the pool
+  long long num_recycled_;
+  /// number of threads that first touch the pages of new arrays
+  int_t first_touch_threads_;
+  /// request huge pages for large arrays
+  bool use_huge_pages_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -41,13 +41,35 @@
 
 #include <DICe_Image.h>
 #include <DICe_ImageIO.h>
+#include <DICe_Profiler.h>
+#include <DICe_Trace.h>
 #include <DICe_Shape.h>
 #include <DICe_ImageFunctors.h>
+#include <DICe_ImageViewPool.h>
 
 #include <cassert>
 
 namespace DICe {
 
+Image::~Image(){
+  // hand the buffers back for the next image of the same size
+  // (they are only recycled if this image holds the last reference)
+  Image_View_Pool & pool = Image_View_Pool::instance();
+  pool.release(intensities_);
+  pool.release(intensities_temp_);
+  pool.release(mask_);
+  pool.release(grad_x_);
+  pool.release(grad_y_);
+}
+
+void
+Image::allocate_intensities_temp(){
+  if(intensities_temp_.ptr_on_device()==0){
+    intensities_temp_ = Image_View_Pool::instance().intensity_device_view("intensities_temp",height_,width_);
+    update_memory_usage();
+  }
+}
+
 Image::Image(const char * file_name,
   const Teuchos::RCP<Teuchos::ParameterList> & params):
   offset_x_(0),
@@ -57,13 +79,21 @@ Image::Image(const char * file_name,
   has_gauss_filter_(false),
   file_name_(file_name),
   has_file_name_(true),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   try{
+    Scoped_Profile_Timer load_timer(PROFILE_IMAGE_LOAD);
+    Scoped_Trace_Span span("image_read","io");
     utils::read_image_dimensions(file_name,width_,height_);
     TEUCHOS_TEST_FOR_EXCEPTION(width_<=0,std::runtime_error,"");
     TEUCHOS_TEST_FOR_EXCEPTION(height_<=0,std::runtime_error,"");
-    intensities_ = intensity_dual_view_2d("intensities",height_,width_);
+    intensities_ = Image_View_Pool::instance().intensity_view("intensities",height_,width_);
     utils::read_image(file_name,
       intensities_.h_view.ptr_on_device(),
       default_is_layout_right());
@@ -89,17 +119,25 @@ Image::Image(const char * file_name,
   has_gauss_filter_(false),
   file_name_(file_name),
   has_file_name_(true),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   // get the image dims
   int_t img_width = 0;
   int_t img_height = 0;
   try{
+    Scoped_Profile_Timer load_timer(PROFILE_IMAGE_LOAD);
+    Scoped_Trace_Span span("image_read","io");
     utils::read_image_dimensions(file_name,img_width,img_height);
     TEUCHOS_TEST_FOR_EXCEPTION(width_<=0||offset_x_+width_>img_width,std::runtime_error,"");
     TEUCHOS_TEST_FOR_EXCEPTION(height_<=0||offset_y_+height_>img_height,std::runtime_error,"");
     // initialize the pixel containers
-    intensities_ = intensity_dual_view_2d("intensities",height_,width_);
+    intensities_ = Image_View_Pool::instance().intensity_view("intensities",height_,width_);
     // read in the image
     utils::read_image(file_name,
       offset_x,offset_y,
@@ -128,11 +166,17 @@ Image::Image(const int_t width,
   has_gauss_filter_(false),
   file_name_("(from array)"),
   has_file_name_(false),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   assert(height_>0);
   assert(width_>0);
-  intensities_ = intensity_dual_view_2d("intensities",height_,width_);
+  intensities_ = Image_View_Pool::instance().intensity_view("intensities",height_,width_);
   for(int_t y=0;y<height_;++y){
     for(int_t x=0;x<width_;++x){
       intensities_.h_view(y,x) = intensity;
@@ -156,7 +200,13 @@ Image::Image(Teuchos::RCP<Image> img,
   has_gauss_filter_(img->has_gauss_filter()),
   file_name_(img->file_name()),
   has_file_name_(img->has_file_name()),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   TEUCHOS_TEST_FOR_EXCEPTION(offset_x_<0,std::invalid_argument,"Error, offset_x_ cannot be negative.");
   TEUCHOS_TEST_FOR_EXCEPTION(offset_y_<0,std::invalid_argument,"Error, offset_x_ cannot be negative.");
@@ -169,11 +219,11 @@ Image::Image(Teuchos::RCP<Image> img,
   const int_t src_width = img->width();
   const int_t src_height = img->height();
   // initialize the pixel containers
-  intensities_ = intensity_dual_view_2d("intensities",height_,width_);
-  intensities_temp_ = intensity_device_view_2d("intensities_temp",height_,width_);
-  grad_x_ = scalar_dual_view_2d("grad_x",height_,width_);
-  grad_y_ = scalar_dual_view_2d("grad_y",height_,width_);
-  mask_ = scalar_dual_view_2d("mask",height_,width_);
+  intensities_ = Image_View_Pool::instance().intensity_view("intensities",height_,width_);
+  // the work array is only allocated if a filter or transformation needs it
+  grad_x_ = Image_View_Pool::instance().scalar_view("grad_x",height_,width_);
+  grad_y_ = Image_View_Pool::instance().scalar_view("grad_y",height_,width_);
+  mask_ = Image_View_Pool::instance().scalar_view("mask",height_,width_);
   // deep copy values over
   int_t src_y=0, src_x=0;
   for(int_t y=0;y<height_;++y){
@@ -204,9 +254,14 @@ Image::Image(Teuchos::RCP<Image> img,
   mask_.sync<device_space>();
   grad_c1_ = 1.0/12.0;
   grad_c2_ = -8.0/12.0;
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
   gauss_filter_mask_size_ = img->gauss_filter_mask_size();
   gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
+  num_threads_ = img->num_threads();
   if(params!=Teuchos::null){
+    if(params->isParameter(DICe::num_threads))
+      set_num_threads(params->get<int_t>(DICe::num_threads));
     if(params->isParameter(DICe::gauss_filter_mask_size)){
       gauss_filter_mask_size_ = params->get<int>(DICe::gauss_filter_mask_size,7);
       gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
@@ -229,6 +284,7 @@ Image::Image(Teuchos::RCP<Image> img,
       }
     }
   }
+  update_memory_usage();
 }
 
 void
@@ -245,7 +301,7 @@ Image::initialize_array_image(intensity_t * intensities){
   // else the data has to be copied to coalesce with the default layout
   else{
     assert(!default_is_layout_right());
-    intensities_ = intensity_dual_view_2d("intensities",height_,width_);
+    intensities_ = Image_View_Pool::instance().intensity_view("intensities",height_,width_);
     for(int_t y=0;y<height_;++y){
       for(int_t x=0;x<width_;++x){
         intensities_.h_view(y,x) = intensities[y*width_+x];
@@ -257,23 +313,39 @@ Image::initialize_array_image(intensity_t * intensities){
 void
 Image::default_constructor_tasks(const Teuchos::RCP<Teuchos::ParameterList> & params){
 
-  grad_x_ = scalar_dual_view_2d("grad_x",height_,width_);
-  grad_y_ = scalar_dual_view_2d("grad_y",height_,width_);
+  grad_x_ = Image_View_Pool::instance().scalar_view("grad_x",height_,width_);
+  grad_y_ = Image_View_Pool::instance().scalar_view("grad_y",height_,width_);
   // copy the image to the device (no-op for OpenMP)
   intensities_.modify<host_space>(); // The template is where the modification took place
   intensities_.sync<device_space>(); // The template is what needs to be synced
-  // create a temp container for the pixel intensities
-  intensities_temp_ = intensity_device_view_2d("intensities_temp",height_,width_);
+  // the temp container for the pixel intensities is only allocated if a filter or transformation needs it
   // image gradient coefficients
   grad_c1_ = 1.0/12.0;
   grad_c2_ = -8.0/12.0;
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
   // create the image mask arrays
-  mask_ = scalar_dual_view_2d("mask",height_,width_);
+  mask_ = Image_View_Pool::instance().scalar_view("mask",height_,width_);
   // initialize the image mask arrays
   Kokkos::parallel_for(Kokkos::RangePolicy<Init_Mask_Tag>(0,num_pixels()),*this);
   mask_.modify<device_space>();
   mask_.sync<host_space>();
   post_allocation_tasks(params);
+  update_memory_usage();
+}
+
+void
+Image::update_memory_usage(){
+  // the host mirror only takes extra memory if it is not the device view itself
+  // (intensities that wrap a user array are counted as well)
+  long long bytes = (intensities_.h_view.ptr_on_device()==intensities_.d_view.ptr_on_device() ? 1 : 2)*
+    intensities_.d_view.dimension_0()*intensities_.d_view.dimension_1()*sizeof(intensity_t);
+  bytes += intensities_temp_.dimension_0()*intensities_temp_.dimension_1()*sizeof(intensity_t);
+  const scalar_dual_view_2d * views[4] = {&mask_,&grad_x_,&grad_y_,&laplacian_};
+  for(int_t i=0;i<4;++i)
+    bytes += (views[i]->h_view.ptr_on_device()==views[i]->d_view.ptr_on_device() ? 1 : 2)*
+      views[i]->d_view.dimension_0()*views[i]->d_view.dimension_1()*sizeof(scalar_t);
+  memory_.set(bytes);
 }
 
 const intensity_t&
@@ -369,6 +441,43 @@ Image::interpolate_grad_y_bicubic(const scalar_t & local_x, const scalar_t & loc
   TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, method not implemented yet.");
 }
 
+void
+Image::batch_interpolate(const int_t num_points,
+  const scalar_t * local_x,
+  const scalar_t * local_y,
+  intensity_t * intensities,
+  scalar_t * grad_x,
+  scalar_t * grad_y,
+  const Interpolation_Method interp){
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, method not implemented yet.");
+}
+
+void
+Image::compute_bspline_coefficients(const int_t degree,
+  const int_t num_threads){
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, method not implemented yet.");
+}
+
+void
+Image::write_preprocessed(const std::string & file_name){
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, method not implemented yet.");
+}
+
+bool
+Image::read_preprocessed(const std::string & file_name){
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, method not implemented yet.");
+  return false;
+}
+
+void
+Image::share_preprocessed_arrays(Teuchos::ArrayRCP<intensity_t> intensities,
+  Teuchos::ArrayRCP<scalar_t> grad_x,
+  Teuchos::ArrayRCP<scalar_t> grad_y,
+  const int_t gauss_filter_mask_size,
+  const Gradient_Method gradient_method){
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, method not implemented yet.");
+}
+
 void
 Image::smooth_gradients_convolution_5_point(){
   TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, this method should not be called");
@@ -382,6 +491,7 @@ Image::compute_gradients_finite_difference(){
 
 void
 Image::compute_gradients(const bool use_hierarchical_parallelism, const int_t team_size){
+  Scoped_Profile_Timer preprocess_timer(PROFILE_PREPROCESS);
   TEUCHOS_TEST_FOR_EXCEPTION(gradient_method_!=FINITE_DIFFERENCE,std::runtime_error,
     "Error, gradient method must be FINITE_DIFFERENCE (this is the only method implemented for Kokkos");
   // Flat gradients:
@@ -417,6 +527,7 @@ Image::apply_mask(const bool smooth_edges){
     // smooth the edges of the mask:
     Mask_Smoothing_Functor smoother(mask_,width_,height_);
     Kokkos::parallel_for(width_*height_,smoother);
+    Image_View_Pool::instance().release(smoother.mask_tmp_);
   }
   // then apply it to the image intensity values
   Mask_Apply_Functor apply_functor(intensities_.d_view,mask_.d_view,width_);
@@ -470,6 +581,7 @@ Image::create_mask(const Conformal_Area_Def & area_def,
     // smooth the edges of the mask:
     Mask_Smoothing_Functor smoother(mask_,width_,height_);
     Kokkos::parallel_for(width_*height_,smoother);
+    Image_View_Pool::instance().release(smoother.mask_tmp_);
   }
   mask_.modify<device_space>();
   mask_.sync<host_space>();
@@ -486,6 +598,7 @@ Image::apply_transformation(Teuchos::RCP<Local_Shape_Function> shape_function,
 
   if(apply_in_place){
     // deep copy the intesity array to the device temporary container
+    allocate_intensities_temp();
     Kokkos::deep_copy(intensities_temp_,intensities_.d_view);
     Transform_Functor trans_functor(intensities_temp_,
       intensities_.d_view,
@@ -520,6 +633,7 @@ Image::apply_transformation(Teuchos::RCP<Local_Shape_Function> shape_function,
 void
 Image::gauss_filter(const int_t mask_size,const bool use_hierarchical_parallelism,
   const int_t team_size){
+  Scoped_Profile_Timer preprocess_timer(PROFILE_PREPROCESS);
 
   if(mask_size>0) gauss_filter_mask_size_ = mask_size;
 
@@ -564,6 +678,7 @@ Image::gauss_filter(const int_t mask_size,const bool use_hierarchical_parallelis
     }
   }
   // deep copy the intesity array to the device temporary container
+  allocate_intensities_temp();
   Kokkos::deep_copy(intensities_temp_,intensities_.d_view);
   // Flat gradients:
   if(use_hierarchical_parallelism)
@@ -586,7 +701,8 @@ Mask_Smoothing_Functor::Mask_Smoothing_Functor(scalar_dual_view_2d mask,
   width_(width),
   height_(height){
   // create the device array to hold a copy of the mask values
-  mask_tmp_ = scalar_device_view_2d("mask_tmp",height_,width_);
+  // (returned to the pool by the caller once the smoothing is done)
+  mask_tmp_ = Image_View_Pool::instance().scalar_device_view("mask_tmp",height_,width_);
   Kokkos::deep_copy(mask_tmp_,mask_.d_view);
   // set up the coefficients:
   std::vector<scalar_t> coeffs(5,0.0);
@@ -804,4 +920,17 @@ Mask_Smoothing_Functor::operator()(const int_t pixel_index)const{
   }
 }
 
+void
+Image::compute_tiled_layout(const int_t num_threads){
+  // the device views keep their own layout
+}
+
+void
+Image::compute_gradient_tiles(const int_t min_x,
+  const int_t min_y,
+  const int_t max_x,
+  const int_t max_y){
+  // the gradients are always computed for the whole image in builds with Kokkos
+}
+
 }// End DICe Namespace
@@ -41,14 +41,41 @@
 
 #include <DICe_Image.h>
 #include <DICe_ImageUtils.h>
+#include <DICe_FrameArena.h>
+#include <DICe_ImageBufferPool.h>
 #include <DICe_LocalShapeFunction.h>
 #include <DICe_ImageIO.h>
+#include <DICe_Profiler.h>
+#include <DICe_Trace.h>
 #include <DICe_Shape.h>
 
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <vector>
 
 namespace DICe {
 
+/// number of pixels along each side of the block of pixels owned by an image tile
+const int_t image_tile_size = 32;
+/// number of pixels copied from the neighboring tiles on each side of a tile (enough for the Keys stencil)
+const int_t image_tile_apron = 3;
+/// number of values along each side of an image tile including the apron
+const int_t image_tile_stride = image_tile_size + 2*image_tile_apron;
+/// number of pixels along each side of the blocks the gradients are computed in when they are lazy
+const int_t gradient_tile_size = 64;
+
+namespace {
+/// guards the bookkeeping of the lazily computed gradient tiles
+std::mutex gradient_tile_mutex;
+/// identifies a preprocessed image file (see Image::write_preprocessed())
+const static char preprocessed_image_magic[8] = {'D','I','C','e','_','I','M','P'};
+}
+
 inline scalar_t keys_f0(const scalar_t & s){
   return 1.33333333333333*s*s*s - 2.33333333333333*s*s+ 1.0;
 }
@@ -58,6 +85,538 @@ inline scalar_t keys_f1(const scalar_t & s){
 inline scalar_t keys_f2(const scalar_t & s){
   return 0.08333333333333*s*s*s - 0.66666666666666*s*s + 1.75*s - 1.5;
 }
+/// derivatives of the Keys kernel pieces (used for the analytic gradients)
+inline scalar_t keys_df0(const scalar_t & s){
+  return 4.0*s*s - 4.66666666666666*s;
+}
+inline scalar_t keys_df1(const scalar_t & s){
+  return -1.75*s*s + 6.0*s - 4.91666666666666;
+}
+inline scalar_t keys_df2(const scalar_t & s){
+  return 0.25*s*s - 1.33333333333333*s + 1.75;
+}
+/// bicubic (Catmull-Rom) weights for the four stencil points -1,0,1,2 given the fractional offset s
+inline void bicubic_weights(const scalar_t & s, scalar_t * w){
+  const scalar_t s_2 = s*s;
+  const scalar_t s_3 = s_2*s;
+  w[0] = -0.5*s + s_2 - 0.5*s_3;
+  w[1] = 1.0 - 2.5*s_2 + 1.5*s_3;
+  w[2] = 0.5*s + 2.0*s_2 - 1.5*s_3;
+  w[3] = -0.5*s_2 + 0.5*s_3;
+}
+/// derivatives of the bicubic weights with respect to s (used for the analytic gradients)
+inline void bicubic_weight_derivatives(const scalar_t & s, scalar_t * dw){
+  const scalar_t s_2 = s*s;
+  dw[0] = -0.5 + 2.0*s - 1.5*s_2;
+  dw[1] = -5.0*s + 4.5*s_2;
+  dw[2] = 0.5 + 4.0*s - 4.5*s_2;
+  dw[3] = -s + 1.5*s_2;
+}
+/// number of sub-pixel offsets per pixel in the quantized interpolation weight tables
+const int_t interpolation_table_resolution = 256;
+/// \brief KEYS_FOURTH and BICUBIC weights and their derivatives at the offsets k/interpolation_table_resolution
+///
+/// Each row holds the weights of the whole stencil for one offset so batch_interpolate() reads them with
+/// a single index (the last row is the offset 1.0, which an offset just below one rounds to)
+struct Interpolation_Weight_Tables{
+  Interpolation_Weight_Tables(){
+    for(int_t k=0;k<=interpolation_table_resolution;++k){
+      const scalar_t s = (scalar_t)k/interpolation_table_resolution;
+      scalar_t * kw = keys + k*6;
+      scalar_t * kdw = keys_derivatives + k*6;
+      kw[0] = keys_f2(s+2.0);
+      kw[1] = keys_f1(s+1.0);
+      kw[2] = keys_f0(s);
+      kw[3] = keys_f0(1.0-s);
+      kw[4] = keys_f1(2.0-s);
+      kw[5] = keys_f2(3.0-s);
+      kdw[0] = keys_df2(s+2.0);
+      kdw[1] = keys_df1(s+1.0);
+      kdw[2] = keys_df0(s);
+      kdw[3] = -keys_df0(1.0-s);
+      kdw[4] = -keys_df1(2.0-s);
+      kdw[5] = -keys_df2(3.0-s);
+      bicubic_weights(s,bicubic + k*4);
+      bicubic_weight_derivatives(s,bicubic_derivatives + k*4);
+    }
+  }
+  /// Keys weights for the stencil points -2..3
+  scalar_t keys[(interpolation_table_resolution+1)*6];
+  /// derivatives of the Keys weights
+  scalar_t keys_derivatives[(interpolation_table_resolution+1)*6];
+  /// bicubic weights for the stencil points -1..2
+  scalar_t bicubic[(interpolation_table_resolution+1)*4];
+  /// derivatives of the bicubic weights
+  scalar_t bicubic_derivatives[(interpolation_table_resolution+1)*4];
+};
+/// the weight tables (built on first use, the initialization of a function local static is thread safe)
+inline const Interpolation_Weight_Tables & interpolation_weight_tables(){
+  static const Interpolation_Weight_Tables tables;
+  return tables;
+}
+/// row of the weight tables nearest to the sub-pixel offset s (0 <= s < 1)
+inline int_t interpolation_table_row(const scalar_t & s){
+  return (int_t)(s*interpolation_table_resolution + 0.5);
+}
+/// derivatives of the bilinear interpolant (zero where interpolate_bilinear() is zero), the analytic
+/// gradients near the image edges where the higher order stencils fall back to bilinear
+inline void bilinear_gradients(const intensity_t * f,
+  const int_t width,
+  const int_t height,
+  const scalar_t & lx,
+  const scalar_t & ly,
+  scalar_t & gx,
+  scalar_t & gy){
+  if(lx<0.0||lx>=width-1.5||ly<0.0||ly>=height-1.5){
+    gx = 0.0;
+    gy = 0.0;
+    return;
+  }
+  const int_t x1 = (int_t)lx;
+  const int_t y1 = (int_t)ly;
+  const scalar_t dx = lx - x1;
+  const scalar_t dy = ly - y1;
+  const int_t i11 = y1*width+x1;
+  const int_t i12 = i11+width;
+  gx = (f[i11+1]-f[i11])*(1.0-dy) + (f[i12+1]-f[i12])*dy;
+  gy = (f[i12]-f[i11])*(1.0-dx) + (f[i12+1]-f[i11+1])*dx;
+}
+/// cubic B-spline basis (and derivative) for |x| in [0,1] and [1,2]
+inline scalar_t bspline3_f0(const scalar_t & s){
+  return 0.66666666666666 - s*s + 0.5*s*s*s;
+}
+inline scalar_t bspline3_df0(const scalar_t & s){
+  return -2.0*s + 1.5*s*s;
+}
+inline scalar_t bspline3_f1(const scalar_t & s){
+  return 0.16666666666666*(2.0-s)*(2.0-s)*(2.0-s);
+}
+inline scalar_t bspline3_df1(const scalar_t & s){
+  return -0.5*(2.0-s)*(2.0-s);
+}
+/// quintic B-spline basis (and derivative) for |x| in [0,1], [1,2] and [2,3]
+inline scalar_t bspline5_f0(const scalar_t & s){
+  const scalar_t s_2 = s*s;
+  return (66.0 - 60.0*s_2 + 30.0*s_2*s_2 - 10.0*s_2*s_2*s)/120.0;
+}
+inline scalar_t bspline5_df0(const scalar_t & s){
+  const scalar_t s_2 = s*s;
+  return (-120.0*s + 120.0*s_2*s - 50.0*s_2*s_2)/120.0;
+}
+inline scalar_t bspline5_f1(const scalar_t & s){
+  const scalar_t s_2 = s*s;
+  return (51.0 + 75.0*s - 210.0*s_2 + 150.0*s_2*s - 45.0*s_2*s_2 + 5.0*s_2*s_2*s)/120.0;
+}
+inline scalar_t bspline5_df1(const scalar_t & s){
+  const scalar_t s_2 = s*s;
+  return (75.0 - 420.0*s + 450.0*s_2 - 180.0*s_2*s + 25.0*s_2*s_2)/120.0;
+}
+inline scalar_t bspline5_f2(const scalar_t & s){
+  const scalar_t r = 3.0-s;
+  return r*r*r*r*r/120.0;
+}
+inline scalar_t bspline5_df2(const scalar_t & s){
+  const scalar_t r = 3.0-s;
+  return -r*r*r*r/24.0;
+}
+/// B-spline weights and their derivatives for the stencil points ix-1..ix+2 (cubic) or ix-2..ix+3 (quintic)
+/// given the fractional offset t
+inline void bspline_weights(const int_t degree, const scalar_t & t, scalar_t * w, scalar_t * dw){
+  if(degree==3){
+    w[0] = bspline3_f1(t+1.0);   dw[0] = bspline3_df1(t+1.0);
+    w[1] = bspline3_f0(t);       dw[1] = bspline3_df0(t);
+    w[2] = bspline3_f0(1.0-t);   dw[2] = -bspline3_df0(1.0-t);
+    w[3] = bspline3_f1(2.0-t);   dw[3] = -bspline3_df1(2.0-t);
+  }
+  else{
+    w[0] = bspline5_f2(t+2.0);   dw[0] = bspline5_df2(t+2.0);
+    w[1] = bspline5_f1(t+1.0);   dw[1] = bspline5_df1(t+1.0);
+    w[2] = bspline5_f0(t);       dw[2] = bspline5_df0(t);
+    w[3] = bspline5_f0(1.0-t);   dw[3] = -bspline5_df0(1.0-t);
+    w[4] = bspline5_f1(2.0-t);   dw[4] = -bspline5_df1(2.0-t);
+    w[5] = bspline5_f2(3.0-t);   dw[5] = -bspline5_df2(3.0-t);
+  }
+}
+/// causal initial value of the recursive B-spline prefilter for mirror boundary conditions
+inline double bspline_initial_causal(const double * c, const int_t n, const double & z){
+  const int_t horizon = (int_t)std::ceil(std::log(1.0E-10)/std::log(std::abs(z)));
+  if(horizon<n){
+    double zn = z;
+    double sum = c[0];
+    for(int_t k=1;k<horizon;++k){
+      sum += zn*c[k];
+      zn *= z;
+    }
+    return sum;
+  }
+  double zn = z;
+  const double iz = 1.0/z;
+  double z2n = std::pow(z,(double)(n-1));
+  double sum = c[0] + z2n*c[n-1];
+  z2n *= z2n*iz;
+  for(int_t k=1;k<n-1;++k){
+    sum += (zn+z2n)*c[k];
+    zn *= z;
+    z2n *= iz;
+  }
+  return sum/(1.0-zn*zn);
+}
+/// in place recursive B-spline prefilter of one line of samples (causal and anti-causal pass per pole)
+inline void bspline_prefilter_line(double * c, const int_t n, const double * poles, const int_t num_poles){
+  if(n<2) return;
+  double gain = 1.0;
+  for(int_t p=0;p<num_poles;++p)
+    gain *= (1.0-poles[p])*(1.0-1.0/poles[p]);
+  for(int_t k=0;k<n;++k)
+    c[k] *= gain;
+  for(int_t p=0;p<num_poles;++p){
+    const double z = poles[p];
+    c[0] = bspline_initial_causal(c,n,z);
+    for(int_t k=1;k<n;++k)
+      c[k] += z*c[k-1];
+    c[n-1] = (z/(z*z-1.0))*(z*c[n-2]+c[n-1]);
+    for(int_t k=n-2;k>=0;--k)
+      c[k] = z*(c[k+1]-c[k]);
+  }
+}
+/// convolve one row of an array with a symmetric 1d kernel in y and then in x,
+/// only the pixels at least border pixels from the left and right edges are written
+/// \param in pointer to the first row of the kernel window (row y - mask_size/2)
+/// \param out_row pointer to the output row
+/// \param w the width of the array
+/// \param coeffs the 1d kernel
+/// \param mask_size the number of kernel coefficients
+/// \param border the number of pixels along the left and right edges to leave as is
+/// \param col work array of length w
+/// \param row work array of length w
+template <typename T>
+inline void separable_convolution_row(const T * in,
+  T * out_row,
+  const int_t w,
+  const scalar_t * coeffs,
+  const int_t mask_size,
+  const int_t border,
+  scalar_t * col,
+  scalar_t * row){
+  const int_t r = mask_size/2;
+  const int_t col_begin = border - r;
+  const int_t col_end = w - border + r;
+  for(int_t x=col_begin;x<col_end;++x)
+    col[x] = 0.0;
+  for(int_t j=0;j<mask_size;++j){
+    const T * in_row = in + j*w;
+    const scalar_t c = coeffs[j];
+    for(int_t x=col_begin;x<col_end;++x)
+      col[x] += c*in_row[x];
+  }
+  for(int_t x=border;x<w-border;++x)
+    row[x] = 0.0;
+  for(int_t i=0;i<mask_size;++i){
+    const scalar_t c = coeffs[i];
+    for(int_t x=border;x<w-border;++x)
+      row[x] += c*col[x+i-r];
+  }
+  for(int_t x=border;x<w-border;++x)
+    out_row[x] = row[x];
+}
+/// convolve the interior of an array with a symmetric 1d kernel in y and then in x, which is
+/// the same as the 2d kernel given by the outer product of the coefficients. Only the pixels at least
+/// border pixels from the edge are written to out (the rest are left as is). The rows are split
+/// between the threads and each thread keeps its own column sums so the inner loops are contiguous
+template <typename T>
+void separable_convolution(const T * in,
+  T * out,
+  const int_t w,
+  const int_t h,
+  const scalar_t * coeffs,
+  const int_t mask_size,
+  const int_t border,
+  const int_t num_threads){
+  assert(border>=mask_size/2);
+  if(w-2*border<=0||h-2*border<=0) return;
+  const int_t r = mask_size/2;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads) if(num_threads>1)
+#endif
+  {
+    std::vector<scalar_t> col(w,0.0);
+    std::vector<scalar_t> row(w,0.0);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t y=border;y<h-border;++y)
+      separable_convolution_row(in+(y-r)*w,out+y*w,w,coeffs,mask_size,border,&col[0],&row[0]);
+  }
+}
+/// finite difference gradients of part of one row of an image, the pixels closest to the
+/// edges use a one sided difference
+/// \param rows pointers to the rows y-2 to y+2 (only the ones inside the image are used)
+/// \param w the width of the image
+/// \param h the height of the image
+/// \param y the row
+/// \param x_begin the first pixel in the row to compute
+/// \param x_end one past the last pixel in the row to compute
+/// \param c1 the outer finite difference coefficient
+/// \param c2 the inner finite difference coefficient
+/// \param gx_out [out] the x gradients for pixels x_begin to x_end-1
+/// \param gy_out [out] the y gradients for pixels x_begin to x_end-1
+inline void finite_difference_gradient_span(const intensity_t * const * rows,
+  const int_t w,
+  const int_t h,
+  const int_t y,
+  const int_t x_begin,
+  const int_t x_end,
+  const scalar_t & c1,
+  const scalar_t & c2,
+  scalar_t * gx_out,
+  scalar_t * gy_out){
+  const intensity_t * row = rows[2];
+  const int_t left_end = std::min(std::min(2,w),x_end);
+  const int_t right_begin = std::max(2,w-2);
+  for(int_t x=x_begin;x<left_end;++x)
+    gx_out[x-x_begin] = row[x+1] - row[x];
+  for(int_t x=std::max(2,x_begin);x<std::min(right_begin,x_end);++x)
+    gx_out[x-x_begin] = c1*row[x-2] + c2*row[x-1] - c2*row[x+1] - c1*row[x+2];
+  for(int_t x=std::max(right_begin,x_begin);x<x_end;++x)
+    gx_out[x-x_begin] = row[x] - row[x-1];
+  /// check if this row is near the top edge
+  if(y<2){
+    const intensity_t * row_p1 = rows[3];
+    for(int_t x=x_begin;x<x_end;++x)
+      gy_out[x-x_begin] = row_p1[x] - row[x];
+  }
+  /// check if this row is near the bottom edge
+  else if(y>=h-2){
+    const intensity_t * row_m1 = rows[1];
+    for(int_t x=x_begin;x<x_end;++x)
+      gy_out[x-x_begin] = row[x] - row_m1[x];
+  }
+  else{
+    const intensity_t * row_m2 = rows[0];
+    const intensity_t * row_m1 = rows[1];
+    const intensity_t * row_p1 = rows[3];
+    const intensity_t * row_p2 = rows[4];
+    for(int_t x=x_begin;x<x_end;++x)
+      gy_out[x-x_begin] = c1*row_m2[x] + c2*row_m1[x] - c2*row_p1[x] - c1*row_p2[x];
+  }
+}
+/// finite difference gradients of one row of an image (see finite_difference_gradient_span())
+inline void finite_difference_gradient_row(const intensity_t * const * rows,
+  const int_t w,
+  const int_t h,
+  const int_t y,
+  const scalar_t & c1,
+  const scalar_t & c2,
+  scalar_t * gx_row,
+  scalar_t * gy_row){
+  finite_difference_gradient_span(rows,w,h,y,0,w,c1,c2,gx_row,gy_row);
+}
+/// gathers the pointers to the rows y-2 to y+2 of an array whose first stored row is first_row
+/// (rows outside [first_row,end_row) are set to null)
+template <typename T>
+inline void gather_rows(const T * data,
+  const int_t w,
+  const int_t first_row,
+  const int_t end_row,
+  const int_t y,
+  const T ** rows){
+  for(int_t k=0;k<5;++k){
+    const int_t ry = y + k - 2;
+    rows[k] = ry>=first_row&&ry<end_row ? data + (ry-first_row)*w : NULL;
+  }
+}
+/// 1d coefficients of the 5 point gradient smoothing kernel (the 2d kernel is the outer product)
+static scalar_t smooth_gradient_coeffs[] = {0.0625, 0.25, 0.375, 0.25, 0.0625};
+/// computes the gradients of a block of pixels [x_begin,x_end) x [y_begin,y_end), the values are the same as
+/// the ones computed for the whole image (the stencils read the pixels around the block as needed)
+/// \param f the image intensities
+/// \param w the width of the image
+/// \param h the height of the image
+/// \param x_begin the first column of the block
+/// \param x_end one past the last column of the block
+/// \param y_begin the first row of the block
+/// \param y_end one past the last row of the block
+/// \param c1 the outer finite difference coefficient
+/// \param c2 the inner finite difference coefficient
+/// \param smooth true if the finite differences are smoothed with the 5 point kernel (CONVOLUTION_5_POINT)
+/// \param gx [out] the x gradients of the whole image (only the block is written)
+/// \param gy [out] the y gradients of the whole image (only the block is written)
+void gradient_block(const intensity_t * f,
+  const int_t w,
+  const int_t h,
+  const int_t x_begin,
+  const int_t x_end,
+  const int_t y_begin,
+  const int_t y_end,
+  const scalar_t & c1,
+  const scalar_t & c2,
+  const bool smooth,
+  scalar_t * gx,
+  scalar_t * gy){
+  const intensity_t * rows[5];
+  if(!smooth){
+    for(int_t y=y_begin;y<y_end;++y){
+      gather_rows(f,w,0,h,y,rows);
+      finite_difference_gradient_span(rows,w,h,y,x_begin,x_end,c1,c2,gx+y*w+x_begin,gy+y*w+x_begin);
+    }
+    return;
+  }
+  // the smoothing reads the finite differences two pixels around the block
+  const int_t wx0 = std::max(0,x_begin-2);
+  const int_t wx1 = std::min(w,x_end+2);
+  const int_t wy0 = std::max(0,y_begin-2);
+  const int_t wy1 = std::min(h,y_end+2);
+  const int_t ww = wx1 - wx0;
+  std::vector<scalar_t> fd_x(ww*(wy1-wy0),0.0);
+  std::vector<scalar_t> fd_y(ww*(wy1-wy0),0.0);
+  for(int_t y=wy0;y<wy1;++y){
+    gather_rows(f,w,0,h,y,rows);
+    finite_difference_gradient_span(rows,w,h,y,wx0,wx1,c1,c2,&fd_x[(y-wy0)*ww],&fd_y[(y-wy0)*ww]);
+  }
+  // the pixels within two of the image edges keep the finite difference values
+  for(int_t y=y_begin;y<y_end;++y){
+    for(int_t x=x_begin;x<x_end;++x){
+      gx[y*w+x] = fd_x[(y-wy0)*ww+x-wx0];
+      gy[y*w+x] = fd_y[(y-wy0)*ww+x-wx0];
+    }
+  }
+  if(ww<=4) return;
+  // same arithmetic as separable_convolution() so the values match the whole image computation,
+  // the window is clipped to the image so the written columns are the block columns at least two from the edges
+  std::vector<scalar_t> col(ww,0.0);
+  std::vector<scalar_t> row(ww,0.0);
+  for(int_t y=std::max(y_begin,2);y<std::min(y_end,h-2);++y){
+    separable_convolution_row(&fd_x[(y-2-wy0)*ww],gx+y*w+wx0,ww,smooth_gradient_coeffs,5,2,&col[0],&row[0]);
+    separable_convolution_row(&fd_y[(y-2-wy0)*ww],gy+y*w+wx0,ww,smooth_gradient_coeffs,5,2,&col[0],&row[0]);
+  }
+}
+/// returns the 1d gauss filter coefficients for the given mask size (the 2d kernel is their outer product)
+/// \param mask_size the size of the mask (5, 7, 9, 11, or 13)
+/// \param coeffs [out] array of at least mask_size values
+inline void gauss_filter_coefficients(const int_t mask_size,
+  scalar_t * coeffs){
+  if(mask_size==5){
+    coeffs[0] = 0.0014;coeffs[1] = 0.1574;coeffs[2] = 0.62825;
+    coeffs[3] = 0.1574;coeffs[4] = 0.0014;
+  }
+  else if (mask_size==7){
+    coeffs[0] = 0.0060;coeffs[1] = 0.0606;coeffs[2] = 0.2418;
+    coeffs[3] = 0.3831;coeffs[4] = 0.2418;coeffs[5] = 0.0606;
+    coeffs[6] = 0.0060;
+  }
+  else if (mask_size==9){
+    coeffs[0] = 0.0007;coeffs[1] = 0.0108;coeffs[2] = 0.0748;
+    coeffs[3] = 0.2384;coeffs[4] = 0.3505;coeffs[5] = 0.2384;
+    coeffs[6] = 0.0748;coeffs[7] = 0.0108;coeffs[8] = 0.0007;
+  }
+  else if (mask_size==11){
+    coeffs[0] = 0.0001;coeffs[1] = 0.0017;coeffs[2] = 0.0168;
+    coeffs[3] = 0.0870;coeffs[4] = 0.2328;coeffs[5] = 0.3231;
+    coeffs[6] = 0.2328;coeffs[7] = 0.0870;coeffs[8] = 0.0168;
+    coeffs[9] = 0.0017;coeffs[10] = 0.0001;
+  }
+  else if (mask_size==13){
+    coeffs[0] = 0.0001;coeffs[1] = 0.0012;coeffs[2] = 0.0085;
+    coeffs[3] = 0.0380;coeffs[4] = 0.1109;coeffs[5] = 0.2108;
+    coeffs[6] = 0.2611;coeffs[7] = 0.2108;coeffs[8] = 0.1109;
+    coeffs[9] = 0.0380;coeffs[10] = 0.0085;coeffs[11] = 0.0012;
+    coeffs[12] = 0.0001;
+  }
+  else{
+    TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,
+      "Error, the Gauss filter mask size is invalid (options include 5,7,9,11,13)");
+  }
+}
+/// gauss filters an image, computes the finite difference gradients and optionally smooths them in one
+/// sweep over bands of rows. Each band filters the rows it needs (with a halo that overlaps the neighboring
+/// bands) and computes their gradients into per thread buffers so the intermediate values stay in cache.
+/// The results are the same as calling separable_convolution, finite_difference_gradient_row and the smoothing in turn
+/// \param in the unfiltered intensities (must not be the same array as out)
+/// \param out [out] the filtered intensities
+/// \param gx [out] the x gradients
+/// \param gy [out] the y gradients
+/// \param w the width of the image
+/// \param h the height of the image
+/// \param coeffs the 1d gauss filter coefficients
+/// \param mask_size the number of gauss filter coefficients
+/// \param border the number of pixels along each edge that are not filtered
+/// \param c1 the outer finite difference coefficient
+/// \param c2 the inner finite difference coefficient
+/// \param smooth true if the gradients should be smoothed with the 5 point kernel
+/// \param num_threads the number of threads to split the bands across
+void fused_filter_and_gradients(const intensity_t * in,
+  intensity_t * out,
+  scalar_t * gx,
+  scalar_t * gy,
+  const int_t w,
+  const int_t h,
+  const scalar_t * coeffs,
+  const int_t mask_size,
+  const int_t border,
+  const scalar_t & c1,
+  const scalar_t & c2,
+  const bool smooth,
+  const int_t num_threads){
+  assert(in!=out);
+  const int_t r = mask_size/2;
+  const bool filter_rows = w-2*border>0&&h-2*border>0;
+  // number of rows per band
+  const int_t band = 32;
+  const int_t num_bands = (h+band-1)/band;
+  // halo rows needed for the gradient smoothing and the gradients
+  const int_t grad_halo = smooth ? 2 : 0;
+  const int_t intens_halo = grad_halo + 2;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads) if(num_threads>1)
+#endif
+  {
+    std::vector<intensity_t> intens_buf((band+2*intens_halo)*w);
+    std::vector<scalar_t> gx_buf((band+2*grad_halo)*w);
+    std::vector<scalar_t> gy_buf((band+2*grad_halo)*w);
+    std::vector<scalar_t> col(w,0.0);
+    std::vector<scalar_t> row(w,0.0);
+    const intensity_t * rows[5];
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t b=0;b<num_bands;++b){
+      const int_t y_begin = b*band;
+      const int_t y_end = std::min(h,y_begin+band);
+      // filter the rows of this band and the halo
+      const int_t intens_begin = std::max(0,y_begin-intens_halo);
+      const int_t intens_end = std::min(h,y_end+intens_halo);
+      for(int_t y=intens_begin;y<intens_end;++y){
+        intensity_t * buf_row = &intens_buf[(y-intens_begin)*w];
+        // the pixels near the edges are not filtered so they keep the original value
+        std::copy(in+y*w,in+(y+1)*w,buf_row);
+        if(filter_rows&&y>=border&&y<h-border)
+          separable_convolution_row(in+(y-r)*w,buf_row,w,coeffs,mask_size,border,&col[0],&row[0]);
+      }
+      // gradients of the filtered rows
+      const int_t grad_begin = std::max(0,y_begin-grad_halo);
+      const int_t grad_end = std::min(h,y_end+grad_halo);
+      for(int_t y=grad_begin;y<grad_end;++y){
+        gather_rows(&intens_buf[0],w,intens_begin,intens_end,y,rows);
+        finite_difference_gradient_row(rows,w,h,y,c1,c2,&gx_buf[(y-grad_begin)*w],&gy_buf[(y-grad_begin)*w]);
+      }
+      // write out the band
+      for(int_t y=y_begin;y<y_end;++y){
+        const intensity_t * buf_row = &intens_buf[(y-intens_begin)*w];
+        std::copy(buf_row,buf_row+w,out+y*w);
+        const scalar_t * gx_row = &gx_buf[(y-grad_begin)*w];
+        const scalar_t * gy_row = &gy_buf[(y-grad_begin)*w];
+        std::copy(gx_row,gx_row+w,gx+y*w);
+        std::copy(gy_row,gy_row+w,gy+y*w);
+        if(smooth&&w>4&&y>=2&&y<h-2){
+          separable_convolution_row(gx_row-2*w,gx+y*w,w,smooth_gradient_coeffs,5,2,&col[0],&row[0]);
+          separable_convolution_row(gy_row-2*w,gy+y*w,w,smooth_gradient_coeffs,5,2,&col[0],&row[0]);
+        }
+      }
+    }
+  }
+}
+
+Image::~Image(){}
 
 Image::Image(const char * file_name,
   const Teuchos::RCP<Teuchos::ParameterList> & params):
@@ -68,7 +627,13 @@ Image::Image(const char * file_name,
   has_gauss_filter_(false),
   file_name_(file_name),
   has_file_name_(true),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   bool filter_failed = false;
   bool convert_to_8_bit = true;
@@ -77,10 +642,13 @@ Image::Image(const char * file_name,
     convert_to_8_bit = params->get<bool>(DICe::convert_cine_to_8_bit,true);
   }
   try{
+    Scoped_Profile_Timer load_timer(PROFILE_IMAGE_LOAD);
+    Scoped_Trace_Span span("image_read","io");
     utils::read_image_dimensions(file_name,width_,height_);
     TEUCHOS_TEST_FOR_EXCEPTION(width_<=0,std::runtime_error,"");
     TEUCHOS_TEST_FOR_EXCEPTION(height_<=0,std::runtime_error,"");
-    intensities_ = Teuchos::ArrayRCP<intensity_t>(width_*height_,0.0);
+    // every pixel is read from the file so the recycled array is not cleared
+    intensities_ = Image_Buffer_Pool::allocate<intensity_t>(width_*height_);
     utils::read_image(file_name,intensities_.getRawPtr(),true,convert_to_8_bit,filter_failed);
   }
   catch(std::exception & e){
@@ -105,7 +673,13 @@ Image::Image(const char * file_name,
   has_gauss_filter_(false),
   file_name_(file_name),
   has_file_name_(true),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   bool filter_failed = false;
   bool convert_to_8_bit = true;
@@ -117,11 +691,13 @@ Image::Image(const char * file_name,
   int_t img_width = 0;
   int_t img_height = 0;
   try{
+    Scoped_Profile_Timer load_timer(PROFILE_IMAGE_LOAD);
+    Scoped_Trace_Span span("image_read","io");
     utils::read_image_dimensions(file_name,img_width,img_height);
     TEUCHOS_TEST_FOR_EXCEPTION(width_<=0||offset_x_+width_>img_width,std::runtime_error,"");
     TEUCHOS_TEST_FOR_EXCEPTION(height_<=0||offset_y_+height_>img_height,std::runtime_error,"");
-    // initialize the pixel containers
-    intensities_ = Teuchos::ArrayRCP<intensity_t>(height_*width_,0.0);
+    // initialize the pixel containers (every pixel is read from the file)
+    intensities_ = Image_Buffer_Pool::allocate<intensity_t>(height_*width_);
     // read in the image
     utils::read_image(file_name,
       offset_x,offset_y,
@@ -148,7 +724,13 @@ Image::Image(const int_t width,
   has_gauss_filter_(false),
   file_name_("(from array)"),
   has_file_name_(false),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(false),
+  quantized_weights_(false),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   assert(height_>0);
   assert(width_>0);
@@ -171,7 +753,13 @@ Image::Image(Teuchos::RCP<Image> img,
   has_gauss_filter_(img->has_gauss_filter()),
   file_name_(img->file_name()),
   has_file_name_(img->has_file_name()),
-  gradient_method_(FINITE_DIFFERENCE)
+  gradient_method_(FINITE_DIFFERENCE),
+  num_threads_(1),
+  lazy_gradients_(false),
+  analytic_gradients_(img->analytic_gradients()),
+  quantized_weights_(img->quantized_interpolation_weights()),
+  num_pending_gradient_tiles_(0),
+  memory_(MEMORY_IMAGES)
 {
   TEUCHOS_TEST_FOR_EXCEPTION(offset_x_<0,std::invalid_argument,"Error, offset_x_ cannot be negative.");
   TEUCHOS_TEST_FOR_EXCEPTION(offset_y_<0,std::invalid_argument,"Error, offset_x_ cannot be negative.");
@@ -183,13 +771,18 @@ Image::Image(Teuchos::RCP<Image> img,
   assert(height_>0);
   const int_t src_width = img->width();
   const int_t src_height = img->height();
+  // the gradients of the copied region have to be computed if they were deferred
+  img->compute_gradient_tiles(offset_x_,offset_y_,offset_x_+width_-1,offset_y_+height_-1);
 
   // initialize the pixel containers
   intensities_ = Teuchos::ArrayRCP<intensity_t>(height_*width_,0.0);
-  intensities_temp_ = Teuchos::ArrayRCP<intensity_t>(height_*width_,0.0);
-  grad_x_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
-  grad_y_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
+  if(!analytic_gradients_){
+    grad_x_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
+    grad_y_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
+  }
   mask_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
+  // only stored gradients are copied
+  const bool copy_grads = has_gradients_&&!analytic_gradients_;
   // deep copy values over
   int_t src_y=0, src_x=0;
   for(int_t y=0;y<height_;++y){
@@ -198,23 +791,28 @@ Image::Image(Teuchos::RCP<Image> img,
       src_x = x + offset_x_;
       if(src_x>=0&&src_x<src_width&&src_y>=0&&src_y<src_height){
         intensities_[y*width_+x] = (*img)(src_x,src_y);
-        grad_x_[y*width_+x] = img->grad_x(src_x,src_y);
-        grad_y_[y*width_+x] = img->grad_y(src_x,src_y);
+        if(copy_grads){
+          grad_x_[y*width_+x] = img->grad_x(src_x,src_y);
+          grad_y_[y*width_+x] = img->grad_y(src_x,src_y);
+        }
         mask_[y*width_+x] = img->mask(src_x,src_y);
       }
       else{
         intensities_[y*width_+x] = 0.0;
-        grad_x_[y*width_+x] = 0.0;
-        grad_y_[y*width_+x] = 0.0;
         mask_[y*width_+x] = 1.0;
       }
     }
   }
   grad_c1_ = 1.0/12.0;
   grad_c2_ = -8.0/12.0;
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
   gauss_filter_mask_size_ = img->gauss_filter_mask_size();
   gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
+  num_threads_ = img->num_threads();
   if(params!=Teuchos::null){
+    if(params->isParameter(DICe::num_threads))
+      set_num_threads(params->get<int_t>(DICe::num_threads));
     if(params->isParameter(DICe::gauss_filter_mask_size)){
       gauss_filter_mask_size_ = params->get<int>(DICe::gauss_filter_mask_size,7);
       gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
@@ -237,6 +835,7 @@ Image::Image(Teuchos::RCP<Image> img,
       }
     }
   }
+  update_memory_usage();
 }
 
 void
@@ -248,10 +847,15 @@ Image::initialize_array_image(intensity_t * intensities){
 
 void
 Image::default_constructor_tasks(const Teuchos::RCP<Teuchos::ParameterList> & params){
-  grad_x_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
-  grad_y_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
-  intensities_temp_ = Teuchos::ArrayRCP<intensity_t>(height_*width_,0.0);
-  mask_ = Teuchos::ArrayRCP<scalar_t>(height_*width_,0.0);
+  if(params!=Teuchos::null){
+    set_analytic_gradients(params->get<bool>(DICe::analytic_def_gradients,analytic_gradients_));
+    set_quantized_interpolation_weights(params->get<bool>(DICe::quantized_interpolation_weights,quantized_weights_));
+  }
+  // images with analytic gradients never store them
+  // the frame sized arrays are recycled from the images of previous frames
+  grad_x_ = analytic_gradients_ ? Teuchos::ArrayRCP<scalar_t>() : Image_Buffer_Pool::allocate<scalar_t>(height_*width_,0.0);
+  grad_y_ = analytic_gradients_ ? Teuchos::ArrayRCP<scalar_t>() : Image_Buffer_Pool::allocate<scalar_t>(height_*width_,0.0);
+  mask_ = Image_Buffer_Pool::allocate<scalar_t>(height_*width_,0.0);
   if(params!=Teuchos::null){
     if(params->isParameter(DICe::compute_laplacian_image)){
       if(params->get<bool>(DICe::compute_laplacian_image)==true){
@@ -262,7 +866,19 @@ Image::default_constructor_tasks(const Teuchos::RCP<Teuchos::ParameterList> & pa
   // image gradient coefficients
   grad_c1_ = 1.0/12.0;
   grad_c2_ = -8.0/12.0;
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
   post_allocation_tasks(params);
+  update_memory_usage();
+}
+
+void
+Image::update_memory_usage(){
+  // arrays that wrap user memory are not counted
+  long long bytes = intensities_.has_ownership() ? intensities_.size()*sizeof(intensity_t) : 0;
+  bytes += (mask_.size() + grad_x_.size() + grad_y_.size() + laplacian_.size() + bspline_coeffs_.size())*sizeof(scalar_t);
+  bytes += tiled_values_.size()*sizeof(scalar_t);
+  memory_.set(bytes);
 }
 
 const intensity_t&
@@ -532,14 +1148,14 @@ Image::interpolate_grad_y_bicubic(const scalar_t & local_x, const scalar_t & loc
 
 intensity_t
 Image::interpolate_keys_fourth(const scalar_t & local_x, const scalar_t & local_y){
-  static std::vector<scalar_t> coeffs_x(6,0.0);
-  static std::vector<scalar_t> coeffs_y(6,0.0);
-  static scalar_t dx = 0.0;
-  static scalar_t dy = 0.0;
-  static int_t ix=0,iy=0;
-  static intensity_t value=0.0;
-  ix = (int_t)local_x;
-  iy = (int_t)local_y;
+  // scratch values are kept local (not static) so that multiple threads can interpolate the same image
+  scalar_t coeffs_x[6];
+  scalar_t coeffs_y[6];
+  scalar_t dx = 0.0;
+  scalar_t dy = 0.0;
+  intensity_t value=0.0;
+  const int_t ix = (int_t)local_x;
+  const int_t iy = (int_t)local_y;
   if(local_x<=2.5||local_x>=width_-3.5||local_y<=2.5||local_y>=height_-3.5)
     return this->interpolate_bilinear(local_x,local_y);
   dx = local_x - ix;
@@ -567,14 +1183,14 @@ Image::interpolate_keys_fourth(const scalar_t & local_x, const scalar_t & local_
 
 scalar_t
 Image::interpolate_grad_x_keys_fourth(const scalar_t & local_x, const scalar_t & local_y){
-  static std::vector<scalar_t> coeffs_x(6,0.0);
-  static std::vector<scalar_t> coeffs_y(6,0.0);
-  static scalar_t dx = 0.0;
-  static scalar_t dy = 0.0;
-  static int_t ix=0,iy=0;
-  static intensity_t value=0.0;
-  ix = (int_t)local_x;
-  iy = (int_t)local_y;
+  // scratch values are kept local (not static) so that multiple threads can interpolate the same image
+  scalar_t coeffs_x[6];
+  scalar_t coeffs_y[6];
+  scalar_t dx = 0.0;
+  scalar_t dy = 0.0;
+  intensity_t value=0.0;
+  const int_t ix = (int_t)local_x;
+  const int_t iy = (int_t)local_y;
   if(local_x<=2.5||local_x>=width_-3.5||local_y<=2.5||local_y>=height_-3.5)
     return this->interpolate_grad_x_bilinear(local_x,local_y);
   dx = local_x - ix;
@@ -602,14 +1218,14 @@ Image::interpolate_grad_x_keys_fourth(const scalar_t & local_x, const scalar_t &
 
 scalar_t
 Image::interpolate_grad_y_keys_fourth(const scalar_t & local_x, const scalar_t & local_y){
-  static std::vector<scalar_t> coeffs_x(6,0.0);
-  static std::vector<scalar_t> coeffs_y(6,0.0);
-  static scalar_t dx = 0.0;
-  static scalar_t dy = 0.0;
-  static int_t ix=0,iy=0;
-  static intensity_t value=0.0;
-  ix = (int_t)local_x;
-  iy = (int_t)local_y;
+  // scratch values are kept local (not static) so that multiple threads can interpolate the same image
+  scalar_t coeffs_x[6];
+  scalar_t coeffs_y[6];
+  scalar_t dx = 0.0;
+  scalar_t dy = 0.0;
+  intensity_t value=0.0;
+  const int_t ix = (int_t)local_x;
+  const int_t iy = (int_t)local_y;
   if(local_x<=2.5||local_x>=width_-3.5||local_y<=2.5||local_y>=height_-3.5)
     return this->interpolate_grad_y_bilinear(local_x,local_y);
   dx = local_x - ix;
@@ -635,8 +1251,424 @@ Image::interpolate_grad_y_keys_fourth(const scalar_t & local_x, const scalar_t &
   return value;
 }
 
+void
+Image::batch_interpolate(const int_t num_points,
+  const scalar_t * local_x,
+  const scalar_t * local_y,
+  intensity_t * intensities,
+  scalar_t * grad_x,
+  scalar_t * grad_y,
+  const Interpolation_Method interp){
+  TEUCHOS_TEST_FOR_EXCEPTION(local_x==NULL||local_y==NULL||intensities==NULL,std::invalid_argument,
+    "Error, null coordinate or intensity array passed to batch_interpolate");
+  const bool do_grads = (has_gradients_||analytic_gradients_)&&grad_x!=NULL&&grad_y!=NULL;
+  // analytic gradients are the derivatives of the interpolant, taken from the intensity stencil
+  const bool analytic = do_grads&&analytic_gradients_;
+  const intensity_t * f = intensities_.getRawPtr();
+  const scalar_t * gx = do_grads&&!analytic ? grad_x_.getRawPtr() : NULL;
+  const scalar_t * gy = do_grads&&!analytic ? grad_y_.getRawPtr() : NULL;
+  if(interp==BILINEAR){
+    for(int_t i=0;i<num_points;++i){
+      const scalar_t & lx = local_x[i];
+      const scalar_t & ly = local_y[i];
+      if(lx<0.0||lx>=width_-1.5||ly<0.0||ly>=height_-1.5){
+        intensities[i] = 0.0;
+        if(do_grads){
+          grad_x[i] = 0.0;
+          grad_y[i] = 0.0;
+        }
+        continue;
+      }
+      const int_t x1 = (int_t)lx;
+      const int_t y1 = (int_t)ly;
+      const scalar_t dx = lx - x1;
+      const scalar_t dy = ly - y1;
+      const scalar_t w11 = (1.0-dx)*(1.0-dy);
+      const scalar_t w21 = dx*(1.0-dy);
+      const scalar_t w22 = dx*dy;
+      const scalar_t w12 = (1.0-dx)*dy;
+      const int_t i11 = y1*width_+x1;
+      const int_t i12 = i11+width_;
+      intensities[i] = f[i11]*w11 + f[i11+1]*w21 + f[i12+1]*w22 + f[i12]*w12;
+      if(analytic){
+        grad_x[i] = (f[i11+1]-f[i11])*(1.0-dy) + (f[i12+1]-f[i12])*dy;
+        grad_y[i] = (f[i12]-f[i11])*(1.0-dx) + (f[i12+1]-f[i11+1])*dx;
+      }
+      else if(do_grads){
+        grad_x[i] = gx[i11]*w11 + gx[i11+1]*w21 + gx[i12+1]*w22 + gx[i12]*w12;
+        grad_y[i] = gy[i11]*w11 + gy[i11+1]*w21 + gy[i12+1]*w22 + gy[i12]*w12;
+      }
+    }
+  }
+  else if(interp==BICUBIC){
+    scalar_t wx_values[4];
+    scalar_t wy_values[4];
+    scalar_t dwx_values[4];
+    scalar_t dwy_values[4];
+    const Interpolation_Weight_Tables * tables = quantized_weights_ ? &interpolation_weight_tables() : NULL;
+    for(int_t i=0;i<num_points;++i){
+      const scalar_t & lx = local_x[i];
+      const scalar_t & ly = local_y[i];
+      if(lx<1.0||lx>=width_-2.0||ly<1.0||ly>=height_-2.0){
+        intensities[i] = interpolate_bilinear(lx,ly);
+        if(analytic)
+          bilinear_gradients(f,width_,height_,lx,ly,grad_x[i],grad_y[i]);
+        else if(do_grads){
+          grad_x[i] = interpolate_grad_x_bilinear(lx,ly);
+          grad_y[i] = interpolate_grad_y_bilinear(lx,ly);
+        }
+        continue;
+      }
+      const int_t x0 = (int_t)lx;
+      const int_t y0 = (int_t)ly;
+      const scalar_t * wx = wx_values;
+      const scalar_t * wy = wy_values;
+      const scalar_t * dwx = dwx_values;
+      const scalar_t * dwy = dwy_values;
+      if(tables){
+        const int_t row_x = interpolation_table_row(lx - x0)*4;
+        const int_t row_y = interpolation_table_row(ly - y0)*4;
+        wx = tables->bicubic + row_x;
+        wy = tables->bicubic + row_y;
+        dwx = tables->bicubic_derivatives + row_x;
+        dwy = tables->bicubic_derivatives + row_y;
+      }
+      else{
+        bicubic_weights(lx - x0,wx_values);
+        bicubic_weights(ly - y0,wy_values);
+        if(analytic){
+          bicubic_weight_derivatives(lx - x0,dwx_values);
+          bicubic_weight_derivatives(ly - y0,dwy_values);
+        }
+      }
+      intensity_t value = 0.0;
+      scalar_t value_gx = 0.0;
+      scalar_t value_gy = 0.0;
+      for(int_t m=0;m<4;++m){
+        const int_t row = (y0-1+m)*width_ + x0-1;
+        for(int_t n=0;n<4;++n){
+          const scalar_t w = wy[m]*wx[n];
+          value += w*f[row+n];
+          if(analytic){
+            value_gx += wy[m]*dwx[n]*f[row+n];
+            value_gy += dwy[m]*wx[n]*f[row+n];
+          }
+          else if(do_grads){
+            value_gx += w*gx[row+n];
+            value_gy += w*gy[row+n];
+          }
+        }
+      }
+      intensities[i] = value;
+      if(do_grads){
+        grad_x[i] = value_gx;
+        grad_y[i] = value_gy;
+      }
+    }
+  }
+  else if(interp==KEYS_FOURTH){
+    scalar_t coeffs_x_values[6];
+    scalar_t coeffs_y_values[6];
+    scalar_t dcoeffs_x_values[6];
+    scalar_t dcoeffs_y_values[6];
+    const Interpolation_Weight_Tables * tables = quantized_weights_ ? &interpolation_weight_tables() : NULL;
+    // read the stencils from the tiles if they are current (and hold the gradients if they are needed),
+    // the tile values are interleaved so the intensity and gradients of a pixel are next to each other
+    const bool use_tiles = has_tiled_layout_&&(!do_grads||analytic||tile_components_==3);
+    const int_t comp = use_tiles ? tile_components_ : 1;
+    const scalar_t * kf = use_tiles ? tiled_values_.getRawPtr() : f;
+    const scalar_t * kgx = use_tiles ? tiled_values_.getRawPtr() + 1 : gx;
+    const scalar_t * kgy = use_tiles ? tiled_values_.getRawPtr() + 2 : gy;
+    for(int_t i=0;i<num_points;++i){
+      const scalar_t & lx = local_x[i];
+      const scalar_t & ly = local_y[i];
+      if(lx<=2.5||lx>=width_-3.5||ly<=2.5||ly>=height_-3.5){
+        intensities[i] = interpolate_bilinear(lx,ly);
+        if(analytic)
+          bilinear_gradients(f,width_,height_,lx,ly,grad_x[i],grad_y[i]);
+        else if(do_grads){
+          grad_x[i] = interpolate_grad_x_bilinear(lx,ly);
+          grad_y[i] = interpolate_grad_y_bilinear(lx,ly);
+        }
+        continue;
+      }
+      const int_t ix = (int_t)lx;
+      const int_t iy = (int_t)ly;
+      const scalar_t dx = lx - ix;
+      const scalar_t dy = ly - iy;
+      const scalar_t * coeffs_x = coeffs_x_values;
+      const scalar_t * coeffs_y = coeffs_y_values;
+      const scalar_t * dcoeffs_x = dcoeffs_x_values;
+      const scalar_t * dcoeffs_y = dcoeffs_y_values;
+      if(tables){
+        const int_t row_x = interpolation_table_row(dx)*6;
+        const int_t row_y = interpolation_table_row(dy)*6;
+        coeffs_x = tables->keys + row_x;
+        coeffs_y = tables->keys + row_y;
+        dcoeffs_x = tables->keys_derivatives + row_x;
+        dcoeffs_y = tables->keys_derivatives + row_y;
+      }
+      else{
+        coeffs_x_values[0] = keys_f2(dx+2.0);
+        coeffs_x_values[1] = keys_f1(dx+1.0);
+        coeffs_x_values[2] = keys_f0(dx);
+        coeffs_x_values[3] = keys_f0(1.0-dx);
+        coeffs_x_values[4] = keys_f1(2.0-dx);
+        coeffs_x_values[5] = keys_f2(3.0-dx);
+        coeffs_y_values[0] = keys_f2(dy+2.0);
+        coeffs_y_values[1] = keys_f1(dy+1.0);
+        coeffs_y_values[2] = keys_f0(dy);
+        coeffs_y_values[3] = keys_f0(1.0-dy);
+        coeffs_y_values[4] = keys_f1(2.0-dy);
+        coeffs_y_values[5] = keys_f2(3.0-dy);
+        if(analytic){
+          // the kernel arguments that decrease with the offset flip the sign of the derivative
+          dcoeffs_x_values[0] = keys_df2(dx+2.0);
+          dcoeffs_x_values[1] = keys_df1(dx+1.0);
+          dcoeffs_x_values[2] = keys_df0(dx);
+          dcoeffs_x_values[3] = -keys_df0(1.0-dx);
+          dcoeffs_x_values[4] = -keys_df1(2.0-dx);
+          dcoeffs_x_values[5] = -keys_df2(3.0-dx);
+          dcoeffs_y_values[0] = keys_df2(dy+2.0);
+          dcoeffs_y_values[1] = keys_df1(dy+1.0);
+          dcoeffs_y_values[2] = keys_df0(dy);
+          dcoeffs_y_values[3] = -keys_df0(1.0-dy);
+          dcoeffs_y_values[4] = -keys_df1(2.0-dy);
+          dcoeffs_y_values[5] = -keys_df2(3.0-dy);
+        }
+      }
+      // same accumulation order as the single point methods so the results are identical
+      intensity_t value = 0.0;
+      scalar_t value_gx = 0.0;
+      scalar_t value_gy = 0.0;
+      // the first value of the stencil and the distance between its rows
+      int_t first = (iy-2)*width_ + ix-2;
+      int_t row_stride = width_;
+      if(use_tiles){
+        const int_t tx = ix/image_tile_size;
+        const int_t ty = iy/image_tile_size;
+        first = (ty*num_tiles_x_+tx)*image_tile_stride*image_tile_stride
+            + (iy-ty*image_tile_size+image_tile_apron-2)*image_tile_stride + ix-tx*image_tile_size+image_tile_apron-2;
+        row_stride = image_tile_stride;
+      }
+      for(int_t m=0;m<6;++m){
+        const int_t row = first + m*row_stride;
+        for(int_t n=0;n<6;++n){
+          const scalar_t w = coeffs_y[m]*coeffs_x[n];
+          const int_t index = (row+n)*comp;
+          value += w*kf[index];
+          if(analytic){
+            value_gx += coeffs_y[m]*dcoeffs_x[n]*kf[index];
+            value_gy += dcoeffs_y[m]*coeffs_x[n]*kf[index];
+          }
+          else if(do_grads){
+            value_gx += w*kgx[index];
+            value_gy += w*kgy[index];
+          }
+        }
+      }
+      intensities[i] = value;
+      if(do_grads){
+        grad_x[i] = value_gx;
+        grad_y[i] = value_gy;
+      }
+    }
+  }
+  else if(interp==CUBIC_BSPLINE||interp==QUINTIC_BSPLINE){
+    const int_t degree = interp==CUBIC_BSPLINE ? 3 : 5;
+    if(bspline_degree_!=degree)
+      compute_bspline_coefficients(degree);
+    const scalar_t * c = bspline_coeffs_.getRawPtr();
+    // the stencil runs from ix-half to ix+support-half-1
+    const int_t support = degree+1;
+    const int_t half = (support-1)/2;
+    scalar_t wx[6],wy[6],dwx[6],dwy[6];
+    for(int_t i=0;i<num_points;++i){
+      const scalar_t & lx = local_x[i];
+      const scalar_t & ly = local_y[i];
+      if(lx<half||lx>=width_-support+half+1||ly<half||ly>=height_-support+half+1){
+        intensities[i] = interpolate_bilinear(lx,ly);
+        if(analytic)
+          bilinear_gradients(f,width_,height_,lx,ly,grad_x[i],grad_y[i]);
+        else if(do_grads){
+          grad_x[i] = interpolate_grad_x_bilinear(lx,ly);
+          grad_y[i] = interpolate_grad_y_bilinear(lx,ly);
+        }
+        continue;
+      }
+      const int_t ix = (int_t)lx;
+      const int_t iy = (int_t)ly;
+      bspline_weights(degree,lx-ix,wx,dwx);
+      bspline_weights(degree,ly-iy,wy,dwy);
+      intensity_t value = 0.0;
+      scalar_t value_gx = 0.0;
+      scalar_t value_gy = 0.0;
+      for(int_t m=0;m<support;++m){
+        const scalar_t * row = c + (iy-half+m)*width_ + ix-half;
+        scalar_t row_value = 0.0;
+        scalar_t row_dx = 0.0;
+        for(int_t n=0;n<support;++n){
+          row_value += wx[n]*row[n];
+          row_dx += dwx[n]*row[n];
+        }
+        value += wy[m]*row_value;
+        value_gx += wy[m]*row_dx;
+        value_gy += dwy[m]*row_value;
+      }
+      intensities[i] = value;
+      // the gradients are the derivatives of the spline rather than interpolated gradient images
+      if(do_grads){
+        grad_x[i] = value_gx;
+        grad_y[i] = value_gy;
+      }
+    }
+  }
+  else{
+    TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,
+      "Error, unknown interpolation method requested");
+  }
+}
+
+void
+Image::compute_tiled_layout(const int_t num_threads){
+  if(has_tiled_layout_) return;
+  DEBUG_MSG("Image::compute_tiled_layout(): tile size " << image_tile_size);
+  num_tiles_x_ = (width_ + image_tile_size - 1)/image_tile_size;
+  const int_t num_tiles_y = (height_ + image_tile_size - 1)/image_tile_size;
+  const int_t tile_values = image_tile_stride*image_tile_stride;
+  const bool copy_grads = has_gradients_&&grad_x_.size()==width_*height_;
+  // every tile holds gradients so any that were deferred are needed now
+  if(copy_grads) compute_gradient_tiles();
+  // each pixel holds {intensity, grad_x, grad_y} or just the intensity if there are no gradients
+  tile_components_ = copy_grads ? 3 : 1;
+  const int_t num_values = num_tiles_x_*num_tiles_y*tile_values*tile_components_;
+  if((int_t)tiled_values_.size()!=num_values){
+    tiled_values_ = Teuchos::ArrayRCP<scalar_t>(num_values,0.0);
+    update_memory_usage();
+  }
+  // each tile is independent so the tiles are split among the threads
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) if(num_threads>1) schedule(static)
+#endif
+  for(int_t tile=0;tile<num_tiles_x_*num_tiles_y;++tile){
+    const int_t x0 = (tile%num_tiles_x_)*image_tile_size - image_tile_apron;
+    const int_t y0 = (tile/num_tiles_x_)*image_tile_size - image_tile_apron;
+    scalar_t * tv = tiled_values_.getRawPtr() + tile*tile_values*tile_components_;
+    for(int_t j=0;j<image_tile_stride;++j){
+      const int_t y = y0 + j;
+      for(int_t i=0;i<image_tile_stride;++i){
+        const int_t x = x0 + i;
+        // values outside the image are never read (points near the edges fall back to bilinear)
+        const bool inside = x>=0&&x<width_&&y>=0&&y<height_;
+        scalar_t * v = tv + (j*image_tile_stride+i)*tile_components_;
+        v[0] = inside ? intensities_[y*width_+x] : 0.0;
+        if(copy_grads){
+          v[1] = inside ? grad_x_[y*width_+x] : 0.0;
+          v[2] = inside ? grad_y_[y*width_+x] : 0.0;
+        }
+      }
+    }
+  }
+  has_tiled_layout_ = true;
+}
+
+void
+Image::compute_bspline_coefficients(const int_t degree,
+  const int_t num_threads){
+  TEUCHOS_TEST_FOR_EXCEPTION(degree!=3&&degree!=5,std::invalid_argument,
+    "Error, only cubic (3) and quintic (5) B-spline coefficients are supported");
+  if(bspline_degree_==degree) return;
+  DEBUG_MSG("Image::compute_bspline_coefficients(): degree " << degree);
+  double poles[2];
+  int_t num_poles = 1;
+  if(degree==3){
+    poles[0] = std::sqrt(3.0) - 2.0;
+  }
+  else{
+    num_poles = 2;
+    poles[0] = -0.430575347099973791851434783493520;
+    poles[1] = -0.043096288203264653822712376822550;
+  }
+  if((int_t)bspline_coeffs_.size()!=width_*height_){
+    bspline_coeffs_ = Teuchos::ArrayRCP<scalar_t>(width_*height_,0.0);
+    update_memory_usage();
+  }
+  scalar_t * c = bspline_coeffs_.getRawPtr();
+  const intensity_t * f = intensities_.getRawPtr();
+  const int_t w = width_;
+  const int_t h = height_;
+  // the rows and columns are independent so each pass is split among the threads
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads) if(num_threads>1)
+#endif
+  {
+    std::vector<double> line(std::max(w,h));
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t y=0;y<h;++y){
+      for(int_t x=0;x<w;++x)
+        line[x] = f[y*w+x];
+      bspline_prefilter_line(&line[0],w,poles,num_poles);
+      for(int_t x=0;x<w;++x)
+        c[y*w+x] = line[x];
+    }
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t x=0;x<w;++x){
+      for(int_t y=0;y<h;++y)
+        line[y] = c[y*w+x];
+      bspline_prefilter_line(&line[0],h,poles,num_poles);
+      for(int_t y=0;y<h;++y)
+        c[y*w+x] = line[y];
+    }
+  }
+  bspline_degree_ = degree;
+}
+
+void
+Image::allocate_gradients(){
+  if(grad_x_.size()==num_pixels()&&grad_y_.size()==num_pixels()) return;
+  grad_x_ = Image_Buffer_Pool::allocate<scalar_t>(num_pixels(),0.0);
+  grad_y_ = Image_Buffer_Pool::allocate<scalar_t>(num_pixels(),0.0);
+  update_memory_usage();
+}
+
 void
 Image::compute_gradients(const bool use_hierarchical_parallelism, const int_t team_size){
+  Scoped_Profile_Timer preprocess_timer(PROFILE_PREPROCESS);
+  if(analytic_gradients_){
+    // batch_interpolate() differentiates the interpolant so there is nothing to compute or store
+    DEBUG_MSG("Image::compute_gradients(): the gradients are taken from the interpolant, releasing the gradient arrays");
+    {
+      std::lock_guard<std::mutex> lock(gradient_tile_mutex);
+      gradient_tiles_.clear();
+      num_pending_gradient_tiles_ = 0;
+    }
+    grad_x_ = Teuchos::ArrayRCP<scalar_t>();
+    grad_y_ = Teuchos::ArrayRCP<scalar_t>();
+    has_gradients_ = false;
+    has_tiled_layout_ = false;
+    update_memory_usage();
+    return;
+  }
+  allocate_gradients();
+  {
+    std::lock_guard<std::mutex> lock(gradient_tile_mutex);
+    if(lazy_gradients_){
+      // only the bookkeeping is reset here, each tile is computed the first time it is requested
+      const int_t num_tiles = ((width_+gradient_tile_size-1)/gradient_tile_size)*((height_+gradient_tile_size-1)/gradient_tile_size);
+      DEBUG_MSG("Image::compute_gradients(): deferring the gradients of " << num_tiles << " tiles");
+      gradient_tiles_.assign(num_tiles,0);
+      num_pending_gradient_tiles_ = num_tiles;
+      has_gradients_ = true;
+      has_tiled_layout_ = false;
+      return;
+    }
+    gradient_tiles_.clear();
+    num_pending_gradient_tiles_ = 0;
+  }
   if(gradient_method_==FINITE_DIFFERENCE){
     DEBUG_MSG("Image::compute_gradients(): using FINITE_DIFFERENCE");
     compute_gradients_finite_difference();
@@ -647,81 +1679,265 @@ Image::compute_gradients(const bool use_hierarchical_parallelism, const int_t te
     smooth_gradients_convolution_5_point();
   }
   has_gradients_ = true;
+  // the tiles hold copies of the gradients
+  has_tiled_layout_ = false;
 }
 
 void
-Image::smooth_gradients_convolution_5_point(){
+Image::compute_gradient_tiles(const int_t min_x,
+  const int_t min_y,
+  const int_t max_x,
+  const int_t max_y){
+  std::lock_guard<std::mutex> lock(gradient_tile_mutex);
+  if(num_pending_gradient_tiles_==0) return;
+  const int_t num_tiles_x = (width_+gradient_tile_size-1)/gradient_tile_size;
+  const int_t tile_x_begin = std::max(0,min_x)/gradient_tile_size;
+  const int_t tile_x_end = std::min(width_-1,max_x)/gradient_tile_size + 1;
+  const int_t tile_y_begin = std::max(0,min_y)/gradient_tile_size;
+  const int_t tile_y_end = std::min(height_-1,max_y)/gradient_tile_size + 1;
+  std::vector<int_t> tiles;
+  for(int_t ty=tile_y_begin;ty<tile_y_end;++ty){
+    for(int_t tx=tile_x_begin;tx<tile_x_end;++tx){
+      if(!gradient_tiles_[ty*num_tiles_x+tx])
+        tiles.push_back(ty*num_tiles_x+tx);
+    }
+  }
+  if(tiles.empty()) return;
+  DEBUG_MSG("Image::compute_gradient_tiles(): computing " << tiles.size() << " of " << num_pending_gradient_tiles_ << " pending tiles");
+  Scoped_Profile_Timer preprocess_timer(PROFILE_PREPROCESS);
+  const intensity_t * f = intensities_.getRawPtr();
+  scalar_t * gx = grad_x_.getRawPtr();
+  scalar_t * gy = grad_y_.getRawPtr();
+  const int_t w = width_;
+  const int_t h = height_;
+  const scalar_t c1 = grad_c1_;
+  const scalar_t c2 = grad_c2_;
+  const bool smooth = gradient_method_==CONVOLUTION_5_POINT;
+  const int_t num_tiles = tiles.size();
+  // the tiles write to separate pixels so they are split among the threads
+  const int_t num_threads = num_tiles > 1 ? num_threads_ : 1;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) if(num_threads>1) schedule(dynamic)
+#endif
+  for(int_t i=0;i<num_tiles;++i){
+    const int_t x_begin = (tiles[i]%num_tiles_x)*gradient_tile_size;
+    const int_t y_begin = (tiles[i]/num_tiles_x)*gradient_tile_size;
+    gradient_block(f,w,h,x_begin,std::min(w,x_begin+gradient_tile_size),y_begin,std::min(h,y_begin+gradient_tile_size),
+      c1,c2,smooth,gx,gy);
+  }
+  for(int_t i=0;i<num_tiles;++i)
+    gradient_tiles_[tiles[i]] = 1;
+  num_pending_gradient_tiles_ -= num_tiles;
+}
 
-  static scalar_t smooth_coeffs[][5] = {{0.00390625, 0.015625, 0.0234375, 0.015625, 0.00390625},
-                                        {0.015625,   0.0625,   0.09375,   0.0625,   0.015625},
-                                        {0.0234375,  0.09375,  0.140625,  0.09375,  0.0234375},
-                                        {0.015625,   0.0625,   0.09375,   0.0625,   0.015625},
-                                        {0.00390625, 0.015625, 0.0234375, 0.015625, 0.00390625}};
-  static int_t smooth_offsets[] =  {-2, -1, 0, 1, 2};
+void
+Image::write_preprocessed(const std::string & file_name){
+  // the file holds the gradients of the whole image
+  compute_gradient_tiles();
+  DEBUG_MSG("Image::write_preprocessed(): writing " << file_name);
+  // write to a temporary file first so that a reader never sees a partial file
+  const std::string tmp_name = file_name + ".tmp";
+  std::FILE * filePtr = fopen(tmp_name.c_str(),"wb");
+  TEUCHOS_TEST_FOR_EXCEPTION(filePtr==NULL,std::runtime_error,"Error, could not open preprocessed image file " << tmp_name);
+  const int32_t header[7] = {(int32_t)sizeof(intensity_t),(int32_t)sizeof(scalar_t),width_,height_,
+    has_gauss_filter_ ? gauss_filter_mask_size_ : 0,has_gradients_ ? 1 : 0,(int32_t)gradient_method_};
+  fwrite(preprocessed_image_magic,1,sizeof(preprocessed_image_magic),filePtr);
+  fwrite(header,sizeof(int32_t),7,filePtr);
+  fwrite(intensities_.getRawPtr(),sizeof(intensity_t),num_pixels(),filePtr);
+  if(has_gradients_){
+    fwrite(grad_x_.getRawPtr(),sizeof(scalar_t),num_pixels(),filePtr);
+    fwrite(grad_y_.getRawPtr(),sizeof(scalar_t),num_pixels(),filePtr);
+  }
+  const bool write_error = ferror(filePtr)!=0;
+  fclose(filePtr);
+  TEUCHOS_TEST_FOR_EXCEPTION(write_error,std::runtime_error,"Error, could not write preprocessed image file " << tmp_name);
+  std::remove(file_name.c_str());
+  TEUCHOS_TEST_FOR_EXCEPTION(std::rename(tmp_name.c_str(),file_name.c_str())!=0,std::runtime_error,
+    "Error, could not rename preprocessed image file " << tmp_name << " to " << file_name);
+}
 
+bool
+Image::read_preprocessed(const std::string & file_name){
+  std::FILE * filePtr = fopen(file_name.c_str(),"rb");
+  if(filePtr==NULL){
+    DEBUG_MSG("Image::read_preprocessed(): no file " << file_name);
+    return false;
+  }
+  char magic[sizeof(preprocessed_image_magic)];
+  int32_t header[7] = {0,0,0,0,0,0,0};
+  bool valid = fread(magic,1,sizeof(magic),filePtr)==sizeof(magic) && std::memcmp(magic,preprocessed_image_magic,sizeof(magic))==0;
+  valid = valid && fread(header,sizeof(int32_t),7,filePtr)==7;
+  valid = valid && header[0]==(int32_t)sizeof(intensity_t) && header[1]==(int32_t)sizeof(scalar_t) && header[2]==width_ && header[3]==height_;
+  const int_t num_px = num_pixels();
+  const bool file_has_gradients = header[5]==1;
+  // read everything before the image is touched so a bad file leaves it unchanged
+  std::vector<intensity_t> intensities(valid ? num_px : 0);
+  std::vector<scalar_t> grad_x(valid&&file_has_gradients ? num_px : 0);
+  std::vector<scalar_t> grad_y(grad_x.size());
+  valid = valid && fread(intensities.data(),sizeof(intensity_t),num_px,filePtr)==(size_t)num_px;
+  if(file_has_gradients){
+    valid = valid && fread(grad_x.data(),sizeof(scalar_t),num_px,filePtr)==(size_t)num_px;
+    valid = valid && fread(grad_y.data(),sizeof(scalar_t),num_px,filePtr)==(size_t)num_px;
+  }
+  fclose(filePtr);
+  if(!valid){
+    DEBUG_MSG("Image::read_preprocessed(): " << file_name << " does not match this image");
+    return false;
+  }
+  DEBUG_MSG("Image::read_preprocessed(): restoring the preprocessed pixels from " << file_name);
+  std::copy(intensities.begin(),intensities.end(),intensities_.getRawPtr());
+  if(file_has_gradients){
+    allocate_gradients();
+    std::copy(grad_x.begin(),grad_x.end(),grad_x_.getRawPtr());
+    std::copy(grad_y.begin(),grad_y.end(),grad_y_.getRawPtr());
+  }
+  {
+    std::lock_guard<std::mutex> lock(gradient_tile_mutex);
+    gradient_tiles_.clear();
+    num_pending_gradient_tiles_ = 0;
+  }
+  has_gauss_filter_ = header[4]>0;
+  if(has_gauss_filter_){
+    gauss_filter_mask_size_ = header[4];
+    gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
+  }
+  has_gradients_ = file_has_gradients;
+  gradient_method_ = static_cast<Gradient_Method>(header[6]);
+  // the B-spline coefficients and the tiles are copies of the old pixels
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
+  return true;
+}
+
+void
+Image::share_preprocessed_arrays(Teuchos::ArrayRCP<intensity_t> intensities,
+  Teuchos::ArrayRCP<scalar_t> grad_x,
+  Teuchos::ArrayRCP<scalar_t> grad_y,
+  const int_t gauss_filter_mask_size,
+  const Gradient_Method gradient_method){
+  TEUCHOS_TEST_FOR_EXCEPTION(intensities.size()!=num_pixels(),std::invalid_argument,
+    "Error, the shared intensities do not match the size of the image");
+  TEUCHOS_TEST_FOR_EXCEPTION(grad_x.size()!=grad_y.size()||(grad_x.size()!=0&&grad_x.size()!=num_pixels()),std::invalid_argument,
+    "Error, the shared gradients do not match the size of the image");
+  // the array image members hold the reference, intensities_ only points to the values
+  intensity_rcp_ = intensities;
+  initialize_array_image(intensities.getRawPtr());
+  if(grad_x.size()>0){
+    grad_x_ = grad_x;
+    grad_y_ = grad_y;
+  }
+  {
+    std::lock_guard<std::mutex> lock(gradient_tile_mutex);
+    gradient_tiles_.clear();
+    num_pending_gradient_tiles_ = 0;
+  }
+  has_gauss_filter_ = gauss_filter_mask_size>0;
+  if(has_gauss_filter_){
+    gauss_filter_mask_size_ = gauss_filter_mask_size;
+    gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
+  }
+  has_gradients_ = grad_x.size()>0;
+  gradient_method_ = gradient_method;
+  // the B-spline coefficients and the tiles are copies of the old pixels
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
+  update_memory_usage();
+}
+
+void
+Image::smooth_gradients_convolution_5_point(){
   Teuchos::ArrayRCP<scalar_t> grad_x_temp(width_*height_,0.0);
   Teuchos::ArrayRCP<scalar_t> grad_y_temp(width_*height_,0.0);
   for(int_t i=0;i<width_*height_;++i){
     grad_x_temp[i] = grad_x_[i];
     grad_y_temp[i] = grad_y_[i];
   }
-  for(int_t y=2;y<height_-2;++y){
-    for(int_t x=2;x<width_-2;++x){
-      scalar_t value_x = 0.0, value_y = 0.0;
-      for(int_t i=0;i<5;++i){
-        for(int_t j=0;j<5;++j){
-          value_x += smooth_coeffs[i][j] * grad_x_temp[(y + smooth_offsets[i])*width_ + x + smooth_offsets[j]];
-          value_y += smooth_coeffs[i][j] * grad_y_temp[(y + smooth_offsets[i])*width_ + x + smooth_offsets[j]];
-        }
-      }
-      grad_x_[y*width_+x] = value_x;
-      grad_y_[y*width_+x] = value_y;
+  // the 5 point smoothing kernel is the outer product of the 1d coefficients
+  separable_convolution(grad_x_temp.getRawPtr(),grad_x_.getRawPtr(),width_,height_,smooth_gradient_coeffs,5,2,num_threads_);
+  separable_convolution(grad_y_temp.getRawPtr(),grad_y_.getRawPtr(),width_,height_,smooth_gradient_coeffs,5,2,num_threads_);
+}
+
+void
+Image::compute_gradients_finite_difference(){
+  const int_t w = width_;
+  const int_t h = height_;
+  const intensity_t * f = intensities_.getRawPtr();
+  scalar_t * gx = grad_x_.getRawPtr();
+  scalar_t * gy = grad_y_.getRawPtr();
+  const scalar_t c1 = grad_c1_;
+  const scalar_t c2 = grad_c2_;
+  const int_t num_threads = num_threads_;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads) if(num_threads>1)
+#endif
+  {
+    const intensity_t * rows[5];
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t y=0;y<h;++y){
+      gather_rows(f,w,0,h,y,rows);
+      finite_difference_gradient_row(rows,w,h,y,c1,c2,gx+y*w,gy+y*w);
     }
   }
 }
 
 void
-Image::compute_gradients_finite_difference(){
-  for(int_t y=0;y<height_;++y){
-    for(int_t x=0;x<width_;++x){
-      if(x<2){
-        grad_x_[y*width_+x] = intensities_[y*width_+x+1] - intensities_[y*width_+x];
-      }
-      /// check if this pixel is near the right edge
-      else if(x>=width_-2){
-        grad_x_[y*width_+x] = intensities_[y*width_+x] - intensities_[y*width_+x-1];
-      }
-      else{
-        grad_x_[y*width_+x] = grad_c1_*intensities_[y*width_+x-2] + grad_c2_*intensities_[y*width_+x-1]
-            - grad_c2_*intensities_[y*width_+x+1] - grad_c1_*intensities_[y*width_+x+2];
-      }
-      /// check if this pixel is near the top edge
-      if(y<2){
-        grad_y_[y*width_+x] = intensities_[(y+1)*width_+x] - intensities_[y*width_+x];
-      }
-      /// check if this pixel is near the bottom edge
-      else if(y>=height_-2){
-        grad_y_[y*width_+x] = intensities_[y*width_+x] - intensities_[(y-1)*width_+x];
-      }
-      else{
-        grad_y_[y*width_+x] = grad_c1_*intensities_[(y-2)*width_+x] + grad_c2_*intensities_[(y-1)*width_+x]
-            - grad_c2_*intensities_[(y+1)*width_+x] - grad_c1_*intensities_[(y+2)*width_+x];
-      }
+Image::gauss_filter_and_compute_gradients(const int_t mask_size){
+  Scoped_Profile_Timer preprocess_timer(PROFILE_PREPROCESS);
+  if(mask_size>0){
+    gauss_filter_mask_size_=mask_size;
+    gauss_filter_half_mask_ = gauss_filter_mask_size_/2+1;
+  }
+  DEBUG_MSG("Image::gauss_filter_and_compute_gradients(): mask_size " << gauss_filter_mask_size_);
+  if(lazy_gradients_||analytic_gradients_){
+    // the gradients are deferred (or taken from the interpolant) so only the filter is applied now
+    // (the old pending tiles are replaced anyway)
+    {
+      std::lock_guard<std::mutex> lock(gradient_tile_mutex);
+      num_pending_gradient_tiles_ = 0;
     }
+    gauss_filter(mask_size);
+    compute_gradients();
+    return;
   }
+  std::vector<scalar_t> coeffs(13,0.0);
+  gauss_filter_coefficients(gauss_filter_mask_size_,&coeffs[0]);
+  TEUCHOS_TEST_FOR_EXCEPTION(width_<gauss_filter_mask_size_||height_<gauss_filter_mask_size_,std::runtime_error,
+    "Error, image too small (" << width_ << " x " << height_ << ") for gauss filtering with mask size " << gauss_filter_mask_size_);
+  // copy over the old intensities
+  allocate_gradients();
+  Frame_Arena::Scope arena_scope;
+  intensity_t * intensities_temp = arena_scope.arena().allocate<intensity_t>(num_pixels());
+  for(int_t i=0;i<num_pixels();++i)
+    intensities_temp[i] = intensities_[i];
+  fused_filter_and_gradients(intensities_temp,intensities_.getRawPtr(),grad_x_.getRawPtr(),grad_y_.getRawPtr(),
+    width_,height_,&coeffs[0],gauss_filter_mask_size_,gauss_filter_half_mask_,grad_c1_,grad_c2_,
+    gradient_method_==CONVOLUTION_5_POINT,num_threads_);
+  has_gauss_filter_ = true;
+  has_gradients_ = true;
+  // any B-spline coefficients are out of date now that the intensities have changed
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
 }
 
 void
 Image::apply_mask(const Conformal_Area_Def & area_def,
   const bool smooth_edges){
+  // any deferred gradients are computed from the unmasked intensities
+  compute_gradient_tiles();
   // first create the mask:
   create_mask(area_def,smooth_edges);
   for(int_t i=0;i<num_pixels();++i)
     intensities_[i] = mask_[i]*intensities_[i];
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
 }
 
 void
 Image::apply_mask(const bool smooth_edges){
+  // any deferred gradients are computed from the unmasked intensities
+  compute_gradient_tiles();
   if(smooth_edges){
     static scalar_t smoothing_coeffs[5][5];
     std::vector<scalar_t> coeffs(5,0.0);
@@ -754,33 +1970,29 @@ Image::apply_mask(const bool smooth_edges){
   } // smooth edges
   for(int_t i=0;i<num_pixels();++i)
     intensities_[i] = mask_[i]*intensities_[i];
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
 }
 
 void
 Image::create_mask(const Conformal_Area_Def & area_def,
   const bool smooth_edges){
   assert(area_def.has_boundary());
-  std::set<std::pair<int_t,int_t> > coords;
-  for(size_t i=0;i<area_def.boundary()->size();++i){
-    std::set<std::pair<int_t,int_t> > shapeCoords = (*area_def.boundary())[i]->get_owned_pixels();
-    coords.insert(shapeCoords.begin(),shapeCoords.end());
-  }
+  std::vector<std::pair<int_t,int_t> > coords;
+  reference_pixels(*area_def.boundary(),coords);
   // now remove any excluded regions:
   // now set the inactive bit for the second set of multishapes if they exist.
   if(area_def.has_excluded_area()){
-    for(size_t i=0;i<area_def.excluded_area()->size();++i){
-      std::set<std::pair<int_t,int_t> > removeCoords = (*area_def.excluded_area())[i]->get_owned_pixels();
-      std::set<std::pair<int_t,int_t> >::iterator it = removeCoords.begin();
-      for(;it!=removeCoords.end();++it){
-        if(coords.find(*it)!=coords.end())
-          coords.erase(*it);
-      } // end removeCoords loop
-    } // end excluded_area loop
+    std::vector<std::pair<int_t,int_t> > remove_coords;
+    reference_pixels(*area_def.excluded_area(),remove_coords);
+    std::vector<std::pair<int_t,int_t> > kept_coords;
+    kept_coords.reserve(coords.size());
+    std::set_difference(coords.begin(),coords.end(),remove_coords.begin(),remove_coords.end(),std::back_inserter(kept_coords));
+    coords.swap(kept_coords);
   } // end has excluded area
-  // NOTE: the pairs are (y,x) not (x,y) so that the ordering is correct in the set
-  std::set<std::pair<int_t,int_t> >::iterator set_it = coords.begin();
-  for( ; set_it!=coords.end();++set_it){
-    mask_[(set_it->first - offset_y_)*width_+set_it->second - offset_x_] = 1.0;
+  // NOTE: the pairs are (y,x) not (x,y)
+  for(size_t i=0;i<coords.size();++i){
+    mask_[(coords[i].first - offset_y_)*width_+coords[i].second - offset_x_] = 1.0;
   }
   if(smooth_edges){
     static scalar_t smoothing_coeffs[5][5];
@@ -821,13 +2033,19 @@ Image::apply_transformation(Teuchos::RCP<Local_Shape_Function> shape_function,
   const bool apply_in_place){
   Teuchos::RCP<Image> this_img = Teuchos::rcp(this,false);
   if(apply_in_place){
-    Teuchos::RCP<Image> temp_img = Teuchos::rcp(new Image(this_img));
-    apply_transform(temp_img,this_img,cx,cy,shape_function);
+    // any deferred gradients are computed from the original intensities
+    compute_gradient_tiles();
+    // the transformed values can't overwrite the intensities while they are being interpolated
+    Frame_Arena::Scope arena_scope;
+    intensity_t * transformed = arena_scope.arena().allocate<intensity_t>(num_pixels());
+    apply_transform(this_img,transformed,cx,cy,shape_function,num_threads_);
+    for(int_t i=0;i<num_pixels();++i)
+      intensities_[i] = transformed[i];
     return Teuchos::null;
   }
   else{
     Teuchos::RCP<Image> result = Teuchos::rcp(new Image(width_,height_));
-    apply_transform(this_img,result,cx,cy,shape_function);
+    apply_transform(this_img,result,cx,cy,shape_function,num_threads_);
     return result;
   }
 }
@@ -835,6 +2053,7 @@ Image::apply_transformation(Teuchos::RCP<Local_Shape_Function> shape_function,
 void
 Image::gauss_filter(const int_t mask_size,const bool use_hierarchical_parallelism,
   const int_t team_size){
+  Scoped_Profile_Timer preprocess_timer(PROFILE_PREPROCESS);
   DEBUG_MSG("Image::gauss_filter: mask_size " << gauss_filter_mask_size_);
 
   if(mask_size>0){
@@ -843,66 +2062,26 @@ Image::gauss_filter(const int_t mask_size,const bool use_hierarchical_parallelis
   }
 
   std::vector<scalar_t> coeffs(13,0.0);
-
-  // make sure the mask size is appropriate
-  if(gauss_filter_mask_size_==5){
-    coeffs[0] = 0.0014;coeffs[1] = 0.1574;coeffs[2] = 0.62825;
-    coeffs[3] = 0.1574;coeffs[4] = 0.0014;
-  }
-  else if (gauss_filter_mask_size_==7){
-    coeffs[0] = 0.0060;coeffs[1] = 0.0606;coeffs[2] = 0.2418;
-    coeffs[3] = 0.3831;coeffs[4] = 0.2418;coeffs[5] = 0.0606;
-    coeffs[6] = 0.0060;
-  }
-  else if (gauss_filter_mask_size_==9){
-    coeffs[0] = 0.0007;coeffs[1] = 0.0108;coeffs[2] = 0.0748;
-    coeffs[3] = 0.2384;coeffs[4] = 0.3505;coeffs[5] = 0.2384;
-    coeffs[6] = 0.0748;coeffs[7] = 0.0108;coeffs[8] = 0.0007;
-  }
-  else if (gauss_filter_mask_size_==11){
-    coeffs[0] = 0.0001;coeffs[1] = 0.0017;coeffs[2] = 0.0168;
-    coeffs[3] = 0.0870;coeffs[4] = 0.2328;coeffs[5] = 0.3231;
-    coeffs[6] = 0.2328;coeffs[7] = 0.0870;coeffs[8] = 0.0168;
-    coeffs[9] = 0.0017;coeffs[10] = 0.0001;
-  }
-  else if (gauss_filter_mask_size_==13){
-    coeffs[0] = 0.0001;coeffs[1] = 0.0012;coeffs[2] = 0.0085;
-    coeffs[3] = 0.0380;coeffs[4] = 0.1109;coeffs[5] = 0.2108;
-    coeffs[6] = 0.2611;coeffs[7] = 0.2108;coeffs[8] = 0.1109;
-    coeffs[9] = 0.0380;coeffs[10] = 0.0085;coeffs[11] = 0.0012;
-    coeffs[12] = 0.0001;
-  }
-  else{
-    TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,
-      "Error, the Gauss filter mask size is invalid (options include 5,7,9,11,13)");
-  }
+  gauss_filter_coefficients(gauss_filter_mask_size_,&coeffs[0]);
   TEUCHOS_TEST_FOR_EXCEPTION(width_<gauss_filter_mask_size_||height_<gauss_filter_mask_size_,std::runtime_error,
     "Error, image too small (" << width_ << " x " << height_ << ") for gauss filtering with mask size " << gauss_filter_mask_size_);
+  // any deferred gradients are computed from the unfiltered intensities
+  compute_gradient_tiles();
 
   // copy over the old intensities
+  Frame_Arena::Scope arena_scope;
+  intensity_t * intensities_temp = arena_scope.arena().allocate<intensity_t>(num_pixels());
   for(int_t i=0;i<num_pixels();++i)
-    intensities_temp_[i] = intensities_[i];
+    intensities_temp[i] = intensities_[i];
 
-  for(int_t j=0;j<gauss_filter_mask_size_;++j){
-    for(int_t i=0;i<gauss_filter_mask_size_;++i){
-      gauss_filter_coeffs_[i][j] = coeffs[i]*coeffs[j];
-    }
-  }
-  for(int_t y=0;y<height_;++y){
-    for(int_t x=0;x<width_;++x){
-      if(x>=gauss_filter_half_mask_&&x<width_-gauss_filter_half_mask_&&y>=gauss_filter_half_mask_&&y<height_-gauss_filter_half_mask_){
-        intensity_t value = 0.0;
-        for(int_t i=0;i<gauss_filter_mask_size_;++i){
-          for(int_t j=0;j<gauss_filter_mask_size_;++j){
-            // assumes intensity values have already been deep copied into intensities_temp_
-            value += gauss_filter_coeffs_[i][j]*intensities_temp_[(y+(j-gauss_filter_half_mask_+1))*width_+x+(i-gauss_filter_half_mask_+1)];
-          } //j
-        } //i
-        intensities_[y*width_+x] = value;
-      }
-    }
-  }
+  // the 2d gauss kernel is the outer product of the 1d coefficients so the filter is applied
+  // as two 1d passes, pixels within gauss_filter_half_mask_ of the edge are not filtered
+  separable_convolution(intensities_temp,intensities_.getRawPtr(),width_,height_,
+    &coeffs[0],gauss_filter_mask_size_,gauss_filter_half_mask_,num_threads_);
   has_gauss_filter_ = true;
+  // any B-spline coefficients are out of date now that the intensities have changed
+  bspline_degree_ = 0;
+  has_tiled_layout_ = false;
 }
 
 }// End DICe Namespace
@@ -43,7 +43,7 @@
 #include <DICe_Image.h>
 #include <DICe_LocalShapeFunction.h>
 
-#include <random>
+#include <cstdint>
 
 namespace DICe {
 
@@ -52,26 +52,49 @@ void apply_transform(Teuchos::RCP<Image> image_in,
   Teuchos::RCP<Image> image_out,
   const int_t cx,
   const int_t cy,
-  Teuchos::RCP<Local_Shape_Function > shape_function){
-
+  Teuchos::RCP<Local_Shape_Function > shape_function,
+  const int_t num_threads){
+  TEUCHOS_TEST_FOR_EXCEPTION(image_in->width()!=image_out->width(),std::runtime_error,"Dimensions must be the same");
+  TEUCHOS_TEST_FOR_EXCEPTION(image_in->height()!=image_out->height(),std::runtime_error,"Dimensions must be the same");
+  apply_transform(image_in,image_out->intensities().getRawPtr(),cx,cy,shape_function,num_threads);
+}
 
+DICE_LIB_DLL_EXPORT
+void apply_transform(Teuchos::RCP<Image> image_in,
+  intensity_t * values_out,
+  const int_t cx,
+  const int_t cy,
+  Teuchos::RCP<Local_Shape_Function > shape_function,
+  const int_t num_threads){
   const int_t width = image_in->width();
   const int_t height = image_in->height();
-  TEUCHOS_TEST_FOR_EXCEPTION(width!=image_out->width(),std::runtime_error,"Dimensions must be the same");
-  TEUCHOS_TEST_FOR_EXCEPTION(height!=image_out->height(),std::runtime_error,"Dimensions must be the same");
+  TEUCHOS_TEST_FOR_EXCEPTION(values_out==NULL,std::runtime_error,"");
   TEUCHOS_TEST_FOR_EXCEPTION(shape_function==Teuchos::null,std::runtime_error,"");
   scalar_t u =0.0,v=0.0,t=0.0;
   shape_function->map_to_u_v_theta(cx,cy,u,v,t);
   shape_function->insert_motion(-u,-v);
   const scalar_t CX = cx + u;
   const scalar_t CY = cy + v;
-  scalar_t mapped_x=0.0, mapped_y=0.0;
-  for(int_t y=0;y<height;++y){
-    for(int_t x=0;x<width;++x){
-      shape_function->map(x,y,CX,CY,mapped_x,mapped_y);
-      image_out->intensities()[y*width+x] = image_in->interpolate_keys_fourth(mapped_x,mapped_y);
-    }// x
-  }// y
+  // raw pointers are used in the threaded loop so the reference counts are not touched
+  Image * img = image_in.getRawPtr();
+  Local_Shape_Function * shape_func = shape_function.getRawPtr();
+  std::vector<int_t> xs(width);
+  for(int_t x=0;x<width;++x)
+    xs[x] = x;
+  // each row is mapped and interpolated in one pass (the same values as map() and interpolate_keys_fourth() per pixel)
+#pragma omp parallel num_threads(num_threads) if(num_threads>1)
+  {
+    std::vector<int_t> ys(width);
+    std::vector<scalar_t> mapped_x(width);
+    std::vector<scalar_t> mapped_y(width);
+#pragma omp for schedule(static)
+    for(int_t y=0;y<height;++y){
+      for(int_t x=0;x<width;++x)
+        ys[x] = y;
+      shape_func->batch_map(width,&xs[0],&ys[0],CX,CY,&mapped_x[0],&mapped_y[0]);
+      img->batch_interpolate(width,&mapped_x[0],&mapped_y[0],values_out+y*width,NULL,NULL,KEYS_FOURTH);
+    }// y
+  }
   shape_function->insert_motion(u,v);
 }
 
@@ -203,7 +226,8 @@ void Image_Deformer::compute_lagrange_strain_error(const scalar_t & coord_x,
 }
 
 Teuchos::RCP<Image>
-Image_Deformer::deform_image(Teuchos::RCP<Image> ref_image){
+Image_Deformer::deform_image(Teuchos::RCP<Image> ref_image,
+  const int_t num_threads){
   const int_t w = ref_image->width();
   const int_t h = ref_image->height();
   const int_t ox = ref_image->offset_x();
@@ -236,25 +260,18 @@ Image_Deformer::deform_image(Teuchos::RCP<Image> ref_image){
 //  } // ens pixel j
 
 
-  // Note: uses 5 x 5 point sampling grid to evaluate the deformed intensity
-  const int_t num_pts = 5;
-  static scalar_t offsets_x[5] = {0.0,-0.5,0.5,0.5,-0.5};
-  static scalar_t offsets_y[5] = {0.0,-0.5,-0.5,0.5,0.5};
   Teuchos::ArrayRCP<intensity_t> def_intens(w*h,0.0);
-  scalar_t bx=0.0,by=0.0;
-  for(int_t j=0;j<h;++j){
-    for(int_t i=0;i<w;++i){
-      scalar_t avg_intens = 0.0;
-      for(int_t pt=0;pt<num_pts;++pt){
-        const scalar_t sample_x = i - offsets_x[pt];
-        const scalar_t sample_y = j - offsets_y[pt];
-        compute_deformation(sample_x+ox,sample_y+oy,bx,by);
-        scalar_t intens = ref_image->interpolate_keys_fourth(sample_x-bx,sample_y-by);
-        avg_intens += intens;
-      } // end avg points
-      def_intens[j*w+i] = num_pts==0.0?0.0:avg_intens/num_pts;
-    } // end pixel i
-  } // ens pixel j
+  intensity_t * def_ptr = def_intens.getRawPtr();
+#pragma omp parallel num_threads(num_threads)
+  {
+    std::vector<scalar_t> sample_x;
+    std::vector<scalar_t> sample_y;
+    std::vector<intensity_t> sample_intens;
+#pragma omp for
+    for(int_t j=0;j<h;++j){
+      deform_row(ref_image,j,sample_x,sample_y,sample_intens,def_ptr+j*w);
+    } // end pixel j
+  }
 
   // no weighted average ...
 //  Teuchos::ArrayRCP<intensity_t> def_intens(w*h,0.0);
@@ -270,6 +287,77 @@ Image_Deformer::deform_image(Teuchos::RCP<Image> ref_image){
   return def_img;
 }
 
+void
+Image_Deformer::deform_row(const Teuchos::RCP<Image> & ref_image,
+  const int_t row,
+  std::vector<scalar_t> & sample_x,
+  std::vector<scalar_t> & sample_y,
+  std::vector<intensity_t> & sample_intens,
+  intensity_t * def_row){
+  const int_t w = ref_image->width();
+  const int_t ox = ref_image->offset_x();
+  const int_t oy = ref_image->offset_y();
+  // Note: uses 5 point sampling grid to evaluate the deformed intensity
+  const int_t num_pts = 5;
+  static const scalar_t offsets_x[5] = {0.0,-0.5,0.5,0.5,-0.5};
+  static const scalar_t offsets_y[5] = {0.0,-0.5,-0.5,0.5,0.5};
+  sample_x.resize(w*num_pts);
+  sample_y.resize(w*num_pts);
+  sample_intens.resize(w*num_pts);
+  scalar_t bx=0.0,by=0.0;
+  for(int_t i=0;i<w;++i){
+    for(int_t pt=0;pt<num_pts;++pt){
+      const scalar_t x = i - offsets_x[pt];
+      const scalar_t y = row - offsets_y[pt];
+      compute_deformation(x+ox,y+oy,bx,by);
+      sample_x[i*num_pts+pt] = x-bx;
+      sample_y[i*num_pts+pt] = y-by;
+    } // end avg points
+  } // end pixel i
+  // all the sample points of the row are interpolated in one pass
+  ref_image->batch_interpolate(w*num_pts,&sample_x[0],&sample_y[0],&sample_intens[0],NULL,NULL,KEYS_FOURTH);
+  for(int_t i=0;i<w;++i){
+    scalar_t avg_intens = 0.0;
+    for(int_t pt=0;pt<num_pts;++pt)
+      avg_intens += sample_intens[i*num_pts+pt];
+    def_row[i] = avg_intens/num_pts;
+  }
+}
+
+DICE_LIB_DLL_EXPORT
+std::vector<Teuchos::RCP<Image> > deform_images(Teuchos::RCP<Image> ref_image,
+  const std::vector<Teuchos::RCP<Image_Deformer> > & deformers,
+  const int_t num_threads){
+  const int_t w = ref_image->width();
+  const int_t h = ref_image->height();
+  const int_t num_deformers = deformers.size();
+  std::vector<Teuchos::ArrayRCP<intensity_t> > def_intens(num_deformers);
+  // raw pointers are used in the threaded loop so the reference counts are not touched
+  std::vector<intensity_t *> def_ptrs(num_deformers);
+  std::vector<Image_Deformer *> deformer_ptrs(num_deformers);
+  for(int_t d=0;d<num_deformers;++d){
+    TEUCHOS_TEST_FOR_EXCEPTION(deformers[d]==Teuchos::null,std::runtime_error,"Error, deformer " << d << " is null");
+    def_intens[d] = Teuchos::ArrayRCP<intensity_t>(w*h,0.0);
+    def_ptrs[d] = def_intens[d].getRawPtr();
+    deformer_ptrs[d] = deformers[d].getRawPtr();
+  }
+#pragma omp parallel num_threads(num_threads)
+  {
+    std::vector<scalar_t> sample_x;
+    std::vector<scalar_t> sample_y;
+    std::vector<intensity_t> sample_intens;
+#pragma omp for
+    for(int_t j=0;j<h;++j){
+      for(int_t d=0;d<num_deformers;++d)
+        deformer_ptrs[d]->deform_row(ref_image,j,sample_x,sample_y,sample_intens,def_ptrs[d]+j*w);
+    }
+  }
+  std::vector<Teuchos::RCP<Image> > def_imgs(num_deformers);
+  for(int_t d=0;d<num_deformers;++d)
+    def_imgs[d] = Teuchos::rcp(new Image(w,h,def_intens[d],Teuchos::null,ref_image->offset_x(),ref_image->offset_y()));
+  return def_imgs;
+}
+
 DICE_LIB_DLL_EXPORT
 int_t compute_speckle_stats(const std::string & output_dir,
   Teuchos::RCP<Image> & image){
@@ -573,7 +661,8 @@ Teuchos::RCP<Image> create_synthetic_speckle_image(const int_t w,
   const int_t offset_x,
   const int_t offset_y,
   const scalar_t & speckle_size,
-  const Teuchos::RCP<Teuchos::ParameterList> & params){
+  const Teuchos::RCP<Teuchos::ParameterList> & params,
+  const int_t num_threads){
 
   const scalar_t period = speckle_size * 2;
   assert(period > 0.0);
@@ -581,34 +670,73 @@ Teuchos::RCP<Image> create_synthetic_speckle_image(const int_t w,
   const scalar_t gamma = freq*DICE_TWOPI;
   const intensity_t mag = 255.0*0.5;
 
+  // the pattern is separable so the cosines are only evaluated once per column and once per row
+  std::vector<scalar_t> cos_x(w);
+  for(int_t x=0;x<w;++x)
+    cos_x[x] = std::cos(gamma*(x+offset_x));
+  std::vector<scalar_t> cos_y(h);
+  for(int_t y=0;y<h;++y)
+    cos_y[y] = std::cos(gamma*(y+offset_y));
   Teuchos::ArrayRCP<intensity_t> intensities(w*h,0.0);
+  intensity_t * intens = intensities.getRawPtr();
+#pragma omp parallel for num_threads(num_threads) if(num_threads>1) schedule(static)
   for(int_t y=0;y<h;++y){
+    const scalar_t mag_y = mag*cos_y[y];
+    intensity_t * row = intens + y*w;
+#pragma omp simd
     for(int_t x=0;x<w;++x){
-      intensities[y*w+x] = mag + mag*std::cos(gamma*(x+offset_x))*std::cos(gamma*(y+offset_y));
+      row[x] = mag + mag_y*cos_x[x];
     }
   }
   Teuchos::RCP<Image> img = Teuchos::rcp(new Image(w,h,intensities,params,offset_x,offset_y));
   return img;
 }
 
+/// counter based random number, returns a well mixed 64 bit value for the given seed and counter
+/// (splitmix64 finalizer, the values only depend on the seed and counter, not on the order they are drawn in)
+inline uint64_t
+counter_based_random(const uint64_t seed,
+  const uint64_t counter){
+  uint64_t z = seed + (counter+1)*0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
 DICE_LIB_DLL_EXPORT
 void add_noise_to_image(Teuchos::RCP<Image> & image,
-  const scalar_t & noise_percent){
+  const scalar_t & noise_percent,
+  const int_t seed,
+  const int_t num_threads){
 
+  const int_t num_px = image->width()*image->height();
+  intensity_t * intens = image->intensities().getRawPtr();
   // convert noise_percent to counts:
   // rip through the image and find the max intensity
   scalar_t max_intensity = 0.0;
-  for(int_t i=0;i<image->width()*image->height();++i){
-    if((*image)(i)>max_intensity)
-      max_intensity = (*image)(i);
+  for(int_t i=0;i<num_px;++i){
+    if(intens[i]>max_intensity)
+      max_intensity = intens[i];
   }
   const scalar_t std_dev = noise_percent*0.01*max_intensity;
   DEBUG_MSG("add_noise_to_image(): max intensity:    " << max_intensity << " counts");
   DEBUG_MSG("add_noise_to_image(): std dev of noise: " << std_dev << " counts");
-  std::default_random_engine generator;
-  std::normal_distribution<intensity_t> distribution(0.0,std_dev);
-  for(int_t i=0;i<image->width()*image->height();++i){
-    image->intensities()[i] += distribution(generator);
+  // each pair of pixels gets its own counter so the noise is the same for any number of threads,
+  // the two normal values of the Box-Muller transform are used for the two pixels of the pair
+  const uint64_t noise_seed = counter_based_random(0,static_cast<uint64_t>(seed));
+  const scalar_t inv_max = 1.0/18446744073709551616.0; // 2^64
+  const int_t num_pairs = (num_px+1)/2;
+#pragma omp parallel for num_threads(num_threads) if(num_threads>1) schedule(static)
+  for(int_t pair=0;pair<num_pairs;++pair){
+    // uniform values in (0,1]
+    const scalar_t u1 = (static_cast<scalar_t>(counter_based_random(noise_seed,2*pair)) + 1.0)*inv_max;
+    const scalar_t u2 = static_cast<scalar_t>(counter_based_random(noise_seed,2*pair+1))*inv_max;
+    const scalar_t r = std_dev*std::sqrt(-2.0*std::log(u1));
+    const scalar_t theta = DICE_TWOPI*u2;
+    const int_t i = 2*pair;
+    intens[i] += r*std::cos(theta);
+    if(i+1<num_px)
+      intens[i+1] += r*std::sin(theta);
   }
 }
 
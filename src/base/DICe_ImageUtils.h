@@ -68,12 +68,29 @@ class Local_Shape_Function;
 /// \param cx the centroid x coordiante
 /// \param cy the centroid y coordinate
 /// \param shape_function stores the vector that defines the deformation map parameters
+/// \param num_threads the number of threads to split the rows of the image across
 DICE_LIB_DLL_EXPORT
 void apply_transform(Teuchos::RCP<Image> image_in,
   Teuchos::RCP<Image> image_out,
   const int_t cx,
   const int_t cy,
-  Teuchos::RCP<Local_Shape_Function> shape_function);
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t num_threads=1);
+
+/// free function to apply a transformation to an image, the result is written to an array
+/// \param image_in the image where the intensities are taken
+/// \param values_out array of image_in->num_pixels() values for the output intensities (must not be the image_in intensities)
+/// \param cx the centroid x coordiante
+/// \param cy the centroid y coordinate
+/// \param shape_function stores the vector that defines the deformation map parameters
+/// \param num_threads the number of threads to split the rows of the image across
+DICE_LIB_DLL_EXPORT
+void apply_transform(Teuchos::RCP<Image> image_in,
+  intensity_t * values_out,
+  const int_t cx,
+  const int_t cy,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t num_threads=1);
 
 /// struct used to sort solutions by peak values
 struct computed_point
@@ -113,20 +130,28 @@ void compute_roll_off_stats(const scalar_t & period,
 /// \param offset_y the y offset for a sub image
 /// \param speckle_size size of the speckles to create
 /// \param params set of image parameters (compute gradients, etc)
+/// \param num_threads the number of threads to split the rows of the image across
 DICE_LIB_DLL_EXPORT
 Teuchos::RCP<Image> create_synthetic_speckle_image(const int_t w,
   const int_t h,
   const int_t offset_x,
   const int_t offset_y,
   const scalar_t & speckle_size,
-  const Teuchos::RCP<Teuchos::ParameterList> & params=Teuchos::null);
+  const Teuchos::RCP<Teuchos::ParameterList> & params=Teuchos::null,
+  const int_t num_threads=1);
 
 /// free function to add noise counts to an image
+/// the noise for each pixel is drawn from a counter based generator so the
+/// result only depends on the seed (not on the number of threads)
 /// \param image the image to modify
 /// \param noise_percent the amount of noise to add in percentage of the maximum intensity
+/// \param seed the seed for the noise, use a different seed for each image of a study
+/// \param num_threads the number of threads to split the pixels across
 DICE_LIB_DLL_EXPORT
 void add_noise_to_image(Teuchos::RCP<Image> & image,
-  const scalar_t & noise_percent);
+  const scalar_t & noise_percent,
+  const int_t seed=0,
+  const int_t num_threads=1);
 
 /// free function to determine the distribution of speckle sizes
 /// returns the next largest odd integer size (so if the pattern predominant size is 6, the function returns 7)
@@ -178,7 +203,24 @@ public:
   /// perform deformation on the image
   /// returns a pointer to the deformed image
   /// \param ref_image the reference image
-  Teuchos::RCP<Image> deform_image(Teuchos::RCP<Image> ref_image);
+  /// \param num_threads the number of threads to split the rows of the image across
+  /// (compute_deformation() must be safe to call from several threads, as it is for the analytical deformers)
+  Teuchos::RCP<Image> deform_image(Teuchos::RCP<Image> ref_image,
+    const int_t num_threads=1);
+
+  /// deform one row of the image (used by deform_image() and deform_images())
+  /// \param ref_image the reference image
+  /// \param row the row to deform
+  /// \param sample_x work space for the sample point x coordinates
+  /// \param sample_y work space for the sample point y coordinates
+  /// \param sample_intens work space for the sample point intensities
+  /// \param def_row [out] array of ref_image->width() deformed intensities
+  void deform_row(const Teuchos::RCP<Image> & ref_image,
+    const int_t row,
+    std::vector<scalar_t> & sample_x,
+    std::vector<scalar_t> & sample_y,
+    std::vector<intensity_t> & sample_intens,
+    intensity_t * def_row);
 
   /// compute the error of a given solution at the given coords
   /// \param coord_x the x coordinate
@@ -239,6 +281,18 @@ private:
 };
 
 
+/// free function to deform a reference image by several deformers in one pass
+/// (for example variants of the amplitude and period of the SinCos_Image_Deformer),
+/// each block of rows of the reference image is deformed by all of the deformers before moving on
+/// returns the deformed images in the same order as the deformers
+/// \param ref_image the reference image
+/// \param deformers the image deformers
+/// \param num_threads the number of threads to split the rows of the images across
+DICE_LIB_DLL_EXPORT
+std::vector<Teuchos::RCP<Image> > deform_images(Teuchos::RCP<Image> ref_image,
+  const std::vector<Teuchos::RCP<Image_Deformer> > & deformers,
+  const int_t num_threads=1);
+
 /// \class SinCos_Image_Deformer
 /// \brief a class that deformed an input image according to a sin()*cos() function
 class
@@ -0,0 +1,234 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_ImageViewPool.h>
+
+namespace DICe {
+
+namespace {
+
+/// returns true if the handle is the only reference to the view's allocation
+/// (unmanaged views that wrap user arrays report a zero count and are never recycled)
+template<typename View_Type>
+bool is_last_reference(const View_Type & view){
+  return view.ptr_on_device()!=0&&view.use_count()==1;
+}
+
+/// for a dual view the host and device views are the same allocation when the device is the host
+template<typename Dual_Type>
+bool is_last_dual_reference(const Dual_Type & view){
+  if(view.d_view.ptr_on_device()==0) return false;
+  if(view.h_view.ptr_on_device()==view.d_view.ptr_on_device())
+    return view.d_view.use_count()==2;
+  return view.d_view.use_count()==1&&view.h_view.use_count()==1;
+}
+
+/// allocates a dual view without initializing the values
+template<typename Dual_Type>
+Dual_Type allocate_dual_view(const std::string & label,
+  const int_t height,
+  const int_t width){
+  typename Dual_Type::t_dev dev(Kokkos::ViewAllocateWithoutInitializing(label),height,width);
+  typename Dual_Type::t_host host = Kokkos::create_mirror_view(dev);
+  return Dual_Type(dev,host);
+}
+
+/// number of values held by the views of a pool
+template<typename View_Type>
+long long pooled_values(const std::map<std::pair<int_t,int_t>,std::vector<View_Type> > & pool){
+  long long num_values = 0;
+  for(typename std::map<std::pair<int_t,int_t>,std::vector<View_Type> >::const_iterator it=pool.begin();it!=pool.end();++it)
+    num_values += (long long)it->second.size()*it->first.first*it->first.second;
+  return num_values;
+}
+
+}
+
+Image_View_Pool &
+Image_View_Pool::instance(){
+  static Image_View_Pool pool;
+  return pool;
+}
+
+template<typename View_Type>
+bool
+Image_View_Pool::take(std::map<View_Size,std::vector<View_Type> > & pool,
+  const View_Size & size,
+  View_Type & view){
+  std::lock_guard<std::mutex> lock(mutex_);
+  typename std::map<View_Size,std::vector<View_Type> >::iterator it = pool.find(size);
+  if(it==pool.end()||it->second.empty()) return false;
+  view = it->second.back();
+  it->second.pop_back();
+  update_memory_usage();
+  return true;
+}
+
+template<typename View_Type>
+void
+Image_View_Pool::put(std::map<View_Size,std::vector<View_Type> > & pool,
+  const View_Size & size,
+  const View_Type & view){
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<View_Type> & views = pool[size];
+  if((int_t)views.size()<max_views_per_size_){
+    views.push_back(view);
+    update_memory_usage();
+  }
+}
+
+void
+Image_View_Pool::update_memory_usage(){
+  // the host mirrors of the dual views are not counted separately
+  memory_.set((pooled_values(intensity_views_)+pooled_values(intensity_device_views_))*sizeof(intensity_t) +
+    (pooled_values(scalar_views_)+pooled_values(scalar_device_views_))*sizeof(scalar_t));
+}
+
+intensity_dual_view_2d
+Image_View_Pool::intensity_view(const std::string & label,
+  const int_t height,
+  const int_t width){
+  intensity_dual_view_2d view;
+  if(!take(intensity_views_,View_Size(height,width),view))
+    view = allocate_dual_view<intensity_dual_view_2d>(label,height,width);
+  return view;
+}
+
+intensity_device_view_2d
+Image_View_Pool::intensity_device_view(const std::string & label,
+  const int_t height,
+  const int_t width){
+  intensity_device_view_2d view;
+  if(!take(intensity_device_views_,View_Size(height,width),view))
+    view = intensity_device_view_2d(Kokkos::ViewAllocateWithoutInitializing(label),height,width);
+  return view;
+}
+
+scalar_dual_view_2d
+Image_View_Pool::scalar_view(const std::string & label,
+  const int_t height,
+  const int_t width){
+  scalar_dual_view_2d view;
+  if(!take(scalar_views_,View_Size(height,width),view))
+    view = allocate_dual_view<scalar_dual_view_2d>(label,height,width);
+  return view;
+}
+
+scalar_device_view_2d
+Image_View_Pool::scalar_device_view(const std::string & label,
+  const int_t height,
+  const int_t width){
+  scalar_device_view_2d view;
+  if(!take(scalar_device_views_,View_Size(height,width),view))
+    view = scalar_device_view_2d(Kokkos::ViewAllocateWithoutInitializing(label),height,width);
+  return view;
+}
+
+void
+Image_View_Pool::release(intensity_dual_view_2d & view){
+  if(is_last_dual_reference(view))
+    put(intensity_views_,View_Size(view.dimension_0(),view.dimension_1()),view);
+  view = intensity_dual_view_2d();
+}
+
+void
+Image_View_Pool::release(intensity_device_view_2d & view){
+  if(is_last_reference(view))
+    put(intensity_device_views_,View_Size(view.dimension_0(),view.dimension_1()),view);
+  view = intensity_device_view_2d();
+}
+
+void
+Image_View_Pool::release(scalar_dual_view_2d & view){
+  if(is_last_dual_reference(view))
+    put(scalar_views_,View_Size(view.dimension_0(),view.dimension_1()),view);
+  view = scalar_dual_view_2d();
+}
+
+void
+Image_View_Pool::release(scalar_device_view_2d & view){
+  if(is_last_reference(view))
+    put(scalar_device_views_,View_Size(view.dimension_0(),view.dimension_1()),view);
+  view = scalar_device_view_2d();
+}
+
+void
+Image_View_Pool::set_max_views_per_size(const int_t max_views){
+  TEUCHOS_TEST_FOR_EXCEPTION(max_views<0,std::invalid_argument,"Error, the maximum number of pooled views cannot be negative");
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_views_per_size_ = max_views;
+  for(std::map<View_Size,std::vector<intensity_dual_view_2d> >::iterator it=intensity_views_.begin();it!=intensity_views_.end();++it)
+    if((int_t)it->second.size()>max_views) it->second.resize(max_views);
+  for(std::map<View_Size,std::vector<intensity_device_view_2d> >::iterator it=intensity_device_views_.begin();it!=intensity_device_views_.end();++it)
+    if((int_t)it->second.size()>max_views) it->second.resize(max_views);
+  for(std::map<View_Size,std::vector<scalar_dual_view_2d> >::iterator it=scalar_views_.begin();it!=scalar_views_.end();++it)
+    if((int_t)it->second.size()>max_views) it->second.resize(max_views);
+  for(std::map<View_Size,std::vector<scalar_device_view_2d> >::iterator it=scalar_device_views_.begin();it!=scalar_device_views_.end();++it)
+    if((int_t)it->second.size()>max_views) it->second.resize(max_views);
+  update_memory_usage();
+}
+
+int_t
+Image_View_Pool::num_pooled_views(){
+  std::lock_guard<std::mutex> lock(mutex_);
+  int_t num_views = 0;
+  for(std::map<View_Size,std::vector<intensity_dual_view_2d> >::iterator it=intensity_views_.begin();it!=intensity_views_.end();++it)
+    num_views += it->second.size();
+  for(std::map<View_Size,std::vector<intensity_device_view_2d> >::iterator it=intensity_device_views_.begin();it!=intensity_device_views_.end();++it)
+    num_views += it->second.size();
+  for(std::map<View_Size,std::vector<scalar_dual_view_2d> >::iterator it=scalar_views_.begin();it!=scalar_views_.end();++it)
+    num_views += it->second.size();
+  for(std::map<View_Size,std::vector<scalar_device_view_2d> >::iterator it=scalar_device_views_.begin();it!=scalar_device_views_.end();++it)
+    num_views += it->second.size();
+  return num_views;
+}
+
+void
+Image_View_Pool::clear(){
+  std::lock_guard<std::mutex> lock(mutex_);
+  intensity_views_.clear();
+  intensity_device_views_.clear();
+  scalar_views_.clear();
+  scalar_device_views_.clear();
+  update_memory_usage();
+}
+
+}// End DICe Namespace
@@ -0,0 +1,176 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_IMAGEVIEWPOOL_H
+#define DICE_IMAGEVIEWPOOL_H
+
+#include <DICe.h>
+#include <DICe_Kokkos.h>
+#include <DICe_MemoryTracker.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Image_View_Pool
+/// \brief Recycles the Kokkos views of images that have been destroyed so that a sequence of
+/// frames of the same size does not allocate (and zero fill) new host and device buffers for every frame
+///
+/// Views are handed out by size. A view is only taken back if the image (or functor) releasing it
+/// holds the last reference to it, views that wrap user arrays or are still shared are simply dropped.
+/// The values of a recycled view are not initialized. The pool is shared by all threads.
+class DICE_LIB_DLL_EXPORT
+Image_View_Pool
+{
+public:
+  /// returns the pool shared by all images
+  static Image_View_Pool & instance();
+
+  /// returns an intensity dual view of the given size (recycled if one is available)
+  /// \param label the label used if a new view has to be allocated
+  /// \param height the number of rows
+  /// \param width the number of columns
+  intensity_dual_view_2d intensity_view(const std::string & label,
+    const int_t height,
+    const int_t width);
+
+  /// returns a device only intensity view of the given size (recycled if one is available)
+  /// \param label the label used if a new view has to be allocated
+  /// \param height the number of rows
+  /// \param width the number of columns
+  intensity_device_view_2d intensity_device_view(const std::string & label,
+    const int_t height,
+    const int_t width);
+
+  /// returns a scalar dual view of the given size (recycled if one is available)
+  /// \param label the label used if a new view has to be allocated
+  /// \param height the number of rows
+  /// \param width the number of columns
+  scalar_dual_view_2d scalar_view(const std::string & label,
+    const int_t height,
+    const int_t width);
+
+  /// returns a device only scalar view of the given size (recycled if one is available)
+  /// \param label the label used if a new view has to be allocated
+  /// \param height the number of rows
+  /// \param width the number of columns
+  scalar_device_view_2d scalar_device_view(const std::string & label,
+    const int_t height,
+    const int_t width);
+
+  /// returns a view to the pool if this is the last reference to it, the view is reset either way
+  void release(intensity_dual_view_2d & view);
+
+  /// returns a view to the pool if this is the last reference to it, the view is reset either way
+  void release(intensity_device_view_2d & view);
+
+  /// returns a view to the pool if this is the last reference to it, the view is reset either way
+  void release(scalar_dual_view_2d & view);
+
+  /// returns a view to the pool if this is the last reference to it, the view is reset either way
+  void release(scalar_device_view_2d & view);
+
+  /// sets the maximum number of views of each type and size kept by the pool (extra views are freed)
+  void set_max_views_per_size(const int_t max_views);
+
+  /// returns the number of views currently held by the pool
+  int_t num_pooled_views();
+
+  /// frees all the views held by the pool
+  void clear();
+
+private:
+  /// constructor
+  Image_View_Pool():
+    max_views_per_size_(4),
+    memory_(MEMORY_CACHES){};
+  /// not copyable
+  Image_View_Pool(const Image_View_Pool &);
+  /// not assignable
+  Image_View_Pool & operator=(const Image_View_Pool &);
+
+  /// size of a view used as the key for the pool
+  typedef std::pair<int_t,int_t> View_Size;
+
+  /// takes a view of the given size out of the pool or returns an empty view if there isn't one
+  template<typename View_Type>
+  bool take(std::map<View_Size,std::vector<View_Type> > & pool,
+    const View_Size & size,
+    View_Type & view);
+
+  /// adds a view to the pool unless the pool for that size is full
+  template<typename View_Type>
+  void put(std::map<View_Size,std::vector<View_Type> > & pool,
+    const View_Size & size,
+    const View_Type & view);
+
+  /// update the bytes held by the pooled views in the memory tracker (called with the mutex held)
+  void update_memory_usage();
+
+  /// guards the pools
+  std::mutex mutex_;
+  /// maximum number of views of each type and size
+  int_t max_views_per_size_;
+  /// pooled intensity dual views
+  std::map<View_Size,std::vector<intensity_dual_view_2d> > intensity_views_;
+  /// pooled device intensity views
+  std::map<View_Size,std::vector<intensity_device_view_2d> > intensity_device_views_;
+  /// pooled scalar dual views
+  std::map<View_Size,std::vector<scalar_dual_view_2d> > scalar_views_;
+  /// pooled device scalar views
+  std::map<View_Size,std::vector<scalar_device_view_2d> > scalar_device_views_;
+  /// bytes held by the pooled views
+  Tracked_Memory memory_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
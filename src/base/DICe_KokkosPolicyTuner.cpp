@@ -0,0 +1,159 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_KokkosPolicyTuner.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace DICe {
+
+namespace {
+/// number of timed runs of each candidate (the fastest one counts)
+const int_t num_timed_runs = 3;
+}
+
+Kokkos_Policy_Tuner &
+Kokkos_Policy_Tuner::instance(){
+  static Kokkos_Policy_Tuner tuner;
+  return tuner;
+}
+
+std::string
+Kokkos_Policy_Tuner::key(const std::string & kernel){
+  std::stringstream ss;
+  ss << kernel << "@" << device_space::name();
+  return ss.str();
+}
+
+std::vector<Kokkos_Policy>
+Kokkos_Policy_Tuner::candidates(){
+  std::vector<Kokkos_Policy> policies;
+  policies.push_back(Kokkos_Policy(false,0));
+  // the teams can't be larger than the threads of a host execution space
+  const int_t max_team_size = std::min((int_t)1024,(int_t)device_space::concurrency());
+  int_t team_size = 1;
+  while(team_size*2<=max_team_size&&team_size<32)
+    team_size *= 2;
+  for(;team_size<=max_team_size;team_size*=2)
+    policies.push_back(Kokkos_Policy(true,team_size));
+  return policies;
+}
+
+void
+Kokkos_Policy_Tuner::set_cache_file(const std::string & file_name){
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_file_ = file_name;
+  if(cache_file_.empty()) return;
+  std::ifstream cache(cache_file_.c_str());
+  if(!cache.good()) return;
+  // each line holds the key, the hierarchical flag and the team size
+  std::string line;
+  while(std::getline(cache,line)){
+    std::stringstream ss(line);
+    std::string kernel_key;
+    int_t hierarchical = 0;
+    int_t team_size = 0;
+    if(ss >> kernel_key >> hierarchical >> team_size)
+      policies_[kernel_key] = Kokkos_Policy(hierarchical!=0,team_size);
+  }
+  DEBUG_MSG("Kokkos_Policy_Tuner::set_cache_file(): read " << policies_.size() << " tuned policies from " << cache_file_);
+}
+
+void
+Kokkos_Policy_Tuner::clear(){
+  std::lock_guard<std::mutex> lock(mutex_);
+  policies_.clear();
+}
+
+Kokkos_Policy
+Kokkos_Policy_Tuner::policy(const std::string & kernel,
+  const std::function<void(const Kokkos_Policy &)> & benchmark){
+  const std::string kernel_key = key(kernel);
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string,Kokkos_Policy>::const_iterator it = policies_.find(kernel_key);
+  if(it!=policies_.end())
+    return it->second;
+  const std::vector<Kokkos_Policy> policies = candidates();
+  Kokkos_Policy fastest = policies[0];
+  double fastest_time = std::numeric_limits<double>::max();
+  for(size_t i=0;i<policies.size();++i){
+    double time = std::numeric_limits<double>::max();
+    try{
+      // the first run is not timed (first touch of the buffers, kernel loading)
+      benchmark(policies[i]);
+      Kokkos::fence();
+      for(int_t run=0;run<num_timed_runs;++run){
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        benchmark(policies[i]);
+        Kokkos::fence();
+        time = std::min(time,std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+      }
+    }
+    catch(std::exception & e){
+      // a team size the device does not support
+      DEBUG_MSG("Kokkos_Policy_Tuner::policy(): " << kernel << " team size " << policies[i].team_size_ << " failed: " << e.what());
+      continue;
+    }
+    DEBUG_MSG("Kokkos_Policy_Tuner::policy(): " << kernel << " hierarchical " << policies[i].use_hierarchical_parallelism_ <<
+      " team size " << policies[i].team_size_ << " time " << time);
+    if(time<fastest_time){
+      fastest_time = time;
+      fastest = policies[i];
+    }
+  }
+  DEBUG_MSG("Kokkos_Policy_Tuner::policy(): tuned " << kernel_key << " hierarchical " << fastest.use_hierarchical_parallelism_ <<
+    " team size " << fastest.team_size_);
+  policies_[kernel_key] = fastest;
+  if(!cache_file_.empty()){
+    std::ofstream cache(cache_file_.c_str(),std::ios::app);
+    if(cache.good())
+      cache << kernel_key << " " << (fastest.use_hierarchical_parallelism_ ? 1 : 0) << " " << fastest.team_size_ << std::endl;
+  }
+  return fastest;
+}
+
+}// End DICe Namespace
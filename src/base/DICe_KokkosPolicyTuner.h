@@ -0,0 +1,145 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_KOKKOSPOLICYTUNER_H
+#define DICE_KOKKOSPOLICYTUNER_H
+
+#include <DICe.h>
+#include <DICe_Kokkos.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Kokkos_Policy
+/// \brief execution policy of a kernel that has a flat and a hierarchical (team) implementation
+struct Kokkos_Policy{
+  /// constructor
+  /// \param use_hierarchical_parallelism true if the team policy is used
+  /// \param team_size the team size for the team policy
+  Kokkos_Policy(const bool use_hierarchical_parallelism=false,
+    const int_t team_size=256):
+    use_hierarchical_parallelism_(use_hierarchical_parallelism),
+    team_size_(team_size){}
+  /// true if the team policy is used
+  bool use_hierarchical_parallelism_;
+  /// the team size for the team policy
+  int_t team_size_;
+};
+
+/// \class DICe::Kokkos_Policy_Tuner
+/// \brief Picks the fastest execution policy of each kernel on this machine
+///
+/// The first time a kernel asks for its policy each candidate (the flat range policy and the team
+/// policy with a range of team sizes) is timed with the benchmark the kernel provides and the fastest
+/// one is kept for the rest of the run. If a cache file is set the tuned policies are read from it
+/// and new ones are appended, so the benchmarks only run once per machine (the entries are keyed by
+/// the kernel name and the execution space). Any kernel can be tuned by passing its own benchmark.
+class DICE_LIB_DLL_EXPORT
+Kokkos_Policy_Tuner
+{
+public:
+  /// returns the tuner shared by all kernels
+  static Kokkos_Policy_Tuner & instance();
+
+  /// returns the tuned policy of a kernel, the candidates are benchmarked if the kernel has not been tuned yet
+  /// \param kernel the name of the kernel
+  /// \param benchmark runs the kernel once with the given policy (must be repeatable and have no side effects on the results)
+  Kokkos_Policy policy(const std::string & kernel,
+    const std::function<void(const Kokkos_Policy &)> & benchmark);
+
+  /// set the file the tuned policies are cached in (the existing entries are read)
+  /// \param file_name the name of the cache file (empty to not cache the policies)
+  void set_cache_file(const std::string & file_name);
+
+  /// turn the tuning of the kernels that have not been given an explicit policy on or off
+  /// \param enabled true if the kernels should use the tuned policies
+  void set_enabled(const bool enabled){
+    enabled_ = enabled;
+  }
+
+  /// returns true if the kernels that have not been given an explicit policy use the tuned policies
+  bool enabled()const{
+    return enabled_;
+  }
+
+  /// returns the candidate policies for the execution space
+  static std::vector<Kokkos_Policy> candidates();
+
+  /// forget the tuned policies (the cache file is not changed)
+  void clear();
+
+private:
+  /// constructor
+  Kokkos_Policy_Tuner():
+    enabled_(false){};
+  /// not copyable
+  Kokkos_Policy_Tuner(const Kokkos_Policy_Tuner &);
+  /// not assignable
+  Kokkos_Policy_Tuner & operator=(const Kokkos_Policy_Tuner &);
+
+  /// returns the key of a kernel in the cache (the kernel name and the execution space)
+  static std::string key(const std::string & kernel);
+
+  /// guards the policies and the cache file
+  std::mutex mutex_;
+  /// the tuned policies by key
+  std::map<std::string,Kokkos_Policy> policies_;
+  /// the cache file
+  std::string cache_file_;
+  /// true if the kernels use the tuned policies
+  bool enabled_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -46,6 +46,17 @@ namespace DICe {
 
 using namespace DICe::field_enums;
 
+/// returns true if the value is a whole number of pixels (to within round-off)
+/// \param value the value to test
+/// \param whole [out] the rounded value
+inline bool whole_pixels(const scalar_t & value,
+  int_t & whole){
+  const scalar_t rounded = std::floor(value + 0.5);
+  if(std::abs(value - rounded) > 1.0E-10) return false;
+  whole = (int_t)rounded;
+  return true;
+}
+
 DICE_LIB_DLL_EXPORT
 Teuchos::RCP<Local_Shape_Function> shape_function_factory(Schema * schema){
   if(!schema){
@@ -62,11 +73,12 @@ void
 Local_Shape_Function::save_fields(Schema * schema,
   const int_t subset_gid){
   assert(schema);
+  const int_t subset_lid = schema->subset_local_id(subset_gid);
   // iterate the fields and save off the values
   std::map<Field_Spec,size_t>::const_iterator it = spec_map_.begin();
   const std::map<Field_Spec,size_t>::const_iterator it_end = spec_map_.end();
   for(;it!=it_end;++it)
-    schema->global_field_value(subset_gid,it->first) = parameters_[it->second];
+    schema->local_field_value(subset_lid,it->first) = parameters_[it->second];
 }
 
 void
@@ -76,6 +88,36 @@ Local_Shape_Function::update(const std::vector<scalar_t> & update){
     parameters_[i] += update[i];
 }
 
+void
+Local_Shape_Function::batch_map(const int_t num_points,
+  const int_t * x,
+  const int_t * y,
+  const scalar_t & cx,
+  const scalar_t & cy,
+  scalar_t * out_x,
+  scalar_t * out_y){
+  for(int_t i=0;i<num_points;++i)
+    map(x[i],y[i],cx,cy,out_x[i],out_y[i]);
+}
+
+void
+Local_Shape_Function::batch_residuals(const int_t num_points,
+  const int_t * x,
+  const int_t * y,
+  const scalar_t & cx,
+  const scalar_t & cy,
+  const scalar_t * gx,
+  const scalar_t * gy,
+  scalar_t * out_residuals,
+  const bool use_ref_grads){
+  std::vector<scalar_t> point_residuals(num_params_,0.0);
+  for(int_t i=0;i<num_points;++i){
+    residuals(x[i],y[i],cx,cy,gx[i],gy[i],point_residuals,use_ref_grads);
+    for(int_t j=0;j<num_params_;++j)
+      out_residuals[i*num_params_+j] = point_residuals[j];
+  }
+}
+
 bool
 Local_Shape_Function::test_for_convergence(const std::vector<scalar_t> & old_parameters,
   const scalar_t & tol){
@@ -116,12 +158,13 @@ void
 Local_Shape_Function::initialize_parameters_from_fields(Schema * schema,
   const int_t subset_gid){
   assert(schema);
+  const int_t subset_lid = schema->subset_local_id(subset_gid);
   std::map<Field_Spec,size_t>::const_iterator it = spec_map_.begin();
   const std::map<Field_Spec,size_t>::const_iterator it_end = spec_map_.end();
   std::stringstream dbg_str;
   dbg_str << "Subset initialized from subset gid " << subset_gid << " with values:";
   for(;it!=it_end;++it){
-    (*this)(it->first) = schema->global_field_value(subset_gid,it->first);
+    (*this)(it->first) = schema->local_field_value(subset_lid,it->first);
     dbg_str << " " << parameter(it->first);
   }
   DEBUG_MSG(dbg_str.str());
@@ -190,16 +233,12 @@ Affine_Shape_Function::map(const scalar_t & x,
   scalar_t & out_x,
   scalar_t & out_y){
 
-  static scalar_t dx=0.0,dy=0.0;
-  static scalar_t Dx=0.0,Dy=0.0;
-  static scalar_t cost;
-  static scalar_t sint;
-  cost = std::cos(parameter(ROTATION_Z_FS));
-  sint = std::sin(parameter(ROTATION_Z_FS));
-  dx = x - cx;
-  dy = y - cy;
-  Dx = (1.0+parameter(NORMAL_STRETCH_XX_FS))*dx + parameter(SHEAR_STRETCH_XY_FS)*dy;
-  Dy = (1.0+parameter(NORMAL_STRETCH_YY_FS))*dy + parameter(SHEAR_STRETCH_XY_FS)*dx;
+  const scalar_t cost = std::cos(parameter(ROTATION_Z_FS));
+  const scalar_t sint = std::sin(parameter(ROTATION_Z_FS));
+  const scalar_t dx = x - cx;
+  const scalar_t dy = y - cy;
+  const scalar_t Dx = (1.0+parameter(NORMAL_STRETCH_XX_FS))*dx + parameter(SHEAR_STRETCH_XY_FS)*dy;
+  const scalar_t Dy = (1.0+parameter(NORMAL_STRETCH_YY_FS))*dy + parameter(SHEAR_STRETCH_XY_FS)*dx;
   // mapped location
   out_x = cost*Dx - sint*Dy + parameter(SUBSET_DISPLACEMENT_X_FS) + cx;
   out_y = sint*Dx + cost*Dy + parameter(SUBSET_DISPLACEMENT_Y_FS) + cy;
@@ -210,39 +249,49 @@ void
 Affine_Shape_Function::initialize_parameters_from_fields(Schema * schema,
   const int_t subset_gid){
   assert(schema);
+  const int_t subset_lid = schema->subset_local_id(subset_gid);
   const Projection_Method projection = schema->projection_method();
+  scalar_t predicted_u = 0.0, predicted_v = 0.0, predicted_t = 0.0;
+  const bool use_prediction = projection == POLYNOMIAL_BASED && schema->predict_motion(subset_gid,predicted_u,predicted_v,predicted_t);
   if(schema->translation_enabled()){
     DEBUG_MSG("Subset " << subset_gid << " Translation is enabled.");
-    if(schema->frame_id() > schema->first_frame_id()+2 && projection == VELOCITY_BASED){
-      (*this)(SUBSET_DISPLACEMENT_X_FS) = schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_FS) +
-          (schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_FS)-schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_NM1_FS));
-      (*this)(SUBSET_DISPLACEMENT_Y_FS) = schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_FS) +
-          (schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_FS)-schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_NM1_FS));
+    if(use_prediction){
+      (*this)(SUBSET_DISPLACEMENT_X_FS) = predicted_u;
+      (*this)(SUBSET_DISPLACEMENT_Y_FS) = predicted_v;
+    }
+    else if(schema->frame_id() > schema->first_frame_id()+2 && projection == VELOCITY_BASED){
+      (*this)(SUBSET_DISPLACEMENT_X_FS) = schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_X_FS) +
+          (schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_X_FS)-schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_X_NM1_FS));
+      (*this)(SUBSET_DISPLACEMENT_Y_FS) = schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_Y_FS) +
+          (schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_Y_FS)-schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_Y_NM1_FS));
 
     }
     else{
-      (*this)(SUBSET_DISPLACEMENT_X_FS) = schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_FS);
-      (*this)(SUBSET_DISPLACEMENT_Y_FS) = schema->global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_FS);
+      (*this)(SUBSET_DISPLACEMENT_X_FS) = schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_X_FS);
+      (*this)(SUBSET_DISPLACEMENT_Y_FS) = schema->local_field_value(subset_lid,SUBSET_DISPLACEMENT_Y_FS);
     }
   }
   if(schema->rotation_enabled()){
     DEBUG_MSG("Subset " << subset_gid << " Rotation is enabled.");
-    if(schema->frame_id() > schema->first_frame_id()+2 && projection == VELOCITY_BASED){
-      (*this)(ROTATION_Z_FS) = schema->global_field_value(subset_gid,ROTATION_Z_FS) +
-          (schema->global_field_value(subset_gid,ROTATION_Z_FS)-schema->global_field_value(subset_gid,ROTATION_Z_NM1_FS));
+    if(use_prediction){
+      (*this)(ROTATION_Z_FS) = predicted_t;
+    }
+    else if(schema->frame_id() > schema->first_frame_id()+2 && projection == VELOCITY_BASED){
+      (*this)(ROTATION_Z_FS) = schema->local_field_value(subset_lid,ROTATION_Z_FS) +
+          (schema->local_field_value(subset_lid,ROTATION_Z_FS)-schema->local_field_value(subset_lid,ROTATION_Z_NM1_FS));
     }
     else{
-      (*this)(ROTATION_Z_FS) = schema->global_field_value(subset_gid,ROTATION_Z_FS);
+      (*this)(ROTATION_Z_FS) = schema->local_field_value(subset_lid,ROTATION_Z_FS);
     }
   }
   if(schema->normal_strain_enabled()){
     DEBUG_MSG("Subset " << subset_gid << " Normal strain is enabled.");
-    (*this)(NORMAL_STRETCH_XX_FS) = schema->global_field_value(subset_gid,NORMAL_STRETCH_XX_FS);
-    (*this)(NORMAL_STRETCH_YY_FS) = schema->global_field_value(subset_gid,NORMAL_STRETCH_YY_FS);
+    (*this)(NORMAL_STRETCH_XX_FS) = schema->local_field_value(subset_lid,NORMAL_STRETCH_XX_FS);
+    (*this)(NORMAL_STRETCH_YY_FS) = schema->local_field_value(subset_lid,NORMAL_STRETCH_YY_FS);
   }
   if(schema->shear_strain_enabled()){
     DEBUG_MSG("Subset " << subset_gid << " Shear strain is enabled.");
-    (*this)(SHEAR_STRETCH_XY_FS) = schema->global_field_value(subset_gid,SHEAR_STRETCH_XY_FS);
+    (*this)(SHEAR_STRETCH_XY_FS) = schema->local_field_value(subset_lid,SHEAR_STRETCH_XY_FS);
   }
 //  if(sid!=subset_gid)
 //    DEBUG_MSG("Subset " << subset_gid << " was initialized from the field values of subset " << sid);
@@ -316,9 +365,9 @@ Affine_Shape_Function::residuals(const scalar_t & x,
   const bool use_ref_grads){
   assert((int_t)residuals.size()==num_params_);
 
-  static scalar_t dx=0.0,dy=0.0,Dx=0.0,Dy=0.0,delTheta=0.0,delEx=0.0,delEy=0.0,delGxy=0.0;
-  static scalar_t Gx=0.0,Gy=0.0;
-  static scalar_t theta=0.0,dudx=0.0,dvdy=0.0,gxy=0.0,cosTheta=0.0,sinTheta=0.0;
+  scalar_t dx=0.0,dy=0.0,Dx=0.0,Dy=0.0,delTheta=0.0,delEx=0.0,delEy=0.0,delGxy=0.0;
+  scalar_t Gx=0.0,Gy=0.0;
+  scalar_t theta=0.0,dudx=0.0,dvdy=0.0,gxy=0.0,cosTheta=0.0,sinTheta=0.0;
   theta = parameter(ROTATION_Z_FS);
   dudx  = parameter(NORMAL_STRETCH_XX_FS);
   dvdy  = parameter(NORMAL_STRETCH_YY_FS);
@@ -354,6 +403,130 @@ Affine_Shape_Function::residuals(const scalar_t & x,
 }
 
 
+/// \brief Residual kernel for the affine shape function with the enabled modes known at compile time
+/// so that the number of parameters and the parameter indices are constants (the ordering of the
+/// parameters is the one set up in Affine_Shape_Function::init())
+template<bool ROTATION, bool NORMAL_STRAIN, bool SHEAR_STRAIN>
+void affine_residuals_kernel(const int_t num_points,
+  const int_t * x,
+  const int_t * y,
+  const scalar_t & cx,
+  const scalar_t & cy,
+  const scalar_t * gx,
+  const scalar_t * gy,
+  const scalar_t * params,
+  scalar_t * out_residuals,
+  const bool use_ref_grads){
+  const int_t N = 2 + (ROTATION ? 1 : 0) + (NORMAL_STRAIN ? 2 : 0) + (SHEAR_STRAIN ? 1 : 0);
+  const int_t t_id = 2;
+  const int_t ex_id = ROTATION ? 3 : 2;
+  const int_t ey_id = ex_id + 1;
+  const int_t gxy_id = ex_id + (NORMAL_STRAIN ? 2 : 0);
+  const scalar_t theta = ROTATION ? params[t_id] : 0.0;
+  const scalar_t dudx = NORMAL_STRAIN ? params[ex_id] : 0.0;
+  const scalar_t dvdy = NORMAL_STRAIN ? params[ey_id] : 0.0;
+  const scalar_t gxy = SHEAR_STRAIN ? params[gxy_id] : 0.0;
+  const scalar_t cosTheta = std::cos(theta);
+  const scalar_t sinTheta = std::sin(theta);
+  for(int_t i=0;i<num_points;++i){
+    const scalar_t dx = x[i] - cx;
+    const scalar_t dy = y[i] - cy;
+    const scalar_t Gx = use_ref_grads ? cosTheta*gx[i] - sinTheta*gy[i] : gx[i];
+    const scalar_t Gy = use_ref_grads ? sinTheta*gx[i] + cosTheta*gy[i] : gy[i];
+    scalar_t * r = out_residuals + i*N;
+    r[0] = Gx;
+    r[1] = Gy;
+    if(ROTATION){
+      const scalar_t Dx = (1.0+dudx)*dx + gxy*dy;
+      const scalar_t Dy = (1.0+dvdy)*dy + gxy*dx;
+      r[t_id] = Gx*(-sinTheta*Dx - cosTheta*Dy) + Gy*(cosTheta*Dx - sinTheta*Dy);
+    }
+    if(NORMAL_STRAIN){
+      r[ex_id] = Gx*dx*cosTheta + Gy*dx*sinTheta;
+      r[ey_id] = -Gx*dy*sinTheta + Gy*dy*cosTheta;
+    }
+    if(SHEAR_STRAIN)
+      r[gxy_id] = Gx*(cosTheta*dy - sinTheta*dx) + Gy*(sinTheta*dy + cosTheta*dx);
+  }
+}
+
+bool
+Affine_Shape_Function::integer_translation(int_t & shift_x,
+  int_t & shift_y)const{
+  // the rotation and stretches all have to be exactly zero for the map to be a translation
+  std::map<Field_Spec,size_t>::const_iterator it = spec_map_.begin();
+  const std::map<Field_Spec,size_t>::const_iterator it_end = spec_map_.end();
+  for(;it!=it_end;++it){
+    if(it->first==SUBSET_DISPLACEMENT_X_FS||it->first==SUBSET_DISPLACEMENT_Y_FS) continue;
+    if(parameters_[it->second]!=0.0) return false;
+  }
+  return whole_pixels(parameter(SUBSET_DISPLACEMENT_X_FS),shift_x) && whole_pixels(parameter(SUBSET_DISPLACEMENT_Y_FS),shift_y);
+}
+
+void
+Affine_Shape_Function::batch_map(const int_t num_points,
+  const int_t * x,
+  const int_t * y,
+  const scalar_t & cx,
+  const scalar_t & cy,
+  scalar_t * out_x,
+  scalar_t * out_y){
+  // same map as Affine_Shape_Function::map() with the coefficients collected once for all points
+  const scalar_t cost = std::cos(parameter(ROTATION_Z_FS));
+  const scalar_t sint = std::sin(parameter(ROTATION_Z_FS));
+  const scalar_t sxx = 1.0 + parameter(NORMAL_STRETCH_XX_FS);
+  const scalar_t syy = 1.0 + parameter(NORMAL_STRETCH_YY_FS);
+  const scalar_t sxy = parameter(SHEAR_STRETCH_XY_FS);
+  const scalar_t a00 = cost*sxx - sint*sxy;
+  const scalar_t a01 = cost*sxy - sint*syy;
+  const scalar_t a10 = sint*sxx + cost*sxy;
+  const scalar_t a11 = sint*sxy + cost*syy;
+  const scalar_t tx = parameter(SUBSET_DISPLACEMENT_X_FS) + cx;
+  const scalar_t ty = parameter(SUBSET_DISPLACEMENT_Y_FS) + cy;
+  for(int_t i=0;i<num_points;++i){
+    const scalar_t dx = x[i] - cx;
+    const scalar_t dy = y[i] - cy;
+    out_x[i] = a00*dx + a01*dy + tx;
+    out_y[i] = a10*dx + a11*dy + ty;
+  }
+}
+
+void
+Affine_Shape_Function::batch_residuals(const int_t num_points,
+  const int_t * x,
+  const int_t * y,
+  const scalar_t & cx,
+  const scalar_t & cy,
+  const scalar_t * gx,
+  const scalar_t * gy,
+  scalar_t * out_residuals,
+  const bool use_ref_grads){
+  const bool rotation = spec_map_.find(ROTATION_Z_FS)!=spec_map_.end();
+  const bool normal_strain = spec_map_.find(NORMAL_STRETCH_XX_FS)!=spec_map_.end();
+  const bool shear_strain = spec_map_.find(SHEAR_STRETCH_XY_FS)!=spec_map_.end();
+  const scalar_t * params = &parameters_[0];
+  if(rotation){
+    if(normal_strain){
+      if(shear_strain) affine_residuals_kernel<true,true,true>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+      else affine_residuals_kernel<true,true,false>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+    }
+    else{
+      if(shear_strain) affine_residuals_kernel<true,false,true>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+      else affine_residuals_kernel<true,false,false>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+    }
+  }
+  else{
+    if(normal_strain){
+      if(shear_strain) affine_residuals_kernel<false,true,true>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+      else affine_residuals_kernel<false,true,false>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+    }
+    else{
+      if(shear_strain) affine_residuals_kernel<false,false,true>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+      else affine_residuals_kernel<false,false,false>(num_points,x,y,cx,cy,gx,gy,params,out_residuals,use_ref_grads);
+    }
+  }
+}
+
 bool
 Affine_Shape_Function::test_for_convergence(const std::vector<scalar_t> & old_parameters,
   const scalar_t & tol){
@@ -382,6 +555,72 @@ Affine_Shape_Function::test_for_convergence(const std::vector<scalar_t> & old_pa
   return converged;
 }
 
+void
+Affine_Shape_Function::inverse_compositional_update(const std::vector<scalar_t> & update){
+  assert((int_t)update.size()==num_params_);
+  // the map is x' = R(theta)*S*(x-c) + c + u where S = [1+ex gxy; gxy 1+ey]
+  // so it is stored as a linear part A = R*S (row major) and a translation t
+  const bool has_t = spec_map_.find(ROTATION_Z_FS)!=spec_map_.end();
+  const bool has_ex = spec_map_.find(NORMAL_STRETCH_XX_FS)!=spec_map_.end();
+  const bool has_ey = spec_map_.find(NORMAL_STRETCH_YY_FS)!=spec_map_.end();
+  const bool has_gxy = spec_map_.find(SHEAR_STRETCH_XY_FS)!=spec_map_.end();
+  const size_t u_id = spec_map_.find(SUBSET_DISPLACEMENT_X_FS)->second;
+  const size_t v_id = spec_map_.find(SUBSET_DISPLACEMENT_Y_FS)->second;
+
+  // current map
+  scalar_t cost = std::cos(parameter(ROTATION_Z_FS));
+  scalar_t sint = std::sin(parameter(ROTATION_Z_FS));
+  scalar_t sxx = 1.0 + parameter(NORMAL_STRETCH_XX_FS);
+  scalar_t syy = 1.0 + parameter(NORMAL_STRETCH_YY_FS);
+  scalar_t sxy = parameter(SHEAR_STRETCH_XY_FS);
+  const scalar_t A00 = cost*sxx - sint*sxy;
+  const scalar_t A01 = cost*sxy - sint*syy;
+  const scalar_t A10 = sint*sxx + cost*sxy;
+  const scalar_t A11 = sint*sxy + cost*syy;
+
+  // incremental map
+  cost = std::cos(has_t ? update[spec_map_.find(ROTATION_Z_FS)->second] : 0.0);
+  sint = std::sin(has_t ? update[spec_map_.find(ROTATION_Z_FS)->second] : 0.0);
+  sxx = 1.0 + (has_ex ? update[spec_map_.find(NORMAL_STRETCH_XX_FS)->second] : 0.0);
+  syy = 1.0 + (has_ey ? update[spec_map_.find(NORMAL_STRETCH_YY_FS)->second] : 0.0);
+  sxy = has_gxy ? update[spec_map_.find(SHEAR_STRETCH_XY_FS)->second] : 0.0;
+  const scalar_t dA00 = cost*sxx - sint*sxy;
+  const scalar_t dA01 = cost*sxy - sint*syy;
+  const scalar_t dA10 = sint*sxx + cost*sxy;
+  const scalar_t dA11 = sint*sxy + cost*syy;
+  const scalar_t det = dA00*dA11 - dA01*dA10;
+  TEUCHOS_TEST_FOR_EXCEPTION(det==0.0,std::runtime_error,"Error, the incremental map is not invertible");
+
+  // inverse of the incremental map
+  const scalar_t iA00 = dA11/det;
+  const scalar_t iA01 = -dA01/det;
+  const scalar_t iA10 = -dA10/det;
+  const scalar_t iA11 = dA00/det;
+  const scalar_t it0 = -(iA00*update[u_id] + iA01*update[v_id]);
+  const scalar_t it1 = -(iA10*update[u_id] + iA11*update[v_id]);
+
+  // composed map
+  const scalar_t nA00 = A00*iA00 + A01*iA10;
+  const scalar_t nA01 = A00*iA01 + A01*iA11;
+  const scalar_t nA10 = A10*iA00 + A11*iA10;
+  const scalar_t nA11 = A10*iA01 + A11*iA11;
+  parameters_[u_id] += A00*it0 + A01*it1;
+  parameters_[v_id] += A10*it0 + A11*it1;
+
+  // decompose the linear part back into a rotation and a symmetric stretch
+  const scalar_t theta = (has_t) ? std::atan2(nA10 - nA01,nA00 + nA11) : 0.0;
+  cost = std::cos(theta);
+  sint = std::sin(theta);
+  if(has_t)
+    (*this)(ROTATION_Z_FS) = theta;
+  if(has_ex)
+    (*this)(NORMAL_STRETCH_XX_FS) = cost*nA00 + sint*nA10 - 1.0;
+  if(has_ey)
+    (*this)(NORMAL_STRETCH_YY_FS) = -sint*nA01 + cost*nA11 - 1.0;
+  if(has_gxy)
+    (*this)(SHEAR_STRETCH_XY_FS) = 0.5*((cost*nA01 + sint*nA11) + (-sint*nA00 + cost*nA10));
+}
+
 Quadratic_Shape_Function::Quadratic_Shape_Function(){
   spec_map_.insert(std::pair<Field_Spec,size_t>(QUAD_A_FS,spec_map_.size()));
   spec_map_.insert(std::pair<Field_Spec,size_t>(QUAD_B_FS,spec_map_.size()));
@@ -537,6 +776,77 @@ Quadratic_Shape_Function::residuals(const scalar_t & x,
   residuals[spec_map_.find(QUAD_L_FS)->second] = Gy;
 }
 
+bool
+Quadratic_Shape_Function::integer_translation(int_t & shift_x,
+  int_t & shift_y)const{
+  // the identity map has A and H equal to one and every coefficient other than the translations F and L zero
+  for(int_t i=0;i<num_params_;++i){
+    if(i==(int_t)spec_map_.find(QUAD_F_FS)->second||i==(int_t)spec_map_.find(QUAD_L_FS)->second) continue;
+    const scalar_t identity = (i==(int_t)spec_map_.find(QUAD_A_FS)->second||i==(int_t)spec_map_.find(QUAD_H_FS)->second) ? 1.0 : 0.0;
+    if(parameters_[i]!=identity) return false;
+  }
+  return whole_pixels(parameter(QUAD_F_FS),shift_x) && whole_pixels(parameter(QUAD_L_FS),shift_y);
+}
+
+void
+Quadratic_Shape_Function::batch_map(const int_t num_points,
+  const int_t * x,
+  const int_t * y,
+  const scalar_t & cx,
+  const scalar_t & cy,
+  scalar_t * out_x,
+  scalar_t * out_y){
+  // the parameter ordering is fixed by the constructor (A through L)
+  assert(num_params_==12);
+  const scalar_t * p = &parameters_[0];
+  for(int_t i=0;i<num_points;++i){
+    const scalar_t dx = x[i] - cx;
+    const scalar_t dy = y[i] - cy;
+    out_x[i] = p[0]*dx + p[1]*dy + p[2]*dx*dy + p[3]*dx*dx + p[4]*dy*dy + p[5] + cx;
+    out_y[i] = p[6]*dx + p[7]*dy + p[8]*dx*dy + p[9]*dx*dx + p[10]*dy*dy + p[11] + cy;
+  }
+}
+
+void
+Quadratic_Shape_Function::batch_residuals(const int_t num_points,
+  const int_t * x,
+  const int_t * y,
+  const scalar_t & cx,
+  const scalar_t & cy,
+  const scalar_t * gx,
+  const scalar_t * gy,
+  scalar_t * out_residuals,
+  const bool use_ref_grads){
+  assert(num_params_==12);
+  scalar_t cosTheta = 1.0;
+  scalar_t sinTheta = 0.0;
+  if(use_ref_grads){
+    scalar_t u=0.0,v=0.0,theta=0.0;
+    map_to_u_v_theta(cx,cy,u,v,theta);
+    cosTheta = std::cos(theta);
+    sinTheta = std::sin(theta);
+  }
+  for(int_t i=0;i<num_points;++i){
+    const scalar_t dx = x[i] - cx;
+    const scalar_t dy = y[i] - cy;
+    const scalar_t Gx = cosTheta*gx[i] - sinTheta*gy[i];
+    const scalar_t Gy = sinTheta*gx[i] + cosTheta*gy[i];
+    scalar_t * r = out_residuals + i*12;
+    r[0]  = Gx*dx;
+    r[1]  = Gx*dy;
+    r[2]  = Gx*dx*dy;
+    r[3]  = Gx*dx*dx;
+    r[4]  = Gx*dy*dy;
+    r[5]  = Gx;
+    r[6]  = Gy*dx;
+    r[7]  = Gy*dy;
+    r[8]  = Gy*dx*dy;
+    r[9]  = Gy*dx*dx;
+    r[10] = Gy*dy*dy;
+    r[11] = Gy;
+  }
+}
+
 void
 Quadratic_Shape_Function::save_fields(Schema * schema,
   const int_t subset_gid){
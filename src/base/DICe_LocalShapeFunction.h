@@ -207,10 +207,62 @@ public:
     std::vector<scalar_t> & residuals,
     const bool use_ref_grads=false)=0;
 
+  /// map a set of input coordinates in one call (one virtual call for the set rather than one per pixel)
+  /// \param num_points the number of points to map
+  /// \param x array of input x coordinates
+  /// \param y array of input y coordinates
+  /// \param cx input centroid coordinate (dummy variable for some shape functions)
+  /// \param cy input centroid coordinate (dummy variable for some shape functions)
+  /// \param out_x [out] array of mapped x coordinates
+  /// \param out_y [out] array of mapped y coordinates
+  virtual void batch_map(const int_t num_points,
+    const int_t * x,
+    const int_t * y,
+    const scalar_t & cx,
+    const scalar_t & cy,
+    scalar_t * out_x,
+    scalar_t * out_y);
+
+  /// compute the residuals for a set of points in one call (one virtual call for the set rather than one per pixel)
+  /// \param num_points the number of points to compute for
+  /// \param x array of x coordinates
+  /// \param y array of y coordinates
+  /// \param cx input centroid coordinate (dummy variable for some shape functions)
+  /// \param cy input centroid coordinate (dummy variable for some shape functions)
+  /// \param gx array of x image gradients
+  /// \param gy array of y image gradients
+  /// \param out_residuals [out] array of size num_points*num_params, the residuals for each point are contiguous
+  /// \param use_ref_grads true if the gradients should be used from the reference image (so they need to be adjusted for the current def map)
+  virtual void batch_residuals(const int_t num_points,
+    const int_t * x,
+    const int_t * y,
+    const scalar_t & cx,
+    const scalar_t & cy,
+    const scalar_t * gx,
+    const scalar_t * gy,
+    scalar_t * out_residuals,
+    const bool use_ref_grads=false);
+
+  /// returns true if the map is a pure translation by a whole number of pixels,
+  /// in which case every pixel lands on a pixel of the image and no interpolation is needed
+  /// \param shift_x [out] the translation in x
+  /// \param shift_y [out] the translation in y
+  virtual bool integer_translation(int_t & shift_x,
+    int_t & shift_y)const{
+    return false;
+  }
+
   /// update the parameter values based on an input vector
   /// \param update reference to the update vector
   void update(const std::vector<scalar_t> & update);
 
+  /// update the parameter values by composing the current map with the inverse of the
+  /// incremental map, W(p) <- W(p) o W(update)^-1 (used by the inverse compositional method)
+  /// \param update reference to the update vector (incremental parameters of the map on the reference subset)
+  virtual void inverse_compositional_update(const std::vector<scalar_t> & update){
+    TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, the inverse compositional update has not been implemented for this shape function");
+  }
+
   /// returns true if the solution is converged
   /// \param old_parameters vector of the previous guess for the parameters
   /// \param tol the solution tolerance
@@ -227,6 +279,11 @@ public:
     return Teuchos::rcp(&deltas_,false);
   }
 
+  /// returns the delta values for this shape function (without creating an rcp)
+  const std::vector<scalar_t> & delta_values()const{
+    return deltas_;
+  }
+
   /// returns a pointer to the spec map
   std::map<DICe::field_enums::Field_Spec,size_t> * spec_map(){
     return &spec_map_;
@@ -323,10 +380,40 @@ public:
     std::vector<scalar_t> & residuals,
     const bool use_ref_grads=false);
 
+  /// see base class description
+  virtual void batch_map(const int_t num_points,
+    const int_t * x,
+    const int_t * y,
+    const scalar_t & cx,
+    const scalar_t & cy,
+    scalar_t * out_x,
+    scalar_t * out_y);
+
+  /// see base class description
+  virtual void batch_residuals(const int_t num_points,
+    const int_t * x,
+    const int_t * y,
+    const scalar_t & cx,
+    const scalar_t & cy,
+    const scalar_t * gx,
+    const scalar_t * gy,
+    scalar_t * out_residuals,
+    const bool use_ref_grads=false);
+
+  /// see base class description
+  virtual bool integer_translation(int_t & shift_x,
+    int_t & shift_y)const;
+
   /// see base class description
   virtual bool test_for_convergence(const std::vector<scalar_t> & old_parameters,
     const scalar_t & tol);
 
+  /// see base class description
+  /// note: the composed map is projected back onto the enabled parameters, so if the
+  /// enabled modes are not closed under composition (for example shear without normal strain)
+  /// the modes that are not enabled are dropped
+  virtual void inverse_compositional_update(const std::vector<scalar_t> & update);
+
   /// see base class description
   virtual void update_params_for_centroid_change(const scalar_t & delta_x,
     const scalar_t & delta_y){
@@ -395,6 +482,30 @@ public:
     std::vector<scalar_t> & residuals,
     const bool use_ref_grads=false);
 
+  /// see base class description
+  virtual void batch_map(const int_t num_points,
+    const int_t * x,
+    const int_t * y,
+    const scalar_t & cx,
+    const scalar_t & cy,
+    scalar_t * out_x,
+    scalar_t * out_y);
+
+  /// see base class description
+  virtual void batch_residuals(const int_t num_points,
+    const int_t * x,
+    const int_t * y,
+    const scalar_t & cx,
+    const scalar_t & cy,
+    const scalar_t * gx,
+    const scalar_t * gy,
+    scalar_t * out_residuals,
+    const bool use_ref_grads=false);
+
+  /// see base class description
+  virtual bool integer_translation(int_t & shift_x,
+    int_t & shift_y)const;
+
   /// see base class description
   virtual void save_fields(Schema * schema,
     const int_t subset_gid);
@@ -0,0 +1,148 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_MemoryTracker.h>
+
+#include <iomanip>
+
+#if DICE_MPI
+#  include <mpi.h>
+#endif
+
+namespace DICe {
+
+std::atomic<long long> Memory_Tracker::current_[MAX_MEMORY_CATEGORY];
+std::atomic<long long> Memory_Tracker::peak_[MAX_MEMORY_CATEGORY];
+std::atomic<long long> Memory_Tracker::total_current_(0);
+std::atomic<long long> Memory_Tracker::total_peak_(0);
+
+void
+Memory_Tracker::raise_peak(std::atomic<long long> & peak,
+  const long long value){
+  long long prev = peak.load();
+  while(value>prev&&!peak.compare_exchange_weak(prev,value)){}
+}
+
+void
+Memory_Tracker::allocate(const Memory_Category category,
+  const long long bytes){
+  raise_peak(peak_[category],current_[category] += bytes);
+  raise_peak(total_peak_,total_current_ += bytes);
+}
+
+void
+Memory_Tracker::release(const Memory_Category category,
+  const long long bytes){
+  current_[category] -= bytes;
+  total_current_ -= bytes;
+}
+
+long long
+Memory_Tracker::total_current(){
+  return total_current_.load();
+}
+
+void
+Memory_Tracker::reset_peaks(){
+  for(int_t i=0;i<MAX_MEMORY_CATEGORY;++i)
+    peak_[i] = current_[i].load();
+  total_peak_ = total_current_.load();
+}
+
+void
+Memory_Tracker::write_frame(std::ostream & os,
+  const int_t frame_id,
+  const bool header){
+  if(header){
+    os << "FRAME";
+    for(int_t i=0;i<MAX_MEMORY_CATEGORY;++i)
+      os << " " << memoryCategoryStrings[i] << " " << memoryCategoryStrings[i] << "_PEAK";
+    os << " TOTAL TOTAL_PEAK" << std::endl;
+  }
+  os << frame_id;
+  for(int_t i=0;i<MAX_MEMORY_CATEGORY;++i)
+    os << " " << current(static_cast<Memory_Category>(i)) << " " << peak(static_cast<Memory_Category>(i));
+  os << " " << total_current() << " " << total_peak() << std::endl;
+}
+
+void
+Memory_Tracker::report(std::ostream & os){
+  const int_t num_values = MAX_MEMORY_CATEGORY+1;
+  double local_current[num_values];
+  double local_peak[num_values];
+  for(int_t i=0;i<MAX_MEMORY_CATEGORY;++i){
+    local_current[i] = static_cast<double>(current(static_cast<Memory_Category>(i)));
+    local_peak[i] = static_cast<double>(peak(static_cast<Memory_Category>(i)));
+  }
+  local_current[MAX_MEMORY_CATEGORY] = static_cast<double>(total_current());
+  local_peak[MAX_MEMORY_CATEGORY] = static_cast<double>(total_peak());
+  double max_current[num_values];
+  double max_peak[num_values];
+  double sum_peak[num_values];
+  int_t proc_rank = 0;
+  int_t num_procs = 1;
+#if DICE_MPI
+  MPI_Comm_rank(MPI_COMM_WORLD,&proc_rank);
+  MPI_Comm_size(MPI_COMM_WORLD,&num_procs);
+  MPI_Allreduce(local_current,max_current,num_values,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  MPI_Allreduce(local_peak,max_peak,num_values,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  MPI_Allreduce(local_peak,sum_peak,num_values,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+#else
+  for(int_t i=0;i<num_values;++i){
+    max_current[i] = local_current[i];
+    max_peak[i] = local_peak[i];
+    sum_peak[i] = local_peak[i];
+  }
+#endif
+  if(proc_rank!=0) return;
+
+  const double mb = 1.0/(1024.0*1024.0);
+  os << "Memory usage (MB, over " << num_procs << " processor(s)):" << std::endl;
+  os << std::setw(20) << std::left << "subsystem" << std::right << std::setw(14) << "max current"
+      << std::setw(14) << "avg peak" << std::setw(14) << "max peak" << std::endl;
+  for(int_t i=0;i<num_values;++i){
+    os << std::setw(20) << std::left << (i<MAX_MEMORY_CATEGORY ? memoryCategoryStrings[i] : "TOTAL") << std::right
+        << std::setprecision(4) << std::setw(14) << max_current[i]*mb << std::setw(14) << sum_peak[i]/num_procs*mb
+        << std::setw(14) << max_peak[i]*mb << std::endl;
+  }
+}
+
+}// End DICe Namespace
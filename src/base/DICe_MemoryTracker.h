@@ -0,0 +1,211 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#ifndef DICE_MEMORYTRACKER_H
+#define DICE_MEMORYTRACKER_H
+
+#include <DICe.h>
+
+#include <atomic>
+#include <iostream>
+#include <string>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// The subsystems whose memory is accounted for
+enum Memory_Category{
+  MEMORY_IMAGES=0,
+  MEMORY_SUBSETS,
+  MEMORY_MESH_FIELDS,
+  MEMORY_NEIGHBOR_LISTS,
+  MEMORY_CACHES,
+  MEMORY_OUTPUT_BUFFERS,
+  // DON'T ADD ANY BELOW MAX
+  MAX_MEMORY_CATEGORY
+};
+
+const static char * memoryCategoryStrings[] = {
+  "IMAGES",
+  "SUBSETS",
+  "MESH_FIELDS",
+  "NEIGHBOR_LISTS",
+  "CACHES",
+  "OUTPUT_BUFFERS"
+};
+
+/// \class DICe::Memory_Tracker
+/// \brief Keeps the current and peak number of bytes held by each subsystem on this processor
+///
+/// The counters are updated by the Tracked_Memory members of the classes that own the large
+/// arrays (images, subsets, multifields, neighbor lists, ...), so only the bulk data is counted,
+/// not the small members of each object. The counters are always on and thread safe.
+class
+DICE_LIB_DLL_EXPORT
+Memory_Tracker{
+public:
+  /// add bytes to a category
+  /// \param category the subsystem
+  /// \param bytes the number of bytes allocated
+  static void allocate(const Memory_Category category,
+    const long long bytes);
+
+  /// remove bytes from a category
+  /// \param category the subsystem
+  /// \param bytes the number of bytes released
+  static void release(const Memory_Category category,
+    const long long bytes);
+
+  /// returns the number of bytes currently held by a category
+  /// \param category the subsystem
+  static long long current(const Memory_Category category){
+    return current_[category].load();
+  }
+
+  /// returns the largest number of bytes held by a category since the last reset_peaks()
+  /// \param category the subsystem
+  static long long peak(const Memory_Category category){
+    return peak_[category].load();
+  }
+
+  /// returns the number of bytes currently held by all categories
+  static long long total_current();
+
+  /// returns the largest number of bytes held by all categories at the same time since the last reset_peaks()
+  static long long total_peak(){
+    return total_peak_.load();
+  }
+
+  /// set the peaks to the current values
+  static void reset_peaks();
+
+  /// write one line with the current and peak bytes of each category (this processor only)
+  /// \param os the stream to write to
+  /// \param frame_id the frame the line is written for
+  /// \param header true if the column names should be written first
+  static void write_frame(std::ostream & os,
+    const int_t frame_id,
+    const bool header);
+
+  /// reduce the peaks across all processors and print a summary table
+  /// (collective when MPI is enabled, only processor 0 prints)
+  /// \param os the stream to print the table to
+  static void report(std::ostream & os);
+
+private:
+  /// raise a peak counter to at least the given value
+  static void raise_peak(std::atomic<long long> & peak,
+    const long long value);
+  /// bytes currently held by each category
+  static std::atomic<long long> current_[MAX_MEMORY_CATEGORY];
+  /// peak bytes held by each category
+  static std::atomic<long long> peak_[MAX_MEMORY_CATEGORY];
+  /// bytes currently held by all categories
+  static std::atomic<long long> total_current_;
+  /// peak bytes held by all categories
+  static std::atomic<long long> total_peak_;
+};
+
+/// \class DICe::Tracked_Memory
+/// \brief Member that accounts for the bulk data of the owning object in the Memory_Tracker
+///
+/// The owner calls set() whenever its arrays are (re)allocated and the bytes are released
+/// when the owner is destroyed. A copy starts at zero bytes since the arrays of the copied
+/// object are usually shared (ArrayRCPs and views), the owner calls set() if it copies them.
+class
+DICE_LIB_DLL_EXPORT
+Tracked_Memory{
+public:
+  /// constructor
+  /// \param category the subsystem the bytes belong to
+  /// \param bytes the initial number of bytes
+  explicit Tracked_Memory(const Memory_Category category,
+    const long long bytes=0):
+    category_(category),
+    bytes_(0){
+    set(bytes);
+  }
+
+  /// copy constructor (the copy holds no bytes)
+  Tracked_Memory(const Tracked_Memory & rhs):
+    category_(rhs.category_),
+    bytes_(0){}
+
+  /// assignment keeps the bytes of this object
+  Tracked_Memory & operator=(const Tracked_Memory &){
+    return *this;
+  }
+
+  /// destructor releases the bytes
+  ~Tracked_Memory(){
+    set(0);
+  }
+
+  /// set the number of bytes held by the owner
+  /// \param bytes the number of bytes
+  void set(const long long bytes){
+    if(bytes>bytes_)
+      Memory_Tracker::allocate(category_,bytes-bytes_);
+    else if(bytes<bytes_)
+      Memory_Tracker::release(category_,bytes_-bytes);
+    bytes_ = bytes;
+  }
+
+  /// returns the number of bytes held by the owner
+  long long bytes()const{
+    return bytes_;
+  }
+
+private:
+  /// the subsystem
+  const Memory_Category category_;
+  /// bytes held
+  long long bytes_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -43,6 +43,8 @@
 #define DICE_MULTIFIELDEPETRA_H
 
 #include <DICe.h>
+#include <DICe_Trace.h>
+#include <DICe_MemoryTracker.h>
 
 #include <Epetra_ConfigDefs.h>
 #if DICE_MPI
@@ -83,7 +85,7 @@ public:
 #if DICE_MPI
   int mpi_is_initialized = 0;
   MPI_Initialized(&mpi_is_initialized);
-  if(mpi_is_initialized)
+  if(mpi_is_initialized&&!serial())
     comm_ = Teuchos::rcp(new Epetra_MpiComm(MPI_COMM_WORLD));
   else
     comm_ = Teuchos::rcp(new Epetra_SerialComm);
@@ -92,6 +94,17 @@ public:
   comm_ = Teuchos::rcp(new Epetra_SerialComm);
 #endif
   }
+
+  /// \brief Makes the communicators created after this call serial so each processor works independently
+  /// (used when the frames rather than the subsets are split among the processors)
+  /// \param flag true if the communicators should be serial
+  static void set_serial(const bool flag){serial() = flag;}
+
+  /// Returns true if the communicators are serial regardless of the number of processors
+  static bool & serial(){
+    static bool serial_comm = false;
+    return serial_comm;
+  }
   /// Returns the current processor id
   int get_rank()const{return comm_->MyPID();}
 
@@ -291,9 +304,11 @@ public:
   /// \param zero_values set to true if the vectors should be initialized with zeros
   MultiField(Teuchos::RCP<MultiField_Map> & map,
     const int_t & num_fields,
-    const bool & zero_values=false){
+    const bool & zero_values=false):
+    memory_(MEMORY_MESH_FIELDS){
     map_ = map;
     epetra_mv_ = Teuchos::rcp(new Epetra_MultiVector(*map->get(),num_fields,true));
+    memory_.set((long long)map->get_num_local_elements()*num_fields*sizeof(mv_scalar_type));
   }
   /// Destructor
   virtual ~MultiField(){};
@@ -329,6 +344,14 @@ public:
     return (*epetra_mv_)[field_index][local_id];
   }
 
+  /// \brief pointer to the local values of one field (null if there are no local elements)
+  /// \param field_index the index of the field to access
+  /// the pointer stays valid as long as this MultiField exists
+  mv_scalar_type * local_values(const int_t field_index=0){
+    if(map_->get_num_local_elements()==0) return NULL;
+    return (*epetra_mv_)[field_index];
+  }
+
   /// \brief axpby for MultiField
   /// \param alpha Multiplier of the input MultiField
   /// \param multifield Input multifield
@@ -349,6 +372,7 @@ public:
   void do_import(Teuchos::RCP<MultiField> multifield,
     MultiField_Importer & importer,
     const Combine_Mode mode=INSERT){
+    Scoped_Trace_Span span("field_import","mpi");
     if(mode==INSERT)
       epetra_mv_->Import(*multifield->get(),*importer.get(),Insert);
     else if(mode==ADD)
@@ -367,6 +391,7 @@ public:
   void do_import(Teuchos::RCP<MultiField> multifield,
     MultiField_Exporter & exporter,
     const Combine_Mode mode=INSERT){
+    Scoped_Trace_Span span("field_import","mpi");
     if(mode==INSERT)
       epetra_mv_->Import(*multifield->get(),*exporter.get(),Insert);
     else if(mode==ADD)
@@ -383,6 +408,7 @@ public:
   void do_export(Teuchos::RCP<MultiField> multifield,
     MultiField_Exporter & exporter,
     const Combine_Mode mode=INSERT){
+    Scoped_Trace_Span span("field_export","mpi");
     if(mode==INSERT)
       epetra_mv_->Export(*multifield->get(),*exporter.get(),Insert);
     else if(mode==ADD)
@@ -443,6 +469,8 @@ private:
   Teuchos::RCP<Epetra_MultiVector> epetra_mv_;
   /// Pointer to the underlying map
   Teuchos::RCP<MultiField_Map> map_;
+  /// bytes held by the vectors
+  Tracked_Memory memory_;
 };
 
 
@@ -501,6 +529,17 @@ public:
     matrix_->ReplaceMyValues(local_row,vals.size(),&vals[0],&cols[0]);
   }
 
+  /// \brief Sum values into existing entries at the global indices given
+  /// returns true if all of the entries were already in the matrix graph
+  /// \param global_row The global id of the row
+  /// \param cols An array of global column ids
+  /// \param vals An array of real values to add
+  bool sum_into_global_values(const int_t global_row,
+    const Teuchos::ArrayView<const int_t> & cols,
+    const Teuchos::ArrayView<const mv_scalar_type> & vals){
+    return matrix_->SumIntoGlobalValues(global_row,vals.size(),&vals[0],&cols[0])==0;
+  }
+
   /// Print the matrix to the screen
   void describe()const{
     matrix_->Print(std::cout);
@@ -508,14 +547,14 @@ public:
 
   /// Finish assembling the matrix
   void fill_complete(){
-    matrix_->FillComplete();
+    // the graph of an Epetra matrix is fixed once filled, only the values change after that
+    if(!matrix_->Filled())
+      matrix_->FillComplete();
   }
 
-  /// Finish assembling the matrix
+  /// Allow the values of a filled matrix to be modified again
   void resume_fill(){
-    // FIXME
-    TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Method not implemented");
-    //matrix_->ResumeFill();
+    // no-op for Epetra, values of existing entries can be changed after FillComplete
   }
 
   /// \brief export the data from one distributed object to this one
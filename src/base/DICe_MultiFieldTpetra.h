@@ -43,6 +43,8 @@
 #define DICE_MULTIFIELDTPETRA_H
 
 #include <DICe.h>
+#include <DICe_Trace.h>
+#include <DICe_MemoryTracker.h>
 
 #include <Tpetra_Vector.hpp>
 #include <Tpetra_MultiVector.hpp>
@@ -83,7 +85,7 @@ public:
 #if DICE_MPI
     int mpi_is_initialized = 0;
     MPI_Initialized(&mpi_is_initialized);
-    if(mpi_is_initialized)
+    if(mpi_is_initialized&&!serial())
       comm_ = Tpetra::DefaultPlatform::getDefaultPlatform().getComm ();
     else
       comm_ =  Teuchos::rcp(new Teuchos::SerialComm<int> ());
@@ -91,6 +93,19 @@ public:
     comm_ = Tpetra::DefaultPlatform::getDefaultPlatform().getComm ();
 #endif
   }
+
+  /// \brief Makes the communicators created after this call serial so each processor works independently
+  /// (used when the frames rather than the subsets are split among the processors)
+  /// \param flag true if the communicators should be serial
+  static void set_serial(const bool flag){
+    serial() = flag;
+  }
+
+  /// Returns true if the communicators are serial regardless of the number of processors
+  static bool & serial(){
+    static bool serial_comm = false;
+    return serial_comm;
+  }
   /// Returns the current processor id
   int get_rank()const{
     return comm_->getRank();
@@ -299,9 +314,11 @@ public:
   /// \param zero_values set to true if the vectors should be initialized with zeros
   MultiField(Teuchos::RCP<MultiField_Map > map,
     const int_t & num_fields,
-    const bool & zero_values=false){
+    const bool & zero_values=false):
+    memory_(MEMORY_MESH_FIELDS){
     map_ = map;
     tpetra_mv_ = Teuchos::rcp(new vec_type(map->get(),num_fields,zero_values));
+    memory_.set((long long)map->get_num_local_elements()*num_fields*sizeof(mv_scalar_type));
   }
 
 //  /// \brief copy constructor
@@ -350,6 +367,14 @@ public:
     return tpetra_mv_->getLocalView<host_device_type>()(local_id,field_index);
   }
 
+  /// \brief pointer to the local values of one field (null if there are no local elements)
+  /// \param field_index the index of the field to access
+  /// the pointer stays valid as long as this MultiField exists
+  scalar_t * local_values(const int_t field_index=0){
+    if(map_->get_num_local_elements()==0) return NULL;
+    return &tpetra_mv_->getLocalView<host_device_type>()(0,field_index);
+  }
+
   /// \brief put that same value in all elements of this Multivector
   /// \param value The value to populate with
   void put_scalar(const scalar_t & value){
@@ -376,6 +401,7 @@ public:
   void do_import(Teuchos::RCP<MultiField> multifield,
     MultiField_Importer & importer,
     const Combine_Mode mode=INSERT){
+    Scoped_Trace_Span span("field_import","mpi");
     if(mode==INSERT)
       tpetra_mv_->doImport(*multifield->get(),*importer.get(),Tpetra::INSERT);
     else if(mode==ADD)
@@ -394,6 +420,7 @@ public:
   void do_import(Teuchos::RCP<MultiField> multifield,
     MultiField_Exporter & exporter,
     const Combine_Mode mode=INSERT){
+    Scoped_Trace_Span span("field_import","mpi");
     if(mode==INSERT)
       tpetra_mv_->doImport(*multifield->get(),*exporter.get(),Tpetra::INSERT);
     else if(mode==ADD)
@@ -410,6 +437,7 @@ public:
   void do_export(Teuchos::RCP<MultiField> multifield,
     MultiField_Exporter & exporter,
     const Combine_Mode mode=INSERT){
+    Scoped_Trace_Span span("field_export","mpi");
     if(mode==INSERT)
       tpetra_mv_->doExport(*multifield->get(),*exporter.get(),Tpetra::INSERT);
     else if(mode==ADD)
@@ -450,6 +478,8 @@ private:
   Teuchos::RCP<vec_type> tpetra_mv_;
   /// Pointer to the underlying map
   Teuchos::RCP<MultiField_Map> map_;
+  /// bytes held by the vectors
+  Tracked_Memory memory_;
 };
 
 /// \class DICe::MultiField_Matrix
@@ -507,6 +537,17 @@ public:
     matrix_->replaceLocalValues (local_row,cols,vals);
   }
 
+  /// \brief Sum values into existing entries at the global indices given
+  /// returns true if all of the entries were already in the matrix graph
+  /// \param global_row The global id of the row
+  /// \param cols An array of global column ids
+  /// \param vals An array of real values to add
+  bool sum_into_global_values(const int_t global_row,
+    const Teuchos::ArrayView<const int_t> & cols,
+    const Teuchos::ArrayView<const scalar_t> & vals){
+    return matrix_->sumIntoGlobalValues(global_row,cols,vals)==(int_t)vals.size();
+  }
+
   /// Print the matrix to the screen
   void describe()const{
     Teuchos::RCP<Teuchos::FancyOStream> fos = Teuchos::fancyOStream(Teuchos::rcpFromRef(std::cout));
@@ -0,0 +1,269 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_NodeSharedMemory.h>
+#include <DICe_Image.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <algorithm>
+#include <new>
+#if DICE_MPI
+  #include <mpi.h>
+#endif
+
+namespace DICe {
+
+namespace {
+/// bytes at the start of each window for the count of processes that hold it (keeps the data aligned)
+const size_t window_header_bytes = 64;
+}
+
+struct Node_Shared_Memory::Impl{
+  Impl():
+    node_rank(0),
+    node_size(1),
+    shared_bytes(0){}
+  /// a shared memory window
+  struct Window{
+#if DICE_MPI
+    /// the MPI window
+    MPI_Win win;
+#endif
+    /// the count of processes that hold the window (the start of the shared memory)
+    std::atomic<int> * holders;
+    /// the first value of the array
+    void * data;
+    /// size of the array in bytes
+    size_t bytes;
+  };
+#if DICE_MPI
+  /// the processes on this node
+  MPI_Comm node_comm;
+#endif
+  /// rank of this process on the node
+  int node_rank;
+  /// number of processes on the node
+  int node_size;
+  /// the windows in the order they were created (the same on every process of the node)
+  std::vector<Window> windows;
+  /// bytes held by the windows
+  size_t shared_bytes;
+};
+
+Node_Shared_Memory::Node_Shared_Memory():
+  impl_(new Impl()){
+#if DICE_MPI
+  int mpi_is_initialized = 0;
+  MPI_Initialized(&mpi_is_initialized);
+  if(!mpi_is_initialized) return;
+  MPI_Comm_split_type(MPI_COMM_WORLD,MPI_COMM_TYPE_SHARED,0,MPI_INFO_NULL,&impl_->node_comm);
+  MPI_Comm_rank(impl_->node_comm,&impl_->node_rank);
+  MPI_Comm_size(impl_->node_comm,&impl_->node_size);
+#endif
+}
+
+Node_Shared_Memory &
+Node_Shared_Memory::instance(){
+  static Node_Shared_Memory * shared = new Node_Shared_Memory();
+  return *shared;
+}
+
+int_t
+Node_Shared_Memory::node_rank(){
+  return instance().impl_->node_rank;
+}
+
+int_t
+Node_Shared_Memory::node_size(){
+  return instance().impl_->node_size;
+}
+
+size_t
+Node_Shared_Memory::shared_bytes(){
+  return instance().impl_->shared_bytes;
+}
+
+void
+Node_Shared_Memory::barrier(){
+#if DICE_MPI
+  Impl * impl = instance().impl_;
+  if(impl->node_size<=1) return;
+  // the processes read each other's stores through plain loads, so the stores are completed first
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  MPI_Barrier(impl->node_comm);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+}
+
+void
+Node_Shared_Memory::broadcast(int_t * values,
+  const int_t count){
+#if DICE_MPI
+  Impl * impl = instance().impl_;
+  if(impl->node_size<=1||count<=0) return;
+  std::vector<long long> buffer(values,values+count);
+  MPI_Bcast(&buffer[0],count,MPI_LONG_LONG,0,impl->node_comm);
+  std::copy(buffer.begin(),buffer.end(),values);
+#endif
+}
+
+void *
+Node_Shared_Memory::take(const size_t bytes,
+  std::atomic<int> * & holders){
+  Impl * impl = impl_;
+  // the leader picks the window so every process holds the same one
+  int_t index = -1;
+  if(impl->node_rank==0){
+    for(size_t i=0;i<impl->windows.size();++i){
+      if(impl->windows[i].bytes==bytes&&impl->windows[i].holders->load()==0){
+        index = i;
+        break;
+      }
+    }
+  }
+  broadcast(&index,1);
+#if DICE_MPI
+  if(index<0){
+    Impl::Window window;
+    window.bytes = bytes;
+    // all of the memory is allocated by the leader, the rest of the processes only map it
+    const MPI_Aint size = impl->node_rank==0 ? (MPI_Aint)(window_header_bytes + bytes) : 0;
+    void * local_base = NULL;
+    TEUCHOS_TEST_FOR_EXCEPTION(MPI_Win_allocate_shared(size,1,MPI_INFO_NULL,impl->node_comm,&local_base,&window.win)!=MPI_SUCCESS,
+      std::runtime_error,"Error, could not allocate a node shared memory window of " << bytes << " bytes");
+    MPI_Aint query_size = 0;
+    int disp_unit = 0;
+    char * base = NULL;
+    MPI_Win_shared_query(window.win,0,&query_size,&disp_unit,&base);
+    if(impl->node_rank==0)
+      new (base) std::atomic<int>(0);
+    window.holders = reinterpret_cast<std::atomic<int>*>(base);
+    window.data = base + window_header_bytes;
+    impl->windows.push_back(window);
+    impl->shared_bytes += bytes;
+    index = impl->windows.size()-1;
+    // the count has to be set up before any process takes hold of the window
+    barrier();
+  }
+#endif
+  TEUCHOS_TEST_FOR_EXCEPTION(index<0||index>=(int_t)impl->windows.size(),std::runtime_error,
+    "Error, the node shared memory windows are not the same on all processes");
+  holders = impl->windows[index].holders;
+  holders->fetch_add(1);
+  return impl->windows[index].data;
+}
+
+void
+Node_Shared_Memory::clear(){
+#if DICE_MPI
+  Impl * impl = instance().impl_;
+  if(impl->node_size<=1) return;
+  // the windows that still have holders are left in place (they are released when the process exits)
+  std::vector<int_t> free_windows(impl->windows.size(),0);
+  if(impl->node_rank==0)
+    for(size_t i=0;i<impl->windows.size();++i)
+      free_windows[i] = impl->windows[i].holders->load()==0 ? 1 : 0;
+  if(!free_windows.empty())
+    broadcast(&free_windows[0],free_windows.size());
+  std::vector<Impl::Window> kept;
+  for(size_t i=0;i<impl->windows.size();++i){
+    if(free_windows[i]){
+      impl->shared_bytes -= impl->windows[i].bytes;
+      MPI_Win_free(&impl->windows[i].win);
+    }
+    else
+      kept.push_back(impl->windows[i]);
+  }
+  impl->windows.swap(kept);
+#endif
+}
+
+Teuchos::RCP<Image>
+read_node_shared_image(const std::string & file_name,
+  const Teuchos::RCP<Teuchos::ParameterList> & params){
+  if(!Node_Shared_Memory::is_shared())
+    return Teuchos::rcp(new Image(file_name.c_str(),params));
+  const bool leader = Node_Shared_Memory::is_node_leader();
+  Teuchos::RCP<Image> img;
+  // width, height, gradients stored, gauss filter mask size (0 if not filtered), gradient method
+  int_t header[5] = {0,0,0,0,0};
+  if(leader){
+    img = Teuchos::rcp(new Image(file_name.c_str(),params));
+    // the other processes can't fill in lazy gradient tiles of the shared arrays
+    img->compute_gradient_tiles();
+    header[0] = img->width();
+    header[1] = img->height();
+    header[2] = img->has_gradients() ? 1 : 0;
+    header[3] = img->has_gauss_filter() ? img->gauss_filter_mask_size() : 0;
+    header[4] = img->gradient_method();
+  }
+  Node_Shared_Memory::broadcast(header,5);
+  const int_t num_pixels = header[0]*header[1];
+  Teuchos::ArrayRCP<intensity_t> intensities = Node_Shared_Memory::allocate<intensity_t>(num_pixels);
+  Teuchos::ArrayRCP<scalar_t> grad_x = header[2] ? Node_Shared_Memory::allocate<scalar_t>(num_pixels) : Teuchos::ArrayRCP<scalar_t>();
+  Teuchos::ArrayRCP<scalar_t> grad_y = header[2] ? Node_Shared_Memory::allocate<scalar_t>(num_pixels) : Teuchos::ArrayRCP<scalar_t>();
+  if(leader){
+    Teuchos::ArrayRCP<intensity_t> img_intensities = img->intensities();
+    std::copy(img_intensities.begin(),img_intensities.begin()+num_pixels,intensities.begin());
+    if(header[2]){
+      Teuchos::ArrayRCP<scalar_t> img_grad_x = img->grad_x_array();
+      Teuchos::ArrayRCP<scalar_t> img_grad_y = img->grad_y_array();
+      std::copy(img_grad_x.begin(),img_grad_x.begin()+num_pixels,grad_x.begin());
+      std::copy(img_grad_y.begin(),img_grad_y.begin()+num_pixels,grad_y.begin());
+    }
+  }
+  Node_Shared_Memory::barrier();
+  if(!leader){
+    // the pixels were preprocessed by the leader
+    Teuchos::RCP<Teuchos::ParameterList> local_params = params==Teuchos::null ?
+        Teuchos::rcp(new Teuchos::ParameterList()) : Teuchos::rcp(new Teuchos::ParameterList(*params));
+    local_params->set(DICe::compute_image_gradients,false);
+    local_params->set(DICe::gauss_filter_images,false);
+    img = Teuchos::rcp(new Image(header[0],header[1],intensities,local_params));
+    std::string name = file_name;
+    img->set_file_name(name);
+  }
+  img->share_preprocessed_arrays(intensities,grad_x,grad_y,header[3],static_cast<Gradient_Method>(header[4]));
+  return img;
+}
+
+}// End DICe Namespace
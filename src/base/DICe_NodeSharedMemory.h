@@ -0,0 +1,186 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_NODESHAREDMEMORY_H
+#define DICE_NODESHAREDMEMORY_H
+
+#include <DICe.h>
+#include <DICe_ImageBufferPool.h>
+
+#include <Teuchos_ArrayRCP.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+class Image;
+
+/// \class DICe::Node_Shared_Memory
+/// \brief Arrays that are shared by all the MPI processes on a node
+///
+/// The arrays live in MPI-3 shared memory windows of a communicator that holds the processes
+/// of one node, so an image can be read by one process and used by all the processes on the node
+/// without a copy for each process. allocate() is collective over the processes of the node: they all
+/// have to call it in the same order with the same size, and they all get the same memory.
+/// Each window keeps a count (in the shared memory) of the processes that hold its array. Once all of
+/// them have released it, the window is handed out again by the next allocate() of the same size.
+/// MPI_Win_free is collective, so the windows are only freed by clear().
+///
+/// In builds without MPI, or if there is only one process on the node, the arrays come from the
+/// Image_Buffer_Pool and nothing is shared.
+class DICE_LIB_DLL_EXPORT
+Node_Shared_Memory{
+public:
+  /// returns an uninitialized array of n values that all processes on the node share (collective over the node)
+  /// \param n the number of values
+  template<typename T>
+  static Teuchos::ArrayRCP<T> allocate(const int_t n){
+    static_assert(std::is_trivially_copyable<T>::value,"Error, only trivially copyable types can be shared");
+    if(n<=0) return Teuchos::ArrayRCP<T>();
+    if(!is_shared()) return Image_Buffer_Pool::allocate<T>(n);
+    std::atomic<int> * holders = NULL;
+    T * data = static_cast<T*>(instance().take(n*sizeof(T),holders));
+    return Teuchos::arcp<T,Releaser<T> >(data,0,n,Releaser<T>(holders),true);
+  }
+
+  /// returns true if there is more than one process on this node
+  static bool is_shared(){
+    return node_size()>1;
+  }
+
+  /// returns the rank of this process among the processes on the node
+  static int_t node_rank();
+
+  /// returns the number of processes on the node
+  static int_t node_size();
+
+  /// returns true if this process reads the data that is shared with the rest of the node
+  static bool is_node_leader(){
+    return node_rank()==0;
+  }
+
+  /// wait for all the processes on the node, the values written to the shared arrays before the
+  /// barrier are visible to all processes after it
+  static void barrier();
+
+  /// send values from the node leader to the other processes on the node
+  /// \param values the values (input on the leader, output on the others)
+  /// \param count the number of values
+  static void broadcast(int_t * values,
+    const int_t count);
+
+  /// returns the number of bytes in the shared windows of this node
+  static size_t shared_bytes();
+
+  /// free the windows that no process holds an array from (collective over the node, called by DICe::finalize())
+  static void clear();
+
+private:
+  /// deallocation policy of the shared ArrayRCPs, releases this process's hold on the window
+  template<typename T>
+  class Releaser{
+  public:
+    /// type of the pointer (required by Teuchos)
+    typedef T ptr_t;
+    /// constructor
+    /// \param holders the count of processes that hold the window
+    explicit Releaser(std::atomic<int> * holders):
+      holders_(holders){}
+    /// release the hold on the window (the window is reused, never freed, here)
+    void free(T * ptr){
+      if(ptr&&holders_) holders_->fetch_sub(1);
+    }
+  private:
+    /// the count of processes that hold the window (in the shared memory)
+    std::atomic<int> * holders_;
+  };
+
+  /// constructor
+  Node_Shared_Memory();
+  /// not copyable
+  Node_Shared_Memory(const Node_Shared_Memory &);
+  /// not assignable
+  Node_Shared_Memory & operator=(const Node_Shared_Memory &);
+
+  /// returns the node communicator and windows (never destroyed, the windows are freed by clear())
+  static Node_Shared_Memory & instance();
+
+  /// returns the data of a free window of the given size, or of a new one, and holds it
+  /// \param bytes the size of the array in bytes
+  /// \param holders [out] the count of processes that hold the window
+  void * take(const size_t bytes,
+    std::atomic<int> * & holders);
+
+  /// opaque storage for the communicator and windows (MPI types are kept out of this header)
+  struct Impl;
+  /// the communicator and windows
+  Impl * impl_;
+};
+
+/// \brief Read an image file once per node and share its preprocessed pixels with every process on the node
+///
+/// The node leader reads the file and applies the preprocessing in the parameters (filter and
+/// gradients). The intensities and gradients are then moved to node shared arrays that all processes
+/// on the node wrap, so there is one copy of the pixels per node. The other processes don't read the
+/// file. Collective over the processes of the node. Without node shared memory this is the same as
+/// constructing the image from the file. The pixels of the returned image must not be changed
+/// (builds without Kokkos only).
+/// \param file_name the name of the image file
+/// \param params the image parameters
+DICE_LIB_DLL_EXPORT
+Teuchos::RCP<Image> read_node_shared_image(const std::string & file_name,
+  const Teuchos::RCP<Teuchos::ParameterList> & params);
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -0,0 +1,141 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_Profiler.h>
+
+#include <fstream>
+#include <iomanip>
+
+#if DICE_MPI
+#  include <mpi.h>
+#endif
+
+namespace DICe {
+
+bool Profiler::enabled_ = false;
+std::atomic<long long> Profiler::nanoseconds_[MAX_PROFILE_PHASE];
+std::atomic<long long> Profiler::calls_[MAX_PROFILE_PHASE];
+
+namespace {
+/// number of open timers for each phase on the calling thread
+thread_local int_t profile_depth[MAX_PROFILE_PHASE] = {0};
+}
+
+void
+Profiler::reset(){
+  for(int_t i=0;i<MAX_PROFILE_PHASE;++i){
+    nanoseconds_[i] = 0;
+    calls_[i] = 0;
+  }
+}
+
+bool
+Profiler::enter(const Profile_Phase phase){
+  return profile_depth[phase]++==0;
+}
+
+void
+Profiler::exit(const Profile_Phase phase,
+  const long long nanoseconds,
+  const bool outer_most){
+  profile_depth[phase]--;
+  if(!outer_most) return;
+  nanoseconds_[phase] += nanoseconds;
+  calls_[phase]++;
+}
+
+void
+Profiler::report(std::ostream & os,
+  const std::string & json_file_name){
+  double local_times[MAX_PROFILE_PHASE];
+  double local_calls[MAX_PROFILE_PHASE];
+  for(int_t i=0;i<MAX_PROFILE_PHASE;++i){
+    local_times[i] = time(static_cast<Profile_Phase>(i));
+    local_calls[i] = static_cast<double>(num_calls(static_cast<Profile_Phase>(i)));
+  }
+  double min_times[MAX_PROFILE_PHASE];
+  double max_times[MAX_PROFILE_PHASE];
+  double sum_times[MAX_PROFILE_PHASE];
+  double sum_calls[MAX_PROFILE_PHASE];
+  int_t proc_rank = 0;
+  int_t num_procs = 1;
+#if DICE_MPI
+  MPI_Comm_rank(MPI_COMM_WORLD,&proc_rank);
+  MPI_Comm_size(MPI_COMM_WORLD,&num_procs);
+  MPI_Allreduce(local_times,min_times,MAX_PROFILE_PHASE,MPI_DOUBLE,MPI_MIN,MPI_COMM_WORLD);
+  MPI_Allreduce(local_times,max_times,MAX_PROFILE_PHASE,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  MPI_Allreduce(local_times,sum_times,MAX_PROFILE_PHASE,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+  MPI_Allreduce(local_calls,sum_calls,MAX_PROFILE_PHASE,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+#else
+  for(int_t i=0;i<MAX_PROFILE_PHASE;++i){
+    min_times[i] = local_times[i];
+    max_times[i] = local_times[i];
+    sum_times[i] = local_times[i];
+    sum_calls[i] = local_calls[i];
+  }
+#endif
+  if(proc_rank!=0) return;
+
+  os << "Phase timing (seconds, min/avg/max over " << num_procs << " processor(s), nested phases are inclusive):" << std::endl;
+  os << std::setw(20) << std::left << "phase" << std::right << std::setw(14) << "calls" << std::setw(14) << "min"
+      << std::setw(14) << "avg" << std::setw(14) << "max" << std::endl;
+  for(int_t i=0;i<MAX_PROFILE_PHASE;++i){
+    os << std::setw(20) << std::left << profilePhaseStrings[i] << std::right << std::setw(14) << (long long)sum_calls[i]
+        << std::setw(14) << std::setprecision(4) << min_times[i] << std::setw(14) << sum_times[i]/num_procs
+        << std::setw(14) << max_times[i] << std::endl;
+  }
+  if(json_file_name.empty()) return;
+  std::ofstream json_file(json_file_name.c_str());
+  TEUCHOS_TEST_FOR_EXCEPTION(!json_file.good(),std::runtime_error,"Error, could not open the timing file " << json_file_name);
+  json_file << "{" << std::endl;
+  json_file << "  \"num_procs\": " << num_procs << "," << std::endl;
+  json_file << "  \"phases\": [" << std::endl;
+  for(int_t i=0;i<MAX_PROFILE_PHASE;++i){
+    json_file << "    {\"phase\": \"" << profilePhaseStrings[i] << "\", \"calls\": " << (long long)sum_calls[i]
+        << ", \"min\": " << min_times[i] << ", \"avg\": " << sum_times[i]/num_procs << ", \"max\": " << max_times[i]
+        << "}" << (i+1<MAX_PROFILE_PHASE ? "," : "") << std::endl;
+  }
+  json_file << "  ]" << std::endl;
+  json_file << "}" << std::endl;
+  json_file.close();
+}
+
+}// End DICe Namespace
@@ -0,0 +1,191 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#ifndef DICE_PROFILER_H
+#define DICE_PROFILER_H
+
+#include <DICe.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// The phases of the correlation hot path that are timed
+enum Profile_Phase{
+  PROFILE_IMAGE_LOAD=0,
+  PROFILE_PREPROCESS,
+  PROFILE_INITIAL_GUESS,
+  PROFILE_SUBSET_INITIALIZE,
+  PROFILE_HESSIAN_ASSEMBLY,
+  PROFILE_LINEAR_SOLVE,
+  PROFILE_SIMPLEX,
+  PROFILE_POST_PROCESS,
+  PROFILE_OUTPUT,
+  // DON'T ADD ANY BELOW MAX
+  MAX_PROFILE_PHASE
+};
+
+const static char * profilePhaseStrings[] = {
+  "IMAGE_LOAD",
+  "PREPROCESS",
+  "INITIAL_GUESS",
+  "SUBSET_INITIALIZE",
+  "HESSIAN_ASSEMBLY",
+  "LINEAR_SOLVE",
+  "SIMPLEX",
+  "POST_PROCESS",
+  "OUTPUT"
+};
+
+/// \class DICe::Profiler
+/// \brief Accumulates the time spent and the number of calls in each phase of the hot path
+///
+/// The timers are always compiled in, but they do nothing unless the profiler has been
+/// enabled at runtime, so a disabled timer costs a single branch. The times are inclusive:
+/// a phase nested inside another (e.g. the subset initialization inside the simplex) is also
+/// counted in the outer phase. Nested timers of the same phase are only counted once.
+class
+DICE_LIB_DLL_EXPORT
+Profiler{
+public:
+  /// returns true if the timers are recording
+  static bool enabled(){
+    return enabled_;
+  }
+
+  /// turn the timers on or off (should be called outside of any threaded region)
+  /// \param flag true if the timers should record
+  static void set_enabled(const bool flag){
+    enabled_ = flag;
+  }
+
+  /// zero all the accumulated times and counters
+  static void reset();
+
+  /// returns true if the phase is not already being timed on this thread
+  /// \param phase the phase that is starting
+  static bool enter(const Profile_Phase phase);
+
+  /// signal the end of a phase started with enter()
+  /// \param phase the phase that is ending
+  /// \param nanoseconds the elapsed time to record (only recorded for outer most timers)
+  /// \param outer_most the value returned by enter()
+  static void exit(const Profile_Phase phase,
+    const long long nanoseconds,
+    const bool outer_most);
+
+  /// returns the accumulated time in seconds for a phase on this processor
+  /// \param phase the phase
+  static double time(const Profile_Phase phase){
+    return nanoseconds_[phase].load()*1.0E-9;
+  }
+
+  /// returns the number of times a phase was timed on this processor
+  /// \param phase the phase
+  static long long num_calls(const Profile_Phase phase){
+    return calls_[phase].load();
+  }
+
+  /// reduce the timers across all processors and print a summary table
+  /// (collective when MPI is enabled, only processor 0 prints and writes the file)
+  /// \param os the stream to print the table to
+  /// \param json_file_name optional name of the json file to write the reduced timers to
+  static void report(std::ostream & os,
+    const std::string & json_file_name="");
+
+private:
+  /// true if the timers are recording
+  static bool enabled_;
+  /// accumulated time for each phase
+  static std::atomic<long long> nanoseconds_[MAX_PROFILE_PHASE];
+  /// number of calls for each phase
+  static std::atomic<long long> calls_[MAX_PROFILE_PHASE];
+};
+
+/// \class DICe::Scoped_Profile_Timer
+/// \brief Times the enclosing scope as the given phase of the hot path
+class
+DICE_LIB_DLL_EXPORT
+Scoped_Profile_Timer{
+public:
+  /// constructor
+  /// \param phase the phase the scope belongs to
+  Scoped_Profile_Timer(const Profile_Phase phase):
+    phase_(phase),
+    recording_(Profiler::enabled()),
+    outer_most_(false){
+    if(!recording_) return;
+    outer_most_ = Profiler::enter(phase_);
+    if(outer_most_)
+      start_ = std::chrono::steady_clock::now();
+  }
+
+  /// destructor records the elapsed time
+  ~Scoped_Profile_Timer(){
+    if(!recording_) return;
+    const long long elapsed = outer_most_ ?
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count() : 0;
+    Profiler::exit(phase_,elapsed,outer_most_);
+  }
+
+private:
+  /// the phase being timed
+  const Profile_Phase phase_;
+  /// true if the profiler was enabled when the scope started
+  const bool recording_;
+  /// true if this is not nested in another timer of the same phase
+  bool outer_most_;
+  /// start of the scope
+  std::chrono::steady_clock::time_point start_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
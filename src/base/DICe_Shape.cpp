@@ -44,9 +44,134 @@
 #include <DICe_LocalShapeFunction.h>
 
 #include <cassert>
+#include <algorithm>
+#include <iterator>
 
 namespace DICe {
 
+void
+Pixel_Bitmap::extend(const int_t min_x,
+  const int_t min_y,
+  const int_t max_x,
+  const int_t max_y){
+  if(max_x<min_x||max_y<min_y) return;
+  const bool has_box = width_>0&&height_>0;
+  if(has_box&&min_x>=min_x_&&max_x<min_x_+width_&&min_y>=min_y_&&max_y<min_y_+height_) return;
+  int_t new_min_x = min_x;
+  int_t new_min_y = min_y;
+  int_t new_max_x = max_x;
+  int_t new_max_y = max_y;
+  if(has_box){
+    new_min_x = std::min(new_min_x,min_x_);
+    new_min_y = std::min(new_min_y,min_y_);
+    new_max_x = std::max(new_max_x,min_x_+width_-1);
+    new_max_y = std::max(new_max_y,min_y_+height_-1);
+  }
+  const int_t new_width = new_max_x - new_min_x + 1;
+  const int_t new_height = new_max_y - new_min_y + 1;
+  const int_t num_words = (new_width*new_height+31)/32;
+  if(num_set_==0){
+    // nothing to copy so the existing storage can be reused
+    bits_.assign(num_words,0u);
+  }
+  else{
+    std::vector<unsigned int> new_bits(num_words,0u);
+    for(int_t y=0;y<height_;++y){
+      for(int_t x=0;x<width_;++x){
+        const int_t i = y*width_ + x;
+        if((bits_[i>>5]>>(i&31))&1u){
+          const int_t j = (y+min_y_-new_min_y)*new_width + x+min_x_-new_min_x;
+          new_bits[j>>5] |= 1u << (j&31);
+        }
+      }
+    }
+    bits_.swap(new_bits);
+  }
+  min_x_ = new_min_x;
+  min_y_ = new_min_y;
+  width_ = new_width;
+  height_ = new_height;
+}
+
+void
+Pixel_Bitmap::insert(const std::set<std::pair<int_t,int_t> > & coords){
+  if(coords.empty()) return;
+  // the set is ordered by y so the y extents are the first and last entries
+  int_t min_x = coords.begin()->second;
+  int_t max_x = min_x;
+  std::set<std::pair<int_t,int_t> >::const_iterator it = coords.begin();
+  for(;it!=coords.end();++it){
+    min_x = std::min(min_x,it->second);
+    max_x = std::max(max_x,it->second);
+  }
+  extend(min_x,coords.begin()->first,max_x,coords.rbegin()->first);
+  for(it=coords.begin();it!=coords.end();++it)
+    set(it->second,it->first);
+}
+
+/// map the (closed) list of polygon vertices with the shape function, apply the skin factor about the
+/// geometric centroid of the mapped vertices and compute the extents of the result
+static void
+map_polygon_vertices(const std::vector<int_t> & ref_verts_x,
+  const std::vector<int_t> & ref_verts_y,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t cx,
+  const int_t cy,
+  const scalar_t skin_factor,
+  std::vector<int_t> & verts_x,
+  std::vector<int_t> & verts_y,
+  int_t & min_x,
+  int_t & min_y,
+  int_t & max_x,
+  int_t & max_y){
+  assert(shape_function!=Teuchos::null);
+  verts_x.resize(ref_verts_x.size());
+  verts_y.resize(ref_verts_y.size());
+  scalar_t X=0.0,Y=0.0;
+  int_t new_x=0,new_y=0;
+  for(size_t i=0;i<ref_verts_x.size();++i){
+    int_t x = ref_verts_x[i];
+    int_t y = ref_verts_y[i];
+    // iterate over all the pixels in the reference blocking subset and compute the current position
+    shape_function->map(x,y,cx,cy,X,Y);
+    new_x = (int_t)X;
+    if(X - (int_t)X >= 0.5) new_x++;
+    new_y = (int_t)Y;
+    if(Y - (int_t)Y >= 0.5) new_y++;
+    verts_x[i] = new_x;
+    verts_y[i] = new_y;
+  }
+  // compute the geometric centroid of the new vertices:
+  int_t centroid_x = 0;
+  int_t centroid_y = 0;
+  for(size_t i=0;i<verts_x.size()-1;++i){
+    centroid_x+=verts_x[i];
+    centroid_y+=verts_y[i];
+  }
+  centroid_x /= verts_x.size()-1==0.0?1.0:(verts_x.size()-1);
+  centroid_y /= verts_y.size()-1==0.0?1.0:(verts_y.size()-1);
+  // apply the skin factor
+  for(size_t i=0;i<verts_x.size();++i){
+    // add the skin to the new vertex (applied as a stretch in x and y):
+    new_x = skin_factor*(verts_x[i] - centroid_x) + centroid_x;
+    new_y = skin_factor*(verts_y[i] - centroid_y) + centroid_y;
+    verts_x[i] = new_x;
+    verts_y[i] = new_y;
+    if(i==0){
+      min_x = new_x;
+      max_x = new_x;
+      min_y = new_y;
+      max_y = new_y;
+    }
+    else{
+      if(new_x < min_x){min_x = new_x;}
+      if(new_x > max_x){max_x = new_x;}
+      if(new_y < min_y){min_y = new_y;}
+      if(new_y > max_y){max_y = new_y;}
+    }
+  } // vertex_loop
+}
+
 Polygon::Polygon(std::vector<int_t> & coords_x,
   std::vector<int_t> & coords_y):
   vertex_coordinates_x_(coords_x),
@@ -101,6 +226,195 @@ angle_2d(const scalar_t & x1,
   return(dtheta);
 }
 
+bool
+polygon_contains(const std::vector<int_t> & verts_x,
+  const std::vector<int_t> & verts_y,
+  const int_t num_vertices,
+  const int_t x,
+  const int_t y){
+  int_t winding_number = 0;
+  for(int_t i=0;i<num_vertices;++i){
+    const int_t x0 = verts_x[i];
+    const int_t y0 = verts_y[i];
+    const int_t x1 = verts_x[i+1];
+    const int_t y1 = verts_y[i+1];
+    // which side of the edge the point is on (zero if colinear)
+    const int_t side = (x1-x0)*(y-y0) - (x-x0)*(y1-y0);
+    if(side==0&&x>=std::min(x0,x1)&&x<=std::max(x0,x1)&&y>=std::min(y0,y1)&&y<=std::max(y0,y1)){
+      // the point is on the boundary, use the sum of the angles so the edge pixels are the same as before
+      scalar_t angle = 0.0;
+      for(int_t j=0;j<num_vertices;++j){
+        angle += angle_2d(verts_x[j]-x,verts_y[j]-y,verts_x[j+1]-x,verts_y[j+1]-y);
+      }
+      return std::abs(angle) >= DICE_PI;
+    }
+    if(y0<=y){
+      if(y1>y&&side>0) winding_number++;
+    }
+    else{
+      if(y1<=y&&side<0) winding_number--;
+    }
+  }
+  // away from the boundary the angle sum is 2*pi times the winding number
+  return winding_number!=0;
+}
+
+/// integer division rounded toward positive infinity (den must be positive)
+static int_t
+ceil_div(const int_t num,
+  const int_t den){
+  assert(den>0);
+  return num >= 0 ? (num + den - 1)/den : -((-num)/den);
+}
+
+/// Scanline fill of one row of a closed polygon, gives the same result as calling polygon_contains() for each pixel
+/// in the row. Away from the boundary the winding number only changes where an edge crosses the row so it is
+/// accumulated from the sorted crossings. Pixels that lie exactly on an edge use polygon_contains() so that the
+/// edge pixels match the angle sum test.
+/// \param verts_x the x vertices of the polygon (the first vertex must be repeated at the end)
+/// \param verts_y the y vertices of the polygon (the first vertex must be repeated at the end)
+/// \param num_vertices the number of vertices (not counting the repeated one)
+/// \param y the row
+/// \param min_x the first x coordinate of the row
+/// \param max_x the last x coordinate of the row
+/// \param crossings work storage for the (first x to the right of the crossing, winding contribution) pairs
+/// \param boundary work storage for the x coordinates of the pixels on an edge
+/// \param inside [out] flag for each pixel in the row (true if the pixel is in the polygon)
+static void
+polygon_row(const std::vector<int_t> & verts_x,
+  const std::vector<int_t> & verts_y,
+  const int_t num_vertices,
+  const int_t y,
+  const int_t min_x,
+  const int_t max_x,
+  std::vector<std::pair<int_t,int_t> > & crossings,
+  std::vector<int_t> & boundary,
+  std::vector<char> & inside){
+  crossings.clear();
+  boundary.clear();
+  inside.assign(max_x-min_x+1,0);
+  for(int_t i=0;i<num_vertices;++i){
+    const int_t x0 = verts_x[i];
+    const int_t y0 = verts_y[i];
+    const int_t x1 = verts_x[i+1];
+    const int_t y1 = verts_y[i+1];
+    if(y<std::min(y0,y1)||y>std::max(y0,y1)) continue;
+    if(y0==y1){
+      // horizontal (or degenerate) edge, every pixel along it is on the boundary
+      for(int_t x=std::max(min_x,std::min(x0,x1));x<=std::min(max_x,std::max(x0,x1));++x)
+        boundary.push_back(x);
+      continue;
+    }
+    // the edge crosses the row at x0 + num/den
+    int_t num = (x1-x0)*(y-y0);
+    int_t den = y1-y0;
+    if(den<0){num=-num;den=-den;}
+    if(num%den==0) boundary.push_back(x0 + num/den);
+    // same half open rule as polygon_contains(), the edge adds to the winding number of the pixels left of the crossing
+    if(y0<=y&&y1>y) crossings.push_back(std::pair<int_t,int_t>(x0 + ceil_div(num,den),1));
+    else if(y1<=y&&y0>y) crossings.push_back(std::pair<int_t,int_t>(x0 + ceil_div(num,den),-1));
+  }
+  std::sort(crossings.begin(),crossings.end());
+  int_t winding_number = 0;
+  for(size_t i=0;i<crossings.size();++i)
+    winding_number += crossings[i].second;
+  size_t next = 0;
+  for(int_t x=min_x;x<=max_x;++x){
+    while(next<crossings.size()&&crossings[next].first<=x){
+      winding_number -= crossings[next].second;
+      next++;
+    }
+    inside[x-min_x] = winding_number!=0;
+  }
+  for(size_t i=0;i<boundary.size();++i){
+    const int_t x = boundary[i];
+    if(x<min_x||x>max_x) continue;
+    inside[x-min_x] = polygon_contains(verts_x,verts_y,num_vertices,x,y);
+  }
+}
+
+/// insert the pixels of a closed polygon into a set using a scanline fill
+static void
+fill_polygon(const std::vector<int_t> & verts_x,
+  const std::vector<int_t> & verts_y,
+  const int_t num_vertices,
+  const int_t min_x,
+  const int_t min_y,
+  const int_t max_x,
+  const int_t max_y,
+  std::set<std::pair<int_t,int_t> > & coords){
+  std::vector<std::pair<int_t,int_t> > crossings;
+  std::vector<int_t> boundary;
+  std::vector<char> inside;
+  for(int_t y=min_y;y<=max_y;++y){
+    polygon_row(verts_x,verts_y,num_vertices,y,min_x,max_x,crossings,boundary,inside);
+    for(int_t x=min_x;x<=max_x;++x){
+      // the pixels are visited in order so the end of the set is always the insertion point
+      if(inside[x-min_x]) coords.insert(coords.end(),std::pair<int_t,int_t>(y,x));
+    }
+  }
+}
+
+/// set the pixels of a closed polygon in a bitmap using a scanline fill
+static void
+fill_polygon(const std::vector<int_t> & verts_x,
+  const std::vector<int_t> & verts_y,
+  const int_t num_vertices,
+  const int_t min_x,
+  const int_t min_y,
+  const int_t max_x,
+  const int_t max_y,
+  Pixel_Bitmap & bitmap){
+  bitmap.extend(min_x,min_y,max_x,max_y);
+  std::vector<std::pair<int_t,int_t> > crossings;
+  std::vector<int_t> boundary;
+  std::vector<char> inside;
+  for(int_t y=min_y;y<=max_y;++y){
+    polygon_row(verts_x,verts_y,num_vertices,y,min_x,max_x,crossings,boundary,inside);
+    int_t x = min_x;
+    while(x<=max_x){
+      if(!inside[x-min_x]){++x;continue;}
+      const int_t run_begin = x;
+      while(x<=max_x&&inside[x-min_x]) ++x;
+      bitmap.set_row(run_begin,x-1,y);
+    }
+  }
+}
+
+const std::vector<std::pair<int_t,int_t> > &
+Shape::reference_pixels()const{
+  // subsets can be constructed on several threads and share shapes
+#if defined(_OPENMP)
+#pragma omp critical (dice_shape_reference_pixels)
+#endif
+  {
+    if(!has_reference_pixels_){
+      const std::set<std::pair<int_t,int_t> > pixels = get_owned_pixels();
+      reference_pixels_.assign(pixels.begin(),pixels.end());
+      has_reference_pixels_ = true;
+    }
+  }
+  return reference_pixels_;
+}
+
+void
+reference_pixels(const multi_shape & shapes,
+  std::vector<std::pair<int_t,int_t> > & pixels){
+  pixels.clear();
+  if(shapes.size()==1){
+    pixels = shapes[0]->reference_pixels();
+    return;
+  }
+  std::vector<std::pair<int_t,int_t> > merged;
+  for(size_t i=0;i<shapes.size();++i){
+    const std::vector<std::pair<int_t,int_t> > & shape_pixels = shapes[i]->reference_pixels();
+    merged.clear();
+    merged.reserve(pixels.size()+shape_pixels.size());
+    std::set_union(pixels.begin(),pixels.end(),shape_pixels.begin(),shape_pixels.end(),std::back_inserter(merged));
+    pixels.swap(merged);
+  }
+}
+
 void
 Polygon::deactivate_pixels(const int_t size,
   bool * pixel_flags,
@@ -144,78 +458,34 @@ Polygon::get_owned_pixels(Teuchos::RCP<Local_Shape_Function> shape_function,
   int_t min_y = min_y_;
   int_t max_x = max_x_;
   int_t max_y = max_y_;
-
   if(shape_function!=Teuchos::null){
-    scalar_t X=0.0,Y=0.0;
-    int_t new_x=0,new_y=0;
-    for(size_t i=0;i<vertex_coordinates_x_.size();++i){
-      int_t x = vertex_coordinates_x_[i];
-      int_t y = vertex_coordinates_y_[i];
-      // iterate over all the pixels in the reference blocking subset and compute the current position
-      shape_function->map(x,y,cx,cy,X,Y);
-      new_x = (int_t)X;
-      if(X - (int_t)X >= 0.5) new_x++;
-      new_y = (int_t)Y;
-      if(Y - (int_t)Y >= 0.5) new_y++;
-      verts_x[i] = new_x;
-      verts_y[i] = new_y;
-    }
-    // compute the geometric centroid of the new vertices:
-    int_t centroid_x = 0;
-    int_t centroid_y = 0;
-    for(size_t i=0;i<verts_x.size()-1;++i){
-      centroid_x+=verts_x[i];
-      centroid_y+=verts_y[i];
-    }
-    centroid_x /= verts_x.size()-1==0.0?1.0:(verts_x.size()-1);
-    centroid_y /= verts_y.size()-1==0.0?1.0:(verts_y.size()-1);
-    // apply the skin factor
-    for(size_t i=0;i<verts_x.size();++i){
-      // add the skin to the new vertex (applied as a stretch in x and y):
-      new_x = skin_factor*(verts_x[i] - centroid_x) + centroid_x;
-      new_y = skin_factor*(verts_y[i] - centroid_y) + centroid_y;
-      verts_x[i] = new_x;
-      verts_y[i] = new_y;
-      if(i==0){
-        min_x = new_x;
-        max_x = new_x;
-        min_y = new_y;
-        max_y = new_y;
-      }
-      else{
-        if(new_x < min_x){min_x = new_x;}
-        if(new_x > max_x){max_x = new_x;}
-        if(new_y < min_y){min_y = new_y;}
-        if(new_y > max_y){max_y = new_y;}
-      }
-    } // vertex_loop
+    map_polygon_vertices(vertex_coordinates_x_,vertex_coordinates_y_,shape_function,cx,cy,skin_factor,
+      verts_x,verts_y,min_x,min_y,max_x,max_y);
   }
 
   std::set<std::pair<int_t,int_t> > coordSet;
+  fill_polygon(verts_x,verts_y,num_vertices_,min_x,min_y,max_x,max_y,coordSet);
+  return coordSet;
+}
 
-  scalar_t dx1=0,dx2=0,dy1=0,dy2=0;
-  scalar_t angle=0;
-  // rip over the points in the extents of the polygon to determine which onese are inside
-  for(int_t y=min_y;y<=max_y;++y){
-    for(int_t x=min_x;x<=max_x;++x){
-      // x and y are the global coordinates of the point to test
-      angle=0.0;
-      for (int_t i=0;i<num_vertices_;i++) {
-        // get the two end points of the polygon side and construct
-        // a vector from the point to each one:
-        dx1 = verts_x[i] - x;
-        dy1 = verts_y[i] - y;
-        dx2 = verts_x[i+1] - x;
-        dy2 = verts_y[i+1] - y;
-        angle += angle_2d(dx1,dy1,dx2,dy2);
-      }
-      // if the angle is greater than PI, the point is in the polygon
-      if(std::abs(angle) >= DICE_PI){
-        coordSet.insert(std::pair<int_t,int_t>(y,x));
-      }
-    }
+void
+Polygon::rasterize(Pixel_Bitmap & bitmap,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t cx,
+  const int_t cy,
+  const scalar_t skin_factor)const{
+
+  std::vector<int_t> verts_x = vertex_coordinates_x_;
+  std::vector<int_t> verts_y = vertex_coordinates_y_;
+  int_t min_x = min_x_;
+  int_t min_y = min_y_;
+  int_t max_x = max_x_;
+  int_t max_y = max_y_;
+  if(shape_function!=Teuchos::null){
+    map_polygon_vertices(vertex_coordinates_x_,vertex_coordinates_y_,shape_function,cx,cy,skin_factor,
+      verts_x,verts_y,min_x,min_y,max_x,max_y);
   }
-  return coordSet;
+  fill_polygon(verts_x,verts_y,num_vertices_,min_x,min_y,max_x,max_y,bitmap);
 }
 
 Circle::Circle(const int_t centroid_x,
@@ -223,7 +493,7 @@ Circle::Circle(const int_t centroid_x,
   const scalar_t & radius):
   centroid_x_(centroid_x),
   centroid_y_(centroid_y),
-  //radius_(radius),
+  radius_(radius),
   radius2_(radius*radius)
 {
   assert(centroid_x_>0);
@@ -271,13 +541,33 @@ Circle::get_owned_pixels(Teuchos::RCP<Local_Shape_Function> shape_function,
       dx = (x-centroid_x_)*(x-centroid_x_);
       dy = (y-centroid_y_)*(y-centroid_y_);
       if(dx + dy <= radius2_){
-        coordSet.insert(std::pair<int_t,int_t>(y,x));
+        coordSet.insert(coordSet.end(),std::pair<int_t,int_t>(y,x));
       }
     }
   }
   return coordSet;
 }
 
+void
+Circle::rasterize(Pixel_Bitmap & bitmap,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t cx,
+  const int_t cy,
+  const scalar_t skin_factor)const{
+  TEUCHOS_TEST_FOR_EXCEPTION(shape_function!=Teuchos::null,std::runtime_error,"Error, circle deformation has not been implemented yet");
+  bitmap.extend(min_x_,min_y_,max_x_,max_y_);
+  // each row of the circle is a single run of pixels
+  for(int_t y=min_y_;y<=max_y_;++y){
+    const scalar_t dy = (y-centroid_y_)*(y-centroid_y_);
+    if(dy > radius2_) continue;
+    int_t half_width = (int_t)std::sqrt(radius2_ - dy);
+    // guard against round off in the square root so the test matches get_owned_pixels exactly
+    while((scalar_t)((half_width+1)*(half_width+1)) + dy <= radius2_) half_width++;
+    while(half_width>0&&(scalar_t)(half_width*half_width) + dy > radius2_) half_width--;
+    bitmap.set_row(std::max(min_x_,centroid_x_-half_width),std::min(max_x_,centroid_x_+half_width),y);
+  }
+}
+
 Rectangle::Rectangle(const int_t centroid_x,
   const int_t centroid_y,
   const int_t width,
@@ -329,97 +619,70 @@ Rectangle::get_owned_pixels(Teuchos::RCP<Local_Shape_Function> shape_function,
     int_t min_y = 0;
     int_t max_x = 0;
     int_t max_y = 0;
-    scalar_t X=0.0,Y=0.0;
-    int_t new_x=0,new_y=0;
-    std::vector<int_t> vertex_coordinates_x(5,0.0);
-    std::vector<int_t> vertex_coordinates_y(5,0.0);
-    std::vector<int_t> verts_x(5,0.0);
-    std::vector<int_t> verts_y(5,0.0);
-    vertex_coordinates_x[0] = origin_x_;
-    vertex_coordinates_x[1] = origin_x_ + width_;
-    vertex_coordinates_x[2] = origin_x_ + width_;
-    vertex_coordinates_x[3] = origin_x_;
-    vertex_coordinates_x[4] = origin_x_;
-    vertex_coordinates_y[0] = origin_y_;
-    vertex_coordinates_y[1] = origin_y_;
-    vertex_coordinates_y[2] = origin_y_ + height_;
-    vertex_coordinates_y[3] = origin_y_ + height_;
-    vertex_coordinates_y[4] = origin_y_;
-
-    for(size_t i=0;i<vertex_coordinates_x.size();++i){
-      int_t x = vertex_coordinates_x[i];
-      int_t y = vertex_coordinates_y[i];
-      shape_function->map(x,y,cx,cy,X,Y);
-      // iterate over all the pixels in the reference blocking subset and compute the current position
-      new_x = (int_t)X;
-      if(X - (int_t)X >= 0.5) new_x++;
-      new_y = (int_t)Y;
-      if(Y - (int_t)Y >= 0.5) new_y++;
-      verts_x[i] = new_x;
-      verts_y[i] = new_y;
-    } // vertex loop
-    // compute the geometric centroid of the new vertices:
-    int_t centroid_x = 0;
-    int_t centroid_y = 0;
-    for(size_t i=0;i<verts_x.size()-1;++i){
-      centroid_x+=verts_x[i];
-      centroid_y+=verts_y[i];
-    }
-    centroid_x /= verts_x.size()-1==0.0?1.0:(verts_x.size()-1);
-    centroid_y /= verts_y.size()-1==0.0?1.0:(verts_y.size()-1);
-    // apply the skin factor
-    for(size_t i=0;i<verts_x.size();++i){
-      // add the skin to the new vertex (applied as a stretch in x and y):
-      new_x = skin_factor*(verts_x[i] - centroid_x) + centroid_x;
-      new_y = skin_factor*(verts_y[i] - centroid_y) + centroid_y;
-      verts_x[i] = new_x;
-      verts_y[i] = new_y;
-      if(i==0){
-        min_x = new_x;
-        max_x = new_x;
-        min_y = new_y;
-        max_y = new_y;
-      }
-      else{
-        if(new_x < min_x){min_x = new_x;}
-        if(new_x > max_x){max_x = new_x;}
-        if(new_y < min_y){min_y = new_y;}
-        if(new_y > max_y){max_y = new_y;}
-      }
-    } // vertex_loop
-
-    scalar_t dx1=0,dx2=0,dy1=0,dy2=0;
-    scalar_t angle=0;
-    // rip over the points in the extents of the polygon to determine which onese are inside
-    for(int_t y=min_y;y<=max_y;++y){
-      for(int_t x=min_x;x<=max_x;++x){
-        // x and y are the global coordinates of the point to test
-        angle=0.0;
-        for (int_t i=0;i<4;i++) {
-          // get the two end points of the polygon side and construct
-          // a vector from the point to each one:
-          dx1 = verts_x[i] - x;
-          dy1 = verts_y[i] - y;
-          dx2 = verts_x[i+1] - x;
-          dy2 = verts_y[i+1] - y;
-          angle += angle_2d(dx1,dy1,dx2,dy2);
-        }
-        // if the angle is greater than PI, the point is in the polygon
-        if(std::abs(angle) >= DICE_PI){
-          coordSet.insert(std::pair<int_t,int_t>(y,x));
-        }
-      }
-    }
+    std::vector<int_t> verts_x;
+    std::vector<int_t> verts_y;
+    deformed_vertices(shape_function,cx,cy,skin_factor,verts_x,verts_y,min_x,min_y,max_x,max_y);
+    fill_polygon(verts_x,verts_y,4,min_x,min_y,max_x,max_y,coordSet);
   } // has deformation
   else{
     // rip over the points in the extents of the circle to determine which onese are inside
     for(int_t y=0;y<height_;++y){
       for(int_t x=0;x<width_;++x){
-        coordSet.insert(std::pair<int_t,int_t>(origin_y_+y,origin_x_+x));
+        coordSet.insert(coordSet.end(),std::pair<int_t,int_t>(origin_y_+y,origin_x_+x));
       }
     }
   }
   return coordSet;
 }
 
+void
+Rectangle::rasterize(Pixel_Bitmap & bitmap,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t cx,
+  const int_t cy,
+  const scalar_t skin_factor)const{
+  if(shape_function!=Teuchos::null){
+    int_t min_x = 0;
+    int_t min_y = 0;
+    int_t max_x = 0;
+    int_t max_y = 0;
+    std::vector<int_t> verts_x;
+    std::vector<int_t> verts_y;
+    deformed_vertices(shape_function,cx,cy,skin_factor,verts_x,verts_y,min_x,min_y,max_x,max_y);
+    fill_polygon(verts_x,verts_y,4,min_x,min_y,max_x,max_y,bitmap);
+  }
+  else{
+    bitmap.extend(origin_x_,origin_y_,origin_x_+width_-1,origin_y_+height_-1);
+    for(int_t y=0;y<height_;++y)
+      bitmap.set_row(origin_x_,origin_x_+width_-1,origin_y_+y);
+  }
+}
+
+void
+Rectangle::deformed_vertices(Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t cx,
+  const int_t cy,
+  const scalar_t skin_factor,
+  std::vector<int_t> & verts_x,
+  std::vector<int_t> & verts_y,
+  int_t & min_x,
+  int_t & min_y,
+  int_t & max_x,
+  int_t & max_y)const{
+  std::vector<int_t> vertex_coordinates_x(5,0.0);
+  std::vector<int_t> vertex_coordinates_y(5,0.0);
+  vertex_coordinates_x[0] = origin_x_;
+  vertex_coordinates_x[1] = origin_x_ + width_;
+  vertex_coordinates_x[2] = origin_x_ + width_;
+  vertex_coordinates_x[3] = origin_x_;
+  vertex_coordinates_x[4] = origin_x_;
+  vertex_coordinates_y[0] = origin_y_;
+  vertex_coordinates_y[1] = origin_y_;
+  vertex_coordinates_y[2] = origin_y_ + height_;
+  vertex_coordinates_y[3] = origin_y_ + height_;
+  vertex_coordinates_y[4] = origin_y_;
+  map_polygon_vertices(vertex_coordinates_x,vertex_coordinates_y,shape_function,cx,cy,skin_factor,
+    verts_x,verts_y,min_x,min_y,max_x,max_y);
+}
+
 }// End DICe Namespace
@@ -48,12 +48,126 @@
 #include <Teuchos_ArrayRCP.hpp>
 
 #include <set>
+#include <vector>
 #include <cassert>
 
 namespace DICe {
 
 class Local_Shape_Function;
 
+/// \class DICe::Pixel_Bitmap
+/// \brief Occupancy grid of global pixel coordinates stored as one bit per pixel over a bounding box
+///
+/// Used in place of a std::set of pixel coordinates when many lookups are needed, for example to
+/// test if a mapped pixel is blocked by another subset. Lookups are constant time and the bounding box
+/// grows as needed when pixels outside of it are inserted.
+
+class DICE_LIB_DLL_EXPORT
+Pixel_Bitmap {
+public:
+  /// constructor (creates an empty bitmap)
+  Pixel_Bitmap():
+    min_x_(0),
+    min_y_(0),
+    width_(0),
+    height_(0),
+    num_set_(0){};
+
+  /// remove all the pixels and the bounding box (the storage is kept for reuse)
+  void clear(){
+    min_x_ = 0;
+    min_y_ = 0;
+    width_ = 0;
+    height_ = 0;
+    num_set_ = 0;
+    bits_.clear();
+  }
+
+  /// returns true if no pixels are set
+  bool empty()const{
+    return num_set_==0;
+  }
+
+  /// returns the number of pixels that are set
+  int_t size()const{
+    return num_set_;
+  }
+
+  /// grow the bounding box (if necessary) so that it includes the given extents
+  /// \param min_x minimum global x coordinate
+  /// \param min_y minimum global y coordinate
+  /// \param max_x maximum global x coordinate (inclusive)
+  /// \param max_y maximum global y coordinate (inclusive)
+  void extend(const int_t min_x,
+    const int_t min_y,
+    const int_t max_x,
+    const int_t max_y);
+
+  /// set a pixel, the bounding box must already contain it (see extend())
+  /// \param x global x coordinate
+  /// \param y global y coordinate
+  void set(const int_t x,
+    const int_t y){
+    assert(x>=min_x_&&x<min_x_+width_&&y>=min_y_&&y<min_y_+height_);
+    const int_t i = (y-min_y_)*width_ + x-min_x_;
+    const unsigned int mask = 1u << (i&31);
+    if(!(bits_[i>>5]&mask)){
+      bits_[i>>5] |= mask;
+      num_set_++;
+    }
+  }
+
+  /// set a horizontal run of pixels, the bounding box must already contain them
+  /// \param x_begin first global x coordinate
+  /// \param x_end last global x coordinate (inclusive)
+  /// \param y global y coordinate
+  void set_row(const int_t x_begin,
+    const int_t x_end,
+    const int_t y){
+    for(int_t x=x_begin;x<=x_end;++x)
+      set(x,y);
+  }
+
+  /// set a pixel, growing the bounding box if needed
+  /// \param x global x coordinate
+  /// \param y global y coordinate
+  void insert(const int_t x,
+    const int_t y){
+    extend(x,y,x,y);
+    set(x,y);
+  }
+
+  /// set all the pixels in a set of coordinates
+  /// \param coords the coordinates, NOTE: the pairs are (y,x) as returned by Shape::get_owned_pixels()
+  void insert(const std::set<std::pair<int_t,int_t> > & coords);
+
+  /// returns true if the pixel is set
+  /// \param x global x coordinate
+  /// \param y global y coordinate
+  bool contains(const int_t x,
+    const int_t y)const{
+    const int_t lx = x - min_x_;
+    const int_t ly = y - min_y_;
+    if(lx<0||lx>=width_||ly<0||ly>=height_) return false;
+    const int_t i = ly*width_ + lx;
+    return (bits_[i>>5]>>(i&31))&1u;
+  }
+
+private:
+  /// minimum global x coordinate of the bounding box
+  int_t min_x_;
+  /// minimum global y coordinate of the bounding box
+  int_t min_y_;
+  /// width of the bounding box
+  int_t width_;
+  /// height of the bounding box
+  int_t height_;
+  /// number of pixels set
+  int_t num_set_;
+  /// bits for each pixel in the bounding box (row major)
+  std::vector<unsigned int> bits_;
+};
+
 /// \class DICe::Shape
 /// \brief Generic class for defining regions in an image
 ///
@@ -67,9 +181,16 @@ class Local_Shape_Function;
 class DICE_LIB_DLL_EXPORT
 Shape {
 public:
-  Shape(){};
+  Shape():
+    has_reference_pixels_(false){};
   virtual ~Shape(){};
 
+  /// \brief Returns the pixels interior to this shape in the reference configuration (same pixels as get_owned_pixels())
+  /// The pixels are computed on the first call and cached on the shape so that shapes that are shared or
+  /// queried repeatedly (decomposition weights, subset construction, masks, etc.) are only rasterized once.
+  /// NOTE: The pairs are (y,x) and are sorted in the same order as the set returned by get_owned_pixels()
+  const std::vector<std::pair<int_t,int_t> > & reference_pixels()const;
+
   /// \brief Returns a set of the coordinates of all pixels interior to this shape.
   /// NOTE: The pair is (y,x) not (x,y) so that the ordering in the set will match with loops over y then x
   /// \param shape_function Optional mapping to the deformed shape, otherwise reference map is used
@@ -85,6 +206,22 @@ public:
     return nullSet;
   }
 
+  /// \brief Sets all the pixels interior to this shape in a bitmap (same pixels as get_owned_pixels())
+  /// The default implementation inserts the result of get_owned_pixels(), derived classes
+  /// write directly to the bitmap
+  /// \param bitmap [out] the bitmap to add the pixels to (the existing pixels are not removed)
+  /// \param shape_function Optional mapping to the deformed shape, otherwise reference map is used
+  /// \param cx Optional x centroid of the map
+  /// \param cy Optional y centroid of the map
+  /// \param skin_factor Optional padding added to the outside of the shape to make it larger or smaller
+  virtual void rasterize(Pixel_Bitmap & bitmap,
+    Teuchos::RCP<Local_Shape_Function> shape_function=Teuchos::null,
+    const int_t cx=0,
+    const int_t cy=0,
+    const scalar_t skin_factor=1.0)const{
+    bitmap.insert(get_owned_pixels(shape_function,cx,cy,skin_factor));
+  }
+
   /// \brief Method used to turn pixels off that fall inside the shape.
   /// Mostly called in the construction of a conformal subset to turn off interior regions to the subset.
   /// \param pixel_flags [out] An array of bools true means the pixel is still active false means that
@@ -100,6 +237,12 @@ public:
     int_t * y_coords) const{
     assert(false && "  DICe ERROR: Base class implementation of this method should not be called.");
   }
+
+private:
+  /// true if the reference pixels have been computed
+  mutable bool has_reference_pixels_;
+  /// cached (y,x) pixels interior to the shape in the reference configuration
+  mutable std::vector<std::pair<int_t,int_t> > reference_pixels_;
 };
 
 ///
@@ -134,6 +277,13 @@ public:
     const int_t cy=0,
     const scalar_t skin_factor=1.0)const;
 
+  /// See base class documentation
+  virtual void rasterize(Pixel_Bitmap & bitmap,
+    Teuchos::RCP<Local_Shape_Function> shape_function=Teuchos::null,
+    const int_t cx=0,
+    const int_t cy=0,
+    const scalar_t skin_factor=1.0)const;
+
   /// See base class documentation
   virtual void deactivate_pixels(const int_t size,
     bool * pixel_flags,
@@ -205,6 +355,21 @@ scalar_t angle_2d(const scalar_t & x1,
   const scalar_t & x2,
   const scalar_t & y2);
 
+/// \brief Returns true if the integer point is inside the closed polygon or on its boundary
+/// This gives the same result as summing the angles from the point to each side (angle_2d)
+/// but uses the integer winding number so it is much cheaper
+/// \param verts_x the x vertices of the polygon (the first vertex must be repeated at the end)
+/// \param verts_y the y vertices of the polygon (the first vertex must be repeated at the end)
+/// \param num_vertices the number of vertices (not counting the repeated one)
+/// \param x the x coordinate of the point
+/// \param y the y coordinate of the point
+DICE_LIB_DLL_EXPORT
+bool polygon_contains(const std::vector<int_t> & verts_x,
+  const std::vector<int_t> & verts_y,
+  const int_t num_vertices,
+  const int_t x,
+  const int_t y);
+
 
 ///
 /// \class DICe::Circle
@@ -229,19 +394,41 @@ public:
     const int_t cy=0,
     const scalar_t skin_factor=1.0)const;
 
+  /// See base class documentation
+  virtual void rasterize(Pixel_Bitmap & bitmap,
+    Teuchos::RCP<Local_Shape_Function> shape_function=Teuchos::null,
+    const int_t cx=0,
+    const int_t cy=0,
+    const scalar_t skin_factor=1.0)const;
+
   /// See base class documentation
   virtual void deactivate_pixels(const int_t size,
     bool * pixel_flags,
     int_t * x_coords,
     int_t * y_coords) const;
 
+  /// return the global x-coordinate of the center
+  int_t centroid_x()const{
+    return centroid_x_;
+  }
+
+  /// return the global y-coordinate of the center
+  int_t centroid_y()const{
+    return centroid_y_;
+  }
+
+  /// return the radius
+  scalar_t radius()const{
+    return radius_;
+  }
+
 private:
   /// Center of the circle global x-coordinate
   int_t centroid_x_;
   /// Center of the circle global y-coordinate
   int_t centroid_y_;
   /// Radius of the circle
-  //scalar_t radius_;
+  scalar_t radius_;
   /// Radius of the circle squared
   scalar_t radius2_;
   /// Minimum x global coordinate of the circle
@@ -279,13 +466,52 @@ public:
     const int_t cy=0,
     const scalar_t skin_factor=1.0)const;
 
+  /// See base class documentation
+  virtual void rasterize(Pixel_Bitmap & bitmap,
+    Teuchos::RCP<Local_Shape_Function> shape_function=Teuchos::null,
+    const int_t cx=0,
+    const int_t cy=0,
+    const scalar_t skin_factor=1.0)const;
+
   /// See base class documentation
   virtual void deactivate_pixels(const int_t size,
     bool * pixel_flags,
     int_t * x_coords,
     int_t * y_coords) const;
 
+  /// return the global x-coordinate of the center
+  int_t centroid_x()const{
+    return centroid_x_;
+  }
+
+  /// return the global y-coordinate of the center
+  int_t centroid_y()const{
+    return centroid_y_;
+  }
+
+  /// return the width
+  int_t width()const{
+    return width_;
+  }
+
+  /// return the height
+  int_t height()const{
+    return height_;
+  }
+
 private:
+  /// compute the vertices (and their extents) of the mapped rectangle with the skin factor applied
+  void deformed_vertices(Teuchos::RCP<Local_Shape_Function> shape_function,
+    const int_t cx,
+    const int_t cy,
+    const scalar_t skin_factor,
+    std::vector<int_t> & verts_x,
+    std::vector<int_t> & verts_y,
+    int_t & min_x,
+    int_t & min_y,
+    int_t & max_x,
+    int_t & max_y)const;
+
   /// Center global x-coordinate
   int_t centroid_x_;
   /// Center global y-coordinate
@@ -303,6 +529,13 @@ private:
 /// A vector that stores a collection of pointers to shapes, used as a way to associate shapes into a larger object.
 typedef std::vector<Teuchos::RCP<Shape> > multi_shape;
 
+/// \brief Collects the reference pixels of all the shapes in a multi_shape (the union of Shape::reference_pixels())
+/// \param shapes the shapes to collect the pixels from
+/// \param pixels [out] sorted and unique (y,x) pairs, in the same order as a std::set of the pixels
+DICE_LIB_DLL_EXPORT
+void reference_pixels(const multi_shape & shapes,
+  std::vector<std::pair<int_t,int_t> > & pixels);
+
 /// \class DICe::Conformal_Area_Def
 /// \brief A simple container for geometry information defining the boundary of a DICe::Subset.
 ///
@@ -0,0 +1,128 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_SharedFrameCache.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <sstream>
+
+namespace DICe {
+
+Shared_Frame_Cache::Shared_Frame_Cache():
+  capacity_(0),
+  num_hits_(0){}
+
+Shared_Frame_Cache &
+Shared_Frame_Cache::instance(){
+  static Shared_Frame_Cache * cache = new Shared_Frame_Cache();
+  return *cache;
+}
+
+Teuchos::RCP<Image>
+Shared_Frame_Cache::frame(const std::string & file_name,
+  const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height,
+  const Teuchos::RCP<Teuchos::ParameterList> & params){
+  Shared_Frame_Cache & cache = instance();
+  std::lock_guard<std::mutex> lock(cache.mutex_);
+  if(cache.capacity_<=0){
+    if(width<0) return Teuchos::rcp(new Image(file_name.c_str(),params));
+    return Teuchos::rcp(new Image(file_name.c_str(),offset_x,offset_y,width,height,params));
+  }
+  // the frame is only shared if it was read with exactly the same parameters
+  std::stringstream key;
+  key << file_name << "|";
+  if(width>=0) key << offset_x << "," << offset_y << "," << width << "," << height;
+  key << "|";
+  if(params!=Teuchos::null)
+    params->print(key,0,true,false);
+  const std::string key_str = key.str();
+  for(std::list<std::pair<std::string,Teuchos::RCP<Image> > >::iterator it=cache.frames_.begin();it!=cache.frames_.end();++it){
+    if(it->first!=key_str) continue;
+    cache.frames_.splice(cache.frames_.begin(),cache.frames_,it);
+    cache.num_hits_++;
+    DEBUG_MSG("Shared_Frame_Cache::frame(): sharing the preprocessed frame " << file_name);
+    return cache.frames_.front().second;
+  }
+  // the frame is read while the lock is held so that concurrent requests for the same frame read it once
+  Teuchos::RCP<Image> img = width<0 ? Teuchos::rcp(new Image(file_name.c_str(),params)) :
+      Teuchos::rcp(new Image(file_name.c_str(),offset_x,offset_y,width,height,params));
+  cache.frames_.push_front(std::pair<std::string,Teuchos::RCP<Image> >(key_str,img));
+  while((int_t)cache.frames_.size()>cache.capacity_)
+    cache.frames_.pop_back();
+  return img;
+}
+
+void
+Shared_Frame_Cache::set_capacity(const int_t num_frames){
+  TEUCHOS_TEST_FOR_EXCEPTION(num_frames<0,std::invalid_argument,"Error, the shared frame cache capacity must be >= 0");
+  Shared_Frame_Cache & cache = instance();
+  std::lock_guard<std::mutex> lock(cache.mutex_);
+  cache.capacity_ = num_frames;
+  while((int_t)cache.frames_.size()>cache.capacity_)
+    cache.frames_.pop_back();
+}
+
+int_t
+Shared_Frame_Cache::capacity(){
+  Shared_Frame_Cache & cache = instance();
+  std::lock_guard<std::mutex> lock(cache.mutex_);
+  return cache.capacity_;
+}
+
+long long
+Shared_Frame_Cache::num_hits(){
+  Shared_Frame_Cache & cache = instance();
+  std::lock_guard<std::mutex> lock(cache.mutex_);
+  return cache.num_hits_;
+}
+
+void
+Shared_Frame_Cache::clear(){
+  Shared_Frame_Cache & cache = instance();
+  std::lock_guard<std::mutex> lock(cache.mutex_);
+  cache.frames_.clear();
+}
+
+}// End DICe Namespace
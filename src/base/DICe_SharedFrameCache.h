@@ -0,0 +1,126 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_SHAREDFRAMECACHE_H
+#define DICE_SHAREDFRAMECACHE_H
+
+#include <DICe.h>
+#include <DICe_Image.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+namespace DICe {
+
+/// \class DICe::Shared_Frame_Cache
+/// \brief Keeps the most recently read and preprocessed frames so that every consumer of the same
+/// source frame (the schemas of a stereo analysis, or the sub images of the motion windows) gets
+/// the same image instead of decoding, filtering and computing the gradients again
+///
+/// A frame is only shared if the file, the region of the file and all of the image parameters match.
+/// The consumers must treat the images as read only, anything that filters the pixels in place
+/// (for example the motion tests on the raw pixels) has to read its own copy.
+/// The cache is off until set_capacity() is called with a positive number of frames.
+class DICE_LIB_DLL_EXPORT
+Shared_Frame_Cache{
+public:
+  /// \brief returns the preprocessed frame, read from the file if it is not in the cache
+  /// \param file_name the name of the file
+  /// \param offset_x the upper left corner x-coordinate of the region (ignored if width is negative)
+  /// \param offset_y the upper left corner y-coordinate of the region (ignored if width is negative)
+  /// \param width the width of the region, negative for the whole frame
+  /// \param height the height of the region, negative for the whole frame
+  /// \param params the image parameters the frame is constructed with
+  static Teuchos::RCP<Image> frame(const std::string & file_name,
+    const int_t offset_x,
+    const int_t offset_y,
+    const int_t width,
+    const int_t height,
+    const Teuchos::RCP<Teuchos::ParameterList> & params);
+
+  /// set the number of frames kept in the cache (0 turns the cache off and releases the frames)
+  /// \param num_frames the number of frames
+  static void set_capacity(const int_t num_frames);
+
+  /// returns the number of frames kept in the cache
+  static int_t capacity();
+
+  /// returns the number of frames handed out from the cache rather than read
+  static long long num_hits();
+
+  /// releases all of the frames in the cache
+  static void clear();
+
+private:
+  /// constructor
+  Shared_Frame_Cache();
+  /// not copyable
+  Shared_Frame_Cache(const Shared_Frame_Cache &);
+  /// not assignable
+  Shared_Frame_Cache & operator=(const Shared_Frame_Cache &);
+
+  /// returns the cache (never destroyed, the frames are released by clear() in DICe::finalize())
+  static Shared_Frame_Cache & instance();
+
+  /// guards the frames
+  std::mutex mutex_;
+  /// the frames with their key, most recently used first
+  std::list<std::pair<std::string,Teuchos::RCP<Image> > > frames_;
+  /// the most frames kept
+  int_t capacity_;
+  /// number of frames handed out from the cache
+  long long num_hits_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
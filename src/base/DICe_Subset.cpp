@@ -41,11 +41,19 @@
 
 #include <DICe_Subset.h>
 #include <DICe_ImageIO.h>
+#include <DICe_Profiler.h>
 #if DICE_KOKKOS
   #include <DICe_Kokkos.h>
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <exception>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace DICe {
 
@@ -58,11 +66,7 @@ Subset::is_obstructed_pixel(const scalar_t & coord_x,
   int_t c_y = (int_t)coord_y;
   if(coord_y - (int_t)coord_y >= 0.5) c_y++;
   // now check if c_x and c_y are obstructed
-  // Note the x and y coordinates are switched because that is how they live in the set
-  // this was done for performance in loops over y then x
-  std::pair<int_t,int_t> point(c_y,c_x);
-  const bool obstructed = obstructed_coords_.find(point)!=obstructed_coords_.end();
-  return obstructed;
+  return obstructed_coords_.contains(c_x,c_y);
 }
 
 std::set<std::pair<int_t,int_t> >
@@ -72,6 +76,13 @@ Subset::deformed_shapes(Teuchos::RCP<Local_Shape_Function> shape_function,
   const scalar_t & skin_factor){
   std::set<std::pair<int_t,int_t> > coords;
   if(!is_conformal_) return coords;
+  if(shape_function==Teuchos::null){
+    // the reference pixels are cached on the shapes (and are already sorted in set order)
+    std::vector<std::pair<int_t,int_t> > pixels;
+    reference_pixels(*conformal_subset_def_.boundary(),pixels);
+    coords.insert(pixels.begin(),pixels.end());
+    return coords;
+  }
   for(size_t i=0;i<conformal_subset_def_.boundary()->size();++i){
     std::set<std::pair<int_t,int_t> > shapeCoords =
         (*conformal_subset_def_.boundary())[i]->get_owned_pixels(shape_function,cx,cy,skin_factor);
@@ -80,33 +91,52 @@ Subset::deformed_shapes(Teuchos::RCP<Local_Shape_Function> shape_function,
   return coords;
 }
 
+void
+Subset::rasterize_deformed_shapes(Pixel_Bitmap & bitmap,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const int_t cx,
+  const int_t cy,
+  const scalar_t & skin_factor){
+  if(!is_conformal_) return;
+  for(size_t i=0;i<conformal_subset_def_.boundary()->size();++i){
+    (*conformal_subset_def_.boundary())[i]->rasterize(bitmap,shape_function,cx,cy,skin_factor);
+  }
+}
+
 void
 Subset::turn_off_obstructed_pixels(Teuchos::RCP<Local_Shape_Function> shape_function){
   assert(shape_function!=Teuchos::null);
 
-  scalar_t X=0.0,Y=0.0;
-  int_t px=0,py=0;
+  const bool has_obstructions = !obstructed_coords_.empty();
   const bool has_blocks = !pixels_blocked_by_other_subsets_.empty();
   reset_is_deactivated_this_step();
 
-  for(int_t i=0;i<num_pixels_;++i){
-    shape_function->map(x(i),y(i),cx_,cy_,X,Y);
-    if(is_obstructed_pixel(X,Y)){
-      is_deactivated_this_step(i) = true;
-    }
-    else{
-      is_deactivated_this_step(i) = false;
-    }
-    // pixels blocked by other subsets:
-    if(has_blocks){
-      px = ((int_t)(X + 0.5) == (int_t)(X)) ? (int_t)(X) : (int_t)(X) + 1;
-      py = ((int_t)(Y + 0.5) == (int_t)(Y)) ? (int_t)(Y) : (int_t)(Y) + 1;
-      if(pixels_blocked_by_other_subsets_.find(std::pair<int_t,int_t>(py,px))
-          !=pixels_blocked_by_other_subsets_.end()){
-        is_deactivated_this_step(i) = true;
-      }
+  // the obstructed and blocked pixels are both rasterized into bitmaps in image coordinates, so once the
+  // subset is mapped (one call to the shape function for all the pixels) each test is a single lookup
+  if(has_obstructions||has_blocks){
+    static thread_local std::vector<scalar_t> mapped_x;
+    static thread_local std::vector<scalar_t> mapped_y;
+    if((int_t)mapped_x.size()<num_pixels_){
+      mapped_x.resize(num_pixels_);
+      mapped_y.resize(num_pixels_);
     }
-  } // pixel loop
+#if DICE_KOKKOS
+    for(int_t i=0;i<num_pixels_;++i)
+      shape_function->map(x(i),y(i),cx_,cy_,mapped_x[i],mapped_y[i]);
+#else
+    shape_function->batch_map(num_pixels_,x_.getRawPtr(),y_.getRawPtr(),cx_,cy_,&mapped_x[0],&mapped_y[0]);
+#endif
+    for(int_t i=0;i<num_pixels_;++i){
+      const scalar_t & X = mapped_x[i];
+      const scalar_t & Y = mapped_y[i];
+      // nearest pixel (same rounding as is_obstructed_pixel())
+      const int_t px = X - (int_t)X >= 0.5 ? (int_t)X + 1 : (int_t)X;
+      const int_t py = Y - (int_t)Y >= 0.5 ? (int_t)Y + 1 : (int_t)Y;
+      if((has_obstructions&&obstructed_coords_.contains(px,py))
+          ||(has_blocks&&pixels_blocked_by_other_subsets_.contains(px,py)))
+        set_is_deactivated_this_step(i,true);
+    } // pixel loop
+  }
 #if DICE_KOKKOS
   is_deactivated_this_step_.modify<host_space>();
   is_deactivated_this_step_.sync<device_space>();
@@ -117,15 +147,45 @@ void
 Subset::turn_on_previously_obstructed_pixels(){
   // this assumes that the is_deactivated_this_step_ flags have already been set correctly prior
   // to calling this method.
+#if DICE_KOKKOS
+  // the reference intensities are modified below so they can't be read from the image
+  unshare_ref_intensities();
   for(int_t px=0;px<num_pixels_;++px){
     // it's not obstructed this step, but was inactive to begin with
     if(!is_deactivated_this_step(px) && !is_active(px)){
       // take the pixel value from the deformed subset
       ref_intensities(px) = def_intensities(px);
       // set the active bit to true
-      is_active(px) = true;
+      set_is_active(px,true);
+    }
+  }
+#else
+  // once a subset has evolved most frames have no newly visible pixels, so the masks are scanned
+  // a word at a time and the reference intensities are only touched for the pixels that change
+  // (the deformed intensities are the ones interpolated for the final solution of this frame)
+  bool evolved = false;
+  const int_t num_words = pixel_mask_size(num_pixels_);
+  for(int_t word=0;word<num_words;++word){
+    // it's not obstructed this step, but was inactive to begin with
+    const pixel_mask_t bits = ~is_active_[word] & ~is_deactivated_this_step_[word];
+    if(bits==0) continue;
+    const int_t begin = word*pixel_mask_bits;
+    const int_t end = std::min(begin+pixel_mask_bits,num_pixels_);
+    for(int_t px=begin;px<end;++px){
+      if(((bits >> (px-begin)) & 1u)==0) continue;
+      // the reference intensities are modified so they can't be read from the image any more
+      if(!evolved){
+        unshare_ref_intensities();
+        evolved = true;
+      }
+      ref_intensities_[px] = def_intensities_[px];
+      is_active_[word] |= 1u << (px-begin);
     }
   }
+  // the steepest descent images depend on the reference intensities
+  if(evolved)
+    has_steepest_descent_ = false;
+#endif
 }
 
 void
@@ -200,6 +260,35 @@ Subset::write_tiff(const std::string & file_name,
   delete[] intensities;
 }
 
+void
+Subset::update_memory_usage(){
+  // the pixel arrays (the host mirrors of the Kokkos views are not counted separately)
+#if DICE_KOKKOS
+  const size_t flag_bytes = 2*num_pixels_*sizeof(bool);
+#else
+  const size_t flag_bytes = 2*pixel_mask_size(num_pixels_)*sizeof(pixel_mask_t);
+#endif
+  // shared reference intensities belong to the image
+  const size_t num_intensity_arrays = ref_is_shared_ ? 1 : 2;
+  memory_.set(num_pixels_*(num_intensity_arrays*sizeof(intensity_t)+2*sizeof(scalar_t)+2*sizeof(int_t)) + flag_bytes +
+    (steepest_descent_.size()+steepest_descent_hessian_.size())*sizeof(double));
+}
+
+void
+Subset::request_gradient_tiles(const Teuchos::RCP<Image> & image)const{
+  if(image->num_pending_gradient_tiles()==0||num_pixels_==0) return;
+  int_t min_x = x(0), max_x = x(0);
+  int_t min_y = y(0), max_y = y(0);
+  for(int_t i=1;i<num_pixels_;++i){
+    min_x = std::min(min_x,x(i));
+    max_x = std::max(max_x,x(i));
+    min_y = std::min(min_y,y(i));
+    max_y = std::max(max_y,y(i));
+  }
+  image->compute_gradient_tiles(min_x-image->offset_x(),min_y-image->offset_y(),
+    max_x-image->offset_x(),max_y-image->offset_y());
+}
+
 int_t
 Subset::num_active_pixels(){
   int_t num_active = 0;
@@ -210,6 +299,122 @@ Subset::num_active_pixels(){
   return num_active;
 }
 
+void
+Subset::batch_gamma(Teuchos::RCP<Image> image,
+  const int_t num_functions,
+  const Teuchos::RCP<Local_Shape_Function> * shape_functions,
+  scalar_t * gamma_values,
+  const Interpolation_Method interp,
+  const int_t num_threads){
+  Scoped_Profile_Timer init_timer(PROFILE_SUBSET_INITIALIZE);
+  TEUCHOS_TEST_FOR_EXCEPTION(image==Teuchos::null,std::invalid_argument,"Error, the image must be defined");
+  if(num_functions<=0) return;
+  TEUCHOS_TEST_FOR_EXCEPTION(shape_functions==NULL||gamma_values==NULL,std::invalid_argument,
+    "Error, the shape function and gamma arrays must be allocated");
+  const int_t offset_x = image->offset_x();
+  const int_t offset_y = image->offset_y();
+  const int_t w = image->width();
+  const int_t h = image->height();
+  const bool has_blocks = !pixels_blocked_by_other_subsets_.empty();
+  // the pixel coordinates, persistent active flags and reference intensities are the same for every shape function
+  std::vector<int_t> px_x(num_pixels_);
+  std::vector<int_t> px_y(num_pixels_);
+  std::vector<bool> px_active(num_pixels_);
+  std::vector<intensity_t> px_ref(num_pixels_);
+  for(int_t i=0;i<num_pixels_;++i){
+    px_x[i] = x(i);
+    px_y[i] = y(i);
+    px_active[i] = is_active(i);
+    px_ref[i] = ref_intensities(i);
+  }
+  Image * img = image.get();
+  const scalar_t ox=(scalar_t)offset_x,oy=(scalar_t)offset_y;
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr eval_error;
+#ifdef _OPENMP
+  const bool in_parallel = omp_in_parallel()!=0;
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads) if(num_threads>1&&num_functions>1&&!in_parallel)
+#endif
+  for(int_t k=0;k<num_functions;++k){
+    try{
+      // scratch storage is reused by each thread
+      static thread_local std::vector<scalar_t> mapped_x;
+      static thread_local std::vector<scalar_t> mapped_y;
+      static thread_local std::vector<scalar_t> local_x;
+      static thread_local std::vector<scalar_t> local_y;
+      static thread_local std::vector<int_t> in_use;
+      static thread_local std::vector<intensity_t> def;
+      if((int_t)mapped_x.size()<num_pixels_){
+        mapped_x.resize(num_pixels_);
+        mapped_y.resize(num_pixels_);
+        local_x.resize(num_pixels_);
+        local_y.resize(num_pixels_);
+        in_use.resize(num_pixels_);
+        def.resize(num_pixels_);
+      }
+      shape_functions[k]->batch_map(num_pixels_,&px_x[0],&px_y[0],cx_,cy_,&mapped_x[0],&mapped_y[0]);
+      // same deactivation tests as initialize(), pixels that aren't active are skipped since they don't contribute
+      int_t num_in_use = 0;
+      for(int_t i=0;i<num_pixels_;++i){
+        if(!px_active[i]) continue;
+        const scalar_t & mx = mapped_x[i];
+        const scalar_t & my = mapped_y[i];
+        const int_t px = ((int_t)(mx + 0.5) == (int_t)(mx)) ? (int_t)(mx) : (int_t)(mx) + 1;
+        const int_t py = ((int_t)(my + 0.5) == (int_t)(my)) ? (int_t)(my) : (int_t)(my) + 1;
+        if(px<offset_x+4||px>=offset_x+w-4||py<offset_y+4||py>=offset_y+h-4) continue;
+        if(is_obstructed_pixel(mx,my)) continue;
+        if(has_blocks&&pixels_blocked_by_other_subsets_.contains(px,py)) continue;
+        local_x[num_in_use] = mx-ox;
+        local_y[num_in_use] = my-oy;
+        in_use[num_in_use] = i;
+        num_in_use++;
+      }
+      if(num_in_use>0)
+        img->batch_interpolate(num_in_use,&local_x[0],&local_y[0],&def[0],NULL,NULL,interp);
+      // the same arithmetic as mean() and gamma() so the values match the single evaluation
+      accumulate_t sum_ref = 0.0;
+      accumulate_t sum_def = 0.0;
+      for(int_t j=0;j<num_in_use;++j){
+        sum_ref += px_ref[in_use[j]];
+        sum_def += def[j];
+      }
+      const scalar_t mean_ref = num_in_use != 0 ? sum_ref/num_in_use : 0.0;
+      const scalar_t mean_def = num_in_use != 0 ? sum_def/num_in_use : 0.0;
+      accumulate_t sum_sq_ref = 0.0;
+      accumulate_t sum_sq_def = 0.0;
+      accumulate_t diff = 0.0;
+      for(int_t j=0;j<num_in_use;++j){
+        diff = px_ref[in_use[j]]-mean_ref;
+        sum_sq_ref += diff*diff;
+        diff = def[j]-mean_def;
+        sum_sq_def += diff*diff;
+      }
+      const scalar_t mean_sum_ref = std::sqrt(sum_sq_ref);
+      const scalar_t mean_sum_def = std::sqrt(sum_sq_def);
+      if(mean_sum_ref==0.0||mean_sum_def==0.0){
+        gamma_values[k] = -1.0;
+        continue;
+      }
+      accumulate_t gamma = 0.0;
+      accumulate_t value = 0.0;
+      for(int_t j=0;j<num_in_use;++j){
+        value = (accumulate_t)(def[j]-mean_def)/mean_sum_def - (accumulate_t)(px_ref[in_use[j]]-mean_ref)/mean_sum_ref;
+        gamma += value*value;
+      }
+      gamma_values[k] = gamma;
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_subset_batch_gamma_error)
+#endif
+      {
+        if(!eval_error) eval_error = std::current_exception();
+      }
+    }
+  }
+  if(eval_error) std::rethrow_exception(eval_error);
+}
+
 scalar_t
 Subset::contrast_std_dev(){
   const scalar_t mean_intensity = mean(DEF_INTENSITIES);
@@ -225,6 +430,43 @@ Subset::contrast_std_dev(){
   return std_dev;
 }
 
+void
+Subset::initialize_steepest_descent(Teuchos::RCP<Image> image,
+  Teuchos::RCP<Local_Shape_Function> shape_function){
+  assert(image!=Teuchos::null);
+  assert(shape_function!=Teuchos::null);
+  TEUCHOS_TEST_FOR_EXCEPTION(!image->has_gradients(),std::runtime_error,
+    "Error, the image gradients are needed to compute the steepest descent images");
+  const int_t N = shape_function->num_params();
+  const int_t offset_x = image->offset_x();
+  const int_t offset_y = image->offset_y();
+  request_gradient_tiles(image);
+  if(N!=num_steepest_descent_params_||(int_t)steepest_descent_.size()!=num_pixels_*N){
+    num_steepest_descent_params_ = N;
+    steepest_descent_ = Teuchos::ArrayRCP<double>(num_pixels_*N,0.0);
+    steepest_descent_hessian_ = Teuchos::ArrayRCP<double>(N*N,0.0);
+    update_memory_usage();
+  }
+  for(int_t i=0;i<N*N;++i)
+    steepest_descent_hessian_[i] = 0.0;
+  std::vector<scalar_t> residuals(N,0.0);
+  const scalar_t cx = cx_;
+  const scalar_t cy = cy_;
+  for(int_t px=0;px<num_pixels_;++px){
+    for(int_t i=0;i<N;++i)
+      residuals[i] = 0.0;
+    // the shape function is the identity so the residuals are the gradient times the warp jacobian at p = 0
+    shape_function->residuals(x(px),y(px),cx,cy,image->grad_x(x(px)-offset_x,y(px)-offset_y),
+      image->grad_y(x(px)-offset_x,y(px)-offset_y),residuals,false);
+    for(int_t i=0;i<N;++i){
+      steepest_descent_[px*N+i] = residuals[i];
+      for(int_t j=0;j<N;++j)
+        steepest_descent_hessian_[i*N+j] += (accumulate_t)residuals[i]*residuals[j];
+    }
+  }
+  has_steepest_descent_ = true;
+}
+
 scalar_t
 Subset::noise_std_dev(Teuchos::RCP<Image> image,
   Teuchos::RCP<Local_Shape_Function> shape_function){
@@ -46,6 +46,7 @@
 #include <DICe_Shape.h>
 #include <DICe_Image.h>
 #include <DICe_LocalShapeFunction.h>
+#include <DICe_MemoryTracker.h>
 #if DICE_KOKKOS
   #include <DICe_Kokkos.h>
 #endif
@@ -59,6 +60,18 @@
 /// generic DICe classes and functions
 namespace DICe {
 
+/// storage word for the per-pixel flags of a subset (one bit per pixel)
+typedef unsigned int pixel_mask_t;
+
+/// number of pixel flags held by each mask word
+const int_t pixel_mask_bits = 8*sizeof(pixel_mask_t);
+
+/// returns the number of mask words needed to hold a flag for each pixel
+/// \param num_pixels the number of pixels
+inline int_t pixel_mask_size(const int_t num_pixels){
+  return (num_pixels + pixel_mask_bits - 1)/pixel_mask_bits;
+}
+
 /// \class DICe::Subset
 /// \brief Subsets are used to store temporary collections of pixels for comparison between the
 /// reference and deformed images. The data that is stored by a subset is a list of x and y
@@ -165,10 +178,39 @@ public:
   /// \param target the initialization mode (put the values in the ref or def intensities)
   /// \param shape_function contains the deformation map (optional)
   /// \param interp interpolation method (optional)
+  /// \param sample_stride if greater than one, only the pixels with (x + y) divisible by the stride are
+  /// mapped and interpolated for the deformed intensities, the rest are deactivated for this step so they
+  /// are left out of the reductions (ignored without a shape function and in builds with Kokkos)
   void initialize(Teuchos::RCP<Image> image,
     const Subset_View_Target target=REF_INTENSITIES,
     Teuchos::RCP<Local_Shape_Function> shape_function=Teuchos::null,
-    const Interpolation_Method interp=KEYS_FOURTH);
+    const Interpolation_Method interp=KEYS_FOURTH,
+    const int_t sample_stride=1);
+
+  /// \brief Read the reference intensities directly from the reference image instead of a private copy
+  ///
+  /// The reference image is read-only for the life of the subset, so overlapping subsets can all read
+  /// from the same array. The gradients are copied as they are in initialize() because the gradient
+  /// arrays are overwritten by the deformed intensities. The image array is held until the subset is
+  /// destroyed or initialized again. If any pixel falls outside the image, or in builds with Kokkos, this
+  /// is the same as calling initialize(image).
+  /// Note: ref_intensities(i) must not be assigned to while the intensities are shared
+  /// \param image the reference image
+  void share_ref_intensities(Teuchos::RCP<Image> image);
+
+  /// returns true if the reference intensities are read from the reference image
+  bool has_shared_ref_intensities()const{
+    return ref_is_shared_;
+  }
+
+  /// \brief Shift a non-conformal subset to a new centroid, keeping the pixel storage
+  ///
+  /// The pixel flags are reset and the gradients and steepest descent images are marked stale,
+  /// so the subset has to be initialized from the reference image again before it is used.
+  /// \param cx the new centroid x coordinate
+  /// \param cy the new centroid y coordinate
+  void move_to(const int_t cx,
+    const int_t cy);
 
   /// write the subset intensity values to a tif file
   /// \param file_name the name of the tif file to write
@@ -197,6 +239,25 @@ public:
   /// returns the ZNSSD gamma correlation value between the reference and deformed subsets
   scalar_t gamma();
 
+  /// \brief Evaluates gamma for several shape functions without changing the deformed intensities
+  ///
+  /// Each value is the same as calling initialize() for the deformed intensities followed by gamma(),
+  /// but only the intensities are interpolated (not the gradients) and the deactivated pixel flags of
+  /// the subset are left alone. The shape functions are evaluated on separate threads if num_threads > 1
+  /// and the call is not already inside a parallel region.
+  /// \param image the deformed image
+  /// \param num_functions the number of shape functions
+  /// \param shape_functions array of the shape functions to evaluate
+  /// \param gamma_values [out] one gamma value per shape function (must be allocated by the caller)
+  /// \param interp the interpolation method
+  /// \param num_threads the number of threads to use
+  void batch_gamma(Teuchos::RCP<Image> image,
+    const int_t num_functions,
+    const Teuchos::RCP<Local_Shape_Function> * shape_functions,
+    scalar_t * gamma_values,
+    const Interpolation_Method interp=KEYS_FOURTH,
+    const int_t num_threads=1);
+
   /// returns the SSSIG value for the reference intensities
   scalar_t sssig();
 
@@ -204,13 +265,25 @@ public:
   void reset_is_active();
 
   /// returns true if this pixel is active
-  bool & is_active(const int_t pixel_index);
+  bool is_active(const int_t pixel_index)const;
+
+  /// set the is_active flag for a pixel
+  /// \param pixel_index the pixel id
+  /// \param value true if the pixel is active
+  void set_is_active(const int_t pixel_index,
+    const bool value);
 
   /// returns the number of active pixels in the subset
   int_t num_active_pixels();
 
   /// returns true if this pixel is deactivated for this particular frame
-  bool & is_deactivated_this_step(const int_t pixel_index);
+  bool is_deactivated_this_step(const int_t pixel_index)const;
+
+  /// set the is_deactivated_this_step flag for a pixel
+  /// \param pixel_index the pixel id
+  /// \param value true if the pixel is deactivated for this frame
+  void set_is_deactivated_this_step(const int_t pixel_index,
+    const bool value);
 
   /// reset the is_deactivated_this_step bool for each pixel to false
   void reset_is_deactivated_this_step();
@@ -247,6 +320,51 @@ public:
   /// \brief Returns the std deviation of the image intensity values
   scalar_t contrast_std_dev();
 
+  /// \brief Compute the steepest descent images and the Hessian of the reference subset for the
+  /// inverse compositional Gauss-Newton method
+  ///
+  /// These only depend on the reference intensities so they are stored and reused for all iterations and all
+  /// frames until the reference intensities change. The Hessian includes every pixel in the subset, inactive
+  /// or deactivated pixels have to be removed by the caller.
+  /// \param image the reference image (the gradients are taken from the image because the subset gradients
+  /// are overwritten each time the deformed intensities are initialized)
+  /// \param shape_function defines the degrees of freedom (must be set to the identity map)
+  void initialize_steepest_descent(Teuchos::RCP<Image> image,
+    Teuchos::RCP<Local_Shape_Function> shape_function);
+
+  /// returns true if the steepest descent images are current
+  bool has_steepest_descent()const{
+    return has_steepest_descent_;
+  }
+
+  /// signal that the steepest descent images need to be recomputed
+  void reset_steepest_descent(){
+    has_steepest_descent_ = false;
+  }
+
+  /// returns the number of shape function parameters the steepest descent images were computed for
+  int_t num_steepest_descent_params()const{
+    return num_steepest_descent_params_;
+  }
+
+  /// steepest descent image accessor
+  /// \param pixel_index the pixel id
+  /// \param param the shape function parameter index
+  /// note there is no bounds checking
+  const double & steepest_descent(const int_t pixel_index,
+    const int_t param)const{
+    return steepest_descent_[pixel_index*num_steepest_descent_params_+param];
+  }
+
+  /// reference Hessian accessor
+  /// \param i row index
+  /// \param j column index
+  /// note there is no bounds checking
+  const double & steepest_descent_hessian(const int_t i,
+    const int_t j)const{
+    return steepest_descent_hessian_[i*num_steepest_descent_params_+j];
+  }
+
   /// \brief EXPERIMENTAL Check the deformed position of the pixel to see if it falls inside an obstruction, if so, turn it off
   /// \param shape_function contains the deformation map (optional)
   ///
@@ -275,8 +393,8 @@ public:
   bool is_obstructed_pixel(const scalar_t & coord_x,
     const scalar_t & coord_y)const;
 
-  /// \brief EXPERIMENTAL Returns a pointer to the set of pixels currently obstructed by another subset
-  std::set<std::pair<int_t,int_t> > * pixels_blocked_by_other_subsets(){
+  /// \brief EXPERIMENTAL Returns a pointer to the bitmap of pixels currently obstructed by another subset
+  Pixel_Bitmap * pixels_blocked_by_other_subsets(){
     return & pixels_blocked_by_other_subsets_;
   }
 
@@ -286,6 +404,19 @@ public:
     const int_t cy=0,
     const scalar_t & skin_factor=1.0);
 
+  /// \brief EXPERIMENTAL Add the pixels of the deformed subset boundary to a bitmap
+  /// (the same pixels as deformed_shapes(), but without building a set)
+  /// \param bitmap [out] the bitmap to add the pixels to
+  /// \param shape_function the deformation map
+  /// \param cx the x centroid of the map
+  /// \param cy the y centroid of the map
+  /// \param skin_factor padding added to the outside of the shapes
+  void rasterize_deformed_shapes(Pixel_Bitmap & bitmap,
+    Teuchos::RCP<Local_Shape_Function> shape_function=Teuchos::null,
+    const int_t cx=0,
+    const int_t cy=0,
+    const scalar_t & skin_factor=1.0);
+
 #if DICE_KOKKOS
   /// x coordinate view accessor
   pixel_coord_dual_view_1d x()const{
@@ -306,6 +437,21 @@ public:
 #endif
 
 private:
+  /// update the bytes held by this subset in the memory tracker (called after the arrays change)
+  void update_memory_usage();
+  /// copy the shared reference intensities into a private array so they can be modified
+  void unshare_ref_intensities();
+  /// compute any deferred gradient tiles of an image that the pixels of this subset fall in
+  /// (see Image::compute_gradient_tiles())
+  /// \param image the image the gradients are read from
+  void request_gradient_tiles(const Teuchos::RCP<Image> & image)const;
+
+#if !DICE_KOKKOS
+  /// returns a contiguous array of the intensities for the reductions in mean() and gamma()
+  /// (shared reference intensities are gathered into storage owned by the calling thread)
+  /// \param target the intensities to return
+  const intensity_t * reduction_values(const Subset_View_Target target);
+#endif
   /// number of pixels in the subset
   int_t num_pixels_;
 #if DICE_KOKKOS
@@ -334,23 +480,25 @@ private:
   Teuchos::ArrayRCP<scalar_t> grad_x_;
   /// container for grad_y
   Teuchos::ArrayRCP<scalar_t> grad_y_;
-  /// pixels can be deactivated by obstructions (persistent)
-  Teuchos::ArrayRCP<bool> is_active_;
-  /// pixels can be deactivated for this frame only
-  Teuchos::ArrayRCP<bool> is_deactivated_this_step_;
+  /// the reference image intensities when they are shared
+  Teuchos::ArrayRCP<intensity_t> shared_ref_intensities_;
+  /// width of the shared reference image
+  int_t shared_ref_width_;
+  /// index of global pixel (0,0) in the shared reference image (accounts for the image offsets)
+  int_t shared_ref_origin_;
+  /// pixels can be deactivated by obstructions (persistent), one bit per pixel
+  Teuchos::ArrayRCP<pixel_mask_t> is_active_;
+  /// pixels can be deactivated for this frame only, one bit per pixel
+  Teuchos::ArrayRCP<pixel_mask_t> is_deactivated_this_step_;
   /// initial x position of the pixels in the reference image
   Teuchos::ArrayRCP<int_t> x_;
   /// initial x position of the pixels in the reference image
   Teuchos::ArrayRCP<int_t> y_;
 #endif
   /// \brief EXPERIMENTAL Holds the obstruction coordinates if they exist.
-  /// NOTE: The coordinates are switched for this (i.e. (Y,X)) so that
-  /// the loops over y then x will be more efficient
-  std::set<std::pair<int_t,int_t> > obstructed_coords_;
+  Pixel_Bitmap obstructed_coords_;
   /// \brief EXPERIMENTAL Holds the pixels blocked by other subsets if they exist.
-  /// NOTE: The coordinates are switched for this (i.e. (Y,X)) so that
-  /// the loops over y then x will be more efficient
-  std::set<std::pair<int_t,int_t> > pixels_blocked_by_other_subsets_;
+  Pixel_Bitmap pixels_blocked_by_other_subsets_;
   /// centroid location x
   int_t cx_; // assumed to be the middle of the pixel
   /// centroid location y
@@ -364,6 +512,18 @@ private:
   /// if sub regions of the frame are used instead of reading in the whole
   /// sub image, this sub_image_id defines which region to draw the pixel information from
   int_t sub_image_id_;
+  /// true if the steepest descent images and Hessian are current
+  bool has_steepest_descent_;
+  /// number of shape function parameters for the steepest descent images
+  int_t num_steepest_descent_params_;
+  /// steepest descent images of the reference subset (num_pixels x num_params)
+  Teuchos::ArrayRCP<double> steepest_descent_;
+  /// Hessian of the reference subset (num_params x num_params)
+  Teuchos::ArrayRCP<double> steepest_descent_hessian_;
+  /// true if the reference intensities are read from the reference image rather than a copy
+  bool ref_is_shared_;
+  /// bytes held by the pixel arrays
+  Tracked_Memory memory_;
 };
 
 }// End DICe Namespace
@@ -0,0 +1,232 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_SubsetBatch.h>
+#include <DICe_SubsetFunctors.h>
+
+#include <cassert>
+
+namespace DICe {
+
+Subset_Batch::Subset_Batch(const std::vector<Teuchos::RCP<Subset> > & subsets,
+  const bool enable_rotation,
+  const bool enable_normal_strain,
+  const bool enable_shear_strain):
+  num_subsets_(subsets.size()),
+  num_params_(2 + (enable_rotation ? 1 : 0) + (enable_normal_strain ? 2 : 0) + (enable_shear_strain ? 1 : 0)),
+  rotation_(enable_rotation),
+  normal_strain_(enable_normal_strain),
+  shear_strain_(enable_shear_strain)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(num_subsets_<=0,std::invalid_argument,"Error, the subset batch needs at least one subset");
+  offsets_ = pixel_coord_dual_view_1d("offsets",num_subsets_+1);
+  offsets_.h_view(0) = 0;
+  for(int_t i=0;i<num_subsets_;++i){
+    TEUCHOS_TEST_FOR_EXCEPTION(subsets[i]==Teuchos::null,std::invalid_argument,"Error, null subset in the batch");
+    TEUCHOS_TEST_FOR_EXCEPTION(!subsets[i]->has_gradients(),std::invalid_argument,
+      "Error, the reference gradients are needed for the subset batch");
+    offsets_.h_view(i+1) = offsets_.h_view(i) + subsets[i]->num_pixels();
+  }
+  const int_t num_pixels = offsets_.h_view(num_subsets_);
+  x_ = pixel_coord_dual_view_1d("x",num_pixels);
+  y_ = pixel_coord_dual_view_1d("y",num_pixels);
+  ref_intensities_ = intensity_dual_view_1d("ref_intensities",num_pixels);
+  def_intensities_ = intensity_dual_view_1d("def_intensities",num_pixels);
+  grad_x_ = scalar_dual_view_1d("grad_x",num_pixels);
+  grad_y_ = scalar_dual_view_1d("grad_y",num_pixels);
+  is_active_ = bool_dual_view_1d("is_active",num_pixels);
+  centroids_ = scalar_dual_view_2d("centroids",num_subsets_,2);
+  for(int_t i=0;i<num_subsets_;++i){
+    Teuchos::RCP<Subset> subset = subsets[i];
+    centroids_.h_view(i,0) = subset->centroid_x();
+    centroids_.h_view(i,1) = subset->centroid_y();
+    const int_t offset = offsets_.h_view(i);
+    for(int_t px=0;px<subset->num_pixels();++px){
+      x_.h_view(offset+px) = subset->x(px);
+      y_.h_view(offset+px) = subset->y(px);
+      ref_intensities_.h_view(offset+px) = subset->ref_intensities(px);
+      grad_x_.h_view(offset+px) = subset->grad_x(px);
+      grad_y_.h_view(offset+px) = subset->grad_y(px);
+      is_active_.h_view(offset+px) = subset->is_active(px)&&!subset->is_deactivated_this_step(px);
+    }
+  }
+  // the packed reference data does not change for the life of the batch
+  offsets_.modify<host_space>();
+  offsets_.sync<device_space>();
+  x_.modify<host_space>();
+  x_.sync<device_space>();
+  y_.modify<host_space>();
+  y_.sync<device_space>();
+  ref_intensities_.modify<host_space>();
+  ref_intensities_.sync<device_space>();
+  grad_x_.modify<host_space>();
+  grad_x_.sync<device_space>();
+  grad_y_.modify<host_space>();
+  grad_y_.sync<device_space>();
+  is_active_.modify<host_space>();
+  is_active_.sync<device_space>();
+  centroids_.modify<host_space>();
+  centroids_.sync<device_space>();
+  solve_ = bool_dual_view_1d("solve",num_subsets_);
+  params_ = scalar_dual_view_2d("params",num_subsets_,num_params_);
+  status_ = pixel_coord_dual_view_1d("status",num_subsets_);
+  iterations_ = pixel_coord_dual_view_1d("iterations",num_subsets_);
+  condition_numbers_ = scalar_dual_view_1d("condition_numbers",num_subsets_);
+  initial_params_.resize(num_subsets_);
+  clear();
+}
+
+void
+Subset_Batch::clear(){
+  for(int_t i=0;i<num_subsets_;++i){
+    solve_.h_view(i) = false;
+    status_.h_view(i) = static_cast<int_t>(CORRELATION_FAILED);
+    iterations_.h_view(i) = -1;
+    initial_params_[i].clear();
+  }
+}
+
+void
+Subset_Batch::set_initial_parameters(const int_t index,
+  const std::vector<scalar_t> & params){
+  assert(index>=0&&index<num_subsets_);
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t)params.size()!=num_params_,std::invalid_argument,
+    "Error, wrong number of parameters for the subset batch");
+  solve_.h_view(index) = true;
+  for(int_t i=0;i<num_params_;++i)
+    params_.h_view(index,i) = params[i];
+  initial_params_[index] = params;
+}
+
+void
+Subset_Batch::solve(Teuchos::RCP<Image> def_img,
+  const Interpolation_Method interp,
+  const scalar_t & tolerance,
+  const int_t max_iterations,
+  const scalar_t & regularization){
+  TEUCHOS_TEST_FOR_EXCEPTION(interp!=BILINEAR&&interp!=KEYS_FOURTH,std::invalid_argument,
+    "Error, the subset batch only supports bilinear and keys fourth interpolation");
+  // only the per subset values are copied, the image and the reference data are already on the device
+  solve_.modify<host_space>();
+  solve_.sync<device_space>();
+  params_.modify<host_space>();
+  params_.sync<device_space>();
+  ZNSSD_Batch_Gauss_Newton_Functor functor;
+  functor.image_intensities_ = def_img->intensity_dual_view().d_view;
+  functor.image_w_ = def_img->width();
+  functor.image_h_ = def_img->height();
+  functor.offset_x_ = def_img->offset_x();
+  functor.offset_y_ = def_img->offset_y();
+  functor.use_keys_ = interp==KEYS_FOURTH;
+  functor.rotation_ = rotation_;
+  functor.normal_strain_ = normal_strain_;
+  functor.shear_strain_ = shear_strain_;
+  functor.num_params_ = num_params_;
+  functor.tolerance_ = tolerance;
+  functor.max_iterations_ = max_iterations;
+  functor.regularization_ = regularization;
+  functor.offsets_ = offsets_.d_view;
+  functor.x_ = x_.d_view;
+  functor.y_ = y_.d_view;
+  functor.ref_intensities_ = ref_intensities_.d_view;
+  functor.def_intensities_ = def_intensities_.d_view;
+  functor.grad_x_ = grad_x_.d_view;
+  functor.grad_y_ = grad_y_.d_view;
+  functor.is_active_ = is_active_.d_view;
+  functor.centroids_ = centroids_.d_view;
+  functor.solve_ = solve_.d_view;
+  functor.params_ = params_.d_view;
+  functor.status_ = status_.d_view;
+  functor.iterations_ = iterations_.d_view;
+  functor.condition_numbers_ = condition_numbers_.d_view;
+  // one team per subset
+  Kokkos::parallel_for(Kokkos::TeamPolicy<device_space>(num_subsets_,Kokkos::AUTO),functor);
+  params_.modify<device_space>();
+  params_.sync<host_space>();
+  status_.modify<device_space>();
+  status_.sync<host_space>();
+  iterations_.modify<device_space>();
+  iterations_.sync<host_space>();
+  condition_numbers_.modify<device_space>();
+  condition_numbers_.sync<host_space>();
+}
+
+bool
+Subset_Batch::solved(const int_t index)const{
+  assert(index>=0&&index<num_subsets_);
+  return solve_.h_view(index);
+}
+
+bool
+Subset_Batch::initial_parameters_match(const int_t index,
+  const std::vector<scalar_t> & params)const{
+  assert(index>=0&&index<num_subsets_);
+  return solve_.h_view(index)&&initial_params_[index]==params;
+}
+
+void
+Subset_Batch::parameters(const int_t index,
+  std::vector<scalar_t> & params)const{
+  assert(index>=0&&index<num_subsets_);
+  params.resize(num_params_);
+  for(int_t i=0;i<num_params_;++i)
+    params[i] = params_.h_view(index,i);
+}
+
+Status_Flag
+Subset_Batch::status(const int_t index)const{
+  assert(index>=0&&index<num_subsets_);
+  return static_cast<Status_Flag>(status_.h_view(index));
+}
+
+int_t
+Subset_Batch::num_iterations(const int_t index)const{
+  assert(index>=0&&index<num_subsets_);
+  return iterations_.h_view(index);
+}
+
+scalar_t
+Subset_Batch::condition_number(const int_t index)const{
+  assert(index>=0&&index<num_subsets_);
+  return condition_numbers_.h_view(index);
+}
+
+}// End DICe Namespace
@@ -0,0 +1,189 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_SUBSETBATCH_H
+#define DICE_SUBSETBATCH_H
+
+#include <DICe.h>
+#include <DICe_Kokkos.h>
+#include <DICe_Image.h>
+#include <DICe_Subset.h>
+
+#include <Teuchos_RCP.hpp>
+
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Subset_Batch
+/// \brief Device resident copy of the reference data for a set of subsets, used to run the
+/// gradient based ZNSSD solve for all of the subsets of a frame in one kernel launch
+///
+/// The coordinates, reference intensities, reference gradients and active flags of the subsets
+/// are packed end to end and copied to the device once by the constructor. The batch stays valid
+/// as long as the reference image (and the subsets) do not change, so for a fixed reference only the
+/// initial guess and the results are copied each frame. The deformed image is read from its own
+/// device view. Only the affine shape function is supported.
+class DICE_LIB_DLL_EXPORT
+Subset_Batch
+{
+public:
+  /// \brief constructor
+  /// \param subsets the subsets to pack (the reference intensities and gradients must be initialized)
+  /// \param enable_rotation true if rotation is one of the shape function parameters
+  /// \param enable_normal_strain true if the normal strains are shape function parameters
+  /// \param enable_shear_strain true if the shear strain is a shape function parameter
+  Subset_Batch(const std::vector<Teuchos::RCP<Subset> > & subsets,
+    const bool enable_rotation,
+    const bool enable_normal_strain,
+    const bool enable_shear_strain);
+
+  /// virtual destructor
+  virtual ~Subset_Batch(){};
+
+  /// returns the number of subsets in the batch
+  int_t num_subsets()const{
+    return num_subsets_;
+  }
+
+  /// returns the number of shape function parameters
+  int_t num_params()const{
+    return num_params_;
+  }
+
+  /// clears the solve flags of all the subsets (call before setting the initial guesses for a frame)
+  void clear();
+
+  /// \brief sets the initial guess for a subset and flags it to be solved
+  /// \param index the index of the subset in the batch
+  /// \param params the shape function parameters (in the Affine_Shape_Function ordering)
+  void set_initial_parameters(const int_t index,
+    const std::vector<scalar_t> & params);
+
+  /// \brief solves all the flagged subsets on the device
+  /// \param def_img the deformed image
+  /// \param interp the interpolation method (only BILINEAR and KEYS_FOURTH are supported)
+  /// \param tolerance the convergence tolerance
+  /// \param max_iterations the maximum number of iterations
+  /// \param regularization value added to the displacement terms of the Hessian (0.0 for none)
+  void solve(Teuchos::RCP<Image> def_img,
+    const Interpolation_Method interp,
+    const scalar_t & tolerance,
+    const int_t max_iterations,
+    const scalar_t & regularization=0.0);
+
+  /// returns true if the subset was flagged for the last solve
+  bool solved(const int_t index)const;
+
+  /// returns true if the given parameters are the initial guess the subset was solved from
+  /// \param index the index of the subset in the batch
+  /// \param params the parameters to compare
+  bool initial_parameters_match(const int_t index,
+    const std::vector<scalar_t> & params)const;
+
+  /// returns the solution parameters of a subset
+  /// \param index the index of the subset in the batch
+  /// \param params [out] the parameters
+  void parameters(const int_t index,
+    std::vector<scalar_t> & params)const;
+
+  /// returns the status of the last solve for a subset
+  Status_Flag status(const int_t index)const;
+
+  /// returns the number of iterations of the last solve for a subset
+  int_t num_iterations(const int_t index)const;
+
+  /// returns the condition number of the displacement terms of the Hessian from the last solve for a subset
+  scalar_t condition_number(const int_t index)const;
+
+private:
+  /// number of subsets
+  int_t num_subsets_;
+  /// number of shape function parameters
+  int_t num_params_;
+  /// true if rotation is one of the parameters
+  bool rotation_;
+  /// true if the normal strains are parameters
+  bool normal_strain_;
+  /// true if the shear strain is a parameter
+  bool shear_strain_;
+  /// first pixel of each subset in the packed arrays
+  pixel_coord_dual_view_1d offsets_;
+  /// packed x coordinates
+  pixel_coord_dual_view_1d x_;
+  /// packed y coordinates
+  pixel_coord_dual_view_1d y_;
+  /// packed reference intensities
+  intensity_dual_view_1d ref_intensities_;
+  /// packed deformed intensities (device scratch space)
+  intensity_dual_view_1d def_intensities_;
+  /// packed reference x gradients
+  scalar_dual_view_1d grad_x_;
+  /// packed reference y gradients
+  scalar_dual_view_1d grad_y_;
+  /// packed active flags
+  bool_dual_view_1d is_active_;
+  /// subset centroids
+  scalar_dual_view_2d centroids_;
+  /// flags for the subsets to solve
+  bool_dual_view_1d solve_;
+  /// initial guess for each subset
+  std::vector<std::vector<scalar_t> > initial_params_;
+  /// parameters (initial guess in, solution out)
+  scalar_dual_view_2d params_;
+  /// status flags
+  pixel_coord_dual_view_1d status_;
+  /// number of iterations
+  pixel_coord_dual_view_1d iterations_;
+  /// condition numbers
+  scalar_dual_view_1d condition_numbers_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -267,6 +267,298 @@ struct Subset_Init_Functor{
   void operator()(const No_Map_Tag &, const int_t pixel_index)const;
 };
 
+/// container for the team reduction of the Gauss-Newton sums of one subset,
+/// the gradient followed by the upper triangle of the Hessian (row by row)
+struct Gauss_Newton_Sums{
+  /// maximum number of values (6 for the gradient and 21 for the upper triangle of a 6x6 Hessian)
+  static const int_t max_size = 27;
+  /// sums
+  double values[max_size];
+  /// constructor
+  KOKKOS_INLINE_FUNCTION
+  Gauss_Newton_Sums(){
+    for(int_t i=0;i<max_size;++i) values[i] = 0.0;
+  }
+  /// join
+  KOKKOS_INLINE_FUNCTION
+  Gauss_Newton_Sums & operator+=(const Gauss_Newton_Sums & rhs){
+    for(int_t i=0;i<max_size;++i) values[i] += rhs.values[i];
+    return *this;
+  }
+  /// join (volatile version needed by the team reduction)
+  KOKKOS_INLINE_FUNCTION
+  void operator+=(const volatile Gauss_Newton_Sums & rhs) volatile{
+    for(int_t i=0;i<max_size;++i) values[i] += rhs.values[i];
+  }
+};
+
+/// \brief Gauss-Newton ZNSSD solve for a batch of subsets with one team per subset
+///
+/// This is the same iteration as Objective_ZNSSD::computeUpdateFast() for the affine shape function
+/// using the reference gradients. The subset data is packed end to end (see DICe::Subset_Batch)
+/// and the deformed intensities are interpolated directly from the device view of the image,
+/// so nothing is copied between the host and device during the solve. The small linear system
+/// is solved redundantly by every thread in the team so that no broadcast is needed.
+struct ZNSSD_Batch_Gauss_Newton_Functor{
+  /// deformed image intensities
+  intensity_device_view_2d image_intensities_;
+  /// width of the image
+  int_t image_w_;
+  /// height of the image
+  int_t image_h_;
+  /// offset taken from image rcp
+  int_t offset_x_;
+  /// offset taken from image rcp
+  int_t offset_y_;
+  /// true if Keys fourth order interpolation is used (bilinear otherwise)
+  bool use_keys_;
+  /// true if rotation is one of the parameters
+  bool rotation_;
+  /// true if normal strain is one of the parameters
+  bool normal_strain_;
+  /// true if shear strain is one of the parameters
+  bool shear_strain_;
+  /// number of parameters
+  int_t num_params_;
+  /// convergence tolerance
+  scalar_t tolerance_;
+  /// maximum number of iterations
+  int_t max_iterations_;
+  /// regularization added to the displacement terms of the Hessian
+  scalar_t regularization_;
+  /// first pixel of each subset in the packed arrays (num_subsets + 1 values)
+  pixel_coord_dual_view_1d::t_dev offsets_;
+  /// packed x coordinates
+  pixel_coord_dual_view_1d::t_dev x_;
+  /// packed y coordinates
+  pixel_coord_dual_view_1d::t_dev y_;
+  /// packed reference intensities
+  intensity_dual_view_1d::t_dev ref_intensities_;
+  /// packed deformed intensities (scratch space written each iteration)
+  intensity_dual_view_1d::t_dev def_intensities_;
+  /// packed reference x gradients
+  scalar_dual_view_1d::t_dev grad_x_;
+  /// packed reference y gradients
+  scalar_dual_view_1d::t_dev grad_y_;
+  /// packed active pixel flags
+  bool_dual_view_1d::t_dev is_active_;
+  /// centroid of each subset (num_subsets x 2)
+  scalar_dual_view_2d::t_dev centroids_;
+  /// flag for each subset to solve
+  bool_dual_view_1d::t_dev solve_;
+  /// parameters for each subset (num_subsets x num_params), initial guess in and solution out
+  scalar_dual_view_2d::t_dev params_;
+  /// status flag for each subset
+  pixel_coord_dual_view_1d::t_dev status_;
+  /// number of iterations for each subset
+  pixel_coord_dual_view_1d::t_dev iterations_;
+  /// condition number of the displacement block of the Hessian for each subset
+  scalar_dual_view_1d::t_dev condition_numbers_;
+
+  /// interpolate the deformed image (same as Image::interpolate_bilinear())
+  KOKKOS_INLINE_FUNCTION
+  scalar_t interpolate_bilinear(const scalar_t & local_x, const scalar_t & local_y)const{
+    if(local_x<0.0||local_x>=image_w_-1.5||local_y<0.0||local_y>=image_h_-1.5) return 0.0;
+    const int_t x1 = (int_t)local_x;
+    const int_t x2 = x1+1;
+    const int_t y1 = (int_t)local_y;
+    const int_t y2 = y1+1;
+    return image_intensities_(y1,x1)*(x2-local_x)*(y2-local_y)
+        +image_intensities_(y1,x2)*(local_x-x1)*(y2-local_y)
+        +image_intensities_(y2,x2)*(local_x-x1)*(local_y-y1)
+        +image_intensities_(y2,x1)*(x2-local_x)*(local_y-y1);
+  }
+
+  /// interpolate the deformed image (same as Image::interpolate_keys_fourth())
+  KOKKOS_INLINE_FUNCTION
+  scalar_t interpolate_keys(const scalar_t & local_x, const scalar_t & local_y)const{
+    if(local_x<=2.5||local_x>=image_w_-3.5||local_y<=2.5||local_y>=image_h_-3.5)
+      return interpolate_bilinear(local_x,local_y);
+    const int_t ix = (int_t)local_x;
+    const int_t iy = (int_t)local_y;
+    const scalar_t dx = local_x - ix;
+    const scalar_t dy = local_y - iy;
+    scalar_t coeffs_x[6];
+    scalar_t coeffs_y[6];
+    keys_coefficients(dx,coeffs_x);
+    keys_coefficients(dy,coeffs_y);
+    scalar_t value = 0.0;
+    for(int_t m=0;m<6;++m)
+      for(int_t n=0;n<6;++n)
+        value += coeffs_y[m]*coeffs_x[n]*image_intensities_(iy-2+m,ix-2+n);
+    return value;
+  }
+
+  /// Keys fourth order weights for the six stencil points given the fractional offset s
+  KOKKOS_INLINE_FUNCTION
+  static void keys_coefficients(const scalar_t & s, scalar_t * c){
+    const scalar_t s0 = s+2.0, s1 = s+1.0, s3 = 1.0-s, s4 = 2.0-s, s5 = 3.0-s;
+    c[0] = 0.08333333333333*s0*s0*s0 - 0.66666666666666*s0*s0 + 1.75*s0 - 1.5;
+    c[1] = -0.58333333333333*s1*s1*s1 + 3.0*s1*s1 - 4.91666666666666*s1 + 2.5;
+    c[2] = 1.33333333333333*s*s*s - 2.33333333333333*s*s + 1.0;
+    c[3] = 1.33333333333333*s3*s3*s3 - 2.33333333333333*s3*s3 + 1.0;
+    c[4] = -0.58333333333333*s4*s4*s4 + 3.0*s4*s4 - 4.91666666666666*s4 + 2.5;
+    c[5] = 0.08333333333333*s5*s5*s5 - 0.66666666666666*s5*s5 + 1.75*s5 - 1.5;
+  }
+
+  /// solve H x = b in place for a small system using Gaussian elimination with partial pivoting
+  /// \return false if the matrix is singular
+  KOKKOS_INLINE_FUNCTION
+  static bool solve_small_system(const int_t n, double H[6][6], double * b){
+    for(int_t k=0;k<n;++k){
+      int_t pivot = k;
+      for(int_t i=k+1;i<n;++i)
+        if((H[i][k]<0.0?-H[i][k]:H[i][k])>(H[pivot][k]<0.0?-H[pivot][k]:H[pivot][k])) pivot = i;
+      if(H[pivot][k]==0.0) return false;
+      if(pivot!=k){
+        for(int_t j=0;j<n;++j){
+          const double tmp = H[k][j]; H[k][j] = H[pivot][j]; H[pivot][j] = tmp;
+        }
+        const double tmp = b[k]; b[k] = b[pivot]; b[pivot] = tmp;
+      }
+      for(int_t i=k+1;i<n;++i){
+        const double factor = H[i][k]/H[k][k];
+        for(int_t j=k;j<n;++j)
+          H[i][j] -= factor*H[k][j];
+        b[i] -= factor*b[k];
+      }
+    }
+    for(int_t i=n-1;i>=0;--i){
+      for(int_t j=i+1;j<n;++j)
+        b[i] -= H[i][j]*b[j];
+      b[i] /= H[i][i];
+    }
+    return true;
+  }
+
+  /// one team per subset
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const member_type team_member)const{
+    const int_t subset = team_member.league_rank();
+    if(!solve_(subset)) return;
+    const int_t begin = offsets_(subset);
+    const int_t end = offsets_(subset+1);
+    const int_t num_pixels = end - begin;
+    const scalar_t cx = centroids_(subset,0);
+    const scalar_t cy = centroids_(subset,1);
+    // parameter indices follow the ordering in Affine_Shape_Function::init()
+    const int_t N = num_params_;
+    const int_t t_id = 2;
+    const int_t ex_id = rotation_ ? 3 : 2;
+    const int_t ey_id = ex_id + 1;
+    const int_t gxy_id = ex_id + (normal_strain_ ? 2 : 0);
+    scalar_t p[6];
+    for(int_t i=0;i<N;++i) p[i] = params_(subset,i);
+
+    scalar_t sum_f = 0.0;
+    Kokkos::parallel_reduce(Kokkos::TeamThreadRange(team_member,begin,end),[&](const int_t px, scalar_t & sum){
+      if(is_active_(px)) sum += ref_intensities_(px);
+    },sum_f);
+    const scalar_t meanF = sum_f/num_pixels;
+
+    int_t status = static_cast<int_t>(MAX_ITERATIONS_REACHED);
+    int_t num_iterations = 0;
+    scalar_t cond_2x2 = -1.0;
+    for(int_t solve_it=0;solve_it<=max_iterations_;++solve_it){
+      num_iterations = solve_it;
+      const scalar_t theta = rotation_ ? p[t_id] : 0.0;
+      const scalar_t dudx = normal_strain_ ? p[ex_id] : 0.0;
+      const scalar_t dvdy = normal_strain_ ? p[ey_id] : 0.0;
+      const scalar_t gxy = shear_strain_ ? p[gxy_id] : 0.0;
+      const scalar_t cosTheta = std::cos(theta);
+      const scalar_t sinTheta = std::sin(theta);
+      // map the pixels into the deformed image (same map as Affine_Shape_Function::map())
+      scalar_t sum_g = 0.0;
+      Kokkos::parallel_reduce(Kokkos::TeamThreadRange(team_member,begin,end),[&](const int_t px, scalar_t & sum){
+        const scalar_t dx = x_(px) - cx;
+        const scalar_t dy = y_(px) - cy;
+        const scalar_t Dx = (1.0+dudx)*dx + gxy*dy;
+        const scalar_t Dy = (1.0+dvdy)*dy + gxy*dx;
+        const scalar_t local_x = cosTheta*Dx - sinTheta*Dy + p[0] + cx - offset_x_;
+        const scalar_t local_y = sinTheta*Dx + cosTheta*Dy + p[1] + cy - offset_y_;
+        const scalar_t value = use_keys_ ? interpolate_keys(local_x,local_y) : interpolate_bilinear(local_x,local_y);
+        def_intensities_(px) = value;
+        if(is_active_(px)) sum += value;
+      },sum_g);
+      const scalar_t meanG = sum_g/num_pixels;
+      team_member.team_barrier();
+      // accumulate the gradient and the upper triangle of the Hessian
+      Gauss_Newton_Sums sums;
+      Kokkos::parallel_reduce(Kokkos::TeamThreadRange(team_member,begin,end),[&](const int_t px, Gauss_Newton_Sums & local){
+        if(!is_active_(px)) return;
+        const scalar_t dx = x_(px) - cx;
+        const scalar_t dy = y_(px) - cy;
+        const scalar_t Gx = cosTheta*grad_x_(px) - sinTheta*grad_y_(px);
+        const scalar_t Gy = sinTheta*grad_x_(px) + cosTheta*grad_y_(px);
+        scalar_t r[6];
+        r[0] = Gx;
+        r[1] = Gy;
+        if(rotation_){
+          const scalar_t Dx = (1.0+dudx)*dx + gxy*dy;
+          const scalar_t Dy = (1.0+dvdy)*dy + gxy*dx;
+          r[t_id] = Gx*(-sinTheta*Dx - cosTheta*Dy) + Gy*(cosTheta*Dx - sinTheta*Dy);
+        }
+        if(normal_strain_){
+          r[ex_id] = Gx*dx*cosTheta + Gy*dx*sinTheta;
+          r[ey_id] = -Gx*dy*sinTheta + Gy*dy*cosTheta;
+        }
+        if(shear_strain_)
+          r[gxy_id] = Gx*(cosTheta*dy - sinTheta*dx) + Gy*(sinTheta*dy + cosTheta*dx);
+        const scalar_t gmf = (def_intensities_(px) - meanG) - (ref_intensities_(px) - meanF);
+        int_t index = N;
+        for(int_t i=0;i<N;++i){
+          local.values[i] += gmf*r[i];
+          for(int_t j=i;j<N;++j)
+            local.values[index++] += r[i]*r[j];
+        }
+      },sums);
+      double H[6][6];
+      double update[6];
+      int_t index = N;
+      for(int_t i=0;i<N;++i){
+        update[i] = -sums.values[i];
+        for(int_t j=i;j<N;++j){
+          H[i][j] = sums.values[index++];
+          H[j][i] = H[i][j];
+        }
+      }
+      H[0][0] += regularization_;
+      H[1][1] += regularization_;
+      // same conditioning test on the displacement block as the host solve
+      const scalar_t det_h = H[0][0]*H[1][1] - H[1][0]*H[0][1];
+      const scalar_t norm_H = std::sqrt(H[0][0]*H[0][0] + H[0][1]*H[0][1] + H[1][0]*H[1][0] + H[1][1]*H[1][1]);
+      cond_2x2 = -1.0;
+      if(det_h!=0.0)
+        cond_2x2 = norm_H * std::sqrt((1.0/(det_h*det_h))*(H[0][0]*H[0][0] + H[0][1]*H[0][1] + H[1][0]*H[1][0] + H[1][1]*H[1][1]));
+      if(cond_2x2 > 1.0E12){
+        status = static_cast<int_t>(HESSIAN_SINGULAR);
+        break;
+      }
+      if(!solve_small_system(N,H,update)){
+        status = static_cast<int_t>(LINEAR_SOLVE_FAILED);
+        break;
+      }
+      for(int_t i=0;i<N;++i)
+        p[i] += update[i];
+      // only the displacements and rotation are tested (same as Affine_Shape_Function::test_for_convergence())
+      bool converged = std::abs(update[0]) < tolerance_ && std::abs(update[1]) < tolerance_;
+      if(rotation_&&std::abs(update[t_id]) >= tolerance_) converged = false;
+      if(converged){
+        status = static_cast<int_t>(CORRELATION_SUCCESSFUL);
+        break;
+      }
+      // the deformed intensities are overwritten on the next iteration
+      team_member.team_barrier();
+    }
+    Kokkos::single(Kokkos::PerTeam(team_member),[&](){
+      for(int_t i=0;i<N;++i) params_(subset,i) = p[i];
+      status_(subset) = status;
+      iterations_(subset) = num_iterations;
+      condition_numbers_(subset) = cond_2x2;
+    });
+  }
+};
+
 }// End DICe Namespace
 
 /*! @} End of Doxygen namespace*/
@@ -41,7 +41,9 @@
 
 #include <DICe_Subset.h>
 #include <DICe_SubsetFunctors.h>
+#include <DICe_Profiler.h>
 
+#include <algorithm>
 #include <cassert>
 
 namespace DICe {
@@ -55,7 +57,10 @@ Subset::Subset(int_t cx,
   cy_(cy),
   has_gradients_(false),
   is_conformal_(false),
-  sub_image_id_(0)
+  sub_image_id_(0),
+  has_steepest_descent_(false),
+  num_steepest_descent_params_(0),
+ memory_(MEMORY_SUBSETS)
 {
   assert(num_pixels_>0);
   assert(x.size()==y.size());
@@ -86,6 +91,8 @@ Subset::Subset(int_t cx,
   is_deactivated_this_step_ = bool_dual_view_1d("is_deactivated_this_step",num_pixels_);
   reset_is_active();
   reset_is_deactivated_this_step();
+  ref_is_shared_ = false;
+  update_memory_usage();
 }
 
 Subset::Subset(const int_t cx,
@@ -96,7 +103,10 @@ Subset::Subset(const int_t cx,
  cy_(cy),
  has_gradients_(false),
  is_conformal_(false),
- sub_image_id_(0)
+ sub_image_id_(0),
+ has_steepest_descent_(false),
+ num_steepest_descent_params_(0),
+ memory_(MEMORY_SUBSETS)
 {
   assert(width>0);
   assert(height>0);
@@ -136,6 +146,8 @@ Subset::Subset(const int_t cx,
   is_deactivated_this_step_ = bool_dual_view_1d("is_deactivated_this_step",num_pixels_);
   reset_is_active();
   reset_is_deactivated_this_step();
+  ref_is_shared_ = false;
+  update_memory_usage();
 }
 
 Subset::Subset(const int_t cx,
@@ -146,32 +158,30 @@ Subset::Subset(const int_t cx,
   has_gradients_(false),
   conformal_subset_def_(subset_def),
   is_conformal_(true),
-  sub_image_id_(0)
+  sub_image_id_(0),
+  has_steepest_descent_(false),
+  num_steepest_descent_params_(0),
+ memory_(MEMORY_SUBSETS)
 {
   TEUCHOS_TEST_FOR_EXCEPTION(cx<0,std::invalid_argument,"Error, cannot have negative coordinates for cx");
   TEUCHOS_TEST_FOR_EXCEPTION(cy<0,std::invalid_argument,"Error, cannot have negative coordinates for cy");
   assert(subset_def.has_boundary());
-  std::set<std::pair<int_t,int_t> > coords;
-  for(size_t i=0;i<subset_def.boundary()->size();++i){
-    std::set<std::pair<int_t,int_t> > shapeCoords = (*subset_def.boundary())[i]->get_owned_pixels();
-    coords.insert(shapeCoords.begin(),shapeCoords.end());
-  }
+  // the shapes cache their pixels so subsets that share a shape only rasterize it once
+  std::vector<std::pair<int_t,int_t> > coords;
+  reference_pixels(*subset_def.boundary(),coords);
   // warn the user if the centroid is outside the subset
   std::pair<int_t,int_t> centroid_pair = std::pair<int_t,int_t>(cy_,cx_);
-  if(coords.find(centroid_pair)==coords.end())
+  if(!std::binary_search(coords.begin(),coords.end(),centroid_pair))
     std::cout << "*** Warning: centroid " << cx_ << " " << cy_ << " is outside the subset boundary" << std::endl;
-  // at this point all the coordinate pairs are in the set
+  // at this point all the coordinate pairs are in the vector
   num_pixels_ = coords.size();
   // resize the storage arrays now that the num_pixels is known
   x_ = pixel_coord_dual_view_1d("x",num_pixels_);
   y_ = pixel_coord_dual_view_1d("y",num_pixels_);
-  int_t index = 0;
-  // NOTE: the pairs are (y,x) not (x,y) so that the ordering is correct in the set
-  typename std::set<std::pair<int_t,int_t> >::iterator set_it = coords.begin();
-  for( ; set_it!=coords.end();++set_it){
-    x_.h_view(index) = set_it->second;
-    y_.h_view(index) = set_it->first;
-    index++;
+  // NOTE: the pairs are (y,x) not (x,y) so that the ordering is correct
+  for(int_t index=0;index<num_pixels_;++index){
+    x_.h_view(index) = coords[index].second;
+    y_.h_view(index) = coords[index].first;
   }
   x_.modify<host_space>();
   y_.modify<host_space>();
@@ -187,6 +197,8 @@ Subset::Subset(const int_t cx,
   is_deactivated_this_step_ = bool_dual_view_1d("is_deactivated_this_step",num_pixels_);
   reset_is_active();
   reset_is_deactivated_this_step();
+  ref_is_shared_ = false;
+  update_memory_usage();
   // now set the inactive bit for the second set of multishapes if they exist.
   if(subset_def.has_excluded_area()){
     for(size_t i=0;i<subset_def.excluded_area()->size();++i){
@@ -198,8 +210,7 @@ Subset::Subset(const int_t cx,
   is_active_.sync<device_space>();
   if(subset_def.has_obstructed_area()){
     for(size_t i=0;i<subset_def.obstructed_area()->size();++i){
-      std::set<std::pair<int_t,int_t> > obstructedArea = (*subset_def.obstructed_area())[i]->get_owned_pixels();
-      obstructed_coords_.insert(obstructedArea.begin(),obstructedArea.end());
+      (*subset_def.obstructed_area())[i]->rasterize(obstructed_coords_);
     }
   }
 }
@@ -235,17 +246,29 @@ Subset::def_intensities(const int_t pixel_index){
 }
 
 /// returns true if this pixel is active
-bool &
-Subset::is_active(const int_t pixel_index){
+bool
+Subset::is_active(const int_t pixel_index)const{
   return is_active_.h_view(pixel_index);
 }
 
+void
+Subset::set_is_active(const int_t pixel_index,
+  const bool value){
+  is_active_.h_view(pixel_index) = value;
+}
+
 /// returns true if this pixel is deactivated for this particular frame
-bool &
-Subset::is_deactivated_this_step(const int_t pixel_index){
+bool
+Subset::is_deactivated_this_step(const int_t pixel_index)const{
   return is_deactivated_this_step_.h_view(pixel_index);
 }
 
+void
+Subset::set_is_deactivated_this_step(const int_t pixel_index,
+  const bool value){
+  is_deactivated_this_step_.h_view(pixel_index) = value;
+}
+
 
 void
 Subset::reset_is_active(){
@@ -342,7 +365,9 @@ void
 Subset::initialize(Teuchos::RCP<Image> image,
   const Subset_View_Target target,
   Teuchos::RCP<Local_Shape_Function> shape_function,
-  const Interpolation_Method interp){
+  const Interpolation_Method interp,
+  const int_t sample_stride){
+  Scoped_Profile_Timer init_timer(PROFILE_SUBSET_INITIALIZE);
 
   // coordinates for points x and y are always in global coordinates
   // if the input image is a sub-image i.e. it has offsets, then these need to be taken into account
@@ -365,6 +390,8 @@ Subset::initialize(Teuchos::RCP<Image> image,
   }
   // now sync up the intensities:
   if(target==REF_INTENSITIES){
+    // the steepest descent images depend on the reference intensities
+    has_steepest_descent_ = false;
     ref_intensities_.modify<device_space>();
     ref_intensities_.sync<host_space>();
     if(image->has_gradients()){
@@ -516,4 +543,39 @@ Subset_Init_Functor::operator()(const No_Map_Tag&,
   subset_intensities_(pixel_index) = image_intensities_(y_(pixel_index)-offset_y_,x_(pixel_index)-offset_x_);
 }
 
+void
+Subset::share_ref_intensities(Teuchos::RCP<Image> image){
+  // the functors need the intensities in a device view so they are always copied
+  initialize(image);
+}
+
+void
+Subset::move_to(const int_t cx,
+  const int_t cy){
+  TEUCHOS_TEST_FOR_EXCEPTION(is_conformal_,std::logic_error,"Error, conformal subsets cannot be moved");
+  TEUCHOS_TEST_FOR_EXCEPTION(cx<0,std::invalid_argument,"Error, cannot have negative coordinates for cx");
+  TEUCHOS_TEST_FOR_EXCEPTION(cy<0,std::invalid_argument,"Error, cannot have negative coordinates for cy");
+  const int_t dx = cx - cx_;
+  const int_t dy = cy - cy_;
+  for(int_t i=0;i<num_pixels_;++i){
+    x_.h_view(i) += dx;
+    y_.h_view(i) += dy;
+  }
+  x_.modify<host_space>();
+  y_.modify<host_space>();
+  x_.sync<device_space>();
+  y_.sync<device_space>();
+  cx_ = cx;
+  cy_ = cy;
+  reset_is_active();
+  reset_is_deactivated_this_step();
+  has_gradients_ = false;
+  has_steepest_descent_ = false;
+}
+
+void
+Subset::unshare_ref_intensities(){
+  // the reference intensities are never shared in builds with Kokkos
+}
+
 }// End DICe Namespace
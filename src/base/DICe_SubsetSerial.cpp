@@ -41,8 +41,11 @@
 
 #include <DICe_Subset.h>
 #include <DICe_ImageUtils.h>
+#include <DICe_Profiler.h>
 
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 namespace DICe {
 
@@ -55,7 +58,10 @@ Subset::Subset(int_t cx,
   cy_(cy),
   has_gradients_(false),
   is_conformal_(false),
-  sub_image_id_(0)
+  sub_image_id_(0),
+  has_steepest_descent_(false),
+  num_steepest_descent_params_(0),
+ memory_(MEMORY_SUBSETS)
 {
   assert(num_pixels_>0);
   assert(x.size()==y.size());
@@ -65,10 +71,12 @@ Subset::Subset(int_t cx,
   def_intensities_ = Teuchos::ArrayRCP<intensity_t>(num_pixels_,0.0);
   grad_x_ = Teuchos::ArrayRCP<scalar_t>(num_pixels_,0.0);
   grad_y_ = Teuchos::ArrayRCP<scalar_t>(num_pixels_,0.0);
-  is_active_ = Teuchos::ArrayRCP<bool>(num_pixels_,true);
-  is_deactivated_this_step_ = Teuchos::ArrayRCP<bool>(num_pixels_,false);
+  is_active_ = Teuchos::ArrayRCP<pixel_mask_t>(pixel_mask_size(num_pixels_),0);
+  is_deactivated_this_step_ = Teuchos::ArrayRCP<pixel_mask_t>(pixel_mask_size(num_pixels_),0);
   reset_is_active();
   reset_is_deactivated_this_step();
+  ref_is_shared_ = false;
+  update_memory_usage();
 }
 
 Subset::Subset(const int_t cx,
@@ -79,7 +87,10 @@ Subset::Subset(const int_t cx,
  cy_(cy),
  has_gradients_(false),
  is_conformal_(false),
- sub_image_id_(0)
+ sub_image_id_(0),
+ has_steepest_descent_(false),
+ num_steepest_descent_params_(0),
+ memory_(MEMORY_SUBSETS)
 {
   assert(width>0);
   assert(height>0);
@@ -102,10 +113,12 @@ Subset::Subset(const int_t cx,
   def_intensities_ = Teuchos::ArrayRCP<intensity_t>(num_pixels_,0.0);
   grad_x_ = Teuchos::ArrayRCP<scalar_t>(num_pixels_,0.0);
   grad_y_ = Teuchos::ArrayRCP<scalar_t>(num_pixels_,0.0);
-  is_active_ = Teuchos::ArrayRCP<bool>(num_pixels_,true);
-  is_deactivated_this_step_ = Teuchos::ArrayRCP<bool>(num_pixels_,false);
+  is_active_ = Teuchos::ArrayRCP<pixel_mask_t>(pixel_mask_size(num_pixels_),0);
+  is_deactivated_this_step_ = Teuchos::ArrayRCP<pixel_mask_t>(pixel_mask_size(num_pixels_),0);
   reset_is_active();
   reset_is_deactivated_this_step();
+  ref_is_shared_ = false;
+  update_memory_usage();
 }
 
 Subset::Subset(const int_t cx,
@@ -116,49 +129,52 @@ Subset::Subset(const int_t cx,
   has_gradients_(false),
   conformal_subset_def_(subset_def),
   is_conformal_(true),
-  sub_image_id_(0)
+  sub_image_id_(0),
+  has_steepest_descent_(false),
+  num_steepest_descent_params_(0),
+ memory_(MEMORY_SUBSETS)
 {
   assert(subset_def.has_boundary());
-  std::set<std::pair<int_t,int_t> > coords;
-  for(size_t i=0;i<subset_def.boundary()->size();++i){
-    std::set<std::pair<int_t,int_t> > shapeCoords = (*subset_def.boundary())[i]->get_owned_pixels();
-    coords.insert(shapeCoords.begin(),shapeCoords.end());
-  }
-  // at this point all the coordinate pairs are in the set
+  // the shapes cache their pixels so subsets that share a shape only rasterize it once
+  std::vector<std::pair<int_t,int_t> > coords;
+  reference_pixels(*subset_def.boundary(),coords);
+  // at this point all the coordinate pairs are in the vector
   num_pixels_ = coords.size();
   x_ = Teuchos::ArrayRCP<int_t>(num_pixels_,0);
   y_ = Teuchos::ArrayRCP<int_t>(num_pixels_,0);
-  int_t index = 0;
-  // NOTE: the pairs are (y,x) not (x,y) so that the ordering is correct in the set
-  std::set<std::pair<int_t,int_t> >::iterator set_it = coords.begin();
-  for( ; set_it!=coords.end();++set_it){
-    x_[index] = set_it->second;
-    y_[index] = set_it->first;
-    index++;
+  // NOTE: the pairs are (y,x) not (x,y) so that the ordering is correct
+  for(int_t index=0;index<num_pixels_;++index){
+    x_[index] = coords[index].second;
+    y_[index] = coords[index].first;
   }
   // warn the user if the centroid is outside the subset
   std::pair<int_t,int_t> centroid_pair = std::pair<int_t,int_t>(cy_,cx_);
-  if(coords.find(centroid_pair)==coords.end())
+  if(!std::binary_search(coords.begin(),coords.end(),centroid_pair))
     std::cout << "*** Warning: centroid " << cx_ << " " << cy_ << " is outside the subset boundary" << std::endl;
   ref_intensities_ = Teuchos::ArrayRCP<intensity_t>(num_pixels_,0.0);
   def_intensities_ = Teuchos::ArrayRCP<intensity_t>(num_pixels_,0.0);
   grad_x_ = Teuchos::ArrayRCP<scalar_t>(num_pixels_,0.0);
   grad_y_ = Teuchos::ArrayRCP<scalar_t>(num_pixels_,0.0);
-  is_active_ = Teuchos::ArrayRCP<bool>(num_pixels_,true);
-  is_deactivated_this_step_ = Teuchos::ArrayRCP<bool>(num_pixels_,false);
+  is_active_ = Teuchos::ArrayRCP<pixel_mask_t>(pixel_mask_size(num_pixels_),0);
+  is_deactivated_this_step_ = Teuchos::ArrayRCP<pixel_mask_t>(pixel_mask_size(num_pixels_),0);
   reset_is_active();
   reset_is_deactivated_this_step();
+  ref_is_shared_ = false;
+  update_memory_usage();
 
   // now set the inactive bit for the second set of multishapes if they exist.
   if(subset_def.has_excluded_area()){
+    // the shapes work on an array of bools so the flags are unpacked and packed again afterwards
+    Teuchos::ArrayRCP<bool> active(num_pixels_,true);
     for(size_t i=0;i<subset_def.excluded_area()->size();++i){
-      (*subset_def.excluded_area())[i]->deactivate_pixels(num_pixels_,is_active_.getRawPtr(),x_.getRawPtr(),y_.getRawPtr());
+      (*subset_def.excluded_area())[i]->deactivate_pixels(num_pixels_,active.getRawPtr(),x_.getRawPtr(),y_.getRawPtr());
     }
+    for(int_t i=0;i<num_pixels_;++i)
+      set_is_active(i,active[i]);
   }
   if(subset_def.has_obstructed_area()){
     for(size_t i=0;i<subset_def.obstructed_area()->size();++i){
-      std::set<std::pair<int_t,int_t> > obstructedArea = (*subset_def.obstructed_area())[i]->get_owned_pixels();
-      obstructed_coords_.insert(obstructedArea.begin(),obstructedArea.end());
+      (*subset_def.obstructed_area())[i]->rasterize(obstructed_coords_);
     }
   }
 }
@@ -185,6 +201,8 @@ Subset::grad_y(const int_t pixel_index)const{
 
 intensity_t&
 Subset::ref_intensities(const int_t pixel_index){
+  if(ref_is_shared_)
+    return shared_ref_intensities_[y_[pixel_index]*shared_ref_width_+x_[pixel_index]+shared_ref_origin_];
   return ref_intensities_[pixel_index];
 }
 
@@ -193,85 +211,206 @@ Subset::def_intensities(const int_t pixel_index){
   return def_intensities_[pixel_index];
 }
 
-/// returns true if this pixel is active
-bool &
-Subset::is_active(const int_t pixel_index){
-  return is_active_[pixel_index];
+/// returns the value of a bit in a pixel mask
+inline bool
+mask_bit(const Teuchos::ArrayRCP<pixel_mask_t> & mask,
+  const int_t pixel_index){
+  return (mask[pixel_index/pixel_mask_bits] >> (pixel_index%pixel_mask_bits)) & 1u;
+}
+
+/// sets the value of a bit in a pixel mask
+inline void
+set_mask_bit(Teuchos::ArrayRCP<pixel_mask_t> & mask,
+  const int_t pixel_index,
+  const bool value){
+  const pixel_mask_t bit = 1u << (pixel_index%pixel_mask_bits);
+  if(value)
+    mask[pixel_index/pixel_mask_bits] |= bit;
+  else
+    mask[pixel_index/pixel_mask_bits] &= ~bit;
+}
+
+/// returns true if a pixel is active and not deactivated this step
+inline bool
+pixel_in_use(const Teuchos::ArrayRCP<pixel_mask_t> & is_active,
+  const Teuchos::ArrayRCP<pixel_mask_t> & is_deactivated,
+  const int_t pixel_index){
+  const int_t word = pixel_index/pixel_mask_bits;
+  return ((is_active[word] & ~is_deactivated[word]) >> (pixel_index%pixel_mask_bits)) & 1u;
+}
+
+bool
+Subset::is_active(const int_t pixel_index)const{
+  return mask_bit(is_active_,pixel_index);
+}
+
+void
+Subset::set_is_active(const int_t pixel_index,
+  const bool value){
+  set_mask_bit(is_active_,pixel_index,value);
 }
 
-/// returns true if this pixel is deactivated for this particular frame
-bool &
-Subset::is_deactivated_this_step(const int_t pixel_index){
-  return is_deactivated_this_step_[pixel_index];
+bool
+Subset::is_deactivated_this_step(const int_t pixel_index)const{
+  return mask_bit(is_deactivated_this_step_,pixel_index);
+}
+
+void
+Subset::set_is_deactivated_this_step(const int_t pixel_index,
+  const bool value){
+  set_mask_bit(is_deactivated_this_step_,pixel_index,value);
 }
 
 void
 Subset::reset_is_active(){
-  for(int_t i=0;i<num_pixels_;++i)
-    is_active_[i] = true;
+  for(int_t i=0;i<is_active_.size();++i)
+    is_active_[i] = ~pixel_mask_t(0);
 }
 
 void
 Subset::reset_is_deactivated_this_step(){
+  for(int_t i=0;i<is_deactivated_this_step_.size();++i)
+    is_deactivated_this_step_[i] = 0;
+}
+
+/// scratch storage for the reductions below, owned by the calling thread so that no allocations
+/// are made once the first subset has been processed
+struct Subset_Reduction_Scratch{
+  /// one weight per pixel, 1 if the pixel is in use, 0 otherwise
+  std::vector<intensity_t> weights;
+  /// reference intensities gathered from a shared reference image
+  std::vector<intensity_t> ref_values;
+};
+
+inline Subset_Reduction_Scratch &
+reduction_scratch(){
+  static thread_local Subset_Reduction_Scratch scratch;
+  return scratch;
+}
+
+/// unpacks the pixel masks into weights so the reductions below are branchless and vectorize
+inline const intensity_t *
+pixel_in_use_weights(const Teuchos::ArrayRCP<pixel_mask_t> & is_active,
+  const Teuchos::ArrayRCP<pixel_mask_t> & is_deactivated,
+  const int_t num_pixels,
+  std::vector<intensity_t> & weights){
+  if((int_t)weights.size()<num_pixels) weights.resize(num_pixels);
+  for(int_t begin=0;begin<num_pixels;begin+=pixel_mask_bits){
+    const pixel_mask_t bits = is_active[begin/pixel_mask_bits] & ~is_deactivated[begin/pixel_mask_bits];
+    const int_t end = std::min(begin+pixel_mask_bits,num_pixels);
+    for(int_t i=begin;i<end;++i)
+      weights[i] = static_cast<intensity_t>((bits >> (i-begin)) & 1u);
+  }
+  return &weights[0];
+}
+
+/// sum of the weighted values and of the weights
+inline void
+masked_sum(const int_t num_pixels,
+  const intensity_t * weights,
+  const intensity_t * values,
+  accumulate_t & sum,
+  accumulate_t & count){
+  accumulate_t s = 0.0, c = 0.0;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:s,c)
+#endif
+  for(int_t i=0;i<num_pixels;++i){
+    s += (accumulate_t)weights[i]*values[i];
+    c += weights[i];
+  }
+  sum = s;
+  count = c;
+}
+
+/// weighted sum of the squared differences from the mean
+inline accumulate_t
+masked_sum_sq_diff(const int_t num_pixels,
+  const intensity_t * weights,
+  const intensity_t * values,
+  const accumulate_t & mean){
+  accumulate_t sum_sq = 0.0;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:sum_sq)
+#endif
+  for(int_t i=0;i<num_pixels;++i){
+    const accumulate_t diff = values[i]-mean;
+    sum_sq += weights[i]*diff*diff;
+  }
+  return sum_sq;
+}
+
+const intensity_t *
+Subset::reduction_values(const Subset_View_Target target){
+  if(target==DEF_INTENSITIES) return def_intensities_.getRawPtr();
+  if(!ref_is_shared_) return ref_intensities_.getRawPtr();
+  std::vector<intensity_t> & values = reduction_scratch().ref_values;
+  if((int_t)values.size()<num_pixels_) values.resize(num_pixels_);
   for(int_t i=0;i<num_pixels_;++i)
-    is_deactivated_this_step_[i] = false;
+    values[i] = shared_ref_intensities_[y_[i]*shared_ref_width_+x_[i]+shared_ref_origin_];
+  return &values[0];
 }
 
 scalar_t
 Subset::mean(const Subset_View_Target target){
-  scalar_t mean = 0.0;
-  int_t num_active = num_active_pixels();
-  if(target==REF_INTENSITIES){
-    for(int_t i=0;i<num_pixels_;++i){
-      if(is_active_[i]&!is_deactivated_this_step_[i])
-        mean += ref_intensities_[i];
-    }
-  }else{
-    for(int_t i=0;i<num_pixels_;++i)
-      if(is_active_[i]&!is_deactivated_this_step_[i]){
-        mean += def_intensities_[i];
-      }
-  }
-  return num_active != 0 ? mean/num_active : 0.0;
+  if(num_pixels_==0) return 0.0;
+  const intensity_t * weights = pixel_in_use_weights(is_active_,is_deactivated_this_step_,num_pixels_,reduction_scratch().weights);
+  accumulate_t sum = 0.0, count = 0.0;
+  masked_sum(num_pixels_,weights,reduction_values(target),sum,count);
+  return count != 0.0 ? sum/count : 0.0;
 }
 
 scalar_t
 Subset::mean(const Subset_View_Target target,
   scalar_t & sum){
-  scalar_t mean_ = mean(target);
   sum = 0.0;
-  if(target==REF_INTENSITIES){
-    for(int_t i=0;i<num_pixels_;++i){
-      if(is_active_[i]&!is_deactivated_this_step_[i])
-        sum += (ref_intensities_[i]-mean_)*(ref_intensities_[i]-mean_);
-    }
-  }else{
-    for(int_t i=0;i<num_pixels_;++i){
-      if(is_active_[i]&!is_deactivated_this_step_[i])
-        sum += (def_intensities_[i]-mean_)*(def_intensities_[i]-mean_);
-    }
-  }
-  sum = std::sqrt(sum);
+  if(num_pixels_==0) return 0.0;
+  // the weights and values are prepared once for both passes
+  const intensity_t * weights = pixel_in_use_weights(is_active_,is_deactivated_this_step_,num_pixels_,reduction_scratch().weights);
+  const intensity_t * values = reduction_values(target);
+  accumulate_t value_sum = 0.0, count = 0.0;
+  masked_sum(num_pixels_,weights,values,value_sum,count);
+  const scalar_t mean_ = count != 0.0 ? value_sum/count : 0.0;
+  sum = std::sqrt(masked_sum_sq_diff(num_pixels_,weights,values,mean_));
   return mean_;
 }
 
 scalar_t
 Subset::gamma(){
   // assumes obstructed pixels are already turned off
-  scalar_t mean_sum_ref = 0.0;
-  const scalar_t mean_ref = mean(REF_INTENSITIES,mean_sum_ref);
-  scalar_t mean_sum_def = 0.0;
-  const scalar_t mean_def = mean(DEF_INTENSITIES,mean_sum_def);
-  if(mean_sum_ref==0.0||mean_sum_def==0.0) return -1.0;
-  scalar_t gamma = 0.0;
-  scalar_t value = 0.0;
+  if(num_pixels_==0) return -1.0;
+  const intensity_t * weights = pixel_in_use_weights(is_active_,is_deactivated_this_step_,num_pixels_,reduction_scratch().weights);
+  const intensity_t * ref = reduction_values(REF_INTENSITIES);
+  const intensity_t * def = def_intensities_.getRawPtr();
+  // first pass: the means of both subsets
+  accumulate_t sum_ref = 0.0, sum_def = 0.0, count = 0.0;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:sum_ref,sum_def,count)
+#endif
   for(int_t i=0;i<num_pixels_;++i){
-    if(is_active_[i]&!is_deactivated_this_step_[i]){
-      value = (def_intensities_[i]-mean_def)/mean_sum_def - (ref_intensities_[i]-mean_ref)/mean_sum_ref;
-      gamma += value*value;
-    }
+    sum_ref += (accumulate_t)weights[i]*ref[i];
+    sum_def += (accumulate_t)weights[i]*def[i];
+    count += weights[i];
   }
-  return gamma;
+  if(count==0.0) return -1.0;
+  const accumulate_t mean_ref = sum_ref/count;
+  const accumulate_t mean_def = sum_def/count;
+  // second pass: the centered second moments, from which the normalized
+  // sum of squared differences follows as 2 - 2*(cross term)/(norm_ref*norm_def)
+  accumulate_t sq_ref = 0.0, sq_def = 0.0, cross = 0.0;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:sq_ref,sq_def,cross)
+#endif
+  for(int_t i=0;i<num_pixels_;++i){
+    const accumulate_t f = weights[i]*(ref[i]-mean_ref);
+    const accumulate_t g = weights[i]*(def[i]-mean_def);
+    sq_ref += f*f;
+    sq_def += g*g;
+    cross += f*g;
+  }
+  if(sq_ref==0.0||sq_def==0.0) return -1.0;
+  const accumulate_t gamma = 2.0 - 2.0*cross/(std::sqrt(sq_ref)*std::sqrt(sq_def));
+  return gamma > 0.0 ? gamma : 0.0;
 }
 
 Teuchos::ArrayRCP<scalar_t>
@@ -288,19 +427,38 @@ Subset::grad_y_array()const{
 scalar_t
 Subset::sssig(){
   // assumes obstructed pixels are already turned off
-  scalar_t sssig = 0.0;
+  accumulate_t sssig = 0.0;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(+:sssig)
+#endif
   for(int_t i=0;i<num_pixels_;++i){
-    sssig += grad_x_[i]*grad_x_[i] + grad_y_[i]*grad_y_[i];
+    sssig += (accumulate_t)grad_x_[i]*grad_x_[i] + (accumulate_t)grad_y_[i]*grad_y_[i];
   }
   sssig /= num_pixels_==0.0?1.0:num_pixels_;
   return sssig;
 }
 
+/// returns true if the shape function shifts the pixels by a whole number of pixels and the interpolant
+/// reproduces the stored image values at the pixel locations (the B-splines smooth the intensities
+/// and analytic gradients differ from the stored finite difference gradients, so those are interpolated)
+inline bool
+whole_pixel_shift(const Teuchos::RCP<Image> & image,
+  const Teuchos::RCP<Local_Shape_Function> & shape_function,
+  const Interpolation_Method interp,
+  int_t & shift_x,
+  int_t & shift_y){
+  if(interp!=BILINEAR&&interp!=BICUBIC&&interp!=KEYS_FOURTH) return false;
+  if(image->analytic_gradients()) return false;
+  return shape_function->integer_translation(shift_x,shift_y);
+}
+
 void
 Subset::initialize(Teuchos::RCP<Image> image,
   const Subset_View_Target target,
   Teuchos::RCP<Local_Shape_Function> shape_function,
-  const Interpolation_Method interp){
+  const Interpolation_Method interp,
+  const int_t sample_stride){
+  Scoped_Profile_Timer init_timer(PROFILE_SUBSET_INITIALIZE);
 
   // coordinates for points x and y are always in global coordinates
   // if the input image is a sub-image i.e. it has offsets, then these need to be taken into account
@@ -308,71 +466,146 @@ Subset::initialize(Teuchos::RCP<Image> image,
   const int_t offset_y = image->offset_y();
   const int_t w = image->width();
   const int_t h = image->height();
+  if(target==REF_INTENSITIES&&ref_is_shared_){
+    // the new values go in a private array
+    shared_ref_intensities_ = Teuchos::null;
+    ref_intensities_ = Teuchos::ArrayRCP<intensity_t>(num_pixels_,0.0);
+    ref_is_shared_ = false;
+    update_memory_usage();
+  }
   Teuchos::ArrayRCP<intensity_t> intensities_ = target==REF_INTENSITIES ? ref_intensities_ : def_intensities_;
+  int_t shift_x = 0, shift_y = 0;
   // assume if the map is null, use the no_map_tag in the parrel for call of the functor
   if(shape_function==Teuchos::null){
     for(int_t i=0;i<num_pixels_;++i)
       intensities_[i] = (*image)(x_[i]-offset_x,y_[i]-offset_y);
   }
+  else if(whole_pixel_shift(image,shape_function,interp,shift_x,shift_y)){
+    // every pixel maps onto a pixel of the image where the interpolants reproduce the stored
+    // intensities and gradients, so the values are copied directly
+    const bool has_blocks = !pixels_blocked_by_other_subsets_.empty();
+    const bool has_grads = image->has_gradients();
+    if(has_grads&&num_pixels_>0&&image->num_pending_gradient_tiles()>0){
+      int_t min_x = x_[0], max_x = x_[0], min_y = y_[0], max_y = y_[0];
+      for(int_t i=1;i<num_pixels_;++i){
+        min_x = std::min(min_x,x_[i]);
+        max_x = std::max(max_x,x_[i]);
+        min_y = std::min(min_y,y_[i]);
+        max_y = std::max(max_y,y_[i]);
+      }
+      image->compute_gradient_tiles(min_x+shift_x-offset_x,min_y+shift_y-offset_y,max_x+shift_x-offset_x,max_y+shift_y-offset_y);
+    }
+    for(int_t i=0;i<num_pixels_;++i){
+      const int_t px = x_[i] + shift_x;
+      const int_t py = y_[i] + shift_y;
+      // same deactivation rules as the general path below
+      if((sample_stride>1&&(x_[i]+y_[i])%sample_stride!=0)||px<offset_x+4||px>=offset_x+w-4||py<offset_y+4||py>=offset_y+h-4
+          ||is_obstructed_pixel(px,py)||(has_blocks&&pixels_blocked_by_other_subsets_.contains(px,py))){
+        set_is_deactivated_this_step(i,true);
+        continue;
+      }
+      set_is_deactivated_this_step(i,false);
+      intensities_[i] = (*image)(px-offset_x,py-offset_y);
+      if(has_grads){
+        grad_x_[i] = image->grad_x(px-offset_x,py-offset_y);
+        grad_y_[i] = image->grad_y(px-offset_x,py-offset_y);
+      }
+    }
+  }
   else{
     int_t px,py;
     const bool has_blocks = !pixels_blocked_by_other_subsets_.empty();
-    // initialize the work variables
-    scalar_t mapped_x = 0.0;
-    scalar_t mapped_y = 0.0;
+    // map all the pixels in one call to the shape function (the storage is reused by each thread)
+    static thread_local std::vector<scalar_t> mapped_x_array;
+    static thread_local std::vector<scalar_t> mapped_y_array;
+    if((int_t)mapped_x_array.size()<num_pixels_){
+      mapped_x_array.resize(num_pixels_);
+      mapped_y_array.resize(num_pixels_);
+    }
+    shape_function->batch_map(num_pixels_,x_.getRawPtr(),y_.getRawPtr(),cx_,cy_,&mapped_x_array[0],&mapped_y_array[0]);
+    // the active pixels are gathered into contiguous local coordinate arrays for the interpolation
+    static thread_local std::vector<scalar_t> active_local_x;
+    static thread_local std::vector<scalar_t> active_local_y;
+    static thread_local std::vector<int_t> active_index;
+    static thread_local std::vector<intensity_t> active_intensities;
+    static thread_local std::vector<scalar_t> active_grad_x;
+    static thread_local std::vector<scalar_t> active_grad_y;
+    if((int_t)active_local_x.size()<num_pixels_){
+      active_local_x.resize(num_pixels_);
+      active_local_y.resize(num_pixels_);
+      active_index.resize(num_pixels_);
+      active_intensities.resize(num_pixels_);
+      active_grad_x.resize(num_pixels_);
+      active_grad_y.resize(num_pixels_);
+    }
+    int_t num_active = 0;
     const scalar_t ox=(scalar_t)offset_x,oy=(scalar_t)offset_y;
     for(int_t i=0;i<num_pixels_;++i){
-      shape_function->map(x_[i],y_[i],cx_,cy_,mapped_x,mapped_y);
+      // pixels left out of the sample lie on every stride-th diagonal so each row and column is sampled
+      if(sample_stride>1&&(x_[i]+y_[i])%sample_stride!=0){
+        set_is_deactivated_this_step(i,true);
+        continue;
+      }
+      const scalar_t & mapped_x = mapped_x_array[i];
+      const scalar_t & mapped_y = mapped_y_array[i];
       px = ((int_t)(mapped_x + 0.5) == (int_t)(mapped_x)) ? (int_t)(mapped_x) : (int_t)(mapped_x) + 1;
       py = ((int_t)(mapped_y + 0.5) == (int_t)(mapped_y)) ? (int_t)(mapped_y) : (int_t)(mapped_y) + 1;
       // out of image bounds ( 4 pixel buffer to ensure enough room to interpolate away from the sub image boundary)
       if(px<offset_x+4||px>=offset_x+w-4||py<offset_y+4||py>=offset_y+h-4){
-        is_deactivated_this_step(i) = true;
+        set_is_deactivated_this_step(i,true);
         continue;
       }
       if(is_obstructed_pixel(mapped_x,mapped_y)){
-        is_deactivated_this_step(i) = true;
+        set_is_deactivated_this_step(i,true);
         continue;
       }
       if(has_blocks){
-        if(pixels_blocked_by_other_subsets_.find(std::pair<int_t,int_t>(py,px))
-            !=pixels_blocked_by_other_subsets_.end()){
-          is_deactivated_this_step(i) = true;
+        if(pixels_blocked_by_other_subsets_.contains(px,py)){
+          set_is_deactivated_this_step(i,true);
           continue;
         }
       }
       // if the code got here, the pixel is not deactivated
-      is_deactivated_this_step(i) = false;
-      if(interp==BILINEAR){
-        intensities_[i] = image->interpolate_bilinear(mapped_x-ox,mapped_y-oy);
-        if(image->has_gradients()){
-          grad_x_[i] = image->interpolate_grad_x_bilinear(mapped_x-ox,mapped_y-oy);
-          grad_y_[i] = image->interpolate_grad_y_bilinear(mapped_x-ox,mapped_y-oy);
-        }
-      }
-      else if(interp==BICUBIC){
-        intensities_[i] = image->interpolate_bicubic(mapped_x-ox,mapped_y-oy);
-        if(image->has_gradients()){
-          grad_x_[i] = image->interpolate_grad_x_bicubic(mapped_x-ox,mapped_y-oy);
-          grad_y_[i] = image->interpolate_grad_y_bicubic(mapped_x-ox,mapped_y-oy);
-        }
-      }
-      else if(interp==KEYS_FOURTH){
-        intensities_[i] = image->interpolate_keys_fourth(mapped_x-ox,mapped_y-oy);
-        if(image->has_gradients()){
-          grad_x_[i] = image->interpolate_grad_x_keys_fourth(mapped_x-ox,mapped_y-oy);
-          grad_y_[i] = image->interpolate_grad_y_keys_fourth(mapped_x-ox,mapped_y-oy);
-        }
+      set_is_deactivated_this_step(i,false);
+      active_local_x[num_active] = mapped_x-ox;
+      active_local_y[num_active] = mapped_y-oy;
+      active_index[num_active] = i;
+      num_active++;
+    }
+    // interpolate the intensities and gradients of all the active pixels in one pass
+    // so the interpolation weights are only computed once per pixel
+    // (images with analytic gradients differentiate the interpolant instead of storing gradients)
+    const bool has_grads = image->has_gradients()||image->analytic_gradients();
+    if(has_grads&&num_active>0&&image->num_pending_gradient_tiles()>0){
+      // the interpolation stencils reach up to three pixels past the mapped locations
+      scalar_t min_x = active_local_x[0], max_x = active_local_x[0];
+      scalar_t min_y = active_local_y[0], max_y = active_local_y[0];
+      for(int_t j=1;j<num_active;++j){
+        min_x = std::min(min_x,active_local_x[j]);
+        max_x = std::max(max_x,active_local_x[j]);
+        min_y = std::min(min_y,active_local_y[j]);
+        max_y = std::max(max_y,active_local_y[j]);
       }
-      else{
-        TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,
-          "Error, unknown interpolation method requested");
+      image->compute_gradient_tiles((int_t)min_x-3,(int_t)min_y-3,(int_t)max_x+3,(int_t)max_y+3);
+    }
+    if(num_active>0)
+      image->batch_interpolate(num_active,&active_local_x[0],&active_local_y[0],&active_intensities[0],
+        has_grads ? &active_grad_x[0] : NULL,has_grads ? &active_grad_y[0] : NULL,interp);
+    for(int_t j=0;j<num_active;++j){
+      const int_t i = active_index[j];
+      intensities_[i] = active_intensities[j];
+      if(has_grads){
+        grad_x_[i] = active_grad_x[j];
+        grad_y_[i] = active_grad_y[j];
       }
     }
   }
   // now sync up the intensities:
   if(target==REF_INTENSITIES){
+    // the steepest descent images depend on the reference intensities
+    has_steepest_descent_ = false;
     if(image->has_gradients()){
+      request_gradient_tiles(image);
       // copy over the image gradients:
       for(int_t px=0;px<num_pixels_;++px){
         grad_x_[px] = image->grad_x(x_[px]-offset_x,y_[px]-offset_y);
@@ -383,4 +616,66 @@ Subset::initialize(Teuchos::RCP<Image> image,
   }
 }
 
+void
+Subset::share_ref_intensities(Teuchos::RCP<Image> image){
+  const int_t offset_x = image->offset_x();
+  const int_t offset_y = image->offset_y();
+  const int_t w = image->width();
+  const int_t h = image->height();
+  for(int_t i=0;i<num_pixels_;++i){
+    if(x_[i]-offset_x<0||x_[i]-offset_x>=w||y_[i]-offset_y<0||y_[i]-offset_y>=h){
+      // let initialize() deal with pixels outside the image
+      initialize(image);
+      return;
+    }
+  }
+  // holding the array keeps the values alive even if the image is replaced
+  shared_ref_intensities_ = image->intensities();
+  shared_ref_width_ = w;
+  shared_ref_origin_ = -offset_y*w - offset_x;
+  ref_intensities_ = Teuchos::null;
+  ref_is_shared_ = true;
+  // the steepest descent images depend on the reference intensities
+  has_steepest_descent_ = false;
+  if(image->has_gradients()){
+    request_gradient_tiles(image);
+    for(int_t px=0;px<num_pixels_;++px){
+      grad_x_[px] = image->grad_x(x_[px]-offset_x,y_[px]-offset_y);
+      grad_y_[px] = image->grad_y(x_[px]-offset_x,y_[px]-offset_y);
+    }
+    has_gradients_ = true;
+  }
+  update_memory_usage();
+}
+
+void
+Subset::move_to(const int_t cx,
+  const int_t cy){
+  TEUCHOS_TEST_FOR_EXCEPTION(is_conformal_,std::logic_error,"Error, conformal subsets cannot be moved");
+  const int_t dx = cx - cx_;
+  const int_t dy = cy - cy_;
+  for(int_t i=0;i<num_pixels_;++i){
+    x_[i] += dx;
+    y_[i] += dy;
+  }
+  cx_ = cx;
+  cy_ = cy;
+  reset_is_active();
+  reset_is_deactivated_this_step();
+  has_gradients_ = false;
+  has_steepest_descent_ = false;
+}
+
+void
+Subset::unshare_ref_intensities(){
+  if(!ref_is_shared_) return;
+  Teuchos::ArrayRCP<intensity_t> values(num_pixels_,0.0);
+  for(int_t i=0;i<num_pixels_;++i)
+    values[i] = ref_intensities(i);
+  shared_ref_intensities_ = Teuchos::null;
+  ref_intensities_ = values;
+  ref_is_shared_ = false;
+  update_memory_usage();
+}
+
 }// End DICe Namespace
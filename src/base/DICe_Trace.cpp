@@ -0,0 +1,240 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_Trace.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if DICE_MPI
+#  include <mpi.h>
+#endif
+
+namespace DICe {
+
+bool Trace_Recorder::enabled_ = false;
+
+namespace {
+
+/// ring buffer of the spans recorded by one thread
+struct Trace_Buffer{
+  /// the spans
+  std::vector<Trace_Event> events;
+  /// index the next span is stored at
+  size_t next;
+  /// number of valid spans
+  size_t count;
+  /// number of overwritten spans
+  size_t dropped;
+  /// id of the thread in the trace
+  int_t tid;
+  /// recording generation the buffer was last cleared for
+  int_t generation;
+};
+
+/// guards the list of buffers (only taken when a thread records its first span)
+std::mutex trace_mutex;
+/// all the buffers ever created, kept after the threads end so their spans can be written
+std::vector<std::shared_ptr<Trace_Buffer> > trace_buffers;
+/// size of each ring buffer
+size_t trace_capacity = 65536;
+/// incremented by each start() so stale thread buffers get cleared
+int_t trace_generation = 0;
+/// origin of the time line
+std::chrono::steady_clock::time_point trace_origin = std::chrono::steady_clock::now();
+/// buffer of the calling thread
+thread_local std::shared_ptr<Trace_Buffer> local_buffer;
+/// innermost open span of the calling thread
+thread_local Scoped_Trace_Span * current_span = 0;
+
+/// returns the calling thread's buffer, creating or clearing it as needed
+Trace_Buffer & thread_buffer(){
+  if(local_buffer==nullptr){
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    local_buffer = std::make_shared<Trace_Buffer>();
+    local_buffer->tid = trace_buffers.size();
+    local_buffer->generation = -1;
+    trace_buffers.push_back(local_buffer);
+  }
+  if(local_buffer->generation!=trace_generation){
+    local_buffer->events.resize(trace_capacity);
+    local_buffer->next = 0;
+    local_buffer->count = 0;
+    local_buffer->dropped = 0;
+    local_buffer->generation = trace_generation;
+  }
+  return *local_buffer;
+}
+
+/// writes the characters of a string literal with the json escapes needed for names
+void write_json_string(std::ostream & os,
+  const char * str){
+  os << "\"";
+  for(const char * c=str;*c!='\0';++c){
+    if(*c=='"'||*c=='\\') os << '\\';
+    os << *c;
+  }
+  os << "\"";
+}
+
+}
+
+void
+Trace_Recorder::start(const int_t events_per_thread){
+  TEUCHOS_TEST_FOR_EXCEPTION(events_per_thread<1,std::runtime_error,"Error, the trace buffers must hold at least one event");
+#if DICE_MPI
+  MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  trace_capacity = events_per_thread;
+  trace_generation++;
+  trace_origin = std::chrono::steady_clock::now();
+  enabled_ = true;
+}
+
+void
+Trace_Recorder::stop(){
+  enabled_ = false;
+}
+
+long long
+Trace_Recorder::now(){
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_origin).count();
+}
+
+void
+Trace_Recorder::record(const Trace_Event & event){
+  Trace_Buffer & buffer = thread_buffer();
+  buffer.events[buffer.next] = event;
+  buffer.next = (buffer.next + 1) % buffer.events.size();
+  if(buffer.count<buffer.events.size())
+    buffer.count++;
+  else
+    buffer.dropped++;
+}
+
+void
+Trace_Recorder::set_status(const int_t status){
+  if(current_span!=0)
+    current_span->set_status(status);
+}
+
+size_t
+Trace_Recorder::num_events(){
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  size_t num = 0;
+  for(size_t i=0;i<trace_buffers.size();++i)
+    if(trace_buffers[i]->generation==trace_generation)
+      num += trace_buffers[i]->count;
+  return num;
+}
+
+size_t
+Trace_Recorder::num_dropped(){
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  size_t num = 0;
+  for(size_t i=0;i<trace_buffers.size();++i)
+    if(trace_buffers[i]->generation==trace_generation)
+      num += trace_buffers[i]->dropped;
+  return num;
+}
+
+void
+Trace_Recorder::write(const std::string & file_name){
+  int_t proc_rank = 0;
+#if DICE_MPI
+  MPI_Comm_rank(MPI_COMM_WORLD,&proc_rank);
+#endif
+  std::ofstream out(file_name.c_str());
+  TEUCHOS_TEST_FOR_EXCEPTION(!out.good(),std::runtime_error,"Error, could not open the trace file " << file_name);
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+  out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << proc_rank << ", \"args\": {\"name\": \"processor " << proc_rank << "\"}}";
+  for(size_t b=0;b<trace_buffers.size();++b){
+    const Trace_Buffer & buffer = *trace_buffers[b];
+    if(buffer.generation!=trace_generation) continue;
+    // the oldest span is at next once the buffer has wrapped
+    const size_t first = buffer.count<buffer.events.size() ? 0 : buffer.next;
+    for(size_t i=0;i<buffer.count;++i){
+      const Trace_Event & event = buffer.events[(first + i) % buffer.events.size()];
+      out << "," << std::endl << "{\"name\": ";
+      write_json_string(out,event.name);
+      out << ", \"cat\": ";
+      write_json_string(out,event.category);
+      out << ", \"ph\": \"X\", \"ts\": " << event.start/1000.0 << ", \"dur\": " << event.duration/1000.0
+          << ", \"pid\": " << proc_rank << ", \"tid\": " << buffer.tid;
+      if(event.gid>=0||event.status>=0){
+        out << ", \"args\": {";
+        if(event.gid>=0) out << "\"gid\": " << event.gid << (event.status>=0 ? ", " : "");
+        if(event.status>=0) out << "\"status\": " << event.status;
+        out << "}";
+      }
+      out << "}";
+    }
+  }
+  out << std::endl << "]}" << std::endl;
+  out.close();
+}
+
+void
+Scoped_Trace_Span::open(const char * name,
+  const char * category,
+  const int_t gid){
+  event_.name = name;
+  event_.category = category;
+  event_.gid = gid;
+  event_.status = -1;
+  parent_ = current_span;
+  current_span = this;
+  event_.start = Trace_Recorder::now();
+}
+
+void
+Scoped_Trace_Span::close(){
+  event_.duration = Trace_Recorder::now() - event_.start;
+  current_span = parent_;
+  Trace_Recorder::record(event_);
+}
+
+}// End DICe Namespace
@@ -0,0 +1,170 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#ifndef DICE_TRACE_H
+#define DICE_TRACE_H
+
+#include <DICe.h>
+
+#include <string>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// A completed span of the timeline
+struct Trace_Event{
+  /// name of the span (must be a string literal, the pointer is stored)
+  const char * name;
+  /// category of the span (must be a string literal, the pointer is stored)
+  const char * category;
+  /// start of the span in nanoseconds since the recording started
+  long long start;
+  /// duration of the span in nanoseconds
+  long long duration;
+  /// optional global id of the subset or frame (-1 if not applicable)
+  int_t gid;
+  /// optional status flag (-1 if not applicable)
+  int_t status;
+};
+
+/// \class DICe::Trace_Recorder
+/// \brief Records spans of the run into per thread ring buffers and writes them as a
+/// chrome trace-event json file (which can be opened with chrome://tracing or Perfetto)
+///
+/// Recording is turned on at runtime. A span that is not recorded costs a single branch.
+/// Each thread owns a ring buffer so recording a span takes no locks, once a buffer is full
+/// the oldest spans are overwritten. start(), stop() and write() should be called outside of
+/// any threaded region and with the background threads idle.
+class
+DICE_LIB_DLL_EXPORT
+Trace_Recorder{
+public:
+  /// returns true if spans are being recorded
+  static bool enabled(){
+    return enabled_;
+  }
+
+  /// start recording, clears any previously recorded spans
+  /// (collective when MPI is enabled so the time lines of all processors share an origin)
+  /// \param events_per_thread the size of each thread's ring buffer
+  static void start(const int_t events_per_thread=65536);
+
+  /// stop recording, the recorded spans are kept until the next start()
+  static void stop();
+
+  /// returns the number of nanoseconds since the recording started
+  static long long now();
+
+  /// store a completed span in the calling thread's ring buffer
+  /// \param event the span
+  static void record(const Trace_Event & event);
+
+  /// set the status of the innermost open span on the calling thread
+  /// \param status the status flag
+  static void set_status(const int_t status);
+
+  /// returns the number of spans currently held in the ring buffers
+  static size_t num_events();
+
+  /// returns the number of spans that were overwritten because a ring buffer was full
+  static size_t num_dropped();
+
+  /// write the spans recorded on this processor (the processor rank is used as the trace pid)
+  /// \param file_name the name of the json file
+  static void write(const std::string & file_name);
+
+private:
+  /// true if spans are being recorded
+  static bool enabled_;
+};
+
+/// \class DICe::Scoped_Trace_Span
+/// \brief Records the enclosing scope as a span of the timeline
+class
+DICE_LIB_DLL_EXPORT
+Scoped_Trace_Span{
+public:
+  /// constructor
+  /// \param name the name of the span (must be a string literal)
+  /// \param category the category of the span (must be a string literal)
+  /// \param gid optional global id of the subset or frame
+  Scoped_Trace_Span(const char * name,
+    const char * category,
+    const int_t gid=-1):
+    recording_(Trace_Recorder::enabled()){
+    if(recording_) open(name,category,gid);
+  }
+
+  /// destructor records the span
+  ~Scoped_Trace_Span(){
+    if(recording_) close();
+  }
+
+  /// set the status flag of the span
+  /// \param status the status flag
+  void set_status(const int_t status){
+    event_.status = status;
+  }
+
+private:
+  /// start the span and make it the innermost span of this thread
+  void open(const char * name,
+    const char * category,
+    const int_t gid);
+  /// record the span and restore the enclosing span
+  void close();
+  /// true if the recorder was enabled when the scope started
+  const bool recording_;
+  /// the span being recorded
+  Trace_Event event_;
+  /// the span that encloses this one on the same thread
+  Scoped_Trace_Span * parent_;
+  friend class Trace_Recorder;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -46,6 +46,20 @@
 #include <time.h>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#if !defined(WIN32)
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
 
 namespace DICe {
 namespace cine {
@@ -79,20 +93,60 @@ const static uint16_t LinLUT[1024] =
  3732,3740, 3749,3757,3765,3773,3781,3789,3798,3806,3814,3822,3830,3839,3847,3855,3863,3872, 3880,3888,3897,3905,3913,3922,3930,3938,3947,3955,3963,3972,3980,3989,3997,4006, 4014,4022,4031,4039,4048,4056,
  4064,4095,4095,4095,4095,4095,4095,4095,4095,4095 };
 
+/// returns the raw 10 bit value of pixel x from a row of 10 bit packed pixels
+/// (four pixels are packed into every five bytes, most significant bits first)
+inline uint16_t
+packed_10_bit_value(const uint8_t * row,
+  const int_t x){
+  const int_t slot = x*10/8;
+  const int_t chunk_offset = x%4;
+  const uint16_t two_byte = ((uint16_t)row[slot] << 8) | row[slot+1];
+  return (two_byte >> (6 - (chunk_offset*2))) & 0x3FF;
+}
+
+/// unpacks the raw 10 bit values of pixels x_begin to x_end-1 from a row of 10 bit packed pixels
+/// whole groups of four pixels are unpacked at once with fixed shifts, only the partial
+/// groups at the ends of the range use the per pixel offsets
+inline void
+unpack_10_bit_row(const uint8_t * row,
+  const int_t x_begin,
+  const int_t x_end,
+  uint16_t * values){
+  int_t x = x_begin;
+  for(;x<x_end&&x%4!=0;++x)
+    values[x-x_begin] = packed_10_bit_value(row,x);
+  for(;x+4<=x_end;x+=4){
+    const uint8_t * b = row + (x/4)*5;
+    uint16_t * v = values + (x-x_begin);
+    v[0] = ((uint16_t)b[0] << 2) | (b[1] >> 6);
+    v[1] = ((uint16_t)(b[1] & 0x3F) << 4) | (b[2] >> 4);
+    v[2] = ((uint16_t)(b[2] & 0x0F) << 6) | (b[3] >> 2);
+    v[3] = ((uint16_t)(b[3] & 0x03) << 8) | b[4];
+  }
+  for(;x<x_end;++x)
+    values[x-x_begin] = packed_10_bit_value(row,x);
+}
+
 Cine_Reader::Cine_Reader(const std::string & file_name,
   std::ostream * out_stream,
-  const bool filter_failed_pixels):
+  const bool filter_failed_pixels,
+  const bool use_memory_map,
+  const Teuchos::RCP<Cine_Header> & cine_header):
+  cine_header_(cine_header),
   out_stream_(out_stream),
   bit_12_warning_(false),
   filter_failed_pixels_(filter_failed_pixels),
   filter_value_(0.0),
-  conversion_factor_(0.0)
+  conversion_factor_(0.0),
+  mapped_file_(NULL),
+  mapped_size_(0)
 {
-  cine_header_ = read_cine_headers(file_name.c_str(),out_stream);
+  if(cine_header_==Teuchos::null)
+    cine_header_ = read_cine_headers(file_name.c_str(),out_stream);
 
-  const int64_t begin = cine_header_->image_offsets_[0];
   TEUCHOS_TEST_FOR_EXCEPTION(cine_header_->header_.ImageCount<=1,std::runtime_error,"Error, cine must have at least two images");
-  const int64_t end = cine_header_->image_offsets_[1];
+  const int64_t begin = cine_header_->image_offset(0);
+  const int64_t end = cine_header_->image_offset(1);
   long long int buffer_size = end - begin;
   TEUCHOS_TEST_FOR_EXCEPTION(buffer_size<=0,std::runtime_error,"Error, invalid buffer size");
   header_offset_ = (buffer_size - cine_header_->bitmap_header_.biSizeImage) / sizeof(uint8_t);
@@ -111,6 +165,78 @@ Cine_Reader::Cine_Reader(const std::string & file_name,
   }
   //if(filter_failed_pixels_) // use this filter to do a binning filter (turned off for now)
   //  initialize_cine_filter(0); // set up the filtering based on the 0th frame intensities
+
+#if !defined(WIN32)
+  // map the whole file once so that frames can be unpacked straight from the page cache
+  // if the mapping fails (e.g. not enough address space) the frames are read with file streams instead
+  if(use_memory_map){
+    const int fd = open(file_name.c_str(),O_RDONLY);
+    if(fd>=0){
+      struct stat file_stat;
+      if(fstat(fd,&file_stat)==0&&file_stat.st_size>0){
+        void * addr = mmap(NULL,file_stat.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+        if(addr!=MAP_FAILED){
+          mapped_file_ = static_cast<uint8_t*>(addr);
+          mapped_size_ = file_stat.st_size;
+        }
+      }
+      close(fd); // the mapping stays valid after the descriptor is closed
+    }
+    if(mapped_file_==NULL&&out_stream_)
+      *out_stream_ << "*** Warning, unable to memory map .cine file: " << file_name << ", falling back to file streams" << std::endl;
+  }
+#else
+  (void)use_memory_map;
+#endif
+}
+
+Cine_Reader::~Cine_Reader(){
+#if !defined(WIN32)
+  if(mapped_file_!=NULL)
+    munmap(mapped_file_,mapped_size_);
+#endif
+}
+
+const uint8_t *
+Cine_Reader::frame_data(const int_t frame_index)const{
+  if(mapped_file_==NULL) return NULL;
+  TEUCHOS_TEST_FOR_EXCEPTION(frame_index<0||frame_index>=num_frames(),std::runtime_error,
+    "Error, invalid frame index " << frame_index);
+  const int64_t begin = cine_header_->image_offset(frame_index) + header_offset_;
+  TEUCHOS_TEST_FOR_EXCEPTION(begin<0||begin+(int64_t)cine_header_->bitmap_header_.biSizeImage>mapped_size_,std::runtime_error,
+    "Error, frame " << frame_index << " extends past the end of the file");
+  return mapped_file_ + begin;
+}
+
+namespace {
+/// buffer the frame blocks are read into when the file is not memory mapped, one per thread
+/// that keeps its capacity so the frames after the first one don't allocate
+/// (the cine reader is built into the utils library, so the frame arena in the core library can't be used)
+std::vector<uint8_t> &
+cine_read_buffer(){
+  static thread_local std::vector<uint8_t> buffer;
+  return buffer;
+}
+}
+
+const uint8_t *
+Cine_Reader::frame_block(const int_t frame_index,
+  const int64_t byte_offset,
+  const int64_t num_bytes,
+  std::vector<uint8_t> & buffer){
+  TEUCHOS_TEST_FOR_EXCEPTION(frame_index<0||frame_index>=num_frames(),std::runtime_error,
+    "Error, invalid frame index " << frame_index);
+  TEUCHOS_TEST_FOR_EXCEPTION(byte_offset<0||num_bytes<=0||byte_offset+num_bytes>(int64_t)cine_header_->bitmap_header_.biSizeImage,
+    std::runtime_error,"Error, requested block is outside the frame");
+  if(mapped_file_!=NULL)
+    return frame_data(frame_index) + byte_offset;
+  buffer.resize(num_bytes);
+  std::ifstream cine_file(cine_header_->file_name_.c_str(), std::ios::in | std::ios::binary);
+  TEUCHOS_TEST_FOR_EXCEPTION(cine_file.fail(),std::runtime_error,"Error, can't open the file: " << cine_header_->file_name_);
+  cine_file.seekg(cine_header_->image_offset(frame_index) + header_offset_ + byte_offset);
+  cine_file.read(reinterpret_cast<char*>(&buffer[0]),num_bytes);
+  cine_file.close();
+  return &buffer[0];
 }
 
 void
@@ -151,17 +277,68 @@ Cine_Reader::get_average_frame(const int_t frame_start,
     intensity_t * intensities,
     const bool is_layout_right,
     const bool filter_failed_pixels,
-    const bool convert_to_8_bit){
+    const bool convert_to_8_bit,
+    const int_t num_threads){
 
-  for(int_t i=0;i<width*height;++i)
+  const int_t num_pixels = width*height;
+  for(int_t i=0;i<num_pixels;++i)
     intensities[i] = 0.0;
-
   const int_t num_frames = frame_end - frame_start + 1;
-  for(int_t frame=frame_start;frame<=frame_end;++frame){
-    Teuchos::ArrayRCP<intensity_t> temp_intens(width*height,0.0);
-    get_frame(offset_x,offset_y,width,height,temp_intens.getRawPtr(),is_layout_right,frame,filter_failed_pixels,convert_to_8_bit);
-    for(int_t i=0;i<temp_intens.size();++i)
-      intensities[i] += num_frames==0.0?0.0:temp_intens[i]/num_frames;
+  if(num_frames<=0) return;
+
+  // set up the filter and conversion factor once so the frames can be decoded concurrently
+  if(filter_failed_pixels&!filter_failed_pixels_){
+    initialize_cine_filter(0);
+    filter_failed_pixels_ = true;
+  }
+  intensity_t conversion_factor_temp =  conversion_factor_;
+  if(!convert_to_8_bit) conversion_factor_ = 1.0;
+
+  // each thread sums a contiguous chunk of frames into its own accumulator, the accumulators are
+  // added up in thread order afterwards so the result does not depend on the thread timing
+  const int_t num_accumulators = std::max(1,std::min(num_threads,num_frames));
+  std::vector<std::vector<intensity_t> > accumulators(num_accumulators);
+  std::exception_ptr decode_error;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_accumulators) if(num_accumulators>1)
+#endif
+  {
+#ifdef _OPENMP
+    const int_t thread_id = omp_get_thread_num();
+    const int_t thread_count = omp_get_num_threads();
+#else
+    const int_t thread_id = 0;
+    const int_t thread_count = 1;
+#endif
+    const int_t chunk_begin = frame_start + (int_t)(((int64_t)num_frames*thread_id)/thread_count);
+    const int_t chunk_end = frame_start + (int_t)(((int64_t)num_frames*(thread_id+1))/thread_count);
+    try{
+      std::vector<intensity_t> & sum = accumulators[thread_id];
+      sum.assign(num_pixels,0.0);
+      std::vector<intensity_t> frame_intens(num_pixels,0.0);
+      for(int_t frame=chunk_begin;frame<chunk_end;++frame){
+        decode_frame(offset_x,offset_y,width,height,&frame_intens[0],is_layout_right,frame,filter_failed_pixels);
+        for(int_t i=0;i<num_pixels;++i)
+          sum[i] += frame_intens[i]/num_frames;
+      }
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_cine_average_error)
+#endif
+      {
+        if(!decode_error) decode_error = std::current_exception();
+      }
+    }
+  }
+  // replace the conversion factor if it was deactivated
+  conversion_factor_ = conversion_factor_temp;
+  if(decode_error) std::rethrow_exception(decode_error);
+  for(size_t t=0;t<accumulators.size();++t){
+    const std::vector<intensity_t> & sum = accumulators[t];
+    if(sum.empty()) continue;
+    for(int_t i=0;i<num_pixels;++i)
+      intensities[i] += sum[i];
   }
 }
 
@@ -181,7 +358,20 @@ Cine_Reader::get_frame(const int_t offset_x,
   }
   intensity_t conversion_factor_temp =  conversion_factor_;
   if(!convert_to_8_bit) conversion_factor_ = 1.0;
+  decode_frame(offset_x,offset_y,width,height,intensities,is_layout_right,frame_index,filter_failed_pixels);
+  // replace the conversion factor if it was deactivated
+  conversion_factor_ = conversion_factor_temp;
+}
 
+void
+Cine_Reader::decode_frame(const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const int_t frame_index,
+  const bool filter_failed_pixels){
   if(cine_header_->bit_depth_==BIT_DEPTH_8){
     get_frame_8_bit(offset_x,offset_y,width,height,intensities,is_layout_right,frame_index,filter_failed_pixels);
   }
@@ -198,8 +388,6 @@ Cine_Reader::get_frame(const int_t offset_x,
     std::cerr << "Error, invalid bit depth" << std::endl;
     throw std::exception();
   }
-  // replace the conversion factor if it was deactivated
-  conversion_factor_ = conversion_factor_temp;
 }
 
 void
@@ -220,25 +408,13 @@ Cine_Reader::get_frame_8_bit(const int_t offset_x,
   const int_t h = cine_header_->bitmap_header_.biHeight;
   const int_t end_x = offset_x + width - 1;
   const int_t end_y = offset_y + height - 1;
-  const int_t sub_buffer_size = (height+1) * w; // + 1 to oversize the buffer
-  char * sub_buffer = new char[sub_buffer_size];
+  const int_t sub_buffer_size = height * w;
   DEBUG_MSG("Cine_Reader::get_frame_8_bit(): buffer_size: " << sub_buffer_size);
   DEBUG_MSG("Cine_Reader::get_frame_8_bit(): start_x " << offset_x << " end_x " << end_x << " start_y " << offset_y << " end_y " << end_y);
-  uint8_t * sub_buff_ptr_8 = reinterpret_cast<uint8_t*>(sub_buffer);
-  // open the file
-  std::ifstream cine_file(cine_header_->file_name_.c_str(), std::ios::in | std::ios::binary);
-  if (cine_file.fail()){
-    std::cerr << "Error, can't open the file: " << cine_header_->file_name_ << std::endl;
-    throw std::exception();
-  }
-  // position to the first frame in this set:
-  const int64_t begin_frame = cine_header_->image_offsets_[frame_index] + header_offset_ + ((h-end_y-1) * w);
-  DEBUG_MSG("Cine_Reader::get_frame_8_bit(): image offset: " << cine_header_->image_offsets_[frame_index]);
   DEBUG_MSG("Cine_Reader::get_frame_8_bit(): y offset: " << (h-end_y-1)*w);
-  DEBUG_MSG("Cine_Reader::get_frame_8_bit(): begin frame: " << begin_frame);
-  cine_file.seekg(begin_frame);
-  // read the buffer
-  cine_file.read(sub_buffer,sub_buffer_size);
+  // rows of the region of interest (read in place if the file is memory mapped)
+  std::vector<uint8_t> & sub_buffer = cine_read_buffer();
+  const uint8_t * sub_buff_ptr_8 = frame_block(frame_index,(int64_t)(h-end_y-1)*w,sub_buffer_size,sub_buffer);
   int_t failed_pixels=0;
   for(int_t y=0;y<height;++y){
     for(int_t x=offset_x;x<=end_x;++x){
@@ -251,8 +427,6 @@ Cine_Reader::get_frame_8_bit(const int_t offset_x,
         intensities[(height-y-1)*width + x-offset_x] = sub_buff_ptr_8[y*w+x]*conversion_factor_;
     }
   }
-  delete [] sub_buff_ptr_8;
-  cine_file.close();
 #ifdef DICE_DEBUG_MSG
   if(failed_pixels>0){
     *out_stream_ << "*** Warning, this frame of .cine file: " << cine_header_->file_name_ << std::endl <<
@@ -280,22 +454,13 @@ Cine_Reader::get_frame_16_bit(const int_t offset_x,
   const int_t h = cine_header_->bitmap_header_.biHeight;
   const int_t end_x = offset_x + width - 1;
   const int_t end_y = offset_y + height - 1;
-  const int_t sub_buffer_size = (height+1)*w*2; // + 1 to oversize the buffer
-  char * sub_buffer = new char[sub_buffer_size];
+  const int_t sub_buffer_size = height*w*2; // times 2 because 2 bytes per 16bit pixel
   DEBUG_MSG("Cine_Reader::get_frame_16_bit(): buffer_size: " << sub_buffer_size);
   DEBUG_MSG("Cine_Reader::get_frame_16_bit(): start_x " << offset_x << " end_x " << end_x << " start_y " << offset_y << " end_y " << end_y);
-  uint16_t * sub_buff_ptr_16 = reinterpret_cast<uint16_t*>(sub_buffer);
-  // open the file
-  std::ifstream cine_file(cine_header_->file_name_.c_str(), std::ios::in | std::ios::binary);
-  if (cine_file.fail()){
-    std::cerr << "Error, can't open the file: " << cine_header_->file_name_ << std::endl;
-    throw std::exception();
-  }
-  // position to the first frame in this set:
-  const int64_t begin_frame = cine_header_->image_offsets_[frame_index] + header_offset_ + ((h-end_y-1) * w * 2); // times 2 because 2 bytes per 16bit pixel
-  cine_file.seekg(begin_frame);
-  // read the buffer
-  cine_file.read(sub_buffer,sub_buffer_size);
+  // rows of the region of interest (read in place if the file is memory mapped)
+  std::vector<uint8_t> & sub_buffer = cine_read_buffer();
+  const uint16_t * sub_buff_ptr_16 = reinterpret_cast<const uint16_t*>(
+      frame_block(frame_index,(int64_t)(h-end_y-1)*w*2,sub_buffer_size,sub_buffer));
   // the images are stored bottom up, not top down!
   uint16_t pixel_intensity;
   uint16_t max_intens = 0;
@@ -323,16 +488,22 @@ Cine_Reader::get_frame_16_bit(const int_t offset_x,
   // check to make sure the image is not 12bit stored as 16bit image:
   // if so, scale the numbers as if 12bit
   if(max_intens < 4096){
-    if(out_stream_ && !bit_12_warning_){
-      *out_stream_ << "*** Warning, .cine file: " << cine_header_->file_name_  << std::endl <<
-          "             was detected to be 12bit depth, but stored and denoted in the header as 16bit." << std::endl <<
-          "             The actual intensity value range is 0 to 4095, not 0 to 65535 as denoted in the header." << std::endl;
-      bit_12_warning_ = true;
+    // frames can be decoded from several threads in get_average_frame()
+#ifdef _OPENMP
+#pragma omp critical(dice_cine_12_bit_warning)
+#endif
+    {
+      if(out_stream_ && !bit_12_warning_){
+        *out_stream_ << "*** Warning, .cine file: " << cine_header_->file_name_  << std::endl <<
+            "             was detected to be 12bit depth, but stored and denoted in the header as 16bit." << std::endl <<
+            "             The actual intensity value range is 0 to 4095, not 0 to 65535 as denoted in the header." << std::endl;
+        bit_12_warning_ = true;
+      }
     }
     if(conversion_factor_!=1.0){
       for(int_t y=0;y<height;++y){
         for(int_t x=0;x<width;++x){
-          intensities[y*w + x] *= (65535.0/4095.0);
+          intensities[y*width + x] *= (65535.0/4095.0);
         }
       }
     }
@@ -364,49 +535,25 @@ Cine_Reader::get_frame_10_bit(const int_t offset_x,
   assert(offset_y>=0&&offset_y<cine_header_->bitmap_header_.biHeight);
   /// buffer for sub_image reading
   assert(w%8==0);
-  const int_t sub_buffer_size = (height+1) * w * 10 / 8;
-  char * sub_buffer = new char[sub_buffer_size]; // + 1 to oversize the buffer
+  const int_t sub_buffer_size = height * w * 10 / 8;
   DEBUG_MSG("Cine_Reader::get_frame_10_bit(): buffer_size: " << sub_buffer_size);
   DEBUG_MSG("Cine_Reader::get_frame_10_bit(): start_x " << offset_x << " end_x " << end_x << " start_y " << offset_y << " end_y " << offset_y + height -1);
-  uint8_t * sub_buff_ptr_8 = reinterpret_cast<uint8_t*>(sub_buffer);
-  // open the file
-  std::ifstream cine_file(cine_header_->file_name_.c_str(), std::ios::in | std::ios::binary);
-  if (cine_file.fail()){
-    std::cerr << "Error, can't open the file: " << cine_header_->file_name_ << std::endl;
-    throw std::exception();
-  }
-  // position to the first frame in this set:
-  const int64_t begin_frame = cine_header_->image_offsets_[frame_index] + header_offset_ + (offset_y * w * 10 / 8);
-  cine_file.seekg(begin_frame);
-  // read the buffer
-  cine_file.read(sub_buffer,sub_buffer_size);
-  // unpack the 10 bit image data from the array
-  uint16_t intensity_16 = 0.0;
-  uint16_t intensity_16p1 = 0.0;
-  uint16_t two_byte = 0;
+  // rows of the region of interest (read in place if the file is memory mapped)
+  std::vector<uint8_t> & sub_buffer = cine_read_buffer();
+  const uint8_t * sub_buff_ptr_8 = frame_block(frame_index,(int64_t)offset_y*w*10/8,sub_buffer_size,sub_buffer);
+  // fold the 12 bit expansion and the conversion factor into one table
+  intensity_t intensity_lut[1024];
+  for(int_t i=0;i<1024;++i)
+    intensity_lut[i] = LinLUT[i] * conversion_factor_;
+  // unpack the 10 bit image data from the array one row at a time
+  const int_t row_bytes = w * 10 / 8;
+  std::vector<uint16_t> row_values(width);
   for(int_t y=0;y<height;++y){
-    for(int_t x=offset_x;x<=end_x;++x){
-      const int_t slot = (y*w+x)*10/8;
-      const int_t chunk_offset = (y*w+x)%4; // 5 bytes per four pixels
-      // create the single 16 bit combo
-      intensity_16p1 = sub_buff_ptr_8[slot + 1];
-      intensity_16p1 <<= 8; // move the bits over to the beginning of the byte
-      intensity_16 = sub_buff_ptr_8[slot];
-      two_byte = intensity_16 | intensity_16p1;
-      endian_swap(two_byte);
-      // shift the 10 bits to the right side of the 16 bit data type;
-      two_byte = two_byte >> (6 - (chunk_offset*2));
-      // use a mask to zero out the left 6 bits
-      two_byte = two_byte & 0x3FF; // 16 bits with only the right 10 active;
-      // this next step is required because the original signal was companded from 12 bits to 10,
-      // now we are expanding it back to 12:
-      two_byte = LinLUT[two_byte];
-      // save off the pixel
-      intensities[y*width+(x-offset_x)] = two_byte * conversion_factor_;
-    }
+    unpack_10_bit_row(sub_buff_ptr_8 + y*row_bytes,offset_x,end_x+1,&row_values[0]);
+    intensity_t * intens_row = intensities + y*width;
+    for(int_t x=0;x<width;++x)
+      intens_row[x] = intensity_lut[row_values[x]];
   }
-  cine_file.close();
-  delete[] sub_buffer;
 }
 
 void
@@ -430,56 +577,36 @@ Cine_Reader::get_frame_10_bit_filtered(const int_t offset_x,
   assert(offset_y>=0&&offset_y<cine_header_->bitmap_header_.biHeight);
   /// buffer for sub_image reading
   assert(w%8==0);
-  const int_t sub_buffer_size = (height+1) * w * 10 / 8;
-  char * sub_buffer = new char[sub_buffer_size]; // + 1 to oversize the buffer
+  const int_t sub_buffer_size = height * w * 10 / 8;
   DEBUG_MSG("Cine_Reader::get_frame_10_bit_filtered(): buffer_size: " << sub_buffer_size);
   DEBUG_MSG("Cine_Reader::get_frame_10_bit_filtered(): start_x " << offset_x << " end_x " << end_x << " start_y " << offset_y << " end_y " << offset_y + height - 1);
-  uint8_t * sub_buff_ptr_8 = reinterpret_cast<uint8_t*>(sub_buffer);
-  // open the file
-  std::ifstream cine_file(cine_header_->file_name_.c_str(), std::ios::in | std::ios::binary);
-  if (cine_file.fail()){
-    std::cerr << "Error, can't open the file: " << cine_header_->file_name_ << std::endl;
-    throw std::exception();
+  // rows of the region of interest (read in place if the file is memory mapped)
+  std::vector<uint8_t> & sub_buffer = cine_read_buffer();
+  const uint8_t * sub_buff_ptr_8 = frame_block(frame_index,(int64_t)offset_y*w*10/8,sub_buffer_size,sub_buffer);
+  // fold the 12 bit expansion, the conversion factor and the failed pixel test into tables
+  intensity_t intensity_lut[1024];
+  bool failed_lut[1024];
+  for(int_t i=0;i<1024;++i){
+    intensity_lut[i] = LinLUT[i] * conversion_factor_;
+    failed_lut[i] = LinLUT[i] >= filter_value_;
   }
-  // position to the first frame in this set:
-  const int64_t begin_frame = cine_header_->image_offsets_[frame_index] + header_offset_ + (offset_y * w * 10 / 8);
-  cine_file.seekg(begin_frame);
-  // read the buffer
-  cine_file.read(sub_buffer,sub_buffer_size);
-  // unpack the 10 bit image data from the array
-  uint16_t intensity_16 = 0.0;
-  uint16_t intensity_16p1 = 0.0;
-  uint16_t two_byte = 0;
+  // unpack the 10 bit image data from the array one row at a time
+  const int_t row_bytes = w * 10 / 8;
+  std::vector<uint16_t> row_values(width);
   int_t failed_pixels=0;
   for(int_t y=0;y<height;++y){
-    for(int_t x=offset_x;x<=end_x;++x){
-      const int_t slot = (y*w+x)*10/8;
-      const int_t chunk_offset = (y*w+x)%4; // 5 bytes per four pixels
-      // create the single 16 bit combo
-      intensity_16p1 = sub_buff_ptr_8[slot + 1];
-      intensity_16p1 <<= 8; // move the bits over to the beginning of the byte
-      intensity_16 = sub_buff_ptr_8[slot];
-      two_byte = intensity_16 | intensity_16p1;
-      endian_swap(two_byte);
-      // shift the 10 bits to the right side of the 16 bit data type;
-      two_byte = two_byte >> (6 - (chunk_offset*2));
-      // use a mask to zero out the left 6 bits
-      two_byte = two_byte & 0x3FF; // 16 bits with only the right 10 active;
-      // this next step is required because the original signal was companded from 12 bits to 10,
-      // now we are expanding it back to 12:
-      two_byte = LinLUT[two_byte];
-      // save off the pixel
-      intensities[y*width+(x-offset_x)] = two_byte * conversion_factor_;
-      if(two_byte >= filter_value_ && !(x == offset_x && y == 0)){
+    unpack_10_bit_row(sub_buff_ptr_8 + y*row_bytes,offset_x,end_x+1,&row_values[0]);
+    intensity_t * intens_row = intensities + y*width;
+    for(int_t x=0;x<width;++x){
+      // failed pixels take the value of the previous pixel (the first pixel is never replaced)
+      if(failed_lut[row_values[x]] && !(x == 0 && y == 0)){
         failed_pixels++;
-        intensities[y*width+(x-offset_x)] = intensities[y*width+(x-offset_x)-1];
+        intens_row[x] = intens_row[x-1];
       }
       else
-        intensities[y*width+(x-offset_x)] = two_byte * conversion_factor_;
+        intens_row[x] = intensity_lut[row_values[x]];
     }
   }
-  cine_file.close();
-  delete[] sub_buffer;
 #ifdef DICE_DEBUG_MSG
   if(failed_pixels>0){
     *out_stream_ << "*** Warning, this frame of .cine file: " << cine_header_->file_name_ << std::endl <<
@@ -490,6 +617,38 @@ Cine_Reader::get_frame_10_bit_filtered(const int_t offset_x,
 #endif
 }
 
+int64_t
+Cine_Header::image_offset(const int64_t frame_index){
+  TEUCHOS_TEST_FOR_EXCEPTION(frame_index<0||frame_index>=(int64_t)header_.ImageCount,std::runtime_error,
+    "Error, invalid frame index " << frame_index << " for .cine file: " << file_name_);
+  const int64_t chunk = frame_index / offset_chunk_size();
+  std::lock_guard<std::mutex> lock(offset_mutex_);
+  std::vector<int64_t> & offsets = offset_chunks_[chunk];
+  if(offsets.empty()){
+    // read the chunk of the offset table in one call
+    const int64_t first = chunk*offset_chunk_size();
+    const int64_t num_offsets = std::min(offset_chunk_size(),(int64_t)header_.ImageCount - first);
+    std::ifstream cine_file(file_name_.c_str(), std::ios::in | std::ios::binary);
+    TEUCHOS_TEST_FOR_EXCEPTION(cine_file.fail(),std::runtime_error,"Error, can't open the file: " << file_name_);
+    cine_file.seekg((int64_t)header_.OffImageOffsets + first*(int64_t)sizeof(int64_t));
+    std::vector<int64_t> chunk_offsets(num_offsets);
+    cine_file.read(reinterpret_cast<char*>(&chunk_offsets[0]),num_offsets*sizeof(int64_t));
+    TEUCHOS_TEST_FOR_EXCEPTION(cine_file.gcount()!=(std::streamsize)(num_offsets*sizeof(int64_t)),std::runtime_error,
+      "Error, the image offset table of .cine file: " << file_name_ << " is truncated");
+    offsets.swap(chunk_offsets);
+  }
+  return offsets[frame_index - chunk*offset_chunk_size()];
+}
+
+/// copy a field out of a header buffer and advance the position in the buffer
+template <typename T>
+void unpack_header_field(const std::vector<char> & buffer,
+  size_t & pos,
+  T & value){
+  std::memcpy(&value,&buffer[pos],sizeof(T));
+  pos += sizeof(T);
+}
+
 Teuchos::RCP<Cine_Header>
 read_cine_headers(const char *file, std::ostream * out_stream){
 
@@ -504,11 +663,6 @@ read_cine_headers(const char *file, std::ostream * out_stream){
   // CINE HEADER
   if(out_stream) *out_stream << "\n** reading the cine header info:\n" << std::endl;
   cine_file_header header;
-  cine_file.read(reinterpret_cast<char*>(&header.Type), sizeof(header.Type));
-  if(out_stream) *out_stream << "file size:            " << file_size << std::endl;
-  if(out_stream) *out_stream << "header type:          " << header.Type << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.Headersize), sizeof(header.Headersize));
-  if(out_stream) *out_stream << "header size:          " << header.Headersize << std::endl;
   int test_size = 0;
   test_size += sizeof(header.Type);
   test_size += sizeof(header.Headersize);
@@ -522,41 +676,47 @@ read_cine_headers(const char *file, std::ostream * out_stream){
   test_size += sizeof(header.OffSetup);
   test_size += sizeof(header.OffImageOffsets);
   test_size += sizeof(header.TriggerTime);
+  // the header is read in one call and the fields are copied out of the buffer (the struct may be padded)
+  std::vector<char> buffer(test_size);
+  cine_file.read(&buffer[0],test_size);
+  TEUCHOS_TEST_FOR_EXCEPTION(cine_file.gcount()!=test_size,std::runtime_error,"Error, the .cine file header is truncated: " << file);
+  size_t pos = 0;
+  unpack_header_field(buffer,pos,header.Type);
+  unpack_header_field(buffer,pos,header.Headersize);
+  unpack_header_field(buffer,pos,header.Compression);
+  unpack_header_field(buffer,pos,header.Version);
+  unpack_header_field(buffer,pos,header.FirstMovieImage);
+  unpack_header_field(buffer,pos,header.TotalImageCount);
+  unpack_header_field(buffer,pos,header.FirstImageNo);
+  unpack_header_field(buffer,pos,header.ImageCount);
+  unpack_header_field(buffer,pos,header.OffImageHeader);
+  unpack_header_field(buffer,pos,header.OffSetup);
+  unpack_header_field(buffer,pos,header.OffImageOffsets);
+  unpack_header_field(buffer,pos,header.TriggerTime);
+  if(out_stream) *out_stream << "file size:            " << file_size << std::endl;
+  if(out_stream) *out_stream << "header type:          " << header.Type << std::endl;
+  if(out_stream) *out_stream << "header size:          " << header.Headersize << std::endl;
   if(out_stream) *out_stream << "test size:            " << test_size << std::endl;
   TEUCHOS_TEST_FOR_EXCEPTION(test_size!=header.Headersize,std::runtime_error,"");
-  cine_file.read(reinterpret_cast<char*>(&header.Compression), sizeof(header.Compression));
   if(out_stream) *out_stream << "header compression:   " << header.Compression << std::endl;
   TEUCHOS_TEST_FOR_EXCEPTION(header.Compression!=0,std::runtime_error,
     "Error: compressed or color .cine files are not supported.");
-  cine_file.read(reinterpret_cast<char*>(&header.Version), sizeof(header.Version));
   if(out_stream) *out_stream << "header version:       " << header.Version << std::endl;
   TEUCHOS_TEST_FOR_EXCEPTION(header.Version!=1,std::runtime_error,
     "Error: only version 1 .cine files are not supported.");
-  cine_file.read(reinterpret_cast<char*>(&header.FirstMovieImage), sizeof(header.FirstMovieImage));
   if(out_stream) *out_stream << "header first mov img: " << header.FirstMovieImage << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.TotalImageCount), sizeof(header.TotalImageCount));
   if(out_stream) *out_stream << "total image count:    " << header.TotalImageCount << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.FirstImageNo), sizeof(header.FirstImageNo));
   if(out_stream) *out_stream << "first image no:       " << header.FirstImageNo << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.ImageCount), sizeof(header.ImageCount));
   if(out_stream) *out_stream << "header image count:   " << header.ImageCount << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.OffImageHeader), sizeof(header.OffImageHeader));
   TEUCHOS_TEST_FOR_EXCEPTION((int)header.OffImageHeader!=test_size,std::runtime_error,"");
   if(out_stream) *out_stream << "offset image header:  " << header.OffImageHeader << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.OffSetup), sizeof(header.OffSetup));
   if(out_stream) *out_stream << "offset setup:         " << header.OffSetup << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.OffImageOffsets), sizeof(header.OffImageOffsets));
   if(out_stream) *out_stream << "offset image offsets: " << header.OffImageOffsets << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&header.TriggerTime), sizeof(header.TriggerTime));
   //if(out_stream) *out_stream << "trigger time:         " << header.TriggerTime << std::endl;
 
   // BITMAP HEADER
   if(out_stream) *out_stream << "\n** reading the cine bitmap header:\n" << std::endl;
   bitmap_info_header bitmap_header;
-  // seek the file posision of the image header:
-  cine_file.seekg(header.OffImageHeader);
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biSize), sizeof(bitmap_header.biSize));
-  if(out_stream) *out_stream << "bitmap header size:      " << bitmap_header.biSize << std::endl;
   int header_test_size = 0;
   header_test_size += sizeof(bitmap_header.biSize);
   header_test_size += sizeof(bitmap_header.biWidth);
@@ -569,56 +729,57 @@ read_cine_headers(const char *file, std::ostream * out_stream){
   header_test_size += sizeof(bitmap_header.biYPelsPerMeter);
   header_test_size += sizeof(bitmap_header.biClrUsed);
   header_test_size += sizeof(bitmap_header.biClrImportant);
+  // seek the file posision of the image header:
+  cine_file.seekg(header.OffImageHeader);
+  buffer.resize(header_test_size);
+  cine_file.read(&buffer[0],header_test_size);
+  TEUCHOS_TEST_FOR_EXCEPTION(cine_file.gcount()!=header_test_size,std::runtime_error,"Error, the .cine bitmap header is truncated: " << file);
+  pos = 0;
+  unpack_header_field(buffer,pos,bitmap_header.biSize);
+  unpack_header_field(buffer,pos,bitmap_header.biWidth);
+  unpack_header_field(buffer,pos,bitmap_header.biHeight);
+  unpack_header_field(buffer,pos,bitmap_header.biPlanes);
+  unpack_header_field(buffer,pos,bitmap_header.biBitCount);
+  unpack_header_field(buffer,pos,bitmap_header.biCompression);
+  unpack_header_field(buffer,pos,bitmap_header.biSizeImage);
+  unpack_header_field(buffer,pos,bitmap_header.biXPelsPerMeter);
+  unpack_header_field(buffer,pos,bitmap_header.biYPelsPerMeter);
+  unpack_header_field(buffer,pos,bitmap_header.biClrUsed);
+  unpack_header_field(buffer,pos,bitmap_header.biClrImportant);
+  if(out_stream) *out_stream << "bitmap header size:      " << bitmap_header.biSize << std::endl;
   //if(out_stream) *out_stream << "test header size:     " << header_test_size << std::endl;
   TEUCHOS_TEST_FOR_EXCEPTION(header_test_size!=(int)bitmap_header.biSize,std::runtime_error,"");
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biWidth), sizeof(bitmap_header.biWidth));
   if(out_stream) *out_stream << "bitmap width:            " << bitmap_header.biWidth << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biHeight), sizeof(bitmap_header.biHeight));
   if(out_stream) *out_stream << "bitmap height:           " << bitmap_header.biHeight << std::endl;
   if(bitmap_header.biHeight < 0){
     std::cout <<"** Warning: the cine file has recorded the pixel array upside down" << std::endl;
     bitmap_header.biHeight *= -1;
   }
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biPlanes), sizeof(bitmap_header.biPlanes));
   if(out_stream) *out_stream << "bitmap num planes:       " << bitmap_header.biPlanes << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biBitCount), sizeof(bitmap_header.biBitCount));
   if(out_stream) *out_stream << "bitmap bit count:        " << bitmap_header.biBitCount << std::endl;
   TEUCHOS_TEST_FOR_EXCEPTION((bitmap_header.biBitCount!=8&&bitmap_header.biBitCount!=16),
     std::runtime_error,"Error: only 8 or 16 bits per pixel are supported");
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biCompression), sizeof(bitmap_header.biCompression));
   if(out_stream) *out_stream << "bitmap compression:      " << bitmap_header.biCompression << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biSizeImage), sizeof(bitmap_header.biSizeImage));
   if(out_stream) *out_stream << "bitmap image size:       " << bitmap_header.biSizeImage << std::endl;
-  TEUCHOS_TEST_FOR_EXCEPTION(bitmap_header.biSizeImage*header.ImageCount > file_size, std::runtime_error,
+  TEUCHOS_TEST_FOR_EXCEPTION((long long int)bitmap_header.biSizeImage*header.ImageCount > file_size, std::runtime_error,
     "Error: file size is smaller than the number of reported frames would require.");
   if(out_stream) *out_stream << "bitmap actual bit count: " << (bitmap_header.biSizeImage * 8) / (bitmap_header.biWidth * bitmap_header.biHeight) << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biXPelsPerMeter), sizeof(bitmap_header.biXPelsPerMeter));
   if(out_stream) *out_stream << "bitmap x pels/meter:     " << bitmap_header.biXPelsPerMeter << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biYPelsPerMeter), sizeof(bitmap_header.biYPelsPerMeter));
   if(out_stream) *out_stream << "bitmap y pels/meter:     " << bitmap_header.biYPelsPerMeter << std::endl;
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biClrUsed), sizeof(bitmap_header.biClrUsed));
   if(out_stream) *out_stream << "bitmap colors used:      " << bitmap_header.biClrUsed << std::endl;
   TEUCHOS_TEST_FOR_EXCEPTION(bitmap_header.biClrUsed!=0,std::runtime_error,
     "Error: cine color files have not been implemented.");
-  cine_file.read(reinterpret_cast<char*>(&bitmap_header.biClrImportant), sizeof(bitmap_header.biClrImportant));
   if(out_stream) *out_stream << "important colors:        " << bitmap_header.biClrImportant << std::endl;
+  // make sure the offset table fits in the file (it is read in chunks as the frames are requested)
+  TEUCHOS_TEST_FOR_EXCEPTION((long long int)header.OffImageOffsets + (long long int)header.ImageCount*(long long int)sizeof(int64_t) > file_size,
+    std::runtime_error,"Error: the image offset table extends past the end of the file.");
+  // close the file:
+  cine_file.close();
 
   // create the return type
   std::stringstream fileName;
   fileName << file;
-  Teuchos::RCP<Cine_Header> cine_header = Teuchos::rcp(new Cine_Header(fileName.str(),header, bitmap_header));
-
-  // read the image offsets:
-  cine_file.seekg(header.OffImageOffsets);
-  for (size_t i=0;i<header.ImageCount;++i){
-    int64_t offset;
-    cine_file.read(reinterpret_cast<char*>(&offset), sizeof(offset));
-    cine_header->image_offsets_[i] = offset;
-  }
-  // close the file:
-  cine_file.close();
-
-  return cine_header;
+  return Teuchos::rcp(new Cine_Header(fileName.str(),header, bitmap_header));
 };
 
 } // end cine namespace
@@ -46,6 +46,8 @@
 
 #include <cassert>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 #if defined(WIN32)
   #include <cstdint>
@@ -145,7 +147,9 @@ struct bitmap_info_header{
 /// \class DICe::cine::Cine_Header
 /// \brief A class to hold header information for cine files.
 /// Always assumes that the cine file has been stored in LayoutRight or row-aligned
-/// in memory
+/// in memory. The image offset table is read from the file in chunks as frames are requested so that
+/// only the part of the table for the frames that are used is read (the header can be shared by readers
+/// on different threads)
 class DICE_LIB_DLL_EXPORT
 Cine_Header
 {
@@ -161,7 +165,7 @@ public:
   bitmap_header_(bitmap_header),
   file_name_(file_name),
   bit_depth_(NO_SUCH_BIT_DEPTH){
-    image_offsets_ = new int64_t[header_.ImageCount];
+    offset_chunks_.resize((header_.ImageCount + offset_chunk_size() - 1)/offset_chunk_size());
     // set the bit depth of the images
     int_t bit_depth = (bitmap_header_.biSizeImage * 8) / (bitmap_header_.biWidth * bitmap_header_.biHeight);
     if(bit_depth==8) bit_depth_=BIT_DEPTH_8;
@@ -172,19 +176,28 @@ public:
     }
   };
   /// default destructor
-  virtual ~Cine_Header(){
-    delete[] image_offsets_;
-  };
+  virtual ~Cine_Header(){};
+  /// \brief returns the offset in the file to the given image
+  /// (the chunk of the offset table that holds the image is read from the file the first time it is needed)
+  /// \param frame_index the index of the image counting from the first image in the file
+  int64_t image_offset(const int64_t frame_index);
+  /// the number of image offsets read from the file at a time
+  static int64_t offset_chunk_size(){
+    return 4096;
+  }
   /// cine file header
   cine_file_header header_;
   /// bitmap information
   bitmap_info_header bitmap_header_;
-  /// pointer to the array with the offsets to each image
-  int64_t * image_offsets_;
   /// the name of the cine file
   std::string file_name_;
   /// bit depth of the file
   Bit_Depth bit_depth_;
+private:
+  /// the chunks of the image offset table (a chunk is empty until it has been read)
+  std::vector<std::vector<int64_t> > offset_chunks_;
+  /// guards the offset table
+  std::mutex offset_mutex_;
 };
 /// function that reads the header information from the cine file
 Teuchos::RCP<Cine_Header>
@@ -202,11 +215,15 @@ public:
   /// \param file_name the name of the cine file
   /// \param out_stream (optional) output stream
   /// \param filter_failed_pixels true if failed pixels should be filtered out by taking the neighbor value
+  /// \param use_memory_map true if the file should be memory mapped (falls back to stream reads if mapping fails)
+  /// \param cine_header (optional) the already parsed header of the file (if null the header is read from the file)
   Cine_Reader(const std::string & file_name,
     std::ostream * out_stream = NULL,
-    const bool filter_failed_pixels=false);
+    const bool filter_failed_pixels=false,
+    const bool use_memory_map=true,
+    const Teuchos::RCP<Cine_Header> & cine_header=Teuchos::null);
   /// default destructor
-  virtual ~Cine_Reader(){};
+  virtual ~Cine_Reader();
 
   /// \brief generic frame fetch
   /// \param offset_x offset to first pixel in x
@@ -239,6 +256,7 @@ public:
   /// \param is_layout_right colum or row oriented storage flag (not used yet for cine)
   /// \param filter_failed_pixels get rid of outlier pixels or failed pixels
   /// \param convert_to_8_bit true if the values should be scaled to 8 bit range
+  /// \param num_threads the number of threads used to decode the frames (each thread sums a chunk of the frames)
   void get_average_frame(const int_t frame_start,
     const int_t frame_end,
     const int_t offset_x,
@@ -248,7 +266,8 @@ public:
     intensity_t * intensities,
     const bool is_layout_right,
     const bool filter_failed_pixels,
-    const bool convert_to_8_bit);
+    const bool convert_to_8_bit,
+    const int_t num_threads=1);
 
   /// \brief 8 bit frame fetch
   /// \param offset_x offset to first pixel in x
@@ -342,7 +361,49 @@ public:
   int_t first_image_number()const{
     return cine_header_->header_.FirstImageNo;
   }
+  /// returns the parsed header of the file
+  Teuchos::RCP<Cine_Header> header()const{
+    return cine_header_;
+  }
+  /// returns the bit depth of the stored pixels
+  Bit_Depth bit_depth()const{
+    return cine_header_->bit_depth_;
+  }
+  /// returns true if the frames are read directly from a memory mapped file
+  bool is_memory_mapped()const{
+    return mapped_file_!=NULL;
+  }
+  /// \brief returns a pointer to the raw pixel data of a frame in the mapped file (NULL if the file is not mapped)
+  /// The rows are stored bottom up with width()*bits/8 bytes per row, so a region of interest can be
+  /// read in place without copying the frame
+  /// \param frame_index the frame to view
+  const uint8_t * frame_data(const int_t frame_index)const;
 private:
+  /// not copyable since the reader owns the mapping
+  Cine_Reader(const Cine_Reader &);
+  /// not assignable since the reader owns the mapping
+  Cine_Reader & operator=(const Cine_Reader &);
+  /// \brief returns a pointer to a contiguous block of pixel data for the given frame
+  /// If the file is mapped the pointer is into the mapped pages, otherwise the block is read into the buffer
+  /// \param frame_index the frame to read from
+  /// \param byte_offset offset in bytes from the beginning of the frame's pixel data
+  /// \param num_bytes the size of the block
+  /// \param buffer storage used if the file is not memory mapped
+  const uint8_t * frame_block(const int_t frame_index,
+    const int64_t byte_offset,
+    const int64_t num_bytes,
+    std::vector<uint8_t> & buffer);
+  /// \brief decodes a frame with the bit depth specific fetch
+  /// The filter and conversion factor must already be set up (see get_frame()), nothing else
+  /// in the reader is modified so frames can be decoded from multiple threads at once
+  void decode_frame(const int_t offset_x,
+    const int_t offset_y,
+    const int_t width,
+    const int_t height,
+    intensity_t * intensities,
+    const bool is_layout_right,
+    const int_t frame_index,
+    const bool filter_failed_pixels);
   /// pointer to the cine file header information
   Teuchos::RCP<Cine_Header> cine_header_;
   /// pointer to the output stream
@@ -357,6 +418,10 @@ private:
   intensity_t filter_value_;
   /// conversion factor for converting to 8 bit depth
   intensity_t conversion_factor_;
+  /// pointer to the beginning of the memory mapped file (NULL if not mapped)
+  uint8_t * mapped_file_;
+  /// size of the memory mapped region in bytes
+  int64_t mapped_size_;
 };
 
 }// end cine namespace
@@ -48,13 +48,17 @@
 
 #include <Teuchos_oblackholestream.hpp>
 
+#include <algorithm>
+#include <queue>
+
 namespace DICe {
 
 Decomp::Decomp(const Teuchos::RCP<Teuchos::ParameterList> & input_params,
   const Teuchos::RCP<Teuchos::ParameterList> & correlation_params):
     num_global_subsets_(0),
     image_width_(-1),
-    image_height_(-1){
+    image_height_(-1),
+    subset_size_(-1){
   comm_ = Teuchos::rcp(new MultiField_Comm());
 
   std::vector<std::string> image_files;
@@ -75,22 +79,26 @@ Decomp::Decomp(const Teuchos::RCP<Teuchos::ParameterList> & input_params,
   TEUCHOS_TEST_FOR_EXCEPTION(comm_->get_rank()!=0&&subset_centroids_x.size()!=0,std::runtime_error,"");
   TEUCHOS_TEST_FOR_EXCEPTION(comm_->get_rank()!=0&&subset_centroids_y.size()!=0,std::runtime_error,"");
   TEUCHOS_TEST_FOR_EXCEPTION(num_global_subsets_<=0,std::runtime_error,"");
-  initialize(subset_centroids_x,subset_centroids_y,neighbor_ids,obstructing_subset_ids,correlation_params);
+  initialize(subset_centroids_x,subset_centroids_y,neighbor_ids,obstructing_subset_ids,correlation_params,Teuchos::null);
 }
 
 Decomp::Decomp(Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
   Teuchos::ArrayRCP<scalar_t> subset_centroids_y,
   Teuchos::RCP<std::vector<int_t> > neighbor_ids,
   Teuchos::RCP<std::map<int_t,std::vector<int_t> > > obstructing_subset_ids,
-  const Teuchos::RCP<Teuchos::ParameterList> & correlation_params):
+  const Teuchos::RCP<Teuchos::ParameterList> & correlation_params,
+  Teuchos::ArrayRCP<scalar_t> subset_weights):
     num_global_subsets_(0),
     image_width_(-1),
-    image_height_(-1){
+    image_height_(-1),
+    subset_size_(-1){
   TEUCHOS_TEST_FOR_EXCEPTION(subset_centroids_x.size()<=0,std::runtime_error,"");
   TEUCHOS_TEST_FOR_EXCEPTION(subset_centroids_x.size()!=subset_centroids_y.size(),std::runtime_error,"");
   comm_ = Teuchos::rcp(new MultiField_Comm());
+  TEUCHOS_TEST_FOR_EXCEPTION(subset_weights!=Teuchos::null&&subset_weights.size()!=subset_centroids_x.size(),std::runtime_error,
+    "Error, the number of subset weights does not match the number of subsets");
   num_global_subsets_ = subset_centroids_x.size();
-  initialize(subset_centroids_x,subset_centroids_y,neighbor_ids,obstructing_subset_ids,correlation_params);
+  initialize(subset_centroids_x,subset_centroids_y,neighbor_ids,obstructing_subset_ids,correlation_params,subset_weights);
 }
 
 void
@@ -98,7 +106,8 @@ Decomp::initialize(const Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
   const Teuchos::ArrayRCP<scalar_t> subset_centroids_y,
   Teuchos::RCP<std::vector<int_t> > & neighbor_ids,
   Teuchos::RCP<std::map<int_t,std::vector<int_t> > > obstructing_subset_ids,
-  const Teuchos::RCP<Teuchos::ParameterList> & correlation_params){
+  const Teuchos::RCP<Teuchos::ParameterList> & correlation_params,
+  const Teuchos::ArrayRCP<scalar_t> subset_weights){
 
   DEBUG_MSG("Decomp::initialize(): num global subsets: " << num_global_subsets_);
 
@@ -109,6 +118,9 @@ Decomp::initialize(const Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
   for(int_t i=0;i<id_decomp_map_->get_num_local_elements();++i)
     this_proc_gid_order_[i] = id_decomp_map_->get_global_element(i);
 
+  // if requested, give each processor a compact region of the image with a balanced amount of work
+  create_spatial_dist_map(subset_centroids_x,subset_centroids_y,subset_weights,correlation_params);
+
   // if there are blocking subsets, they need to be on the same processor and put in order:
   create_obstruction_dist_map(obstructing_subset_ids);
 
@@ -305,141 +317,151 @@ Decomp::initialize(const Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
 }
 
 void
-Decomp::create_obstruction_dist_map(Teuchos::RCP<std::map<int_t,std::vector<int_t> > > & obstructing_subset_ids){
-  if(obstructing_subset_ids==Teuchos::null) return;
-  if(obstructing_subset_ids->size()==0) return;
+Decomp::create_spatial_dist_map(const Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
+  const Teuchos::ArrayRCP<scalar_t> subset_centroids_y,
+  const Teuchos::ArrayRCP<scalar_t> subset_weights,
+  const Teuchos::RCP<Teuchos::ParameterList> & correlation_params){
 
+  if(correlation_params==Teuchos::null) return;
+  if(!correlation_params->get<bool>(DICe::use_spatial_decomposition,false)) return;
   const int_t proc_id = comm_->get_rank();
   const int_t num_procs = comm_->get_size();
+  if(num_procs==1) return;
 
-  if(proc_id == 0) DEBUG_MSG("Subsets have obstruction dependencies.");
-  // set up the groupings of subset ids that have to stay together:
-  // Note: this assumes that the obstructions are only one relation deep
-  // i.e. the blocking subset cannot itself have a subset that blocks it
-  // TODO address this to make it more general
-  std::set<int_t> eligible_ids;
-  for(int_t i=0;i<num_global_subsets_;++i)
-    eligible_ids.insert(i);
-  std::vector<std::set<int_t> > obstruction_groups;
-  std::map<int_t,int_t> earliest_id_can_appear;
-  std::set<int_t> assigned_to_a_group;
-  std::map<int_t,std::vector<int_t> >::iterator map_it = obstructing_subset_ids->begin();
-  for(;map_it!=obstructing_subset_ids->end();++map_it){
-    int_t greatest_subset_id_among_obst = 0;
-    for(size_t j=0;j<map_it->second.size();++j)
-      if(map_it->second[j] > greatest_subset_id_among_obst) greatest_subset_id_among_obst = map_it->second[j];
-    earliest_id_can_appear.insert(std::pair<int_t,int_t>(map_it->first,greatest_subset_id_among_obst));
-
-    if(assigned_to_a_group.find(map_it->first)!=assigned_to_a_group.end()) continue;
-    std::set<int_t> dependencies;
-    dependencies.insert(map_it->first);
-    eligible_ids.erase(map_it->first);
-    // gather for all the dependencies for this subset
-    for(size_t j=0;j<map_it->second.size();++j){
-      dependencies.insert(map_it->second[j]);
-      eligible_ids.erase(map_it->second[j]);
-    }
-    // no search all the other obstruction sets for any ids currently in the dependency list
-    std::set<int_t>::iterator dep_it = dependencies.begin();
-    for(;dep_it!=dependencies.end();++dep_it){
-      std::map<int_t,std::vector<int_t> >::iterator search_it = obstructing_subset_ids->begin();
-      for(;search_it!=obstructing_subset_ids->end();++search_it){
-        if(assigned_to_a_group.find(search_it->first)!=assigned_to_a_group.end()) continue;
-        // if any of the ids are in the current dependency list, add the whole set:
-        bool match_found = false;
-        if(*dep_it==search_it->first) match_found = true;
-        for(size_t k=0;k<search_it->second.size();++k){
-          if(*dep_it==search_it->second[k]) match_found = true;
-        }
-        if(match_found){
-          dependencies.insert(search_it->first);
-          eligible_ids.erase(search_it->first);
-          for(size_t k=0;k<search_it->second.size();++k){
-            dependencies.insert(search_it->second[k]);
-            eligible_ids.erase(search_it->second[k]);
+  // dummy field to communicate the extents to each processor
+  Teuchos::Array<int_t> zero_owned_ids;
+  if(proc_id==0){
+    for(int_t i=0;i<num_procs;++i)
+      zero_owned_ids.push_back(i);
+  }
+  Teuchos::Array<int_t> all_owned_ids;
+  all_owned_ids.push_back(proc_id);
+  Teuchos::RCP<MultiField_Map> zero_map = Teuchos::rcp (new MultiField_Map(-1, zero_owned_ids,0,*comm_));
+  Teuchos::RCP<MultiField_Map> all_map = Teuchos::rcp (new MultiField_Map(-1, all_owned_ids,0,*comm_));
+  Teuchos::RCP<MultiField> zero_data = Teuchos::rcp(new MultiField(zero_map,2,true));
+  Teuchos::RCP<MultiField> all_data = Teuchos::rcp(new MultiField(all_map,2,true));
+
+  // process zero partitions the subsets and stacks the ids in processor order:
+  Teuchos::Array<int_t> field_zero_owned_ids;
+  if(proc_id==0){
+    field_zero_owned_ids = Teuchos::Array<int_t>(num_global_subsets_);
+  }
+  for(int_t i=0;i<field_zero_owned_ids.size();++i){
+    field_zero_owned_ids[i] = i;
+  }
+  Teuchos::RCP<MultiField_Map> field_zero_map = Teuchos::rcp (new MultiField_Map(-1, field_zero_owned_ids,0,*comm_));
+  Teuchos::RCP<MultiField> field_zero_data = Teuchos::rcp(new MultiField(field_zero_map,1,true));
+
+  if(proc_id==0){
+    TEUCHOS_TEST_FOR_EXCEPTION(subset_centroids_x.size()!=num_global_subsets_||subset_centroids_y.size()!=num_global_subsets_,std::runtime_error,"");
+    Teuchos::ArrayRCP<scalar_t> weights = subset_weights;
+    if(weights==Teuchos::null){
+      // estimate the cost of each subset by the number of pixels it has
+      weights = Teuchos::ArrayRCP<scalar_t>(num_global_subsets_,subset_size_>0?subset_size_*subset_size_:1.0);
+      // the conformal subset ids only line up with the subset ids if no subsets were removed by the SSSIG check
+      if(subset_info_!=Teuchos::null){
+        if((int_t)subset_info_->coordinates_vector->size()==num_global_subsets_*2){
+          std::map<int_t,DICe::Conformal_Area_Def>::const_iterator it = subset_info_->conformal_area_defs->begin();
+          for(;it!=subset_info_->conformal_area_defs->end();++it){
+            if(it->first<0||it->first>=num_global_subsets_||!it->second.has_boundary()) continue;
+            // the shapes cache their pixels so these are reused when the subsets are constructed
+            std::vector<std::pair<int_t,int_t> > owned_pixels;
+            reference_pixels(*it->second.boundary(),owned_pixels);
+            weights[it->first] = owned_pixels.size() > 0 ? owned_pixels.size() : 1.0;
           }
-          // reset the dependency index because more items were added to the list
-          dep_it = dependencies.begin();
-          // remove this set of obstruction ids since they have already been added to a group
-          assigned_to_a_group.insert(search_it->first);
-        } // match found
-      } // obstruction set
-    } // dependency it
-    obstruction_groups.push_back(dependencies);
-  } // outer obstruction set it
-  if(proc_id == 0) DEBUG_MSG("[PROC " << proc_id << "] There are " << obstruction_groups.size() << " obstruction groupings: ");
-//  std::stringstream ss;
-//  for(size_t i=0;i<obstruction_groups.size();++i){
-//    ss << "[PROC " << proc_id << "] Group: " << i << std::endl;
-//    std::set<int_t>::iterator j = obstruction_groups[i].begin();
-//    for(;j!=obstruction_groups[i].end();++j){
-//      ss << "[PROC " << proc_id << "]   id: " << *j << std::endl;
-//    }
-//  }
-//  ss << "[PROC " << proc_id << "] Eligible ids: " << std::endl;
-//  for(std::set<int_t>::iterator elig_it=eligible_ids.begin();elig_it!=eligible_ids.end();++elig_it){
-//    ss << "[PROC " << proc_id << "]   " << *elig_it << std::endl;
-//  }
-//  if(proc_id == 0) DEBUG_MSG(ss.str());
-
-  // divy up the obstruction groups among the processors:
-  int_t obst_group_gid = 0;
-  std::vector<std::set<int_t> > local_subset_gids(num_procs);
-  while(obst_group_gid < (int_t)obstruction_groups.size()){
-    for(int_t p_id=0;p_id<num_procs;++p_id){
-      if(obst_group_gid < (int_t)obstruction_groups.size()){
-        //if(p_id==proc_id){
-        local_subset_gids[p_id].insert(obstruction_groups[obst_group_gid].begin(),obstruction_groups[obst_group_gid].end());
-        //}
-        obst_group_gid++;
+        }
       }
-      else break;
     }
-  }
-  // assign the rest based on who has the least amount of subsets
-  for(std::set<int_t>::iterator elig_it = eligible_ids.begin();elig_it!=eligible_ids.end();++elig_it){
-    int_t proc_with_fewest_subsets = 0;
-    int_t lowest_num_subsets = num_global_subsets_;
-    for(int_t i=0;i<num_procs;++i){
-      if((int_t)local_subset_gids[i].size() <= lowest_num_subsets){
-        lowest_num_subsets = local_subset_gids[i].size();
-        proc_with_fewest_subsets = i;
+    std::vector<int_t> part;
+    coordinate_bisection_partition(subset_centroids_x,subset_centroids_y,weights,num_procs,part);
+    int_t id_count = 0;
+    for(int_t proc=0;proc<num_procs;++proc){
+      zero_data->local_value(proc,0) = id_count;
+      for(int_t i=0;i<num_global_subsets_;++i){
+        if(part[i]==proc)
+          field_zero_data->local_value(id_count++) = i;
       }
+      zero_data->local_value(proc,1) = id_count - 1;
+      DEBUG_MSG("Decomp::create_spatial_dist_map(): proc " << proc << " owns " << zero_data->local_value(proc,1) - zero_data->local_value(proc,0) + 1 << " subsets");
     }
-    local_subset_gids[proc_with_fewest_subsets].insert(*elig_it);
+  } // end processor 0
+
+  // communicate the extents of the ordered list to all procs:
+  MultiField_Exporter exporter(*all_map,*zero_data->get_map());
+  all_data->do_import(zero_data,exporter,INSERT);
+  const int_t start_id = all_data->local_value(0,0);
+  const int_t end_id = all_data->local_value(0,1);
+  const int_t num_ids = end_id - start_id + 1;
+
+  Teuchos::Array<int_t> field_all_owned_ids(num_ids);
+  for(int_t i=0;i<field_all_owned_ids.size();++i){
+    field_all_owned_ids[i] = start_id + i;
   }
-  // order the subset ids so that they respect the dependencies:
-  std::vector<int_t> local_gids;
-  std::set<int_t>::iterator set_it = local_subset_gids[proc_id].begin();
-  for(;set_it!=local_subset_gids[proc_id].end();++set_it){
-    // not in the list of subsets with blockers
-    if(obstructing_subset_ids->find(*set_it)==obstructing_subset_ids->end()){
-      local_gids.push_back(*set_it);
-    }
-    // in the list of subsets with blockers, but has no blocking ids
-    else if(obstructing_subset_ids->find(*set_it)->second.size()==0){
-      local_gids.push_back(*set_it);
-    }
+  Teuchos::RCP<MultiField_Map> field_all_map = Teuchos::rcp (new MultiField_Map(-1, field_all_owned_ids,0,*comm_));
+  Teuchos::RCP<MultiField> field_all_data = Teuchos::rcp(new MultiField(field_all_map,1,true));
+  MultiField_Exporter field_exporter(*field_all_map,*field_zero_data->get_map());
+  field_all_data->do_import(field_zero_data,field_exporter,INSERT);
+  const int_t num_local_subsets = field_all_data->get_map()->get_num_local_elements();
+
+  // the ids are already in ascending order on each processor
+  this_proc_gid_order_ = std::vector<int_t>(num_local_subsets,-1);
+  for(int_t i=0;i<num_local_subsets;++i)
+    this_proc_gid_order_[i] = field_all_data->local_value(i);
+  Teuchos::ArrayView<const int_t> local_gids = num_local_subsets > 0 ?
+      Teuchos::ArrayView<const int_t>(&this_proc_gid_order_[0],num_local_subsets) : Teuchos::ArrayView<const int_t>();
+  id_decomp_map_ = Teuchos::rcp(new MultiField_Map(num_global_subsets_,local_gids,0,*comm_));
+}
+
+void
+Decomp::create_obstruction_dist_map(Teuchos::RCP<std::map<int_t,std::vector<int_t> > > & obstructing_subset_ids){
+  if(obstructing_subset_ids==Teuchos::null) return;
+  if(obstructing_subset_ids->size()==0) return;
+
+  const int_t proc_id = comm_->get_rank();
+  const int_t num_procs = comm_->get_size();
+
+  if(proc_id == 0) DEBUG_MSG("Subsets have obstruction dependencies.");
+  // set up the groupings of subset ids that have to stay together
+  // (all the subsets connected by any chain of obstructions end up in the same group)
+  std::vector<std::vector<int_t> > obstruction_groups;
+  group_obstructed_subsets(num_global_subsets_,*obstructing_subset_ids,obstruction_groups);
+  if(proc_id == 0) DEBUG_MSG("[PROC " << proc_id << "] There are " << obstruction_groups.size() << " obstruction groupings: ");
 
+  // divy up the obstruction groups among the processors, largest groups first, each to the processor with the
+  // fewest subsets so far, then the subsets without obstructions fill in the processors with the fewest subsets
+  std::vector<int_t> group_order(obstruction_groups.size());
+  for(size_t i=0;i<group_order.size();++i)
+    group_order[i] = i;
+  std::stable_sort(group_order.begin(),group_order.end(),[&obstruction_groups](const int_t a, const int_t b){
+    return obstruction_groups[a].size() > obstruction_groups[b].size();});
+  // pairs of the number of subsets and the processor id with the fewest subsets on top
+  std::priority_queue<std::pair<int_t,int_t>,std::vector<std::pair<int_t,int_t> >,std::greater<std::pair<int_t,int_t> > > proc_loads;
+  for(int_t i=0;i<num_procs;++i)
+    proc_loads.push(std::pair<int_t,int_t>(0,i));
+  std::vector<bool> in_a_group(num_global_subsets_,false);
+  std::vector<int_t> local_gids;
+  for(size_t i=0;i<group_order.size();++i){
+    const std::vector<int_t> & group = obstruction_groups[group_order[i]];
+    std::pair<int_t,int_t> load = proc_loads.top();
+    proc_loads.pop();
+    for(size_t j=0;j<group.size();++j)
+      in_a_group[group[j]] = true;
+    if(load.second==proc_id)
+      local_gids.insert(local_gids.end(),group.begin(),group.end());
+    load.first += group.size();
+    proc_loads.push(load);
   }
-  set_it = local_subset_gids[proc_id].begin();
-  for(;set_it!=local_subset_gids[proc_id].end();++set_it){
-    if(obstructing_subset_ids->find(*set_it)!=obstructing_subset_ids->end()){
-      if(obstructing_subset_ids->find(*set_it)->second.size()>0){
-        TEUCHOS_TEST_FOR_EXCEPTION(earliest_id_can_appear.find(*set_it)==earliest_id_can_appear.end(),
-          std::runtime_error,"");
-        local_gids.push_back(*set_it);
-      }
-    }
+  for(int_t i=0;i<num_global_subsets_;++i){
+    if(in_a_group[i]) continue;
+    std::pair<int_t,int_t> load = proc_loads.top();
+    proc_loads.pop();
+    if(load.second==proc_id)
+      local_gids.push_back(i);
+    load.first++;
+    proc_loads.push(load);
   }
-
-//  ss.str(std::string());
-//  ss.clear();
-//  ss << "[PROC " << proc_id << "] Has the following subset ids: " << std::endl;
-//  for(size_t i=0;i<local_gids.size();++i){
-//    ss << "[PROC " << proc_id << "] " << local_gids[i] <<  std::endl;
-//  }
-//  DEBUG_MSG(ss.str());
+  // order the subset ids so that each subset comes after the subsets that block it
+  order_by_obstructions(*obstructing_subset_ids,local_gids);
 
   // copy the ids in order
   this_proc_gid_order_ = std::vector<int_t>(local_gids.size(),-1);
@@ -448,7 +470,8 @@ Decomp::create_obstruction_dist_map(Teuchos::RCP<std::map<int_t,std::vector<int_
 
   // sort the vector so the map is not in execution order
   std::sort(local_gids.begin(),local_gids.end());
-  Teuchos::ArrayView<const int_t> lids_grouped_by_obstruction(&local_gids[0],local_gids.size());
+  Teuchos::ArrayView<const int_t> lids_grouped_by_obstruction = local_gids.size() > 0 ?
+      Teuchos::ArrayView<const int_t>(&local_gids[0],local_gids.size()) : Teuchos::ArrayView<const int_t>();
   id_decomp_map_ = Teuchos::rcp(new MultiField_Map(num_global_subsets_,lids_grouped_by_obstruction,0,*comm_));
 }
 
@@ -630,6 +653,7 @@ Decomp::populate_coordinate_vectors(const std::string & image_file_name,
   DEBUG_MSG("[PROC "<<proc_rank <<"] Decomp::populate_coordinate_vectors(): image height: " << img_h);
   image_width_ = img_w;
   image_height_ = img_h;
+  subset_size_ = subset_size;
 
   // processor 0 creates the list of correlation points and divys them up for checking the SSSIG if necessary...
   Teuchos::RCP<std::vector<scalar_t> > subset_centroids = Teuchos::rcp(new std::vector<scalar_t>());
@@ -644,7 +668,9 @@ Decomp::populate_coordinate_vectors(const std::string & image_file_name,
     DICe::Subset_File_Info_Type subset_info_type = DICe::SUBSET_INFO;
     if(has_subset_file){
       std::string fileName = input_params->get<std::string>(DICe::subset_file);
-      subset_info_ = DICe::read_subset_file(fileName,img_w,img_h);
+      // all processors construct the decomp so processor 0 can parse the file and broadcast it
+      const bool use_cache = input_params->get<bool>(DICe::subset_file_cache,false);
+      subset_info_ = DICe::read_subset_file(fileName,img_w,img_h,true,use_cache);
       subset_info_type = subset_info_->type;
     }
     if(!has_subset_file || subset_info_type==DICe::REGION_OF_INTEREST_INFO){
@@ -690,7 +716,8 @@ Decomp::populate_coordinate_vectors(const std::string & image_file_name,
     }
   }
   const scalar_t grad_threshold = correlation_params->get<double>(DICe::sssig_threshold,50.0);
-  if((optimization_method==GRADIENT_BASED || optimization_method==GRADIENT_BASED_THEN_SIMPLEX)&&grad_threshold > 0.0&&subset_size>0){
+  if((optimization_method==GRADIENT_BASED || optimization_method==GRADIENT_BASED_THEN_SIMPLEX ||
+      optimization_method==INVERSE_COMPOSITIONAL || optimization_method==INVERSE_COMPOSITIONAL_THEN_SIMPLEX)&&grad_threshold > 0.0&&subset_size>0){
     sssig_check_done = true;
     // split up the points across processors and check the SSSIG:
 
@@ -858,6 +885,165 @@ Decomp::populate_coordinate_vectors(const std::string & image_file_name,
   num_global_subsets_ = all_data->local_value(0);
 }
 
+/// recursively split the points in the range [begin,end) along the longest extent into num_parts parts
+static void
+coordinate_bisection(const Teuchos::ArrayRCP<scalar_t> & coords_x,
+  const Teuchos::ArrayRCP<scalar_t> & coords_y,
+  const Teuchos::ArrayRCP<scalar_t> & weights,
+  const std::vector<int_t>::iterator begin,
+  const std::vector<int_t>::iterator end,
+  const int_t first_part,
+  const int_t num_parts,
+  std::vector<int_t> & part){
+  if(num_parts<=1||end-begin<=1){
+    for(std::vector<int_t>::iterator it=begin;it!=end;++it)
+      part[*it] = first_part;
+    return;
+  }
+  scalar_t min_x = coords_x[*begin], max_x = min_x;
+  scalar_t min_y = coords_y[*begin], max_y = min_y;
+  scalar_t total_weight = 0.0;
+  for(std::vector<int_t>::iterator it=begin;it!=end;++it){
+    min_x = std::min(min_x,coords_x[*it]);
+    max_x = std::max(max_x,coords_x[*it]);
+    min_y = std::min(min_y,coords_y[*it]);
+    max_y = std::max(max_y,coords_y[*it]);
+    total_weight += weights.size()>0 ? weights[*it] : 1.0;
+  }
+  // sort along the longest extent (ties broken by id so the partition is deterministic)
+  const Teuchos::ArrayRCP<scalar_t> & coords = max_x - min_x >= max_y - min_y ? coords_x : coords_y;
+  std::sort(begin,end,[&coords](const int_t a, const int_t b){
+    return coords[a] < coords[b] || (coords[a]==coords[b] && a < b);});
+  // cut where the weight to the left is proportional to the number of parts on the left
+  const int_t num_left_parts = num_parts/2;
+  const scalar_t target_weight = total_weight*num_left_parts/num_parts;
+  scalar_t left_weight = 0.0;
+  std::vector<int_t>::iterator mid = begin;
+  while(mid!=end){
+    const scalar_t weight = weights.size()>0 ? weights[*mid] : 1.0;
+    // stop if adding this point moves the left side further from the target
+    if(left_weight + weight > target_weight && left_weight + weight - target_weight > target_weight - left_weight) break;
+    left_weight += weight;
+    ++mid;
+  }
+  coordinate_bisection(coords_x,coords_y,weights,begin,mid,first_part,num_left_parts,part);
+  coordinate_bisection(coords_x,coords_y,weights,mid,end,first_part+num_left_parts,num_parts-num_left_parts,part);
+}
+
+DICE_LIB_DLL_EXPORT
+void
+coordinate_bisection_partition(const Teuchos::ArrayRCP<scalar_t> & coords_x,
+  const Teuchos::ArrayRCP<scalar_t> & coords_y,
+  const Teuchos::ArrayRCP<scalar_t> & weights,
+  const int_t num_parts,
+  std::vector<int_t> & part){
+  TEUCHOS_TEST_FOR_EXCEPTION(coords_x.size()!=coords_y.size(),std::runtime_error,"");
+  TEUCHOS_TEST_FOR_EXCEPTION(weights.size()>0&&weights.size()!=coords_x.size(),std::runtime_error,"");
+  TEUCHOS_TEST_FOR_EXCEPTION(num_parts<=0,std::runtime_error,"Error, invalid number of parts " << num_parts);
+  const int_t num_points = coords_x.size();
+  part.assign(num_points,0);
+  std::vector<int_t> ids(num_points);
+  for(int_t i=0;i<num_points;++i)
+    ids[i] = i;
+  coordinate_bisection(coords_x,coords_y,weights,ids.begin(),ids.end(),0,num_parts,part);
+}
+
+/// returns the representative of the set the id belongs to (with path halving)
+static int_t
+find_group_root(std::vector<int_t> & parent,
+  int_t id){
+  while(parent[id]!=id){
+    parent[id] = parent[parent[id]];
+    id = parent[id];
+  }
+  return id;
+}
+
+DICE_LIB_DLL_EXPORT
+void
+group_obstructed_subsets(const int_t num_subsets,
+  const std::map<int_t,std::vector<int_t> > & obstructing_subset_ids,
+  std::vector<std::vector<int_t> > & groups){
+  groups.clear();
+  // union-find over the obstruction relations
+  std::vector<int_t> parent(num_subsets);
+  std::vector<int_t> set_size(num_subsets,1);
+  std::vector<bool> has_obstruction(num_subsets,false);
+  for(int_t i=0;i<num_subsets;++i)
+    parent[i] = i;
+  std::map<int_t,std::vector<int_t> >::const_iterator map_it = obstructing_subset_ids.begin();
+  for(;map_it!=obstructing_subset_ids.end();++map_it){
+    TEUCHOS_TEST_FOR_EXCEPTION(map_it->first<0||map_it->first>=num_subsets,std::runtime_error,
+      "Error, invalid subset id with obstructions " << map_it->first);
+    has_obstruction[map_it->first] = true;
+    for(size_t j=0;j<map_it->second.size();++j){
+      const int_t blocking_id = map_it->second[j];
+      TEUCHOS_TEST_FOR_EXCEPTION(blocking_id<0||blocking_id>=num_subsets,std::runtime_error,
+        "Error, invalid obstructing subset id " << blocking_id << " for subset " << map_it->first);
+      has_obstruction[blocking_id] = true;
+      int_t root_a = find_group_root(parent,map_it->first);
+      int_t root_b = find_group_root(parent,blocking_id);
+      if(root_a==root_b) continue;
+      // the smaller set is attached to the larger one
+      if(set_size[root_a] < set_size[root_b]) std::swap(root_a,root_b);
+      parent[root_b] = root_a;
+      set_size[root_a] += set_size[root_b];
+    }
+  }
+  // collect the groups in order of their lowest subset id, each sorted by id
+  std::map<int_t,int_t> root_to_group;
+  for(int_t i=0;i<num_subsets;++i){
+    if(!has_obstruction[i]) continue;
+    const int_t root = find_group_root(parent,i);
+    std::map<int_t,int_t>::const_iterator root_it = root_to_group.find(root);
+    if(root_it==root_to_group.end()){
+      root_to_group.insert(std::pair<int_t,int_t>(root,groups.size()));
+      groups.push_back(std::vector<int_t>(1,i));
+    }
+    else
+      groups[root_it->second].push_back(i);
+  }
+}
+
+DICE_LIB_DLL_EXPORT
+void
+order_by_obstructions(const std::map<int_t,std::vector<int_t> > & obstructing_subset_ids,
+  std::vector<int_t> & subset_ids){
+  // topological sort of the subset ids (lowest id first among the subsets that are ready)
+  std::map<int_t,int_t> num_blockers;
+  std::map<int_t,std::vector<int_t> > blocked_by;
+  for(size_t i=0;i<subset_ids.size();++i)
+    num_blockers.insert(std::pair<int_t,int_t>(subset_ids[i],0));
+  for(size_t i=0;i<subset_ids.size();++i){
+    std::map<int_t,std::vector<int_t> >::const_iterator map_it = obstructing_subset_ids.find(subset_ids[i]);
+    if(map_it==obstructing_subset_ids.end()) continue;
+    for(size_t j=0;j<map_it->second.size();++j){
+      // blockers that are not in the list do not constrain the order
+      if(num_blockers.find(map_it->second[j])==num_blockers.end()||map_it->second[j]==subset_ids[i]) continue;
+      num_blockers[subset_ids[i]]++;
+      blocked_by[map_it->second[j]].push_back(subset_ids[i]);
+    }
+  }
+  std::priority_queue<int_t,std::vector<int_t>,std::greater<int_t> > ready;
+  for(std::map<int_t,int_t>::const_iterator it=num_blockers.begin();it!=num_blockers.end();++it)
+    if(it->second==0) ready.push(it->first);
+  std::vector<int_t> ordered;
+  ordered.reserve(subset_ids.size());
+  while(!ready.empty()){
+    const int_t id = ready.top();
+    ready.pop();
+    ordered.push_back(id);
+    std::map<int_t,std::vector<int_t> >::const_iterator blocked_it = blocked_by.find(id);
+    if(blocked_it==blocked_by.end()) continue;
+    for(size_t j=0;j<blocked_it->second.size();++j)
+      if(--num_blockers[blocked_it->second[j]]==0)
+        ready.push(blocked_it->second[j]);
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(ordered.size()!=num_blockers.size(),std::runtime_error,
+    "Error, the obstruction relations between the subsets are circular");
+  subset_ids.swap(ordered);
+}
+
 DICE_LIB_DLL_EXPORT
 void
 create_regular_grid_of_correlation_points(std::vector<scalar_t> & correlation_points,
@@ -78,11 +78,14 @@ public:
   /// \param neighbor_ids neighbor id to use for initialization if USE_NEIGHBOR_VALUES is selected
   /// \param obstructing_subset_ids obstructions listed for each subset if necessary
   /// \param correlation_params pointer to the parameters used for the correlation
+  /// \param subset_weights optional cost of each subset (for example the number of pixels times the iterations
+  /// measured in a previous run) used to balance the work if use_spatial_decomposition is true
   Decomp(Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
     Teuchos::ArrayRCP<scalar_t> subset_centroids_y,
     Teuchos::RCP<std::vector<int_t> > neighbor_ids,
     Teuchos::RCP<std::map<int_t,std::vector<int_t> > > obstructing_subset_ids,
-    const Teuchos::RCP<Teuchos::ParameterList> & correlation_params);
+    const Teuchos::RCP<Teuchos::ParameterList> & correlation_params,
+    Teuchos::ArrayRCP<scalar_t> subset_weights=Teuchos::null);
 
   /// destructor
   ~Decomp(){};
@@ -144,11 +147,13 @@ private:
   /// \param neighbor_ids the neighbors in global ids to use for initialization of the solution if neighbor values are used
   /// \param obstructing_subset_ids obstructions listed for each subset if necessary
   /// \param correlation_params pointer to the parameters used for the correlation
+  /// \param subset_weights cost of each subset (can be null, see create_spatial_dist_map())
   void initialize(const Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
     const Teuchos::ArrayRCP<scalar_t> subset_centroids_y,
     Teuchos::RCP<std::vector<int_t> > & neighbor_ids,
     Teuchos::RCP<std::map<int_t,std::vector<int_t> > > obstructing_subset_ids,
-    const Teuchos::RCP<Teuchos::ParameterList> & correlation_params);
+    const Teuchos::RCP<Teuchos::ParameterList> & correlation_params,
+    const Teuchos::ArrayRCP<scalar_t> subset_weights);
 
   /// populate the coordinate vectors
   /// note: all other procs besides proc 0 get an empty vector for coords_x and coords_y
@@ -167,6 +172,18 @@ private:
     Teuchos::RCP<std::vector<int_t> > & neighbor_ids,
     Teuchos::RCP<std::map<int_t,std::vector<int_t> > > & obstructing_subset_ids);
 
+  /// redo the decomposition so that each processor owns a compact region of the image
+  /// (recursive coordinate bisection of the subset centroids weighted by the subset cost),
+  /// the obstruction and seed decompositions take precedence over this one if they apply
+  /// \param subset_centroids_x x coordinates of all global points (only needed on proc 0)
+  /// \param subset_centroids_y y coordinates of all global points (only needed on proc 0)
+  /// \param subset_weights cost of each subset, if null the number of pixels in each subset is used
+  /// \param correlation_params pointer to the parameters used for the correlation
+  void create_spatial_dist_map(const Teuchos::ArrayRCP<scalar_t> subset_centroids_x,
+    const Teuchos::ArrayRCP<scalar_t> subset_centroids_y,
+    const Teuchos::ArrayRCP<scalar_t> subset_weights,
+    const Teuchos::RCP<Teuchos::ParameterList> & correlation_params);
+
   /// redo the ordering and decomposition of points if there are obstructions involved
   /// \param obstructing_subset_ids map giving the obstructions for each subset
   void create_obstruction_dist_map( Teuchos::RCP<std::map<int_t,std::vector<int_t> > > & obstructing_subset_ids);
@@ -185,6 +202,8 @@ private:
   int_t image_width_;
   /// image height of reference image (used for filtering points out of bounds)
   int_t image_height_;
+  /// subset size for square subsets (-1 if not known)
+  int_t subset_size_;
   /// global mpi communicator
   Teuchos::RCP<MultiField_Comm> comm_;
   /// one-to-one decomposition map (all ids are only onwned by one processor)
@@ -223,6 +242,35 @@ void create_regular_grid_of_correlation_points(std::vector<scalar_t> & correlati
   Teuchos::RCP<DICe::Image> image=Teuchos::null,
   const scalar_t & grad_threshold=0.0);
 
+/// \brief Splits a set of points into parts with compact extents and balanced weights using recursive coordinate bisection
+/// \param coords_x x coordinates of the points
+/// \param coords_y y coordinates of the points
+/// \param weights weight of each point (all points are weighted the same if the array is empty)
+/// \param num_parts the number of parts to split the points into
+/// \param part [out] resized to the number of points and populated with the part each point is assigned to
+DICE_LIB_DLL_EXPORT
+void coordinate_bisection_partition(const Teuchos::ArrayRCP<scalar_t> & coords_x,
+  const Teuchos::ArrayRCP<scalar_t> & coords_y,
+  const Teuchos::ArrayRCP<scalar_t> & weights,
+  const int_t num_parts,
+  std::vector<int_t> & part);
+
+/// \brief Groups the subsets that are connected by any chain of obstruction relations
+/// \param num_subsets the global number of subsets
+/// \param obstructing_subset_ids map of each subset id to the ids of the subsets that block it
+/// \param groups [out] the groups of subset ids sorted by id (subsets without obstruction relations are not included)
+DICE_LIB_DLL_EXPORT
+void group_obstructed_subsets(const int_t num_subsets,
+  const std::map<int_t,std::vector<int_t> > & obstructing_subset_ids,
+  std::vector<std::vector<int_t> > & groups);
+
+/// \brief Orders the subset ids so that each subset comes after all of the subsets that block it
+/// \param obstructing_subset_ids map of each subset id to the ids of the subsets that block it
+/// \param subset_ids [in/out] the subset ids to order (blocking subsets not in this list are ignored)
+DICE_LIB_DLL_EXPORT
+void order_by_obstructions(const std::map<int_t,std::vector<int_t> > & obstructing_subset_ids,
+  std::vector<int_t> & subset_ids);
+
 /// \brief Test to see that the point falls with the boundary of a conformal def and not in the excluded area
 /// \param x_coord X coordinate of the point in question
 /// \param y_coord Y coordinate of the point in question
@@ -0,0 +1,205 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_HaloExchange.h>
+#include <DICe_Trace.h>
+
+#include <map>
+
+namespace DICe {
+
+// the tag used for the halo messages
+#if DICE_MPI
+static const int halo_exchange_tag = 7411;
+#endif
+
+Halo_Exchange::Halo_Exchange(Teuchos::RCP<MultiField_Map> dist_map,
+  Teuchos::RCP<MultiField_Map> overlap_map):
+  dist_map_(dist_map),
+  overlap_map_(overlap_map),
+  num_fields_(0),
+  in_progress_(false){
+  Scoped_Trace_Span span("halo_setup","mpi");
+  TEUCHOS_TEST_FOR_EXCEPTION(dist_map_==Teuchos::null||overlap_map_==Teuchos::null,std::runtime_error,"");
+  const int_t num_overlap = overlap_map_->get_num_local_elements();
+  overlap_to_dist_.assign(num_overlap,-1);
+  overlap_to_recv_.assign(num_overlap,std::pair<int_t,int_t>(-1,-1));
+  Teuchos::Array<int_t> remote_gids;
+  std::vector<int_t> remote_olids;
+  for(int_t i=0;i<num_overlap;++i){
+    const int_t gid = overlap_map_->get_global_element(i);
+    overlap_to_dist_[i] = dist_map_->get_local_element(gid);
+    if(overlap_to_dist_[i]<0){
+      remote_gids.push_back(gid);
+      remote_olids.push_back(i);
+    }
+  }
+  // find the owners of the remote ids (collective)
+  Teuchos::Array<int_t> owners(remote_gids.size());
+  dist_map_->get_remote_index_list(remote_gids,owners);
+#if DICE_MPI
+  int num_procs = 1;
+  MPI_Comm_size(MPI_COMM_WORLD,&num_procs);
+  // the ids requested from each processor in the order they will be received
+  std::map<int_t,std::vector<int_t> > requested_gids;
+  for(int_t i=0;i<(int_t)remote_gids.size();++i){
+    TEUCHOS_TEST_FOR_EXCEPTION(owners[i]<0,std::runtime_error,"Error, no processor owns subset " << remote_gids[i]);
+    std::vector<int_t> & gids = requested_gids[owners[i]];
+    overlap_to_recv_[remote_olids[i]] = std::pair<int_t,int_t>(owners[i],gids.size());
+    gids.push_back(remote_gids[i]);
+  }
+  std::vector<int> recv_counts(num_procs,0);
+  std::vector<int> send_counts(num_procs,0);
+  for(std::map<int_t,std::vector<int_t> >::const_iterator it=requested_gids.begin();it!=requested_gids.end();++it)
+    recv_counts[it->first] = it->second.size();
+  // tell each processor how many of its ids this processor needs, then which ones
+  MPI_Alltoall(&recv_counts[0],1,MPI_INT,&send_counts[0],1,MPI_INT,MPI_COMM_WORLD);
+  std::vector<int> recv_displs(num_procs,0);
+  std::vector<int> send_displs(num_procs,0);
+  std::vector<int> request_list;
+  for(int_t p=0;p<num_procs;++p){
+    recv_displs[p] = request_list.size();
+    if(requested_gids.find(p)!=requested_gids.end())
+      request_list.insert(request_list.end(),requested_gids[p].begin(),requested_gids[p].end());
+    if(p>0) send_displs[p] = send_displs[p-1] + send_counts[p-1];
+  }
+  std::vector<int> requested_of_me(send_displs[num_procs-1]+send_counts[num_procs-1]);
+  MPI_Alltoallv(request_list.empty() ? NULL : &request_list[0],&recv_counts[0],&recv_displs[0],MPI_INT,
+    requested_of_me.empty() ? NULL : &requested_of_me[0],&send_counts[0],&send_displs[0],MPI_INT,MPI_COMM_WORLD);
+  std::map<int_t,int_t> recv_proc_index;
+  for(int_t p=0;p<num_procs;++p){
+    if(send_counts[p]>0){
+      send_procs_.push_back(p);
+      send_lids_.push_back(std::vector<int_t>(send_counts[p]));
+      for(int_t i=0;i<send_counts[p];++i){
+        const int_t gid = requested_of_me[send_displs[p]+i];
+        const int_t lid = dist_map_->get_local_element(gid);
+        TEUCHOS_TEST_FOR_EXCEPTION(lid<0,std::runtime_error,"Error, subset " << gid << " requested from the wrong processor");
+        send_lids_.back()[i] = lid;
+        boundary_ids_.insert(gid);
+      }
+    }
+    if(recv_counts[p]>0){
+      recv_proc_index.insert(std::pair<int_t,int_t>(p,recv_procs_.size()));
+      recv_procs_.push_back(p);
+      recv_sizes_.push_back(recv_counts[p]);
+    }
+  }
+  // store the index of the receive processor rather than its rank
+  for(int_t i=0;i<num_overlap;++i)
+    if(overlap_to_recv_[i].first>=0)
+      overlap_to_recv_[i].first = recv_proc_index.find(overlap_to_recv_[i].first)->second;
+#else
+  TEUCHOS_TEST_FOR_EXCEPTION(remote_gids.size()>0,std::runtime_error,"Error, the overlap map has remote ids in a serial run");
+#endif
+  send_buffers_.resize(send_procs_.size());
+  recv_buffers_.resize(recv_procs_.size());
+}
+
+Halo_Exchange::~Halo_Exchange(){
+  wait();
+}
+
+void
+Halo_Exchange::wait(){
+#if DICE_MPI
+  Scoped_Trace_Span span("halo_wait","mpi");
+  if(!requests_.empty())
+    MPI_Waitall(requests_.size(),&requests_[0],MPI_STATUSES_IGNORE);
+  requests_.clear();
+#endif
+}
+
+void
+Halo_Exchange::begin(const std::vector<Teuchos::RCP<MultiField> > & fields){
+  TEUCHOS_TEST_FOR_EXCEPTION(in_progress_,std::runtime_error,"Error, the previous halo exchange has not been completed");
+  num_fields_ = fields.size();
+  for(int_t j=0;j<num_fields_;++j)
+    TEUCHOS_TEST_FOR_EXCEPTION(fields[j]->get_map()->get_num_local_elements()!=dist_map_->get_num_local_elements(),
+      std::runtime_error,"Error, invalid field for the halo exchange");
+  in_progress_ = true;
+#if DICE_MPI
+  Scoped_Trace_Span span("halo_begin","mpi");
+  // the values for each processor are packed field by field
+  for(size_t p=0;p<recv_procs_.size();++p){
+    recv_buffers_[p].resize(recv_sizes_[p]*num_fields_);
+    MPI_Request request;
+    MPI_Irecv(recv_buffers_[p].empty() ? NULL : &recv_buffers_[p][0],recv_buffers_[p].size()*sizeof(scalar_t),MPI_BYTE,
+      recv_procs_[p],halo_exchange_tag,MPI_COMM_WORLD,&request);
+    requests_.push_back(request);
+  }
+  for(size_t p=0;p<send_procs_.size();++p){
+    const int_t num_send = send_lids_[p].size();
+    send_buffers_[p].resize(num_send*num_fields_);
+    for(int_t j=0;j<num_fields_;++j)
+      for(int_t i=0;i<num_send;++i)
+        send_buffers_[p][j*num_send+i] = fields[j]->local_value(send_lids_[p][i]);
+    MPI_Request request;
+    MPI_Isend(send_buffers_[p].empty() ? NULL : &send_buffers_[p][0],send_buffers_[p].size()*sizeof(scalar_t),MPI_BYTE,
+      send_procs_[p],halo_exchange_tag,MPI_COMM_WORLD,&request);
+    requests_.push_back(request);
+  }
+#endif
+}
+
+void
+Halo_Exchange::end(const std::vector<Teuchos::RCP<MultiField> > & fields,
+  std::vector<Teuchos::RCP<MultiField> > & overlap_fields){
+  TEUCHOS_TEST_FOR_EXCEPTION(!in_progress_,std::runtime_error,"Error, no halo exchange is in progress");
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t)fields.size()!=num_fields_,std::runtime_error,"");
+  wait();
+  in_progress_ = false;
+  overlap_fields.resize(num_fields_);
+  const int_t num_overlap = overlap_to_dist_.size();
+  for(int_t j=0;j<num_fields_;++j){
+    overlap_fields[j] = Teuchos::rcp(new MultiField(overlap_map_,1,true));
+    for(int_t i=0;i<num_overlap;++i){
+      if(overlap_to_dist_[i]>=0)
+        overlap_fields[j]->local_value(i) = fields[j]->local_value(overlap_to_dist_[i]);
+      else{
+        const std::pair<int_t,int_t> & source = overlap_to_recv_[i];
+        overlap_fields[j]->local_value(i) = recv_buffers_[source.first][j*recv_sizes_[source.first]+source.second];
+      }
+    }
+  }
+}
+
+}// End DICe Namespace
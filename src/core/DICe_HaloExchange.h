@@ -0,0 +1,155 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_HALOEXCHANGE_H
+#define DICE_HALOEXCHANGE_H
+
+#include <DICe.h>
+#ifdef DICE_TPETRA
+  #include "DICe_MultiFieldTpetra.h"
+#else
+  #include "DICe_MultiFieldEpetra.h"
+#endif
+
+#include <Teuchos_RCP.hpp>
+
+#if DICE_MPI
+#  include <mpi.h>
+#endif
+
+#include <set>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Halo_Exchange
+/// \brief Non-blocking exchange of scalar field values from a distributed map to an overlap map
+///
+/// The communication pattern is set up once by the constructor. begin() posts the sends and receives
+/// for the values other processors need (only the boundary subsets have to be final by then) and
+/// end() waits for the messages and assembles the overlap fields, so the work done between the two
+/// calls (correlating the interior subsets) hides the communication. Without MPI the overlap fields
+/// are assembled from the local values.
+class DICE_LIB_DLL_EXPORT
+Halo_Exchange
+{
+public:
+  /// \brief constructor (collective, all processors have to call it)
+  /// \param dist_map the one-to-one map the fields are stored on
+  /// \param overlap_map the map of the overlap fields (includes the ids needed from the other processors)
+  Halo_Exchange(Teuchos::RCP<MultiField_Map> dist_map,
+    Teuchos::RCP<MultiField_Map> overlap_map);
+
+  /// destructor (waits for any messages still in flight)
+  virtual ~Halo_Exchange();
+
+  /// \brief posts the non-blocking sends and receives (collective)
+  /// \param fields the distributed fields to exchange (the values of the boundary ids are copied on this call)
+  void begin(const std::vector<Teuchos::RCP<MultiField> > & fields);
+
+  /// \brief waits for the exchange posted by begin() and assembles the overlap fields
+  /// \param fields the distributed fields (the same fields given to begin(), the values owned by this
+  /// processor are read from them on this call)
+  /// \param overlap_fields [out] the overlap fields in the same order as the fields
+  void end(const std::vector<Teuchos::RCP<MultiField> > & fields,
+    std::vector<Teuchos::RCP<MultiField> > & overlap_fields);
+
+  /// returns true if begin() has been called without a matching call to end()
+  bool in_progress()const{
+    return in_progress_;
+  }
+
+  /// returns the global ids owned by this processor that other processors need
+  const std::set<int_t> & boundary_ids()const{
+    return boundary_ids_;
+  }
+
+private:
+  /// not copyable
+  Halo_Exchange(const Halo_Exchange &);
+  /// not assignable
+  Halo_Exchange & operator=(const Halo_Exchange &);
+
+  /// waits for the outstanding messages
+  void wait();
+
+  /// the one-to-one map
+  Teuchos::RCP<MultiField_Map> dist_map_;
+  /// the overlap map
+  Teuchos::RCP<MultiField_Map> overlap_map_;
+  /// global ids owned by this processor that are sent to the other processors
+  std::set<int_t> boundary_ids_;
+  /// processors this processor sends values to
+  std::vector<int_t> send_procs_;
+  /// local ids (in the distributed map) of the values sent to each of the send processors
+  std::vector<std::vector<int_t> > send_lids_;
+  /// processors this processor receives values from
+  std::vector<int_t> recv_procs_;
+  /// number of ids received from each of the receive processors
+  std::vector<int_t> recv_sizes_;
+  /// for each overlap local id, the local id in the distributed map or -1 if the value is received
+  std::vector<int_t> overlap_to_dist_;
+  /// for each overlap local id that is received, the receive processor index and the position in the message
+  std::vector<std::pair<int_t,int_t> > overlap_to_recv_;
+  /// number of fields being exchanged
+  int_t num_fields_;
+  /// packed values sent to each send processor
+  std::vector<std::vector<scalar_t> > send_buffers_;
+  /// packed values received from each receive processor
+  std::vector<std::vector<scalar_t> > recv_buffers_;
+#if DICE_MPI
+  /// outstanding requests
+  std::vector<MPI_Request> requests_;
+#endif
+  /// true between begin() and end()
+  bool in_progress_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
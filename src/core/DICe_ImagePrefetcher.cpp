@@ -0,0 +1,182 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_ImagePrefetcher.h>
+
+#include <cassert>
+
+namespace DICe {
+
+Image_Prefetcher::Image_Prefetcher(const Teuchos::RCP<Teuchos::ParameterList> & params):
+  stop_(false){
+  // the parameter list is copied so the background thread never shares it with the caller
+  params_ = Teuchos::rcp(new Teuchos::ParameterList());
+  if(params!=Teuchos::null)
+    *params_ = *params;
+  thread_ = std::thread(&Image_Prefetcher::run,this);
+}
+
+Image_Prefetcher::~Image_Prefetcher(){
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_ = true;
+  }
+  queue_cond_.notify_all();
+  if(thread_.joinable())
+    thread_.join();
+}
+
+void
+Image_Prefetcher::request(const std::string & file_name,
+  const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height){
+  DEBUG_MSG("Image_Prefetcher::request(): " << file_name << " offset " << offset_x << " " << offset_y << " dims " << width << " " << height);
+  Frame frame;
+  frame.file_name_ = file_name;
+  frame.offset_x_ = offset_x;
+  frame.offset_y_ = offset_y;
+  frame.width_ = width;
+  frame.height_ = height;
+  frame.started_ = false;
+  frame.ready_ = false;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    frames_.push_back(frame);
+  }
+  queue_cond_.notify_all();
+}
+
+int_t
+Image_Prefetcher::num_pending(){
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return frames_.size();
+}
+
+Teuchos::RCP<Image>
+Image_Prefetcher::next(const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height){
+  Frame frame;
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    TEUCHOS_TEST_FOR_EXCEPTION(frames_.empty(),std::runtime_error,"Error, no frames have been requested from the prefetcher");
+    queue_cond_.wait(lock,[this]{return frames_.front().ready_;});
+    frame = frames_.front();
+    frames_.pop_front();
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(!frame.error_.empty(),std::runtime_error,
+    "Error, prefetching image " << frame.file_name_ << " failed: " << frame.error_);
+  // make sure the prefetched region still covers what is needed
+  const bool loaded_whole = frame.width_<=0||frame.height_<=0;
+  const bool need_whole = width<=0||height<=0;
+  bool covers = loaded_whole;
+  if(!loaded_whole&&!need_whole){
+    covers = offset_x >= frame.offset_x_ && offset_y >= frame.offset_y_ &&
+        offset_x + width <= frame.offset_x_ + frame.width_ &&
+        offset_y + height <= frame.offset_y_ + frame.height_;
+  }
+  if(!covers){
+    DEBUG_MSG("Image_Prefetcher::next(): prefetched region of " << frame.file_name_ << " is too small, reloading");
+    frame.offset_x_ = offset_x;
+    frame.offset_y_ = offset_y;
+    frame.width_ = width;
+    frame.height_ = height;
+    std::lock_guard<std::mutex> read_lock(read_mutex_);
+    frame.image_ = load(frame);
+  }
+  return frame.image_;
+}
+
+Teuchos::RCP<Image>
+Image_Prefetcher::load(const Frame & frame){
+  if(frame.width_>0&&frame.height_>0)
+    return Teuchos::rcp(new Image(frame.file_name_.c_str(),frame.offset_x_,frame.offset_y_,frame.width_,frame.height_,params_));
+  return Teuchos::rcp(new Image(frame.file_name_.c_str(),params_));
+}
+
+void
+Image_Prefetcher::run(){
+  while(true){
+    Frame * frame = NULL;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      while(!stop_&&frame==NULL){
+        for(size_t i=0;i<frames_.size();++i){
+          if(!frames_[i].started_){
+            frame = &frames_[i];
+            break;
+          }
+        }
+        if(frame==NULL)
+          queue_cond_.wait(lock);
+      }
+      if(stop_) return;
+      // the element stays in place until next() pops it, which can't happen before it is ready
+      frame->started_ = true;
+    }
+    Teuchos::RCP<Image> image;
+    std::string error;
+    {
+      std::lock_guard<std::mutex> read_lock(read_mutex_);
+      try{
+        image = load(*frame);
+      }
+      catch(std::exception & e){
+        error = e.what();
+        if(error.empty()) error = "unknown error";
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      frame->image_ = image;
+      frame->error_ = error;
+      frame->ready_ = true;
+      // release this thread's reference while the lock is held so the count is settled before the hand off
+      image = Teuchos::null;
+    }
+    queue_cond_.notify_all();
+  }
+}
+
+}// End DICe Namespace
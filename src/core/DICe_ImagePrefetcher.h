@@ -0,0 +1,163 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_IMAGEPREFETCHER_H
+#define DICE_IMAGEPREFETCHER_H
+
+#include <DICe.h>
+#include <DICe_Image.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Image_Prefetcher
+/// \brief Loads images on a background thread so that reading, filtering and computing
+/// the gradients of upcoming frames overlaps with the correlation of the current frame
+///
+/// Frames are returned by next() in the order they were requested. Only the background thread
+/// reads image files while the prefetcher is active, any synchronous load also goes through the
+/// prefetcher so that the (non-thread-safe) cine readers are never used by two threads at once.
+class DICE_LIB_DLL_EXPORT
+Image_Prefetcher
+{
+public:
+  /// \brief constructor (starts the background thread)
+  /// \param params the image parameters used to construct each frame (gradients, gauss filter, etc.)
+  Image_Prefetcher(const Teuchos::RCP<Teuchos::ParameterList> & params);
+
+  /// destructor (stops the background thread, pending frames are discarded)
+  virtual ~Image_Prefetcher();
+
+  /// \brief queue a frame to be loaded in the background
+  /// \param file_name the image file name
+  /// \param offset_x offset of the portion of the image to load
+  /// \param offset_y offset of the portion of the image to load
+  /// \param width width of the portion of the image to load (the whole image is loaded if width or height is <= 0)
+  /// \param height height of the portion of the image to load
+  void request(const std::string & file_name,
+    const int_t offset_x=0,
+    const int_t offset_y=0,
+    const int_t width=-1,
+    const int_t height=-1);
+
+  /// \brief returns the oldest requested frame, waiting for it to be loaded if necessary
+  /// If the loaded region does not cover the region given here (the
+  /// extents may have grown since the request) the frame is reloaded synchronously
+  /// \param offset_x offset of the portion of the image required
+  /// \param offset_y offset of the portion of the image required
+  /// \param width width of the portion of the image required (the whole image is required if width or height is <= 0)
+  /// \param height height of the portion of the image required
+  Teuchos::RCP<Image> next(const int_t offset_x=0,
+    const int_t offset_y=0,
+    const int_t width=-1,
+    const int_t height=-1);
+
+  /// returns the number of requested frames that have not been returned by next()
+  int_t num_pending();
+
+private:
+  /// not copyable
+  Image_Prefetcher(const Image_Prefetcher &);
+  /// not assignable
+  Image_Prefetcher & operator=(const Image_Prefetcher &);
+
+  /// a frame in the queue
+  struct Frame{
+    /// image file name
+    std::string file_name_;
+    /// region to load
+    int_t offset_x_;
+    /// region to load
+    int_t offset_y_;
+    /// region to load
+    int_t width_;
+    /// region to load
+    int_t height_;
+    /// true once the background thread has picked up this frame
+    bool started_;
+    /// true once the frame has been loaded (or failed to load)
+    bool ready_;
+    /// the loaded image
+    Teuchos::RCP<Image> image_;
+    /// error message if the load failed
+    std::string error_;
+  };
+
+  /// loads the requested region of an image (called with the read mutex held)
+  Teuchos::RCP<Image> load(const Frame & frame);
+
+  /// main loop of the background thread
+  void run();
+
+  /// image parameters (only used while holding the read mutex)
+  Teuchos::RCP<Teuchos::ParameterList> params_;
+  /// queue of requested frames, front is the next frame returned
+  std::deque<Frame> frames_;
+  /// guards the queue and the stop flag
+  std::mutex queue_mutex_;
+  /// serializes all image reads
+  std::mutex read_mutex_;
+  /// signals changes to the queue
+  std::condition_variable queue_cond_;
+  /// true if the background thread should exit
+  bool stop_;
+  /// the background thread
+  std::thread thread_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -53,6 +53,11 @@
 #include <fstream>
 #include <math.h>
 #include <cassert>
+#include <algorithm>
+#include <map>
+#include <limits>
+#include <vector>
+#include <exception>
 
 #include <boost/timer.hpp>
 
@@ -137,19 +142,38 @@ Path_Initializer::Path_Initializer(Schema * schema,
   kd_tree_->buildIndex();
 
   // now set up the neighbor list for each triad:
+  // the queries only read the tree so the triads are split across threads
+  // with one set of result buffers per thread
   neighbors_ = std::vector<size_t>(num_triads_*num_neighbors_,0);
-  scalar_t query_pt[3];
-  std::vector<size_t> ret_index(num_neighbors_);
-  std::vector<scalar_t> out_dist_sqr(num_neighbors_);
-  for(size_t id=0;id<num_triads_;++id){
-    query_pt[0] = point_cloud_->pts[id].x;
-    query_pt[1] = point_cloud_->pts[id].y;
-    query_pt[2] = point_cloud_->pts[id].z;
-    kd_tree_->knnSearch(&query_pt[0], num_neighbors_, &ret_index[0], &out_dist_sqr[0]);
-    for(size_t i=0;i<num_neighbors_;++i){
-      neighbors_[id*num_neighbors_ + i] = ret_index[i];
+  const int_t num_threads = schema_ ? schema_->num_threads() : 1;
+  std::exception_ptr neighbor_error;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads) if(num_threads>1)
+#endif
+  {
+    std::vector<scalar_t> out_dist_sqr(num_neighbors_);
+    scalar_t query_pt[3];
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t id=0;id<(int_t)num_triads_;++id){
+      try{
+        query_pt[0] = point_cloud_->pts[id].x;
+        query_pt[1] = point_cloud_->pts[id].y;
+        query_pt[2] = point_cloud_->pts[id].z;
+        kd_tree_->knnSearch(&query_pt[0], num_neighbors_, &neighbors_[id*num_neighbors_], &out_dist_sqr[0]);
+      }
+      catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_path_initializer_error)
+#endif
+        {
+          if(!neighbor_error) neighbor_error = std::current_exception();
+        }
+      }
     }
   }
+  if(neighbor_error) std::rethrow_exception(neighbor_error);
 }
 
 void
@@ -159,15 +183,42 @@ Path_Initializer::closest_triad(const scalar_t &u,
   size_t &id,
   scalar_t & distance_sqr)const{
 
+  // only the single closest point is needed so the results go straight into the outputs
   scalar_t query_pt[3];
-  std::vector<size_t> ret_index(num_neighbors_,0.0);
-  std::vector<scalar_t> out_dist_sqr(num_neighbors_,0.0);
   query_pt[0] = u;
   query_pt[1] = v;
   query_pt[2] = t;
-  kd_tree_->knnSearch(&query_pt[0], 1, &ret_index[0], &out_dist_sqr[0]);
-  id = ret_index[0];
-  distance_sqr = out_dist_sqr[0];
+  kd_tree_->knnSearch(&query_pt[0], 1, &id, &distance_sqr);
+}
+
+void
+Path_Initializer::closest_triads(const size_t num_points,
+  const scalar_t * u,
+  const scalar_t * v,
+  const scalar_t * t,
+  size_t * ids,
+  scalar_t * distance_sqr,
+  const int_t num_threads)const{
+  if(num_points==0) return;
+  TEUCHOS_TEST_FOR_EXCEPTION(!u||!v||!t||!ids||!distance_sqr,std::runtime_error,"Error, arrays must not be null here.");
+  std::exception_ptr query_error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads>1)
+#endif
+  for(int_t i=0;i<(int_t)num_points;++i){
+    try{
+      closest_triad(u[i],v[i],t[i],ids[i],distance_sqr[i]);
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_path_initializer_error)
+#endif
+      {
+        if(!query_error) query_error = std::current_exception();
+      }
+    }
+  }
+  if(query_error) std::rethrow_exception(query_error);
 }
 
 void
@@ -291,10 +342,188 @@ void
 Phase_Correlation_Initializer::pre_execution_tasks(){
   assert(schema_->prev_img()!=Teuchos::null);
   assert(schema_->def_img()!=Teuchos::null);
-  DICe::phase_correlate_x_y(schema_->prev_img(),schema_->def_img(),phase_cor_u_x_,phase_cor_u_y_);
+  DICe::phase_correlate_x_y(schema_->prev_img(),schema_->def_img(),phase_cor_u_x_,phase_cor_u_y_,false,schema_->num_threads());
   DEBUG_MSG("Phase_Correlation_Initializer::pre_execution_tasks(): initial displacements ux: " << phase_cor_u_x_ << " uy: " << phase_cor_u_y_);
 }
 
+Status_Flag
+Windowed_Phase_Correlation_Initializer::initial_guess(const int_t subset_gid,
+  Teuchos::RCP<Local_Shape_Function> shape_function){
+  const int_t local_id = schema_->subset_local_id(subset_gid);
+  TEUCHOS_TEST_FOR_EXCEPTION(local_id<0||local_id>=(int_t)u_x_.size(),std::runtime_error,
+    "Error, no windowed phase correlation result for subset " << subset_gid);
+  shape_function->insert_motion(u_x_[local_id] + schema_->global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_FS),
+    u_y_[local_id] + schema_->global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_FS),
+    schema_->global_field_value(subset_gid,ROTATION_Z_FS));
+  return INITIALIZE_SUCCESSFUL;
+};
+
+void
+Windowed_Phase_Correlation_Initializer::pre_execution_tasks(){
+  assert(schema_->prev_img()!=Teuchos::null);
+  assert(schema_->def_img()!=Teuchos::null);
+  const int_t num_subsets = schema_->local_num_subsets();
+  u_x_.assign(num_subsets,0.0);
+  u_y_.assign(num_subsets,0.0);
+  // the window centers are the subset locations in the previous frame,
+  // these are gathered up front since the field access is not thread safe
+  std::vector<int_t> center_x(num_subsets);
+  std::vector<int_t> center_y(num_subsets);
+  for(int_t i=0;i<num_subsets;++i){
+    center_x[i] = (int_t)std::floor(schema_->local_field_value(i,SUBSET_COORDINATES_X_FS)
+      + schema_->local_field_value(i,SUBSET_DISPLACEMENT_X_FS) + 0.5);
+    center_y[i] = (int_t)std::floor(schema_->local_field_value(i,SUBSET_COORDINATES_Y_FS)
+      + schema_->local_field_value(i,SUBSET_DISPLACEMENT_Y_FS) + 0.5);
+  }
+  const Teuchos::RCP<Image> & prev_img = schema_->prev_img();
+  const Teuchos::RCP<Image> & def_img = schema_->def_img();
+  const int_t num_threads = schema_->num_threads();
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr window_error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,16) num_threads(num_threads) if(num_threads>1)
+#endif
+  for(int_t i=0;i<num_subsets;++i){
+    try{
+      scalar_t u_x = 0.0;
+      scalar_t u_y = 0.0;
+      // if the window does not fit in the image the increment stays zero
+      if(phase_correlate_window(prev_img,def_img,center_x[i],center_y[i],window_size_,u_x,u_y)>0.0){
+        u_x_[i] = u_x;
+        u_y_[i] = u_y;
+      }
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_windowed_phase_correlation_error)
+#endif
+      {
+        if(!window_error) window_error = std::current_exception();
+      }
+    }
+  }
+  if(window_error) std::rethrow_exception(window_error);
+  DEBUG_MSG("Windowed_Phase_Correlation_Initializer::pre_execution_tasks(): computed increments for " << num_subsets << " subsets");
+}
+
+scalar_t
+Search_Initializer::grid_search(Teuchos::RCP<Subset> subset,
+  Teuchos::RCP<Image> def_img,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  const scalar_t & scale,
+  const scalar_t & start_u,
+  const scalar_t & end_u,
+  const scalar_t & step_u,
+  const scalar_t & start_v,
+  const scalar_t & end_v,
+  const scalar_t & step_v,
+  const scalar_t & start_t,
+  const scalar_t & end_t,
+  const scalar_t & step_t,
+  scalar_t & best_u,
+  scalar_t & best_v,
+  scalar_t & best_t,
+  bool & good_enough){
+  const scalar_t gamma_good_enough = 1.0E-4;
+  good_enough = false;
+  scalar_t min_gamma = 100.0;
+  best_u = start_u;
+  best_v = start_v;
+  best_t = start_t;
+  // search in u, v, and theta
+  DEBUG_MSG("Search ranges " << start_u << " to " << end_u << " " << start_v << " to " << end_v << " " << start_t << " to " << end_t << " scale " << scale);
+  trial_motions_.clear();
+  for(scalar_t trial_v = start_v;trial_v<=end_v;trial_v+=step_v){
+    for(scalar_t trial_u = start_u;trial_u<=end_u;trial_u+=step_u){
+      for(scalar_t trial_t = start_t;trial_t<=end_t;trial_t+=step_t){
+        trial_motions_.push_back(trial_u);
+        trial_motions_.push_back(trial_v);
+        trial_motions_.push_back(trial_t);
+      } // theta loop
+    } // u loop
+  } // v loop
+  // the trials are evaluated in batches and the results are scanned in the order of the loops above so
+  // the best value and the early exit are the same as if the trials were evaluated one at a time
+  const int_t num_trials = trial_motions_.size()/3;
+  const int_t batch_size = 16;
+  if((int_t)trial_functions_.size()<batch_size)
+    trial_functions_.resize(batch_size);
+  scalar_t trial_gamma[batch_size];
+  for(int_t first=0;first<num_trials;first+=batch_size){
+    const int_t num_batch = std::min(batch_size,num_trials-first);
+    for(int_t k=0;k<num_batch;++k){
+      if(trial_functions_[k]==Teuchos::null||trial_functions_[k]->num_params()!=shape_function->num_params())
+        trial_functions_[k] = shape_function_factory(schema_);
+      // the trials keep the other parameters of the input shape function
+      trial_functions_[k]->clone(shape_function);
+      const scalar_t * motion = &trial_motions_[(first+k)*3];
+      trial_functions_[k]->insert_motion(motion[0]/scale,motion[1]/scale,motion[2]);
+    }
+    try{
+      // assumes that the reference subset has already been initialized
+      subset->batch_gamma(def_img,num_batch,&trial_functions_[0],trial_gamma,KEYS_FOURTH,schema_->num_threads());
+    }
+    catch(std::exception & e){
+      for(int_t k=0;k<num_batch;++k)
+        trial_gamma[k] = 100.0;
+    }
+    for(int_t k=0;k<num_batch;++k){
+      scalar_t gamma = trial_gamma[k];
+      if(gamma<0.0) gamma = 4.0; // catch a failed gamma eval
+      const scalar_t * motion = &trial_motions_[(first+k)*3];
+      //DEBUG_MSG("search pos " << motion[0] << " " << motion[1] << " " << motion[2] << " gamma " << gamma);
+      if(gamma < min_gamma){
+        min_gamma = gamma;
+        best_u = motion[0];
+        best_v = motion[1];
+        best_t = motion[2];
+      }
+      if(gamma < gamma_good_enough){
+        DEBUG_MSG("Found very small gamma: " << gamma << " skipping the rest of the search");
+        good_enough = true;
+        // the input shape function is left at the accepted motion
+        shape_function->insert_motion(motion[0]/scale,motion[1]/scale,motion[2]);
+        return min_gamma;
+      }
+    }
+  }
+  return min_gamma;
+}
+
+Teuchos::RCP<Subset>
+Search_Initializer::pyramid_subset(const int_t level){
+  // the pyramid images average blocks of scale x scale pixels aligned to the global coordinates,
+  // so the subset pixels are gathered into the same blocks and only complete blocks are kept
+  const int_t scale = 1 << level;
+  const int_t min_num_pixels = 25;
+  std::map<std::pair<int_t,int_t>,std::pair<scalar_t,int_t> > blocks;
+  for(int_t i=0;i<subset_->num_pixels();++i){
+    std::pair<scalar_t,int_t> & block = blocks[std::pair<int_t,int_t>(subset_->x(i)/scale,subset_->y(i)/scale)];
+    block.first += subset_->ref_intensities(i);
+    block.second++;
+  }
+  std::vector<int_t> x;
+  std::vector<int_t> y;
+  std::vector<scalar_t> intens;
+  for(std::map<std::pair<int_t,int_t>,std::pair<scalar_t,int_t> >::const_iterator it=blocks.begin();it!=blocks.end();++it){
+    if(it->second.second!=scale*scale) continue;
+    x.push_back(it->first.first);
+    y.push_back(it->first.second);
+    intens.push_back(it->second.first/(scale*scale));
+  }
+  if((int_t)x.size()<min_num_pixels) return Teuchos::null;
+  Teuchos::ArrayRCP<int_t> coords_x(x.size(),0);
+  Teuchos::ArrayRCP<int_t> coords_y(y.size(),0);
+  for(size_t i=0;i<x.size();++i){
+    coords_x[i] = x[i];
+    coords_y[i] = y[i];
+  }
+  Teuchos::RCP<Subset> subset = Teuchos::rcp(new Subset(subset_->centroid_x()/scale,subset_->centroid_y()/scale,coords_x,coords_y));
+  for(size_t i=0;i<intens.size();++i)
+    subset->ref_intensities(i) = intens[i];
+  return subset;
+}
+
 Status_Flag
 Search_Initializer::initial_guess(const int_t subset_gid,
   Teuchos::RCP<Local_Shape_Function> shape_function){
@@ -304,58 +533,63 @@ Search_Initializer::initial_guess(const int_t subset_gid,
   TEUCHOS_TEST_FOR_EXCEPTION(step_size_u_==0.0,std::runtime_error,"Error, step x size must not be 0");
   TEUCHOS_TEST_FOR_EXCEPTION(step_size_v_==0.0,std::runtime_error,"Error, step y size must not be 0");
   TEUCHOS_TEST_FOR_EXCEPTION(step_size_theta_==0.0,std::runtime_error,"Error, step size theta must not be 0");
+  TEUCHOS_TEST_FOR_EXCEPTION(num_pyramid_levels_<0,std::runtime_error,"Error, the number of pyramid levels must not be negative");
 
   // start with the input deformation
   scalar_t orig_u = 0.0,orig_v=0.0,orig_t=0.0;
   shape_function->map_to_u_v_theta(subset_->centroid_x(),subset_->centroid_y(),orig_u,orig_v,orig_t);
-  const scalar_t start_u = step_size_u_ < 0.0 ? orig_u : orig_u - search_dim_u_;
-  const scalar_t start_v = step_size_v_ < 0.0 ? orig_v : orig_v - search_dim_v_;
-  const scalar_t start_t = step_size_theta_ < 0.0 ? orig_t : orig_t - search_dim_theta_;
-  const scalar_t end_u = step_size_u_ < 0.0 ? orig_u : orig_u + search_dim_u_;
-  const scalar_t end_v = step_size_v_ < 0.0 ? orig_v : orig_v + search_dim_v_;
-  const scalar_t end_t = step_size_theta_ < 0.0 ? orig_t : orig_t + search_dim_theta_;
-  if(step_size_u_ < 0.0) step_size_u_ = 1.0;
-  if(step_size_v_ < 0.0) step_size_v_ = 1.0;
-  if(step_size_theta_ < 0.0) step_size_theta_ = 1.0;
-  const scalar_t gamma_good_enough = 1.0E-4;
-  scalar_t min_gamma = 100.0;
-  scalar_t min_u = 0.0;
-  scalar_t min_v = 0.0;
-  scalar_t min_theta = 0.0;
-  // search in u, v, and theta
-  DEBUG_MSG("Search ranges " << start_u << " to " << end_u << " " << start_v << " to " << end_v << " " << start_t << " to " << end_t);
-  for(scalar_t trial_v = start_v;trial_v<=end_v;trial_v+=step_size_u_){
-    for(scalar_t trial_u = start_u;trial_u<=end_u;trial_u+=step_size_v_){
-      for(scalar_t trial_t = start_t;trial_t<=end_t;trial_t+=step_size_theta_){
-        shape_function->insert_motion(trial_u,trial_v,trial_t);
-        subset_->initialize(schema_->def_img(),DEF_INTENSITIES,shape_function);
-        // assumes that the reference subset has already been initialized
-        scalar_t gamma = 100.0;
-        try{
-          gamma = subset_->gamma();
-          if(gamma<0.0) gamma = 4.0; // catch a failed gamma eval
-        }
-        catch(std::exception & e){
-          gamma = 100.0;
-        }
-        //DEBUG_MSG("search pos " << trial_u << " " << trial_v << " " << trial_t << " gamma " << gamma);
-        if(gamma < min_gamma){
-          min_gamma = gamma;
-          min_u = trial_u;
-          min_v = trial_v;
-          min_theta = trial_t;
-        }
-        if(gamma < gamma_good_enough){
-          DEBUG_MSG("Found very small gamma: " << gamma << " skipping the rest of the search");
-          DEBUG_MSG("Search initialization values: u, " << min_u << " v, "
-            << min_v << " theta, " << min_theta);
-          return INITIALIZE_SUCCESSFUL;
-        }
-      } // theta loop
-    } // u loop
-  } // v loop
-  DEBUG_MSG("Search initialization values: " << min_u << " " << min_v << " " << min_theta << " gamma: " << min_gamma);
-  shape_function->insert_motion(min_u,min_v,min_theta);
+  // the extents of the whole search
+  const scalar_t min_u = step_size_u_ < 0.0 ? orig_u : orig_u - search_dim_u_;
+  const scalar_t min_v = step_size_v_ < 0.0 ? orig_v : orig_v - search_dim_v_;
+  const scalar_t min_t = step_size_theta_ < 0.0 ? orig_t : orig_t - search_dim_theta_;
+  const scalar_t max_u = step_size_u_ < 0.0 ? orig_u : orig_u + search_dim_u_;
+  const scalar_t max_v = step_size_v_ < 0.0 ? orig_v : orig_v + search_dim_v_;
+  const scalar_t max_t = step_size_theta_ < 0.0 ? orig_t : orig_t + search_dim_theta_;
+  const scalar_t step_u = step_size_u_ < 0.0 ? 1.0 : step_size_u_;
+  const scalar_t step_v = step_size_v_ < 0.0 ? 1.0 : step_size_v_;
+  const scalar_t step_t = step_size_theta_ < 0.0 ? 1.0 : step_size_theta_;
+  scalar_t start_u = min_u, end_u = max_u;
+  scalar_t start_v = min_v, end_v = max_v;
+  scalar_t start_t = min_t, end_t = max_t;
+  scalar_t best_u = orig_u, best_v = orig_v, best_t = orig_t;
+  bool good_enough = false;
+
+  // coarse-to-fine search, the levels are limited by the number of pixels left in the subset and the image size
+  Teuchos::RCP<Image> def_img = schema_->def_img();
+  std::vector<Teuchos::RCP<Subset> > level_subsets;
+  for(int_t level=1;level<=num_pyramid_levels_;++level){
+    if((def_img->width() >> level) < 16 || (def_img->height() >> level) < 16) break;
+    Teuchos::RCP<Subset> level_subset = pyramid_subset(level);
+    if(level_subset==Teuchos::null) break;
+    level_subsets.push_back(level_subset);
+  }
+  const int_t num_levels = level_subsets.size();
+  if(num_levels > 0){
+    Teuchos::RCP<Local_Shape_Function> level_function = shape_function_factory(schema_);
+    for(int_t level=num_levels;level>=1;--level){
+      const scalar_t scale = 1 << level;
+      if(level<num_levels){
+        // refine around the best value from the level above using the step size from the level above as the radius
+        start_u = std::max(min_u,best_u - 2.0*scale*step_u); end_u = std::min(max_u,best_u + 2.0*scale*step_u);
+        start_v = std::max(min_v,best_v - 2.0*scale*step_v); end_v = std::min(max_v,best_v + 2.0*scale*step_v);
+        start_t = std::max(min_t,best_t - step_t); end_t = std::min(max_t,best_t + step_t);
+      }
+      const scalar_t level_gamma = grid_search(level_subsets[level-1],def_img->pyramid_level(level),level_function,scale,
+        start_u,end_u,scale*step_u,start_v,end_v,scale*step_v,start_t,end_t,step_t,best_u,best_v,best_t,good_enough);
+      DEBUG_MSG("Search pyramid level " << level << " values: " << best_u << " " << best_v << " " << best_t << " gamma: " << level_gamma);
+    }
+    // the full resolution search is restricted to the neighborhood of the level 1 result
+    start_u = std::max(min_u,best_u - 2.0*step_u); end_u = std::min(max_u,best_u + 2.0*step_u);
+    start_v = std::max(min_v,best_v - 2.0*step_v); end_v = std::min(max_v,best_v + 2.0*step_v);
+    start_t = std::max(min_t,best_t - step_t); end_t = std::min(max_t,best_t + step_t);
+  }
+
+  const scalar_t min_gamma = grid_search(subset_,def_img,shape_function,1.0,
+    start_u,end_u,step_u,start_v,end_v,step_v,start_t,end_t,step_t,best_u,best_v,best_t,good_enough);
+  DEBUG_MSG("Search initialization values: " << best_u << " " << best_v << " " << best_t << " gamma: " << min_gamma);
+  if(good_enough)
+    return INITIALIZE_SUCCESSFUL;
+  shape_function->insert_motion(best_u,best_v,best_t);
   if(min_gamma < 1.0)
     return INITIALIZE_SUCCESSFUL;
   else
@@ -404,20 +638,46 @@ void
 Feature_Matching_Initializer::pre_execution_tasks(){
   assert(schema_->ref_img()!=Teuchos::null);
   assert(schema_->def_img()!=Teuchos::null);
-  if(first_call_){
-    prev_img_ = schema_->ref_img();
+  const float tol = 0.005f;
+  // features are only detected in the box around the current subset locations (padded to allow for the motion
+  // between frames) since the features anywhere else are never used to initialize a subset
+  std::vector<int_t> region;
+  if(schema_->local_num_subsets()>0){
+    scalar_t min_x = std::numeric_limits<scalar_t>::max();
+    scalar_t max_x = std::numeric_limits<scalar_t>::lowest();
+    scalar_t min_y = std::numeric_limits<scalar_t>::max();
+    scalar_t max_y = std::numeric_limits<scalar_t>::lowest();
+    for(int_t i=0;i<schema_->local_num_subsets();++i){
+      const int_t gid = schema_->subset_global_id(i);
+      const scalar_t x = schema_->global_field_value(gid,SUBSET_COORDINATES_X_FS) + schema_->global_field_value(gid,SUBSET_DISPLACEMENT_X_FS);
+      const scalar_t y = schema_->global_field_value(gid,SUBSET_COORDINATES_Y_FS) + schema_->global_field_value(gid,SUBSET_DISPLACEMENT_Y_FS);
+      min_x = std::min(min_x,x); max_x = std::max(max_x,x);
+      min_y = std::min(min_y,y); max_y = std::max(max_y,y);
+    }
+    const scalar_t pad = 100 + std::max(schema_->subset_dim(),(int_t)0);
+    region.push_back((int_t)std::floor(min_x - pad));
+    region.push_back((int_t)std::floor(min_y - pad));
+    region.push_back((int_t)std::ceil(max_x + pad));
+    region.push_back((int_t)std::ceil(max_y + pad));
+  }
+  const int_t num_threads = schema_->num_threads();
+  // the features of the previous image were computed last frame (except for the first frame)
+  if(first_call_||prev_features_==Teuchos::null){
+    prev_features_ = Teuchos::rcp(new Feature_Set(schema_->ref_img(),tol,region,tile_size_,max_features_per_tile_,num_threads));
   }
-  // read both images and match features between them
+  // detect the features in the new image and match them to the previous ones
   std::vector<scalar_t> left_x;
   std::vector<scalar_t> left_y;
   std::vector<scalar_t> right_x;
   std::vector<scalar_t> right_y;
+  Teuchos::RCP<Feature_Set> def_features;
   {
     boost::timer t;
-    const float tol = 0.005f;
+    def_features = Teuchos::rcp(new Feature_Set(schema_->def_img(0),tol,region,tile_size_,max_features_per_tile_,num_threads));
     std::stringstream outname;
-    outname << "fm_initializer_" << schema_->mesh()->get_comm()->get_rank() << ".png";
-    match_features(prev_img_,schema_->def_img(0),left_x,left_y,right_x,right_y,tol,outname.str());
+    if(output_match_image_)
+      outname << "fm_initializer_" << schema_->mesh()->get_comm()->get_rank() << ".png";
+    match_features(*prev_features_,*def_features,left_x,left_y,right_x,right_y,matcher_,outname.str());
     const int_t num_matches = left_x.size();
     DEBUG_MSG("number of features matched: " << num_matches);
     DEBUG_MSG("time to compute features: "  << t.elapsed());
@@ -439,7 +699,7 @@ Feature_Matching_Initializer::pre_execution_tasks(){
     u_[i] = right_x[i] - left_x[i];
     v_[i] = right_y[i] - left_y[i];
   }
-  prev_img_ = schema_->def_img(0);
+  prev_features_ = def_features;
   first_call_ = false;
 }
 
@@ -941,12 +1201,23 @@ Optical_Flow_Initializer::initial_guess(const int_t subset_gid,
 };
 
 Motion_Test_Utility::Motion_Test_Utility(Schema * schema,
-  const scalar_t & tol):
+  const scalar_t & tol,
+  const int_t sample_stride,
+  const int_t window_start_x,
+  const int_t window_start_y,
+  const int_t window_end_x,
+  const int_t window_end_y):
   schema_(schema),
   tol_(tol),
+  sample_stride_(sample_stride),
+  window_start_x_(window_start_x),
+  window_start_y_(window_start_y),
+  window_end_x_(window_end_x),
+  window_end_y_(window_end_y),
   motion_state_(MOTION_NOT_SET)
 {
-  DEBUG_MSG("Constructor for Motion_Test_Utility called, tol: " << tol_);
+  TEUCHOS_TEST_FOR_EXCEPTION(sample_stride_<1,std::runtime_error,"Error, invalid motion window sample stride " << sample_stride_);
+  DEBUG_MSG("Constructor for Motion_Test_Utility called, tol: " << tol_ << " sample stride: " << sample_stride_);
 }
 
 bool
@@ -963,21 +1234,39 @@ Motion_Test_Utility::motion_detected(const int_t sub_image_id){
     return motion_state_==MOTION_TRUE ? true: false;
   }
   else{
+    // when testing on the raw pixels the unfiltered frames are compared (the frame may already
+    // have been filtered for another window that detected motion)
+    const bool raw = schema_->test_motion_on_raw_pixels();
+    const Teuchos::RCP<Image> def_img = raw ? schema_->raw_def_img(sub_image_id) : schema_->def_img(sub_image_id);
+    const Teuchos::RCP<Image> prev_img = raw ? schema_->raw_prev_img(sub_image_id) : schema_->prev_img(sub_image_id);
+    if(raw&&(def_img==Teuchos::null||prev_img==Teuchos::null)){
+      DEBUG_MSG("Motion_Test_Utility::motion_detected(): no unfiltered previous frame to compare to, assuming motion");
+      motion_state_ = MOTION_TRUE;
+      return true;
+    }
     // make sure that the images are gauss filtered:
-    TEUCHOS_TEST_FOR_EXCEPTION(!schema_->def_img(sub_image_id)->has_gauss_filter(),std::runtime_error,
+    TEUCHOS_TEST_FOR_EXCEPTION(!raw&&!def_img->has_gauss_filter(),std::runtime_error,
       "Error, Gauss filtering required for using motion windows, but gauss filtering is not enabled in the input.");
-    const int_t half_mask = schema_->def_img(sub_image_id)->gauss_filter_mask_size()/2;
-    const int_t w = schema_->def_img(sub_image_id)->width();
-    const int_t h = schema_->def_img(sub_image_id)->height();
+    const int_t half_mask = def_img->gauss_filter_mask_size()/2;
+    const int_t w = def_img->width();
+    const int_t h = def_img->height();
     DEBUG_MSG("Motion_Test_Utility::motion_detected(): motion window sub_image_id " << sub_image_id << " width " << w << " height " << h);
     //diff the two images and see if the difference is above the user requested tolerance
+    // skip the outer edges since they are not filtered. Once a tolerance is set the
+    // sum can stop as soon as it is exceeded since the exact value is not needed
+    const scalar_t max_diff_sqr = tol_ > 0.0 ? tol_*tol_ : -1.0;
     scalar_t diff = 0.0;
-    // skip the outer edges since they are not filtered
-    for(int_t y=half_mask+1;y<h-(half_mask+1);++y){
-      for(int_t x=half_mask+1;x<w-(half_mask+1);++x){
-        diff += ((*schema_->def_img(sub_image_id))(x,y) - (*schema_->prev_img(sub_image_id))(x,y))*((*schema_->def_img(sub_image_id))(x,y) - (*schema_->prev_img(sub_image_id))(x,y));
-      }
+    const bool has_window = window_end_x_>window_start_x_&&window_end_y_>window_start_y_;
+    if(has_window&&(w>window_end_x_-window_start_x_+1||h>window_end_y_-window_start_y_+1)){
+      // the sub image is a frame shared by several motion windows so only this window is compared
+      const int_t ox = def_img->offset_x();
+      const int_t oy = def_img->offset_y();
+      diff = def_img->sum_squared_diff_region(prev_img,window_start_x_-ox,window_start_y_-oy,
+        window_end_x_-ox,window_end_y_-oy,half_mask+1,sample_stride_,max_diff_sqr);
     }
+    else
+      diff = def_img->sum_squared_diff(prev_img,half_mask+1,sample_stride_,max_diff_sqr);
+    TEUCHOS_TEST_FOR_EXCEPTION(diff<0.0,std::runtime_error,"Error, the motion window images are not the same size");
     diff = std::sqrt(diff);
     DEBUG_MSG("Motion_Test_Utility::motion_detected() called, img diff: " << diff << " initial tol: " << tol_);
     if(tol_==-1.0&&diff!=0.0){ // user has not set a tolerance manually
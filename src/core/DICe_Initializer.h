@@ -64,6 +64,7 @@
 namespace DICe {
 
 class Schema;
+class Feature_Set;
 
 /// Deformation triad to store three parameter values in a set
 struct def_triad
@@ -199,6 +200,24 @@ public:
     size_t &id,
     scalar_t & distance_sqr)const;
 
+  /// return the ids of the path triads closest to a batch of points (for example
+  /// the current solution of every subset in a frame). The kd-tree queries are
+  /// independent so the points are split across threads
+  /// \param num_points the number of points to query
+  /// \param u array of displacements in x (of length num_points)
+  /// \param v array of displacements in y
+  /// \param t array of rotations
+  /// \param ids [out] array of closest triad ids (must be allocated by the caller)
+  /// \param distance_sqr [out] array of squared distances (must be allocated by the caller)
+  /// \param num_threads the number of threads to split the queries across
+  void closest_triads(const size_t num_points,
+    const scalar_t * u,
+    const scalar_t * v,
+    const scalar_t * t,
+    size_t * ids,
+    scalar_t * distance_sqr,
+    const int_t num_threads=1)const;
+
   /// see base class description
   virtual void pre_execution_tasks(){// do nothing for path_initializer
   };
@@ -279,8 +298,47 @@ protected:
   scalar_t phase_cor_u_y_;
 };
 
+/// \class DICe::Windowed_Phase_Correlation_Initializer
+/// \brief A class that computes the phase correlation of a window around
+/// each subset to get an initial displacement for each subset individually.
+/// This initializer is good for cases with large motion that varies across the image
+/// (the window should be larger than twice the expected motion between frames)
+class DICE_LIB_DLL_EXPORT
+Windowed_Phase_Correlation_Initializer : public Initializer{
+public:
+
+  /// constructor
+  /// \param schema the parent schema
+  /// \param window_size the width and height of the phase correlation window in pixels
+  Windowed_Phase_Correlation_Initializer(Schema * schema,
+    const int_t window_size):
+  Initializer(schema),
+  window_size_(window_size){};
+
+  /// virtual destructor
+  virtual ~Windowed_Phase_Correlation_Initializer(){};
+
+  /// see base class description
+  virtual void pre_execution_tasks();
+
+  /// see base class description
+  virtual Status_Flag initial_guess(const int_t subset_gid,
+    Teuchos::RCP<Local_Shape_Function> shape_function);
+
+protected:
+  /// width and height of the phase correlation window
+  int_t window_size_;
+  /// displacement x increment from the previous frame for each local subset
+  std::vector<scalar_t> u_x_;
+  /// displacement y increment from the previous frame for each local subset
+  std::vector<scalar_t> u_y_;
+};
+
 /// \class DICe::Search_Initializer
-/// \brief A class that searches a nearby neighborhood for the subset
+/// \brief A class that searches a nearby neighborhood for the subset.
+/// If pyramid levels are requested, the search starts on a downsampled copy of the
+/// images (coarse-to-fine) and is refined locally at each finer level, which
+/// makes large search windows affordable
 class DICE_LIB_DLL_EXPORT
 Search_Initializer : public Initializer{
 public:
@@ -294,6 +352,7 @@ public:
   /// \param search_dim_v the extents of the search in v
   /// \param step_size_theta the angle step size (negative 1 means don't search in this dim)
   /// \param search_dim_theta the extents of the search in angle
+  /// \param num_pyramid_levels the number of downsampled levels to search first (0 searches only the full resolution images)
   Search_Initializer(Schema * schema,
     Teuchos::RCP<Subset> subset,
     const scalar_t & step_size_u,
@@ -301,7 +360,8 @@ public:
     const scalar_t & step_size_v,
     const scalar_t & search_dim_v,
     const scalar_t & step_size_theta,
-    const scalar_t & search_dim_theta):
+    const scalar_t & search_dim_theta,
+    const int_t num_pyramid_levels=0):
   Initializer(schema),
   subset_(subset),
   step_size_u_(step_size_u),
@@ -309,7 +369,8 @@ public:
   search_dim_u_(search_dim_u),
   search_dim_v_(search_dim_v),
   step_size_theta_(step_size_theta),
-  search_dim_theta_(search_dim_theta){};
+  search_dim_theta_(search_dim_theta),
+  num_pyramid_levels_(num_pyramid_levels){};
 
   /// virtual destructor
   virtual ~Search_Initializer(){};
@@ -322,6 +383,47 @@ public:
     Teuchos::RCP<Local_Shape_Function> shape_function);
 
 protected:
+  /// search a grid of u, v, and theta values (u and v in full resolution pixels) and return the best gamma
+  /// \param subset the subset to evaluate (its reference intensities must be initialized)
+  /// \param def_img the deformed image to evaluate the subset on
+  /// \param shape_function the shape function used to map the subset (only u, v, and theta are changed)
+  /// \param scale the ratio of full resolution pixels to pixels in the images being searched
+  /// \param start_u the first u value
+  /// \param end_u the last u value
+  /// \param step_u the u increment
+  /// \param start_v the first v value
+  /// \param end_v the last v value
+  /// \param step_v the v increment
+  /// \param start_t the first theta value
+  /// \param end_t the last theta value
+  /// \param step_t the theta increment
+  /// \param best_u [out] the u value with the lowest gamma
+  /// \param best_v [out] the v value with the lowest gamma
+  /// \param best_t [out] the theta value with the lowest gamma
+  /// \param good_enough [out] true if the search stopped early because gamma was small enough
+  scalar_t grid_search(Teuchos::RCP<Subset> subset,
+    Teuchos::RCP<Image> def_img,
+    Teuchos::RCP<Local_Shape_Function> shape_function,
+    const scalar_t & scale,
+    const scalar_t & start_u,
+    const scalar_t & end_u,
+    const scalar_t & step_u,
+    const scalar_t & start_v,
+    const scalar_t & end_v,
+    const scalar_t & step_v,
+    const scalar_t & start_t,
+    const scalar_t & end_t,
+    const scalar_t & step_t,
+    scalar_t & best_u,
+    scalar_t & best_v,
+    scalar_t & best_t,
+    bool & good_enough);
+
+  /// create a subset for the given pyramid level by averaging the reference intensities
+  /// of subset_ in blocks, returns null if the subset would have too few pixels
+  /// \param level the pyramid level
+  Teuchos::RCP<Subset> pyramid_subset(const int_t level);
+
   /// pointer to a specific subset
   Teuchos::RCP<Subset> subset_;
   /// search step size in x and y
@@ -334,6 +436,12 @@ protected:
   scalar_t step_size_theta_;
   /// extent of search in theta
   scalar_t search_dim_theta_;
+  /// number of coarse pyramid levels to search before the full resolution search
+  int_t num_pyramid_levels_;
+  /// u, v, and theta of each trial in a grid search (kept so the storage is reused)
+  std::vector<scalar_t> trial_motions_;
+  /// shape functions for a batch of grid search trials
+  std::vector<Teuchos::RCP<Local_Shape_Function> > trial_functions_;
 };
 
 
@@ -362,16 +470,28 @@ public:
 };
 
 /// \class DICe::Feature_Matching_Initializer
-/// \brief an initializer that uses nearby feature matching to initialize the solution
+/// \brief an initializer that uses nearby feature matching to initialize the solution.
+/// The features of each deformed image are kept and reused as the previous image features in the next frame
 class DICE_LIB_DLL_EXPORT
 Feature_Matching_Initializer : public Initializer{
 public:
 
   /// constructor
   /// \param schema the parent schema
-  Feature_Matching_Initializer(Schema * schema):
+  /// \param matcher the descriptor matcher to use
+  /// \param output_match_image true if an image of the matches should be written each frame (for debugging)
+  /// \param tile_size size of the tiles the features are detected in concurrently (0 for no tiles)
+  /// \param max_features_per_tile maximum number of features kept in each tile (0 for no limit)
+  Feature_Matching_Initializer(Schema * schema,
+    const Feature_Matcher matcher=BRUTE_FORCE_FEATURE_MATCHER,
+    const bool output_match_image=false,
+    const int_t tile_size=0,
+    const int_t max_features_per_tile=0):
     Initializer(schema),
-//    prev_img_name_(""),
+    matcher_(matcher),
+    output_match_image_(output_match_image),
+    tile_size_(tile_size),
+    max_features_per_tile_(max_features_per_tile),
     first_call_(true){};
 
   /// virtual destructor
@@ -393,10 +513,16 @@ protected:
   std::vector<scalar_t> u_;
   /// storage for displacements of features
   std::vector<scalar_t> v_;
-  /// previous image pointer (used if the images are constructed from an array)
-  Teuchos::RCP<Image> prev_img_;
-  /// previous image name (used if the images are constructed from file rather than array)
-//  std::string prev_img_name_;
+  /// features of the previous image (the last deformed image)
+  Teuchos::RCP<Feature_Set> prev_features_;
+  /// descriptor matcher
+  Feature_Matcher matcher_;
+  /// true if an image of the matched features is written each frame
+  bool output_match_image_;
+  /// size of the tiles the features are detected in (0 for no tiles)
+  int_t tile_size_;
+  /// maximum number of features kept in each tile (0 for no limit)
+  int_t max_features_per_tile_;
   /// first time the pre execution tasks are called
   bool first_call_;
 };
@@ -566,8 +692,20 @@ public:
   /// constructor
   /// \param schema pointer to the schema that will be calling the motion test utility
   /// \param tol determines the threshold for the image diff to register motion
+  /// \param sample_stride only every sample_stride-th pixel in x and y is compared
+  /// \param window_start_x upper left corner x coord of the motion window (global image coordinates)
+  /// \param window_start_y upper left corner y coord of the motion window
+  /// \param window_end_x lower right corner x coord of the motion window
+  /// \param window_end_y lower right corner y coord of the motion window
+  /// (if the window is not set the whole sub image is compared, if it is set and the sub image is a full frame
+  /// shared by several windows only the window is compared)
   Motion_Test_Utility(Schema * schema,
-    const scalar_t & tol);
+    const scalar_t & tol,
+    const int_t sample_stride=1,
+    const int_t window_start_x=0,
+    const int_t window_start_y=0,
+    const int_t window_end_x=0,
+    const int_t window_end_y=0);
 
   /// virtual destructor
   ~Motion_Test_Utility(){};
@@ -586,6 +724,16 @@ private:
   Schema * schema_;
   /// image diff tolerance (above this means motion is occurring)
   scalar_t tol_;
+  /// sampling interval for the image diff
+  int_t sample_stride_;
+  /// upper left corner x coord of the motion window
+  int_t window_start_x_;
+  /// upper left corner y coord of the motion window
+  int_t window_start_y_;
+  /// lower right corner x coord of the motion window
+  int_t window_end_x_;
+  /// lower right corner y coord of the motion window
+  int_t window_end_y_;
   /// keep a copy of the result incase another call is
   /// made for this initializer by another subset
   Motion_State motion_state_;
@@ -44,10 +44,22 @@
 #include <DICe_Image.h>
 #include <DICe_ImageIO.h>
 #include <DICe_Schema.h>
+#include <DICe_ThroughputTuner.h>
 #include <DICe_Triangulation.h>
+#include <DICe_ImagePrefetcher.h>
+#include <DICe_OutputWriter.h>
+#include <DICe_Profiler.h>
+#include <DICe_Trace.h>
+#include <DICe_Metrics.h>
+#include <DICe_MemoryTracker.h>
 
 #include <boost/timer.hpp>
 
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <thread>
+
 #if DICE_MPI
 #  include <mpi.h>
 #endif
@@ -87,9 +99,19 @@ int main(int argc, char *argv[]) {
     input_params->print(*outStream);
     *outStream << "\n--- Input read successfully ---\n" << std::endl;
 
+    // the phase timers are compiled in but only record when requested
+    const bool print_phase_timing = input_params->get<bool>(DICe::print_phase_timing,false);
+    Profiler::reset();
+    Profiler::set_enabled(print_phase_timing);
+    // the timeline is only recorded when a trace file is requested
+    const std::string trace_prefix = input_params->get<std::string>(DICe::trace_file_prefix,"");
+    if(!trace_prefix.empty())
+      Trace_Recorder::start(input_params->get<int_t>(DICe::trace_events_per_thread,65536));
+
     // correlation parameters
 
     bool is_error_est_run = false;
+    bool is_tuning_run = false;
     Teuchos::RCP<Teuchos::ParameterList> correlation_params;
     if(input_params->isParameter(DICe::correlation_parameters_file)){
       const std::string paramsFileName = input_params->get<std::string>(DICe::correlation_parameters_file);
@@ -101,6 +123,7 @@ int main(int argc, char *argv[]) {
         // force the computing of the image laplacian for the reference image:
         correlation_params->set(DICe::compute_laplacian_image,true);
       }
+      is_tuning_run = correlation_params->get<bool>(DICe::tune_throughput,false);
       *outStream << "\n--- Correlation parameters read successfully ---\n" << std::endl;
     }
     else{
@@ -129,6 +152,9 @@ int main(int argc, char *argv[]) {
     int_t first_frame_id = 0;
     int_t image_width = 0;
     int_t image_height = 0;
+    const int_t frame_cache_mb = correlation_params!=Teuchos::null ? correlation_params->get<int_t>(DICe::image_frame_cache_size,0) : 0;
+    TEUCHOS_TEST_FOR_EXCEPTION(frame_cache_mb<0,std::runtime_error,"Error, image_frame_cache_size cannot be negative");
+    utils::Image_Reader_Cache::instance().set_frame_cache_budget((size_t)frame_cache_mb*1024*1024);
     const bool is_cine = utils::image_file_type(image_files[0].c_str()) == CINE;
     bool filter_failed_pixels = false;
     if(is_cine){
@@ -175,6 +201,14 @@ int main(int argc, char *argv[]) {
       *outStream << "Execution information will be written to a separate file (not placed in the output headers)" << std::endl;
     }
 
+    // optionally split the frames rather than the subsets among the processors, in which case
+    // the schemas on each processor are serial and own all the subsets
+    const bool frame_parallel = input_params->get<bool>(DICe::use_frame_parallel_decomposition,false)&&proc_size>1;
+    if(frame_parallel){
+      *outStream << "Splitting the frames among " << proc_size << " processors (each processor correlates all of the subsets)" << std::endl;
+      MultiField_Comm::set_serial(true);
+    }
+
     // create schemas:
     Teuchos::RCP<DICe::Schema> schema = Teuchos::rcp(new DICe::Schema(input_params,correlation_params));
     Teuchos::RCP<DICe::Schema> stereo_schema;
@@ -253,6 +287,19 @@ int main(int argc, char *argv[]) {
       return 0;
     }
 
+    // if the user selects the tune_throughput option, candidate configurations are evaluated on a sample of the subsets
+    // and the actual analysis is skipped
+    if(is_tuning_run){
+      TEUCHOS_TEST_FOR_EXCEPTION(proc_size>1,std::runtime_error,"Error, tune_throughput has to be run on one processor");
+      Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
+      imgParams->set(DICe::compute_image_gradients,true);
+      Teuchos::RCP<Image> ref_img = Teuchos::rcp(new Image(image_files[0].c_str(),imgParams));
+      DICe::tune_throughput(schema,ref_img,correlation_params,input_params->get<std::string>(DICe::correlation_parameters_file),
+        output_folder,outStream);
+      DICe::finalize();
+      return 0;
+    }
+
     TEUCHOS_TEST_FOR_EXCEPTION(is_stereo&&!input_params->isParameter(DICe::calibration_parameters_file),std::runtime_error,
       "Error, calibration_parameters_file required for stereo");
     Teuchos::RCP<DICe::Triangulation> triangulation;
@@ -273,14 +320,38 @@ int main(int argc, char *argv[]) {
       boost::timer t;
       TEUCHOS_TEST_FOR_EXCEPTION(schema->analysis_type()==GLOBAL_DIC,std::runtime_error,"Error, global stereo not enabled yet");
       *outStream << "Processing cross correlation between left and right images" << std::endl;
-      schema->initialize_cross_correlation(triangulation,input_params); // images don't need to be loaded by here they get loaded in this routine based on the input params
-      schema->update_extents(true);
-      schema->set_ref_image(image_files[0]);
-      schema->set_def_image(stereo_image_files[0]);
-      if(schema->use_nonlinear_projection()){
-        schema->project_right_image_into_left_frame(triangulation,false);
+      // the cross-correlation can be reused from an earlier run with the same reference images and calibration
+      const std::string cross_corr_cache_file = input_params->get<std::string>(DICe::cross_correlation_cache_file,"");
+      std::uint64_t cross_corr_key = 0;
+      bool cross_corr_cached = false;
+      if(!cross_corr_cache_file.empty()){
+        cross_corr_key = schema->cross_correlation_cache_key(triangulation,input_params);
+        cross_corr_cached = schema->read_cross_correlation_cache(cross_corr_cache_file,cross_corr_key,triangulation);
+        // every processor has to agree or the ones that recompute would wait on the others
+#if DICE_MPI
+        int local_cached = cross_corr_cached ? 1 : 0;
+        int all_cached = 0;
+        MPI_Allreduce(&local_cached,&all_cached,1,MPI_INT,MPI_MIN,MPI_COMM_WORLD);
+        cross_corr_cached = all_cached==1;
+#endif
+      }
+      if(cross_corr_cached){
+        *outStream << "Reusing the cross correlation from " << cross_corr_cache_file << std::endl;
+        schema->update_extents(true);
+        schema->set_ref_image(image_files[0]);
+      }
+      else{
+        schema->initialize_cross_correlation(triangulation,input_params); // images don't need to be loaded by here they get loaded in this routine based on the input params
+        schema->update_extents(true);
+        schema->set_ref_image(image_files[0]);
+        schema->set_def_image(stereo_image_files[0]);
+        if(schema->use_nonlinear_projection()){
+          schema->project_right_image_into_left_frame(triangulation,false);
+        }
+        schema->execute_cross_correlation();
+        if(!cross_corr_cache_file.empty())
+          schema->write_cross_correlation_cache(cross_corr_cache_file,cross_corr_key,triangulation);
       }
-      schema->execute_cross_correlation();
       schema->save_cross_correlation_fields();
       stereo_schema = Teuchos::rcp(new DICe::Schema(input_params,correlation_params,schema));
       stereo_schema->update_extents();
@@ -298,6 +369,71 @@ int main(int argc, char *argv[]) {
       schema->set_ref_image(image_files[0]);
     }
 
+    // correlate a few sample frames and project the cost of the full run (nothing is written)
+    if(input_params->isParameter(DICe::estimate_run_and_exit)){
+      const int_t num_sample_frames = std::min(input_params->get<int_t>(DICe::estimate_run_and_exit),num_frames);
+      TEUCHOS_TEST_FOR_EXCEPTION(num_sample_frames<1,std::runtime_error,"Error, the estimate requires at least one deformed frame");
+      Memory_Tracker::reset_peaks();
+      scalar_t sample_time = 0.0;
+      for(int_t image_it=1;image_it<=num_sample_frames;++image_it){
+        *outStream << "Estimating the cost with sample frame: " << image_it << " of " << num_sample_frames << std::endl;
+        boost::timer t;
+        if(schema->use_incremental_formulation()&&image_it>1)
+          schema->set_ref_image(schema->def_img());
+        schema->update_extents();
+        schema->set_def_image(image_files[image_it]);
+        schema->execute_correlation();
+        if(is_stereo){
+          if(stereo_schema->use_incremental_formulation()&&image_it>1)
+            stereo_schema->set_ref_image(stereo_schema->def_img());
+          stereo_schema->update_extents();
+          stereo_schema->set_def_image(stereo_image_files[image_it]);
+          stereo_schema->execute_correlation();
+          schema->execute_triangulation(triangulation,stereo_schema);
+        }
+        schema->execute_post_processors();
+        // the first frame includes the one time setup
+        if(image_it>1||num_sample_frames==1)
+          sample_time += t.elapsed();
+      }
+      // the slowest processor sets the pace of the run
+      double frame_time = sample_time / (num_sample_frames>1 ? num_sample_frames-1 : 1);
+      double peak_bytes = Memory_Tracker::total_peak();
+#if DICE_MPI
+      double max_value = 0.0;
+      MPI_Allreduce(&frame_time,&max_value,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+      frame_time = max_value;
+      MPI_Allreduce(&peak_bytes,&max_value,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+      peak_bytes = max_value;
+#endif
+      // every processor reads every frame unless the frames are split among them,
+      // the output is estimated as one text value of ~16 characters per field per point
+      const int_t num_cameras = is_stereo ? 2 : 1;
+      const int_t num_readers = frame_parallel ? 1 : proc_size;
+      const double input_bytes = (double)num_cameras*(num_frames+1)*image_width*image_height*sizeof(intensity_t)*num_readers;
+      const double total_time = frame_parallel ? frame_time*((num_frames+proc_size-1)/proc_size) : frame_time*num_frames;
+      const int_t num_output_fields = 20;
+      const int_t num_output_points = schema->analysis_type()==LOCAL_DIC ? schema->global_num_subsets() :
+          schema->mesh()->get_scalar_node_dist_map()->get_num_global_elements();
+      const int_t output_frequency = std::max(input_params->get<int_t>(DICe::output_frequency,1),1);
+      int_t num_output_frames = 0;
+      for(int_t image_it=1;image_it<=num_frames;++image_it)
+        if(image_it==num_frames||(image_it-1)%output_frequency==0) num_output_frames++;
+      const double output_bytes = (double)num_output_frames*num_output_points*num_output_fields*16.0;
+      const double mb = 1024.0*1024.0;
+      if(proc_rank==0){
+        std::cout << "Estimated cost of the full run (from " << num_sample_frames << " sample frame(s) on " << proc_size << " processor(s)):" << std::endl;
+        std::cout << "  Number of frames:          " << num_frames << std::endl;
+        std::cout << "  Time per frame:            " << frame_time << std::endl;
+        std::cout << "  Total correlation time:    " << total_time << std::endl;
+        std::cout << "  Peak memory per processor: " << peak_bytes/mb << " MB (tracked allocations only)" << std::endl;
+        std::cout << "  Image data read:           " << input_bytes/mb << " MB" << std::endl;
+        std::cout << "  Output written (approx):   " << output_bytes/mb << " MB" << std::endl;
+      }
+      DICe::finalize();
+      return 0;
+    }
+
     // iterate through the images and perform the correlation:
     scalar_t corr_time = 0.0;
     scalar_t elapsed_time = 0.0;
@@ -307,68 +443,395 @@ int main(int argc, char *argv[]) {
     scalar_t avg_time = 0.0;
     bool failed_step = false;
 
-    for(int_t image_it=1;image_it<=num_frames;++image_it){
-      *outStream << "Processing frame: " << image_it << " of " << num_frames << ", " << image_files[image_it] << std::endl;
+    // optionally move subsets between processors when the cost of the subsets changes over the frames
+    const scalar_t rebalance_threshold = input_params->get<double>(DICe::rebalance_imbalance_threshold,0.0);
+    TEUCHOS_TEST_FOR_EXCEPTION(rebalance_threshold!=0.0&&rebalance_threshold<1.0,std::runtime_error,
+      "Error, rebalance_imbalance_threshold must be 1.0 or greater (or 0 to never rebalance)");
+    TEUCHOS_TEST_FOR_EXCEPTION(rebalance_threshold>0.0&&(is_stereo||separate_output_file_for_each_subset),std::runtime_error,
+      "Error, rebalance_imbalance_threshold cannot be used for stereo or with a separate output file for each subset");
+
+    // only every output_frequency-th frame (counting from the first) and the last frame are post processed and
+    // written, the others are still correlated so the solution is carried forward
+    const int_t output_frequency = input_params->get<int_t>(DICe::output_frequency,1);
+    TEUCHOS_TEST_FOR_EXCEPTION(output_frequency<1,std::runtime_error,"Error, output_frequency must be at least 1");
+    // the frames to correlate on this processor in order, the ones that are not output only seed the initial guess
+    std::vector<int_t> frame_list;
+    std::vector<bool> output_frame;
+    // the coarse pass frames are at the start of the list
+    int_t num_coarse_frames = 0;
+    if(frame_parallel){
+      TEUCHOS_TEST_FOR_EXCEPTION(schema->use_incremental_formulation()||(is_stereo&&stereo_schema->use_incremental_formulation()),std::runtime_error,
+        "Error, use_frame_parallel_decomposition cannot be used with the incremental formulation");
+      TEUCHOS_TEST_FOR_EXCEPTION(rebalance_threshold>0.0||separate_output_file_for_each_subset,std::runtime_error,
+        "Error, use_frame_parallel_decomposition cannot be used with rebalance_imbalance_threshold or a separate output file for each subset");
+      // each processor gets a contiguous range of frames
+      const int_t block_start = 1 + (proc_rank*num_frames)/proc_size;
+      const int_t block_end = ((proc_rank+1)*num_frames)/proc_size;
+      if(block_start<=block_end){
+        // coarse pass: the first frame of each of the previous ranges is correlated in order so that the
+        // solution carried into this range is close (the reference frame is the same for all frames)
+        for(int_t rank=0;rank<proc_rank;++rank){
+          const int_t coarse_frame = 1 + (rank*num_frames)/proc_size;
+          if(coarse_frame<block_start&&(frame_list.empty()||coarse_frame>frame_list.back())){
+            frame_list.push_back(coarse_frame);
+            output_frame.push_back(false);
+          }
+        }
+        num_coarse_frames = frame_list.size();
+        for(int_t image_it=block_start;image_it<=block_end;++image_it){
+          frame_list.push_back(image_it);
+          // the first frame of each range is always written so the output files of the range are initialized
+          output_frame.push_back(image_it==block_start||image_it==num_frames||(image_it-1)%output_frequency==0);
+        }
+      }
+      *outStream << "Processor " << proc_rank << " correlating frames " << block_start << " to " << block_end << std::endl;
+      // the independent schemas write their own binary output files
+      std::stringstream suffix;
+      suffix << "_frames_" << block_start << "_" << block_end;
+      schema->set_output_file_suffix(suffix.str());
+      if(is_stereo)
+        stereo_schema->set_output_file_suffix(suffix.str());
+    }
+    else{
+      for(int_t image_it=1;image_it<=num_frames;++image_it){
+        frame_list.push_back(image_it);
+        output_frame.push_back(image_it==num_frames||(image_it-1)%output_frequency==0);
+      }
+    }
+    // optionally write the correlation state every few frames so that an interrupted analysis can be restarted
+    // (the right camera of a stereo analysis has its own checkpoint file)
+    const std::string checkpoint_file = input_params->get<std::string>(DICe::checkpoint_file,"");
+    const std::string stereo_checkpoint_file = checkpoint_file + "_right";
+    const int_t checkpoint_frequency = input_params->get<int_t>(DICe::checkpoint_frequency,0);
+    const bool restart = input_params->get<bool>(DICe::restart_from_checkpoint,false);
+    TEUCHOS_TEST_FOR_EXCEPTION(checkpoint_frequency<0,std::runtime_error,"Error, checkpoint_frequency must be >= 0");
+    TEUCHOS_TEST_FOR_EXCEPTION((checkpoint_frequency>0||restart)&&checkpoint_file.empty(),std::runtime_error,
+      "Error, checkpoint_frequency and restart_from_checkpoint require a checkpoint_file");
+    TEUCHOS_TEST_FOR_EXCEPTION((checkpoint_frequency>0||restart)&&(frame_parallel||rebalance_threshold>0.0),std::runtime_error,
+      "Error, checkpoints cannot be used with use_frame_parallel_decomposition or rebalance_imbalance_threshold");
+    TEUCHOS_TEST_FOR_EXCEPTION(restart&&(separate_output_file_for_each_subset||input_params->get<bool>(DICe::binary_output_files,false)),
+      std::runtime_error,"Error, restart_from_checkpoint cannot append to a separate output file for each subset or a binary output file");
+    if(restart){
+      const int_t last_frame = schema->read_checkpoint(checkpoint_file);
+      TEUCHOS_TEST_FOR_EXCEPTION(is_stereo&&stereo_schema->read_checkpoint(stereo_checkpoint_file)!=last_frame,std::runtime_error,
+        "Error, the left and right checkpoint files are from different frames");
+      TEUCHOS_TEST_FOR_EXCEPTION(last_frame<1||last_frame>num_frames,std::runtime_error,
+        "Error, the checkpoint frame " << last_frame << " is not in this analysis");
+      *outStream << "Restarting after frame " << last_frame << " from checkpoint " << checkpoint_file << std::endl;
+      // the last completed frame is the previous frame for the motion tests and the reference for the incremental formulation
+      schema->update_extents();
+      schema->set_def_image(image_files[last_frame]);
+      for(size_t i=0;i<schema->prev_imgs()->size();++i)
+        schema->set_prev_image(schema->def_img(i),i);
+      if(is_stereo){
+        stereo_schema->update_extents();
+        stereo_schema->set_def_image(stereo_image_files[last_frame]);
+        for(size_t i=0;i<stereo_schema->prev_imgs()->size();++i)
+          stereo_schema->set_prev_image(stereo_schema->def_img(i),i);
+      }
+      frame_list.erase(frame_list.begin(),frame_list.begin()+last_frame);
+      output_frame.erase(output_frame.begin(),output_frame.begin()+last_frame);
+    }
+    const int_t num_local_frames = frame_list.size();
+
+    // optionally load the upcoming deformed frames on a background thread while the current frame is correlated
+    // (the left and right frames for stereo share the same queue so reads are never concurrent)
+    const int_t num_prefetch = input_params->get<int_t>(DICe::num_prefetch_frames,0);
+    TEUCHOS_TEST_FOR_EXCEPTION(num_prefetch<0,std::runtime_error,"Error, num_prefetch_frames must be >= 0");
+    // the node shared frames are read collectively by all the processes on a node, so each process has to read
+    // the same frames in the same order on the main thread
+    TEUCHOS_TEST_FOR_EXCEPTION(schema->node_shared_images()&&frame_parallel,std::runtime_error,
+      "Error, node_shared_images cannot be used with use_frame_parallel_decomposition");
+    if(schema->node_shared_images()&&num_prefetch>0)
+      *outStream << "Warning: num_prefetch_frames is ignored because the frames are shared by the processes on each node" << std::endl;
+    int_t stereo_image_width = 0;
+    int_t stereo_image_height = 0;
+    if(is_stereo)
+      utils::read_image_dimensions(stereo_image_files[0].c_str(),stereo_image_width,stereo_image_height);
+    Teuchos::RCP<DICe::Image_Prefetcher> prefetcher;
+    int_t region_x = 0, region_y = 0, region_w = 0, region_h = 0;
+    if(num_prefetch>0&&!schema->node_shared_images()){
+      *outStream << "Prefetching " << num_prefetch << " frame(s) ahead on a background thread" << std::endl;
+      // the stereo schema uses the same image parameters as the left schema
+      prefetcher = Teuchos::rcp(new DICe::Image_Prefetcher(schema->def_image_params()));
+      for(int_t frame_it=0;frame_it<std::min(num_prefetch,num_local_frames);++frame_it){
+        schema->def_image_region(image_width,image_height,region_x,region_y,region_w,region_h);
+        prefetcher->request(image_files[frame_list[frame_it]],region_x,region_y,region_w,region_h);
+        if(is_stereo){
+          stereo_schema->def_image_region(stereo_image_width,stereo_image_height,region_x,region_y,region_w,region_h);
+          prefetcher->request(stereo_image_files[frame_list[frame_it]],region_x,region_y,region_w,region_h);
+        }
+      }
+    }
+
+    // optionally format and write the output on a background thread while the next frame is correlated
+    // (the left and right schemas share the writer so the files are written in order)
+    const int_t num_async_output = input_params->get<int_t>(DICe::num_async_output_frames,0);
+    TEUCHOS_TEST_FOR_EXCEPTION(num_async_output<0,std::runtime_error,"Error, num_async_output_frames must be >= 0");
+    Teuchos::RCP<DICe::Output_Writer> output_writer;
+    if(num_async_output>0){
+      *outStream << "Writing the output on a background thread (up to " << num_async_output << " frame(s) queued)" << std::endl;
+      output_writer = Teuchos::rcp(new DICe::Output_Writer(num_async_output));
+      schema->set_output_writer(output_writer);
+      if(is_stereo)
+        stereo_schema->set_output_writer(output_writer);
+    }
+    // live throughput and failure rates for long analyses
+    Teuchos::RCP<DICe::Metrics_Sink> metrics;
+    if(input_params->isParameter(DICe::metrics_file)){
+      std::string metrics_file_name = input_params->get<std::string>(DICe::metrics_file);
+      if(proc_size>1){
+        // each processor writes its own file
+        std::stringstream rank_suffix;
+        rank_suffix << "." << proc_size << "." << proc_rank;
+        const size_t ext_pos = metrics_file_name.find_last_of('.');
+        const size_t dir_pos = metrics_file_name.find_last_of("/\\");
+        if(ext_pos==std::string::npos||(dir_pos!=std::string::npos&&ext_pos<dir_pos))
+          metrics_file_name += rank_suffix.str();
+        else
+          metrics_file_name.insert(ext_pos,rank_suffix.str());
+      }
+      *outStream << "Writing the run metrics to " << metrics_file_name << std::endl;
+      metrics = Teuchos::rcp(new DICe::Metrics_Sink(metrics_file_name,input_params->get<double>(DICe::metrics_interval,10.0),proc_rank));
+    }
+    // bytes held by each subsystem at the end of each frame (and the peak during the frame)
+    const bool print_memory_usage = input_params->get<bool>(DICe::print_memory_usage,false);
+    std::ofstream memory_file;
+    if(print_memory_usage){
+      std::stringstream memory_file_name;
+      memory_file_name << output_folder << "memory." << proc_size << "." << proc_rank << ".txt";
+      memory_file.open(memory_file_name.str().c_str());
+      TEUCHOS_TEST_FOR_EXCEPTION(!memory_file.is_open(),std::runtime_error,"Error, could not open the memory file " << memory_file_name.str());
+      Memory_Tracker::write_frame(memory_file,schema->frame_id(),true);
+      Memory_Tracker::reset_peaks();
+    }
+    auto record_memory = [&](){
+      if(!print_memory_usage) return;
+      Memory_Tracker::write_frame(memory_file,schema->frame_id(),false);
+      Memory_Tracker::reset_peaks();
+    };
+
+    // optionally correlate the left and right cameras of each stereo frame at the same time
+    bool concurrent_stereo = is_stereo&&input_params->get<bool>(DICe::concurrent_stereo_correlation,false);
+    TEUCHOS_TEST_FOR_EXCEPTION(concurrent_stereo&&proc_size>1&&!frame_parallel,std::runtime_error,
+      "Error, concurrent_stereo_correlation requires one processor or use_frame_parallel_decomposition (the schemas communicate during the correlation)");
+#ifndef HAVE_TEUCHOS_THREAD_SAFE
+    if(concurrent_stereo){
+      *outStream << "Warning: Trilinos was not built with Teuchos_ENABLE_THREAD_SAFE, the stereo cameras will be correlated one after the other" << std::endl;
+      concurrent_stereo = false;
+    }
+#endif
+    if(concurrent_stereo)
+      *outStream << "Correlating the left and right cameras concurrently" << std::endl;
+
+    // optionally correlate each subset over a batch of frames before moving on to the next subset
+    // (the images of the whole batch are loaded and correlated at the first frame of the batch)
+    int_t batch_frames = input_params->get<int_t>(DICe::subset_major_batch_frames,0);
+    TEUCHOS_TEST_FOR_EXCEPTION(batch_frames<0,std::runtime_error,"Error, subset_major_batch_frames must be >= 0");
+    if(batch_frames>1&&(is_stereo||frame_parallel||checkpoint_frequency>0||!schema->supports_frame_batches())){
+      *outStream << "Warning: subset_major_batch_frames requires a single camera TRACKING_ROUTINE analysis with independent subsets, "
+          "one deformed image, no checkpoints and a field value, zero or optical flow initializer, the frames will be correlated one at a time" << std::endl;
+      batch_frames = 0;
+    }
+    if(batch_frames>1)
+      *outStream << "Correlating each subset over batches of " << batch_frames << " frames" << std::endl;
+    int_t batch_start = 0;
+    int_t batch_end = 0;
+    scalar_t batch_frame_time = 0.0;
+
+    for(int_t frame_it=0;frame_it<num_local_frames;++frame_it){
+      const int_t image_it = frame_list[frame_it];
+      Scoped_Trace_Span frame_span("frame","frame",image_it);
+      *outStream << "Processing frame: " << image_it << " of " << num_frames << ", " << image_files[image_it] <<
+          (frame_it<num_coarse_frames ? " (coarse pass initial guess)" : (output_frame[frame_it] ? "" : " (no output)")) << std::endl;
+      if(frame_parallel){
+        // the frames on this processor are not in sequence
+        schema->set_frame_id(first_frame_id+image_it-1);
+        if(is_stereo)
+          stereo_schema->set_frame_id(first_frame_id+image_it-1);
+      }
       if(schema->use_incremental_formulation()&&image_it>1){
         schema->set_ref_image(schema->def_img());
       }
-      schema->update_extents();
-      schema->set_def_image(image_files[image_it]);
+      if(batch_frames>1){
+        if(frame_it==batch_end){
+          batch_start = frame_it;
+          batch_end = std::min(frame_it+batch_frames,num_local_frames);
+          boost::timer batch_t;
+          for(int_t batch_it=batch_start;batch_it<batch_end;++batch_it){
+            schema->update_extents();
+            if(prefetcher!=Teuchos::null){
+              schema->def_image_region(image_width,image_height,region_x,region_y,region_w,region_h);
+              schema->set_def_image(prefetcher->next(region_x,region_y,region_w,region_h));
+              if(batch_it+num_prefetch<num_local_frames)
+                prefetcher->request(image_files[frame_list[batch_it+num_prefetch]],region_x,region_y,region_w,region_h);
+            }
+            else
+              schema->set_def_image(image_files[frame_list[batch_it]]);
+            schema->push_batch_frame();
+          }
+          if(schema->execute_correlation_batch())
+            failed_step = true;
+          // the time of the batch is spread over its frames
+          batch_frame_time = batch_t.elapsed()/(batch_end-batch_start);
+        }
+      }
+      else{
+        schema->update_extents();
+        if(prefetcher!=Teuchos::null){
+          schema->def_image_region(image_width,image_height,region_x,region_y,region_w,region_h);
+          schema->set_def_image(prefetcher->next(region_x,region_y,region_w,region_h));
+        }
+        else
+          schema->set_def_image(image_files[image_it]);
+      }
       if(is_stereo){
         if(stereo_schema->use_incremental_formulation()&&image_it>1){
           stereo_schema->set_ref_image(stereo_schema->def_img());
         }
         stereo_schema->update_extents();
-        stereo_schema->set_def_image(stereo_image_files[image_it]);
+        if(prefetcher!=Teuchos::null){
+          stereo_schema->def_image_region(stereo_image_width,stereo_image_height,region_x,region_y,region_w,region_h);
+          stereo_schema->set_def_image(prefetcher->next(region_x,region_y,region_w,region_h));
+        }
+        else
+          stereo_schema->set_def_image(stereo_image_files[image_it]);
         //if(stereo_schema->use_nonlinear_projection())
         //  stereo_schema->project_right_image_into_left_frame(triangulation,false);
       }
+      // queue the next frame so it loads while this one is correlated
+      if(prefetcher!=Teuchos::null&&batch_frames<=1&&frame_it+num_prefetch<num_local_frames){
+        schema->def_image_region(image_width,image_height,region_x,region_y,region_w,region_h);
+        prefetcher->request(image_files[frame_list[frame_it+num_prefetch]],region_x,region_y,region_w,region_h);
+        if(is_stereo){
+          stereo_schema->def_image_region(stereo_image_width,stereo_image_height,region_x,region_y,region_w,region_h);
+          prefetcher->request(stereo_image_files[frame_list[frame_it+num_prefetch]],region_x,region_y,region_w,region_h);
+        }
+      }
       { // start the timer
         boost::timer t;
 
-        int_t corr_error = schema->execute_correlation();
-        if(corr_error)
-          failed_step = true;
-        if(is_stereo){
-          corr_error = stereo_schema->execute_correlation();
-          if(corr_error)
+        if(batch_frames>1){
+          // the frame was correlated with the rest of its batch
+          schema->load_batch_frame(frame_it-batch_start);
+        }
+        else if(concurrent_stereo){
+          // the right camera is correlated on a second thread while this one correlates the left,
+          // the triangulation waits for both
+          int_t stereo_corr_error = 0;
+          std::exception_ptr stereo_exception;
+          std::thread stereo_thread([&](){
+            try{
+              stereo_corr_error = stereo_schema->execute_correlation();
+            }
+            catch(...){
+              stereo_exception = std::current_exception();
+            }
+          });
+          int_t corr_error = 0;
+          try{
+            corr_error = schema->execute_correlation();
+          }
+          catch(...){
+            stereo_thread.join();
+            throw;
+          }
+          stereo_thread.join();
+          if(stereo_exception)
+            std::rethrow_exception(stereo_exception);
+          if(corr_error||stereo_corr_error)
             failed_step = true;
           schema->execute_triangulation(triangulation,stereo_schema);
         }
-        schema->execute_post_processors();
+        else{
+          int_t corr_error = schema->execute_correlation();
+          if(corr_error)
+            failed_step = true;
+          if(is_stereo){
+            corr_error = stereo_schema->execute_correlation();
+            if(corr_error)
+              failed_step = true;
+            schema->execute_triangulation(triangulation,stereo_schema);
+          }
+        }
+        if(output_frame[frame_it])
+          schema->execute_post_processors();
         // timing info
-        elapsed_time = t.elapsed();
+        elapsed_time = t.elapsed() + (batch_frames>1 ? batch_frame_time : 0.0);
         if(elapsed_time>max_time)max_time = elapsed_time;
         if(elapsed_time<min_time)min_time = elapsed_time;
         corr_time += elapsed_time;
       }
-
-      // write the output
-      boost::timer write_t;
-      const bool no_text_output = input_params->get<bool>(DICe::no_text_output_files,false);
-      schema->write_output(output_folder,file_prefix,separate_output_file_for_each_subset,separate_header_file,no_text_output);
-      schema->post_execution_tasks();
-      // print the timing data with or without verbose flag
-      if(input_params->get<bool>(DICe::print_stats,false)){
-        schema->mesh()->print_field_stats();
-      }
-      //if(subset_info->conformal_area_defs!=Teuchos::null&&image_it==1){
-      //  schema->write_control_points_image("RegionOfInterest");
-      //}
-      if(is_stereo){
-        if(input_params->get<bool>(DICe::output_stereo_files,false)){
-          stereo_schema->write_output(output_folder,stereo_file_prefix,separate_output_file_for_each_subset,separate_header_file,no_text_output);
+      if(metrics!=Teuchos::null)
+        metrics->record_frame(schema.get(),elapsed_time,
+          prefetcher!=Teuchos::null ? prefetcher->num_pending() : 0,
+          output_writer!=Teuchos::null ? output_writer->num_pending() : 0);
+
+      // the coarse pass frames and the frames skipped by output_frequency only carry the solution forward
+      // (the post processors and the output are skipped but the correlation state is still updated)
+      if(output_frame[frame_it]){
+        // write the output
+        boost::timer write_t;
+        const bool no_text_output = input_params->get<bool>(DICe::no_text_output_files,false);
+        const bool binary_output = input_params->get<bool>(DICe::binary_output_files,false);
+        schema->write_output(output_folder,file_prefix,separate_output_file_for_each_subset,separate_header_file,no_text_output,binary_output);
+        schema->post_execution_tasks();
+        // print the timing data with or without verbose flag
+        if(input_params->get<bool>(DICe::print_stats,false)){
+          schema->mesh()->print_field_stats();
         }
-        stereo_schema->post_execution_tasks();
+        //if(subset_info->conformal_area_defs!=Teuchos::null&&image_it==1){
+        //  schema->write_control_points_image("RegionOfInterest");
+        //}
+        if(is_stereo){
+          if(input_params->get<bool>(DICe::output_stereo_files,false)){
+            stereo_schema->write_output(output_folder,stereo_file_prefix,separate_output_file_for_each_subset,separate_header_file,no_text_output,binary_output);
+          }
+          stereo_schema->post_execution_tasks();
+        }
+        write_time = write_t.elapsed();
+      }
+      else{
+        schema->post_execution_tasks();
+        if(is_stereo)
+          stereo_schema->post_execution_tasks();
+      }
+      if(checkpoint_frequency>0&&image_it%checkpoint_frequency==0&&image_it<num_frames){
+        // the output up to this frame has to be on disk before the checkpoint says the frame is done
+        if(output_writer!=Teuchos::null)
+          output_writer->flush();
+        schema->write_checkpoint(checkpoint_file,image_it);
+        if(is_stereo)
+          stereo_schema->write_checkpoint(stereo_checkpoint_file,image_it);
+      }
+      // move subsets off of the processors that took much longer than the others
+      if(rebalance_threshold>0.0&&image_it<num_frames&&schema->rebalance(rebalance_threshold)){
+        *outStream << "Rebalanced the subsets among the processors" << std::endl;
+        // the regions of the images each processor needs have changed
+        schema->update_extents();
+        if(schema->use_incremental_formulation())
+          schema->set_def_image(image_files[image_it]);
+        else
+          schema->set_ref_image(image_files[0]);
       }
-      write_time = write_t.elapsed();
+      record_memory();
     } // image loop
+    // write the last metrics sample
+    metrics = Teuchos::null;
+    // stop the background thread
+    prefetcher = Teuchos::null;
+    // finish writing the output
+    if(output_writer!=Teuchos::null)
+      output_writer->flush();
+
+    // the processors share the info file if the frames were split among them
+    if(!frame_parallel||proc_rank==0){
+      schema->write_stats(output_folder,file_prefix);
+      if(is_stereo)
+        stereo_schema->write_stats(output_folder,stereo_file_prefix);
+    }
 
-    schema->write_stats(output_folder,file_prefix);
-    if(is_stereo)
-      stereo_schema->write_stats(output_folder,stereo_file_prefix);
-
-    avg_time = corr_time / num_frames;
+    avg_time = num_local_frames > 0 ? corr_time / num_local_frames : 0.0;
 
     if(failed_step)
       *outStream << "\n--- Failed Step Occurred ---\n" << std::endl;
@@ -395,6 +858,23 @@ int main(int argc, char *argv[]) {
     fprintf(timeFile,"TOTAL CROSS_CORR CORR AVERAGE_PER_IMAGE MAX_PER_IMAGE MIN_PER_IMAGE WRITE\n");
     fprintf(timeFile,"%4.4E %4.4E %4.4E %4.4E %4.4E %4.4E %4.4E\n",total_time,cross_corr_time,corr_time,avg_time,max_time,min_time,write_time);
     fclose(timeFile);
+    // reduce the phase timers across the processors (collective)
+    if(print_phase_timing){
+      std::stringstream phase_file_name;
+      phase_file_name << output_folder << "timing_phases." << proc_size << ".json";
+      Profiler::report(std::cout,phase_file_name.str());
+    }
+    // reduce the memory usage across the processors (collective)
+    if(print_memory_usage)
+      Memory_Tracker::report(std::cout);
+    if(!trace_prefix.empty()){
+      Trace_Recorder::stop();
+      std::stringstream trace_file_name;
+      trace_file_name << trace_prefix << "." << proc_size << "." << proc_rank << ".json";
+      if(Trace_Recorder::num_dropped()>0)
+        std::cout << "Warning, " << Trace_Recorder::num_dropped() << " trace events were overwritten, increase " << DICe::trace_events_per_thread << std::endl;
+      Trace_Recorder::write(trace_file_name.str());
+    }
 
     DICe::finalize();
   }
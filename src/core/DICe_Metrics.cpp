@@ -0,0 +1,254 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_Metrics.h>
+#include <DICe_Schema.h>
+#include <DICe_ParameterUtilities.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace DICe {
+
+namespace {
+
+/// returns true if the string ends with the given suffix
+bool ends_with(const std::string & str,
+  const std::string & suffix){
+  return str.size()>=suffix.size() && str.compare(str.size()-suffix.size(),suffix.size(),suffix)==0;
+}
+
+/// ratio that is zero if the denominator is zero
+double safe_ratio(const double & num,
+  const double & den){
+  return den > 0.0 ? num/den : 0.0;
+}
+
+}
+
+Metrics_Sink::Metrics_Sink(const std::string & file_name,
+  const scalar_t & interval,
+  const int_t proc_rank):
+  file_name_(file_name),
+  prometheus_(ends_with(file_name,".prom")),
+  interval_(interval),
+  proc_rank_(proc_rank),
+  start_(std::chrono::steady_clock::now()),
+  last_sample_(start_),
+  num_samples_(0),
+  last_profile_fallbacks_(0),
+  last_profile_size_(-1){
+  TEUCHOS_TEST_FOR_EXCEPTION(file_name_.empty(),std::runtime_error,"Error, the metrics file name is empty");
+  TEUCHOS_TEST_FOR_EXCEPTION(interval_<0.0,std::runtime_error,"Error, the metrics interval cannot be negative");
+  if(!prometheus_){
+    // start a new file for each analysis, samples are appended from here on
+    std::ofstream file(file_name_.c_str(),std::ios::out|std::ios::trunc);
+    TEUCHOS_TEST_FOR_EXCEPTION(!file.is_open(),std::runtime_error,"Error, could not open the metrics file " << file_name_);
+  }
+}
+
+Metrics_Sink::~Metrics_Sink(){
+  if(window_.num_frames>0){
+    try{
+      write_sample();
+    }
+    catch(std::exception & e){
+      std::cerr << "Warning, the last metrics sample could not be written: " << e.what() << std::endl;
+    }
+  }
+}
+
+void
+Metrics_Sink::record_frame(const Frame_Metrics & frame){
+  TEUCHOS_TEST_FOR_EXCEPTION(frame.status_counts.size()!=(size_t)MAX_STATUS_FLAG,std::runtime_error,
+    "Error, the frame metrics need a count for each status flag");
+  Totals * totals[2] = {&totals_,&window_};
+  for(int_t t=0;t<2;++t){
+    totals[t]->num_frames++;
+    totals[t]->num_subsets += frame.num_subsets;
+    totals[t]->num_failed += frame.num_failed;
+    totals[t]->num_fallbacks += frame.num_fallbacks;
+    totals[t]->frame_time += frame.frame_time;
+    totals[t]->image_bytes += frame.image_bytes;
+    for(int_t i=0;i<MAX_STATUS_FLAG;++i)
+      totals[t]->status_counts[i] += frame.status_counts[i];
+  }
+  last_frame_ = frame;
+  const double since_sample = std::chrono::duration<double>(std::chrono::steady_clock::now()-last_sample_).count();
+  if(since_sample>=interval_)
+    write_sample();
+}
+
+void
+Metrics_Sink::record_frame(Schema * schema,
+  const scalar_t & frame_time,
+  const int_t prefetch_depth,
+  const int_t output_depth){
+  TEUCHOS_TEST_FOR_EXCEPTION(schema==NULL,std::runtime_error,"Error, the schema is null");
+  Frame_Metrics frame;
+  frame.frame_id = schema->frame_id();
+  frame.num_subsets = schema->local_num_subsets();
+  frame.frame_time = frame_time;
+  frame.prefetch_depth = prefetch_depth;
+  frame.output_depth = output_depth;
+  if(schema->def_img()!=Teuchos::null)
+    frame.image_bytes = (long long)schema->def_img()->width()*schema->def_img()->height()*sizeof(intensity_t);
+  for(int_t i=0;i<frame.num_subsets;++i){
+    const int_t status = (int_t)schema->local_field_value(i,DICe::field_enums::STATUS_FLAG_FS);
+    if(status>=0&&status<MAX_STATUS_FLAG)
+      frame.status_counts[status]++;
+    if(schema->local_field_value(i,DICe::field_enums::SIGMA_FS)<0.0)
+      frame.num_failed++;
+  }
+  // the subset profile is cumulative, so the fallbacks for this frame are the change since the last frame
+  Teuchos::RCP<Stat_Container> stats = schema->stat_container();
+  if(stats!=Teuchos::null){
+    long long fallbacks = 0;
+    for(int_t i=0;i<stats->subset_profile_size();++i)
+      fallbacks += stats->num_path_solves(i,SEARCH_INITIALIZATION_PATH) + stats->num_path_solves(i,BACKUP_OPTIMIZATION_PATH);
+    // the profile starts over if the subsets were redistributed
+    if(stats->subset_profile_size()!=last_profile_size_||fallbacks<last_profile_fallbacks_)
+      last_profile_fallbacks_ = 0;
+    frame.num_fallbacks = (int_t)(fallbacks - last_profile_fallbacks_);
+    last_profile_fallbacks_ = fallbacks;
+    last_profile_size_ = stats->subset_profile_size();
+  }
+  record_frame(frame);
+}
+
+void
+Metrics_Sink::write_sample(){
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const double elapsed = std::chrono::duration<double>(now-start_).count();
+  const double window_time = std::chrono::duration<double>(now-last_sample_).count();
+  const double frames_per_second = safe_ratio(window_.num_frames,window_time);
+  const double subsets_per_second = safe_ratio(window_.num_subsets,window_time);
+  const double failure_rate = safe_ratio(window_.num_failed,window_.num_subsets);
+  const double fallback_rate = safe_ratio(window_.num_fallbacks,window_.num_subsets);
+  const double bytes_per_second = safe_ratio(window_.image_bytes,window_time);
+  const double avg_frame_time = safe_ratio(window_.frame_time,window_.num_frames);
+
+  std::stringstream ss;
+  ss << std::setprecision(6);
+  if(prometheus_){
+    std::stringstream label;
+    label << "rank=\"" << proc_rank_ << "\"";
+    const std::string lbl = label.str();
+    ss << "# HELP dice_frames_total Frames correlated since the start of the analysis\n";
+    ss << "# TYPE dice_frames_total counter\n";
+    ss << "dice_frames_total{" << lbl << "} " << totals_.num_frames << "\n";
+    ss << "# HELP dice_subsets_total Subsets correlated since the start of the analysis\n";
+    ss << "# TYPE dice_subsets_total counter\n";
+    ss << "dice_subsets_total{" << lbl << "} " << totals_.num_subsets << "\n";
+    ss << "# HELP dice_subset_status_total Subsets correlated by status flag\n";
+    ss << "# TYPE dice_subset_status_total counter\n";
+    for(int_t i=0;i<MAX_STATUS_FLAG;++i){
+      if(totals_.status_counts[i]==0) continue;
+      ss << "dice_subset_status_total{" << lbl << ",status=\"" << to_string(static_cast<Status_Flag>(i)) << "\"} " << totals_.status_counts[i] << "\n";
+    }
+    ss << "# HELP dice_subset_failures_total Subsets that failed to correlate\n";
+    ss << "# TYPE dice_subset_failures_total counter\n";
+    ss << "dice_subset_failures_total{" << lbl << "} " << totals_.num_failed << "\n";
+    ss << "# HELP dice_subset_fallbacks_total Subsets that needed a search initialization or the backup optimization method\n";
+    ss << "# TYPE dice_subset_fallbacks_total counter\n";
+    ss << "dice_subset_fallbacks_total{" << lbl << "} " << totals_.num_fallbacks << "\n";
+    ss << "# HELP dice_image_bytes_total Bytes of image data loaded\n";
+    ss << "# TYPE dice_image_bytes_total counter\n";
+    ss << "dice_image_bytes_total{" << lbl << "} " << totals_.image_bytes << "\n";
+    ss << "# HELP dice_frames_per_second Frames per second since the previous sample\n";
+    ss << "# TYPE dice_frames_per_second gauge\n";
+    ss << "dice_frames_per_second{" << lbl << "} " << frames_per_second << "\n";
+    ss << "# HELP dice_subsets_per_second Subsets per second since the previous sample\n";
+    ss << "# TYPE dice_subsets_per_second gauge\n";
+    ss << "dice_subsets_per_second{" << lbl << "} " << subsets_per_second << "\n";
+    ss << "# HELP dice_failure_rate Fraction of subsets that failed since the previous sample\n";
+    ss << "# TYPE dice_failure_rate gauge\n";
+    ss << "dice_failure_rate{" << lbl << "} " << failure_rate << "\n";
+    ss << "# HELP dice_fallback_rate Fraction of subsets that needed a fallback since the previous sample\n";
+    ss << "# TYPE dice_fallback_rate gauge\n";
+    ss << "dice_fallback_rate{" << lbl << "} " << fallback_rate << "\n";
+    ss << "# HELP dice_image_bytes_per_second Image bytes loaded per second since the previous sample\n";
+    ss << "# TYPE dice_image_bytes_per_second gauge\n";
+    ss << "dice_image_bytes_per_second{" << lbl << "} " << bytes_per_second << "\n";
+    ss << "# HELP dice_prefetch_queue_depth Frames waiting in the image prefetcher\n";
+    ss << "# TYPE dice_prefetch_queue_depth gauge\n";
+    ss << "dice_prefetch_queue_depth{" << lbl << "} " << last_frame_.prefetch_depth << "\n";
+    ss << "# HELP dice_output_queue_depth Tasks waiting in the output writer\n";
+    ss << "# TYPE dice_output_queue_depth gauge\n";
+    ss << "dice_output_queue_depth{" << lbl << "} " << last_frame_.output_depth << "\n";
+    // write to a temporary file and rename it so a reader never sees a partial file
+    const std::string tmp_name = file_name_ + ".tmp";
+    {
+      std::ofstream file(tmp_name.c_str(),std::ios::out|std::ios::trunc);
+      TEUCHOS_TEST_FOR_EXCEPTION(!file.is_open(),std::runtime_error,"Error, could not open the metrics file " << tmp_name);
+      file << ss.str();
+    }
+    TEUCHOS_TEST_FOR_EXCEPTION(std::rename(tmp_name.c_str(),file_name_.c_str())!=0,std::runtime_error,
+      "Error, could not replace the metrics file " << file_name_);
+  }
+  else{
+    ss << "{\"time\":" << elapsed << ",\"rank\":" << proc_rank_ << ",\"frame\":" << last_frame_.frame_id
+       << ",\"frames\":" << totals_.num_frames << ",\"subsets\":" << totals_.num_subsets
+       << ",\"frames_per_second\":" << frames_per_second << ",\"subsets_per_second\":" << subsets_per_second
+       << ",\"avg_frame_time\":" << avg_frame_time << ",\"failure_rate\":" << failure_rate
+       << ",\"fallback_rate\":" << fallback_rate << ",\"image_bytes_per_second\":" << bytes_per_second
+       << ",\"prefetch_queue_depth\":" << last_frame_.prefetch_depth << ",\"output_queue_depth\":" << last_frame_.output_depth
+       << ",\"status\":{";
+    bool first = true;
+    for(int_t i=0;i<MAX_STATUS_FLAG;++i){
+      if(window_.status_counts[i]==0) continue;
+      ss << (first?"":",") << "\"" << to_string(static_cast<Status_Flag>(i)) << "\":" << window_.status_counts[i];
+      first = false;
+    }
+    ss << "}}\n";
+    std::ofstream file(file_name_.c_str(),std::ios::out|std::ios::app);
+    TEUCHOS_TEST_FOR_EXCEPTION(!file.is_open(),std::runtime_error,"Error, could not open the metrics file " << file_name_);
+    file << ss.str();
+  }
+  window_ = Totals();
+  last_sample_ = now;
+  num_samples_++;
+}
+
+}// End DICe Namespace
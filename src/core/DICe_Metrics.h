@@ -0,0 +1,192 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#ifndef DICE_METRICS_H
+#define DICE_METRICS_H
+
+#include <DICe.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+// forward declaration of the schema
+class Schema;
+
+/// the values recorded for one frame
+struct DICE_LIB_DLL_EXPORT
+Frame_Metrics{
+  /// constructor
+  Frame_Metrics():
+    frame_id(-1),
+    num_subsets(0),
+    num_failed(0),
+    num_fallbacks(0),
+    frame_time(0.0),
+    image_bytes(0),
+    prefetch_depth(0),
+    output_depth(0),
+    status_counts(MAX_STATUS_FLAG,0){}
+  /// the frame id
+  int_t frame_id;
+  /// the number of subsets correlated
+  int_t num_subsets;
+  /// the number of subsets that failed (sigma of -1)
+  int_t num_failed;
+  /// the number of subsets that needed a search initialization or the backup optimization method
+  int_t num_fallbacks;
+  /// the correlation time of the frame in seconds
+  scalar_t frame_time;
+  /// the number of bytes of image data loaded for the frame
+  long long image_bytes;
+  /// the number of frames waiting in the prefetcher
+  int_t prefetch_depth;
+  /// the number of tasks waiting in the output writer
+  int_t output_depth;
+  /// the number of subsets with each Status_Flag
+  std::vector<int_t> status_counts;
+};
+
+/// \class DICe::Metrics_Sink
+/// \brief Periodically writes the throughput and failure rates of a running analysis to a file
+///
+/// If the file name ends in .prom the file is rewritten in the Prometheus text format every sample
+/// (for example for the node exporter textfile collector), otherwise one json object per sample is
+/// appended to the file. The rates of each sample cover the frames since the previous sample.
+class DICE_LIB_DLL_EXPORT
+Metrics_Sink
+{
+public:
+  /// \brief constructor
+  /// \param file_name the name of the metrics file
+  /// \param interval the minimum number of seconds between samples (0 writes a sample for every frame)
+  /// \param proc_rank the processor id reported with the metrics
+  Metrics_Sink(const std::string & file_name,
+    const scalar_t & interval=10.0,
+    const int_t proc_rank=0);
+
+  /// destructor (writes a last sample if any frames were recorded since the previous one)
+  virtual ~Metrics_Sink();
+
+  /// \brief record a frame and write a sample if the interval has passed
+  /// \param frame the values for the frame
+  void record_frame(const Frame_Metrics & frame);
+
+  /// \brief gather the values of the frame just correlated by a schema and record them
+  /// \param schema the schema (the local subsets of this processor are counted)
+  /// \param frame_time the correlation time of the frame in seconds
+  /// \param prefetch_depth the number of frames waiting in the prefetcher
+  /// \param output_depth the number of tasks waiting in the output writer
+  void record_frame(Schema * schema,
+    const scalar_t & frame_time,
+    const int_t prefetch_depth,
+    const int_t output_depth);
+
+  /// write a sample now
+  void write_sample();
+
+  /// returns the number of samples written
+  int_t num_samples()const{
+    return num_samples_;
+  }
+
+private:
+  /// not copyable
+  Metrics_Sink(const Metrics_Sink &);
+  /// not assignable
+  Metrics_Sink & operator=(const Metrics_Sink &);
+
+  /// the counters accumulated over a number of frames
+  struct Totals{
+    Totals():
+      num_frames(0),
+      num_subsets(0),
+      num_failed(0),
+      num_fallbacks(0),
+      frame_time(0.0),
+      image_bytes(0),
+      status_counts(MAX_STATUS_FLAG,0){}
+    long long num_frames;
+    long long num_subsets;
+    long long num_failed;
+    long long num_fallbacks;
+    double frame_time;
+    long long image_bytes;
+    std::vector<long long> status_counts;
+  };
+
+  /// name of the metrics file
+  const std::string file_name_;
+  /// true if the file is written in the Prometheus text format
+  const bool prometheus_;
+  /// minimum time between samples
+  const double interval_;
+  /// processor id
+  const int_t proc_rank_;
+  /// counters since the start of the analysis
+  Totals totals_;
+  /// counters since the last sample
+  Totals window_;
+  /// the last frame recorded
+  Frame_Metrics last_frame_;
+  /// time the sink was created
+  std::chrono::steady_clock::time_point start_;
+  /// time of the last sample
+  std::chrono::steady_clock::time_point last_sample_;
+  /// number of samples written
+  int_t num_samples_;
+  /// the number of fallbacks in the schema's subset profile at the last frame
+  long long last_profile_fallbacks_;
+  /// the number of subsets in the schema's subset profile at the last frame
+  int_t last_profile_size_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
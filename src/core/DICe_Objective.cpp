@@ -42,12 +42,14 @@
 #include <DICe_Objective.h>
 #include <DICe_ImageUtils.h>
 #include <DICe_Simplex.h>
+#include <DICe_Profiler.h>
 
 #include <Teuchos_LAPACK.hpp>
 #include <Teuchos_SerialDenseMatrix.hpp>
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 #include <cassert>
 
@@ -55,8 +57,18 @@ namespace DICe {
 
 using namespace field_enums;
 
+/// perturbation size and scale factor in u, v, and theta used to compute beta
+const scalar_t beta_epsilon[3] = {1.0E-1,1.0E-1,1.0E-1};
+const scalar_t beta_factor[3] = {1.0E-3,1.0E-3,1.0E-1};
+
 scalar_t
 Objective::gamma( Teuchos::RCP<Local_Shape_Function> shape_function) const {
+  return gamma(shape_function,schema_->normalize_gamma_with_active_pixels());
+}
+
+scalar_t
+Objective::gamma( Teuchos::RCP<Local_Shape_Function> shape_function,
+  const bool normalize_with_active_pixels) const {
   try{
     subset_->initialize(schema_->def_img(subset_->sub_image_id()),DEF_INTENSITIES,shape_function,schema_->interpolation_method());
   }
@@ -64,7 +76,7 @@ Objective::gamma( Teuchos::RCP<Local_Shape_Function> shape_function) const {
     return -1.0;
   }
   scalar_t gamma = subset_->gamma();
-  if(schema_->normalize_gamma_with_active_pixels()){
+  if(normalize_with_active_pixels){
     int_t num_active_pixels = 0;
     for(int_t i=0;i<subset_->num_pixels();++i)
       if(subset_->is_active(i)) num_active_pixels++;
@@ -74,23 +86,44 @@ Objective::gamma( Teuchos::RCP<Local_Shape_Function> shape_function) const {
   return gamma;
 }
 
+void
+Objective::batch_gamma(const int_t num_functions,
+  const Teuchos::RCP<Local_Shape_Function> * shape_functions,
+  scalar_t * gamma_values,
+  const int_t num_threads) const {
+  try{
+    subset_->batch_gamma(schema_->def_img(subset_->sub_image_id()),num_functions,shape_functions,gamma_values,
+      schema_->interpolation_method(),num_threads);
+  }
+  catch (std::logic_error & err) {
+    for(int_t i=0;i<num_functions;++i)
+      gamma_values[i] = -1.0;
+    return;
+  }
+  if(schema_->normalize_gamma_with_active_pixels()){
+    int_t num_active_pixels = 0;
+    for(int_t i=0;i<subset_->num_pixels();++i)
+      if(subset_->is_active(i)) num_active_pixels++;
+    if(num_active_pixels > 0)
+      for(int_t i=0;i<num_functions;++i)
+        gamma_values[i] /= num_active_pixels;
+  }
+}
+
 scalar_t
 Objective::beta(Teuchos::RCP<Local_Shape_Function> shape_function) const {
   // for now return -1 for beta if affine shape functions are used
 
+  // use the estimate from the converged Hessian if the gradient based solver produced one
+  if(has_analytic_beta_){
+    DEBUG_MSG("Objective::beta(): return value (from the Hessian) " << analytic_beta_);
+    return analytic_beta_;
+  }
   // for beta we don't want the gamma values normalized by the number of pixels:
-  const bool original_normalize_flag = schema_->normalize_gamma_with_active_pixels();
-  schema_->set_normalize_gamma_with_active_pixels(false);
-  std::vector<scalar_t> epsilon(3);
-  epsilon[0] = 1.0E-1;
-  epsilon[1] = 1.0E-1;
-  epsilon[2] = 1.0E-1;
-  std::vector<scalar_t> factor(3);
-  factor[0] = 1.0E-3;
-  factor[1] = 1.0E-3;
-  factor[2] = 1.0E-1;
+  const scalar_t * epsilon = beta_epsilon;
+  const scalar_t * factor = beta_factor;
   scalar_t temp_u=0.0,temp_v=0.0,temp_t=0.0;
-  const scalar_t gamma_0 = gamma(shape_function);
+  const scalar_t gamma_0 = gamma(shape_function,false);
   std::vector<scalar_t> dir_beta(3,0.0);
   Teuchos::RCP<Local_Shape_Function> temp_lsf = shape_function_factory(schema_);
   for(size_t i=0;i<3;++i){
@@ -105,7 +138,7 @@ Objective::beta(Teuchos::RCP<Local_Shape_Function> shape_function) const {
       temp_t += epsilon[i];
     }
     temp_lsf->insert_motion(temp_u,temp_v,temp_t);
-    const scalar_t gamma_p = gamma(temp_lsf);
+    const scalar_t gamma_p = gamma(temp_lsf,false);
     if(i==0){
       temp_u -= 2*epsilon[i];
     }else if(i==1){
@@ -115,12 +148,10 @@ Objective::beta(Teuchos::RCP<Local_Shape_Function> shape_function) const {
     }
     temp_lsf->insert_motion(temp_u,temp_v,temp_t);
     // mod the def vector -
-    const scalar_t gamma_m = gamma(temp_lsf);
+    const scalar_t gamma_m = gamma(temp_lsf,false);
     if(std::abs(gamma_m - gamma_0)<1.0E-10||std::abs(gamma_p - gamma_0)<1.0E-10){
       // abort because the slope is so bad that beta is infinite
       DEBUG_MSG("Objective::beta(): return value -1.0");
-      // replace the correct normalization flag:
-      schema_->set_normalize_gamma_with_active_pixels(original_normalize_flag);
       // re-initialize the subset with the original deformation solution
       subset_->initialize(schema_->def_img(subset_->sub_image_id()),DEF_INTENSITIES,shape_function,schema_->interpolation_method());
       return -1.0;
@@ -138,14 +169,53 @@ Objective::beta(Teuchos::RCP<Local_Shape_Function> shape_function) const {
   mag_dir_beta = std::sqrt(mag_dir_beta);
   DEBUG_MSG("Objective::beta(): return value " << mag_dir_beta);
 
-  // replace the correct normalization flag:
-  schema_->set_normalize_gamma_with_active_pixels(original_normalize_flag);
-
   // re-initialize the subset with the original deformation solution
   subset_->initialize(schema_->def_img(subset_->sub_image_id()),DEF_INTENSITIES,shape_function,schema_->interpolation_method());
   return mag_dir_beta;
 }
 
+void
+Objective::computeAnalyticBeta(const scalar_t & h_uu,
+  const scalar_t & h_vv,
+  const scalar_t * gx,
+  const scalar_t * gy){
+  has_analytic_beta_ = false;
+  scalar_t norm_ref = 0.0;
+  subset_->mean(REF_INTENSITIES,norm_ref);
+  scalar_t norm_def = 0.0;
+  subset_->mean(DEF_INTENSITIES,norm_def);
+  if(norm_ref==0.0||norm_def==0.0) return;
+  // the rotation curvature is not part of the Hessian for every shape function so it is
+  // accumulated here from the rotation about the centroid
+  accumulate_t h_tt = 0.0;
+  if(schema_->rotation_enabled()){
+    const scalar_t cx = subset_->centroid_x();
+    const scalar_t cy = subset_->centroid_y();
+    for(int_t i=0;i<subset_->num_pixels();++i){
+      if(!subset_->is_active(i) || subset_->is_deactivated_this_step(i)) continue;
+      const accumulate_t r_t = (accumulate_t)gy[i]*(subset_->x(i)-cx) - (accumulate_t)gx[i]*(subset_->y(i)-cy);
+      h_tt += r_t*r_t;
+    }
+  }
+  // near the minimum gamma(p +/- epsilon) - gamma(p) ~ h epsilon^2 / (|F||G|) in each direction
+  // so the slopes can be formed the same way as the finite difference estimate in beta()
+  const scalar_t h[3] = {h_uu,h_vv,static_cast<scalar_t>(h_tt)};
+  scalar_t mag_dir_beta = 0.0;
+  for(int_t i=0;i<3;++i){
+    if(!schema_->rotation_enabled()&&i==2) continue;
+    const scalar_t delta_gamma = h[i]*beta_epsilon[i]*beta_epsilon[i]/(norm_ref*norm_def);
+    if(delta_gamma<1.0E-10){
+      analytic_beta_ = -1.0;
+      has_analytic_beta_ = true;
+      return;
+    }
+    const scalar_t dir_beta = beta_epsilon[i]/delta_gamma*beta_factor[i];
+    mag_dir_beta += dir_beta*dir_beta;
+  }
+  analytic_beta_ = std::sqrt(mag_dir_beta);
+  has_analytic_beta_ = true;
+}
+
 scalar_t
 Objective::sigma( Teuchos::RCP<Local_Shape_Function> shape_function,
   scalar_t & noise_level) const {
@@ -153,15 +223,16 @@ Objective::sigma( Teuchos::RCP<Local_Shape_Function> shape_function,
   if(!subset_->has_gradients())
     return 0.0;
 
-  // compute the noise std dev. of the image:
-  noise_level = subset_->noise_std_dev(schema_->def_img(subset_->sub_image_id()),shape_function);
+  // compute the noise std dev. of the image (if it is not reported sigma is only used to flag failed
+  // subsets so a unit noise level is used):
+  noise_level = schema_->compute_noise_level() ? subset_->noise_std_dev(schema_->def_img(subset_->sub_image_id()),shape_function) : 1.0;
   // sum up the grads in x and y:
-  scalar_t sum_gx = 0.0;
-  scalar_t sum_gy = 0.0;
+  accumulate_t sum_gx = 0.0;
+  accumulate_t sum_gy = 0.0;
   for(int_t i=0;i<subset_->num_pixels();++i){
     if(!subset_->is_active(i) || subset_->is_deactivated_this_step(i)) continue;
-    sum_gx += subset_->grad_x(i)*subset_->grad_x(i);
-    sum_gy += subset_->grad_y(i)*subset_->grad_y(i);
+    sum_gx += (accumulate_t)subset_->grad_x(i)*subset_->grad_x(i);
+    sum_gy += (accumulate_t)subset_->grad_y(i)*subset_->grad_y(i);
   }
   const scalar_t sum_grad = sum_gx > sum_gy ? sum_gy : sum_gx;
   // ensure that sum grad is greater than zero
@@ -170,110 +241,134 @@ Objective::sigma( Teuchos::RCP<Local_Shape_Function> shape_function,
   return sigma;
 }
 
+Status_Flag
+Objective::acceptConvergedSolution(Teuchos::RCP<Local_Shape_Function> shape_function,
+  const std::vector<scalar_t> & parameters){
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t)parameters.size()!=shape_function->num_params(),std::runtime_error,
+    "Error, the solution has the wrong number of parameters for the shape function");
+  for(int_t i=0;i<shape_function->num_params();++i)
+    (*shape_function)(i) = parameters[i];
+  has_analytic_beta_ = false;
+  has_gradient_moments_ = false;
+  DEBUG_MSG("Subset " << correlation_point_global_id_ << " ** ACCEPTED SOLUTION ");
+  shape_function->print_parameters();
+  computeUncertaintyFields(shape_function);
+  return CORRELATION_SUCCESSFUL;
+}
+
+void
+Objective::computeGradientMoments(const scalar_t * gx,
+  const scalar_t * gy){
+  accumulate_t sum_xx = 0.0;
+  accumulate_t sum_xy = 0.0;
+  accumulate_t sum_yy = 0.0;
+  accumulate_t sum_grad_2 = 0.0;
+  for(int_t i=0;i<subset_->num_pixels();++i){
+    const accumulate_t gx_i = gx[i];
+    const accumulate_t gy_i = gy[i];
+    const accumulate_t mag_grad_phi_2 = gx_i*gx_i + gy_i*gy_i;
+    const accumulate_t one_over_mag_grad_phi_2 = mag_grad_phi_2 < 1.0E-4 ? 0.0 : 1.0 / mag_grad_phi_2;
+    sum_xx += gx_i*gx_i*one_over_mag_grad_phi_2;
+    sum_xy += gx_i*gy_i*one_over_mag_grad_phi_2;
+    sum_yy += gy_i*gy_i*one_over_mag_grad_phi_2;
+    sum_grad_2 += mag_grad_phi_2;
+  }
+  gradient_moments_[0] = sum_xx;
+  gradient_moments_[1] = sum_xy;
+  gradient_moments_[2] = sum_yy;
+  gradient_moments_[3] = sum_grad_2;
+  has_gradient_moments_ = true;
+}
+
 void
 Objective::computeUncertaintyFields(Teuchos::RCP<Local_Shape_Function> shape_function){
 
   if(correlation_point_global_id_<0)return;
 
-  scalar_t norm_ut_2 = 0.0;
-  scalar_t norm_uhat_2 = 0.0;
-  scalar_t norm_error_dot_gphi_2 = 0.0;
-  scalar_t norm_error_dot_jgphi_2 = 0.0;
-  scalar_t norm_ut_dot_gphi_2 = 0.0;
-  scalar_t norm_uhat_dot_gphi_2 = 0.0;
-
-  scalar_t int_r_total_2 = 0.0;
-  //scalar_t int_r_exact_2 = 0.0;
-  scalar_t int_uhat_dot_g = 0.0;
-  scalar_t int_uhat_dot_jg = 0.0;
-
-  scalar_t sssig = 1.0;
+  // the gradient sums are usually accumulated by the solver while the gradients are in cache
+  if(!has_gradient_moments_)
+    computeGradientMoments(subset_->grad_x_array().getRawPtr(),subset_->grad_y_array().getRawPtr());
+  const accumulate_t sum_xx = gradient_moments_[0];
+  const accumulate_t sum_xy = gradient_moments_[1];
+  const accumulate_t sum_yy = gradient_moments_[2];
 
   scalar_t u = 0.0;
   scalar_t v = 0.0;
   scalar_t t = 0.0;
-  const scalar_t cx = schema_->global_field_value(correlation_point_global_id_,SUBSET_COORDINATES_X_FS);
-  const scalar_t cy = schema_->global_field_value(correlation_point_global_id_,SUBSET_COORDINATES_Y_FS);
+  const scalar_t cx = subset_->centroid_x();
+  const scalar_t cy = subset_->centroid_y();
   shape_function->map_to_u_v_theta(cx,cy,u,v,t);
-  const bool has_image_deformer = schema_->image_deformer()!=Teuchos::null;
-  // put the exact solution into the n minus 1 field in case it didn't get populated by an image deformer
-  if(has_image_deformer){
+  const int_t num_pixels = subset_->num_pixels();
+
+  // uhat is constant over the subset so its norms follow from the gradient sums
+  const scalar_t norm_uhat_2 = num_pixels*(u*u + v*v);
+  const scalar_t norm_uhat_dot_gphi_2 = u*u*sum_xx + 2.0*u*v*sum_xy + v*v*sum_yy;
+  scalar_t norm_ut_2 = 0.0;
+  scalar_t norm_ut_dot_gphi_2 = 0.0;
+  // without an exact solution the error is uhat itself
+  scalar_t norm_error_dot_gphi_2 = norm_uhat_dot_gphi_2;
+  scalar_t norm_error_dot_jgphi_2 = v*v*sum_xx - 2.0*u*v*sum_xy + u*u*sum_yy;
+  scalar_t int_r_total_2 = 0.0;
+  const scalar_t sssig = (1.0 + gradient_moments_[3]) / (num_pixels==0?1.0:num_pixels);
+
+  // the exact error estimates need the image deformer and interpolated intensities for each pixel
+  // so the subset is only walked again for synthetic images
+  Teuchos::RCP<Image_Deformer> image_deformer = schema_->image_deformer();
+  if(image_deformer!=Teuchos::null){
     scalar_t exact_u = 0.0;
     scalar_t exact_v = 0.0;
-    schema_->image_deformer()->compute_deformation(cx,cy,exact_u,exact_v);
-    schema_->mesh()->get_field(DICe::field_enums::MODEL_DISPLACEMENT_X_FS)->global_value(correlation_point_global_id_) = exact_u;
-    schema_->mesh()->get_field(DICe::field_enums::MODEL_DISPLACEMENT_Y_FS)->global_value(correlation_point_global_id_) = exact_v;
+    image_deformer->compute_deformation(cx,cy,exact_u,exact_v);
+    // put the exact solution into the model displacement fields
+    schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::MODEL_DISPLACEMENT_X_FS) = exact_u;
+    schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::MODEL_DISPLACEMENT_Y_FS) = exact_v;
     // field 8: subset error at center in x direction
-    schema_->mesh()->get_field(DICe::field_enums::FIELD_8_FS)->global_value(correlation_point_global_id_) = std::abs(exact_u - u);
-    // field 9: subset error at center in x direction
-    schema_->mesh()->get_field(DICe::field_enums::FIELD_9_FS)->global_value(correlation_point_global_id_) = std::abs(exact_v - v);
-  }
-
-  for(int_t i=0;i<subset_->num_pixels();++i){
-    scalar_t x = subset_->x(i);
-    scalar_t y = subset_->y(i);
-    const int_t offset_x = schema_->ref_img()->offset_x();
-    const int_t offset_y = schema_->ref_img()->offset_y();
-    scalar_t bx = 0.0;
-    scalar_t by = 0.0;
-    if(has_image_deformer)
-      schema_->image_deformer()->compute_deformation(x,y,bx,by); // x and y should not be offset since they are global pixel coordinates
-    scalar_t gx = subset_->grad_x(i);
-    scalar_t gy = subset_->grad_y(i);
-    //scalar_t lap = schema_->ref_img()->laplacian(x-offset_x,y-offset_y);
-    sssig += gx*gx + gy*gy;
-
-    scalar_t mag_ut_2 = bx*bx + by*by;
-    //scalar_t one_over_mag_ut_2 = mag_ut_2 == 0.0 ? 0.0 : 1.0/mag_ut_2;
-    norm_ut_2 += mag_ut_2;
-    scalar_t mag_uhat_2 = u*u + v*v;
-    //scalar_t one_over_mag_uhat_2 = mag_uhat_2 == 0.0 ? 0.0 : 1.0/mag_uhat_2;
-    norm_uhat_2 += mag_uhat_2;
-    //norm_error_2 += (bx - u)*(bx - u) + (by - v)*(by - v);
-    scalar_t one_over_mag_grad_phi_2 = gx*gx + gy*gy < 1.0E-4 ? 0.0: 1.0 / (gx*gx + gy*gy);
-    norm_ut_dot_gphi_2 += (bx*gx + by*gy)*(bx*gx + by*gy)*one_over_mag_grad_phi_2;
-    //norm_ut_dot_jgphi_2 += (bx*-1.0*gy + by*gx)*(bx*-1.0*gy + by*gx)*one_over_mag_grad_phi_2;
-    norm_uhat_dot_gphi_2 += (u*gx + v*gy)*(u*gx + v*gy)*one_over_mag_grad_phi_2;
-    norm_error_dot_gphi_2 += ((u-bx)*gx + (v-by)*gy)*((u-bx)*gx + (v-by)*gy)*one_over_mag_grad_phi_2;
-    norm_error_dot_jgphi_2 += ((v-by)*gx - (u-bx)*gy)*((v-by)*gx - (u-bx)*gy)*one_over_mag_grad_phi_2;
-
-    scalar_t sub_r = schema_->def_img()->interpolate_keys_fourth(x - offset_x + u,y - offset_y + v) - (*schema_->ref_img())((int_t)(x-offset_x),(int_t)(y-offset_y));
-    //int_r += sig*sig*lap*lap*one_over_mag_grad_phi_2;
-    //scalar_t taylor = (*schema_->def_img())((int_t)(x-offset_x),(int_t)(y-offset_y)) - (*schema_->ref_img())((int_t)(x-offset_x),(int_t)(y-offset_y)) + u*gx + v*gy;
-    //int_sub_r += sub_r*sub_r*one_over_mag_grad_phi_2;
-    scalar_t sub_r_exact = schema_->def_img()->interpolate_keys_fourth(x-offset_x + bx,y-offset_y + by) - (*schema_->ref_img())((int_t)(x-offset_x),(int_t)(y-offset_y));
-    //int_r_exact_2 += sub_r_exact*sub_r_exact*one_over_mag_grad_phi_2;
-    int_r_total_2 += (sub_r - sub_r_exact)*(sub_r - sub_r_exact)*one_over_mag_grad_phi_2;
-    int_uhat_dot_g += (u*gx + v*gy)/std::sqrt(gx*gx + gy*gy);
-    int_uhat_dot_jg += (-1.0*u*gy + v*gx);
+    schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_8_FS) = std::abs(exact_u - u);
+    // field 9: subset error at center in y direction
+    schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_9_FS) = std::abs(exact_v - v);
+
+    Teuchos::RCP<Image> ref_img = schema_->ref_img();
+    Teuchos::RCP<Image> def_img = schema_->def_img();
+    const int_t offset_x = ref_img->offset_x();
+    const int_t offset_y = ref_img->offset_y();
+    norm_error_dot_gphi_2 = 0.0;
+    norm_error_dot_jgphi_2 = 0.0;
+    for(int_t i=0;i<num_pixels;++i){
+      const scalar_t x = subset_->x(i);
+      const scalar_t y = subset_->y(i);
+      scalar_t bx = 0.0;
+      scalar_t by = 0.0;
+      image_deformer->compute_deformation(x,y,bx,by); // x and y should not be offset since they are global pixel coordinates
+      const scalar_t gx = subset_->grad_x(i);
+      const scalar_t gy = subset_->grad_y(i);
+      const scalar_t one_over_mag_grad_phi_2 = gx*gx + gy*gy < 1.0E-4 ? 0.0: 1.0 / (gx*gx + gy*gy);
+      norm_ut_2 += bx*bx + by*by;
+      norm_ut_dot_gphi_2 += (bx*gx + by*gy)*(bx*gx + by*gy)*one_over_mag_grad_phi_2;
+      norm_error_dot_gphi_2 += ((u-bx)*gx + (v-by)*gy)*((u-bx)*gx + (v-by)*gy)*one_over_mag_grad_phi_2;
+      norm_error_dot_jgphi_2 += ((v-by)*gx - (u-bx)*gy)*((v-by)*gx - (u-bx)*gy)*one_over_mag_grad_phi_2;
+      // the reference intensity cancels in the difference of the residuals for uhat and the exact motion
+      const scalar_t sub_r = def_img->interpolate_keys_fourth(x - offset_x + u,y - offset_y + v);
+      const scalar_t sub_r_exact = def_img->interpolate_keys_fourth(x - offset_x + bx,y - offset_y + by);
+      int_r_total_2 += (sub_r - sub_r_exact)*(sub_r - sub_r_exact)*one_over_mag_grad_phi_2;
+    }
   }
-  sssig /= subset_->num_pixels()==0.0?1.0:subset_->num_pixels();
 
   // populate the fields:
   // field 1: cos of angle between uhat and grad phi
   const scalar_t cos_theta_hat = norm_uhat_2 == 0.0 ? 1.0 : std::sqrt(norm_uhat_dot_gphi_2/norm_uhat_2);
-  schema_->mesh()->get_field(DICe::field_enums::FIELD_1_FS)->global_value(correlation_point_global_id_) = cos_theta_hat;
+  schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_1_FS) = cos_theta_hat;
   // field 2: cos of angle between the true motion and grad phi
   const scalar_t cos_theta = norm_ut_2 == 0.0 ? 1.0 : std::sqrt(norm_ut_dot_gphi_2/norm_ut_2);
-  schema_->mesh()->get_field(DICe::field_enums::FIELD_2_FS)->global_value(correlation_point_global_id_) = cos_theta;
+  schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_2_FS) = cos_theta;
   // field 3: the total L2 error magnitude:
-  schema_->mesh()->get_field(DICe::field_enums::FIELD_3_FS)->global_value(correlation_point_global_id_) = std::sqrt(norm_error_dot_gphi_2 + norm_error_dot_jgphi_2);
+  schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_3_FS) = std::sqrt(norm_error_dot_gphi_2 + norm_error_dot_jgphi_2);
   // field 4: residual based exact error estimate in the direction of grad phi
-  schema_->mesh()->get_field(DICe::field_enums::FIELD_4_FS)->global_value(correlation_point_global_id_) = cos_theta_hat==0.0?0.0:1.0/cos_theta_hat * std::sqrt(int_r_total_2);
+  schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_4_FS) = cos_theta_hat==0.0?0.0:1.0/cos_theta_hat * std::sqrt(int_r_total_2);
   // field 5: the L2 error mag in direction of grad phi:
-  schema_->mesh()->get_field(DICe::field_enums::FIELD_5_FS)->global_value(correlation_point_global_id_) = std::sqrt(norm_error_dot_gphi_2);
+  schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_5_FS) = std::sqrt(norm_error_dot_gphi_2);
   // field 6: residual based exact error estimate in the direction of grad phi
-  schema_->mesh()->get_field(DICe::field_enums::FIELD_6_FS)->global_value(correlation_point_global_id_) = std::sqrt(int_r_total_2);
+  schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_6_FS) = std::sqrt(int_r_total_2);
   // field 7: SSSIG field
-  schema_->mesh()->get_field(DICe::field_enums::FIELD_7_FS)->global_value(correlation_point_global_id_) = sssig;
-// field 8: cos of angle between the error and grad phi
-//  schema_->mesh()->get_field(DICe::field_enums::FIELD_8_FS)->global_value(correlation_point_global_id_) = std::sqrt(norm_error_dot_gphi_2/norm_error_2);
-//  // field 9: cos of angle between ut and uhat
-//  schema_->mesh()->get_field(DICe::field_enums::FIELD_9_FS)->global_value(correlation_point_global_id_) = std::sqrt(norm_ut_dot_uhat_2/norm_ut_2);
-//  // field 10: cos of angle between ut and grad_phi
-//  schema_->mesh()->get_field(DICe::field_enums::FIELD_10_FS)->global_value(correlation_point_global_id_) = std::sqrt(int_r_total_2);
-//  // field 10: cos of angle between error and ut
-//  schema_->mesh()->get_field(DICe::field_enums::FIELD_10_FS)->global_value(correlation_point_global_id_) = std::sqrt(int_sub_r_approx);
+  schema_->global_field_value(correlation_point_global_id_,DICe::field_enums::FIELD_7_FS) = sssig;
 }
 
 Status_Flag
@@ -281,15 +376,22 @@ Objective::computeUpdateRobust(Teuchos::RCP<Local_Shape_Function> shape_function
   int_t & num_iterations,
   const scalar_t & override_tol){
 
+  Scoped_Profile_Timer simplex_timer(PROFILE_SIMPLEX);
+  // the simplex has no Hessian so beta falls back to finite differences
+  has_analytic_beta_ = false;
+  has_gradient_moments_ = false;
   const scalar_t skip_threshold = override_tol==-1 ? schema_->skip_solve_gamma_threshold() : override_tol;
 
   Status_Flag status_flag;
-  Teuchos::RCP<Teuchos::ParameterList> params = rcp(new Teuchos::ParameterList());
-  params->set(DICe::max_iterations,  schema_->max_solver_iterations_robust());
-  params->set(DICe::tolerance, schema_->robust_solver_tolerance());
-  DICe::Subset_Simplex simplex(this,params);
+  if(simplex_==Teuchos::null)
+    simplex_ = Teuchos::rcp(new DICe::Subset_Simplex(this,schema_->max_solver_iterations_robust(),schema_->robust_solver_tolerance()));
+  else{
+    simplex_->set_max_iterations(schema_->max_solver_iterations_robust());
+    simplex_->set_tolerance(schema_->robust_solver_tolerance());
+  }
+  simplex_->set_num_threads(schema_->num_threads());
   try{
-    status_flag = simplex.minimize(shape_function,num_iterations,skip_threshold);
+    status_flag = simplex_->minimize(shape_function,num_iterations,skip_threshold);
   }
   catch (std::logic_error &err) {
     return CORRELATION_FAILED;
@@ -297,28 +399,133 @@ Objective::computeUpdateRobust(Teuchos::RCP<Local_Shape_Function> shape_function
   return status_flag;
 }
 
+/// \brief Scratch storage for the Gauss-Newton iteration in Objective_ZNSSD::computeUpdateFast()
+///
+/// One of these is kept per thread and reused for every subset so the inner iteration is allocation free.
+/// The storage is only reallocated if the number of shape function parameters changes.
+struct Gauss_Newton_Workspace{
+  Gauss_Newton_Workspace():
+    num_params(0){}
+  /// size the storage for N degrees of freedom
+  void resize(const int_t N){
+    if(N==num_params) return;
+    num_params = N;
+    ipiv.assign(N+1,0);
+    work.assign(N*N,0.0);
+    H.shape(N,N);
+    q.assign(N,0.0);
+    def_old.assign(N,0.0);
+    def_update.assign(N,0.0);
+    // the per pixel storage depends on N so it is resized in resize_pixels()
+    pixel_residuals.clear();
+    pixel_gmf.clear();
+  }
+  /// size the per pixel storage for a subset with num_pixels pixels (only grows)
+  void resize_pixels(const int_t num_pixels){
+    if((int_t)pixel_gmf.size()>=num_pixels) return;
+    pixel_residuals.resize(num_pixels*num_params);
+    pixel_gmf.resize(num_pixels);
+  }
+  /// number of degrees of freedom the storage is currently sized for
+  int_t num_params;
+  /// pivots for the LU factorization
+  std::vector<int> ipiv;
+  /// lapack work array (type double because LAPACK doesn't support float)
+  std::vector<double> work;
+  /// hessian
+  Teuchos::SerialDenseMatrix<int_t,double> H;
+  /// gradient of the objective
+  std::vector<double> q;
+  /// residuals for each pixel in the subset (num_pixels x num_params)
+  std::vector<scalar_t> pixel_residuals;
+  /// difference between the mean subtracted deformed and reference intensities for each pixel
+  std::vector<scalar_t> pixel_gmf;
+  /// parameter values from the previous iteration
+  std::vector<scalar_t> def_old;
+  /// update to the parameters
+  std::vector<scalar_t> def_update;
+};
+
+/// \brief Accumulate the gradient and Hessian of the Gauss-Newton update over all pixels
+///
+/// The number of parameters is a template argument so the loops have fixed trip counts that can
+/// be unrolled, N = 0 uses the run time value num_params instead. H is column major and only the
+/// upper triangle is accumulated before it is mirrored.
+/// \param num_params the number of parameters (used if N is 0)
+/// \param num_pixels the number of pixels
+/// \param residuals the residuals for each pixel (num_pixels x num_params)
+/// \param gmf the intensity difference for each pixel
+/// \param q [out] the gradient
+/// \param H [out] the Hessian
+template<int_t N>
+void accumulate_gauss_newton(const int_t num_params,
+  const int_t num_pixels,
+  const scalar_t * residuals,
+  const scalar_t * gmf,
+  double * q,
+  double * H){
+  const int_t n = N > 0 ? N : num_params;
+  for(int_t px=0;px<num_pixels;++px){
+    const scalar_t * r = residuals + px*n;
+    // the products are formed in double even if the residuals are stored in single precision
+    const accumulate_t g = gmf[px];
+    for(int_t i=0;i<n;++i){
+      const accumulate_t ri = r[i];
+      q[i] += g*ri;
+      for(int_t j=i;j<n;++j)
+        H[j*n+i] += ri*r[j];
+    }
+  }
+  for(int_t i=0;i<n;++i)
+    for(int_t j=0;j<i;++j)
+      H[j*n+i] = H[i*n+j];
+}
+
 Status_Flag
 Objective_ZNSSD::computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_function,
   int_t & num_iterations){
   TEUCHOS_TEST_FOR_EXCEPTION(!subset_->has_gradients(),std::runtime_error,"Error, image gradients have not been computed but are needed here.");
+  has_analytic_beta_ = false;
+  has_gradient_moments_ = false;
+  const bool compute_analytic_beta = schema_->output_beta()&&schema_->analytic_beta();
   // TODO catch the case where the initial gamma is good enough (possibly do this at the image level, not subset?):
   int_t N = shape_function->num_params(); // one degree of freedom for each shape function parameter
   assert(N>=2);
   scalar_t tolerance = schema_->fast_solver_tolerance();
+  const scalar_t noise_tolerance_factor = schema_->noise_adaptive_tolerance_factor();
+  // tolerance for the displacement parameters (may be raised to what the image noise allows below)
+  scalar_t disp_tolerance = tolerance;
   const int_t max_solve_its = schema_->max_solver_iterations_fast();
-  int *IPIV = new int[N+1];
   int LWORK = N*N;
   int INFO = 0;
-  // using type double here because LAPACK doesn't support float.
-  double *WORK = new double[LWORK];
   Teuchos::LAPACK<int_t,double> lapack;
 
-  // Initialize storage:
-  Teuchos::SerialDenseMatrix<int_t,double> H(N,N, true);
-  Teuchos::ArrayRCP<double> q(N,0.0);
-  std::vector<scalar_t> residuals(N,0.0);
-  std::vector<scalar_t> def_old(N,0.0);    // save off the previous value to test for convergence
-  std::vector<scalar_t> def_update(N,0.0); // save off the previous value to test for convergence
+  // the storage is owned by the calling thread and reused from one call to the next
+  // so that no allocations are made once the first subset has been correlated
+  static thread_local Gauss_Newton_Workspace workspace;
+  workspace.resize(N);
+  int * IPIV = &workspace.ipiv[0];
+  double * WORK = &workspace.work[0];
+  Teuchos::SerialDenseMatrix<int_t,double> & H = workspace.H;
+  std::vector<double> & q = workspace.q;
+  std::vector<scalar_t> & def_old = workspace.def_old;       // save off the previous value to test for convergence
+  std::vector<scalar_t> & def_update = workspace.def_update;
+  const int_t num_pixels = subset_->num_pixels();
+  workspace.resize_pixels(num_pixels);
+  scalar_t * residuals = &workspace.pixel_residuals[0];
+  scalar_t * gmf = &workspace.pixel_gmf[0];
+  // the subset coordinates are stored contiguously
+  const int_t * px_x = &subset_->x(0);
+  const int_t * px_y = &subset_->y(0);
+  // the early iterations may only use every sample_stride-th pixel, the stride is halved each time
+  // the sampled iterations converge so the accepted solution is always converged with all the pixels
+  int_t sample_stride = schema_->progressive_sampling_stride();
+#if DICE_KOKKOS
+  sample_stride = 1;
+#endif
+  // keep enough pixels in the sample to determine the parameters
+  while(sample_stride>1&&num_pixels<20*N*sample_stride)
+    sample_stride /= 2;
 
   // note this creates a pointer to the array so
   // the values are updated each frame if compute_grad_def_images is on
@@ -328,6 +535,7 @@ Objective_ZNSSD::computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_func
   const scalar_t cy = subset_->centroid_y();
   const scalar_t meanF = subset_->mean(REF_INTENSITIES);
 
+#ifdef DICE_DEBUG_MSG
   scalar_t old_u=0.0,old_v=0.0,old_t=0.0;
   shape_function->map_to_u_v_theta(cx,cy,old_u,old_v,old_t);
   DEBUG_MSG(std::setw(5) << "Iter" <<
@@ -337,14 +545,27 @@ Objective_ZNSSD::computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_func
     std::setw(12) << " dv" <<
     std::setw(12) << " t"  <<
     std::setw(12) << " dt");
+#endif
 
+  // displacement diagonal of the Hessian before regularization and inversion (used for beta)
+  scalar_t h_uu = 0.0, h_vv = 0.0;
+  // the noise tolerance and gradient moments are taken from the first iteration that uses all pixels
+  bool full_sample_seen = false;
   int_t solve_it = 0;
   for(;solve_it<=max_solve_its;++solve_it){
     num_iterations = solve_it;
+    // leave the second half of the iterations for all the pixels
+    if(sample_stride>1&&2*solve_it>=max_solve_its)
+      sample_stride = 1;
+
+    // zero out the storage (a previous call may have returned early and left values behind)
+    H.putScalar(0.0);
+    for(int_t i=0;i<N;++i)
+      q[i] = 0.0;
 
     // update the deformed image with the new deformation:
     try{
-      subset_->initialize(schema_->def_img(subset_->sub_image_id()),DEF_INTENSITIES,shape_function,schema_->interpolation_method());
+      subset_->initialize(schema_->def_img(subset_->sub_image_id()),DEF_INTENSITIES,shape_function,schema_->interpolation_method(),sample_stride);
       //#ifdef DICE_DEBUG_MSG
       //    std::stringstream fileName;
       //    fileName << "defSubset_" << correlation_point_global_id_ << "_" << solve_it;
@@ -357,22 +578,53 @@ Objective_ZNSSD::computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_func
     // compute the mean value of the subsets:
     const scalar_t meanG = subset_->mean(DEF_INTENSITIES);
     // the gradients are taken from the def images rather than the ref
-    const bool use_ref_grads = schema_->def_img()->has_gradients() ? false : true;
+    const bool use_ref_grads = schema_->def_img()->has_gradients()||schema_->def_img()->analytic_gradients() ? false : true;
 
-    scalar_t GmF = 0.0;
-    for(int_t index=0;index<subset_->num_pixels();++index){
-      if(subset_->is_deactivated_this_step(index)||!subset_->is_active(index)) continue;
-      GmF = (subset_->def_intensities(index) - meanG) - (subset_->ref_intensities(index) - meanF);
-      for(int_t i=0;i<N;++i)
-        residuals[i] = 0.0;
-      shape_function->residuals(subset_->x(index),subset_->y(index),cx,cy,gradGx[index],gradGy[index],residuals,use_ref_grads);
-      for(int_t i=0;i<N;++i){
-        q[i] += GmF*residuals[i];
-        for(int_t j=0;j<N;++j)
-          H(i,j) += residuals[i]*residuals[j];
+    {
+      Scoped_Profile_Timer hessian_timer(PROFILE_HESSIAN_ASSEMBLY);
+      // compute the residuals for all pixels in one call to the shape function
+      shape_function->batch_residuals(num_pixels,px_x,px_y,cx,cy,gradGx.getRawPtr(),gradGy.getRawPtr(),residuals,use_ref_grads);
+      for(int_t index=0;index<num_pixels;++index){
+        if(subset_->is_deactivated_this_step(index)||!subset_->is_active(index)){
+          // zero residuals remove the pixel from the sums below
+          gmf[index] = 0.0;
+          for(int_t i=0;i<N;++i)
+            residuals[index*N+i] = 0.0;
+          continue;
+        }
+        gmf[index] = (subset_->def_intensities(index) - meanG) - (subset_->ref_intensities(index) - meanF);
+      }
+      switch(N){
+      case 2: accumulate_gauss_newton<2>(N,num_pixels,residuals,gmf,&q[0],H.values()); break;
+      case 3: accumulate_gauss_newton<3>(N,num_pixels,residuals,gmf,&q[0],H.values()); break;
+      case 4: accumulate_gauss_newton<4>(N,num_pixels,residuals,gmf,&q[0],H.values()); break;
+      case 5: accumulate_gauss_newton<5>(N,num_pixels,residuals,gmf,&q[0],H.values()); break;
+      case 6: accumulate_gauss_newton<6>(N,num_pixels,residuals,gmf,&q[0],H.values()); break;
+      case 12: accumulate_gauss_newton<12>(N,num_pixels,residuals,gmf,&q[0],H.values()); break;
+      default: accumulate_gauss_newton<0>(N,num_pixels,residuals,gmf,&q[0],H.values());
+      }
+      h_uu = H(0,0);
+      h_vv = H(1,1);
+      // the gradients don't change between iterations so the sums for the uncertainty fields are taken once
+      // (the gradients of the pixels left out of a sample are stale if they come from the deformed image)
+      if(sample_stride==1&&!full_sample_seen)
+        computeGradientMoments(gradGx.getRawPtr(),gradGy.getRawPtr());
+    }
+
+    // updates smaller than a fraction of the displacement uncertainty due to the image noise (see sigma())
+    // can't be resolved by the data so the displacements don't have to converge beyond that
+    if(sample_stride==1&&!full_sample_seen&&noise_tolerance_factor>0.0){
+      const scalar_t sum_grad = std::min(h_uu,h_vv);
+      if(sum_grad>0.0){
+        const scalar_t noise_level = subset_->noise_std_dev(schema_->def_img(subset_->sub_image_id()),shape_function);
+        disp_tolerance = std::max(tolerance,noise_tolerance_factor*std::sqrt(2.0*noise_level*noise_level/sum_grad));
+        DEBUG_MSG("Subset " << correlation_point_global_id_ << " noise level " << noise_level << " displacement tolerance " << disp_tolerance);
       }
     }
 
+    const bool full_sample = sample_stride==1;
+    full_sample_seen = full_sample_seen||full_sample;
+
     if(schema_->use_objective_regularization()){ // TODO test for affine shape functions too
       // add the penalty terms
       const scalar_t alpha = schema_->levenberg_marquardt_regularization_factor();
@@ -391,32 +643,35 @@ Objective_ZNSSD::computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_func
       cond_2x2 = norm_H * norm_Hi;
     }
 
-    // clear temp storage
-    for(int_t i=0;i<LWORK;++i) WORK[i] = 0.0;
-    for(int_t i=0;i<N+1;++i) {IPIV[i] = 0;}
-    try
     {
-      lapack.GETRF(N,N,H.values(),N,IPIV,&INFO);
-      if(correlation_point_global_id_>=0)
-        schema_->global_field_value(correlation_point_global_id_,CONDITION_NUMBER_FS) = cond_2x2;
-      if(cond_2x2 > 1.0E12) return HESSIAN_SINGULAR;
-    }
-    catch(std::exception &e){
-      if(&e!=0){
-        DEBUG_MSG( e.what() << '\n');
+      Scoped_Profile_Timer solve_timer(PROFILE_LINEAR_SOLVE);
+      // clear temp storage
+      for(int_t i=0;i<LWORK;++i) WORK[i] = 0.0;
+      for(int_t i=0;i<N+1;++i) {IPIV[i] = 0;}
+      try
+      {
+        lapack.GETRF(N,N,H.values(),N,IPIV,&INFO);
+        if(correlation_point_global_id_>=0)
+          schema_->global_field_value(correlation_point_global_id_,CONDITION_NUMBER_FS) = cond_2x2;
+        if(cond_2x2 > 1.0E12) return HESSIAN_SINGULAR;
       }
-      return LINEAR_SOLVE_FAILED;
-    }
-    for(int_t i=0;i<LWORK;++i) WORK[i] = 0.0;
-    try
-    {
-      lapack.GETRI(N,H.values(),N,IPIV,WORK,LWORK,&INFO);
-    }
-    catch(std::exception &e){
-      if(&e!=0){
-        DEBUG_MSG( e.what() << '\n');
+      catch(std::exception &e){
+        if(&e!=0){
+          DEBUG_MSG( e.what() << '\n');
+        }
+        return LINEAR_SOLVE_FAILED;
+      }
+      for(int_t i=0;i<LWORK;++i) WORK[i] = 0.0;
+      try
+      {
+        lapack.GETRI(N,H.values(),N,IPIV,WORK,LWORK,&INFO);
+      }
+      catch(std::exception &e){
+        if(&e!=0){
+          DEBUG_MSG( e.what() << '\n');
+        }
+        return LINEAR_SOLVE_FAILED;
       }
-      return LINEAR_SOLVE_FAILED;
     }
     // save off last step
     for(int_t i=0;i<N;++i)
@@ -428,6 +683,7 @@ Objective_ZNSSD::computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_func
         def_update[i] += H(i,j)*(-1.0)*q[j];
     shape_function->update(def_update);
 
+#ifdef DICE_DEBUG_MSG
     scalar_t guess_u = 0.0,guess_v=0.0,guess_t=0.0;
     shape_function->map_to_u_v_theta(cx,cy,guess_u,guess_v,guess_t);
     std::ios  state(NULL);
@@ -441,24 +697,169 @@ Objective_ZNSSD::computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_func
       std::setw(12) << guess_t - old_t);
     std::cout.copyfmt(state);
     shape_function->map_to_u_v_theta(cx,cy,old_u,old_v,old_t);
+#endif
 
-    const bool converged = shape_function->test_for_convergence(def_old,tolerance);
+    bool converged = shape_function->test_for_convergence(def_old,tolerance);
+    if(!converged&&disp_tolerance>tolerance){
+      // the displacements (always the first two parameters) are held to the noise based tolerance
+      converged = true;
+      for(int_t i=0;i<N;++i)
+        if(std::abs((*shape_function)(i) - def_old[i]) >= (i<2 ? disp_tolerance : tolerance))
+          converged = false;
+    }
+    if(converged&&!full_sample){
+      // refine the sample and keep iterating
+      sample_stride /= 2;
+      DEBUG_MSG("Subset " << correlation_point_global_id_ << " sampled iterations converged, pixel stride is now " << sample_stride);
+      continue;
+    }
     if(converged){
       DEBUG_MSG("Subset " << correlation_point_global_id_ << " ** CONVERGED SOLUTION ");
       shape_function->print_parameters();
       computeUncertaintyFields(shape_function);
+      if(compute_analytic_beta)
+        computeAnalyticBeta(h_uu,h_vv,gradGx.getRawPtr(),gradGy.getRawPtr());
       break;
     }
+  } // end solve iteration loop
+
+  if(solve_it>max_solve_its){
+    return MAX_ITERATIONS_REACHED;
+  }
+  else return CORRELATION_SUCCESSFUL;
+}
+
+Status_Flag
+Objective_ZNSSD::computeUpdateInverseCompositional(Teuchos::RCP<Local_Shape_Function> shape_function,
+  int_t & num_iterations){
+  const int_t N = shape_function->num_params(); // one degree of freedom for each shape function parameter
+  assert(N>=2);
+  const scalar_t tolerance = schema_->fast_solver_tolerance();
+  const int_t max_solve_its = schema_->max_solver_iterations_fast();
+  has_analytic_beta_ = false;
+  has_gradient_moments_ = false;
+  int INFO = 0;
+  Teuchos::LAPACK<int_t,double> lapack;
+
+  // the steepest descent images and Hessian only depend on the reference subset so they
+  // are stored by the subset and reused for all iterations and all frames
+  if(!subset_->has_steepest_descent()||subset_->num_steepest_descent_params()!=N){
+    Teuchos::RCP<Local_Shape_Function> identity = shape_function_factory(schema_);
+    TEUCHOS_TEST_FOR_EXCEPTION(identity->num_params()!=N,std::runtime_error,
+      "Error, the shape function does not match the one defined by the schema");
+    subset_->initialize_steepest_descent(schema_->ref_img(),identity);
+  }
+
+  static thread_local Gauss_Newton_Workspace workspace;
+  workspace.resize(N);
+  int * IPIV = &workspace.ipiv[0];
+  Teuchos::SerialDenseMatrix<int_t,double> & H = workspace.H;
+  std::vector<double> & q = workspace.q;
+  std::vector<scalar_t> & def_old = workspace.def_old;       // save off the previous value to test for convergence
+  std::vector<scalar_t> & def_update = workspace.def_update;
+
+  const scalar_t meanF = subset_->mean(REF_INTENSITIES);
+  // true if H currently holds the factorization of the Hessian with all pixels included
+  bool full_hessian_factored = false;
+
+  int_t solve_it = 0;
+  for(;solve_it<=max_solve_its;++solve_it){
+    num_iterations = solve_it;
+
+    // update the deformed image with the new deformation:
+    try{
+      subset_->initialize(schema_->def_img(subset_->sub_image_id()),DEF_INTENSITIES,shape_function,schema_->interpolation_method());
+    }
+    catch (std::logic_error & err) {
+      return SUBSET_CONSTRUCTION_FAILED;
+    }
+    // compute the mean value of the subsets:
+    const scalar_t meanG = subset_->mean(DEF_INTENSITIES);
 
-    // zero out the storage
-    H.putScalar(0.0);
     for(int_t i=0;i<N;++i)
       q[i] = 0.0;
-  } // end solve iteration loop
+    int_t num_skipped = 0;
+    accumulate_t GmF = 0.0;
+    for(int_t index=0;index<subset_->num_pixels();++index){
+      if(subset_->is_deactivated_this_step(index)||!subset_->is_active(index)){
+        num_skipped++;
+        continue;
+      }
+      GmF = (subset_->def_intensities(index) - meanG) - (subset_->ref_intensities(index) - meanF);
+      for(int_t i=0;i<N;++i)
+        q[i] += GmF*subset_->steepest_descent(index,i);
+    }
 
-  // clean up storage for lapack:
-  delete [] WORK;
-  delete [] IPIV;
+    // the factorization only has to be redone if pixels were skipped (only happens at the subset
+    // boundaries or near obstructions) since their contribution is removed from the stored Hessian
+    if(num_skipped>0||!full_hessian_factored){
+      for(int_t i=0;i<N;++i)
+        for(int_t j=0;j<N;++j)
+          H(i,j) = subset_->steepest_descent_hessian(i,j);
+      if(num_skipped>0){
+        for(int_t index=0;index<subset_->num_pixels();++index){
+          if(!subset_->is_deactivated_this_step(index)&&subset_->is_active(index)) continue;
+          for(int_t i=0;i<N;++i)
+            for(int_t j=0;j<N;++j)
+              H(i,j) -= subset_->steepest_descent(index,i)*subset_->steepest_descent(index,j);
+        }
+      }
+      if(schema_->use_objective_regularization()){
+        // add the penalty terms
+        const scalar_t alpha = schema_->levenberg_marquardt_regularization_factor();
+        H(0,0) += alpha;
+        H(1,1) += alpha;
+      }
+      // compute the norm of H prior to factoring (the first two parameters are always the displacements):
+      const scalar_t det_h = H(0,0)*H(1,1) - H(1,0)*H(0,1);
+      const scalar_t norm_H = std::sqrt(H(0,0)*H(0,0) + H(0,1)*H(0,1) + H(1,0)*H(1,0) + H(1,1)*H(1,1));
+      scalar_t cond_2x2 = -1.0;
+      if(det_h !=0.0){
+        const scalar_t norm_Hi = std::sqrt((1.0/(det_h*det_h))*(H(0,0)*H(0,0) + H(0,1)*H(0,1) + H(1,0)*H(1,0) + H(1,1)*H(1,1)));
+        cond_2x2 = norm_H * norm_Hi;
+      }
+      if(correlation_point_global_id_>=0)
+        schema_->global_field_value(correlation_point_global_id_,CONDITION_NUMBER_FS) = cond_2x2;
+      if(cond_2x2 > 1.0E12) return HESSIAN_SINGULAR;
+      for(int_t i=0;i<N+1;++i) IPIV[i] = 0;
+      try
+      {
+        lapack.GETRF(N,N,H.values(),N,IPIV,&INFO);
+      }
+      catch(std::exception &e){
+        DEBUG_MSG( e.what() << '\n');
+        return LINEAR_SOLVE_FAILED;
+      }
+      if(INFO!=0) return HESSIAN_SINGULAR;
+      full_hessian_factored = num_skipped==0;
+    }
+    // solve for the incremental map of the reference subset (solution overwrites q)
+    try
+    {
+      lapack.GETRS('N',N,1,H.values(),N,IPIV,&q[0],N,&INFO);
+    }
+    catch(std::exception &e){
+      DEBUG_MSG( e.what() << '\n');
+      return LINEAR_SOLVE_FAILED;
+    }
+    if(INFO!=0) return LINEAR_SOLVE_FAILED;
+
+    // save off last step
+    for(int_t i=0;i<N;++i)
+      def_old[i] = (*shape_function)(i);
+    for(int_t i=0;i<N;++i)
+      def_update[i] = q[i];
+    // W(p) <- W(p) o W(dp)^-1
+    shape_function->inverse_compositional_update(def_update);
+
+    const bool converged = shape_function->test_for_convergence(def_old,tolerance);
+    if(converged){
+      DEBUG_MSG("Subset " << correlation_point_global_id_ << " ** CONVERGED SOLUTION (inverse compositional)");
+      shape_function->print_parameters();
+      computeUncertaintyFields(shape_function);
+      break;
+    }
+  } // end solve iteration loop
 
   if(solve_it>max_solve_its){
     return MAX_ITERATIONS_REACHED;
@@ -54,6 +54,9 @@
 
 namespace DICe {
 
+/// forward dec for the simplex used by computeUpdateRobust()
+class Subset_Simplex;
+
 /// \class DICe::Objective
 /// \brief A container class for the subsets, optimization algorithm and initialization routine used to correlate a single point
 ///
@@ -81,26 +84,13 @@ public:
   /// \param correlation_point_global_id Control point local index (the local id of the control point, in parallel this is the id on the current processor)
   Objective(Schema * schema, const int_t correlation_point_global_id):
     schema_(schema),
-    correlation_point_global_id_(correlation_point_global_id)
+    correlation_point_global_id_(correlation_point_global_id),
+    has_analytic_beta_(false),
+    analytic_beta_(-1.0),
+    has_gradient_moments_(false)
 {
     if(correlation_point_global_id==-1)return;
-    assert(schema_->is_initialized());
-    // create the refSubset as member data
-    // check to see if the schema has multishapes:
-    if((*schema_->conformal_subset_defs()).find(correlation_point_global_id_)!=(*schema_->conformal_subset_defs()).end()){
-      subset_ = Teuchos::rcp(new Subset(static_cast<int_t>(global_field_value(DICe::field_enums::SUBSET_COORDINATES_X_FS)),
-        static_cast<int_t>(global_field_value(DICe::field_enums::SUBSET_COORDINATES_Y_FS)),
-        (*schema_->conformal_subset_defs()).find(correlation_point_global_id_)->second));
-    }
-    // otherwise build up the subsets from x/y and w/h:
-    else{
-      assert(schema_->subset_dim()>0);
-      subset_ = Teuchos::rcp(new Subset(static_cast<int_t>(global_field_value(DICe::field_enums::SUBSET_COORDINATES_X_FS)),
-        static_cast<int_t>(global_field_value(DICe::field_enums::SUBSET_COORDINATES_Y_FS)),
-        schema_->subset_dim(),schema_->subset_dim()));
-    }
-    assert(schema_->ref_img()!=Teuchos::null);
-    subset_->initialize(schema_->ref_img());
+    build_subset();
 }
 
   /// \brief Base class constructor uses a DICe::Schema to get parameter values and coordinates to denote the centroid of the subset
@@ -111,7 +101,10 @@ public:
 const int_t x,
 const int_t y):
     schema_(schema),
-    correlation_point_global_id_(-1)
+    correlation_point_global_id_(-1),
+    has_analytic_beta_(false),
+    analytic_beta_(-1.0),
+    has_gradient_moments_(false)
 {
     // create the refSubset as member data from x/y and w/h:
     assert(schema_->is_initialized());
@@ -120,7 +113,10 @@ const int_t y):
     assert(y>=0&&y<schema_->ref_img()->height());
     assert(schema_->ref_img()!=Teuchos::null);
     subset_ = Teuchos::rcp(new Subset(x,y,schema_->subset_dim(),schema_->subset_dim()));
-    subset_->initialize(schema_->ref_img());
+    if(schema_->share_reference_intensities())
+      subset_->share_ref_intensities(schema_->ref_img());
+    else
+      subset_->initialize(schema_->ref_img());
 }
 
   virtual ~Objective(){}
@@ -129,6 +125,25 @@ const int_t y):
   /// \param shape_function pointer to the class that holds the deformation parameter values
   scalar_t gamma( Teuchos::RCP<Local_Shape_Function> shape_function) const;
 
+  /// \brief Correlation criteria with explicit control of the active pixel normalization
+  /// (used by beta so that the schema flag does not have to be toggled, which is not thread safe)
+  /// \param shape_function pointer to the class that holds the deformation parameter values
+  /// \param normalize_with_active_pixels true if gamma should be divided by the number of active pixels
+  scalar_t gamma( Teuchos::RCP<Local_Shape_Function> shape_function,
+    const bool normalize_with_active_pixels) const;
+
+  /// \brief Correlation criteria for several shape functions at once (see Subset::batch_gamma())
+  ///
+  /// Each value matches gamma(shape_function) but the deformed intensities of the subset are not modified.
+  /// \param num_functions the number of shape functions
+  /// \param shape_functions array of the shape functions to evaluate
+  /// \param gamma_values [out] one gamma value per shape function (must be allocated by the caller)
+  /// \param num_threads the number of threads to use if the call is not already in a parallel region
+  void batch_gamma(const int_t num_functions,
+    const Teuchos::RCP<Local_Shape_Function> * shape_functions,
+    scalar_t * gamma_values,
+    const int_t num_threads=1) const;
+
   /// \brief Uncertainty measure for solution
   /// \param shape_function [out] pointer to the class that holds the deformation parameter values
   /// \param noise_level [out] Returned as the standard deviation estimate of the image noise sigma_g from Sutton et.al.
@@ -136,6 +151,9 @@ const int_t y):
     scalar_t & noise_level) const;
 
   /// \brief Measure of the slope of the optimization landscape or how deep the minimum well is
+  ///
+  /// If analytic_beta is set and the last solve was gradient based, the value estimated from the
+  /// converged Hessian is returned, otherwise gamma is evaluated at perturbed solutions
   /// \param shape_function pointer to the class that holds the deformation parameter values
   scalar_t beta( Teuchos::RCP<Local_Shape_Function> shape_function) const;
 
@@ -145,6 +163,13 @@ const int_t y):
   virtual Status_Flag computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_function,
     int_t & num_iterations) = 0;
 
+  /// \brief Inverse compositional Gauss-Newton optimization algorithm. The Hessian and steepest descent
+  /// images are computed from the reference subset once and reused for all iterations and frames
+  /// \param shape_function pointer to the class that holds the deformation parameter values
+  /// \param num_iterations [out] The number of interations a particular frame took to execute
+  virtual Status_Flag computeUpdateInverseCompositional(Teuchos::RCP<Local_Shape_Function> shape_function,
+    int_t & num_iterations) = 0;
+
   /// \brief Simplex based optimization algorithm
   /// \param shape_function pointer to the class that holds the deformation parameter values
   /// \param num_iterations [out] The number of interations a particular frame took to execute
@@ -153,6 +178,13 @@ const int_t y):
     int_t & num_iterations,
     const scalar_t & override_tol = -1.0);
 
+  /// \brief Accepts a converged solution that was computed outside the objective (for example by
+  /// a batched solve on the device) and computes the same uncertainty fields a converged solve would
+  /// \param shape_function [out] pointer to the class that holds the deformation parameter values
+  /// \param parameters the converged shape function parameters
+  Status_Flag acceptConvergedSolution(Teuchos::RCP<Local_Shape_Function> shape_function,
+    const std::vector<scalar_t> & parameters);
+
   /// \brief Returns the current value of the field specified. These values are stored in the schema
   /// \param spec Field_Spec that defines the requested field
   const mv_scalar_type & global_field_value(const DICe::field_enums::Field_Spec spec)const{
@@ -179,18 +211,89 @@ const int_t y):
     return correlation_point_global_id_;
   }
 
+  /// \brief Point the objective at a different correlation point so the instance can be reused
+  ///
+  /// Square subsets are moved to the new centroid and keep their pixel storage, conformal subsets are rebuilt.
+  /// \param correlation_point_global_id the global id of the new correlation point
+  void reset(const int_t correlation_point_global_id){
+    TEUCHOS_TEST_FOR_EXCEPTION(correlation_point_global_id<0,std::invalid_argument,"Error, invalid correlation point id");
+    correlation_point_global_id_ = correlation_point_global_id;
+    has_analytic_beta_ = false;
+    has_gradient_moments_ = false;
+    build_subset();
+  }
+
+  /// \brief Change the global id of the correlation point without touching the subset
+  /// (the correlation points were renumbered, but this one did not move)
+  /// \param correlation_point_global_id the new global id of the correlation point
+  void renumber(const int_t correlation_point_global_id){
+    TEUCHOS_TEST_FOR_EXCEPTION(correlation_point_global_id<0,std::invalid_argument,"Error, invalid correlation point id");
+    correlation_point_global_id_ = correlation_point_global_id;
+  }
+
 protected:
 
   /// Computes the difference from the exact solution and associated fields
   /// \param shape_function pointer to the class that holds the deformation parameter values
   void computeUncertaintyFields(Teuchos::RCP<Local_Shape_Function> shape_function);
 
+  /// Estimates beta from the curvature of the converged Gauss-Newton solve (see beta())
+  /// \param h_uu Hessian entry for the x displacement
+  /// \param h_vv Hessian entry for the y displacement
+  /// \param gx array of the x gradients for the subset pixels
+  /// \param gy array of the y gradients for the subset pixels
+  void computeAnalyticBeta(const scalar_t & h_uu,
+    const scalar_t & h_vv,
+    const scalar_t * gx,
+    const scalar_t * gy);
+
+  /// Accumulates the gradient sums used by computeUncertaintyFields() in one pass over the subset pixels
+  /// \param gx array of the x gradients for the subset pixels
+  /// \param gy array of the y gradients for the subset pixels
+  void computeGradientMoments(const scalar_t * gx,
+    const scalar_t * gy);
+
+  /// Creates (or moves) the subset for the current correlation point and fills the reference intensities
+  void build_subset(){
+    assert(schema_->is_initialized());
+    assert(schema_->ref_img()!=Teuchos::null);
+    const int_t cx = static_cast<int_t>(global_field_value(DICe::field_enums::SUBSET_COORDINATES_X_FS));
+    const int_t cy = static_cast<int_t>(global_field_value(DICe::field_enums::SUBSET_COORDINATES_Y_FS));
+    // check to see if the schema has multishapes:
+    if((*schema_->conformal_subset_defs()).find(correlation_point_global_id_)!=(*schema_->conformal_subset_defs()).end()){
+      subset_ = Teuchos::rcp(new Subset(cx,cy,(*schema_->conformal_subset_defs()).find(correlation_point_global_id_)->second));
+    }
+    // a square subset from a previous correlation point can be moved rather than reallocated
+    else if(subset_!=Teuchos::null&&!subset_->is_conformal()){
+      subset_->move_to(cx,cy);
+    }
+    // otherwise build up the subsets from x/y and w/h:
+    else{
+      assert(schema_->subset_dim()>0);
+      subset_ = Teuchos::rcp(new Subset(cx,cy,schema_->subset_dim(),schema_->subset_dim()));
+    }
+    if(schema_->share_reference_intensities())
+      subset_->share_ref_intensities(schema_->ref_img());
+    else
+      subset_->initialize(schema_->ref_img());
+  }
+
   /// Pointer to the schema for this analysis
   Schema * schema_;
   /// Correlation point global id
-  const int_t correlation_point_global_id_;
+  int_t correlation_point_global_id_;
   /// Pointer to the subset
   Teuchos::RCP<Subset> subset_;
+  /// simplex used by computeUpdateRobust(), created on first use and kept so a reused objective doesn't reallocate it
+  Teuchos::RCP<Subset_Simplex> simplex_;
+  /// true if analytic_beta_ holds the beta value for the last converged gradient based solve
+  bool has_analytic_beta_;
+  /// beta estimated from the converged Hessian
+  scalar_t analytic_beta_;
+  /// true if gradient_moments_ holds the sums for the gradients of the current solve
+  bool has_gradient_moments_;
+  /// sums over the subset pixels of gx^2/|g|^2, gx*gy/|g|^2, gy^2/|g|^2 and |g|^2
+  accumulate_t gradient_moments_[4];
 };
 
 /// \class DICe::Objective_ZNSSD
@@ -235,6 +338,10 @@ public:
   virtual Status_Flag computeUpdateFast(Teuchos::RCP<Local_Shape_Function> shape_function,
     int_t & num_iterations);
 
+  /// See base class documentation
+  virtual Status_Flag computeUpdateInverseCompositional(Teuchos::RCP<Local_Shape_Function> shape_function,
+    int_t & num_iterations);
+
   /// See base class documentation
   using Objective::computeUpdateRobust;
 
@@ -0,0 +1,144 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_OutputWriter.h>
+#include <DICe_Trace.h>
+
+#include <iostream>
+
+namespace DICe {
+
+Output_Writer::Output_Writer(const int_t max_pending):
+  max_pending_(max_pending),
+  busy_(false),
+  stop_(false),
+  memory_(MEMORY_OUTPUT_BUFFERS){
+  TEUCHOS_TEST_FOR_EXCEPTION(max_pending_<1,std::runtime_error,"Error, the output writer must allow at least one pending task");
+  thread_ = std::thread(&Output_Writer::run,this);
+}
+
+Output_Writer::~Output_Writer(){
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    // finish the output that was already submitted
+    queue_cond_.wait(lock,[this]{return tasks_.empty()&&!busy_;});
+    stop_ = true;
+    if(!error_.empty())
+      std::cout << "Error, writing the output failed: " << error_ << std::endl;
+  }
+  queue_cond_.notify_all();
+  if(thread_.joinable())
+    thread_.join();
+}
+
+void
+Output_Writer::check_error(){
+  if(error_.empty()) return;
+  const std::string error = error_;
+  error_.clear();
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, writing the output failed: " << error);
+}
+
+void
+Output_Writer::submit(const std::function<void()> & task,
+  const long long bytes){
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    check_error();
+    // time spent here is the correlation being blocked by the output
+    Scoped_Trace_Span span("output_wait","io");
+    queue_cond_.wait(lock,[this]{return (int_t)tasks_.size() + (busy_?1:0) < max_pending_;});
+    tasks_.push_back(std::pair<std::function<void()>,long long>(task,bytes));
+    memory_.set(memory_.bytes()+bytes);
+  }
+  queue_cond_.notify_all();
+}
+
+void
+Output_Writer::flush(){
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  queue_cond_.wait(lock,[this]{return tasks_.empty()&&!busy_;});
+  check_error();
+}
+
+int_t
+Output_Writer::num_pending(){
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return tasks_.size() + (busy_?1:0);
+}
+
+void
+Output_Writer::run(){
+  while(true){
+    std::function<void()> task;
+    long long bytes = 0;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cond_.wait(lock,[this]{return stop_||!tasks_.empty();});
+      if(stop_) return;
+      task = tasks_.front().first;
+      bytes = tasks_.front().second;
+      tasks_.pop_front();
+      busy_ = true;
+    }
+    std::string error;
+    try{
+      Scoped_Trace_Span span("output_task","io");
+      task();
+    }
+    catch(std::exception & e){
+      error = e.what();
+      if(error.empty()) error = "unknown error";
+    }
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      if(!error.empty()&&error_.empty())
+        error_ = error;
+      busy_ = false;
+      // release the copied data while the lock is held so the caller sees the task as finished
+      task = nullptr;
+      memory_.set(memory_.bytes()-bytes);
+    }
+    queue_cond_.notify_all();
+  }
+}
+
+}// End DICe Namespace
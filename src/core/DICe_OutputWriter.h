@@ -0,0 +1,135 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_OUTPUTWRITER_H
+#define DICE_OUTPUTWRITER_H
+
+#include <DICe.h>
+#include <DICe_MemoryTracker.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Output_Writer
+/// \brief Runs output tasks (formatting and writing result files) on a background thread so that
+/// writing the output of one frame overlaps with the correlation of the next
+///
+/// Tasks run one at a time in the order they were submitted. A task must not touch any data
+/// that the caller changes after submitting it (the caller copies the field values for the frame
+/// into the task). If the number of tasks waiting reaches the limit given to the constructor, submit()
+/// blocks until the background thread catches up. An error thrown by a task is reported by the next
+/// call to submit() or flush().
+class DICE_LIB_DLL_EXPORT
+Output_Writer
+{
+public:
+  /// \brief constructor (starts the background thread)
+  /// \param max_pending the maximum number of tasks that can be queued or running before submit() blocks
+  Output_Writer(const int_t max_pending=2);
+
+  /// destructor (waits for the pending tasks to finish then stops the background thread)
+  virtual ~Output_Writer();
+
+  /// \brief queue a task to run on the background thread
+  /// \param task the task to run
+  /// \param bytes the size of the data copied into the task (counted as output buffers until the task finishes)
+  void submit(const std::function<void()> & task,
+    const long long bytes=0);
+
+  /// waits for all of the submitted tasks to finish
+  void flush();
+
+  /// returns the number of tasks that are queued or running
+  int_t num_pending();
+
+  /// returns the maximum number of pending tasks
+  int_t max_pending()const{
+    return max_pending_;
+  }
+
+private:
+  /// not copyable
+  Output_Writer(const Output_Writer &);
+  /// not assignable
+  Output_Writer & operator=(const Output_Writer &);
+
+  /// throws if a task failed since the last check (called with the queue mutex held)
+  void check_error();
+
+  /// main loop of the background thread
+  void run();
+
+  /// maximum number of queued or running tasks
+  const int_t max_pending_;
+  /// queue of tasks that have not started and the size of their data
+  std::deque<std::pair<std::function<void()>,long long> > tasks_;
+  /// true while the background thread is running a task
+  bool busy_;
+  /// error message of the first task that failed since the last check
+  std::string error_;
+  /// guards the queue, the error and the stop flag
+  std::mutex queue_mutex_;
+  /// signals changes to the queue
+  std::condition_variable queue_cond_;
+  /// true if the background thread should exit
+  bool stop_;
+  /// the background thread
+  std::thread thread_;
+  /// bytes held by the queued and running tasks (guarded by the queue mutex)
+  Tracked_Memory memory_;
+};
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
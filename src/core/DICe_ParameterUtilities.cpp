@@ -93,7 +93,9 @@ const std::string to_string(Status_Flag in){
     "FAILURE_DUE_TO_TOO_MANY_RESTARTS",
     "FAILURE_DUE_TO_DEVIATION_FROM_PATH",
     "FRAME_SKIPPED",
-    "FRAME_SKIPPED_DUE_TO_NO_MOTION"
+    "FRAME_SKIPPED_DUE_TO_NO_MOTION",
+    "SUBSET_REJECTED_DUE_TO_LOW_CONTRAST",
+    "SUBSET_INTERPOLATED_FROM_COARSE_GRID"
   };
   return statusFlagStrings[in];
 }
@@ -118,6 +120,11 @@ const std::string to_string(Initialization_Method in){
   return initializationMethodStrings[in];
 }
 DICE_LIB_DLL_EXPORT
+const std::string to_string(Feature_Matcher in){
+  assert(in < MAX_FEATURE_MATCHER);
+  return featureMatcherStrings[in];
+}
+DICE_LIB_DLL_EXPORT
 const std::string to_string(Optimization_Method in){
   assert(in < MAX_OPTIMIZATION_METHOD);
   return optimizationMethodStrings[in];
@@ -185,6 +192,31 @@ Global_Solver string_to_global_solver(std::string & in){
   return NO_SUCH_GLOBAL_SOLVER; // prevent no return errors
 }
 
+DICE_LIB_DLL_EXPORT
+const std::string to_string(Global_Preconditioner in){
+  assert(in < NO_SUCH_GLOBAL_PRECONDITIONER);
+  const static char * globalPreconditionerStrings[] = {
+    "ILU_PRECONDITIONER",
+    "JACOBI_PRECONDITIONER",
+    "AMG_PRECONDITIONER",
+    "BLOCK_PRECONDITIONER",
+    "NO_SUCH_GLOBAL_PRECONDITIONER"
+  };
+  return globalPreconditionerStrings[in];
+};
+
+DICE_LIB_DLL_EXPORT
+Global_Preconditioner string_to_global_preconditioner(std::string & in){
+  // convert the string to uppercase
+  stringToUpper(in);
+  for(int_t i=0;i<NO_SUCH_GLOBAL_PRECONDITIONER;++i){
+    if(to_string(static_cast<Global_Preconditioner>(i))==in) return static_cast<Global_Preconditioner>(i);
+  }
+  std::cout << "Error: Global_Preconditioner " << in << " does not exist." << std::endl;
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,"");
+  return NO_SUCH_GLOBAL_PRECONDITIONER; // prevent no return errors
+}
+
 DICE_LIB_DLL_EXPORT
 Correlation_Routine string_to_correlation_routine(std::string & in){
   // convert the string to uppercase
@@ -230,6 +262,17 @@ Initialization_Method string_to_initialization_method(std::string & in){
   return NO_SUCH_INITIALIZATION_METHOD; // prevent no return errors
 }
 DICE_LIB_DLL_EXPORT
+Feature_Matcher string_to_feature_matcher(std::string & in){
+  // convert the string to uppercase
+  stringToUpper(in);
+  for(int_t i=0;i<MAX_FEATURE_MATCHER;++i){
+    if(featureMatcherStrings[i]==in) return static_cast<Feature_Matcher>(i);
+  }
+  std::cout << "Error: Feature_Matcher " << in << " does not exist." << std::endl;
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,"");
+  return NO_SUCH_FEATURE_MATCHER; // prevent no return errors
+}
+DICE_LIB_DLL_EXPORT
 Optimization_Method string_to_optimization_method(std::string & in){
   // convert the string to uppercase
   stringToUpper(in);
@@ -79,6 +79,10 @@ const std::string to_string(Global_Formulation in);
 DICE_LIB_DLL_EXPORT
 const std::string to_string(Initialization_Method in);
 
+/// Convert a DICe::Feature_Matcher to string
+DICE_LIB_DLL_EXPORT
+const std::string to_string(Feature_Matcher in);
+
 /// Convert a DICe::Optimization_Method to string
 DICE_LIB_DLL_EXPORT
 const std::string to_string(Optimization_Method in);
@@ -103,6 +107,14 @@ const std::string to_string(Global_Solver in);
 DICE_LIB_DLL_EXPORT
 Global_Solver string_to_global_solver(std::string & in);
 
+/// Convert a DICe::Global_Preconditioner to string
+DICE_LIB_DLL_EXPORT
+const std::string to_string(Global_Preconditioner in);
+
+/// Convert a string to a DICe::Global_Preconditioner
+DICE_LIB_DLL_EXPORT
+Global_Preconditioner string_to_global_preconditioner(std::string & in);
+
 /// Convert a string to a DICe::Correlation_Routine
 DICE_LIB_DLL_EXPORT
 Correlation_Routine string_to_correlation_routine(std::string & in);
@@ -119,6 +131,10 @@ Global_Formulation string_to_global_formulation(std::string & in);
 DICE_LIB_DLL_EXPORT
 Initialization_Method string_to_initialization_method(std::string & in);
 
+/// Convert a string to a DICe::Feature_Matcher
+DICE_LIB_DLL_EXPORT
+Feature_Matcher string_to_feature_matcher(std::string & in);
+
 /// Convert a string to a DICe::Interpolation_Method
 DICE_LIB_DLL_EXPORT
 Interpolation_Method string_to_interpolation_method(std::string & in);
@@ -45,6 +45,8 @@
 #include <DICe.h>
 #include <DICe_Cine.h>
 #include <DICe_NetCDF.h>
+#include <DICe_Rawi.h>
+#include <DICe_ImageIO.h>
 #include <DICe_FieldEnums.h>
 
 #include <Teuchos_oblackholestream.hpp>
@@ -62,6 +64,11 @@ namespace po = boost::program_options;
 #include <string>
 #include <algorithm>
 #include <vector>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
 
 #if DICE_MPI
 #  include <mpi.h>
@@ -92,9 +99,11 @@ Teuchos::RCP<Teuchos::ParameterList> parse_command_line(int argc,
                        ("verbose,v","Output log to screen")
                        ("version","Output version information to screen")
                        ("timing,t","Print timing statistics to screen")
+                       ("profile","Time the phases of the correlation and write a summary to the output folder")
                        ("input,i",po::value<std::string>(),"XML input file name <filename>.xml")
                        ("generate,g",po::value<std::string>()->implicit_value("dice"),"Create XML input file templates")
                        ("stats,s","Print field statistics to screen")
+                       ("estimate",po::value<int>()->implicit_value(3),"Correlate a few sample frames, print the projected time, memory and I/O of the full run and exit")
                        ("ss_locs","Print a file (ss_locs.txt) with the subset locations and exit before analysis")
                        ("debug_msg_on,d","Returns 1 if debugging messages are on, 0 if off")
                        ;
@@ -170,11 +179,22 @@ Teuchos::RCP<Teuchos::ParameterList> parse_command_line(int argc,
     inputParams->set(DICe::print_timing,true);
   }
 
+  // Time the phases of the correlation?
+  if(vm.count("profile")){
+    inputParams->set(DICe::print_phase_timing,true);
+  }
+
   // Print subset locations and exit?
   if(vm.count("ss_locs")){
     inputParams->set(DICe::print_subset_locations_and_exit,true);
   }
 
+  // Estimate the cost of the run and exit?
+  if(vm.count("estimate")){
+    TEUCHOS_TEST_FOR_EXCEPTION(vm["estimate"].as<int>()<1,std::runtime_error,"Error, --estimate requires at least one sample frame");
+    inputParams->set(DICe::estimate_run_and_exit,vm["estimate"].as<int>());
+  }
+
   // Print timing statistics?
   if(vm.count("stats")){
     inputParams->set(DICe::print_stats,true);
@@ -233,9 +253,10 @@ Teuchos::RCP<Teuchos::ParameterList> parse_command_line(int argc,
       required_param_missing = true;
     }
   }
-  if(!inputParams->isParameter(DICe::reference_image_index)&&!inputParams->isParameter(DICe::reference_image)&&!inputParams->isParameter(DICe::cine_file)&&!inputParams->isParameter(DICe::netcdf_file)){
+  if(!inputParams->isParameter(DICe::reference_image_index)&&!inputParams->isParameter(DICe::reference_image)&&!inputParams->isParameter(DICe::cine_file)&&!inputParams->isParameter(DICe::netcdf_file)
+      &&!inputParams->isParameter(DICe::rawv_file)){
     std::cout << "Error: Either the parameter " << DICe:: reference_image_index << " or " <<
-        DICe::reference_image << " or " << DICe::cine_file << " or " << DICe::netcdf_file << " needs to be specified in " << input_file << std::endl;
+        DICe::reference_image << " or " << DICe::cine_file << " or " << DICe::netcdf_file << " or " << DICe::rawv_file << " needs to be specified in " << input_file << std::endl;
     required_param_missing = true;
   }
   // specifying a simple two image correlation
@@ -376,10 +397,18 @@ Teuchos::RCP<Teuchos::ParameterList> read_correlation_params(const std::string &
         diceParams->set(DICe::global_solver,DICe::string_to_global_solver(
           stringParams->get<std::string>(it->first)));
       }
+      else if(paramName == DICe::global_preconditioner){
+        diceParams->set(DICe::global_preconditioner,DICe::string_to_global_preconditioner(
+          stringParams->get<std::string>(it->first)));
+      }
       else if(paramName == DICe::initialization_method){
         diceParams->set(DICe::initialization_method,DICe::string_to_initialization_method(
           stringParams->get<std::string>(it->first)));
       }
+      else if(paramName == DICe::feature_matcher){
+        diceParams->set(DICe::feature_matcher,DICe::string_to_feature_matcher(
+          stringParams->get<std::string>(it->first)));
+      }
       else{
         if(proc_rank==0) DEBUG_MSG("Not a string parameter that needs to be translated");
         diceParams->setEntry(it->first,it->second);
@@ -436,6 +465,8 @@ void decipher_image_file_names(Teuchos::RCP<Teuchos::ParameterList> params,
       "Error, cannot specify cine_file and reference_image");
     TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::netcdf_file),std::runtime_error,
       "Error, cannot specify netcdf_file and reference_image");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::rawv_file),std::runtime_error,
+      "Error, cannot specify rawv_file and reference_image");
     TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::stereo_cine_file),std::runtime_error,
       "Error, cannot specify stereo_cine_file and reference_image");
 
@@ -515,11 +546,10 @@ void decipher_image_file_names(Teuchos::RCP<Teuchos::ParameterList> params,
     std::stringstream cine_name;
     std::string cine_file_name = params->get<std::string>(DICe::cine_file);
     cine_name << params->get<std::string>(DICe::image_folder) << cine_file_name;
-    Teuchos::RCP<std::ostream> bhs = Teuchos::rcp(new Teuchos::oblackholestream); // outputs nothing
-    Teuchos::RCP<DICe::cine::Cine_Reader> cine_reader = Teuchos::rcp(new DICe::cine::Cine_Reader(cine_name.str(),bhs.getRawPtr(),false));
-    // read the image data for a frame
-    const int_t num_images = cine_reader->num_frames();
-    const int_t first_frame_index = cine_reader->first_image_number();
+    // only the header is needed here (it is shared with the readers created later for the frames)
+    Teuchos::RCP<DICe::cine::Cine_Header> cine_header = utils::Image_Reader_Cache::instance().cine_header(cine_name.str());
+    const int_t num_images = cine_header->header_.ImageCount;
+    const int_t first_frame_index = cine_header->header_.FirstImageNo;
     //TEUCHOS_TEST_FOR_EXCEPTION(!input_params->isParameter(DICe::cine_ref_index),std::runtime_error,
     //  "Error, the reference index for the cine file has not been specified");
     const int_t cine_ref_index = params->get<int_t>(DICe::cine_ref_index,first_frame_index);
@@ -566,8 +596,8 @@ void decipher_image_file_names(Teuchos::RCP<Teuchos::ParameterList> params,
       std::stringstream stereo_cine_name;
       std::string stereo_cine_file_name = params->get<std::string>(DICe::stereo_cine_file);
       stereo_cine_name << params->get<std::string>(DICe::image_folder) << stereo_cine_file_name;
-      Teuchos::RCP<std::ostream> bhs = Teuchos::rcp(new Teuchos::oblackholestream); // outputs nothing
-      Teuchos::RCP<DICe::cine::Cine_Reader> stereo_cine_reader = Teuchos::rcp(new DICe::cine::Cine_Reader(stereo_cine_name.str(),bhs.getRawPtr(),false));
+      // make sure the header can be read (the header is cached for the readers created later)
+      utils::Image_Reader_Cache::instance().cine_header(stereo_cine_name.str());
       // strip the .cine part from the end of the cine file:
       std::string stereo_trimmed_cine_name = stereo_cine_name.str();
       if(stereo_trimmed_cine_name.size() > ext.size() && stereo_trimmed_cine_name.substr(stereo_trimmed_cine_name.size() - ext.size()) == ".cine" )
@@ -593,6 +623,69 @@ void decipher_image_file_names(Teuchos::RCP<Teuchos::ParameterList> params,
       }
     }
   } // end cine file
+  else if(params->isParameter(DICe::rawv_file)){
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::deformed_images),std::runtime_error,
+      "Error, cannot specify deformed_images and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::stereo_reference_image),std::runtime_error,
+      "Error, cannot specify stereo_reference_image and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::stereo_deformed_images),std::runtime_error,
+      "Error, cannot specify stereo_deformed_images and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::image_file_prefix),std::runtime_error,
+      "Error, cannot specify image_file_prefix and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::image_file_extension),std::runtime_error,
+      "Error, cannot specify image_file_extension and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::num_file_suffix_digits),std::runtime_error,
+      "Error, cannot specify num_file_suffix_digits and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::stereo_left_suffix),std::runtime_error,
+      "Error, cannot specify stereo_left_suffix and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::stereo_right_suffix),std::runtime_error,
+      "Error, cannot specify stereo_right_suffix and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::cine_file),std::runtime_error,
+      "Error, cannot specify cine_file and rawv_file");
+    TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::netcdf_file),std::runtime_error,
+      "Error, cannot specify netcdf_file and rawv_file");
+    // the frames are zero based, by default the first frame is the reference and every frame is analyzed
+    std::stringstream rawv_name;
+    rawv_name << folder << params->get<std::string>(DICe::rawv_file);
+    DICe::utils::Rawv_Reader rawv_reader(rawv_name.str());
+    const int_t num_rawv_frames = rawv_reader.num_frames();
+    TEUCHOS_TEST_FOR_EXCEPTION(num_rawv_frames<=0,std::runtime_error,"Error, rawv file has no frames: " << rawv_name.str());
+    const int_t ref_index = params->get<int_t>(DICe::reference_image_index,0);
+    const int_t start_index = params->get<int_t>(DICe::start_image_index,ref_index);
+    const int_t end_index = params->get<int_t>(DICe::end_image_index,num_rawv_frames-1);
+    const int_t skip_index = params->get<int_t>(DICe::skip_image_index,1);
+    TEUCHOS_TEST_FOR_EXCEPTION(ref_index<0||ref_index>=num_rawv_frames,std::invalid_argument,"Error, invalid rawv reference index " << ref_index);
+    TEUCHOS_TEST_FOR_EXCEPTION(start_index<0||start_index>end_index,std::invalid_argument,"Error, invalid rawv start index " << start_index);
+    TEUCHOS_TEST_FOR_EXCEPTION(end_index>=num_rawv_frames,std::invalid_argument,"Error, the rawv end index " << end_index << " is past the last frame");
+    TEUCHOS_TEST_FOR_EXCEPTION(skip_index<=0,std::invalid_argument,"Error, invalid rawv skip index " << skip_index);
+    std::vector<std::string> rawv_files;
+    rawv_files.push_back(rawv_name.str());
+    if(params->isParameter(DICe::stereo_rawv_file)){
+      std::stringstream stereo_rawv_name;
+      stereo_rawv_name << folder << params->get<std::string>(DICe::stereo_rawv_file);
+      DICe::utils::Rawv_Reader stereo_rawv_reader(stereo_rawv_name.str());
+      TEUCHOS_TEST_FOR_EXCEPTION(stereo_rawv_reader.num_frames()!=num_rawv_frames,std::runtime_error,
+        "Error, the rawv file and stereo rawv file must have the same number of frames");
+      rawv_files.push_back(stereo_rawv_name.str());
+    }
+    // frames are named with the same convention as netcdf files, <name>_frame_<index>.rawv
+    const std::string ext(".rawv");
+    for(size_t file_it=0;file_it<rawv_files.size();++file_it){
+      std::string trimmed_name = rawv_files[file_it];
+      TEUCHOS_TEST_FOR_EXCEPTION(trimmed_name.size() <= ext.size() || trimmed_name.substr(trimmed_name.size() - ext.size()) != ext,
+        std::runtime_error,"Error, invalid rawv file: " << trimmed_name);
+      trimmed_name = trimmed_name.substr(0, trimmed_name.size() - ext.size());
+      std::vector<std::string> & files = file_it==0 ? image_files : stereo_image_files;
+      std::stringstream ref_rawv_ss;
+      ref_rawv_ss << trimmed_name << "_frame_" << ref_index << ext;
+      files.push_back(ref_rawv_ss.str());
+      for(int_t i=start_index;i<=end_index;i+=skip_index){
+        std::stringstream def_rawv_ss;
+        def_rawv_ss << trimmed_name << "_frame_" << i << ext;
+        files.push_back(def_rawv_ss.str());
+      }
+    }
+  } // end rawv file
 #if DICE_ENABLE_NETCDF
   else if(params->isParameter(DICe::netcdf_file)){
     TEUCHOS_TEST_FOR_EXCEPTION(params->isParameter(DICe::reference_image),std::runtime_error,
@@ -816,10 +909,28 @@ void generate_template_input_files(const std::string & file_prefix){
   write_xml_comment(inputFile,"Write a separate output file for each subset with all frames in that file (default is to write one file per frame with all subsets)");
   write_xml_bool_param(inputFile,DICe::create_separate_run_info_file,"false",false);
   write_xml_comment(inputFile,"Write a separate output file that has the header information rather than place it at the top of the output files");
+  write_xml_bool_param(inputFile,DICe::binary_output_files,"false",false);
+  write_xml_comment(inputFile,"Write the results for all frames to one binary file (<prefix>.dbr) rather than text files, see DICe_BinaryResultsToText");
+  write_xml_size_param(inputFile,DICe::num_async_output_frames,"0",false);
+  write_xml_comment(inputFile,"Write the output on a background thread with up to this many frames queued, so the next frame is correlated while the output is written");
+  write_xml_size_param(inputFile,DICe::subset_major_batch_frames,"0",false);
+  write_xml_comment(inputFile,"For the tracking routine, correlate each subset over a batch of this many frames before moving on to the next subset (the subsets must be independent)");
+  write_xml_size_param(inputFile,DICe::output_frequency,"1",false);
+  write_xml_comment(inputFile,"Run the post processors and write the output only for every n-th frame and the last frame, the frames in between are still correlated to track the motion");
+  write_xml_real_param(inputFile,DICe::rebalance_imbalance_threshold,"0.0",false);
+  write_xml_comment(inputFile,"For parallel runs, move subsets between processors after a frame if the most expensive processor took more than this factor times the average (e.g. 1.5, 0 never moves subsets)");
+  write_xml_bool_param(inputFile,DICe::use_frame_parallel_decomposition,"false",false);
+  write_xml_comment(inputFile,"For parallel runs that are not incremental, give each processor a range of frames with all the subsets rather than splitting the subsets among the processors");
+  write_xml_string_param(inputFile,DICe::checkpoint_file,"<path>");
+  write_xml_size_param(inputFile,DICe::checkpoint_frequency,"0",false);
+  write_xml_bool_param(inputFile,DICe::restart_from_checkpoint,"false",false);
+  write_xml_comment(inputFile,"Write the correlation state to the checkpoint file every checkpoint_frequency frames, a run with restart_from_checkpoint continues after the last checkpoint");
   write_xml_string_param(inputFile,DICe::subset_file,"<path>");
   write_xml_comment(inputFile,"Optional file to specify the coordinates of the subset centroids (cannot be used with step_size param)");
   write_xml_comment(inputFile,"The subset file should be space separated (no commas) with one integer value for the number of subsets on the first line");
   write_xml_comment(inputFile,"and a set of global x and y coordinates for each subset centroid, one point per line.");
+  write_xml_bool_param(inputFile,DICe::subset_file_cache,"false",false);
+  write_xml_comment(inputFile,"Store the parsed subset file in a binary file (<subset_file>.cache) that is used instead of parsing the subset file again while it is unchanged");
   write_xml_comment(inputFile,"There are two ways to specify the deformed images, first by listing them or by providing tokens to create a file sequence (see below)");
   write_xml_string_param(inputFile,DICe::reference_image,"<file_name>",false);
   write_xml_comment(inputFile,"If the images are not grayscale, they will be automatically converted to 8-bit grayscale.");
@@ -850,6 +961,11 @@ void generate_template_input_files(const std::string & file_prefix){
   write_xml_size_param(inputFile,DICe::cine_ref_index);
   write_xml_size_param(inputFile,DICe::cine_start_index);
   write_xml_size_param(inputFile,DICe::cine_end_index);
+  write_xml_comment(inputFile,"");
+  write_xml_comment(inputFile,"Frames can also be read from a multi-frame rawi file (see DICe_ImageToRawv for converting an image sequence).");
+  write_xml_comment(inputFile,"The frame indices are zero based. By default the first frame is the reference and all frames are analyzed,");
+  write_xml_comment(inputFile,"reference_image_index, start_image_index, end_image_index and skip_image_index can be used to select the frames.");
+  write_xml_string_param(inputFile,DICe::rawv_file);
 
   // write the correlation parameters
 
@@ -949,43 +1065,36 @@ DICE_LIB_DLL_EXPORT
 std::vector<std::string> tokenize_line(std::istream &dataFile,
   const std::string & delim,
   const bool capitalize){
-//  static int_t MAX_CHARS_PER_LINE = 512;
-  static int_t MAX_TOKENS_PER_LINE = 100;
-
-  std::vector<std::string> tokens(MAX_TOKENS_PER_LINE,"");
-
   // read an entire line into memory
   std::string buf_str;
   safeGetline(dataFile, buf_str);
-  char *buf = new char[buf_str.length() + 1];
-  strcpy(buf, buf_str.c_str());
-
-  // parse the line into blank-delimited tokens
-  int_t n = 0; // a for-loop index
-
-  // parse the line
-  char * token;
-  token = strtok(buf, delim.c_str());
-  tokens[0] = token ? token : ""; // first token
-  if(capitalize)
-    to_upper(tokens[0]);
-  bool first_char_is_pound = tokens[0].find("#") == 0;
-  if (tokens[0] != "" && tokens[0]!=parser_comment_char && !first_char_is_pound) // zero if line is blank or starts with a comment char
-  {
-    for (n = 1; n < MAX_TOKENS_PER_LINE; n++)
-    {
-      token = strtok(0, delim.c_str());
-      tokens[n] = token ? token : ""; // subsequent tokens
-      if (tokens[n]=="") break; // no more tokens
-      if(capitalize)
-        to_upper(tokens[n]); // convert the string to upper case
+  return tokenize_line(buf_str,delim,capitalize);
+}
+
+DICE_LIB_DLL_EXPORT
+std::vector<std::string> tokenize_line(const std::string & line,
+  const std::string & delim,
+  const bool capitalize){
+  static int_t MAX_TOKENS_PER_LINE = 100;
+
+  std::vector<std::string> tokens;
+
+  // parse the line into delimited tokens, runs of delimiters count as one
+  // (the same splitting as strtok, but without the hidden state so lines can be split on multiple threads)
+  size_t pos = line.find_first_not_of(delim);
+  while(pos!=std::string::npos&&(int_t)tokens.size()<MAX_TOKENS_PER_LINE){
+    const size_t end = line.find_first_of(delim,pos);
+    tokens.push_back(line.substr(pos,end==std::string::npos?std::string::npos:end-pos));
+    if(capitalize)
+      to_upper(tokens.back()); // convert the string to upper case
+    // zero tokens if the line starts with a comment char
+    if(tokens.size()==1&&(tokens[0]==parser_comment_char||tokens[0].find("#")==0)){
+      tokens.clear();
+      break;
     }
+    pos = end==std::string::npos ? end : line.find_first_not_of(delim,end);
   }
-  tokens.resize(n);
-  delete [] buf;
-
   return tokens;
-
 }
 
 DICE_LIB_DLL_EXPORT
@@ -998,10 +1107,477 @@ bool is_number(const std::string& s)
 }
 
 
+namespace {
+
+/// the subset file tokens are split on spaces and tabs (the tokenize_line() default)
+const char * const subset_file_delimiters = " \t";
+
+/// \brief finds the first tokens of a line without copying them (same splitting as tokenize_line())
+/// \param line the line to split
+/// \param max_tokens the maximum number of tokens to find
+/// \param begins [out] pointers to the first character of each token
+/// \param ends [out] pointers to one past the last character of each token
+/// returns the number of tokens found
+int_t find_tokens(const std::string & line,
+  const int_t max_tokens,
+  const char ** begins,
+  const char ** ends){
+  int_t num_tokens = 0;
+  size_t pos = line.find_first_not_of(subset_file_delimiters);
+  while(pos!=std::string::npos&&num_tokens<max_tokens){
+    const size_t end = line.find_first_of(subset_file_delimiters,pos);
+    begins[num_tokens] = line.c_str() + pos;
+    ends[num_tokens] = line.c_str() + (end==std::string::npos ? line.size() : end);
+    num_tokens++;
+    pos = end==std::string::npos ? end : line.find_first_not_of(subset_file_delimiters,end);
+  }
+  return num_tokens;
+}
+
+/// same test as is_number() for a token that has not been copied out of its line
+bool is_number(const char * begin,
+  const char * end){
+  const char * it = begin;
+  while(it != end && (std::isdigit(*it) || *it=='+' || *it=='-' || *it=='e' || *it=='E' || *it=='.'))
+    ++it;
+  return begin!=end && it == end;
+}
+
+/// checks that the subset coordinates are inside the image
+void check_subset_coordinates(const Subset_File_Info & info,
+  const std::string & fileName,
+  const int_t width,
+  const int_t height){
+  const int_t dim = 2;
+  const std::vector<scalar_t> & coords = *info.coordinates_vector;
+  for(int_t i=0;i<(int_t)coords.size()/dim;++i){
+    if(coords[i*dim]<0||(coords[i*dim]>=width&&width!=-1)){
+      TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid subset coordinate in " << fileName << " x: "  << coords[i*dim]);
+    }
+    if(coords[i*dim+1]<0||(coords[i*dim+1]>=height&&height!=-1)){
+      TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid subset coordinate in " << fileName << " y: "  << coords[i*dim+1]);
+    }
+  }
+}
+
+/// 64 bit FNV-1a hash of the subset file contents, used to check that a cache file is current
+uint64_t hash_contents(const std::string & contents){
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t i=0;i<contents.size();++i){
+    hash ^= static_cast<unsigned char>(contents[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/// first bytes of a subset cache file
+const char subset_cache_magic[8] = {'D','I','C','e','S','U','B','C'};
+/// increment if the layout of the packed Subset_File_Info changes
+const int32_t subset_cache_version = 1;
+
+/// appends the bytes of values to a buffer
+class Pack_Buffer{
+public:
+  /// constructor
+  Pack_Buffer(std::vector<char> & buffer):buffer_(buffer){}
+  /// append plain values
+  template <typename T>
+  void write_raw(const T * values, const size_t num_values){
+    const char * bytes = reinterpret_cast<const char*>(values);
+    buffer_.insert(buffer_.end(),bytes,bytes+num_values*sizeof(T));
+  }
+  void write(const int_t & value){write_raw(&value,1);}
+  void write(const scalar_t & value){write_raw(&value,1);}
+  void write(const bool & value){const char c = value ? 1 : 0; write_raw(&c,1);}
+  void write(const std::string & value){
+    write((int_t)value.size());
+    write_raw(value.c_str(),value.size());
+  }
+  template <typename T1, typename T2>
+  void write(const std::pair<T1,T2> & value){write(value.first);write(value.second);}
+  template <typename T>
+  void write(const std::vector<T> & values){
+    write((int_t)values.size());
+    for(size_t i=0;i<values.size();++i) write(values[i]);
+  }
+  template <typename T>
+  void write(const std::set<T> & values){
+    write((int_t)values.size());
+    for(typename std::set<T>::const_iterator it=values.begin();it!=values.end();++it) write(*it);
+  }
+  template <typename K, typename T>
+  void write(const std::map<K,T> & values){
+    write((int_t)values.size());
+    for(typename std::map<K,T>::const_iterator it=values.begin();it!=values.end();++it){write(it->first);write(it->second);}
+  }
+  void write(const Motion_Window_Params & value){
+    write(value.start_x_);write(value.start_y_);write(value.end_x_);write(value.end_y_);write(value.tol_);
+    write(value.use_subset_id_);write(value.use_motion_detection_);write(value.sub_image_id_);
+  }
+  void write(const Boundary_Condition_Def & value){
+    write(value.region_);write(value.shape_id_);write(value.left_vertex_id_);write(value.right_vertex_id_);write(value.has_value_);
+    write(value.value_);write(value.comp_);write(value.use_subsets_);write(value.subset_size_);write(value.is_neumann_);
+  }
+  void write(const Teuchos::RCP<Shape> & shape){
+    Teuchos::RCP<Circle> circle = Teuchos::rcp_dynamic_cast<Circle>(shape);
+    Teuchos::RCP<Polygon> polygon = Teuchos::rcp_dynamic_cast<Polygon>(shape);
+    Teuchos::RCP<Rectangle> rectangle = Teuchos::rcp_dynamic_cast<Rectangle>(shape);
+    if(circle!=Teuchos::null){
+      write((int_t)0);write(circle->centroid_x());write(circle->centroid_y());write(circle->radius());
+    }
+    else if(polygon!=Teuchos::null){
+      // the first vertex is repeated at the end of the polygon vertices, the constructor adds it back
+      const int_t num_vertices = polygon->num_vertices();
+      write((int_t)1);write(num_vertices);
+      write_raw(&(*polygon->vertex_coordinates_x())[0],num_vertices);
+      write_raw(&(*polygon->vertex_coordinates_y())[0],num_vertices);
+    }
+    else if(rectangle!=Teuchos::null){
+      write((int_t)2);write(rectangle->centroid_x());write(rectangle->centroid_y());write(rectangle->width());write(rectangle->height());
+    }
+    else{
+      TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, unknown shape type in a conformal area def");
+    }
+  }
+  void write(const Conformal_Area_Def & value){
+    write(value.has_boundary());
+    if(value.has_boundary()) write(*value.boundary());
+    write(value.has_excluded_area());
+    if(value.has_excluded_area()) write(*value.excluded_area());
+    write(value.has_obstructed_area());
+    if(value.has_obstructed_area()) write(*value.obstructed_area());
+  }
+private:
+  /// the buffer to append to
+  std::vector<char> & buffer_;
+};
+
+/// reads values from a buffer written by Pack_Buffer
+class Unpack_Buffer{
+public:
+  /// constructor
+  Unpack_Buffer(const std::vector<char> & buffer):buffer_(buffer),pos_(0){}
+  /// read plain values
+  template <typename T>
+  void read_raw(T * values, const size_t num_values){
+    TEUCHOS_TEST_FOR_EXCEPTION(pos_+num_values*sizeof(T)>buffer_.size(),std::runtime_error,"Error, the packed subset file info is truncated");
+    if(num_values>0) std::memcpy(values,&buffer_[pos_],num_values*sizeof(T));
+    pos_ += num_values*sizeof(T);
+  }
+  /// read a container size
+  int_t read_size(){
+    int_t size = 0;
+    read(size);
+    TEUCHOS_TEST_FOR_EXCEPTION(size<0||(size_t)size>buffer_.size()-pos_,std::runtime_error,"Error, invalid size in the packed subset file info");
+    return size;
+  }
+  void read(int_t & value){read_raw(&value,1);}
+  void read(scalar_t & value){read_raw(&value,1);}
+  void read(bool & value){char c = 0; read_raw(&c,1); value = c!=0;}
+  void read(std::string & value){
+    value.resize(read_size());
+    if(!value.empty()) read_raw(&value[0],value.size());
+  }
+  template <typename T1, typename T2>
+  void read(std::pair<T1,T2> & value){read(value.first);read(value.second);}
+  template <typename T>
+  void read(std::vector<T> & values){
+    values.resize(read_size());
+    for(size_t i=0;i<values.size();++i) read(values[i]);
+  }
+  template <typename T>
+  void read(std::set<T> & values){
+    values.clear();
+    const int_t size = read_size();
+    for(int_t i=0;i<size;++i){T value; read(value); values.insert(value);}
+  }
+  template <typename K, typename T>
+  void read(std::map<K,T> & values){
+    values.clear();
+    const int_t size = read_size();
+    for(int_t i=0;i<size;++i){K key; read(key); read(values[key]);}
+  }
+  void read(Motion_Window_Params & value){
+    read(value.start_x_);read(value.start_y_);read(value.end_x_);read(value.end_y_);read(value.tol_);
+    read(value.use_subset_id_);read(value.use_motion_detection_);read(value.sub_image_id_);
+  }
+  void read(Boundary_Condition_Def & value){
+    read(value.region_);read(value.shape_id_);read(value.left_vertex_id_);read(value.right_vertex_id_);read(value.has_value_);
+    read(value.value_);read(value.comp_);read(value.use_subsets_);read(value.subset_size_);read(value.is_neumann_);
+  }
+  void read(Teuchos::RCP<Shape> & shape){
+    int_t type = -1;
+    read(type);
+    if(type==0){
+      int_t cx = 0, cy = 0;
+      scalar_t radius = 0.0;
+      read(cx);read(cy);read(radius);
+      shape = Teuchos::rcp(new Circle(cx,cy,radius));
+    }
+    else if(type==1){
+      const int_t num_vertices = read_size();
+      std::vector<int_t> vertices_x(num_vertices);
+      std::vector<int_t> vertices_y(num_vertices);
+      read_raw(&vertices_x[0],num_vertices);
+      read_raw(&vertices_y[0],num_vertices);
+      shape = Teuchos::rcp(new Polygon(vertices_x,vertices_y));
+    }
+    else if(type==2){
+      int_t cx = 0, cy = 0, width = 0, height = 0;
+      read(cx);read(cy);read(width);read(height);
+      shape = Teuchos::rcp(new Rectangle(cx,cy,width,height));
+    }
+    else{
+      TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, unknown shape type in the packed subset file info: " << type);
+    }
+  }
+  void read(Conformal_Area_Def & value){
+    bool has_boundary = false, has_excluded = false, has_obstructed = false;
+    multi_shape boundary, excluded, obstructed;
+    read(has_boundary);
+    if(has_boundary) read(boundary);
+    read(has_excluded);
+    if(has_excluded) read(excluded);
+    read(has_obstructed);
+    if(has_obstructed) read(obstructed);
+    value = has_boundary ? Conformal_Area_Def(boundary,excluded,obstructed) : Conformal_Area_Def();
+  }
+  /// returns true if all of the buffer has been read
+  bool done()const{
+    return pos_==buffer_.size();
+  }
+private:
+  /// the buffer to read from
+  const std::vector<char> & buffer_;
+  /// the current read position
+  size_t pos_;
+};
+
+/// \brief reads a subset cache file, returns the info if the cache matches the contents of the subset file (null otherwise)
+/// \param cache_name the name of the cache file
+/// \param contents the contents of the subset file
+Teuchos::RCP<Subset_File_Info> read_subset_cache(const std::string & cache_name,
+  const std::string & contents){
+  std::ifstream cache_file(cache_name.c_str(),std::ios::in|std::ios::binary);
+  if(!cache_file.good()) return Teuchos::null;
+  char magic[sizeof(subset_cache_magic)];
+  int32_t version = 0, scalar_size = 0, int_size = 0;
+  uint64_t contents_size = 0, contents_hash = 0, packed_size = 0;
+  cache_file.read(magic,sizeof(magic));
+  cache_file.read(reinterpret_cast<char*>(&version),sizeof(version));
+  cache_file.read(reinterpret_cast<char*>(&scalar_size),sizeof(scalar_size));
+  cache_file.read(reinterpret_cast<char*>(&int_size),sizeof(int_size));
+  cache_file.read(reinterpret_cast<char*>(&contents_size),sizeof(contents_size));
+  cache_file.read(reinterpret_cast<char*>(&contents_hash),sizeof(contents_hash));
+  cache_file.read(reinterpret_cast<char*>(&packed_size),sizeof(packed_size));
+  if(!cache_file.good()||std::memcmp(magic,subset_cache_magic,sizeof(magic))!=0||version!=subset_cache_version
+      ||scalar_size!=(int32_t)sizeof(scalar_t)||int_size!=(int32_t)sizeof(int_t)
+      ||contents_size!=contents.size()||contents_hash!=hash_contents(contents)){
+    DEBUG_MSG("read_subset_cache(): cache file " << cache_name << " is out of date");
+    return Teuchos::null;
+  }
+  std::vector<char> packed(packed_size);
+  if(packed_size>0) cache_file.read(&packed[0],packed_size);
+  if(!cache_file.good()) return Teuchos::null;
+  DEBUG_MSG("read_subset_cache(): using the cache file " << cache_name);
+  return unpack_subset_file_info(packed);
+}
+
+/// \brief writes a subset cache file (failures are not an error, the file is just parsed again next time)
+/// \param cache_name the name of the cache file
+/// \param contents the contents of the subset file
+/// \param packed the packed subset file info
+void write_subset_cache(const std::string & cache_name,
+  const std::string & contents,
+  const std::vector<char> & packed){
+  // write to a temporary file first so that a partial file is never read
+  const std::string tmp_name = cache_name + ".tmp";
+  {
+    std::ofstream cache_file(tmp_name.c_str(),std::ios::out|std::ios::binary|std::ios::trunc);
+    if(!cache_file.good()){
+      DEBUG_MSG("write_subset_cache(): could not create the cache file " << cache_name);
+      return;
+    }
+    const int32_t scalar_size = sizeof(scalar_t);
+    const int32_t int_size = sizeof(int_t);
+    const uint64_t contents_size = contents.size();
+    const uint64_t contents_hash = hash_contents(contents);
+    const uint64_t packed_size = packed.size();
+    cache_file.write(subset_cache_magic,sizeof(subset_cache_magic));
+    cache_file.write(reinterpret_cast<const char*>(&subset_cache_version),sizeof(subset_cache_version));
+    cache_file.write(reinterpret_cast<const char*>(&scalar_size),sizeof(scalar_size));
+    cache_file.write(reinterpret_cast<const char*>(&int_size),sizeof(int_size));
+    cache_file.write(reinterpret_cast<const char*>(&contents_size),sizeof(contents_size));
+    cache_file.write(reinterpret_cast<const char*>(&contents_hash),sizeof(contents_hash));
+    cache_file.write(reinterpret_cast<const char*>(&packed_size),sizeof(packed_size));
+    if(packed_size>0) cache_file.write(&packed[0],packed_size);
+    if(!cache_file.good()){
+      DEBUG_MSG("write_subset_cache(): could not write the cache file " << cache_name);
+      cache_file.close();
+      std::remove(tmp_name.c_str());
+      return;
+    }
+  }
+  std::remove(cache_name.c_str());
+  if(std::rename(tmp_name.c_str(),cache_name.c_str())!=0){
+    DEBUG_MSG("write_subset_cache(): could not rename the cache file " << tmp_name);
+    std::remove(tmp_name.c_str());
+  }
+}
+
+/// \brief reads the subset file (or its cache) and parses it
+/// \param fileName the name of the subset file
+/// \param use_cache true if the cache file should be used
+/// \param write_cache true if the cache file can be written
+Teuchos::RCP<Subset_File_Info> load_subset_file(const std::string & fileName,
+  const bool use_cache,
+  const bool write_cache){
+  // the whole file is read in one buffered read and parsed from memory
+  std::ifstream dataFile(fileName.c_str(),std::ios::in|std::ios::binary);
+  TEUCHOS_TEST_FOR_EXCEPTION(!dataFile.good(), std::runtime_error, "Error, the subset file does not exist: " << fileName);
+  std::stringstream contents_stream;
+  contents_stream << dataFile.rdbuf();
+  dataFile.close();
+  const std::string contents = contents_stream.str();
+  const std::string cache_name = fileName + ".cache";
+  if(use_cache){
+    Teuchos::RCP<Subset_File_Info> info = read_subset_cache(cache_name,contents);
+    if(info!=Teuchos::null) return info;
+  }
+  std::istringstream data_stream(contents);
+  Teuchos::RCP<Subset_File_Info> info = parse_subset_file(data_stream,fileName);
+  if(use_cache&&write_cache){
+    std::vector<char> packed;
+    pack_subset_file_info(*info,packed);
+    write_subset_cache(cache_name,contents,packed);
+  }
+  return info;
+}
+
+} // end anonymous namespace
+
+DICE_LIB_DLL_EXPORT
+void pack_subset_file_info(const Subset_File_Info & info,
+  std::vector<char> & buffer){
+  buffer.clear();
+  Pack_Buffer pack(buffer);
+  pack.write((int_t)info.type);
+  pack.write(*info.conformal_area_defs);
+  pack.write(*info.coordinates_vector);
+  pack.write(*info.neighbor_vector);
+  pack.write(*info.id_sets_map);
+  pack.write(*info.force_simplex);
+  pack.write(*info.size_map);
+  pack.write(*info.displacement_map);
+  pack.write(*info.normal_strain_map);
+  pack.write(*info.shear_strain_map);
+  pack.write(*info.rotation_map);
+  pack.write(*info.seed_subset_ids);
+  pack.write(*info.path_file_names);
+  pack.write(*info.optical_flow_flags);
+  pack.write(*info.skip_solve_flags);
+  pack.write(*info.motion_window_params);
+  pack.write(info.num_motion_windows);
+  pack.write(*info.boundary_condition_defs);
+  pack.write(info.use_regular_grid);
+  pack.write(info.ic_value_x);
+  pack.write(info.ic_value_y);
+  pack.write(info.enforce_lagrange_bc);
+}
+
+DICE_LIB_DLL_EXPORT
+Teuchos::RCP<Subset_File_Info> unpack_subset_file_info(const std::vector<char> & buffer){
+  Unpack_Buffer unpack(buffer);
+  int_t type = 0;
+  unpack.read(type);
+  Teuchos::RCP<Subset_File_Info> info = Teuchos::rcp(new Subset_File_Info(static_cast<Subset_File_Info_Type>(type)));
+  unpack.read(*info->conformal_area_defs);
+  unpack.read(*info->coordinates_vector);
+  unpack.read(*info->neighbor_vector);
+  unpack.read(*info->id_sets_map);
+  unpack.read(*info->force_simplex);
+  unpack.read(*info->size_map);
+  unpack.read(*info->displacement_map);
+  unpack.read(*info->normal_strain_map);
+  unpack.read(*info->shear_strain_map);
+  unpack.read(*info->rotation_map);
+  unpack.read(*info->seed_subset_ids);
+  unpack.read(*info->path_file_names);
+  unpack.read(*info->optical_flow_flags);
+  unpack.read(*info->skip_solve_flags);
+  unpack.read(*info->motion_window_params);
+  unpack.read(info->num_motion_windows);
+  unpack.read(*info->boundary_condition_defs);
+  unpack.read(info->use_regular_grid);
+  unpack.read(info->ic_value_x);
+  unpack.read(info->ic_value_y);
+  unpack.read(info->enforce_lagrange_bc);
+  TEUCHOS_TEST_FOR_EXCEPTION(!unpack.done(),std::runtime_error,"Error, the packed subset file info has extra bytes");
+  return info;
+}
+
 DICE_LIB_DLL_EXPORT
 const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileName,
   const int_t width,
-  const int_t height){
+  const int_t height,
+  const bool broadcast,
+  const bool use_cache){
+  int proc_rank = 0;
+  int num_procs = 1;
+#if DICE_MPI
+  int mpi_is_initialized = 0;
+  MPI_Initialized(&mpi_is_initialized);
+  if(mpi_is_initialized){
+    MPI_Comm_rank(MPI_COMM_WORLD,&proc_rank);
+    MPI_Comm_size(MPI_COMM_WORLD,&num_procs);
+  }
+#endif
+  const bool use_broadcast = broadcast && num_procs > 1;
+  if(proc_rank==0) DEBUG_MSG("Reading the subset file " << fileName << (use_broadcast ? " (parsed on processor 0 and broadcast)" : "")
+    << (use_cache ? " (with cache)" : ""));
+
+  Teuchos::RCP<Subset_File_Info> info;
+  if(!use_broadcast){
+    // only processor 0 writes the cache file so that processors don't write the same file at the same time
+    info = load_subset_file(fileName,use_cache,proc_rank==0);
+  }
+#if DICE_MPI
+  else{
+    // processor 0 parses the file, the error message (if any) and the packed info are sent to the others
+    std::vector<char> packed;
+    std::string error_msg;
+    if(proc_rank==0){
+      try{
+        info = load_subset_file(fileName,use_cache,true);
+        pack_subset_file_info(*info,packed);
+      }
+      catch(std::exception & e){
+        error_msg = e.what();
+        if(error_msg.empty()) error_msg = "Error reading the subset file " + fileName;
+      }
+    }
+    long long sizes[2] = {(long long)error_msg.size(),(long long)packed.size()};
+    MPI_Bcast(sizes,2,MPI_LONG_LONG,0,MPI_COMM_WORLD);
+    if(sizes[0]>0){
+      error_msg.resize(sizes[0]);
+      MPI_Bcast(&error_msg[0],sizes[0],MPI_CHAR,0,MPI_COMM_WORLD);
+      TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,error_msg);
+    }
+    packed.resize(sizes[1]);
+    if(sizes[1]>0)
+      MPI_Bcast(&packed[0],sizes[1],MPI_CHAR,0,MPI_COMM_WORLD);
+    if(proc_rank!=0)
+      info = unpack_subset_file_info(packed);
+  }
+#endif
+  TEUCHOS_TEST_FOR_EXCEPTION(info==Teuchos::null,std::runtime_error,"Error reading the subset file " << fileName);
+  check_subset_coordinates(*info,fileName,width,height);
+  return info;
+}
+
+DICE_LIB_DLL_EXPORT
+Teuchos::RCP<Subset_File_Info> parse_subset_file(std::istream & dataFile,
+  const std::string & fileName){
   int proc_rank = 0;
 #if DICE_MPI
   int mpi_is_initialized = 0;
@@ -1014,10 +1590,11 @@ const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileNa
   Teuchos::RCP<Subset_File_Info> info = Teuchos::rcp(new Subset_File_Info());
   // NOTE: assumes 2D coordinates
   const int_t dim = 2;
-  std::fstream dataFile(fileName.c_str(), std::ios_base::in);
-  TEUCHOS_TEST_FOR_EXCEPTION(!dataFile.good(), std::runtime_error, "Error, the subset file does not exist: " << fileName);
-
-  if(proc_rank==0) DEBUG_MSG("Reading the subset file " << fileName);
+  // the lines with only numbers (coordinates, vertices, ids) make up most of a large file,
+  // they are split in place without copying the tokens
+  std::string line;
+  const char * token_begins[2];
+  const char * token_ends[2];
 
   bool coordinates_defined = false;
   bool conformal_subset_defined = false;
@@ -1045,16 +1622,19 @@ const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileNa
          coordinates_defined = true;
          // read more lines until parser end is reached
          while(!dataFile.eof()){
-           std::vector<std::string> block_tokens = tokenize_line(dataFile);
-           if(block_tokens.size()==0) continue; // blank line or comment
-           else if(block_tokens[0]==parser_end) break; // end of the list
-           else if(is_number(block_tokens[0])){ // set of coordinates
-             if(block_tokens.size()<2){TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid coordinate (not enough values)" << fileName);}
-             info->coordinates_vector->push_back(strtod(block_tokens[0].c_str(),NULL));
-             if(block_tokens[1]==parser_comment_char){TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid coordinate (not enough values)" << fileName);}
-             info->coordinates_vector->push_back(strtod(block_tokens[1].c_str(),NULL));
+           safeGetline(dataFile,line);
+           const int_t num_tokens = find_tokens(line,2,token_begins,token_ends);
+           if(num_tokens>0&&is_number(token_begins[0],token_ends[0])){ // set of coordinates
+             if(num_tokens<2){TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid coordinate (not enough values)" << fileName);}
+             info->coordinates_vector->push_back(strtod(token_begins[0],NULL));
+             if(std::string(token_begins[1],token_ends[1])==parser_comment_char){TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid coordinate (not enough values)" << fileName);}
+             info->coordinates_vector->push_back(strtod(token_begins[1],NULL));
              info->neighbor_vector->push_back(-1); // neighbor_id
+             continue;
            }
+           std::vector<std::string> block_tokens = tokenize_line(line);
+           if(block_tokens.size()==0) continue; // blank line or comment
+           else if(block_tokens[0]==parser_end) break; // end of the list
            else{ // or error
              TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error parsing subset coordinates: " << fileName << " "  << block_tokens[0]);
            }
@@ -1063,13 +1643,8 @@ const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileNa
          TEUCHOS_TEST_FOR_EXCEPTION(info->coordinates_vector->size()<2,std::runtime_error,"");
          TEUCHOS_TEST_FOR_EXCEPTION(info->coordinates_vector->size()/2!=info->neighbor_vector->size(),std::runtime_error,"");
          TEUCHOS_TEST_FOR_EXCEPTION(info->coordinates_vector->size()%2!=0,std::runtime_error,"");
+         // the coordinates are checked against the image size by read_subset_file()
          for(int_t i=0;i<(int_t)info->coordinates_vector->size()/dim;++i){
-           if((*info->coordinates_vector)[i*dim]<0||((*info->coordinates_vector)[i*dim]>=width&&width!=-1)){
-             TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid subset coordinate in " << fileName << " x: "  << (*info->coordinates_vector)[i*dim]);
-           }
-           if((*info->coordinates_vector)[i*dim+1]<0||((*info->coordinates_vector)[i*dim+1]>=height&&height!=-1)){
-             TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error: invalid subset coordinate in " << fileName << " y: "  << (*info->coordinates_vector)[i*dim+1]);
-           }
            if(proc_rank==0) DEBUG_MSG("Subset coord: (" << (*info->coordinates_vector)[i*dim] << "," << (*info->coordinates_vector)[i*dim+1] << ")");
          }
        }
@@ -1464,7 +2039,12 @@ const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileNa
              else if(block_tokens[1]==parser_blocking_subsets){
                if(proc_rank==0) DEBUG_MSG("Reading blocking subsets");
                while(!dataFile.eof()){
-                 std::vector<std::string> id_tokens = tokenize_line(dataFile);
+                 safeGetline(dataFile,line);
+                 if(find_tokens(line,1,token_begins,token_ends)==1&&is_number(token_begins[0],token_ends[0])){
+                   blocking_ids.push_back(strtol(token_begins[0],NULL,0));
+                   continue;
+                 }
+                 std::vector<std::string> id_tokens = tokenize_line(line);
                  if(id_tokens.size()==0) continue;
                  if(id_tokens[0]==parser_end) break;
                  TEUCHOS_TEST_FOR_EXCEPTION(!is_number(id_tokens[0]),std::runtime_error,"");
@@ -1520,7 +2100,6 @@ const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileNa
        }
      }
    }
-  dataFile.close();
   if(roi_defined){
     TEUCHOS_TEST_FOR_EXCEPTION(coordinates_defined || conformal_subset_defined,std::runtime_error,"Error, if a region of interest in defined, the coordinates"
         " cannot be specified, nor can conformal subset definitions.");
@@ -1552,7 +2131,7 @@ const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileNa
 }
 
 DICE_LIB_DLL_EXPORT
-Teuchos::RCP<Circle> read_circle(std::fstream &dataFile){
+Teuchos::RCP<Circle> read_circle(std::istream &dataFile){
   int proc_rank = 0;
 #if DICE_MPI
   int mpi_is_initialized = 0;
@@ -1594,7 +2173,7 @@ Teuchos::RCP<Circle> read_circle(std::fstream &dataFile){
 }
 
 DICE_LIB_DLL_EXPORT
-Teuchos::RCP<DICe::Rectangle> read_rectangle(std::fstream &dataFile){
+Teuchos::RCP<DICe::Rectangle> read_rectangle(std::istream &dataFile){
   int proc_rank = 0;
 #if DICE_MPI
   int mpi_is_initialized = 0;
@@ -1688,7 +2267,7 @@ Teuchos::RCP<DICe::Rectangle> read_rectangle(std::fstream &dataFile){
 }
 
 DICE_LIB_DLL_EXPORT
-Teuchos::RCP<DICe::Polygon> read_polygon(std::fstream &dataFile){
+Teuchos::RCP<DICe::Polygon> read_polygon(std::istream &dataFile){
   int proc_rank = 0;
 #if DICE_MPI
   int mpi_is_initialized = 0;
@@ -1709,8 +2288,18 @@ Teuchos::RCP<DICe::Polygon> read_polygon(std::fstream &dataFile){
     TEUCHOS_TEST_FOR_EXCEPTION(tokens[0]!=parser_begin,std::runtime_error,"");
     TEUCHOS_TEST_FOR_EXCEPTION(tokens[1]!=parser_vertices,std::runtime_error,"");
     // read the vertices
+    std::string line;
+    const char * token_begins[2];
+    const char * token_ends[2];
     while(!dataFile.eof()){
-      std::vector<std::string> vertex_tokens = tokenize_line(dataFile);
+      safeGetline(dataFile,line);
+      // vertices are split in place without copying the tokens
+      if(find_tokens(line,2,token_begins,token_ends)==2&&is_number(token_begins[0],token_ends[0])&&is_number(token_begins[1],token_ends[1])){
+        vertices_x.push_back(strtol(token_begins[0],NULL,0));
+        vertices_y.push_back(strtol(token_begins[1],NULL,0));
+        continue;
+      }
+      std::vector<std::string> vertex_tokens = tokenize_line(line);
       if(vertex_tokens.size()==0)continue;
       if(vertex_tokens[0]==parser_end) break;
       TEUCHOS_TEST_FOR_EXCEPTION(vertex_tokens.size()<2,std::runtime_error,"");
@@ -1732,7 +2321,7 @@ Teuchos::RCP<DICe::Polygon> read_polygon(std::fstream &dataFile){
 }
 
 DICE_LIB_DLL_EXPORT
-multi_shape read_shapes(std::fstream & dataFile){
+multi_shape read_shapes(std::istream & dataFile){
   DICe::multi_shape multi_shape;
   while(!dataFile.eof()){
     std::vector<std::string> shape_tokens = tokenize_line(dataFile);
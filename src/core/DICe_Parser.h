@@ -69,6 +69,8 @@ const char* const subset_size = "subset_size";
 const char* const step_size = "step_size";
 /// Optional input parameter to specify the x and y coordinates of the subset centroids
 const char* const subset_file = "subset_file";
+/// Optional input parameter, store the parsed subset file in a binary cache file (<subset_file>.cache) that is reused while the subset file is unchanged
+const char* const subset_file_cache = "subset_file_cache";
 /// Input parameter, only for constrained optimization DIC
 const char* const mesh_file = "mesh_file";
 /// Input parameter, only for constrained optimization DIC
@@ -81,6 +83,18 @@ const char* const mesh_size = "mesh_size";
 const char* const image_edge_buffer_size = "image_edge_buffer_size";
 /// Input parameter
 const char* const print_timing = "print_timing";
+/// Input parameter, time the phases of the hot path and write a summary (timing_phases.<num_procs>.json in the output folder)
+const char* const print_phase_timing = "print_phase_timing";
+/// Input parameter, record a timeline of the run as chrome trace-event json (<prefix>.<num_procs>.<rank>.json)
+const char* const trace_file_prefix = "trace_file_prefix";
+/// Input parameter, number of spans each thread keeps for the timeline (the oldest are overwritten)
+const char* const trace_events_per_thread = "trace_events_per_thread";
+/// Input parameter, periodically write the throughput and failure rates to this file (.prom for the Prometheus text format, otherwise json lines)
+const char* const metrics_file = "metrics_file";
+/// Input parameter, minimum number of seconds between two samples in the metrics file
+const char* const metrics_interval = "metrics_interval";
+/// Input parameter, write the bytes held by each subsystem after every frame to memory.<num_procs>.<rank>.txt and print the peaks at the end
+const char* const print_memory_usage = "print_memory_usage";
 /// Input parameter
 const char* const cal_target_has_adaptive = "cal_target_has_adaptive";
 /// Input parameter
@@ -99,18 +113,54 @@ const char* const cal_target_spacing_size = "cal_target_spacing_size";
 const char* const cal_manual_skip_images = "cal_manual_skip_images";
 /// Input parameter
 const char* const cal_mode = "cal_mode";
+/// Input parameter, locate the cal target in the image downsampled by this factor and then refine each dot
+/// in a window of the full resolution image (1 locates the target at full resolution)
+const char* const cal_target_downsample_factor = "cal_target_downsample_factor";
+/// Input parameter, file that stores the cal dots located in each image by file and target parameters so they are
+/// not located again when the calibration is re-run (empty string disables the cache)
+const char* const cal_detection_cache = "cal_detection_cache";
 /// Input parameter
 const char* const print_subset_locations_and_exit = "print_subset_locations_and_exit";
+/// Input parameter, number of sample frames to correlate before printing the projected cost of the full run and exiting
+const char* const estimate_run_and_exit = "estimate_run_and_exit";
 /// Input parameter
 const char* const print_stats = "print_stats";
 /// Input parameter
 const char* const output_stereo_files = "output_stereo_files";
 /// Input parameter
 const char* const no_text_output_files = "no_text_output_files";
+/// Input parameter, write all frames to one binary results file instead of text files
+const char* const binary_output_files = "binary_output_files";
+/// Input parameter, number of deformed frames to load ahead on a background thread (0 loads each frame when it is needed)
+const char* const num_prefetch_frames = "num_prefetch_frames";
+/// Input parameter, for tracking analyses correlate each subset over a batch of this many frames before moving on to the
+/// next subset so the data of the subset stays in cache (0 or 1 correlates all subsets for each frame in turn)
+const char* const subset_major_batch_frames = "subset_major_batch_frames";
+/// Input parameter, number of frames of output that can be queued for writing on a background thread (0 writes the output before the next frame is correlated)
+const char* const num_async_output_frames = "num_async_output_frames";
+/// Input parameter, post process and write the output only for every n-th frame (and the last frame), the other frames are still correlated
+const char* const output_frequency = "output_frequency";
+/// Input parameter, redistribute the subsets among processors between frames if the max over the average processor cost exceeds this value (0 never rebalances)
+const char* const rebalance_imbalance_threshold = "rebalance_imbalance_threshold";
+/// Input parameter, split the frames rather than the subsets among the processors (each processor correlates all subsets for a contiguous range of frames)
+const char* const use_frame_parallel_decomposition = "use_frame_parallel_decomposition";
+/// Input parameter, correlate the left and right cameras of each stereo frame at the same time on two threads (requires one processor
+/// or use_frame_parallel_decomposition, each schema still uses num_threads threads for its subsets)
+const char* const concurrent_stereo_correlation = "concurrent_stereo_correlation";
+/// Input parameter, write the correlation state to this binary file every checkpoint_frequency frames
+/// (with more than one processor each writes <file>.<num_procs>.<rank>)
+const char* const checkpoint_file = "checkpoint_file";
+/// Input parameter, number of frames between checkpoints (0 never writes one)
+const char* const checkpoint_frequency = "checkpoint_frequency";
+/// Input parameter, restart the analysis after the last frame stored in the checkpoint_file
+const char* const restart_from_checkpoint = "restart_from_checkpoint";
 /// Input parameter
 const char* const correlation_parameters_file = "correlation_parameters_file";
 /// Input parameter
 const char* const calibration_parameters_file = "calibration_parameters_file";
+/// Input parameter, reuse the stereo cross-correlation stored in this binary file if it was computed from the same reference images,
+/// calibration and subsets (otherwise the cross-correlation is computed and written to the file)
+const char* const cross_correlation_cache_file = "cross_correlation_cache_file";
 /// Input parameter
 const char* const physics_parameters_file = "physics_parameters_file";
 // For simple two image correlation
@@ -129,6 +179,10 @@ const char* const stereo_deformed_images = "stereo_deformed_images";
 /// Input parameter
 const char* const netcdf_file = "netcdf_file";
 /// Input parameter
+const char* const rawv_file = "rawv_file";
+/// Input parameter
+const char* const stereo_rawv_file = "stereo_rawv_file";
+/// Input parameter
 const char* const cine_file = "cine_file";
 /// Input parameter
 const char* const cine_ref_index = "cine_ref_index";
@@ -413,6 +467,15 @@ std::vector<std::string> tokenize_line(std::istream &dataFile,
   const std::string & delim=" \t",
   const bool capitalize = true);
 
+/// \brief Turns a line of text into tokens (safe to call from multiple threads)
+/// \param line the line to split
+/// \param delim Delimiter character
+/// \param capitalize true if the tokens should be automatically capitalized
+DICE_LIB_DLL_EXPORT
+std::vector<std::string> tokenize_line(const std::string & line,
+  const std::string & delim=" \t",
+  const bool capitalize = true);
+
 /// \brief Determines if a string is a number
 /// \param s Input string
 DICE_LIB_DLL_EXPORT
@@ -422,32 +485,56 @@ bool is_number(const std::string& s);
 /// \param fileName String name of the file that defines the subsets
 /// \param width The image width (used to check for valid coords)
 /// \param height The image height (used to check for valid coords)
+/// \param broadcast true if processor 0 should parse the file and send the result to the other processors
+/// (must then be called by all processors)
+/// \param use_cache true if the parsed file should be stored in a binary cache file (<fileName>.cache) that is reused
+/// as long as the contents of the subset file do not change
 /// TODO add conformal subset notes here.
 DICE_LIB_DLL_EXPORT
 const Teuchos::RCP<Subset_File_Info> read_subset_file(const std::string & fileName,
   const int_t width=-1,
-  const int_t height=-1);
+  const int_t height=-1,
+  const bool broadcast=false,
+  const bool use_cache=false);
 
+/// \brief Parse the subset definitions from a stream (used by read_subset_file())
+/// \param dataFile the stream to read from
+/// \param fileName the name of the file (only used for error messages)
+DICE_LIB_DLL_EXPORT
+Teuchos::RCP<Subset_File_Info> parse_subset_file(std::istream & dataFile,
+  const std::string & fileName);
+
+/// \brief Serialize a Subset_File_Info to a buffer of bytes (used for the subset cache and broadcasting)
+/// \param info the info to serialize
+/// \param buffer [out] the bytes
+DICE_LIB_DLL_EXPORT
+void pack_subset_file_info(const Subset_File_Info & info,
+  std::vector<char> & buffer);
+
+/// \brief Create a Subset_File_Info from a buffer written by pack_subset_file_info()
+/// \param buffer the bytes
+DICE_LIB_DLL_EXPORT
+Teuchos::RCP<Subset_File_Info> unpack_subset_file_info(const std::vector<char> & buffer);
 
 /// \brief Read a circle from the input file
-/// \param dataFile fstream file to read line from (assumed to be open)
+/// \param dataFile stream to read lines from (assumed to be open)
 DICE_LIB_DLL_EXPORT
-Teuchos::RCP<DICe::Circle> read_circle(std::fstream &dataFile);
+Teuchos::RCP<DICe::Circle> read_circle(std::istream &dataFile);
 
 /// \brief Read a circle from the input file
-/// \param dataFile fstream file to read line from (assumed to be open)
+/// \param dataFile stream to read lines from (assumed to be open)
 DICE_LIB_DLL_EXPORT
-Teuchos::RCP<DICe::Rectangle> read_rectangle(std::fstream &dataFile);
+Teuchos::RCP<DICe::Rectangle> read_rectangle(std::istream &dataFile);
 
 /// \brief Read a polygon from the input file
-/// \param dataFile fstream file to read line from (assumed to be open)
+/// \param dataFile stream to read lines from (assumed to be open)
 DICE_LIB_DLL_EXPORT
-Teuchos::RCP<DICe::Polygon> read_polygon(std::fstream &dataFile);
+Teuchos::RCP<DICe::Polygon> read_polygon(std::istream &dataFile);
 
 /// \brief Read Several shapes from the subset file
-/// \param dataFile fstream file to read line from (assumed to be open)
+/// \param dataFile stream to read lines from (assumed to be open)
 DICE_LIB_DLL_EXPORT
-multi_shape read_shapes(std::fstream & dataFile);
+multi_shape read_shapes(std::istream & dataFile);
 
 
 
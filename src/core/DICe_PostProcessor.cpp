@@ -40,19 +40,168 @@
 // @HEADER
 
 #include <DICe_PostProcessor.h>
+#include <DICe_FrameArena.h>
 
 #include <Teuchos_LAPACK.hpp>
 #include <Teuchos_SerialDenseMatrix.hpp>
 
+#include <algorithm>
+#include <exception>
 #include <fstream>
 
 namespace DICe {
 
+Neighborhood_Cache::Neighborhood_Cache(Teuchos::RCP<DICe::mesh::Mesh> mesh):
+  mesh_(mesh),
+  num_kd_tree_builds_(0),
+  num_neighborhood_searches_(0),
+  memory_(MEMORY_NEIGHBOR_LISTS)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(mesh_==Teuchos::null,std::runtime_error,"Error, the mesh must not be null");
+}
+
+Teuchos::RCP<Neighborhood>
+Neighborhood_Cache::neighborhood(const std::string & coords_x_name,
+  const std::string & coords_y_name,
+  const scalar_t & neighborhood_radius){
+  DEBUG_MSG("Neighborhood_Cache::neighborhood(): begin");
+  const int_t local_num_points = mesh_->get_scalar_node_dist_map()->get_num_local_elements();
+  const int_t overlap_num_points = mesh_->get_scalar_node_overlap_map()->get_num_local_elements();
+
+  // gather an all owned field here
+  const int_t spa_dim = mesh_->spatial_dimension();
+  DICe::field_enums::Field_Spec coords_x_spec = mesh_->get_field_spec(coords_x_name);
+  DICe::field_enums::Field_Spec coords_y_spec = mesh_->get_field_spec(coords_y_name);
+  std::vector<scalar_t> coords(overlap_num_points*spa_dim);
+  if(coords_x_spec.get_field_type()==DICe::field_enums::SCALAR_FIELD_TYPE){
+    Teuchos::RCP<MultiField> coords_x = mesh_->get_overlap_field(coords_x_spec);
+    Teuchos::RCP<MultiField> coords_y = mesh_->get_overlap_field(coords_y_spec);
+    for(int_t i=0;i<overlap_num_points;++i){
+      coords[i*spa_dim+0] = coords_x->local_value(i);
+      coords[i*spa_dim+1] = coords_y->local_value(i);
+    }
+  }else{
+    // note assumes that the same vector field spec was given for x and y
+    Teuchos::RCP<MultiField> coords_xy = mesh_->get_overlap_field(coords_x_spec);
+    for(int_t i=0;i<overlap_num_points*spa_dim;++i)
+      coords[i] = coords_xy->local_value(i);
+  }
+
+  // the kd-tree and neighbor lists are only rebuilt if the coordinates changed
+  Coordinates_Entry & entry = entries_[std::pair<std::string,std::string>(coords_x_name,coords_y_name)];
+  if(entry.kd_tree==Teuchos::null||entry.coords!=coords){
+    // create neighborhood lists using nanoflann:
+    DEBUG_MSG("creating the point cloud using nanoflann");
+    entry.coords = coords;
+    entry.neighborhoods.clear();
+    entry.point_cloud = Teuchos::rcp(new Point_Cloud_2D<scalar_t>());
+    entry.point_cloud->pts.resize(overlap_num_points);
+    for(int_t i=0;i<overlap_num_points;++i){
+      entry.point_cloud->pts[i].x = coords[i*spa_dim+0];
+      entry.point_cloud->pts[i].y = coords[i*spa_dim+1];
+    }
+    DEBUG_MSG("building the kd-tree");
+    entry.kd_tree = Teuchos::rcp(new kd_tree_2d_t(2 /*dim*/, *entry.point_cloud.get(), nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */) ) );
+    entry.kd_tree->buildIndex();
+    num_kd_tree_builds_++;
+    DEBUG_MSG("kd-tree completed");
+  }
+  std::map<scalar_t,Teuchos::RCP<Neighborhood> >::const_iterator it = entry.neighborhoods.find(neighborhood_radius);
+  if(it!=entry.neighborhoods.end()){
+    DEBUG_MSG("Neighborhood_Cache::neighborhood(): reusing the neighbor lists for radius " << neighborhood_radius);
+    return it->second;
+  }
+
+  Teuchos::RCP<Neighborhood> neigh = Teuchos::rcp(new Neighborhood());
+  // perform a pass to size the neighbor lists
+  neigh->neighbor_list.resize(local_num_points);
+  neigh->neighbor_dist_x.resize(local_num_points);
+  neigh->neighbor_dist_y.resize(local_num_points);
+
+  scalar_t query_pt[2];
+  if(neighborhood_radius < 0){ // k-nearest search
+    const int_t num_neigh = (int_t)(-1.0*neighborhood_radius);
+    DEBUG_MSG("performing k-nearest neighbors search for " << num_neigh << " neighbors");
+    std::vector<size_t> ret_index(num_neigh);
+    std::vector<scalar_t> out_dist_sqr(num_neigh);
+    for(int_t i=0;i<local_num_points;++i){
+      // get the gid of the point
+      const int_t gid = mesh_->get_scalar_node_dist_map()->get_global_element(i);
+      // get the overlap local id of the point
+      const int_t olid = mesh_->get_scalar_node_overlap_map()->get_local_element(gid);
+      assert(olid<overlap_num_points);
+      query_pt[0] = entry.point_cloud->pts[olid].x;
+      query_pt[1] = entry.point_cloud->pts[olid].y;
+      entry.kd_tree->knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
+      for(int_t j=0;j<num_neigh;++j){
+        const int_t neigh_olid = ret_index[j];
+        neigh->neighbor_list[i].push_back(neigh_olid);
+        neigh->neighbor_dist_x[i].push_back(coords[neigh_olid*spa_dim+0] - coords[olid*spa_dim+0]);
+        neigh->neighbor_dist_y[i].push_back(coords[neigh_olid*spa_dim+1] - coords[olid*spa_dim+1]);
+      }
+    }
+  }else{ // radius search
+    std::vector<std::pair<size_t,scalar_t> > ret_matches;
+    nanoflann::SearchParams params;
+    params.sorted = true; // sort by distance in ascending order
+    const scalar_t tiny = 1.0E-5;
+    scalar_t neigh_rad_2 = neighborhood_radius*neighborhood_radius + tiny;
+    DEBUG_MSG("performing radius neighbor search with rad^2 " << neigh_rad_2);
+
+    for(int_t i=0;i<local_num_points;++i){
+      // get the gid of the point
+      const int_t gid = mesh_->get_scalar_node_dist_map()->get_global_element(i);
+      // get the overlap local id of the point
+      const int_t olid = mesh_->get_scalar_node_overlap_map()->get_local_element(gid);
+      assert(olid<overlap_num_points);
+      query_pt[0] = entry.point_cloud->pts[olid].x;
+      query_pt[1] = entry.point_cloud->pts[olid].y;
+      entry.kd_tree->radiusSearch(&query_pt[0],neigh_rad_2,ret_matches,params);
+      for(size_t j=0;j<ret_matches.size();++j){
+        const int_t neigh_olid = ret_matches[j].first;
+        neigh->neighbor_list[i].push_back(neigh_olid);
+        neigh->neighbor_dist_x[i].push_back(coords[neigh_olid*spa_dim+0] - coords[olid*spa_dim+0]);
+        neigh->neighbor_dist_y[i].push_back(coords[neigh_olid*spa_dim+1] - coords[olid*spa_dim+1]);
+      }
+    }
+  }
+  num_neighborhood_searches_++;
+  entry.neighborhoods[neighborhood_radius] = neigh;
+  update_memory_usage();
+  DEBUG_MSG("Neighborhood_Cache::neighborhood(): end");
+  return neigh;
+}
+
+void
+Neighborhood_Cache::update_memory_usage(){
+  long long bytes = 0;
+  std::map<std::pair<std::string,std::string>,Coordinates_Entry>::const_iterator it = entries_.begin();
+  for(;it!=entries_.end();++it){
+    const Coordinates_Entry & entry = it->second;
+    bytes += entry.coords.capacity()*sizeof(scalar_t);
+    if(entry.point_cloud!=Teuchos::null)
+      bytes += entry.point_cloud->pts.capacity()*sizeof(Point_Cloud_2D<scalar_t>::Point);
+    if(entry.kd_tree!=Teuchos::null)
+      bytes += entry.kd_tree->usedMemory();
+    std::map<scalar_t,Teuchos::RCP<Neighborhood> >::const_iterator neigh_it = entry.neighborhoods.begin();
+    for(;neigh_it!=entry.neighborhoods.end();++neigh_it){
+      const Neighborhood & neigh = *neigh_it->second;
+      for(size_t i=0;i<neigh.neighbor_list.size();++i){
+        bytes += neigh.neighbor_list[i].capacity()*sizeof(int_t)
+            + (neigh.neighbor_dist_x[i].capacity() + neigh.neighbor_dist_y[i].capacity())*sizeof(scalar_t);
+      }
+      bytes += neigh.neighbor_list.size()*(sizeof(std::vector<int_t>) + 2*sizeof(std::vector<scalar_t>));
+    }
+  }
+  memory_.set(bytes);
+}
+
 Post_Processor::Post_Processor(const std::string & name) :
   name_(name),
   local_num_points_(0),
   overlap_num_points_(0),
   neighborhood_initialized_(false),
+  num_threads_(1),
   coords_x_name_(DICe::field_enums::INITIAL_COORDINATES_FS.get_name_label()),
   coords_y_name_(DICe::field_enums::INITIAL_COORDINATES_FS.get_name_label()),
   disp_x_name_(DICe::field_enums::DISPLACEMENT_FS.get_name_label()),
@@ -61,9 +210,15 @@ Post_Processor::Post_Processor(const std::string & name) :
 {}
 
 void
-Post_Processor::initialize(Teuchos::RCP<DICe::mesh::Mesh> & mesh){
+Post_Processor::initialize(Teuchos::RCP<DICe::mesh::Mesh> & mesh,
+  Teuchos::RCP<Neighborhood_Cache> neighborhood_cache){
   mesh_ = mesh;
   assert(mesh_!=Teuchos::null);
+  neighborhood_cache_ = neighborhood_cache==Teuchos::null ? Teuchos::rcp(new Neighborhood_Cache(mesh_)) : neighborhood_cache;
+  TEUCHOS_TEST_FOR_EXCEPTION(neighborhood_cache_->mesh()!=mesh_,std::runtime_error,
+    "Error, the neighborhood cache was built for a different mesh");
+  // the neighborhoods have to be rebuilt if the post processor is initialized with a new mesh
+  neighborhood_initialized_ = false;
   local_num_points_ = mesh_->get_scalar_node_dist_map()->get_num_local_elements();
   overlap_num_points_ = mesh_->get_scalar_node_overlap_map()->get_num_local_elements();
   assert(local_num_points_>0);
@@ -133,91 +288,9 @@ Post_Processor::set_stereo_field_names(){
 void
 Post_Processor::initialize_neighborhood(const scalar_t & neighborhood_radius){
   DEBUG_MSG("Post_Processor::initialize_neighborhood(): begin");
-
-  // gather an all owned field here
-  const int_t spa_dim = mesh_->spatial_dimension();
-  DICe::field_enums::Field_Spec coords_x_spec = mesh_->get_field_spec(coords_x_name_);
-  DICe::field_enums::Field_Spec coords_y_spec = mesh_->get_field_spec(coords_y_name_);
-  Teuchos::RCP<MultiField> coords;
-  if(coords_x_spec.get_field_type()==DICe::field_enums::SCALAR_FIELD_TYPE){
-    Teuchos::RCP<MultiField> coords_x = mesh_->get_overlap_field(coords_x_spec);
-    Teuchos::RCP<MultiField> coords_y = mesh_->get_overlap_field(coords_y_spec);
-    Teuchos::RCP<MultiField_Map> overlap_map = mesh_->get_vector_node_overlap_map();
-    coords = Teuchos::rcp( new MultiField(overlap_map,1,true));
-    for(int_t i=0;i<mesh_->get_scalar_node_overlap_map()->get_num_local_elements();++i){
-      coords->local_value(i*spa_dim+0) = coords_x->local_value(i);
-      coords->local_value(i*spa_dim+1) = coords_y->local_value(i);
-    }
-  }else{
-    // note assumes that the same vector field spec was given for x and y
-    coords = mesh_->get_overlap_field(coords_x_spec);
-  }
-  // create neighborhood lists using nanoflann:
-  DEBUG_MSG("creating the point cloud using nanoflann");
-  point_cloud_ = Teuchos::rcp(new Point_Cloud_2D<scalar_t>());
-  point_cloud_->pts.resize(overlap_num_points_);
-  for(int_t i=0;i<overlap_num_points_;++i){
-    point_cloud_->pts[i].x = coords->local_value(i*spa_dim+0);
-    point_cloud_->pts[i].y = coords->local_value(i*spa_dim+1);
-  }
-  DEBUG_MSG("building the kd-tree");
-  Teuchos::RCP<kd_tree_2d_t> kd_tree = Teuchos::rcp(new kd_tree_2d_t(2 /*dim*/, *point_cloud_.get(), nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */) ) );
-  kd_tree->buildIndex();
-  DEBUG_MSG("kd-tree completed");
-
-  // perform a pass to size the neighbor lists
-  neighbor_list_.resize(local_num_points_);
-  neighbor_dist_x_.resize(local_num_points_);
-  neighbor_dist_y_.resize(local_num_points_);
-
-  scalar_t query_pt[2];
-  if(neighborhood_radius < 0){ // k-nearest search
-    const int_t num_neigh = (int_t)(-1.0*neighborhood_radius);
-    DEBUG_MSG("performing k-nearest neighbors search for " << num_neigh << " neighbors");
-    std::vector<size_t> ret_index(num_neigh);
-    std::vector<scalar_t> out_dist_sqr(num_neigh);
-    for(int_t i=0;i<local_num_points_;++i){
-      // get the gid of the point
-      const int_t gid = mesh_->get_scalar_node_dist_map()->get_global_element(i);
-      // get the overlap local id of the point
-      const int_t olid = mesh_->get_scalar_node_overlap_map()->get_local_element(gid);
-      assert(olid<overlap_num_points_);
-      query_pt[0] = point_cloud_->pts[olid].x;
-      query_pt[1] = point_cloud_->pts[olid].y;
-      kd_tree->knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
-      for(int_t j=0;j<num_neigh;++j){
-        const int_t neigh_olid = ret_index[j];
-        neighbor_list_[i].push_back(neigh_olid);
-        neighbor_dist_x_[i].push_back(coords->local_value(neigh_olid*spa_dim+0) - coords->local_value(olid*spa_dim+0));
-        neighbor_dist_y_[i].push_back(coords->local_value(neigh_olid*spa_dim+1) - coords->local_value(olid*spa_dim+1));
-      }
-    }
-  }else{ // radius search
-    std::vector<std::pair<size_t,scalar_t> > ret_matches;
-    nanoflann::SearchParams params;
-    params.sorted = true; // sort by distance in ascending order
-    const scalar_t tiny = 1.0E-5;
-    scalar_t neigh_rad_2 = neighborhood_radius*neighborhood_radius + tiny;
-    DEBUG_MSG("performing radius neighbor search with rad^2 " << neigh_rad_2);
-
-    for(int_t i=0;i<local_num_points_;++i){
-      // get the gid of the point
-      const int_t gid = mesh_->get_scalar_node_dist_map()->get_global_element(i);
-      // get the overlap local id of the point
-      const int_t olid = mesh_->get_scalar_node_overlap_map()->get_local_element(gid);
-      assert(olid<overlap_num_points_);
-      query_pt[0] = point_cloud_->pts[olid].x;
-      query_pt[1] = point_cloud_->pts[olid].y;
-      kd_tree->radiusSearch(&query_pt[0],neigh_rad_2,ret_matches,params);
-      for(size_t j=0;j<ret_matches.size();++j){
-        const int_t neigh_olid = ret_matches[j].first;
-        neighbor_list_[i].push_back(neigh_olid);
-        neighbor_dist_x_[i].push_back(coords->local_value(neigh_olid*spa_dim+0) - coords->local_value(olid*spa_dim+0));
-        neighbor_dist_y_[i].push_back(coords->local_value(neigh_olid*spa_dim+1) - coords->local_value(olid*spa_dim+1));
-      }
-    }
-  }
-
+  TEUCHOS_TEST_FOR_EXCEPTION(neighborhood_cache_==Teuchos::null,std::runtime_error,
+    "Error, the post processor must be initialized before the neighborhood is set up");
+  neighborhood_ = neighborhood_cache_->neighborhood(coords_x_name_,coords_y_name_,neighborhood_radius);
   neighborhood_initialized_ = true;
   DEBUG_MSG("Post_Processor::initialize_neighborhood(): end");
 }
@@ -310,98 +383,117 @@ VSG_Strain_Post_Processor::execute(){
   Teuchos::RCP<DICe::MultiField> match = mesh_->get_field(DICe::field_enums::MATCH_FS);
 
   const int_t N = 3;
-  int *IPIV = new int[N+1];
-  int LWORK = N*N;
-  int INFO = 0;
-  double *WORK = new double[LWORK];
-  double *GWORK = new double[10*N];
-  int *IWORK = new int[LWORK];
-  // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
-  Teuchos::LAPACK<int,double> lapack;
-
-  int_t num_neigh = 0;
-  std::vector<bool> neigh_valid;
-  int_t neigh_id = 0;
-  for(int_t subset=0;subset<local_num_points_;++subset){
-    DEBUG_MSG("Processing subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << ", " << subset + 1 << " of " << local_num_points_);
-    // search the neighbors to see how many valid neighbors exist:
-    num_neigh = neighbor_list_[subset].size();
-    neigh_valid.resize(num_neigh);
-    int_t num_valid_neigh = 0;
-    for(int_t j=0;j<num_neigh;++j){
-      if(sigma->local_value(neighbor_list_[subset][j])>=0.0){
-        neigh_valid[j] = true;
-        num_valid_neigh++;
-      }else{
-        neigh_valid[j] = false;
-      }
-    }
-    DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " num valid neighbors: " << num_valid_neigh);
-    if(num_valid_neigh < 3 || sigma->local_value(neighbor_list_[subset][0]) < 0.0){
-      vsg_dudx_rcp->local_value(subset) = 0.0;
-      vsg_dudy_rcp->local_value(subset) = 0.0;
-      vsg_dvdx_rcp->local_value(subset) = 0.0;
-      vsg_dvdy_rcp->local_value(subset) = 0.0;
-      vsg_strain_xx_rcp->local_value(subset) = 0.0;
-      vsg_strain_yy_rcp->local_value(subset) = 0.0;
-      vsg_strain_xy_rcp->local_value(subset) = 0.0;
-      DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " failed subset (sigma=-1) or not enough neighbors to calculate VSG strain."
-          " Setting all strain values to zero.");
-      match->local_value(subset) = -1;
-    }else{
-      Teuchos::ArrayRCP<double> u_x(num_valid_neigh,0.0);
-      Teuchos::ArrayRCP<double> u_y(num_valid_neigh,0.0);
-      Teuchos::ArrayRCP<double> X_t_u_x(N,0.0);
-      Teuchos::ArrayRCP<double> X_t_u_y(N,0.0);
-      Teuchos::ArrayRCP<double> coeffs_x(N,0.0);
-      Teuchos::ArrayRCP<double> coeffs_y(N,0.0);
-      Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_valid_neigh, true);
-      Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
+  // size the workspaces for the largest neighborhood so they can be reused for every point
+  int_t max_num_neigh = 0;
+  for(int_t subset=0;subset<local_num_points_;++subset)
+    max_num_neigh = std::max(max_num_neigh,(int_t)neighborhood_->neighbor_list[subset].size());
+  const Neighborhood & neigh = *neighborhood_;
+
+  // the points are independent so they are processed concurrently, each thread owns its workspaces
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr subset_error;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads_) if(num_threads_>1)
+#endif
+  {
+    std::vector<int> IPIV(N+1,0);
+    int LWORK = N*N;
+    int INFO = 0;
+    std::vector<double> WORK(LWORK,0.0);
+    std::vector<double> GWORK(10*N,0.0);
+    std::vector<int> IWORK(LWORK,0);
+    // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
+    Teuchos::LAPACK<int,double> lapack;
+    // the neighborhood sized workspaces come from this thread's frame arena
+    Frame_Arena::Scope arena_scope;
+    double * u_x = arena_scope.arena().allocate<double>(max_num_neigh);
+    double * u_y = arena_scope.arena().allocate<double>(max_num_neigh);
+    // X^T is stored row by row with a stride of max_num_neigh
+    double * X_t = arena_scope.arena().allocate<double>(N*max_num_neigh);
+    // X^T*X is stored column major for LAPACK
+    double X_t_X[N*N];
+    double X_t_u_x[N];
+    double X_t_u_y[N];
+    double coeffs_x[N];
+    double coeffs_y[N];
+    double colTotals[N];
+    bool * neigh_valid = arena_scope.arena().allocate<bool>(max_num_neigh);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+    for(int_t subset=0;subset<local_num_points_;++subset){
+      try{
+        DEBUG_MSG("Processing subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << ", " << subset + 1 << " of " << local_num_points_);
+        // search the neighbors to see how many valid neighbors exist:
+        const std::vector<int_t> & neighbor_list = neigh.neighbor_list[subset];
+        const int_t num_neigh = neighbor_list.size();
+        int_t num_valid_neigh = 0;
+        for(int_t j=0;j<num_neigh;++j){
+          if(sigma->local_value(neighbor_list[j])>=0.0){
+            neigh_valid[j] = true;
+            num_valid_neigh++;
+          }else{
+            neigh_valid[j] = false;
+          }
+        }
+        DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " num valid neighbors: " << num_valid_neigh);
+        if(num_valid_neigh < 3 || sigma->local_value(neighbor_list[0]) < 0.0){
+          vsg_dudx_rcp->local_value(subset) = 0.0;
+          vsg_dudy_rcp->local_value(subset) = 0.0;
+          vsg_dvdx_rcp->local_value(subset) = 0.0;
+          vsg_dvdy_rcp->local_value(subset) = 0.0;
+          vsg_strain_xx_rcp->local_value(subset) = 0.0;
+          vsg_strain_yy_rcp->local_value(subset) = 0.0;
+          vsg_strain_xy_rcp->local_value(subset) = 0.0;
+          DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " failed subset (sigma=-1) or not enough neighbors to calculate VSG strain."
+              " Setting all strain values to zero.");
+          match->local_value(subset) = -1;
+          continue;
+        }
 
-      // gather the displacements of the neighbors
-      int_t valid_id = 0;
-      for(int_t j=0;j<num_neigh;++j){
-        if(!neigh_valid[j])continue;
-        neigh_id = neighbor_list_[subset][j];
-        assert(sigma->local_value(neigh_id)>=0.0);
-        u_x[valid_id] = disp->local_value(neigh_id*spa_dim+0);
-        u_y[valid_id] = disp->local_value(neigh_id*spa_dim+1);
-        // set up the X^T matrix
-        X_t(0,valid_id) = 1.0;
-        X_t(1,valid_id) = neighbor_dist_x_[subset][j];
-        X_t(2,valid_id) = neighbor_dist_y_[subset][j];
-        valid_id++;
-      }
+        // gather the displacements of the neighbors
+        int_t valid_id = 0;
+        for(int_t j=0;j<num_neigh;++j){
+          if(!neigh_valid[j])continue;
+          const int_t neigh_id = neighbor_list[j];
+          assert(sigma->local_value(neigh_id)>=0.0);
+          u_x[valid_id] = disp->local_value(neigh_id*spa_dim+0);
+          u_y[valid_id] = disp->local_value(neigh_id*spa_dim+1);
+          // set up the X^T matrix
+          X_t[valid_id] = 1.0;
+          X_t[max_num_neigh + valid_id] = neigh.neighbor_dist_x[subset][j];
+          X_t[2*max_num_neigh + valid_id] = neigh.neighbor_dist_y[subset][j];
+          valid_id++;
+        }
 
-      // set up X^T*X
-      for(int_t k=0;k<N;++k){
-        for(int_t m=0;m<N;++m){
-          for(int_t j=0;j<num_valid_neigh;++j){
-            X_t_X(k,m) += X_t(k,j)*X_t(m,j);
+        // set up X^T*X
+        for(int_t k=0;k<N;++k){
+          for(int_t m=0;m<N;++m){
+            double value = 0.0;
+            for(int_t j=0;j<num_valid_neigh;++j){
+              value += X_t[k*max_num_neigh+j]*X_t[m*max_num_neigh+j];
+            }
+            X_t_X[m*N+k] = value;
           }
         }
-      }
-      //X_t_X.print(std::cout);
 
-      // Invert X^T*X
-      // TODO: remove for performance?
-      // compute the 1-norm of H:
-      std::vector<double> colTotals(X_t_X.numCols(),0.0);
-      for(int_t i=0;i<X_t_X.numCols();++i){
-        for(int_t j=0;j<X_t_X.numRows();++j){
-          colTotals[i]+=std::abs(X_t_X(j,i));
+        // Invert X^T*X
+        // compute the 1-norm of X^T*X:
+        for(int_t i=0;i<N;++i){
+          colTotals[i] = 0.0;
+          for(int_t j=0;j<N;++j){
+            colTotals[i]+=std::abs(X_t_X[i*N+j]);
+          }
         }
-      }
-      double anorm = 0.0;
-      for(int_t i=0;i<X_t_X.numCols();++i){
-        if(colTotals[i] > anorm) anorm = colTotals[i];
-      }
-      DEBUG_MSG("Subset " << subset << " anorm " << anorm);
-      double rcond=0.0; // reciporical condition number
-      try
-      {
-        lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),IPIV,&INFO);
-        lapack.GECON('1',X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),anorm,&rcond,GWORK,IWORK,&INFO);
+        double anorm = 0.0;
+        for(int_t i=0;i<N;++i){
+          if(colTotals[i] > anorm) anorm = colTotals[i];
+        }
+        DEBUG_MSG("Subset " << subset << " anorm " << anorm);
+        double rcond=0.0; // reciporical condition number
+        lapack.GETRF(N,N,X_t_X,N,&IPIV[0],&INFO);
+        lapack.GECON('1',N,X_t_X,N,anorm,&rcond,&GWORK[0],&IWORK[0],&INFO);
         DEBUG_MSG("Subset " << subset << " VSG X^T*X RCOND(H): "<< rcond);
         if(rcond < 1.0E-12) {
           vsg_dudx_rcp->local_value(subset) = 0.0;
@@ -415,75 +507,65 @@ VSG_Strain_Post_Processor::execute(){
               " Setting all strain values to zero.");
           match->local_value(subset) = -1;
           continue;
-          //std::cout << "Error: The pseudo-inverse of the VSG strain calculation is (or is near) singular." << std::endl;
-          //TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"");
         }
-      }
-      catch(std::exception &e){
-        if(&e!=0){
-          DEBUG_MSG( e.what() << '\n');
-        }
-        std::cout << "Error: Something went wrong in the condition number calculation" << std::endl;
-        TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"");
-      }
-      try
-      {
-        lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),IPIV,WORK,LWORK,&INFO);
-      }
-      catch(std::exception &e){
-        if(&e!=0){
-          DEBUG_MSG( e.what() << '\n');
+        lapack.GETRI(N,X_t_X,N,&IPIV[0],&WORK[0],LWORK,&INFO);
+
+        // compute X^T*u
+        for(int_t i=0;i<N;++i){
+          X_t_u_x[i] = 0.0;
+          X_t_u_y[i] = 0.0;
+          for(int_t j=0;j<num_valid_neigh;++j){
+            X_t_u_x[i] += X_t[i*max_num_neigh+j]*u_x[j];
+            X_t_u_y[i] += X_t[i*max_num_neigh+j]*u_y[j];
+          }
         }
-        std::cout << "Error: Something went wrong in the inverse calculation of X^T*X " << std::endl;
-      }
 
-      // compute X^T*u
-      for(int_t i=0;i<N;++i){
-        for(int_t j=0;j<num_valid_neigh;++j){
-          X_t_u_x[i] += X_t(i,j)*u_x[j];
-          X_t_u_y[i] += X_t(i,j)*u_y[j];
+        // compute the coeffs
+        for(int_t i=0;i<N;++i){
+          coeffs_x[i] = 0.0;
+          coeffs_y[i] = 0.0;
+          for(int_t j=0;j<N;++j){
+            coeffs_x[i] += X_t_X[j*N+i]*X_t_u_x[j];
+            coeffs_y[i] += X_t_X[j*N+i]*X_t_u_y[j];
+          }
         }
-      }
 
-      // compute the coeffs
-      for(int_t i=0;i<N;++i){
-        for(int_t j=0;j<N;++j){
-          coeffs_x[i] += X_t_X(i,j)*X_t_u_x[j];
-          coeffs_y[i] += X_t_X(i,j)*X_t_u_y[j];
+        // update the field values
+        const double dudx = coeffs_x[1];
+        const double dudy = coeffs_x[2];
+        const double dvdx = coeffs_y[1];
+        const double dvdy = coeffs_y[2];
+        vsg_dudx_rcp->local_value(subset) = dudx;
+        vsg_dudy_rcp->local_value(subset) = dudy;
+        vsg_dvdx_rcp->local_value(subset) = dvdx;
+        vsg_dvdy_rcp->local_value(subset) = dvdy;
+
+        DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " dudx " << dudx << " dudy " << dudy <<
+          " dvdx " << dvdx << " dvdy " << dvdy);
+
+        // compute the Green-Lagrange strain based on the derivatives computed above:
+        const scalar_t GL_xx = 0.5*(2.0*dudx + dudx*dudx + dvdx*dvdx);
+        const scalar_t GL_yy = 0.5*(2.0*dvdy + dudy*dudy + dvdy*dvdy);
+        const scalar_t GL_xy = 0.5*(dudy + dvdx + dudx*dudy + dvdx*dvdy);
+        vsg_strain_xx_rcp->local_value(subset) = GL_xx;
+        vsg_strain_yy_rcp->local_value(subset) = GL_yy;
+        vsg_strain_xy_rcp->local_value(subset) = GL_xy;
+
+        DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " VSG Green-Lagrange strain XX: " << GL_xx << " YY: " << GL_yy <<
+          " XY: " << GL_xy);
+      }
+      catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_vsg_strain_error)
+#endif
+        {
+          if(!subset_error) subset_error = std::current_exception();
         }
       }
+    } // end subset loop
+  } // parallel region
+  if(subset_error) std::rethrow_exception(subset_error);
 
-      // update the field values
-      const double dudx = coeffs_x[1];
-      const double dudy = coeffs_x[2];
-      const double dvdx = coeffs_y[1];
-      const double dvdy = coeffs_y[2];
-      vsg_dudx_rcp->local_value(subset) = dudx;
-      vsg_dudy_rcp->local_value(subset) = dudy;
-      vsg_dvdx_rcp->local_value(subset) = dvdx;
-      vsg_dvdy_rcp->local_value(subset) = dvdy;
-
-      DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " dudx " << dudx << " dudy " << dudy <<
-        " dvdx " << dvdx << " dvdy " << dvdy);
-
-      // compute the Green-Lagrange strain based on the derivatives computed above:
-      const scalar_t GL_xx = 0.5*(2.0*dudx + dudx*dudx + dvdx*dvdx);
-      const scalar_t GL_yy = 0.5*(2.0*dvdy + dudy*dudy + dvdy*dvdy);
-      const scalar_t GL_xy = 0.5*(dudy + dvdx + dudx*dudy + dvdx*dvdy);
-      vsg_strain_xx_rcp->local_value(subset) = GL_xx;
-      vsg_strain_yy_rcp->local_value(subset) = GL_yy;
-      vsg_strain_xy_rcp->local_value(subset) = GL_xy;
-
-      DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " VSG Green-Lagrange strain XX: " << GL_xx << " YY: " << GL_yy <<
-        " XY: " << GL_xy);
-    } // end has enough valid neighbors to compute strain check
-
-  } // end subset loop
-
-  delete [] WORK;
-  delete [] GWORK;
-  delete [] IWORK;
-  delete [] IPIV;
   DEBUG_MSG("VSG_Strain_Post_Processor execute() end");
 }
 
@@ -591,94 +673,116 @@ NLVC_Strain_Post_Processor::execute(){
   Teuchos::RCP<DICe::MultiField> f10_rcp = mesh_->get_field(DICe::field_enums::FIELD_10_FS);
   Teuchos::RCP<DICe::MultiField> match = mesh_->get_field(DICe::field_enums::MATCH_FS);
 
-  std::vector<bool> neigh_valid;
-  for(int_t subset=0;subset<local_num_points_;++subset){
-    DEBUG_MSG("Processing subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << ", " << subset + 1 << " of " << local_num_points_);
-    scalar_t dudx = 0.0;
-    scalar_t dudy = 0.0;
-    scalar_t dvdx = 0.0;
-    scalar_t dvdy = 0.0;
-    scalar_t ux = 0.0;
-    scalar_t uy = 0.0;
-    scalar_t dx = 0.0;
-    scalar_t dy = 0.0;
-    scalar_t sum_int_x = 0.0;
-    scalar_t sum_int_y = 0.0;
-    scalar_t kx = 0.0;
-    scalar_t ky = 0.0;
-    int_t neigh_id = 0;
-    const int_t num_neigh = neighbor_dist_x_[subset].size();
-    neigh_valid.resize(num_neigh);
-    int_t num_valid_neigh = 0;
-    for(int_t j=0;j<num_neigh;++j){
-      if(sigma->local_value(neighbor_list_[subset][j])>=0.0){
-        neigh_valid[j] = true;
-        num_valid_neigh++;
-      }else{
-        neigh_valid[j] = false;
+  // the points are independent so they are processed concurrently
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr subset_error;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads_) if(num_threads_>1)
+#endif
+  {
+    std::vector<bool> neigh_valid;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+    for(int_t subset=0;subset<local_num_points_;++subset){
+      try{
+        DEBUG_MSG("Processing subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << ", " << subset + 1 << " of " << local_num_points_);
+        scalar_t dudx = 0.0;
+        scalar_t dudy = 0.0;
+        scalar_t dvdx = 0.0;
+        scalar_t dvdy = 0.0;
+        scalar_t ux = 0.0;
+        scalar_t uy = 0.0;
+        scalar_t dx = 0.0;
+        scalar_t dy = 0.0;
+        scalar_t sum_int_x = 0.0;
+        scalar_t sum_int_y = 0.0;
+        scalar_t kx = 0.0;
+        scalar_t ky = 0.0;
+        int_t neigh_id = 0;
+        const int_t num_neigh = neighborhood_->neighbor_dist_x[subset].size();
+        neigh_valid.resize(num_neigh);
+        int_t num_valid_neigh = 0;
+        for(int_t j=0;j<num_neigh;++j){
+          if(sigma->local_value(neighborhood_->neighbor_list[subset][j])>=0.0){
+            neigh_valid[j] = true;
+            num_valid_neigh++;
+          }else{
+            neigh_valid[j] = false;
+          }
+        }
+        DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " num valid neighbors: " << num_valid_neigh);
+        if(num_valid_neigh < 3 || sigma->local_value(neighborhood_->neighbor_list[subset][0])<0.0){
+          nlvc_dudx_rcp->local_value(subset) = 0.0;
+          nlvc_dudy_rcp->local_value(subset) = 0.0;
+          nlvc_dvdx_rcp->local_value(subset) = 0.0;
+          nlvc_dvdy_rcp->local_value(subset) = 0.0;
+          nlvc_strain_xx_rcp->local_value(subset) = 0.0;
+          nlvc_strain_yy_rcp->local_value(subset) = 0.0;
+          nlvc_strain_xy_rcp->local_value(subset) = 0.0;
+          DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " failed subset (sigma=-1) or not enough neighbors to calculate NLVC strain."
+              " Setting all strain values to zero.");
+          match->local_value(subset) = -1;
+        }else{
+          assert(neighborhood_->neighbor_dist_x[subset].size()>1);
+          assert(neighborhood_->neighbor_dist_y[subset].size()>1);
+          // neighbor 0 is yourself
+          const scalar_t nearest_neigh_dist = std::sqrt(neighborhood_->neighbor_dist_x[subset][1]*neighborhood_->neighbor_dist_x[subset][1] +
+            neighborhood_->neighbor_dist_y[subset][1]*neighborhood_->neighbor_dist_y[subset][1]);
+          const scalar_t patch_area = nearest_neigh_dist*nearest_neigh_dist;
+          for(int_t j=0;j<num_neigh;++j){
+            if(!neigh_valid[j]) continue;
+            neigh_id = neighborhood_->neighbor_list[subset][j];
+            assert(sigma->local_value(neigh_id)>=0.0);
+            ux = disp->local_value(neigh_id*spa_dim+0);
+            uy = disp->local_value(neigh_id*spa_dim+1);
+            dx = neighborhood_->neighbor_dist_x[subset][j];
+            dy = neighborhood_->neighbor_dist_y[subset][j];
+            compute_kernel(dx,dy,kx,ky);
+            sum_int_x += kx*patch_area;
+            sum_int_y += ky*patch_area;
+            dudx -= ux * kx*patch_area;
+            dudy -= ux * ky*patch_area;
+            dvdx -= uy * kx*patch_area;
+            dvdy -= uy * ky*patch_area;
+          } // neighbor loop
+          nlvc_dudx_rcp->local_value(subset) = dudx;
+          nlvc_dudy_rcp->local_value(subset) = dudy;
+          nlvc_dvdx_rcp->local_value(subset) = dvdx;
+          nlvc_dvdy_rcp->local_value(subset) = dvdy;
+          f9_rcp->local_value(subset) = sum_int_x;
+          f10_rcp->local_value(subset) = sum_int_y;
+
+          DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " dudx " << dudx << " dudy " << dudy <<
+            " dvdx " << dvdx << " dvdy " << dvdy);
+          DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " sum_int_x " << sum_int_x <<
+            " sum_int_y " << sum_int_y);
+
+          // compute the Green-Lagrange strain based on the derivatives computed above:
+          const scalar_t GL_xx = 0.5*(2.0*dudx + dudx*dudx + dvdx*dvdx);
+          const scalar_t GL_yy = 0.5*(2.0*dvdy + dudy*dudy + dvdy*dvdy);
+          const scalar_t GL_xy = 0.5*(dudy + dvdx + dudx*dudy + dvdx*dvdy);
+          nlvc_strain_xx_rcp->local_value(subset) = GL_xx;
+          nlvc_strain_yy_rcp->local_value(subset) = GL_yy;
+          nlvc_strain_xy_rcp->local_value(subset) = GL_xy;
+          if(sum_int_x > 0.01 || sum_int_y > 0.01 || sum_int_x < -0.01 || sum_int_y < -0.01){
+            match->local_value(subset) = -1;
+          }
+          DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " NLVC Green-Lagrange strain XX: " << GL_xx << " YY: " << GL_yy <<
+            " XY: " << GL_xy);
+        }
       }
-    }
-    DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " num valid neighbors: " << num_valid_neigh);
-    if(num_valid_neigh < 3 || sigma->local_value(neighbor_list_[subset][0])<0.0){
-      nlvc_dudx_rcp->local_value(subset) = 0.0;
-      nlvc_dudy_rcp->local_value(subset) = 0.0;
-      nlvc_dvdx_rcp->local_value(subset) = 0.0;
-      nlvc_dvdy_rcp->local_value(subset) = 0.0;
-      nlvc_strain_xx_rcp->local_value(subset) = 0.0;
-      nlvc_strain_yy_rcp->local_value(subset) = 0.0;
-      nlvc_strain_xy_rcp->local_value(subset) = 0.0;
-      DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " failed subset (sigma=-1) or not enough neighbors to calculate NLVC strain."
-          " Setting all strain values to zero.");
-      match->local_value(subset) = -1;
-    }else{
-      assert(neighbor_dist_x_[subset].size()>1);
-      assert(neighbor_dist_y_[subset].size()>1);
-      // neighbor 0 is yourself
-      const scalar_t nearest_neigh_dist = std::sqrt(neighbor_dist_x_[subset][1]*neighbor_dist_x_[subset][1] +
-        neighbor_dist_y_[subset][1]*neighbor_dist_y_[subset][1]);
-      const scalar_t patch_area = nearest_neigh_dist*nearest_neigh_dist;
-      for(int_t j=0;j<num_neigh;++j){
-        if(!neigh_valid[j]) continue;
-        neigh_id = neighbor_list_[subset][j];
-        assert(sigma->local_value(neigh_id)>=0.0);
-        ux = disp->local_value(neigh_id*spa_dim+0);
-        uy = disp->local_value(neigh_id*spa_dim+1);
-        dx = neighbor_dist_x_[subset][j];
-        dy = neighbor_dist_y_[subset][j];
-        compute_kernel(dx,dy,kx,ky);
-        sum_int_x += kx*patch_area;
-        sum_int_y += ky*patch_area;
-        dudx -= ux * kx*patch_area;
-        dudy -= ux * ky*patch_area;
-        dvdx -= uy * kx*patch_area;
-        dvdy -= uy * ky*patch_area;
-      } // neighbor loop
-      nlvc_dudx_rcp->local_value(subset) = dudx;
-      nlvc_dudy_rcp->local_value(subset) = dudy;
-      nlvc_dvdx_rcp->local_value(subset) = dvdx;
-      nlvc_dvdy_rcp->local_value(subset) = dvdy;
-      f9_rcp->local_value(subset) = sum_int_x;
-      f10_rcp->local_value(subset) = sum_int_y;
-
-      DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " dudx " << dudx << " dudy " << dudy <<
-        " dvdx " << dvdx << " dvdy " << dvdy);
-      DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " sum_int_x " << sum_int_x <<
-        " sum_int_y " << sum_int_y);
-
-      // compute the Green-Lagrange strain based on the derivatives computed above:
-      const scalar_t GL_xx = 0.5*(2.0*dudx + dudx*dudx + dvdx*dvdx);
-      const scalar_t GL_yy = 0.5*(2.0*dvdy + dudy*dudy + dvdy*dvdy);
-      const scalar_t GL_xy = 0.5*(dudy + dvdx + dudx*dudy + dvdx*dvdy);
-      nlvc_strain_xx_rcp->local_value(subset) = GL_xx;
-      nlvc_strain_yy_rcp->local_value(subset) = GL_yy;
-      nlvc_strain_xy_rcp->local_value(subset) = GL_xy;
-      if(sum_int_x > 0.01 || sum_int_y > 0.01 || sum_int_x < -0.01 || sum_int_y < -0.01){
-        match->local_value(subset) = -1;
+      catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_nlvc_strain_error)
+#endif
+        {
+          if(!subset_error) subset_error = std::current_exception();
+        }
       }
-      DEBUG_MSG("Subset gid " << mesh_->get_scalar_node_dist_map()->get_global_element(subset) << " NLVC Green-Lagrange strain XX: " << GL_xx << " YY: " << GL_yy <<
-        " XY: " << GL_xy);
-    }
-  } // subset loop
+    } // subset loop
+  } // parallel region
+  if(subset_error) std::rethrow_exception(subset_error);
 
   DEBUG_MSG("NLVC_Strain_Post_Processor execute() end");
 }
@@ -715,21 +819,42 @@ Altitude_Post_Processor::execute(){
       std::vector<scalar_t> xs;
       std::vector<scalar_t> ys;
       std::vector<scalar_t> elevs;
+      // the values are read straight out of each line since the files can have millions of points
+      // (splitting every line into capitalized string tokens dominated the first frame)
       int_t line = 0;
-      while(!elev_file.eof()){
-        std::vector<std::string> tokens = tokenize_line(elev_file);
-        if(tokens.size()==0) continue;
-        TEUCHOS_TEST_FOR_EXCEPTION(tokens.size()!=5,std::runtime_error,"Error, invalid number of tokens for line " << line <<
-          " of file elevation_data.txt. Has " << tokens.size() << " tokens, but should have 5");
-        scalar_t elev = strtod(tokens[2].c_str(),NULL);
+      std::string buffer;
+      while(!safeGetline(elev_file,buffer).eof()||!buffer.empty()){
+        const char * pos = buffer.c_str();
+        while(*pos==' '||*pos=='\t') ++pos;
+        if(*pos=='\0'||*pos==parser_comment_char[0]){
+          if(elev_file.eof()) break;
+          continue;
+        }
+        double values[5];
+        int_t num_values = 0;
+        while(*pos!='\0'){
+          char * end = NULL;
+          const double value = strtod(pos,&end);
+          TEUCHOS_TEST_FOR_EXCEPTION(end==pos,std::runtime_error,"Error, invalid value on line " << line <<
+            " of file elevation_data.txt: " << buffer);
+          if(num_values<5) values[num_values] = value;
+          num_values++;
+          pos = end;
+          while(*pos==' '||*pos=='\t') ++pos;
+        }
+        TEUCHOS_TEST_FOR_EXCEPTION(num_values!=5,std::runtime_error,"Error, invalid number of tokens for line " << line <<
+          " of file elevation_data.txt. Has " << num_values << " tokens, but should have 5");
+        scalar_t elev = values[2];
         if(elev < 0.0) elev = 0.0; // prevent negative ground heights
         elevs.push_back(elev + radius_of_earth_);
-        xs.push_back(strtod(tokens[3].c_str(),NULL));
-        ys.push_back(strtod(tokens[4].c_str(),NULL));
+        xs.push_back(values[3]);
+        ys.push_back(values[4]);
         line++;
+        if(elev_file.eof()) break;
       }
       const int_t num_elev_pts = xs.size();
       DEBUG_MSG("Altitude_Post_Processor::execute(): found " << num_elev_pts << " points in elevation_data.txt");
+      TEUCHOS_TEST_FOR_EXCEPTION(num_elev_pts<5,std::runtime_error,"Error, elevation_data.txt needs at least 5 points");
       // create a point cloud
       TEUCHOS_TEST_FOR_EXCEPTION(neighborhood_initialized_,std::runtime_error,"");
       DEBUG_MSG("creating the point cloud using nanoflann");
@@ -743,73 +868,84 @@ Altitude_Post_Processor::execute(){
       Teuchos::RCP<kd_tree_2d_t> kd_tree = Teuchos::rcp(new kd_tree_2d_t(2 /*dim*/, *point_cloud_.get(), nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */) ) );
       kd_tree->buildIndex();
       DEBUG_MSG("kd-tree completed");
+      const kd_tree_2d_t & tree = *kd_tree;
 
       // compute the 5 nearest neighbors for each subset and interpolate the ground height from them.
       Teuchos::RCP<MultiField> subset_coords_x = mesh_->get_field(DICe::field_enums::SUBSET_COORDINATES_X_FS);
       Teuchos::RCP<MultiField> subset_coords_y = mesh_->get_field(DICe::field_enums::SUBSET_COORDINATES_Y_FS);
+      // raw pointers to the local values so the threads don't go through the multivector accessors
+      const mv_scalar_type * coords_x = subset_coords_x->local_values();
+      const mv_scalar_type * coords_y = subset_coords_y->local_values();
+      mv_scalar_type * ground_level = ground_level_rcp->local_values();
       const int_t num_neigh = 5;
-      scalar_t query_pt[2];
-      std::vector<size_t> ret_index(num_neigh);
-      std::vector<scalar_t> out_dist_sqr(num_neigh);
-
       const int_t N = 3;
-      int *IPIV = new int[N+1];
-      int LWORK = N*N;
-      int INFO = 0;
-      double *WORK = new double[LWORK];
-      double *GWORK = new double[10*N];
-      int *IWORK = new int[LWORK];
-      // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
-      Teuchos::LAPACK<int,double> lapack;
-
-      for(int_t subset=0;subset<local_num_points_;++subset){
-        Teuchos::ArrayRCP<double> neigh_elevs(num_neigh,0.0);
-        Teuchos::ArrayRCP<double> X_t_u_x(N,0.0);
-        Teuchos::ArrayRCP<double> coeffs(N,0.0);
-        Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_neigh, true);
-        Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
-
-        query_pt[0] = subset_coords_x->local_value(subset);
-        query_pt[1] = subset_coords_y->local_value(subset);
-        kd_tree->knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
-        for(size_t i=0;i<num_neigh;++i){
-          const int_t neigh_id = ret_index[i];
-          neigh_elevs[i] = elevs[neigh_id];
-          // set up the X^T matrix
-          X_t(0,i) = 1.0;
-          X_t(1,i) = xs[neigh_id] - query_pt[0];
-          X_t(2,i) = ys[neigh_id] - query_pt[1];
-        }
 
-        // set up X^T*X
-        for(int_t k=0;k<N;++k){
-          for(int_t m=0;m<N;++m){
-            for(int_t j=0;j<num_neigh;++j){
-              X_t_X(k,m) += X_t(k,j)*X_t(m,j);
+      // the subsets are independent so they are fit concurrently, each thread owns its workspaces
+      // (the kd-tree queries only read the tree)
+      std::exception_ptr subset_error;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads_) if(num_threads_>1)
+#endif
+      {
+        scalar_t query_pt[2];
+        size_t ret_index[num_neigh];
+        scalar_t out_dist_sqr[num_neigh];
+        int IPIV[N+1];
+        int LWORK = N*N;
+        int INFO = 0;
+        double WORK[N*N];
+        // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
+        Teuchos::LAPACK<int,double> lapack;
+        double X_t[N*num_neigh];
+        // X^T*X is stored column major for LAPACK
+        double X_t_X[N*N];
+        double X_t_u_x[N];
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for(int_t subset=0;subset<local_num_points_;++subset){
+          try{
+            query_pt[0] = coords_x[subset];
+            query_pt[1] = coords_y[subset];
+            tree.knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
+            for(int_t i=0;i<num_neigh;++i){
+              const int_t neigh_id = ret_index[i];
+              // set up the X^T matrix
+              X_t[0*num_neigh+i] = 1.0;
+              X_t[1*num_neigh+i] = xs[neigh_id] - query_pt[0];
+              X_t[2*num_neigh+i] = ys[neigh_id] - query_pt[1];
             }
+            // set up X^T*X and X^T*u
+            for(int_t k=0;k<N;++k){
+              X_t_u_x[k] = 0.0;
+              for(int_t m=0;m<N;++m){
+                double sum = 0.0;
+                for(int_t j=0;j<num_neigh;++j)
+                  sum += X_t[k*num_neigh+j]*X_t[m*num_neigh+j];
+                X_t_X[m*N+k] = sum;
+              }
+              for(int_t j=0;j<num_neigh;++j)
+                X_t_u_x[k] += X_t[k*num_neigh+j]*elevs[ret_index[j]];
+            }
+            lapack.GETRF(N,N,X_t_X,N,IPIV,&INFO);
+            lapack.GETRI(N,X_t_X,N,IPIV,WORK,LWORK,&INFO);
+            // only the constant coefficient (the ground level at the subset) is needed
+            double coeff_0 = 0.0;
+            for(int_t j=0;j<N;++j)
+              coeff_0 += X_t_X[j*N+0]*X_t_u_x[j];
+            ground_level[subset] = coeff_0;
           }
-        }
-        lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),IPIV,&INFO);
-        lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),IPIV,WORK,LWORK,&INFO);
-
-        // compute X^T*u
-        for(int_t i=0;i<N;++i){
-          for(int_t j=0;j<num_neigh;++j){
-            X_t_u_x[i] += X_t(i,j)*neigh_elevs[j];
-          }
-        }
-        // compute the coeffs
-        for(int_t i=0;i<N;++i){
-          for(int_t j=0;j<N;++j){
-            coeffs[i] += X_t_X(i,j)*X_t_u_x[j];
+          catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_altitude_error)
+#endif
+            {
+              if(!subset_error) subset_error = std::current_exception();
+            }
           }
-        }
-        ground_level_rcp->local_value(subset) = coeffs[0];
-      } // end local num points
-      delete [] WORK;
-      delete [] GWORK;
-      delete [] IWORK;
-      delete [] IPIV;
+        } // end local num points
+      } // parallel region
+      if(subset_error) std::rethrow_exception(subset_error);
     } // end has elevations file
     else{
       DEBUG_MSG("Altitude_Post_Processor::execute(): elevations file: elevation_data.txt not found, using radius of the earth as ground level");
@@ -1121,10 +1257,12 @@ Live_Plot_Post_Processor::pre_execution_tasks(){
 
   //dist_map_->describe();
 
+  // the live plot points are not mesh points so they have their own neighborhood
+  neighborhood_ = Teuchos::rcp(new Neighborhood());
   // perform a pass to size the neighbor lists
-  neighbor_list_.resize(local_indices_.size());
-  neighbor_dist_x_.resize(local_indices_.size());
-  neighbor_dist_y_.resize(local_indices_.size());
+  neighborhood_->neighbor_list.resize(local_indices_.size());
+  neighborhood_->neighbor_dist_x.resize(local_indices_.size());
+  neighborhood_->neighbor_dist_y.resize(local_indices_.size());
 
   // create neighborhood lists using nanoflann:
   DEBUG_MSG("creating the point cloud of overlap points using nanoflann");
@@ -1147,9 +1285,9 @@ Live_Plot_Post_Processor::pre_execution_tasks(){
     kd_tree->knnSearch(&query_pt[0], num_neigh_, &ret_index[0], &out_dist_sqr[0]);
     for(int_t j=0;j<num_neigh_;++j){
       const int_t neigh_olid = ret_index[j];
-      neighbor_list_[i].push_back(neigh_olid);
-      neighbor_dist_x_[i].push_back(overlap_coords->local_value(neigh_olid*spa_dim+0) - pts_x_[local_indices_[i]]);
-      neighbor_dist_y_[i].push_back(overlap_coords->local_value(neigh_olid*spa_dim+1) - pts_y_[local_indices_[i]]);
+      neighborhood_->neighbor_list[i].push_back(neigh_olid);
+      neighborhood_->neighbor_dist_x[i].push_back(overlap_coords->local_value(neigh_olid*spa_dim+0) - pts_x_[local_indices_[i]]);
+      neighborhood_->neighbor_dist_y[i].push_back(overlap_coords->local_value(neigh_olid*spa_dim+1) - pts_y_[local_indices_[i]]);
     }
   }
   neighborhood_initialized_ = true;
@@ -1195,8 +1333,8 @@ Live_Plot_Post_Processor::execute(){
   // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
   Teuchos::LAPACK<int,double> lapack;
 
-  assert(neighbor_list_.size()==local_indices_.size());
-  assert((int_t)neighbor_list_[0].size()==num_neigh_);
+  assert(neighborhood_->neighbor_list.size()==local_indices_.size());
+  assert((int_t)neighborhood_->neighbor_list[0].size()==num_neigh_);
   std::vector<bool> neigh_valid(num_neigh_,true);
   int_t neigh_id = 0;
   for(size_t pt=0;pt<local_indices_.size();++pt){
@@ -1205,7 +1343,7 @@ Live_Plot_Post_Processor::execute(){
     // search the neighbors to see how many valid neighbors exist:
     int_t num_valid_neigh = 0;
     for(int_t j=0;j<num_neigh_;++j){
-      if(sigma->local_value(neighbor_list_[pt][j])>=0.0){
+      if(sigma->local_value(neighborhood_->neighbor_list[pt][j])>=0.0){
         neigh_valid[j] = true;
         num_valid_neigh++;
       }else{
@@ -1232,14 +1370,14 @@ Live_Plot_Post_Processor::execute(){
       int_t valid_id = 0;
       for(int_t j=0;j<num_neigh_;++j){
         if(!neigh_valid[j])continue;
-        neigh_id = neighbor_list_[pt][j];
+        neigh_id = neighborhood_->neighbor_list[pt][j];
         for(int_t field_it=0;field_it<num_fields;++field_it){
           u[field_it][valid_id] = field_vec[field_it]->local_value(neigh_id);
         }
         // set up the X^T matrix
         X_t(0,valid_id) = 1.0;
-        X_t(1,valid_id) = neighbor_dist_x_[pt][j];
-        X_t(2,valid_id) = neighbor_dist_y_[pt][j];
+        X_t(1,valid_id) = neighborhood_->neighbor_dist_x[pt][j];
+        X_t(2,valid_id) = neighborhood_->neighbor_dist_y[pt][j];
         valid_id++;
       }
       // set up X^T*X
@@ -43,12 +43,14 @@
 #define DICE_POSTPROCESSOR_H
 
 #include <DICe.h>
+#include <DICe_MemoryTracker.h>
 #include <DICe_Mesh.h>
 #include <DICe_PointCloud.h>
 
 #include <Teuchos_ParameterList.hpp>
 
 #include <cassert>
+#include <map>
 
 namespace DICe {
 
@@ -116,6 +118,86 @@ const char * const nlvc_dvdx = "NLVC_DVDX";
 /// String field name
 const char * const nlvc_dvdy = "NLVC_DVDY";
 
+/// \class DICe::Neighborhood
+/// \brief Neighbor lists for each local point of a mesh
+struct DICE_LIB_DLL_EXPORT
+Neighborhood{
+  /// array holding the overlap ids of the neighbors for each point
+  std::vector<std::vector<int_t> > neighbor_list;
+  /// array holding the signed x distances for each neighbor
+  std::vector<std::vector<scalar_t> > neighbor_dist_x;
+  /// array holding the signed y distances for each neighbor
+  std::vector<std::vector<scalar_t> > neighbor_dist_y;
+};
+
+/// \class DICe::Neighborhood_Cache
+/// \brief Neighborhoods shared by all the post processors of a mesh
+///
+/// One kd-tree is built for each set of coordinate fields and the neighbor lists are stored for each
+/// search radius so that post processors with the same coordinates and radius share the same lists.
+/// The coordinates are compared each time a neighborhood is requested and the kd-tree
+/// and neighbor lists are only rebuilt if the coordinates have changed.
+class DICE_LIB_DLL_EXPORT
+Neighborhood_Cache{
+public:
+  /// \brief Default constructor
+  /// \param mesh Pointer to the mesh that holds the coordinate fields
+  Neighborhood_Cache(Teuchos::RCP<DICe::mesh::Mesh> mesh);
+
+  /// Virtual destructor
+  virtual ~Neighborhood_Cache(){}
+
+  /// returns the neighbor lists for each local point of the mesh (the lists must not be modified)
+  /// \param coords_x_name name of the x coordinates field
+  /// \param coords_y_name name of the y coordinates field
+  /// \param neighborhood_radius inclusive radius of a point's neighborhood
+  /// if the radius is positive a radius search is used to construct the neighbors
+  /// if the radius is negative, the search is k-nearest neighbors with the k being (int)(-1*radius)
+  Teuchos::RCP<Neighborhood> neighborhood(const std::string & coords_x_name,
+    const std::string & coords_y_name,
+    const scalar_t & neighborhood_radius);
+
+  /// returns the mesh the neighborhoods are built for
+  Teuchos::RCP<DICe::mesh::Mesh> mesh()const{
+    return mesh_;
+  }
+
+  /// returns the number of kd-trees that have been built
+  int_t num_kd_tree_builds()const{
+    return num_kd_tree_builds_;
+  }
+
+  /// returns the number of neighbor searches that have been performed
+  int_t num_neighborhood_searches()const{
+    return num_neighborhood_searches_;
+  }
+
+private:
+  /// update the bytes held by the kd-trees and neighbor lists in the memory tracker
+  void update_memory_usage();
+  /// kd-tree and neighborhoods for one set of coordinate fields
+  struct Coordinates_Entry{
+    /// coordinates of the overlap points (x and y interleaved) the kd-tree was built with
+    std::vector<scalar_t> coords;
+    /// point cloud used for the neighbor searching
+    Teuchos::RCP<Point_Cloud_2D<scalar_t> > point_cloud;
+    /// kd-tree of the point cloud
+    Teuchos::RCP<kd_tree_2d_t> kd_tree;
+    /// neighbor lists for each search radius
+    std::map<scalar_t,Teuchos::RCP<Neighborhood> > neighborhoods;
+  };
+  /// Pointer to the mesh
+  Teuchos::RCP<DICe::mesh::Mesh> mesh_;
+  /// entries keyed by the coordinate field names
+  std::map<std::pair<std::string,std::string>,Coordinates_Entry> entries_;
+  /// number of kd-trees that have been built
+  int_t num_kd_tree_builds_;
+  /// number of neighbor searches that have been performed
+  int_t num_neighborhood_searches_;
+  /// bytes held by the kd-trees and neighbor lists
+  Tracked_Memory memory_;
+};
+
 /// \class DICe::Post_Processor
 /// \brief A class for computing variables based on the field values and associated utilities
 ///
@@ -131,7 +213,16 @@ public:
 
   /// operations that all post processors need to do after construction
   /// \param mesh Pointer to a computational mesh with fields and discretization
-  void initialize(Teuchos::RCP<DICe::mesh::Mesh> & mesh);
+  /// \param neighborhood_cache neighborhoods shared with the other post processors of the mesh
+  /// (if null, this post processor builds its own)
+  void initialize(Teuchos::RCP<DICe::mesh::Mesh> & mesh,
+    Teuchos::RCP<Neighborhood_Cache> neighborhood_cache=Teuchos::null);
+
+  /// set the number of threads used to process the points
+  /// \param num_threads the number of threads
+  void set_num_threads(const int_t num_threads){
+    num_threads_ = num_threads > 0 ? num_threads : 1;
+  }
 
   /// set up the neighbor lists for each point
   /// \param neighborhood_radius inclusive radius of a point's neighborhood
@@ -162,6 +253,11 @@ public:
     return & field_specs_;
   }
 
+  /// Returns the name of this post processor
+  const std::string & name()const{
+    return name_;
+  }
+
 protected:
   /// Pointer to the mesh to access fields and discretization
   Teuchos::RCP<DICe::mesh::Mesh> mesh_;
@@ -175,14 +271,14 @@ protected:
   std::vector<DICe::field_enums::Field_Spec> field_specs_;
   /// pointer to the point cloud used for the neighbor searching
   Teuchos::RCP<Point_Cloud_2D<scalar_t> > point_cloud_;
-  /// array holding the number of neighbors for each point
-  std::vector<std::vector<int_t> > neighbor_list_;
-  /// array holding the signed x distances for each neighbor in one long strided array
-  std::vector<std::vector<scalar_t> > neighbor_dist_x_;
-  /// array holding the signed y distances for each neighbor in one long strided array
-  std::vector<std::vector<scalar_t> > neighbor_dist_y_;
+  /// neighborhoods shared with the other post processors of the mesh
+  Teuchos::RCP<Neighborhood_Cache> neighborhood_cache_;
+  /// the neighbor lists for each point
+  Teuchos::RCP<Neighborhood> neighborhood_;
   /// true when the neighbor lists have been constructed
   bool neighborhood_initialized_;
+  /// number of threads used to process the points
+  int_t num_threads_;
   /// holds the field name to be used for coordinates field
   std::string coords_x_name_;
   /// holds the field name to be used for coordinates field
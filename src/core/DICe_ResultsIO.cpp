@@ -0,0 +1,318 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_ResultsIO.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdint.h>
+
+namespace DICe {
+
+/// marks the start of a binary results file
+const static char binary_results_magic[8] = {'D','I','C','e','_','B','I','N'};
+/// version of the binary results format
+const static uint32_t binary_results_version = 1;
+/// written in native byte order so a reader can detect files from a machine with a different byte order
+const static uint32_t binary_results_byte_order = 0x01020304;
+
+/// 64 bit file seek (the results files can be larger than 2 GB)
+static int seek_file(std::FILE * file,
+  const int64_t offset,
+  const int origin){
+#if defined(WIN32)
+  return _fseeki64(file,offset,origin);
+#else
+  return fseeko(file,(off_t)offset,origin);
+#endif
+}
+
+/// 64 bit file position
+static int64_t tell_file(std::FILE * file){
+#if defined(WIN32)
+  return _ftelli64(file);
+#else
+  return (int64_t)ftello(file);
+#endif
+}
+
+Binary_Results_Writer::Binary_Results_Writer(const std::string & file_name,
+  const std::vector<std::string> & field_names,
+  const std::vector<int_t> & subset_ids):
+  file_name_(file_name),
+  file_(NULL),
+  num_fields_(field_names.size()),
+  num_subsets_(subset_ids.size()){
+  file_ = fopen(file_name.c_str(),"wb");
+  TEUCHOS_TEST_FOR_EXCEPTION(file_==NULL,std::runtime_error,"Error, could not create binary results file " << file_name);
+  const uint32_t value_size = sizeof(scalar_t);
+  const uint32_t num_fields = num_fields_;
+  const uint32_t num_subsets = num_subsets_;
+  fwrite(binary_results_magic,1,sizeof(binary_results_magic),file_);
+  fwrite(&binary_results_byte_order,sizeof(uint32_t),1,file_);
+  fwrite(&binary_results_version,sizeof(uint32_t),1,file_);
+  fwrite(&value_size,sizeof(uint32_t),1,file_);
+  fwrite(&num_fields,sizeof(uint32_t),1,file_);
+  fwrite(&num_subsets,sizeof(uint32_t),1,file_);
+  for(size_t i=0;i<field_names.size();++i){
+    const uint32_t name_size = field_names[i].size();
+    fwrite(&name_size,sizeof(uint32_t),1,file_);
+    fwrite(field_names[i].c_str(),1,name_size,file_);
+  }
+  std::vector<int32_t> ids(subset_ids.begin(),subset_ids.end());
+  if(!ids.empty())
+    fwrite(&ids[0],sizeof(int32_t),ids.size(),file_);
+  TEUCHOS_TEST_FOR_EXCEPTION(ferror(file_),std::runtime_error,"Error, could not write the header of binary results file " << file_name);
+  fflush(file_);
+}
+
+Binary_Results_Writer::~Binary_Results_Writer(){
+  if(file_!=NULL)
+    fclose(file_);
+}
+
+void
+Binary_Results_Writer::write_frame(const int_t frame_id,
+  const std::vector<scalar_t> & values){
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t)values.size()!=num_fields_*num_subsets_,std::runtime_error,
+    "Error, binary results frame has " << values.size() << " values, but should have " << num_fields_*num_subsets_);
+  const int32_t id = frame_id;
+  fwrite(&id,sizeof(int32_t),1,file_);
+  if(!values.empty())
+    fwrite(&values[0],sizeof(scalar_t),values.size(),file_);
+  TEUCHOS_TEST_FOR_EXCEPTION(ferror(file_),std::runtime_error,"Error, could not write frame " << frame_id << " to binary results file " << file_name_);
+  // flush so that the completed frames can be read while the analysis is still running
+  fflush(file_);
+}
+
+Binary_Results_Reader::Binary_Results_Reader(const std::string & file_name):
+  file_name_(file_name),
+  file_(NULL),
+  value_size_(0),
+  header_size_(0),
+  record_size_(0){
+  file_ = fopen(file_name.c_str(),"rb");
+  TEUCHOS_TEST_FOR_EXCEPTION(file_==NULL,std::runtime_error,"Error, could not open binary results file " << file_name);
+  char magic[sizeof(binary_results_magic)];
+  uint32_t byte_order = 0;
+  uint32_t version = 0;
+  uint32_t value_size = 0;
+  uint32_t num_fields = 0;
+  uint32_t num_subsets = 0;
+  bool valid = fread(magic,1,sizeof(magic),file_)==sizeof(magic) && std::memcmp(magic,binary_results_magic,sizeof(magic))==0;
+  TEUCHOS_TEST_FOR_EXCEPTION(!valid,std::runtime_error,"Error, " << file_name << " is not a binary results file");
+  valid = fread(&byte_order,sizeof(uint32_t),1,file_)==1 && fread(&version,sizeof(uint32_t),1,file_)==1 &&
+      fread(&value_size,sizeof(uint32_t),1,file_)==1 && fread(&num_fields,sizeof(uint32_t),1,file_)==1 &&
+      fread(&num_subsets,sizeof(uint32_t),1,file_)==1;
+  TEUCHOS_TEST_FOR_EXCEPTION(!valid,std::runtime_error,"Error, could not read the header of binary results file " << file_name);
+  TEUCHOS_TEST_FOR_EXCEPTION(byte_order!=binary_results_byte_order,std::runtime_error,
+    "Error, binary results file " << file_name << " was written on a machine with a different byte order");
+  TEUCHOS_TEST_FOR_EXCEPTION(version!=binary_results_version,std::runtime_error,
+    "Error, unsupported binary results file version " << version);
+  TEUCHOS_TEST_FOR_EXCEPTION(value_size!=sizeof(float)&&value_size!=sizeof(double),std::runtime_error,
+    "Error, invalid value size in binary results file " << value_size);
+  value_size_ = value_size;
+  field_names_.resize(num_fields);
+  for(uint32_t i=0;i<num_fields;++i){
+    uint32_t name_size = 0;
+    valid = fread(&name_size,sizeof(uint32_t),1,file_)==1;
+    std::vector<char> name(name_size+1,'\0');
+    valid = valid && (name_size==0||fread(&name[0],1,name_size,file_)==name_size);
+    TEUCHOS_TEST_FOR_EXCEPTION(!valid,std::runtime_error,"Error, could not read the field names of binary results file " << file_name);
+    field_names_[i] = std::string(&name[0]);
+  }
+  std::vector<int32_t> ids(num_subsets);
+  valid = num_subsets==0||fread(&ids[0],sizeof(int32_t),num_subsets,file_)==num_subsets;
+  TEUCHOS_TEST_FOR_EXCEPTION(!valid,std::runtime_error,"Error, could not read the subset ids of binary results file " << file_name);
+  subset_ids_.assign(ids.begin(),ids.end());
+  header_size_ = tell_file(file_);
+  record_size_ = sizeof(int32_t) + (int64_t)num_fields*num_subsets*value_size_;
+}
+
+Binary_Results_Reader::~Binary_Results_Reader(){
+  if(file_!=NULL)
+    fclose(file_);
+}
+
+void
+Binary_Results_Reader::seek(const int64_t offset){
+  TEUCHOS_TEST_FOR_EXCEPTION(seek_file(file_,offset,SEEK_SET)!=0,std::runtime_error,
+    "Error, could not seek in binary results file " << file_name_);
+}
+
+int_t
+Binary_Results_Reader::num_frames(){
+  TEUCHOS_TEST_FOR_EXCEPTION(seek_file(file_,0,SEEK_END)!=0,std::runtime_error,
+    "Error, could not seek in binary results file " << file_name_);
+  // a partially written record at the end of the file is not counted
+  return (int_t)((tell_file(file_) - header_size_)/record_size_);
+}
+
+void
+Binary_Results_Reader::read_values(const int_t num_values,
+  scalar_t * values){
+  if(num_values==0) return;
+  bool valid = false;
+  if(value_size_==(int_t)sizeof(scalar_t)){
+    valid = fread(values,sizeof(scalar_t),num_values,file_)==(size_t)num_values;
+  }
+  else if(value_size_==(int_t)sizeof(float)){
+    std::vector<float> buffer(num_values);
+    valid = fread(&buffer[0],sizeof(float),num_values,file_)==(size_t)num_values;
+    for(int_t i=0;i<num_values;++i)
+      values[i] = buffer[i];
+  }
+  else{
+    std::vector<double> buffer(num_values);
+    valid = fread(&buffer[0],sizeof(double),num_values,file_)==(size_t)num_values;
+    for(int_t i=0;i<num_values;++i)
+      values[i] = buffer[i];
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(!valid,std::runtime_error,"Error, could not read values from binary results file " << file_name_);
+}
+
+void
+Binary_Results_Reader::read_frame(const int_t frame_index,
+  int_t & frame_id,
+  std::vector<scalar_t> & values){
+  TEUCHOS_TEST_FOR_EXCEPTION(frame_index<0||frame_index>=num_frames(),std::runtime_error,
+    "Error, invalid frame index " << frame_index << " for binary results file " << file_name_);
+  seek(header_size_ + frame_index*record_size_);
+  int32_t id = 0;
+  TEUCHOS_TEST_FOR_EXCEPTION(fread(&id,sizeof(int32_t),1,file_)!=1,std::runtime_error,
+    "Error, could not read frame " << frame_index << " from binary results file " << file_name_);
+  frame_id = id;
+  values.resize(num_fields()*num_subsets());
+  read_values(values.size(),values.empty() ? NULL : &values[0]);
+}
+
+void
+Binary_Results_Reader::read_field(const int_t frame_index,
+  const std::string & field_name,
+  std::vector<scalar_t> & values){
+  TEUCHOS_TEST_FOR_EXCEPTION(frame_index<0||frame_index>=num_frames(),std::runtime_error,
+    "Error, invalid frame index " << frame_index << " for binary results file " << file_name_);
+  int_t field = -1;
+  for(size_t i=0;i<field_names_.size();++i)
+    if(field_names_[i]==field_name) field = i;
+  TEUCHOS_TEST_FOR_EXCEPTION(field<0,std::runtime_error,"Error, field " << field_name << " is not in binary results file " << file_name_);
+  // only the column for this field is read
+  seek(header_size_ + frame_index*record_size_ + (int64_t)sizeof(int32_t) + (int64_t)field*num_subsets()*value_size_);
+  values.resize(num_subsets());
+  read_values(values.size(),values.empty() ? NULL : &values[0]);
+}
+
+Subset_Text_Writer::Subset_Text_Writer(const std::vector<std::string> & file_names,
+  const int_t max_open_files,
+  const size_t max_buffered_bytes):
+  file_names_(file_names),
+  buffers_(file_names.size()),
+  files_(file_names.size(),NULL),
+  open_list_pos_(file_names.size()),
+  max_open_files_(max_open_files),
+  max_buffered_bytes_(max_buffered_bytes),
+  buffered_bytes_(0),
+  memory_(MEMORY_OUTPUT_BUFFERS){
+  TEUCHOS_TEST_FOR_EXCEPTION(max_open_files_<1,std::runtime_error,"Error, max_open_files must be at least 1");
+}
+
+Subset_Text_Writer::~Subset_Text_Writer(){
+  try{
+    flush();
+  }
+  catch(std::exception & e){
+    std::cout << e.what() << std::endl;
+  }
+  for(size_t i=0;i<files_.size();++i)
+    if(files_[i]) fclose(files_[i]);
+}
+
+std::FILE *
+Subset_Text_Writer::file(const int_t subset){
+  if(files_[subset]){
+    // move the file to the front of the recently written list
+    open_list_.splice(open_list_.begin(),open_list_,open_list_pos_[subset]);
+    return files_[subset];
+  }
+  if((int_t)open_list_.size()>=max_open_files_){
+    const int_t oldest = open_list_.back();
+    open_list_.pop_back();
+    fclose(files_[oldest]);
+    files_[oldest] = NULL;
+  }
+  files_[subset] = fopen(file_names_[subset].c_str(),"a");
+  TEUCHOS_TEST_FOR_EXCEPTION(files_[subset]==NULL,std::runtime_error,"Error, could not open output file " << file_names_[subset]);
+  open_list_.push_front(subset);
+  open_list_pos_[subset] = open_list_.begin();
+  return files_[subset];
+}
+
+void
+Subset_Text_Writer::append(const int_t subset,
+  const std::string & row){
+  TEUCHOS_TEST_FOR_EXCEPTION(subset<0||subset>=num_subsets(),std::runtime_error,"Error, invalid subset index " << subset);
+  buffers_[subset] += row;
+  buffered_bytes_ += row.size();
+  if(buffered_bytes_>=max_buffered_bytes_)
+    flush();
+  else
+    memory_.set(buffered_bytes_);
+}
+
+void
+Subset_Text_Writer::flush(){
+  for(size_t subset=0;subset<buffers_.size();++subset){
+    std::string & buffer = buffers_[subset];
+    if(buffer.empty()) continue;
+    std::FILE * file_ptr = file(subset);
+    TEUCHOS_TEST_FOR_EXCEPTION(fwrite(buffer.data(),1,buffer.size(),file_ptr)!=buffer.size(),std::runtime_error,
+      "Error, could not write to output file " << file_names_[subset]);
+    fflush(file_ptr);
+    buffer.clear();
+  }
+  buffered_bytes_ = 0;
+  memory_.set(0);
+}
+
+}// End DICe Namespace
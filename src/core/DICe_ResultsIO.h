@@ -0,0 +1,261 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_RESULTSIO_H
+#define DICE_RESULTSIO_H
+
+#include <DICe.h>
+#include <DICe_MemoryTracker.h>
+
+#include <cstdio>
+#include <list>
+#include <string>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+/// \class DICe::Binary_Results_Writer
+/// \brief Writes the subset results for every frame to one append-only binary file
+///
+/// The file starts with a header that lists the field names and the global ids of the subsets,
+/// followed by one fixed size record per frame. Each record has the frame id and then the values
+/// of each field for all of the subsets (one column per field, in the order of the header). Since
+/// every record is the same size, any frame or field can be read without parsing the rest of the file.
+/// The values are stored with the size of scalar_t and native byte order (recorded in the header).
+class DICE_LIB_DLL_EXPORT
+Binary_Results_Writer
+{
+public:
+  /// \brief constructor, creates the file and writes the header (an existing file is overwritten)
+  /// \param file_name the name of the file to create
+  /// \param field_names the names of the fields in each record
+  /// \param subset_ids the global ids of the subsets in each record
+  Binary_Results_Writer(const std::string & file_name,
+    const std::vector<std::string> & field_names,
+    const std::vector<int_t> & subset_ids);
+
+  /// destructor, closes the file
+  virtual ~Binary_Results_Writer();
+
+  /// \brief append a frame to the file
+  /// \param frame_id the frame id
+  /// \param values the field values stored by field, values[field*num_subsets() + subset]
+  void write_frame(const int_t frame_id,
+    const std::vector<scalar_t> & values);
+
+  /// returns the number of subsets in each record
+  int_t num_subsets()const{
+    return num_subsets_;
+  }
+
+  /// returns the number of fields in each record
+  int_t num_fields()const{
+    return num_fields_;
+  }
+
+private:
+  /// not copyable since the writer owns the open file
+  Binary_Results_Writer(const Binary_Results_Writer &);
+  /// not assignable since the writer owns the open file
+  Binary_Results_Writer & operator=(const Binary_Results_Writer &);
+  /// the name of the file
+  std::string file_name_;
+  /// the open file
+  std::FILE * file_;
+  /// the number of fields in each record
+  int_t num_fields_;
+  /// the number of subsets in each record
+  int_t num_subsets_;
+};
+
+/// \class DICe::Subset_Text_Writer
+/// \brief Appends rows to one text file per subset without opening and closing every file for every frame
+///
+/// The rows are buffered in memory and written to the files in one block per file when the buffered
+/// rows reach a size limit (or flush() is called). Up to a fixed number of files are kept open between
+/// writes, the least recently written file is closed if another one has to be opened.
+class DICE_LIB_DLL_EXPORT
+Subset_Text_Writer
+{
+public:
+  /// \brief constructor (the files are opened to append, they must already exist)
+  /// \param file_names the name of the file of each subset
+  /// \param max_open_files the maximum number of files kept open at once
+  /// \param max_buffered_bytes the size of the buffered rows (for all subsets) that triggers a write
+  Subset_Text_Writer(const std::vector<std::string> & file_names,
+    const int_t max_open_files=256,
+    const size_t max_buffered_bytes=16*1024*1024);
+
+  /// destructor, writes the buffered rows and closes the files
+  virtual ~Subset_Text_Writer();
+
+  /// \brief add a row to the file of a subset
+  /// \param subset the index of the subset
+  /// \param row the text of the row
+  void append(const int_t subset,
+    const std::string & row);
+
+  /// write all of the buffered rows to the files
+  void flush();
+
+  /// returns the number of subsets
+  int_t num_subsets()const{
+    return file_names_.size();
+  }
+
+  /// returns the number of files that are open
+  int_t num_open_files()const{
+    return open_list_.size();
+  }
+
+private:
+  /// not copyable since the writer owns the open files
+  Subset_Text_Writer(const Subset_Text_Writer &);
+  /// not assignable since the writer owns the open files
+  Subset_Text_Writer & operator=(const Subset_Text_Writer &);
+  /// returns the open file of a subset (opens it and closes the least recently written file if needed)
+  std::FILE * file(const int_t subset);
+  /// the name of the file of each subset
+  std::vector<std::string> file_names_;
+  /// the buffered rows of each subset
+  std::vector<std::string> buffers_;
+  /// the open file of each subset (NULL if it is closed)
+  std::vector<std::FILE*> files_;
+  /// the subsets with open files, most recently written first
+  std::list<int_t> open_list_;
+  /// the position of each subset in the open list (valid only if the file is open)
+  std::vector<std::list<int_t>::iterator> open_list_pos_;
+  /// the maximum number of open files
+  int_t max_open_files_;
+  /// the size of the buffered rows that triggers a write
+  size_t max_buffered_bytes_;
+  /// the size of the buffered rows
+  size_t buffered_bytes_;
+  /// bytes held by the buffered rows
+  Tracked_Memory memory_;
+};
+
+/// \class DICe::Binary_Results_Reader
+/// \brief Reads the files written by DICe::Binary_Results_Writer
+class DICE_LIB_DLL_EXPORT
+Binary_Results_Reader
+{
+public:
+  /// \brief constructor, reads the header
+  /// \param file_name the name of the file to read
+  Binary_Results_Reader(const std::string & file_name);
+
+  /// destructor, closes the file
+  virtual ~Binary_Results_Reader();
+
+  /// returns the field names
+  const std::vector<std::string> & field_names()const{
+    return field_names_;
+  }
+
+  /// returns the global ids of the subsets
+  const std::vector<int_t> & subset_ids()const{
+    return subset_ids_;
+  }
+
+  /// returns the number of fields in each record
+  int_t num_fields()const{
+    return field_names_.size();
+  }
+
+  /// returns the number of subsets in each record
+  int_t num_subsets()const{
+    return subset_ids_.size();
+  }
+
+  /// returns the number of complete frames in the file
+  int_t num_frames();
+
+  /// \brief read all of the fields for a frame
+  /// \param frame_index the position of the frame in the file (0 is the first frame written)
+  /// \param frame_id [out] the id of the frame
+  /// \param values [out] the field values stored by field, values[field*num_subsets() + subset]
+  void read_frame(const int_t frame_index,
+    int_t & frame_id,
+    std::vector<scalar_t> & values);
+
+  /// \brief read one field for a frame
+  /// \param frame_index the position of the frame in the file (0 is the first frame written)
+  /// \param field_name the name of the field
+  /// \param values [out] the field values for each subset
+  void read_field(const int_t frame_index,
+    const std::string & field_name,
+    std::vector<scalar_t> & values);
+
+private:
+  /// not copyable since the reader owns the open file
+  Binary_Results_Reader(const Binary_Results_Reader &);
+  /// not assignable since the reader owns the open file
+  Binary_Results_Reader & operator=(const Binary_Results_Reader &);
+  /// move the file position to a location in the file
+  void seek(const int64_t offset);
+  /// read values of the stored size into values
+  void read_values(const int_t num_values,
+    scalar_t * values);
+  /// the name of the file
+  std::string file_name_;
+  /// the open file
+  std::FILE * file_;
+  /// the field names
+  std::vector<std::string> field_names_;
+  /// the global ids of the subsets
+  std::vector<int_t> subset_ids_;
+  /// size in bytes of each stored value (4 or 8)
+  int_t value_size_;
+  /// offset to the first record
+  int64_t header_size_;
+  /// size of each record in bytes
+  int64_t record_size_;
+};
+
+}// End DICe Namespace
+
+#endif
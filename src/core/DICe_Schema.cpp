@@ -50,6 +50,19 @@
 #include <DICe_Triangulation.h>
 #include <DICe_Simplex.h>
 #include <DICe_Cine.h>
+#include <DICe_ResultsIO.h>
+#include <DICe_OutputWriter.h>
+#include <DICe_HaloExchange.h>
+#include <DICe_Profiler.h>
+#include <DICe_Trace.h>
+#include <DICe_FrameArena.h>
+#include <DICe_ImageBufferPool.h>
+#include <DICe_NodeSharedMemory.h>
+#include <DICe_SharedFrameCache.h>
+#if DICE_KOKKOS
+  #include <DICe_SubsetBatch.h>
+  #include <DICe_KokkosPolicyTuner.h>
+#endif
 #ifdef DICE_ENABLE_GLOBAL
   #include <DICe_MeshIO.h>
   #include <DICe_MeshIOUtils.h>
@@ -58,15 +71,28 @@
 #include <Teuchos_XMLParameterListHelpers.hpp>
 #include <Teuchos_ArrayRCP.hpp>
 
+#include <chrono>
 #include <ctime>
+#include <cstdarg>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <queue>
 #include <tuple>
+#include <functional>
+#include <memory>
 #include <math.h>
+#include <cmath>
 
 #include <cassert>
 #include <set>
+#include <limits>
+#include <exception>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifndef DICE_DISABLE_BOOST_FILESYSTEM
   #include <boost/filesystem.hpp>
@@ -158,39 +184,99 @@ Schema::rotate_def_image(){
   }
 }
 
+Teuchos::RCP<Teuchos::ParameterList>
+Schema::def_image_params()const{
+  Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
+  // the filter and gradients are applied later if the motion tests use the raw pixels
+  const bool preprocess = !test_motion_on_raw_pixels();
+  imgParams->set(DICe::compute_image_gradients,compute_def_gradients_&&preprocess);
+  imgParams->set(DICe::lazy_image_gradients,lazy_image_gradients_);
+  imgParams->set(DICe::analytic_def_gradients,analytic_def_gradients_);
+  imgParams->set(DICe::quantized_interpolation_weights,quantized_interpolation_weights_);
+  imgParams->set(DICe::gauss_filter_images,gauss_filter_images_&&preprocess);
+  imgParams->set(DICe::gauss_filter_mask_size,gauss_filter_mask_size_);
+  imgParams->set(DICe::num_threads,num_threads_);
+  imgParams->set(DICe::gradient_method,gradient_method_);
+  return imgParams;
+}
+
+void
+Schema::def_image_region(const int_t img_width,
+  const int_t img_height,
+  int_t & offset_x,
+  int_t & offset_y,
+  int_t & width,
+  int_t & height)const{
+  if(!has_extents_){
+    offset_x = 0;
+    offset_y = 0;
+    width = -1;
+    height = -1;
+    return;
+  }
+  const int_t buffer = 100; // if the extents are within 100 pixels of the image boundary use the whole image
+  offset_x = def_extents_[0] > buffer && def_extents_[0] < img_width - buffer ? def_extents_[0] : 0;
+  offset_y = def_extents_[2] > buffer && def_extents_[2] < img_height - buffer ? def_extents_[2] : 0;
+  const int_t end_x = def_extents_[1] > buffer && def_extents_[1] < img_width - buffer ? def_extents_[1] : img_width;
+  const int_t end_y = def_extents_[3] > buffer && def_extents_[3] < img_height - buffer ? def_extents_[3] : img_height;
+  width = end_x - offset_x;
+  height = end_y - offset_y;
+}
+
 void
 Schema::set_def_image(const std::string & defName,
   const int_t id){
   DEBUG_MSG("Schema: Resetting the deformed image");
   assert(def_imgs_.size()>0);
   assert(id<(int_t)def_imgs_.size());
-  Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
-  imgParams->set(DICe::compute_image_gradients,compute_def_gradients_);
-  imgParams->set(DICe::gauss_filter_images,gauss_filter_images_);
-  imgParams->set(DICe::gauss_filter_mask_size,gauss_filter_mask_size_);
-  imgParams->set(DICe::gradient_method,gradient_method_);
+  Teuchos::RCP<Teuchos::ParameterList> imgParams = def_image_params();
+  const Teuchos::RCP<Image> old_frame = def_imgs_[id];
 
   // query the image dimensions:
-  if(has_extents_){
+  if(node_shared_images()){
+    // the whole frame is read once per node (the processes' regions are all in it)
+    def_imgs_[id] = read_node_shared_image(defName,imgParams);
+  }
+  else if(has_extents_){
     int_t w = 0;
     int_t h = 0;
     utils::read_image_dimensions(defName.c_str(),w,h);
-    const int_t buffer = 100; // if the extents are within 100 pixels of the image boundary use the whole image
-    const int_t offset_x = def_extents_[0] > buffer && def_extents_[0] < w - buffer ? def_extents_[0] : 0;
-    const int_t offset_y = def_extents_[2] > buffer && def_extents_[2] < h - buffer ? def_extents_[2] : 0;
-    const int_t end_x = def_extents_[1] > buffer && def_extents_[1] < w - buffer ? def_extents_[1] : w;
-    const int_t end_y = def_extents_[3] > buffer && def_extents_[3] < h - buffer ? def_extents_[3] : h;
-    const int_t width = end_x - offset_x;
-    const int_t height = end_y - offset_y;
-    def_imgs_[id] = Teuchos::rcp( new Image(defName.c_str(),offset_x,offset_y,width,height,imgParams));
+    int_t offset_x = 0, offset_y = 0, width = 0, height = 0;
+    def_image_region(w,h,offset_x,offset_y,width,height);
+    // the raw pixels are filtered in place later so they can't be shared
+    if(test_motion_on_raw_pixels())
+      def_imgs_[id] = Teuchos::rcp( new Image(defName.c_str(),offset_x,offset_y,width,height,imgParams));
+    else
+      def_imgs_[id] = Shared_Frame_Cache::frame(defName,offset_x,offset_y,width,height,imgParams);
   }
-  else
+  else if(test_motion_on_raw_pixels())
     def_imgs_[id] = Teuchos::rcp( new Image(defName.c_str(),imgParams));
+  else
+    def_imgs_[id] = Shared_Frame_Cache::frame(defName,0,0,-1,-1,imgParams);
+  if(test_motion_on_raw_pixels()){
+    raw_def_imgs_[id] = def_imgs_[id];
+    def_preprocessing_pending_ = true;
+  }
   //TEUCHOS_TEST_FOR_EXCEPTION(def_imgs_[id]->width()!=ref_img_->width()||def_imgs_[id]->height()!=ref_img_->height(),
   //  std::runtime_error,"Error, ref and def images must have the same dimensions");
   if(def_image_rotation_!=ZERO_DEGREES){
     def_imgs_[id] = def_imgs_[id]->apply_rotation(def_image_rotation_);
   }
+  if(id==0) share_def_frame(old_frame);
+}
+
+void
+Schema::share_def_frame(const Teuchos::RCP<Image> & old_frame){
+  for(size_t i=1;i<def_imgs_.size();++i){
+    if(def_imgs_[i]==Teuchos::null||def_imgs_[i]==old_frame){
+      def_imgs_[i] = def_imgs_[0];
+      if(i<raw_def_imgs_.size())
+        raw_def_imgs_[i] = raw_def_imgs_[0];
+    }
+    // the first frame is compared to the reference frame
+    if(i<prev_imgs_.size()&&prev_imgs_[i]==Teuchos::null&&def_imgs_[i]==def_imgs_[0])
+      prev_imgs_[i] = prev_imgs_[0];
+  }
 }
 
 void
@@ -199,19 +285,252 @@ Schema::set_def_image(Teuchos::RCP<Image> img,
   DEBUG_MSG("Schema::set_def_image() Resetting the deformed image for sub image id " << id);
   assert(def_imgs_.size()>0);
   assert(id<(int_t)def_imgs_.size());
+  const Teuchos::RCP<Image> old_frame = def_imgs_[id];
   def_imgs_[id] = img;
-  if(gauss_filter_images_&&!def_imgs_[id]->has_gauss_filter()){ // the filter may have alread been applied to the image
-      def_imgs_[id]->gauss_filter(gauss_filter_mask_size_);
-  }
-  if(compute_def_gradients_&&!def_imgs_[id]->has_gradients()){
-    def_imgs_[id]->compute_gradients();
+  def_imgs_[id]->set_num_threads(num_threads_);
+  def_imgs_[id]->set_lazy_gradients(lazy_image_gradients_);
+  def_imgs_[id]->set_analytic_gradients(analytic_def_gradients_);
+  def_imgs_[id]->set_quantized_interpolation_weights(quantized_interpolation_weights_);
+  if(test_motion_on_raw_pixels()){
+    // the frame is only filtered if a subset has to be correlated (see preprocess_def_images())
+    raw_def_imgs_[id] = def_imgs_[id];
+    def_preprocessing_pending_ = true;
   }
+  else
+    preprocess_def_image(id);
   if(def_image_rotation_!=ZERO_DEGREES){
     Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
     imgParams->set(DICe::compute_image_gradients,true); // automatically compute the gradients if the ref image is changed
     imgParams->set(DICe::gradient_method,gradient_method_);
+    imgParams->set(DICe::analytic_def_gradients,analytic_def_gradients_);
+  imgParams->set(DICe::quantized_interpolation_weights,quantized_interpolation_weights_);
     def_imgs_[id] = def_imgs_[id]->apply_rotation(def_image_rotation_,imgParams);
   }
+  if(id==0) share_def_frame(old_frame);
+}
+
+void
+Schema::preprocess_def_image(const int_t id){
+#if !DICE_KOKKOS
+  if(gauss_filter_images_&&!def_imgs_[id]->has_gauss_filter()&&compute_def_gradients_&&!def_imgs_[id]->has_gradients()){
+    def_imgs_[id]->gauss_filter_and_compute_gradients(gauss_filter_mask_size_);
+  }
+#endif
+  if(gauss_filter_images_&&!def_imgs_[id]->has_gauss_filter()){ // the filter may have alread been applied to the image
+      def_imgs_[id]->gauss_filter(gauss_filter_mask_size_);
+  }
+  if(compute_def_gradients_&&!def_imgs_[id]->has_gradients()){
+    def_imgs_[id]->compute_gradients();
+  }
+}
+
+void
+Schema::preprocess_def_images(){
+  if(!def_preprocessing_pending_) return;
+  def_preprocessing_pending_ = false;
+  DEBUG_MSG("Schema::preprocess_def_images(): filtering the deformed images now that a subset will be correlated");
+  for(size_t i=0;i<def_imgs_.size();++i){
+    if(def_imgs_[i]==Teuchos::null) continue;
+    // frames shared by several motion windows are only filtered once
+    size_t first = i;
+    for(size_t j=0;j<i&&first==i;++j)
+      if(def_imgs_[j]==def_imgs_[i]) first = j;
+    if(first!=i){
+      raw_def_imgs_[i] = raw_def_imgs_[first];
+      continue;
+    }
+    // the filter works in place so the raw pixels are kept for the next motion test
+    if(gauss_filter_images_&&!def_imgs_[i]->has_gauss_filter())
+      raw_def_imgs_[i] = Teuchos::rcp(new Image(def_imgs_[i]));
+    preprocess_def_image(i);
+  }
+  prepare_def_interpolants();
+}
+
+void
+Schema::prepare_def_interpolants(){
+#if !DICE_KOKKOS
+  // the B-spline coefficients of the deformed images are computed once up front
+  // so that the subsets (possibly on multiple threads) only read them
+  if(interpolation_method_==CUBIC_BSPLINE||interpolation_method_==QUINTIC_BSPLINE){
+    const int_t degree = interpolation_method_==CUBIC_BSPLINE ? 3 : 5;
+    for(size_t i=0;i<def_imgs_.size();++i){
+      if(def_imgs_[i]!=Teuchos::null)
+        def_imgs_[i]->compute_bspline_coefficients(degree,num_threads_);
+    }
+  }
+  // the same goes for the tiled copy of the deformed images
+  if(use_tiled_image_layout_&&interpolation_method_==KEYS_FOURTH){
+    for(size_t i=0;i<def_imgs_.size();++i){
+      if(def_imgs_[i]!=Teuchos::null)
+        def_imgs_[i]->compute_tiled_layout(num_threads_);
+    }
+  }
+#endif
+}
+
+namespace {
+/// number of frames kept in the motion history of each subset (see Schema::predict_motion())
+const int_t motion_history_depth = 4;
+
+/// FNV-1a hash of a block of bytes, chained through the hash argument
+std::uint64_t
+fnv1a_hash(const void * data,
+  const size_t num_bytes,
+  std::uint64_t hash){
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  for(size_t i=0;i<num_bytes;++i){
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/// name of the cached preprocessed reference image in the cache folder, the key is a hash of the raw pixels
+/// and the preprocessing settings
+std::string
+reference_image_cache_file_name(const std::string & cache_folder,
+  const Teuchos::RCP<Image> & raw_img,
+  const std::vector<int_t> & settings){
+  std::uint64_t hash = 14695981039346656037ULL;
+  const int_t dims[4] = {raw_img->width(),raw_img->height(),raw_img->offset_x(),raw_img->offset_y()};
+  hash = fnv1a_hash(dims,sizeof(dims),hash);
+  hash = fnv1a_hash(settings.data(),settings.size()*sizeof(int_t),hash);
+  hash = fnv1a_hash(raw_img->intensities().getRawPtr(),raw_img->num_pixels()*sizeof(intensity_t),hash);
+  std::stringstream name;
+  name << cache_folder;
+  if(cache_folder[cache_folder.size()-1]!='/'&&cache_folder[cache_folder.size()-1]!='\\')
+    name << "/";
+  name << "ref_image_" << std::hex << hash << ".dpi";
+  return name.str();
+}
+
+/// translation only inverse compositional Gauss-Newton solve of a subset on an image pair that
+/// minimizes the zero normalized sum of squared differences, returns true if the solve converged
+/// \param subset the subset (its reference intensities and gradients must be initialized)
+/// \param def_img the deformed image
+/// \param theta the rotation (held fixed)
+/// \param u [in/out] the x displacement
+/// \param v [in/out] the y displacement
+bool translation_solve(Subset & subset,
+  const Teuchos::RCP<Image> & def_img,
+  const scalar_t & theta,
+  scalar_t & u,
+  scalar_t & v){
+  const int_t max_iterations = 25;
+  const scalar_t tol = 1.0E-3;
+  const int_t n = subset.num_pixels();
+  if(n==0||!subset.has_gradients()) return false;
+  scalar_t mean_f = 0.0;
+  for(int_t i=0;i<n;++i)
+    mean_f += subset.ref_intensities(i);
+  mean_f /= n;
+  // the hessian only depends on the reference gradients so it is assembled once
+  scalar_t norm_f = 0.0, h_xx = 0.0, h_xy = 0.0, h_yy = 0.0;
+  for(int_t i=0;i<n;++i){
+    const scalar_t df = subset.ref_intensities(i) - mean_f;
+    norm_f += df*df;
+    h_xx += subset.grad_x(i)*subset.grad_x(i);
+    h_xy += subset.grad_x(i)*subset.grad_y(i);
+    h_yy += subset.grad_y(i)*subset.grad_y(i);
+  }
+  norm_f = std::sqrt(norm_f);
+  const scalar_t det = h_xx*h_yy - h_xy*h_xy;
+  if(norm_f==0.0||std::abs(det)<1.0E-10) return false;
+  Teuchos::RCP<Local_Shape_Function> shape_function = shape_function_factory();
+  for(int_t it=0;it<max_iterations;++it){
+    shape_function->clear();
+    shape_function->insert_motion(u,v,theta);
+    subset.initialize(def_img,DEF_INTENSITIES,shape_function,KEYS_FOURTH);
+    scalar_t mean_g = 0.0;
+    for(int_t i=0;i<n;++i)
+      mean_g += subset.def_intensities(i);
+    mean_g /= n;
+    scalar_t norm_g = 0.0;
+    for(int_t i=0;i<n;++i)
+      norm_g += (subset.def_intensities(i) - mean_g)*(subset.def_intensities(i) - mean_g);
+    norm_g = std::sqrt(norm_g);
+    if(norm_g==0.0) return false;
+    const scalar_t s = norm_f/norm_g;
+    scalar_t b_x = 0.0, b_y = 0.0;
+    for(int_t i=0;i<n;++i){
+      const scalar_t r = s*(subset.def_intensities(i) - mean_g) - (subset.ref_intensities(i) - mean_f);
+      b_x += subset.grad_x(i)*r;
+      b_y += subset.grad_y(i)*r;
+    }
+    // the reference warp is inverted and composed with the current one (a subtraction for a translation)
+    const scalar_t du = (h_yy*b_x - h_xy*b_y)/det;
+    const scalar_t dv = (h_xx*b_y - h_xy*b_x)/det;
+    u -= du;
+    v -= dv;
+    if(!std::isfinite(u)||!std::isfinite(v)) return false;
+    if(std::sqrt(du*du+dv*dv)<tol) return true;
+  }
+  return false;
+}
+}
+
+void
+Schema::pyramid_pre_correlation(){
+  // motion windows correlate on their own sub images
+  if(ref_img_==Teuchos::null||def_imgs_.size()!=1||def_imgs_[0]==Teuchos::null) return;
+  Scoped_Profile_Timer guess_timer(PROFILE_INITIAL_GUESS);
+  const int_t num_levels = pyramid_correlation_levels_;
+  // the levels are built (and differentiated) up front so the subsets only read them
+  std::vector<Teuchos::RCP<Image> > ref_levels(num_levels+1);
+  std::vector<Teuchos::RCP<Image> > def_levels(num_levels+1);
+  for(int_t level=1;level<=num_levels;++level){
+    ref_levels[level] = ref_img_->pyramid_level(level);
+    if(!ref_levels[level]->has_gradients())
+      ref_levels[level]->compute_gradients();
+    def_levels[level] = def_imgs_[0]->pyramid_level(level);
+  }
+  std::vector<int_t> half_extents(local_num_subsets_,0);
+  for(int_t i=0;i<local_num_subsets_;++i)
+    half_extents[i] = subset_half_extent(subset_global_id(i),local_field_value(i,SUBSET_COORDINATES_X_FS),
+      local_field_value(i,SUBSET_COORDINATES_Y_FS));
+  // the coarse subsets are never smaller than this half width
+  const int_t min_half_width = 4;
+  // coarse matches worse than this are not used
+  const scalar_t max_gamma = 1.0;
+  int_t num_updated = 0;
+  const int_t num_subsets = local_num_subsets_;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_subsets>1) reduction(+:num_updated)
+#endif
+  for(int_t i=0;i<num_subsets;++i){
+    const scalar_t cx = local_field_value(i,SUBSET_COORDINATES_X_FS);
+    const scalar_t cy = local_field_value(i,SUBSET_COORDINATES_Y_FS);
+    const scalar_t theta = local_field_value(i,ROTATION_Z_FS);
+    scalar_t u = local_field_value(i,SUBSET_DISPLACEMENT_X_FS);
+    scalar_t v = local_field_value(i,SUBSET_DISPLACEMENT_Y_FS);
+    bool updated = false;
+    for(int_t level=num_levels;level>=1;--level){
+      const scalar_t scale = (scalar_t)(1 << level);
+      const Teuchos::RCP<Image> & ref = ref_levels[level];
+      const int_t ccx = (int_t)std::floor(cx/scale + 0.5);
+      const int_t ccy = (int_t)std::floor(cy/scale + 0.5);
+      const int_t half = std::max(min_half_width,(int_t)(half_extents[i]/scale));
+      // the coarse subset has to lie inside the coarse reference image
+      if(ccx-half<ref->offset_x()||ccx+half>=ref->offset_x()+ref->width()||
+          ccy-half<ref->offset_y()||ccy+half>=ref->offset_y()+ref->height()) continue;
+      Subset coarse(ccx,ccy,2*half+1,2*half+1);
+      coarse.initialize(ref);
+      scalar_t coarse_u = u/scale;
+      scalar_t coarse_v = v/scale;
+      if(translation_solve(coarse,def_levels[level],theta,coarse_u,coarse_v)&&coarse.gamma()<max_gamma){
+        u = coarse_u*scale;
+        v = coarse_v*scale;
+        updated = true;
+      }
+    }
+    if(updated){
+      local_field_value(i,SUBSET_DISPLACEMENT_X_FS) = u;
+      local_field_value(i,SUBSET_DISPLACEMENT_Y_FS) = v;
+      num_updated++;
+    }
+  }
+  DEBUG_MSG("Schema::pyramid_pre_correlation(): updated the initial guess of " << num_updated << " of " << num_subsets << " subsets");
 }
 
 void
@@ -225,14 +544,24 @@ Schema::set_def_image(const int_t img_width,
   TEUCHOS_TEST_FOR_EXCEPTION(img_width<=0,std::runtime_error,"");
   TEUCHOS_TEST_FOR_EXCEPTION(img_height<=0,std::runtime_error,"");
   Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
-  imgParams->set(DICe::compute_image_gradients,compute_ref_gradients_); // automatically compute the gradients if the ref image is changed
+  imgParams->set(DICe::compute_image_gradients,compute_ref_gradients_&&!test_motion_on_raw_pixels()); // automatically compute the gradients if the ref image is changed
+  imgParams->set(DICe::lazy_image_gradients,lazy_image_gradients_);
+  imgParams->set(DICe::analytic_def_gradients,analytic_def_gradients_);
+  imgParams->set(DICe::quantized_interpolation_weights,quantized_interpolation_weights_);
   imgParams->set(DICe::gradient_method,gradient_method_);
   imgParams->set(DICe::gauss_filter_mask_size,gauss_filter_mask_size_);
+  imgParams->set(DICe::num_threads,num_threads_);
   imgParams->set(DICe::gradient_method,gradient_method_);
+  const Teuchos::RCP<Image> old_frame = def_imgs_[id];
   def_imgs_[id] = Teuchos::rcp( new Image(img_width,img_height,defRCP,imgParams));
+  if(test_motion_on_raw_pixels()){
+    raw_def_imgs_[id] = def_imgs_[id];
+    def_preprocessing_pending_ = true;
+  }
   if(def_image_rotation_!=ZERO_DEGREES){
     def_imgs_[id] = def_imgs_[id]->apply_rotation(def_image_rotation_);
   }
+  if(id==0) share_def_frame(old_frame);
 }
 
 void
@@ -249,11 +578,31 @@ Schema::set_ref_image(const std::string & refName){
   DEBUG_MSG("Schema:  Resetting the reference image");
   Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
   imgParams->set(DICe::compute_image_gradients,compute_ref_gradients_); // automatically compute the gradients if the ref image is changed
+  imgParams->set(DICe::lazy_image_gradients,lazy_image_gradients_);
   imgParams->set(DICe::gauss_filter_images,gauss_filter_images_);
   imgParams->set(DICe::gauss_filter_mask_size,gauss_filter_mask_size_);
+  imgParams->set(DICe::num_threads,num_threads_);
   imgParams->set(DICe::gradient_method,gradient_method_);
   imgParams->set(DICe::compute_laplacian_image,compute_laplacian_image_);
-  if(has_extents_){
+  // the filtered pixels and gradients can be restored from an earlier run with the same reference image
+  // (the laplacian is not cached so it is computed as usual)
+#if DICE_KOKKOS
+  const bool use_ref_image_cache = false;
+#else
+  const bool use_ref_image_cache = !reference_image_cache_folder_.empty()&&!compute_laplacian_image_;
+#endif
+  Teuchos::RCP<Teuchos::ParameterList> loadParams = imgParams;
+  if(use_ref_image_cache){
+    // only the raw pixels are read here, they are the key to the cache
+    loadParams = Teuchos::rcp(new Teuchos::ParameterList());
+    loadParams->set(DICe::num_threads,num_threads_);
+  }
+  const bool shared_ref = node_shared_images()&&!use_ref_image_cache;
+  if(shared_ref){
+    utils::read_image_dimensions(refName.c_str(),full_ref_img_width_,full_ref_img_height_);
+    ref_img_ = read_node_shared_image(refName,loadParams);
+  }
+  else if(has_extents_){
     utils::read_image_dimensions(refName.c_str(),full_ref_img_width_,full_ref_img_height_);
     const int_t buffer = 100; // if the extents are within 100 pixels of the image boundary use the whole image
     const int_t offset_x = ref_extents_[0] > buffer && ref_extents_[0] < full_ref_img_width_ - buffer ? ref_extents_[0] : 0;
@@ -262,17 +611,42 @@ Schema::set_ref_image(const std::string & refName){
     const int_t end_y = ref_extents_[3] > buffer && ref_extents_[3] < full_ref_img_height_ - buffer ? ref_extents_[3] : full_ref_img_height_;
     const int_t width = end_x - offset_x;
     const int_t height = end_y - offset_y;
-    ref_img_ = Teuchos::rcp( new Image(refName.c_str(),offset_x,offset_y,width,height,imgParams));
+    // the cached preprocessing is read into the image in place so it can't be shared
+    if(use_ref_image_cache)
+      ref_img_ = Teuchos::rcp( new Image(refName.c_str(),offset_x,offset_y,width,height,loadParams));
+    else
+      ref_img_ = Shared_Frame_Cache::frame(refName,offset_x,offset_y,width,height,loadParams);
   }
+  else if(use_ref_image_cache)
+    ref_img_ = Teuchos::rcp( new Image(refName.c_str(),loadParams));
   else
-    ref_img_ = Teuchos::rcp( new Image(refName.c_str(),imgParams));
+    ref_img_ = Shared_Frame_Cache::frame(refName,0,0,-1,-1,loadParams);
+  if(use_ref_image_cache){
+    std::vector<int_t> settings(4);
+    settings[0] = gauss_filter_images_ ? gauss_filter_mask_size_ : 0;
+    settings[1] = compute_ref_gradients_ ? 1 : 0;
+    settings[2] = gradient_method_;
+    settings[3] = sizeof(scalar_t);
+    const std::string cache_file_name = reference_image_cache_file_name(reference_image_cache_folder_,ref_img_,settings);
+    if(!ref_img_->read_preprocessed(cache_file_name)){
+      ref_img_->post_allocation_tasks(imgParams);
+      ref_img_->write_preprocessed(cache_file_name);
+    }
+    // the lazy gradients setting only applies to images that are preprocessed when they are loaded
+    ref_img_->set_lazy_gradients(lazy_image_gradients_);
+  }
   if(ref_image_rotation_!=ZERO_DEGREES){
     ref_img_ = ref_img_->apply_rotation(ref_image_rotation_,imgParams);
   }
   if(prev_imgs_[0]==Teuchos::null){
-    prev_imgs_[0] = Teuchos::rcp( new Image(refName.c_str(),imgParams));
-    if(ref_image_rotation_!=ZERO_DEGREES){
-      prev_imgs_[0] = prev_imgs_[0]->apply_rotation(ref_image_rotation_,imgParams);
+    // only the portion of the image this processor needs is kept (the same pixels as the reference image)
+    if(has_extents_||shared_ref)
+      prev_imgs_[0] = ref_img_;
+    else{
+      prev_imgs_[0] = Shared_Frame_Cache::frame(refName,0,0,-1,-1,imgParams);
+      if(ref_image_rotation_!=ZERO_DEGREES){
+        prev_imgs_[0] = prev_imgs_[0]->apply_rotation(ref_image_rotation_,imgParams);
+      }
     }
   }// end prev img is null
 }
@@ -286,8 +660,10 @@ Schema::set_ref_image(const int_t img_width,
   TEUCHOS_TEST_FOR_EXCEPTION(img_height<=0,std::runtime_error,"");
   Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
   imgParams->set(DICe::compute_image_gradients,compute_ref_gradients_);
+  imgParams->set(DICe::lazy_image_gradients,lazy_image_gradients_);
   imgParams->set(DICe::gauss_filter_images,gauss_filter_images_);
   imgParams->set(DICe::gauss_filter_mask_size,gauss_filter_mask_size_);
+  imgParams->set(DICe::num_threads,num_threads_);
   imgParams->set(DICe::gradient_method,gradient_method_);
   ref_img_ = Teuchos::rcp( new Image(img_width,img_height,refRCP,imgParams));
   if(ref_image_rotation_!=ZERO_DEGREES){
@@ -306,6 +682,11 @@ void
 Schema::set_ref_image(Teuchos::RCP<Image> img){
   DEBUG_MSG("Schema::set_ref_image() Resetting the reference image");
   ref_img_ = img;
+  ref_img_->set_num_threads(num_threads_);
+  ref_img_->set_lazy_gradients(lazy_image_gradients_);
+  // the reference gradients are read at the pixels so they are always stored
+  // (a deformed image with analytic gradients becomes the reference in the incremental formulation)
+  ref_img_->set_analytic_gradients(false);
   if(gauss_filter_images_){
     if(!ref_img_->has_gauss_filter()) // the filter may have alread been applied to the image
       ref_img_->gauss_filter(gauss_filter_mask_size_);
@@ -351,13 +732,56 @@ Schema::default_constructor_tasks(const Teuchos::RCP<Teuchos::ParameterList> & p
   initial_gamma_threshold_ = -1.0;
   final_gamma_threshold_ = -1.0;
   path_distance_threshold_ = -1.0;
+  low_contrast_threshold_ = -1.0;
+  low_sssig_threshold_ = -1.0;
+  low_contrast_recheck_interval_ = 10;
   stat_container_ = Teuchos::rcp(new Stat_Container());
   use_incremental_formulation_ = false;
   use_nonlinear_projection_ = false;
   sort_txt_output_ = false;
+  overlap_halo_exchange_ = false;
+  use_batched_device_correlation_ = false;
+  share_reference_intensities_ = false;
+  use_tiled_image_layout_ = false;
+  lazy_image_gradients_ = false;
+  analytic_def_gradients_ = false;
+  quantized_interpolation_weights_ = false;
+  node_shared_images_ = false;
+#if DICE_KOKKOS
+  subset_batch_solved_ = false;
+#endif
+  exodus_output_buffer_size_ = 1;
+  exodus_output_step_offset_ = 0;
+  num_threads_ = 1;
+  phase_correlation_window_size_ = 64;
+  feature_matcher_ = BRUTE_FORCE_FEATURE_MATCHER;
+  output_feature_matching_image_ = false;
+  feature_tile_size_ = 0;
+  max_features_per_tile_ = 0;
+  search_initialization_radius_ = 10.0;
+  search_initialization_pyramid_levels_ = 0;
+  pyramid_correlation_levels_ = 0;
+  reliability_guided_propagation_ = false;
+  adaptive_grid_coarsening_ = 0;
+  adaptive_grid_tolerance_ = 0.05;
+  adaptive_grid_gamma_threshold_ = 0.0;
+  adaptive_grid_created_ = false;
+  min_local_subset_gid_ = 0;
+  noise_adaptive_tolerance_factor_ = 0.0;
+  progressive_sampling_stride_ = 1;
+  analytic_beta_ = false;
+  compute_noise_level_ = true;
+  compute_contrast_level_ = true;
+  motion_window_sample_stride_ = 1;
+  test_motion_on_raw_pixels_ = false;
+  def_preprocessing_pending_ = false;
+  batch_values_per_subset_ = 0;
+  batch_first_frame_id_ = 0;
   set_params(params);
   prev_imgs_.push_back(Teuchos::null);
   def_imgs_.push_back(Teuchos::null);
+  raw_prev_imgs_.push_back(Teuchos::null);
+  raw_def_imgs_.push_back(Teuchos::null);
   has_extents_ = false;
   ref_extents_.resize(4,-1);
   def_extents_.resize(4,-1);
@@ -492,6 +916,34 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
   use_incremental_formulation_ = diceParams->get<bool>(DICe::use_incremental_formulation,false);
   use_nonlinear_projection_ = diceParams->get<bool>(DICe::use_nonlinear_projection,false);
   sort_txt_output_ = diceParams->get<bool>(DICe::sort_txt_output,false);
+  overlap_halo_exchange_ = diceParams->get<bool>(DICe::overlap_halo_exchange,false);
+  use_batched_device_correlation_ = diceParams->get<bool>(DICe::use_batched_device_correlation,false);
+#if !DICE_KOKKOS
+  if(use_batched_device_correlation_)
+    std::cout << "*** Warning: use_batched_device_correlation requires DICe to be built with Kokkos, the parameter will be ignored" << std::endl;
+#endif
+  share_reference_intensities_ = diceParams->get<bool>(DICe::share_reference_intensities,false);
+  use_tiled_image_layout_ = diceParams->get<bool>(DICe::use_tiled_image_layout,false);
+  lazy_image_gradients_ = diceParams->get<bool>(DICe::lazy_image_gradients,false);
+  reference_image_cache_folder_ = diceParams->get<std::string>(DICe::reference_image_cache_folder,"");
+#if DICE_KOKKOS
+  if(lazy_image_gradients_){
+    std::cout << "*** Warning: lazy_image_gradients is not available in builds with Kokkos, the parameter will be ignored" << std::endl;
+    lazy_image_gradients_ = false;
+  }
+  if(share_reference_intensities_){
+    std::cout << "*** Warning: share_reference_intensities is not available in builds with Kokkos, the parameter will be ignored" << std::endl;
+    share_reference_intensities_ = false;
+  }
+  Kokkos_Policy_Tuner::instance().set_enabled(diceParams->get<bool>(DICe::auto_tune_kokkos_policies,false));
+  if(Kokkos_Policy_Tuner::instance().enabled())
+    Kokkos_Policy_Tuner::instance().set_cache_file(diceParams->get<std::string>(DICe::kokkos_policy_cache_file,""));
+#else
+  if(diceParams->get<bool>(DICe::auto_tune_kokkos_policies,false))
+    std::cout << "*** Warning: auto_tune_kokkos_policies requires DICe to be built with Kokkos, the parameter will be ignored" << std::endl;
+#endif
+  exodus_output_buffer_size_ = diceParams->get<int_t>(DICe::exodus_output_buffer_size,1);
+  TEUCHOS_TEST_FOR_EXCEPTION(exodus_output_buffer_size_<1,std::runtime_error,"Error, exodus_output_buffer_size must be at least 1");
   gauss_filter_images_ = diceParams->get<bool>(DICe::gauss_filter_images,false);
   gauss_filter_mask_size_ = diceParams->get<int_t>(DICe::gauss_filter_mask_size,7);
   compute_ref_gradients_ = diceParams->get<bool>(DICe::compute_ref_gradients,true);
@@ -505,6 +957,22 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
     compute_ref_gradients_ = true;
     compute_def_gradients_ = true;
   }
+  // only matters if the deformed image gradients are used
+  analytic_def_gradients_ = compute_def_gradients_&&diceParams->get<bool>(DICe::analytic_def_gradients,false);
+#if DICE_KOKKOS
+  if(analytic_def_gradients_){
+    std::cout << "*** Warning: analytic_def_gradients is not available in builds with Kokkos, the parameter will be ignored" << std::endl;
+    analytic_def_gradients_ = false;
+  }
+#endif
+  quantized_interpolation_weights_ = diceParams->get<bool>(DICe::quantized_interpolation_weights,false);
+  node_shared_images_ = diceParams->get<bool>(DICe::node_shared_images,false);
+#if DICE_KOKKOS
+  if(node_shared_images_){
+    std::cout << "*** Warning: node_shared_images is not available in builds with Kokkos, the parameter will be ignored" << std::endl;
+    node_shared_images_ = false;
+  }
+#endif
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::projection_method),std::runtime_error,"");
   projection_method_ = diceParams->get<Projection_Method>(DICe::projection_method);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::interpolation_method),std::runtime_error,"");
@@ -517,6 +985,12 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
   max_solver_iterations_fast_ = diceParams->get<int_t>(DICe::max_solver_iterations_fast);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::fast_solver_tolerance),std::runtime_error,"");
   fast_solver_tolerance_ = diceParams->get<double>(DICe::fast_solver_tolerance);
+  noise_adaptive_tolerance_factor_ = diceParams->get<double>(DICe::noise_adaptive_tolerance_factor,0.0);
+  TEUCHOS_TEST_FOR_EXCEPTION(noise_adaptive_tolerance_factor_<0.0,std::invalid_argument,
+    "Error, noise_adaptive_tolerance_factor must not be negative");
+  progressive_sampling_stride_ = diceParams->get<int_t>(DICe::progressive_sampling_stride,1);
+  TEUCHOS_TEST_FOR_EXCEPTION(progressive_sampling_stride_<1,std::invalid_argument,
+    "Error, progressive_sampling_stride must be at least 1");
   // make sure image gradients are on at least for the reference image for any gradient based optimization routine
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::optimization_method),std::runtime_error,"");
   optimization_method_ = diceParams->get<Optimization_Method>(DICe::optimization_method);
@@ -524,6 +998,15 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
   correlation_routine_ = diceParams->get<Correlation_Routine>(DICe::correlation_routine);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::initialization_method),std::runtime_error,"");
   initialization_method_ = diceParams->get<Initialization_Method>(DICe::initialization_method);
+  phase_correlation_window_size_ = diceParams->get<int_t>(DICe::phase_correlation_window_size,64);
+  TEUCHOS_TEST_FOR_EXCEPTION(phase_correlation_window_size_<8,std::invalid_argument,
+    "Error, phase_correlation_window_size must be at least 8 pixels");
+  feature_matcher_ = diceParams->get<Feature_Matcher>(DICe::feature_matcher,BRUTE_FORCE_FEATURE_MATCHER);
+  output_feature_matching_image_ = diceParams->get<bool>(DICe::output_feature_matching_image,false);
+  feature_tile_size_ = diceParams->get<int_t>(DICe::feature_tile_size,0);
+  max_features_per_tile_ = diceParams->get<int_t>(DICe::max_features_per_tile,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(feature_tile_size_<0||max_features_per_tile_<0,std::invalid_argument,
+    "Error, feature_tile_size and max_features_per_tile must not be negative");
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::max_solver_iterations_robust),std::runtime_error,"");
   max_solver_iterations_robust_ = diceParams->get<int_t>(DICe::max_solver_iterations_robust);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::robust_solver_tolerance),std::runtime_error,"");
@@ -538,6 +1021,10 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
   final_gamma_threshold_ = diceParams->get<double>(DICe::final_gamma_threshold);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::path_distance_threshold),std::runtime_error,"");
   path_distance_threshold_ = diceParams->get<double>(DICe::path_distance_threshold);
+  low_contrast_threshold_ = diceParams->get<double>(DICe::low_contrast_threshold,-1.0);
+  low_sssig_threshold_ = diceParams->get<double>(DICe::low_sssig_threshold,-1.0);
+  low_contrast_recheck_interval_ = diceParams->get<int_t>(DICe::low_contrast_recheck_interval,10);
+  TEUCHOS_TEST_FOR_EXCEPTION(low_contrast_recheck_interval_<1,std::invalid_argument,"Error, low_contrast_recheck_interval must be at least 1");
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::disp_jump_tol),std::runtime_error,"");
   disp_jump_tol_ = diceParams->get<double>(DICe::disp_jump_tol);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::theta_jump_tol),std::runtime_error,"");
@@ -556,6 +1043,9 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
   enable_shear_strain_ = diceParams->get<bool>(DICe::enable_shear_strain);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::enable_quadratic_shape_function),std::runtime_error,"");
   enable_quadratic_shape_function_ = diceParams->get<bool>(DICe::enable_quadratic_shape_function);
+  TEUCHOS_TEST_FOR_EXCEPTION(enable_quadratic_shape_function_&&(optimization_method_==DICe::INVERSE_COMPOSITIONAL||
+      optimization_method_==DICe::INVERSE_COMPOSITIONAL_THEN_SIMPLEX),std::invalid_argument,
+    "Error, the inverse compositional optimization method is not available for the quadratic shape function");
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::output_deformed_subset_images),std::runtime_error,"");
   output_deformed_subset_images_ = diceParams->get<bool>(DICe::output_deformed_subset_images);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::output_deformed_subset_intensity_images),std::runtime_error,"");
@@ -574,8 +1064,33 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
   levenberg_marquardt_regularization_factor_ = diceParams->get<double>(DICe::levenberg_marquardt_regularization_factor);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::output_beta),std::runtime_error,"");
   output_beta_ = diceParams->get<bool>(DICe::output_beta);
+  analytic_beta_ = diceParams->get<bool>(DICe::analytic_beta,false);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::use_search_initialization_for_failed_steps),std::runtime_error,"");
   use_search_initialization_for_failed_steps_ = diceParams->get<bool>(DICe::use_search_initialization_for_failed_steps);
+  search_initialization_radius_ = diceParams->get<double>(DICe::search_initialization_radius,10.0);
+  TEUCHOS_TEST_FOR_EXCEPTION(search_initialization_radius_<0.0,std::invalid_argument,
+    "Error, search_initialization_radius must not be negative");
+  search_initialization_pyramid_levels_ = diceParams->get<int_t>(DICe::search_initialization_pyramid_levels,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(search_initialization_pyramid_levels_<0,std::invalid_argument,
+    "Error, search_initialization_pyramid_levels must not be negative");
+  pyramid_correlation_levels_ = diceParams->get<int_t>(DICe::pyramid_correlation_levels,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(pyramid_correlation_levels_<0,std::invalid_argument,
+    "Error, pyramid_correlation_levels must not be negative");
+  reliability_guided_propagation_ = diceParams->get<bool>(DICe::reliability_guided_propagation,false);
+  adaptive_grid_coarsening_ = diceParams->get<int_t>(DICe::adaptive_grid_coarsening,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(adaptive_grid_coarsening_<0,std::invalid_argument,
+    "Error, adaptive_grid_coarsening must not be negative");
+  adaptive_grid_tolerance_ = diceParams->get<double>(DICe::adaptive_grid_tolerance,0.05);
+  TEUCHOS_TEST_FOR_EXCEPTION(adaptive_grid_tolerance_<0.0,std::invalid_argument,
+    "Error, adaptive_grid_tolerance must not be negative");
+  adaptive_grid_gamma_threshold_ = diceParams->get<double>(DICe::adaptive_grid_gamma_threshold,0.0);
+  TEUCHOS_TEST_FOR_EXCEPTION(adaptive_grid_gamma_threshold_<0.0,std::invalid_argument,
+    "Error, adaptive_grid_gamma_threshold must not be negative");
+  adaptive_grid_created_ = false;
+  motion_window_sample_stride_ = diceParams->get<int_t>(DICe::motion_window_sample_stride,1);
+  TEUCHOS_TEST_FOR_EXCEPTION(motion_window_sample_stride_<1,std::invalid_argument,
+    "Error, motion_window_sample_stride must be at least 1");
+  test_motion_on_raw_pixels_ = diceParams->get<bool>(DICe::test_motion_on_raw_pixels,false);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::normalize_gamma_with_active_pixels),std::runtime_error,"");
   normalize_gamma_with_active_pixels_ = diceParams->get<bool>(DICe::normalize_gamma_with_active_pixels);
   TEUCHOS_TEST_FOR_EXCEPTION(!diceParams->isParameter(DICe::rotate_ref_image_90),std::runtime_error,"");
@@ -595,6 +1110,32 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
   if(diceParams->get<bool>(DICe::rotate_def_image_270)) def_image_rotation_ = TWO_HUNDRED_SEVENTY_DEGREES;
   if(normalize_gamma_with_active_pixels_)
     DEBUG_MSG("Gamma values will be normalized by the number of active pixels.");
+  num_threads_ = diceParams->get<int_t>(DICe::num_threads,1);
+#ifdef _OPENMP
+  if(num_threads_<1)
+    num_threads_ = omp_get_max_threads();
+#ifndef HAVE_TEUCHOS_THREAD_SAFE
+  // the reference counts of the RCPs shared across subsets are not atomic in this case
+  if(num_threads_>1){
+    if(proc_rank == 0) std::cout << "Warning: Trilinos was not built with Teuchos_ENABLE_THREAD_SAFE, resetting num_threads to 1" << std::endl;
+    num_threads_ = 1;
+  }
+#endif
+#else
+  if(num_threads_!=1){
+    if(proc_rank == 0) std::cout << "Warning: DICe was not compiled with OpenMP, resetting num_threads to 1" << std::endl;
+    num_threads_ = 1;
+  }
+#endif
+  DEBUG_MSG("Number of threads used to correlate subsets: " << num_threads_);
+  // frames averaged from video files are decoded with the same number of threads
+  utils::Image_Reader_Cache::instance().set_num_threads(num_threads_);
+  // the pages of the new image arrays are placed by the threads that process their rows
+  Image_Buffer_Pool::set_first_touch_threads(diceParams->get<bool>(DICe::numa_first_touch_images,false) ? num_threads_ : 1);
+  Image_Buffer_Pool::set_use_huge_pages(diceParams->get<bool>(DICe::use_huge_pages_for_images,false));
+  const int_t shared_frames = diceParams->get<int_t>(DICe::shared_frame_cache_size,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(shared_frames<0,std::runtime_error,"Error, shared_frame_cache_size must be >= 0");
+  Shared_Frame_Cache::set_capacity(shared_frames);
   if(analysis_type_==GLOBAL_DIC){
     compute_ref_gradients_ = true;
   }
@@ -672,11 +1213,22 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
       outputParams->setEntry(it->first,it->second);
     }
   }
-  // create the output spec:
+  // create the output spec (output still queued in the background writer uses the old one):
+  flush_output();
   const std::string delimiter = diceParams->get<std::string>(DICe::output_delimiter," ");
   const bool omit_row_id = diceParams->get<bool>(DICe::omit_output_row_id,false);
   output_spec_ = Teuchos::rcp(new DICe::Output_Spec(this,omit_row_id,outputParams,delimiter));
   has_output_spec_ = true;
+  // the quantities that are only reported are skipped if they are not written (beta is still computed if
+  // output_beta was set explicitly rather than by the default params)
+  compute_noise_level_ = output_spec_->has_field(SIGMA_FS.get_name_label())||output_spec_->has_field(NOISE_LEVEL_FS.get_name_label())
+      ||output_spec_->has_field(UNCERTAINTY_FS.get_name_label())||output_spec_->has_field(UNCERTAINTY_ANGLE_FS.get_name_label());
+  compute_contrast_level_ = output_spec_->has_field(CONTRAST_LEVEL_FS.get_name_label());
+  if(output_beta_&&!output_spec_->has_field(BETA_FS.get_name_label())&&(params==Teuchos::null||!params->isParameter(DICe::output_beta))){
+    if(proc_rank == 0) DEBUG_MSG("Beta is not in the output spec, skipping the beta computation");
+    output_beta_ = false;
+  }
+  if(proc_rank == 0) DEBUG_MSG("Computing the noise level: " << compute_noise_level_ << " contrast level: " << compute_contrast_level_);
 
   if(diceParams->isParameter(DICe::exact_solution_constant_value_x)||diceParams->isParameter(DICe::exact_solution_constant_value_y)){
     TEUCHOS_TEST_FOR_EXCEPTION(diceParams->get<bool>(DICe::estimate_resolution_error,false),std::runtime_error,"");
@@ -695,12 +1247,19 @@ Schema::set_params(const Teuchos::RCP<Teuchos::ParameterList> & params){
 
 void
 Schema::update_extents(const bool use_transformation_augmentation){
-  // don't use image extents when conformal subsets are used
-  if(conformal_subset_defs_!=Teuchos::null){
-    if(conformal_subset_defs_->size()>0){
-      has_extents_ = false;
-      return;
-    }
+  // for global the extents cover the elements on this processor
+  if(analysis_type_==GLOBAL_DIC){
+#ifdef DICE_ENABLE_GLOBAL
+    TEUCHOS_TEST_FOR_EXCEPTION(global_algorithm_==Teuchos::null,std::runtime_error,"");
+    global_algorithm_->image_extents(ref_extents_,def_extents_);
+    has_extents_ = true;
+#endif
+    return;
+  }
+  // don't use image extents when conformal subsets are tracked with motion windows (the windows define the sub images)
+  if(conformal_subset_defs_!=Teuchos::null&&conformal_subset_defs_->size()>0&&motion_window_params_->size()>0){
+    has_extents_ = false;
+    return;
   }
   TEUCHOS_TEST_FOR_EXCEPTION(motion_window_params_->size()>0,std::runtime_error,"");
   TEUCHOS_TEST_FOR_EXCEPTION(mesh_==Teuchos::null,std::runtime_error,"");
@@ -751,17 +1310,25 @@ Schema::update_extents(const bool use_transformation_augmentation){
   scalar_t min_y_def = std::numeric_limits<int_t>::max();
   scalar_t max_y_def = 0.0;
 
+  // the extents include the pixels of each subset, not just the centroids
   for(int_t i=0;i<local_num_subsets_;++i){
-    if(coords->local_value(i*2+0) < min_x_ref) min_x_ref = coords->local_value(i*2+0);
-    if(coords->local_value(i*2+0) > max_x_ref) max_x_ref = coords->local_value(i*2+0);
-    if(coords->local_value(i*2+1) < min_y_ref) min_y_ref = coords->local_value(i*2+1);
-    if(coords->local_value(i*2+1) > max_y_ref) max_y_ref = coords->local_value(i*2+1);
-    if(current_coords->local_value(i*2+0) < min_x_def) min_x_def = current_coords->local_value(i*2+0);
-    if(current_coords->local_value(i*2+0) > max_x_def) max_x_def = current_coords->local_value(i*2+0);
-    if(current_coords->local_value(i*2+1) < min_y_def) min_y_def = current_coords->local_value(i*2+1);
-    if(current_coords->local_value(i*2+1) > max_y_def) max_y_def = current_coords->local_value(i*2+1);
-  }
-  const int_t buffer = use_transformation_augmentation&&use_nonlinear_projection_ ? 500 : 100;
+    const scalar_t half_extent = analysis_type_==LOCAL_DIC ?
+        subset_half_extent(subset_global_id(i),coords->local_value(i*2+0),coords->local_value(i*2+1)) : 0;
+    if(coords->local_value(i*2+0) - half_extent < min_x_ref) min_x_ref = coords->local_value(i*2+0) - half_extent;
+    if(coords->local_value(i*2+0) + half_extent > max_x_ref) max_x_ref = coords->local_value(i*2+0) + half_extent;
+    if(coords->local_value(i*2+1) - half_extent < min_y_ref) min_y_ref = coords->local_value(i*2+1) - half_extent;
+    if(coords->local_value(i*2+1) + half_extent > max_y_ref) max_y_ref = coords->local_value(i*2+1) + half_extent;
+    if(current_coords->local_value(i*2+0) - half_extent < min_x_def) min_x_def = current_coords->local_value(i*2+0) - half_extent;
+    if(current_coords->local_value(i*2+0) + half_extent > max_x_def) max_x_def = current_coords->local_value(i*2+0) + half_extent;
+    if(current_coords->local_value(i*2+1) - half_extent < min_y_def) min_y_def = current_coords->local_value(i*2+1) - half_extent;
+    if(current_coords->local_value(i*2+1) + half_extent > max_y_def) max_y_def = current_coords->local_value(i*2+1) + half_extent;
+  }
+  // the halo covers the motion between frames and the region searched by the initializers
+  int_t buffer = use_transformation_augmentation&&use_nonlinear_projection_ ? 500 : 100;
+  if(use_search_initialization_for_failed_steps_)
+    buffer += std::ceil(search_initialization_radius_);
+  if(initialization_method_==USE_WINDOWED_PHASE_CORRELATION)
+    buffer = std::max(buffer,phase_correlation_window_size_);
   min_x_ref -= buffer; min_y_ref -= buffer;
   max_x_ref += buffer; max_y_ref += buffer;
   min_x_ref = min_x_ref < buffer ? 0 : std::round(min_x_ref);
@@ -787,6 +1354,32 @@ Schema::update_extents(const bool use_transformation_augmentation){
   DEBUG_MSG("[PROC " << mesh_->get_comm()->get_rank() << "] y " << def_extents_[2] << " to " << def_extents_[3]);
 }
 
+int_t
+Schema::subset_half_extent(const int_t subset_gid,
+  const scalar_t & cx,
+  const scalar_t & cy){
+  if(conformal_subset_defs_==Teuchos::null||conformal_subset_defs_->find(subset_gid)==conformal_subset_defs_->end())
+    return subset_dim_ > 0 ? subset_dim_/2 + 1 : 0;
+  std::map<int_t,int_t>::const_iterator it = conformal_subset_half_extents_.find(subset_gid);
+  if(it!=conformal_subset_half_extents_.end())
+    return it->second;
+  const Conformal_Area_Def & def = conformal_subset_defs_->find(subset_gid)->second;
+  int_t half_extent = 0;
+  if(def.has_boundary()){
+    for(size_t i=0;i<def.boundary()->size();++i){
+      const std::vector<std::pair<int_t,int_t> > & pixels = (*def.boundary())[i]->reference_pixels();
+      // the pairs are (y,x)
+      for(std::vector<std::pair<int_t,int_t> >::const_iterator pixel_it=pixels.begin();pixel_it!=pixels.end();++pixel_it){
+        half_extent = std::max(half_extent,(int_t)std::ceil(std::abs(pixel_it->second - cx)));
+        half_extent = std::max(half_extent,(int_t)std::ceil(std::abs(pixel_it->first - cy)));
+      }
+    }
+  }
+  half_extent += 1;
+  conformal_subset_half_extents_.insert(std::pair<int_t,int_t>(subset_gid,half_extent));
+  return half_extent;
+}
+
 void
 Schema::initialize(const Teuchos::RCP<Teuchos::ParameterList> & input_params,
   const Teuchos::RCP<Teuchos::ParameterList> & correlation_params){
@@ -894,9 +1487,13 @@ Schema::initialize(const Teuchos::RCP<Teuchos::ParameterList> & input_params,
       // change the def image storage to be a vector of motion windows rather than one large image
       def_imgs_.resize(subset_info->num_motion_windows);
       prev_imgs_.resize(subset_info->num_motion_windows);
+      raw_def_imgs_.resize(subset_info->num_motion_windows);
+      raw_prev_imgs_.resize(subset_info->num_motion_windows);
       for(int_t i=0;i<subset_info->num_motion_windows;++i){
         def_imgs_[i] = Teuchos::null;
         prev_imgs_[i] = Teuchos::null;
+        raw_def_imgs_[i] = Teuchos::null;
+        raw_prev_imgs_[i] = Teuchos::null;
       }
     }
     if(subset_info->seed_subset_ids->size()>0){
@@ -1011,6 +1608,10 @@ Schema::initialize(const Teuchos::RCP<Teuchos::ParameterList> & input_params,
   std::set<int_t> neumann_boundary_nodes;
   std::set<int_t> lagrange_boundary_nodes;
 
+  // the cached field values and subset ids belong to the previous mesh
+  field_values_.clear();
+  subset_global_ids_.clear();
+  subset_local_ids_.clear();
   mesh_ = DICe::mesh::create_point_or_tri_mesh(DICe::mesh::MESHLESS,
     overlap_coords_x,
     overlap_coords_y,
@@ -1024,14 +1625,18 @@ Schema::initialize(const Teuchos::RCP<Teuchos::ParameterList> & input_params,
 
   conformal_subset_defs_ = Teuchos::rcp(new std::map<int_t,DICe::Conformal_Area_Def>);
 
-  // initialize the post processors
-  for(size_t i=0;i<post_processors_.size();++i)
-    post_processors_[i]->initialize(mesh_);
+  // initialize the post processors (all post processors share one set of neighborhoods)
+  neighborhood_cache_ = Teuchos::rcp(new Neighborhood_Cache(mesh_));
+  for(size_t i=0;i<post_processors_.size();++i){
+    post_processors_[i]->initialize(mesh_,neighborhood_cache_);
+    post_processors_[i]->set_num_threads(num_threads_);
+  }
 
   is_initialized_ = true;
 
   TEUCHOS_TEST_FOR_EXCEPTION(mesh_==Teuchos::null,std::runtime_error,"Error: mesh should not be null here");
   local_num_subsets_ = mesh_->get_scalar_node_dist_map()->get_num_local_elements();
+  adaptive_grid_created_ = false;
   create_mesh_fields();
 
   mesh_->get_field(NEIGHBOR_ID_FS)->update(1.0,*schema->mesh()->get_field(NEIGHBOR_ID_FS),0.0);
@@ -1080,9 +1685,12 @@ Schema::initialize(Teuchos::RCP<Decomp> decomp,
     TEUCHOS_TEST_FOR_EXCEPTION(subset_size<=0,std::runtime_error,"");
   }
 
-  // initialize the post processors
-  for(size_t i=0;i<post_processors_.size();++i)
-    post_processors_[i]->initialize(mesh_);
+  // initialize the post processors (all post processors share one set of neighborhoods)
+  neighborhood_cache_ = Teuchos::rcp(new Neighborhood_Cache(mesh_));
+  for(size_t i=0;i<post_processors_.size();++i){
+    post_processors_[i]->initialize(mesh_,neighborhood_cache_);
+    post_processors_[i]->set_num_threads(num_threads_);
+  }
 
   is_initialized_ = true;
 
@@ -1097,7 +1705,8 @@ Schema::initialize(Teuchos::RCP<Decomp> decomp,
 }
 
 void
-Schema::create_mesh(Teuchos::RCP<Decomp> decomp){
+Schema::create_mesh(Teuchos::RCP<Decomp> decomp,
+  const std::string & exo_name_suffix){
 
   const int_t num_overlap_coords = decomp->id_decomp_overlap_map()->get_num_local_elements();
   const int_t num_coords = decomp->id_decomp_map()->get_num_local_elements();
@@ -1126,14 +1735,18 @@ Schema::create_mesh(Teuchos::RCP<Decomp> decomp){
   // filename for output
   std::stringstream exo_name;
   if(init_params_!=Teuchos::null)
-    exo_name << init_params_->get<std::string>(output_prefix,"DICe_solution") << ".e";
+    exo_name << init_params_->get<std::string>(output_prefix,"DICe_solution") << exo_name_suffix << ".e";
   else
-    exo_name << "DICe_solution.e";
+    exo_name << "DICe_solution" << exo_name_suffix << ".e";
 
   // dummy arrays
   std::vector<std::pair<int_t,int_t>> dirichlet_boundary_nodes;
   std::set<int_t> neumann_boundary_nodes;
   std::set<int_t> lagrange_boundary_nodes;
+  // the cached field values and subset ids belong to the previous mesh
+  field_values_.clear();
+  subset_global_ids_.clear();
+  subset_local_ids_.clear();
   mesh_ = DICe::mesh::create_point_or_tri_mesh(DICe::mesh::MESHLESS,
     decomp->overlap_coords_x(),
     decomp->overlap_coords_y(),
@@ -1147,6 +1760,9 @@ Schema::create_mesh(Teuchos::RCP<Decomp> decomp){
 
   TEUCHOS_TEST_FOR_EXCEPTION(mesh_==Teuchos::null,std::runtime_error,"Error: mesh should not be null here");
   local_num_subsets_ = mesh_->get_scalar_node_dist_map()->get_num_local_elements();
+  adaptive_grid_created_ = false;
+  // the exchange pattern depends on the maps of the mesh
+  halo_exchange_ = Teuchos::null;
   create_mesh_fields();
 }
 
@@ -1213,6 +1829,8 @@ Schema::create_mesh_fields(){
     mesh_->get_field(field_enums::ACCUMULATED_DISP_FS)->put_scalar(0.0);
   }
 
+  cache_field_values();
+
   // fill the subset coordinates field:
   Teuchos::RCP<MultiField> coords = mesh_->get_field(field_enums::INITIAL_COORDINATES_FS);
   for(int_t i=0;i<local_num_subsets_;++i){
@@ -1221,6 +1839,33 @@ Schema::create_mesh_fields(){
   }
 }
 
+void
+Schema::cache_field_values(){
+  field_values_.clear();
+  subset_global_ids_.clear();
+  subset_local_ids_.clear();
+  min_local_subset_gid_ = 0;
+  if(mesh_==Teuchos::null) return;
+  DICe::mesh::field_registry::iterator field_it = mesh_->get_field_registry()->begin();
+  const DICe::mesh::field_registry::iterator field_end = mesh_->get_field_registry()->end();
+  for(;field_it!=field_end;++field_it){
+    const size_t index = field_cache_index(field_it->first);
+    if(index>=field_values_.size())
+      field_values_.resize(index+1,NULL);
+    field_values_[index] = field_it->second->local_values();
+  }
+  Teuchos::RCP<MultiField_Map> dist_map = mesh_->get_scalar_node_dist_map();
+  if(dist_map==Teuchos::null) return;
+  Teuchos::ArrayView<const int_t> gids = dist_map->get_global_element_list();
+  if(gids.size()==0) return;
+  subset_global_ids_.assign(gids.begin(),gids.end());
+  min_local_subset_gid_ = *std::min_element(subset_global_ids_.begin(),subset_global_ids_.end());
+  const int_t max_local_gid = *std::max_element(subset_global_ids_.begin(),subset_global_ids_.end());
+  subset_local_ids_.assign(max_local_gid-min_local_subset_gid_+1,-1);
+  for(size_t i=0;i<subset_global_ids_.size();++i)
+    subset_local_ids_[subset_global_ids_[i]-min_local_subset_gid_] = i;
+}
+
 void
 Schema::post_execution_tasks(){
   if(analysis_type_==GLOBAL_DIC){
@@ -1228,6 +1873,244 @@ Schema::post_execution_tasks(){
     global_algorithm_->post_execution_tasks(frame_id_);
 #endif
   }
+  // the work arrays of this frame have all been released, the arenas can be compacted for the next one
+  Frame_Arena::end_frame();
+}
+
+bool
+Schema::rebalance(const scalar_t & imbalance_threshold){
+  const int_t num_procs = comm_->get_size();
+  if(analysis_type_!=LOCAL_DIC||num_procs==1||!is_initialized_) return false;
+  // the subsets can only be moved if they are independent of each other and don't keep state outside the fields
+  if(correlation_routine_!=GENERIC_ROUTINE) return false;
+  if(initialization_method_==USE_NEIGHBOR_VALUES||initialization_method_==USE_NEIGHBOR_VALUES_FIRST_STEP_ONLY) return false;
+  if(obstructing_subset_ids_!=Teuchos::null&&obstructing_subset_ids_->size()>0) return false;
+  // the live plot post processor has already written the headers of its output files
+  for(size_t i=0;i<post_processors_.size();++i)
+    if(post_processors_[i]->name()==post_process_live_plots) return false;
+
+  // gather the coordinates, cost, and owner of all subsets on all processors so they all make the same decision
+  const int_t proc_id = comm_->get_rank();
+  Teuchos::RCP<MultiField_Map> dist_map = mesh_->get_scalar_node_dist_map();
+  Teuchos::RCP<MultiField> coords = mesh_->get_field(INITIAL_COORDINATES_FS);
+  Teuchos::RCP<MultiField> dist_data = Teuchos::rcp(new MultiField(dist_map,4,true)); // the cols are x, y, cost, owner
+  for(int_t i=0;i<local_num_subsets_;++i){
+    const scalar_t active_pixels = local_field_value(i,ACTIVE_PIXELS_FS);
+    const scalar_t iterations = local_field_value(i,ITERATIONS_FS);
+    dist_data->local_value(i,0) = coords->local_value(i*2+0);
+    dist_data->local_value(i,1) = coords->local_value(i*2+1);
+    dist_data->local_value(i,2) = std::max(active_pixels,(scalar_t)1.0)*(std::max(iterations,(scalar_t)0.0)+1.0);
+    dist_data->local_value(i,3) = proc_id;
+  }
+  Teuchos::Array<int_t> all_owned_ids(global_num_subsets_);
+  for(int_t i=0;i<global_num_subsets_;++i)
+    all_owned_ids[i] = i;
+  Teuchos::RCP<MultiField_Map> all_map = Teuchos::rcp(new MultiField_Map(-1,all_owned_ids,0,*comm_));
+  Teuchos::RCP<MultiField> all_data = Teuchos::rcp(new MultiField(all_map,4,true));
+  MultiField_Exporter exporter(*all_map,*dist_map);
+  all_data->do_import(dist_data,exporter,INSERT);
+
+  std::vector<scalar_t> proc_cost(num_procs,0.0);
+  scalar_t total_cost = 0.0;
+  for(int_t i=0;i<global_num_subsets_;++i){
+    proc_cost[(int_t)all_data->local_value(i,3)] += all_data->local_value(i,2);
+    total_cost += all_data->local_value(i,2);
+  }
+  const scalar_t max_cost = *std::max_element(proc_cost.begin(),proc_cost.end());
+  const scalar_t avg_cost = total_cost/num_procs;
+  DEBUG_MSG("[PROC " << proc_id << "] Schema::rebalance(): max processor cost " << max_cost << " average " << avg_cost);
+  if(avg_cost<=0.0||max_cost/avg_cost<=imbalance_threshold) return false;
+
+  // decompose the subsets spatially using the measured cost as the weight
+  Teuchos::ArrayRCP<scalar_t> coords_x(global_num_subsets_,0.0);
+  Teuchos::ArrayRCP<scalar_t> coords_y(global_num_subsets_,0.0);
+  Teuchos::ArrayRCP<scalar_t> weights(global_num_subsets_,0.0);
+  for(int_t i=0;i<global_num_subsets_;++i){
+    coords_x[i] = all_data->local_value(i,0);
+    coords_y[i] = all_data->local_value(i,1);
+    weights[i] = all_data->local_value(i,2);
+  }
+  Teuchos::RCP<Teuchos::ParameterList> decomp_params = Teuchos::rcp(new Teuchos::ParameterList());
+  decomp_params->set(DICe::use_spatial_decomposition,true);
+  // the overlap points have to cover the largest strain window of the post processors
+  int_t max_strain_window_size = 0;
+  for(size_t i=0;i<post_processors_.size();++i)
+    max_strain_window_size = std::max(max_strain_window_size,post_processors_[i]->strain_window_size());
+  if(max_strain_window_size>0)
+    decomp_params->sublist(DICe::post_process_vsg_strain).set(DICe::strain_window_size_in_pixels,max_strain_window_size);
+  Teuchos::RCP<Decomp> decomp = Teuchos::rcp(new Decomp(coords_x,coords_y,Teuchos::null,Teuchos::null,decomp_params,weights));
+
+  // the output already written or queued uses the old subset ids, so the files that store
+  // the subset ids (exodus and binary) are started over with a new name
+  flush_output();
+  binary_results_writer_ = Teuchos::null;
+  subset_text_writer_ = Teuchos::null;
+  adaptive_grid_created_ = false;
+#ifdef DICE_ENABLE_GLOBAL
+  if(mesh_->get_output_exoid()>=0)
+    DICe::mesh::close_exodus_output(mesh_);
+#endif
+  std::stringstream suffix;
+  suffix << "_rebalanced_" << frame_id_ - first_frame_id_;
+  rebalance_suffix_ = suffix.str();
+
+  Teuchos::RCP<DICe::mesh::Mesh> old_mesh = mesh_;
+  this_proc_gid_order_ = decomp->this_proc_gid_order();
+  create_mesh(decomp,rebalance_suffix_);
+  neighborhood_cache_ = Teuchos::rcp(new Neighborhood_Cache(mesh_));
+  for(size_t i=0;i<post_processors_.size();++i)
+    post_processors_[i]->initialize(mesh_,neighborhood_cache_);
+
+  // migrate all of the field values to the new owners (there are only a few distinct maps so the exporters are reused)
+  std::map<std::pair<const MultiField_Map*,const MultiField_Map*>,Teuchos::RCP<MultiField_Exporter> > exporters;
+  DICe::mesh::field_registry::iterator field_it = old_mesh->get_field_registry()->begin();
+  const DICe::mesh::field_registry::iterator field_end = old_mesh->get_field_registry()->end();
+  for(;field_it!=field_end;++field_it){
+    mesh_->create_field(field_it->first);
+    Teuchos::RCP<MultiField> field = mesh_->get_field(field_it->first);
+    const std::pair<const MultiField_Map*,const MultiField_Map*> maps(field->get_map().getRawPtr(),field_it->second->get_map().getRawPtr());
+    if(exporters.find(maps)==exporters.end())
+      exporters.insert(std::make_pair(maps,Teuchos::rcp(new MultiField_Exporter(*field->get_map(),*field_it->second->get_map()))));
+    field->do_import(field_it->second,*exporters.find(maps)->second,INSERT);
+  }
+  cache_field_values();
+  // the previous image is reset when the reference image is reloaded
+  for(size_t i=0;i<prev_imgs_.size();++i)
+    prev_imgs_[i] = Teuchos::null;
+  DEBUG_MSG("[PROC " << proc_id << "] Schema::rebalance(): now owns " << local_num_subsets_ << " subsets");
+  return true;
+}
+
+namespace {
+/// carries the per-subset values of a vector over to the new subsets (stride values per subset),
+/// the added subsets get the fill value, the vector is cleared if it was not sized for the old subsets
+template<typename T>
+void
+remap_subset_values(std::vector<T> & values,
+  const std::vector<int_t> & source_lids,
+  const int_t old_num_subsets,
+  const size_t stride,
+  const T & fill){
+  if(values.empty()||values.size()!=(size_t)old_num_subsets*stride){
+    values.clear();
+    return;
+  }
+  std::vector<T> new_values(source_lids.size()*stride,fill);
+  for(size_t i=0;i<source_lids.size();++i){
+    if(source_lids[i]<0) continue;
+    std::copy(values.begin()+source_lids[i]*stride,values.begin()+(source_lids[i]+1)*stride,new_values.begin()+i*stride);
+  }
+  values.swap(new_values);
+}
+}
+
+void
+Schema::update_subsets(Teuchos::ArrayRCP<scalar_t> coords_x,
+  Teuchos::ArrayRCP<scalar_t> coords_y,
+  const std::vector<int_t> & source_gids){
+  TEUCHOS_TEST_FOR_EXCEPTION(!is_initialized_||analysis_type_!=LOCAL_DIC,std::runtime_error,
+    "Error, the subsets can only be updated for an initialized local analysis");
+  TEUCHOS_TEST_FOR_EXCEPTION(comm_->get_size()>1,std::runtime_error,"Error, the subsets can only be updated on one processor");
+  TEUCHOS_TEST_FOR_EXCEPTION(!conformal_subset_defs_->empty()||motion_window_params_->size()>0||
+    (obstructing_subset_ids_!=Teuchos::null&&obstructing_subset_ids_->size()>0)||path_file_names_->size()>0||optical_flow_flags_->size()>0,
+    std::runtime_error,"Error, the subsets can't be updated if they were defined with a subset file");
+  const int_t num_points = coords_x.size();
+  TEUCHOS_TEST_FOR_EXCEPTION(num_points<1||coords_y.size()!=num_points||(int_t)source_gids.size()!=num_points,std::invalid_argument,
+    "Error, the new coordinates and source ids must have the same size (at least one point)");
+  // the values of the continuing subsets are found by their current local id
+  const int_t old_num_subsets = local_num_subsets_;
+  std::vector<int_t> source_lids(num_points,-1);
+  std::vector<int_t> new_gids(global_num_subsets_,-1);
+  for(int_t i=0;i<num_points;++i){
+    if(source_gids[i]<0) continue;
+    const int_t lid = source_gids[i]<global_num_subsets_ ? subset_local_id(source_gids[i]) : -1;
+    TEUCHOS_TEST_FOR_EXCEPTION(lid<0||new_gids[source_gids[i]]>=0,std::invalid_argument,
+      "Error, invalid or repeated source id " << source_gids[i]);
+    source_lids[i] = lid;
+    new_gids[source_gids[i]] = i;
+  }
+  std::vector<bool> moved(num_points,true);
+  for(int_t i=0;i<num_points;++i)
+    if(source_lids[i]>=0)
+      moved[i] = local_field_value(source_lids[i],SUBSET_COORDINATES_X_FS)!=coords_x[i]||
+        local_field_value(source_lids[i],SUBSET_COORDINATES_Y_FS)!=coords_y[i];
+  DEBUG_MSG("Schema::update_subsets(): " << old_num_subsets << " subsets replaced by " << num_points);
+
+  // the output already written or queued uses the old subset ids
+  flush_output();
+  binary_results_writer_ = Teuchos::null;
+  subset_text_writer_ = Teuchos::null;
+#ifdef DICE_ENABLE_GLOBAL
+  if(mesh_->get_output_exoid()>=0)
+    DICe::mesh::close_exodus_output(mesh_);
+#endif
+  Teuchos::RCP<Decomp> decomp = Teuchos::rcp(new Decomp(coords_x,coords_y,Teuchos::null,Teuchos::null,Teuchos::null));
+  Teuchos::RCP<DICe::mesh::Mesh> old_mesh = mesh_;
+  global_num_subsets_ = decomp->num_global_subsets();
+  this_proc_gid_order_ = decomp->this_proc_gid_order();
+  create_mesh(decomp);
+  TEUCHOS_TEST_FOR_EXCEPTION(local_num_subsets_!=num_points,std::runtime_error,"Error, the new mesh has the wrong number of subsets");
+  neighborhood_cache_ = Teuchos::rcp(new Neighborhood_Cache(mesh_));
+  for(size_t i=0;i<post_processors_.size();++i)
+    post_processors_[i]->initialize(mesh_,neighborhood_cache_);
+
+  // copy the values of the continuing subsets (the mesh creates its own coordinate field)
+  DICe::mesh::field_registry::iterator field_it = old_mesh->get_field_registry()->begin();
+  const DICe::mesh::field_registry::iterator field_end = old_mesh->get_field_registry()->end();
+  for(;field_it!=field_end;++field_it){
+    if(field_it->first==field_enums::INITIAL_COORDINATES_FS) continue;
+    mesh_->create_field(field_it->first);
+    Teuchos::RCP<MultiField> field = mesh_->get_field(field_it->first);
+    const int_t old_length = field_it->second->get_map()->get_num_local_elements();
+    const int_t new_length = field->get_map()->get_num_local_elements();
+    if(old_length%old_num_subsets!=0||new_length!=old_length/old_num_subsets*num_points) continue;
+    const int_t stride = old_length/old_num_subsets;
+    for(int_t col=0;col<field->get_num_fields()&&col<field_it->second->get_num_fields();++col){
+      const scalar_t * old_values = field_it->second->local_values(col);
+      scalar_t * new_values = field->local_values(col);
+      for(int_t i=0;i<num_points;++i)
+        if(source_lids[i]>=0)
+          std::copy(old_values+source_lids[i]*stride,old_values+(source_lids[i]+1)*stride,new_values+i*stride);
+    }
+  }
+  cache_field_values();
+  for(int_t i=0;i<num_points;++i){
+    local_field_value(i,SUBSET_COORDINATES_X_FS) = coords_x[i];
+    local_field_value(i,SUBSET_COORDINATES_Y_FS) = coords_y[i];
+    // the neighbor ids are global ids so they are renumbered too
+    const int_t neigh_gid = static_cast<int_t>(local_field_value(i,NEIGHBOR_ID_FS));
+    if(source_lids[i]>=0&&neigh_gid>=0)
+      local_field_value(i,NEIGHBOR_ID_FS) = neigh_gid<(int_t)new_gids.size() ? new_gids[neigh_gid] : -1;
+  }
+
+  // the objectives of the subsets that did not move keep their subsets
+  if(!obj_vec_.empty()&&ref_img_!=Teuchos::null){
+    std::vector<Teuchos::RCP<Objective> > objs(num_points);
+    for(int_t i=0;i<num_points;++i){
+      if(source_lids[i]>=0&&obj_vec_[source_lids[i]]!=Teuchos::null){
+        objs[i] = obj_vec_[source_lids[i]];
+        if(moved[i]) objs[i]->reset(i);
+        else objs[i]->renumber(i);
+      }
+      else
+        objs[i] = Teuchos::rcp(new Objective_ZNSSD(this,i));
+    }
+    obj_vec_.swap(objs);
+  }
+  else
+    obj_vec_.clear();
+  // the initializers are keyed by the global ids and hold the subsets, they are rebuilt for the next frame
+  opt_initializers_.clear();
+  remap_subset_values(motion_history_,source_lids,old_num_subsets,motion_history_depth*3,(scalar_t)0.0);
+  remap_subset_values(motion_history_frames_,source_lids,old_num_subsets,motion_history_depth,0);
+  remap_subset_values(motion_history_size_,source_lids,old_num_subsets,1,0);
+  remap_subset_values(motion_history_next_,source_lids,old_num_subsets,1,0);
+  remap_subset_values(low_contrast_check_frame_,source_lids,old_num_subsets,1,0);
+  remap_subset_values(low_contrast_rejected_,source_lids,old_num_subsets,1,-1);
+#if DICE_KOKKOS
+  subset_batch_ = Teuchos::null;
+  subset_batch_ref_img_ = Teuchos::null;
+#endif
 }
 
 void
@@ -1241,15 +2124,40 @@ Schema::project_right_image_into_left_frame(Teuchos::RCP<Triangulation> tri,
   const int_t oly = ref_img_->offset_y();
   const int_t orx = reference ? ref_img_->offset_x() : def_imgs_[0]->offset_x();
   const int_t ory = reference ? ref_img_->offset_y() : def_imgs_[0]->offset_y();
+  // the map from left pixels to right image coordinates only depends on the calibration and the frame
+  // geometry so it is computed once and reused for every frame
+  assert(tri->projective_params()!=Teuchos::null);
+  assert(tri->warp_params()!=Teuchos::null);
+  std::vector<scalar_t> key(tri->projective_params()->begin(),tri->projective_params()->end());
+  key.insert(key.end(),tri->warp_params()->begin(),tri->warp_params()->end());
+  const scalar_t geometry[6] = {(scalar_t)w,(scalar_t)h,(scalar_t)olx,(scalar_t)oly,(scalar_t)orx,(scalar_t)ory};
+  key.insert(key.end(),geometry,geometry+6);
+  if(key!=projection_map_key_){
+    DEBUG_MSG("Schema::project_right_image_into_left_frame(): computing the projection map");
+    projection_map_x_.resize(w*h);
+    projection_map_y_.resize(w*h);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(num_threads_)
+#endif
+    for(int_t j=0;j<h;++j){
+      scalar_t xr = 0.0;
+      scalar_t yr = 0.0;
+      for(int_t i=0;i<w;++i){
+        tri->project_left_to_right_sensor_coords(i+olx,j+oly,xr,yr);
+        projection_map_x_[j*w+i] = xr-orx;
+        projection_map_y_[j*w+i] = yr-ory;
+      }
+    }
+    projection_map_key_.swap(key);
+  }
   Teuchos::RCP<Image> proj_img = Teuchos::rcp(new Image(w,h,0.0,olx,oly));
   Teuchos::ArrayRCP<intensity_t> intens = proj_img->intensities();
-  scalar_t xr = 0.0;
-  scalar_t yr = 0.0;
+  intensity_t * proj_intens = intens.getRawPtr();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(num_threads_)
+#endif
   for(int_t j=0;j<h;++j){
-    for(int_t i=0;i<w;++i){
-      tri->project_left_to_right_sensor_coords(i+olx,j+oly,xr,yr);
-      intens[j*w+i] = img->interpolate_keys_fourth(xr-orx,yr-ory);
-    }
+    img->batch_interpolate(w,&projection_map_x_[j*w],&projection_map_y_[j*w],&proj_intens[j*w],NULL,NULL,KEYS_FOURTH);
   }
   if(reference){
     // automatically compute the derivatives of the new reference image...
@@ -1270,6 +2178,7 @@ Schema::execute_cross_correlation(){
   assert(is_initialized_);
   assert(global_num_subsets_>0);
   assert(local_num_subsets_>0);
+  stat_container_->initialize_subset_profile(local_num_subsets_);
   const int_t proc_id = comm_->get_rank();
   const int_t num_procs = comm_->get_size();
   DEBUG_MSG("********************");
@@ -1286,7 +2195,8 @@ Schema::execute_cross_correlation(){
 
   // change the parameters for cross-correlation
   initialization_method_ = USE_FIELD_VALUES; //USE_FEATURE_MATCHING;
-  if(optimization_method_==GRADIENT_BASED||optimization_method_==GRADIENT_BASED_THEN_SIMPLEX)
+  if(optimization_method_==GRADIENT_BASED||optimization_method_==GRADIENT_BASED_THEN_SIMPLEX||
+      optimization_method_==INVERSE_COMPOSITIONAL||optimization_method_==INVERSE_COMPOSITIONAL_THEN_SIMPLEX)
     optimization_method_=GRADIENT_THEN_SEARCH;
 
   // project the right image onto the left if requested
@@ -1307,7 +2217,7 @@ Schema::execute_cross_correlation(){
         const scalar_t search_step_u = 1.0; // pixels
         const scalar_t search_dim_u = 50.0; // pixels
         const int_t subset_gid = subset_global_id(subset_index);
-        Search_Initializer searcher(this,obj->subset(),search_step_u,search_dim_u,-1.0,0.0,-1.0,0.0);
+        Search_Initializer searcher(this,obj->subset(),search_step_u,search_dim_u,-1.0,0.0,-1.0,0.0,search_initialization_pyramid_levels_);
         searcher.initial_guess(subset_gid,shape_function);
         scalar_t min_u = 0.0,min_v = 0.0, min_t = 0.0;
         shape_function->map_to_u_v_theta(global_field_value(subset_gid,SUBSET_COORDINATES_X_FS),global_field_value(subset_gid,SUBSET_COORDINATES_Y_FS),
@@ -1399,6 +2309,10 @@ Schema::execute_correlation(){
   assert(is_initialized_);
   assert(global_num_subsets_>0);
   assert(local_num_subsets_>0);
+  // pick up any fields created since the last frame (by the post processors or initializers)
+  cache_field_values();
+  // the profile has to be sized before the threads record their solves
+  stat_container_->initialize_subset_profile(local_num_subsets_);
   const int_t proc_id = comm_->get_rank();
   const int_t num_procs = comm_->get_size();
 
@@ -1426,6 +2340,9 @@ Schema::execute_correlation(){
   DEBUG_MSG(message.str());
 #endif
 
+  // overlap fields exchanged for the previous frame are out of date
+  mesh_->clear_exchanged_overlap_fields();
+
   // if the formulation is incremental, clear the displacement fields
   if(use_incremental_formulation_){
     mesh_->get_field(SUBSET_DISPLACEMENT_X_FS)->put_scalar(0.0);
@@ -1456,6 +2373,13 @@ Schema::execute_correlation(){
 #endif
   TEUCHOS_TEST_FOR_EXCEPTION((int_t)this_proc_gid_order_.size()!=local_num_subsets_,std::runtime_error,
     "Error, the subset gid order vector is the wrong size");
+  allocate_subset_histories();
+  // if the motion tests run on the raw pixels this happens once a subset has to be correlated
+  if(!def_preprocessing_pending_)
+    prepare_def_interpolants();
+  // large motions are first found on downsampled images (this updates the field values the initializers read)
+  if(pyramid_correlation_levels_>0&&!def_preprocessing_pending_)
+    pyramid_pre_correlation();
   // The generic routine is typically used when the dataset involves numerous subsets,
   // but only a small number of images. In this case it's more efficient to re-allocate the
   // objectives at every step, since making them static would consume a lot of memory
@@ -1464,53 +2388,101 @@ Schema::execute_correlation(){
     TEUCHOS_TEST_FOR_EXCEPTION(motion_window_params_->size()!=0,std::runtime_error,
       "Error, motion windows are intended only for the TRACKING_ROUTINE");
     prepare_optimization_initializers();
-    for(int_t subset_index=0;subset_index<local_num_subsets_;++subset_index){
-      DEBUG_MSG("Schema::execute_correlation(): creating Objective for subset " << this_proc_gid_order_[subset_index]);
-      try{
-        Teuchos::RCP<Objective> obj = Teuchos::rcp(new Objective_ZNSSD(this,this_proc_gid_order_[subset_index]));
-        DEBUG_MSG("Schema::execute_correlation(): Objective creation successful");
-        generic_correlation_routine(obj);
+    // subsets in the same level are independent and share the read-only images
+    std::vector<std::vector<int_t> > levels;
+    create_correlation_levels(levels);
+    // optionally the subsets other processors need are correlated first so their values
+    // are in flight while the interior subsets are correlated
+    std::vector<std::vector<int_t> > interior_levels;
+    const bool exchange_halo = split_levels_for_halo_exchange(levels,interior_levels);
+    order_levels_by_cost(levels);
+    order_levels_by_cost(interior_levels);
+    std::vector<Teuchos::RCP<MultiField> > halo_fields;
+    // optionally the gradient based solves are done up front in one batch on the device
+    std::vector<Teuchos::RCP<Objective> > batch_objs;
+    prepare_batched_solve(batch_objs);
+    // each thread reuses one objective and one shape function for all of the subsets it correlates
+    objective_pool_.resize(num_threads_);
+    std::vector<Teuchos::RCP<Local_Shape_Function> > shape_function_pool(num_threads_);
+    for(int_t t=0;t<num_threads_;++t)
+      shape_function_pool[t] = shape_function_factory(this);
+    // the neighbor dependencies can instead be resolved in order of correlation quality
+    const bool use_neighbors = initialization_method_==USE_NEIGHBOR_VALUES ||
+        (initialization_method_==USE_NEIGHBOR_VALUES_FIRST_STEP_ONLY && frame_id_==first_frame_id_);
+    if(reliability_guided_propagation_&&use_neighbors&&!exchange_halo){
+      reliability_guided_correlation(batch_objs,shape_function_pool);
+      levels.clear();
+    }
+    else if(adaptive_grid_coarsening_>1&&!exchange_halo&&batch_objs.empty()&&adaptive_grid_applies()){
+      adaptive_grid_correlation(shape_function_pool);
+      levels.clear();
+    }
+    for(int_t phase=0;phase<2;++phase){
+      const std::vector<std::vector<int_t> > & phase_levels = phase==0 ? levels : interior_levels;
+      for(size_t level=0;level<phase_levels.size();++level){
+        const int_t num_level_subsets = phase_levels[level].size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_level_subsets>1)
+#endif
+        for(int_t i=0;i<num_level_subsets;++i)
+          correlate_pooled_subset(phase_levels[level][i],batch_objs,shape_function_pool);
       }
-      catch(std::exception & e){
-        DEBUG_MSG("Schema::execute_correlation(): subset " << this_proc_gid_order_[subset_index] << " failed");
-        record_failed_step(this_proc_gid_order_[subset_index],static_cast<int_t>(INITIALIZE_FAILED_BY_EXCEPTION),-1);
+      if(phase==0&&exchange_halo){
+        for(size_t i=0;i<halo_field_specs_.size();++i)
+          halo_fields.push_back(mesh_->get_field(halo_field_specs_[i]));
+        halo_exchange_->begin(halo_fields);
       }
     }
+#if DICE_KOKKOS
+    subset_batch_solved_ = false;
+#endif
+    if(exchange_halo){
+      std::vector<Teuchos::RCP<MultiField> > overlap_fields;
+      halo_exchange_->end(halo_fields,overlap_fields);
+      for(size_t i=0;i<halo_field_specs_.size();++i)
+        mesh_->set_exchanged_overlap_field(halo_field_specs_[i],overlap_fields[i]);
+    }
   }
   // In this routine there are usually only a handful of subsets, but thousands of images.
   // In this case it is a lot more efficient to make the objectives static since there won't
   // be very many of them, and we can avoid the allocation cost at every step
   else if(correlation_routine_==TRACKING_ROUTINE){
-    // construct the static objectives if they haven't already been constructed
-    if(obj_vec_.empty()){
-      for(int_t subset_index=0;subset_index<local_num_subsets_;++subset_index){
-        const int_t subset_gid = subset_global_id(subset_index);
-        //const int_t subset_gid = this_proc_gid_order_[subset_index];
-        DEBUG_MSG("[PROC " << proc_id << "] Adding objective to obj_vec_ " << subset_gid);
-        obj_vec_.push_back(Teuchos::rcp(new Objective_ZNSSD(this,subset_gid)));
-        // set the sub_image id for each subset:
-        if(motion_window_params_->find(subset_gid)!=motion_window_params_->end()){
-          const int_t use_subset_id = motion_window_params_->find(subset_gid)->second.use_subset_id_;
-          const int_t sub_image_id = use_subset_id ==-1 ? motion_window_params_->find(subset_gid)->second.sub_image_id_:
-              motion_window_params_->find(use_subset_id)->second.sub_image_id_;
-          DEBUG_MSG("[PROC " << proc_id << "] setting the sub_image id for subset " << subset_gid << " to " << sub_image_id);
-          obj_vec_[subset_index]->subset()->set_sub_image_id(sub_image_id);
+    create_tracking_objectives();
+    prepare_optimization_initializers();
+    // execute the subsets in order (levels are executed in parallel if there are no obstructions)
+    std::vector<std::vector<int_t> > levels;
+    create_correlation_levels(levels);
+    order_levels_by_cost(levels);
+    // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+    std::exception_ptr subset_error;
+    for(size_t level=0;level<levels.size();++level){
+      const int_t num_level_subsets = levels[level].size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_level_subsets>1)
+#endif
+      for(int_t i=0;i<num_level_subsets;++i){
+        const int_t subset_gid = levels[level][i];
+        const int_t subset_lid = subset_local_id(subset_gid);
+        try{
+          check_for_blocking_subsets(subset_gid);
+          generic_correlation_routine(obj_vec_[subset_lid]);
+        }
+        catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_subset_error)
+#endif
+          {
+            if(!subset_error) subset_error = std::current_exception();
+          }
         }
       }
-    }
-    TEUCHOS_TEST_FOR_EXCEPTION((int_t)obj_vec_.size()!=local_num_subsets_,std::runtime_error,"");
-    prepare_optimization_initializers();
-    // execute the subsets in order
-    for(int_t subset_index=0;subset_index<local_num_subsets_;++subset_index){
-      const int_t subset_gid = this_proc_gid_order_[subset_index];
-      const int_t subset_lid = subset_local_id(subset_gid);
-      check_for_blocking_subsets(subset_gid);
-      generic_correlation_routine(obj_vec_[subset_lid]);
+      if(subset_error) std::rethrow_exception(subset_error);
     }
     if(output_deformed_subset_images_)
       write_deformed_subsets_image();
     for(size_t i=0;i<prev_imgs_.size();++i)
       prev_imgs_[i]=def_imgs_[i];
+    raw_prev_imgs_ = raw_def_imgs_;
   }
   else
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,"ERROR: unknown correlation routine.");
@@ -1535,6 +2507,689 @@ Schema::execute_correlation(){
   return 0;
 };
 
+void
+Schema::create_tracking_objectives(){
+  // construct the static objectives if they haven't already been constructed
+  if(obj_vec_.empty()){
+    for(int_t subset_index=0;subset_index<local_num_subsets_;++subset_index){
+      const int_t subset_gid = subset_global_id(subset_index);
+      //const int_t subset_gid = this_proc_gid_order_[subset_index];
+      DEBUG_MSG("[PROC " << comm_->get_rank() << "] Adding objective to obj_vec_ " << subset_gid);
+      obj_vec_.push_back(Teuchos::rcp(new Objective_ZNSSD(this,subset_gid)));
+      // set the sub_image id for each subset:
+      if(motion_window_params_->find(subset_gid)!=motion_window_params_->end()){
+        const int_t use_subset_id = motion_window_params_->find(subset_gid)->second.use_subset_id_;
+        const int_t sub_image_id = use_subset_id ==-1 ? motion_window_params_->find(subset_gid)->second.sub_image_id_:
+            motion_window_params_->find(use_subset_id)->second.sub_image_id_;
+        DEBUG_MSG("[PROC " << comm_->get_rank() << "] setting the sub_image id for subset " << subset_gid << " to " << sub_image_id);
+        obj_vec_[subset_index]->subset()->set_sub_image_id(sub_image_id);
+      }
+    }
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t)obj_vec_.size()!=local_num_subsets_,std::runtime_error,"");
+}
+
+void
+Schema::allocate_subset_histories(){
+  // the motion history is allocated once so the subsets can append to it in parallel
+  if(projection_method_==POLYNOMIAL_BASED&&(int_t)motion_history_size_.size()!=local_num_subsets_){
+    motion_history_.assign(local_num_subsets_*motion_history_depth*3,0.0);
+    motion_history_frames_.assign(local_num_subsets_*motion_history_depth,0);
+    motion_history_size_.assign(local_num_subsets_,0);
+    motion_history_next_.assign(local_num_subsets_,0);
+  }
+  // the low contrast checks are also stored per subset so they can be updated in parallel
+  if((low_contrast_threshold_>0.0||low_sssig_threshold_>0.0)&&(int_t)low_contrast_rejected_.size()!=local_num_subsets_){
+    low_contrast_check_frame_.assign(local_num_subsets_,0);
+    low_contrast_rejected_.assign(local_num_subsets_,-1);
+  }
+}
+
+bool
+Schema::supports_frame_batches()const{
+  if(analysis_type_!=LOCAL_DIC||correlation_routine_!=TRACKING_ROUTINE||!is_initialized_) return false;
+  if(use_incremental_formulation_||def_imgs_.size()!=1||motion_window_params_->size()>0) return false;
+  if(obstructing_subset_ids_!=Teuchos::null&&obstructing_subset_ids_->size()>0) return false;
+  if(pyramid_correlation_levels_>0) return false;
+  // the other initializers read the other subsets or the whole frame
+  return initialization_method_==USE_FIELD_VALUES||initialization_method_==USE_ZEROS||initialization_method_==USE_OPTICAL_FLOW;
+}
+
+void
+Schema::push_batch_frame(){
+  TEUCHOS_TEST_FOR_EXCEPTION(!supports_frame_batches(),std::runtime_error,
+    "Error, the frames can't be correlated in batches with these correlation parameters");
+  // every frame of the batch is correlated so the deferred filter is applied now
+  preprocess_def_images();
+  prepare_def_interpolants();
+  batch_def_imgs_.push_back(def_imgs_[0]);
+  batch_raw_def_imgs_.push_back(raw_def_imgs_[0]);
+}
+
+void
+Schema::copy_batch_subset_values(const int_t subset_lid,
+  scalar_t * values,
+  const bool to_fields){
+  int_t offset = 0;
+  for(size_t i=0;i<batch_fields_.size();++i){
+    const Teuchos::RCP<MultiField> & field = batch_fields_[i].first;
+    const int_t stride = batch_fields_[i].second;
+    for(int_t col=0;col<field->get_num_fields();++col){
+      mv_scalar_type * field_values = field->local_values(col);
+      for(int_t j=0;j<stride;++j){
+        if(to_fields)
+          field_values[subset_lid*stride+j] = values[offset++];
+        else
+          values[offset++] = field_values[subset_lid*stride+j];
+      }
+    }
+  }
+}
+
+int_t
+Schema::execute_correlation_batch(){
+  Scoped_Trace_Span span("execute_correlation_batch","correlation");
+  TEUCHOS_TEST_FOR_EXCEPTION(batch_def_imgs_.empty(),std::runtime_error,"Error, no frames have been added to the batch");
+  TEUCHOS_TEST_FOR_EXCEPTION(!supports_frame_batches(),std::runtime_error,
+    "Error, the frames can't be correlated in batches with these correlation parameters");
+  const int_t num_batch_frames = batch_def_imgs_.size();
+  DEBUG_MSG("Schema::execute_correlation_batch(): correlating " << local_num_subsets_ << " subsets over " << num_batch_frames << " frames");
+  cache_field_values();
+  mesh_->clear_exchanged_overlap_fields();
+  allocate_subset_histories();
+  create_tracking_objectives();
+  prepare_optimization_initializers();
+
+  // every field with one or more values per subset is stored for each frame
+  batch_fields_.clear();
+  batch_values_per_subset_ = 0;
+  const DICe::mesh::field_registry * registry = mesh_->get_field_registry();
+  for(DICe::mesh::field_registry::const_iterator it=registry->begin();it!=registry->end();++it){
+    const int_t num_values = it->second->get_map()->get_num_local_elements();
+    if(num_values==0||num_values%local_num_subsets_!=0) continue;
+    const int_t stride = num_values/local_num_subsets_;
+    batch_fields_.push_back(std::pair<Teuchos::RCP<MultiField>,int_t>(it->second,stride));
+    batch_values_per_subset_ += stride*it->second->get_num_fields();
+  }
+  batch_field_values_.resize(num_batch_frames);
+  for(int_t frame=0;frame<num_batch_frames;++frame)
+    batch_field_values_[frame].resize(local_num_subsets_*batch_values_per_subset_);
+
+  // the images and frame id are switched for each frame of the subset, the state at the
+  // start of the batch is the previous frame of the first frame
+  batch_first_frame_id_ = frame_id_;
+  batch_prev_imgs_ = prev_imgs_;
+  batch_raw_prev_imgs_ = raw_prev_imgs_;
+  def_preprocessing_pending_ = false;
+  std::vector<std::vector<int_t> > levels;
+  create_correlation_levels(levels);
+  for(size_t level=0;level<levels.size();++level){
+    for(size_t i=0;i<levels[level].size();++i){
+      const int_t subset_gid = levels[level][i];
+      const int_t subset_lid = subset_local_id(subset_gid);
+      for(int_t frame=0;frame<num_batch_frames;++frame){
+        frame_id_ = batch_first_frame_id_ + frame;
+        def_imgs_[0] = batch_def_imgs_[frame];
+        raw_def_imgs_[0] = batch_raw_def_imgs_[frame];
+        prev_imgs_[0] = frame==0 ? batch_prev_imgs_[0] : batch_def_imgs_[frame-1];
+        raw_prev_imgs_[0] = frame==0 ? batch_raw_prev_imgs_[0] : batch_raw_def_imgs_[frame-1];
+        generic_correlation_routine(obj_vec_[subset_lid]);
+        copy_batch_subset_values(subset_lid,&batch_field_values_[frame][subset_lid*batch_values_per_subset_],false);
+      }
+    }
+  }
+  frame_id_ = batch_first_frame_id_;
+  return 0;
+}
+
+void
+Schema::load_batch_frame(const int_t index){
+  TEUCHOS_TEST_FOR_EXCEPTION(index<0||index>=(int_t)batch_field_values_.size()||index>=(int_t)batch_def_imgs_.size(),std::runtime_error,
+    "Error, invalid batch frame index " << index);
+  for(int_t subset_lid=0;subset_lid<local_num_subsets_;++subset_lid)
+    copy_batch_subset_values(subset_lid,&batch_field_values_[index][subset_lid*batch_values_per_subset_],true);
+  frame_id_ = batch_first_frame_id_ + index;
+  def_imgs_[0] = batch_def_imgs_[index];
+  raw_def_imgs_[0] = batch_raw_def_imgs_[index];
+  if(output_deformed_subset_images_)
+    write_deformed_subsets_image();
+  prev_imgs_[0] = def_imgs_[0];
+  raw_prev_imgs_[0] = raw_def_imgs_[0];
+  update_frame_id();
+  // the batch is done once its last frame is loaded
+  if(index==(int_t)batch_def_imgs_.size()-1){
+    batch_def_imgs_.clear();
+    batch_raw_def_imgs_.clear();
+    batch_prev_imgs_.clear();
+    batch_raw_prev_imgs_.clear();
+    batch_field_values_.clear();
+  }
+}
+
+void
+Schema::correlate_pooled_subset(const int_t subset_gid,
+  const std::vector<Teuchos::RCP<Objective> > & batch_objs,
+  const std::vector<Teuchos::RCP<Local_Shape_Function> > & shape_function_pool){
+#ifdef _OPENMP
+  const int_t thread = omp_get_thread_num();
+#else
+  const int_t thread = 0;
+#endif
+  DEBUG_MSG("Schema::execute_correlation(): creating Objective for subset " << subset_gid);
+  try{
+    Teuchos::RCP<Objective> obj = batch_objs.empty() ? Teuchos::null : batch_objs[subset_local_id(subset_gid)];
+    if(obj==Teuchos::null){
+      if(objective_pool_[thread]==Teuchos::null)
+        objective_pool_[thread] = Teuchos::rcp(new Objective_ZNSSD(this,subset_gid));
+      else
+        objective_pool_[thread]->reset(subset_gid);
+      obj = objective_pool_[thread];
+    }
+    DEBUG_MSG("Schema::execute_correlation(): Objective creation successful");
+    generic_correlation_routine(obj,shape_function_pool[thread]);
+  }
+  catch(std::exception & e){
+    DEBUG_MSG("Schema::execute_correlation(): subset " << subset_gid << " failed");
+    // the pooled objective may have been left part way through a reset
+    objective_pool_[thread] = Teuchos::null;
+    record_failed_step(subset_gid,static_cast<int_t>(INITIALIZE_FAILED_BY_EXCEPTION),-1);
+  }
+}
+
+bool
+Schema::adaptive_grid_applies(){
+  bool applies = step_size_x_>0&&step_size_y_>0
+      &&initialization_method_!=USE_NEIGHBOR_VALUES&&initialization_method_!=USE_NEIGHBOR_VALUES_FIRST_STEP_ONLY
+      &&(obstructing_subset_ids_==Teuchos::null||obstructing_subset_ids_->size()==0);
+  // every processor has the same coordinates so they all make the same decision
+  if(applies)
+    applies = create_adaptive_grid();
+  if(!applies){
+    if(comm_->get_rank()==0)
+      std::cout << "*** Warning: adaptive_grid_coarsening requires a regular grid of subsets that are not initialized "
+        "with neighbor values or blocked by other subsets, every subset will be correlated" << std::endl;
+    adaptive_grid_coarsening_ = 0;
+  }
+  return applies;
+}
+
+bool
+Schema::create_adaptive_grid(){
+  // this is collective so every processor has to rebuild the grid at the same time
+  if(adaptive_grid_created_) return true;
+  adaptive_coarse_gids_.clear();
+  adaptive_fine_gids_.clear();
+  adaptive_corner_gids_.clear();
+  adaptive_corner_weights_.clear();
+  // gather the coordinates of all the subsets on all processors since the corners may belong to other processors
+  Teuchos::RCP<MultiField_Map> dist_map = mesh_->get_scalar_node_dist_map();
+  Teuchos::RCP<MultiField> dist_coords = Teuchos::rcp(new MultiField(dist_map,2,true));
+  for(int_t i=0;i<local_num_subsets_;++i){
+    dist_coords->local_value(i,0) = local_field_value(i,SUBSET_COORDINATES_X_FS);
+    dist_coords->local_value(i,1) = local_field_value(i,SUBSET_COORDINATES_Y_FS);
+  }
+  Teuchos::Array<int_t> all_owned_ids(global_num_subsets_);
+  for(int_t i=0;i<global_num_subsets_;++i)
+    all_owned_ids[i] = i;
+  Teuchos::RCP<MultiField_Map> all_map = Teuchos::rcp(new MultiField_Map(-1,all_owned_ids,0,*comm_));
+  Teuchos::RCP<MultiField> all_coords = Teuchos::rcp(new MultiField(all_map,2,true));
+  MultiField_Exporter exporter(*all_map,*dist_map);
+  all_coords->do_import(dist_coords,exporter,INSERT);
+  scalar_t min_x = std::numeric_limits<scalar_t>::max();
+  scalar_t min_y = std::numeric_limits<scalar_t>::max();
+  for(int_t i=0;i<global_num_subsets_;++i){
+    min_x = std::min(min_x,(scalar_t)all_coords->local_value(i,0));
+    min_y = std::min(min_y,(scalar_t)all_coords->local_value(i,1));
+  }
+  // grid index of every subset
+  std::map<std::pair<int_t,int_t>,int_t> grid;
+  std::vector<int_t> index_x(global_num_subsets_);
+  std::vector<int_t> index_y(global_num_subsets_);
+  for(int_t i=0;i<global_num_subsets_;++i){
+    const scalar_t x = all_coords->local_value(i,0);
+    const scalar_t y = all_coords->local_value(i,1);
+    index_x[i] = (int_t)std::round((x-min_x)/step_size_x_);
+    index_y[i] = (int_t)std::round((y-min_y)/step_size_y_);
+    if(std::abs(min_x+index_x[i]*step_size_x_-x)>0.5||std::abs(min_y+index_y[i]*step_size_y_-y)>0.5)
+      return false;
+    grid[std::pair<int_t,int_t>(index_x[i],index_y[i])] = i;
+  }
+  const int_t r = adaptive_grid_coarsening_;
+  for(int_t i=0;i<local_num_subsets_;++i){
+    const int_t gid = subset_global_id(i);
+    const int_t ix = index_x[gid];
+    const int_t iy = index_y[gid];
+    if(ix%r==0&&iy%r==0){
+      adaptive_coarse_gids_.push_back(gid);
+      continue;
+    }
+    adaptive_fine_gids_.push_back(gid);
+    const int_t cx = ix - ix%r;
+    const int_t cy = iy - iy%r;
+    const scalar_t wx = (scalar_t)(ix%r)/r;
+    const scalar_t wy = (scalar_t)(iy%r)/r;
+    const int_t corner_x[4] = {cx,cx+r,cx,cx+r};
+    const int_t corner_y[4] = {cy,cy,cy+r,cy+r};
+    const scalar_t weights[4] = {(1.0-wx)*(1.0-wy),wx*(1.0-wy),(1.0-wx)*wy,wx*wy};
+    for(int_t c=0;c<4;++c){
+      std::map<std::pair<int_t,int_t>,int_t>::const_iterator it = grid.find(std::pair<int_t,int_t>(corner_x[c],corner_y[c]));
+      adaptive_corner_gids_.push_back(it==grid.end() ? -1 : it->second);
+      adaptive_corner_weights_.push_back(weights[c]);
+    }
+  }
+  adaptive_grid_created_ = true;
+  DEBUG_MSG("[PROC " << comm_->get_rank() << "] Schema::create_adaptive_grid(): " << adaptive_coarse_gids_.size() << " coarse subsets and " <<
+    adaptive_fine_gids_.size() << " subsets in between");
+  return true;
+}
+
+void
+Schema::adaptive_grid_correlation(const std::vector<Teuchos::RCP<Local_Shape_Function> > & shape_function_pool){
+  const std::vector<Teuchos::RCP<Objective> > no_batch_objs;
+  const int_t num_coarse = adaptive_coarse_gids_.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_coarse>1)
+#endif
+  for(int_t i=0;i<num_coarse;++i)
+    correlate_pooled_subset(adaptive_coarse_gids_[i],no_batch_objs,shape_function_pool);
+
+  // the solution and quality of the corners are gathered on all processors
+  std::vector<Field_Spec> solution_specs;
+  solution_specs.push_back(SUBSET_DISPLACEMENT_X_FS);
+  solution_specs.push_back(SUBSET_DISPLACEMENT_Y_FS);
+  solution_specs.push_back(ROTATION_Z_FS);
+  std::map<Field_Spec,size_t>::const_iterator spec_it = shape_function_pool[0]->spec_map()->begin();
+  for(;spec_it!=shape_function_pool[0]->spec_map()->end();++spec_it)
+    if(std::find(solution_specs.begin(),solution_specs.end(),spec_it->first)==solution_specs.end())
+      solution_specs.push_back(spec_it->first);
+  const int_t num_solution_specs = solution_specs.size();
+  std::vector<Field_Spec> quality_specs;
+  quality_specs.push_back(SIGMA_FS);
+  quality_specs.push_back(GAMMA_FS);
+  quality_specs.push_back(BETA_FS);
+  quality_specs.push_back(OMEGA_FS);
+  quality_specs.push_back(NOISE_LEVEL_FS);
+  quality_specs.push_back(CONTRAST_LEVEL_FS);
+  std::vector<Field_Spec> specs = solution_specs;
+  specs.insert(specs.end(),quality_specs.begin(),quality_specs.end());
+  const int_t num_specs = specs.size();
+  const int_t sigma_col = num_solution_specs;
+  const int_t gamma_col = num_solution_specs + 1;
+  // columns of the strains, their spread over the corners times the cell size is an interpolation error
+  std::vector<int_t> strain_cols;
+  for(int_t i=0;i<num_solution_specs;++i)
+    if(specs[i]==NORMAL_STRETCH_XX_FS||specs[i]==NORMAL_STRETCH_YY_FS||specs[i]==SHEAR_STRETCH_XY_FS)
+      strain_cols.push_back(i);
+  Teuchos::RCP<MultiField_Map> dist_map = mesh_->get_scalar_node_dist_map();
+  Teuchos::RCP<MultiField> dist_values = Teuchos::rcp(new MultiField(dist_map,num_specs,true));
+  for(int_t i=0;i<local_num_subsets_;++i)
+    for(int_t j=0;j<num_specs;++j)
+      dist_values->local_value(i,j) = local_field_value(i,specs[j]);
+  Teuchos::Array<int_t> all_owned_ids(global_num_subsets_);
+  for(int_t i=0;i<global_num_subsets_;++i)
+    all_owned_ids[i] = i;
+  Teuchos::RCP<MultiField_Map> all_map = Teuchos::rcp(new MultiField_Map(-1,all_owned_ids,0,*comm_));
+  Teuchos::RCP<MultiField> all_values = Teuchos::rcp(new MultiField(all_map,num_specs,true));
+  MultiField_Exporter exporter(*all_map,*dist_map);
+  all_values->do_import(dist_values,exporter,INSERT);
+
+  // interpolate the subsets in between, the ones the coarse cell does not resolve start from the interpolated values
+  const scalar_t cell_size = adaptive_grid_coarsening_*std::max(step_size_x_,step_size_y_);
+  const int_t num_fine = adaptive_fine_gids_.size();
+  std::vector<int_t> refine_gids;
+  for(int_t i=0;i<num_fine;++i){
+    const int_t gid = adaptive_fine_gids_[i];
+    const int_t lid = subset_local_id(gid);
+    const int_t * corners = &adaptive_corner_gids_[i*4];
+    const scalar_t * weights = &adaptive_corner_weights_[i*4];
+    bool refine = false;
+    bool all_corners = true;
+    for(int_t c=0;c<4;++c){
+      if(weights[c]<=0.0) continue;
+      if(corners[c]<0){
+        refine = true;
+        break;
+      }
+      if(all_values->local_value(corners[c],sigma_col)<0.0
+          ||(adaptive_grid_gamma_threshold_>0.0&&all_values->local_value(corners[c],gamma_col)>adaptive_grid_gamma_threshold_))
+        refine = true;
+    }
+    for(int_t c=0;c<4;++c)
+      if(corners[c]<0) all_corners = false;
+    if(!refine){
+      scalar_t error = 0.0;
+      // the bilinear twist of the displacements is the part an affine field can't represent
+      if(all_corners&&weights[3]>0.0){
+        for(int_t j=0;j<2;++j)
+          error = std::max(error,(scalar_t)(0.25*std::abs(all_values->local_value(corners[0],j) - all_values->local_value(corners[1],j)
+            - all_values->local_value(corners[2],j) + all_values->local_value(corners[3],j))));
+      }
+      for(size_t j=0;j<strain_cols.size();++j){
+        scalar_t min_strain = std::numeric_limits<scalar_t>::max();
+        scalar_t max_strain = -std::numeric_limits<scalar_t>::max();
+        for(int_t c=0;c<4;++c){
+          if(weights[c]<=0.0) continue;
+          min_strain = std::min(min_strain,(scalar_t)all_values->local_value(corners[c],strain_cols[j]));
+          max_strain = std::max(max_strain,(scalar_t)all_values->local_value(corners[c],strain_cols[j]));
+        }
+        error = std::max(error,(scalar_t)(0.25*(max_strain-min_strain)*cell_size));
+      }
+      refine = error>adaptive_grid_tolerance_;
+    }
+    for(int_t j=0;j<num_solution_specs;++j){
+      scalar_t value = 0.0;
+      for(int_t c=0;c<4;++c)
+        if(weights[c]>0.0&&corners[c]>=0)
+          value += weights[c]*all_values->local_value(corners[c],j);
+      local_field_value(lid,specs[j]) = value;
+    }
+    if(refine){
+      refine_gids.push_back(gid);
+      continue;
+    }
+    // the quality of an interpolated subset is the worst of its corners
+    for(size_t j=0;j<quality_specs.size();++j){
+      scalar_t value = -std::numeric_limits<scalar_t>::max();
+      for(int_t c=0;c<4;++c)
+        if(weights[c]>0.0)
+          value = std::max(value,(scalar_t)all_values->local_value(corners[c],num_solution_specs+j));
+      local_field_value(lid,quality_specs[j]) = value;
+    }
+    local_field_value(lid,MATCH_FS) = 0.0;
+    local_field_value(lid,ACTIVE_PIXELS_FS) = 0.0;
+    local_field_value(lid,ITERATIONS_FS) = 0;
+    local_field_value(lid,STATUS_FLAG_FS) = static_cast<int_t>(SUBSET_INTERPOLATED_FROM_COARSE_GRID);
+  }
+  DEBUG_MSG("[PROC " << comm_->get_rank() << "] Schema::adaptive_grid_correlation(): correlated " << num_coarse << " coarse subsets, refined " <<
+    refine_gids.size() << " and interpolated " << num_fine - (int_t)refine_gids.size());
+  const int_t num_refine = refine_gids.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_refine>1)
+#endif
+  for(int_t i=0;i<num_refine;++i)
+    correlate_pooled_subset(refine_gids[i],no_batch_objs,shape_function_pool);
+}
+
+void
+Schema::reliability_guided_correlation(const std::vector<Teuchos::RCP<Objective> > & batch_objs,
+  const std::vector<Teuchos::RCP<Local_Shape_Function> > & shape_function_pool){
+  if(local_num_subsets_<=0) return;
+  // nearest neighbor graph of the local subsets (a subset is its own first neighbor)
+  const int_t num_neighbors = std::min<int_t>(9,local_num_subsets_);
+  Teuchos::RCP<Point_Cloud_2D<scalar_t> > point_cloud = Teuchos::rcp(new Point_Cloud_2D<scalar_t>());
+  point_cloud->pts.resize(local_num_subsets_);
+  for(int_t i=0;i<local_num_subsets_;++i){
+    point_cloud->pts[i].x = local_field_value(i,SUBSET_COORDINATES_X_FS);
+    point_cloud->pts[i].y = local_field_value(i,SUBSET_COORDINATES_Y_FS);
+  }
+  Teuchos::RCP<kd_tree_2d_t> kd_tree = Teuchos::rcp(new kd_tree_2d_t(2 /*dim*/, *point_cloud.get(), nanoflann::KDTreeSingleIndexAdaptorParams(10 /* max leaf */) ) );
+  kd_tree->buildIndex();
+  std::vector<size_t> neighbors(local_num_subsets_*num_neighbors,0);
+  std::vector<scalar_t> out_dist_sqr(num_neighbors);
+  scalar_t query_pt[2];
+  for(int_t i=0;i<local_num_subsets_;++i){
+    query_pt[0] = point_cloud->pts[i].x;
+    query_pt[1] = point_cloud->pts[i].y;
+    kd_tree->knnSearch(&query_pt[0],num_neighbors,&neighbors[i*num_neighbors],&out_dist_sqr[0]);
+  }
+  // the seeds start the propagation
+  std::vector<bool> scheduled(local_num_subsets_,false);
+  std::vector<int_t> wave;
+  for(int_t i=0;i<local_num_subsets_;++i){
+    const int_t subset_gid = this_proc_gid_order_[i];
+    const int_t neigh_gid = global_field_value(subset_gid,NEIGHBOR_ID_FS);
+    if(neigh_gid<0||neigh_gid==subset_gid||subset_local_id(neigh_gid)<0){
+      wave.push_back(subset_gid);
+      scheduled[subset_local_id(subset_gid)] = true;
+    }
+  }
+  // candidates ranked by the gamma of the subset they are initialized from (lowest first)
+  typedef std::pair<scalar_t,std::pair<int_t,int_t> > candidate_t; // gamma, (subset gid, initializing subset gid)
+  std::priority_queue<candidate_t,std::vector<candidate_t>,std::greater<candidate_t> > candidates;
+  const size_t wave_size = num_threads_ > 1 ? num_threads_ : 1;
+  int_t num_waves = 0;
+  while(!wave.empty()){
+    const int_t num_wave_subsets = wave.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_wave_subsets>1)
+#endif
+    for(int_t i=0;i<num_wave_subsets;++i)
+      correlate_pooled_subset(wave[i],batch_objs,shape_function_pool);
+    num_waves++;
+    // only successfully correlated subsets pass their solution on
+    for(int_t i=0;i<num_wave_subsets;++i){
+      if(global_field_value(wave[i],SIGMA_FS)==-1.0) continue;
+      const scalar_t gamma = global_field_value(wave[i],GAMMA_FS);
+      const int_t subset_lid = subset_local_id(wave[i]);
+      for(int_t j=0;j<num_neighbors;++j){
+        const int_t neigh_lid = neighbors[subset_lid*num_neighbors+j];
+        if(!scheduled[neigh_lid])
+          candidates.push(candidate_t(gamma,std::pair<int_t,int_t>(subset_global_id(neigh_lid),wave[i])));
+      }
+    }
+    wave.clear();
+    while(!candidates.empty()&&wave.size()<wave_size){
+      const candidate_t best = candidates.top();
+      candidates.pop();
+      const int_t subset_lid = subset_local_id(best.second.first);
+      if(scheduled[subset_lid]) continue;
+      scheduled[subset_lid] = true;
+      local_field_value(subset_lid,NEIGHBOR_ID_FS) = best.second.second;
+      wave.push_back(best.second.first);
+    }
+  }
+  // subsets only reachable through failed subsets keep their original neighbor
+  int_t num_unreached = 0;
+  for(int_t i=0;i<local_num_subsets_;++i){
+    const int_t subset_gid = this_proc_gid_order_[i];
+    if(scheduled[subset_local_id(subset_gid)]) continue;
+    correlate_pooled_subset(subset_gid,batch_objs,shape_function_pool);
+    num_unreached++;
+  }
+  DEBUG_MSG("Schema::reliability_guided_correlation(): " << num_waves << " waves, " << num_unreached << " subsets not reached from a seed");
+}
+
+void
+Schema::create_correlation_levels(std::vector<std::vector<int_t> > & levels){
+  levels.clear();
+  bool serial = num_threads_<=1;
+  // for tracking, blocking subsets and motion detectors are shared between subsets so the order has to be kept
+  if(correlation_routine_==TRACKING_ROUTINE){
+    if(obstructing_subset_ids_!=Teuchos::null)
+      if(obstructing_subset_ids_->size()>0) serial = true;
+    if(motion_window_params_->size()>0) serial = true;
+  }
+  // subsets initialized with a neighbor's solution have to wait for the neighbor
+  const bool use_neighbors = initialization_method_==USE_NEIGHBOR_VALUES ||
+      (initialization_method_==USE_NEIGHBOR_VALUES_FIRST_STEP_ONLY && frame_id_==first_frame_id_);
+  if(!serial){
+    std::map<int_t,int_t> gid_levels;
+    for(int_t i=0;i<local_num_subsets_;++i){
+      const int_t subset_gid = this_proc_gid_order_[i];
+      int_t level = 0;
+      if(use_neighbors){
+        const int_t neigh_gid = global_field_value(subset_gid,NEIGHBOR_ID_FS);
+        if(neigh_gid>=0&&neigh_gid!=subset_gid&&subset_local_id(neigh_gid)>=0){
+          // the neighbor is executed after this subset in the serial order, keep the serial order
+          if(gid_levels.find(neigh_gid)==gid_levels.end()){
+            serial = true;
+            break;
+          }
+          level = gid_levels.find(neigh_gid)->second + 1;
+        }
+      }
+      gid_levels.insert(std::pair<int_t,int_t>(subset_gid,level));
+      if((int_t)levels.size()<=level)
+        levels.resize(level+1);
+      levels[level].push_back(subset_gid);
+    }
+  }
+  if(serial){
+    levels.clear();
+    levels.resize(local_num_subsets_);
+    for(int_t i=0;i<local_num_subsets_;++i)
+      levels[i].push_back(this_proc_gid_order_[i]);
+  }
+  DEBUG_MSG("Schema::create_correlation_levels(): number of levels " << levels.size() << " for " << local_num_subsets_ << " subsets");
+}
+
+void
+Schema::order_levels_by_cost(std::vector<std::vector<int_t> > & levels){
+  if(num_threads_<=1) return;
+  const bool profiled = stat_container_->subset_profile_size()==local_num_subsets_;
+  std::vector<std::pair<scalar_t,int_t> > costs; // cost, subset gid
+  for(size_t level=0;level<levels.size();++level){
+    if(levels[level].size()<2) continue;
+    // the solve times are only compared once all the subsets in the level have one
+    bool timed = profiled;
+    for(size_t i=0;i<levels[level].size()&&timed;++i)
+      if(stat_container_->num_solves(subset_local_id(levels[level][i]))==0) timed = false;
+    costs.resize(levels[level].size());
+    for(size_t i=0;i<levels[level].size();++i){
+      const int_t subset_lid = subset_local_id(levels[level][i]);
+      costs[i].first = timed ? stat_container_->average_solve_time(subset_lid) : local_field_value(subset_lid,ITERATIONS_FS);
+      costs[i].second = levels[level][i];
+    }
+    // stable so that subsets without a history keep their original order
+    std::stable_sort(costs.begin(),costs.end(),
+      [](const std::pair<scalar_t,int_t> & a, const std::pair<scalar_t,int_t> & b){return a.first > b.first;});
+    for(size_t i=0;i<costs.size();++i)
+      levels[level][i] = costs[i].second;
+  }
+}
+
+bool
+Schema::split_levels_for_halo_exchange(std::vector<std::vector<int_t> > & levels,
+  std::vector<std::vector<int_t> > & interior_levels){
+  interior_levels.clear();
+  if(!overlap_halo_exchange_||comm_->get_size()<=1||post_processors_.empty()||use_incremental_formulation_)
+    return false;
+  // reordering the subsets would break the dependency on the neighbor's solution
+  if(initialization_method_==USE_NEIGHBOR_VALUES ||
+      (initialization_method_==USE_NEIGHBOR_VALUES_FIRST_STEP_ONLY && frame_id_==first_frame_id_))
+    return false;
+  // the post processors request the same fields on every processor so all processors agree on the exchange
+  halo_field_specs_.clear();
+  const std::set<field_enums::Field_Spec> & requested = mesh_->requested_overlap_fields();
+  for(std::set<field_enums::Field_Spec>::const_iterator it=requested.begin();it!=requested.end();++it){
+    if(it->get_rank()==field_enums::NODE_RANK&&it->get_field_type()==field_enums::SCALAR_FIELD_TYPE&&
+        mesh_->get_field_registry()->find(*it)!=mesh_->get_field_registry()->end())
+      halo_field_specs_.push_back(*it);
+  }
+  if(halo_field_specs_.empty())
+    return false;
+  if(halo_exchange_==Teuchos::null)
+    halo_exchange_ = Teuchos::rcp(new Halo_Exchange(mesh_->get_scalar_node_dist_map(),mesh_->get_scalar_node_overlap_map()));
+  // there are no dependencies between the subsets so each phase is one level
+  std::vector<int_t> boundary;
+  std::vector<int_t> interior;
+  for(size_t level=0;level<levels.size();++level){
+    for(size_t i=0;i<levels[level].size();++i){
+      if(halo_exchange_->boundary_ids().find(levels[level][i])!=halo_exchange_->boundary_ids().end())
+        boundary.push_back(levels[level][i]);
+      else
+        interior.push_back(levels[level][i]);
+    }
+  }
+  levels.assign(1,boundary);
+  interior_levels.assign(1,interior);
+  DEBUG_MSG("[PROC " << comm_->get_rank() << "] Schema::split_levels_for_halo_exchange(): " << boundary.size() <<
+    " boundary subsets, " << interior.size() << " interior subsets");
+  return true;
+}
+
+void
+Schema::prepare_batched_solve(std::vector<Teuchos::RCP<Objective> > & objs){
+  objs.clear();
+#if DICE_KOKKOS
+  subset_batch_solved_ = false;
+  // the batch covers the plain gradient based solve of the affine shape function from the field values,
+  // everything else (and any subset whose initial guess turns out different) is solved as usual
+  if(!use_batched_device_correlation_||correlation_routine_!=GENERIC_ROUTINE||local_num_subsets_<=0) return;
+  if(optimization_method_!=DICe::GRADIENT_BASED&&optimization_method_!=DICe::GRADIENT_BASED_THEN_SIMPLEX&&
+      optimization_method_!=DICe::GRADIENT_THEN_SEARCH) return;
+  if(initialization_method_!=USE_FIELD_VALUES||quadratic_shape_function_enabled()) return;
+  if(interpolation_method_!=BILINEAR&&interpolation_method_!=KEYS_FOURTH) return;
+  // the batch uses the reference gradients and the reference intensities from when it was packed
+  if(def_imgs_[0]->has_gradients()||use_subset_evolution_) return;
+  DEBUG_MSG("Schema::prepare_batched_solve(): constructing objectives for " << local_num_subsets_ << " subsets");
+  objs.resize(local_num_subsets_);
+  bool all_constructed = true;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_)
+#endif
+  for(int_t lid=0;lid<local_num_subsets_;++lid){
+    try{
+      objs[lid] = Teuchos::rcp(new Objective_ZNSSD(this,subset_global_id(lid)));
+    }
+    catch(std::exception & e){
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+      all_constructed = false;
+    }
+  }
+  // the packed reference data is reused for as long as the reference image stays the same
+  if(subset_batch_==Teuchos::null||subset_batch_ref_img_!=ref_img_){
+    subset_batch_ = Teuchos::null;
+    subset_batch_ref_img_ = Teuchos::null;
+    if(!all_constructed){
+      DEBUG_MSG("Schema::prepare_batched_solve(): not all objectives could be constructed, skipping the batched solve");
+      return;
+    }
+    std::vector<Teuchos::RCP<Subset> > subsets(local_num_subsets_);
+    for(int_t lid=0;lid<local_num_subsets_;++lid)
+      subsets[lid] = objs[lid]->subset();
+    subset_batch_ = Teuchos::rcp(new Subset_Batch(subsets,rotation_enabled(),normal_strain_enabled(),shear_strain_enabled()));
+    subset_batch_ref_img_ = ref_img_;
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(subset_batch_->num_subsets()!=local_num_subsets_,std::runtime_error,
+    "Error, the subset batch is the wrong size");
+  // same initial guess as the Field_Value_Initializer
+  subset_batch_->clear();
+  int_t num_batched = 0;
+  for(int_t lid=0;lid<local_num_subsets_;++lid){
+    const int_t subset_gid = subset_global_id(lid);
+    if(objs[lid]==Teuchos::null||global_field_value(subset_gid,SIGMA_FS)==-1.0) continue;
+    if(force_simplex_!=Teuchos::null&&force_simplex_->find(subset_gid)!=force_simplex_->end()) continue;
+    Teuchos::RCP<Local_Shape_Function> shape_function = shape_function_factory(this);
+    shape_function->initialize_parameters_from_fields(this,subset_gid);
+    subset_batch_->set_initial_parameters(lid,*shape_function->rcp());
+    num_batched++;
+  }
+  DEBUG_MSG("Schema::prepare_batched_solve(): solving " << num_batched << " subsets in the batch");
+  if(num_batched==0) return;
+  subset_batch_->solve(def_imgs_[0],interpolation_method_,fast_solver_tolerance_,max_solver_iterations_fast_,
+    use_objective_regularization() ? levenberg_marquardt_regularization_factor() : 0.0);
+  subset_batch_solved_ = true;
+#endif
+}
+
+bool
+Schema::apply_batched_solution(Teuchos::RCP<Objective> obj,
+  Teuchos::RCP<Local_Shape_Function> shape_function,
+  Status_Flag & status,
+  int_t & num_iterations){
+#if DICE_KOKKOS
+  if(!subset_batch_solved_||subset_batch_==Teuchos::null) return false;
+  const int_t subset_gid = obj->correlation_point_global_id();
+  const int_t lid = subset_local_id(subset_gid);
+  if(lid<0||!subset_batch_->solved(lid)) return false;
+  // failed solves are repeated on the host so the failure handling is the same as without the batch
+  if(subset_batch_->status(lid)!=CORRELATION_SUCCESSFUL) return false;
+  if(!subset_batch_->initial_parameters_match(lid,*shape_function->rcp())) return false;
+  std::vector<scalar_t> params;
+  subset_batch_->parameters(lid,params);
+  global_field_value(subset_gid,CONDITION_NUMBER_FS) = subset_batch_->condition_number(lid);
+  num_iterations = subset_batch_->num_iterations(lid);
+  status = obj->acceptConvergedSolution(shape_function,params);
+  DEBUG_MSG("Subset " << subset_gid << " using the batched device solution (" << num_iterations << " iterations)");
+  return true;
+#else
+  return false;
+#endif
+}
+
 void
 Schema::save_cross_correlation_fields(){
   Teuchos::RCP<MultiField> ux = mesh_->get_field(SUBSET_DISPLACEMENT_X_FS);
@@ -1562,13 +3217,247 @@ Schema::save_cross_correlation_fields(){
   fclose(filePtr);
 }
 
+namespace {
+
+const static char cross_correlation_cache_magic[8] = {'D','I','C','e','_','X','C','C'};
+
+/// file name of the cache for this processor
+std::string
+cross_correlation_cache_file_name(const std::string & file_name,
+  const int_t num_procs,
+  const int_t proc_rank){
+  if(num_procs==1) return file_name;
+  std::stringstream name;
+  name << file_name << "." << num_procs << "." << proc_rank;
+  return name.str();
+}
+
+}
+
+std::uint64_t
+Schema::cross_correlation_cache_key(Teuchos::RCP<Triangulation> tri,
+  const Teuchos::RCP<Teuchos::ParameterList> & input_params){
+  TEUCHOS_TEST_FOR_EXCEPTION(tri==Teuchos::null,std::runtime_error,"Error, triangulation is null");
+  std::uint64_t hash = 14695981039346656037ULL;
+  // the reference images are loaded the same way initialize_cross_correlation() loads them
+  std::vector<std::string> image_files;
+  std::vector<std::string> stereo_image_files;
+  DICe::decipher_image_file_names(input_params,image_files,stereo_image_files);
+  TEUCHOS_TEST_FOR_EXCEPTION(image_files.empty()||stereo_image_files.empty(),std::runtime_error,
+    "Error, the left and right reference images are needed for the cross-correlation cache key");
+  Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
+  imgParams->set(DICe::gauss_filter_images,gauss_filter_images_);
+  imgParams->set(DICe::gauss_filter_mask_size,gauss_filter_mask_size_);
+  imgParams->set(DICe::num_threads,num_threads_);
+  for(int_t i=0;i<2;++i){
+    Teuchos::RCP<Image> img = Teuchos::rcp(new Image(i==0 ? image_files[0].c_str() : stereo_image_files[0].c_str(),imgParams));
+    const int_t dims[2] = {img->width(),img->height()};
+    hash = fnv1a_hash(dims,sizeof(dims),hash);
+    hash = fnv1a_hash(img->intensities().getRawPtr(),img->width()*img->height()*sizeof(intensity_t),hash);
+  }
+  const std::vector<std::vector<scalar_t> > * cal[2] = {tri->cal_intrinsics(),tri->cal_extrinsics()};
+  for(int_t c=0;c<2;++c)
+    for(size_t i=0;i<cal[c]->size();++i)
+      hash = fnv1a_hash((*cal[c])[i].data(),(*cal[c])[i].size()*sizeof(scalar_t),hash);
+  const int_t settings[3] = {subset_dim_,use_nonlinear_projection_ ? 1 : 0,local_num_subsets_};
+  hash = fnv1a_hash(settings,sizeof(settings),hash);
+  for(int_t i=0;i<local_num_subsets_;++i){
+    const int_t gid = subset_global_id(i);
+    const scalar_t coords[2] = {local_field_value(i,SUBSET_COORDINATES_X_FS),local_field_value(i,SUBSET_COORDINATES_Y_FS)};
+    hash = fnv1a_hash(&gid,sizeof(gid),hash);
+    hash = fnv1a_hash(coords,sizeof(coords),hash);
+  }
+  DEBUG_MSG("Schema::cross_correlation_cache_key(): key " << hash);
+  return hash;
+}
+
+void
+Schema::write_cross_correlation_cache(const std::string & file_name,
+  const std::uint64_t key,
+  Teuchos::RCP<Triangulation> tri){
+  TEUCHOS_TEST_FOR_EXCEPTION(tri==Teuchos::null,std::runtime_error,"Error, triangulation is null");
+  const std::string name = cross_correlation_cache_file_name(file_name,comm_->get_size(),comm_->get_rank());
+  DEBUG_MSG("Schema::write_cross_correlation_cache(): writing " << name);
+  std::FILE * filePtr = fopen(name.c_str(),"wb");
+  TEUCHOS_TEST_FOR_EXCEPTION(filePtr==NULL,std::runtime_error,"Error, could not open cross-correlation cache file " << name);
+  const std::vector<scalar_t> & proj = *tri->projective_params();
+  const std::vector<scalar_t> & warp = *tri->warp_params();
+  const int32_t sizes[4] = {(int32_t)sizeof(scalar_t),(int32_t)proj.size(),(int32_t)warp.size(),(int32_t)local_num_subsets_};
+  fwrite(cross_correlation_cache_magic,1,sizeof(cross_correlation_cache_magic),filePtr);
+  fwrite(&key,sizeof(std::uint64_t),1,filePtr);
+  fwrite(sizes,sizeof(int32_t),4,filePtr);
+  fwrite(proj.data(),sizeof(scalar_t),proj.size(),filePtr);
+  fwrite(warp.data(),sizeof(scalar_t),warp.size(),filePtr);
+  for(int_t i=0;i<local_num_subsets_;++i){
+    const int32_t gid = subset_global_id(i);
+    const scalar_t values[6] = {local_field_value(i,SUBSET_DISPLACEMENT_X_FS),local_field_value(i,SUBSET_DISPLACEMENT_Y_FS),
+      local_field_value(i,SIGMA_FS),local_field_value(i,GAMMA_FS),
+      mesh_->get_field(PROJECTION_AUG_X_FS)->local_value(i),mesh_->get_field(PROJECTION_AUG_Y_FS)->local_value(i)};
+    fwrite(&gid,sizeof(int32_t),1,filePtr);
+    fwrite(values,sizeof(scalar_t),6,filePtr);
+  }
+  fclose(filePtr);
+}
+
+bool
+Schema::read_cross_correlation_cache(const std::string & file_name,
+  const std::uint64_t key,
+  Teuchos::RCP<Triangulation> tri){
+  TEUCHOS_TEST_FOR_EXCEPTION(tri==Teuchos::null,std::runtime_error,"Error, triangulation is null");
+  const std::string name = cross_correlation_cache_file_name(file_name,comm_->get_size(),comm_->get_rank());
+  std::FILE * filePtr = fopen(name.c_str(),"rb");
+  if(filePtr==NULL){
+    DEBUG_MSG("Schema::read_cross_correlation_cache(): no cache file " << name);
+    return false;
+  }
+  char magic[sizeof(cross_correlation_cache_magic)];
+  std::uint64_t file_key = 0;
+  int32_t sizes[4] = {0,0,0,0};
+  bool valid = fread(magic,1,sizeof(magic),filePtr)==sizeof(magic) && std::memcmp(magic,cross_correlation_cache_magic,sizeof(magic))==0;
+  valid = valid && fread(&file_key,sizeof(std::uint64_t),1,filePtr)==1 && file_key==key;
+  valid = valid && fread(sizes,sizeof(int32_t),4,filePtr)==4;
+  valid = valid && sizes[0]==(int32_t)sizeof(scalar_t) && sizes[1]==9 && sizes[2]==12 && sizes[3]==(int32_t)local_num_subsets_;
+  Teuchos::RCP<std::vector<scalar_t> > proj_params = Teuchos::rcp(new std::vector<scalar_t>(9,0.0));
+  Teuchos::RCP<std::vector<scalar_t> > warp_params = Teuchos::rcp(new std::vector<scalar_t>(12,0.0));
+  valid = valid && fread(proj_params->data(),sizeof(scalar_t),9,filePtr)==9;
+  valid = valid && fread(warp_params->data(),sizeof(scalar_t),12,filePtr)==12;
+  std::vector<int32_t> gids(valid ? local_num_subsets_ : 0);
+  std::vector<scalar_t> values(gids.size()*6);
+  for(size_t i=0;i<gids.size()&&valid;++i){
+    valid = fread(&gids[i],sizeof(int32_t),1,filePtr)==1 && gids[i]==subset_global_id(i);
+    valid = valid && fread(&values[i*6],sizeof(scalar_t),6,filePtr)==6;
+  }
+  fclose(filePtr);
+  if(!valid){
+    DEBUG_MSG("Schema::read_cross_correlation_cache(): " << name << " does not match this analysis, the cross-correlation will be recomputed");
+    return false;
+  }
+  DEBUG_MSG("Schema::read_cross_correlation_cache(): reusing the cross-correlation from " << name);
+  tri->set_projective_params(proj_params);
+  tri->set_warp_params(warp_params);
+  Teuchos::RCP<MultiField> proj_aug_x = mesh_->get_field(PROJECTION_AUG_X_FS);
+  Teuchos::RCP<MultiField> proj_aug_y = mesh_->get_field(PROJECTION_AUG_Y_FS);
+  for(int_t i=0;i<local_num_subsets_;++i){
+    local_field_value(i,SUBSET_DISPLACEMENT_X_FS) = values[i*6+0];
+    local_field_value(i,SUBSET_DISPLACEMENT_Y_FS) = values[i*6+1];
+    local_field_value(i,SIGMA_FS) = values[i*6+2];
+    local_field_value(i,GAMMA_FS) = values[i*6+3];
+    proj_aug_x->local_value(i) = values[i*6+4];
+    proj_aug_y->local_value(i) = values[i*6+5];
+  }
+  return true;
+}
+
+namespace {
+/// identifies a correlation state checkpoint file
+const static char checkpoint_magic[8] = {'D','I','C','e','_','C','K','P'};
+}
+
+void
+Schema::write_checkpoint(const std::string & file_name,
+  const int_t frame_index){
+  TEUCHOS_TEST_FOR_EXCEPTION(analysis_type_==GLOBAL_DIC,std::runtime_error,"Error, checkpoints are not enabled for global DIC");
+  const std::string name = cross_correlation_cache_file_name(file_name,comm_->get_size(),comm_->get_rank());
+  DEBUG_MSG("Schema::write_checkpoint(): writing " << name << " after frame " << frame_index);
+  // write to a temporary file first so that an interrupted write never replaces the last good checkpoint
+  const std::string tmp_name = name + ".tmp";
+  std::FILE * filePtr = fopen(tmp_name.c_str(),"wb");
+  TEUCHOS_TEST_FOR_EXCEPTION(filePtr==NULL,std::runtime_error,"Error, could not open checkpoint file " << tmp_name);
+  const int32_t sizes[3] = {(int32_t)sizeof(int_t),(int32_t)sizeof(scalar_t),(int32_t)local_num_subsets_};
+  fwrite(checkpoint_magic,1,sizeof(checkpoint_magic),filePtr);
+  fwrite(sizes,sizeof(int32_t),3,filePtr);
+  const int_t frame_info[2] = {frame_index,frame_id_};
+  fwrite(frame_info,sizeof(int_t),2,filePtr);
+  for(int_t i=0;i<local_num_subsets_;++i){
+    const int_t gid = subset_global_id(i);
+    fwrite(&gid,sizeof(int_t),1,filePtr);
+  }
+  // every field with its state so the previous (n) states of the multi-state fields are kept too
+  const DICe::mesh::field_registry * registry = mesh_->get_field_registry();
+  const int_t num_fields = registry->size();
+  fwrite(&num_fields,sizeof(int_t),1,filePtr);
+  for(DICe::mesh::field_registry::const_iterator it=registry->begin();it!=registry->end();++it){
+    const std::string label = it->first.get_name_label();
+    const int_t num_values = it->second->get_map()->get_num_local_elements();
+    const int_t header[4] = {(int_t)label.size(),(int_t)it->first.get_state(),it->second->get_num_fields(),num_values};
+    fwrite(header,sizeof(int_t),4,filePtr);
+    fwrite(label.c_str(),1,label.size(),filePtr);
+    for(int_t j=0;j<header[2]&&num_values>0;++j)
+      fwrite(it->second->local_values(j),sizeof(scalar_t),num_values,filePtr);
+  }
+  stat_container_->write_checkpoint(filePtr);
+  const bool write_error = ferror(filePtr)!=0;
+  fclose(filePtr);
+  TEUCHOS_TEST_FOR_EXCEPTION(write_error,std::runtime_error,"Error, could not write checkpoint file " << tmp_name);
+  std::remove(name.c_str());
+  TEUCHOS_TEST_FOR_EXCEPTION(std::rename(tmp_name.c_str(),name.c_str())!=0,std::runtime_error,
+    "Error, could not rename checkpoint file " << tmp_name << " to " << name);
+}
+
+int_t
+Schema::read_checkpoint(const std::string & file_name){
+  TEUCHOS_TEST_FOR_EXCEPTION(analysis_type_==GLOBAL_DIC,std::runtime_error,"Error, checkpoints are not enabled for global DIC");
+  const std::string name = cross_correlation_cache_file_name(file_name,comm_->get_size(),comm_->get_rank());
+  DEBUG_MSG("Schema::read_checkpoint(): reading " << name);
+  std::FILE * filePtr = fopen(name.c_str(),"rb");
+  TEUCHOS_TEST_FOR_EXCEPTION(filePtr==NULL,std::runtime_error,"Error, could not open checkpoint file " << name);
+  char magic[sizeof(checkpoint_magic)];
+  int32_t sizes[3] = {0,0,0};
+  bool valid = fread(magic,1,sizeof(magic),filePtr)==sizeof(magic) && std::memcmp(magic,checkpoint_magic,sizeof(magic))==0;
+  valid = valid && fread(sizes,sizeof(int32_t),3,filePtr)==3;
+  valid = valid && sizes[0]==(int32_t)sizeof(int_t) && sizes[1]==(int32_t)sizeof(scalar_t) && sizes[2]==(int32_t)local_num_subsets_;
+  int_t frame_info[2] = {-1,0};
+  valid = valid && fread(frame_info,sizeof(int_t),2,filePtr)==2;
+  for(int_t i=0;i<local_num_subsets_&&valid;++i){
+    int_t gid = -1;
+    valid = fread(&gid,sizeof(int_t),1,filePtr)==1 && gid==subset_global_id(i);
+  }
+  if(!valid){
+    fclose(filePtr);
+    TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, checkpoint file " << name <<
+      " is invalid or was written for a different set of subsets or number of processors");
+  }
+  int_t num_fields = 0;
+  valid = fread(&num_fields,sizeof(int_t),1,filePtr)==1;
+  DICe::mesh::field_registry * registry = mesh_->get_field_registry();
+  std::string error_msg = "the file is truncated";
+  for(int_t field_it=0;field_it<num_fields&&valid;++field_it){
+    int_t header[4] = {0,0,0,0};
+    valid = fread(header,sizeof(int_t),4,filePtr)==4 && header[0]>=0;
+    std::string label(valid ? header[0] : 0,' ');
+    valid = valid && (header[0]==0||fread(&label[0],1,header[0],filePtr)==(size_t)header[0]);
+    if(!valid) break;
+    DICe::mesh::field_registry::iterator reg_it = registry->begin();
+    for(;reg_it!=registry->end();++reg_it)
+      if(reg_it->first.get_name_label()==label&&(int_t)reg_it->first.get_state()==header[1]) break;
+    if(reg_it==registry->end()||reg_it->second->get_num_fields()!=header[2]||
+        reg_it->second->get_map()->get_num_local_elements()!=header[3]){
+      error_msg = "field " + label + " does not match this analysis";
+      valid = false;
+      break;
+    }
+    for(int_t j=0;j<header[2]&&header[3]>0&&valid;++j)
+      valid = fread(reg_it->second->local_values(j),sizeof(scalar_t),header[3],filePtr)==(size_t)header[3];
+  }
+  valid = valid && stat_container_->read_checkpoint(filePtr);
+  fclose(filePtr);
+  TEUCHOS_TEST_FOR_EXCEPTION(!valid,std::runtime_error,"Error, could not read checkpoint file " << name << ", " << error_msg);
+  frame_id_ = frame_info[1];
+  DEBUG_MSG("Schema::read_checkpoint(): restored the state after frame " << frame_info[0] << ", frame id " << frame_id_);
+  return frame_info[0];
+}
+
 
 void
 Schema::execute_post_processors(){
+  Scoped_Profile_Timer post_timer(PROFILE_POST_PROCESS);
   // compute post-processed quantities
   for(size_t i=0;i<post_processors_.size();++i){
     post_processors_[i]->execute();
   }
+  // the exchanged overlap fields are only valid for this frame
+  if(mesh_!=Teuchos::null)
+    mesh_->clear_exchanged_overlap_fields();
   DEBUG_MSG("[PROC " << comm_->get_rank() << "] post processing complete");
 }
 
@@ -1597,7 +3486,12 @@ Schema::prepare_optimization_initializers(){
   }
   else if(initialization_method_==USE_FEATURE_MATCHING){
     DEBUG_MSG("Default initializer is feature matching initializer");
-    default_initializer = Teuchos::rcp(new Feature_Matching_Initializer(this));
+    default_initializer = Teuchos::rcp(new Feature_Matching_Initializer(this,feature_matcher_,output_feature_matching_image_,
+      feature_tile_size_,max_features_per_tile_));
+  }
+  else if(initialization_method_==USE_WINDOWED_PHASE_CORRELATION){
+    DEBUG_MSG("Default initializer is windowed phase correlation initializer");
+    default_initializer = Teuchos::rcp(new Windowed_Phase_Correlation_Initializer(this,phase_correlation_window_size_));
   }
   else if(initialization_method_==USE_OPTICAL_FLOW){
     // make syre tga the correlation routine is tracking routine
@@ -1675,7 +3569,8 @@ Schema::motion_detected(const int_t subset_gid){
       // create the motion detector because it doesn't exist
       DEBUG_MSG("Creating a motion test utility for subset " << subset_gid << " using id " << use_subset_id);
       Motion_Window_Params mwp = motion_window_params_->find(use_subset_id)->second;
-      motion_detectors_.insert(std::pair<int_t,Teuchos::RCP<Motion_Test_Utility> >(use_subset_id,Teuchos::rcp(new Motion_Test_Utility(this,mwp.tol_))));
+      motion_detectors_.insert(std::pair<int_t,Teuchos::RCP<Motion_Test_Utility> >(use_subset_id,Teuchos::rcp(new Motion_Test_Utility(this,mwp.tol_,motion_window_sample_stride_,
+        mwp.start_x_,mwp.start_y_,mwp.end_x_,mwp.end_y_))));
     }
     TEUCHOS_TEST_FOR_EXCEPTION(motion_detectors_.find(use_subset_id)==motion_detectors_.end(),std::runtime_error,
       "Error, the motion detector should exist here, but it doesn't.");
@@ -1690,21 +3585,56 @@ Schema::motion_detected(const int_t subset_gid){
   }
 }
 
+bool
+Schema::rejected_for_low_contrast(Teuchos::RCP<Objective> obj){
+  if(low_contrast_threshold_<=0.0&&low_sssig_threshold_<=0.0) return false;
+  const int_t subset_lid = subset_local_id(obj->correlation_point_global_id());
+  if(subset_lid<0||subset_lid>=(int_t)low_contrast_rejected_.size()) return false;
+  // the result of the last check is reused until the interval has passed
+  if(low_contrast_rejected_[subset_lid]!=-1&&frame_id_-low_contrast_check_frame_[subset_lid]<low_contrast_recheck_interval_)
+    return low_contrast_rejected_[subset_lid]==1;
+  Teuchos::RCP<Subset> subset = obj->subset();
+  bool rejected = false;
+  if(low_contrast_threshold_>0.0){
+    scalar_t sum = 0.0;
+    subset->mean(REF_INTENSITIES,sum);
+    const int_t num_active = subset->num_active_pixels();
+    // sum is the square root of the sum of the squared differences from the mean
+    const scalar_t std_dev = num_active==0 ? 0.0 : sum/std::sqrt((scalar_t)num_active);
+    rejected = std_dev < low_contrast_threshold_;
+    DEBUG_MSG("Subset " << obj->correlation_point_global_id() << " reference intensity std dev: " << std_dev);
+  }
+  if(!rejected&&low_sssig_threshold_>0.0&&subset->has_gradients()){
+    const scalar_t sssig = subset->sssig();
+    rejected = sssig < low_sssig_threshold_;
+    DEBUG_MSG("Subset " << obj->correlation_point_global_id() << " SSSIG: " << sssig);
+  }
+  low_contrast_check_frame_[subset_lid] = frame_id_;
+  low_contrast_rejected_[subset_lid] = rejected ? 1 : 0;
+  return rejected;
+}
+
 void
 Schema::record_failed_step(const int_t subset_gid,
   const int_t status,
   const int_t num_iterations){
   DEBUG_MSG("Subset " << subset_gid << " record failed step");
-  global_field_value(subset_gid,SIGMA_FS) = -1.0;
-  global_field_value(subset_gid,MATCH_FS) = -1.0;
-  global_field_value(subset_gid,GAMMA_FS) = -1.0;
-  global_field_value(subset_gid,BETA_FS) = -1.0;
-  global_field_value(subset_gid,OMEGA_FS) = -1.0;
-  global_field_value(subset_gid,NOISE_LEVEL_FS) = -1.0;
-  global_field_value(subset_gid,CONTRAST_LEVEL_FS) = -1.0;
-  global_field_value(subset_gid,ACTIVE_PIXELS_FS) = -1.0;
-  global_field_value(subset_gid,STATUS_FLAG_FS) = status;
-  global_field_value(subset_gid,ITERATIONS_FS) = num_iterations;
+  const int_t subset_lid = subset_local_id(subset_gid);
+  local_field_value(subset_lid,SIGMA_FS) = -1.0;
+  local_field_value(subset_lid,MATCH_FS) = -1.0;
+  local_field_value(subset_lid,GAMMA_FS) = -1.0;
+  local_field_value(subset_lid,BETA_FS) = -1.0;
+  local_field_value(subset_lid,OMEGA_FS) = -1.0;
+  local_field_value(subset_lid,NOISE_LEVEL_FS) = -1.0;
+  local_field_value(subset_lid,CONTRAST_LEVEL_FS) = -1.0;
+  local_field_value(subset_lid,ACTIVE_PIXELS_FS) = -1.0;
+  local_field_value(subset_lid,STATUS_FLAG_FS) = status;
+  local_field_value(subset_lid,ITERATIONS_FS) = num_iterations;
+  // a failed step breaks the motion history, the prediction starts over from the next solution
+  if(subset_lid<(int_t)motion_history_size_.size()){
+    motion_history_size_[subset_lid] = 0;
+    motion_history_next_[subset_lid] = 0;
+  }
 }
 
 void
@@ -1721,21 +3651,103 @@ Schema::record_step(Teuchos::RCP<Objective> obj,
   const int_t num_iterations){
   const int_t subset_gid = obj->correlation_point_global_id();
   DEBUG_MSG("Subset " << subset_gid << " record step");
+  const int_t subset_lid = subset_local_id(subset_gid);
+  // the status is reported on the span of the subset being correlated
+  if(Trace_Recorder::enabled())
+    Trace_Recorder::set_status(status);
   shape_function->save_fields(this,subset_gid);
-  global_field_value(subset_gid,SIGMA_FS) = sigma;
-  global_field_value(subset_gid,MATCH_FS) = match; // 0 means data is successful
-  global_field_value(subset_gid,GAMMA_FS) = gamma;
-  global_field_value(subset_gid,BETA_FS) = beta;
-  global_field_value(subset_gid,NOISE_LEVEL_FS) = noise;
-  global_field_value(subset_gid,CONTRAST_LEVEL_FS) = contrast;
-  global_field_value(subset_gid,ACTIVE_PIXELS_FS) = active_pixels;
-  global_field_value(subset_gid,STATUS_FLAG_FS) = status;
-  global_field_value(subset_gid,ITERATIONS_FS) = num_iterations;
+  local_field_value(subset_lid,SIGMA_FS) = sigma;
+  local_field_value(subset_lid,MATCH_FS) = match; // 0 means data is successful
+  local_field_value(subset_lid,GAMMA_FS) = gamma;
+  local_field_value(subset_lid,BETA_FS) = beta;
+  local_field_value(subset_lid,NOISE_LEVEL_FS) = noise;
+  local_field_value(subset_lid,CONTRAST_LEVEL_FS) = contrast;
+  local_field_value(subset_lid,ACTIVE_PIXELS_FS) = active_pixels;
+  local_field_value(subset_lid,STATUS_FLAG_FS) = status;
+  local_field_value(subset_lid,ITERATIONS_FS) = num_iterations;
+  if(projection_method_==POLYNOMIAL_BASED) record_motion_history(subset_gid);
+}
+
+void
+Schema::record_motion_history(const int_t global_id){
+  const int_t local_id = subset_local_id(global_id);
+  if(local_id<0||local_id>=(int_t)motion_history_size_.size()) return;
+  int_t & size = motion_history_size_[local_id];
+  int_t & next = motion_history_next_[local_id];
+  int_t slot = local_id*motion_history_depth + next;
+  // a subset correlated more than once in the same frame replaces its latest entry
+  if(size>0){
+    const int_t last = local_id*motion_history_depth + (next+motion_history_depth-1)%motion_history_depth;
+    if(motion_history_frames_[last]==frame_id_)
+      slot = last;
+  }
+  if(slot==local_id*motion_history_depth + next){
+    next = (next+1)%motion_history_depth;
+    if(size<motion_history_depth) size++;
+  }
+  motion_history_frames_[slot] = frame_id_;
+  motion_history_[slot*3+0] = local_field_value(local_id,SUBSET_DISPLACEMENT_X_FS);
+  motion_history_[slot*3+1] = local_field_value(local_id,SUBSET_DISPLACEMENT_Y_FS);
+  motion_history_[slot*3+2] = local_field_value(local_id,ROTATION_Z_FS);
+}
+
+bool
+Schema::predict_motion(const int_t global_id,
+  scalar_t & u,
+  scalar_t & v,
+  scalar_t & theta)const{
+  const int_t local_id = subset_local_id(global_id);
+  if(local_id<0||local_id>=(int_t)motion_history_size_.size()) return false;
+  const int_t num_entries = motion_history_size_[local_id];
+  if(num_entries==0) return false;
+  // normal equations for the polynomial coefficients (constant, velocity, acceleration) with the
+  // frame offset from the current frame as the variable, one right hand side each for u, v, and theta
+  const int_t num_coeffs = num_entries > 2 ? 3 : num_entries;
+  double lhs[3][3] = {{0.0,0.0,0.0},{0.0,0.0,0.0},{0.0,0.0,0.0}};
+  double rhs[3][3] = {{0.0,0.0,0.0},{0.0,0.0,0.0},{0.0,0.0,0.0}};
+  for(int_t k=0;k<num_entries;++k){
+    const int_t slot = local_id*motion_history_depth + k;
+    const double offset = motion_history_frames_[slot] - frame_id_;
+    const double basis[3] = {1.0,offset,offset*offset};
+    for(int_t i=0;i<num_coeffs;++i){
+      for(int_t j=0;j<num_coeffs;++j)
+        lhs[i][j] += basis[i]*basis[j];
+      for(int_t c=0;c<3;++c)
+        rhs[i][c] += basis[i]*motion_history_[slot*3+c];
+    }
+  }
+  // Gaussian elimination (the frame ids are distinct so the system is only singular if the history is corrupt)
+  for(int_t col=0;col<num_coeffs;++col){
+    if(std::abs(lhs[col][col])<1.0E-12) return false;
+    for(int_t row=col+1;row<num_coeffs;++row){
+      const double factor = lhs[row][col]/lhs[col][col];
+      for(int_t j=col;j<num_coeffs;++j)
+        lhs[row][j] -= factor*lhs[col][j];
+      for(int_t c=0;c<3;++c)
+        rhs[row][c] -= factor*rhs[col][c];
+    }
+  }
+  double coeffs[3][3];
+  for(int_t row=num_coeffs-1;row>=0;--row){
+    for(int_t c=0;c<3;++c){
+      double value = rhs[row][c];
+      for(int_t j=row+1;j<num_coeffs;++j)
+        value -= lhs[row][j]*coeffs[j][c];
+      coeffs[row][c] = value/lhs[row][row];
+    }
+  }
+  // the prediction is the value of the polynomial at the current frame (zero offset)
+  u = coeffs[0][0];
+  v = coeffs[0][1];
+  theta = coeffs[0][2];
+  DEBUG_MSG("Subset " << global_id << " motion predicted from " << num_entries << " frames, u: " << u << " v: " << v << " theta: " << theta);
+  return true;
 }
 
 Status_Flag
 Schema::initial_guess(const int_t subset_gid,
   Teuchos::RCP<Local_Shape_Function> shape_function){
+  Scoped_Profile_Timer guess_timer(PROFILE_INITIAL_GUESS);
   // for non-tracking routines, there is only the zero-th entry in the initializers map
   int_t sid = 0;
   // tracking routine has a different initializer for each subset
@@ -1747,20 +3759,51 @@ Schema::initial_guess(const int_t subset_gid,
   return opt_initializers_.find(sid)->second->initial_guess(subset_gid,shape_function);
 }
 
+namespace {
+/// records the cost of a subset solve in the schema's profile on every exit from the correlation routine
+class Subset_Profile_Sentry{
+public:
+  Subset_Profile_Sentry(Schema * schema,
+    const int_t subset_lid,
+    const int_t & path):
+    schema_(schema),
+    subset_lid_(subset_lid),
+    path_(path),
+    start_(std::chrono::steady_clock::now()){}
+  ~Subset_Profile_Sentry(){
+    const double solve_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    int_t path = path_;
+    // failed steps are recorded with a sigma of -1
+    if(schema_->local_field_value(subset_lid_,SIGMA_FS)==-1.0) path |= FAILED_SOLVE_PATH;
+    schema_->stat_container()->register_subset_solve(subset_lid_,
+      static_cast<int_t>(schema_->local_field_value(subset_lid_,ITERATIONS_FS)),solve_time,path);
+  }
+private:
+  Schema * schema_;
+  const int_t subset_lid_;
+  const int_t & path_;
+  const std::chrono::steady_clock::time_point start_;
+};
+}
+
 void
-Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
+Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj,
+  Teuchos::RCP<Local_Shape_Function> shape_function){
 
   const int_t subset_gid = obj->correlation_point_global_id();
-  TEUCHOS_TEST_FOR_EXCEPTION(subset_local_id(subset_gid)==-1,std::runtime_error,
+  Scoped_Trace_Span span("subset","correlation",subset_gid);
+  // the fields are accessed by local id from here on
+  const int_t subset_lid = subset_local_id(subset_gid);
+  TEUCHOS_TEST_FOR_EXCEPTION(subset_lid==-1,std::runtime_error,
     "Error: subset id is not local to this process.");
-  DEBUG_MSG("[PROC " << comm_->get_rank() << "] SUBSET " << subset_gid << " (" << global_field_value(subset_gid,SUBSET_COORDINATES_X_FS) <<
-    "," << global_field_value(subset_gid,SUBSET_COORDINATES_Y_FS) << ")");
+  DEBUG_MSG("[PROC " << comm_->get_rank() << "] SUBSET " << subset_gid << " (" << local_field_value(subset_lid,SUBSET_COORDINATES_X_FS) <<
+    "," << local_field_value(subset_lid,SUBSET_COORDINATES_Y_FS) << ")");
 
   // if for some reason the coordinates of this subset are outside the image domain, record a failed step,
   // this may have occurred for a subset in the left image projected to the right that is not in the right image
   if(subset_dim_ > 0){
-    const scalar_t current_pos_x = global_field_value(subset_gid,SUBSET_COORDINATES_X_FS) + global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_FS);
-    const scalar_t current_pos_y = global_field_value(subset_gid,SUBSET_COORDINATES_Y_FS) + global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_FS);
+    const scalar_t current_pos_x = local_field_value(subset_lid,SUBSET_COORDINATES_X_FS) + local_field_value(subset_lid,SUBSET_DISPLACEMENT_X_FS);
+    const scalar_t current_pos_y = local_field_value(subset_lid,SUBSET_COORDINATES_Y_FS) + local_field_value(subset_lid,SUBSET_DISPLACEMENT_Y_FS);
     if(current_pos_x < def_imgs_[0]->offset_x()+subset_dim_/2 || current_pos_x > def_imgs_[0]->width()+def_imgs_[0]->offset_x() - subset_dim_/2 ||
         current_pos_y < def_imgs_[0]->offset_y()+subset_dim_/2 || current_pos_y > def_imgs_[0]->height()+def_imgs_[0]->offset_y() - subset_dim_/2){
       DEBUG_MSG("Invalid subset origin (probably from stereo projection of the left subset not being in the right image)" <<
@@ -1772,6 +3815,13 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
     }
   }
 
+  // subsets without enough texture to correlate are not sent to the solvers
+  if(rejected_for_low_contrast(obj)){
+    DEBUG_MSG("Subset " << subset_gid << " rejected due to low contrast");
+    record_failed_step(subset_gid,static_cast<int_t>(SUBSET_REJECTED_DUE_TO_LOW_CONTRAST),0);
+    return;
+  }
+
   // check if the solve should be skipped
   bool skip_frame = false;
   if(skip_solve_flags_->find(subset_gid)!=skip_solve_flags_->end()||skip_all_solves_){
@@ -1791,18 +3841,25 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
   if(!motion){
     DEBUG_MSG("Subset " << subset_gid << " skipping frame due to no motion");
     // only change the match value and the status flag
-    global_field_value(subset_gid,MATCH_FS) = 0.0;
-    global_field_value(subset_gid,STATUS_FLAG_FS) = static_cast<int_t>(FRAME_SKIPPED_DUE_TO_NO_MOTION);
-    global_field_value(subset_gid,ITERATIONS_FS) = 0;
+    local_field_value(subset_lid,MATCH_FS) = 0.0;
+    local_field_value(subset_lid,STATUS_FLAG_FS) = static_cast<int_t>(FRAME_SKIPPED_DUE_TO_NO_MOTION);
+    local_field_value(subset_lid,ITERATIONS_FS) = 0;
     return;
   }
+  // the motion windows are run serially so the first subset that is correlated filters the frame
+  preprocess_def_images();
   //
   //  initial guess for the subset's solution parameters
   //
   Status_Flag init_status = INITIALIZE_SUCCESSFUL;
   Status_Flag corr_status = CORRELATION_FAILED;
   int_t num_iterations = -1;
-  Teuchos::RCP<Local_Shape_Function> shape_function = shape_function_factory(this);
+  int_t solve_path = PRIMARY_SOLVE_PATH;
+  Subset_Profile_Sentry profile_sentry(this,subset_lid,solve_path);
+  if(shape_function==Teuchos::null)
+    shape_function = shape_function_factory(this);
+  else
+    shape_function->clear();
   try{
     init_status = initial_guess(subset_gid,shape_function);
   }
@@ -1817,16 +3874,18 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
     // try again with a search initializer
     if(correlation_routine_==TRACKING_ROUTINE && use_search_initialization_for_failed_steps_){
       stat_container_->register_search_call(subset_gid,frame_id_);
+      solve_path |= SEARCH_INITIALIZATION_PATH;
       // before giving up, try a search initialization, then simplex, then give up if it still can't track:
       const scalar_t search_step_xy = 1.0; // pixels
-      const scalar_t search_dim_xy = 10.0; // pixels
+      const scalar_t search_dim_xy = search_initialization_radius_; // pixels
       const scalar_t search_step_theta = 0.01; // radians (keep theta the same)
       const scalar_t search_dim_theta = 0.0;
       // reset the deformation position to the previous step's value
       shape_function->clear();
-      shape_function->insert_motion(global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_FS),global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_FS),
-        global_field_value(subset_gid,ROTATION_Z_FS));
-      Search_Initializer searcher(this,obj->subset(),search_step_xy,search_dim_xy,search_step_xy,search_dim_xy,search_step_theta,search_dim_theta);
+      shape_function->insert_motion(local_field_value(subset_lid,SUBSET_DISPLACEMENT_X_FS),local_field_value(subset_lid,SUBSET_DISPLACEMENT_Y_FS),
+        local_field_value(subset_lid,ROTATION_Z_FS));
+      Search_Initializer searcher(this,obj->subset(),search_step_xy,search_dim_xy,search_step_xy,search_dim_xy,search_step_theta,search_dim_theta,
+        search_initialization_pyramid_levels_);
       init_status = searcher.initial_guess(subset_gid,shape_function);
     }
     if(init_status==INITIALIZE_FAILED){
@@ -1848,7 +3907,7 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
     const scalar_t initial_sigma = obj->sigma(shape_function,noise_std_dev);
     const scalar_t initial_gamma = obj->gamma(shape_function);
     const scalar_t initial_beta = output_beta_ ? obj->beta(shape_function) : 0.0;
-    const scalar_t contrast = obj->subset()->contrast_std_dev();
+    const scalar_t contrast = compute_contrast_level_ ? obj->subset()->contrast_std_dev() : 0.0;
     const int_t active_pixels = obj->subset()->num_active_pixels();
     record_step(obj,
       shape_function,initial_sigma,0.0,initial_gamma,initial_beta,
@@ -1906,9 +3965,9 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
       }
     } // loop over obstructing subset ids
   } // end !override force simplex
-  const scalar_t prev_u = global_field_value(subset_gid,SUBSET_DISPLACEMENT_X_FS);
-  const scalar_t prev_v = global_field_value(subset_gid,SUBSET_DISPLACEMENT_Y_FS);
-  const scalar_t prev_t = global_field_value(subset_gid,ROTATION_Z_FS);
+  const scalar_t prev_u = local_field_value(subset_lid,SUBSET_DISPLACEMENT_X_FS);
+  const scalar_t prev_v = local_field_value(subset_lid,SUBSET_DISPLACEMENT_Y_FS);
+  const scalar_t prev_t = local_field_value(subset_lid,ROTATION_Z_FS);
   //
   // perform the correlation
   //
@@ -1923,7 +3982,16 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
   else if(optimization_method_==DICe::GRADIENT_BASED||optimization_method_==DICe::GRADIENT_BASED_THEN_SIMPLEX||
       optimization_method_==DICe::GRADIENT_THEN_SEARCH){
     try{
-      corr_status = obj->computeUpdateFast(shape_function,num_iterations);
+      if(!apply_batched_solution(obj,shape_function,corr_status,num_iterations))
+        corr_status = obj->computeUpdateFast(shape_function,num_iterations);
+    }
+    catch (std::logic_error &err) { //a non-graceful exception occurred
+      corr_status = CORRELATION_FAILED_BY_EXCEPTION;
+    };
+  }
+  else if(optimization_method_==DICe::INVERSE_COMPOSITIONAL||optimization_method_==DICe::INVERSE_COMPOSITIONAL_THEN_SIMPLEX){
+    try{
+      corr_status = obj->computeUpdateInverseCompositional(shape_function,num_iterations);
     }
     catch (std::logic_error &err) { //a non-graceful exception occurred
       corr_status = CORRELATION_FAILED_BY_EXCEPTION;
@@ -1935,7 +4003,7 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
   // test for jump failure (too high displacement or rotation from last step due to subset getting lost)
   bool jump_pass = true;
   scalar_t new_u = 0.0,new_v = 0.0, new_t = 0.0;
-  shape_function->map_to_u_v_theta(global_field_value(subset_gid,SUBSET_COORDINATES_X_FS),global_field_value(subset_gid,SUBSET_COORDINATES_Y_FS),
+  shape_function->map_to_u_v_theta(local_field_value(subset_lid,SUBSET_COORDINATES_X_FS),local_field_value(subset_lid,SUBSET_COORDINATES_Y_FS),
     new_u,new_v,new_t);
   scalar_t diffU = new_u - prev_u;
   scalar_t diffV = new_v - prev_v;
@@ -1948,14 +4016,17 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
   DEBUG_MSG("Subset " << subset_gid << " jump pass: " << jump_pass);
   if(corr_status!=CORRELATION_SUCCESSFUL||!jump_pass){
     bool second_attempt_failed = false;
-    if(optimization_method_==DICe::SIMPLEX||optimization_method_==DICe::GRADIENT_BASED||force_simplex){
+    if(optimization_method_==DICe::SIMPLEX||optimization_method_==DICe::GRADIENT_BASED||
+        optimization_method_==DICe::INVERSE_COMPOSITIONAL||force_simplex){
       second_attempt_failed = true;
     }
-    else if(optimization_method_==DICe::GRADIENT_BASED_THEN_SIMPLEX||optimization_method_==DICe::GRADIENT_THEN_SEARCH){
+    else if(optimization_method_==DICe::GRADIENT_BASED_THEN_SIMPLEX||optimization_method_==DICe::GRADIENT_THEN_SEARCH||
+        optimization_method_==DICe::INVERSE_COMPOSITIONAL_THEN_SIMPLEX){
       if(correlation_routine_==TRACKING_ROUTINE) stat_container_->register_backup_opt_call(subset_gid,frame_id_);
+      solve_path |= BACKUP_OPTIMIZATION_PATH;
       // try again using simplex
       init_status = initial_guess(subset_gid,shape_function);
-      if(optimization_method_==DICe::GRADIENT_BASED_THEN_SIMPLEX){
+      if(optimization_method_==DICe::GRADIENT_BASED_THEN_SIMPLEX||optimization_method_==DICe::INVERSE_COMPOSITIONAL_THEN_SIMPLEX){
         try{
           corr_status = obj->computeUpdateRobust(shape_function,num_iterations);
         }
@@ -1967,10 +4038,10 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
         // search farther in x because we assume that the cross correlation is between two cameras with the same y
         const scalar_t search_step_u = 1.0; // pixels
         const scalar_t search_dim_u = 50.0; // pixels
-        Search_Initializer searcher(this,obj->subset(),search_step_u,search_dim_u,-1.0,0.0,-1.0,0.0);
+        Search_Initializer searcher(this,obj->subset(),search_step_u,search_dim_u,-1.0,0.0,-1.0,0.0,search_initialization_pyramid_levels_);
         init_status = searcher.initial_guess(subset_gid,shape_function);
         scalar_t min_u = 0.0,min_v = 0.0, min_t = 0.0;
-        shape_function->map_to_u_v_theta(global_field_value(subset_gid,SUBSET_COORDINATES_X_FS),global_field_value(subset_gid,SUBSET_COORDINATES_Y_FS),
+        shape_function->map_to_u_v_theta(local_field_value(subset_lid,SUBSET_COORDINATES_X_FS),local_field_value(subset_lid,SUBSET_COORDINATES_Y_FS),
           min_u,min_v,min_t);
         DEBUG_MSG("Subset " << subset_gid << " GRADIENT_THEN_SEARCH method used, search-based initial u: " << min_u);// << " v: " << min_v);
         try{
@@ -1985,6 +4056,7 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
     }
     else if(optimization_method_==DICe::SIMPLEX_THEN_GRADIENT_BASED){
       if(correlation_routine_==TRACKING_ROUTINE) stat_container_->register_backup_opt_call(subset_gid,frame_id_);
+      solve_path |= BACKUP_OPTIMIZATION_PATH;
       // try again using gradient based
       init_status = initial_guess(subset_gid,shape_function);
       try{
@@ -2036,7 +4108,7 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
     Teuchos::RCP<Path_Initializer> path_initializer =
         Teuchos::rcp_dynamic_cast<Path_Initializer>(opt_initializers_.find(subset_gid)->second);
     scalar_t pt_u = 0.0,pt_v = 0.0,pt_t=0.0;
-    shape_function->map_to_u_v_theta(global_field_value(subset_gid,SUBSET_COORDINATES_X_FS),global_field_value(subset_gid,SUBSET_COORDINATES_Y_FS),
+    shape_function->map_to_u_v_theta(local_field_value(subset_lid,SUBSET_COORDINATES_X_FS),local_field_value(subset_lid,SUBSET_COORDINATES_Y_FS),
       pt_u,pt_v,pt_t);
     path_initializer->closest_triad(pt_u,pt_v,pt_t,id,path_distance);
     DEBUG_MSG("Subset " << subset_gid << " path distance: " << path_distance);
@@ -2052,7 +4124,7 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
   //  Test jumps again
   //
   new_u = 0.0;new_v = 0.0;new_t = 0.0;
-  shape_function->map_to_u_v_theta(global_field_value(subset_gid,SUBSET_COORDINATES_X_FS),global_field_value(subset_gid,SUBSET_COORDINATES_Y_FS),
+  shape_function->map_to_u_v_theta(local_field_value(subset_lid,SUBSET_COORDINATES_X_FS),local_field_value(subset_lid,SUBSET_COORDINATES_Y_FS),
     new_u,new_v,new_t);
   diffU = new_u - prev_u;
   diffV = new_v - prev_v;
@@ -2069,7 +4141,7 @@ Schema::generic_correlation_routine(Teuchos::RCP<Objective> obj){
   // SUCCESS
   //
   if(projection_method_==VELOCITY_BASED) save_off_fields(subset_gid);
-  const scalar_t contrast = obj->subset()->contrast_std_dev();
+  const scalar_t contrast = compute_contrast_level_ ? obj->subset()->contrast_std_dev() : 0.0;
   const int_t active_pixels = obj->subset()->num_active_pixels();
   record_step(obj,
     shape_function,sigma,0.0,gamma,beta,noise_std_dev,contrast,active_pixels,
@@ -2171,6 +4243,7 @@ Schema::estimate_resolution_error(const Teuchos::RCP<Teuchos::ParameterList> & c
   const scalar_t amp_step = correlation_params->get<scalar_t>(DICe::estimate_resolution_error_amplitude_step,0.5);
   const scalar_t speckle_size = correlation_params->get<scalar_t>(DICe::estimate_resolution_error_speckle_size,-1.0);
   const scalar_t noise_percent = correlation_params->get<scalar_t>(DICe::estimate_resolution_error_noise_percent,-1.0);
+  const scalar_t max_error = correlation_params->get<scalar_t>(DICe::estimate_resolution_error_max_error,-1.0);
 
   // the full image width and height must be set
   TEUCHOS_TEST_FOR_EXCEPTION(full_ref_img_width_<=0||full_ref_img_height_<=0,std::runtime_error,"");
@@ -2216,6 +4289,7 @@ Schema::estimate_resolution_error(const Teuchos::RCP<Teuchos::ParameterList> & c
     DEBUG_MSG("amplitude step:            " << amp_step << " pixels");
     DEBUG_MSG("speckle size:              " << speckle_size << " pixels (negative means not specified)");
     DEBUG_MSG("noise level:               " << noise_percent << "% of 255 counts (negative means not specified)");
+    DEBUG_MSG("max error:                 " << max_error << "% (negative means the full sweep is run)");
     DEBUG_MSG("****************************************************************");
   }
   TEUCHOS_TEST_FOR_EXCEPTION(min_period <= 0.0,std::runtime_error,"");
@@ -2288,7 +4362,7 @@ Schema::estimate_resolution_error(const Teuchos::RCP<Teuchos::ParameterList> & c
     imgParams->set(DICe::compute_image_gradients,true);
     imgParams->set(DICe::gradient_method,gradient_method_);
     Teuchos::RCP<Image> speckled_ref = create_synthetic_speckle_image(ref_img_->width(),ref_img_->height(),
-      ref_img_->offset_x(),ref_img_->offset_y(),speckle_size,imgParams);
+      ref_img_->offset_x(),ref_img_->offset_y(),speckle_size,imgParams,num_threads_);
     set_ref_image(speckled_ref);
   }
 
@@ -2330,7 +4404,10 @@ Schema::estimate_resolution_error(const Teuchos::RCP<Teuchos::ParameterList> & c
     fclose(infoFilePtr);
   }
   const int_t spa_dim = mesh_->spatial_dimension();
-  for(scalar_t period=max_period;period>=min_period;period*=period_factor){
+  // each synthetic image is written on a background thread while the previous case is correlated
+  Output_Writer image_writer;
+  bool sweep_done = false;
+  for(scalar_t period=max_period;period>=min_period&&!sweep_done;period*=period_factor){
     // reset the displacements between frequency updates, otherwise the existing solution makes a nice initial guess
     if(is_subset_based){
       mesh_->get_field(SUBSET_DISPLACEMENT_X_FS)->put_scalar(0.0);
@@ -2339,39 +4416,53 @@ Schema::estimate_resolution_error(const Teuchos::RCP<Teuchos::ParameterList> & c
       mesh_->get_field(DISPLACEMENT_FS)->put_scalar(0.0);
     }
     mesh_->get_field(SIGMA_FS)->put_scalar(0.0);
+    // the cases of one period are independent so all amplitudes are deformed in one pass over the reference image
+    std::vector<scalar_t> amplitudes;
+    std::vector<Teuchos::RCP<Image_Deformer> > deformers;
     for(scalar_t amplitude=min_amp;amplitude<=max_amp;amplitude+=amp_step){
-      if(proc_id==0)
-        std::cout << "processing resolution error for period " << period << " amplitude " << amplitude << std::endl;
-      // create an image deformer class
-      image_deformer_ = Teuchos::rcp(new SinCos_Image_Deformer(period,amplitude));
+      amplitudes.push_back(amplitude);
+      deformers.push_back(Teuchos::rcp(new SinCos_Image_Deformer(period,amplitude)));
+    }
+    DEBUG_MSG("generating " << deformers.size() << " new synthetic images");
+    std::vector<Teuchos::RCP<Image> > def_imgs = deform_images(ref_img(),deformers,num_threads_);
+    std::vector<std::string> def_img_names(def_imgs.size());
+    for(size_t amp_index=0;amp_index<def_imgs.size();++amp_index){
+      if(noise_percent > 0.0){
+        add_noise_to_image(def_imgs[amp_index],noise_percent,amp_index,num_threads_);
+      }
       std::stringstream sincos_name;
-      Teuchos::RCP<Image> def_img;
       std::stringstream amp_ss;
       std::stringstream per_ss;
-      amp_ss << amplitude;
+      amp_ss << amplitudes[amp_index];
       std::string amp_s = amp_ss.str();
       std::replace( amp_s.begin(), amp_s.end(), '.', 'p'); // replace dots with p for file name
       per_ss << period;
       std::string per_s = per_ss.str();
       std::replace( per_s.begin(), per_s.end(), '.', 'p'); // replace dots with p for file name
       sincos_name << image_dir_str << "amp_" << std::setprecision(4) << amp_s << "_period_" << std::setprecision(4) << per_s << "_proc_" << proc_id << ".tif";
-
-      // check to see if the deformed image already exists:
-      std::ifstream f(sincos_name.str().c_str());
-      //if(f.good()){
-      //  DEBUG_MSG("using previously saved image");
-      //  def_img = Teuchos::rcp(new DICe::Image(sincos_name.str().c_str()));
-      //}else{
-        DEBUG_MSG("generating new synthetic image");
-        def_img = image_deformer_->deform_image(ref_img());
-        if(noise_percent > 0.0){
-          add_noise_to_image(def_img,noise_percent);
-        }
-        def_img->write(sincos_name.str());
-      //}
+      def_img_names[amp_index] = sincos_name.str();
+    }
+    if(!def_imgs.empty()){
+      // raw pointers since the reference count of an RCP is not thread safe, def_imgs keeps the images alive
+      Image * img = def_imgs[0].get();
+      const std::string name = def_img_names[0];
+      image_writer.submit([img,name](){img->write(name);});
+    }
+    for(size_t amp_index=0;amp_index<def_imgs.size();++amp_index){
+      const scalar_t amplitude = amplitudes[amp_index];
+      if(proc_id==0)
+        std::cout << "processing resolution error for period " << period << " amplitude " << amplitude << std::endl;
+      image_deformer_ = deformers[amp_index];
+      // this case's image has to be written before the schema filters it, the next one is written while this case is correlated
+      image_writer.flush();
+      if(amp_index+1<def_imgs.size()){
+        Image * img = def_imgs[amp_index+1].get();
+        const std::string name = def_img_names[amp_index+1];
+        image_writer.submit([img,name](){img->write(name);});
+      }
 
       // set the deformed image for the schema
-      set_def_image(def_img);
+      set_def_image(def_imgs[amp_index]);
       int_t corr_error = execute_correlation();
       TEUCHOS_TEST_FOR_EXCEPTION(corr_error,std::runtime_error,"Error, correlation unsuccesssful");
       DEBUG_MSG("Error prediction step correlation return value " << corr_error);
@@ -2577,8 +4668,17 @@ Schema::estimate_resolution_error(const Teuchos::RCP<Teuchos::ParameterList> & c
       }
       result_stream.clear();
       result_stream.str("");
+      // larger amplitudes of this period won't recover and shorter periods only roll off further
+      if(max_error>0.0&&(avg_error_u>max_error||avg_error_v>max_error)){
+        if(proc_id==0)
+          std::cout << "resolution error exceeds " << max_error << "%, skipping the remaining amplitudes of period " << period <<
+            (amp_index==0 ? " and the shorter periods" : "") << std::endl;
+        if(amp_index==0) sweep_done = true;
+        break;
+      }
     } // end step loop
   } // end mag loop
+  image_writer.flush();
 #endif
 }
 
@@ -2598,6 +4698,7 @@ Schema::initialize_cross_correlation(Teuchos::RCP<Triangulation> tri,
     Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
     imgParams->set(DICe::gauss_filter_images,gauss_filter_images_);
     imgParams->set(DICe::gauss_filter_mask_size,gauss_filter_mask_size_);
+    imgParams->set(DICe::num_threads,num_threads_);
     const std::string left_image_string = image_files[0];
     const std::string right_image_string = stereo_image_files[0];
     Teuchos::RCP<DICe::Image> left_image = Teuchos::rcp(new Image(left_image_string.c_str(),imgParams));
@@ -2684,6 +4785,8 @@ int_t
 Schema::execute_triangulation(Teuchos::RCP<Triangulation> tri,
   Teuchos::RCP<Schema> right_schema){
   TEUCHOS_TEST_FOR_EXCEPTION(right_schema==Teuchos::null,std::runtime_error,"");
+  // the triangulation changes fields that may have been exchanged already
+  mesh_->clear_exchanged_overlap_fields();
   TEUCHOS_TEST_FOR_EXCEPTION(right_schema->local_num_subsets()!=local_num_subsets_,std::runtime_error,
     "Error, incompatible schemas: left number of subsets " << local_num_subsets_ << " right " << right_schema->local_num_subsets());
 
@@ -2796,11 +4899,20 @@ Schema::execute_triangulation(Teuchos::RCP<Triangulation> tri,
   Teuchos::RCP<MultiField> model_disp_x = mesh_->get_field(MODEL_DISPLACEMENT_X_FS);
   Teuchos::RCP<MultiField> model_disp_y = mesh_->get_field(MODEL_DISPLACEMENT_Y_FS);
   Teuchos::RCP<MultiField> model_disp_z = mesh_->get_field(MODEL_DISPLACEMENT_Z_FS);
-  scalar_t X=0.0,Y=0.0,Z=0.0;
-  scalar_t Xw=0.0,Yw=0.0,Zw=0.0;
-  scalar_t xl=0.0,yl=0.0;
-  scalar_t xr=0.0,yr=0.0;
-  scalar_t max_m_value = 0.0;
+  // gather the sensor coordinates so that all the points can be triangulated in one pass
+  std::vector<scalar_t> xl(local_num_subsets_,0.0);
+  std::vector<scalar_t> yl(local_num_subsets_,0.0);
+  std::vector<scalar_t> xr(local_num_subsets_,0.0);
+  std::vector<scalar_t> yr(local_num_subsets_,0.0);
+  // the world coordinates are triangulated into one contiguous buffer that the best fit plane also uses
+  Point_Cloud_3D<scalar_t> world_pts;
+  std::vector<scalar_t> max_m_values(local_num_subsets_,0.0);
+  for(int_t i=0;i<local_num_subsets_;++i){
+    xl[i] = coords_x->local_value(i) + disp_x->local_value(i);
+    yl[i] = coords_y->local_value(i) + disp_y->local_value(i);
+    xr[i] = stereo_coords_x->local_value(i) + my_stereo_disp_x->local_value(i);
+    yr[i] = stereo_coords_y->local_value(i) + my_stereo_disp_y->local_value(i);
+  }
   // if this is the first frame and a best fit plane is being used, clear the transform entries in case they have already been specified by the user
 
   bool best_fit = false;
@@ -2814,38 +4926,24 @@ Schema::execute_triangulation(Teuchos::RCP<Triangulation> tri,
       tri->clear_trans_extrinsics();
     }
   }
+  tri->triangulate(local_num_subsets_,xl.data(),yl.data(),xr.data(),yr.data(),world_pts,max_m_values.data(),false,num_threads_);
+  // the best fit plane is fit to the initial triangulation and the coordinates of the first frame are retriangulated in it
+  if(frame_id_==first_frame_id_ && best_fit){
+    tri->best_fit_plane(world_pts,sigma_left);
+    tri->triangulate(local_num_subsets_,xl.data(),yl.data(),xr.data(),yr.data(),world_pts,NULL,false,num_threads_);
+  }
+  // w-coordinates have been transformed by a user defined transform to world or model coords
   for(int_t i=0;i<local_num_subsets_;++i){
-    xl = coords_x->local_value(i) + disp_x->local_value(i);
-    yl = coords_y->local_value(i) + disp_y->local_value(i);
-    xr = stereo_coords_x->local_value(i) + my_stereo_disp_x->local_value(i);
-    yr = stereo_coords_y->local_value(i) + my_stereo_disp_y->local_value(i);
-    max_m_value = tri->triangulate(xl,yl,xr,yr,X,Y,Z,Xw,Yw,Zw);
-    max_m->local_value(i) = max_m_value;
+    max_m->local_value(i) = max_m_values[i];
     if(frame_id_==first_frame_id_){
-      model_x->local_value(i) = Xw; // w-coordinates have been transformed by a user defined transform to world or model coords
-      model_y->local_value(i) = Yw;
-      model_z->local_value(i) = Zw;
+      model_x->local_value(i) = world_pts.pts[i].x;
+      model_y->local_value(i) = world_pts.pts[i].y;
+      model_z->local_value(i) = world_pts.pts[i].z;
     }
     else{
-      model_disp_x->local_value(i) = Xw - model_x->local_value(i); // w-coordinates have been transformed by a user defined transform to world or model coords
-      model_disp_y->local_value(i) = Yw - model_y->local_value(i);
-      model_disp_z->local_value(i) = Zw - model_z->local_value(i);
-    }
-    //std::cout << " xl " << xl << " yl " << yl << " xr " << xr << " yr " << yr << " X " << Xw << " Y " << Yw << " Z " << Zw << std::endl;
-  }
-  if(frame_id_==first_frame_id_ && best_fit){
-    Teuchos::RCP<MultiField> sigma = mesh_->get_field(SIGMA_FS);
-    tri->best_fit_plane(model_x,model_y,model_z,sigma);
-    // retriangulate the coordinate in the first frame
-    for(int_t i=0;i<local_num_subsets_;++i){
-      xl = coords_x->local_value(i) + disp_x->local_value(i);
-      yl = coords_y->local_value(i) + disp_y->local_value(i);
-      xr = stereo_coords_x->local_value(i) + my_stereo_disp_x->local_value(i);
-      yr = stereo_coords_y->local_value(i) + my_stereo_disp_y->local_value(i);
-      tri->triangulate(xl,yl,xr,yr,X,Y,Z,Xw,Yw,Zw);
-      model_x->local_value(i) = Xw; // w-coordinates have been transformed by a user defined transform to world or model coords
-      model_y->local_value(i) = Yw;
-      model_z->local_value(i) = Zw;
+      model_disp_x->local_value(i) = world_pts.pts[i].x - model_x->local_value(i);
+      model_disp_y->local_value(i) = world_pts.pts[i].y - model_y->local_value(i);
+      model_disp_z->local_value(i) = world_pts.pts[i].z - model_z->local_value(i);
     }
   }
   return 0;
@@ -2867,6 +4965,9 @@ Schema::write_control_points_image(const std::string & fileName,
 
   // first, create new intensities based on the old
   Teuchos::ArrayRCP<intensity_t> intensities(width*height,0.0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads_) if(num_threads_>1)
+#endif
   for (int_t i=0;i<width*height;++i)
     intensities[i] = (*img)(i);
 
@@ -2923,28 +5024,71 @@ Schema::write_control_points_image(const std::string & fileName,
   new_img->write(fileName);
 }
 
+Schema::~Schema(){
+  // the pending output uses the output spec and binary writer of this schema
+  if(output_writer_!=Teuchos::null){
+    try{
+      output_writer_->flush();
+    }
+    catch(std::exception & e){
+      std::cout << e.what() << std::endl;
+    }
+  }
+#ifdef DICE_ENABLE_GLOBAL
+  // write any exodus output steps that are still buffered
+  if(mesh_!=Teuchos::null&&mesh_->get_output_exoid()>=0){
+    try{
+      DICe::mesh::flush_exodus_output(mesh_);
+    }
+    catch(std::exception & e){
+      std::cout << e.what() << std::endl;
+    }
+  }
+#endif
+}
+
+void
+Schema::set_output_writer(const Teuchos::RCP<DICe::Output_Writer> & writer){
+  flush_output();
+  output_writer_ = writer;
+}
+
+void
+Schema::flush_output(){
+  if(output_writer_!=Teuchos::null)
+    output_writer_->flush();
+  if(subset_text_writer_!=Teuchos::null)
+    subset_text_writer_->flush();
+}
+
 void
 Schema::write_output(const std::string & output_folder,
   const std::string & prefix,
   const bool separate_files_per_subset,
   const bool separate_header_file,
-  const bool no_text_output){
+  const bool no_text_output,
+  const bool binary_output){
   if(analysis_type_==GLOBAL_DIC){
     return;
   }
+  Scoped_Profile_Timer output_timer(PROFILE_OUTPUT);
+  Scoped_Trace_Span span("write_output","io");
   TEUCHOS_TEST_FOR_EXCEPTION(output_spec_==Teuchos::null,std::runtime_error,"");
   int_t my_proc = comm_->get_rank();
   int_t proc_size = comm_->get_size();
 
 #ifdef DICE_ENABLE_GLOBAL
-  if(frame_id_==first_frame_id_+1){
+  // the mesh is new after the subsets have been rebalanced so the steps are written to a new file
+  if(frame_id_==first_frame_id_+1||mesh_->get_output_exoid()<0){
     std::string output_dir= "";
     if(init_params_!=Teuchos::null)
       output_dir = init_params_->get<std::string>(DICe::output_folder,"");
     DICe::mesh::create_output_exodus_file(mesh_,output_dir);
     DICe::mesh::create_exodus_output_variable_names(mesh_);
+    mesh_->set_output_buffer_size(exodus_output_buffer_size_);
+    exodus_output_step_offset_ = frame_id_-first_frame_id_-1;
   }
-  DICe::mesh::exodus_output_dump(mesh_,frame_id_-first_frame_id_,frame_id_-first_frame_id_);
+  DICe::mesh::exodus_output_dump(mesh_,frame_id_-first_frame_id_-exodus_output_step_offset_,frame_id_-first_frame_id_);
 #endif
 
   if(no_text_output) return;
@@ -2958,7 +5102,47 @@ Schema::write_output(const std::string & output_folder,
   std::stringstream infoName;
   infoName << output_folder << prefix << ".info";
 
-  if(separate_files_per_subset){
+  // everything the files are written from is copied here so the output can be written on
+  // the background thread while the fields are updated for the next frame
+  std::shared_ptr<std::vector<scalar_t> > values(new std::vector<scalar_t>());
+  output_spec_->gather_values(*values,local_num_subsets_);
+  Output_Spec * output_spec = output_spec_.getRawPtr();
+  const int_t num_local_subsets = local_num_subsets_;
+  const int_t output_frame_id = frame_id_-1; // frame is decremented because write gets called after update_frame
+  const bool first_frame = frame_id_==first_frame_id_+1;
+  const std::string info_file_name = infoName.str();
+  std::function<void()> task;
+
+  if(binary_output){
+    // one append-only file per processor with a fixed size record for each frame
+    std::string info;
+    if(first_frame||binary_results_writer_==Teuchos::null){
+      if(my_proc==0)
+        info = output_spec_->info(true);
+      std::stringstream fName;
+      fName << output_folder << prefix << output_file_suffix_ << rebalance_suffix_;
+      if(proc_size>1)
+        fName << "." << proc_size << "." << my_proc;
+      fName << ".dbr";
+      std::vector<int_t> subset_ids(local_num_subsets_);
+      for(int_t i=0;i<local_num_subsets_;++i)
+        subset_ids[i] = subset_global_id(i);
+      // the previous writer may still be used by output that has not been written yet
+      flush_output();
+      binary_results_writer_ = Teuchos::rcp(new Binary_Results_Writer(fName.str(),output_spec_->field_names(),subset_ids));
+    }
+    Binary_Results_Writer * binary_writer = binary_results_writer_.getRawPtr();
+    task = [=](){
+      if(!info.empty()){
+        std::FILE * infoFilePtr = fopen(info_file_name.c_str(),"w"); // overwrite the file if it exists
+        fprintf(infoFilePtr,"%s",info.c_str());
+        fclose(infoFilePtr);
+      }
+      binary_writer->write_frame(output_frame_id,*values);
+    };
+  }
+  else if(separate_files_per_subset){
+    std::shared_ptr<std::vector<std::string> > file_names(new std::vector<std::string>(local_num_subsets_));
     for(int_t subset=0;subset<local_num_subsets_;++subset){
       // determine the number of digits to append:
       int_t num_digits_total = 0;
@@ -2980,28 +5164,42 @@ Schema::write_output(const std::string & output_folder,
       if(proc_size>1)
         fName << "." << proc_size << "." << my_proc;
       fName << ".txt";
-      if(frame_id_==first_frame_id_+1){
-        std::FILE * filePtr = fopen(fName.str().c_str(),"w"); // overwrite the file if it exists
-        if(separate_header_file&&my_proc==0){
-          std::FILE * infoFilePtr = fopen(infoName.str().c_str(),"w"); // overwrite the file if it exists
-          output_spec_->write_info(infoFilePtr,true);
-          fclose(infoFilePtr);
-         }
-        else{
-          output_spec_->write_info(filePtr,false);
-        }
-        output_spec_->write_header(filePtr,"FRAME");
-        fclose (filePtr);
+      (*file_names)[subset] = fName.str();
+    }
+    const bool write_info_file = separate_header_file&&my_proc==0;
+    std::string info;
+    if(first_frame)
+      info = output_spec_->info(write_info_file);
+    // the files are kept open between frames and the rows are buffered rather than
+    // opening and closing every subset file for every frame
+    if(first_frame||subset_text_writer_==Teuchos::null||subset_text_writer_->num_subsets()!=num_local_subsets){
+      // the previous writer may still be used by output that has not been written yet
+      flush_output();
+      subset_text_writer_ = Teuchos::rcp(new Subset_Text_Writer(*file_names));
+    }
+    Subset_Text_Writer * subset_writer = subset_text_writer_.getRawPtr();
+    task = [=](){
+      if(first_frame&&write_info_file){
+        std::FILE * infoFilePtr = fopen(info_file_name.c_str(),"w"); // overwrite the file if it exists
+        fprintf(infoFilePtr,"%s",info.c_str());
+        fclose(infoFilePtr);
       }
-      // append the latest result to the file
-      std::FILE * filePtr = fopen(fName.str().c_str(),"a");
-      output_spec_->write_frame(filePtr,frame_id_-1,subset_global_id(subset)); // frame is decremented because write gets called after update_frame
-      fclose (filePtr);
-    } // subset loop
+      for(int_t subset=0;subset<num_local_subsets;++subset){
+        const std::string & file_name = (*file_names)[subset];
+        if(first_frame){
+          std::FILE * filePtr = fopen(file_name.c_str(),"w"); // overwrite the file if it exists
+          if(!write_info_file)
+            fprintf(filePtr,"%s",info.c_str());
+          output_spec->write_header(filePtr,"FRAME");
+          fclose (filePtr);
+        }
+        // append the latest result to the file
+        subset_writer->append(subset,output_spec->frame_row(output_frame_id,*values,num_local_subsets,subset));
+      } // subset loop
+    };
   }
   else{
     std::stringstream fName;
-    std::stringstream infofName;
     // determine the number of digits to append:
     int_t num_zeros = 0;
     if(num_frames_>0){
@@ -3017,25 +5215,22 @@ Schema::write_output(const std::string & output_folder,
       num_zeros = num_digits_total - num_digits_image;
     }
     fName << output_folder << prefix << "_";
-    infofName << output_folder << prefix << ".txt";
     for(int_t i=0;i<num_zeros;++i)
       fName << "0";
     fName << frame_id_-1;
     if(proc_size >1)
       fName << "." << proc_size << "." << my_proc;
     fName << ".txt";
-    std::FILE * filePtr = fopen(fName.str().c_str(),"w");
-    if(separate_header_file && frame_id_<= first_frame_id_+1 && my_proc==0){
-      std::FILE * infoFilePtr = fopen(infoName.str().c_str(),"w"); // overwrite the file if it exists
-      output_spec_->write_info(infoFilePtr,true);
-      fclose(infoFilePtr);
-    }
-    else if(!separate_header_file){
-      output_spec_->write_info(filePtr,false);
-    }
-    output_spec_->write_header(filePtr,"SUBSET_ID");
-
-    // determine the sort order
+    const std::string file_name = fName.str();
+    const bool write_info_file = separate_header_file && frame_id_<= first_frame_id_+1 && my_proc==0;
+    std::string info;
+    if(write_info_file)
+      info = output_spec_->info(true);
+    else if(!separate_header_file)
+      info = output_spec_->info(false);
+
+    // determine the row order, each row is the subset id and the local index of its values
+    std::shared_ptr<std::vector<std::pair<int_t,int_t> > > rows(new std::vector<std::pair<int_t,int_t> >(local_num_subsets_));
     if(sort_txt_output_){
       // gather the coordinates fields
       Teuchos::RCP<MultiField> subset_coords_x = mesh_->get_field(SUBSET_COORDINATES_X_FS);
@@ -3043,7 +5238,7 @@ Schema::write_output(const std::string & output_folder,
       std::vector<std::tuple<int_t,scalar_t,scalar_t> >
         data(local_num_subsets_,std::tuple<int_t,scalar_t,scalar_t>(0,0.0,0.0));
       for(int_t i=0;i<local_num_subsets_;++i){
-        std::get<0>(data[i]) = subset_global_id(i);
+        std::get<0>(data[i]) = i;
         std::get<1>(data[i]) = subset_coords_x->local_value(i);
         std::get<2>(data[i]) = subset_coords_y->local_value(i);
       }
@@ -3053,19 +5248,37 @@ Schema::write_output(const std::string & output_folder,
       // sort the vector of tuples by x coordinate
       //std::sort(std::begin(data), std::end(data), [](const std::tuple<int_t,scalar_t,scalar_t> & a, const std::tuple<int_t,scalar_t,scalar_t>& b)
       //{return std::get<1>(a) < std::get<1>(b);});
-      // write the output
       for(int_t i=0;i<local_num_subsets_;++i){
         const int_t sorted_index = std::get<0>(data[i]);
-        output_spec_->write_frame(filePtr,sorted_index,sorted_index);
+        (*rows)[i] = std::pair<int_t,int_t>(subset_global_id(sorted_index),sorted_index);
       }
     }
     else{
-      for(int_t i=0;i<local_num_subsets_;++i){
-        output_spec_->write_frame(filePtr,subset_global_id(i),i);
-      }
+      for(int_t i=0;i<local_num_subsets_;++i)
+        (*rows)[i] = std::pair<int_t,int_t>(subset_global_id(i),i);
     }
-    fclose (filePtr);
+    task = [=](){
+      std::FILE * filePtr = fopen(file_name.c_str(),"w");
+      if(write_info_file){
+        std::FILE * infoFilePtr = fopen(info_file_name.c_str(),"w"); // overwrite the file if it exists
+        fprintf(infoFilePtr,"%s",info.c_str());
+        fclose(infoFilePtr);
+      }
+      else if(!separate_header_file){
+        fprintf(filePtr,"%s",info.c_str());
+      }
+      output_spec->write_header(filePtr,"SUBSET_ID");
+      // write the output
+      for(size_t i=0;i<rows->size();++i)
+        output_spec->write_frame(filePtr,(*rows)[i].first,*values,num_local_subsets,(*rows)[i].second);
+      fclose (filePtr);
+    };
   }
+
+  if(output_writer_!=Teuchos::null)
+    output_writer_->submit(task,values->size()*sizeof(scalar_t));
+  else
+    task();
 }
 
 void
@@ -3074,6 +5287,17 @@ Schema::write_stats(const std::string & output_folder,
   if(analysis_type_==GLOBAL_DIC)
     return;
   TEUCHOS_TEST_FOR_EXCEPTION(output_spec_==Teuchos::null,std::runtime_error,"");
+  // the info file may still be in the background writer's queue
+  flush_output();
+  // each processor writes the profile of the subsets it owns
+  if(stat_container_->subset_profile_size()==local_num_subsets_&&local_num_subsets_>0){
+    std::vector<int_t> subset_gids(local_num_subsets_);
+    for(int_t i=0;i<local_num_subsets_;++i)
+      subset_gids[i] = subset_global_id(i);
+    std::stringstream profileName;
+    profileName << output_folder << prefix << "_subset_profile." << comm_->get_rank() << ".csv";
+    stat_container_->write_subset_profile(profileName.str(),subset_gids);
+  }
   std::stringstream infoName;
   infoName << output_folder << prefix << ".info";
   // the info file must exist for the stats to be written, otherwise no op
@@ -3128,8 +5352,7 @@ Schema::check_for_blocking_subsets(const int_t subset_global_id){
 
   // turn off pixels in this subset that are blocked by another
   // get a pointer to the member data in the subset that will store the list of blocked pixels
-  std::set<std::pair<int_t,int_t> > & blocked_pixels =
-      *obj_vec_[subset_lid]->subset()->pixels_blocked_by_other_subsets();
+  Pixel_Bitmap & blocked_pixels = *obj_vec_[subset_lid]->subset()->pixels_blocked_by_other_subsets();
   blocked_pixels.clear();
 
   // get the list of subsets that block this one
@@ -3143,9 +5366,7 @@ Schema::check_for_blocking_subsets(const int_t subset_global_id){
     int_t cy = obj_vec_[local_ss]->subset()->centroid_y();
     Teuchos::RCP<Local_Shape_Function> shape_function = shape_function_factory(this);
     shape_function->initialize_parameters_from_fields(this,global_ss);
-    std::set<std::pair<int_t,int_t> > subset_pixels =
-        obj_vec_[local_ss]->subset()->deformed_shapes(shape_function,cx,cy,obstruction_skin_factor_);
-    blocked_pixels.insert(subset_pixels.begin(),subset_pixels.end());
+    obj_vec_[local_ss]->subset()->rasterize_deformed_shapes(blocked_pixels,shape_function,cx,cy,obstruction_skin_factor_);
   } // blocking subsets loop
 }
 
@@ -3186,78 +5407,129 @@ Schema::write_deformed_subsets_image(const bool use_gamma_as_color){
   const int_t w = ref_img_->width();
   const int_t h = ref_img_->height();
 
-  Teuchos::ArrayRCP<intensity_t> intensities(w*h,0.0);
+  // the image is rendered into a buffer that is reused once the image of the previous frame
+  // has been written (the write task holds on to the buffer until then)
+  if(!deformed_subsets_image_buffer_||deformed_subsets_image_buffer_.use_count()>1
+      ||(int_t)deformed_subsets_image_buffer_->size()!=w*h)
+    deformed_subsets_image_buffer_ = std::make_shared<std::vector<intensity_t> >(w*h);
+  std::shared_ptr<std::vector<intensity_t> > buffer = deformed_subsets_image_buffer_;
+  intensity_t * intensities = buffer->data();
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads_) if(num_threads_>1)
+#endif
+  for(int_t y=0;y<h;++y)
+    std::fill(intensities+y*w,intensities+(y+1)*w,0.0);
 
   // construct a copy of the base image to use as layer 0 for the output;
   // read each sub image if motion windows are used
   for(int_t sub=0;sub<(int_t)def_imgs_.size();++sub){
     if(def_imgs_[sub]==Teuchos::null)continue;
-    const int_t offset_x = def_imgs_[sub]->offset_x();
-    const int_t offset_y = def_imgs_[sub]->offset_y();
-    for(int_t y=0;y<def_imgs_[sub]->height();++y){
-      for(int_t x=0;x<def_imgs_[sub]->width();++x){
-        intensities[(y+offset_y)*w + x + offset_x] = (*def_imgs_[sub])(x,y);
+    const Image & sub_img = *def_imgs_[sub];
+    const int_t offset_x = sub_img.offset_x();
+    const int_t offset_y = sub_img.offset_y();
+    const int_t sub_h = sub_img.height();
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads_) if(num_threads_>1)
+#endif
+    for(int_t y=0;y<sub_h;++y){
+      for(int_t x=0;x<sub_img.width();++x){
+        intensities[(y+offset_y)*w + x + offset_x] = sub_img(x,y);
       }
     }
   }
-  int_t ox=0,oy=0;
-  scalar_t X=0.0,Y=0.0;
-  int_t px=0,py=0;
-  Teuchos::RCP<Local_Shape_Function> shape_function = shape_function_factory(this);
-  // create output for each subset
-  for(size_t subset=0;subset<obj_vec_.size();++subset){
-    const int_t gid = obj_vec_[subset]->correlation_point_global_id();
-    shape_function->initialize_parameters_from_fields(this,gid);
-    shape_function->print_parameters();
-    Teuchos::RCP<DICe::Subset> ref_subset = obj_vec_[subset]->subset();
-    ox = ref_subset->centroid_x();
-    oy = ref_subset->centroid_y();
-    scalar_t mean_sum_ref = 0.0;
-    scalar_t mean_sum_def = 0.0;
-    scalar_t mean_ref = 0.0;
-    scalar_t mean_def = 0.0;
-    if(use_gamma_as_color){
-      mean_ref = obj_vec_[subset]->subset()->mean(REF_INTENSITIES,mean_sum_ref);
-      mean_def = obj_vec_[subset]->subset()->mean(DEF_INTENSITIES,mean_sum_def);
-      TEUCHOS_TEST_FOR_EXCEPTION(mean_sum_ref==0.0||mean_sum_def==0.0,std::runtime_error," invalid mean sum (cannot be 0.0, ZNSSD is then undefined)" <<
-        mean_sum_ref << " " << mean_sum_def);
-    }
-    // loop over each pixel in the subset
-    scalar_t pixel_gamma = 0.0;
-    for(int_t i=0;i<ref_subset->num_pixels();++i){
-      shape_function->map(ref_subset->x(i),ref_subset->y(i),ox,oy,X,Y);
-      // get the nearest pixel location:
-      px = (int_t)X;
-      if(X - (int_t)X >= 0.5) px++;
-      py = (int_t)Y;
-      if(Y - (int_t)Y >= 0.5) py++;
-      // offset the pixel locations by the sub image offsets
-      if(px>=0&&px<w&&py>=0&&py<h){
-        if(use_gamma_as_color){
-          if(ref_subset->is_active(i)&!ref_subset->is_deactivated_this_step(i)){
-            pixel_gamma =  (ref_subset->def_intensities(i)-mean_def)/mean_sum_def - (ref_subset->ref_intensities(i)-mean_ref)/mean_sum_ref;
-            intensities[py*w+px] = pixel_gamma*pixel_gamma*10000.0;
-          }
-        }else{
-          if(!ref_subset->is_active(i)){
-            intensities[py*w+px] = 75;
-          }
-          else{
+  // the subsets are mapped in parallel, each one into its own list of pixels, and the lists are
+  // painted in subset order afterwards so overlapping subsets are drawn the same way as in serial
+  const int_t num_subsets = obj_vec_.size();
+  std::vector<std::vector<std::pair<int_t,intensity_t> > > subset_pixels(num_subsets);
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr render_error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_subsets>1)
+#endif
+  for(int_t subset=0;subset<num_subsets;++subset){
+    try{
+      const int_t gid = obj_vec_[subset]->correlation_point_global_id();
+      Teuchos::RCP<Local_Shape_Function> shape_function = shape_function_factory(this);
+      shape_function->initialize_parameters_from_fields(this,gid);
+      shape_function->print_parameters();
+      Teuchos::RCP<DICe::Subset> ref_subset = obj_vec_[subset]->subset();
+      const int_t ox = ref_subset->centroid_x();
+      const int_t oy = ref_subset->centroid_y();
+      scalar_t mean_sum_ref = 0.0;
+      scalar_t mean_sum_def = 0.0;
+      scalar_t mean_ref = 0.0;
+      scalar_t mean_def = 0.0;
+      if(use_gamma_as_color){
+        mean_ref = ref_subset->mean(REF_INTENSITIES,mean_sum_ref);
+        mean_def = ref_subset->mean(DEF_INTENSITIES,mean_sum_def);
+        TEUCHOS_TEST_FOR_EXCEPTION(mean_sum_ref==0.0||mean_sum_def==0.0,std::runtime_error," invalid mean sum (cannot be 0.0, ZNSSD is then undefined)" <<
+          mean_sum_ref << " " << mean_sum_def);
+      }
+      const int_t num_pixels = ref_subset->num_pixels();
+      std::vector<int_t> coords_x(num_pixels);
+      std::vector<int_t> coords_y(num_pixels);
+      for(int_t i=0;i<num_pixels;++i){
+        coords_x[i] = ref_subset->x(i);
+        coords_y[i] = ref_subset->y(i);
+      }
+      std::vector<scalar_t> mapped_x(num_pixels);
+      std::vector<scalar_t> mapped_y(num_pixels);
+      shape_function->batch_map(num_pixels,coords_x.data(),coords_y.data(),ox,oy,mapped_x.data(),mapped_y.data());
+      std::vector<std::pair<int_t,intensity_t> > & pixels = subset_pixels[subset];
+      pixels.reserve(num_pixels);
+      // loop over each pixel in the subset
+      scalar_t pixel_gamma = 0.0;
+      for(int_t i=0;i<num_pixels;++i){
+        const scalar_t & X = mapped_x[i];
+        const scalar_t & Y = mapped_y[i];
+        // get the nearest pixel location:
+        int_t px = (int_t)X;
+        if(X - (int_t)X >= 0.5) px++;
+        int_t py = (int_t)Y;
+        if(Y - (int_t)Y >= 0.5) py++;
+        // offset the pixel locations by the sub image offsets
+        if(px>=0&&px<w&&py>=0&&py<h){
+          if(use_gamma_as_color){
+            if(ref_subset->is_active(i)&!ref_subset->is_deactivated_this_step(i)){
+              pixel_gamma =  (ref_subset->def_intensities(i)-mean_def)/mean_sum_def - (ref_subset->ref_intensities(i)-mean_ref)/mean_sum_ref;
+              pixels.push_back(std::pair<int_t,intensity_t>(py*w+px,pixel_gamma*pixel_gamma*10000.0));
+            }
+          }else{
             // color shows correlation quality
-            intensities[py*w+px] = 100;//ref_subset->per_pixel_gamma(i)*85000;
-          }
-          // trun all deactivated pixels white
-          if(ref_subset->is_deactivated_this_step(i)){
-            intensities[py*w+px] = 255;
-          }
-        } // not use_gamma_as_color
-      } // range guard
-    } // pixel loop
-
+            intensity_t color = ref_subset->is_active(i) ? 100 : 75; //ref_subset->per_pixel_gamma(i)*85000;
+            // trun all deactivated pixels white
+            if(ref_subset->is_deactivated_this_step(i))
+              color = 255;
+            pixels.push_back(std::pair<int_t,intensity_t>(py*w+px,color));
+          } // not use_gamma_as_color
+        } // range guard
+      } // pixel loop
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_render_error)
+#endif
+      {
+        if(!render_error) render_error = std::current_exception();
+      }
+    }
   } // subset loop
+  if(render_error) std::rethrow_exception(render_error);
+  for(int_t subset=0;subset<num_subsets;++subset){
+    const std::vector<std::pair<int_t,intensity_t> > & pixels = subset_pixels[subset];
+    for(size_t i=0;i<pixels.size();++i)
+      intensities[pixels[i].first] = pixels[i].second;
+  }
 
-  Teuchos::RCP<Image> layer_0_image = Teuchos::rcp(new Image(w,h,intensities));
-  layer_0_image->write(ss.str());
+  // the image is encoded and written by the output writer if there is one so that it overlaps with the next frame
+  const std::string file_name = ss.str();
+  std::function<void()> task = [buffer,file_name,w,h](){
+    utils::write_image(file_name.c_str(),w,h,buffer->data());
+  };
+  if(output_writer_!=Teuchos::null)
+    output_writer_->submit(task,w*h*sizeof(intensity_t));
+  else
+    task();
 #else
   DEBUG_MSG("Warning, write_deformed_image() was called, but Boost::filesystem is not enabled making this a no-op.");
 #endif
@@ -3391,61 +5663,100 @@ Output_Spec::gather_fields(){
   }
 }
 
+void
+Output_Spec::gather_values(std::vector<scalar_t> & values,
+  const int_t num_local_subsets){
+  values.assign(field_names_.size()*num_local_subsets,0.0);
+  for(size_t i=0;i<field_names_.size();++i){
+    // fields that were requested, but don't exist are written as zeros
+    if(field_vec_[i]==Teuchos::null) continue;
+    scalar_t * field_values = &values[i*num_local_subsets];
+    for(int_t j=0;j<num_local_subsets;++j)
+      field_values[j] = field_vec_[i]->local_value(j);
+  }
+}
+
+/// appends printf style formatted text to a string
+static void
+append_format(std::string & str,
+  const char * format,
+  ...){
+  va_list args;
+  va_start(args,format);
+  va_list args_copy;
+  va_copy(args_copy,args);
+  const int size = vsnprintf(NULL,0,format,args_copy);
+  va_end(args_copy);
+  if(size>0){
+    std::vector<char> buffer(size+1);
+    vsnprintf(&buffer[0],buffer.size(),format,args);
+    str.append(&buffer[0],size);
+  }
+  va_end(args);
+}
+
 void
 Output_Spec::write_info(std::FILE * file,
   const bool include_time_of_day){
   assert(file);
+  fprintf(file,"%s",info(include_time_of_day).c_str());
+}
+
+std::string
+Output_Spec::info(const bool include_time_of_day){
   TEUCHOS_TEST_FOR_EXCEPTION(schema_->analysis_type()==GLOBAL_DIC,std::runtime_error,
     "Error, write_info is not intended to be used for global DIC");
-  fprintf(file,"***\n");
-  fprintf(file,"*** Digital Image Correlation Engine (DICe), (git sha1: %s) Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS)\n",GITSHA1);
-  fprintf(file,"***\n");
-  fprintf(file,"*** Reference image: %s \n",schema_->ref_img()->file_name().c_str());
-  fprintf(file,"*** Deformed image: %s \n",schema_->def_img(0)->file_name().c_str());
-  fprintf(file,"*** DIC method : local \n");
-  fprintf(file,"*** Correlation method: ZNSSD\n");
+  std::string info;
+  append_format(info,"***\n");
+  append_format(info,"*** Digital Image Correlation Engine (DICe), (git sha1: %s) Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS)\n",GITSHA1);
+  append_format(info,"***\n");
+  append_format(info,"*** Reference image: %s \n",schema_->ref_img()->file_name().c_str());
+  append_format(info,"*** Deformed image: %s \n",schema_->def_img(0)->file_name().c_str());
+  append_format(info,"*** DIC method : local \n");
+  append_format(info,"*** Correlation method: ZNSSD\n");
   std::string interp_method = to_string(schema_->interpolation_method());
-  fprintf(file,"*** Interpolation method: %s\n",interp_method.c_str());
+  append_format(info,"*** Interpolation method: %s\n",interp_method.c_str());
   std::string grad_method = to_string(schema_->gradient_method());
-  fprintf(file,"*** Image gradient method: %s\n",grad_method.c_str());
+  append_format(info,"*** Image gradient method: %s\n",grad_method.c_str());
   std::string opt_method = to_string(schema_->optimization_method());
-  fprintf(file,"*** Optimization method: %s\n",opt_method.c_str());
+  append_format(info,"*** Optimization method: %s\n",opt_method.c_str());
   std::string proj_method = to_string(schema_->projection_method());
-  fprintf(file,"*** Projection method: %s\n",proj_method.c_str());
+  append_format(info,"*** Projection method: %s\n",proj_method.c_str());
   std::string init_method = to_string(schema_->initialization_method());
-  fprintf(file,"*** Guess initialization method: %s\n",init_method.c_str());
-  fprintf(file,"*** Seed location: N/A\n");
-  fprintf(file,"*** Shape functions: ");
+  append_format(info,"*** Guess initialization method: %s\n",init_method.c_str());
+  append_format(info,"*** Seed location: N/A\n");
+  append_format(info,"*** Shape functions: ");
   if(schema_->quadratic_shape_function_enabled()){
-    fprintf(file,"quadratic (A,B,C,D,E,F,G,H,I,J,K,L)");
+    append_format(info,"quadratic (A,B,C,D,E,F,G,H,I,J,K,L)");
   }else{
     if(schema_->translation_enabled())
-      fprintf(file,"Translation (u,v) ");
+      append_format(info,"Translation (u,v) ");
     if(schema_->rotation_enabled())
-      fprintf(file,"Rotation (theta) ");
+      append_format(info,"Rotation (theta) ");
     if(schema_->normal_strain_enabled())
-      fprintf(file,"Normal Strain (ex,ey) ");
+      append_format(info,"Normal Strain (ex,ey) ");
     if(schema_->shear_strain_enabled())
-      fprintf(file,"Shear Strain (gamma_xy) ");
+      append_format(info,"Shear Strain (gamma_xy) ");
   }
-  fprintf(file,"\n");
-  fprintf(file,"*** Incremental correlation: false\n");
-  fprintf(file,"*** Subset size: %i\n",schema_->subset_dim());
-  fprintf(file,"*** Step size: x %i y %i (-1 implies not regular grid)\n",schema_->step_size_x(),schema_->step_size_y());
+  append_format(info,"\n");
+  append_format(info,"*** Incremental correlation: false\n");
+  append_format(info,"*** Subset size: %i\n",schema_->subset_dim());
+  append_format(info,"*** Step size: x %i y %i (-1 implies not regular grid)\n",schema_->step_size_x(),schema_->step_size_y());
   if(schema_->post_processors()->size()==0)
-    fprintf(file,"*** Strain window: N/A\n");
+    append_format(info,"*** Strain window: N/A\n");
   else if(schema_->strain_window_size(0)==-1)
-    fprintf(file,"*** Strain window: N/A\n");
+    append_format(info,"*** Strain window: N/A\n");
   else
-    fprintf(file,"*** Strain window size in pixels: %i (only first strain post-processor is reported)\n",schema_->strain_window_size(0));
-  fprintf(file,"*** Coordinates given with (0,0) as upper left corner of image, x positive right, y positive down\n");
-  fprintf(file,"***\n");
+    append_format(info,"*** Strain window size in pixels: %i (only first strain post-processor is reported)\n",schema_->strain_window_size(0));
+  append_format(info,"*** Coordinates given with (0,0) as upper left corner of image, x positive right, y positive down\n");
+  append_format(info,"***\n");
   if(include_time_of_day){
     time_t t = time(0);   // get time now
     struct tm * now = localtime( & t );
-    fprintf(file,"*** Analysis start time %i_%i_%i %i %i %i \n",
+    append_format(info,"*** Analysis start time %i_%i_%i %i %i %i \n",
       now->tm_year + 1900,now->tm_mon + 1,now->tm_mday,now->tm_hour,now->tm_min,now->tm_sec);
   }
+  return info;
 }
 
 void
@@ -3537,6 +5848,44 @@ Output_Spec::write_frame(std::FILE * file,
   fprintf(file,"\n"); // the space before end of line is important for parsing in the output diff tool
 }
 
+void
+Output_Spec::write_frame(std::FILE * file,
+  const int_t row_index,
+  const std::vector<scalar_t> & values,
+  const int_t num_local_subsets,
+  const int_t field_value_index){
+  assert(file);
+  const std::string row = frame_row(row_index,values,num_local_subsets,field_value_index);
+  fprintf(file,"%s",row.c_str());
+}
+
+std::string
+Output_Spec::frame_row(const int_t row_index,
+  const std::vector<scalar_t> & values,
+  const int_t num_local_subsets,
+  const int_t field_value_index){
+  TEUCHOS_TEST_FOR_EXCEPTION(field_value_index<0||field_value_index>=num_local_subsets
+    ||(int_t)values.size()!=(int_t)field_names_.size()*num_local_subsets,std::runtime_error,
+    "Error, invalid values given to write_frame");
+  std::string row;
+  char buffer[64];
+  if(!omit_row_id_){
+    snprintf(buffer,sizeof(buffer),"%i",row_index);
+    row += buffer;
+    row += delimiter_;
+  }
+  for(size_t i=0;i<field_names_.size();++i)
+  {
+    const scalar_t value = values[i*num_local_subsets + field_value_index];
+    if(i!=0)
+      row += delimiter_;
+    snprintf(buffer,sizeof(buffer),"%4.4E",value);
+    row += buffer;
+  }
+  row += "\n";
+  return row;
+}
+
 bool frame_should_be_skipped(const int_t trigger_based_frame_index,
   std::vector<int_t> & frame_id_vector){
   DEBUG_MSG("frame_should_be_skipped(): vector size " << frame_id_vector.size());
@@ -3557,50 +5906,252 @@ bool frame_should_be_skipped(const int_t trigger_based_frame_index,
 void
 Stat_Container::register_backup_opt_call(const int_t subset_id,
   const int_t frame_id){
-  if(backup_optimization_call_frames_.find(subset_id) == backup_optimization_call_frames_.end()){
-    std::vector<int_t> frames;
-    frames.push_back(frame_id);
-    backup_optimization_call_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+#ifdef _OPENMP
+#pragma omp critical(dice_stat_container)
+#endif
+  {
+    if(backup_optimization_call_frames_.find(subset_id) == backup_optimization_call_frames_.end()){
+      std::vector<int_t> frames;
+      frames.push_back(frame_id);
+      backup_optimization_call_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+    }
+    else
+      backup_optimization_call_frames_.find(subset_id)->second.push_back(frame_id);
   }
-  else
-    backup_optimization_call_frames_.find(subset_id)->second.push_back(frame_id);
 }
 
 void
 Stat_Container::register_search_call(const int_t subset_id,
   const int_t frame_id){
-  if(search_call_frames_.find(subset_id) == search_call_frames_.end()){
-    std::vector<int_t> frames;
-    frames.push_back(frame_id);
-    search_call_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+#ifdef _OPENMP
+#pragma omp critical(dice_stat_container)
+#endif
+  {
+    if(search_call_frames_.find(subset_id) == search_call_frames_.end()){
+      std::vector<int_t> frames;
+      frames.push_back(frame_id);
+      search_call_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+    }
+    else
+      search_call_frames_.find(subset_id)->second.push_back(frame_id);
   }
-  else
-    search_call_frames_.find(subset_id)->second.push_back(frame_id);
 }
 
 void
 Stat_Container::register_jump_exceeded(const int_t subset_id,
   const int_t frame_id){
-  if(jump_tol_exceeded_frames_.find(subset_id) == jump_tol_exceeded_frames_.end()){
-    std::vector<int_t> frames;
-    frames.push_back(frame_id);
-    jump_tol_exceeded_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+#ifdef _OPENMP
+#pragma omp critical(dice_stat_container)
+#endif
+  {
+    if(jump_tol_exceeded_frames_.find(subset_id) == jump_tol_exceeded_frames_.end()){
+      std::vector<int_t> frames;
+      frames.push_back(frame_id);
+      jump_tol_exceeded_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+    }
+    else
+      jump_tol_exceeded_frames_.find(subset_id)->second.push_back(frame_id);
   }
-  else
-    jump_tol_exceeded_frames_.find(subset_id)->second.push_back(frame_id);
 }
 
 void
 Stat_Container::register_failed_init(const int_t subset_id,
   const int_t frame_id){
-  if(failed_init_frames_.find(subset_id) == failed_init_frames_.end()){
-    std::vector<int_t> frames;
-    frames.push_back(frame_id);
-    failed_init_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+#ifdef _OPENMP
+#pragma omp critical(dice_stat_container)
+#endif
+  {
+    if(failed_init_frames_.find(subset_id) == failed_init_frames_.end()){
+      std::vector<int_t> frames;
+      frames.push_back(frame_id);
+      failed_init_frames_.insert(std::pair<int_t,std::vector<int_t> >(subset_id,frames));
+    }
+    else
+      failed_init_frames_.find(subset_id)->second.push_back(frame_id);
+  }
+}
+
+void
+Stat_Container::initialize_subset_profile(const int_t num_local_subsets){
+  TEUCHOS_TEST_FOR_EXCEPTION(num_local_subsets<0,std::runtime_error,"Error, invalid number of subsets");
+  if(subset_profile_size()==num_local_subsets) return;
+  profile_num_solves_.assign(num_local_subsets,0);
+  profile_total_iterations_.assign(num_local_subsets,0);
+  profile_max_iterations_.assign(num_local_subsets,0);
+  profile_num_searches_.assign(num_local_subsets,0);
+  profile_num_backup_opts_.assign(num_local_subsets,0);
+  profile_num_failures_.assign(num_local_subsets,0);
+  profile_solve_time_.assign(num_local_subsets,0.0);
+  profile_last_path_.assign(num_local_subsets,static_cast<char>(PRIMARY_SOLVE_PATH));
+}
+
+void
+Stat_Container::register_subset_solve(const int_t subset_lid,
+  const int_t iterations,
+  const double & solve_time,
+  const int_t path){
+  // subsets added after the profile was sized are not tracked
+  if(subset_lid<0||subset_lid>=subset_profile_size()) return;
+  profile_num_solves_[subset_lid]++;
+  if(iterations>0){
+    profile_total_iterations_[subset_lid] += iterations;
+    profile_max_iterations_[subset_lid] = std::max(profile_max_iterations_[subset_lid],iterations);
+  }
+  if(path & SEARCH_INITIALIZATION_PATH) profile_num_searches_[subset_lid]++;
+  if(path & BACKUP_OPTIMIZATION_PATH) profile_num_backup_opts_[subset_lid]++;
+  if(path & FAILED_SOLVE_PATH) profile_num_failures_[subset_lid]++;
+  profile_solve_time_[subset_lid] += solve_time;
+  profile_last_path_[subset_lid] = static_cast<char>(path);
+}
+
+int_t
+Stat_Container::num_path_solves(const int_t subset_lid,
+  const Subset_Solve_Path path)const{
+  switch(path){
+  case SEARCH_INITIALIZATION_PATH: return profile_num_searches_[subset_lid];
+  case BACKUP_OPTIMIZATION_PATH: return profile_num_backup_opts_[subset_lid];
+  case FAILED_SOLVE_PATH: return profile_num_failures_[subset_lid];
+  default: break;
+  }
+  // solves that did not need any fallback
+  return profile_num_solves_[subset_lid] - profile_num_searches_[subset_lid] - profile_num_backup_opts_[subset_lid] - profile_num_failures_[subset_lid];
+}
+
+std::vector<int_t>
+Stat_Container::costliest_subsets(const int_t num_subsets)const{
+  std::vector<int_t> lids(subset_profile_size());
+  for(size_t i=0;i<lids.size();++i)
+    lids[i] = i;
+  const size_t num_sorted = std::min(lids.size(),static_cast<size_t>(std::max(num_subsets,0)));
+  std::partial_sort(lids.begin(),lids.begin()+num_sorted,lids.end(),
+    [this](const int_t a, const int_t b){return profile_solve_time_[a] > profile_solve_time_[b];});
+  lids.resize(num_sorted);
+  return lids;
+}
+
+void
+Stat_Container::write_subset_profile(const std::string & file_name,
+  const std::vector<int_t> & subset_gids,
+  const bool binary)const{
+  const int_t num_subsets = subset_profile_size();
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t)subset_gids.size()!=num_subsets,std::runtime_error,
+    "Error, the number of subset ids does not match the profile");
+  std::FILE * file = fopen(file_name.c_str(),binary ? "wb" : "w");
+  TEUCHOS_TEST_FOR_EXCEPTION(file==NULL,std::runtime_error,"Error, could not open the subset profile file " << file_name);
+  if(binary){
+    // the number of subsets followed by each column as a contiguous array
+    fwrite(&num_subsets,sizeof(int_t),1,file);
+    if(num_subsets>0){
+      fwrite(&subset_gids[0],sizeof(int_t),num_subsets,file);
+      fwrite(&profile_num_solves_[0],sizeof(int_t),num_subsets,file);
+      fwrite(&profile_total_iterations_[0],sizeof(int_t),num_subsets,file);
+      fwrite(&profile_max_iterations_[0],sizeof(int_t),num_subsets,file);
+      fwrite(&profile_num_searches_[0],sizeof(int_t),num_subsets,file);
+      fwrite(&profile_num_backup_opts_[0],sizeof(int_t),num_subsets,file);
+      fwrite(&profile_num_failures_[0],sizeof(int_t),num_subsets,file);
+      fwrite(&profile_solve_time_[0],sizeof(double),num_subsets,file);
+      fwrite(&profile_last_path_[0],sizeof(char),num_subsets,file);
+    }
+  }
+  else{
+    fprintf(file,"SUBSET_ID,NUM_SOLVES,TOTAL_ITERATIONS,MAX_ITERATIONS,SEARCH_INITS,BACKUP_OPTS,FAILURES,SOLVE_TIME,AVG_SOLVE_TIME,LAST_PATH\n");
+    for(int_t i=0;i<num_subsets;++i){
+      const double avg_time = profile_num_solves_[i] > 0 ? profile_solve_time_[i]/profile_num_solves_[i] : 0.0;
+      fprintf(file,"%i,%i,%i,%i,%i,%i,%i,%.6e,%.6e,%i\n",subset_gids[i],profile_num_solves_[i],profile_total_iterations_[i],
+        profile_max_iterations_[i],profile_num_searches_[i],profile_num_backup_opts_[i],profile_num_failures_[i],
+        profile_solve_time_[i],avg_time,static_cast<int_t>(profile_last_path_[i]));
+    }
+  }
+  fclose(file);
+}
+
+namespace {
+
+/// write a map of subset id to frame ids as the number of entries followed by id, count, frames for each entry
+void
+write_frame_map(std::FILE * file,
+  const std::map<int_t,std::vector<int_t> > & frame_map){
+  const int_t num_entries = frame_map.size();
+  fwrite(&num_entries,sizeof(int_t),1,file);
+  for(std::map<int_t,std::vector<int_t> >::const_iterator it=frame_map.begin();it!=frame_map.end();++it){
+    const int_t header[2] = {it->first,(int_t)it->second.size()};
+    fwrite(header,sizeof(int_t),2,file);
+    if(!it->second.empty())
+      fwrite(&it->second[0],sizeof(int_t),it->second.size(),file);
   }
-  else
-    failed_init_frames_.find(subset_id)->second.push_back(frame_id);
 }
 
+/// read a map written by write_frame_map(), returns false if the file is truncated
+bool
+read_frame_map(std::FILE * file,
+  std::map<int_t,std::vector<int_t> > & frame_map){
+  frame_map.clear();
+  int_t num_entries = 0;
+  if(fread(&num_entries,sizeof(int_t),1,file)!=1||num_entries<0) return false;
+  for(int_t i=0;i<num_entries;++i){
+    int_t header[2] = {0,0};
+    if(fread(header,sizeof(int_t),2,file)!=2||header[1]<0) return false;
+    std::vector<int_t> & frames = frame_map[header[0]];
+    frames.resize(header[1]);
+    if(header[1]>0&&fread(&frames[0],sizeof(int_t),header[1],file)!=(size_t)header[1]) return false;
+  }
+  return true;
+}
+
+/// write a vector as its size followed by the values
+template <typename T>
+void
+write_profile_column(std::FILE * file,
+  const std::vector<T> & column){
+  const int_t size = column.size();
+  fwrite(&size,sizeof(int_t),1,file);
+  if(size>0)
+    fwrite(&column[0],sizeof(T),size,file);
+}
+
+/// read a vector written by write_profile_column(), returns false if the file is truncated
+template <typename T>
+bool
+read_profile_column(std::FILE * file,
+  std::vector<T> & column){
+  int_t size = 0;
+  if(fread(&size,sizeof(int_t),1,file)!=1||size<0) return false;
+  column.resize(size);
+  return size==0 || fread(&column[0],sizeof(T),size,file)==(size_t)size;
+}
+
+}
+
+void
+Stat_Container::write_checkpoint(std::FILE * file)const{
+  write_frame_map(file,backup_optimization_call_frames_);
+  write_frame_map(file,search_call_frames_);
+  write_frame_map(file,jump_tol_exceeded_frames_);
+  write_frame_map(file,failed_init_frames_);
+  write_profile_column(file,profile_num_solves_);
+  write_profile_column(file,profile_total_iterations_);
+  write_profile_column(file,profile_max_iterations_);
+  write_profile_column(file,profile_num_searches_);
+  write_profile_column(file,profile_num_backup_opts_);
+  write_profile_column(file,profile_num_failures_);
+  write_profile_column(file,profile_solve_time_);
+  write_profile_column(file,profile_last_path_);
+}
+
+bool
+Stat_Container::read_checkpoint(std::FILE * file){
+  return read_frame_map(file,backup_optimization_call_frames_)
+    && read_frame_map(file,search_call_frames_)
+    && read_frame_map(file,jump_tol_exceeded_frames_)
+    && read_frame_map(file,failed_init_frames_)
+    && read_profile_column(file,profile_num_solves_)
+    && read_profile_column(file,profile_total_iterations_)
+    && read_profile_column(file,profile_max_iterations_)
+    && read_profile_column(file,profile_num_searches_)
+    && read_profile_column(file,profile_num_backup_opts_)
+    && read_profile_column(file,profile_num_failures_)
+    && read_profile_column(file,profile_solve_time_)
+    && read_profile_column(file,profile_last_path_);
+}
 
 }// End DICe Namespace
@@ -64,7 +64,11 @@
 #include <Teuchos_ParameterList.hpp>
 #include <Teuchos_SerialDenseMatrix.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <map>
+#include <memory>
 
 namespace DICe {
 
@@ -74,8 +78,26 @@ class Objective;
 // forward declaration of Output_Spec
 class Output_Spec;
 
+// forward declaration of Binary_Results_Writer
+class Binary_Results_Writer;
+// forward declaration of Subset_Text_Writer
+class Subset_Text_Writer;
+
+// forward declaration of Output_Writer
+class Output_Writer;
+
+// forward declaration of Halo_Exchange
+class Halo_Exchange;
+
+#if DICE_KOKKOS
+// forward declaration of Subset_Batch
+class Subset_Batch;
+#endif
+
 // forward declaration of Post_Processor
 class Post_Processor;
+// forward declaration of Neighborhood_Cache
+class Neighborhood_Cache;
 
 // forward dec for a triangulation
 class Triangulation;
@@ -84,7 +106,20 @@ class Triangulation;
 class Image_Deformer;
 
 
+/// solve paths recorded in the per-subset profile (more than one can apply to the same solve)
+enum Subset_Solve_Path{
+  /// the first optimization method was used and not retried
+  PRIMARY_SOLVE_PATH=0,
+  /// a search initialization was needed to start the solve
+  SEARCH_INITIALIZATION_PATH=1,
+  /// the backup optimization method was needed
+  BACKUP_OPTIMIZATION_PATH=2,
+  /// the solve did not converge to a valid solution
+  FAILED_SOLVE_PATH=4
+};
+
 /// container class that holds information about a tracking analysis
+/// and the per-subset cost of each solve
 class
 DICE_LIB_DLL_EXPORT
 Stat_Container{
@@ -174,6 +209,86 @@ public:
       return 0;
   }
 
+  /// \brief size the per-subset profile, the counters are only reset if the size changes
+  /// \param num_local_subsets the number of subsets local to this process
+  ///
+  /// Must be called before the subset loop since the profile is not resized in the loop
+  void initialize_subset_profile(const int_t num_local_subsets);
+
+  /// \brief record one solve of a subset in the profile
+  /// \param subset_lid the local id of the subset
+  /// \param iterations the number of iterations the solve took
+  /// \param solve_time the wall time of the solve in seconds
+  /// \param path the bitwise or of the Subset_Solve_Path values that were taken
+  ///
+  /// Each subset is only solved by one thread at a time so no lock is needed
+  void register_subset_solve(const int_t subset_lid,
+    const int_t iterations,
+    const double & solve_time,
+    const int_t path);
+
+  /// returns the number of subsets in the profile
+  int_t subset_profile_size()const{
+    return profile_num_solves_.size();
+  }
+
+  /// returns the number of times the subset was solved
+  int_t num_solves(const int_t subset_lid)const{
+    return profile_num_solves_[subset_lid];
+  }
+
+  /// returns the total number of iterations for all solves of the subset
+  int_t total_iterations(const int_t subset_lid)const{
+    return profile_total_iterations_[subset_lid];
+  }
+
+  /// returns the largest number of iterations of one solve of the subset
+  int_t max_iterations(const int_t subset_lid)const{
+    return profile_max_iterations_[subset_lid];
+  }
+
+  /// returns the total solve time for the subset in seconds
+  double solve_time(const int_t subset_lid)const{
+    return profile_solve_time_[subset_lid];
+  }
+
+  /// returns the average solve time of the subset in seconds (zero if it has not been solved)
+  double average_solve_time(const int_t subset_lid)const{
+    return profile_num_solves_[subset_lid] > 0 ? profile_solve_time_[subset_lid]/profile_num_solves_[subset_lid] : 0.0;
+  }
+
+  /// returns the number of solves that needed the given fallback path
+  /// \param subset_lid the local id of the subset
+  /// \param path one of SEARCH_INITIALIZATION_PATH, BACKUP_OPTIMIZATION_PATH or FAILED_SOLVE_PATH
+  int_t num_path_solves(const int_t subset_lid,
+    const Subset_Solve_Path path)const;
+
+  /// returns the paths taken in the last solve of the subset
+  int_t last_solve_path(const int_t subset_lid)const{
+    return profile_last_path_[subset_lid];
+  }
+
+  /// \brief returns the local ids of the most expensive subsets, most expensive first
+  /// \param num_subsets the number of subsets to return (all if larger than the profile)
+  std::vector<int_t> costliest_subsets(const int_t num_subsets)const;
+
+  /// \brief write the per-subset profile with one row per subset
+  /// \param file_name the name of the file to write
+  /// \param subset_gids the global id of each local subset
+  /// \param binary write the columns as raw arrays rather than comma separated text
+  void write_subset_profile(const std::string & file_name,
+    const std::vector<int_t> & subset_gids,
+    const bool binary=false)const;
+
+  /// write the tracking statistics and the per-subset profile to an open binary checkpoint file
+  /// \param file the file to write to
+  void write_checkpoint(std::FILE * file)const;
+
+  /// read the tracking statistics and the per-subset profile written by write_checkpoint(),
+  /// returns false if the file is truncated
+  /// \param file the file to read from
+  bool read_checkpoint(std::FILE * file);
+
 private:
   /// number of times backup optimization routine had to be used
   std::map<int_t,std::vector<int_t> > backup_optimization_call_frames_;
@@ -183,6 +298,22 @@ private:
   std::map<int_t,std::vector<int_t> > jump_tol_exceeded_frames_;
   /// failed initialization frames
   std::map<int_t,std::vector<int_t> > failed_init_frames_;
+  /// number of solves of each local subset
+  std::vector<int_t> profile_num_solves_;
+  /// total iterations of each local subset
+  std::vector<int_t> profile_total_iterations_;
+  /// largest iteration count of one solve of each local subset
+  std::vector<int_t> profile_max_iterations_;
+  /// number of solves that needed a search initialization
+  std::vector<int_t> profile_num_searches_;
+  /// number of solves that needed the backup optimization method
+  std::vector<int_t> profile_num_backup_opts_;
+  /// number of failed solves
+  std::vector<int_t> profile_num_failures_;
+  /// total solve time of each local subset in seconds
+  std::vector<double> profile_solve_time_;
+  /// the paths taken in the last solve of each local subset
+  std::vector<char> profile_last_path_;
 };
 
 /// \class DICe::Schema
@@ -267,7 +398,8 @@ public:
     Teuchos::RCP<std::vector<int_t> > neighbor_ids=Teuchos::null,
     const Teuchos::RCP<Teuchos::ParameterList> & params=Teuchos::null);
 
-  virtual ~Schema(){};
+  /// destructor (waits for any output of this schema still being written in the background)
+  virtual ~Schema();
 
   /// If a schema's parameters are changed, set_params() must be called again
   /// any params that aren't set are reset to the default value (so this method
@@ -280,6 +412,9 @@ public:
   void set_params(const std::string & params_file_name);
 
   /// \brief set the extents of the image to be used when only reading a portion of the image
+  ///
+  /// The extents cover all the subsets local to this processor (including the size of each subset)
+  /// plus a halo for the motion between frames and any search done by the initializers
   /// \param use_transformation_augmentation true if the right image is being projected into
   /// the left frame of reference for each frame (typicaly only set to true for nonlinear projection in the cross correlation)
   void update_extents(const bool use_transformation_augmentation=false);
@@ -305,6 +440,23 @@ public:
   void set_def_image(const std::string & defName,
     const int_t id=0);
 
+  /// returns the image parameters used when loading a deformed image from file
+  Teuchos::RCP<Teuchos::ParameterList> def_image_params()const;
+
+  /// \brief determines the portion of a deformed image that needs to be loaded based on the current extents
+  /// \param img_width width of the full image
+  /// \param img_height height of the full image
+  /// \param offset_x [out] offset of the region
+  /// \param offset_y [out] offset of the region
+  /// \param width [out] width of the region (-1 if the whole image is needed)
+  /// \param height [out] height of the region (-1 if the whole image is needed)
+  void def_image_region(const int_t img_width,
+    const int_t img_height,
+    int_t & offset_x,
+    int_t & offset_y,
+    int_t & width,
+    int_t & height)const;
+
   /// Replace the deformed image using an intensity array
   void set_def_image(const int_t img_width,
     const int_t img_height,
@@ -312,6 +464,8 @@ public:
     const int_t id=0);
 
   /// Replace the deformed image using an image
+  /// (when id is 0 and there are motion windows, the windows that have not been given their own sub image share this frame,
+  /// no pixels are copied and the frame is only filtered once)
   void set_def_image(Teuchos::RCP<Image> img,
     const int_t id=0);
 
@@ -319,6 +473,25 @@ public:
   void set_prev_image(Teuchos::RCP<Image> img,
     const int_t id=0);
 
+  /// Filter the deformed images and compute their gradients if this was deferred until
+  /// a subset has to be correlated (see test_motion_on_raw_pixels()), otherwise does nothing
+  void preprocess_def_images();
+
+  /// Returns true if the deformed images have not been filtered yet because the motion tests run on the raw pixels
+  bool def_preprocessing_pending()const{
+    return def_preprocessing_pending_;
+  }
+
+  /// Returns the unfiltered version of the deformed image for a motion window (null if the raw pixels are not kept)
+  Teuchos::RCP<Image> raw_def_img(const int_t index=0)const{
+    return index>=0&&index<(int_t)raw_def_imgs_.size() ? raw_def_imgs_[index] : Teuchos::null;
+  }
+
+  /// Returns the unfiltered version of the previous image for a motion window (null if there is none yet)
+  Teuchos::RCP<Image> raw_prev_img(const int_t index=0)const{
+    return index>=0&&index<(int_t)raw_prev_imgs_.size() ? raw_prev_imgs_[index] : Teuchos::null;
+  }
+
   /// Rotate the deformed image if requested
   void rotate_def_image();
 
@@ -337,11 +510,43 @@ public:
   /// returns 0 if successful
   int_t execute_correlation();
 
+  /// \brief Returns true if the subsets can be correlated subset-major over a batch of frames
+  /// (see execute_correlation_batch()). This requires the TRACKING_ROUTINE with independent subsets,
+  /// one deformed image (no motion windows), a total (not incremental) formulation and an initializer
+  /// that only reads the values of the subset itself.
+  bool supports_frame_batches()const;
+
+  /// \brief Adds the current deformed image to the batch of frames correlated by execute_correlation_batch()
+  ///
+  /// The image is filtered and its interpolants are prepared here since the frame is only set once for the batch.
+  void push_batch_frame();
+
+  /// \brief Correlates each subset over all of the frames added by push_batch_frame() before moving on
+  /// to the next subset (subset-major rather than frame-major)
+  ///
+  /// The reference intensities, shape function and history of a subset stay in cache for the whole batch.
+  /// The field values of every subset are stored for each frame, load_batch_frame() puts them back
+  /// into the fields so that the post processors and the output of each frame see the same values as
+  /// frame-major correlation. The subsets are correlated one after the other (not on multiple threads).
+  /// returns 0 if successful
+  int_t execute_correlation_batch();
+
+  /// \brief Puts the results of one frame of the batch in the fields and advances the frame id
+  /// (this takes the place of execute_correlation() for that frame)
+  /// \param index the index of the frame in the batch (in the order the frames were added)
+  void load_batch_frame(const int_t index);
+
+  /// Returns the number of frames added by push_batch_frame() since the last batch was started
+  int_t num_batch_frames()const{
+    return batch_def_imgs_.size();
+  }
+
   /// Conduct the cross correlation (a modified version of the regular correlation)
   /// returns 0 if successful
   int_t execute_cross_correlation();
 
-  /// projects the right image into the left frame (useful when the mapping between is highly nonlinear)
+  /// projects the right image into the left frame (useful when the mapping between is highly nonlinear),
+  /// the right image coordinates of each pixel are cached so later frames only interpolate
   /// \param tri a pointer to a triangulation that contains the projective parameters
   /// \param reference true if the transformation should be applied to the reference image
   void project_right_image_into_left_frame(Teuchos::RCP<Triangulation> tri,
@@ -361,6 +566,48 @@ public:
   /// Save off the q and r fields once the mapping from left to right image is known
   void save_cross_correlation_fields();
 
+  /// returns a hash of the inputs that determine the cross-correlation: the left and right reference
+  /// images, the calibration intrinsics and extrinsics, and the subsets owned by this processor
+  /// \param tri Triangulation that contains the camera params
+  /// \param input_params the input params are needed to load the reference images
+  std::uint64_t cross_correlation_cache_key(Teuchos::RCP<Triangulation> tri,
+    const Teuchos::RCP<Teuchos::ParameterList> & input_params);
+
+  /// write the cross-correlation result (projection parameters and the subset displacements, sigma and gamma)
+  /// to a binary file so that a later run with the same key can skip the cross-correlation,
+  /// call after execute_cross_correlation() and before save_cross_correlation_fields()
+  /// (with more than one processor each writes <file_name>.<num_procs>.<rank>)
+  /// \param file_name the name of the cache file
+  /// \param key the key from cross_correlation_cache_key()
+  /// \param tri Triangulation that contains the projection parameters
+  void write_cross_correlation_cache(const std::string & file_name,
+    const std::uint64_t key,
+    Teuchos::RCP<Triangulation> tri);
+
+  /// read a cross-correlation result written by write_cross_correlation_cache(), on success the projection
+  /// parameters and the fields are set as if execute_cross_correlation() had just run
+  /// returns false if the file does not exist or was written for a different key
+  /// \param file_name the name of the cache file
+  /// \param key the key from cross_correlation_cache_key()
+  /// \param tri Triangulation that receives the projection parameters
+  bool read_cross_correlation_cache(const std::string & file_name,
+    const std::uint64_t key,
+    Teuchos::RCP<Triangulation> tri);
+
+  /// write the correlation state at the end of a frame to a binary checkpoint file: the frame id, every mesh field
+  /// (including the previous states) and the tracking statistics, read_checkpoint() restores it in a later run
+  /// (with more than one processor each writes <file_name>.<num_procs>.<rank>)
+  /// \param file_name the name of the checkpoint file
+  /// \param frame_index the index in the image list of the last frame that was completed
+  void write_checkpoint(const std::string & file_name,
+    const int_t frame_index);
+
+  /// read a checkpoint written by write_checkpoint() with the same input files and number of processors,
+  /// returns the index in the image list of the last frame that was completed
+  /// (the images are not part of the checkpoint, the caller reloads the previous frame)
+  /// \param file_name the name of the checkpoint file
+  int_t read_checkpoint(const std::string & file_name);
+
   /// Triangulate the current positions of the subset centroids
   /// returns 0 if successful
   /// \param tri pointer to a triangulation
@@ -368,9 +615,35 @@ public:
   int_t execute_triangulation(Teuchos::RCP<Triangulation> tri,
     Teuchos::RCP<Schema> right_schema);
 
-  /// do clean up tasks
+  /// do clean up tasks at the end of a frame (including the compaction of the frame arenas)
   void post_execution_tasks();
 
+  /// \brief Redistribute the subsets among the processors if the work is not balanced
+  /// \param imbalance_threshold the subsets are redistributed if the max processor cost over the average is larger than this
+  /// \return true if the subsets were redistributed
+  ///
+  /// The cost of each subset is the number of active pixels times the number of iterations it took in the last frame.
+  /// The new decomposition gives each processor a compact region of the image with a balanced cost (see Decomp)
+  /// and all of the fields are migrated to the new owners. This is only done for the local generic routine
+  /// without obstructions or neighbor initialization (the subsets are independent). The extents of each processor
+  /// change so the images have to be reloaded by the caller after calling update_extents().
+  /// Must be called by all processors
+  bool rebalance(const scalar_t & imbalance_threshold);
+
+  /// \brief Replace the correlation points without constructing a new schema
+  /// \param coords_x the x coordinates of the new points
+  /// \param coords_y the y coordinates of the new points
+  /// \param source_gids for each new point the global id of the current point it continues (-1 for an added point)
+  ///
+  /// The new point i gets the global id i. The field values, objectives and motion histories of the
+  /// points that continue are carried over (an objective is only rebuilt if its point moved), the added
+  /// points start from the default field values. The images, parameters and post processors are kept.
+  /// Only for a square subset local analysis on one processor without subset file features
+  /// (conformal subsets, motion windows, obstructions, path files or optical flow flags).
+  void update_subsets(Teuchos::ArrayRCP<scalar_t> coords_x,
+    Teuchos::ArrayRCP<scalar_t> coords_y,
+    const std::vector<int_t> & source_gids);
+
   /// Returns if the field storage is initilaized
   int_t is_initialized()const{
     return is_initialized_;
@@ -428,6 +701,17 @@ public:
     return fast_solver_tolerance_;
   }
 
+  /// Returns the fraction of the noise induced displacement uncertainty used as the fast solver's
+  /// displacement tolerance (zero if the tolerance is not adapted to the noise)
+  double noise_adaptive_tolerance_factor()const{
+    return noise_adaptive_tolerance_factor_;
+  }
+
+  /// Returns the pixel stride used for the early iterations of the fast solver (1 means all pixels are used)
+  int_t progressive_sampling_stride()const{
+    return progressive_sampling_stride_;
+  }
+
   /// Returns the variation applied to the displacement initial guess in the simplex method
   double robust_delta_disp()const{
     return robust_delta_disp_;
@@ -535,22 +819,53 @@ public:
     const DICe::field_enums::Field_Spec spec){
     assert(local_id<local_num_subsets_);
     assert(local_id>=0);
+    // fields created after the cache was filled are looked up in the mesh's registry
+    const size_t index = field_cache_index(spec);
+    if(index<field_values_.size()&&field_values_[index]!=NULL)
+      return field_values_[index][local_id];
     return mesh_->get_field(spec)->local_value(local_id);
   }
 
+  /// \brief store a pointer to the local values of every field of the mesh so that
+  /// local_field_value() and global_field_value() don't search the field registry
+  ///
+  /// The translation between the local and global subset ids is copied into plain tables at the same
+  /// time, so the per subset accesses don't go through the distributed map (the map is only used again
+  /// when the subsets are redistributed, see rebalance()).
+  /// Called after the fields are created and at the start of each frame (not thread safe)
+  void cache_field_values();
+
   /// \brief Save off the current solution into the storage for frame n - 1 (only used if projection_method is VELOCITY_BASED)
   /// \param global_id global ID of correlation point
   void save_off_fields(const int_t global_id){
     DEBUG_MSG("Saving off solution nm1 for subset (global id) " << global_id);
+    const int_t local_id = subset_local_id(global_id);
     for(int_t i=0;i<DICe::field_enums::num_fields_defined;++i){
       DICe::field_enums::Field_Spec fs_nm1 = DICe::field_enums::fs_spec_vec[i];
       if(fs_nm1.get_state()!=DICe::field_enums::STATE_N_MINUS_ONE) continue;
       // build up a field spec for a no state field corresponding to the nm1 field
       DICe::field_enums::Field_Spec fs(fs_nm1.get_field_type(),fs_nm1.get_name(),fs_nm1.get_rank(),DICe::field_enums::NO_FIELD_STATE,true,true);
-      global_field_value(global_id,fs_nm1) = global_field_value(global_id,fs);
+      local_field_value(local_id,fs_nm1) = local_field_value(local_id,fs);
     }
   };
 
+  /// \brief Append the current displacement and rotation of a subset to its motion history
+  /// (only used if projection_method is POLYNOMIAL_BASED)
+  /// \param global_id global ID of correlation point
+  void record_motion_history(const int_t global_id);
+
+  /// \brief Predict the displacement and rotation of a subset for the current frame by a least squares
+  /// fit of a polynomial in the frame id (up to constant acceleration) to the subset's motion history
+  /// \param global_id global ID of correlation point
+  /// \param u [out] predicted x displacement
+  /// \param v [out] predicted y displacement
+  /// \param theta [out] predicted rotation
+  /// \return false if the subset has no motion history (the outputs are not modified)
+  bool predict_motion(const int_t global_id,
+    scalar_t & u,
+    scalar_t & v,
+    scalar_t & theta)const;
+
   /// \brief Print the field values to screen or to a file
   /// \param fileName Optional file name
   ///
@@ -621,11 +936,32 @@ public:
   /// The default is one file per frame with all subsets listed one per row.
   /// \param separate_header_file place the run information in another file rather than the header of the results
   /// \param no_text_output if true the text output files are not written
+  /// \param binary_output if true all frames are appended to one binary results file (<prefix>.dbr, see
+  /// DICe::Binary_Results_Writer) instead of writing text files, the run information goes in <prefix>.info
   void write_output(const std::string & output_folder,
     const std::string & prefix="DICe_solution",
     const bool separate_files_per_subset=false,
     const bool separate_header_file=false,
-    const bool no_text_output=false);
+    const bool no_text_output=false,
+    const bool binary_output=false);
+
+  /// \brief Write the text or binary output on a background thread
+  ///
+  /// The field values for the frame are copied by write_output() and the formatting and file writing is
+  /// done by the writer, so the next frame can be correlated while the output is written.
+  /// The exodus output for global DIC is still written by the calling thread.
+  /// \param writer the writer to use (can be shared by several schemas), null writes the output synchronously
+  void set_output_writer(const Teuchos::RCP<DICe::Output_Writer> & writer);
+
+  /// waits for the output submitted to the background writer to finish (no op if there is no writer)
+  void flush_output();
+
+  /// \brief sets a string appended to the name of the binary output file
+  /// (used when several independent schemas write the results for different frames)
+  /// \param suffix the string to append to the file name
+  void set_output_file_suffix(const std::string & suffix){
+    output_file_suffix_ = suffix;
+  }
 
   /// \brief Write the stats for a completed run
   /// \param output_folder Name of the folder for output (the file name is fixed)
@@ -686,13 +1022,118 @@ public:
   /// in the params file).
   ///
   /// \param obj A single DICe::Objective that has a DICe::subset as part of its member data
-  void generic_correlation_routine(Teuchos::RCP<Objective> obj);
+  /// \param shape_function (optional) shape function to reuse for the solve, it is cleared before use
+  void generic_correlation_routine(Teuchos::RCP<Objective> obj,
+    Teuchos::RCP<Local_Shape_Function> shape_function=Teuchos::null);
+
+  /// \brief Group the subsets owned by this processor into levels that can be correlated concurrently
+  ///
+  /// The subsets in each level only depend on subsets in previous levels (through the neighbor id
+  /// used for initialization), so the levels are executed in order and the subsets within a level in parallel.
+  /// If the dependencies can't be honored this way (obstructions, motion windows, or only one thread)
+  /// every subset gets its own level, which is the original serial ordering.
+  /// \param levels [out] vector of levels, each with the global ids of the subsets in that level
+  void create_correlation_levels(std::vector<std::vector<int_t> > & levels);
+
+  /// \brief Splits the correlation levels so the subsets the other processors need are correlated first
+  /// and their values exchanged while the rest are correlated (no op unless overlap_halo_exchange is on and applies).
+  /// The fields exchanged are the scalar fields the post processors requested as overlap fields on previous frames.
+  /// \param levels [in/out] the levels from create_correlation_levels, replaced by the boundary subsets
+  /// \param interior_levels [out] the levels to correlate after the exchange has been posted
+  /// \return true if a halo exchange should be posted after the returned levels are correlated
+  bool split_levels_for_halo_exchange(std::vector<std::vector<int_t> > & levels,
+    std::vector<std::vector<int_t> > & interior_levels);
+
+  /// \brief Orders the subsets within each level by their expected cost, most expensive first, so the
+  /// expensive subsets start first and the cheap ones fill in at the end of the level (no op for one thread).
+  /// The cost is the average solve time from the subset profile, or the iterations of the last solve
+  /// until every subset in the level has been timed. The levels themselves are not changed so the
+  /// neighbor dependencies are kept.
+  /// \param levels [in/out] the levels to order
+  void order_levels_by_cost(std::vector<std::vector<int_t> > & levels);
+
+  /// \brief Constructs the objectives for all the local subsets and solves the ones initialized from the
+  /// field values in one batched kernel on the device (no op unless use_batched_device_correlation is on and applies).
+  /// The batched solutions are picked up by generic_correlation_routine() through apply_batched_solution().
+  /// \param objs [out] the objectives in local id order (empty if the batch is not used)
+  void prepare_batched_solve(std::vector<Teuchos::RCP<Objective> > & objs);
+
+  /// \brief Constructs the static objectives of the TRACKING_ROUTINE if they haven't already been constructed
+  void create_tracking_objectives();
+
+  /// \brief Allocates the per subset motion history and low contrast checks if the number of subsets changed
+  void allocate_subset_histories();
+
+  /// \brief Copies the values of all the subset fields of one subset to or from a buffer (see execute_correlation_batch())
+  /// \param subset_lid the local id of the subset
+  /// \param values the buffer of batch_values_per_subset_ values
+  /// \param to_fields true to copy from the buffer to the fields, otherwise from the fields to the buffer
+  void copy_batch_subset_values(const int_t subset_lid,
+    scalar_t * values,
+    const bool to_fields);
+
+  /// \brief Correlates one subset in the GENERIC_ROUTINE using the calling thread's pooled objective and shape function
+  /// \param subset_gid the global id of the subset
+  /// \param batch_objs the objectives from prepare_batched_solve() (empty if the batch is not used)
+  /// \param shape_function_pool one shape function per thread
+  void correlate_pooled_subset(const int_t subset_gid,
+    const std::vector<Teuchos::RCP<Objective> > & batch_objs,
+    const std::vector<Teuchos::RCP<Local_Shape_Function> > & shape_function_pool);
+
+  /// \brief Returns true if the adaptive grid can be used for this analysis (see adaptive_grid_correlation())
+  bool adaptive_grid_applies();
+
+  /// \brief Finds the coarse grid subsets and the coarse cell corners of the other subsets
+  /// (only redone if the subsets change)
+  /// \return false if the subsets are not on a regular grid
+  bool create_adaptive_grid();
+
+  /// \brief Adaptive alternative to the correlation levels for a regular grid of subsets
+  ///
+  /// Only every adaptive_grid_coarsening-th subset in x and y is correlated first. The other subsets are
+  /// interpolated bilinearly from the corners of their coarse grid cell if the corners were all successful,
+  /// their gamma is below adaptive_grid_gamma_threshold and the estimated interpolation error (the non-affine part of the
+  /// corner displacements and the spread of the corner strains times the cell size) is below adaptive_grid_tolerance.
+  /// Otherwise the interpolated values are the initial guess (for the field value initializer) and the subset is correlated.
+  /// \param shape_function_pool one shape function per thread
+  void adaptive_grid_correlation(const std::vector<Teuchos::RCP<Local_Shape_Function> > & shape_function_pool);
+
+  /// \brief Reliability guided alternative to the correlation levels for neighbor initialized subsets
+  ///
+  /// The seeds (subsets without a local neighbor) are correlated first. The nearest neighbors of every
+  /// successfully correlated subset go into a priority queue ranked by the gamma of that subset, and the
+  /// best ranked subsets are taken from the queue in waves of one subset per thread. Before a subset is
+  /// correlated its NEIGHBOR_ID field is set to the subset it was queued from so the neighbor initializer
+  /// starts from the most reliable solution nearby. Subsets that can't be reached this way are correlated
+  /// afterwards in the original seed order.
+  /// \param batch_objs the objectives from prepare_batched_solve() (empty if the batch is not used)
+  /// \param shape_function_pool one shape function per thread
+  void reliability_guided_correlation(const std::vector<Teuchos::RCP<Objective> > & batch_objs,
+    const std::vector<Teuchos::RCP<Local_Shape_Function> > & shape_function_pool);
+
+  /// \brief Uses the batched solution for a subset in place of the gradient based solve if there is one
+  /// and it started from the same initial guess as the shape function
+  /// \param obj the objective for the subset
+  /// \param shape_function [out] the shape function to put the solution in
+  /// \param status [out] the status of the solve
+  /// \param num_iterations [out] the number of iterations the solve took
+  /// \return true if the batched solution was used
+  bool apply_batched_solution(Teuchos::RCP<Objective> obj,
+    Teuchos::RCP<Local_Shape_Function> shape_function,
+    Status_Flag & status,
+    int_t & num_iterations);
 
   /// Returns true if the user has requested testing for motion in the frame
   /// and the motion was detected by diffing pixel values:
   /// \param subset_gid the global id of the subset to test for motion
   bool motion_detected(const int_t subset_gid);
 
+  /// Returns true if the subset's reference intensities do not have enough contrast or gradients to correlate
+  /// (see low_contrast_threshold and low_sssig_threshold, the result of a check is reused for
+  /// low_contrast_recheck_interval frames)
+  /// \param obj the objective that holds the subset to test
+  bool rejected_for_low_contrast(Teuchos::RCP<Objective> obj);
+
   /// Fail the current frame for this subset and move on to the next
   /// \param subset_gid the global id of the subset
   /// \param status the reason for failure
@@ -730,6 +1171,37 @@ public:
     return levenberg_marquardt_regularization_factor_ > 0.0;
   }
 
+  /// returns true if the deformed images are copied into tiles for the Keys interpolation
+  bool use_tiled_image_layout()const{
+    return use_tiled_image_layout_;
+  }
+
+  /// returns true if the image gradients are computed one tile at a time when the subsets first need them
+  bool lazy_image_gradients()const{
+    return lazy_image_gradients_;
+  }
+
+  /// returns true if the deformed image gradients are the derivatives of the interpolant (no gradient images are stored)
+  bool analytic_def_gradients()const{
+    return analytic_def_gradients_;
+  }
+
+  /// returns true if the deformed images are interpolated with tabulated kernel weights
+  bool quantized_interpolation_weights()const{
+    return quantized_interpolation_weights_;
+  }
+
+  /// returns true if the frames read from files are shared by the processes on a node (see read_node_shared_image())
+  bool node_shared_images()const{
+    // the raw pixels are preprocessed in place later, so they can't be shared
+    return node_shared_images_&&!test_motion_on_raw_pixels();
+  }
+
+  /// returns true if the subsets read their reference intensities directly from the reference image
+  bool share_reference_intensities()const{
+    return share_reference_intensities_;
+  }
+
   /// returns true if the incremental formulation is used
   bool use_incremental_formulation()const{
     return use_incremental_formulation_;
@@ -740,6 +1212,11 @@ public:
     return use_nonlinear_projection_;
   }
 
+  /// Returns true if the images are gauss filtered (the filter is applied in place)
+  bool gauss_filter_images() const {
+    return gauss_filter_images_;
+  }
+
   // shape function controls:
   /// Returns true if all quadratic shape functions are enabled
   bool quadratic_shape_function_enabled() const {
@@ -781,6 +1258,27 @@ public:
     return output_beta_;
   }
 
+  /// \brief turn the computation of beta on or off (beta is recorded as 0.0 when it is off)
+  /// \param flag true if beta should be computed
+  void set_output_beta(const bool flag){
+    output_beta_ = flag;
+  }
+
+  /// Returns true if the image noise level is estimated for each subset (otherwise sigma is relative to a unit noise level)
+  bool compute_noise_level()const{
+    return compute_noise_level_;
+  }
+
+  /// Returns true if the contrast level of each subset is computed
+  bool compute_contrast_level()const{
+    return compute_contrast_level_;
+  }
+
+  /// Returns true if beta is estimated from the converged Gauss-Newton Hessian
+  bool analytic_beta()const{
+    return analytic_beta_;
+  }
+
   /// Evolve subsets as more pixels become visible that were previously obstructed
   bool use_subset_evolution()const{
     return use_subset_evolution_;
@@ -832,6 +1330,12 @@ public:
     frame_id_++;
   }
 
+  /// \brief Sets the current image frame number (used when the frames are not processed in sequence)
+  /// \param frame_id the frame number, the same value as frame_id() returns after the previous frame in sequence
+  void set_frame_id(const int_t frame_id){
+    frame_id_ = frame_id;
+  }
+
   /// Returns the current image frame (Nonzero only if multiple images are included in the sequence)
   int_t frame_id()const{
     return frame_id_;
@@ -877,6 +1381,42 @@ public:
     return pixel_integration_order_;
   }
 
+  /// Returns the number of threads used to correlate subsets concurrently on this processor
+  int_t num_threads()const{
+    return num_threads_;
+  }
+
+  /// Returns the window size used by the windowed phase correlation initializer
+  int_t phase_correlation_window_size()const{
+    return phase_correlation_window_size_;
+  }
+
+  /// Returns the number of pyramid levels used by the search initializers
+  int_t search_initialization_pyramid_levels()const{
+    return search_initialization_pyramid_levels_;
+  }
+
+  /// Returns the number of downsampled levels the subsets are correlated on before the full resolution correlation
+  int_t pyramid_correlation_levels()const{
+    return pyramid_correlation_levels_;
+  }
+
+  /// Returns true if neighbor initialized subsets are correlated in order of the neighbors' correlation quality
+  bool reliability_guided_propagation()const{
+    return reliability_guided_propagation_;
+  }
+
+  /// Returns the pixel sampling interval used by the motion window tests
+  int_t motion_window_sample_stride()const{
+    return motion_window_sample_stride_;
+  }
+
+  /// Returns true if the motion windows are tested on the unfiltered frames and the filter and gradients
+  /// are only applied to frames that have to be correlated
+  bool test_motion_on_raw_pixels()const{
+    return test_motion_on_raw_pixels_&&motion_window_params_->size()>0&&def_image_rotation_==ZERO_DEGREES;
+  }
+
   /// Return access to the post processors vector
   const std::vector<Teuchos::RCP<Post_Processor> > * post_processors(){
     return &post_processors_;
@@ -977,12 +1517,19 @@ public:
   /// Return the global id of a subset local id
   /// \param local_id the input local id to tranlate to global
   int_t subset_global_id(const int_t local_id){
+    // the ids are read from the tables filled by cache_field_values() once they exist
+    if(local_id>=0&&local_id<(int_t)subset_global_ids_.size())
+      return subset_global_ids_[local_id];
     return mesh_->get_scalar_node_dist_map()->get_global_element(local_id);
   }
 
-  /// Return the local id of a subset global id
+  /// Return the local id of a subset global id (-1 if the subset is not owned by this process)
   /// \param global_id the input global id to tranlate to local
   int_t subset_local_id(const int_t global_id){
+    if(!subset_global_ids_.empty()){
+      const int_t index = global_id - min_local_subset_gid_;
+      return index>=0&&index<(int_t)subset_local_ids_.size() ? subset_local_ids_[index] : -1;
+    }
     return mesh_->get_scalar_node_dist_map()->get_local_element(global_id);
   }
 
@@ -1017,6 +1564,23 @@ public:
   }
 
 private:
+  /// \brief points the motion window sub images that have not been set, or that shared the previous frame,
+  /// at the new frame in def_imgs_[0] so the windows are views into one filtered frame rather than copies
+  /// \param old_frame the frame that def_imgs_[0] held before it was replaced
+  void share_def_frame(const Teuchos::RCP<Image> & old_frame);
+
+  /// \brief filters a deformed image and computes its gradients as requested in the parameters
+  /// \param id the sub image id
+  void preprocess_def_image(const int_t id);
+
+  /// \brief computes the B-spline coefficients or tiled copies of the deformed images needed by the interpolation method
+  void prepare_def_interpolants();
+
+  /// \brief correlates the local subsets (translation only) on downsampled copies of the images, coarsest level first,
+  /// and stores the displacements in the fields so the full resolution solve starts from them
+  /// (see pyramid_correlation_levels())
+  void pyramid_pre_correlation();
+
   /// \brief Initializes the data structures for the schema
   /// \param input_params pointer to the initialization parameters
   /// \param correlation_params pointer to the correlation parameters
@@ -1051,11 +1615,27 @@ private:
   /// all owned map are the same. The dist_map is used to define the distributed
   /// ownership for which procs will correlate a given subset. This map is one-to-one
   /// with no overlap
-  void create_mesh(Teuchos::RCP<Decomp> decomp);
+  /// \param exo_name_suffix appended to the name of the exodus output file
+  void create_mesh(Teuchos::RCP<Decomp> decomp,
+    const std::string & exo_name_suffix="");
+
+  /// \brief returns the largest distance from the centroid to a pixel in the subset (in the reference configuration)
+  /// \param subset_gid global id of the subset
+  /// \param cx x coordinate of the subset centroid
+  /// \param cy y coordinate of the subset centroid
+  int_t subset_half_extent(const int_t subset_gid,
+    const scalar_t & cx,
+    const scalar_t & cy);
 
   /// create all of the fields necessary on the mesh
   void create_mesh_fields();
 
+  /// position of a field in the cache of field values (the registry orders the fields by name and state)
+  /// \param spec the field spec
+  static size_t field_cache_index(const DICe::field_enums::Field_Spec & spec){
+    return static_cast<size_t>(spec.get_name())*(DICe::field_enums::STATE_N_PLUS_ONE+1) + spec.get_state();
+  }
+
   /// Pointer to communicator (can be serial)
   comm_rcp comm_;
   /// The mesh holds the fields and subsets or elements and nodes
@@ -1072,10 +1652,34 @@ private:
   /// map assigns all nodes to all processors. This map is used for post-processors
   /// and output from process 0 or anywhere an all to all communication is needed.
   Teuchos::RCP<DICe::mesh::Mesh> mesh_;
+  /// pointers to the local values of the mesh fields indexed by field_cache_index() (null if not cached)
+  std::vector<mv_scalar_type*> field_values_;
+  /// global id of each local subset (filled by cache_field_values(), empty if there are no local subsets)
+  std::vector<int_t> subset_global_ids_;
+  /// local id of each global id from min_local_subset_gid_ to the largest local global id (-1 if not local)
+  std::vector<int_t> subset_local_ids_;
+  /// smallest global id owned by this process
+  int_t min_local_subset_gid_;
   /// Keeps track of the order of gids local to this process
   std::vector<int_t> this_proc_gid_order_;
   /// Vector of objective classes
   std::vector<Teuchos::RCP<Objective> > obj_vec_;
+  /// one reusable objective per thread for the generic correlation routine
+  std::vector<Teuchos::RCP<Objective> > objective_pool_;
+  /// ring buffers with the u, v, and theta solutions of the last few frames of each subset (see predict_motion())
+  std::vector<scalar_t> motion_history_;
+  /// frame id of each motion history entry
+  std::vector<int_t> motion_history_frames_;
+  /// number of valid entries in each subset's motion history
+  std::vector<int_t> motion_history_size_;
+  /// ring buffer position of the next motion history entry of each subset
+  std::vector<int_t> motion_history_next_;
+  /// right image coordinates of every left frame pixel used by project_right_image_into_left_frame
+  /// (the calibration is fixed, so the map is only rebuilt when the key below changes)
+  std::vector<scalar_t> projection_map_x_;
+  std::vector<scalar_t> projection_map_y_;
+  /// projective and warp parameters, frame size and image offsets the projection map was built for
+  std::vector<scalar_t> projection_map_key_;
   /// Pointer to reference image
   Teuchos::RCP<Image> ref_img_;
   /// Pointer to deformed image
@@ -1086,6 +1690,8 @@ private:
   std::vector<Teuchos::RCP<Image> > prev_imgs_;
   /// Vector of pointers to the post processing utilities
   std::vector<Teuchos::RCP<Post_Processor> > post_processors_;
+  /// Neighborhoods (kd-tree and neighbor lists) shared by the post processors
+  Teuchos::RCP<Neighborhood_Cache> neighborhood_cache_;
   /// True if any post_processors have been activated
   bool has_post_processor_;
   /// map of pointers to initializers (used to initialize first guess for optimization routine)
@@ -1098,6 +1704,8 @@ private:
   //Teuchos::SerialDenseMatrix<int_t,int_t> connectivity_;
   /// Square subset size (used only if subsets are not conformal)
   int_t subset_dim_;
+  /// largest distance from the centroid to a pixel of each conformal subset by global id (computed when first needed)
+  std::map<int_t,int_t> conformal_subset_half_extents_;
   /// Regular grid subset spacing in x direction (used only if subsets are not conformal)
   int_t step_size_x_;
   /// Regular grid subset spacing in y direction (used only if subsets are not conformal)
@@ -1112,6 +1720,10 @@ private:
   int_t max_solver_iterations_robust_;
   /// Fase solver convergence tolerance
   double fast_solver_tolerance_;
+  /// fraction of the noise induced displacement uncertainty used as the fast solver tolerance (0 is off)
+  double noise_adaptive_tolerance_factor_;
+  /// pixel stride for the early fast solver iterations (1 is off)
+  int_t progressive_sampling_stride_;
   /// Robust solver convergence tolerance
   double robust_solver_tolerance_;
   /// If gamma is less than this for the initial guess, the solve is skipped
@@ -1126,6 +1738,44 @@ private:
   bool has_output_spec_;
   /// Determines how the output is formatted
   Teuchos::RCP<DICe::Output_Spec> output_spec_;
+  /// Writes the binary results file (null unless binary output is requested)
+  Teuchos::RCP<DICe::Binary_Results_Writer> binary_results_writer_;
+  /// Buffers the rows of the output files for each subset (null unless separate files for each subset are requested)
+  Teuchos::RCP<DICe::Subset_Text_Writer> subset_text_writer_;
+  /// Writes the output on a background thread (null if the output is written synchronously)
+  Teuchos::RCP<DICe::Output_Writer> output_writer_;
+  /// image buffer reused by write_deformed_subsets_image() once the image of the previous frame has been written
+  std::shared_ptr<std::vector<intensity_t> > deformed_subsets_image_buffer_;
+  /// true if the overlap fields for the post processors are exchanged while the interior subsets are correlated
+  bool overlap_halo_exchange_;
+  /// non-blocking exchange of the overlap fields (created when first needed)
+  Teuchos::RCP<DICe::Halo_Exchange> halo_exchange_;
+  /// the fields being exchanged by the halo exchange
+  std::vector<field_enums::Field_Spec> halo_field_specs_;
+  /// true if the gradient based solves of a frame are batched on the device (Kokkos builds only)
+  bool use_batched_device_correlation_;
+  /// true if the subsets read their reference intensities from the reference image instead of a copy
+  bool share_reference_intensities_;
+  /// true if the deformed images are copied into tiles for the Keys interpolation
+  bool use_tiled_image_layout_;
+  /// true if the image gradients are computed one tile at a time when the subsets first need them
+  bool lazy_image_gradients_;
+  /// folder where the preprocessed reference image is cached (empty if there is no cache)
+  std::string reference_image_cache_folder_;
+  /// true if the deformed image gradients are the derivatives of the interpolant (no gradient images are stored)
+  bool analytic_def_gradients_;
+  /// true if the deformed images are interpolated with tabulated kernel weights
+  bool quantized_interpolation_weights_;
+  /// true if the frames read from files are shared by the processes on a node
+  bool node_shared_images_;
+#if DICE_KOKKOS
+  /// device resident reference data for the batched solve (rebuilt when the reference image changes)
+  Teuchos::RCP<DICe::Subset_Batch> subset_batch_;
+  /// the reference image the subset batch was packed from
+  Teuchos::RCP<Image> subset_batch_ref_img_;
+  /// true while the batched solutions of the current frame can be used
+  bool subset_batch_solved_;
+#endif
   /// Stores current fame number for a sequence of images
   int_t frame_id_;
   /// Stores the offset to the first image's index (cine files can start with a negative index)
@@ -1223,8 +1873,24 @@ private:
   double final_gamma_threshold_;
   /// tolerance for max_path_distance
   double path_distance_threshold_;
+  /// minimum standard deviation of the reference intensities of a subset (-1 if not checked)
+  double low_contrast_threshold_;
+  /// minimum SSSIG of a subset (-1 if not checked)
+  double low_sssig_threshold_;
+  /// number of frames the result of a low contrast check is reused for
+  int_t low_contrast_recheck_interval_;
+  /// frame id of the last low contrast check of each subset
+  std::vector<int_t> low_contrast_check_frame_;
+  /// result of the last low contrast check of each subset (-1 not checked yet, 0 passed, 1 rejected)
+  std::vector<int_t> low_contrast_rejected_;
   /// true if the beta parameter should be computed by the objective
   bool output_beta_;
+  /// true if beta should be estimated from the converged Hessian rather than by finite differences
+  bool analytic_beta_;
+  /// true if the noise level is estimated for each subset (needed for sigma, the noise level and the uncertainty output)
+  bool compute_noise_level_;
+  /// true if the contrast level of each subset is computed
+  bool compute_contrast_level_;
   /// true if search initialization should be used for failed steps (otherwise the subset is skipped)
   bool use_search_initialization_for_failed_steps_;
 #ifdef DICE_ENABLE_GLOBAL
@@ -1237,6 +1903,14 @@ private:
   bool use_incremental_formulation_;
   /// sort the txt output for full field results by coordinates so that they are in ascending order x, then y
   bool sort_txt_output_;
+  /// number of exodus output steps kept in memory before they are written
+  int_t exodus_output_buffer_size_;
+  /// appended to the output file names that can't change their subsets once written (set when the subsets are rebalanced)
+  std::string rebalance_suffix_;
+  /// appended to the name of the binary output file
+  std::string output_file_suffix_;
+  /// number of output frames written to previous exodus files (before the subsets were rebalanced)
+  int_t exodus_output_step_offset_;
   /// name of the file to read for the initial condition
   std::string initial_condition_file_;
   /// project the right image onto the left frame of reference using a nonlinear projection
@@ -1255,6 +1929,68 @@ private:
   Teuchos::RCP<Image_Deformer> image_deformer_;
   /// true if the laplacian images should be computed
   bool compute_laplacian_image_;
+  /// number of threads used to correlate subsets concurrently on this processor
+  int_t num_threads_;
+  /// window size for the windowed phase correlation initializer
+  int_t phase_correlation_window_size_;
+  /// matcher used by the feature matching initializer
+  Feature_Matcher feature_matcher_;
+  /// true if the feature matching initializer should write an image of the matches each frame
+  bool output_feature_matching_image_;
+  /// size of the tiles the feature matching initializer detects features in (0 for no tiles)
+  int_t feature_tile_size_;
+  /// maximum number of features kept in each tile by the feature matching initializer (0 for no limit)
+  int_t max_features_per_tile_;
+  /// extent of the search for failed steps in the tracking routine
+  scalar_t search_initialization_radius_;
+  /// number of pyramid levels used by the search initializers
+  int_t search_initialization_pyramid_levels_;
+  /// pixel sampling interval used by the motion window tests
+  int_t motion_window_sample_stride_;
+  /// number of downsampled levels correlated before the full resolution correlation
+  int_t pyramid_correlation_levels_;
+  /// propagate neighbor initialization from the best correlated subsets first
+  bool reliability_guided_propagation_;
+  /// only every n-th subset of the grid in x and y is correlated first (0 or 1 correlates every subset)
+  int_t adaptive_grid_coarsening_;
+  /// largest estimated interpolation error in pixels for the subsets between the coarse grid subsets
+  scalar_t adaptive_grid_tolerance_;
+  /// the subsets of a coarse grid cell are correlated if the gamma of a corner is above this value (0 does not check)
+  scalar_t adaptive_grid_gamma_threshold_;
+  /// true once create_adaptive_grid() has found the coarse grid for the current subsets
+  bool adaptive_grid_created_;
+  /// global ids of the local subsets on the coarse grid
+  std::vector<int_t> adaptive_coarse_gids_;
+  /// global ids of the local subsets between the coarse grid subsets
+  std::vector<int_t> adaptive_fine_gids_;
+  /// global ids of the four coarse cell corners of each subset in adaptive_fine_gids_ (-1 if the corner is not a subset)
+  std::vector<int_t> adaptive_corner_gids_;
+  /// bilinear weights of the four coarse cell corners of each subset in adaptive_fine_gids_
+  std::vector<scalar_t> adaptive_corner_weights_;
+  /// test the motion windows on the unfiltered frames and only filter frames that are correlated
+  bool test_motion_on_raw_pixels_;
+  /// true if the deformed images still have to be filtered and differentiated for this frame
+  bool def_preprocessing_pending_;
+  /// unfiltered versions of the deformed images (only kept when testing for motion on the raw pixels)
+  std::vector<Teuchos::RCP<Image> > raw_def_imgs_;
+  /// unfiltered versions of the previous images (only kept when testing for motion on the raw pixels)
+  std::vector<Teuchos::RCP<Image> > raw_prev_imgs_;
+  /// deformed images of the frames in the current batch (see push_batch_frame())
+  std::vector<Teuchos::RCP<Image> > batch_def_imgs_;
+  /// unfiltered deformed images of the frames in the current batch
+  std::vector<Teuchos::RCP<Image> > batch_raw_def_imgs_;
+  /// the fields with values for each subset and the number of values per subset in each field
+  std::vector<std::pair<Teuchos::RCP<MultiField>,int_t> > batch_fields_;
+  /// total number of field values for one subset
+  int_t batch_values_per_subset_;
+  /// field values of all the subsets for each frame of the batch
+  std::vector<std::vector<scalar_t> > batch_field_values_;
+  /// the previous images at the start of the batch
+  std::vector<Teuchos::RCP<Image> > batch_prev_imgs_;
+  /// the unfiltered previous images at the start of the batch
+  std::vector<Teuchos::RCP<Image> > batch_raw_prev_imgs_;
+  /// frame id at the start of the batch
+  int_t batch_first_frame_id_;
 };
 
 /// \class DICe::Output_Spec
@@ -1288,6 +2024,10 @@ public:
   void write_info(std::FILE * file,
     const bool include_time_of_day);
 
+  /// \brief Returns the run information written by write_info()
+  /// \param include_time_of_day stamp the start of the run
+  std::string info(const bool include_time_of_day);
+
   /// \brief appends statistics for each subset to the info file
   /// \param file Pointer to the output file (must already be open)
   void write_stats(std::FILE * file);
@@ -1303,6 +2043,29 @@ public:
     const int_t row_index,
     const int_t field_value_index);
 
+  /// \brief Writes the fields for the current frame using values copied by gather_values()
+  /// (the fields are not accessed so this can be called after they change)
+  /// \param file Pointer to the output file (must already be open)
+  /// \param row_index The label for the current row (typically frame_number or subset_id)
+  /// \param values the values from gather_values()
+  /// \param num_local_subsets the number of local subsets given to gather_values()
+  /// \param field_value_index Index of the subset in the values
+  void write_frame(std::FILE * file,
+    const int_t row_index,
+    const std::vector<scalar_t> & values,
+    const int_t num_local_subsets,
+    const int_t field_value_index);
+
+  /// \brief Returns the row that write_frame() writes for the values copied by gather_values()
+  /// \param row_index The label for the current row (typically frame_number or subset_id)
+  /// \param values the values from gather_values()
+  /// \param num_local_subsets the number of local subsets given to gather_values()
+  /// \param field_value_index Index of the subset in the values
+  std::string frame_row(const int_t row_index,
+    const std::vector<scalar_t> & values,
+    const int_t num_local_subsets,
+    const int_t field_value_index);
+
   /// provide access to the field_vec
   std::vector<Teuchos::RCP<MultiField> > * field_vec(){
     return &field_vec_;
@@ -1311,6 +2074,23 @@ public:
   /// gather all the fields necessary to write the output
   void gather_fields();
 
+  /// returns the names of the fields in output order
+  const std::vector<std::string> & field_names()const{
+    return field_names_;
+  }
+
+  /// returns true if the field with the given name label is written
+  /// \param name the field name label
+  bool has_field(const std::string & name)const{
+    return std::find(field_names_.begin(),field_names_.end(),name)!=field_names_.end();
+  }
+
+  /// \brief collect the output field values of the local subsets (gather_fields() must be called first)
+  /// \param values [out] the values stored by field, values[field*num_local_subsets + subset]
+  /// \param num_local_subsets the number of local subsets
+  void gather_values(std::vector<scalar_t> & values,
+    const int_t num_local_subsets);
+
 private:
   /// Vector of field names that will be output to file
   std::vector<std::string> field_names_;
@@ -49,7 +49,8 @@ namespace DICe {
 Simplex::Simplex(const Teuchos::RCP<Teuchos::ParameterList> & params):
   max_iterations_(1000),
   tolerance_(1.0E-8),
-  tiny_(1.0E-10)
+  tiny_(1.0E-10),
+  num_threads_(1)
 {
   if(params!=Teuchos::null){
     if(params->isParameter(DICe::max_iterations)) max_iterations_ = params->get<int_t>(DICe::max_iterations);
@@ -57,73 +58,141 @@ Simplex::Simplex(const Teuchos::RCP<Teuchos::ParameterList> & params):
   }
 }
 
+Simplex::Simplex(const int_t max_iterations,
+  const double tolerance):
+  max_iterations_(max_iterations),
+  tolerance_(tolerance),
+  tiny_(1.0E-10),
+  num_threads_(1)
+{}
+
 Status_Flag
 Simplex::minimize(Teuchos::RCP<std::vector<scalar_t> > variables,
   Teuchos::RCP<std::vector<scalar_t> > deltas,
   int_t & num_iterations,
   const scalar_t & threshold){
-  const int_t num_dofs = variables->size();
+  assert(variables!=Teuchos::null);
+  assert(deltas!=Teuchos::null);
+  // the rcp is held while the minimization runs so the default evaluate() can pass it to objective()
+  variables_ = variables;
+  Status_Flag status;
+  try{
+    status = minimize_variables(*variables,*deltas,num_iterations,threshold);
+  }
+  catch(...){
+    variables_ = Teuchos::null;
+    throw;
+  }
+  variables_ = Teuchos::null;
+  return status;
+}
+
+Status_Flag
+Simplex::minimize_variables(std::vector<scalar_t> & variables,
+  const std::vector<scalar_t> & deltas,
+  int_t & num_iterations,
+  const scalar_t & threshold){
+  // the common subset shape function sizes get a fixed size simplex on the stack
+  switch(variables.size()){
+  case 6: return nelder_mead<6>(variables,deltas,num_iterations,threshold);
+  case 12: return nelder_mead<12>(variables,deltas,num_iterations,threshold);
+  default: return nelder_mead<0>(variables,deltas,num_iterations,threshold);
+  }
+}
+
+void
+Simplex::evaluate_batch(std::vector<scalar_t> & variables,
+  const int_t num_points,
+  const scalar_t * points,
+  scalar_t * values){
+  const int_t num_dofs = variables.size();
+  for(int_t k=0;k<num_points;++k){
+    for(int_t j=0;j<num_dofs;++j)
+      variables[j] = points[k*num_dofs+j];
+    values[k] = evaluate(variables);
+  }
+}
+
+template<int_t N>
+Status_Flag
+Simplex::nelder_mead(std::vector<scalar_t> & variables,
+  const std::vector<scalar_t> & deltas,
+  int_t & num_iterations,
+  const scalar_t & threshold){
+  const int_t num_dofs = N>0 ? N : variables.size();
   assert(num_dofs>0);
-  assert((int_t)deltas->size()==num_dofs);
+  assert((int_t)variables.size()==num_dofs);
+  assert((int_t)deltas.size()==num_dofs);
 
   DEBUG_MSG("Conducting multidimensional simplex minimization");
   DEBUG_MSG("Max iterations: " << max_iterations_ << " tolerance: " << tolerance_);
   DEBUG_MSG("Initial guess: ");
 #ifdef DICE_DEBUG_MSG
   std::cout << " POINT 0: ";
-  for(int_t j=0;j<num_dofs;++j) std::cout << " " << (*variables)[j];
+  for(int_t j=0;j<num_dofs;++j) std::cout << " " << variables[j];
   std::cout << std::endl;
 #endif
 
-  // allocate temp storage for routine and initialize the simplex vertices
-  std::vector<scalar_t> init_variables(num_dofs,0.0);
+  // the simplex vertices (one row per vertex), gamma at each vertex, the column sums,
+  // the trial point and the initial guess all live in one block of storage
+  const int_t mpts = num_dofs + 1;
+  const int_t work_size = mpts*num_dofs + mpts + 3*num_dofs;
+  scalar_t fixed_work[N>0 ? (N+1)*N + (N+1) + 3*N : 1];
+  scalar_t * work = fixed_work;
+  if(N==0){
+    if((int_t)workspace_.size()<work_size)
+      workspace_.resize(work_size);
+    work = &workspace_[0];
+  }
+  scalar_t * points = work;
+  scalar_t * gamma_values = points + mpts*num_dofs;
+  scalar_t * points_column_sums = gamma_values + mpts;
+  scalar_t * ptry = points_column_sums + num_dofs;
+  scalar_t * init_variables = ptry + num_dofs;
+
   for(int_t i=0;i<num_dofs;++i)
-    init_variables[i] = (*variables)[i];
+    init_variables[i] = variables[i];
 
-  const int_t mpts = num_dofs + 1;
-  scalar_t * gamma_values = new scalar_t[mpts];
-  std::vector< Teuchos::RCP<std::vector<scalar_t> > > points(mpts);
+  // initialize the simplex vertices
   for(int_t i=0;i<mpts;++i){
-    points[i] = Teuchos::rcp(new std::vector<scalar_t>(num_dofs,0.0));
+    scalar_t * point = &points[i*num_dofs];
     // set the points for the initial bounding simplex
     for(int_t j=0;j<num_dofs;++j){
-      (*points[i])[j] = (*variables)[j];
+      point[j] = init_variables[j];
     }
     if(i>0)
-      (*points[i])[i-1] += (*deltas)[i-1];
+      point[i-1] += deltas[i-1];
 #ifdef DICE_DEBUG_MSG
     std::cout << " SIMPLEX POINT: ";
-    for(int_t j=0;j<num_dofs;++j) std::cout << " " << (*points[i])[j];
+    for(int_t j=0;j<num_dofs;++j) std::cout << " " << point[j];
     std::cout << std::endl;
 #endif
-    // evaluate gamma at these points
-    for(int_t j=0;j<num_dofs;++j)
-       (*variables)[j] = (*points[i])[j];
-    gamma_values[i] = objective(variables);
-    DEBUG_MSG("Gamma value for this point: " << gamma_values[i]);
-    if(i==0&&gamma_values[i]<threshold&&gamma_values[i]>=0.0){
-      num_iterations = 0;
-      DEBUG_MSG("Initial variables guess is good enough (gamma < " << threshold << " for this guess)");
-      return CORRELATION_SUCCESSFUL;
-    }
-    for(int_t j=0;j<num_dofs;++j)
-       (*variables)[j] = init_variables[j];
   }
+  // evaluate gamma at the initial guess first since the rest can be skipped if it is good enough
+  gamma_values[0] = evaluate(variables);
+  DEBUG_MSG("Gamma value for the initial guess: " << gamma_values[0]);
+  if(gamma_values[0]<threshold&&gamma_values[0]>=0.0){
+    num_iterations = 0;
+    DEBUG_MSG("Initial variables guess is good enough (gamma < " << threshold << " for this guess)");
+    return CORRELATION_SUCCESSFUL;
+  }
+  // the other vertices are independent so they are evaluated together
+  evaluate_batch(variables,num_dofs,&points[num_dofs],&gamma_values[1]);
+  for(int_t j=0;j<num_dofs;++j)
+     variables[j] = init_variables[j];
 
   // work variables
 
   int_t inhi;
   scalar_t ysave;
   int_t nfunk = 0;
-  scalar_t * points_column_sums = new scalar_t[num_dofs];
-  scalar_t * ptry = new scalar_t[num_dofs];
 
   // sum up the columns of the simplex vertices
 
   for (int_t j = 0; j < num_dofs; j++) {
     scalar_t sum = 0.0;
     for (int_t i = 0; i < mpts; i++) {
-      sum += (*points[i])[j];
+      sum += points[i*num_dofs+j];
     }
     points_column_sums[j] = sum;
   }
@@ -139,9 +208,6 @@ Simplex::minimize(Teuchos::RCP<std::vector<scalar_t> > variables,
   for (iteration=0; iteration < max_iterations_; iteration++) {
     if( iteration >= max_iterations_-1){
       DEBUG_MSG("Simplex method max iterations exceeded");
-      delete [] gamma_values;
-      delete [] points_column_sums;
-      delete [] ptry;
       num_iterations = iteration;
       return MAX_ITERATIONS_REACHED;
     }
@@ -170,14 +236,16 @@ Simplex::minimize(Teuchos::RCP<std::vector<scalar_t> > variables,
     if(gamma_repeats > gamma_repeats_allowed){
       DEBUG_MSG("*** Warning: simplex optimization exiting due to repeating gamma (loss of accuracy may occur)");
     }
+    scalar_t * point_hi = &points[ihi*num_dofs];
+    scalar_t * point_lo = &points[ilo*num_dofs];
     if (rtol < tolerance_ || rtol_diff < tolerance_ || gamma_repeats > gamma_repeats_allowed) {
       scalar_t dum = gamma_values[0];
       gamma_values[0] = gamma_values[ilo];
       gamma_values[ilo] = dum;
       for (int_t i = 0; i < num_dofs; i++) {
-        scalar_t dum2 = (*points[0])[i];
-        (*points[0])[i] = (*points[ilo])[i];
-        (*points[ilo])[i] = dum2;
+        scalar_t dum2 = points[i];
+        points[i] = point_lo[i];
+        point_lo[i] = dum2;
       }
       break;
     }
@@ -190,17 +258,17 @@ Simplex::minimize(Teuchos::RCP<std::vector<scalar_t> > variables,
     fac2 = fac1 - fac;
 
     for (int_t j = 0; j < num_dofs; j++)
-      ptry[j] = points_column_sums[j]*fac1 - (*points[ihi])[j]*fac2;
+      ptry[j] = points_column_sums[j]*fac1 - point_hi[j]*fac2;
 
     for(int_t n=0;n<num_dofs;++n)
-      (*variables)[n] = ptry[n];
-    ytry = objective(variables);
+      variables[n] = ptry[n];
+    ytry = evaluate(variables);
 
     if (ytry < gamma_values[ihi]) {
       gamma_values[ihi] = ytry;
       for (int_t j = 0; j < num_dofs; j++) {
-        points_column_sums[j] += ptry[j] - (*points[ihi])[j];
-        (*points[ihi])[j] = ptry[j];
+        points_column_sums[j] += ptry[j] - point_hi[j];
+        point_hi[j] = ptry[j];
       }
     }
     if (ytry <= gamma_values[ilo]) {
@@ -208,17 +276,17 @@ Simplex::minimize(Teuchos::RCP<std::vector<scalar_t> > variables,
       fac1 = (1.0 - fac)/num_dofs;
       fac2 = fac1 - fac;
       for (int_t j = 0; j < num_dofs; j++)
-        ptry[j] = points_column_sums[j]*fac1 - (*points[ihi])[j]*fac2;
+        ptry[j] = points_column_sums[j]*fac1 - point_hi[j]*fac2;
 
       for(int_t n=0;n<num_dofs;++n)
-        (*variables)[n] = ptry[n];
-      ytry = objective(variables);
+        variables[n] = ptry[n];
+      ytry = evaluate(variables);
 
       if (ytry < gamma_values[ihi]) {
         gamma_values[ihi] = ytry;
         for (int_t j = 0; j < num_dofs; j++) {
-          points_column_sums[j] += ptry[j] - (*points[ihi])[j];
-          (*points[ihi])[j] = ptry[j];
+          points_column_sums[j] += ptry[j] - point_hi[j];
+          point_hi[j] = ptry[j];
         }
       }
     } else if (ytry >= gamma_values[inhi]) {
@@ -227,51 +295,56 @@ Simplex::minimize(Teuchos::RCP<std::vector<scalar_t> > variables,
       fac1 = (1.0 - fac)/num_dofs;
       fac2 = fac1 - fac;
       for (int_t j = 0; j < num_dofs; j++)
-        ptry[j] = points_column_sums[j]*fac1 - (*points[ihi])[j]*fac2;
+        ptry[j] = points_column_sums[j]*fac1 - point_hi[j]*fac2;
 
       for(int_t n=0;n<num_dofs;++n)
-        (*variables)[n] = ptry[n];
-      ytry = objective(variables);
+        variables[n] = ptry[n];
+      ytry = evaluate(variables);
 
       if (ytry < gamma_values[ihi]) {
         gamma_values[ihi] = ytry;
         for (int_t j = 0; j < num_dofs; j++) {
-          points_column_sums[j] += ptry[j] - (*points[ihi])[j];
-          (*points[ihi])[j] = ptry[j];
+          points_column_sums[j] += ptry[j] - point_hi[j];
+          point_hi[j] = ptry[j];
         }
       }
       if (ytry >= ysave) {
+        // shrink the simplex towards the lowest vertex
         for (int_t i = 0; i < mpts; i++) {
           if (i != ilo) {
+            scalar_t * point = &points[i*num_dofs];
             for (int_t j = 0; j < num_dofs; j++)
-              (*points[i])[j] = points_column_sums[j] = 0.5*((*points[i])[j] + (*points[ilo])[j]);
-            for(int_t n=0;n<num_dofs;++n)
-              (*variables)[n] = points_column_sums[n];
-            gamma_values[i] = objective(variables);
+              point[j] = 0.5*(point[j] + point_lo[j]);
           }
         }
+        // the vertices before and after the lowest one are evaluated in (at most) two batches
+        if(ilo>0)
+          evaluate_batch(variables,ilo,&points[0],&gamma_values[0]);
+        if(ilo<mpts-1)
+          evaluate_batch(variables,mpts-1-ilo,&points[(ilo+1)*num_dofs],&gamma_values[ilo+1]);
+        // the variables are left at the last vertex that was moved
+        const int_t last = ilo==mpts-1 ? mpts-2 : mpts-1;
+        for(int_t n=0;n<num_dofs;++n)
+          variables[n] = points[last*num_dofs+n];
         nfunk += num_dofs;
 
         for (int_t j = 0; j < num_dofs; j++) {
           scalar_t sum = 0.0;
           for (int_t i = 0; i < mpts; i++)
-            sum += (*points[i])[j];
+            sum += points[i*num_dofs+j];
           points_column_sums[j] = sum;
         }
       }
     } else --nfunk;
 
-    gamma_new = objective(variables);
+    gamma_new = evaluate(variables);
 #ifdef DICE_DEBUG_MSG
     std::cout << "Iteration " << iteration;
-    for(int_t i=0;i<num_dofs;++i) std::cout << " " << (*variables)[i];
+    for(int_t i=0;i<num_dofs;++i) std::cout << " " << variables[i];
     std::cout << " nfunk: " << nfunk << " gamma: " << gamma_new << " rtol: " << rtol << " tol: " << tolerance_ << std::endl;
 #endif
   }
 
-  delete [] gamma_values;
-  delete [] points_column_sums;
-  delete [] ptry;
   num_iterations = iteration;
   return CORRELATION_SUCCESSFUL;
 }
@@ -280,10 +353,11 @@ Status_Flag
 Subset_Simplex::minimize(Teuchos::RCP<Local_Shape_Function> shape_function,
   int_t & num_iterations,
   const scalar_t & threshold){
-  if(shape_function_==Teuchos::null)
-    shape_function_=Teuchos::RCP<Local_Shape_Function>(shape_function);
+  // the simplex may be reused for many subsets so the shape function is always replaced
+  shape_function_ = shape_function;
   assert(shape_function_!=Teuchos::null);
-  return Simplex::minimize(shape_function_->rcp(),shape_function_->deltas(),num_iterations,threshold);
+  // the parameters are modified in place so no rcp has to be created for them
+  return minimize_variables(*shape_function_->parameters(),shape_function_->delta_values(),num_iterations,threshold);
 }
 
 Subset_Simplex::Subset_Simplex(const DICe::Objective * const obj,
@@ -295,12 +369,48 @@ Subset_Simplex::Subset_Simplex(const DICe::Objective * const obj,
   assert(obj_);
 }
 
+Subset_Simplex::Subset_Simplex(const DICe::Objective * const obj,
+  const int_t max_iterations,
+  const double tolerance):
+  Simplex(max_iterations,tolerance),
+  obj_(obj)
+{
+  assert(obj_);
+}
+
 scalar_t
 Subset_Simplex::objective(Teuchos::RCP<std::vector<scalar_t> > variables){
   assert(shape_function_->num_params()==(int_t)variables->size());
   return obj_->gamma(shape_function_);
 }
 
+scalar_t
+Subset_Simplex::evaluate(std::vector<scalar_t> & variables){
+  assert(shape_function_->num_params()==(int_t)variables.size());
+  return obj_->gamma(shape_function_);
+}
+
+void
+Subset_Simplex::evaluate_batch(std::vector<scalar_t> & variables,
+  const int_t num_points,
+  const scalar_t * points,
+  scalar_t * values){
+  const int_t num_dofs = variables.size();
+  assert(shape_function_->num_params()==num_dofs);
+  if((int_t)batch_functions_.size()<num_points)
+    batch_functions_.resize(num_points);
+  for(int_t k=0;k<num_points;++k){
+    if(batch_functions_[k]==Teuchos::null||batch_functions_[k]->num_params()!=num_dofs)
+      batch_functions_[k] = shape_function_factory(obj_->schema());
+    TEUCHOS_TEST_FOR_EXCEPTION(batch_functions_[k]->num_params()!=num_dofs,std::runtime_error,
+      "Error, the batch shape function does not match the simplex shape function");
+    std::vector<scalar_t> & params = *batch_functions_[k]->parameters();
+    for(int_t j=0;j<num_dofs;++j)
+      params[j] = points[k*num_dofs+j];
+  }
+  obj_->batch_gamma(num_points,&batch_functions_[0],values,num_threads_);
+}
+
 Homography_Simplex::Homography_Simplex(Teuchos::RCP<Image> left_img,
   Teuchos::RCP<Image> right_img,
   Triangulation * tri,
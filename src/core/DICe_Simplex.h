@@ -71,9 +71,33 @@ public:
   /// \param params Paramters that define the varaitions on the initial guess, convergence tolerance and max number of iterations
   Simplex(const Teuchos::RCP<Teuchos::ParameterList> & params=Teuchos::null);
 
+  /// \brief Constructor that takes the settings directly rather than through a parameter list
+  /// \param max_iterations the maximum number of iterations
+  /// \param tolerance the convergence tolerance
+  Simplex(const int_t max_iterations,
+    const double tolerance);
+
   /// destructor
   virtual ~Simplex(){};
 
+  /// set the maximum number of iterations
+  /// \param max_iterations the maximum number of iterations
+  void set_max_iterations(const int_t max_iterations){
+    max_iterations_ = max_iterations;
+  }
+
+  /// set the convergence tolerance
+  /// \param tolerance the convergence tolerance
+  void set_tolerance(const double tolerance){
+    tolerance_ = tolerance;
+  }
+
+  /// set the number of threads used by evaluate_batch() (only used if not already in a parallel region)
+  /// \param num_threads the number of threads
+  void set_num_threads(const int_t num_threads){
+    num_threads_ = num_threads;
+  }
+
   /// \brief Returns the status of the algorithm when complete
   /// \param variables [out] Taken as the initial guess for the first iteration and returned as the converged solution at successful completion.
   /// \param deltas The variations on the initial guess used to construct the other simplex points.
@@ -91,13 +115,58 @@ public:
   virtual scalar_t objective(Teuchos::RCP<std::vector<scalar_t> > variables)=0;
 
 protected:
+  /// \brief Minimization on a variables vector that is modified in place (see minimize() for the arguments)
+  ///
+  /// The simplex storage for 6 and 12 degrees of freedom is on the stack, other sizes use a workspace
+  /// owned by this class that is only reallocated when it needs to grow, so repeated calls don't allocate.
+  Status_Flag minimize_variables(std::vector<scalar_t> & variables,
+    const std::vector<scalar_t> & deltas,
+    int_t & num_iterations,
+    const scalar_t & threshold);
+
+  /// \brief evaluates the objective for the values currently stored in variables
+  ///
+  /// The default passes the rcp given to minimize() on to objective(). Derived classes that
+  /// call minimize_variables() directly have to override this.
+  /// \param variables the current guess at which to evaluate the objective
+  virtual scalar_t evaluate(std::vector<scalar_t> & variables){
+    assert(variables_!=Teuchos::null&&variables_.get()==&variables);
+    return objective(variables_);
+  }
+
+  /// \brief evaluates the objective at several independent points (the initial vertices and the shrink step)
+  ///
+  /// The default calls evaluate() for each point in turn. The contents of variables are unspecified on return.
+  /// \param variables the variables vector being minimized (may be used as scratch)
+  /// \param num_points the number of points
+  /// \param points the points to evaluate, one row of variables.size() values per point
+  /// \param values [out] the objective value at each point
+  virtual void evaluate_batch(std::vector<scalar_t> & variables,
+    const int_t num_points,
+    const scalar_t * points,
+    scalar_t * values);
+
   /// Maximum allowed iterations for convergence
   int_t max_iterations_;
   /// Convergence tolerance
   double tolerance_;
   /// Numerically small value
   scalar_t tiny_;
+  /// number of threads for evaluate_batch()
+  int_t num_threads_;
+
+private:
+  /// the Nelder-Mead iteration, N is the number of degrees of freedom or 0 if it is only known at run time
+  template<int_t N>
+  Status_Flag nelder_mead(std::vector<scalar_t> & variables,
+    const std::vector<scalar_t> & deltas,
+    int_t & num_iterations,
+    const scalar_t & threshold);
 
+  /// the variables passed to minimize(), only set while it runs
+  Teuchos::RCP<std::vector<scalar_t> > variables_;
+  /// simplex storage for the sizes that aren't on the stack
+  std::vector<scalar_t> workspace_;
 };
 
 
@@ -113,6 +182,14 @@ public:
   Subset_Simplex(const DICe::Objective * const obj,
     const Teuchos::RCP<Teuchos::ParameterList> & params=Teuchos::null);
 
+  /// \brief Constructor that takes the settings directly rather than through a parameter list
+  /// \param obj Pointer to a DICe::Objective, used to gain access to the gamma() method of the objective
+  /// \param max_iterations the maximum number of iterations
+  /// \param tolerance the convergence tolerance
+  Subset_Simplex(const DICe::Objective * const obj,
+    const int_t max_iterations,
+    const double tolerance);
+
   /// destructor
   virtual ~Subset_Simplex(){};
 
@@ -129,10 +206,23 @@ public:
     const scalar_t & threshold = 1.0E-10);
 
 protected:
+  /// evaluates gamma for the shape function directly since its parameters are the variables
+  /// \param variables the current guess at which to evaluate the objective
+  virtual scalar_t evaluate(std::vector<scalar_t> & variables);
+
+  /// evaluates gamma for all of the points in one call to Objective::batch_gamma()
+  /// (see the base class for the arguments)
+  virtual void evaluate_batch(std::vector<scalar_t> & variables,
+    const int_t num_points,
+    const scalar_t * points,
+    scalar_t * values);
+
   /// Pointer to a DICe::Objective, used to gain access to objective methods like gamma()
   const DICe::Objective * const obj_;
   /// Pointer to a shape function class
   Teuchos::RCP<Local_Shape_Function> shape_function_;
+  /// shape functions that hold the points of a batch evaluation (kept so they are only allocated once)
+  std::vector<Teuchos::RCP<Local_Shape_Function> > batch_functions_;
 };
 
 /// a derived optimization class specific for image homography between two cameras
@@ -0,0 +1,304 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_ThroughputTuner.h>
+#include <DICe_Schema.h>
+#include <DICe_ImageUtils.h>
+#include <DICe_Parser.h>
+#include <DICe_ParameterUtilities.h>
+
+#include <Teuchos_TestForException.hpp>
+#include <Teuchos_XMLParameterListHelpers.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace DICe {
+
+namespace {
+
+/// the correlation parameters that only control the tuning (they are not copied to the tuned parameters file)
+const char * const tuning_only_params[] = {
+  tune_throughput,
+  tune_throughput_sample_size,
+  tune_throughput_amplitude,
+  tune_throughput_noise_percent,
+  tune_throughput_max_error,
+  tune_throughput_output_file
+};
+
+/// rounds a subset size to the nearest odd number of pixels (at least 11)
+int_t
+odd_subset_size(const scalar_t & size){
+  int_t odd_size = static_cast<int_t>(size + 0.5);
+  if(odd_size%2==0) odd_size++;
+  return std::max(odd_size,(int_t)11);
+}
+
+/// removes a parameter from the list regardless of the case used for its name in the user's file
+void
+remove_param(Teuchos::ParameterList & params,
+  const std::string & name){
+  std::vector<std::string> matches;
+  for(Teuchos::ParameterList::ConstIterator it=params.begin();it!=params.end();++it){
+    std::string param_name = it->first;
+    to_lower(param_name);
+    if(param_name==name) matches.push_back(it->first);
+  }
+  for(size_t i=0;i<matches.size();++i)
+    params.remove(matches[i]);
+}
+
+/// sets the tuned parameters of a case (the interpolation method as an enum for a schema or as a string for a file)
+void
+set_case_params(Teuchos::ParameterList & params,
+  const Throughput_Tuning_Case & tuning_case,
+  const bool as_strings){
+  const char * const case_params[] = {interpolation_method,enable_translation,enable_rotation,enable_normal_strain,
+    enable_shear_strain,enable_quadratic_shape_function,fast_solver_tolerance};
+  for(size_t i=0;i<sizeof(case_params)/sizeof(case_params[0]);++i)
+    remove_param(params,case_params[i]);
+  if(as_strings)
+    params.set(interpolation_method,std::string(interpolationMethodStrings[tuning_case.interpolation_method_]));
+  else
+    params.set(interpolation_method,tuning_case.interpolation_method_);
+  params.set(enable_translation,true);
+  params.set(enable_rotation,true);
+  params.set(enable_normal_strain,tuning_case.affine_);
+  params.set(enable_shear_strain,tuning_case.affine_);
+  params.set(fast_solver_tolerance,(double)tuning_case.solver_tolerance_);
+}
+
+}
+
+void
+mark_pareto_front(std::vector<Throughput_Tuning_Case> & cases){
+  for(size_t i=0;i<cases.size();++i){
+    // cases that could not be evaluated have a negative error
+    cases[i].pareto_optimal_ = cases[i].avg_error_>=0.0;
+    for(size_t j=0;j<cases.size()&&cases[i].pareto_optimal_;++j){
+      if(i==j||cases[j].avg_error_<0.0) continue;
+      const bool as_good = cases[j].subsets_per_second_>=cases[i].subsets_per_second_&&cases[j].avg_error_<=cases[i].avg_error_;
+      const bool better = cases[j].subsets_per_second_>cases[i].subsets_per_second_||cases[j].avg_error_<cases[i].avg_error_;
+      if(as_good&&better) cases[i].pareto_optimal_ = false;
+    }
+  }
+}
+
+int_t
+select_tuning_case(const std::vector<Throughput_Tuning_Case> & cases,
+  const scalar_t & max_error){
+  int_t fastest = -1;
+  int_t most_accurate = -1;
+  for(size_t i=0;i<cases.size();++i){
+    const Throughput_Tuning_Case & c = cases[i];
+    if(c.avg_error_<0.0) continue;
+    if(max_error>=0.0&&c.avg_error_<=max_error){
+      if(fastest<0||c.subsets_per_second_>cases[fastest].subsets_per_second_||
+          (c.subsets_per_second_==cases[fastest].subsets_per_second_&&c.avg_error_<cases[fastest].avg_error_))
+        fastest = i;
+    }
+    if(most_accurate<0||c.avg_error_<cases[most_accurate].avg_error_||
+        (c.avg_error_==cases[most_accurate].avg_error_&&c.subsets_per_second_>cases[most_accurate].subsets_per_second_))
+      most_accurate = i;
+  }
+  return fastest>=0 ? fastest : most_accurate;
+}
+
+std::vector<Throughput_Tuning_Case>
+tune_throughput(Teuchos::RCP<Schema> schema,
+  Teuchos::RCP<Image> ref_img,
+  const Teuchos::RCP<Teuchos::ParameterList> & correlation_params,
+  const std::string & correlation_params_file,
+  const std::string & output_folder,
+  Teuchos::RCP<std::ostream> & outStream){
+  TEUCHOS_TEST_FOR_EXCEPTION(schema==Teuchos::null||ref_img==Teuchos::null,std::invalid_argument,"Error, the schema and reference image are required");
+  TEUCHOS_TEST_FOR_EXCEPTION(schema->analysis_type()!=LOCAL_DIC||schema->subset_dim()<=0,std::runtime_error,
+    "Error, the throughput tuning requires a local analysis with square subsets (subset_size)");
+  Teuchos::RCP<Teuchos::ParameterList> base_params = correlation_params!=Teuchos::null ?
+      Teuchos::rcp(new Teuchos::ParameterList(*correlation_params)) : Teuchos::rcp(new Teuchos::ParameterList());
+  const int_t sample_size = base_params->get<int_t>(DICe::tune_throughput_sample_size,200);
+  const scalar_t amplitude = base_params->get<double>(DICe::tune_throughput_amplitude,1.0);
+  const scalar_t noise_percent = base_params->get<double>(DICe::tune_throughput_noise_percent,0.0);
+  const scalar_t max_error = base_params->get<double>(DICe::tune_throughput_max_error,-1.0);
+  const std::string output_file = base_params->get<std::string>(DICe::tune_throughput_output_file,"tuned_correlation_params.xml");
+  TEUCHOS_TEST_FOR_EXCEPTION(sample_size<1,std::runtime_error,"Error, invalid tune_throughput_sample_size " << sample_size);
+  TEUCHOS_TEST_FOR_EXCEPTION(amplitude<=0.0,std::runtime_error,"Error, invalid tune_throughput_amplitude " << amplitude);
+
+  // the candidates span the subset size, interpolation, shape function and solver tolerance
+  Teuchos::ParameterList default_params;
+  dice_default_params(&default_params);
+  const scalar_t base_tolerance = base_params->get<double>(DICe::fast_solver_tolerance,default_params.get<double>(DICe::fast_solver_tolerance));
+  std::vector<int_t> subset_sizes;
+  subset_sizes.push_back(odd_subset_size(schema->subset_dim()*2.0/3.0));
+  subset_sizes.push_back(schema->subset_dim());
+  subset_sizes.push_back(odd_subset_size(schema->subset_dim()*4.0/3.0));
+  std::sort(subset_sizes.begin(),subset_sizes.end());
+  subset_sizes.erase(std::unique(subset_sizes.begin(),subset_sizes.end()),subset_sizes.end());
+  std::vector<Interpolation_Method> interps;
+  interps.push_back(BILINEAR);
+  interps.push_back(KEYS_FOURTH);
+  interps.push_back(QUINTIC_BSPLINE);
+  std::vector<Throughput_Tuning_Case> cases;
+  for(size_t s=0;s<subset_sizes.size();++s)
+    for(size_t m=0;m<interps.size();++m)
+      for(int_t affine=0;affine<2;++affine)
+        for(int_t loose=0;loose<2;++loose)
+          cases.push_back(Throughput_Tuning_Case(subset_sizes[s],interps[m],affine==1,loose==1?base_tolerance*10.0:base_tolerance));
+
+  // sample the user's subsets evenly, leaving out the ones where the largest candidate would leave the image
+  const scalar_t margin = subset_sizes.back()/2 + amplitude + 2.0;
+  std::vector<scalar_t> candidates_x;
+  std::vector<scalar_t> candidates_y;
+  for(int_t i=0;i<schema->local_num_subsets();++i){
+    const scalar_t x = schema->local_field_value(i,SUBSET_COORDINATES_X_FS);
+    const scalar_t y = schema->local_field_value(i,SUBSET_COORDINATES_Y_FS);
+    if(x<margin||y<margin||x>ref_img->width()-1-margin||y>ref_img->height()-1-margin) continue;
+    candidates_x.push_back(x);
+    candidates_y.push_back(y);
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(candidates_x.empty(),std::runtime_error,
+    "Error, no subset is far enough from the image boundary for the largest candidate subset size " << subset_sizes.back());
+  const int_t num_samples = std::min(sample_size,(int_t)candidates_x.size());
+  Teuchos::ArrayRCP<scalar_t> coords_x(num_samples,0.0);
+  Teuchos::ArrayRCP<scalar_t> coords_y(num_samples,0.0);
+  for(int_t i=0;i<num_samples;++i){
+    const size_t index = (size_t)i*candidates_x.size()/num_samples;
+    coords_x[i] = candidates_x[index];
+    coords_y[i] = candidates_y[index];
+  }
+
+  // the known motion has a period of half the image so the subsets see a range of gradients
+  const scalar_t period = 0.5*std::min(ref_img->width(),ref_img->height());
+  SinCos_Image_Deformer deformer(period,amplitude);
+  Teuchos::RCP<Image> def_img = deformer.deform_image(ref_img);
+  if(noise_percent>0.0)
+    add_noise_to_image(def_img,noise_percent);
+  *outStream << "Tuning " << cases.size() << " candidate configurations on " << num_samples << " of the "
+      << schema->local_num_subsets() << " subsets (motion amplitude " << amplitude << " px, period " << period << " px)" << std::endl;
+
+  // the evaluation runs do not depend on the neighbors of the (sparse) sample
+  base_params->set(DICe::correlation_routine,DICe::GENERIC_ROUTINE);
+  base_params->set(DICe::initialization_method,DICe::USE_FIELD_VALUES);
+  const int_t num_repeats = 2;
+  for(size_t c=0;c<cases.size();++c){
+    Throughput_Tuning_Case & tuning_case = cases[c];
+    Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList(*base_params));
+    set_case_params(*params,tuning_case,false);
+    try{
+      scalar_t best_time = std::numeric_limits<scalar_t>::max();
+      for(int_t repeat=0;repeat<num_repeats;++repeat){
+        Schema tuning_schema(coords_x,coords_y,tuning_case.subset_size_,Teuchos::null,Teuchos::null,params);
+        // the schema filters its images in place so each one gets a copy
+        tuning_schema.set_ref_image(Teuchos::rcp(new Image(ref_img)));
+        tuning_schema.set_def_image(Teuchos::rcp(new Image(def_img)));
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        tuning_schema.execute_correlation();
+        best_time = std::min(best_time,(scalar_t)std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+        if(repeat>0) continue;
+        // the correlation is deterministic so the error is only computed once
+        tuning_case.num_failed_ = 0;
+        scalar_t total_error = 0.0;
+        for(int_t i=0;i<tuning_schema.local_num_subsets();++i){
+          if(tuning_schema.local_field_value(i,SIGMA_FS)<0.0){
+            tuning_case.num_failed_++;
+            total_error += amplitude;
+            continue;
+          }
+          scalar_t error_x = 0.0;
+          scalar_t error_y = 0.0;
+          deformer.compute_displacement_error(tuning_schema.local_field_value(i,SUBSET_COORDINATES_X_FS),
+            tuning_schema.local_field_value(i,SUBSET_COORDINATES_Y_FS),
+            tuning_schema.local_field_value(i,SUBSET_DISPLACEMENT_X_FS),
+            tuning_schema.local_field_value(i,SUBSET_DISPLACEMENT_Y_FS),
+            error_x,error_y,true,false);
+          total_error += std::sqrt(error_x + error_y);
+        }
+        tuning_case.avg_error_ = total_error/num_samples;
+      }
+      tuning_case.subsets_per_second_ = best_time>0.0 ? num_samples/best_time : std::numeric_limits<scalar_t>::max();
+    }
+    catch(std::exception & e){
+      *outStream << "Warning: candidate " << c << " could not be evaluated: " << e.what() << std::endl;
+      tuning_case.avg_error_ = -1.0;
+    }
+  }
+  mark_pareto_front(cases);
+  const int_t selected = select_tuning_case(cases,max_error);
+  TEUCHOS_TEST_FOR_EXCEPTION(selected<0,std::runtime_error,"Error, none of the candidate configurations could be evaluated");
+
+  // report all of the cases, the Pareto front is also printed to the screen
+  const std::string report_name = output_folder + "throughput_tuning.txt";
+  std::FILE * report = fopen(report_name.c_str(),"w");
+  TEUCHOS_TEST_FOR_EXCEPTION(report==NULL,std::runtime_error,"Error, could not open " << report_name);
+  fprintf(report,"subset_size(px) interpolation_method shape_function solver_tolerance subsets_per_second avg_error(px) num_failed pareto_optimal selected\n");
+  *outStream << "\nPareto front of throughput vs. error (subset_size interpolation shape_function tolerance subsets/s error(px) failed):" << std::endl;
+  for(size_t c=0;c<cases.size();++c){
+    const Throughput_Tuning_Case & tc = cases[c];
+    const char * shape_function = tc.affine_ ? "AFFINE" : "RIGID";
+    fprintf(report,"%i %s %s %e %e %e %i %i %i\n",tc.subset_size_,interpolationMethodStrings[tc.interpolation_method_],shape_function,
+      tc.solver_tolerance_,tc.subsets_per_second_,tc.avg_error_,tc.num_failed_,(int_t)tc.pareto_optimal_,(int_t)((int_t)c==selected));
+    if(tc.pareto_optimal_)
+      *outStream << ((int_t)c==selected ? "* " : "  ") << tc.subset_size_ << " " << interpolationMethodStrings[tc.interpolation_method_] << " " << shape_function << " "
+          << tc.solver_tolerance_ << " " << tc.subsets_per_second_ << " " << tc.avg_error_ << " " << tc.num_failed_ << std::endl;
+  }
+  fclose(report);
+
+  // the tuned file keeps the user's other correlation parameters
+  const Throughput_Tuning_Case & best = cases[selected];
+  Teuchos::RCP<Teuchos::ParameterList> tuned_params = correlation_params_file.empty() ?
+      Teuchos::rcp(new Teuchos::ParameterList()) : read_input_params(correlation_params_file);
+  for(size_t i=0;i<sizeof(tuning_only_params)/sizeof(tuning_only_params[0]);++i)
+    remove_param(*tuned_params,tuning_only_params[i]);
+  set_case_params(*tuned_params,best,true);
+  const std::string tuned_name = output_folder + output_file;
+  Teuchos::writeParameterListToXmlFile(*tuned_params,tuned_name);
+  if(max_error>=0.0&&best.avg_error_>max_error)
+    *outStream << "Warning: no candidate meets tune_throughput_max_error " << max_error << " px, the most accurate one was selected" << std::endl;
+  *outStream << "\nThe selected configuration (*) was written to " << tuned_name << " and all of the cases to " << report_name << std::endl;
+  *outStream << "Use subset_size " << best.subset_size_ << " in the input parameters with the tuned correlation parameters" << std::endl;
+  return cases;
+}
+
+}// End DICe Namespace
@@ -0,0 +1,140 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_THROUGHPUTTUNER_H
+#define DICE_THROUGHPUTTUNER_H
+
+#include <DICe.h>
+#include <DICe_Image.h>
+
+#include <Teuchos_ParameterList.hpp>
+#include <Teuchos_RCP.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*!
+ *  \namespace DICe
+ *  @{
+ */
+/// generic DICe classes and functions
+namespace DICe {
+
+class Schema;
+
+/// \class DICe::Throughput_Tuning_Case
+/// \brief One candidate configuration of the throughput tuning and how it performed
+struct Throughput_Tuning_Case{
+  /// constructor
+  /// \param subset_size the subset size in pixels
+  /// \param interp the interpolation method
+  /// \param affine true if the normal and shear strains are enabled in addition to translation and rotation
+  /// \param solver_tolerance the fast solver tolerance
+  Throughput_Tuning_Case(const int_t subset_size=-1,
+    const Interpolation_Method interp=KEYS_FOURTH,
+    const bool affine=false,
+    const scalar_t & solver_tolerance=1.0E-4):
+    subset_size_(subset_size),
+    interpolation_method_(interp),
+    affine_(affine),
+    solver_tolerance_(solver_tolerance),
+    subsets_per_second_(0.0),
+    avg_error_(-1.0),
+    num_failed_(0),
+    pareto_optimal_(false){}
+  /// subset size in pixels
+  int_t subset_size_;
+  /// interpolation method
+  Interpolation_Method interpolation_method_;
+  /// true for the affine shape function, false for translation and rotation only
+  bool affine_;
+  /// fast solver tolerance
+  scalar_t solver_tolerance_;
+  /// number of sample subsets correlated per second (fastest repeat)
+  scalar_t subsets_per_second_;
+  /// average displacement error of the sample subsets in pixels (a failed subset counts as the motion amplitude)
+  scalar_t avg_error_;
+  /// number of sample subsets that failed to correlate
+  int_t num_failed_;
+  /// true if no other case is both at least as fast and at least as accurate (and better in one of them)
+  bool pareto_optimal_;
+};
+
+/// free function that marks the cases on the Pareto front of throughput vs. error
+/// \param cases the evaluated cases
+DICE_LIB_DLL_EXPORT
+void mark_pareto_front(std::vector<Throughput_Tuning_Case> & cases);
+
+/// free function that returns the index of the fastest case with an error at or below max_error,
+/// the most accurate case is returned if none meets the target or max_error is negative (-1 if there are no cases)
+/// \param cases the evaluated cases
+/// \param max_error the accuracy target in pixels
+DICE_LIB_DLL_EXPORT
+int_t select_tuning_case(const std::vector<Throughput_Tuning_Case> & cases,
+  const scalar_t & max_error);
+
+/// \brief free function that picks the subset size, interpolation method, shape function and solver tolerance
+/// for a local analysis by correlating candidate configurations on a sample of its subsets
+/// \param schema the schema of the analysis (provides the subset locations and the subset size)
+/// \param ref_img the full reference image of the analysis
+/// \param correlation_params the correlation parameters of the analysis (can be null)
+/// \param correlation_params_file the file the correlation parameters were read from (empty if none)
+/// \param output_folder the folder the report and the tuned parameters file are written to
+/// \param outStream output stream to write screen output to
+///
+/// The reference image is deformed with a known sin()*cos() motion and each candidate correlates the
+/// sample subsets. The throughput and error of every case are written to throughput_tuning.txt and the
+/// parameters of the selected case (see select_tuning_case()) to the tune_throughput_output_file. The other
+/// correlation parameters are copied from the user's file. Returns the evaluated cases.
+DICE_LIB_DLL_EXPORT
+std::vector<Throughput_Tuning_Case> tune_throughput(Teuchos::RCP<Schema> schema,
+  Teuchos::RCP<Image> ref_img,
+  const Teuchos::RCP<Teuchos::ParameterList> & correlation_params,
+  const std::string & correlation_params_file,
+  const std::string & output_folder,
+  Teuchos::RCP<std::ostream> & outStream);
+
+}// End DICe Namespace
+
+/*! @} End of Doxygen namespace*/
+
+#endif
@@ -45,7 +45,12 @@
 #include <DICe_Parser.h>
 
 #include <Teuchos_LAPACK.hpp>
+#include <algorithm>
+#include <cmath>
+#include <exception>
 #include <fstream>
+#include <limits>
+#include <random>
 
 namespace DICe {
 
@@ -264,6 +269,159 @@ compute_affine_matrix(const std::vector<scalar_t> proj_xl,
   return affine_matrix;
 }
 
+namespace {
+
+/// squared reprojection distance of a left point mapped through the 3x3 projection
+scalar_t
+projection_error_sq(const Teuchos::SerialDenseMatrix<int_t,double> & H,
+  const scalar_t & xl,
+  const scalar_t & yl,
+  const scalar_t & xr,
+  const scalar_t & yr){
+  const scalar_t denom = H(2,0)*xl + H(2,1)*yl + H(2,2);
+  if(denom==0.0) return std::numeric_limits<scalar_t>::max();
+  const scalar_t px = (H(0,0)*xl + H(0,1)*yl + H(0,2))/denom;
+  const scalar_t py = (H(1,0)*xl + H(1,1)*yl + H(1,2))/denom;
+  const scalar_t err = (px-xr)*(px-xr) + (py-yr)*(py-yr);
+  return std::isfinite(err) ? err : std::numeric_limits<scalar_t>::max();
+}
+
+/// returns true if any three of the four sample points are (nearly) collinear
+bool
+degenerate_sample(const std::vector<scalar_t> & x,
+  const std::vector<scalar_t> & y,
+  const size_t * ids){
+  for(int_t i=0;i<4;++i){
+    const size_t a = ids[i];
+    const size_t b = ids[(i+1)%4];
+    const size_t c = ids[(i+2)%4];
+    const scalar_t area = (x[b]-x[a])*(y[c]-y[a]) - (x[c]-x[a])*(y[b]-y[a]);
+    if(std::abs(area) < 1.0) return true;
+  }
+  return false;
+}
+
+/// converts the projective parameters from full resolution coordinates to the coordinates of a pyramid
+/// level (or back if to_level is false), pixel q of the level covers full resolution pixel p = s*q + (s-1)/2
+void
+convert_projective_params(const std::vector<scalar_t> & params_in,
+  std::vector<scalar_t> & params_out,
+  const scalar_t & s,
+  const bool to_level){
+  assert(params_in.size()==9);
+  assert(params_out.size()==9);
+  const scalar_t c = 0.5*(s-1.0);
+  // A maps level to full resolution coordinates, the level projection is A^-1 H A
+  const scalar_t A[9] = {s,0.0,c,0.0,s,c,0.0,0.0,1.0};
+  const scalar_t Ainv[9] = {1.0/s,0.0,-c/s,0.0,1.0/s,-c/s,0.0,0.0,1.0};
+  const scalar_t * left = to_level ? Ainv : A;
+  const scalar_t * right = to_level ? A : Ainv;
+  scalar_t tmp[9];
+  for(int_t i=0;i<3;++i)
+    for(int_t j=0;j<3;++j)
+      tmp[i*3+j] = params_in[i*3+0]*right[0*3+j] + params_in[i*3+1]*right[1*3+j] + params_in[i*3+2]*right[2*3+j];
+  for(int_t i=0;i<3;++i)
+    for(int_t j=0;j<3;++j)
+      params_out[i*3+j] = left[i*3+0]*tmp[0*3+j] + left[i*3+1]*tmp[1*3+j] + left[i*3+2]*tmp[2*3+j];
+}
+
+}
+
+DICE_LIB_DLL_EXPORT
+Teuchos::SerialDenseMatrix<int_t,double>
+compute_robust_affine_matrix(const std::vector<scalar_t> & proj_xl,
+  const std::vector<scalar_t> & proj_yl,
+  const std::vector<scalar_t> & proj_xr,
+  const std::vector<scalar_t> & proj_yr,
+  std::vector<bool> & inliers,
+  const scalar_t & inlier_tol,
+  const int_t max_trials){
+  DEBUG_MSG("compute_robust_affine_matrix(): begin");
+  const size_t num_coords = proj_xl.size();
+  TEUCHOS_TEST_FOR_EXCEPTION(num_coords<4,std::invalid_argument,"Error, at least 4 points are needed to estimate a projection");
+  TEUCHOS_TEST_FOR_EXCEPTION(proj_yl.size()!=num_coords||proj_xr.size()!=num_coords||proj_yr.size()!=num_coords,
+    std::invalid_argument,"Error, the point arrays must all be the same size");
+  const scalar_t tol_sq = inlier_tol*inlier_tol;
+  inliers.assign(num_coords,false);
+
+  // a fixed seed keeps the calibration repeatable from run to run
+  std::mt19937 generator(12345);
+  std::uniform_int_distribution<size_t> distribution(0,num_coords-1);
+  std::vector<scalar_t> sample_xl(4), sample_yl(4), sample_xr(4), sample_yr(4);
+  std::vector<bool> trial_inliers(num_coords,false);
+  size_t best_count = 0;
+  scalar_t best_error = std::numeric_limits<scalar_t>::max();
+  int_t num_trials = max_trials;
+  for(int_t trial=0;trial<num_trials;++trial){
+    size_t ids[4];
+    for(int_t i=0;i<4;++i){
+      bool repeat = true;
+      while(repeat){
+        ids[i] = distribution(generator);
+        repeat = false;
+        for(int_t j=0;j<i;++j)
+          if(ids[j]==ids[i]) repeat = true;
+      }
+    }
+    if(degenerate_sample(proj_xl,proj_yl,ids)||degenerate_sample(proj_xr,proj_yr,ids)) continue;
+    for(int_t i=0;i<4;++i){
+      sample_xl[i] = proj_xl[ids[i]];
+      sample_yl[i] = proj_yl[ids[i]];
+      sample_xr[i] = proj_xr[ids[i]];
+      sample_yr[i] = proj_yr[ids[i]];
+    }
+    Teuchos::SerialDenseMatrix<int_t,double> H;
+    try{
+      H = compute_affine_matrix(sample_xl,sample_yl,sample_xr,sample_yr);
+    }
+    catch(std::exception &){
+      continue;
+    }
+    size_t count = 0;
+    scalar_t error = 0.0;
+    for(size_t i=0;i<num_coords;++i){
+      const scalar_t err = projection_error_sq(H,proj_xl[i],proj_yl[i],proj_xr[i],proj_yr[i]);
+      trial_inliers[i] = err < tol_sq;
+      if(trial_inliers[i]){
+        count++;
+        error += err;
+      }
+    }
+    if(count > best_count || (count==best_count && count > 0 && error < best_error)){
+      best_count = count;
+      best_error = error;
+      inliers = trial_inliers;
+      // reduce the number of trials so that an all inlier sample has been drawn with 99% confidence
+      const scalar_t w = (scalar_t)count/num_coords;
+      const scalar_t p_good = w*w*w*w;
+      if(p_good >= 1.0) break;
+      const int_t needed = (int_t)std::ceil(std::log(0.01)/std::log(1.0-p_good));
+      if(needed > 0 && needed < num_trials) num_trials = needed;
+    }
+  }
+  DEBUG_MSG("compute_robust_affine_matrix(): " << best_count << " of " << num_coords << " points in the consensus set");
+  if(best_count < 4){
+    // no sample explained the data, fall back to the least squares fit of all the points
+    inliers.assign(num_coords,true);
+    return compute_affine_matrix(proj_xl,proj_yl,proj_xr,proj_yr);
+  }
+  // refit on the consensus set
+  std::vector<scalar_t> in_xl, in_yl, in_xr, in_yr;
+  in_xl.reserve(best_count);
+  in_yl.reserve(best_count);
+  in_xr.reserve(best_count);
+  in_yr.reserve(best_count);
+  for(size_t i=0;i<num_coords;++i){
+    if(!inliers[i]) continue;
+    in_xl.push_back(proj_xl[i]);
+    in_yl.push_back(proj_yl[i]);
+    in_xr.push_back(proj_xr[i]);
+    in_yr.push_back(proj_yr[i]);
+  }
+  DEBUG_MSG("compute_robust_affine_matrix(): end");
+  return compute_affine_matrix(in_xl,in_yl,in_xr,in_yr);
+}
+
 void
 Triangulation::convert_CB_angles_to_T(const scalar_t & alpha,
   const scalar_t & beta,
@@ -583,10 +741,24 @@ Triangulation::best_fit_plane(Teuchos::RCP<MultiField> & cx,
   Teuchos::RCP<MultiField> & cy,
   Teuchos::RCP<MultiField> & cz,
   Teuchos::RCP<MultiField> & sigma){
+  const int_t num_local_points = cx->get_map()->get_num_local_elements();
+  Point_Cloud_3D<scalar_t> points;
+  points.pts.resize(num_local_points);
+  for(int_t i=0;i<num_local_points;++i){
+    points.pts[i].x = cx->local_value(i);
+    points.pts[i].y = cy->local_value(i);
+    points.pts[i].z = cz->local_value(i);
+  }
+  best_fit_plane(points,sigma);
+}
+
+void
+Triangulation::best_fit_plane(const Point_Cloud_3D<scalar_t> & points,
+  const Teuchos::RCP<MultiField> & sigma){
 
   // create an all on all map for the K and F coeffs:
   // create all on zero map
-  MultiField_Comm comm = cx->get_map()->get_comm();
+  MultiField_Comm comm = sigma->get_map()->get_comm();
   const int_t num_entries = 9; // k11 k12 k13 k22 k23 k33 f1 f2 f3
   const int_t num_coeffs = 12; // R11 R12 R13 R21 R22 R23 R31 R32 R33 tx ty tz
   Teuchos::Array<int_t> all_on_all_ids(num_entries);
@@ -601,22 +773,28 @@ Triangulation::best_fit_plane(Teuchos::RCP<MultiField> & cx,
   Teuchos::RCP<MultiField_Map> all_on_all_coeff_map = Teuchos::rcp (new MultiField_Map(-1, all_on_all_coeff_ids,0,comm));
   Teuchos::RCP<MultiField> all_coeffs = Teuchos::rcp(new MultiField(all_on_all_coeff_map,1,true));
 
-  const int_t num_local_points = cx->get_map()->get_num_local_elements();
+  const int_t num_local_points = points.pts.size();
+  TEUCHOS_TEST_FOR_EXCEPTION(num_local_points!=sigma->get_map()->get_num_local_elements(),std::runtime_error,
+    "Error, the point cloud and the sigma field have a different number of points");
+  // the sums are accumulated locally and stored once in the field
+  scalar_t sums[9] = {0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0};
   for(int_t i=0;i<num_local_points;++i){
     if(sigma->local_value(i)<0.0) continue;
-    const scalar_t x = cx->local_value(i);
-    const scalar_t y = cy->local_value(i);
-    const scalar_t z = cz->local_value(i);
-    all_entries->local_value(0) += x*x;
-    all_entries->local_value(1) += x*y;
-    all_entries->local_value(2) += x;
-    all_entries->local_value(3) += y*y;
-    all_entries->local_value(4) += y;
-    all_entries->local_value(5) += 1.0;
-    all_entries->local_value(6) -= 1.0*x*z;
-    all_entries->local_value(7) -= 1.0*y*z;
-    all_entries->local_value(8) -= 1.0*z;
+    const scalar_t x = points.pts[i].x;
+    const scalar_t y = points.pts[i].y;
+    const scalar_t z = points.pts[i].z;
+    sums[0] += x*x;
+    sums[1] += x*y;
+    sums[2] += x;
+    sums[3] += y*y;
+    sums[4] += y;
+    sums[5] += 1.0;
+    sums[6] -= 1.0*x*z;
+    sums[7] -= 1.0*y*z;
+    sums[8] -= 1.0*z;
   }
+  for(int_t i=0;i<num_entries;++i)
+    all_entries->local_value(i) = sums[i];
   // broadcast the values to processor 0
   Teuchos::Array<int_t> all_on_zero_ids;
   Teuchos::Array<int_t> all_on_zero_coeff_ids;
@@ -1079,23 +1257,268 @@ scalar_t Triangulation::triangulate(const scalar_t & x0,
   return max_m;
 }
 
+void
+Triangulation::triangulate(const int_t num_points,
+  const scalar_t * x0,
+  const scalar_t * y0,
+  const scalar_t * x1,
+  const scalar_t * y1,
+  scalar_t * xc_out,
+  scalar_t * yc_out,
+  scalar_t * zc_out,
+  scalar_t * xw_out,
+  scalar_t * yw_out,
+  scalar_t * zw_out,
+  scalar_t * max_m_out,
+  const bool correct_lens_distortion,
+  const int_t num_threads){
+  triangulate_points(num_points,x0,y0,x1,y1,xc_out,yc_out,zc_out,xw_out,yw_out,zw_out,1,
+    max_m_out,correct_lens_distortion,num_threads);
+}
+
+void
+Triangulation::triangulate(const int_t num_points,
+  const scalar_t * x0,
+  const scalar_t * y0,
+  const scalar_t * x1,
+  const scalar_t * y1,
+  Point_Cloud_3D<scalar_t> & world_out,
+  scalar_t * max_m_out,
+  const bool correct_lens_distortion,
+  const int_t num_threads){
+  world_out.pts.resize(num_points);
+  if(num_points<=0) return;
+  // the coordinates of a point are stored next to each other
+  const int_t stride = sizeof(Point_Cloud_3D<scalar_t>::Point)/sizeof(scalar_t);
+  triangulate_points(num_points,x0,y0,x1,y1,NULL,NULL,NULL,
+    &world_out.pts[0].x,&world_out.pts[0].y,&world_out.pts[0].z,stride,
+    max_m_out,correct_lens_distortion,num_threads);
+}
+
+void
+Triangulation::triangulate_points(const int_t num_points,
+  const scalar_t * x0,
+  const scalar_t * y0,
+  const scalar_t * x1,
+  const scalar_t * y1,
+  scalar_t * xc_out,
+  scalar_t * yc_out,
+  scalar_t * zc_out,
+  scalar_t * xw_out,
+  scalar_t * yw_out,
+  scalar_t * zw_out,
+  const int_t world_stride,
+  scalar_t * max_m_out,
+  const bool correct_lens_distortion,
+  const int_t num_threads){
+  DEBUG_MSG("Triangulation::triangulate(): triangulating " << num_points << " points");
+  if(num_points<=0) return;
+  TEUCHOS_TEST_FOR_EXCEPTION(!x0||!y0||!x1||!y1||!xw_out||!yw_out||!zw_out,std::runtime_error,
+    "Error, invalid pointer passed to triangulate");
+  TEUCHOS_TEST_FOR_EXCEPTION(cal_intrinsics_.size()<2||cal_extrinsics_.size()<3||trans_extrinsics_.size()<4,std::runtime_error,
+    "Error, the calibration parameters have not been set");
+
+  // everything that does not depend on the point is hoisted out of the loop
+  // (see the single point version of triangulate() for the terms of the M matrix)
+  const double cx0 = cal_intrinsics_[0][0];
+  const double cy0 = cal_intrinsics_[0][1];
+  const double cx1 = cal_intrinsics_[1][0];
+  const double cy1 = cal_intrinsics_[1][1];
+  const double fx0 = cal_intrinsics_[0][2];
+  const double fy0 = cal_intrinsics_[0][3];
+  const double fs0 = cal_intrinsics_[0][4];
+  const double fx1 = cal_intrinsics_[1][2];
+  const double fy1 = cal_intrinsics_[1][3];
+  const double fs1 = cal_intrinsics_[1][4];
+  double k0[3],k1[3];
+  for(int_t i=0;i<3;++i){
+    k0[i] = cal_intrinsics_[0][5+i];
+    k1[i] = cal_intrinsics_[1][5+i];
+  }
+  double R3[3],A2[3],A3[3];
+  for(int_t i=0;i<3;++i){
+    R3[i] = cal_extrinsics_[2][i];
+    A2[i] = fx1*cal_extrinsics_[0][i] + fs1*cal_extrinsics_[1][i];
+    A3[i] = fy1*cal_extrinsics_[1][i];
+  }
+  const double tz = cal_extrinsics_[2][3];
+  const double r2_0 = -fx1*cal_extrinsics_[0][3] - fs1*cal_extrinsics_[1][3];
+  const double r3_0 = -fy1*cal_extrinsics_[1][3];
+  double T[3][4];
+  for(int_t i=0;i<3;++i)
+    for(int_t j=0;j<4;++j)
+      T[i][j] = trans_extrinsics_[i][j];
+  const double max_m_01 = std::max(std::abs(fx0),std::abs(fy0));
+
+  std::exception_ptr point_error;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) if(num_threads>1) schedule(static)
+#endif
+  for(int_t pt=0;pt<num_points;++pt){
+    double xs0 = x0[pt];
+    double ys0 = y0[pt];
+    double xs1 = x1[pt];
+    double ys1 = y1[pt];
+    if(correct_lens_distortion){
+      // same radial model as correct_lens_distortion_radial(), interpolated from the table if there is one
+      double dx = 0.0, dy = 0.0;
+      if(!lookup_lens_distortion_correction(xs0,ys0,0,dx,dy)){
+        const double r1 = (xs0-cx0)/cx0;
+        const double r2 = (ys0-cy0)/cy0;
+        const double rho = r1*r1 + r2*r2;
+        const double factor = rho*(k0[0] + rho*(k0[1] + rho*k0[2]));
+        dx = factor*r1*cx0;
+        dy = factor*r2*cy0;
+      }
+      xs0 -= dx;
+      ys0 -= dy;
+      if(!lookup_lens_distortion_correction(xs1,ys1,1,dx,dy)){
+        const double r1 = (xs1-cx1)/cx1;
+        const double r2 = (ys1-cy1)/cy1;
+        const double rho = r1*r1 + r2*r2;
+        const double factor = rho*(k1[0] + rho*(k1[1] + rho*k1[2]));
+        dx = factor*r1*cx1;
+        dy = factor*r2*cy1;
+      }
+      xs1 -= dx;
+      ys1 -= dy;
+    }
+    // rows of the 4x3 M matrix, the first two rows have zeros (M(1,0) = 0)
+    const double m02 = cx0 - xs0;
+    const double m12 = cy0 - ys0;
+    const double cmx = cx1 - xs1;
+    const double cmy = cy1 - ys1;
+    const double m20 = cmx*R3[0] + A2[0];
+    const double m21 = cmx*R3[1] + A2[1];
+    const double m22 = cmx*R3[2] + A2[2];
+    const double m30 = cmy*R3[0] + A3[0];
+    const double m31 = cmy*R3[1] + A3[1];
+    const double m32 = cmy*R3[2] + A3[2];
+    const double r2 = r2_0 - cmx*tz;
+    const double r3 = r3_0 - cmy*tz;
+    // M^TM (symmetric)
+    const double a00 = fx0*fx0 + m20*m20 + m30*m30;
+    const double a01 = fx0*fs0 + m20*m21 + m30*m31;
+    const double a02 = fx0*m02 + m20*m22 + m30*m32;
+    const double a11 = fs0*fs0 + fy0*fy0 + m21*m21 + m31*m31;
+    const double a12 = fs0*m02 + fy0*m12 + m21*m22 + m31*m32;
+    const double a22 = m02*m02 + m12*m12 + m22*m22 + m32*m32;
+    // M^Tr (only the last two entries of r are non-zero)
+    const double b0 = m20*r2 + m30*r3;
+    const double b1 = m21*r2 + m31*r3;
+    const double b2 = m22*r2 + m32*r3;
+    // solve the 3x3 normal equations with the adjugate
+    const double c00 = a11*a22 - a12*a12;
+    const double c01 = a02*a12 - a01*a22;
+    const double c02 = a01*a12 - a02*a11;
+    const double c11 = a00*a22 - a02*a02;
+    const double c12 = a01*a02 - a00*a12;
+    const double c22 = a00*a11 - a01*a01;
+    const double det = a00*c00 + a01*c01 + a02*c02;
+    if(det==0.0||det!=det){
+#ifdef _OPENMP
+#pragma omp critical(dice_triangulate_error)
+#endif
+      {
+        if(!point_error){
+          try{
+            TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,
+              "Error, could not invert the M matrix in triangulation for point " << pt);
+          }
+          catch(...){
+            point_error = std::current_exception();
+          }
+        }
+      }
+      continue;
+    }
+    const double inv_det = 1.0/det;
+    const double X = (c00*b0 + c01*b1 + c02*b2)*inv_det;
+    const double Y = (c01*b0 + c11*b1 + c12*b2)*inv_det;
+    const double Z = (c02*b0 + c12*b1 + c22*b2)*inv_det;
+    if(xc_out) xc_out[pt] = X;
+    if(yc_out) yc_out[pt] = Y;
+    if(zc_out) zc_out[pt] = Z;
+    // apply the camera 0 to world coord transform
+    const int_t w = pt*world_stride;
+    xw_out[w] = T[0][0]*X + T[0][1]*Y + T[0][2]*Z + T[0][3];
+    yw_out[w] = T[1][0]*X + T[1][1]*Y + T[1][2]*Z + T[1][3];
+    zw_out[w] = T[2][0]*X + T[2][1]*Y + T[2][2]*Z + T[2][3];
+    if(max_m_out) max_m_out[pt] = std::max(max_m_01,std::abs(m22));
+  }
+  if(point_error) std::rethrow_exception(point_error);
+}
+
 void
 Triangulation::correct_lens_distortion_radial(scalar_t & x_s,
   scalar_t & y_s,
   const int_t camera_id){
   assert(cal_intrinsics_.size()>0);
-  static scalar_t rho_tilde = 0.0; // = rho^2
-  static scalar_t r1 = 0.0;
-  static scalar_t r2 = 0.0;
-  static scalar_t factor = 0.0;
-  r1 = (x_s-cal_intrinsics_[camera_id][0])/cal_intrinsics_[camera_id][0]; // tested above to see that cx > 0 and cy > 0 when cal parameters loaded
-  r2 = (y_s-cal_intrinsics_[camera_id][1])/cal_intrinsics_[camera_id][1];
-  rho_tilde = r1*r1 + r2*r2;
-  factor = (cal_intrinsics_[camera_id][5]*rho_tilde + cal_intrinsics_[camera_id][6]*rho_tilde*rho_tilde
-      + cal_intrinsics_[camera_id][7]*rho_tilde*rho_tilde*rho_tilde);
-  //DEBUG_MSG("Triangulation::correct_lens_distortion(): corrections x " << factor*r1*cal_intrinsics_[camera_id][0] << " y " << factor*r2*cal_intrinsics_[camera_id][1]);
-  x_s = x_s - factor*r1*cal_intrinsics_[camera_id][0];
-  y_s = y_s - factor*r2*cal_intrinsics_[camera_id][1];
+  double dx = 0.0;
+  double dy = 0.0;
+  if(!lookup_lens_distortion_correction(x_s,y_s,camera_id,dx,dy))
+    lens_distortion_correction(x_s,y_s,camera_id,dx,dy);
+  //DEBUG_MSG("Triangulation::correct_lens_distortion(): corrections x " << dx << " y " << dy);
+  x_s = x_s - dx;
+  y_s = y_s - dy;
+}
+
+void
+Triangulation::lens_distortion_correction(const double & x_s,
+  const double & y_s,
+  const int_t camera_id,
+  double & dx,
+  double & dy)const{
+  const std::vector<scalar_t> & intrinsics = cal_intrinsics_[camera_id];
+  const double r1 = (x_s-intrinsics[0])/intrinsics[0]; // tested above to see that cx > 0 and cy > 0 when cal parameters loaded
+  const double r2 = (y_s-intrinsics[1])/intrinsics[1];
+  const double rho_tilde = r1*r1 + r2*r2; // = rho^2
+  const double factor = rho_tilde*(intrinsics[5] + rho_tilde*(intrinsics[6] + rho_tilde*intrinsics[7]));
+  dx = factor*r1*intrinsics[0];
+  dy = factor*r2*intrinsics[1];
+}
+
+scalar_t
+Triangulation::build_lens_distortion_map(const int_t width,
+  const int_t height,
+  const scalar_t & spacing){
+  TEUCHOS_TEST_FOR_EXCEPTION(cal_intrinsics_.size()<2,std::runtime_error,
+    "Error, the calibration parameters must be loaded before building the lens distortion map");
+  TEUCHOS_TEST_FOR_EXCEPTION(width<=0||height<=0,std::runtime_error,"Error, invalid sensor dimensions " << width << " x " << height);
+  TEUCHOS_TEST_FOR_EXCEPTION(spacing<=0.0,std::runtime_error,"Error, invalid lens distortion map spacing " << spacing);
+  clear_lens_distortion_map();
+  // one extra node past the last pixel on each side so every pixel center is inside the table
+  const int_t nx = (int_t)std::ceil(width/spacing) + 2;
+  const int_t ny = (int_t)std::ceil(height/spacing) + 2;
+  DEBUG_MSG("Triangulation::build_lens_distortion_map(): building a " << nx << " x " << ny << " table with spacing " << spacing);
+  for(int_t cam=0;cam<2;++cam){
+    lens_map_dx_[cam].resize(nx*ny);
+    lens_map_dy_[cam].resize(nx*ny);
+    for(int_t j=0;j<ny;++j){
+      for(int_t i=0;i<nx;++i){
+        lens_distortion_correction(i*spacing,j*spacing,cam,lens_map_dx_[cam][j*nx+i],lens_map_dy_[cam][j*nx+i]);
+      }
+    }
+  }
+  lens_map_nx_ = nx;
+  lens_map_ny_ = ny;
+  lens_map_spacing_ = spacing;
+  // check the accuracy of the table against the model at the cell centers (where the interpolation error is largest)
+  double max_error = 0.0;
+  double dx_map = 0.0, dy_map = 0.0, dx = 0.0, dy = 0.0;
+  for(int_t cam=0;cam<2;++cam){
+    for(int_t j=0;j<ny-2;++j){
+      for(int_t i=0;i<nx-2;++i){
+        const double x = (i+0.5)*spacing;
+        const double y = (j+0.5)*spacing;
+        lookup_lens_distortion_correction(x,y,cam,dx_map,dy_map);
+        lens_distortion_correction(x,y,cam,dx,dy);
+        max_error = std::max(max_error,std::max(std::abs(dx_map-dx),std::abs(dy_map-dy)));
+      }
+    }
+  }
+  DEBUG_MSG("Triangulation::build_lens_distortion_map(): max table error " << max_error << " pixels");
+  return max_error;
 }
 
 //void
@@ -1262,7 +1685,31 @@ Triangulation::estimate_projective_transform(Teuchos::RCP<Image> left_img,
     num_coords = proj_xl.size();
   }
 
-  Teuchos::SerialDenseMatrix<int_t,double> TrHtildeTl = compute_affine_matrix(proj_xl,proj_yl,proj_xr,proj_yr);
+  Teuchos::SerialDenseMatrix<int_t,double> TrHtildeTl;
+  if(use_nonlinear_projection){
+    // hand picked points are trusted as is
+    TrHtildeTl = compute_affine_matrix(proj_xl,proj_yl,proj_xr,proj_yr);
+  }
+  else{
+    // feature matches can contain mismatches that would skew a plain least squares fit
+    std::vector<bool> inliers;
+    TrHtildeTl = compute_robust_affine_matrix(proj_xl,proj_yl,proj_xr,proj_yr,inliers);
+    int_t num_inliers = 0;
+    for(int_t i=0;i<num_coords;++i){
+      if(!inliers[i]) continue;
+      proj_xl[num_inliers] = proj_xl[i];
+      proj_yl[num_inliers] = proj_yl[i];
+      proj_xr[num_inliers] = proj_xr[i];
+      proj_yr[num_inliers] = proj_yr[i];
+      num_inliers++;
+    }
+    DEBUG_MSG("Triangulation::estimate_projective_transform(): " << num_inliers << " of " << num_coords << " feature matches are inliers");
+    num_coords = num_inliers;
+    proj_xl.resize(num_coords);
+    proj_yl.resize(num_coords);
+    proj_xr.resize(num_coords);
+    proj_yr.resize(num_coords);
+  }
   (*projective_params_)[0] = TrHtildeTl(0,0);
   (*projective_params_)[1] = TrHtildeTl(0,1);
   (*projective_params_)[2] = TrHtildeTl(0,2);
@@ -1311,10 +1758,6 @@ Triangulation::estimate_projective_transform(Teuchos::RCP<Image> left_img,
   //TEUCHOS_TEST_FOR_EXCEPTION(error > 100.0,std::runtime_error,"Error, initial projection error too large");
 
   // simplex optimize the coefficients
-  Teuchos::RCP<Teuchos::ParameterList> params = rcp(new Teuchos::ParameterList());
-  params->set(DICe::max_iterations,200);
-  params->set(DICe::tolerance,0.00001);
-  DICe::Homography_Simplex simplex(left_img,right_img,this,params);
   Teuchos::RCP<std::vector<scalar_t> > deltas = Teuchos::rcp(new std::vector<scalar_t>(9,0.0));
   if(use_nonlinear_projection){
     for(size_t i=0;i<deltas->size();++i){
@@ -1335,7 +1778,53 @@ Triangulation::estimate_projective_transform(Teuchos::RCP<Image> left_img,
     (*deltas)[8] = 0.0001;
   }
   int_t num_iterations = 0;
-  Status_Flag corr_status = simplex.minimize(projective_params_,deltas,num_iterations);
+  Status_Flag corr_status;
+
+  // refine coarse to fine on the image pyramid where each objective evaluation is cheap,
+  // the pyramid coordinates only map onto the projection when the warp is still the identity
+  const std::vector<scalar_t> & wp = *warp_params_;
+  bool identity_warp = wp[1]==1.0 && wp[8]==1.0;
+  for(size_t i=0;i<wp.size();++i)
+    if(i!=1&&i!=8&&wp[i]!=0.0) identity_warp = false;
+  int_t num_levels = 0;
+  while(num_levels<3 && std::min(left_img->width(),left_img->height())/(2<<num_levels) >= 128) num_levels++;
+  if(identity_warp && num_levels > 0){
+    Teuchos::RCP<std::vector<scalar_t> > full_params = projective_params_;
+    Teuchos::RCP<std::vector<scalar_t> > level_params = Teuchos::rcp(new std::vector<scalar_t>(9,0.0));
+    Teuchos::RCP<std::vector<scalar_t> > level_deltas = Teuchos::rcp(new std::vector<scalar_t>(9,0.0));
+    Teuchos::RCP<Teuchos::ParameterList> level_simplex_params = rcp(new Teuchos::ParameterList());
+    level_simplex_params->set(DICe::max_iterations,200);
+    level_simplex_params->set(DICe::tolerance,0.00001);
+    for(int_t level=num_levels;level>=1;--level){
+      const scalar_t s = 1 << level;
+      convert_projective_params(*full_params,*level_params,s,true);
+      // the translation terms shrink with the level and the perspective terms grow
+      *level_deltas = *deltas;
+      (*level_deltas)[2] /= s;
+      (*level_deltas)[5] /= s;
+      (*level_deltas)[6] *= s;
+      (*level_deltas)[7] *= s;
+      DICe::Homography_Simplex level_simplex(left_img->pyramid_level(level),right_img->pyramid_level(level),this,level_simplex_params);
+      int_t level_iterations = 0;
+      corr_status = level_simplex.minimize(level_params,level_deltas,level_iterations);
+      // the objective points this triangulation at the level parameters, restore the full resolution storage
+      set_projective_params(full_params);
+      if(corr_status!=CORRELATION_SUCCESSFUL){
+        DEBUG_MSG("Triangulation::estimate_projective_transform(): pyramid level " << level << " refinement failed, keeping the previous estimate");
+        continue;
+      }
+      convert_projective_params(*level_params,*full_params,s,false);
+      DEBUG_MSG("Triangulation::estimate_projective_transform(): pyramid level " << level << " refinement took " << level_iterations << " iterations");
+    }
+  }
+
+  // the full resolution simplex polishes the estimate, starting from the pyramid solution it
+  // typically converges in a fraction of the iterations the cold start needed
+  Teuchos::RCP<Teuchos::ParameterList> params = rcp(new Teuchos::ParameterList());
+  params->set(DICe::max_iterations,200);
+  params->set(DICe::tolerance,0.00001);
+  DICe::Homography_Simplex simplex(left_img,right_img,this,params);
+  corr_status = simplex.minimize(projective_params_,deltas,num_iterations);
   TEUCHOS_TEST_FOR_EXCEPTION(corr_status!=CORRELATION_SUCCESSFUL,std::runtime_error,"Error, could not determine projective transform.");
 
   filePtr = fopen("projection_out.dat","a");
@@ -44,6 +44,7 @@
 
 #include <DICe.h>
 #include <DICe_Image.h>
+#include <DICe_PointCloud.h>
 #ifdef DICE_TPETRA
   #include "DICe_MultiFieldTpetra.h"
 #else
@@ -70,6 +71,27 @@ compute_affine_matrix(const std::vector<scalar_t> proj_xl,
   const std::vector<scalar_t> proj_xr,
   const std::vector<scalar_t> proj_yr);
 
+/// free function to estimate a 9 parameter affine projection from matches that may contain outliers,
+/// random four point samples are fit and scored by reprojection error (RANSAC) and the winning
+/// consensus set is refit with compute_affine_matrix
+/// \param proj_xl x coordinates of the points in the left image or coordinate system
+/// \param proj_yl y coordinates of the points in the left image or coordinate system
+/// \param proj_xr x coordinates of the points in the right image or coordinate system
+/// \param proj_yr y coordinates of the points in the right image or coordinate system
+/// \param inliers output flag for each point, true if it is in the consensus set
+/// \param inlier_tol reprojection distance in pixels below which a point counts as an inlier
+/// \param max_trials the maximum number of random samples to fit
+/// return value affine_matrix storage for the affine parameters (must be 3x3)
+DICE_LIB_DLL_EXPORT
+Teuchos::SerialDenseMatrix<int_t,double>
+compute_robust_affine_matrix(const std::vector<scalar_t> & proj_xl,
+  const std::vector<scalar_t> & proj_yl,
+  const std::vector<scalar_t> & proj_xr,
+  const std::vector<scalar_t> & proj_yr,
+  std::vector<bool> & inliers,
+  const scalar_t & inlier_tol=2.0,
+  const int_t max_trials=1000);
+
 /// \class DICe::Triangulation
 /// \brief A class for computing the triangulation of 3d points from two correlation and a calibration file
 ///
@@ -78,7 +100,10 @@ Triangulation{
 public:
   /// \brief Default constructor
   /// \param param_file_name the name of the file to parse the calibration parameters from
-  Triangulation(const std::string & param_file_name){
+  Triangulation(const std::string & param_file_name):
+    lens_map_spacing_(0.0),
+    lens_map_nx_(0),
+    lens_map_ny_(0){
     warp_params_ = Teuchos::rcp(new std::vector<scalar_t>(12,0.0)); /// at max there are 12 parameters that must be set (for the quadratic)
     (*warp_params_)[1] = 1.0;
     (*warp_params_)[8] = 1.0;
@@ -90,7 +115,10 @@ public:
   };
 
   /// \brief constructor with no args
-  Triangulation(){
+  Triangulation():
+    lens_map_spacing_(0.0),
+    lens_map_nx_(0),
+    lens_map_ny_(0){
     warp_params_ = Teuchos::rcp(new std::vector<scalar_t>(12,0.0));
     (*warp_params_)[1] = 1.0;
     (*warp_params_)[8] = 1.0;
@@ -145,6 +173,60 @@ public:
     scalar_t & zw_out,
     const bool correct_lens_distortion = false);
 
+  /// triangulate a whole set of points in 3D, equivalent to calling the single point version
+  /// of triangulate() for each point, but without the temporary matrices and with the lens
+  /// distortion correction fused into the same pass. The arrays are all of length num_points
+  /// and the points are processed concurrently if num_threads > 1 (and OpenMP is enabled)
+  /// \param num_points the number of points to triangulate
+  /// \param x0 sensor x coordinates of the points in camera 0
+  /// \param y0 sensor y coordinates of the points in camera 0
+  /// \param x1 sensor x coordinates of the points in camera 1
+  /// \param y1 sensor y coordinates of the points in camera 1
+  /// \param xc_out [out] global x positions in camera 0 coords (can be NULL if not needed)
+  /// \param yc_out [out] global y positions in camera 0 coords (can be NULL if not needed)
+  /// \param zc_out [out] global z positions in camera 0 coords (can be NULL if not needed)
+  /// \param xw_out [out] global x positions in world coords
+  /// \param yw_out [out] global y positions in world coords
+  /// \param zw_out [out] global z positions in world coords
+  /// \param max_m_out [out] the max value of the psuedo matrix for each point (can be NULL if not needed)
+  /// \param correct_lens_distortion correct for lens distortion
+  /// \param num_threads the number of threads to use
+  void triangulate(const int_t num_points,
+    const scalar_t * x0,
+    const scalar_t * y0,
+    const scalar_t * x1,
+    const scalar_t * y1,
+    scalar_t * xc_out,
+    scalar_t * yc_out,
+    scalar_t * zc_out,
+    scalar_t * xw_out,
+    scalar_t * yw_out,
+    scalar_t * zw_out,
+    scalar_t * max_m_out = NULL,
+    const bool correct_lens_distortion = false,
+    const int_t num_threads = 1);
+
+  /// triangulate a whole set of points in 3D directly into a point cloud of world coordinates
+  /// (see the array version of triangulate() above)
+  /// \param num_points the number of points to triangulate
+  /// \param x0 sensor x coordinates of the points in camera 0
+  /// \param y0 sensor y coordinates of the points in camera 0
+  /// \param x1 sensor x coordinates of the points in camera 1
+  /// \param y1 sensor y coordinates of the points in camera 1
+  /// \param world_out [out] global positions in world coords (resized to num_points)
+  /// \param max_m_out [out] the max value of the psuedo matrix for each point (can be NULL if not needed)
+  /// \param correct_lens_distortion correct for lens distortion
+  /// \param num_threads the number of threads to use
+  void triangulate(const int_t num_points,
+    const scalar_t * x0,
+    const scalar_t * y0,
+    const scalar_t * x1,
+    const scalar_t * y1,
+    Point_Cloud_3D<scalar_t> & world_out,
+    scalar_t * max_m_out = NULL,
+    const bool correct_lens_distortion = false,
+    const int_t num_threads = 1);
+
 //  /// project camera 0 coordinates to sensor 1 coordinates
 //  /// \param xc camera 0 x coordinate
 //  /// \param yc camera 0 y coordinate
@@ -184,6 +266,35 @@ public:
     scalar_t & y_s,
     const int_t camera_id);
 
+  /// build a lookup table of the radial lens distortion corrections for both cameras
+  /// so that the corrections can be interpolated rather than evaluated for every point.
+  /// Once the table exists, correct_lens_distortion_radial() and triangulate() use it
+  /// for any point inside the table and fall back to the model for points outside.
+  /// The calibration parameters must be loaded before calling this method.
+  /// returns the max error of the table (in pixels) measured at the cell centers
+  /// \param width the width of the sensor in pixels
+  /// \param height the height of the sensor in pixels
+  /// \param spacing the spacing of the table nodes in pixels (i.e. 0.25 for quarter pixel resolution)
+  scalar_t build_lens_distortion_map(const int_t width,
+    const int_t height,
+    const scalar_t & spacing = 0.5);
+
+  /// returns true if a lens distortion lookup table has been built
+  bool has_lens_distortion_map()const{
+    return lens_map_spacing_ > 0.0;
+  }
+
+  /// remove the lens distortion lookup table (the model is evaluated directly again)
+  void clear_lens_distortion_map(){
+    lens_map_spacing_ = 0.0;
+    lens_map_nx_ = 0;
+    lens_map_ny_ = 0;
+    for(int_t i=0;i<2;++i){
+      lens_map_dx_[i].clear();
+      lens_map_dy_[i].clear();
+    }
+  }
+
   /// estimate the projective transform from the left to right image
   /// \param left_img pointer to the left image
   /// \param right_img pointer to the right image
@@ -242,6 +353,12 @@ public:
     Teuchos::RCP<MultiField> & cz,
     Teuchos::RCP<MultiField> & sigma);
 
+  /// determine the best fit plane to a cloud of X Y Z coordinates (excluding any failed points)
+  /// \param points the coordinates from the initial triangulation (one point per local entry of sigma)
+  /// \param sigma pointer to the sigma field (negative for failed points)
+  void best_fit_plane(const Point_Cloud_3D<scalar_t> & points,
+    const Teuchos::RCP<MultiField> & sigma);
+
 
   /// returns the cosine of the angle between two vectors
   /// \param a vector a, must have three components
@@ -258,6 +375,70 @@ public:
 
 
 private:
+  /// implementation of the batched triangulate(), the world coordinates of point i are written
+  /// to entry i*world_stride of xw_out, yw_out and zw_out so they can be interleaved
+  /// (see the array version of triangulate() for the other arguments)
+  /// \param world_stride the stride of the world coordinate output arrays
+  void triangulate_points(const int_t num_points,
+    const scalar_t * x0,
+    const scalar_t * y0,
+    const scalar_t * x1,
+    const scalar_t * y1,
+    scalar_t * xc_out,
+    scalar_t * yc_out,
+    scalar_t * zc_out,
+    scalar_t * xw_out,
+    scalar_t * yw_out,
+    scalar_t * zw_out,
+    const int_t world_stride,
+    scalar_t * max_m_out,
+    const bool correct_lens_distortion,
+    const int_t num_threads);
+
+  /// evaluate the radial lens distortion correction directly from the model
+  /// \param x_s x sensor coordinate
+  /// \param y_s y sensor coordinate
+  /// \param camera_id either 0 or 1
+  /// \param dx [out] the correction to subtract from x_s
+  /// \param dy [out] the correction to subtract from y_s
+  void lens_distortion_correction(const double & x_s,
+    const double & y_s,
+    const int_t camera_id,
+    double & dx,
+    double & dy)const;
+
+  /// interpolate the radial lens distortion correction from the lookup table
+  /// returns false if there is no table or the point is outside of it
+  /// \param x_s x sensor coordinate
+  /// \param y_s y sensor coordinate
+  /// \param camera_id either 0 or 1
+  /// \param dx [out] the correction to subtract from x_s
+  /// \param dy [out] the correction to subtract from y_s
+  bool lookup_lens_distortion_correction(const double & x_s,
+    const double & y_s,
+    const int_t camera_id,
+    double & dx,
+    double & dy)const{
+    if(lens_map_spacing_<=0.0) return false;
+    const double px = x_s/lens_map_spacing_;
+    const double py = y_s/lens_map_spacing_;
+    if(px<0.0||py<0.0) return false;
+    const int_t ix = (int_t)px;
+    const int_t iy = (int_t)py;
+    if(ix>=lens_map_nx_-1||iy>=lens_map_ny_-1) return false;
+    const double fx = px - ix;
+    const double fy = py - iy;
+    const int_t n00 = iy*lens_map_nx_ + ix;
+    const int_t n10 = n00 + 1;
+    const int_t n01 = n00 + lens_map_nx_;
+    const int_t n11 = n01 + 1;
+    const std::vector<double> & mx = lens_map_dx_[camera_id];
+    const std::vector<double> & my = lens_map_dy_[camera_id];
+    dx = (1.0-fy)*((1.0-fx)*mx[n00] + fx*mx[n10]) + fy*((1.0-fx)*mx[n01] + fx*mx[n11]);
+    dy = (1.0-fy)*((1.0-fx)*my[n00] + fx*my[n10]) + fy*((1.0-fx)*my[n01] + fx*my[n11]);
+    return true;
+  }
+
   /// \brief load the calibration parameters
   /// \param param_file_name File name of the cal parameters file
   void load_calibration_parameters(const std::string & param_file_name);
@@ -284,6 +465,16 @@ private:
   Teuchos::RCP<std::vector<scalar_t> > warp_params_;
   /// 8 parameters that define a projective transform (independent from intrinsic and extrinsic parameters)
   Teuchos::RCP<std::vector<scalar_t> > projective_params_;
+  /// spacing of the lens distortion lookup table nodes in pixels (0.0 if there is no table)
+  double lens_map_spacing_;
+  /// number of lens distortion lookup table nodes in x
+  int_t lens_map_nx_;
+  /// number of lens distortion lookup table nodes in y
+  int_t lens_map_ny_;
+  /// x lens distortion corrections at the table nodes for each camera
+  std::vector<double> lens_map_dx_[2];
+  /// y lens distortion corrections at the table nodes for each camera
+  std::vector<double> lens_map_dy_[2];
 };
 
 }// End DICe Namespace
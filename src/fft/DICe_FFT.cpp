@@ -40,13 +40,757 @@
 // @HEADER
 
 #include <DICe_FFT.h>
+#include <DICe_FrameArena.h>
 
 #include <Teuchos_ArrayRCP.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#ifdef DICE_ENABLE_FFTW
+  #include <fftw3.h>
+  #ifdef DICE_USE_DOUBLE
+    #define DICE_FFTW(name) fftw_##name
+  #else
+    #define DICE_FFTW(name) fftwf_##name
+  #endif
+#endif
+
+// the device fft backend (cuFFT for CUDA builds or hipFFT on top of rocFFT for HIP builds)
+// keeps the phase correlation on the device in the manycore build
+#if DICE_KOKKOS && (defined(DICE_ENABLE_CUFFT) || defined(DICE_ENABLE_HIPFFT))
+  #define DICE_GPU_FFT 1
+  #include <DICe_Kokkos.h>
+  #include <Kokkos_Complex.hpp>
+  #ifdef DICE_ENABLE_CUFFT
+    #include <cufft.h>
+    typedef cufftHandle dice_gpu_fft_plan;
+    #define DICE_GPU_FFT_SUCCESS CUFFT_SUCCESS
+    #define DICE_GPU_FFT_PLAN_2D cufftPlan2d
+    #define DICE_GPU_FFT_DESTROY cufftDestroy
+    #ifdef DICE_USE_DOUBLE
+      typedef cufftDoubleComplex dice_gpu_fft_complex;
+      #define DICE_GPU_FFT_TYPE CUFFT_Z2Z
+      #define DICE_GPU_FFT_EXEC cufftExecZ2Z
+    #else
+      typedef cufftComplex dice_gpu_fft_complex;
+      #define DICE_GPU_FFT_TYPE CUFFT_C2C
+      #define DICE_GPU_FFT_EXEC cufftExecC2C
+    #endif
+  #else
+    #include <hipfft/hipfft.h>
+    typedef hipfftHandle dice_gpu_fft_plan;
+    #define DICE_GPU_FFT_SUCCESS HIPFFT_SUCCESS
+    #define DICE_GPU_FFT_PLAN_2D hipfftPlan2d
+    #define DICE_GPU_FFT_DESTROY hipfftDestroy
+    #ifdef DICE_USE_DOUBLE
+      typedef hipfftDoubleComplex dice_gpu_fft_complex;
+      #define DICE_GPU_FFT_TYPE HIPFFT_Z2Z
+      #define DICE_GPU_FFT_EXEC hipfftExecZ2Z
+    #else
+      typedef hipfftComplex dice_gpu_fft_complex;
+      #define DICE_GPU_FFT_TYPE HIPFFT_C2C
+      #define DICE_GPU_FFT_EXEC hipfftExecC2C
+    #endif
+  #endif
+#endif
 
 namespace DICe {
 
+namespace {
+
+/// process wide cache of the kiss fft configurations keyed by (size, direction),
+/// the configurations are only read by kiss_fft so they can be shared across threads
+class FFT_Plan_Cache{
+public:
+  ~FFT_Plan_Cache(){
+    clear();
+  }
+  kiss_fft_cfg get(const int_t nfft,
+    const int_t inverse){
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::pair<int_t,int_t> key(nfft,inverse!=0?1:0);
+    std::map<std::pair<int_t,int_t>,kiss_fft_cfg>::const_iterator it = plans_.find(key);
+    if(it!=plans_.end()) return it->second;
+    kiss_fft_cfg cfg = kiss_fft_alloc(nfft,key.second,0,0);
+    TEUCHOS_TEST_FOR_EXCEPTION(cfg==NULL,std::runtime_error,"Error, could not allocate the fft configuration for size " << nfft);
+    plans_[key] = cfg;
+    return cfg;
+  }
+  void clear(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(std::map<std::pair<int_t,int_t>,kiss_fft_cfg>::iterator it=plans_.begin();it!=plans_.end();++it)
+      free(it->second);
+    plans_.clear();
+  }
+  int_t size(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plans_.size();
+  }
+private:
+  std::mutex mutex_;
+  std::map<std::pair<int_t,int_t>,kiss_fft_cfg> plans_;
+};
+
+FFT_Plan_Cache &
+fft_plan_cache(){
+  static FFT_Plan_Cache cache;
+  return cache;
+}
+
+#ifdef DICE_ENABLE_FFTW
+/// the kinds of FFTW plans that are cached
+enum FFTW_Plan_Kind{
+  /// in place split complex to complex (the inverse is the same plan with real and imaginary swapped)
+  SPLIT_C2C=0,
+  /// out of place real to split complex (only the first n/2+1 values of the last dimension are computed)
+  SPLIT_R2C
+};
+
+/// process wide cache of the FFTW plans keyed by (width, height, kind),
+/// a height of 0 is used for the 1d plans. FFTW planning is not thread safe so the plans are
+/// created under the lock, but the plans are executed with the new array interface
+/// which can be called concurrently
+class FFTW_Plan_Cache{
+public:
+  ~FFTW_Plan_Cache(){
+    clear();
+  }
+  DICE_FFTW(plan) get(const int_t w,
+    const int_t h,
+    const FFTW_Plan_Kind kind,
+    scalar_t * in,
+    scalar_t * real,
+    scalar_t * complex){
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::pair<std::pair<int_t,int_t>,int_t> key(std::pair<int_t,int_t>(w,h),kind);
+    std::map<std::pair<std::pair<int_t,int_t>,int_t>,DICE_FFTW(plan)>::const_iterator it = plans_.find(key);
+    if(it!=plans_.end()) return it->second;
+    DICE_FFTW(iodim) dims[2];
+    int rank = 1;
+    if(h>0){
+      rank = 2;
+      dims[0].n = h; dims[0].is = w; dims[0].os = w;
+      dims[1].n = w; dims[1].is = 1; dims[1].os = 1;
+    }
+    else{
+      dims[0].n = w; dims[0].is = 1; dims[0].os = 1;
+    }
+    // FFTW_ESTIMATE does not touch the arrays and FFTW_UNALIGNED allows the plan to be executed on any arrays
+    const unsigned flags = FFTW_ESTIMATE | FFTW_UNALIGNED;
+    DICE_FFTW(plan) plan = kind==SPLIT_C2C ?
+        DICE_FFTW(plan_guru_split_dft)(rank,dims,0,NULL,real,complex,real,complex,flags):
+        DICE_FFTW(plan_guru_split_dft_r2c)(rank,dims,0,NULL,in,real,complex,flags);
+    TEUCHOS_TEST_FOR_EXCEPTION(plan==NULL,std::runtime_error,"Error, could not create the FFTW plan for size " << w << " x " << h);
+    plans_[key] = plan;
+    return plan;
+  }
+  void clear(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(std::map<std::pair<std::pair<int_t,int_t>,int_t>,DICE_FFTW(plan)>::iterator it=plans_.begin();it!=plans_.end();++it)
+      DICE_FFTW(destroy_plan)(it->second);
+    plans_.clear();
+  }
+  int_t size(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plans_.size();
+  }
+private:
+  std::mutex mutex_;
+  std::map<std::pair<std::pair<int_t,int_t>,int_t>,DICE_FFTW(plan)> plans_;
+};
+
+FFTW_Plan_Cache &
+fftw_plan_cache(){
+  static FFTW_Plan_Cache cache;
+  return cache;
+}
+#endif
+
+#ifdef DICE_GPU_FFT
+/// interleaved complex values on the device (same layout as the complex type of the device fft library)
+typedef Kokkos::View<Kokkos::complex<scalar_t>*,device_space> complex_device_view_1d;
+
+/// process wide cache of the device fft plans keyed by (width, height),
+/// the same plan is used for the forward and inverse transforms
+class GPU_FFT_Plan_Cache{
+public:
+  ~GPU_FFT_Plan_Cache(){
+    clear();
+  }
+  dice_gpu_fft_plan get(const int_t w,
+    const int_t h){
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::pair<int_t,int_t> key(w,h);
+    std::map<std::pair<int_t,int_t>,dice_gpu_fft_plan>::const_iterator it = plans_.find(key);
+    if(it!=plans_.end()) return it->second;
+    dice_gpu_fft_plan plan;
+    // the slowest varying dimension comes first
+    const int status = DICE_GPU_FFT_PLAN_2D(&plan,h,w,DICE_GPU_FFT_TYPE);
+    TEUCHOS_TEST_FOR_EXCEPTION(status!=DICE_GPU_FFT_SUCCESS,std::runtime_error,
+      "Error, could not create the device fft plan for size " << w << " x " << h << " (status " << status << ")");
+    plans_[key] = plan;
+    return plan;
+  }
+  void clear(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(std::map<std::pair<int_t,int_t>,dice_gpu_fft_plan>::iterator it=plans_.begin();it!=plans_.end();++it)
+      DICE_GPU_FFT_DESTROY(it->second);
+    plans_.clear();
+  }
+  int_t size(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plans_.size();
+  }
+private:
+  std::mutex mutex_;
+  std::map<std::pair<int_t,int_t>,dice_gpu_fft_plan> plans_;
+};
+
+GPU_FFT_Plan_Cache &
+gpu_fft_plan_cache(){
+  static GPU_FFT_Plan_Cache cache;
+  return cache;
+}
+
+/// in place 2d fft on the device of the row major w x h array of complex values
+void
+gpu_fft_2d(const int_t w,
+  const int_t h,
+  complex_device_view_1d values,
+  const int_t inverse){
+  assert((int_t)values.dimension_0()==w*h);
+  dice_gpu_fft_plan plan = gpu_fft_plan_cache().get(w,h);
+  // the kernels that filled the values may still be running
+  Kokkos::fence();
+  dice_gpu_fft_complex * data = reinterpret_cast<dice_gpu_fft_complex*>(values.ptr_on_device());
+  // both libraries use -1 for the forward and +1 for the inverse direction
+  const int status = DICE_GPU_FFT_EXEC(plan,data,data,inverse ? 1 : -1);
+  TEUCHOS_TEST_FOR_EXCEPTION(status!=DICE_GPU_FFT_SUCCESS,std::runtime_error,
+    "Error, the device fft of size " << w << " x " << h << " failed (status " << status << ")");
+  Kokkos::fence();
+}
+
+/// \brief loads the (optionally hamming filtered) intensities of an image as complex values
+struct FFT_Load_Functor{
+  /// the image intensities on the device
+  intensity_device_view_2d intensities_;
+  /// the complex values
+  complex_device_view_1d values_;
+  /// image width
+  int_t width_;
+  /// image height
+  int_t height_;
+  /// true if the hamming filter is applied
+  bool hamming_filter_;
+  /// constructor
+  FFT_Load_Functor(intensity_device_view_2d intensities,
+    complex_device_view_1d values,
+    const int_t width,
+    const int_t height,
+    const bool hamming_filter):
+    intensities_(intensities),
+    values_(values),
+    width_(width),
+    height_(height),
+    hamming_filter_(hamming_filter){};
+  /// operator
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const int_t pixel_index)const{
+    const int_t y = pixel_index / width_;
+    const int_t x = pixel_index - y*width_;
+    scalar_t value = intensities_(y,x);
+    if(hamming_filter_)
+      value *= (0.54 - 0.46*cos(DICE_TWOPI*x/(width_-1)))*(0.54 - 0.46*cos(DICE_TWOPI*y/(height_-1)));
+    values_(pixel_index) = Kokkos::complex<scalar_t>(value,0.0);
+  }
+};
+
+/// \brief sum of the squared intensity differences of two images
+struct Image_Diff_Functor{
+  /// the first image intensities on the device
+  intensity_device_view_2d intensities_a_;
+  /// the second image intensities on the device
+  intensity_device_view_2d intensities_b_;
+  /// image width
+  int_t width_;
+  /// constructor
+  Image_Diff_Functor(intensity_device_view_2d intensities_a,
+    intensity_device_view_2d intensities_b,
+    const int_t width):
+    intensities_a_(intensities_a),
+    intensities_b_(intensities_b),
+    width_(width){};
+  /// operator
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const int_t pixel_index,
+    scalar_t & sum)const{
+    const int_t y = pixel_index / width_;
+    const int_t x = pixel_index - y*width_;
+    const scalar_t diff = intensities_a_(y,x) - intensities_b_(y,x);
+    sum += diff*diff;
+  }
+};
+
+/// \brief normalized cross power spectrum a*conj(b)/|a*conj(b)|, stored in a
+struct Cross_Power_Functor{
+  /// the fft of the first image (overwritten by the cross power spectrum)
+  complex_device_view_1d a_;
+  /// the fft of the second image
+  complex_device_view_1d b_;
+  /// constructor
+  Cross_Power_Functor(complex_device_view_1d a,
+    complex_device_view_1d b):
+    a_(a),
+    b_(b){};
+  /// operator
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const int_t i)const{
+    const scalar_t a_r = a_(i).real();
+    const scalar_t a_i = a_(i).imag();
+    const scalar_t b_r = b_(i).real();
+    const scalar_t b_i = -b_(i).imag();
+    const scalar_t r_r = a_r*b_r - a_i*b_i;
+    const scalar_t r_i = a_i*b_r + a_r*b_i;
+    const scalar_t r_abs = sqrt(r_r*r_r + r_i*r_i);
+    a_(i) = Kokkos::complex<scalar_t>(r_r/r_abs,r_i/r_abs);
+  }
+};
+
+/// \brief finds the largest absolute real value and the largest one aside from index 0,
+/// ties go to the lowest index like the serial search
+struct Correlation_Peak_Functor{
+  /// the peak and the next peak
+  struct value_type{
+    scalar_t max_value;
+    int_t max_index;
+    scalar_t next_value;
+    int_t next_index;
+  };
+  /// the inverse fft of the cross power spectrum
+  complex_device_view_1d values_;
+  /// constructor
+  Correlation_Peak_Functor(complex_device_view_1d values):
+    values_(values){};
+  /// initial value
+  KOKKOS_INLINE_FUNCTION
+  void init(value_type & peak)const{
+    peak.max_value = 0.0;
+    peak.max_index = 0;
+    peak.next_value = 0.0;
+    peak.next_index = 0;
+  }
+  /// true if the value at index i beats the current best
+  KOKKOS_INLINE_FUNCTION
+  static bool beats(const scalar_t & value,
+    const int_t i,
+    const scalar_t & best_value,
+    const int_t best_index){
+    return value>best_value||(value==best_value&&value>0.0&&i<best_index);
+  }
+  /// operator
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const int_t i,
+    value_type & peak)const{
+    const scalar_t value = fabs(values_(i).real());
+    if(beats(value,i,peak.max_value,peak.max_index)){
+      peak.max_value = value;
+      peak.max_index = i;
+    }
+    if(i>0&&beats(value,i,peak.next_value,peak.next_index)){
+      peak.next_value = value;
+      peak.next_index = i;
+    }
+  }
+  /// combine two partial results
+  KOKKOS_INLINE_FUNCTION
+  void join(volatile value_type & dst,
+    const volatile value_type & src)const{
+    if(beats(src.max_value,src.max_index,dst.max_value,dst.max_index)){
+      dst.max_value = src.max_value;
+      dst.max_index = src.max_index;
+    }
+    if(beats(src.next_value,src.next_index,dst.next_value,dst.next_index)){
+      dst.next_value = src.next_value;
+      dst.next_index = src.next_index;
+    }
+  }
+};
+
+/// \brief polar transform of an image on the device (see polar_transform())
+struct Polar_Transform_Functor{
+  /// the image intensities on the device
+  intensity_device_view_2d intensities_from_;
+  /// the transformed intensities on the device
+  intensity_device_view_2d intensities_to_;
+  /// image width
+  int_t width_;
+  /// image height
+  int_t height_;
+  /// angle increment
+  scalar_t t_size_;
+  /// radius increment
+  scalar_t r_size_;
+  /// constructor
+  Polar_Transform_Functor(intensity_device_view_2d intensities_from,
+    intensity_device_view_2d intensities_to,
+    const int_t width,
+    const int_t height,
+    const scalar_t & t_size,
+    const scalar_t & r_size):
+    intensities_from_(intensities_from),
+    intensities_to_(intensities_to),
+    width_(width),
+    height_(height),
+    t_size_(t_size),
+    r_size_(r_size){};
+  /// operator
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const int_t pixel_index)const{
+    const int_t y = pixel_index / width_;
+    const int_t x = pixel_index - y*width_;
+    const scalar_t r = (y+0.5)*r_size_;
+    const scalar_t t = (x+0.5)*t_size_;
+    const scalar_t X = 0.5*width_ + r*cos(t);
+    const scalar_t Y = 0.5*height_ + r*sin(t);
+    const int_t x1 = (int_t)X;
+    const int_t y1 = (int_t)Y;
+    if(X>=0&&X<width_-2&&Y>=0&&Y<height_-2){
+      const int_t x2 = x1+1;
+      const int_t y2 = y1+1;
+      intensities_to_(y,x) =
+          intensities_from_(y1,x1)*(x2-X)*(y2-Y)
+          +intensities_from_(y1,x2)*(X-x1)*(y2-Y)
+          +intensities_from_(y2,x2)*(X-x1)*(Y-y1)
+          +intensities_from_(y1,x2)*(x2-X)*(Y-y1);
+    }
+    else if(X>=0&&X<width_&&Y>=0&&Y<height_){
+      intensities_to_(y,x) = intensities_from_(y1,x1);
+    }
+    else{
+      intensities_to_(y,x) = 0.0;
+    }
+  }
+};
+
+/// returns the device view of the image intensities, synced to the device
+intensity_device_view_2d
+device_intensities(const Teuchos::RCP<Image> & image){
+  intensity_dual_view_2d intensities = image->intensity_dual_view();
+  intensities.sync<device_space>();
+  return intensities.d_view;
+}
+
+/// fft of an image on the device
+void
+gpu_image_fft(const Teuchos::RCP<Image> & image,
+  complex_device_view_1d values,
+  const int_t inverse,
+  const bool hamming_filter){
+  const int_t w = image->width();
+  const int_t h = image->height();
+  FFT_Load_Functor load_functor(device_intensities(image),values,w,h,hamming_filter);
+  Kokkos::parallel_for(w*h,load_functor);
+  gpu_fft_2d(w,h,values,inverse);
+}
+#endif
+
+/// number of columns that are gathered into a contiguous tile for the column transforms,
+/// each tile row is one contiguous segment of the image rows (a cache line for float values)
+const int_t fft_tile_cols = 16;
+
+/// scratch buffers for the 1d transforms, one set per thread that grows as needed
+/// (the transforms are done out of place since kiss_fft allocates a temporary for in place calls)
+struct FFT_Scratch{
+  std::vector<kiss_fft_cpx> in;
+  std::vector<kiss_fft_cpx> out;
+  std::vector<kiss_fft_cpx> tile_in;
+  std::vector<kiss_fft_cpx> tile_out;
+  std::vector<scalar_t> values;
+  void resize(const int_t n,
+    const int_t tile_size,
+    const int_t values_size){
+    if((int_t)in.size()<n){
+      in.resize(n);
+      out.resize(n);
+    }
+    if((int_t)values.size()<values_size)
+      values.resize(values_size);
+    if((int_t)tile_in.size()<tile_size){
+      tile_in.resize(tile_size);
+      tile_out.resize(tile_size);
+    }
+  }
+};
+
+FFT_Scratch &
+fft_scratch(const int_t n,
+  const int_t tile_size=0,
+  const int_t values_size=0){
+  static thread_local FFT_Scratch scratch;
+  scratch.resize(n,tile_size,values_size);
+  return scratch;
+}
+
+/// 2d fft using kiss_fft of the row major w x h array stored as separate real and imaginary parts.
+/// If real_input is true the imaginary part is assumed to be zero on input,
+/// in that case two rows are transformed at once as one complex row and only
+/// half the columns are transformed, the rest come from the conjugate symmetry.
+/// The columns are transformed in tiles of fft_tile_cols columns that are transposed
+/// into contiguous storage, and the rows and tiles are split across num_threads threads
+void
+kiss_fft_2d(const int_t w,
+  const int_t h,
+  scalar_t * real,
+  scalar_t * complex,
+  const int_t inverse,
+  const bool real_input,
+  const int_t num_threads){
+  assert(w>0);
+  assert(h>0);
+  // the plans are looked up before the parallel region so that any allocation error is thrown here
+  kiss_fft_cfg cfg_ffx = fft_plan(w,inverse);
+  kiss_fft_cfg cfg_ffy = fft_plan(h,inverse);
+  // with real input the rows are transformed in pairs
+  const int_t num_row_jobs = real_input ? (h+1)/2 : h;
+  const int_t num_cols = real_input ? w/2 + 1 : w;
+  const int_t num_tiles = (num_cols + fft_tile_cols - 1)/fft_tile_cols;
+#ifdef _OPENMP
+  const int_t nt = num_threads > 1 ? num_threads : 1;
+#pragma omp parallel num_threads(nt) if(nt>1)
+#endif
+  {
+    FFT_Scratch & scratch = fft_scratch(w,fft_tile_cols*h);
+    kiss_fft_cpx * buf_in = &scratch.in[0];
+    kiss_fft_cpx * buf_out = &scratch.out[0];
+    kiss_fft_cpx * tile_in = &scratch.tile_in[0];
+    kiss_fft_cpx * tile_out = &scratch.tile_out[0];
+
+    // fft the rows
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t job=0;job<num_row_jobs;++job){
+      if(real_input && 2*job+1<h){
+        const int_t y = 2*job;
+        scalar_t * row_a = real + y*w;
+        scalar_t * row_b = real + (y+1)*w;
+        for(int_t x=0;x<w;++x){
+          buf_in[x].r=row_a[x];
+          buf_in[x].i=row_b[x];
+        }
+        kiss_fft(cfg_ffx,buf_in,buf_out);
+        // separate the transforms of the two real rows
+        // A_k = (Z_k + conj(Z_{w-k}))/2, B_k = (Z_k - conj(Z_{w-k}))/2i
+        scalar_t * row_a_i = complex + y*w;
+        scalar_t * row_b_i = complex + (y+1)*w;
+        for(int_t x=0;x<w;++x){
+          const kiss_fft_cpx & zk = buf_out[x];
+          const kiss_fft_cpx & zm = buf_out[x==0?0:w-x];
+          row_a[x] = 0.5*(zk.r + zm.r);
+          row_a_i[x] = 0.5*(zk.i - zm.i);
+          row_b[x] = 0.5*(zk.i + zm.i);
+          row_b_i[x] = 0.5*(zm.r - zk.r);
+        }
+      }
+      else{
+        // a complex row or the last unpaired real row
+        const int_t y = real_input ? 2*job : job;
+        for(int_t x=0;x<w;++x){
+          buf_in[x].r=real[y*w+x];
+          buf_in[x].i=real_input ? 0.0 : complex[y*w+x];
+        }
+        kiss_fft(cfg_ffx,buf_in,buf_out);
+        for(int_t x=0;x<w;++x){
+          real[y*w+x] = buf_out[x].r;
+          complex[y*w+x] = buf_out[x].i;
+        }
+      }
+    }
+
+    // fft the cols one tile at a time (the tile is stored column by column)
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t tile=0;tile<num_tiles;++tile){
+      const int_t x0 = tile*fft_tile_cols;
+      const int_t tile_w = std::min(fft_tile_cols,num_cols-x0);
+      for(int_t y=0;y<h;++y){
+        const scalar_t * row_r = real + y*w + x0;
+        const scalar_t * row_i = complex + y*w + x0;
+        for(int_t i=0;i<tile_w;++i){
+          tile_in[i*h+y].r = row_r[i];
+          tile_in[i*h+y].i = row_i[i];
+        }
+      }
+      for(int_t i=0;i<tile_w;++i)
+        kiss_fft(cfg_ffy,tile_in+i*h,tile_out+i*h);
+      for(int_t y=0;y<h;++y){
+        scalar_t * row_r = real + y*w + x0;
+        scalar_t * row_i = complex + y*w + x0;
+        for(int_t i=0;i<tile_w;++i){
+          row_r[i] = tile_out[i*h+y].r;
+          row_i[i] = tile_out[i*h+y].i;
+        }
+      }
+    }
+
+    // the transform of real data is conjugate symmetric: F(x,y) = conj(F(w-x,h-y))
+    if(real_input && num_cols<w){
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for(int_t y=0;y<h;++y){
+        const int_t ys = y==0?0:h-y;
+        for(int_t x=num_cols;x<w;++x){
+          real[y*w+x] = real[ys*w+w-x];
+          complex[y*w+x] = -complex[ys*w+w-x];
+        }
+      }
+    }
+  } // end parallel region
+}
+
+#ifdef DICE_ENABLE_FFTW
+/// 2d fft using FFTW, same arguments as kiss_fft_2d (the FFTW transforms are not threaded)
+void
+fftw_fft_2d(const int_t w,
+  const int_t h,
+  scalar_t * real,
+  scalar_t * complex,
+  const int_t inverse,
+  const bool real_input){
+  if(real_input){
+    // the r2c transform needs a separate input array, it computes the first w/2+1 columns
+    FFT_Scratch & scratch = fft_scratch(0,0,w*h);
+    scalar_t * in = &scratch.values[0];
+    std::copy(real,real+w*h,in);
+    DICE_FFTW(plan) plan = fftw_plan_cache().get(w,h,SPLIT_R2C,in,real,complex);
+    DICE_FFTW(execute_split_dft_r2c)(plan,in,real,complex);
+    const int_t num_cols = w/2 + 1;
+    // the inverse transform of real data is the conjugate of the forward transform
+    if(inverse){
+      for(int_t y=0;y<h;++y)
+        for(int_t x=0;x<num_cols;++x)
+          complex[y*w+x] = -complex[y*w+x];
+    }
+    // the transform of real data is conjugate symmetric: F(x,y) = conj(F(w-x,h-y))
+    for(int_t y=0;y<h;++y){
+      const int_t ys = y==0?0:h-y;
+      for(int_t x=num_cols;x<w;++x){
+        real[y*w+x] = real[ys*w+w-x];
+        complex[y*w+x] = -complex[ys*w+w-x];
+      }
+    }
+  }
+  else{
+    DICE_FFTW(plan) plan = fftw_plan_cache().get(w,h,SPLIT_C2C,NULL,real,complex);
+    // swapping the real and imaginary parts gives the inverse transform
+    if(inverse)
+      DICE_FFTW(execute_split_dft)(plan,complex,real,complex,real);
+    else
+      DICE_FFTW(execute_split_dft)(plan,real,complex,real,complex);
+  }
+}
+#endif
+
+/// 2d fft of the row major w x h array stored as separate real and imaginary parts
+/// using the backend selected at build time
+void
+fft_2d(const int_t w,
+  const int_t h,
+  scalar_t * real,
+  scalar_t * complex,
+  const int_t inverse,
+  const bool real_input,
+  const int_t num_threads){
+#ifdef DICE_ENABLE_FFTW
+  (void)num_threads;
+  fftw_fft_2d(w,h,real,complex,inverse,real_input);
+#else
+  kiss_fft_2d(w,h,real,complex,inverse,real_input,num_threads);
+#endif
+}
+
+/// in place 1d fft of an array stored as separate real and imaginary parts
+/// using the backend selected at build time
+void
+fft_1d(const int_t n,
+  scalar_t * real,
+  scalar_t * complex,
+  const int_t inverse){
+  assert(n>0);
+#ifdef DICE_ENABLE_FFTW
+  DICE_FFTW(plan) plan = fftw_plan_cache().get(n,0,SPLIT_C2C,NULL,real,complex);
+  if(inverse)
+    DICE_FFTW(execute_split_dft)(plan,complex,real,complex,real);
+  else
+    DICE_FFTW(execute_split_dft)(plan,real,complex,real,complex);
+#else
+  kiss_fft_cfg cfg = fft_plan(n,inverse);
+  FFT_Scratch & scratch = fft_scratch(n);
+  kiss_fft_cpx * buf_in = &scratch.in[0];
+  kiss_fft_cpx * buf_out = &scratch.out[0];
+  for(int_t i=0;i<n;++i){
+    buf_in[i].r = real[i];
+    buf_in[i].i = complex[i];
+  }
+  kiss_fft(cfg,buf_in,buf_out);
+  for(int_t i=0;i<n;++i){
+    real[i] = buf_out[i].r;
+    complex[i] = buf_out[i].i;
+  }
+#endif
+}
+
+} // end anonymous namespace
+
+DICE_LIB_DLL_EXPORT
+kiss_fft_cfg
+fft_plan(const int_t nfft,
+  const int_t inverse){
+  return fft_plan_cache().get(nfft,inverse);
+}
+
+DICE_LIB_DLL_EXPORT
+void
+clear_fft_plan_cache(){
+  fft_plan_cache().clear();
+#ifdef DICE_ENABLE_FFTW
+  fftw_plan_cache().clear();
+#endif
+#ifdef DICE_GPU_FFT
+  gpu_fft_plan_cache().clear();
+#endif
+}
+
+DICE_LIB_DLL_EXPORT
+int_t
+fft_plan_cache_size(){
+  int_t size = fft_plan_cache().size();
+#ifdef DICE_ENABLE_FFTW
+  size += fftw_plan_cache().size();
+#endif
+#ifdef DICE_GPU_FFT
+  size += gpu_fft_plan_cache().size();
+#endif
+  return size;
+}
+
+DICE_LIB_DLL_EXPORT
+std::string
+fft_backend(){
+#ifdef DICE_ENABLE_FFTW
+  return "fftw";
+#else
+  return "kiss_fft";
+#endif
+}
+
 DICE_LIB_DLL_EXPORT
 void
 complex_divide(kiss_fft_cpx * lhs,
@@ -127,7 +871,8 @@ phase_correlate_x_y(Teuchos::RCP<Image> image_a,
   Teuchos::RCP<Image> image_b,
   scalar_t & u_x,
   scalar_t & u_y,
-  const bool convert_to_r_theta){
+  const bool convert_to_r_theta,
+  const int_t num_threads){
 
   const int_t w = image_a->width();
   const int_t h = image_a->height();
@@ -140,7 +885,16 @@ phase_correlate_x_y(Teuchos::RCP<Image> image_a,
   // This hopefully removes the false 0,0 peak
   // TODO address this more formally
   scalar_t diff_tol = 50.0;
+#ifdef DICE_GPU_FFT
+  // the images stay on the device, only the peak is copied back
+  (void)num_threads;
+  scalar_t diff = 0.0;
+  Image_Diff_Functor diff_functor(device_intensities(image_a),device_intensities(image_b),w);
+  Kokkos::parallel_reduce(w*h,diff_functor,diff);
+  diff = std::sqrt(diff);
+#else
   const scalar_t diff = image_a->diff(image_b);
+#endif
   DEBUG_MSG("phase_correlate_x_y(): image diff test result: " << diff);
   if(diff < diff_tol){
     DEBUG_MSG("phase_correlate_x_y(): skipping phase correlation because images are the same.");
@@ -149,35 +903,70 @@ phase_correlate_x_y(Teuchos::RCP<Image> image_a,
     return -1.0;
   }
 
+  // find max of result
+  scalar_t max_real = 0.0;
+  // find the max of all pixels aside from (0,0)
+  scalar_t next_real = 0.0;
+  u_x = 0.0;
+  u_y = 0.0;
+  scalar_t next_x = 0;
+  scalar_t next_y = 0;
+
+#ifdef DICE_GPU_FFT
+  complex_device_view_1d fft_a("phase_correlation_fft_a",w*h);
+  complex_device_view_1d fft_b("phase_correlation_fft_b",w*h);
+  gpu_image_fft(image_a,fft_a,0,true);
+  gpu_image_fft(image_b,fft_b,0,true);
+  // FFTRN = FFT1 .* conj(FFT2) / abs(FFT1 .* conj(FFT2)), then back to the spatial domain
+  Cross_Power_Functor cross_power_functor(fft_a,fft_b);
+  Kokkos::parallel_for(w*h,cross_power_functor);
+  gpu_fft_2d(w,h,fft_a,1);
+  Correlation_Peak_Functor::value_type peak;
+  Correlation_Peak_Functor peak_functor(fft_a);
+  Kokkos::parallel_reduce(w*h,peak_functor,peak);
+  max_real = peak.max_value;
+  u_x = peak.max_index % w;
+  u_y = peak.max_index / w;
+  next_real = peak.next_value;
+  next_x = peak.next_index % w;
+  next_y = peak.next_index / w;
+#else
   // fft of image a
   Teuchos::ArrayRCP<scalar_t> a_r,a_i;
-  DICe::image_fft(image_a,a_r,a_i,0);
+  DICe::image_fft(image_a,a_r,a_i,0,true,num_threads);
 
   // fft of image b
   Teuchos::ArrayRCP<scalar_t> b_r,b_i;
-  DICe::image_fft(image_b,b_r,b_i,0);
+  DICe::image_fft(image_b,b_r,b_i,0,true,num_threads);
 
   // conjugate of image b
   for(int_t i=0;i<w*h;++i)
     b_i[i] = -b_i[i];
 
+  // the work arrays below only live for this call so they are taken from the frame arena
+  Frame_Arena::Scope arena_scope;
+  Frame_Arena & arena = arena_scope.arena();
+  const scalar_t zero = 0.0;
+
   // FFTR = FFT1 .* FFT2
-  Teuchos::ArrayRCP<scalar_t> FFTR_r(w*h,0.0), FFTR_i(w*h,0.0);
+  scalar_t * FFTR_r = arena.allocate<scalar_t>(w*h);
+  scalar_t * FFTR_i = arena.allocate<scalar_t>(w*h);
   for(int_t i=0;i<w*h;++i)
     complex_multiply(FFTR_r[i],FFTR_i[i],a_r[i],a_i[i],b_r[i],b_i[i]);
 
   // compute abs(FFTR)
-  Teuchos::ArrayRCP<scalar_t> FFTR_abs(w*h,0.0);
+  scalar_t * FFTR_abs = arena.allocate<scalar_t>(w*h);
   for(int_t i=0;i<w*h;++i)
     complex_abs(FFTR_abs[i],FFTR_r[i],FFTR_i[i]);
 
   //FFTRN = FFTR / (abs(FT1 .* FFT2))
-  Teuchos::ArrayRCP<scalar_t> FFTRN_r(w*h,0.0), FFTRN_i(w*h,0.0),zero(w*h,0.0);
+  scalar_t * FFTRN_r = arena.allocate<scalar_t>(w*h);
+  scalar_t * FFTRN_i = arena.allocate<scalar_t>(w*h);
   for(int_t i=0;i<w*h;++i)
-    complex_divide(FFTRN_r[i],FFTRN_i[i],FFTR_r[i],FFTR_i[i],FFTR_abs[i],zero[i]);
+    complex_divide(FFTRN_r[i],FFTRN_i[i],FFTR_r[i],FFTR_i[i],FFTR_abs[i],zero);
 
   // result = inverse FFTRN
-  array_2d_fft_in_place(w,h,FFTRN_r,FFTRN_i,1);
+  fft_2d(w,h,FFTRN_r,FFTRN_i,1,false,num_threads);
 
 //  std::cout << " FFTRN " << std::endl;
 //  for(int_t i=0;i<h;++i){
@@ -187,14 +976,6 @@ phase_correlate_x_y(Teuchos::RCP<Image> image_a,
 //    std::cout << std::endl;
 //  }
 
-  // find max of result
-  scalar_t max_real = 0.0;
-  // find the max of all pixels aside from (0,0)
-  scalar_t next_real = 0.0;
-  u_x = 0.0;
-  u_y = 0.0;
-  scalar_t next_x = 0;
-  scalar_t next_y = 0;
   scalar_t max_complex = 0.0;
 
   scalar_t test_real = 0.0;
@@ -222,6 +1003,7 @@ phase_correlate_x_y(Teuchos::RCP<Image> image_a,
   //std::cout << " max real " << max_real << " u_x " << u_x << " u_y " << u_y << " max_complex  " <<
   //max_complex << " next_real " << next_real << " nx " << next_x << " ny " << next_y << std::endl;
   assert(max_complex <= 1.0E-5);
+#endif
   // deal with aliasing (which causes a false peak at 0,0)
   // TODO find a better approach to this using pre-whitening, etc.
   if(u_x!=next_x&&next_x>1){
@@ -278,6 +1060,114 @@ phase_correlate_x_y(Teuchos::RCP<Image> image_a,
   return max_real;
 }
 
+DICE_LIB_DLL_EXPORT
+scalar_t
+phase_correlate_window(const Teuchos::RCP<Image> & image_a,
+  const Teuchos::RCP<Image> & image_b,
+  const int_t center_x,
+  const int_t center_y,
+  const int_t window_size,
+  scalar_t & u_x,
+  scalar_t & u_y){
+
+  u_x = 0.0;
+  u_y = 0.0;
+  const int_t n = window_size;
+  const int_t w = image_a->width();
+  const int_t h = image_a->height();
+  assert(image_b->width()==w && "Error: images must be the same dims");
+  assert(image_b->height()==h && "Error: images must be the same dims");
+  if(n<8||n>w||n>h) return -1.0;
+
+  // the window is shifted to stay inside the image
+  const int_t x0 = std::max(0,std::min(w-n,center_x - image_a->offset_x() - n/2));
+  const int_t y0 = std::max(0,std::min(h-n,center_y - image_a->offset_y() - n/2));
+
+  // per thread storage so that repeated calls do not allocate
+  static thread_local std::vector<scalar_t> z_r, z_i, c_r, c_i, ham;
+  z_r.resize(n*n);
+  z_i.resize(n*n);
+  c_r.resize(n*n);
+  c_i.resize(n*n);
+  ham.resize(n);
+  for(int_t i=0;i<n;++i)
+    ham[i] = 0.54 - 0.46*std::cos(DICE_TWOPI*i/(n-1));
+
+  // remove the window means so the dc term does not dominate the correlation
+  scalar_t mean_a = 0.0;
+  scalar_t mean_b = 0.0;
+  for(int_t y=0;y<n;++y){
+    for(int_t x=0;x<n;++x){
+      mean_a += (*image_a)(x0+x,y0+y);
+      mean_b += (*image_b)(x0+x,y0+y);
+    }
+  }
+  mean_a /= (n*n);
+  mean_b /= (n*n);
+
+  // both windows are real so they are packed into one complex transform as z = a + i b
+  for(int_t y=0;y<n;++y){
+    for(int_t x=0;x<n;++x){
+      const scalar_t filter = ham[x]*ham[y];
+      z_r[y*n+x] = ((*image_a)(x0+x,y0+y) - mean_a)*filter;
+      z_i[y*n+x] = ((*image_b)(x0+x,y0+y) - mean_b)*filter;
+    }
+  }
+  fft_2d(n,n,&z_r[0],&z_i[0],0,false,1);
+
+  // separate the two transforms using A(k) = (Z(k) + conj(Z(-k)))/2 and B(k) = (Z(k) - conj(Z(-k)))/2i
+  // and form the normalized cross power spectrum A conj(B) / |A conj(B)|
+  for(int_t ky=0;ky<n;++ky){
+    const int_t nky = ky==0 ? 0 : n - ky;
+    for(int_t kx=0;kx<n;++kx){
+      const int_t nkx = kx==0 ? 0 : n - kx;
+      const scalar_t zr = z_r[ky*n+kx];
+      const scalar_t zi = z_i[ky*n+kx];
+      const scalar_t mr = z_r[nky*n+nkx];
+      const scalar_t mi = -z_i[nky*n+nkx];
+      const scalar_t ar = 0.5*(zr + mr);
+      const scalar_t ai = 0.5*(zi + mi);
+      const scalar_t br = 0.5*(zi - mi);
+      const scalar_t bi = 0.5*(mr - zr);
+      const scalar_t rr = ar*br + ai*bi;
+      const scalar_t ri = ai*br - ar*bi;
+      const scalar_t mag = std::sqrt(rr*rr + ri*ri);
+      c_r[ky*n+kx] = mag > 0.0 ? rr/mag : 0.0;
+      c_i[ky*n+kx] = mag > 0.0 ? ri/mag : 0.0;
+    }
+  }
+  fft_2d(n,n,&c_r[0],&c_i[0],1,false,1);
+
+  // find the correlation peak
+  int_t peak_x = 0;
+  int_t peak_y = 0;
+  scalar_t peak = c_r[0];
+  for(int_t i=1;i<n*n;++i){
+    if(c_r[i] > peak){
+      peak = c_r[i];
+      peak_x = i%n;
+      peak_y = i/n;
+    }
+  }
+  // a flat window (no texture) has no correlation peak
+  if(peak<=0.0) return 0.0;
+  // subpixel location from the peak and its neighbors (which wrap around) using the
+  // ratio estimate for the sinc shaped peak of phase only correlation (Foroosh et al. 2002)
+  const scalar_t left = c_r[peak_y*n + (peak_x+n-1)%n];
+  const scalar_t right = c_r[peak_y*n + (peak_x+1)%n];
+  const scalar_t below = c_r[((peak_y+n-1)%n)*n + peak_x];
+  const scalar_t above = c_r[((peak_y+1)%n)*n + peak_x];
+  const scalar_t sub_x = right > left ? right/(right + peak) : -left/(left + peak);
+  const scalar_t sub_y = above > below ? above/(above + peak) : -below/(below + peak);
+
+  // convert back to image coordinates (same convention as phase_correlate_x_y)
+  u_x = peak_x >= n/2 ? n - peak_x - sub_x : -peak_x - sub_x;
+  u_y = peak_y >= n/2 ? n - peak_y - sub_y : -peak_y - sub_y;
+
+  // the inverse transform is not scaled so the peak is normalized here to be in [0,1]
+  return peak/(n*n);
+}
+
 DICE_LIB_DLL_EXPORT
 void
 phase_correlate_row(Teuchos::RCP<Image> image_a,
@@ -291,71 +1181,55 @@ phase_correlate_row(Teuchos::RCP<Image> image_a,
   int_t w = image_a->width();
   assert(w>1);
 
+  // the work arrays only live for this call (one row per call) so they are taken from the frame arena
+  Frame_Arena::Scope arena_scope;
+  Frame_Arena & arena = arena_scope.arena();
+  const scalar_t zero = 0.0;
+
   // compute the hamming filter
-  Teuchos::ArrayRCP<scalar_t> x_ham(w,0.0);
+  scalar_t * x_ham = arena.allocate<scalar_t>(w);
   for(int_t i=0;i<w;++i)
     x_ham[i] = 0.54 - 0.46*std::cos(DICE_TWOPI*i/(w-1));
 
   // compute th fft of image a's row
-  Teuchos::ArrayRCP<scalar_t> a_real(w,0.0), a_complex(w,0.0);
-  kiss_fft_cpx * img_row = new kiss_fft_cpx[w];
-  kiss_fft_cfg cfg_ffx = kiss_fft_alloc(w,0,0,0);
-  // fft the rows
+  scalar_t * a_real = arena.allocate<scalar_t>(w);
+  scalar_t * a_complex = arena.allocate<scalar_t>(w);
   for(int_t x=0;x<w;++x){
-    img_row[x].r=(*image_a)(x,row_id)*x_ham[x];
-    img_row[x].i=0;
-  }
-  kiss_fft(cfg_ffx,img_row,img_row);
-  for(int_t x=0;x<w;++x){
-    a_real[x] = img_row[x].r;
-    a_complex[x] = img_row[x].i;
+    a_real[x] = (*image_a)(x,row_id)*x_ham[x];
+    a_complex[x] = 0.0;
   }
+  fft_1d(w,a_real,a_complex,0);
   // compute the fft of b's row:
-  Teuchos::ArrayRCP<scalar_t> b_real(w,0.0), b_complex(w,0.0);
-  for(int_t x=0;x<w;++x){
-    img_row[x].r=(*image_b)(x,row_id)*x_ham[x];
-    img_row[x].i=0;
-  }
-  kiss_fft(cfg_ffx,img_row,img_row);
+  scalar_t * b_real = arena.allocate<scalar_t>(w);
+  scalar_t * b_complex = arena.allocate<scalar_t>(w);
   for(int_t x=0;x<w;++x){
-    b_real[x] = img_row[x].r;
-    b_complex[x] = img_row[x].i;
+    b_real[x] = (*image_b)(x,row_id)*x_ham[x];
+    b_complex[x] = 0.0;
   }
-  free(cfg_ffx);
-
+  fft_1d(w,b_real,b_complex,0);
 
   // conjugate of image b
   for(int_t i=0;i<w;++i)
     b_complex[i] = -b_complex[i];
 
   // FFTR = FFT1 .* FFT2
-  Teuchos::ArrayRCP<scalar_t> FFTR_r(w,0.0), FFTR_i(w,0.0);
+  scalar_t * FFTR_r = arena.allocate<scalar_t>(w);
+  scalar_t * FFTR_i = arena.allocate<scalar_t>(w);
   for(int_t i=0;i<w;++i)
     complex_multiply(FFTR_r[i],FFTR_i[i],a_real[i],a_complex[i],b_real[i],b_complex[i]);
 
   // compute abs(FFTR)
-  Teuchos::ArrayRCP<scalar_t> FFTR_abs(w,0.0);
+  scalar_t * FFTR_abs = arena.allocate<scalar_t>(w);
   for(int_t i=0;i<w;++i)
     complex_abs(FFTR_abs[i],FFTR_r[i],FFTR_i[i]);
 
   //FFTRN = FFTR / (abs(FT1 .* FFT2))
-  Teuchos::ArrayRCP<scalar_t> FFTRN_r(w,0.0), FFTRN_i(w,0.0),zero(w,0.0);
+  scalar_t * FFTRN_r = arena.allocate<scalar_t>(w);
+  scalar_t * FFTRN_i = arena.allocate<scalar_t>(w);
   for(int_t i=0;i<w;++i)
-    complex_divide(FFTRN_r[i],FFTRN_i[i],FFTR_r[i],FFTR_i[i],FFTR_abs[i],zero[i]);
+    complex_divide(FFTRN_r[i],FFTRN_i[i],FFTR_r[i],FFTR_i[i],FFTR_abs[i],zero);
 
-  kiss_fft_cfg cfg_ffxi = kiss_fft_alloc(w,1,0,0);
-  // fft the rows
-  for(int_t x=0;x<w;++x){
-    img_row[x].r=FFTRN_r[x];
-    img_row[x].i=FFTRN_i[x];
-  }
-  kiss_fft(cfg_ffxi,img_row,img_row);
-  for(int_t x=0;x<w;++x){
-    FFTRN_r[x] = img_row[x].r;
-    FFTRN_i[x] = img_row[x].i;
-  }
-  free(cfg_ffxi);
-  delete[] img_row;
+  fft_1d(w,FFTRN_r,FFTRN_i,1);
 
   // find the max and convert to theta if necessary
   u = 0;
@@ -390,6 +1264,20 @@ polar_transform(Teuchos::RCP<Image> image,
 
   assert(w>0);
   assert(h>0);
+#ifdef DICE_GPU_FFT
+  {
+    // transform on the device so the image does not have to come back to the host
+    const scalar_t t_size = DICE_TWOPI/w;
+    const scalar_t r_size = high_pass_filter ? 0.25*w/h : std::sqrt(w_2*w_2 + h_2*h_2)/h;
+    Teuchos::RCP<Image> out_image = Teuchos::rcp(new Image(w,h,0.0));
+    intensity_dual_view_2d output = out_image->intensity_dual_view();
+    Polar_Transform_Functor polar_functor(device_intensities(image),output.d_view,w,h,t_size,r_size);
+    Kokkos::parallel_for(w*h,polar_functor);
+    output.modify<device_space>();
+    output.sync<host_space>();
+    return out_image;
+  }
+#endif
   // whatever is passed in for the output array RPC, it gets written over
   Teuchos::ArrayRCP<intensity_t> output = Teuchos::ArrayRCP<intensity_t> (w*h,0.0);
   const scalar_t t_size = DICE_TWOPI/w;
@@ -443,7 +1331,8 @@ image_fft(Teuchos::RCP<Image> image,
   const bool apply_log,
   const scalar_t scale_factor,
   bool shift,
-  const bool high_pass_filter){
+  const bool high_pass_filter,
+  const int_t num_threads){
 
   // NOTE: if the high_pass_filter is used,
   // the fft values are automatically shifted:
@@ -461,7 +1350,7 @@ image_fft(Teuchos::RCP<Image> image,
   Teuchos::ArrayRCP<intensity_t> real;
   Teuchos::ArrayRCP<intensity_t> complex;
   // for now, disallow the use of the inverse fft
-  image_fft(image,real,complex,0,hamming_filter);
+  image_fft(image,real,complex,0,hamming_filter,num_threads);
   assert(real.size()==w*h);
   assert(complex.size()==w*h);
   scalar_t max_mag = std::numeric_limits<scalar_t>::min();
@@ -546,7 +1435,8 @@ image_fft(Teuchos::RCP<Image> image,
   Teuchos::ArrayRCP<scalar_t> & real,
   Teuchos::ArrayRCP<scalar_t> & complex,
   const int_t inverse,
-  const bool hamming_filter){
+  const bool hamming_filter,
+  const int_t num_threads){
 
   const int_t w = image->width();
   assert(w>1);
@@ -555,6 +1445,20 @@ image_fft(Teuchos::RCP<Image> image,
   real = Teuchos::ArrayRCP<scalar_t> (w*h,0.0);
   complex = Teuchos::ArrayRCP<scalar_t> (w*h,0.0);
 
+#ifdef DICE_GPU_FFT
+  // transform on the device, only the result comes back to the host
+  (void)num_threads;
+  complex_device_view_1d values("image_fft_values",w*h);
+  gpu_image_fft(image,values,inverse,hamming_filter);
+  complex_device_view_1d::HostMirror values_host = Kokkos::create_mirror_view(values);
+  Kokkos::deep_copy(values_host,values);
+  for(int_t i=0;i<w*h;++i){
+    real[i] = values_host(i).real();
+    complex[i] = values_host(i).imag();
+  }
+  return;
+#endif
+
   if(hamming_filter){
     Teuchos::ArrayRCP<scalar_t> x_ham(w,0.0);
     Teuchos::ArrayRCP<scalar_t> y_ham(h,0.0);
@@ -578,41 +1482,8 @@ image_fft(Teuchos::RCP<Image> image,
     }
   }
 
-  kiss_fft_cpx * img_row = new kiss_fft_cpx[w];
-  kiss_fft_cpx * img_col = new kiss_fft_cpx[h];
-  kiss_fft_cfg cfg_ffx = kiss_fft_alloc(w,inverse,0,0);
-  kiss_fft_cfg cfg_ffy = kiss_fft_alloc(h,inverse,0,0);
-
-  // fft the rows
-  for(int_t y=0;y<h;++y){
-    for(int_t x=0;x<w;++x){
-      img_row[x].r=real[y*w+x];
-      img_row[x].i=0.0;
-    }
-    kiss_fft(cfg_ffx,img_row,img_row);
-    for(int_t x=0;x<w;++x){
-      real[y*w+x] = img_row[x].r;
-      complex[y*w+x] = img_row[x].i;
-    }
-  }
-  // fft the cols
-  for(int_t x=0;x<w;++x){
-    for(int_t y=0;y<h;++y){
-      img_col[y].r=real[y*w+x];
-      img_col[y].i=complex[y*w+x];
-    }
-    kiss_fft(cfg_ffy,img_col,img_col);
-    for(int_t y=0;y<h;++y){
-      real[y*w+x] = img_col[y].r;
-      complex[y*w+x] = img_col[y].i;
-    }
-  }
-
-  free(cfg_ffx);
-  free(cfg_ffy);
-  delete[] img_row;
-  delete[] img_col;
-
+  // the image intensities are real so the real input path can be used
+  fft_2d(w,h,real.getRawPtr(),complex.getRawPtr(),inverse,true,num_threads);
 };
 
 DICE_LIB_DLL_EXPORT
@@ -621,41 +1492,12 @@ array_2d_fft_in_place(const int_t w,
   const int_t h,
   Teuchos::ArrayRCP<scalar_t> & real,
   Teuchos::ArrayRCP<scalar_t> & complex,
-  const int_t inverse){
-
-  kiss_fft_cpx * img_row = new kiss_fft_cpx[w];
-  kiss_fft_cpx * img_col = new kiss_fft_cpx[h];
-  kiss_fft_cfg cfg_ffx = kiss_fft_alloc(w,inverse,0,0);
-  kiss_fft_cfg cfg_ffy = kiss_fft_alloc(h,inverse,0,0);
+  const int_t inverse,
+  const int_t num_threads){
 
-  // fft the rows
-  for(int_t y=0;y<h;++y){
-    for(int_t x=0;x<w;++x){
-      img_row[x].r=real[y*w+x];
-      img_row[x].i=complex[y*w+x];
-    }
-    kiss_fft(cfg_ffx,img_row,img_row);
-    for(int_t x=0;x<w;++x){
-      real[y*w+x] = img_row[x].r;
-      complex[y*w+x] = img_row[x].i;
-    }
-  }
-  // fft the cols
-  for(int_t x=0;x<w;++x){
-    for(int_t y=0;y<h;++y){
-      img_col[y].r=real[y*w+x];
-      img_col[y].i=complex[y*w+x];
-    }
-    kiss_fft(cfg_ffy,img_col,img_col);
-    for(int_t y=0;y<h;++y){
-      real[y*w+x] = img_col[y].r;
-      complex[y*w+x] = img_col[y].i;
-    }
-  }
-  free(cfg_ffx);
-  free(cfg_ffy);
-  delete[] img_row;
-  delete[] img_col;
+  assert(real.size()>=w*h);
+  assert(complex.size()>=w*h);
+  fft_2d(w,h,real.getRawPtr(),complex.getRawPtr(),inverse,false,num_threads);
 };
 
 }// End DICe Namespace
@@ -51,6 +51,32 @@
 
 namespace DICe {
 
+/// returns the kiss fft configuration for the given size and direction from a
+/// process wide cache (the configuration is allocated the first time it is requested).
+/// The configuration is owned by the cache and must not be freed by the caller
+/// \param nfft the size of the transform
+/// \param inverse 1 if this is an inverse FFT (back to time domain)
+DICE_LIB_DLL_EXPORT
+kiss_fft_cfg
+fft_plan(const int_t nfft,
+  const int_t inverse = 0);
+
+/// free all of the cached fft configurations
+/// (should not be called while a transform is in progress on another thread)
+DICE_LIB_DLL_EXPORT
+void
+clear_fft_plan_cache();
+
+/// returns the number of configurations in the fft plan cache
+DICE_LIB_DLL_EXPORT
+int_t
+fft_plan_cache_size();
+
+/// returns the name of the fft backend selected at build time ("kiss_fft" or "fftw")
+DICE_LIB_DLL_EXPORT
+std::string
+fft_backend();
+
 /// complex number divide
 /// \param lhs left hand side
 /// \param rhs right hand side
@@ -67,13 +93,15 @@ complex_divide(kiss_fft_cpx * lhs,
 /// \param complex [out] the imaginary part of the FFT
 /// \param inverse 1 if this should be an inverse FFT (back to time domain)
 /// \param hamming_filter true if a hamming filter should be applied to the image
+/// \param num_threads the number of threads to split the rows and columns across
 DICE_LIB_DLL_EXPORT
 void
 image_fft(Teuchos::RCP<Image> image,
   Teuchos::ArrayRCP<scalar_t> & real,
   Teuchos::ArrayRCP<scalar_t> & complex,
   const int_t inverse = 0,
-  const bool hamming_filter=true);
+  const bool hamming_filter=true,
+  const int_t num_threads=1);
 
 /// compute the image fft and return an image with
 /// intensity values as the magnitude of the FFT values
@@ -85,6 +113,7 @@ image_fft(Teuchos::RCP<Image> image,
 /// \param scale_factor used if the log is applied i = scale_factor*log(i+1)
 /// \param shift true if the quandrants of the fft image should be swapped
 /// \param high_pass_filter true if the values should be filtered
+/// \param num_threads the number of threads to use for the fft
 DICE_LIB_DLL_EXPORT
 Teuchos::RCP<Image>
 image_fft(Teuchos::RCP<Image> image,
@@ -92,7 +121,8 @@ image_fft(Teuchos::RCP<Image> image,
   const bool apply_log=true,
   const scalar_t scale_factor=100.0,
   bool shift=true,
-  const bool high_pass_filter=false);
+  const bool high_pass_filter=false,
+  const int_t num_threads=1);
 
 /// Phase correlate two images,
 /// If the images have been polar transformed, then set the
@@ -104,13 +134,38 @@ image_fft(Teuchos::RCP<Image> image,
 /// \param u_y [out] displacement y
 /// \param convert_to_r_theta true if the images are polar transforms and
 /// the correlation is for radius and angle of rotation
+/// \param num_threads the number of threads to use for the ffts
 DICE_LIB_DLL_EXPORT
 scalar_t
 phase_correlate_x_y(Teuchos::RCP<Image> image_a,
   Teuchos::RCP<Image> image_b,
   scalar_t & u_x,
   scalar_t & u_y,
-  const bool convert_to_r_theta=false);
+  const bool convert_to_r_theta=false,
+  const int_t num_threads=1);
+
+/// Phase correlate a square window of two images centered at the given location,
+/// (the window is shifted to stay inside the image). The result u is the motion of
+/// image_b relative to image_a with a subpixel estimate of the peak location.
+/// Returns the normalized peak value (between 0 and 1) or -1 if the window does not fit in the image.
+/// This method is serial so that it can be called from a threaded loop over many windows,
+/// the fft plans and work arrays are reused between calls.
+/// \param image_a the first image
+/// \param image_b the second image (must have the same dimensions as image_a)
+/// \param center_x the x coordinate of the window center in global image coordinates
+/// \param center_y the y coordinate of the window center in global image coordinates
+/// \param window_size the width and height of the window in pixels
+/// \param u_x [out] displacement x
+/// \param u_y [out] displacement y
+DICE_LIB_DLL_EXPORT
+scalar_t
+phase_correlate_window(const Teuchos::RCP<Image> & image_a,
+  const Teuchos::RCP<Image> & image_b,
+  const int_t center_x,
+  const int_t center_y,
+  const int_t window_size,
+  scalar_t & u_x,
+  scalar_t & u_y);
 
 /// Phase correlate a single row from two images
 /// \param image_a the first image
@@ -144,13 +199,15 @@ polar_transform(Teuchos::RCP<Image> image,
 /// \param real the real array
 /// \param complex the imaginary array
 /// \param inverse 1 if the FFT should be to the time domain
+/// \param num_threads the number of threads to split the rows and columns across
 DICE_LIB_DLL_EXPORT
 void
 array_2d_fft_in_place(const int_t w,
   const int_t h,
   Teuchos::ArrayRCP<scalar_t> & real,
   Teuchos::ArrayRCP<scalar_t> & complex,
-  const int_t inverse = 0);
+  const int_t inverse = 0,
+  const int_t num_threads = 1);
 
 /// multiply two complex numbers
 /// \param result_r [out] the real result
@@ -252,7 +252,8 @@ void kf_work(
 #ifdef _OPENMP
     // use openmp extensions at the 
     // top-level (not recursive)
-    if (fstride==1 && p<=5)
+    // (m==1 is the last stage so there are no factors left to recurse on)
+    if (fstride==1 && p<=5 && m>1)
     {
         int k;
 
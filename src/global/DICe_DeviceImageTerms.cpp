@@ -0,0 +1,469 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_DeviceImageTerms.h>
+#include <DICe_QuadratureCache.h>
+#include <DICe_Mesh.h>
+
+#include <cassert>
+
+namespace DICe {
+
+namespace global{
+
+namespace {
+
+/// interpolate a device image (same as Image::interpolate_bilinear())
+KOKKOS_INLINE_FUNCTION
+scalar_t
+device_interpolate_bilinear(const intensity_device_view_2d & values,
+  const int_t width,
+  const int_t height,
+  const scalar_t & local_x,
+  const scalar_t & local_y){
+  if(local_x<0.0||local_x>=width-1.5||local_y<0.0||local_y>=height-1.5) return 0.0;
+  const int_t x1 = (int_t)local_x;
+  const int_t x2 = x1+1;
+  const int_t y1 = (int_t)local_y;
+  const int_t y2 = y1+1;
+  return values(y1,x1)*(x2-local_x)*(y2-local_y)
+      +values(y1,x2)*(local_x-x1)*(y2-local_y)
+      +values(y2,x2)*(local_x-x1)*(local_y-y1)
+      +values(y2,x1)*(x2-local_x)*(local_y-y1);
+}
+
+/// weights of the four stencil points of the cubic convolution kernel (a = -0.5) for the fractional offset t
+KOKKOS_INLINE_FUNCTION
+void
+cubic_weights(const scalar_t & t,
+  scalar_t * w){
+  const scalar_t t_2 = t*t;
+  const scalar_t t_3 = t_2*t;
+  w[0] = -0.5*t + t_2 - 0.5*t_3;
+  w[1] = 1.0 - 2.5*t_2 + 1.5*t_3;
+  w[2] = 0.5*t + 2.0*t_2 - 1.5*t_3;
+  w[3] = -0.5*t_2 + 0.5*t_3;
+}
+
+/// interpolate a device image, the separable form of the polynomial in Image::interpolate_bicubic()
+KOKKOS_INLINE_FUNCTION
+scalar_t
+device_interpolate_bicubic(const intensity_device_view_2d & values,
+  const int_t width,
+  const int_t height,
+  const scalar_t & local_x,
+  const scalar_t & local_y){
+  if(local_x<1.0||local_x>=width-2.0||local_y<1.0||local_y>=height-2.0)
+    return device_interpolate_bilinear(values,width,height,local_x,local_y);
+  const int_t x0 = (int_t)local_x;
+  const int_t y0 = (int_t)local_y;
+  scalar_t wx[4];
+  scalar_t wy[4];
+  cubic_weights(local_x - x0,wx);
+  cubic_weights(local_y - y0,wy);
+  scalar_t value = 0.0;
+  for(int_t m=0;m<4;++m)
+    for(int_t n=0;n<4;++n)
+      value += wy[m]*wx[n]*values(y0-1+m,x0-1+n);
+  return value;
+}
+
+/// returns the device view of the image intensities, synced to the device (an empty view for a null image)
+intensity_device_view_2d
+device_intensities(const Teuchos::RCP<Image> & image){
+  if(image==Teuchos::null) return intensity_device_view_2d();
+  intensity_dual_view_2d intensities = image->intensity_dual_view();
+  intensities.sync<device_space>();
+  return intensities.d_view;
+}
+
+/// \brief evaluates the image terms of one element per thread
+struct Image_Term_Functor{
+  /// shape functions at the image integration points
+  scalar_device_view_2d image_N_;
+  /// image integration point weights
+  scalar_device_view_2d image_weights_;
+  /// physical x coordinates of the image integration points
+  scalar_device_view_2d image_x_;
+  /// physical y coordinates of the image integration points
+  scalar_device_view_2d image_y_;
+  /// jacobian determinants at the image integration points
+  scalar_device_view_2d image_J_;
+  /// reference image intensities at the image integration points
+  scalar_device_view_2d phi_0_;
+  /// reference image x gradients at the image integration points
+  scalar_device_view_2d grad_phi_x_;
+  /// reference image y gradients at the image integration points
+  scalar_device_view_2d grad_phi_y_;
+  /// overlap local ids of the element nodes
+  Kokkos::View<int_t**> elem_nodes_;
+  /// overlap displacements
+  scalar_dual_view_2d::t_dev disp_;
+  /// the deformed image
+  intensity_device_view_2d def_;
+  /// the reference image
+  intensity_device_view_2d ref_;
+  /// the reference image x gradients
+  intensity_device_view_2d grad_x_;
+  /// the reference image y gradients
+  intensity_device_view_2d grad_y_;
+  /// the element force vectors or stiffness matrices
+  scalar_dual_view_2d::t_dev out_;
+  /// width of the reference image and its gradients
+  int_t ref_width_;
+  /// height of the reference image and its gradients
+  int_t ref_height_;
+  /// x offset of the reference image (if only a portion of the image is loaded on this processor)
+  int_t ref_offset_x_;
+  /// y offset of the reference image
+  int_t ref_offset_y_;
+  /// width of the deformed image
+  int_t def_width_;
+  /// height of the deformed image
+  int_t def_height_;
+  /// x offset of the deformed image
+  int_t def_offset_x_;
+  /// y offset of the deformed image
+  int_t def_offset_y_;
+  /// number of shape functions per element
+  int_t num_funcs_;
+  /// number of image integration points per element
+  int_t num_image_gps_;
+  /// true if the integration points are convected by the displacements
+  bool use_fixed_point_;
+  /// true if the sampled reference values are used
+  bool use_cached_;
+  /// tag
+  struct Sample_Tag {};
+  /// tag
+  struct Time_Force_Tag {};
+  /// tag
+  struct Grad_Tensor_Tag {};
+
+  /// set the dimensions and offsets of the reference image (zeros for a null image)
+  /// \param img the reference image (or one of its gradient images, which have the same dimensions)
+  void set_ref_dims(const Teuchos::RCP<Image> & img){
+    ref_width_ = img==Teuchos::null ? 0 : img->width();
+    ref_height_ = img==Teuchos::null ? 0 : img->height();
+    ref_offset_x_ = img==Teuchos::null ? 0 : img->offset_x();
+    ref_offset_y_ = img==Teuchos::null ? 0 : img->offset_y();
+  }
+
+  /// set the dimensions and offsets of the deformed image
+  /// \param img the deformed image
+  void set_def_dims(const Teuchos::RCP<Image> & img){
+    def_width_ = img->width();
+    def_height_ = img->height();
+    def_offset_x_ = img->offset_x();
+    def_offset_y_ = img->offset_y();
+  }
+
+  /// displacement of an integration point interpolated from the element nodes
+  KOKKOS_INLINE_FUNCTION
+  void displacement(const int_t elem,
+    const int_t gp,
+    scalar_t & bx,
+    scalar_t & by)const{
+    bx = 0.0;
+    by = 0.0;
+    if(!use_fixed_point_) return;
+    for(int_t i=0;i<num_funcs_;++i){
+      const int_t node = elem_nodes_(elem,i);
+      bx += disp_(0,node*2+0)*image_N_(gp,i);
+      by += disp_(0,node*2+1)*image_N_(gp,i);
+    }
+  }
+
+  /// samples the reference image values of an element
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const Sample_Tag &, const int_t elem)const{
+    for(int_t gp=0;gp<num_image_gps_;++gp){
+      const scalar_t x = image_x_(elem,gp);
+      const scalar_t y = image_y_(elem,gp);
+      phi_0_(elem,gp) = device_interpolate_bicubic(ref_,ref_width_,ref_height_,x-ref_offset_x_,y-ref_offset_y_);
+      grad_phi_x_(elem,gp) = device_interpolate_bicubic(grad_x_,ref_width_,ref_height_,x-ref_offset_x_,y-ref_offset_y_);
+      grad_phi_y_(elem,gp) = device_interpolate_bicubic(grad_y_,ref_width_,ref_height_,x-ref_offset_x_,y-ref_offset_y_);
+    }
+  }
+
+  /// d_dt(phi) * grad(phi) (same as image_time_force())
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const Time_Force_Tag &, const int_t elem)const{
+    for(int_t gp=0;gp<num_image_gps_;++gp){
+      const scalar_t x = image_x_(elem,gp);
+      const scalar_t y = image_y_(elem,gp);
+      const scalar_t weight_J = image_weights_(0,gp)*image_J_(elem,gp);
+      scalar_t phi_0 = 0.0, grad_phi_x = 0.0, grad_phi_y = 0.0;
+      if(use_cached_){
+        phi_0 = phi_0_(elem,gp);
+        grad_phi_x = grad_phi_x_(elem,gp);
+        grad_phi_y = grad_phi_y_(elem,gp);
+      }
+      else{
+        scalar_t bx = 0.0, by = 0.0;
+        displacement(elem,gp,bx,by);
+        const scalar_t ref_x = x - bx - ref_offset_x_;
+        const scalar_t ref_y = y - by - ref_offset_y_;
+        phi_0 = device_interpolate_bicubic(ref_,ref_width_,ref_height_,ref_x,ref_y);
+        grad_phi_x = device_interpolate_bicubic(grad_x_,ref_width_,ref_height_,ref_x,ref_y);
+        grad_phi_y = device_interpolate_bicubic(grad_y_,ref_width_,ref_height_,ref_x,ref_y);
+      }
+      const scalar_t d_phi_dt = device_interpolate_bicubic(def_,def_width_,def_height_,x-def_offset_x_,y-def_offset_y_) - phi_0;
+      for(int_t i=0;i<num_funcs_;++i){
+        out_(elem,i*2+0) -= d_phi_dt*grad_phi_x*image_N_(gp,i)*weight_J;
+        out_(elem,i*2+1) -= d_phi_dt*grad_phi_y*image_N_(gp,i)*weight_J;
+      }
+    }
+  }
+
+  /// grad(phi) tensor_prod grad(phi) (same as image_grad_tensor())
+  KOKKOS_INLINE_FUNCTION
+  void operator()(const Grad_Tensor_Tag &, const int_t elem)const{
+    const int_t num_cols = num_funcs_*2;
+    for(int_t gp=0;gp<num_image_gps_;++gp){
+      const scalar_t weight_J = image_weights_(0,gp)*image_J_(elem,gp);
+      scalar_t grad_phi_x = 0.0, grad_phi_y = 0.0;
+      if(use_cached_){
+        grad_phi_x = grad_phi_x_(elem,gp);
+        grad_phi_y = grad_phi_y_(elem,gp);
+      }
+      else{
+        scalar_t bx = 0.0, by = 0.0;
+        displacement(elem,gp,bx,by);
+        const scalar_t ref_x = image_x_(elem,gp) - bx - ref_offset_x_;
+        const scalar_t ref_y = image_y_(elem,gp) - by - ref_offset_y_;
+        grad_phi_x = device_interpolate_bicubic(grad_x_,ref_width_,ref_height_,ref_x,ref_y);
+        grad_phi_y = device_interpolate_bicubic(grad_y_,ref_width_,ref_height_,ref_x,ref_y);
+      }
+      for(int_t i=0;i<num_funcs_;++i){
+        const int_t row1 = i*2 + 0;
+        const int_t row2 = i*2 + 1;
+        for(int_t j=0;j<num_funcs_;++j){
+          const scalar_t NN = image_N_(gp,i)*image_N_(gp,j)*weight_J;
+          out_(elem,row1*num_cols + j*2+0) += grad_phi_x*grad_phi_x*NN;
+          out_(elem,row1*num_cols + j*2+1) += grad_phi_x*grad_phi_y*NN;
+          out_(elem,row2*num_cols + j*2+0) += grad_phi_y*grad_phi_x*NN;
+          out_(elem,row2*num_cols + j*2+1) += grad_phi_y*grad_phi_y*NN;
+        }
+      }
+    }
+  }
+};
+
+} // end anonymous namespace
+
+Device_Image_Terms::Device_Image_Terms(const Quadrature_Cache & quad,
+  const DICe::mesh::Flat_Mesh_Data & flat,
+  const Teuchos::RCP<Image> & ref_img,
+  const Teuchos::RCP<Image> & grad_x,
+  const Teuchos::RCP<Image> & grad_y):
+  num_elem_(quad.num_elem()),
+  num_funcs_(quad.num_funcs()),
+  num_image_gps_(quad.num_image_gps()),
+  has_reference_image_values_(false)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(flat.num_elem()!=num_elem_,std::runtime_error,"Error, the quadrature cache does not match the mesh");
+  DEBUG_MSG("Device_Image_Terms::Device_Image_Terms(): copying the image integration points of " << num_elem_ << " elements to the device");
+  image_N_ = scalar_device_view_2d("image_N",num_image_gps_,num_funcs_);
+  image_weights_ = scalar_device_view_2d("image_weights",1,num_image_gps_);
+  image_x_ = scalar_device_view_2d("image_x",num_elem_,num_image_gps_);
+  image_y_ = scalar_device_view_2d("image_y",num_elem_,num_image_gps_);
+  image_J_ = scalar_device_view_2d("image_J",num_elem_,num_image_gps_);
+  phi_0_ = scalar_device_view_2d("phi_0",num_elem_,num_image_gps_);
+  grad_phi_x_ = scalar_device_view_2d("grad_phi_x",num_elem_,num_image_gps_);
+  grad_phi_y_ = scalar_device_view_2d("grad_phi_y",num_elem_,num_image_gps_);
+  elem_nodes_ = Kokkos::View<int_t**>("elem_nodes",num_elem_,num_funcs_);
+  elem_force_ = scalar_dual_view_2d("elem_force",num_elem_,num_funcs_*2);
+  elem_stiffness_ = scalar_dual_view_2d("elem_stiffness",num_elem_,num_funcs_*2*num_funcs_*2);
+
+  scalar_device_view_2d::HostMirror N_host = Kokkos::create_mirror_view(image_N_);
+  scalar_device_view_2d::HostMirror weights_host = Kokkos::create_mirror_view(image_weights_);
+  for(int_t gp=0;gp<num_image_gps_;++gp){
+    weights_host(0,gp) = quad.image_gp_weight(gp);
+    for(int_t i=0;i<num_funcs_;++i)
+      N_host(gp,i) = quad.image_N(gp)[i];
+  }
+  scalar_device_view_2d::HostMirror x_host = Kokkos::create_mirror_view(image_x_);
+  scalar_device_view_2d::HostMirror y_host = Kokkos::create_mirror_view(image_y_);
+  scalar_device_view_2d::HostMirror J_host = Kokkos::create_mirror_view(image_J_);
+  Kokkos::View<int_t**>::HostMirror nodes_host = Kokkos::create_mirror_view(elem_nodes_);
+  for(int_t elem=0;elem<num_elem_;++elem){
+    TEUCHOS_TEST_FOR_EXCEPTION(flat.num_elem_nodes(elem)<num_funcs_,std::runtime_error,"Error, element " << elem << " has too few nodes");
+    const int_t * nodes = flat.elem_nodes(elem);
+    for(int_t i=0;i<num_funcs_;++i)
+      nodes_host(elem,i) = nodes[i];
+    for(int_t gp=0;gp<num_image_gps_;++gp){
+      x_host(elem,gp) = quad.image_x(elem,gp);
+      y_host(elem,gp) = quad.image_y(elem,gp);
+      J_host(elem,gp) = quad.image_J(elem,gp);
+    }
+  }
+  Kokkos::deep_copy(image_N_,N_host);
+  Kokkos::deep_copy(image_weights_,weights_host);
+  Kokkos::deep_copy(image_x_,x_host);
+  Kokkos::deep_copy(image_y_,y_host);
+  Kokkos::deep_copy(image_J_,J_host);
+  Kokkos::deep_copy(elem_nodes_,nodes_host);
+  update_reference_image_values(ref_img,grad_x,grad_y);
+}
+
+void
+Device_Image_Terms::update_reference_image_values(const Teuchos::RCP<Image> & ref_img,
+  const Teuchos::RCP<Image> & grad_x,
+  const Teuchos::RCP<Image> & grad_y){
+  has_reference_image_values_ = false;
+  if(ref_img==Teuchos::null||grad_x==Teuchos::null||grad_y==Teuchos::null) return;
+  DEBUG_MSG("Device_Image_Terms::update_reference_image_values(): sampling the reference image on the device");
+  Image_Term_Functor functor;
+  functor.image_x_ = image_x_;
+  functor.image_y_ = image_y_;
+  functor.phi_0_ = phi_0_;
+  functor.grad_phi_x_ = grad_phi_x_;
+  functor.grad_phi_y_ = grad_phi_y_;
+  functor.ref_ = device_intensities(ref_img);
+  functor.grad_x_ = device_intensities(grad_x);
+  functor.grad_y_ = device_intensities(grad_y);
+  functor.set_ref_dims(ref_img);
+  functor.num_image_gps_ = num_image_gps_;
+  Kokkos::parallel_for(Kokkos::RangePolicy<device_space,Image_Term_Functor::Sample_Tag>(0,num_elem_),functor);
+  Kokkos::fence();
+  has_reference_image_values_ = true;
+}
+
+void
+Device_Image_Terms::copy_displacements(const Teuchos::ArrayRCP<const scalar_t> & disp_values,
+  const bool use_fixed_point){
+  if(!use_fixed_point) return;
+  const int_t num_values = disp_values.size();
+  if((int_t)disp_.dimension_1()!=num_values)
+    disp_ = scalar_dual_view_2d("overlap_disp",1,num_values);
+  for(int_t i=0;i<num_values;++i)
+    disp_.h_view(0,i) = disp_values[i];
+  disp_.modify<host_space>();
+  disp_.sync<device_space>();
+}
+
+void
+Device_Image_Terms::add_image_time_force(const Teuchos::RCP<Image> & def_img,
+  const Teuchos::RCP<Image> & ref_img,
+  const Teuchos::RCP<Image> & grad_x,
+  const Teuchos::RCP<Image> & grad_y,
+  const Teuchos::ArrayRCP<const scalar_t> & disp_values,
+  const bool use_fixed_point,
+  scalar_t * all_elem_force){
+  TEUCHOS_TEST_FOR_EXCEPTION(def_img==Teuchos::null,std::runtime_error,"Error, the deformed image must be valid");
+  const bool use_cached = !use_fixed_point && has_reference_image_values_;
+  TEUCHOS_TEST_FOR_EXCEPTION(!use_cached&&(ref_img==Teuchos::null||grad_x==Teuchos::null||grad_y==Teuchos::null),std::runtime_error,
+    "Error, the reference image and its gradients must be valid");
+  copy_displacements(disp_values,use_fixed_point);
+  Kokkos::deep_copy(elem_force_.d_view,0.0);
+  Image_Term_Functor functor;
+  functor.image_N_ = image_N_;
+  functor.image_weights_ = image_weights_;
+  functor.image_x_ = image_x_;
+  functor.image_y_ = image_y_;
+  functor.image_J_ = image_J_;
+  functor.phi_0_ = phi_0_;
+  functor.grad_phi_x_ = grad_phi_x_;
+  functor.grad_phi_y_ = grad_phi_y_;
+  functor.elem_nodes_ = elem_nodes_;
+  functor.disp_ = disp_.d_view;
+  functor.def_ = device_intensities(def_img);
+  functor.ref_ = use_cached ? intensity_device_view_2d() : device_intensities(ref_img);
+  functor.grad_x_ = use_cached ? intensity_device_view_2d() : device_intensities(grad_x);
+  functor.grad_y_ = use_cached ? intensity_device_view_2d() : device_intensities(grad_y);
+  functor.out_ = elem_force_.d_view;
+  functor.set_ref_dims(use_cached ? Teuchos::null : ref_img);
+  functor.set_def_dims(def_img);
+  functor.num_funcs_ = num_funcs_;
+  functor.num_image_gps_ = num_image_gps_;
+  functor.use_fixed_point_ = use_fixed_point;
+  functor.use_cached_ = use_cached;
+  Kokkos::parallel_for(Kokkos::RangePolicy<device_space,Image_Term_Functor::Time_Force_Tag>(0,num_elem_),functor);
+  elem_force_.modify<device_space>();
+  elem_force_.sync<host_space>();
+  const int_t force_size = num_funcs_*2;
+  for(int_t elem=0;elem<num_elem_;++elem)
+    for(int_t i=0;i<force_size;++i)
+      all_elem_force[elem*force_size+i] += elem_force_.h_view(elem,i);
+}
+
+void
+Device_Image_Terms::add_image_grad_tensor(const Teuchos::RCP<Image> & grad_x,
+  const Teuchos::RCP<Image> & grad_y,
+  const Teuchos::ArrayRCP<const scalar_t> & disp_values,
+  const bool use_fixed_point,
+  scalar_t * all_elem_stiffness){
+  const bool use_cached = !use_fixed_point && has_reference_image_values_;
+  TEUCHOS_TEST_FOR_EXCEPTION(!use_cached&&(grad_x==Teuchos::null||grad_y==Teuchos::null),std::runtime_error,
+    "Error, the reference image gradients must be valid");
+  copy_displacements(disp_values,use_fixed_point);
+  Kokkos::deep_copy(elem_stiffness_.d_view,0.0);
+  Image_Term_Functor functor;
+  functor.image_N_ = image_N_;
+  functor.image_weights_ = image_weights_;
+  functor.image_x_ = image_x_;
+  functor.image_y_ = image_y_;
+  functor.image_J_ = image_J_;
+  functor.grad_phi_x_ = grad_phi_x_;
+  functor.grad_phi_y_ = grad_phi_y_;
+  functor.elem_nodes_ = elem_nodes_;
+  functor.disp_ = disp_.d_view;
+  functor.grad_x_ = use_cached ? intensity_device_view_2d() : device_intensities(grad_x);
+  functor.grad_y_ = use_cached ? intensity_device_view_2d() : device_intensities(grad_y);
+  functor.out_ = elem_stiffness_.d_view;
+  functor.set_ref_dims(use_cached ? Teuchos::null : grad_x);
+  functor.num_funcs_ = num_funcs_;
+  functor.num_image_gps_ = num_image_gps_;
+  functor.use_fixed_point_ = use_fixed_point;
+  functor.use_cached_ = use_cached;
+  Kokkos::parallel_for(Kokkos::RangePolicy<device_space,Image_Term_Functor::Grad_Tensor_Tag>(0,num_elem_),functor);
+  elem_stiffness_.modify<device_space>();
+  elem_stiffness_.sync<host_space>();
+  const int_t stiffness_size = num_funcs_*2*num_funcs_*2;
+  for(int_t elem=0;elem<num_elem_;++elem)
+    for(int_t i=0;i<stiffness_size;++i)
+      all_elem_stiffness[elem*stiffness_size+i] += elem_stiffness_.h_view(elem,i);
+}
+
+}// end global namespace
+
+}// End DICe Namespace
@@ -0,0 +1,174 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_DEVICEIMAGETERMS_H
+#define DICE_DEVICEIMAGETERMS_H
+
+#include <DICe.h>
+#include <DICe_Image.h>
+#include <DICe_Kokkos.h>
+
+#include <Teuchos_ArrayRCP.hpp>
+#include <Teuchos_RCP.hpp>
+
+namespace DICe {
+
+namespace mesh{
+// forward declaration of the flat mesh arrays
+struct Flat_Mesh_Data;
+}
+
+namespace global{
+
+// forward declaration of the quadrature cache
+class Quadrature_Cache;
+
+/// \class DICe::global::Device_Image_Terms
+/// \brief Image terms of the global residual and tangent evaluated on the device (manycore build only)
+///
+/// The image integration points dominate the cost of Global_Algorithm::compute_residual() and
+/// Global_Algorithm::compute_tangent(). The image integration point data of the Quadrature_Cache
+/// and the element connectivity are copied to the device once, the images are interpolated on the
+/// device (one thread per element) and only the element force vectors and stiffness matrices
+/// are copied back to be assembled on the host.
+class
+DICE_LIB_DLL_EXPORT
+Device_Image_Terms
+{
+public:
+  /// Constructor
+  /// \param quad the integration point data of the reference configuration
+  /// \param flat the flat element connectivity of the mesh
+  /// \param ref_img the reference image
+  /// \param grad_x the reference image x gradients
+  /// \param grad_y the reference image y gradients
+  Device_Image_Terms(const Quadrature_Cache & quad,
+    const DICe::mesh::Flat_Mesh_Data & flat,
+    const Teuchos::RCP<Image> & ref_img,
+    const Teuchos::RCP<Image> & grad_x,
+    const Teuchos::RCP<Image> & grad_y);
+
+  /// Destructor
+  virtual ~Device_Image_Terms(){};
+
+  /// sample the reference image and its gradients at the image integration points on the device
+  /// (does nothing if any of the images is null)
+  void update_reference_image_values(const Teuchos::RCP<Image> & ref_img,
+    const Teuchos::RCP<Image> & grad_x,
+    const Teuchos::RCP<Image> & grad_y);
+
+  /// returns true if the reference image values are available on the device
+  bool has_reference_image_values()const{
+    return has_reference_image_values_;
+  }
+
+  /// adds the d_dt(phi) * grad(phi) term of every element to the element force vectors
+  /// \param def_img the deformed image
+  /// \param ref_img the reference image (only used if the integration points are convected)
+  /// \param grad_x the reference image x gradients (only used if the integration points are convected)
+  /// \param grad_y the reference image y gradients (only used if the integration points are convected)
+  /// \param disp_values the overlap displacements (only used if the integration points are convected)
+  /// \param use_fixed_point true if the integration points are convected by the displacements
+  /// \param all_elem_force [out] the element force vectors (num_funcs*spa_dim values per element)
+  void add_image_time_force(const Teuchos::RCP<Image> & def_img,
+    const Teuchos::RCP<Image> & ref_img,
+    const Teuchos::RCP<Image> & grad_x,
+    const Teuchos::RCP<Image> & grad_y,
+    const Teuchos::ArrayRCP<const scalar_t> & disp_values,
+    const bool use_fixed_point,
+    scalar_t * all_elem_force);
+
+  /// adds the grad(phi) tensor_prod grad(phi) term of every element to the element stiffness matrices
+  /// \param grad_x the reference image x gradients (only used if the integration points are convected)
+  /// \param grad_y the reference image y gradients (only used if the integration points are convected)
+  /// \param disp_values the overlap displacements (only used if the integration points are convected)
+  /// \param use_fixed_point true if the integration points are convected by the displacements
+  /// \param all_elem_stiffness [out] the element stiffness matrices ((num_funcs*spa_dim)^2 values per element)
+  void add_image_grad_tensor(const Teuchos::RCP<Image> & grad_x,
+    const Teuchos::RCP<Image> & grad_y,
+    const Teuchos::ArrayRCP<const scalar_t> & disp_values,
+    const bool use_fixed_point,
+    scalar_t * all_elem_stiffness);
+
+private:
+  /// copies the overlap displacements to the device (if the integration points are convected)
+  void copy_displacements(const Teuchos::ArrayRCP<const scalar_t> & disp_values,
+    const bool use_fixed_point);
+
+  /// number of elements
+  int_t num_elem_;
+  /// number of shape functions per element
+  int_t num_funcs_;
+  /// number of image integration points per element
+  int_t num_image_gps_;
+  /// true if the reference image values have been sampled
+  bool has_reference_image_values_;
+  /// shape functions at the image integration points (num_image_gps x num_funcs)
+  scalar_device_view_2d image_N_;
+  /// image integration point weights (stored as a 1 x num_image_gps array)
+  scalar_device_view_2d image_weights_;
+  /// physical x coordinates of the image integration points (num_elem x num_image_gps)
+  scalar_device_view_2d image_x_;
+  /// physical y coordinates of the image integration points (num_elem x num_image_gps)
+  scalar_device_view_2d image_y_;
+  /// jacobian determinants at the image integration points (num_elem x num_image_gps)
+  scalar_device_view_2d image_J_;
+  /// reference image intensities at the image integration points (num_elem x num_image_gps)
+  scalar_device_view_2d phi_0_;
+  /// reference image x gradients at the image integration points (num_elem x num_image_gps)
+  scalar_device_view_2d grad_phi_x_;
+  /// reference image y gradients at the image integration points (num_elem x num_image_gps)
+  scalar_device_view_2d grad_phi_y_;
+  /// overlap local ids of the element nodes (num_elem x num_funcs)
+  Kokkos::View<int_t**> elem_nodes_;
+  /// overlap displacements (stored as a 1 x num values array)
+  scalar_dual_view_2d disp_;
+  /// element force vectors (num_elem x num_funcs*spa_dim)
+  scalar_dual_view_2d elem_force_;
+  /// element stiffness matrices (num_elem x (num_funcs*spa_dim)^2)
+  scalar_dual_view_2d elem_stiffness_;
+};
+
+}// end global namespace
+
+}// End DICe Namespace
+
+#endif
@@ -46,7 +46,17 @@
 #include <DICe_MeshIOUtils.h>
 #include <DICe_ParameterUtilities.h>
 #include <DICe_Preconditioner.h>
+#include <DICe_QuadratureCache.h>
+#if DICE_KOKKOS
+  #include <DICe_DeviceImageTerms.h>
+#endif
+#include <DICe_MatrixFreeOperator.h>
 #include <DICe_Parser.h>
+#include <DICe_FFT.h>
+
+#include <chrono>
+#include <limits>
+#include <exception>
 
 namespace DICe {
 
@@ -65,7 +75,24 @@ Global_Algorithm::Global_Algorithm(Schema * schema,
   max_iterations_(25),
   element_type_(DICe::mesh::TRI6),
   use_fixed_point_iterations_(false),
-  stabilization_tau_(-1.0)
+  stabilization_tau_(-1.0),
+  num_threads_(1),
+  use_matrix_free_(false),
+  global_preconditioner_(ILU_PRECONDITIONER),
+  reuse_preconditioner_(false),
+  preconditioner_max_reuse_(0),
+  preconditioner_rebuild_iterations_(0),
+  output_frequency_(1),
+  warm_start_extrapolation_(false),
+  warm_start_window_size_(0),
+  preconditioner_num_reuses_(0),
+  num_linear_iterations_(0),
+  assembly_time_(0.0),
+  preconditioner_time_(0.0),
+  linear_solve_time_(0.0),
+  total_linear_iterations_(0),
+  num_nonlinear_iterations_(0),
+  preconditioner_matrix_(NULL)
 {
   TEUCHOS_TEST_FOR_EXCEPTION(!schema,std::runtime_error,"Error, cannot have null schema in this constructor");
   default_constructor_tasks(params);
@@ -82,7 +109,24 @@ Global_Algorithm::Global_Algorithm(const Teuchos::RCP<Teuchos::ParameterList> &
   max_iterations_(25),
   element_type_(DICe::mesh::TRI6),
   use_fixed_point_iterations_(false),
-  stabilization_tau_(-1.0)
+  stabilization_tau_(-1.0),
+  num_threads_(1),
+  use_matrix_free_(false),
+  global_preconditioner_(ILU_PRECONDITIONER),
+  reuse_preconditioner_(false),
+  preconditioner_max_reuse_(0),
+  preconditioner_rebuild_iterations_(0),
+  output_frequency_(1),
+  warm_start_extrapolation_(false),
+  warm_start_window_size_(0),
+  preconditioner_num_reuses_(0),
+  num_linear_iterations_(0),
+  assembly_time_(0.0),
+  preconditioner_time_(0.0),
+  linear_solve_time_(0.0),
+  total_linear_iterations_(0),
+  num_nonlinear_iterations_(0),
+  preconditioner_matrix_(NULL)
 {
   default_constructor_tasks(params);
 }
@@ -105,6 +149,31 @@ Global_Algorithm::default_constructor_tasks(const Teuchos::RCP<Teuchos::Paramete
   global_solver_ = params->get<Global_Solver>(DICe::global_solver,CG_SOLVER);
   DEBUG_MSG("Global_Algorithm::default_constructor_tasks(): global solver type: " << to_string(global_solver_));
 
+  use_matrix_free_ = params->get<bool>(DICe::global_use_matrix_free,false);
+  DEBUG_MSG("Global_Algorithm::default_constructor_tasks(): use matrix free operator: " << use_matrix_free_);
+  // the ILU preconditioner needs the assembled matrix
+  global_preconditioner_ = params->get<Global_Preconditioner>(DICe::global_preconditioner,
+    use_matrix_free_ ? JACOBI_PRECONDITIONER : ILU_PRECONDITIONER);
+  DEBUG_MSG("Global_Algorithm::default_constructor_tasks(): global preconditioner type: " << to_string(global_preconditioner_));
+  TEUCHOS_TEST_FOR_EXCEPTION(use_matrix_free_&&global_preconditioner_==ILU_PRECONDITIONER,std::runtime_error,
+    "Error, the ILU_PRECONDITIONER requires an assembled tangent, use the JACOBI_PRECONDITIONER with global_use_matrix_free");
+  TEUCHOS_TEST_FOR_EXCEPTION(use_matrix_free_&&global_preconditioner_==AMG_PRECONDITIONER,std::runtime_error,
+    "Error, the AMG_PRECONDITIONER requires an assembled tangent, use the JACOBI_PRECONDITIONER with global_use_matrix_free");
+#ifndef DICE_ENABLE_ML
+  TEUCHOS_TEST_FOR_EXCEPTION(global_preconditioner_==AMG_PRECONDITIONER,std::runtime_error,
+    "Error, the AMG_PRECONDITIONER requires Trilinos to be built with ML");
+#endif
+  TEUCHOS_TEST_FOR_EXCEPTION(global_preconditioner_==BLOCK_PRECONDITIONER&&!is_mixed_formulation(),std::runtime_error,
+    "Error, the BLOCK_PRECONDITIONER is only available for the mixed formulations");
+  TEUCHOS_TEST_FOR_EXCEPTION(global_preconditioner_==BLOCK_PRECONDITIONER&&global_solver_!=GMRES_SOLVER,std::runtime_error,
+    "Error, the BLOCK_PRECONDITIONER is not symmetric and requires the GMRES_SOLVER");
+  reuse_preconditioner_ = params->get<bool>(DICe::global_reuse_preconditioner,false);
+  preconditioner_max_reuse_ = params->get<int_t>(DICe::global_preconditioner_max_reuse,0);
+  preconditioner_rebuild_iterations_ = params->get<int_t>(DICe::global_preconditioner_rebuild_iterations,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(preconditioner_max_reuse_<0,std::runtime_error,"Error, invalid global_preconditioner_max_reuse");
+  DEBUG_MSG("Global_Algorithm::default_constructor_tasks(): reuse preconditioner: " << reuse_preconditioner_ <<
+    " max reuse: " << preconditioner_max_reuse_ << " rebuild iterations: " << preconditioner_rebuild_iterations_);
+
   if(params->isParameter(DICe::global_element_type)){
     std::string elem_str = params->get<std::string>(DICe::global_element_type);
     if(elem_str=="tri6"||elem_str=="TRI6")
@@ -166,13 +235,24 @@ Global_Algorithm::default_constructor_tasks(const Teuchos::RCP<Teuchos::Paramete
     TEUCHOS_TEST_FOR_EXCEPTION(schema_==NULL,std::runtime_error,"If not an mms problem, schema must not be null.");
     TEUCHOS_TEST_FOR_EXCEPTION(!params->isParameter(DICe::subset_file),std::runtime_error,"Error, subset file must be defined");
     const std::string & subset_file = params->get<std::string>(DICe::subset_file);
-    mesh_ = DICe::generate_tri_mesh(element_type_,subset_file,mesh_size_,output_file_name_);
+    const std::string mesh_cache_folder = params->get<std::string>(DICe::global_mesh_cache_folder,"");
+    mesh_ = DICe::generate_tri_mesh(element_type_,subset_file,mesh_size_,output_file_name_,mesh_cache_folder);
   }
   TEUCHOS_TEST_FOR_EXCEPTION(mesh_==Teuchos::null,std::runtime_error,"Error, mesh should not be a null pointer here.");
   if(schema_)
     schema_->mesh() = mesh_;
 
   DICe::mesh::create_output_exodus_file(mesh_,output_folder);
+  const int_t output_buffer_size = params->get<int_t>(DICe::exodus_output_buffer_size,1);
+  TEUCHOS_TEST_FOR_EXCEPTION(output_buffer_size<1,std::runtime_error,"Error, exodus_output_buffer_size must be at least 1");
+  output_frequency_ = params->get<int_t>(DICe::global_output_frequency,1);
+  TEUCHOS_TEST_FOR_EXCEPTION(output_frequency_<1,std::runtime_error,"Error, global_output_frequency must be at least 1");
+  warm_start_extrapolation_ = params->get<bool>(DICe::global_warm_start_extrapolation,false);
+  warm_start_window_size_ = params->get<int_t>(DICe::global_warm_start_window_size,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(warm_start_window_size_<0,std::runtime_error,"Error, invalid global_warm_start_window_size");
+  DEBUG_MSG("Global_Algorithm::default_constructor_tasks(): warm start extrapolation: " << warm_start_extrapolation_ <<
+    " window size: " << warm_start_window_size_);
+  mesh_->set_output_buffer_size(output_buffer_size);
   if(is_mixed_formulation())
     mesh_->create_mixed_node_field_maps(mesh_);
 
@@ -249,6 +329,11 @@ Global_Algorithm::default_constructor_tasks(const Teuchos::RCP<Teuchos::Paramete
 
   stabilization_tau_ = params->get<double>(DICe::global_stabilization_tau,-1.0);
 
+  // the schema has already checked that threads are available (OpenMP and thread safe reference counts)
+  if(schema_)
+    num_threads_ = schema_->num_threads();
+  DEBUG_MSG("Global_Algorithm::default_constructor_tasks(): number of threads used for element assembly: " << num_threads_);
+
   if(global_formulation_==HORN_SCHUNCK||global_formulation_==MIXED_HORN_SCHUNCK){
     TEUCHOS_TEST_FOR_EXCEPTION(!params->isParameter(DICe::global_regularization_alpha),std::runtime_error,
       "Error, global_regularization_alpha must be defined");
@@ -398,6 +483,18 @@ Global_Algorithm::pre_execution_tasks(){
   }
 
   DEBUG_MSG("Global_Algorithm::pre_execution_tasks(): BC_Manager has been initialized.");
+
+  quadrature_cache_ = Teuchos::rcp(new Quadrature_Cache(this));
+  DEBUG_MSG("Global_Algorithm::pre_execution_tasks(): quadrature cache has been initialized.");
+#if DICE_KOKKOS
+  device_image_terms_ = Teuchos::rcp(new Device_Image_Terms(*quadrature_cache_,mesh_->get_flat_data(),ref_img_,grad_x_img_,grad_y_img_));
+  DEBUG_MSG("Global_Algorithm::pre_execution_tasks(): the image terms will be evaluated on the device.");
+#endif
+
+  if(use_matrix_free_){
+    matrix_free_operator_ = Teuchos::rcp(new Matrix_Free_Operator(this));
+    DEBUG_MSG("Global_Algorithm::pre_execution_tasks(): matrix free operator has been initialized.");
+  }
   is_initialized_ = true;
 }
 
@@ -407,239 +504,180 @@ Global_Algorithm::compute_tangent(const bool use_fixed_point){
   DEBUG_MSG("Global_Algorithm::compute_tangent(): Computing the tangent matrix");
   const int_t spa_dim = mesh_->spatial_dimension();
   const int_t relations_size = mesh_->max_num_node_relations();
-  Teuchos::RCP<DICe::MultiField_Matrix> tangent;
-  if(is_mixed_formulation())
-    tangent = Teuchos::rcp(new DICe::MultiField_Matrix(*mesh_->get_mixed_vector_node_dist_map(),relations_size));
-  else
-    tangent = Teuchos::rcp(new DICe::MultiField_Matrix(*mesh_->get_vector_node_dist_map(),relations_size));
-  DEBUG_MSG("Global_Algorithm::execute(): Tangent has been allocated.");
   const int_t mgo = mixed_global_offset();
   DEBUG_MSG("Global_Algorithm::compute_tangent(): mixed global offset: " << mgo);
-
-  // assemble the distributed tangent matrix
-  Teuchos::RCP<DICe::MultiField_Matrix> tangent_overlap;
-  if(is_mixed_formulation())
-    tangent_overlap = Teuchos::rcp(new DICe::MultiField_Matrix(*mesh_->get_mixed_vector_node_overlap_map(),relations_size));
-  else
-    tangent_overlap = Teuchos::rcp(new DICe::MultiField_Matrix(*mesh_->get_vector_node_overlap_map(),relations_size));
-
+  Teuchos::RCP<MultiField_Map> overlap_map = is_mixed_formulation() ? mesh_->get_mixed_vector_node_overlap_map() :
+      mesh_->get_vector_node_overlap_map();
+  Teuchos::RCP<MultiField_Map> dist_map = is_mixed_formulation() ? mesh_->get_mixed_vector_node_dist_map() :
+      mesh_->get_vector_node_dist_map();
+
+  // the sparsity pattern only depends on the mesh and the boundary conditions so the
+  // matrices are allocated and their graphs built on the first assembly, after that the values are refilled in place
+  const bool is_first_assembly = tangent_overlap_==Teuchos::null;
+  if(is_first_assembly){
+    tangent_ = Teuchos::rcp(new DICe::MultiField_Matrix(*dist_map,relations_size));
+    tangent_overlap_ = Teuchos::rcp(new DICe::MultiField_Matrix(*overlap_map,relations_size));
+    tangent_exporter_ = Teuchos::rcp(new MultiField_Exporter(*overlap_map,*dist_map));
+    tangent_col_ids_.resize(tangent_overlap_->num_local_rows());
+    tangent_values_.resize(tangent_overlap_->num_local_rows());
+    DEBUG_MSG("Global_Algorithm::compute_tangent(): Tangent has been allocated.");
+  }
+  else{
+    tangent_overlap_->resume_fill();
+    tangent_->resume_fill();
+  }
   // clear the jacobian values
-  tangent_overlap->put_scalar(0.0);
-  tangent->put_scalar(0.0);
-  // allocate simple temp arrays for holding values of the local jacobain contributions
+  tangent_overlap_->put_scalar(0.0);
+  tangent_->put_scalar(0.0);
+  // clear the temp arrays used to collect the local jacobian contributions for each row
   // this will hopefully limit the number of calls to crsmatrix.insertGlobalValues
-  std::map<int_t,Teuchos::Array<int_t> > col_id_array_map;
-  std::map<int_t,Teuchos::Array<mv_scalar_type> > values_array_map;
-  for(int_t i=0;i<tangent_overlap->num_local_rows();++i)
-  {
-    Teuchos::Array<int_t> id_array;
-    Teuchos::Array<int_t> local_id_array;
-    const int_t row_gid = is_mixed_formulation() ? mesh_->get_mixed_vector_node_overlap_map()->get_global_element(i) :
-        mesh_->get_vector_node_overlap_map()->get_global_element(i);
-    col_id_array_map.insert(std::pair<int_t,Teuchos::Array<int_t> >(row_gid,id_array));
-    Teuchos::Array<mv_scalar_type> value_array;
-    values_array_map.insert(std::pair<int_t,Teuchos::Array<mv_scalar_type> >(row_gid,value_array));
-  }
-  // establish the shape functions (using P2-P1 element for velocity pressure, or P2 velocity if no constraint):
-  DICe::mesh::Shape_Function_Evaluator_Factory shape_func_eval_factory;
-  Teuchos::RCP<DICe::mesh::Shape_Function_Evaluator> shape_func_evaluator = element_type_ ==DICe::mesh::TRI6 ?
-      shape_func_eval_factory.create(DICe::mesh::TRI6):
-      shape_func_eval_factory.create(DICe::mesh::TRI3);
-  const int_t num_funcs = shape_func_evaluator->num_functions();
-  std::vector<scalar_t> N(num_funcs);
-  std::vector<scalar_t> DN(num_funcs*spa_dim);
-  std::vector<int_t> node_ids(num_funcs);
-  std::vector<scalar_t> nodal_coords(num_funcs*spa_dim);
-  std::vector<scalar_t> nodal_disp(num_funcs*spa_dim);
-  std::vector<scalar_t> jac(spa_dim*spa_dim);
-  std::vector<scalar_t> inv_jac(spa_dim*spa_dim);
-  scalar_t J =0.0;
-  std::vector<scalar_t> elem_stiffness(num_funcs*spa_dim*num_funcs*spa_dim);
-  std::vector<scalar_t> elem_div_stiffness(num_funcs*spa_dim*num_funcs);
-  std::vector<scalar_t> elem_stab_stiffness(num_funcs*num_funcs);
-
-  //scalar_t grad_phi[spa_dim];
-  scalar_t x=0.0,y=0.0;
-  scalar_t bx=0.0,by=0.0;
-
-  // get the natural integration points for this element:
-  const int_t integration_order = 6;
-  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > gp_locs;
-  Teuchos::ArrayRCP<scalar_t> gp_weights;
-  int_t num_integration_points = -1;
-  shape_func_evaluator->get_natural_integration_points(integration_order,gp_locs,gp_weights,num_integration_points);
-  const int_t natural_coord_dim = gp_locs[0].size();
-  std::vector<scalar_t> natural_coords(natural_coord_dim);
-
-  const int_t image_integration_order = num_image_integration_points_;
-  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > image_gp_locs;
-  Teuchos::ArrayRCP<scalar_t> image_gp_weights;
-  int_t num_image_integration_points = -1;
-  tri2d_nonexact_integration_points(image_integration_order,image_gp_locs,image_gp_weights,num_image_integration_points);
+  for(size_t i=0;i<tangent_col_ids_.size();++i){
+    tangent_col_ids_[i].clear();
+    tangent_values_[i].clear();
+  }
+  // the shape functions, integration point locations and jacobians of the reference configuration are cached
+  TEUCHOS_TEST_FOR_EXCEPTION(quadrature_cache_==Teuchos::null,std::runtime_error,
+    "Error, the quadrature cache has not been initialized (pre_execution_tasks() must be called first)");
+  const Quadrature_Cache & quad = *quadrature_cache_;
+  const int_t num_funcs = quad.num_funcs();
+  const int_t stiffness_size = num_funcs*spa_dim*num_funcs*spa_dim;
+  const int_t div_stiffness_size = num_funcs*spa_dim*num_funcs;
+  const int_t stab_stiffness_size = num_funcs*num_funcs;
+  const int_t num_integration_points = quad.num_gps();
+  const int_t num_image_integration_points = quad.num_image_gps();
+  // the cached reference image values can only be used if the integration points are not convected
+  const bool use_cached_image_values = !use_fixed_point && quad.has_reference_image_values();
 
   // gather the OVERLAP fields
-  Teuchos::RCP<MultiField> overlap_coords_ptr = mesh_->get_overlap_field(field_enums::INITIAL_COORDINATES_FS);
-  MultiField & overlap_coords = *overlap_coords_ptr;
-  Teuchos::ArrayRCP<const scalar_t> coords_values = overlap_coords.get_1d_view();
   Teuchos::RCP<MultiField> overlap_disp_ptr = mesh_->get_overlap_field(field_enums::DISPLACEMENT_FS);
   MultiField & overlap_disp = *overlap_disp_ptr;
   Teuchos::ArrayRCP<const scalar_t> disp_values = overlap_disp.get_1d_view();
-
-  // element loop
-  DICe::mesh::element_set::iterator elem_it = mesh_->get_element_set()->begin();
-  DICe::mesh::element_set::iterator elem_end = mesh_->get_element_set()->end();
-  for(;elem_it!=elem_end;++elem_it)
+#if DICE_KOKKOS
+  // the image integration points are evaluated on the device below
+  const bool image_terms_on_host = false;
+#else
+  const bool image_terms_on_host = true;
+#endif
+
+  // the element matrices are computed concurrently into storage owned by each element and then assembled
+  // in element order below so the tangent does not depend on the number of threads
+  const DICe::mesh::Flat_Mesh_Data & flat = mesh_->get_flat_data();
+  const int_t num_elem = flat.num_elem();
+  TEUCHOS_TEST_FOR_EXCEPTION(quad.num_elem()!=num_elem,std::runtime_error,"Error, the quadrature cache does not match the mesh");
+  std::vector<scalar_t> all_elem_stiffness(num_elem*stiffness_size,0.0);
+  std::vector<scalar_t> all_elem_div_stiffness(num_elem*div_stiffness_size,0.0);
+  std::vector<scalar_t> all_elem_stab_stiffness(num_elem*stab_stiffness_size,0.0);
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr elem_error;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads_) if(num_threads_>1)
+#endif
   {
-    //std::cout << "*********ELEM: " << elem_it->get()->global_id() << std::endl;
-    const DICe::mesh::connectivity_vector & connectivity = *elem_it->get()->connectivity();
-    // compute the shape functions and derivatives for this element:
-    for(int_t nd=0;nd<num_funcs;++nd){
-      node_ids[nd] = connectivity[nd]->global_id();
-      for(int_t dim=0;dim<spa_dim;++dim){
-        //std::cout << " gid " << node_ids[nd] << std::endl;
-        nodal_coords[nd*spa_dim+dim] = coords_values[connectivity[nd]->overlap_local_id()*spa_dim + dim];
-        nodal_disp[nd*spa_dim+dim] = disp_values[connectivity[nd]->overlap_local_id()*spa_dim + dim];
-      }
-    }
-    // clear the elem stiffness
-    for(int_t i=0;i<num_funcs*spa_dim*num_funcs*spa_dim;++i)
-      elem_stiffness[i] = 0.0;
-    // clear the div stiffness storage
-    for(int_t i=0;i<num_funcs*spa_dim*num_funcs;++i)
-      elem_div_stiffness[i] = 0.0;
-    // clear the stab stiffness storage
-    for(int_t i=0;i<num_funcs*num_funcs;++i)
-      elem_stab_stiffness[i] = 0.0;
-
-    // low-order gauss point loop:
-    for(int_t gp=0;gp<num_integration_points;++gp){
-
-      // isoparametric coords of the gauss point
-      for(int_t dim=0;dim<natural_coord_dim;++dim){
-        natural_coords[dim] = gp_locs[gp][dim];
-        //std::cout << " natural coords " << dim << " " << natural_coords[dim] << std::endl;
-      }
-      // evaluate the shape functions and derivatives:
-      shape_func_evaluator->evaluate_shape_functions(&natural_coords[0],&N[0]);
-      shape_func_evaluator->evaluate_shape_function_derivatives(&natural_coords[0],&DN[0]);
+    std::vector<scalar_t> nodal_disp(num_funcs*spa_dim);
+    scalar_t bx=0.0,by=0.0;
+
+    // element loop
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t elem=0;elem<num_elem;++elem){
+      try{
+        const int_t * elem_nodes = flat.elem_nodes(elem);
+        scalar_t * elem_stiffness = &all_elem_stiffness[elem*stiffness_size];
+        scalar_t * elem_div_stiffness = &all_elem_div_stiffness[elem*div_stiffness_size];
+        scalar_t * elem_stab_stiffness = &all_elem_stab_stiffness[elem*stab_stiffness_size];
+        if(use_fixed_point){
+          for(int_t nd=0;nd<num_funcs;++nd)
+            for(int_t dim=0;dim<spa_dim;++dim)
+              nodal_disp[nd*spa_dim+dim] = disp_values[elem_nodes[nd]*spa_dim + dim];
+        }
 
-      // physical gp location
-      x = 0.0; y=0.0;
-      for(int_t i=0;i<num_funcs;++i){
-        x += nodal_coords[i*spa_dim+0]*N[i];
-        y += nodal_coords[i*spa_dim+1]*N[i];
-      }
-      //std::cout << " physical coords " << x << " " << y << std::endl;
+        // low-order gauss point loop:
+        for(int_t gp=0;gp<num_integration_points;++gp){
+          const scalar_t * N = quad.N(gp);
+          const scalar_t * DN = quad.DN(gp);
+          const scalar_t * inv_jac = quad.inv_jac(elem,gp);
+          const scalar_t x = quad.x(elem,gp);
+          const scalar_t y = quad.y(elem,gp);
+          const scalar_t J = quad.J(elem,gp);
+          const scalar_t gp_weight = quad.gp_weight(gp);
+
+          scalar_t tau = 0.0;
+          if(is_mixed_formulation()){
+            tau = stabilization_tau_ == -1.0 ? compute_tau_tri3(global_formulation_,alpha2_,quad.natural_coords(gp),J,inv_jac) :
+                stabilization_tau_;
+          }
 
-      // compute the jacobian for this element:
-      DICe::global::calc_jacobian(&nodal_coords[0],&DN[0],&jac[0],&inv_jac[0],J,num_funcs,spa_dim);
+          // grad(phi) tensor_prod grad(phi)
+          if(has_term(MMS_IMAGE_GRAD_TENSOR))
+            mms_image_grad_tensor(mms_problem_,spa_dim,num_funcs,x,y,J,gp_weight,N,elem_stiffness);
 
-      scalar_t tau = 0.0;
-      if(is_mixed_formulation()){
-        tau = stabilization_tau_ == -1.0 ? compute_tau_tri3(global_formulation_,alpha2_,&natural_coords[0],J,&inv_jac[0]) :
-            stabilization_tau_;
-      }
+          // alpha^2 * div(0.5*(grad(b) + grad(b)^T))
+          if(has_term(DIV_SYMMETRIC_STRAIN_REGULARIZATION))
+            div_symmetric_strain(spa_dim,num_funcs,alpha2_,J,gp_weight,inv_jac,DN,elem_stiffness);
 
-      // grad(phi) tensor_prod grad(phi)
-      if(has_term(MMS_IMAGE_GRAD_TENSOR))
-        mms_image_grad_tensor(mms_problem_,spa_dim,num_funcs,x,y,J,gp_weights[gp],&N[0],&elem_stiffness[0]);
-
-      // alpha^2 * div(0.5*(grad(b) + grad(b)^T))
-      if(has_term(DIV_SYMMETRIC_STRAIN_REGULARIZATION))
-        div_symmetric_strain(spa_dim,num_funcs,alpha2_,J,gp_weights[gp],&inv_jac[0],&DN[0],&elem_stiffness[0]);
-
-      // alpha^2 * b
-      if(has_term(TIKHONOV_REGULARIZATION))
-        tikhonov_tensor(this,spa_dim,num_funcs,J,gp_weights[gp],&N[0],tau,&elem_stiffness[0]);
-      //lumped_tikhonov_tensor(this,spa_dim,tri6_num_funcs,J,gp_weights[gp],N6,elem_stiffness);
-
-      // mixed formulation stiffness terms
-
-      // grad(lambda)
-      if(has_term(DIV_VELOCITY))
-        div_velocity(spa_dim,num_funcs,J,gp_weights[gp],&inv_jac[0],&DN[0],&N[0],alpha2_,tau,&elem_div_stiffness[0]);
-
-      if(has_term(STAB_LAGRANGE))
-        stab_lagrange(spa_dim,num_funcs,J,gp_weights[gp],&inv_jac[0],&DN[0],tau,&elem_stab_stiffness[0]);
-
-      //      std::cout << "INT div stiff " << std::endl;
-      //      for(int_t j=0;j<lag_num_funcs;++j){
-      //        for(int_t i=0;i<vel_num_funcs*spa_dim;++i){
-      //          std::cout << elem_div_stiffness[j*vel_num_funcs*spa_dim + i] << " ";
-      //        }
-      //        std::cout << std::endl;
-      //      }
-
-
-//      std::cout << "INT kpp stiff " << std::endl;
-//      for(int_t j=0;j<num_funcs;++j){
-//        for(int_t i=0;i<num_funcs;++i){
-//          std::cout << elem_stab_stiffness[j*num_funcs + i] << " ";
-//        }
-//        std::cout << std::endl;
-//      }
-
-    } // gp loop
-
-//    std::cout << "div stiff " << std::endl;
-//    for(int_t j=0;j<num_funcs;++j){
-//      for(int_t i=0;i<num_funcs*spa_dim;++i){
-//        std::cout << elem_div_stiffness[j*num_funcs*spa_dim + i] << " ";
-//      }
-//      std::cout << std::endl;
-//    }
-//
-//    std::cout << "Kvv stiff " << std::endl;
-//    for(int_t j=0;j<num_funcs*spa_dim;++j){
-//      for(int_t i=0;i<num_funcs*spa_dim;++i){
-//        std::cout << elem_stiffness[j*num_funcs*spa_dim + i] << " ";
-//      }
-//      std::cout << std::endl;
-//    }
-//
-//    std::cout << "Kp stiff " << std::endl;
-//    for(int_t j=0;j<num_funcs;++j){
-//      for(int_t i=0;i<num_funcs;++i){
-//        std::cout << elem_stab_stiffness[j*num_funcs + i] << " ";
-//      }
-//      std::cout << std::endl;
-//    }
-
-    // low-order gauss point loop:
-    // TODO maybe merge this with the one above FIXME
-    for(int_t gp=0;gp<num_image_integration_points;++gp){
-
-      // isoparametric coords of the gauss point
-      for(int_t dim=0;dim<natural_coord_dim;++dim){
-        natural_coords[dim] = image_gp_locs[gp][dim];
-        //std::cout << " natural coords " << dim << " " << natural_coords[dim] << std::endl;
-      }
-      // evaluate the shape functions and derivatives:
-      shape_func_evaluator->evaluate_shape_functions(&natural_coords[0],&N[0]);
-      shape_func_evaluator->evaluate_shape_function_derivatives(&natural_coords[0],&DN[0]);
+          // alpha^2 * b
+          if(has_term(TIKHONOV_REGULARIZATION))
+            tikhonov_tensor(this,spa_dim,num_funcs,J,gp_weight,N,tau,elem_stiffness);
 
-      // physical gp location
-      x = 0.0; y=0.0;
-      bx = 0.0; by=0.0;
-      for(int_t i=0;i<num_funcs;++i){
-        x += nodal_coords[i*spa_dim+0]*N[i];
-        y += nodal_coords[i*spa_dim+1]*N[i];
-        if(use_fixed_point){
-          bx += nodal_disp[i*spa_dim+0]*N[i];
-          by += nodal_disp[i*spa_dim+1]*N[i];
-        }
-      }
-      //std::cout << " physical coords " << x << " " << y << std::endl;
+          // mixed formulation stiffness terms
 
-      // compute the jacobian for this element:
-      DICe::global::calc_jacobian(&nodal_coords[0],&DN[0],&jac[0],&inv_jac[0],J,num_funcs,spa_dim);
+          // grad(lambda)
+          if(has_term(DIV_VELOCITY))
+            div_velocity(spa_dim,num_funcs,J,gp_weight,inv_jac,DN,N,alpha2_,tau,elem_div_stiffness);
 
-      // grad(phi) tensor_prod grad(phi)
-      if(has_term(IMAGE_GRAD_TENSOR))
-        image_grad_tensor(this,spa_dim,num_funcs,x,y,bx,by,J,image_gp_weights[gp],&N[0],&elem_stiffness[0]);
+          if(has_term(STAB_LAGRANGE))
+            stab_lagrange(spa_dim,num_funcs,J,gp_weight,inv_jac,DN,tau,elem_stab_stiffness);
+        } // gp loop
 
-    } // image gp loop
+        // image gauss point loop:
+        if(image_terms_on_host&&has_term(IMAGE_GRAD_TENSOR)){
+          for(int_t gp=0;gp<num_image_integration_points;++gp){
+            const scalar_t * N = quad.image_N(gp);
+            const scalar_t J = quad.image_J(elem,gp);
+            const scalar_t gp_weight = quad.image_gp_weight(gp);
 
+            // grad(phi) tensor_prod grad(phi)
+            if(use_cached_image_values){
+              image_grad_tensor(spa_dim,num_funcs,quad.grad_phi_x(elem,gp),quad.grad_phi_y(elem,gp),J,gp_weight,N,elem_stiffness);
+            }
+            else{
+              bx = 0.0; by=0.0;
+              if(use_fixed_point){
+                for(int_t i=0;i<num_funcs;++i){
+                  bx += nodal_disp[i*spa_dim+0]*N[i];
+                  by += nodal_disp[i*spa_dim+1]*N[i];
+                }
+              }
+              image_grad_tensor(this,spa_dim,num_funcs,quad.image_x(elem,gp),quad.image_y(elem,gp),bx,by,J,gp_weight,N,elem_stiffness);
+            }
+          } // image gp loop
+        }
+      }
+      catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_global_tangent_error)
+#endif
+        {
+          if(!elem_error) elem_error = std::current_exception();
+        }
+      }
+    }  // elem
+  } // parallel region
+  if(elem_error) std::rethrow_exception(elem_error);
+#if DICE_KOKKOS
+  if(has_term(IMAGE_GRAD_TENSOR))
+    device_image_terms_->add_image_grad_tensor(grad_x_img_,grad_y_img_,disp_values,use_fixed_point,all_elem_stiffness.data());
+#endif
+
+  std::vector<int_t> node_ids(num_funcs);
+  for(int_t elem=0;elem<num_elem;++elem){
+    const int_t * elem_gids = flat.elem_node_gids(elem);
+    for(int_t nd=0;nd<num_funcs;++nd)
+      node_ids[nd] = elem_gids[nd];
+    const scalar_t * elem_stiffness = &all_elem_stiffness[elem*stiffness_size];
+    const scalar_t * elem_div_stiffness = &all_elem_div_stiffness[elem*div_stiffness_size];
+    const scalar_t * elem_stab_stiffness = &all_elem_stab_stiffness[elem*stab_stiffness_size];
     //DEBUG_MSG("Global_Algorithm::compute_tangent(): Assembling the tangent matrix");
     // assemble the global stiffness matrix
     for(int_t i=0;i<num_funcs;++i){
@@ -656,8 +694,9 @@ Global_Algorithm::compute_tangent(const bool use_fixed_point){
           const bool is_p_row = is_local_mixed_row_node ?
               bc_manager_->is_mixed_bc(mesh_->get_scalar_node_dist_map()->get_local_element(node_ids[i])) : false;
           if(!row_is_bc_node&&!is_p_row){// && !col_is_bc_node){
-            col_id_array_map.find(row)->second.push_back(col);
-            values_array_map.find(row)->second.push_back(value);
+            const int_t row_lid = overlap_map->get_local_element(row);
+            tangent_col_ids_[row_lid].push_back(col);
+            tangent_values_[row_lid].push_back(value);
           }
         } // tri3_num_funcs
       }
@@ -676,16 +715,18 @@ Global_Algorithm::compute_tangent(const bool use_fixed_point){
             const bool is_p_row = is_local_mixed_row_node ?
                 bc_manager_->is_mixed_bc(mesh_->get_scalar_node_dist_map()->get_local_element(node_ids[i])) : false;
             if(!row_is_bc_node&&!is_p_row){// && !col_is_bc_node){
-              col_id_array_map.find(row)->second.push_back(col);
-              values_array_map.find(row)->second.push_back(value);
+              const int_t row_lid = overlap_map->get_local_element(row);
+              tangent_col_ids_[row_lid].push_back(col);
+              tangent_values_[row_lid].push_back(value);
               // transpose should be the same value
             }
             const bool is_local_mixed_col_node =  mesh_->get_scalar_node_dist_map()->is_node_global_elem(node_ids[j]); // using the non-mixed map because the row is a velocity row
             const bool is_p_col = is_local_mixed_col_node ?
                 bc_manager_->is_mixed_bc(mesh_->get_scalar_node_dist_map()->get_local_element(node_ids[j])) : false;
             if(!is_p_col){
-              col_id_array_map.find(col)->second.push_back(row);
-              values_array_map.find(col)->second.push_back(value);
+              const int_t col_lid = overlap_map->get_local_element(col);
+              tangent_col_ids_[col_lid].push_back(row);
+              tangent_values_[col_lid].push_back(value);
             }
           } // tri3_num_funcs
         }
@@ -699,9 +740,10 @@ Global_Algorithm::compute_tangent(const bool use_fixed_point){
             const bool row_is_bc_node = is_local_row_node ?
                 bc_manager_->is_row_bc(mesh_->get_vector_node_dist_map()->get_local_element(row)) : false;
             if(!row_is_bc_node){// && !col_is_bc_node){
-              TEUCHOS_TEST_FOR_EXCEPTION(col_id_array_map.find(row)==col_id_array_map.end(),std::runtime_error,"Error, invalid col id");
-              col_id_array_map.find(row)->second.push_back(col);
-              values_array_map.find(row)->second.push_back(value);
+              const int_t row_lid = overlap_map->get_local_element(row);
+              TEUCHOS_TEST_FOR_EXCEPTION(row_lid<0,std::runtime_error,"Error, invalid col id");
+              tangent_col_ids_[row_lid].push_back(col);
+              tangent_values_[row_lid].push_back(value);
             }
           } // spa dim
         } // num_funcs
@@ -712,8 +754,9 @@ Global_Algorithm::compute_tangent(const bool use_fixed_point){
   for(int_t i=0;i<mesh_->get_vector_node_overlap_map()->get_num_local_elements();++i){
     if(bc_manager_->is_col_bc(i)){
       const int_t global_id = mesh_->get_vector_node_overlap_map()->get_global_element(i);
-      col_id_array_map.find(global_id)->second.push_back(global_id);
-      values_array_map.find(global_id)->second.push_back(1.0);
+      const int_t lid = overlap_map->get_local_element(global_id);
+      tangent_col_ids_[lid].push_back(global_id);
+      tangent_values_[lid].push_back(1.0);
     }
   }
   /// lagrange multiplier bc
@@ -721,36 +764,40 @@ Global_Algorithm::compute_tangent(const bool use_fixed_point){
     for(int_t i=0;i<mesh_->get_scalar_node_overlap_map()->get_num_local_elements();++i){
       if(bc_manager_->is_mixed_bc(i)){
         const int_t global_id = mesh_->get_scalar_node_overlap_map()->get_global_element(i) + mgo;
-        col_id_array_map.find(global_id)->second.push_back(global_id);
-        values_array_map.find(global_id)->second.push_back(1.0);
+        const int_t lid = overlap_map->get_local_element(global_id);
+        tangent_col_ids_[lid].push_back(global_id);
+        tangent_values_[lid].push_back(1.0);
       }
     }
   }
-  std::map<int_t,Teuchos::Array<int_t> >::iterator cmap_it = col_id_array_map.begin();
-  std::map<int_t,Teuchos::Array<int_t> >::iterator cmap_end = col_id_array_map.end();
-  for(;cmap_it!=cmap_end;++cmap_it){
-    int_t global_row = cmap_it->first;
-    const Teuchos::Array<int_t> ids_array = cmap_it->second;
-    const Teuchos::Array<mv_scalar_type> values_array = values_array_map.find(cmap_it->first)->second;
-    if(ids_array.empty()) continue;
-    // now do the insertGlobalValues calls:
-    tangent_overlap->insert_global_values(global_row,ids_array,values_array);
-  }
-  tangent_overlap->fill_complete();
-  if(is_mixed_formulation()){
-    MultiField_Exporter exporter (*mesh_->get_mixed_vector_node_overlap_map(),*mesh_->get_mixed_vector_node_dist_map());
-    tangent->do_export(tangent_overlap, exporter, ADD);
+  bool pattern_changed = false;
+  for(size_t i=0;i<tangent_col_ids_.size();++i){
+    if(tangent_col_ids_[i].empty()) continue;
+    const int_t global_row = overlap_map->get_global_element(i);
+    if(is_first_assembly){
+      // now do the insertGlobalValues calls:
+      tangent_overlap_->insert_global_values(global_row,tangent_col_ids_[i],tangent_values_[i]);
+    }
+    else if(!tangent_overlap_->sum_into_global_values(global_row,tangent_col_ids_[i],tangent_values_[i])){
+      pattern_changed = true;
+      break;
+    }
   }
-  else{
-    MultiField_Exporter exporter (*mesh_->get_vector_node_overlap_map(),*mesh_->get_vector_node_dist_map());
-    tangent->do_export(tangent_overlap, exporter, ADD);
+  if(pattern_changed){
+    // a contribution fell outside the stored graph so the matrices have to be rebuilt from scratch
+    DEBUG_MSG("Global_Algorithm::compute_tangent(): the tangent sparsity pattern changed, rebuilding the graph");
+    tangent_ = Teuchos::null;
+    tangent_overlap_ = Teuchos::null;
+    tangent_exporter_ = Teuchos::null;
+    return compute_tangent(use_fixed_point);
   }
-  tangent->fill_complete();
-  //tangent->describe();
-  return tangent;
+  tangent_overlap_->fill_complete();
+  tangent_->do_export(tangent_overlap_, *tangent_exporter_, ADD);
+  tangent_->fill_complete();
+  //tangent_->describe();
+  return tangent_;
 }
 
-scalar_t
 Global_Algorithm::compute_residual(const bool use_fixed_point){
 
   DEBUG_MSG("Global_Algorithm::compute_residual(): computing the residual.");
@@ -763,142 +810,122 @@ Global_Algorithm::compute_residual(const bool use_fixed_point){
     residual = mesh_->get_field(field_enums::RESIDUAL_FS);
   residual->put_scalar(0.0);
 
-  // establish the shape functions (using P2-P1 element for velocity pressure, or P2 velocity if no constraint):
-  DICe::mesh::Shape_Function_Evaluator_Factory shape_func_eval_factory;
-  Teuchos::RCP<DICe::mesh::Shape_Function_Evaluator> shape_func_evaluator = element_type_==DICe::mesh::TRI6 ?
-      shape_func_eval_factory.create(DICe::mesh::TRI6) :
-      shape_func_eval_factory.create(DICe::mesh::TRI3);
-  const int_t num_funcs = shape_func_evaluator->num_functions();
-  std::vector<scalar_t> N(num_funcs);
-  std::vector<scalar_t> DN(num_funcs*spa_dim);
-  std::vector<scalar_t> nodal_coords(num_funcs*spa_dim);
-  std::vector<scalar_t> nodal_disp(num_funcs*spa_dim);
-  std::vector<scalar_t> jac(spa_dim*spa_dim);
-  std::vector<scalar_t> inv_jac(spa_dim*spa_dim);
-  scalar_t J =0.0;
-  std::vector<scalar_t> elem_force(num_funcs*spa_dim);
-  scalar_t x=0.0,y=0.0,bx=0.0,by=0.0;
-
-  // get the natural integration points for this element:
-  const int_t integration_order = 6;
-  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > gp_locs;
-  Teuchos::ArrayRCP<scalar_t> gp_weights;
-  int_t num_integration_points = -1;
-  shape_func_evaluator->get_natural_integration_points(integration_order,gp_locs,gp_weights,num_integration_points);
-  const int_t natural_coord_dim = gp_locs[0].size();
-  std::vector<scalar_t> natural_coords(natural_coord_dim);
-
-  const int_t image_integration_order = num_image_integration_points_;
-  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > image_gp_locs;
-  Teuchos::ArrayRCP<scalar_t> image_gp_weights;
-  int_t num_image_integration_points = -1;
-  tri2d_nonexact_integration_points(image_integration_order,image_gp_locs,image_gp_weights,num_image_integration_points);
-//  Teuchos::RCP<MultiField> overlap_residual_ptr = is_mixed_formulation() ? mesh_->get_overlap_field(field_enums::MIXED_RESIDUAL_FS):
-//      mesh_->get_overlap_field(field_enums::RESIDUAL_FS);
-//  MultiField & overlap_residual = *overlap_residual_ptr;
-//  overlap_residual.put_scalar(0.0);
-  Teuchos::RCP<MultiField> overlap_coords_ptr = mesh_->get_overlap_field(field_enums::INITIAL_COORDINATES_FS);
-  MultiField & overlap_coords = *overlap_coords_ptr;
-  Teuchos::ArrayRCP<const scalar_t> coords_values = overlap_coords.get_1d_view();
+  // the shape functions, integration point locations and jacobians of the reference configuration are cached
+  TEUCHOS_TEST_FOR_EXCEPTION(quadrature_cache_==Teuchos::null,std::runtime_error,
+    "Error, the quadrature cache has not been initialized (pre_execution_tasks() must be called first)");
+  const Quadrature_Cache & quad = *quadrature_cache_;
+  const int_t num_funcs = quad.num_funcs();
+  const int_t force_size = num_funcs*spa_dim;
+  const int_t num_integration_points = quad.num_gps();
+  const int_t num_image_integration_points = quad.num_image_gps();
+  // the cached reference image values can only be used if the integration points are not convected
+  const bool use_cached_image_values = !use_fixed_point && quad.has_reference_image_values();
+
   Teuchos::RCP<MultiField> overlap_disp_ptr = mesh_->get_overlap_field(field_enums::DISPLACEMENT_FS);
   MultiField & overlap_disp = *overlap_disp_ptr;
   Teuchos::ArrayRCP<const scalar_t> disp_values = overlap_disp.get_1d_view();
-
-  // element loop
-  DICe::mesh::element_set::iterator elem_it = mesh_->get_element_set()->begin();
-  DICe::mesh::element_set::iterator elem_end = mesh_->get_element_set()->end();
-  for(;elem_it!=elem_end;++elem_it)
+#if DICE_KOKKOS
+  // the image integration points are evaluated on the device below
+  const bool image_terms_on_host = false;
+#else
+  const bool image_terms_on_host = true;
+#endif
+
+  // the element forces are computed concurrently into storage owned by each element and then assembled
+  // in element order below so the residual does not depend on the number of threads
+  const DICe::mesh::Flat_Mesh_Data & flat = mesh_->get_flat_data();
+  const int_t num_elem = flat.num_elem();
+  TEUCHOS_TEST_FOR_EXCEPTION(quad.num_elem()!=num_elem,std::runtime_error,"Error, the quadrature cache does not match the mesh");
+  std::vector<scalar_t> all_elem_force(num_elem*force_size,0.0);
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr elem_error;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads_) if(num_threads_>1)
+#endif
   {
-    //std::cout << "ELEM: " << elem_it->get()->global_id() << std::endl;
-    const DICe::mesh::connectivity_vector & connectivity = *elem_it->get()->connectivity();
-    // compute the shape functions and derivatives for this element:
-    for(int_t nd=0;nd<num_funcs;++nd){
-      for(int_t dim=0;dim<spa_dim;++dim){
-        nodal_coords[nd*spa_dim+dim] = coords_values[connectivity[nd]->overlap_local_id()*spa_dim + dim];
-        nodal_disp[nd*spa_dim+dim] = disp_values[connectivity[nd]->overlap_local_id()*spa_dim + dim];
-      }
-    }
-    // clear the elem force
-    for(int_t i=0;i<num_funcs*spa_dim;++i)
-      elem_force[i] = 0.0;
-
-    if(mms_problem_!=Teuchos::null){
-      // low-order gauss point loop:
-      for(int_t gp=0;gp<num_integration_points;++gp){
-
-        // isoparametric coords of the gauss point
-        for(int_t dim=0;dim<natural_coord_dim;++dim){
-          natural_coords[dim] = gp_locs[gp][dim];
-          //std::cout << " natural coords " << dim << " " << natural_coords[dim] << std::endl;
-        }
-        // evaluate the shape functions and derivatives:
-        shape_func_evaluator->evaluate_shape_functions(&natural_coords[0],&N[0]);
-        shape_func_evaluator->evaluate_shape_function_derivatives(&natural_coords[0],&DN[0]);
-
-        // physical gp location
-        x = 0.0; y=0.0;
-        for(int_t i=0;i<num_funcs;++i){
-          x += nodal_coords[i*spa_dim+0]*N[i];
-          y += nodal_coords[i*spa_dim+1]*N[i];
+    std::vector<scalar_t> nodal_disp(num_funcs*spa_dim);
+    scalar_t bx=0.0,by=0.0;
+
+    // element loop
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t elem=0;elem<num_elem;++elem){
+      try{
+        const int_t * elem_nodes = flat.elem_nodes(elem);
+        scalar_t * elem_force = &all_elem_force[elem*force_size];
+        if(use_fixed_point){
+          for(int_t nd=0;nd<num_funcs;++nd)
+            for(int_t dim=0;dim<spa_dim;++dim)
+              nodal_disp[nd*spa_dim+dim] = disp_values[elem_nodes[nd]*spa_dim + dim];
         }
-        //std::cout << " physical coords " << x << " " << y << std::endl;
-
-        // compute the jacobian for this element:
-        DICe::global::calc_jacobian(&nodal_coords[0],&DN[0],&jac[0],&inv_jac[0],J,num_funcs,spa_dim);
-
-        // mms force
-        if(has_term(MMS_FORCE))
-          mms_force(mms_problem_,spa_dim,num_funcs,x,y,alpha2_,J,gp_weights[gp],&N[0],this->eq_terms(),&elem_force[0]);
-
-        // d_dt(phi) * grad(phi)
-        if(has_term(MMS_IMAGE_TIME_FORCE))
-          mms_image_time_force(mms_problem_,spa_dim,num_funcs,x,y,J,gp_weights[gp],&N[0],&elem_force[0]);
-
-      } // gp loop
-    } // has mms_problem
-
-    // low-order gauss point loop:
-    for(int_t gp=0;gp<num_image_integration_points;++gp){
 
-      // isoparametric coords of the gauss point
-      for(int_t dim=0;dim<natural_coord_dim;++dim){
-        natural_coords[dim] = image_gp_locs[gp][dim];
-        //std::cout << " natural coords " << dim << " " << natural_coords[dim] << std::endl;
+        if(mms_problem_!=Teuchos::null){
+          // low-order gauss point loop:
+          for(int_t gp=0;gp<num_integration_points;++gp){
+            const scalar_t * N = quad.N(gp);
+            const scalar_t x = quad.x(elem,gp);
+            const scalar_t y = quad.y(elem,gp);
+            const scalar_t J = quad.J(elem,gp);
+            const scalar_t gp_weight = quad.gp_weight(gp);
+
+            // mms force
+            if(has_term(MMS_FORCE))
+              mms_force(mms_problem_,spa_dim,num_funcs,x,y,alpha2_,J,gp_weight,N,this->eq_terms(),elem_force);
+
+            // d_dt(phi) * grad(phi)
+            if(has_term(MMS_IMAGE_TIME_FORCE))
+              mms_image_time_force(mms_problem_,spa_dim,num_funcs,x,y,J,gp_weight,N,elem_force);
+
+          } // gp loop
+        } // has mms_problem
+
+        // image gauss point loop:
+        if(image_terms_on_host&&has_term(IMAGE_TIME_FORCE)){
+          for(int_t gp=0;gp<num_image_integration_points;++gp){
+            const scalar_t * N = quad.image_N(gp);
+            const scalar_t x = quad.image_x(elem,gp);
+            const scalar_t y = quad.image_y(elem,gp);
+            const scalar_t J = quad.image_J(elem,gp);
+            const scalar_t gp_weight = quad.image_gp_weight(gp);
+
+            // d_dt(phi) * grad(phi)
+            if(use_cached_image_values){
+              image_time_force(this,spa_dim,num_funcs,x,y,quad.phi_0(elem,gp),quad.grad_phi_x(elem,gp),quad.grad_phi_y(elem,gp),
+                J,gp_weight,N,elem_force);
+            }
+            else{
+              bx = 0.0; by=0.0;
+              if(use_fixed_point){
+                for(int_t i=0;i<num_funcs;++i){
+                  bx += nodal_disp[i*spa_dim+0]*N[i];
+                  by += nodal_disp[i*spa_dim+1]*N[i];
+                }
+              }
+              image_time_force(this,spa_dim,num_funcs,x,y,bx,by,J,gp_weight,N,elem_force);
+            }
+          } // image gp loop
+        }
       }
-      // evaluate the shape functions and derivatives:
-      shape_func_evaluator->evaluate_shape_functions(&natural_coords[0],&N[0]);
-      shape_func_evaluator->evaluate_shape_function_derivatives(&natural_coords[0],&DN[0]);
-
-      // physical gp location
-      x = 0.0; y=0.0;
-      bx = 0.0; by=0.0;
-      for(int_t i=0;i<num_funcs;++i){
-        x += nodal_coords[i*spa_dim+0]*N[i];
-        y += nodal_coords[i*spa_dim+1]*N[i];
-        if(use_fixed_point){
-          bx += nodal_disp[i*spa_dim+0]*N[i];
-          by += nodal_disp[i*spa_dim+1]*N[i];
+      catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_global_residual_error)
+#endif
+        {
+          if(!elem_error) elem_error = std::current_exception();
         }
       }
-      //std::cout << " x " << x << " y " << y <<  " bx " << bx << " by " << by << std::endl;
-      //std::cout << " physical coords " << x << " " << y << std::endl;
-
-      // compute the jacobian for this element:
-      DICe::global::calc_jacobian(&nodal_coords[0],&DN[0],&jac[0],&inv_jac[0],J,num_funcs,spa_dim);
-
-      // d_dt(phi) * grad(phi)
-      if(has_term(IMAGE_TIME_FORCE))
-        image_time_force(this,spa_dim,num_funcs,x,y,bx,by,J,image_gp_weights[gp],&N[0],&elem_force[0]);
-
-      //if(use_fixed_point)
-      //  image_grad_force(this,spa_dim,tri6_num_funcs,x,y,bx,by,J,image_gp_weights[gp],N6,elem_force);
-
-      //// d_dt(phi) * grad(phi)
-      //if(has_term(TIKHONOV_REGULARIZATION)&&use_fixed_point)
-      //  tikhonov_force(this,spa_dim,tri6_num_funcs,bx,by,J,image_gp_weights[gp],N6,elem_force);
-
-    } // image gp loop
-
+    }  // elem
+  } // parallel region
+  if(elem_error) std::rethrow_exception(elem_error);
+#if DICE_KOKKOS
+  if(has_term(IMAGE_TIME_FORCE))
+    device_image_terms_->add_image_time_force(def_img_,ref_img_,grad_x_img_,grad_y_img_,disp_values,use_fixed_point,all_elem_force.data());
+#endif
+
+  for(int_t elem=0;elem<num_elem;++elem){
+    const int_t * elem_gids = flat.elem_node_gids(elem);
+    const scalar_t * elem_force = &all_elem_force[elem*force_size];
     // assemble the force terms
     // (note: no force terms for lagrange multiplier...so assembly is the same if mixed or not)
     for(int_t i=0;i<num_funcs;++i){
@@ -907,7 +934,7 @@ Global_Algorithm::compute_residual(const bool use_fixed_point){
       //overlap_residual.local_value(nodex_local_id) += elem_force[i*spa_dim+0];
       //overlap_residual.local_value(nodey_local_id) += elem_force[i*spa_dim+1];
       for(int_t dim=0;dim<spa_dim;++dim){
-        int_t row = connectivity[i]->global_id()*spa_dim+dim;
+        int_t row = elem_gids[i]*spa_dim+dim;
         //const bool is_local_row_node =  mesh_->get_vector_node_dist_map()->is_node_global_elem(row); // using the non-mixed map because the row is a velocity row
         //const bool row_is_bc_node = is_local_row_node ?
         //    bc_manager_->is_row_bc(mesh_->get_vector_node_dist_map()->get_local_element(row)) : false; // same rationalle here
@@ -923,10 +950,198 @@ Global_Algorithm::compute_residual(const bool use_fixed_point){
 }
 
 
+Teuchos::RCP<Epetra_Operator>
+Global_Algorithm::update_preconditioner(Teuchos::RCP<DICe::MultiField_Matrix> tangent){
+  Preconditioner_Factory factory;
+  // the numeric part is recomputed once it has been used for the max number of solves or
+  // if the last linear solve needed too many iterations (the preconditioner has gone stale)
+  const bool recompute_numeric = preconditioner_num_reuses_ >= preconditioner_max_reuse_ ||
+      (preconditioner_rebuild_iterations_ > 0 && num_linear_iterations_ > preconditioner_rebuild_iterations_);
+  if(global_preconditioner_==JACOBI_PRECONDITIONER){
+    if(!reuse_preconditioner_||preconditioner_==Teuchos::null||recompute_numeric){
+      DEBUG_MSG("Global_Algorithm::update_preconditioner(): computing the Jacobi preconditioner");
+      Epetra_Vector diagonal(*mesh_->get_vector_node_dist_map()->get());
+      if(use_matrix_free_)
+        matrix_free_operator_->extract_diagonal(diagonal);
+      else
+        tangent->get()->ExtractDiagonalCopy(diagonal);
+      preconditioner_ = factory.create_jacobi(diagonal);
+      preconditioner_num_reuses_ = 0;
+    }
+    else{
+      DEBUG_MSG("Global_Algorithm::update_preconditioner(): reusing the Jacobi preconditioner");
+      preconditioner_num_reuses_++;
+    }
+    return preconditioner_;
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(tangent==Teuchos::null,std::runtime_error,"Error, the "
+    << to_string(global_preconditioner_) << " requires the assembled tangent");
+  if(global_preconditioner_==BLOCK_PRECONDITIONER){
+    // the blocks are copies of the tangent values so there is no symbolic part to keep
+    if(!reuse_preconditioner_||preconditioner_==Teuchos::null||preconditioner_matrix_!=tangent->get().get()||recompute_numeric){
+      DEBUG_MSG("Global_Algorithm::update_preconditioner(): computing the block preconditioner");
+      preconditioner_ = factory.create_block(tangent->get(),mixed_global_offset());
+      preconditioner_matrix_ = tangent->get().get();
+      preconditioner_num_reuses_ = 0;
+    }
+    else{
+      DEBUG_MSG("Global_Algorithm::update_preconditioner(): reusing the block preconditioner");
+      preconditioner_num_reuses_++;
+    }
+    return preconditioner_;
+  }
+#ifdef DICE_ENABLE_ML
+  if(global_preconditioner_==AMG_PRECONDITIONER){
+    // the aggregates only depend on the graph, which is kept as long as the tangent matrix is the same object
+    if(!reuse_preconditioner_||ml_preconditioner_==Teuchos::null||preconditioner_matrix_!=tangent->get().get()){
+      DEBUG_MSG("Global_Algorithm::update_preconditioner(): computing the AMG preconditioner");
+      // the lagrange multiplier dofs of the mixed formulation are not grouped by node with the displacements
+      Teuchos::RCP<Teuchos::ParameterList> plist = factory.parameter_list_for_ml(is_mixed_formulation() ? 1 : mesh_->spatial_dimension());
+      ml_preconditioner_ = factory.create_amg(tangent->get(), plist);
+      preconditioner_matrix_ = tangent->get().get();
+      preconditioner_num_reuses_ = 0;
+    }
+    else if(recompute_numeric){
+      // keeps the prolongators and recomputes the coarse operators and smoothers
+      DEBUG_MSG("Global_Algorithm::update_preconditioner(): reusing the AMG prolongators, recomputing the level operators and smoothers");
+      ml_preconditioner_->ReComputePreconditioner();
+      preconditioner_num_reuses_ = 0;
+    }
+    else{
+      DEBUG_MSG("Global_Algorithm::update_preconditioner(): reusing the AMG preconditioner");
+      preconditioner_num_reuses_++;
+    }
+    preconditioner_ = ml_preconditioner_;
+    return preconditioner_;
+  }
+#endif
+  // the symbolic factorization only depends on the graph, which is kept as long as the tangent matrix is the same object
+  if(!reuse_preconditioner_||ifpack_preconditioner_==Teuchos::null||preconditioner_matrix_!=tangent->get().get()){
+    DEBUG_MSG("Global_Algorithm::update_preconditioner(): computing the ILU preconditioner");
+    Teuchos::RCP<Teuchos::ParameterList> plist = factory.parameter_list_for_ifpack();
+    ifpack_preconditioner_ = factory.create (tangent->get(), plist);
+    preconditioner_matrix_ = tangent->get().get();
+    preconditioner_num_reuses_ = 0;
+  }
+  else if(recompute_numeric){
+    DEBUG_MSG("Global_Algorithm::update_preconditioner(): reusing the ILU symbolic factorization, recomputing the numeric factorization");
+    ifpack_preconditioner_->Compute();
+    preconditioner_num_reuses_ = 0;
+  }
+  else{
+    DEBUG_MSG("Global_Algorithm::update_preconditioner(): reusing the ILU preconditioner");
+    preconditioner_num_reuses_++;
+  }
+  preconditioner_ = ifpack_preconditioner_;
+  return preconditioner_;
+}
+
+void
+Global_Algorithm::warm_start(Teuchos::RCP<MultiField> disp,
+  Teuchos::RCP<MultiField> disp_nm1){
+  TEUCHOS_TEST_FOR_EXCEPTION(!schema_,std::runtime_error,"Error, the warm start requires a schema");
+  const int_t spa_dim = mesh_->spatial_dimension();
+  const int_t num_values = mesh_->get_scalar_node_dist_map()->get_num_local_elements()*spa_dim;
+  if(schema_->frame_id()==schema_->first_frame_id()){
+    prev_frame_disp_.clear();
+    if(warm_start_window_size_>0&&!schema_->has_initial_condition_file())
+      seed_from_local_correlation(disp,disp_nm1);
+    return;
+  }
+  if(!warm_start_extrapolation_||schema_->use_incremental_formulation()) return;
+  // disp holds the solution of the last frame
+  std::vector<scalar_t> last_frame_disp(num_values);
+  for(int_t i=0;i<num_values;++i)
+    last_frame_disp[i] = disp->local_value(i);
+  // the extrapolation needs the solutions of two frames
+  if((int_t)prev_frame_disp_.size()==num_values){
+    DEBUG_MSG("Global_Algorithm::warm_start(): extrapolating the displacements of the last two frames");
+    for(int_t i=0;i<num_values;++i){
+      const scalar_t value = 2.0*last_frame_disp[i] - prev_frame_disp_[i];
+      disp->local_value(i) = value;
+      disp_nm1->local_value(i) = value;
+    }
+  }
+  prev_frame_disp_.swap(last_frame_disp);
+}
+
+void
+Global_Algorithm::seed_from_local_correlation(Teuchos::RCP<MultiField> disp,
+  Teuchos::RCP<MultiField> disp_nm1){
+  TEUCHOS_TEST_FOR_EXCEPTION(ref_img_==Teuchos::null||def_img_==Teuchos::null,std::runtime_error,
+    "Error, the images must be set to seed the displacements");
+  DEBUG_MSG("Global_Algorithm::seed_from_local_correlation(): phase correlating a " << warm_start_window_size_ <<
+    " pixel window around each node");
+  const int_t spa_dim = mesh_->spatial_dimension();
+  const int_t num_nodes = mesh_->get_scalar_node_dist_map()->get_num_local_elements();
+  Teuchos::RCP<MultiField> coords = mesh_->get_field(field_enums::INITIAL_COORDINATES_FS);
+  std::vector<scalar_t> node_u_x(num_nodes,0.0);
+  std::vector<scalar_t> node_u_y(num_nodes,0.0);
+  std::vector<char> is_valid(num_nodes,0);
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr window_error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads_) if(num_threads_>1)
+#endif
+  for(int_t i=0;i<num_nodes;++i){
+    try{
+      const int_t cx = (int_t)std::floor(coords->local_value(i*spa_dim+0)+0.5);
+      const int_t cy = (int_t)std::floor(coords->local_value(i*spa_dim+1)+0.5);
+      const scalar_t peak = phase_correlate_window(ref_img_,def_img_,cx,cy,warm_start_window_size_,node_u_x[i],node_u_y[i]);
+      is_valid[i] = peak > 0.0;
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_global_seed_error)
+#endif
+      {
+        if(!window_error) window_error = std::current_exception();
+      }
+    }
+  }
+  if(window_error) std::rethrow_exception(window_error);
+  int_t num_valid = 0;
+  scalar_t avg_u_x = 0.0;
+  scalar_t avg_u_y = 0.0;
+  for(int_t i=0;i<num_nodes;++i){
+    if(!is_valid[i]) continue;
+    avg_u_x += node_u_x[i];
+    avg_u_y += node_u_y[i];
+    num_valid++;
+  }
+  if(num_valid>0){
+    avg_u_x /= num_valid;
+    avg_u_y /= num_valid;
+  }
+  DEBUG_MSG("Global_Algorithm::seed_from_local_correlation(): " << num_valid << " of " << num_nodes <<
+    " nodes correlated, average displacement " << avg_u_x << " " << avg_u_y);
+  for(int_t i=0;i<num_nodes;++i){
+    const scalar_t u_x = is_valid[i] ? node_u_x[i] : avg_u_x;
+    const scalar_t u_y = is_valid[i] ? node_u_y[i] : avg_u_y;
+    disp->local_value(i*spa_dim+0) = u_x;
+    disp->local_value(i*spa_dim+1) = u_y;
+    disp_nm1->local_value(i*spa_dim+0) = u_x;
+    disp_nm1->local_value(i*spa_dim+1) = u_y;
+  }
+}
+
 Status_Flag
 Global_Algorithm::execute(){
   DEBUG_MSG("Global_Algorithm::execute(): method called");
   pre_execution_tasks();
+  assembly_time_ = 0.0;
+  preconditioner_time_ = 0.0;
+  linear_solve_time_ = 0.0;
+  total_linear_iterations_ = 0;
+  num_nonlinear_iterations_ = 0;
+  // returns the seconds since the given time point and resets it to now
+  std::chrono::steady_clock::time_point timer_start;
+  auto elapsed_time = [&timer_start](){
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const scalar_t seconds = std::chrono::duration<scalar_t>(now - timer_start).count();
+    timer_start = now;
+    return seconds;
+  };
 
   const int_t p_rank = mesh_->get_comm()->get_rank();
   const int_t spa_dim = mesh_->spatial_dimension();
@@ -971,6 +1186,7 @@ Global_Algorithm::execute(){
         disp_nm1->local_value(i*spa_dim+1) = disp_y[i];
       }
     }
+    warm_start(disp,disp_nm1);
   }
 //  disp->describe();
 
@@ -988,10 +1204,20 @@ Global_Algorithm::execute(){
   const scalar_t residual_tol = 1.0E-8;
   int_t it=0;
   for(;it<=max_its;++it){
-
-    Teuchos::RCP<DICe::MultiField_Matrix> tangent = compute_tangent(use_fixed_point_iterations_);
-    linear_problem_->setHermitian(true);
-    linear_problem_->setOperator(tangent->get());
+    num_nonlinear_iterations_++;
+    elapsed_time();
+
+    Teuchos::RCP<DICe::MultiField_Matrix> tangent;
+    if(use_matrix_free_){
+      matrix_free_operator_->update(use_fixed_point_iterations_);
+      linear_problem_->setHermitian(true);
+      linear_problem_->setOperator(matrix_free_operator_);
+    }
+    else{
+      tangent = compute_tangent(use_fixed_point_iterations_);
+      linear_problem_->setHermitian(true);
+      linear_problem_->setOperator(tangent->get());
+    }
 
     // apply the initial conditions (sets lhs and disp_nm1)
     bc_manager_->apply_ics(it==0);
@@ -1000,6 +1226,7 @@ Global_Algorithm::execute(){
 
     // apply the boundary conditions
     bc_manager_->apply_bcs(it==0);
+    assembly_time_ += elapsed_time();
 
     //residual->describe();
 
@@ -1022,10 +1249,9 @@ Global_Algorithm::execute(){
     // solve:
     DEBUG_MSG("Global_Algorithm::execute(): Solving the linear system...");
     DEBUG_MSG("Global_Algorithm::execute(): Preconditioning");
-    Preconditioner_Factory factory;
-    Teuchos::RCP<Teuchos::ParameterList> plist = factory.parameter_list_for_ifpack();
-    Teuchos::RCP<Ifpack_Preconditioner> Prec = factory.create (tangent->get(), plist);
+    Teuchos::RCP<Epetra_Operator> Prec = update_preconditioner(tangent);
     Teuchos::RCP<Belos::EpetraPrecOp> belosPrec = Teuchos::rcp( new Belos::EpetraPrecOp( Prec ) );
+    preconditioner_time_ += elapsed_time();
     linear_problem_->setLeftPrec( belosPrec );
     bool is_set = linear_problem_->setProblem(lhs->get(), residual->get());
     TEUCHOS_TEST_FOR_EXCEPTION(!is_set, std::logic_error,
@@ -1033,6 +1259,10 @@ Global_Algorithm::execute(){
     Belos::ReturnType ret = belos_solver_->solve();
     if(ret != Belos::Converged && p_rank==0)
       std::cout << "*** WARNING: Belos linear solver did not converge!" << std::endl;
+    linear_solve_time_ += elapsed_time();
+    num_linear_iterations_ = belos_solver_->getNumIters();
+    total_linear_iterations_ += num_linear_iterations_;
+    DEBUG_MSG("Global_Algorithm::execute(): linear solver iterations: " << num_linear_iterations_);
     // } // end iteration loop
 
     for(int_t i=0;i<mesh_->get_scalar_node_dist_map()->get_num_local_elements();++i){
@@ -1096,8 +1326,6 @@ Global_Algorithm::execute(){
 
   DEBUG_MSG("Global_Algorithm::execute(): linear solve complete");
 
-  compute_strains();
-
   mesh_->print_field_stats();
 
   if(it>=max_its)
@@ -1122,9 +1350,6 @@ Global_Algorithm::compute_strains(){
   Teuchos::RCP<MultiField> gl_yy = mesh_->get_field(field_enums::GREEN_LAGRANGE_STRAIN_YY_FS);
   Teuchos::RCP<MultiField> gl_xy = mesh_->get_field(field_enums::GREEN_LAGRANGE_STRAIN_XY_FS);
   Teuchos::RCP<MultiField> coords = mesh_->get_field(field_enums::INITIAL_COORDINATES_FS);
-  Teuchos::RCP<MultiField> overlap_coords_ptr = mesh_->get_overlap_field(field_enums::INITIAL_COORDINATES_FS);
-  MultiField & overlap_coords = *overlap_coords_ptr;
-  Teuchos::ArrayRCP<const scalar_t> coords_values = overlap_coords.get_1d_view();
   Teuchos::RCP<MultiField> overlap_disp_ptr = mesh_->get_overlap_field(field_enums::DISPLACEMENT_FS);
   MultiField & overlap_disp = *overlap_disp_ptr;
   Teuchos::ArrayRCP<const scalar_t> disp_values = overlap_disp.get_1d_view();
@@ -1150,58 +1375,55 @@ Global_Algorithm::compute_strains(){
   //Teuchos::ArrayRCP<const scalar_t> dvdy_values = overlap_dvdy.get_1d_view();
 
   const int_t spa_dim = mesh_->spatial_dimension();
-  DICe::mesh::Shape_Function_Evaluator_Factory shape_func_eval_factory;
-  Teuchos::RCP<DICe::mesh::Shape_Function_Evaluator> shape_func_evaluator = element_type_==DICe::mesh::TRI6 ?
-      shape_func_eval_factory.create(DICe::mesh::TRI6) : // linear strains
-      shape_func_eval_factory.create(DICe::mesh::TRI3); // constant strains
-  const int_t num_funcs = shape_func_evaluator->num_functions();
-  std::vector<scalar_t> DN(num_funcs*spa_dim);
-  std::vector<scalar_t> nodal_coords(num_funcs*spa_dim);
-  std::vector<scalar_t> nodal_disp(num_funcs*spa_dim);
-  std::vector<scalar_t> jac(spa_dim*spa_dim);
-  std::vector<scalar_t> inv_jac(spa_dim*spa_dim);
-  scalar_t J =0.0;
-  std::vector<scalar_t> natural_coords(spa_dim);
-  scalar_t node_nat_x[] = {0.0, 1.0, 0.0, 0.5, 0.5, 0.0}; // If the elem is TRI6 the last three are not used
-  scalar_t node_nat_y[] = {0.0, 0.0, 1.0, 0.0, 0.5, 0.5};
-
-  // element loop
-  DICe::mesh::element_set::iterator elem_it = mesh_->get_element_set()->begin();
-  DICe::mesh::element_set::iterator elem_end = mesh_->get_element_set()->end();
-  for(;elem_it!=elem_end;++elem_it)
-  {
-    //std::cout << "ELEM: " << elem_it->get()->global_id() << std::endl;
-    const DICe::mesh::connectivity_vector & connectivity = *elem_it->get()->connectivity();
-    // compute the shape functions and derivatives for this element:
+  // the shape function derivatives at the element nodes only depend on the reference configuration so they are cached
+  TEUCHOS_TEST_FOR_EXCEPTION(quadrature_cache_==Teuchos::null,std::runtime_error,
+    "Error, the quadrature cache has not been initialized (pre_execution_tasks() must be called first)");
+  const Quadrature_Cache & quad = *quadrature_cache_;
+  const int_t num_funcs = quad.num_funcs(); // TRI6 gives linear strains, TRI3 constant strains
+  const DICe::mesh::Flat_Mesh_Data & flat = mesh_->get_flat_data();
+  const int_t num_elem = flat.num_elem();
+  TEUCHOS_TEST_FOR_EXCEPTION(quad.num_elem()!=num_elem,std::runtime_error,"Error, the quadrature cache does not match the mesh");
+
+  // the displacement gradients at the nodes of each element are computed concurrently into storage owned by the
+  // element (du/dx, du/dy, dv/dx, dv/dy for each node) and summed in element order below so the result
+  // doesn't depend on the number of threads
+  std::vector<scalar_t> all_elem_grads(num_elem*num_funcs*4);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(num_threads_) if(num_threads_>1)
+#endif
+  for(int_t elem=0;elem<num_elem;++elem){
+    const int_t * elem_nodes = flat.elem_nodes(elem);
     for(int_t nd=0;nd<num_funcs;++nd){
-      for(int_t dim=0;dim<spa_dim;++dim){
-        nodal_coords[nd*spa_dim+dim] = coords_values[connectivity[nd]->overlap_local_id()*spa_dim+dim];
-        nodal_disp[nd*spa_dim+dim] = disp_values[connectivity[nd]->overlap_local_id()*spa_dim+dim];
+      const scalar_t * grad_N = quad.node_grad_N(elem,nd);
+      scalar_t dudx = 0.0, dudy = 0.0, dvdx = 0.0, dvdy = 0.0;
+      for(int_t i=0;i<num_funcs;++i){
+        const scalar_t u = disp_values[elem_nodes[i]*spa_dim + 0];
+        const scalar_t v = disp_values[elem_nodes[i]*spa_dim + 1];
+        dudx += u*grad_N[i*spa_dim + 0];
+        dudy += u*grad_N[i*spa_dim + 1];
+        dvdx += v*grad_N[i*spa_dim + 0];
+        dvdy += v*grad_N[i*spa_dim + 1];
       }
+      scalar_t * grads = &all_elem_grads[(elem*num_funcs+nd)*4];
+      grads[0] = dudx;
+      grads[1] = dudy;
+      grads[2] = dvdx;
+      grads[3] = dvdy;
     }
-    // iterate the nodes for this element and compute the strain at each node
-    // sum the contributions
+  }
+  // sum the contributions of each element to its nodes
+  for(int_t elem=0;elem<num_elem;++elem){
+    const int_t * elem_nodes = flat.elem_nodes(elem);
     for(int_t nd=0;nd<num_funcs;++nd){
-      // isoparametric coords
-      natural_coords[0] = node_nat_x[nd];
-      natural_coords[1] = node_nat_y[nd];
-
-      // evaluate the shape functions and derivatives:
-      shape_func_evaluator->evaluate_shape_function_derivatives(&natural_coords[0],&DN[0]);
-
-      // compute the jacobian for this element:
-      DICe::global::calc_jacobian(&nodal_coords[0],&DN[0],&jac[0],&inv_jac[0],J,num_funcs,spa_dim);
-
-      for(int_t i=0;i<num_funcs;++i){
-        int_t local_index = connectivity[nd]->overlap_local_id();
-        overlap_dudx_ptr->local_value(local_index) += nodal_disp[i*spa_dim + 0]*(inv_jac[0]*DN[i*spa_dim + 0]+inv_jac[2]*DN[i*spa_dim + 1]);
-        overlap_dudy_ptr->local_value(local_index) += nodal_disp[i*spa_dim + 0]*(inv_jac[1]*DN[i*spa_dim + 0]+inv_jac[3]*DN[i*spa_dim + 1]);
-        overlap_dvdx_ptr->local_value(local_index) += nodal_disp[i*spa_dim + 1]*(inv_jac[0]*DN[i*spa_dim + 0]+inv_jac[2]*DN[i*spa_dim + 1]);
-        overlap_dvdy_ptr->local_value(local_index) += nodal_disp[i*spa_dim + 1]*(inv_jac[1]*DN[i*spa_dim + 0]+inv_jac[3]*DN[i*spa_dim + 1]);
-      }
-      overlap_strain_contribs_ptr->local_value(connectivity[nd]->overlap_local_id()) += 1.0;
+      const int_t local_index = elem_nodes[nd];
+      const scalar_t * grads = &all_elem_grads[(elem*num_funcs+nd)*4];
+      overlap_dudx_ptr->local_value(local_index) += grads[0];
+      overlap_dudy_ptr->local_value(local_index) += grads[1];
+      overlap_dvdx_ptr->local_value(local_index) += grads[2];
+      overlap_dvdy_ptr->local_value(local_index) += grads[3];
+      overlap_strain_contribs_ptr->local_value(local_index) += 1.0;
     }
-  }  // elem
+  }
 
   // export the fields
   mesh_->field_overlap_export(overlap_dudx_ptr,DICe::field_enums::DU_DX_FS, ADD);
@@ -1259,6 +1481,7 @@ Global_Algorithm::initialize_ref_image(){
   // take the gradienst from the normalized image and make grad images for interpolation
   const int_t w = ref_img_->width();
   const int_t h = ref_img_->height();
+  ref_img_->compute_gradient_tiles();
   Teuchos::ArrayRCP<intensity_t> grad_ref_x(ref_img_->width()*ref_img_->height(),0.0);
   Teuchos::ArrayRCP<intensity_t> grad_ref_y(ref_img_->width()*ref_img_->height(),0.0);
   for(int_t y=0;y<h;++y){
@@ -1267,12 +1490,70 @@ Global_Algorithm::initialize_ref_image(){
       grad_ref_y[y*w+x] = ref_img_->grad_y(x,y);
     }
   }
-  grad_x_img_ = Teuchos::rcp(new Image(w,h,grad_ref_x));
+  // the gradient images cover the same portion of the image as the reference image
+  grad_x_img_ = Teuchos::rcp(new Image(w,h,grad_ref_x,Teuchos::null,ref_img_->offset_x(),ref_img_->offset_y()));
   //grad_x_img_->write("grad_x_img.tif");
-  grad_y_img_ = Teuchos::rcp(new Image(w,h,grad_ref_y));
+  grad_y_img_ = Teuchos::rcp(new Image(w,h,grad_ref_y,Teuchos::null,ref_img_->offset_x(),ref_img_->offset_y()));
   //grad_y_img_->write("grad_y_img.tif");
 }
 
+void
+Global_Algorithm::image_extents(std::vector<int_t> & ref_extents,
+  std::vector<int_t> & def_extents){
+  ref_extents.resize(4);
+  def_extents.resize(4);
+  const DICe::mesh::Flat_Mesh_Data & flat = mesh_->get_flat_data();
+  scalar_t min_x = std::numeric_limits<int_t>::max();
+  scalar_t max_x = 0.0;
+  scalar_t min_y = std::numeric_limits<int_t>::max();
+  scalar_t max_y = 0.0;
+  // the flat coordinates include the overlap nodes of the local elements
+  for(size_t i=0;i<flat.node_x.size();++i){
+    min_x = std::min(min_x,flat.node_x[i]);
+    max_x = std::max(max_x,flat.node_x[i]);
+    min_y = std::min(min_y,flat.node_y[i]);
+    max_y = std::max(max_y,flat.node_y[i]);
+  }
+  if(flat.node_x.empty()){
+    min_x = 0.0; min_y = 0.0;
+  }
+  // range of the current displacements of the owned nodes (the overlap nodes move with their neighbors)
+  const int_t spa_dim = mesh_->spatial_dimension();
+  const int_t num_nodes = mesh_->get_scalar_node_dist_map()->get_num_local_elements();
+  Teuchos::RCP<MultiField> disp = mesh_->get_field(field_enums::DISPLACEMENT_FS);
+  scalar_t min_u_x = 0.0, max_u_x = 0.0, min_u_y = 0.0, max_u_y = 0.0;
+  for(int_t i=0;i<num_nodes;++i){
+    min_u_x = std::min(min_u_x,disp->local_value(i*spa_dim+0));
+    max_u_x = std::max(max_u_x,disp->local_value(i*spa_dim+0));
+    min_u_y = std::min(min_u_y,disp->local_value(i*spa_dim+1));
+    max_u_y = std::max(max_u_y,disp->local_value(i*spa_dim+1));
+  }
+  // the halo covers the bicubic interpolation stencil, the motion between frames and the phase correlation seed windows
+  const int_t halo = std::max((int_t)100,warm_start_window_size_);
+  const scalar_t ref_bounds[] = {min_x - halo, max_x + halo, min_y - halo, max_y + halo};
+  const scalar_t def_bounds[] = {min_x + min_u_x - halo, max_x + max_u_x + halo, min_y + min_u_y - halo, max_y + max_u_y + halo};
+  for(int_t i=0;i<4;++i){
+    ref_extents[i] = ref_bounds[i] < 0.0 ? 0 : (int_t)std::round(ref_bounds[i]);
+    def_extents[i] = def_bounds[i] < 0.0 ? 0 : (int_t)std::round(def_bounds[i]);
+  }
+  DEBUG_MSG("Global_Algorithm::image_extents(): reference x " << ref_extents[0] << " to " << ref_extents[1] <<
+    " y " << ref_extents[2] << " to " << ref_extents[3]);
+  DEBUG_MSG("Global_Algorithm::image_extents(): deformed x " << def_extents[0] << " to " << def_extents[1] <<
+    " y " << def_extents[2] << " to " << def_extents[3]);
+}
+
+Global_Algorithm::~Global_Algorithm(){
+  // write any exodus output steps that are still buffered
+  if(mesh_!=Teuchos::null&&mesh_->get_output_exoid()>=0){
+    try{
+      DICe::mesh::flush_exodus_output(mesh_);
+    }
+    catch(std::exception & e){
+      std::cout << e.what() << std::endl;
+    }
+  }
+}
+
 void
 Global_Algorithm::set_def_image(){
   //schema_->def_img()->write("pre_def_img.tif");
@@ -1287,6 +1568,12 @@ Global_Algorithm::post_execution_tasks(const scalar_t & time_stamp){
   TEUCHOS_TEST_FOR_EXCEPTION(!is_initialized_,std::runtime_error,"Error, must be initialized");
 
   const int_t time_step = time_stamp;
+  // the strains are only needed for the output so they aren't computed for the frames that are skipped
+  if(time_step%output_frequency_!=0){
+    DEBUG_MSG("Skipping the output for step : " << time_step << " (output frequency " << output_frequency_ << ")");
+    return;
+  }
+  compute_strains();
   DEBUG_MSG("Writing the output file with step : " << time_step << " time stamp: " << time_stamp);
   DICe::mesh::exodus_output_dump(mesh_,time_step,time_stamp);
 }
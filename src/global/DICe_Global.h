@@ -56,6 +56,12 @@
   #include <BelosTpetraAdapter.hpp>
 #else
   #include <BelosEpetraAdapter.hpp>
+  class Ifpack_Preconditioner;
+  #ifdef DICE_ENABLE_ML
+    namespace ML_Epetra{
+      class MultiLevelPreconditioner;
+    }
+  #endif
 #endif
 
 
@@ -66,6 +72,15 @@ class Schema;
 
 namespace global{
 
+// forward declaration of the matrix free tangent operator
+class Matrix_Free_Operator;
+// forward declaration of the cached integration point data
+class Quadrature_Cache;
+#if DICE_KOKKOS
+// forward declaration of the image terms evaluated on the device
+class Device_Image_Terms;
+#endif
+
 /// \class Global_Algorithm
 /// \brief holds all the methods and data for global DIC
 class
@@ -84,8 +99,8 @@ public:
   /// \param params pointer to a set of parameters that define which terms are included, etc.
   Global_Algorithm(const Teuchos::RCP<Teuchos::ParameterList> & params);
 
-  /// Destructor
-  virtual ~Global_Algorithm(){};
+  /// Destructor (writes any buffered exodus output)
+  virtual ~Global_Algorithm();
 
   /// default constructor tasks
   /// \param params the global params passed through
@@ -97,13 +112,32 @@ public:
   /// execute the global alg
   Status_Flag execute();
 
-  /// post execution tasks
+  /// post execution tasks (computes the strains and writes the output if the step is an output step, see global_output_frequency)
+  /// \param time_stamp the time stamp of the frame
   void post_execution_tasks(const scalar_t & time_stamp);
 
   /// populate the tangent matrix
   /// \param use_fixed_point true if fixed point iteration is being employed
   Teuchos::RCP<DICe::MultiField_Matrix> compute_tangent(const bool use_fixed_point);
 
+  /// build the preconditioner for the linear solve or reuse the previous one
+  /// according to the reuse policy in the global parameters
+  /// \param tangent the assembled tangent (null if the matrix free operator is used)
+  Teuchos::RCP<Epetra_Operator> update_preconditioner(Teuchos::RCP<DICe::MultiField_Matrix> tangent);
+
+  /// set the starting displacements of the nonlinear iterations according to the warm start parameters
+  /// \param disp the displacements
+  /// \param disp_nm1 the displacements of the previous iteration
+  void warm_start(Teuchos::RCP<MultiField> disp,
+    Teuchos::RCP<MultiField> disp_nm1);
+
+  /// seed the displacements by phase correlating a window centered on each node (a coarse local DIC estimate),
+  /// the nodes without a valid correlation get the average of the others
+  /// \param disp the displacements
+  /// \param disp_nm1 the displacements of the previous iteration
+  void seed_from_local_correlation(Teuchos::RCP<MultiField> disp,
+    Teuchos::RCP<MultiField> disp_nm1);
+
   /// populate the residual vector
   /// \param use_fixed_point use the fixed point iteration strategy
   scalar_t compute_residual(const bool use_fixed_point);
@@ -113,7 +147,7 @@ public:
     return mesh_->get_vector_node_dist_map()->get_max_global_index();
   }
 
-  /// compute the strain values
+  /// compute the strain values at the nodes from the cached shape function derivatives (elements are processed concurrently)
   void compute_strains();
 
   /// evaluate the error norms for mms problems
@@ -167,6 +201,15 @@ public:
   /// set the reference image and perform the necessary pre-filtering + compute gradients
   void set_def_image();
 
+  /// \brief compute the portions of the images used by the elements on this processor
+  ///
+  /// The extents cover the owned and overlap nodes of the local elements plus a halo for the interpolation
+  /// and the motion to the next frame, the deformed extents are shifted by the current displacements
+  /// \param ref_extents [out] x_start, x_end, y_start, y_end of the reference image region
+  /// \param def_extents [out] x_start, x_end, y_start, y_end of the deformed image region
+  void image_extents(std::vector<int_t> & ref_extents,
+    std::vector<int_t> & def_extents);
+
   /// return a pointer to the reference image
   Teuchos::RCP<Image> ref_img()const{
     return ref_img_;
@@ -202,6 +245,51 @@ public:
     return mms_problem_;
   }
 
+  /// return a pointer to the boundary condition manager
+  Teuchos::RCP<BC_Manager> bc_manager()const{
+    return bc_manager_;
+  }
+
+  /// return the element type
+  DICe::mesh::Base_Element_Type element_type()const{
+    return element_type_;
+  }
+
+  /// return the number of image integration points in each dimension
+  int_t num_image_integration_points()const{
+    return num_image_integration_points_;
+  }
+
+  /// return the number of threads used to compute the element terms
+  int_t num_threads()const{
+    return num_threads_;
+  }
+
+  /// return the wall time in seconds spent assembling the tangent, residual and boundary conditions in the last execute()
+  scalar_t assembly_time()const{
+    return assembly_time_;
+  }
+
+  /// return the wall time in seconds spent building the preconditioner in the last execute()
+  scalar_t preconditioner_time()const{
+    return preconditioner_time_;
+  }
+
+  /// return the wall time in seconds spent in the Belos solves of the last execute()
+  scalar_t linear_solve_time()const{
+    return linear_solve_time_;
+  }
+
+  /// return the number of Belos iterations summed over all the linear solves of the last execute()
+  int_t total_linear_iterations()const{
+    return total_linear_iterations_;
+  }
+
+  /// return the number of nonlinear iterations of the last execute()
+  int_t num_nonlinear_iterations()const{
+    return num_nonlinear_iterations_;
+  }
+
 protected:
   /// protect the default constructor
   Global_Algorithm(const Global_Algorithm&);
@@ -227,6 +315,16 @@ protected:
   Teuchos::RCP< Belos::SolverManager<mv_scalar_type,vec_type,operator_type> > belos_solver_;
   /// boundary condition manager
   Teuchos::RCP<BC_Manager> bc_manager_;
+  /// distributed tangent matrix (the graph is built by the first assembly and reused after that)
+  Teuchos::RCP<DICe::MultiField_Matrix> tangent_;
+  /// overlap tangent matrix that the element contributions are assembled into
+  Teuchos::RCP<DICe::MultiField_Matrix> tangent_overlap_;
+  /// exporter from the overlap tangent to the distributed tangent
+  Teuchos::RCP<MultiField_Exporter> tangent_exporter_;
+  /// global column ids of the element contributions for each overlap row (storage reused between assemblies)
+  std::vector<Teuchos::Array<int_t> > tangent_col_ids_;
+  /// values of the element contributions for each overlap row (storage reused between assemblies)
+  std::vector<Teuchos::Array<mv_scalar_type> > tangent_values_;
   /// true if the solver, etc been initialized
   bool is_initialized_;
   /// set of active terms in the formulation
@@ -254,6 +352,58 @@ protected:
   bool use_fixed_point_iterations_;
   /// stabilization parameter set by user
   scalar_t stabilization_tau_;
+  /// number of threads used to compute the element contributions to the residual and tangent
+  int_t num_threads_;
+  /// apply the tangent element by element rather than assembling it
+  bool use_matrix_free_;
+  /// preconditioner used for the linear solve
+  Global_Preconditioner global_preconditioner_;
+  /// matrix free tangent operator (only allocated if use_matrix_free_ is true)
+  Teuchos::RCP<Matrix_Free_Operator> matrix_free_operator_;
+  /// integration point data of the reference configuration (built in pre_execution_tasks())
+  Teuchos::RCP<Quadrature_Cache> quadrature_cache_;
+#if DICE_KOKKOS
+  /// image terms of the residual and tangent evaluated on the device (built in pre_execution_tasks())
+  Teuchos::RCP<Device_Image_Terms> device_image_terms_;
+#endif
+  /// keep the preconditioner (and the ILU symbolic factorization) across nonlinear iterations and frames
+  bool reuse_preconditioner_;
+  /// number of additional solves the numeric preconditioner values can be reused for
+  int_t preconditioner_max_reuse_;
+  /// recompute the numeric preconditioner if the last linear solve took more iterations than this (off if <= 0)
+  int_t preconditioner_rebuild_iterations_;
+  /// the output is written and the strains computed every output_frequency_ frames
+  int_t output_frequency_;
+  /// start each frame from a linear extrapolation of the displacements of the last two frames
+  bool warm_start_extrapolation_;
+  /// if > 0 the first frame is seeded by phase correlating a window of this size around each node
+  int_t warm_start_window_size_;
+  /// the converged displacements of the frame before the last one (used for the extrapolation)
+  std::vector<scalar_t> prev_frame_disp_;
+  /// number of solves the current numeric preconditioner has been reused for
+  int_t preconditioner_num_reuses_;
+  /// number of iterations of the last linear solve
+  int_t num_linear_iterations_;
+  /// wall time of the assembly in the last execute()
+  scalar_t assembly_time_;
+  /// wall time of the preconditioner updates in the last execute()
+  scalar_t preconditioner_time_;
+  /// wall time of the linear solves in the last execute()
+  scalar_t linear_solve_time_;
+  /// Belos iterations summed over the linear solves of the last execute()
+  int_t total_linear_iterations_;
+  /// number of nonlinear iterations of the last execute()
+  int_t num_nonlinear_iterations_;
+  /// current preconditioner
+  Teuchos::RCP<Epetra_Operator> preconditioner_;
+  /// current ILU preconditioner (null if the Jacobi preconditioner is used)
+  Teuchos::RCP<Ifpack_Preconditioner> ifpack_preconditioner_;
+#ifdef DICE_ENABLE_ML
+  /// current AMG preconditioner (null unless the AMG preconditioner is used)
+  Teuchos::RCP<ML_Epetra::MultiLevelPreconditioner> ml_preconditioner_;
+#endif
+  /// matrix the ILU, AMG or block preconditioner was initialized with
+  Epetra_CrsMatrix * preconditioner_matrix_;
 };
 
 }// end global namespace
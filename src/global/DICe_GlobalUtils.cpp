@@ -180,11 +180,29 @@ void image_time_force(Global_Algorithm* alg,
     "Error, the pointer to the algorithm must be valid");
 
   // compute the image force terms
-  const intensity_t phi_0 = alg->ref_img()->interpolate_bicubic(x-bx,y-by);
-  const intensity_t phi = alg->def_img()->interpolate_bicubic(x,y);
+  const scalar_t phi_0 = alg->ref_img()->interpolate_bicubic_global(x-bx,y-by);
+  const scalar_t grad_phi_x = alg->grad_x()->interpolate_bicubic_global(x-bx,y-by);
+  const scalar_t grad_phi_y = alg->grad_y()->interpolate_bicubic_global(x-bx,y-by);
+  image_time_force(alg,spa_dim,num_funcs,x,y,phi_0,grad_phi_x,grad_phi_y,J,gp_weight,N,elem_force);
+}
+
+DICE_LIB_DLL_EXPORT
+void image_time_force(Global_Algorithm* alg,
+  const int_t spa_dim,
+  const int_t num_funcs,
+  const scalar_t & x,
+  const scalar_t & y,
+  const scalar_t & phi_0,
+  const scalar_t & grad_phi_x,
+  const scalar_t & grad_phi_y,
+  const scalar_t & J,
+  const scalar_t & gp_weight,
+  const scalar_t * N,
+  scalar_t * elem_force){
+  TEUCHOS_TEST_FOR_EXCEPTION(alg==NULL,std::runtime_error,
+    "Error, the pointer to the algorithm must be valid");
+  const intensity_t phi = alg->def_img()->interpolate_bicubic_global(x,y);
   const scalar_t d_phi_dt = phi - phi_0;
-  const scalar_t grad_phi_x = alg->grad_x()->interpolate_bicubic(x-bx,y-by);
-  const scalar_t grad_phi_y = alg->grad_y()->interpolate_bicubic(x-bx,y-by);
   for(int_t i=0;i<num_funcs;++i){
     elem_force[i*spa_dim+0] -= d_phi_dt*grad_phi_x*N[i]*gp_weight*J;
     elem_force[i*spa_dim+1] -= d_phi_dt*grad_phi_y*N[i]*gp_weight*J;
@@ -206,9 +224,20 @@ void image_grad_tensor(Global_Algorithm * alg,
   TEUCHOS_TEST_FOR_EXCEPTION(alg==NULL,std::runtime_error,
     "Error, the pointer to the algorithm must be valid");
   // compute the image stiffness terms
-  const scalar_t grad_phi_x = alg->grad_x()->interpolate_bicubic(x-bx,y-by);
-  const scalar_t grad_phi_y = alg->grad_y()->interpolate_bicubic(x-bx,y-by);
+  const scalar_t grad_phi_x = alg->grad_x()->interpolate_bicubic_global(x-bx,y-by);
+  const scalar_t grad_phi_y = alg->grad_y()->interpolate_bicubic_global(x-bx,y-by);
+  image_grad_tensor(spa_dim,num_funcs,grad_phi_x,grad_phi_y,J,gp_weight,N,elem_stiffness);
+}
 
+DICE_LIB_DLL_EXPORT
+void image_grad_tensor(const int_t spa_dim,
+  const int_t num_funcs,
+  const scalar_t & grad_phi_x,
+  const scalar_t & grad_phi_y,
+  const scalar_t & J,
+  const scalar_t & gp_weight,
+  const scalar_t * N,
+  scalar_t * elem_stiffness){
   // image stiffness terms
   for(int_t i=0;i<num_funcs;++i){
     const int_t row1 = (i*spa_dim) + 0;
@@ -241,8 +270,8 @@ void image_grad_force(Global_Algorithm* alg,
   TEUCHOS_TEST_FOR_EXCEPTION(alg==NULL,std::runtime_error,
     "Error, the pointer to the algorithm must be valid");
 
-  const scalar_t grad_phi_x = alg->grad_x()->interpolate_bicubic(x-bx,y-by);
-  const scalar_t grad_phi_y = alg->grad_y()->interpolate_bicubic(x-bx,y-by);
+  const scalar_t grad_phi_x = alg->grad_x()->interpolate_bicubic_global(x-bx,y-by);
+  const scalar_t grad_phi_y = alg->grad_y()->interpolate_bicubic_global(x-bx,y-by);
 
   // image stiffness terms
   for(int_t i=0;i<num_funcs;++i){
@@ -595,7 +624,7 @@ scalar_t compute_tau_tri3(const Global_Formulation & formulation,
   const scalar_t & alpha2,
   const scalar_t * natural_coords,
   const scalar_t & J,
-  scalar_t * inv_jac){
+  const scalar_t * inv_jac){
 
   assert(alpha2!=0.0);
   const scalar_t tau_1 = 0.225*0.5*J;
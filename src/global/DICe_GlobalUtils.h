@@ -896,6 +896,25 @@ void image_grad_tensor(Global_Algorithm * alg,
   const scalar_t * N,
   scalar_t * elem_stiffness);
 
+/// adds the image gradients term to the stiffness matrx using image gradients evaluated by the caller
+/// \param spa_dim spatial dimension
+/// \param num_funcs the number of shape functions
+/// \param grad_phi_x x gradient of the reference image at the point
+/// \param grad_phi_y y gradient of the reference image at the point
+/// \param J determinant of the jacobian
+/// \param gp_weight gauss weight
+/// \param N shape functions
+/// \param elem_stiffness output the element stiffness contributions
+DICE_LIB_DLL_EXPORT
+void image_grad_tensor(const int_t spa_dim,
+  const int_t num_funcs,
+  const scalar_t & grad_phi_x,
+  const scalar_t & grad_phi_y,
+  const scalar_t & J,
+  const scalar_t & gp_weight,
+  const scalar_t * N,
+  scalar_t * elem_stiffness);
+
 /// adds the image gradients term to the force vector (from manufactured solutions problem)
 /// \param mms_problem pointer to the method of manufactured solutions problem
 /// \param spa_dim spatial dimension
@@ -966,6 +985,33 @@ void image_time_force(Global_Algorithm* alg,
   const scalar_t * N,
   scalar_t * elem_force);
 
+/// adds the dphi_dt force vector to the residual using reference image values evaluated by the caller
+/// \param alg pointer to the calling Global_Algorithm
+/// \param spa_dim spatial dimension
+/// \param num_funcs the number of shape functions
+/// \param x x-coordinate of the point
+/// \param y y-coordinate of the point
+/// \param phi_0 reference image intensity at the point
+/// \param grad_phi_x x gradient of the reference image at the point
+/// \param grad_phi_y y gradient of the reference image at the point
+/// \param J determinant of the jacobian
+/// \param gp_weight gauss weight
+/// \param N shape functions
+/// \param elem_force output the element force contributions
+DICE_LIB_DLL_EXPORT
+void image_time_force(Global_Algorithm* alg,
+  const int_t spa_dim,
+  const int_t num_funcs,
+  const scalar_t & x,
+  const scalar_t & y,
+  const scalar_t & phi_0,
+  const scalar_t & grad_phi_x,
+  const scalar_t & grad_phi_y,
+  const scalar_t & J,
+  const scalar_t & gp_weight,
+  const scalar_t * N,
+  scalar_t * elem_force);
+
 /// adds the grad_phi tensor grad_phi force vector to the residual
 /// \param alg pointer to the calling Global_Algorithm
 /// \param spa_dim spatial dimension
@@ -1045,7 +1091,7 @@ scalar_t compute_tau_tri3(const Global_Formulation & formulation,
   const scalar_t & alpha2,
   const scalar_t * natural_coords,
   const scalar_t & J,
-  scalar_t * inv_jac);
+  const scalar_t * inv_jac);
 
 DICE_LIB_DLL_EXPORT
 void calc_jacobian(const scalar_t * xcap,
@@ -0,0 +1,452 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_MatrixFreeOperator.h>
+#include <DICe_Global.h>
+#include <DICe_GlobalUtils.h>
+
+#include <exception>
+
+namespace DICe {
+
+namespace global{
+
+Matrix_Free_Operator::Matrix_Free_Operator(Global_Algorithm * alg):
+  alg_(alg),
+  spa_dim_(0),
+  num_funcs_(0),
+  num_elem_(0),
+  num_gps_(0),
+  num_image_gps_(0),
+  num_threads_(1),
+  alpha2_(0.0),
+  has_image_term_(false),
+  has_mms_image_term_(false),
+  has_tikhonov_term_(false),
+  has_div_strain_term_(false),
+  is_updated_(false)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(alg_==NULL,std::runtime_error,
+    "Error, the pointer to the algorithm must be valid");
+  TEUCHOS_TEST_FOR_EXCEPTION(alg_->is_mixed_formulation(),std::runtime_error,
+    "Error, the matrix free operator is not available for mixed formulations");
+  Teuchos::RCP<DICe::mesh::Mesh> mesh = alg_->mesh();
+  spa_dim_ = mesh->spatial_dimension();
+  TEUCHOS_TEST_FOR_EXCEPTION(spa_dim_!=2,std::runtime_error,
+    "Error, the matrix free operator is only implemented for two dimensions");
+  num_threads_ = alg_->num_threads();
+  dist_map_ = mesh->get_vector_node_dist_map()->get();
+  overlap_map_ = mesh->get_vector_node_overlap_map()->get();
+  importer_ = Teuchos::rcp(new Epetra_Import(*overlap_map_,*dist_map_));
+  exporter_ = Teuchos::rcp(new Epetra_Export(*overlap_map_,*dist_map_));
+
+  DICe::mesh::Shape_Function_Evaluator_Factory shape_func_eval_factory;
+  Teuchos::RCP<DICe::mesh::Shape_Function_Evaluator> shape_func_evaluator = alg_->element_type()==DICe::mesh::TRI6 ?
+      shape_func_eval_factory.create(DICe::mesh::TRI6) :
+      shape_func_eval_factory.create(DICe::mesh::TRI3);
+  num_funcs_ = shape_func_evaluator->num_functions();
+  const int_t elem_size = num_funcs_*spa_dim_;
+
+  // use the same integration points as Global_Algorithm::compute_tangent()
+  const int_t integration_order = 6;
+  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > gp_locs;
+  Teuchos::ArrayRCP<scalar_t> gp_weights;
+  shape_func_evaluator->get_natural_integration_points(integration_order,gp_locs,gp_weights,num_gps_);
+  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > image_gp_locs;
+  Teuchos::ArrayRCP<scalar_t> image_gp_weights;
+  tri2d_nonexact_integration_points(alg_->num_image_integration_points(),image_gp_locs,image_gp_weights,num_image_gps_);
+
+  // the shape functions only depend on the natural coordinates so they are shared by all elements
+  gp_weights_.resize(num_gps_);
+  N_.resize(num_gps_*num_funcs_);
+  DN_.resize(num_gps_*elem_size);
+  const int_t natural_coord_dim = gp_locs[0].size();
+  std::vector<scalar_t> natural_coords(num_gps_*natural_coord_dim);
+  for(int_t gp=0;gp<num_gps_;++gp){
+    gp_weights_[gp] = gp_weights[gp];
+    for(int_t dim=0;dim<natural_coord_dim;++dim)
+      natural_coords[gp*natural_coord_dim+dim] = gp_locs[gp][dim];
+  }
+  shape_func_evaluator->evaluate_shape_functions_at_points(num_gps_,natural_coord_dim,&natural_coords[0],&N_[0],&DN_[0]);
+  image_gp_weights_.resize(num_image_gps_);
+  image_N_.resize(num_image_gps_*num_funcs_);
+  image_DN_.resize(num_image_gps_*elem_size);
+  const int_t image_natural_coord_dim = image_gp_locs[0].size();
+  std::vector<scalar_t> image_natural_coords(num_image_gps_*image_natural_coord_dim);
+  for(int_t gp=0;gp<num_image_gps_;++gp){
+    image_gp_weights_[gp] = image_gp_weights[gp];
+    for(int_t dim=0;dim<image_natural_coord_dim;++dim)
+      image_natural_coords[gp*image_natural_coord_dim+dim] = image_gp_locs[gp][dim];
+  }
+  shape_func_evaluator->evaluate_shape_functions_at_points(num_image_gps_,image_natural_coord_dim,&image_natural_coords[0],&image_N_[0],&image_DN_[0]);
+
+  // the element geometry doesn't change so the jacobians are evaluated once here
+  const DICe::mesh::Flat_Mesh_Data & flat = mesh->get_flat_data();
+  num_elem_ = flat.num_elem();
+  elem_dofs_.resize(num_elem_*elem_size);
+  gp_weight_J_.resize(num_elem_*num_gps_);
+  gp_inv_jac_.resize(num_elem_*num_gps_*spa_dim_*spa_dim_);
+  image_gp_weight_J_.resize(num_elem_*num_image_gps_);
+  std::vector<scalar_t> nodal_coords(elem_size);
+  std::vector<scalar_t> jac(spa_dim_*spa_dim_);
+  std::vector<scalar_t> inv_jac(spa_dim_*spa_dim_);
+  scalar_t J = 0.0;
+  for(int_t elem=0;elem<num_elem_;++elem){
+    const int_t * elem_nodes = flat.elem_nodes(elem);
+    for(int_t nd=0;nd<num_funcs_;++nd){
+      for(int_t dim=0;dim<spa_dim_;++dim)
+        elem_dofs_[elem*elem_size + nd*spa_dim_ + dim] = elem_nodes[nd]*spa_dim_ + dim;
+      nodal_coords[nd*spa_dim_+0] = flat.node_x[elem_nodes[nd]];
+      nodal_coords[nd*spa_dim_+1] = flat.node_y[elem_nodes[nd]];
+    }
+    for(int_t gp=0;gp<num_gps_;++gp){
+      DICe::global::calc_jacobian(&nodal_coords[0],&DN_[gp*elem_size],&jac[0],&gp_inv_jac_[(elem*num_gps_+gp)*spa_dim_*spa_dim_],J,num_funcs_,spa_dim_);
+      gp_weight_J_[elem*num_gps_+gp] = gp_weights_[gp]*J;
+    }
+    for(int_t gp=0;gp<num_image_gps_;++gp){
+      DICe::global::calc_jacobian(&nodal_coords[0],&image_DN_[gp*elem_size],&jac[0],&inv_jac[0],J,num_funcs_,spa_dim_);
+      image_gp_weight_J_[elem*num_image_gps_+gp] = image_gp_weights_[gp]*J;
+    }
+  }
+  elem_values_.resize(num_elem_*elem_size);
+  DEBUG_MSG("Matrix_Free_Operator::Matrix_Free_Operator(): num elem " << num_elem_ << " num gps " << num_gps_ <<
+    " num image gps " << num_image_gps_);
+}
+
+void
+Matrix_Free_Operator::update(const bool use_fixed_point){
+  DEBUG_MSG("Matrix_Free_Operator::update(): evaluating the quadrature data");
+  TEUCHOS_TEST_FOR_EXCEPTION(alg_->has_term(DIV_VELOCITY)||alg_->has_term(STAB_LAGRANGE),std::runtime_error,
+    "Error, the matrix free operator does not support the lagrange multiplier terms");
+  has_image_term_ = alg_->has_term(IMAGE_GRAD_TENSOR);
+  has_mms_image_term_ = alg_->has_term(MMS_IMAGE_GRAD_TENSOR);
+  has_tikhonov_term_ = alg_->has_term(TIKHONOV_REGULARIZATION);
+  has_div_strain_term_ = alg_->has_term(DIV_SYMMETRIC_STRAIN_REGULARIZATION);
+  alpha2_ = alg_->alpha2();
+  Teuchos::RCP<DICe::mesh::Mesh> mesh = alg_->mesh();
+  const int_t elem_size = num_funcs_*spa_dim_;
+
+  // rows of kinematic bc nodes get no element contributions and a unit diagonal (see compute_tangent())
+  Teuchos::RCP<MultiField_Map> dist_map = mesh->get_vector_node_dist_map();
+  Teuchos::RCP<MultiField_Map> overlap_map = mesh->get_vector_node_overlap_map();
+  const BC_Manager & bc_manager = *alg_->bc_manager();
+  const int_t num_overlap_dofs = overlap_map->get_num_local_elements();
+  skip_row_.assign(num_overlap_dofs,false);
+  identity_dofs_.clear();
+  for(int_t i=0;i<num_overlap_dofs;++i){
+    const int_t row = overlap_map->get_global_element(i);
+    if(dist_map->is_node_global_elem(row))
+      skip_row_[i] = bc_manager.is_row_bc(dist_map->get_local_element(row));
+    if(bc_manager.is_col_bc(i))
+      identity_dofs_.push_back(i);
+  }
+
+  // evaluate the image gradients at the integration points
+  image_gp_grad_x_.assign(has_image_term_ ? num_elem_*num_image_gps_ : 0,0.0);
+  image_gp_grad_y_.assign(has_image_term_ ? num_elem_*num_image_gps_ : 0,0.0);
+  gp_grad_x_.assign(has_mms_image_term_ ? num_elem_*num_gps_ : 0,0.0);
+  gp_grad_y_.assign(has_mms_image_term_ ? num_elem_*num_gps_ : 0,0.0);
+  if(has_image_term_||has_mms_image_term_){
+    // the coordinates are read from the flat arrays so the x and y values are each contiguous
+    const DICe::mesh::Flat_Mesh_Data & flat = mesh->get_flat_data();
+    const scalar_t * node_x = &flat.node_x[0];
+    const scalar_t * node_y = &flat.node_y[0];
+    Teuchos::ArrayRCP<const scalar_t> disp_values = mesh->get_overlap_field(field_enums::DISPLACEMENT_FS)->get_1d_view();
+    // raw pointers are used inside the parallel region so no reference counts are modified
+    Image * grad_x = has_image_term_ ? alg_->grad_x().get() : NULL;
+    Image * grad_y = has_image_term_ ? alg_->grad_y().get() : NULL;
+    MMS_Problem * mms_problem = has_mms_image_term_ ? alg_->mms_problem().get() : NULL;
+    TEUCHOS_TEST_FOR_EXCEPTION(has_image_term_&&(grad_x==NULL||grad_y==NULL),std::runtime_error,
+      "Error, the image gradients must be defined");
+    TEUCHOS_TEST_FOR_EXCEPTION(has_mms_image_term_&&mms_problem==NULL,std::runtime_error,
+      "Error, the pointer to the mms problem must be valid");
+    // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+    std::exception_ptr elem_error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(num_threads_) if(num_threads_>1)
+#endif
+    for(int_t elem=0;elem<num_elem_;++elem){
+      try{
+        const int_t * dofs = &elem_dofs_[elem*elem_size];
+        const int_t * elem_nodes = flat.elem_nodes(elem);
+        if(has_mms_image_term_){
+          for(int_t gp=0;gp<num_gps_;++gp){
+            const scalar_t * N = &N_[gp*num_funcs_];
+            scalar_t x = 0.0, y = 0.0;
+            for(int_t i=0;i<num_funcs_;++i){
+              x += node_x[elem_nodes[i]]*N[i];
+              y += node_y[elem_nodes[i]]*N[i];
+            }
+            scalar_t d_phi_dt = 0.0;
+            mms_problem->phi_derivatives(x,y,d_phi_dt,gp_grad_x_[elem*num_gps_+gp],gp_grad_y_[elem*num_gps_+gp]);
+          }
+        }
+        if(has_image_term_){
+          for(int_t gp=0;gp<num_image_gps_;++gp){
+            const scalar_t * N = &image_N_[gp*num_funcs_];
+            scalar_t x = 0.0, y = 0.0, bx = 0.0, by = 0.0;
+            for(int_t i=0;i<num_funcs_;++i){
+              x += node_x[elem_nodes[i]]*N[i];
+              y += node_y[elem_nodes[i]]*N[i];
+              if(use_fixed_point){
+                bx += disp_values[dofs[i*spa_dim_+0]]*N[i];
+                by += disp_values[dofs[i*spa_dim_+1]]*N[i];
+              }
+            }
+            image_gp_grad_x_[elem*num_image_gps_+gp] = grad_x->interpolate_bicubic_global(x-bx,y-by);
+            image_gp_grad_y_[elem*num_image_gps_+gp] = grad_y->interpolate_bicubic_global(x-bx,y-by);
+          }
+        }
+      }
+      catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_matrix_free_update_error)
+#endif
+        {
+          if(!elem_error) elem_error = std::current_exception();
+        }
+      }
+    } // elem
+    if(elem_error) std::rethrow_exception(elem_error);
+  }
+  is_updated_ = true;
+}
+
+void
+Matrix_Free_Operator::apply_element(const int_t elem,
+  const scalar_t * elem_x,
+  scalar_t * strain,
+  scalar_t * B,
+  scalar_t * elem_y)const{
+  const int_t elem_size = num_funcs_*spa_dim_;
+  const int_t B_dim = 2*spa_dim_ - 1;
+  for(int_t i=0;i<elem_size;++i)
+    elem_y[i] = 0.0;
+
+  // low order integration points: mms image and regularization terms
+  for(int_t gp=0;gp<num_gps_;++gp){
+    const int_t index = elem*num_gps_ + gp;
+    const scalar_t * N = &N_[gp*num_funcs_];
+    const scalar_t weight_J = gp_weight_J_[index];
+    if(has_mms_image_term_||has_tikhonov_term_){
+      scalar_t ux = 0.0, uy = 0.0;
+      for(int_t i=0;i<num_funcs_;++i){
+        ux += N[i]*elem_x[i*spa_dim_+0];
+        uy += N[i]*elem_x[i*spa_dim_+1];
+      }
+      // grad(phi) tensor_prod grad(phi)
+      if(has_mms_image_term_){
+        const scalar_t grad_phi_x = gp_grad_x_[index];
+        const scalar_t grad_phi_y = gp_grad_y_[index];
+        const scalar_t s = (grad_phi_x*ux + grad_phi_y*uy)*weight_J;
+        for(int_t i=0;i<num_funcs_;++i){
+          elem_y[i*spa_dim_+0] += N[i]*grad_phi_x*s;
+          elem_y[i*spa_dim_+1] += N[i]*grad_phi_y*s;
+        }
+      }
+      // alpha^2 * b
+      if(has_tikhonov_term_){
+        const scalar_t coeff = alpha2_*weight_J;
+        for(int_t i=0;i<num_funcs_;++i){
+          elem_y[i*spa_dim_+0] += coeff*N[i]*ux;
+          elem_y[i*spa_dim_+1] += coeff*N[i]*uy;
+        }
+      }
+    }
+    // alpha^2 * div(0.5*(grad(b) + grad(b)^T))
+    if(has_div_strain_term_){
+      DICe::global::calc_B(&DN_[gp*elem_size],&gp_inv_jac_[index*spa_dim_*spa_dim_],num_funcs_,spa_dim_,B);
+      for(int_t j=0;j<B_dim;++j){
+        strain[j] = 0.0;
+        for(int_t k=0;k<elem_size;++k)
+          strain[j] += B[j*elem_size+k]*elem_x[k];
+      }
+      const scalar_t coeff = alpha2_*weight_J;
+      for(int_t i=0;i<elem_size;++i)
+        for(int_t j=0;j<B_dim;++j)
+          elem_y[i] += coeff*B[j*elem_size+i]*strain[j];
+    }
+  }
+
+  // image integration points: grad(phi) tensor_prod grad(phi)
+  if(has_image_term_){
+    for(int_t gp=0;gp<num_image_gps_;++gp){
+      const int_t index = elem*num_image_gps_ + gp;
+      const scalar_t * N = &image_N_[gp*num_funcs_];
+      scalar_t ux = 0.0, uy = 0.0;
+      for(int_t i=0;i<num_funcs_;++i){
+        ux += N[i]*elem_x[i*spa_dim_+0];
+        uy += N[i]*elem_x[i*spa_dim_+1];
+      }
+      const scalar_t grad_phi_x = image_gp_grad_x_[index];
+      const scalar_t grad_phi_y = image_gp_grad_y_[index];
+      const scalar_t s = (grad_phi_x*ux + grad_phi_y*uy)*image_gp_weight_J_[index];
+      for(int_t i=0;i<num_funcs_;++i){
+        elem_y[i*spa_dim_+0] += N[i]*grad_phi_x*s;
+        elem_y[i*spa_dim_+1] += N[i]*grad_phi_y*s;
+      }
+    }
+  }
+}
+
+int
+Matrix_Free_Operator::Apply(const Epetra_MultiVector & X,
+  Epetra_MultiVector & Y)const{
+  TEUCHOS_TEST_FOR_EXCEPTION(!is_updated_,std::runtime_error,
+    "Error, update() must be called before the operator is applied");
+  const int_t num_vectors = X.NumVectors();
+  if(overlap_x_==Teuchos::null||overlap_x_->NumVectors()!=num_vectors){
+    overlap_x_ = Teuchos::rcp(new Epetra_MultiVector(*overlap_map_,num_vectors));
+    overlap_y_ = Teuchos::rcp(new Epetra_MultiVector(*overlap_map_,num_vectors));
+  }
+  overlap_x_->Import(X,*importer_,Insert);
+  overlap_y_->PutScalar(0.0);
+  const int_t elem_size = num_funcs_*spa_dim_;
+  const int_t B_dim = 2*spa_dim_ - 1;
+  for(int_t v=0;v<num_vectors;++v){
+    const double * x = (*overlap_x_)[v];
+    double * y = (*overlap_y_)[v];
+    // the element products are computed concurrently and summed in element order
+    // so the result does not depend on the number of threads
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads_) if(num_threads_>1)
+#endif
+    {
+      std::vector<scalar_t> elem_x(elem_size);
+      std::vector<scalar_t> strain(B_dim);
+      std::vector<scalar_t> B(B_dim*elem_size);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for(int_t elem=0;elem<num_elem_;++elem){
+        const int_t * dofs = &elem_dofs_[elem*elem_size];
+        for(int_t i=0;i<elem_size;++i)
+          elem_x[i] = x[dofs[i]];
+        apply_element(elem,&elem_x[0],&strain[0],&B[0],&elem_values_[elem*elem_size]);
+      }
+    }
+    for(int_t elem=0;elem<num_elem_;++elem){
+      const int_t * dofs = &elem_dofs_[elem*elem_size];
+      const scalar_t * elem_y = &elem_values_[elem*elem_size];
+      for(int_t i=0;i<elem_size;++i){
+        if(!skip_row_[dofs[i]])
+          y[dofs[i]] += elem_y[i];
+      }
+    }
+    for(size_t i=0;i<identity_dofs_.size();++i)
+      y[identity_dofs_[i]] += x[identity_dofs_[i]];
+  }
+  Y.PutScalar(0.0);
+  Y.Export(*overlap_y_,*exporter_,Add);
+  return 0;
+}
+
+void
+Matrix_Free_Operator::extract_diagonal(Epetra_Vector & diagonal)const{
+  TEUCHOS_TEST_FOR_EXCEPTION(!is_updated_,std::runtime_error,
+    "Error, update() must be called before the diagonal is extracted");
+  TEUCHOS_TEST_FOR_EXCEPTION(!diagonal.Map().SameAs(*dist_map_),std::runtime_error,
+    "Error, the diagonal must have the same map as the operator");
+  const int_t elem_size = num_funcs_*spa_dim_;
+  const int_t B_dim = 2*spa_dim_ - 1;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads_) if(num_threads_>1)
+#endif
+  {
+    std::vector<scalar_t> B(B_dim*elem_size);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int_t elem=0;elem<num_elem_;++elem){
+      scalar_t * elem_diag = &elem_values_[elem*elem_size];
+      for(int_t i=0;i<elem_size;++i)
+        elem_diag[i] = 0.0;
+      for(int_t gp=0;gp<num_gps_;++gp){
+        const int_t index = elem*num_gps_ + gp;
+        const scalar_t * N = &N_[gp*num_funcs_];
+        const scalar_t weight_J = gp_weight_J_[index];
+        for(int_t i=0;i<num_funcs_;++i){
+          if(has_mms_image_term_){
+            elem_diag[i*spa_dim_+0] += N[i]*gp_grad_x_[index]*gp_grad_x_[index]*N[i]*weight_J;
+            elem_diag[i*spa_dim_+1] += N[i]*gp_grad_y_[index]*gp_grad_y_[index]*N[i]*weight_J;
+          }
+          if(has_tikhonov_term_){
+            elem_diag[i*spa_dim_+0] += N[i]*alpha2_*N[i]*weight_J;
+            elem_diag[i*spa_dim_+1] += N[i]*alpha2_*N[i]*weight_J;
+          }
+        }
+        if(has_div_strain_term_){
+          DICe::global::calc_B(&DN_[gp*elem_size],&gp_inv_jac_[index*spa_dim_*spa_dim_],num_funcs_,spa_dim_,&B[0]);
+          for(int_t i=0;i<elem_size;++i)
+            for(int_t j=0;j<B_dim;++j)
+              elem_diag[i] += alpha2_*B[j*elem_size+i]*B[j*elem_size+i]*weight_J;
+        }
+      }
+      if(has_image_term_){
+        for(int_t gp=0;gp<num_image_gps_;++gp){
+          const int_t index = elem*num_image_gps_ + gp;
+          const scalar_t * N = &image_N_[gp*num_funcs_];
+          for(int_t i=0;i<num_funcs_;++i){
+            elem_diag[i*spa_dim_+0] += N[i]*image_gp_grad_x_[index]*image_gp_grad_x_[index]*N[i]*image_gp_weight_J_[index];
+            elem_diag[i*spa_dim_+1] += N[i]*image_gp_grad_y_[index]*image_gp_grad_y_[index]*N[i]*image_gp_weight_J_[index];
+          }
+        }
+      }
+    } // elem
+  }
+  Epetra_Vector overlap_diagonal(*overlap_map_);
+  for(int_t elem=0;elem<num_elem_;++elem){
+    const int_t * dofs = &elem_dofs_[elem*elem_size];
+    const scalar_t * elem_diag = &elem_values_[elem*elem_size];
+    for(int_t i=0;i<elem_size;++i){
+      if(!skip_row_[dofs[i]])
+        overlap_diagonal[dofs[i]] += elem_diag[i];
+    }
+  }
+  for(size_t i=0;i<identity_dofs_.size();++i)
+    overlap_diagonal[identity_dofs_[i]] += 1.0;
+  diagonal.PutScalar(0.0);
+  diagonal.Export(overlap_diagonal,*exporter_,Add);
+}
+
+}// end global namespace
+
+}// End DICe Namespace
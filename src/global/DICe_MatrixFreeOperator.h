@@ -0,0 +1,238 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_MATRIXFREEOPERATOR_H
+#define DICE_MATRIXFREEOPERATOR_H
+
+#include <DICe.h>
+#include <DICe_MultiFieldEpetra.h>
+
+#include <Epetra_Operator.h>
+#include <Epetra_Vector.h>
+#include <Epetra_Import.h>
+#include <Epetra_Export.h>
+
+#include <vector>
+
+namespace DICe {
+
+namespace global{
+
+// forward declaration of the global algorithm
+class Global_Algorithm;
+
+/// \class DICe::global::Matrix_Free_Operator
+/// \brief Applies the global DIC tangent to a vector without assembling the matrix
+///
+/// The image and regularization stiffness terms are evaluated element by element
+/// from quadrature data (weighted jacobians and image gradients at the integration points)
+/// cached for each element by update(). The boundary condition rows are treated the
+/// same way as in Global_Algorithm::compute_tangent(). Only the non-mixed formulations are supported.
+class
+DICE_LIB_DLL_EXPORT
+Matrix_Free_Operator : public Epetra_Operator
+{
+public:
+  /// Constructor
+  /// \param alg pointer to the global algorithm that owns the mesh, images and boundary conditions
+  Matrix_Free_Operator(Global_Algorithm * alg);
+
+  /// Destructor
+  virtual ~Matrix_Free_Operator(){};
+
+  /// evaluate the cached quadrature data for the current images and displacement field
+  /// \param use_fixed_point true if fixed point iteration is being employed
+  void update(const bool use_fixed_point);
+
+  /// compute the diagonal of the operator
+  /// \param diagonal output vector with the distributed map of the operator
+  void extract_diagonal(Epetra_Vector & diagonal)const;
+
+  /// only the non-transposed operator is available (the operator is symmetric)
+  /// \param use_transpose true if the transpose should be applied
+  int SetUseTranspose(bool use_transpose){
+    return use_transpose ? -1 : 0;
+  }
+
+  /// compute Y = A*X
+  /// \param X input multivector
+  /// \param Y output multivector
+  int Apply(const Epetra_MultiVector & X,
+    Epetra_MultiVector & Y)const;
+
+  /// the inverse is not available
+  int ApplyInverse(const Epetra_MultiVector & X,
+    Epetra_MultiVector & Y)const{
+    return -1;
+  }
+
+  /// the infinity norm is not available
+  double NormInf()const{
+    return 0.0;
+  }
+
+  /// label for the operator
+  const char * Label()const{
+    return "DICe::global::Matrix_Free_Operator";
+  }
+
+  /// returns false, the transpose is never used
+  bool UseTranspose()const{
+    return false;
+  }
+
+  /// returns false, the infinity norm is not available
+  bool HasNormInf()const{
+    return false;
+  }
+
+  /// return the communicator
+  const Epetra_Comm & Comm()const{
+    return dist_map_->Comm();
+  }
+
+  /// return the domain map
+  const Epetra_Map & OperatorDomainMap()const{
+    return *dist_map_;
+  }
+
+  /// return the range map
+  const Epetra_Map & OperatorRangeMap()const{
+    return *dist_map_;
+  }
+
+private:
+  /// protect the default constructor
+  Matrix_Free_Operator(const Matrix_Free_Operator&);
+  /// comparison operator
+  Matrix_Free_Operator& operator=(const Matrix_Free_Operator&);
+
+  /// compute the element contribution elem_y = K_e * elem_x
+  /// \param elem the element index
+  /// \param elem_x element values of the input vector
+  /// \param strain scratch storage of size 2*spa_dim-1
+  /// \param B scratch storage for the B matrix
+  /// \param elem_y output element values
+  void apply_element(const int_t elem,
+    const scalar_t * elem_x,
+    scalar_t * strain,
+    scalar_t * B,
+    scalar_t * elem_y)const;
+
+  /// pointer to the global algorithm
+  Global_Algorithm * alg_;
+  /// spatial dimension
+  int_t spa_dim_;
+  /// number of shape functions per element
+  int_t num_funcs_;
+  /// number of elements
+  int_t num_elem_;
+  /// number of low order integration points (regularization terms)
+  int_t num_gps_;
+  /// number of image integration points
+  int_t num_image_gps_;
+  /// number of threads used to evaluate the element terms
+  int_t num_threads_;
+  /// regularization coefficient
+  scalar_t alpha2_;
+  /// true if the image gradient tensor term is active
+  bool has_image_term_;
+  /// true if the mms image gradient tensor term is active
+  bool has_mms_image_term_;
+  /// true if the tikhonov regularization term is active
+  bool has_tikhonov_term_;
+  /// true if the symmetric strain regularization term is active
+  bool has_div_strain_term_;
+  /// true once the quadrature data has been evaluated
+  bool is_updated_;
+  /// distributed vector node map
+  Teuchos::RCP<const Epetra_Map> dist_map_;
+  /// overlap vector node map
+  Teuchos::RCP<const Epetra_Map> overlap_map_;
+  /// importer from the distributed to the overlap map
+  Teuchos::RCP<Epetra_Import> importer_;
+  /// exporter from the overlap to the distributed map
+  Teuchos::RCP<Epetra_Export> exporter_;
+  /// overlap copy of the input vector
+  mutable Teuchos::RCP<Epetra_MultiVector> overlap_x_;
+  /// overlap copy of the output vector
+  mutable Teuchos::RCP<Epetra_MultiVector> overlap_y_;
+  /// element contributions, assembled in element order after the parallel loop
+  mutable std::vector<scalar_t> elem_values_;
+  /// overlap local dof ids of the element nodes
+  std::vector<int_t> elem_dofs_;
+  /// true for the overlap dofs that do not receive element contributions (kinematic bc rows)
+  std::vector<bool> skip_row_;
+  /// overlap dofs that get a unit diagonal (kinematic bcs)
+  std::vector<int_t> identity_dofs_;
+  /// gauss weights of the low order integration points
+  std::vector<scalar_t> gp_weights_;
+  /// gauss weights of the image integration points
+  std::vector<scalar_t> image_gp_weights_;
+  /// shape function values at the low order integration points (the same for every element)
+  std::vector<scalar_t> N_;
+  /// shape function derivatives at the low order integration points
+  std::vector<scalar_t> DN_;
+  /// shape function values at the image integration points
+  std::vector<scalar_t> image_N_;
+  /// shape function derivatives at the image integration points
+  std::vector<scalar_t> image_DN_;
+  /// gauss weight times jacobian for each element and low order integration point
+  std::vector<scalar_t> gp_weight_J_;
+  /// inverse jacobian for each element and low order integration point
+  std::vector<scalar_t> gp_inv_jac_;
+  /// mms image gradients for each element and low order integration point
+  std::vector<scalar_t> gp_grad_x_;
+  /// mms image gradients for each element and low order integration point
+  std::vector<scalar_t> gp_grad_y_;
+  /// gauss weight times jacobian for each element and image integration point
+  std::vector<scalar_t> image_gp_weight_J_;
+  /// image gradients for each element and image integration point
+  std::vector<scalar_t> image_gp_grad_x_;
+  /// image gradients for each element and image integration point
+  std::vector<scalar_t> image_gp_grad_y_;
+};
+
+}// end global namespace
+
+}// End DICe Namespace
+
+#endif
@@ -97,6 +97,190 @@ Preconditioner_Factory::create (Teuchos::RCP<matrix_type> A,
 
   return prec;
 }
+
+Diagonal_Preconditioner::Diagonal_Preconditioner(const Epetra_Vector & diagonal):
+  diagonal_(diagonal),
+  inverse_diagonal_(diagonal.Map())
+{
+  for(int_t i=0;i<diagonal_.MyLength();++i)
+    inverse_diagonal_[i] = diagonal_[i]==0.0 ? 1.0 : 1.0/diagonal_[i];
+}
+
+Teuchos::RCP<Diagonal_Preconditioner>
+Preconditioner_Factory::create_jacobi (const Epetra_Vector & diagonal) const
+{
+  DEBUG_MSG("Preconditioner_Factory(): creating Jacobi preconditioner");
+  return Teuchos::rcp(new Diagonal_Preconditioner(diagonal));
+}
+
+Block_Preconditioner::Block_Preconditioner(Teuchos::RCP<matrix_type> matrix,
+  const int_t mixed_offset,
+  const Teuchos::RCP<Teuchos::ParameterList> & ifpack_params):
+  matrix_(matrix)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(matrix_==Teuchos::null||!matrix_->Filled(),std::runtime_error,
+    "Error, the block preconditioner requires an assembled tangent");
+  const Epetra_Map & row_map = matrix_->RowMap();
+  std::vector<int> velocity_gids;
+  std::vector<int> multiplier_gids;
+  for(int_t i=0;i<row_map.NumMyElements();++i){
+    const int gid = row_map.GID(i);
+    if(gid>mixed_offset){
+      multiplier_lids_.push_back(i);
+      multiplier_gids.push_back(gid);
+    }
+    else{
+      velocity_lids_.push_back(i);
+      velocity_gids.push_back(gid);
+    }
+  }
+  DEBUG_MSG("Block_Preconditioner(): local velocity rows: " << velocity_lids_.size() << " local multiplier rows: " << multiplier_lids_.size());
+  velocity_map_ = Teuchos::rcp(new Epetra_Map(-1,(int)velocity_gids.size(),velocity_gids.empty() ? NULL : &velocity_gids[0],
+    row_map.IndexBase(),row_map.Comm()));
+  multiplier_map_ = Teuchos::rcp(new Epetra_Map(-1,(int)multiplier_gids.size(),multiplier_gids.empty() ? NULL : &multiplier_gids[0],
+    row_map.IndexBase(),row_map.Comm()));
+
+  // split the velocity rows into the A and B^T blocks
+  velocity_block_ = Teuchos::rcp(new Epetra_CrsMatrix(Copy,*velocity_map_,0));
+  coupling_block_ = Teuchos::rcp(new Epetra_CrsMatrix(Copy,*velocity_map_,0));
+  std::vector<int> a_cols, bt_cols;
+  std::vector<double> a_values, bt_values;
+  int num_entries = 0;
+  double * values = NULL;
+  int * indices = NULL;
+  for(size_t i=0;i<velocity_lids_.size();++i){
+    matrix_->ExtractMyRowView(velocity_lids_[i],num_entries,values,indices);
+    a_cols.clear(); a_values.clear();
+    bt_cols.clear(); bt_values.clear();
+    for(int j=0;j<num_entries;++j){
+      const int col_gid = matrix_->GCID(indices[j]);
+      if(col_gid>mixed_offset){
+        bt_cols.push_back(col_gid);
+        bt_values.push_back(values[j]);
+      }
+      else{
+        a_cols.push_back(col_gid);
+        a_values.push_back(values[j]);
+      }
+    }
+    if(!a_cols.empty())
+      velocity_block_->InsertGlobalValues(velocity_gids[i],(int)a_cols.size(),&a_values[0],&a_cols[0]);
+    if(!bt_cols.empty())
+      coupling_block_->InsertGlobalValues(velocity_gids[i],(int)bt_cols.size(),&bt_values[0],&bt_cols[0]);
+  }
+  velocity_block_->FillComplete();
+  coupling_block_->FillComplete(*multiplier_map_,*velocity_map_);
+
+  Preconditioner_Factory factory;
+  velocity_solver_ = factory.create(velocity_block_,ifpack_params);
+
+  // diagonal Schur complement approximation S_kk = C_kk - sum_j B_kj^2 / A_jj
+  // (the coupling blocks are the transpose of each other), B is split out of the multiplier rows
+  // so that its column map only holds velocity ids the diagonal of A can be imported to
+  Epetra_CrsMatrix multiplier_coupling_block(Copy,*multiplier_map_,0);
+  std::vector<double> multiplier_diagonal(multiplier_lids_.size(),0.0);
+  for(size_t k=0;k<multiplier_lids_.size();++k){
+    matrix_->ExtractMyRowView(multiplier_lids_[k],num_entries,values,indices);
+    bt_cols.clear(); bt_values.clear();
+    for(int j=0;j<num_entries;++j){
+      const int col_gid = matrix_->GCID(indices[j]);
+      if(col_gid==multiplier_gids[k])
+        multiplier_diagonal[k] += values[j];
+      else if(col_gid<=mixed_offset){
+        bt_cols.push_back(col_gid);
+        bt_values.push_back(values[j]);
+      }
+    }
+    if(!bt_cols.empty())
+      multiplier_coupling_block.InsertGlobalValues(multiplier_gids[k],(int)bt_cols.size(),&bt_values[0],&bt_cols[0]);
+  }
+  multiplier_coupling_block.FillComplete(*velocity_map_,*multiplier_map_);
+  Epetra_Vector inverse_velocity_diagonal(*velocity_map_);
+  velocity_block_->ExtractDiagonalCopy(inverse_velocity_diagonal);
+  for(int_t i=0;i<inverse_velocity_diagonal.MyLength();++i)
+    inverse_velocity_diagonal[i] = inverse_velocity_diagonal[i]==0.0 ? 1.0 : 1.0/inverse_velocity_diagonal[i];
+  Epetra_Vector inverse_velocity_diagonal_col(multiplier_coupling_block.ColMap());
+  Epetra_Import importer(multiplier_coupling_block.ColMap(),*velocity_map_);
+  inverse_velocity_diagonal_col.Import(inverse_velocity_diagonal,importer,Insert);
+  inverse_schur_diagonal_ = Teuchos::rcp(new Epetra_Vector(*multiplier_map_));
+  for(size_t k=0;k<multiplier_lids_.size();++k){
+    multiplier_coupling_block.ExtractMyRowView((int)k,num_entries,values,indices);
+    double schur = multiplier_diagonal[k];
+    for(int j=0;j<num_entries;++j)
+      schur -= values[j]*values[j]*inverse_velocity_diagonal_col[indices[j]];
+    (*inverse_schur_diagonal_)[k] = schur==0.0 ? 1.0 : 1.0/schur;
+  }
+}
+
+int
+Block_Preconditioner::ApplyInverse(const Epetra_MultiVector & X,
+  Epetra_MultiVector & Y)const{
+  const int num_vectors = X.NumVectors();
+  // X and Y may be the same vector so the blocks are copied out before Y is written
+  Epetra_MultiVector x_u(*velocity_map_,num_vectors,false);
+  Epetra_MultiVector x_p(*multiplier_map_,num_vectors,false);
+  for(int v=0;v<num_vectors;++v){
+    for(size_t i=0;i<velocity_lids_.size();++i)
+      x_u[v][i] = X[v][velocity_lids_[i]];
+    for(size_t k=0;k<multiplier_lids_.size();++k)
+      x_p[v][k] = X[v][multiplier_lids_[k]];
+  }
+  // y_p = S^-1 x_p
+  Epetra_MultiVector y_p(*multiplier_map_,num_vectors,false);
+  int ierr = y_p.Multiply(1.0,*inverse_schur_diagonal_,x_p,0.0);
+  if(ierr) return ierr;
+  // y_u = A^-1 (x_u - B^T y_p)
+  Epetra_MultiVector r_u(*velocity_map_,num_vectors,false);
+  ierr = coupling_block_->Multiply(false,y_p,r_u);
+  if(ierr) return ierr;
+  r_u.Update(1.0,x_u,-1.0);
+  Epetra_MultiVector y_u(*velocity_map_,num_vectors,false);
+  ierr = velocity_solver_->ApplyInverse(r_u,y_u);
+  if(ierr) return ierr;
+  for(int v=0;v<num_vectors;++v){
+    for(size_t i=0;i<velocity_lids_.size();++i)
+      Y[v][velocity_lids_[i]] = y_u[v][i];
+    for(size_t k=0;k<multiplier_lids_.size();++k)
+      Y[v][multiplier_lids_[k]] = y_p[v][k];
+  }
+  return 0;
+}
+
+Teuchos::RCP<Block_Preconditioner>
+Preconditioner_Factory::create_block (Teuchos::RCP<matrix_type> A,
+          const int_t mixed_offset) const
+{
+  DEBUG_MSG("Preconditioner_Factory(): creating block preconditioner");
+  return Teuchos::rcp(new Block_Preconditioner(A,mixed_offset,parameter_list_for_ifpack()));
+}
+
+#ifdef DICE_ENABLE_ML
+Teuchos::RCP<Teuchos::ParameterList>
+Preconditioner_Factory::parameter_list_for_ml(const int_t num_pde_equations) const{
+  Teuchos::RCP<Teuchos::ParameterList> pl = Teuchos::parameterList ("ML");
+  // smoothed aggregation defaults for symmetric (or nearly symmetric) systems
+  ML_Epetra::SetDefaults("SA",*pl);
+  // aggregate the displacement components of a node together
+  pl->set ("PDE equations", num_pde_equations);
+  pl->set ("aggregation: type", "Uncoupled");
+  pl->set ("smoother: type", "symmetric Gauss-Seidel");
+  pl->set ("smoother: sweeps", 2);
+  pl->set ("coarse: max size", 128);
+  pl->set ("ML output", 0);
+  return pl;
+}
+
+Teuchos::RCP<ML_Epetra::MultiLevelPreconditioner>
+Preconditioner_Factory::create_amg (Teuchos::RCP<matrix_type> A,
+          const Teuchos::RCP<Teuchos::ParameterList> plist) const
+{
+  DEBUG_MSG("Preconditioner_Factory(): creating ML preconditioner");
+  // the hierarchy is computed in the constructor
+  Teuchos::RCP<ML_Epetra::MultiLevelPreconditioner> prec =
+      Teuchos::rcp(new ML_Epetra::MultiLevelPreconditioner(*A, *plist, true));
+  return prec;
+}
+#endif
 #endif
 
 }// End DICe Namespace
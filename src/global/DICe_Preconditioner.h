@@ -51,6 +51,9 @@
 #else
   #include "DICe_MultiFieldEpetra.h"
   #include <Ifpack.h>
+  #ifdef DICE_ENABLE_ML
+    #include <ml_MultiLevelPreconditioner.h>
+  #endif
 #endif
 
 namespace DICe {
@@ -58,6 +61,181 @@ namespace DICe {
 #ifdef DICE_TPETRA
 #error // ifpack is not set up for Tpetra...
 #else
+/// \class DICe::Diagonal_Preconditioner
+/// \brief Jacobi preconditioner, ApplyInverse() scales the input by the inverse of the operator diagonal
+///
+/// Only the diagonal is needed so this can be used with the matrix free operator
+class Diagonal_Preconditioner : public Epetra_Operator {
+public:
+  /// Constructor
+  /// \param diagonal the diagonal of the operator (zero entries are treated as one)
+  Diagonal_Preconditioner(const Epetra_Vector & diagonal);
+
+  /// Destructor
+  virtual ~Diagonal_Preconditioner(){};
+
+  /// the diagonal is symmetric so the transpose is the same operator
+  /// \param use_transpose true if the transpose should be applied
+  int SetUseTranspose(bool use_transpose){
+    return 0;
+  }
+
+  /// scale by the diagonal
+  /// \param X input multivector
+  /// \param Y output multivector
+  int Apply(const Epetra_MultiVector & X,
+    Epetra_MultiVector & Y)const{
+    return Y.Multiply(1.0,diagonal_,X,0.0);
+  }
+
+  /// scale by the inverse of the diagonal
+  /// \param X input multivector
+  /// \param Y output multivector
+  int ApplyInverse(const Epetra_MultiVector & X,
+    Epetra_MultiVector & Y)const{
+    return Y.Multiply(1.0,inverse_diagonal_,X,0.0);
+  }
+
+  /// return the infinity norm
+  double NormInf()const{
+    double norm = 0.0;
+    diagonal_.NormInf(&norm);
+    return norm;
+  }
+
+  /// label for the operator
+  const char * Label()const{
+    return "DICe::Diagonal_Preconditioner";
+  }
+
+  /// returns false, the transpose is the same operator
+  bool UseTranspose()const{
+    return false;
+  }
+
+  /// returns true
+  bool HasNormInf()const{
+    return true;
+  }
+
+  /// return the communicator
+  const Epetra_Comm & Comm()const{
+    return diagonal_.Comm();
+  }
+
+  /// return the domain map
+  const Epetra_Map & OperatorDomainMap()const{
+    return static_cast<const Epetra_Map &>(diagonal_.Map());
+  }
+
+  /// return the range map
+  const Epetra_Map & OperatorRangeMap()const{
+    return static_cast<const Epetra_Map &>(diagonal_.Map());
+  }
+
+private:
+  /// diagonal of the operator
+  Epetra_Vector diagonal_;
+  /// inverse of the diagonal
+  Epetra_Vector inverse_diagonal_;
+};
+
+/// \class DICe::Block_Preconditioner
+/// \brief block upper triangular preconditioner for the saddle point tangent of the mixed formulation
+///
+/// The tangent is split into the velocity and the lagrange multiplier blocks [A B^T; B C]. ApplyInverse()
+/// solves the multiplier block with the diagonal approximation of the Schur complement S = C - B diag(A)^-1 B^T,
+/// followed by the velocity block y_u = A^-1 (x_u - B^T y_p) with an ILU factorization of A. The
+/// preconditioner is not symmetric so it should be used with GMRES.
+class Block_Preconditioner : public Epetra_Operator {
+public:
+  /// Constructor
+  /// \param matrix the assembled mixed tangent
+  /// \param mixed_offset the largest velocity global id (the multiplier ids are above this)
+  /// \param ifpack_params the parameters for the ILU factorization of the velocity block
+  Block_Preconditioner(Teuchos::RCP<matrix_type> matrix,
+    const int_t mixed_offset,
+    const Teuchos::RCP<Teuchos::ParameterList> & ifpack_params);
+
+  /// Destructor
+  virtual ~Block_Preconditioner(){};
+
+  /// the transpose is not supported
+  /// \param use_transpose true if the transpose should be applied
+  int SetUseTranspose(bool use_transpose){
+    return use_transpose ? -1 : 0;
+  }
+
+  /// apply the tangent
+  /// \param X input multivector
+  /// \param Y output multivector
+  int Apply(const Epetra_MultiVector & X,
+    Epetra_MultiVector & Y)const{
+    return matrix_->Apply(X,Y);
+  }
+
+  /// apply the block inverse
+  /// \param X input multivector
+  /// \param Y output multivector
+  int ApplyInverse(const Epetra_MultiVector & X,
+    Epetra_MultiVector & Y)const;
+
+  /// not available
+  double NormInf()const{
+    return 0.0;
+  }
+
+  /// label for the operator
+  const char * Label()const{
+    return "DICe::Block_Preconditioner";
+  }
+
+  /// returns false
+  bool UseTranspose()const{
+    return false;
+  }
+
+  /// returns false
+  bool HasNormInf()const{
+    return false;
+  }
+
+  /// return the communicator
+  const Epetra_Comm & Comm()const{
+    return matrix_->Comm();
+  }
+
+  /// return the domain map
+  const Epetra_Map & OperatorDomainMap()const{
+    return matrix_->OperatorDomainMap();
+  }
+
+  /// return the range map
+  const Epetra_Map & OperatorRangeMap()const{
+    return matrix_->OperatorRangeMap();
+  }
+
+private:
+  /// the mixed tangent
+  Teuchos::RCP<matrix_type> matrix_;
+  /// local ids of the velocity rows in the tangent
+  std::vector<int> velocity_lids_;
+  /// local ids of the lagrange multiplier rows in the tangent
+  std::vector<int> multiplier_lids_;
+  /// map of the velocity rows
+  Teuchos::RCP<Epetra_Map> velocity_map_;
+  /// map of the lagrange multiplier rows
+  Teuchos::RCP<Epetra_Map> multiplier_map_;
+  /// velocity block A
+  Teuchos::RCP<Epetra_CrsMatrix> velocity_block_;
+  /// coupling block B^T (velocity rows, multiplier columns)
+  Teuchos::RCP<Epetra_CrsMatrix> coupling_block_;
+  /// ILU factorization of the velocity block (holds a pointer to velocity_block_ so it is declared after it)
+  Teuchos::RCP<Ifpack_Preconditioner> velocity_solver_;
+  /// inverse of the approximate Schur complement diagonal
+  Teuchos::RCP<Epetra_Vector> inverse_schur_diagonal_;
+};
+
 class Preconditioner_Factory {
 private:
 public:
@@ -65,6 +243,21 @@ public:
   Teuchos::RCP<Teuchos::ParameterList> parameter_list_for_ifpack () const;
   Teuchos::RCP<Ifpack_Preconditioner> create (Teuchos::RCP<matrix_type> A,
           const Teuchos::RCP<Teuchos::ParameterList> plist) const;
+  /// create a Jacobi preconditioner from the diagonal of the operator
+  Teuchos::RCP<Diagonal_Preconditioner> create_jacobi (const Epetra_Vector & diagonal) const;
+  /// create a block preconditioner for the mixed formulation tangent
+  /// \param A the assembled mixed tangent
+  /// \param mixed_offset the largest velocity global id
+  Teuchos::RCP<Block_Preconditioner> create_block (Teuchos::RCP<matrix_type> A,
+          const int_t mixed_offset) const;
+#ifdef DICE_ENABLE_ML
+  /// parameters for the smoothed aggregation multigrid preconditioner
+  /// \param num_pde_equations number of degrees of freedom per node
+  Teuchos::RCP<Teuchos::ParameterList> parameter_list_for_ml (const int_t num_pde_equations) const;
+  /// create an algebraic multigrid preconditioner
+  Teuchos::RCP<ML_Epetra::MultiLevelPreconditioner> create_amg (Teuchos::RCP<matrix_type> A,
+          const Teuchos::RCP<Teuchos::ParameterList> plist) const;
+#endif
 };
 #endif
 
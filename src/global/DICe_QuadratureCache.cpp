@@ -0,0 +1,219 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe_QuadratureCache.h>
+#include <DICe_Global.h>
+#include <DICe_GlobalUtils.h>
+
+#include <exception>
+
+namespace DICe {
+
+namespace global{
+
+Quadrature_Cache::Quadrature_Cache(Global_Algorithm * alg):
+  alg_(alg),
+  spa_dim_(0),
+  num_funcs_(0),
+  num_elem_(0),
+  num_gps_(0),
+  num_image_gps_(0),
+  natural_coord_dim_(0),
+  has_reference_image_values_(false)
+{
+  TEUCHOS_TEST_FOR_EXCEPTION(alg_==NULL,std::runtime_error,
+    "Error, the pointer to the algorithm must be valid");
+  Teuchos::RCP<DICe::mesh::Mesh> mesh = alg_->mesh();
+  spa_dim_ = mesh->spatial_dimension();
+  TEUCHOS_TEST_FOR_EXCEPTION(spa_dim_!=2,std::runtime_error,
+    "Error, the quadrature cache is only implemented for two dimensions");
+
+  DICe::mesh::Shape_Function_Evaluator_Factory shape_func_eval_factory;
+  Teuchos::RCP<DICe::mesh::Shape_Function_Evaluator> shape_func_evaluator = alg_->element_type()==DICe::mesh::TRI6 ?
+      shape_func_eval_factory.create(DICe::mesh::TRI6) :
+      shape_func_eval_factory.create(DICe::mesh::TRI3);
+  num_funcs_ = shape_func_evaluator->num_functions();
+  const int_t elem_size = num_funcs_*spa_dim_;
+  const int_t jac_size = spa_dim_*spa_dim_;
+
+  // same integration points as Global_Algorithm::compute_tangent()
+  const int_t integration_order = 6;
+  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > gp_locs;
+  Teuchos::ArrayRCP<scalar_t> gp_weights;
+  shape_func_evaluator->get_natural_integration_points(integration_order,gp_locs,gp_weights,num_gps_);
+  natural_coord_dim_ = gp_locs[0].size();
+  Teuchos::ArrayRCP<Teuchos::ArrayRCP<scalar_t> > image_gp_locs;
+  Teuchos::ArrayRCP<scalar_t> image_gp_weights;
+  tri2d_nonexact_integration_points(alg_->num_image_integration_points(),image_gp_locs,image_gp_weights,num_image_gps_);
+
+  // the shape functions only depend on the natural coordinates so they are shared by all elements
+  natural_coords_.resize(num_gps_*natural_coord_dim_);
+  gp_weights_.resize(num_gps_);
+  N_.resize(num_gps_*num_funcs_);
+  DN_.resize(num_gps_*elem_size);
+  for(int_t gp=0;gp<num_gps_;++gp){
+    for(int_t dim=0;dim<natural_coord_dim_;++dim)
+      natural_coords_[gp*natural_coord_dim_+dim] = gp_locs[gp][dim];
+    gp_weights_[gp] = gp_weights[gp];
+  }
+  shape_func_evaluator->evaluate_shape_functions_at_points(num_gps_,natural_coord_dim_,&natural_coords_[0],&N_[0],&DN_[0]);
+  image_gp_weights_.resize(num_image_gps_);
+  image_N_.resize(num_image_gps_*num_funcs_);
+  std::vector<scalar_t> image_DN(num_image_gps_*elem_size);
+  const int_t image_natural_coord_dim = image_gp_locs[0].size();
+  std::vector<scalar_t> image_natural_coords(num_image_gps_*image_natural_coord_dim);
+  for(int_t gp=0;gp<num_image_gps_;++gp){
+    image_gp_weights_[gp] = image_gp_weights[gp];
+    for(int_t dim=0;dim<image_natural_coord_dim;++dim)
+      image_natural_coords[gp*image_natural_coord_dim+dim] = image_gp_locs[gp][dim];
+  }
+  shape_func_evaluator->evaluate_shape_functions_at_points(num_image_gps_,image_natural_coord_dim,&image_natural_coords[0],&image_N_[0],&image_DN[0]);
+
+  // the natural coordinates of the element nodes (if the element is TRI3 the last three are not used)
+  const scalar_t node_nat_coords[] = {0.0,0.0, 1.0,0.0, 0.0,1.0, 0.5,0.0, 0.5,0.5, 0.0,0.5};
+  std::vector<scalar_t> node_N(num_funcs_*num_funcs_);
+  std::vector<scalar_t> node_DN(num_funcs_*elem_size);
+  shape_func_evaluator->evaluate_shape_functions_at_points(num_funcs_,2,&node_nat_coords[0],&node_N[0],&node_DN[0]);
+
+  const DICe::mesh::Flat_Mesh_Data & flat = mesh->get_flat_data();
+  num_elem_ = flat.num_elem();
+  gp_x_.resize(num_elem_*num_gps_);
+  gp_y_.resize(num_elem_*num_gps_);
+  gp_J_.resize(num_elem_*num_gps_);
+  gp_inv_jac_.resize(num_elem_*num_gps_*jac_size);
+  image_gp_x_.resize(num_elem_*num_image_gps_);
+  image_gp_y_.resize(num_elem_*num_image_gps_);
+  image_gp_J_.resize(num_elem_*num_image_gps_);
+  node_grad_N_.resize(num_elem_*num_funcs_*elem_size);
+  std::vector<scalar_t> nodal_coords(elem_size);
+  std::vector<scalar_t> jac(jac_size);
+  std::vector<scalar_t> inv_jac(jac_size);
+  for(int_t elem=0;elem<num_elem_;++elem){
+    const int_t * elem_nodes = flat.elem_nodes(elem);
+    for(int_t nd=0;nd<num_funcs_;++nd){
+      nodal_coords[nd*spa_dim_+0] = flat.node_x[elem_nodes[nd]];
+      nodal_coords[nd*spa_dim_+1] = flat.node_y[elem_nodes[nd]];
+    }
+    for(int_t gp=0;gp<num_gps_;++gp){
+      const int_t id = elem*num_gps_+gp;
+      const scalar_t * N = &N_[gp*num_funcs_];
+      gp_x_[id] = 0.0; gp_y_[id] = 0.0;
+      for(int_t i=0;i<num_funcs_;++i){
+        gp_x_[id] += nodal_coords[i*spa_dim_+0]*N[i];
+        gp_y_[id] += nodal_coords[i*spa_dim_+1]*N[i];
+      }
+      DICe::global::calc_jacobian(&nodal_coords[0],&DN_[gp*elem_size],&jac[0],&gp_inv_jac_[id*jac_size],gp_J_[id],num_funcs_,spa_dim_);
+    }
+    for(int_t gp=0;gp<num_image_gps_;++gp){
+      const int_t id = elem*num_image_gps_+gp;
+      const scalar_t * N = &image_N_[gp*num_funcs_];
+      image_gp_x_[id] = 0.0; image_gp_y_[id] = 0.0;
+      for(int_t i=0;i<num_funcs_;++i){
+        image_gp_x_[id] += nodal_coords[i*spa_dim_+0]*N[i];
+        image_gp_y_[id] += nodal_coords[i*spa_dim_+1]*N[i];
+      }
+      DICe::global::calc_jacobian(&nodal_coords[0],&image_DN[gp*elem_size],&jac[0],&inv_jac[0],image_gp_J_[id],num_funcs_,spa_dim_);
+    }
+    for(int_t nd=0;nd<num_funcs_;++nd){
+      const scalar_t * DN = &node_DN[nd*elem_size];
+      scalar_t node_J = 0.0;
+      DICe::global::calc_jacobian(&nodal_coords[0],DN,&jac[0],&inv_jac[0],node_J,num_funcs_,spa_dim_);
+      scalar_t * grad_N = &node_grad_N_[(elem*num_funcs_+nd)*elem_size];
+      for(int_t i=0;i<num_funcs_;++i){
+        grad_N[i*spa_dim_+0] = inv_jac[0]*DN[i*spa_dim_+0] + inv_jac[2]*DN[i*spa_dim_+1];
+        grad_N[i*spa_dim_+1] = inv_jac[1]*DN[i*spa_dim_+0] + inv_jac[3]*DN[i*spa_dim_+1];
+      }
+    }
+  }
+  DEBUG_MSG("Quadrature_Cache::Quadrature_Cache(): num elem " << num_elem_ << " num gps " << num_gps_ <<
+    " num image gps " << num_image_gps_);
+  update_reference_image_values();
+}
+
+void
+Quadrature_Cache::update_reference_image_values(){
+  has_reference_image_values_ = false;
+  image_gp_phi_0_.clear();
+  image_gp_grad_x_.clear();
+  image_gp_grad_y_.clear();
+  // raw pointers are used inside the parallel region so no reference counts are modified
+  Image * ref_img = alg_->ref_img().get();
+  Image * grad_x = alg_->grad_x().get();
+  Image * grad_y = alg_->grad_y().get();
+  if(ref_img==NULL||grad_x==NULL||grad_y==NULL) return;
+#if DICE_KOKKOS
+  // the images are sampled on the device by Device_Image_Terms
+  DEBUG_MSG("Quadrature_Cache::update_reference_image_values(): the reference image is sampled on the device");
+  return;
+#endif
+  DEBUG_MSG("Quadrature_Cache::update_reference_image_values(): sampling the reference image");
+  const int_t num_values = num_elem_*num_image_gps_;
+  image_gp_phi_0_.resize(num_values);
+  image_gp_grad_x_.resize(num_values);
+  image_gp_grad_y_.resize(num_values);
+  const int_t num_threads = alg_->num_threads();
+  // exceptions can't leave a parallel region so the first one is stored and re-thrown below
+  std::exception_ptr sample_error;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads>1)
+#endif
+  for(int_t id=0;id<num_values;++id){
+    try{
+      image_gp_phi_0_[id] = ref_img->interpolate_bicubic_global(image_gp_x_[id],image_gp_y_[id]);
+      image_gp_grad_x_[id] = grad_x->interpolate_bicubic_global(image_gp_x_[id],image_gp_y_[id]);
+      image_gp_grad_y_[id] = grad_y->interpolate_bicubic_global(image_gp_x_[id],image_gp_y_[id]);
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_quadrature_cache_error)
+#endif
+      {
+        if(!sample_error) sample_error = std::current_exception();
+      }
+    }
+  }
+  if(sample_error) std::rethrow_exception(sample_error);
+  has_reference_image_values_ = true;
+}
+
+}// end global namespace
+
+}// End DICe Namespace
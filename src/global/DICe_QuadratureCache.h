@@ -0,0 +1,254 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#ifndef DICE_QUADRATURECACHE_H
+#define DICE_QUADRATURECACHE_H
+
+#include <DICe.h>
+
+#include <vector>
+
+namespace DICe {
+
+namespace global{
+
+// forward declaration of the global algorithm
+class Global_Algorithm;
+
+/// \class DICe::global::Quadrature_Cache
+/// \brief Integration point data for each element of a global DIC mesh
+///
+/// The reference configuration doesn't change during a global analysis so the shape functions,
+/// physical integration point locations and jacobians are evaluated once and stored in
+/// contiguous arrays (one entry per element and integration point), the same for the
+/// reference image intensities and gradients at the image integration points.
+/// Both the regular (order 6) and the image integration points of
+/// Global_Algorithm::compute_tangent() and Global_Algorithm::compute_residual() are stored,
+/// as well as the physical shape function derivatives at the element nodes used by
+/// Global_Algorithm::compute_strains().
+class
+DICE_LIB_DLL_EXPORT
+Quadrature_Cache
+{
+public:
+  /// Constructor
+  /// \param alg pointer to the global algorithm that owns the mesh and images
+  Quadrature_Cache(Global_Algorithm * alg);
+
+  /// Destructor
+  virtual ~Quadrature_Cache(){};
+
+  /// sample the reference image and its gradients at the image integration points
+  /// (does nothing if the algorithm has no reference image)
+  void update_reference_image_values();
+
+  /// returns true if the reference image values are available
+  bool has_reference_image_values()const{
+    return has_reference_image_values_;
+  }
+
+  /// number of elements
+  int_t num_elem()const{
+    return num_elem_;
+  }
+
+  /// number of shape functions per element
+  int_t num_funcs()const{
+    return num_funcs_;
+  }
+
+  /// number of regular integration points per element
+  int_t num_gps()const{
+    return num_gps_;
+  }
+
+  /// number of image integration points per element
+  int_t num_image_gps()const{
+    return num_image_gps_;
+  }
+
+  /// natural coordinates of a regular integration point
+  const scalar_t * natural_coords(const int_t gp)const{
+    return &natural_coords_[gp*natural_coord_dim_];
+  }
+
+  /// weight of a regular integration point
+  scalar_t gp_weight(const int_t gp)const{
+    return gp_weights_[gp];
+  }
+
+  /// shape functions at a regular integration point
+  const scalar_t * N(const int_t gp)const{
+    return &N_[gp*num_funcs_];
+  }
+
+  /// shape function derivatives at a regular integration point
+  const scalar_t * DN(const int_t gp)const{
+    return &DN_[gp*num_funcs_*spa_dim_];
+  }
+
+  /// physical x coordinate of a regular integration point
+  scalar_t x(const int_t elem, const int_t gp)const{
+    return gp_x_[elem*num_gps_+gp];
+  }
+
+  /// physical y coordinate of a regular integration point
+  scalar_t y(const int_t elem, const int_t gp)const{
+    return gp_y_[elem*num_gps_+gp];
+  }
+
+  /// jacobian determinant at a regular integration point
+  scalar_t J(const int_t elem, const int_t gp)const{
+    return gp_J_[elem*num_gps_+gp];
+  }
+
+  /// inverse jacobian at a regular integration point
+  const scalar_t * inv_jac(const int_t elem, const int_t gp)const{
+    return &gp_inv_jac_[(elem*num_gps_+gp)*spa_dim_*spa_dim_];
+  }
+
+  /// \brief physical shape function derivatives evaluated at one of the nodes of an element
+  ///
+  /// entries 2*i and 2*i+1 are the x and y derivatives of shape function i
+  /// \param elem the element index
+  /// \param nd the element node
+  const scalar_t * node_grad_N(const int_t elem, const int_t nd)const{
+    return &node_grad_N_[(elem*num_funcs_+nd)*num_funcs_*spa_dim_];
+  }
+
+  /// weight of an image integration point
+  scalar_t image_gp_weight(const int_t gp)const{
+    return image_gp_weights_[gp];
+  }
+
+  /// shape functions at an image integration point
+  const scalar_t * image_N(const int_t gp)const{
+    return &image_N_[gp*num_funcs_];
+  }
+
+  /// physical x coordinate of an image integration point
+  scalar_t image_x(const int_t elem, const int_t gp)const{
+    return image_gp_x_[elem*num_image_gps_+gp];
+  }
+
+  /// physical y coordinate of an image integration point
+  scalar_t image_y(const int_t elem, const int_t gp)const{
+    return image_gp_y_[elem*num_image_gps_+gp];
+  }
+
+  /// jacobian determinant at an image integration point
+  scalar_t image_J(const int_t elem, const int_t gp)const{
+    return image_gp_J_[elem*num_image_gps_+gp];
+  }
+
+  /// reference image intensity at an image integration point
+  scalar_t phi_0(const int_t elem, const int_t gp)const{
+    return image_gp_phi_0_[elem*num_image_gps_+gp];
+  }
+
+  /// reference image x gradient at an image integration point
+  scalar_t grad_phi_x(const int_t elem, const int_t gp)const{
+    return image_gp_grad_x_[elem*num_image_gps_+gp];
+  }
+
+  /// reference image y gradient at an image integration point
+  scalar_t grad_phi_y(const int_t elem, const int_t gp)const{
+    return image_gp_grad_y_[elem*num_image_gps_+gp];
+  }
+
+private:
+  /// pointer to the global algorithm
+  Global_Algorithm * alg_;
+  /// spatial dimension
+  int_t spa_dim_;
+  /// number of shape functions per element
+  int_t num_funcs_;
+  /// number of elements
+  int_t num_elem_;
+  /// number of regular integration points per element
+  int_t num_gps_;
+  /// number of image integration points per element
+  int_t num_image_gps_;
+  /// dimension of the natural coordinates
+  int_t natural_coord_dim_;
+  /// true if the reference image values have been sampled
+  bool has_reference_image_values_;
+  /// natural coordinates of the regular integration points
+  std::vector<scalar_t> natural_coords_;
+  /// regular integration point weights
+  std::vector<scalar_t> gp_weights_;
+  /// shape functions at the regular integration points (shared by all elements)
+  std::vector<scalar_t> N_;
+  /// shape function derivatives at the regular integration points (shared by all elements)
+  std::vector<scalar_t> DN_;
+  /// physical x coordinates of the regular integration points
+  std::vector<scalar_t> gp_x_;
+  /// physical y coordinates of the regular integration points
+  std::vector<scalar_t> gp_y_;
+  /// jacobian determinants at the regular integration points
+  std::vector<scalar_t> gp_J_;
+  /// inverse jacobians at the regular integration points
+  std::vector<scalar_t> gp_inv_jac_;
+  /// physical shape function derivatives at the element nodes
+  std::vector<scalar_t> node_grad_N_;
+  /// image integration point weights
+  std::vector<scalar_t> image_gp_weights_;
+  /// shape functions at the image integration points (shared by all elements)
+  std::vector<scalar_t> image_N_;
+  /// physical x coordinates of the image integration points
+  std::vector<scalar_t> image_gp_x_;
+  /// physical y coordinates of the image integration points
+  std::vector<scalar_t> image_gp_y_;
+  /// jacobian determinants at the image integration points
+  std::vector<scalar_t> image_gp_J_;
+  /// reference image intensities at the image integration points
+  std::vector<scalar_t> image_gp_phi_0_;
+  /// reference image x gradients at the image integration points
+  std::vector<scalar_t> image_gp_grad_x_;
+  /// reference image y gradients at the image integration points
+  std::vector<scalar_t> image_gp_grad_y_;
+};
+
+}// end global namespace
+
+}// End DICe Namespace
+
+#endif
@@ -45,8 +45,109 @@
 
 #include <triangle.h>
 
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+
 namespace DICe {
 
+/// returns a string that uniquely identifies the Triangle input and arguments
+std::string
+triangle_cache_key(const char * args,
+  const struct triangulateio & in){
+  std::stringstream key;
+  key << std::setprecision(17) << args << " " << in.numberofpoints;
+  for(int_t i=0;i<in.numberofpoints*2;++i)
+    key << " " << in.pointlist[i];
+  key << " " << in.numberofsegments;
+  for(int_t i=0;i<in.numberofsegments;++i)
+    key << " " << in.segmentlist[i*2] << " " << in.segmentlist[i*2+1] << " " << in.segmentmarkerlist[i];
+  key << " " << in.numberofholes;
+  for(int_t i=0;i<in.numberofholes*2;++i)
+    key << " " << in.holelist[i];
+  return key.str();
+}
+
+/// returns the name of the cache file for a key
+std::string
+triangle_cache_file_name(const std::string & cache_folder,
+  const std::string & key){
+  std::stringstream name;
+  name << cache_folder;
+  if(cache_folder[cache_folder.size()-1]!='/'&&cache_folder[cache_folder.size()-1]!='\\')
+    name << "/";
+  name << "tri_mesh_" << std::hex << std::hash<std::string>()(key) << ".txt";
+  return name.str();
+}
+
+/// reads a cached Triangle output, returns false if there is no cache file for this key
+/// (the arrays in out are allocated with malloc so they are freed the same way as Triangle's output)
+bool
+read_triangle_cache(const std::string & file_name,
+  const std::string & key,
+  struct triangulateio & out){
+  std::ifstream cache_file(file_name.c_str());
+  if(!cache_file.is_open()) return false;
+  std::string stored_key;
+  std::getline(cache_file,stored_key);
+  if(stored_key!=key) return false;
+  int num_points = 0, num_corners = 0, num_triangles = 0, num_segments = 0;
+  cache_file >> num_points >> num_corners >> num_triangles >> num_segments;
+  if(!cache_file.good()||num_points<=0||num_corners<=0||num_triangles<=0) return false;
+  REAL * pointlist = (REAL *) malloc(num_points*2*sizeof(REAL));
+  int * trianglelist = (int *) malloc(num_triangles*num_corners*sizeof(int));
+  int * segmentlist = (int *) malloc((num_segments*2+1)*sizeof(int));
+  int * segmentmarkerlist = (int *) malloc((num_segments+1)*sizeof(int));
+  for(int i=0;i<num_points*2;++i)
+    cache_file >> pointlist[i];
+  for(int i=0;i<num_triangles*num_corners;++i)
+    cache_file >> trianglelist[i];
+  for(int i=0;i<num_segments;++i)
+    cache_file >> segmentlist[i*2] >> segmentlist[i*2+1] >> segmentmarkerlist[i];
+  if(cache_file.fail()){
+    free(pointlist);
+    free(trianglelist);
+    free(segmentlist);
+    free(segmentmarkerlist);
+    return false;
+  }
+  out.numberofpoints = num_points;
+  out.numberofcorners = num_corners;
+  out.numberoftriangles = num_triangles;
+  out.numberofsegments = num_segments;
+  out.numberofedges = 0;
+  out.pointlist = pointlist;
+  out.trianglelist = trianglelist;
+  out.segmentlist = segmentlist;
+  out.segmentmarkerlist = segmentmarkerlist;
+  return true;
+}
+
+/// writes the Triangle output to the cache file
+void
+write_triangle_cache(const std::string & file_name,
+  const std::string & key,
+  const struct triangulateio & out){
+  std::ofstream cache_file(file_name.c_str());
+  if(!cache_file.is_open()){
+    DEBUG_MSG("write_triangle_cache(): could not open mesh cache file " << file_name);
+    return;
+  }
+  cache_file << key << "\n";
+  cache_file << out.numberofpoints << " " << out.numberofcorners << " " << out.numberoftriangles << " " << out.numberofsegments << "\n";
+  cache_file << std::setprecision(17);
+  for(int i=0;i<out.numberofpoints;++i)
+    cache_file << out.pointlist[i*2] << " " << out.pointlist[i*2+1] << "\n";
+  for(int i=0;i<out.numberoftriangles;++i){
+    for(int j=0;j<out.numberofcorners;++j)
+      cache_file << out.trianglelist[i*out.numberofcorners+j] << " ";
+    cache_file << "\n";
+  }
+  for(int i=0;i<out.numberofsegments;++i)
+    cache_file << out.segmentlist[i*2] << " " << out.segmentlist[i*2+1] << " " << out.segmentmarkerlist[i] << "\n";
+}
+
 DICE_LIB_DLL_EXPORT
 Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_Type elem_type,
   Teuchos::ArrayRCP<scalar_t> points_x,
@@ -74,7 +175,8 @@ DICE_LIB_DLL_EXPORT
 Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_Type elem_type,
   const std::string & roi_file_name,
   const scalar_t & max_size_constraint,
-  const std::string & output_file_name){
+  const std::string & output_file_name,
+  const std::string & cache_folder){
 
   TEUCHOS_TEST_FOR_EXCEPTION(elem_type!=DICe::mesh::TRI6&&elem_type!=DICe::mesh::TRI3,std::runtime_error,
     "Error, invalid element type");
@@ -263,7 +365,8 @@ Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_
       max_size_constraint,
       output_file_name,
       subset_file_info->enforce_lagrange_bc,
-      false);
+      false,
+      cache_folder);
   }
   mesh->set_bc_defs(stored_bcs);
   mesh->set_ic_values(subset_file_info->ic_value_x,subset_file_info->ic_value_y);
@@ -283,7 +386,8 @@ Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_
   const scalar_t & max_size_constraint,
   const std::string & output_file_name,
   const bool enforce_lagrange_bc,
-  const bool use_regular_grid){
+  const bool use_regular_grid,
+  const std::string & cache_folder){
 
   TEUCHOS_TEST_FOR_EXCEPTION(elem_type!=DICe::mesh::TRI6&&elem_type!=DICe::mesh::TRI3,std::runtime_error,
     "Error, invalid elem type");
@@ -456,7 +560,21 @@ Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_
     strncpy(args, arg_ss.str().c_str(), 1024);
     DEBUG_MSG("generate_tri_mesh() called with args: " << args);
     //  char args[] = arg_ss.str().c_str();
-    triangulate(args,&in,&out,NULL);
+    // reuse the output of a previous run for the same input if there is a cached copy
+    bool read_from_cache = false;
+    std::string cache_key;
+    std::string cache_file_name;
+    if(!cache_folder.empty()){
+      cache_key = triangle_cache_key(args,in);
+      cache_file_name = triangle_cache_file_name(cache_folder,cache_key);
+      read_from_cache = read_triangle_cache(cache_file_name,cache_key,out);
+      DEBUG_MSG("generate_tri_mesh(): mesh cache file " << cache_file_name << (read_from_cache ? " found" : " not found"));
+    }
+    if(!read_from_cache){
+      triangulate(args,&in,&out,NULL);
+      if(!cache_folder.empty())
+        write_triangle_cache(cache_file_name,cache_key,out);
+    }
 
     DEBUG_MSG("generate_tri_mesh(): number of boundary segments: " << out.numberofsegments);
     std::vector<std::pair<int_t,int_t>> dirichlet_boundary_nodes;
@@ -488,15 +606,23 @@ Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_
 
     // convert the resulting mesh to an exodus mesh
 
+    // index the boundary segments by their left node so the side set search below
+    // does not scan every segment for every element node
+    std::map<int_t,std::vector<int_t> > segments_by_left_node;
+    for(int_t k=0;k<out.numberofsegments;++k)
+      segments_by_left_node[out.segmentlist[k*2]].push_back(k);
+
     Teuchos::ArrayRCP<int_t> connectivity(out.numberoftriangles*out.numberofcorners); // numberofcorners is num nodes per elem
     for(int_t i=0;i<out.numberoftriangles;++i){
       for (int_t j = 0; j < out.numberofcorners; j++) {
         connectivity[i*out.numberofcorners + j] = out.trianglelist[i * out.numberofcorners + j];
         if(elem_type==DICe::mesh::TRI6){
           // search the connectivity for edge elements and side sets
-          //if(has_dirich_segments||has_neumann_segments){
-          for(int_t k=0;k<out.numberofsegments;++k){
-            if(out.segmentlist[k*2] == out.trianglelist[i*out.numberofcorners + j]){
+          // (only the segments that start at this node are visited, in segment order)
+          std::map<int_t,std::vector<int_t> >::const_iterator seg_it = segments_by_left_node.find(out.trianglelist[i*out.numberofcorners + j]);
+          if(seg_it!=segments_by_left_node.end()){
+            for(size_t ks=0;ks<seg_it->second.size();++ks){
+              const int_t k = seg_it->second[ks];
               for(int_t m=0;m<out.numberofcorners;++m){
                 if(out.segmentlist[k*2+1] == out.trianglelist[i*out.numberofcorners +m]){
                   // now that the element and side are known for boundary nodes add the middle node
@@ -61,7 +61,8 @@ DICE_LIB_DLL_EXPORT
 Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_Type elem_type,
   const std::string & roi_file_name,
   const scalar_t & max_size_constraint,
-  const std::string & output_file_name);
+  const std::string & output_file_name,
+  const std::string & cache_folder="");
 
 DICE_LIB_DLL_EXPORT
 Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_Type elem_type,
@@ -76,7 +77,8 @@ Teuchos::RCP<DICe::mesh::Mesh> generate_tri_mesh(const DICe::mesh::Base_Element_
   const scalar_t & max_size_constraint,
   const std::string & output_file_name,
   const bool enforce_lagrange_bc=false,
-  const bool use_regular_grid=false);
+  const bool use_regular_grid=false,
+  const std::string & cache_folder="");
 
 DICE_LIB_DLL_EXPORT
 Teuchos::RCP<DICe::mesh::Mesh> generate_regular_tri_mesh(const DICe::mesh::Base_Element_Type elem_type,
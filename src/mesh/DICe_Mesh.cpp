@@ -300,6 +300,7 @@ Mesh::Mesh(const std::string & input_filename,
   input_exoid_(-1),
   output_exoid_(-1),
   face_edge_output_exoid_(-1),
+  output_buffer_size_(1),
   input_filename_(input_filename),
   output_filename_(output_filename),
   face_edge_output_filename_("face_edge_" + output_filename),
@@ -307,7 +308,9 @@ Mesh::Mesh(const std::string & input_filename,
   cell_sizes_are_initialized_(false),
   ic_value_x_(0.0),
   ic_value_y_(0.0),
-  is_regular_grid_(false)
+  is_regular_grid_(false),
+  has_flat_data_(false),
+  flat_data_memory_(MEMORY_MESH_FIELDS)
 {
   comm_ = Teuchos::rcp(new MultiField_Comm());
   element_set_ = Teuchos::rcp(new element_set);
@@ -493,6 +496,48 @@ Mesh::create_elem_node_field_maps(const bool force_elem_and_node_maps_to_match){
     // NOTE some will be -1 if they are not locally owned
     node_it->second->update_local_id(scalar_node_dist_map_->get_local_element(node_it->first));
   }
+  // the overlap ids may have changed
+  has_flat_data_ = false;
+}
+
+void
+Mesh::create_flat_data(){
+  DEBUG_MSG("Mesh::create_flat_data(): creating the flat connectivity arrays");
+  TEUCHOS_TEST_FOR_EXCEPTION(scalar_node_overlap_map_==Teuchos::null,std::runtime_error,
+    "Error, the field maps must be created before the flat connectivity");
+  const int_t spa_dim = spatial_dimension();
+  const element_set & elements = *element_set_;
+  const int_t num_elements = elements.size();
+  flat_data_.elem_node_offsets.assign(num_elements+1,0);
+  for(int_t elem=0;elem<num_elements;++elem)
+    flat_data_.elem_node_offsets[elem+1] = flat_data_.elem_node_offsets[elem] + elements[elem]->connectivity()->size();
+  const int_t num_entries = flat_data_.elem_node_offsets[num_elements];
+  flat_data_.elem_node_overlap_ids.resize(num_entries);
+  flat_data_.elem_node_global_ids.resize(num_entries);
+  for(int_t elem=0;elem<num_elements;++elem){
+    const connectivity_vector & connectivity = *elements[elem]->connectivity();
+    const int_t offset = flat_data_.elem_node_offsets[elem];
+    for(size_t nd=0;nd<connectivity.size();++nd){
+      flat_data_.elem_node_overlap_ids[offset+nd] = connectivity[nd]->overlap_local_id();
+      flat_data_.elem_node_global_ids[offset+nd] = connectivity[nd]->global_id();
+    }
+  }
+  // the coordinates are stored as separate x and y arrays rather than interleaved like the field
+  flat_data_.node_x.clear();
+  flat_data_.node_y.clear();
+  if(spa_dim>=2&&field_registry_.find(field_enums::INITIAL_COORDINATES_FS)!=field_registry_.end()){
+    Teuchos::ArrayRCP<const scalar_t> coords = get_overlap_field(field_enums::INITIAL_COORDINATES_FS)->get_1d_view();
+    const int_t num_overlap_nodes = scalar_node_overlap_map_->get_num_local_elements();
+    flat_data_.node_x.resize(num_overlap_nodes);
+    flat_data_.node_y.resize(num_overlap_nodes);
+    for(int_t i=0;i<num_overlap_nodes;++i){
+      flat_data_.node_x[i] = coords[i*spa_dim+0];
+      flat_data_.node_y[i] = coords[i*spa_dim+1];
+    }
+  }
+  flat_data_memory_.set(flat_data_.num_bytes());
+  // if the coordinates field doesn't exist yet the arrays are built again on the next call
+  has_flat_data_ = spa_dim<2||!flat_data_.node_x.empty();
 }
 
 void
@@ -667,6 +712,38 @@ Teuchos::RCP<Shape_Function_Evaluator> Shape_Function_Evaluator_Factory::create(
   }
 }
 
+void
+Shape_Function_Evaluator::evaluate_shape_functions_at_points(const int_t num_points,
+  const int_t num_natural_coords,
+  const scalar_t * natural_coords,
+  scalar_t * shape_function_values,
+  scalar_t * shape_function_derivative_values){
+  const int_t num_derivatives = num_functions_*num_natural_coords;
+  for(int_t pt=0;pt<num_points;++pt){
+    evaluate_shape_functions(&natural_coords[pt*num_natural_coords],&shape_function_values[pt*num_functions_]);
+    evaluate_shape_function_derivatives(&natural_coords[pt*num_natural_coords],&shape_function_derivative_values[pt*num_derivatives]);
+  }
+}
+
+/// Evaluates the shape functions and derivatives at a set of points with the sizes known at compile time,
+/// the qualified calls to the evaluator methods are not virtual so they can be inlined
+template<class Evaluator, int_t num_funcs, int_t num_nat_coords>
+void
+evaluate_shape_functions_at_points(Evaluator & evaluator,
+  const int_t num_points,
+  const int_t num_natural_coords,
+  const scalar_t * natural_coords,
+  scalar_t * shape_function_values,
+  scalar_t * shape_function_derivative_values){
+  TEUCHOS_TEST_FOR_EXCEPTION(num_natural_coords!=num_nat_coords,std::runtime_error,
+    "Error, invalid number of natural coordinates " << num_natural_coords << " (should be " << num_nat_coords << ")");
+  for(int_t pt=0;pt<num_points;++pt){
+    evaluator.Evaluator::evaluate_shape_functions(&natural_coords[pt*num_nat_coords],&shape_function_values[pt*num_funcs]);
+    evaluator.Evaluator::evaluate_shape_function_derivatives(&natural_coords[pt*num_nat_coords],
+      &shape_function_derivative_values[pt*num_funcs*num_nat_coords]);
+  }
+}
+
 
 bool
 Mesh::field_exists(const std::string & field_name){
@@ -835,8 +912,28 @@ Mesh::get_overlap_field(const field_enums::Field_Spec & field_spec)
     oss << " MG_Mesh::get_overlap_field(): unknown rank and tensor order combination specified: " << DICe::tostring(field_spec.get_rank()) << " " << DICe::tostring(field_spec.get_field_type()) << std::endl;
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
   }
-  const Teuchos::RCP<MultiField > to_field = field_import(field_spec,map);
-  return to_field;
+  requested_overlap_fields_.insert(field_spec);
+  TEUCHOS_TEST_FOR_EXCEPTION(field_registry_.find(field_spec)==field_registry_.end(),std::invalid_argument,
+    "Error, MG_Mesh::get_overlap_field(): could not find the field: " << field_spec.get_name_label());
+  Teuchos::RCP<MultiField> from_field = field_registry_.find(field_spec)->second;
+  // the overlap field and importer are built the first time and again only if the field or map is replaced
+  Overlap_Field & overlap = overlap_fields_[field_spec];
+  if(overlap.overlap_field_==Teuchos::null||overlap.from_field_!=from_field||overlap.to_map_!=map){
+    overlap.overlap_field_ = Teuchos::rcp(new MultiField(map,1,true));
+    overlap.from_field_ = from_field;
+    overlap.to_map_ = map;
+    overlap.exporter_ = Teuchos::null;
+  }
+  std::map<field_enums::Field_Spec,Teuchos::RCP<MultiField> >::const_iterator exchanged_it = exchanged_overlap_fields_.find(field_spec);
+  if(exchanged_it!=exchanged_overlap_fields_.end()){
+    // the values were already exchanged, no communication is needed
+    overlap.overlap_field_->update(1.0,*exchanged_it->second,0.0);
+    return overlap.overlap_field_;
+  }
+  if(overlap.exporter_==Teuchos::null)
+    overlap.exporter_ = Teuchos::rcp(new MultiField_Exporter(*map,*from_field->get_map()));
+  overlap.overlap_field_->do_import(from_field,*overlap.exporter_);
+  return overlap.overlap_field_;
 }
 
 Teuchos::RCP<MultiField>
@@ -1407,6 +1504,16 @@ CVFEM_Linear_Tet4::evaluate_shape_functions(const scalar_t * nodal_coords,
   TEUCHOS_TEST_FOR_EXCEPTION(std::abs(sum_volume - coefficient)>1E-3,std::logic_error,"Areas do not sum to total subelem area.");// + oss.str());
 }
 
+void
+FEM_Linear_Hex8::evaluate_shape_functions_at_points(const int_t num_points,
+  const int_t num_natural_coords,
+  const scalar_t * natural_coords,
+  scalar_t * shape_function_values,
+  scalar_t * shape_function_derivative_values){
+  DICe::mesh::evaluate_shape_functions_at_points<FEM_Linear_Hex8,8,3>(*this,num_points,num_natural_coords,natural_coords,
+    shape_function_values,shape_function_derivative_values);
+}
+
 bool
 CVFEM_Linear_Tet4::is_in_element(const scalar_t * nodal_coords,
   const scalar_t * point_coords,
@@ -1542,6 +1649,16 @@ CVFEM_Linear_Tet4::evaluate_shape_function_derivatives(const scalar_t * nodal_co
   shape_function_derivative_values[11] = 1.0*cross[2]/coefficient_times_6;
 }
 
+void
+FEM_Linear_Quad4::evaluate_shape_functions_at_points(const int_t num_points,
+  const int_t num_natural_coords,
+  const scalar_t * natural_coords,
+  scalar_t * shape_function_values,
+  scalar_t * shape_function_derivative_values){
+  DICe::mesh::evaluate_shape_functions_at_points<FEM_Linear_Quad4,4,2>(*this,num_points,num_natural_coords,natural_coords,
+    shape_function_values,shape_function_derivative_values);
+}
+
 bool
 FEM_Linear_Hex8::is_in_element(const scalar_t * nodal_coords,
   const scalar_t * point_coords,
@@ -1665,6 +1782,16 @@ FEM_Linear_Hex8::evaluate_shape_function_derivatives(const scalar_t * natural_co
 
 }
 
+void
+FEM_Linear_Tri3::evaluate_shape_functions_at_points(const int_t num_points,
+  const int_t num_natural_coords,
+  const scalar_t * natural_coords,
+  scalar_t * shape_function_values,
+  scalar_t * shape_function_derivative_values){
+  DICe::mesh::evaluate_shape_functions_at_points<FEM_Linear_Tri3,3,2>(*this,num_points,num_natural_coords,natural_coords,
+    shape_function_values,shape_function_derivative_values);
+}
+
 bool
 FEM_Linear_Quad4::is_in_element(const scalar_t * nodal_coords,
   const scalar_t * point_coords,
@@ -1723,6 +1850,16 @@ FEM_Linear_Quad4::evaluate_shape_function_derivatives(const scalar_t * natural_c
 }
 
 
+void
+FEM_Quadratic_Tri6::evaluate_shape_functions_at_points(const int_t num_points,
+  const int_t num_natural_coords,
+  const scalar_t * natural_coords,
+  scalar_t * shape_function_values,
+  scalar_t * shape_function_derivative_values){
+  DICe::mesh::evaluate_shape_functions_at_points<FEM_Quadratic_Tri6,6,2>(*this,num_points,num_natural_coords,natural_coords,
+    shape_function_values,shape_function_derivative_values);
+}
+
 bool
 FEM_Linear_Tri3::is_in_element(const scalar_t * nodal_coords,
   const scalar_t * point_coords,
@@ -1765,6 +1902,16 @@ FEM_Linear_Tri3::evaluate_shape_function_derivatives(const scalar_t * natural_co
   shape_function_derivative_values[2*spa_dim+1] = 1;
 }
 
+void
+FEM_Barycentric_Tri6::evaluate_shape_functions_at_points(const int_t num_points,
+  const int_t num_natural_coords,
+  const scalar_t * natural_coords,
+  scalar_t * shape_function_values,
+  scalar_t * shape_function_derivative_values){
+  DICe::mesh::evaluate_shape_functions_at_points<FEM_Barycentric_Tri6,6,3>(*this,num_points,num_natural_coords,natural_coords,
+    shape_function_values,shape_function_derivative_values);
+}
+
 bool
 FEM_Quadratic_Tri6::is_in_element(const scalar_t * nodal_coords,
   const scalar_t * point_coords,
@@ -46,6 +46,7 @@
 #include <DICe_MeshEnums.h>
 #include <DICe_FieldEnums.h>
 #include <DICe_Parser.h>
+#include <DICe_MemoryTracker.h>
 #ifdef DICE_TPETRA
   #include "DICe_MultiFieldTpetra.h"
 #else
@@ -55,6 +56,8 @@
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_ParameterList.hpp>
 
+#include <set>
+
 namespace DICe{
 /*!
  *  \namespace DICe::mesh
@@ -734,6 +737,49 @@ typedef std::vector<Teuchos::RCP<DICe::mesh::Internal_Cell> > internal_cell_set;
 /// typedef
 typedef std::map<int_t,Teuchos::RCP<DICe::mesh::Node> > node_set;
 
+/// \brief Flat (structure of arrays) copy of the element to node connectivity and the node coordinates
+///
+/// The object graph of the mesh is convenient for building the mesh, but the assembly loops only need the
+/// node ids of each element and the node coordinates. The nodes of element e (in element set order) are
+/// stored from elem_node_offsets[e] to elem_node_offsets[e+1]-1 in the id arrays.
+/// The coordinates are indexed by the overlap local id of the node.
+struct Flat_Mesh_Data{
+  /// offsets of the first node of each element (size num elements + 1)
+  std::vector<int_t> elem_node_offsets;
+  /// overlap local ids of the element nodes
+  std::vector<int_t> elem_node_overlap_ids;
+  /// global ids of the element nodes
+  std::vector<int_t> elem_node_global_ids;
+  /// initial x coordinates of the nodes by overlap local id
+  std::vector<scalar_t> node_x;
+  /// initial y coordinates of the nodes by overlap local id
+  std::vector<scalar_t> node_y;
+  /// returns the number of elements
+  int_t num_elem()const{
+    return elem_node_offsets.empty() ? 0 : elem_node_offsets.size() - 1;
+  }
+  /// returns the number of nodes of an element
+  /// \param elem the element index in the element set
+  int_t num_elem_nodes(const int_t elem)const{
+    return elem_node_offsets[elem+1] - elem_node_offsets[elem];
+  }
+  /// returns a pointer to the overlap local ids of the nodes of an element
+  /// \param elem the element index in the element set
+  const int_t * elem_nodes(const int_t elem)const{
+    return &elem_node_overlap_ids[elem_node_offsets[elem]];
+  }
+  /// returns a pointer to the global ids of the nodes of an element
+  /// \param elem the element index in the element set
+  const int_t * elem_node_gids(const int_t elem)const{
+    return &elem_node_global_ids[elem_node_offsets[elem]];
+  }
+  /// returns the number of bytes held by the arrays
+  long long num_bytes()const{
+    return (long long)(elem_node_offsets.size()+elem_node_overlap_ids.size()+elem_node_global_ids.size())*sizeof(int_t) +
+        (long long)(node_x.size()+node_y.size())*sizeof(scalar_t);
+  }
+};
+
 /// Holds information for side sets in the mesh
 struct side_set_info
 {
@@ -784,6 +830,30 @@ struct side_set_info
   }
 };
 
+/// Values of one exodus output variable for one time step that have not been written yet
+struct exodus_output_var
+{
+  /// true for an element variable, false for a nodal variable
+  bool is_element_var;
+  /// exodus index of the variable
+  int_t var_index;
+  /// block id (only used for element variables)
+  int_t block_id;
+  /// the values for each node or element in the block
+  std::vector<float> values;
+};
+
+/// A time step of exodus output that has not been written yet
+struct exodus_output_step
+{
+  /// time step number
+  int_t time_step_num;
+  /// time value
+  float time_value;
+  /// the variables for this step
+  std::vector<exodus_output_var> vars;
+};
+
 /// \class Mesh
 /// \brief The discretization used by the pysics classes.
 ///
@@ -860,6 +930,24 @@ public:
     face_edge_output_exoid_ = id;
   }
 
+  /// \brief Sets the number of time steps of exodus output held in memory before they are written
+  /// (1 writes each step right away, see DICe::mesh::flush_exodus_output)
+  /// \param num_steps the number of steps
+  void set_output_buffer_size(const int_t num_steps){
+    TEUCHOS_TEST_FOR_EXCEPTION(num_steps<1,std::runtime_error,"Error, the output buffer size must be at least 1");
+    output_buffer_size_ = num_steps;
+  }
+
+  /// Returns the number of time steps of exodus output held in memory before they are written
+  int_t get_output_buffer_size()const{
+    return output_buffer_size_;
+  }
+
+  /// Returns a pointer to the exodus output steps that have not been written yet
+  std::vector<exodus_output_step> * get_output_buffer(){
+    return &output_buffer_;
+  }
+
   /// Returns the name of the input mesh (already decorated for multiple processors)
   std::string get_input_filename()const{
     return input_filename_;
@@ -943,10 +1031,31 @@ public:
   field_enums::Field_Spec get_field_spec(const std::string & field_name,
     const field_enums::Field_State state = field_enums::NO_FIELD_STATE);
 
-  /// this will actually do the import, create a new field that has the overlap values and return a pointer to that field
+  /// \brief imports the overlap values of a field and returns a pointer to the overlap field
+  /// The overlap field and the importer are kept by the mesh for each field spec and refreshed in place
+  /// on every call, so the returned field is overwritten by the next call for the same field spec
   /// \param field_spec the field_spec defines the field to get
   Teuchos::RCP<MultiField> get_overlap_field(const field_enums::Field_Spec & field_spec);
 
+  /// \brief stores an overlap field that was already assembled (by a non-blocking exchange) so that get_overlap_field()
+  /// returns a copy of it rather than communicating, until clear_exchanged_overlap_fields() is called
+  /// \param field_spec the field_spec of the distributed field
+  /// \param overlap_field the overlap values of the field
+  void set_exchanged_overlap_field(const field_enums::Field_Spec & field_spec,
+    const Teuchos::RCP<MultiField> & overlap_field){
+    exchanged_overlap_fields_[field_spec] = overlap_field;
+  }
+
+  /// removes the overlap fields stored by set_exchanged_overlap_field()
+  void clear_exchanged_overlap_fields(){
+    exchanged_overlap_fields_.clear();
+  }
+
+  /// returns the specs of all the fields that have been requested from get_overlap_field()
+  const std::set<field_enums::Field_Spec> & requested_overlap_fields()const{
+    return requested_overlap_fields_;
+  }
+
   /// Returns a vector of stings of the field names
   /// \param entity_rank The rank that filters which fields are returned
   /// \param field_type Differentiates between vector and scalar fields
@@ -1162,6 +1271,16 @@ public:
     return subelement_sets_by_block_[block_id];
   }
 
+  /// \brief Returns the flat connectivity and coordinate arrays (see DICe::mesh::Flat_Mesh_Data)
+  ///
+  /// The arrays are built on the first call after the field maps and the initial coordinates
+  /// field were created, so the first call must not be made from inside a parallel region.
+  const Flat_Mesh_Data & get_flat_data(){
+    if(!has_flat_data_)
+      create_flat_data();
+    return flat_data_;
+  }
+
   /// Returns nodes on this processor sorted by block
   /// \param block_id The requested block
   Teuchos::RCP<node_set> get_node_set(const int_t block_id){
@@ -1509,6 +1628,10 @@ private:
   int_t output_exoid_;
   /// face edge output file exodus id
   int_t face_edge_output_exoid_;
+  /// number of exodus output steps held in memory before they are written
+  int_t output_buffer_size_;
+  /// exodus output steps that have not been written yet
+  std::vector<exodus_output_step> output_buffer_;
   /// input mesh file name (already decorated for multiple processors)
   std::string input_filename_;
   /// output mesh file name (already decorated for multiple processors)
@@ -1555,6 +1678,23 @@ private:
   Teuchos::RCP<MultiField_Map> vector_subelem_dist_map_;
   /// Registry that holds all the mesh fields
   field_registry field_registry_;
+  /// overlap fields that were already exchanged (returned by get_overlap_field() instead of communicating)
+  std::map<field_enums::Field_Spec,Teuchos::RCP<MultiField> > exchanged_overlap_fields_;
+  /// specs of the fields requested from get_overlap_field()
+  std::set<field_enums::Field_Spec> requested_overlap_fields_;
+  /// the persistent overlap field of a field spec and the importer that fills it
+  struct Overlap_Field{
+    /// the overlap values
+    Teuchos::RCP<MultiField> overlap_field_;
+    /// the distributed field the importer was built for
+    Teuchos::RCP<MultiField> from_field_;
+    /// the overlap map the importer was built for
+    Teuchos::RCP<MultiField_Map> to_map_;
+    /// importer from the distributed field to the overlap field
+    Teuchos::RCP<MultiField_Exporter> exporter_;
+  };
+  /// overlap fields returned by get_overlap_field() (rebuilt if the field or the overlap map is replaced)
+  std::map<field_enums::Field_Spec,Overlap_Field> overlap_fields_;
   /// True if the control volume fields have been initialized
   bool control_volumes_are_initialized_;
   /// True if the cell size field has been populated
@@ -1575,6 +1715,14 @@ private:
   scalar_t ic_value_y_;
   /// true if this mesh is a regular grid
   bool is_regular_grid_;
+  /// builds the flat connectivity and coordinate arrays from the element set
+  void create_flat_data();
+  /// flat copy of the connectivity and coordinates
+  Flat_Mesh_Data flat_data_;
+  /// true if the flat arrays are up to date
+  bool has_flat_data_;
+  /// bytes held by the flat arrays
+  Tracked_Memory flat_data_memory_;
 };
 
 /// \class Shape_Function_Evaluator
@@ -1636,6 +1784,20 @@ public:
   virtual void evaluate_shape_function_derivatives(const scalar_t * natural_coords,
     scalar_t * shape_function_derivative_values)=0;
 
+  /// Evaluation of the shape functions and derivatives at a set of points in one call
+  /// (the FEM evaluators override this so the points are evaluated without a virtual call per point)
+  /// \param num_points the number of points
+  /// \param num_natural_coords the number of natural coordinates per point
+  /// \param natural_coords the natural coords of the points, num_natural_coords values per point
+  /// \param shape_function_values array of num_points*num_functions() values, the values for each point are contiguous
+  /// \param shape_function_derivative_values array of num_points*num_functions()*num_natural_coords values, the derivatives
+  /// for each point are contiguous and laid out as they are for evaluate_shape_function_derivatives()
+  virtual void evaluate_shape_functions_at_points(const int_t num_points,
+    const int_t num_natural_coords,
+    const scalar_t * natural_coords,
+    scalar_t * shape_function_values,
+    scalar_t * shape_function_derivative_values);
+
   /// Determine if a given point is inside the element or external
   /// \param point_coords The test point location
   /// \param nodal_coords The corrdinates of the nodes for this element
@@ -1798,6 +1960,13 @@ public:
   virtual void evaluate_shape_function_derivatives(const scalar_t * natural_coords,
     scalar_t * shape_function_derivative_values);
 
+  /// see base class documentation
+  virtual void evaluate_shape_functions_at_points(const int_t num_points,
+    const int_t num_natural_coords,
+    const scalar_t * natural_coords,
+    scalar_t * shape_function_values,
+    scalar_t * shape_function_derivative_values);
+
   /// See base class documentation
   virtual bool is_in_element(const scalar_t * nodal_coords,
     const scalar_t * point_coords,
@@ -1845,6 +2014,13 @@ public:
   virtual void evaluate_shape_function_derivatives(const scalar_t * natural_coords,
     scalar_t * shape_function_derivative_values);
 
+  /// see base class documentation
+  virtual void evaluate_shape_functions_at_points(const int_t num_points,
+    const int_t num_natural_coords,
+    const scalar_t * natural_coords,
+    scalar_t * shape_function_values,
+    scalar_t * shape_function_derivative_values);
+
   /// See base class documentation
   virtual bool is_in_element(const scalar_t * nodal_coords,
     const scalar_t * point_coords,
@@ -1892,6 +2068,13 @@ public:
   virtual void evaluate_shape_function_derivatives(const scalar_t * natural_coords,
     scalar_t * shape_function_derivative_values);
 
+  /// see base class documentation
+  virtual void evaluate_shape_functions_at_points(const int_t num_points,
+    const int_t num_natural_coords,
+    const scalar_t * natural_coords,
+    scalar_t * shape_function_values,
+    scalar_t * shape_function_derivative_values);
+
   /// See base class documentation
   virtual bool is_in_element(const scalar_t * nodal_coords,
     const scalar_t * point_coords,
@@ -1940,6 +2123,13 @@ public:
   virtual void evaluate_shape_function_derivatives(const scalar_t * natural_coords,
     scalar_t * shape_function_derivative_values);
 
+  /// see base class documentation
+  virtual void evaluate_shape_functions_at_points(const int_t num_points,
+    const int_t num_natural_coords,
+    const scalar_t * natural_coords,
+    scalar_t * shape_function_values,
+    scalar_t * shape_function_derivative_values);
+
   /// See base class documentation
   virtual bool is_in_element(const scalar_t * nodal_coords,
     const scalar_t * point_coords,
@@ -1987,6 +2177,13 @@ public:
   virtual void evaluate_shape_function_derivatives(const scalar_t * natural_coords,
     scalar_t * shape_function_derivative_values);
 
+  /// see base class documentation
+  virtual void evaluate_shape_functions_at_points(const int_t num_points,
+    const int_t num_natural_coords,
+    const scalar_t * natural_coords,
+    scalar_t * shape_function_values,
+    scalar_t * shape_function_derivative_values);
+
   /// See base class documentation
   virtual bool is_in_element(const scalar_t * nodal_coords,
     const scalar_t * point_coords,
@@ -44,6 +44,12 @@
 #include <boost/algorithm/string.hpp>
 #include <exodusII.h>
 
+#include <exception>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 #ifdef HAVE_MPI
 #  include <mpi.h>
 #endif
@@ -157,11 +163,14 @@ Teuchos::RCP<Mesh> read_exodus_mesh(const std::string & serial_input_filename,
   error_int = ex_get_node_num_map(input_exoid, node_map);
   TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::logic_error,"ex_get_node_num_map(): Failure");
 
-  // put all the nodes in the mesh
+  // put all the nodes in the mesh, the nodes are also kept by exodus index so the
+  // connectivity can be resolved without searching the node set
+  std::vector<Teuchos::RCP<Node> > nodes_by_index(num_nodes);
+  DICe::mesh::node_set & mesh_nodes = *mesh->get_node_set();
   for(int_t i =0;i<num_nodes;++i)
   {
-    Teuchos::RCP<Node> node_rcp = Teuchos::rcp(new DICe::mesh::Node(node_map[i],i));
-    mesh->get_node_set()->insert(std::pair<int_t,Teuchos::RCP<Node> >(node_rcp->global_id(),node_rcp));
+    nodes_by_index[i] = Teuchos::rcp(new DICe::mesh::Node(node_map[i],i));
+    mesh_nodes.insert(mesh_nodes.end(),std::pair<int_t,Teuchos::RCP<Node> >(node_map[i],nodes_by_index[i]));
   }
 
   char elem_type_str[MAX_STR_LENGTH + 1];
@@ -204,21 +213,16 @@ Teuchos::RCP<Mesh> read_exodus_mesh(const std::string & serial_input_filename,
     //  error() << "ex_get_elem_conn(): Failure" << std::endl;
     //  exit(1);
     //}
+    mesh->get_element_set()->reserve(mesh->get_element_set()->size()+num_elem_in_block[i]);
+    connectivity_vector conn(num_nodes_per_elem[i]);
     for(int_t j=0; j<num_elem_in_block[i]; ++j)
     {
-      connectivity_vector conn;
       for(int_t k=0;k<num_nodes_per_elem[i];++k)
       {
-        const int_t global_node_id = node_map[connectivity[j*num_nodes_per_elem[i] + k] - 1];
-        // find the node in the set with the same global id
-        bool found_node = false;
-        if(mesh->get_node_set()->find(global_node_id)!=mesh->get_node_set()->end()){
-          found_node = true;
-          conn.push_back(mesh->get_node_set()->find(global_node_id)->second);
-        }
-        else{
-          TEUCHOS_TEST_FOR_EXCEPTION(!found_node,std::logic_error,"Could not find node rcp in set");
-        }
+        // exodus node indices are one based
+        const int_t node_index = connectivity[j*num_nodes_per_elem[i] + k] - 1;
+        TEUCHOS_TEST_FOR_EXCEPTION(node_index<0||node_index>=num_nodes,std::logic_error,"Could not find node rcp in set");
+        conn[k] = nodes_by_index[node_index];
       }
       // create an element and put it in the mesh
       const int_t elem_global_id = elem_map[elem_local_id];
@@ -243,35 +247,20 @@ Teuchos::RCP<Mesh> read_exodus_mesh(const std::string & serial_input_filename,
   }
 
   // put the element blocks in a field so they are accessible in parallel from other processors
+  // TODO: do the same for faces/edges
+  // the elements are sorted into their blocks in one pass
+  std::map<int_t,Teuchos::RCP<element_set> > & elem_sets_by_block = *mesh->get_element_sets_by_block();
   block_type_map::iterator blk_map_it = mesh->get_block_type_map()->begin();
   block_type_map::iterator blk_map_end = mesh->get_block_type_map()->end();
   for(;blk_map_it!=blk_map_end;++blk_map_it)
   {
-    // TODO: do the same for faces/edges
     Teuchos::RCP<element_set> elem_set = Teuchos::rcp(new element_set);
-//    Teuchos::RCP<node_set> node_set_ptr = Teuchos::rcp(new node_set);
-//    node_set & node_set_ref = *node_set_ptr;
-    for(elem_it=mesh->get_element_set()->begin();elem_it!=elem_end;++elem_it)
-    {
-      if(elem_it->get()->block_id()==blk_map_it->first)
-      {
-        elem_set->push_back(*elem_it);
-//        const DICe::mesh::connectivity_vector & connectivity = *elem_it->get()->connectivity();
-//        for(size_t node_it=0;node_it<connectivity.size();++node_it)
-//        {
-//          // check if the node is already there:
-//          bool not_found = true;
-//          for(size_t i=0;i<node_set_ptr->size();++i)
-//          {
-//            if(node_set_ref[i]==connectivity[node_it]) not_found = false;
-//          }
-//          if(not_found) node_set_ptr->push_back(connectivity[node_it]);
-//        }
-      }
-    }
-    mesh->get_element_sets_by_block()->insert(std::pair<int_t,Teuchos::RCP<element_set> >(blk_map_it->first,elem_set));
-//    mesh->get_node_sets_by_block()->insert(std::pair<int_t,Teuchos::RCP<node_set> >(blk_map_it->first,node_set_ptr));
+    for(int_t j=0;j<num_elem_blk;++j)
+      if(block_ids[j]==blk_map_it->first) elem_set->reserve(num_elem_in_block[j]);
+    elem_sets_by_block.insert(std::pair<int_t,Teuchos::RCP<element_set> >(blk_map_it->first,elem_set));
   }
+  for(elem_it=mesh->get_element_set()->begin();elem_it!=elem_end;++elem_it)
+    elem_sets_by_block.find(elem_it->get()->block_id())->second->push_back(*elem_it);
 
 //#ifdef DICE_DEBUG_MSG
 //    std::cout << " THESE ARE THE SIZES (nodes):" << std::endl;
@@ -482,16 +471,10 @@ std::vector<scalar_t>
 read_exodus_field(const std::string & file_name,
   const std::string & field_name,
   const int_t step){
-
-  std::vector<std::string> field_names = DICe::mesh::read_exodus_field_names(file_name);
-  int_t var_index = -1;
-  for(size_t i=0;i<field_names.size();++i){
-    if(field_names[i]==field_name){
-      var_index = i+1;
-    }
-  }
-  TEUCHOS_TEST_FOR_EXCEPTION(var_index<=0,std::runtime_error,"Error, field not found in mesh: " << field_name);
-  return read_exodus_field(file_name,var_index,step);
+  Exodus_Field_Reader reader(file_name);
+  std::vector<scalar_t> result;
+  reader.read(reader.var_index(field_name),step,result);
+  return result;
 }
 
 DICE_LIB_DLL_EXPORT
@@ -507,38 +490,117 @@ std::vector<scalar_t>
 read_exodus_field(const std::string & file_name,
   const int_t var_index,
   const int_t step){
-  TEUCHOS_TEST_FOR_EXCEPTION(step==0,std::runtime_error,"Invalid step (<=0): " << step);
-  const int_t num_steps = read_exodus_num_steps(file_name);
-  TEUCHOS_TEST_FOR_EXCEPTION(step>num_steps,std::runtime_error,"Invalid step (>num_steps): " << step);
+  Exodus_Field_Reader reader(file_name);
+  std::vector<scalar_t> result;
+  reader.read(var_index,step,result);
+  return result;
+}
+
+Exodus_Field_Reader::Exodus_Field_Reader(const std::string & file_name):
+  file_name_(file_name),
+  exoid_(-1),
+  num_nodes_(0),
+  num_steps_(0){
   float version;
   int_t CPU_word_size = 0;
   int_t IO_word_size = 0;
-  /*open exodus II file */
   std::vector<char> writable(file_name.size() + 1);
   std::copy(file_name.begin(), file_name.end(), writable.begin());
-  //const char * file_name = analysis_model->input_file_name().c_str();
-  const int input_exoid = ex_open(&writable[0],EX_READ,&CPU_word_size,&IO_word_size,&version);
-  if (input_exoid < 0)
+  exoid_ = ex_open(&writable[0],EX_READ,&CPU_word_size,&IO_word_size,&version);
+  if (exoid_ < 0)
   {
     std::stringstream oss;
     oss << "Reading mesh failure: " << file_name;
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
   }
-  // get the number of nodes
   float ret_float = 0.0;
   char ret_char;
   int num_nodes = 0;
-  ex_inquire(input_exoid, EX_INQ_NODES, &num_nodes, &ret_float, &ret_char);
-  DEBUG_MSG("read_exodus_field(): number of nodes " << num_nodes);
+  ex_inquire(exoid_,EX_INQ_NODES,&num_nodes,&ret_float,&ret_char);
+  num_nodes_ = num_nodes;
+  int num_steps = 0;
+  ex_inquire(exoid_,EX_INQ_TIME,&num_steps,&ret_float,&ret_char);
+  num_steps_ = num_steps;
+  int_t num_node_vars = 0;
+  ex_get_var_param(exoid_,"n",&num_node_vars);
+  for(int_t i=1;i<=num_node_vars;++i){ // exodus is one based
+    char nodal_var_name[100];
+    ex_get_var_name(exoid_,"n",i,&nodal_var_name[0]);
+    field_names_.push_back(std::string(nodal_var_name));
+  }
+  ex_buffer_.resize(num_nodes_);
+  DEBUG_MSG("Exodus_Field_Reader::Exodus_Field_Reader(): " << file_name << " num nodes " << num_nodes_ <<
+    " num steps " << num_steps_ << " num nodal fields " << num_node_vars);
+}
+
+Exodus_Field_Reader::~Exodus_Field_Reader(){
+  if(exoid_>=0)
+    ex_close(exoid_);
+}
 
-  float * ex_result = new float[num_nodes];
-  std::vector<scalar_t> result(num_nodes,0.0);
-  ex_get_nodal_var(input_exoid,step,var_index,result.size(),&ex_result[0]);
-  for(int_t i=0;i<num_nodes;++i){
-    result[i] = ex_result[i];
+int_t
+Exodus_Field_Reader::var_index(const std::string & field_name)const{
+  for(size_t i=0;i<field_names_.size();++i){
+    if(field_names_[i]==field_name)
+      return i+1;
   }
-  delete [] ex_result;
-  ex_close(input_exoid);
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, field not found in mesh: " << field_name);
+  return -1;
+}
+
+void
+Exodus_Field_Reader::read(const int_t var_index,
+  const int_t step,
+  scalar_t * values){
+  TEUCHOS_TEST_FOR_EXCEPTION(step<=0,std::runtime_error,"Invalid step (<=0): " << step);
+  TEUCHOS_TEST_FOR_EXCEPTION(step>num_steps_,std::runtime_error,"Invalid step (>num_steps): " << step);
+  TEUCHOS_TEST_FOR_EXCEPTION(var_index<=0||var_index>(int_t)field_names_.size(),std::runtime_error,
+    "Invalid var_index: " << var_index);
+  if(num_nodes_==0) return;
+  const int error = ex_get_nodal_var(exoid_,step,var_index,num_nodes_,&ex_buffer_[0]);
+  TEUCHOS_TEST_FOR_EXCEPTION(error<0,std::runtime_error,"Error, reading field " << field_names_[var_index-1] <<
+    " at step " << step << " failed for file " << file_name_);
+  for(int_t i=0;i<num_nodes_;++i)
+    values[i] = ex_buffer_[i];
+}
+
+void
+Exodus_Field_Reader::read(const int_t var_index,
+  const int_t step,
+  std::vector<scalar_t> & values){
+  values.resize(num_nodes_);
+  if(num_nodes_>0)
+    read(var_index,step,&values[0]);
+}
+
+void
+Exodus_Field_Reader::read_steps(const std::vector<int_t> & var_indices,
+  const int_t first_step,
+  const int_t last_step,
+  std::vector<scalar_t> & values){
+  TEUCHOS_TEST_FOR_EXCEPTION(last_step<first_step,std::runtime_error,"Invalid step range: " << first_step << " to " << last_step);
+  const int_t num_range_steps = last_step - first_step + 1;
+  values.resize(var_indices.size()*num_range_steps*num_nodes_);
+  if(values.empty()) return;
+  for(size_t f=0;f<var_indices.size();++f){
+    for(int_t step=first_step;step<=last_step;++step){
+      read(var_indices[f],step,&values[(f*num_range_steps + step-first_step)*num_nodes_]);
+    }
+  }
+}
+
+DICE_LIB_DLL_EXPORT
+std::vector<scalar_t>
+read_exodus_field_history(const std::string & file_name,
+  const std::vector<std::string> & field_names,
+  const int_t first_step,
+  const int_t last_step){
+  Exodus_Field_Reader reader(file_name);
+  std::vector<int_t> var_indices(field_names.size());
+  for(size_t i=0;i<field_names.size();++i)
+    var_indices[i] = reader.var_index(field_names[i]);
+  std::vector<scalar_t> result;
+  reader.read_steps(var_indices,first_step,last_step<0?reader.num_steps():last_step,result);
   return result;
 }
 
@@ -685,13 +747,14 @@ read_exodus_coordinates(Teuchos::RCP<Mesh> mesh){
   TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::logic_error,"ex_get_coord(): Failure");
 
   // put coords in a tpetra vector
+  mv_scalar_type * initial_coords_values = initial_coords->local_values();
   for(int_t i=0;i<num_nodes;++i)  // i represents the local_id
   {
-    initial_coords->local_value(i*spa_dim+0) = temp_x[i];
-    initial_coords->local_value(i*spa_dim+1) = temp_y[i];
+    initial_coords_values[i*spa_dim+0] = temp_x[i];
+    initial_coords_values[i*spa_dim+1] = temp_y[i];
     if (num_dim >= 3)
     {
-      initial_coords->local_value(i*spa_dim+2) = temp_z[i];
+      initial_coords_values[i*spa_dim+2] = temp_z[i];
     }
   }
   delete[] temp_x;
@@ -712,24 +775,25 @@ read_exodus_coordinates(Teuchos::RCP<Mesh> mesh){
   MultiField & initial_cell_coords = *mesh->get_field(field_enums::INITIAL_CELL_COORDINATES_FS);
 
   //compute the centroid from the coordinates of the nodes;
+  const mv_scalar_type * coords_values = coords->local_values();
+  mv_scalar_type * cell_coords_values = initial_cell_coords.local_values();
   DICe::mesh::element_set::const_iterator elem_it = mesh->get_element_set()->begin();
   DICe::mesh::element_set::const_iterator elem_end = mesh->get_element_set()->end();
   for(;elem_it!=elem_end;++elem_it)
   {
     const DICe::mesh::connectivity_vector & connectivity = *elem_it->get()->connectivity();
     assert(connectivity.size()!=0);
-    std::vector<scalar_t> centroid(num_dim);
-    for(int_t i=0;i<num_dim;++i) centroid[i]=0.0;
+    scalar_t centroid[3] = {0.0,0.0,0.0};
     for(size_t node_it=0;node_it<connectivity.size();++node_it)
     {
-      const Teuchos::RCP<DICe::mesh::Node> node = connectivity[node_it];
-      centroid[0] += coords->local_value(node.get()->overlap_local_id()*spa_dim+0);
-      centroid[1] += coords->local_value(node.get()->overlap_local_id()*spa_dim+1);
+      const int_t node_id = connectivity[node_it].get()->overlap_local_id();
+      centroid[0] += coords_values[node_id*spa_dim+0];
+      centroid[1] += coords_values[node_id*spa_dim+1];
     }
     for(int_t dim=0;dim<num_dim;++dim)
     {
       centroid[dim] /= connectivity.size();
-      initial_cell_coords.local_value(elem_it->get()->local_id()*spa_dim+dim) = centroid[dim];
+      cell_coords_values[elem_it->get()->local_id()*spa_dim+dim] = centroid[dim];
     }
   }
   //std::cout << " INITIAL CELL COORDS: " << std::endl;
@@ -1058,6 +1122,52 @@ void create_output_exodus_file(Teuchos::RCP<Mesh> mesh,
   delete[] dist_fact;
 }
 
+/// returns the exodus variable names for the fields of the given rank in the order of the variable indices
+static std::vector<std::string>
+exodus_var_names(Teuchos::RCP<Mesh> mesh,
+  const field_enums::Entity_Rank rank,
+  const bool ignore_dimension,
+  const bool only_printable)
+{
+  const int_t spatial_dimension = mesh->spatial_dimension();
+  // this needs to be improved... right now the exodusII file does not differente between scalars and vectors for the variable names
+  // so we have to concatinate the list like this:
+  std::vector<std::string> scalar_fields = mesh->get_field_names(rank,field_enums::SCALAR_FIELD_TYPE,only_printable);
+  std::vector<std::string> vector_fields = mesh->get_field_names(rank,field_enums::VECTOR_FIELD_TYPE,only_printable);
+  int_t num_scalar_variables = scalar_fields.size();
+  int_t num_vector_variables = vector_fields.size();
+  std::vector<std::string> var_names;
+  for (int_t i = 0; i < num_scalar_variables; ++i)
+  {
+    var_names.push_back(scalar_fields[i]);
+  }
+  for (int_t i = 0; i < num_vector_variables; ++i)
+  {
+    var_names.push_back(vector_fields[i] + "_X");
+    var_names.push_back(vector_fields[i] + "_Y");
+    if (spatial_dimension > 2 || ignore_dimension) var_names.push_back(vector_fields[i] + "_Z");
+  }
+  return var_names;
+}
+
+/// returns the index of a variable in a list from exodus_var_names() (-1 if the variable is not in the list)
+static int_t
+exodus_var_index(const std::vector<std::string> & var_names,
+  const std::string & name,
+  const std::string & component)
+{
+  std::string comp = "";
+  if (component != "") comp = "_" + component;
+  boost::to_upper(comp);
+  // rip through the list looking for the specified field which is broken down by component
+  for (size_t i = 0; i < var_names.size(); ++i)
+  {
+    if (var_names[i] == name + comp)
+    return i + 1;
+  }
+  return -1;
+}
+
 DICE_LIB_DLL_EXPORT
 void
 exodus_output_dump(Teuchos::RCP<Mesh> mesh,
@@ -1065,9 +1175,16 @@ exodus_output_dump(Teuchos::RCP<Mesh> mesh,
   const float & time_value)
 {
   DEBUG_MSG("exodus_output_dump(): time_step_num: " << time_step_num << " time: " << time_value);
-  int error_int = 0;
-  error_int = ex_put_time(mesh->get_output_exoid(), time_step_num, &time_value);
-  TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::logic_error,"ex_put_time(): Failure " << error_int);
+  // the values are copied into the output buffer and written by flush_exodus_output() once
+  // enough steps have been collected, so several steps share one ex_update
+  std::vector<exodus_output_step> & buffer = *mesh->get_output_buffer();
+  buffer.push_back(exodus_output_step());
+  exodus_output_step & step = buffer.back();
+  step.time_step_num = time_step_num;
+  step.time_value = time_value;
+  // look up the variable indices once per step rather than once per variable
+  const std::vector<std::string> element_var_names = exodus_var_names(mesh,field_enums::ELEMENT_RANK,false,true);
+  const std::vector<std::string> nodal_var_names = exodus_var_names(mesh,field_enums::NODE_RANK,false,true);
 
   // write fields
   DICe::mesh::field_registry::iterator field_it = mesh->get_field_registry()->begin();
@@ -1094,41 +1211,44 @@ exodus_output_dump(Teuchos::RCP<Mesh> mesh,
         {
           const int_t num_elements = mesh->num_elem_in_block(block_type_map_it->first);
           if(num_elements==0) continue;
-          float * values = new float[num_elements];
+          step.vars.push_back(exodus_output_var());
+          exodus_output_var & var = step.vars.back();
+          var.is_element_var = true;
+          var.block_id = block_type_map_it->first;
+          var.var_index = exodus_var_index(element_var_names, DICe::tostring(field_it->first.get_name()), components[comp]);
+          var.values.resize(num_elements);
           DICe::mesh::element_set::const_iterator elem_it = mesh->get_element_set()->begin();
           DICe::mesh::element_set::const_iterator elem_end = mesh->get_element_set()->end();
           for(;elem_it!=elem_end;++elem_it)
           {
             if(elem_it->get()->block_id()!=block_type_map_it->first)continue; // filter out the elements not from this block
-            values[elem_it->get()->index_in_block()] = field.local_value(elem_it->get()->local_id()*num_comps+comp);  // this may not work since the elements are in a set rather than a vector, may have to re-order them
+            var.values[elem_it->get()->index_in_block()] = field.local_value(elem_it->get()->local_id()*num_comps+comp);  // this may not work since the elements are in a set rather than a vector, may have to re-order them
           }
-          const int_t var_index = get_var_index(mesh, DICe::tostring(field_it->first.get_name()), components[comp], field_it->first.get_rank());
-          error_int = ex_put_elem_var(mesh->get_output_exoid(), time_step_num, var_index, block_type_map_it->first, mesh->num_elem_in_block(block_type_map_it->first),values);
-          TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::logic_error,"Failure ex_put_elem_var(): " + DICe::tostring(field_it->first.get_name()));
-          delete [] values;
         }
       }
     }
     else if(field_it->first.get_rank()==field_enums::NODE_RANK)
     {
       Teuchos::RCP<MultiField > field = mesh->get_overlap_field(field_it->first);
-      float * values = new float[mesh->num_nodes()];
       std::string components[3];
       components[0] = (field_it->first.get_field_type()==field_enums::VECTOR_FIELD_TYPE) ? "X" : "";
       components[1] = "Y";
       components[2] = "Z";
       for (int_t comp = 0; comp < num_comps; ++comp)
       {
+        step.vars.push_back(exodus_output_var());
+        exodus_output_var & var = step.vars.back();
+        var.is_element_var = false;
+        var.block_id = -1;
+        var.var_index = exodus_var_index(nodal_var_names, DICe::tostring(field_it->first.get_name()), components[comp]);
+        var.values.resize(mesh->num_nodes());
         DICe::mesh::node_set::const_iterator node_it = mesh->get_node_set()->begin();
         DICe::mesh::node_set::const_iterator node_end = mesh->get_node_set()->end();
         for(;node_it!=node_end;++node_it)
         {
-          values[node_it->second->overlap_local_id()] = field->local_value(node_it->second->overlap_local_id()*num_comps+comp);
+          var.values[node_it->second->overlap_local_id()] = field->local_value(node_it->second->overlap_local_id()*num_comps+comp);
         }
-        const int_t var_index = get_var_index(mesh, DICe::tostring(field_it->first.get_name()), components[comp], field_it->first.get_rank());
-        error_int = ex_put_nodal_var(mesh->get_output_exoid(), time_step_num, var_index,mesh->num_nodes(), values);
       }
-      delete [] values;
     }
 //    else
 //    {
@@ -1137,7 +1257,36 @@ exodus_output_dump(Teuchos::RCP<Mesh> mesh,
 //      TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
 //    }
   }
-  error_int = ex_update(mesh->get_output_exoid());
+  if((int_t)buffer.size()>=mesh->get_output_buffer_size())
+    flush_exodus_output(mesh);
+}
+
+DICE_LIB_DLL_EXPORT
+void
+flush_exodus_output(Teuchos::RCP<Mesh> mesh)
+{
+  std::vector<exodus_output_step> & buffer = *mesh->get_output_buffer();
+  if(buffer.empty()) return;
+  DEBUG_MSG("flush_exodus_output(): writing " << buffer.size() << " step(s)");
+  const int output_exoid = mesh->get_output_exoid();
+  int error_int = 0;
+  for(size_t i=0;i<buffer.size();++i){
+    exodus_output_step & step = buffer[i];
+    error_int = ex_put_time(output_exoid, step.time_step_num, &step.time_value);
+    TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::logic_error,"ex_put_time(): Failure " << error_int);
+    for(size_t j=0;j<step.vars.size();++j){
+      exodus_output_var & var = step.vars[j];
+      if(var.is_element_var){
+        error_int = ex_put_elem_var(output_exoid, step.time_step_num, var.var_index, var.block_id, var.values.size(), &var.values[0]);
+        TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::logic_error,"Failure ex_put_elem_var(): variable index " << var.var_index);
+      }
+      else if(!var.values.empty()){
+        error_int = ex_put_nodal_var(output_exoid, step.time_step_num, var.var_index, var.values.size(), &var.values[0]);
+      }
+    }
+  }
+  buffer.clear();
+  error_int = ex_update(output_exoid);
   TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::logic_error,"ex_update(): Failure");
 }
 
@@ -1205,40 +1354,13 @@ get_var_index(Teuchos::RCP<Mesh> mesh,
   const bool ignore_dimension,
   const bool only_printable)
 {
-  std::string comp = "";
-  if (component != "") comp = "_" + component;
-  boost::to_upper(comp);
-  const int_t spatial_dimension = mesh->spatial_dimension();
-  // this needs to be improved... right now the exodusII file does not differente between scalars and vectors for the variable names
-  // so we have to concatinate the list like this:
-  std::vector<std::string> scalar_fields = mesh->get_field_names(rank,field_enums::SCALAR_FIELD_TYPE,only_printable);
-  std::vector<std::string> vector_fields = mesh->get_field_names(rank,field_enums::VECTOR_FIELD_TYPE,only_printable);
-  int_t num_scalar_variables = scalar_fields.size();
-  int_t num_vector_variables = vector_fields.size();
-  std::vector<std::string> var_names;
-  for (int_t i = 0; i < num_scalar_variables; ++i)
-  {
-    var_names.push_back(scalar_fields[i]);
-  }
-  for (int_t i = 0; i < num_vector_variables; ++i)
-  {
-    var_names.push_back(vector_fields[i] + "_X");
-    var_names.push_back(vector_fields[i] + "_Y");
-    if (spatial_dimension > 2 || ignore_dimension) var_names.push_back(vector_fields[i] + "_Z");
-  }
-  // rip through the list looking for the specified field which is broken down by component
-  for (size_t i = 0; i < var_names.size(); ++i)
-  {
-    //cout << " This is a var name: " << var_names[i] << std::endl;
-    if (var_names[i] == name + comp)
-    return i + 1;
-  }
-  return -1;
+  return exodus_var_index(exodus_var_names(mesh,rank,ignore_dimension,only_printable),name,component);
 }
 
 DICE_LIB_DLL_EXPORT
 void
 close_exodus_output(Teuchos::RCP<Mesh> mesh){
+  flush_exodus_output(mesh);
   ex_close(mesh->get_output_exoid());
 }
 
@@ -2320,7 +2442,8 @@ tetra4_volume(Teuchos::ArrayRCP<const scalar_t> coords_values,
 
 DICE_LIB_DLL_EXPORT
 void
-create_cell_size_and_radius(Teuchos::RCP<Mesh> mesh)
+create_cell_size_and_radius(Teuchos::RCP<Mesh> mesh,
+  const int_t num_threads)
 {
   if(mesh->cell_sizes_are_initialized())return;
   // create the cell_coords, cell_radius and cell_size fields:
@@ -2329,43 +2452,65 @@ create_cell_size_and_radius(Teuchos::RCP<Mesh> mesh)
 
   Teuchos::RCP<MultiField > coords = mesh->get_overlap_field(field_enums::INITIAL_COORDINATES_FS);
   Teuchos::ArrayRCP<const scalar_t> coords_values = coords->get_1d_view();
-  DICe::mesh::element_set::const_iterator elem_it = mesh->get_element_set()->begin();
-  DICe::mesh::element_set::const_iterator elem_end = mesh->get_element_set()->end();
-  for(;elem_it!=elem_end;++elem_it)
+  // the elements are independent so they are processed concurrently using raw pointers
+  // (the reference counts of the mesh objects are not thread safe)
+  const scalar_t * coords_ptr = coords_values.get();
+  mv_scalar_type * cell_size = mesh->get_field(field_enums::INITIAL_CELL_SIZE_FS)->local_values();
+  mv_scalar_type * cell_radius = mesh->get_field(field_enums::INITIAL_CELL_RADIUS_FS)->local_values();
+  const DICe::mesh::element_set & elements = *mesh->get_element_set();
+  const block_type_map & block_types = *mesh->get_block_type_map();
+  std::exception_ptr elem_error;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) schedule(static) if(num_threads>1)
+#endif
+  for(int_t i=0;i<(int_t)elements.size();++i)
   {
-    // switch on element type
-    const Teuchos::RCP<DICe::mesh::Element> elem = *elem_it;
-    // switch on element type
-    const Base_Element_Type elem_type = mesh->get_block_type_map()->find(elem.get()->block_id())->second;
-    if(elem_type == HEX8)
-      hex8_volume_radius(mesh,coords_values,elem);
-    else if(elem_type == TETRA4 || elem_type == TETRA)  // FIXME: we should only accept tetra4, tetra is a poor selection in cubit
-      tetra4_volume_radius(mesh,coords_values,elem);
-    else if(elem_type == PYRAMID5)
-      pyramid5_volume_radius(mesh,coords_values,elem);
-    else if(elem_type == QUAD4)
-      quad4_area_radius(mesh,coords_values,elem);
-    else if(elem_type == TRI3)
-      tri3_area_radius(mesh,coords_values,elem);
-    else
-    {
-      std::stringstream oss;
-      oss << "create_cell_size_and_radius(): unknown element type: " << tostring(elem_type) << std::endl;
-      TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
+    try{
+      const DICe::mesh::Element & elem = *elements[i].get();
+      // switch on element type
+      const Base_Element_Type elem_type = block_types.find(elem.block_id())->second;
+      scalar_t size = 0.0;
+      scalar_t radius = 0.0;
+      if(elem_type == HEX8)
+        hex8_volume_radius(coords_ptr,elem,size,radius);
+      else if(elem_type == TETRA4 || elem_type == TETRA)  // FIXME: we should only accept tetra4, tetra is a poor selection in cubit
+        tetra4_volume_radius(coords_ptr,elem,size,radius);
+      else if(elem_type == PYRAMID5)
+        pyramid5_volume_radius(coords_ptr,elem,size,radius);
+      else if(elem_type == QUAD4)
+        quad4_area_radius(coords_ptr,elem,size,radius);
+      else if(elem_type == TRI3)
+        tri3_area_radius(coords_ptr,elem,size,radius);
+      else
+      {
+        std::stringstream oss;
+        oss << "create_cell_size_and_radius(): unknown element type: " << tostring(elem_type) << std::endl;
+        TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
+      }
+      cell_size[elem.local_id()] = size;
+      cell_radius[elem.local_id()] = radius;
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_cell_size_error)
+#endif
+      {
+        if(!elem_error) elem_error = std::current_exception();
+      }
     }
   }
+  if(elem_error) std::rethrow_exception(elem_error);
   mesh->set_cell_sizes_are_initialized();
 }
 
 DICE_LIB_DLL_EXPORT
 void
-hex8_volume_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element)
+hex8_volume_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & volume,
+  scalar_t & radius)
 {
-  MultiField & cell_size = *mesh->get_field(field_enums::INITIAL_CELL_SIZE_FS);
-  MultiField & cell_radius = *mesh->get_field(field_enums::INITIAL_CELL_RADIUS_FS);
-  const DICe::mesh::connectivity_vector & connectivity = *element.get()->connectivity();
+  const DICe::mesh::connectivity_vector & connectivity = *element.connectivity();
 
   // this is translated from the sphgen3d fortran code
   const int_t num_nodes = connectivity.size();
@@ -2376,19 +2521,13 @@ hex8_volume_radius(Teuchos::RCP<Mesh> mesh,
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
   }
 
-  std::vector<scalar_t> x(num_nodes);
-  for(int_t i=0;i<num_nodes;++i) x[i]=0.0;
-  std::vector<scalar_t> y(num_nodes);
-  for(int_t i=0;i<num_nodes;++i) y[i]=0.0;
-  std::vector<scalar_t> z(num_nodes);
-  for(int_t i=0;i<num_nodes;++i) z[i]=0.0;
+  scalar_t x[8], y[8], z[8];
 
   //std::stringstream oss;
   //oss << " ELEMENT: " << element->global_id() << std::endl;
   for(size_t node_it=0;node_it<connectivity.size();++node_it)
   {
-    const Teuchos::RCP<DICe::mesh::Node> node = connectivity[node_it];
-    const int_t stride = node.get()->overlap_local_id();
+    const int_t stride = connectivity[node_it].get()->overlap_local_id();
     x[node_it] = coords_values[stride*3+0];
     y[node_it] = coords_values[stride*3+1];
     z[node_it] = coords_values[stride*3+2];
@@ -2428,22 +2567,18 @@ hex8_volume_radius(Teuchos::RCP<Mesh> mesh,
   const scalar_t Z47 = z[3] - z[6];
   const scalar_t Z54 = z[4] - z[3];
   const scalar_t G8 = ( y[6]*(z[2]-z[5]-Z54) + y[5]*Z75 + y[4]*(z[5]-z[0]-Z47) + y[3]*(z[0]-z[2]-Z75) + y[2]*Z47 + y[0]*Z54 ) / 12.0;
-  const scalar_t volume = x[0] * G1 + x[1] * G2 + x[2] * G3 + x[3] * G4 + x[4] * G5 + x[5] * G6 + x[6] * G7 + x[7] * G8;
-  const scalar_t radius = std::pow(volume,1.0/3.0) * 0.5;
-
-  cell_size.local_value(element.get()->local_id()) = volume;
-  cell_radius.local_value(element.get()->local_id()) = radius;
+  volume = x[0] * G1 + x[1] * G2 + x[2] * G3 + x[3] * G4 + x[4] * G5 + x[5] * G6 + x[6] * G7 + x[7] * G8;
+  radius = std::pow(volume,1.0/3.0) * 0.5;
 }
 
 DICE_LIB_DLL_EXPORT
 void
-tetra4_volume_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element)
+tetra4_volume_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & volume,
+  scalar_t & radius)
 {
-  MultiField & cell_size = *mesh->get_field(field_enums::INITIAL_CELL_SIZE_FS);
-  MultiField & cell_radius = *mesh->get_field(field_enums::INITIAL_CELL_RADIUS_FS);
-  const DICe::mesh::connectivity_vector & connectivity = *element.get()->connectivity();
+  const DICe::mesh::connectivity_vector & connectivity = *element.connectivity();
 
   // this is translated from the sphgen3d fortran code
   const int_t num_nodes = connectivity.size();
@@ -2453,26 +2588,28 @@ tetra4_volume_radius(Teuchos::RCP<Mesh> mesh,
     oss << "tetra4_volume_radius(): the connectivity does not have the right number of nodes: " << num_nodes << std::endl;
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
   }
-  const Teuchos::RCP<DICe::mesh::Node> node_A = connectivity[0];
-  const Teuchos::RCP<DICe::mesh::Node> node_B = connectivity[1];
-  const Teuchos::RCP<DICe::mesh::Node> node_C = connectivity[2];
-  const Teuchos::RCP<DICe::mesh::Node> node_D = connectivity[3];
-  const scalar_t volume = tetra4_volume(coords_values,node_A,node_B,node_C,node_D);
-  scalar_t radius = std::pow(volume,1.0/3.0) * 0.5;
-
-  cell_size.local_value(element.get()->local_id()) = volume;
-  cell_radius.local_value(element.get()->local_id()) = radius;
+  // same determinant as tetra4_volume()
+  scalar_t a[4*4];
+  for (int_t j = 0; j < 4; j++ )
+  {
+    const int_t stride = connectivity[j].get()->overlap_local_id();
+    a[0+j*4] = coords_values[stride*3+(j+0)%3];
+    a[1+j*4] = coords_values[stride*3+(j+1)%3];
+    a[2+j*4] = coords_values[stride*3+(j+2)%3];
+    a[3+j*4] = 1.0;
+  }
+  volume = std::abs(determinant_4x4(&a[0])) / 6.0;
+  radius = std::pow(volume,1.0/3.0) * 0.5;
 }
 
 DICE_LIB_DLL_EXPORT
 void
-pyramid5_volume_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element)
+pyramid5_volume_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & volume,
+  scalar_t & radius)
 {
-  MultiField & cell_size = *mesh->get_field(field_enums::INITIAL_CELL_SIZE_FS);
-  MultiField & cell_radius = *mesh->get_field(field_enums::INITIAL_CELL_RADIUS_FS);
-  const DICe::mesh::connectivity_vector & connectivity = *element.get()->connectivity();
+  const DICe::mesh::connectivity_vector & connectivity = *element.connectivity();
 
   const int_t num_nodes = connectivity.size();
   if(num_nodes!=5)
@@ -2483,30 +2620,23 @@ pyramid5_volume_radius(Teuchos::RCP<Mesh> mesh,
   }
 
   scalar_t A[3], B[3], C[3], D[3], E[3];
-  Teuchos::RCP<DICe::mesh::Node> node;
-
-  node = connectivity[0];
-  int_t stride = node.get()->overlap_local_id();
+  int_t stride = connectivity[0].get()->overlap_local_id();
   A[0] = coords_values[stride*3+0];
   A[1] = coords_values[stride*3+1];
   A[2] = coords_values[stride*3+2];
-  node = connectivity[1];
-  stride = node.get()->overlap_local_id();
+  stride = connectivity[1].get()->overlap_local_id();
   B[0] = coords_values[stride*3+0];
   B[1] = coords_values[stride*3+1];
   B[2] = coords_values[stride*3+2];
-  node = connectivity[2];
-  stride = node.get()->overlap_local_id();
+  stride = connectivity[2].get()->overlap_local_id();
   C[0] = coords_values[stride*3+0];
   C[1] = coords_values[stride*3+1];
   C[2] = coords_values[stride*3+2];
-  node = connectivity[3];
-  stride = node.get()->overlap_local_id();
+  stride = connectivity[3].get()->overlap_local_id();
   D[0] = coords_values[stride*3+0];
   D[1] = coords_values[stride*3+1];
   D[2] = coords_values[stride*3+2];
-  node = connectivity[4];
-  stride = node.get()->overlap_local_id();
+  stride = connectivity[4].get()->overlap_local_id();
   E[0] = coords_values[stride*3+0];
   E[1] = coords_values[stride*3+1];
   E[2] = coords_values[stride*3+2];
@@ -2534,22 +2664,18 @@ pyramid5_volume_radius(Teuchos::RCP<Mesh> mesh,
   height = std::abs(height);
   //cout << "Element: " << element.global_id() << " area " << area << " coeff_a " << coeff_a << " coeff_b " << coeff_b << " coeff_c " << coeff_c  << " coeff_d " << coeff_d << " hegiht " << height << std::endl;
 
-  scalar_t volume = 1.0/3.0 * area * height;
-  const scalar_t radius = std::pow(volume,1.0/3.0) * 0.5;
-
-  cell_size.local_value(element.get()->local_id()) = volume;
-  cell_radius.local_value(element.get()->local_id()) = radius;
+  volume = 1.0/3.0 * area * height;
+  radius = std::pow(volume,1.0/3.0) * 0.5;
 }
 
 DICE_LIB_DLL_EXPORT
 void
-quad4_area_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element)
+quad4_area_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & area,
+  scalar_t & radius)
 {
-  MultiField & cell_size = *mesh->get_field(field_enums::INITIAL_CELL_SIZE_FS);
-  MultiField & cell_radius = *mesh->get_field(field_enums::INITIAL_CELL_RADIUS_FS);
-  const DICe::mesh::connectivity_vector & connectivity = *element.get()->connectivity();
+  const DICe::mesh::connectivity_vector & connectivity = *element.connectivity();
 
   const int_t num_nodes = connectivity.size();
   if(num_nodes!=4)
@@ -2560,26 +2686,20 @@ quad4_area_radius(Teuchos::RCP<Mesh> mesh,
   }
 
   scalar_t A[2], B[2], C[2], D[2];
-  Teuchos::RCP<DICe::mesh::Node> node;
-
-  node = connectivity[0];
-  int_t stride = node.get()->overlap_local_id();
+  int_t stride = connectivity[0].get()->overlap_local_id();
   A[0] = coords_values[stride*2+0];
   A[1] = coords_values[stride*2+1];
-  node = connectivity[1];
-  stride = node.get()->overlap_local_id();
+  stride = connectivity[1].get()->overlap_local_id();
   B[0] = coords_values[stride*2+0];
   B[1] = coords_values[stride*2+1];
-  node = connectivity[2];
-  stride = node.get()->overlap_local_id();
+  stride = connectivity[2].get()->overlap_local_id();
   C[0] = coords_values[stride*2+0];
   C[1] = coords_values[stride*2+1];
-  node = connectivity[3];
-  stride = node.get()->overlap_local_id();
+  stride = connectivity[3].get()->overlap_local_id();
   D[0] = coords_values[stride*2+0];
   D[1] = coords_values[stride*2+1];
 
-  scalar_t area = 0.0;
+  area = 0.0;
 
   // split into two triangles and sum cross products
   scalar_t cross_prod = cross(&A[0],&B[0],&D[0]);
@@ -2587,21 +2707,17 @@ quad4_area_radius(Teuchos::RCP<Mesh> mesh,
   cross_prod = cross(&C[0],&B[0],&D[0]);
   area += 0.5 * std::abs(cross_prod);
 
-  const scalar_t radius = std::sqrt(area/3.14159265358979323846264338327950288);
-
-  cell_size.local_value(element.get()->local_id()) = area;
-  cell_radius.local_value(element.get()->local_id()) = radius;
+  radius = std::sqrt(area/3.14159265358979323846264338327950288);
 }
 
 DICE_LIB_DLL_EXPORT
 void
-tri3_area_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element)
+tri3_area_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & area,
+  scalar_t & radius)
 {
-  MultiField & cell_size = *mesh->get_field(field_enums::INITIAL_CELL_SIZE_FS);
-  MultiField & cell_radius = *mesh->get_field(field_enums::INITIAL_CELL_RADIUS_FS);
-  const DICe::mesh::connectivity_vector & connectivity = *element.get()->connectivity();
+  const DICe::mesh::connectivity_vector & connectivity = *element.connectivity();
 
   const int_t num_nodes = connectivity.size();
   if(num_nodes!=3)
@@ -2610,16 +2726,16 @@ tri3_area_radius(Teuchos::RCP<Mesh> mesh,
     oss << "tri3_area_radius(): the connectivity does not have the right number of nodes: " << num_nodes << std::endl;
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,oss.str());
   }
-  Teuchos::RCP<DICe::mesh::Node> node_A, node_B, node_C;
-  node_A = connectivity[0];
-  node_B = connectivity[1];
-  node_C = connectivity[2];
-
-  const scalar_t area = tri3_area(coords_values,node_A,node_B,node_C);
-  const scalar_t radius = std::sqrt(area/3.14159265358979323846264338327950288);
-
-  cell_size.local_value(element.get()->local_id()) = area;
-  cell_radius.local_value(element.get()->local_id()) = radius;
+  // same cross product as tri3_area()
+  scalar_t A[2], B[2], C[2];
+  A[0] = coords_values[connectivity[0].get()->overlap_local_id()*2+0];
+  A[1] = coords_values[connectivity[0].get()->overlap_local_id()*2+1];
+  B[0] = coords_values[connectivity[1].get()->overlap_local_id()*2+0];
+  B[1] = coords_values[connectivity[1].get()->overlap_local_id()*2+1];
+  C[0] = coords_values[connectivity[2].get()->overlap_local_id()*2+0];
+  C[1] = coords_values[connectivity[2].get()->overlap_local_id()*2+1];
+  area = 0.5 * std::abs(cross(&A[0],&B[0],&C[0]));
+  radius = std::sqrt(area/3.14159265358979323846264338327950288);
 }
 
 } // mesh
@@ -131,6 +131,104 @@ read_exodus_field(
   const std::string & field_name,
   const int_t step);
 
+/// \class DICe::mesh::Exodus_Field_Reader
+/// \brief Keeps an exodus file open to stream nodal field values step by step
+///
+/// The file is opened once and the field names, number of nodes and number of steps
+/// are read once so that reading many steps or fields does not pay the cost of
+/// opening the file and looking up the field for every call to read_exodus_field.
+/// Memory is bounded by the buffer the caller passes in (one step of one field for read(),
+/// or a window of steps and fields for read_steps()).
+class DICE_LIB_DLL_EXPORT
+Exodus_Field_Reader{
+public:
+  /// Constructor
+  /// \param file_name the exodus file to read
+  Exodus_Field_Reader(const std::string & file_name);
+
+  /// Destructor, closes the file
+  ~Exodus_Field_Reader();
+
+  /// returns the number of steps in the file
+  int_t num_steps()const{
+    return num_steps_;
+  }
+
+  /// returns the number of nodes in the file
+  int_t num_nodes()const{
+    return num_nodes_;
+  }
+
+  /// returns the nodal field names
+  const std::vector<std::string> & field_names()const{
+    return field_names_;
+  }
+
+  /// returns the (one based) exodus variable index for the given field, throws if not found
+  /// \param field_name the name of the field
+  int_t var_index(const std::string & field_name)const;
+
+  /// Read the nodal values of one field at one step
+  /// \param var_index the (one based) variable index of the field
+  /// \param step the (one based) step number
+  /// \param values pointer to storage for num_nodes() values
+  void read(const int_t var_index,
+    const int_t step,
+    scalar_t * values);
+
+  /// Read the nodal values of one field at one step, resizing values to num_nodes()
+  /// \param var_index the (one based) variable index of the field
+  /// \param step the (one based) step number
+  /// \param values the vector to populate
+  void read(const int_t var_index,
+    const int_t step,
+    std::vector<scalar_t> & values);
+
+  /// Read a range of steps for several fields into one contiguous buffer
+  /// laid out as [field][step][node], i.e. the value for field f, step s and node n is at
+  /// ((f*(last_step-first_step+1) + s-first_step)*num_nodes() + n)
+  /// \param var_indices the (one based) variable indices of the fields
+  /// \param first_step the first (one based) step to read
+  /// \param last_step the last (one based) step to read (inclusive)
+  /// \param values the buffer to populate (resized as needed)
+  void read_steps(const std::vector<int_t> & var_indices,
+    const int_t first_step,
+    const int_t last_step,
+    std::vector<scalar_t> & values);
+
+private:
+  /// not copyable since it owns the file handle
+  Exodus_Field_Reader(const Exodus_Field_Reader &);
+  /// not copyable since it owns the file handle
+  Exodus_Field_Reader & operator=(const Exodus_Field_Reader &);
+  /// the name of the file
+  std::string file_name_;
+  /// the exodus file id
+  int exoid_;
+  /// number of nodes in the file
+  int_t num_nodes_;
+  /// number of steps in the file
+  int_t num_steps_;
+  /// nodal field names
+  std::vector<std::string> field_names_;
+  /// reusable single precision buffer for the exodus reads
+  std::vector<float> ex_buffer_;
+};
+
+/// Returns the history of several nodal fields over a range of steps in one contiguous buffer
+/// laid out as [field][step][node] (see Exodus_Field_Reader::read_steps)
+/// \param file_name the name of the exodus file
+/// \param field_names the names of the requested fields
+/// \param first_step the first (one based) step to read
+/// \param last_step the last (one based) step to read (inclusive), -1 reads to the end of the file
+DICE_LIB_DLL_EXPORT
+std::vector<scalar_t>
+read_exodus_field_history(
+  const std::string & file_name,
+  const std::vector<std::string> & field_names,
+  const int_t first_step=1,
+  const int_t last_step=-1);
+
 /// Create an exodus output file
 /// \param mesh The mesh to use for this function
 /// \param output_folder The name of the output folder
@@ -162,6 +260,9 @@ int_t get_var_index(Teuchos::RCP<Mesh> mesh,
   const bool only_printable=true);
 
 /// Write a time step to the exodus file
+///
+/// If the mesh output buffer size is larger than one (see Mesh::set_output_buffer_size) the
+/// step is held in memory and the buffered steps are written together once the buffer is full
 /// \param mesh The mesh to use for this function
 /// \param time_step_num The time step number NOTE: has to be 1 or greater or exodus will throw an error
 /// \param time_value The time for this step
@@ -179,7 +280,12 @@ void exodus_face_edge_output_dump(Teuchos::RCP<Mesh> mesh,
   const int_t & time_step_num,
   const float & time_value);
 
-/// Close the exodus file
+/// Write the buffered time steps to the exodus file (no op if there are none)
+/// \param mesh The mesh to use for this function
+DICE_LIB_DLL_EXPORT
+void flush_exodus_output(Teuchos::RCP<Mesh> mesh);
+
+/// Close the exodus file (the buffered time steps are written first)
 /// \param mesh The mesh to use for this function
 DICE_LIB_DLL_EXPORT
 void close_exodus_output(Teuchos::RCP<Mesh> mesh);
@@ -328,53 +434,65 @@ scalar_t tetra4_volume(Teuchos::ArrayRCP<const scalar_t> coords_values,
 
 /// Compute the volume and radius of each element
 /// \param mesh The computational mesh
-DICE_LIB_DLL_EXPORT
-void create_cell_size_and_radius(Teuchos::RCP<Mesh> mesh);
-
-/// Compute a specific elemnet type size
-/// \param mesh the mesh
-/// \param coords_values Array with the coordinate values
-/// \param element Pointer to the particular element
-DICE_LIB_DLL_EXPORT
-void hex8_volume_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element>  element);
-
-/// Compute a specific elemnet type size
-/// \param mesh the mesh
-/// \param coords_values Array with the coordinate values
-/// \param element Pointer to the particular element
-DICE_LIB_DLL_EXPORT
-void tetra4_volume_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element>  element);
-
-/// Compute a specific elemnet type size
-/// \param mesh the mesh
-/// \param coords_values Array with the coordinate values
-/// \param element Pointer to the particular element
-DICE_LIB_DLL_EXPORT
-void quad4_area_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element);
-
-/// Compute a specific elemnet type size
-/// \param mesh the mesh
-/// \param coords_values Array with the  coordinate values
-/// \param element Pointer to the particular element
-DICE_LIB_DLL_EXPORT
-void tri3_area_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element);
-
-/// Compute a specific elemnet type size
-/// \param mesh the mesh
-/// \param coords_values Array with the coordinate values
-/// \param element Pointer to the particular element
-DICE_LIB_DLL_EXPORT
-void pyramid5_volume_radius(Teuchos::RCP<Mesh> mesh,
-  Teuchos::ArrayRCP<const scalar_t> coords_values,
-  const Teuchos::RCP<DICe::mesh::Element> element);
+/// \param num_threads number of threads used to process the elements
+DICE_LIB_DLL_EXPORT
+void create_cell_size_and_radius(Teuchos::RCP<Mesh> mesh,
+  const int_t num_threads=1);
+
+/// Compute a specific elemnet type size (safe to call from multiple threads)
+/// \param coords_values the overlap coordinate values
+/// \param element the particular element
+/// \param volume [out] the volume of the element
+/// \param radius [out] the radius of the element
+DICE_LIB_DLL_EXPORT
+void hex8_volume_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & volume,
+  scalar_t & radius);
+
+/// Compute a specific elemnet type size (safe to call from multiple threads)
+/// \param coords_values the overlap coordinate values
+/// \param element the particular element
+/// \param volume [out] the volume of the element
+/// \param radius [out] the radius of the element
+DICE_LIB_DLL_EXPORT
+void tetra4_volume_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & volume,
+  scalar_t & radius);
+
+/// Compute a specific elemnet type size (safe to call from multiple threads)
+/// \param coords_values the overlap coordinate values
+/// \param element the particular element
+/// \param area [out] the area of the element
+/// \param radius [out] the radius of the element
+DICE_LIB_DLL_EXPORT
+void quad4_area_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & area,
+  scalar_t & radius);
+
+/// Compute a specific elemnet type size (safe to call from multiple threads)
+/// \param coords_values the overlap coordinate values
+/// \param element the particular element
+/// \param area [out] the area of the element
+/// \param radius [out] the radius of the element
+DICE_LIB_DLL_EXPORT
+void tri3_area_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & area,
+  scalar_t & radius);
+
+/// Compute a specific elemnet type size (safe to call from multiple threads)
+/// \param coords_values the overlap coordinate values
+/// \param element the particular element
+/// \param volume [out] the volume of the element
+/// \param radius [out] the radius of the element
+DICE_LIB_DLL_EXPORT
+void pyramid5_volume_radius(const scalar_t * coords_values,
+  const DICe::mesh::Element & element,
+  scalar_t & volume,
+  scalar_t & radius);
 
 } //mesh
 } //DICe
@@ -360,8 +360,9 @@ Importer_Projector::read_vector_field(const std::string & file_name,
     // exodus file
   else if(file_name.find(exo_ext)){
     DEBUG_MSG("Importer_Projector::read_vector_field(): reading vector field from DICe exodus results file: " << file_name);
-    field_x = read_exodus_field(file_name,field_name_x,step+1);
-    field_y = read_exodus_field(file_name,field_name_y,step+1);
+    Exodus_Field_Reader reader(file_name);
+    reader.read(reader.var_index(field_name_x),step+1,field_x);
+    reader.read(reader.var_index(field_name_y),step+1,field_y);
   }
   else{
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, unrecognized file format " << file_name);
@@ -43,16 +43,20 @@
 #include <Teuchos_RCP.hpp>
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 #include "netcdf.h"
 
 namespace DICe {
 namespace netcdf {
 
+/// upper bound on the chunk cache set for the data variable (bytes)
+const static size_t max_chunk_cache_size = 256*1024*1024;
+
 void
-NetCDF_Reader::get_image_dimensions(const std::string & file_name,
-  int_t & width,
-  int_t & height,
-  int_t & num_time_steps){
+NetCDF_Reader::open(const std::string & file_name){
+  if(ncid_>=0&&file_name==file_name_) return;
+  close();
 
   int error_int = 0;
 
@@ -62,17 +66,16 @@ NetCDF_Reader::get_image_dimensions(const std::string & file_name,
   TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::runtime_error,"Error, could not open NetCDF file " << file_name);
   // acquire the dimensions of the file
   int num_data_dims = 0;
-  height = -1;
-  width = -1;
-  num_time_steps = 0;
+  int_t height = -1;
+  int_t width = -1;
+  int_t num_time_steps = 0;
   nc_inq_ndims(ncid, &num_data_dims);
-  DEBUG_MSG("NetCDF_Reader::get_image(): number of data dimensions: " <<  num_data_dims);
+  DEBUG_MSG("NetCDF_Reader::open(): number of data dimensions: " <<  num_data_dims);
   for(int_t i=0;i<num_data_dims;++i){
-    char var_name[100];
+    char var_name[NC_MAX_NAME+1];
     size_t length = 0;
     nc_inq_dim(ncid,i,&var_name[0],&length);
-    std::string var_name_str = var_name;
-    DEBUG_MSG("NetCDF_Reader::get_image(): found dimension " << var_name << " of size " << length);
+    DEBUG_MSG("NetCDF_Reader::open(): found dimension " << var_name << " of size " << length);
     if(strcmp(var_name, "xc") == 0||strcmp(var_name, "imsize1") == 0){
       width = (int)length;
       assert(width > 0);
@@ -86,157 +89,103 @@ NetCDF_Reader::get_image_dimensions(const std::string & file_name,
       assert(num_time_steps >= 0);
     }
   }
+  if(width<=0||height<=0) nc_close(ncid);
   TEUCHOS_TEST_FOR_EXCEPTION(width <=0, std::runtime_error,"Error, could not find xc dimension in NetCDF file " << file_name);
   TEUCHOS_TEST_FOR_EXCEPTION(height <=0, std::runtime_error,"Error, could not find yc dimension in NetCDF file " << file_name);
-  DEBUG_MSG("NetCDF_Reader::get_image(): image dimensions " << width << " x " << height << " num time steps: " << num_time_steps);
-
-  // close the nc_file
-  nc_close(ncid);
-}
-
-void
-NetCDF_Reader::read_netcdf_image(const char * file_name,
-  intensity_t * intensities,
-  const size_t time_index,
-  const bool is_layout_right){
-
-  int_t width = 0;
-  int_t height = 0;
-  int_t num_time_steps = 0;
-  get_image_dimensions(file_name,width,height,num_time_steps);
-  TEUCHOS_TEST_FOR_EXCEPTION(time_index < 0 || (int_t)time_index >= num_time_steps,std::runtime_error,"");
-
-  // Open the file for read access
-  int ncid;
-  int_t error_int = nc_open(file_name, 0, &ncid);
-  TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::runtime_error,"Error, could not open NetCDF file " << file_name);
+  DEBUG_MSG("NetCDF_Reader::open(): image dimensions " << width << " x " << height << " num time steps: " << num_time_steps);
 
+  // find the data variable (files without one can still be queried for their dimensions)
   int num_vars = 0;
   nc_inq_nvars(ncid, &num_vars);
-  DEBUG_MSG("NetCDF_Reader::get_image(): number of variables in the file: " << num_vars);
-
-  // get the variable names
+  DEBUG_MSG("NetCDF_Reader::open(): number of variables in the file: " << num_vars);
   int data_var_index = -1;
   int data_type = -1;
+  int data_var_dims = 0;
   for(int_t i=0;i<num_vars;++i){
-    char var_name[100];
-    int nc_type;
+    char var_name[NC_MAX_NAME+1];
+    nc_type var_type;
     int num_dims = 0;
-    int dim_ids[NC_MAX_VAR_DIMS]; // assume less than 100 ids
+    int dim_ids[NC_MAX_VAR_DIMS];
     int num_var_attr = 0;
-    nc_inq_var(ncid,i, &var_name[0], &nc_type,&num_dims, dim_ids, &num_var_attr);
-    nc_inq_varname(ncid, i, &var_name[0]);
-    std::string var_name_str = var_name;
-    DEBUG_MSG("NetCDF_Reader::get_image(): found variable " << var_name_str << " type " << nc_type << " num dims " << num_dims << " num attributes " << num_var_attr);
+    nc_inq_var(ncid,i, &var_name[0], &var_type,&num_dims, dim_ids, &num_var_attr);
+    DEBUG_MSG("NetCDF_Reader::open(): found variable " << var_name << " type " << var_type << " num dims " << num_dims << " num attributes " << num_var_attr);
     if(strcmp(var_name, "data") == 0){
       data_var_index = i;
       assert(num_dims == 3 || num_dims == 2);
-      assert(nc_type == 5 || nc_type == 6);
-      data_type = nc_type;
+      assert(var_type == NC_FLOAT || var_type == NC_DOUBLE);
+      data_type = var_type;
+      data_var_dims = num_dims;
     }
-//    if(strcmp(var_name, "dataWidth") == 0){
-//      int data_width = 0;
-//      nc_get_var1_int(ncid,i,0,&data_width);
-//      DEBUG_MSG("NetCDF_Reader::get_image(): memory storage size per pixel " << data_width << " (bytes)");
-//      DEBUG_MSG("NetCDF_Reader::get_image(): total data memory storage " << data_width * width * height / 1000000.0 << " (Mb)");
-//      assert(num_dims == 0);
-//      assert(nc_type == 4);
-//    }
-//    if(strcmp(var_name, "lineRes") == 0){
-//      int line_res = 0;
-//      nc_get_var1_int(ncid,i,0,&line_res);
-//      DEBUG_MSG("NetCDF_Reader::get_image(): line resolution " << line_res << " (km)");
-//    }
-//    if(strcmp(var_name, "elemRes") == 0){
-//      int elem_res = 0;
-//      nc_get_var1_int(ncid,i,0,&elem_res);
-//      DEBUG_MSG("NetCDF_Reader::get_image(): element resolution " << elem_res << " (km)");
-//    }
   }
-  TEUCHOS_TEST_FOR_EXCEPTION(data_var_index<0, std::runtime_error,"Error, could not find data variable in NetCDF file " << file_name);
 
-  // read the intensities
-  //Teuchos::ArrayRCP<intensity_t> intensities(width*height,0.0);
-
-  std::vector<size_t> starts(3);
-  starts[0] = time_index;
-  starts[1] = 0;
-  starts[2] = 0;
-  std::vector<size_t> counts(3);
-  counts[0] = 1;
-  counts[1] = height;
-  counts[2] = width;
+#ifdef NC_NETCDF4
+  // the default HDF5 chunk cache is often smaller than the chunks that span one frame,
+  // in which case every hyperslab read decompresses the same chunks again
+  if(data_var_index>=0){
+    int storage = NC_CONTIGUOUS;
+    std::vector<size_t> chunk_sizes(data_var_dims,1);
+    if(nc_inq_var_chunking(ncid,data_var_index,&storage,&chunk_sizes[0])==NC_NOERR&&storage==NC_CHUNKED){
+      size_t min_cache_size = 0;
+      size_t num_elems = 0;
+      float preemption = 0.0f;
+      nc_get_var_chunk_cache(ncid,data_var_index,&min_cache_size,&num_elems,&preemption);
+      // enough room for all of the chunks that cover one frame
+      const size_t value_size = data_type==NC_DOUBLE ? sizeof(double) : sizeof(float);
+      const size_t chunk_h = chunk_sizes[data_var_dims-2];
+      const size_t chunk_w = chunk_sizes[data_var_dims-1];
+      const size_t chunk_t = data_var_dims==3 ? chunk_sizes[0] : 1;
+      const size_t chunks_per_frame = ((height+chunk_h-1)/chunk_h)*((width+chunk_w-1)/chunk_w);
+      const size_t frame_cache_size = std::min(max_chunk_cache_size,chunks_per_frame*chunk_h*chunk_w*chunk_t*value_size);
+      if(frame_cache_size>min_cache_size){
+        DEBUG_MSG("NetCDF_Reader::open(): setting the chunk cache to " << frame_cache_size << " bytes");
+        nc_set_var_chunk_cache(ncid,data_var_index,frame_cache_size,std::max(num_elems,2*chunks_per_frame+1),0.75f);
+      }
+    }
+  }
+#endif
+
+  ncid_ = ncid;
+  file_name_ = file_name;
+  data_var_index_ = data_var_index;
+  data_type_ = data_type;
+  num_data_dims_ = data_var_dims;
+  width_ = width;
+  height_ = height;
+  num_time_steps_ = num_time_steps;
+}
 
-  if(data_type==5){
-    float * data = new float[width*height];
-    DEBUG_MSG("NetCDF_Reader::get_image(): FLOAT TYPE, ncid " << ncid << " data_var_index " << data_var_index);
+void
+NetCDF_Reader::close(){
+  if(ncid_>=0)
+    nc_close(ncid_);
+  ncid_ = -1;
+  file_name_ = "";
+  data_var_index_ = -1;
+  data_type_ = -1;
+  num_data_dims_ = 0;
+  width_ = 0;
+  height_ = 0;
+  num_time_steps_ = 0;
+}
 
-    int_t ret_val = nc_get_vara_float(ncid,data_var_index,&starts[0],&counts[0],data);
-    //int_t ret_val = nc_get_var_float (ncid,data_var_index,data);
-    DEBUG_MSG("NetCDF_Reader::get_image(): return value from get_var_float(): " << ret_val);
-    TEUCHOS_TEST_FOR_EXCEPTION(ret_val,std::runtime_error,"");
-    //float min_intensity = std::numeric_limits<float>::max();
-    //float max_intensity = std::numeric_limits<float>::min();
+void
+NetCDF_Reader::get_image_dimensions(const std::string & file_name,
+  int_t & width,
+  int_t & height,
+  int_t & num_time_steps){
+  open(file_name);
+  width = width_;
+  height = height_;
+  num_time_steps = num_time_steps_;
+}
 
-    int_t index = 0;
-    for (int_t y=0; y<height; ++y) {
-      if(is_layout_right){
-        for (int_t x=0; x<width;++x){
-          intensities[y*width+x] = data[index];
-          //if(data[index] > max_intensity) max_intensity = data[index];
-          //if(data[index] < min_intensity) min_intensity = data[index];
-          index++;
-        }
-      }
-      else{ // otherwise assume layout left
-        TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"");
-        for (int_t x=0; x<width;++x){
-          intensities[x*height+y] = data[index];
-          //if(data[index] > max_intensity) max_intensity = data[index];
-          //if(data[index] < min_intensity) min_intensity = data[index];
-          index++;
-        } // end x
-      }
-    } // end y
-    //DEBUG_MSG("NetCDF_Reader::get_image(): intensity range " << min_intensity << " to " << max_intensity);
-    delete [] data;
-  }
-  else if(data_type==6){
-    double * data = new double[width*height];
-    DEBUG_MSG("NetCDF_Reader::get_image(): DOUBLE TYPE, ncid " << ncid << " data_var_index " << data_var_index);
-    int_t ret_val = nc_get_vara_double(ncid,data_var_index,&starts[0],&counts[0],data);
-    //int_t ret_val = nc_get_var_double (ncid,data_var_index,data);
-    TEUCHOS_TEST_FOR_EXCEPTION(ret_val,std::runtime_error,"");
-    //float min_intensity = std::numeric_limits<float>::max();
-    //float max_intensity = std::numeric_limits<float>::min();
-    int_t index = 0;
-    for (int_t y=0; y<height; ++y) {
-      if(is_layout_right){
-        for (int_t x=0; x<width;++x){
-          intensities[y*width+x] = data[index];
-          //if(data[index] > max_intensity) max_intensity = data[index];
-          //if(data[index] < min_intensity) min_intensity = data[index];
-          index++;
-        }
-      }
-      else{ // otherwise assume layout left
-        TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"");
-        for (int_t x=0; x<width;++x){
-          intensities[x*height+y] = data[index];
-          //if(data[index] > max_intensity) max_intensity = data[index];
-          //if(data[index] < min_intensity) min_intensity = data[index];
-          index++;
-        } // end x
-      }
-    } // end y
-    //DEBUG_MSG("NetCDF_Reader::get_image(): intensity range " << min_intensity << " to " << max_intensity);
-    delete [] data;
-  }
-  else{
-    TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, invalid data type: " << data_type);
-  }
-  // close the nc_file
-  nc_close(ncid);
+void
+NetCDF_Reader::read_netcdf_image(const char * file_name,
+  intensity_t * intensities,
+  const size_t time_index,
+  const bool is_layout_right){
+  open(file_name);
+  read_netcdf_image(file_name,0,0,width_,height_,time_index,intensities,is_layout_right);
 }
 
 void
@@ -249,122 +198,45 @@ NetCDF_Reader::read_netcdf_image(const char * file_name,
   intensity_t * intensities,
   const bool is_layout_right){
 
-  int_t img_width = 0;
-  int_t img_height = 0;
-  int_t num_time_steps = 0;
-  get_image_dimensions(file_name,img_width,img_height,num_time_steps);
-  TEUCHOS_TEST_FOR_EXCEPTION(time_index < 0 || (int_t)time_index >= num_time_steps,std::runtime_error,"");
-
-  // Open the file for read access
-  int ncid;
-  int_t error_int = nc_open(file_name, 0, &ncid);
-  TEUCHOS_TEST_FOR_EXCEPTION(error_int,std::runtime_error,"Error, could not open NetCDF file " << file_name);
-
-  int num_vars = 0;
-  nc_inq_nvars(ncid, &num_vars);
-  DEBUG_MSG("NetCDF_Reader::get_image(): number of variables in the file: " << num_vars);
-
-  // get the variable names
-  int data_var_index = -1;
-  int data_type = -1;
-  for(int_t i=0;i<num_vars;++i){
-    char var_name[100];
-    int nc_type;
-    int num_dims = 0;
-    int dim_ids[NC_MAX_VAR_DIMS]; // assume less than 100 ids
-    int num_var_attr = 0;
-    nc_inq_var(ncid,i, &var_name[0], &nc_type,&num_dims, dim_ids, &num_var_attr);
-    nc_inq_varname(ncid, i, &var_name[0]);
-    std::string var_name_str = var_name;
-    DEBUG_MSG("NetCDF_Reader::get_image(): found variable " << var_name_str << " type " << nc_type << " num dims " << num_dims << " num attributes " << num_var_attr);
-    if(strcmp(var_name, "data") == 0){
-      data_var_index = i;
-      assert(num_dims == 3 || num_dims == 2);
-      assert(nc_type == 5 || nc_type == 6);
-      data_type = nc_type;
-    }
-//    if(strcmp(var_name, "dataWidth") == 0){
-//      int data_width = 0;
-//      nc_get_var1_int(ncid,i,0,&data_width);
-//      DEBUG_MSG("NetCDF_Reader::get_image(): memory storage size per pixel " << data_width << " (bytes)");
-//      DEBUG_MSG("NetCDF_Reader::get_image(): total data memory storage " << data_width * img_width * img_height / 1000000.0 << " (Mb)");
-//      assert(num_dims == 0);
-//      assert(nc_type == 4);
-//    }
-//    if(strcmp(var_name, "lineRes") == 0){
-//      int line_res = 0;
-//      nc_get_var1_int(ncid,i,0,&line_res);
-//      DEBUG_MSG("NetCDF_Reader::get_image(): line resolution " << line_res << " (km)");
-//    }
-//    if(strcmp(var_name, "elemRes") == 0){
-//      int elem_res = 0;
-//      nc_get_var1_int(ncid,i,0,&elem_res);
-//      DEBUG_MSG("NetCDF_Reader::get_image(): element resolution " << elem_res << " (km)");
-//    }
+  open(file_name);
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t)time_index >= num_time_steps_,std::runtime_error,
+    "Error, invalid time index " << time_index << " for NetCDF file " << file_name);
+  TEUCHOS_TEST_FOR_EXCEPTION(data_var_index_<0, std::runtime_error,"Error, could not find data variable in NetCDF file " << file_name);
+  TEUCHOS_TEST_FOR_EXCEPTION(data_type_!=NC_FLOAT&&data_type_!=NC_DOUBLE,std::runtime_error,"Error, invalid data type: " << data_type_);
+  TEUCHOS_TEST_FOR_EXCEPTION(offset_x<0||offset_y<0||width<=0||height<=0||offset_x+width>width_||offset_y+height>height_,
+    std::runtime_error,"Error, invalid region for NetCDF file " << file_name);
+
+  // read only the hyperslab that covers the region (netcdf converts the values to the intensity type)
+  std::vector<size_t> starts;
+  std::vector<size_t> counts;
+  if(num_data_dims_==3){
+    starts.push_back(time_index);
+    counts.push_back(1);
   }
-  TEUCHOS_TEST_FOR_EXCEPTION(data_var_index <=0, std::runtime_error,"Error, could not find data variable in NetCDF file " << file_name);
-
-  std::vector<size_t> starts(3);
-  starts[0] = time_index;
-  starts[1] = 0;
-  starts[2] = 0;
-  std::vector<size_t> counts(3);
-  counts[0] = 1;
-  counts[1] = height;
-  counts[2] = width;
-
-  // read the intensities
-  //Teuchos::ArrayRCP<intensity_t> intensities(width*height,0.0);
-  if(data_type==5){
-    float * data = new float[img_width*img_height];
-    nc_get_vara_float(ncid,data_var_index,&starts[0],&counts[0],data);
-    //nc_get_var_float (ncid,data_var_index,data);
-    //float min_intensity = std::numeric_limits<float>::max();
-    //float max_intensity = std::numeric_limits<float>::min();
-
-    for (int_t y=offset_y; y<offset_y+height; ++y) {
-      if(is_layout_right)
-        for (int_t x=offset_x; x<offset_x+width;++x){
-          intensities[(y-offset_y)*width+x-offset_x] = data[y*img_width+x];
-          //if(data[y*img_width+x] > max_intensity) max_intensity = data[y*img_width+x];
-          //if(data[y*img_width+x] < min_intensity) min_intensity = data[y*img_width+x];
-        }
-      else // otherwise assume layout left
-        for (int_t x=offset_x; x<offset_x+width;++x){
-          intensities[(x-offset_x)*height+y-offset_y] = data[y*img_width+x];
-          //if(data[y*img_width+x] > max_intensity) max_intensity = data[y*img_width+x];
-          //if(data[y*img_width+x] < min_intensity) min_intensity = data[y*img_width+x];
-        } // end x
-    } // end y
-    //DEBUG_MSG("NetCDF_Reader::get_image(): intensity range " << min_intensity << " to " << max_intensity);
-    delete [] data;
-  }else{
-    double * data = new double[img_width*img_height];
-    nc_get_vara_double(ncid,data_var_index,&starts[0],&counts[0],data);
-    //nc_get_var_float (ncid,data_var_index,data);
-    //float min_intensity = std::numeric_limits<float>::max();
-    //float max_intensity = std::numeric_limits<float>::min();
-
-    for (int_t y=offset_y; y<offset_y+height; ++y) {
-      if(is_layout_right)
-        for (int_t x=offset_x; x<offset_x+width;++x){
-          intensities[(y-offset_y)*width+x-offset_x] = data[y*img_width+x];
-          //if(data[y*img_width+x] > max_intensity) max_intensity = data[y*img_width+x];
-          //if(data[y*img_width+x] < min_intensity) min_intensity = data[y*img_width+x];
-        }
-      else // otherwise assume layout left
-        for (int_t x=offset_x; x<offset_x+width;++x){
-          intensities[(x-offset_x)*height+y-offset_y] = data[y*img_width+x];
-          //if(data[y*img_width+x] > max_intensity) max_intensity = data[y*img_width+x];
-          //if(data[y*img_width+x] < min_intensity) min_intensity = data[y*img_width+x];
-        } // end x
-    } // end y
-    //DEBUG_MSG("NetCDF_Reader::get_image(): intensity range " << min_intensity << " to " << max_intensity);
-    delete [] data;
+  starts.push_back(offset_y);
+  starts.push_back(offset_x);
+  counts.push_back(height);
+  counts.push_back(width);
+
+  std::vector<intensity_t> buffer;
+  intensity_t * data = intensities;
+  if(!is_layout_right){
+    buffer.resize(width*height);
+    data = &buffer[0];
+  }
+#if DICE_USE_DOUBLE
+  const int_t ret_val = nc_get_vara_double(ncid_,data_var_index_,&starts[0],&counts[0],data);
+#else
+  const int_t ret_val = nc_get_vara_float(ncid_,data_var_index_,&starts[0],&counts[0],data);
+#endif
+  DEBUG_MSG("NetCDF_Reader::read_netcdf_image(): return value from nc_get_vara(): " << ret_val);
+  TEUCHOS_TEST_FOR_EXCEPTION(ret_val,std::runtime_error,"Error, could not read the data from NetCDF file " << file_name);
+
+  if(!is_layout_right){
+    for (int_t y=0; y<height; ++y)
+      for (int_t x=0; x<width;++x)
+        intensities[x*height+y] = buffer[y*width+x];
   }
-
-  // close the nc_file
-  nc_close(ncid);
 }
 
 NetCDF_Writer::NetCDF_Writer(const std::string & file_name,
@@ -372,74 +244,121 @@ NetCDF_Writer::NetCDF_Writer(const std::string & file_name,
   const int_t & height,
   const int_t & num_time_steps,
   const std::vector<std::string> & var_names,
-  const bool use_double):
+  const bool use_double,
+  const int_t compression_level,
+  const bool use_shuffle,
+  const int_t quantize_digits):
   file_name_(file_name),
   dim_x_(width),
   dim_y_(height),
   num_time_steps_(num_time_steps),
-  var_names_(var_names){
-
+  var_names_(var_names),
+  next_time_index_(var_names.size(),0),
+  ncid_(-1){
+
+  TEUCHOS_TEST_FOR_EXCEPTION(compression_level<0||compression_level>9,std::runtime_error,
+    "Error, invalid NetCDF compression level " << compression_level << " (must be 0 to 9)");
+  TEUCHOS_TEST_FOR_EXCEPTION(quantize_digits<0,std::runtime_error,"Error, invalid number of quantize digits " << quantize_digits);
+#ifndef NC_NETCDF4
+  TEUCHOS_TEST_FOR_EXCEPTION(compression_level>0,std::runtime_error,
+    "Error, NetCDF compression requested, but the netcdf library was not built with NetCDF-4 support");
+#endif
   // create a netcdf file:
   int_t retval = 0;
-  int_t ncid = -1;
+  int ncid = -1;
   const int_t num_dims = 3;
-  retval = nc_create(file_name.c_str(),NC_CLOBBER, &ncid);
-  TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"");
+  int create_mode = NC_CLOBBER;
+#ifdef NC_NETCDF4
+  if(compression_level>0) create_mode |= NC_NETCDF4;
+#endif
+  retval = nc_create(file_name.c_str(),create_mode, &ncid);
+  TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"Error, could not create NetCDF file " << file_name);
   DEBUG_MSG("created file " << file_name << " with id: " << ncid);
-  int_t xdim_id = -1;
-  int_t ydim_id = -1;
-  int_t data_id = -1;
-  int_t timedim_id = -1;
+  int xdim_id = -1;
+  int ydim_id = -1;
+  int data_id = -1;
+  int timedim_id = -1;
   retval = nc_def_dim(ncid, "xc", width, &xdim_id);
   TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"");
   retval = nc_def_dim(ncid, "yc", height, &ydim_id);
   TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"");
   retval = nc_def_dim(ncid, "time", NC_UNLIMITED, &timedim_id);//num_time_steps, &timedim_id);
   TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"");
-  std::vector<int_t> dim_ids(3);
+  std::vector<int> dim_ids(3);
   dim_ids[1] = ydim_id; dim_ids[2] = xdim_id; dim_ids[0] = timedim_id;
   var_ids_.resize(var_names_.size());
   for(size_t i=0;i<var_names.size();++i){
-    /* Define the data variable. The type of the variable in this case is
-     * NC_INT (4-byte integer). */
-    std::string var_str = var_names[i];
-    char * var_char = new char[var_str.size()+1];
-    std::copy(var_str.begin(), var_str.end(), var_char);
-    var_char[var_str.size()] = '\0';
     if(use_double)
-      retval = nc_def_var(ncid, var_char, NC_DOUBLE, num_dims, &dim_ids[0], &data_id);
+      retval = nc_def_var(ncid, var_names[i].c_str(), NC_DOUBLE, num_dims, &dim_ids[0], &data_id);
     else
-      retval = nc_def_var(ncid, var_char, NC_FLOAT, num_dims, &dim_ids[0], &data_id);
+      retval = nc_def_var(ncid, var_names[i].c_str(), NC_FLOAT, num_dims, &dim_ids[0], &data_id);
     TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"");
-    DEBUG_MSG("created variable " << var_char << " with id: " << data_id << " num dimensions " << num_dims << ": "  << dim_ids[0] << " " << dim_ids[1] << " " << dim_ids[2]);
+    DEBUG_MSG("created variable " << var_names[i] << " with id: " << data_id << " num dimensions " << num_dims << ": "  << dim_ids[0] << " " << dim_ids[1] << " " << dim_ids[2]);
+#ifdef NC_NETCDF4
+    if(compression_level>0){
+      // one chunk per frame so that each time step is compressed and written on its own
+      std::vector<size_t> chunk_sizes(3);
+      chunk_sizes[0] = 1;
+      chunk_sizes[1] = height;
+      chunk_sizes[2] = width;
+      retval = nc_def_var_chunking(ncid, data_id, NC_CHUNKED, &chunk_sizes[0]);
+      TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"Error, could not set the chunking for variable " << var_names[i]);
+      retval = nc_def_var_deflate(ncid, data_id, use_shuffle ? 1 : 0, 1, compression_level);
+      TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"Error, could not set the compression for variable " << var_names[i]);
+#ifdef NC_QUANTIZE_BITGROOM
+      if(quantize_digits>0&&!use_double){
+        retval = nc_def_var_quantize(ncid, data_id, NC_QUANTIZE_BITGROOM, quantize_digits);
+        TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"Error, could not set the quantization for variable " << var_names[i]);
+      }
+#else
+      if(quantize_digits>0)
+        DEBUG_MSG("NetCDF_Writer(): the netcdf library does not support quantization, writing full precision");
+#endif
+    }
+#else
+    (void)use_shuffle;
+    (void)quantize_digits;
+#endif
     var_ids_[i] = data_id;
   }
   /* End define mode. This tells netCDF we are done defining
    * metadata. */
   retval = nc_enddef(ncid);
   TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,retval);
-  nc_close(ncid);
+  ncid_ = ncid;
 }
 
 void
-NetCDF_Writer::write_float_array(const std::string var_name,
+NetCDF_Writer::close(){
+  if(ncid_>=0)
+    nc_close(ncid_);
+  ncid_ = -1;
+}
+
+size_t
+NetCDF_Writer::check_write(const std::string & var_name,
   const size_t time_index,
-  const std::vector<float> & array){
+  const size_t array_size){
   // search the list of names to ensure that one matches and get the id:
-  int_t var_id = -1;
+  size_t var_index = var_names_.size();
   for(size_t i=0;i<var_names_.size();++i){
     if(var_names_[i]==var_name)
-      var_id = var_ids_[i];
+      var_index = i;
   }
-  DEBUG_MSG("writing variable " << var_name << " with id: " << var_id << " time step " << time_index << " to file " << file_name_);
-  TEUCHOS_TEST_FOR_EXCEPTION(var_id<0,std::runtime_error,"");
-  TEUCHOS_TEST_FOR_EXCEPTION(time_index < 0 || (int_t) time_index >= num_time_steps_,std::runtime_error,"");
+  DEBUG_MSG("writing variable " << var_name << " time step " << time_index << " to file " << file_name_);
+  TEUCHOS_TEST_FOR_EXCEPTION(var_index>=var_names_.size(),std::runtime_error,"Error, unknown variable " << var_name);
+  TEUCHOS_TEST_FOR_EXCEPTION((int_t) time_index >= num_time_steps_,std::runtime_error,"Error, invalid time index " << time_index);
   // check that the dimensions are correct
-  TEUCHOS_TEST_FOR_EXCEPTION(dim_x_*dim_y_!=(int_t)array.size(),std::runtime_error,"");
-  int_t ncid = -1;
-  int_t retval = 0;
-  retval = nc_open(file_name_.c_str(),NC_WRITE,&ncid);
-  TEUCHOS_TEST_FOR_EXCEPTION(ncid<0,std::runtime_error,"error: " << retval);
+  TEUCHOS_TEST_FOR_EXCEPTION(dim_x_*dim_y_!=(int_t)array_size,std::runtime_error,"");
+  TEUCHOS_TEST_FOR_EXCEPTION(ncid_<0,std::runtime_error,"Error, NetCDF file " << file_name_ << " has been closed");
+  return var_index;
+}
+
+void
+NetCDF_Writer::write_float_array(const std::string var_name,
+  const size_t time_index,
+  const std::vector<float> & array){
+  const size_t var_index = check_write(var_name,time_index,array.size());
   /* Write the data to the file.  */
   std::vector<size_t> starts(3);
   starts[0] = time_index;
@@ -449,33 +368,19 @@ NetCDF_Writer::write_float_array(const std::string var_name,
   counts[0] = 1;
   counts[1] = dim_y_;
   counts[2] = dim_x_;
-  retval = nc_put_vara_float(ncid,var_id,&starts[0],&counts[0],&array[0]);
+  int_t retval = nc_put_vara_float(ncid_,var_ids_[var_index],&starts[0],&counts[0],&array[0]);
   DEBUG_MSG("nc_put_vara_float() return value: " << retval);
-  //retval = nc_put_var_float(ncid, var_id, &array[0]);
   TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"");
-  nc_close(ncid);
+  // flush so the frame can be read before the writer is closed
+  nc_sync(ncid_);
+  next_time_index_[var_index] = std::max(next_time_index_[var_index],time_index+1);
 }
 
 void
 NetCDF_Writer::write_double_array(const std::string var_name,
   const size_t time_index,
   const std::vector<double> & array){
-
-  // search the list of names to ensure that one matches and get the id:
-  int_t var_id = -1;
-  for(size_t i=0;i<var_names_.size();++i){
-    if(var_names_[i]==var_name)
-      var_id = var_ids_[i];
-  }
-  DEBUG_MSG("writing variable " << var_name << " with id: " << var_id << " to file " << file_name_);
-  TEUCHOS_TEST_FOR_EXCEPTION(var_id<0,std::runtime_error,"");
-  TEUCHOS_TEST_FOR_EXCEPTION(time_index < 0 || (int_t) time_index >= num_time_steps_,std::runtime_error,"");
-  // check that the dimensions are correct
-  TEUCHOS_TEST_FOR_EXCEPTION(dim_x_*dim_y_!=(int_t)array.size(),std::runtime_error,"");
-  int_t ncid = -1;
-  int_t retval = 0;
-  retval = nc_open(file_name_.c_str(),NC_WRITE,&ncid);
-  TEUCHOS_TEST_FOR_EXCEPTION(ncid<0,std::runtime_error,"");
+  const size_t var_index = check_write(var_name,time_index,array.size());
   /* Write the data to the file.  */
   std::vector<size_t> starts(3);
   starts[0] = time_index;
@@ -485,13 +390,26 @@ NetCDF_Writer::write_double_array(const std::string var_name,
   counts[0] = 1;
   counts[1] = dim_y_;
   counts[2] = dim_x_;
-  retval = nc_put_vara_double(ncid,var_id,&starts[0],&counts[0],&array[0]);
-  //retval = nc_put_var_double(ncid, var_id, &array[0]);
+  int_t retval = nc_put_vara_double(ncid_,var_ids_[var_index],&starts[0],&counts[0],&array[0]);
   TEUCHOS_TEST_FOR_EXCEPTION(retval,std::runtime_error,"");
-  nc_close(ncid);
+  // flush so the frame can be read before the writer is closed
+  nc_sync(ncid_);
+  next_time_index_[var_index] = std::max(next_time_index_[var_index],time_index+1);
 }
 
+void
+NetCDF_Writer::append_float_array(const std::string var_name,
+  const std::vector<float> & array){
+  const size_t var_index = check_write(var_name,0,array.size());
+  write_float_array(var_name,next_time_index_[var_index],array);
+}
 
+void
+NetCDF_Writer::append_double_array(const std::string var_name,
+  const std::vector<double> & array){
+  const size_t var_index = check_write(var_name,0,array.size());
+  write_double_array(var_name,next_time_index_[var_index],array);
+}
 
 } // end netcdf namespace
 } // end DICe Namespace
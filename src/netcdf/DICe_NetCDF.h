@@ -68,9 +68,18 @@ NetCDF_Reader
 {
 public:
   /// constructor
-  NetCDF_Reader(){};
-  /// default destructor
-  virtual ~NetCDF_Reader(){};
+  NetCDF_Reader():
+    ncid_(-1),
+    data_var_index_(-1),
+    data_type_(-1),
+    num_data_dims_(0),
+    width_(0),
+    height_(0),
+    num_time_steps_(0){};
+  /// default destructor, closes the file if it is open
+  virtual ~NetCDF_Reader(){
+    close();
+  };
 
   /// read the intensities from the netcdf file:
   /// \param file_name the name of the file to read
@@ -110,12 +119,42 @@ public:
     int_t & height,
     int_t & num_time_steps);
 
-private:
+  /// close the file if it is open (the next read opens it again)
+  void close();
 
+private:
+  /// not copyable since the reader owns the open file
+  NetCDF_Reader(const NetCDF_Reader &);
+  /// not assignable since the reader owns the open file
+  NetCDF_Reader & operator=(const NetCDF_Reader &);
+  /// \brief open the file and read the dimensions and data variable info
+  /// Nothing is done if the file is already open so that successive frames
+  /// are read without opening and searching the file again
+  /// \param file_name the name of the file
+  void open(const std::string & file_name);
+  /// name of the open file
+  std::string file_name_;
+  /// netcdf id of the open file (-1 if no file is open)
+  int ncid_;
+  /// id of the data variable
+  int data_var_index_;
+  /// netcdf type of the data variable
+  int data_type_;
+  /// number of dimensions of the data variable (2 or 3)
+  int num_data_dims_;
+  /// width of the frames
+  int_t width_;
+  /// height of the frames
+  int_t height_;
+  /// number of time steps in the file
+  int_t num_time_steps_;
 };
 
 
 /// class to write float arrays out a netcdf file
+/// The file stays open until the writer is closed or destroyed so that frames can be streamed
+/// out one time step at a time. With compression the file is written in the NetCDF-4 format
+/// with one chunk per frame.
 class DICE_LIB_DLL_EXPORT
 NetCDF_Writer
 {
@@ -127,14 +166,23 @@ public:
   /// \param num_time_steps the number of time steps to include in the file
   /// \param var_names vector with the names of the varibles to save
   /// \param use_double forces output to be in double, not float
+  /// \param compression_level deflate level from 0 (no compression, classic format) to 9
+  /// \param use_shuffle apply the byte shuffle filter before deflating (usually compresses floats much better)
+  /// \param quantize_digits number of significant digits to keep for float variables, 0 keeps all of them
+  /// (only used with compression and if the netcdf library supports quantization)
   NetCDF_Writer(const std::string & file_name,
     const int_t & width,
     const int_t & height,
     const int_t & num_time_steps,
     const std::vector<std::string> & var_names,
-    const bool use_double = false);
-  /// default destructor
-  virtual ~NetCDF_Writer(){};
+    const bool use_double = false,
+    const int_t compression_level = 0,
+    const bool use_shuffle = true,
+    const int_t quantize_digits = 0);
+  /// default destructor, closes the file
+  virtual ~NetCDF_Writer(){
+    close();
+  };
 
   /// write an array to the file
   /// if the file exists, overwrite
@@ -154,7 +202,33 @@ public:
     const size_t time_index,
     const std::vector<double> & array);
 
+  /// write an array to the time step after the last one written for this variable
+  /// \param var_name the name of the variable to write
+  /// \param vector of float values to write
+  void append_float_array(const std::string var_name,
+    const std::vector<float> & array);
+
+  /// write an array to the time step after the last one written for this variable
+  /// \param var_name the name of the variable to write
+  /// \param vector of double values to write
+  void append_double_array(const std::string var_name,
+    const std::vector<double> & array);
+
+  /// close the file (no more arrays can be written)
+  void close();
+
 private:
+  /// not copyable since the writer owns the open file
+  NetCDF_Writer(const NetCDF_Writer &);
+  /// not assignable since the writer owns the open file
+  NetCDF_Writer & operator=(const NetCDF_Writer &);
+  /// returns the index of the variable in var_names_, checks the array size and time index
+  /// \param var_name the name of the variable
+  /// \param time_index the time frame to write
+  /// \param array_size the number of values in the array
+  size_t check_write(const std::string & var_name,
+    const size_t time_index,
+    const size_t array_size);
   const std::string file_name_;
   /// x dimension of the array
   const int_t dim_x_;
@@ -166,6 +240,10 @@ private:
   std::vector<std::string> var_names_;
   /// collection of the variable ids
   std::vector<int_t> var_ids_;
+  /// the next time step appended for each variable
+  std::vector<size_t> next_time_index_;
+  /// netcdf id of the open file (-1 if closed)
+  int ncid_;
 };
 
 
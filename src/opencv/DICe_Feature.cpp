@@ -45,18 +45,139 @@
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/opencv.hpp>
 
+#include <algorithm>
 #include <cstdio>
+#include <exception>
+#include <vector>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 namespace DICe {
 
+/// opencv storage for a feature set
+struct Feature_Set_Data{
+  /// 8 bit copy of the image (used to draw the matches)
+  std::vector<unsigned char> pixels;
+  /// opencv header for the pixels
+  cv::Mat img;
+  /// keypoints
+  std::vector<cv::KeyPoint> kpts;
+  /// descriptors (one row per keypoint)
+  cv::Mat desc;
+  /// offsets of the image to convert to global coordinates
+  scalar_t offset_x;
+  scalar_t offset_y;
+};
+
+Feature_Set::Feature_Set(Teuchos::RCP<Image> image,
+  const float & feature_tol,
+  const std::vector<int_t> & region,
+  const int_t tile_size,
+  const int_t max_features_per_tile,
+  const int_t num_threads):
+  data_(Teuchos::rcp(new Feature_Set_Data())){
+  DEBUG_MSG("Feature_Set::Feature_Set(): detect and compute features");
+  TEUCHOS_TEST_FOR_EXCEPTION(!region.empty()&&region.size()!=4,std::invalid_argument,
+    "Error, the feature region must have four values (x_min, y_min, x_max, y_max)");
+  TEUCHOS_TEST_FOR_EXCEPTION(tile_size<0||max_features_per_tile<0||num_threads<1,std::invalid_argument,
+    "Error, invalid feature tile size, max features per tile or number of threads");
+  // only the pixels in the region are converted to 8 bit
+  int_t x_begin = 0;
+  int_t y_begin = 0;
+  int_t x_end = image->width();
+  int_t y_end = image->height();
+  if(!region.empty()){
+    x_begin = std::max(x_begin,region[0] - (int_t)image->offset_x());
+    y_begin = std::max(y_begin,region[1] - (int_t)image->offset_y());
+    x_end = std::min(x_end,region[2] - (int_t)image->offset_x() + 1);
+    y_end = std::min(y_end,region[3] - (int_t)image->offset_y() + 1);
+  }
+  data_->offset_x = image->offset_x() + x_begin;
+  data_->offset_y = image->offset_y() + y_begin;
+  if(x_end<=x_begin||y_end<=y_begin){
+    DEBUG_MSG("Feature_Set::Feature_Set(): the region does not overlap the image, no features detected");
+    return;
+  }
+  const int_t w = x_end - x_begin;
+  const int_t h = y_end - y_begin;
+  data_->pixels.resize(w*h);
+  opencv_8UC1(image,&data_->pixels[0],x_begin,y_begin,w,h);
+  data_->img = cv::Mat(h,w,CV_8U,&data_->pixels[0]);
+
+  // split the region into tiles, each tile is detected with a border so the features near the edges of the tile
+  // are the same as if the whole region was detected, then only the features inside the tile are kept
+  const int_t tile = tile_size>0 ? tile_size : std::max(w,h);
+  const int_t tile_border = tile_size>0 ? 32 : 0;
+  std::vector<cv::Rect> tiles;
+  for(int_t y=0;y<h;y+=tile)
+    for(int_t x=0;x<w;x+=tile)
+      tiles.push_back(cv::Rect(x,y,std::min(tile,w-x),std::min(tile,h-y)));
+  std::vector<std::vector<cv::KeyPoint> > tile_kpts(tiles.size());
+  std::vector<cv::Mat> tile_desc(tiles.size());
+  std::exception_ptr detect_error;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic,1) if(num_threads>1&&tiles.size()>1)
+#endif
+  for(int_t t=0;t<(int_t)tiles.size();++t){
+    try{
+      const cv::Rect & core = tiles[t];
+      const cv::Rect window = cv::Rect(core.x-tile_border,core.y-tile_border,core.width+2*tile_border,core.height+2*tile_border)
+        & cv::Rect(0,0,w,h);
+      cv::Ptr<cv::AKAZE> akaze = cv::AKAZE::create(cv::AKAZE::DESCRIPTOR_MLDB,0,3,feature_tol,4,4,cv::KAZE::DIFF_PM_G2);
+      std::vector<cv::KeyPoint> kpts;
+      cv::Mat desc;
+      akaze->detectAndCompute(data_->img(window), cv::noArray(), kpts, desc);
+      // keep the features in the core of the tile, strongest first if the number is capped
+      std::vector<std::pair<float,int> > keep;
+      for(size_t i=0;i<kpts.size();++i){
+        kpts[i].pt.x += window.x;
+        kpts[i].pt.y += window.y;
+        if(core.contains(cv::Point((int)kpts[i].pt.x,(int)kpts[i].pt.y)))
+          keep.push_back(std::pair<float,int>(-kpts[i].response,(int)i));
+      }
+      if(max_features_per_tile>0&&(int_t)keep.size()>max_features_per_tile){
+        std::sort(keep.begin(),keep.end());
+        keep.resize(max_features_per_tile);
+      }
+      tile_kpts[t].reserve(keep.size());
+      for(size_t i=0;i<keep.size();++i){
+        tile_kpts[t].push_back(kpts[keep[i].second]);
+        tile_desc[t].push_back(desc.row(keep[i].second));
+      }
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_feature_set_error)
+#endif
+      {
+        if(!detect_error) detect_error = std::current_exception();
+      }
+    }
+  }
+  if(detect_error) std::rethrow_exception(detect_error);
+  // gather the tiles in order so the features don't depend on the number of threads
+  for(size_t t=0;t<tiles.size();++t){
+    data_->kpts.insert(data_->kpts.end(),tile_kpts[t].begin(),tile_kpts[t].end());
+    data_->desc.push_back(tile_desc[t]);
+  }
+  DEBUG_MSG("Feature_Set::Feature_Set(): number of features: " << data_->kpts.size() << " in " << tiles.size() << " tiles");
+}
+
+int_t
+Feature_Set::num_features()const{
+  return data_->kpts.size();
+}
+
 DICE_LIB_DLL_EXPORT
-void match_features(Teuchos::RCP<Image> left_image,
-  Teuchos::RCP<Image> right_image,
+void match_features(const Feature_Set & left_features,
+  const Feature_Set & right_features,
   std::vector<scalar_t> & left_x,
   std::vector<scalar_t> & left_y,
   std::vector<scalar_t> & right_x,
   std::vector<scalar_t> & right_y,
-  const float & feature_tol,
+  const Feature_Matcher matcher,
   const std::string & result_image_name){
 
   left_x.clear();
@@ -64,48 +185,42 @@ void match_features(Teuchos::RCP<Image> left_image,
   right_x.clear();
   right_y.clear();
 
-  DEBUG_MSG("match_features(): initializing OpenCV Mats");
-  unsigned char * left_array = new unsigned char[left_image->width()*left_image->height()];
-  unsigned char * right_array = new unsigned char[right_image->width()*right_image->height()];
-  opencv_8UC1(left_image,left_array);
-  opencv_8UC1(right_image,right_array);
-  cv::Mat img1 =   cv::Mat(left_image->height(),left_image->width(),CV_8U,left_array);
-  cv::Mat img2 =   cv::Mat(right_image->height(),right_image->width(),CV_8U,right_array);
+  const Feature_Set_Data * left = left_features.data();
+  const Feature_Set_Data * right = right_features.data();
   const float nn_match_ratio = 0.6f;   // Nearest neighbor matching ratio
-  DEBUG_MSG("match_features(): detect and compute features");
-
-  std::vector<cv::KeyPoint> kpts1, kpts2;
-  cv::Mat desc1, desc2;
-  cv::Ptr<cv::AKAZE> akaze = cv::AKAZE::create(cv::AKAZE::DESCRIPTOR_MLDB,0,3,feature_tol,4,4,cv::KAZE::DIFF_PM_G2);
-  akaze->detectAndCompute(img1, cv::noArray(), kpts1, desc1);
-  akaze->detectAndCompute(img2, cv::noArray(), kpts2, desc2);
 
   DEBUG_MSG("match_features(): matching features");
 
-  cv::BFMatcher matcher(cv::NORM_HAMMING);
   std::vector< std::vector<cv::DMatch> > nn_matches;
-  matcher.knnMatch(desc1, desc2, nn_matches, 2);
+  if(!left->desc.empty()&&!right->desc.empty()){
+    if(matcher==FLANN_LSH_FEATURE_MATCHER){
+      // locality sensitive hashing index for the binary descriptors
+      cv::FlannBasedMatcher flann_matcher(cv::makePtr<cv::flann::LshIndexParams>(12,20,2));
+      flann_matcher.knnMatch(left->desc, right->desc, nn_matches, 2);
+    }
+    else{
+      cv::BFMatcher bf_matcher(cv::NORM_HAMMING);
+      bf_matcher.knnMatch(left->desc, right->desc, nn_matches, 2);
+    }
+  }
 
   DEBUG_MSG("match_features(): removing outliers");
 
-  std::vector<cv::KeyPoint> matched1, matched2, inliers1, inliers2;
+  std::vector<cv::KeyPoint> inliers1, inliers2;
   std::vector<cv::DMatch> good_matches;
   for(size_t i = 0; i < nn_matches.size(); i++) {
+    // the ratio test needs two neighbors (the lsh index can return fewer)
+    if(nn_matches[i].size()<2) continue;
     cv::DMatch first = nn_matches[i][0];
     float dist1 = nn_matches[i][0].distance;
     float dist2 = nn_matches[i][1].distance;
     if(dist1 < nn_match_ratio * dist2) {
-      matched1.push_back(kpts1[first.queryIdx]);
-      matched2.push_back(kpts2[first.trainIdx]);
+      int new_i = static_cast<int>(inliers1.size());
+      inliers1.push_back(left->kpts[first.queryIdx]);
+      inliers2.push_back(right->kpts[first.trainIdx]);
+      good_matches.push_back(cv::DMatch(new_i, new_i, 0));
     }
   }
-
-  for(unsigned i = 0; i < matched1.size(); i++) {
-    int new_i = static_cast<int>(inliers1.size());
-    inliers1.push_back(matched1[i]);
-    inliers2.push_back(matched2[i]);
-    good_matches.push_back(cv::DMatch(new_i, new_i, 0));
-  }
   assert(inliers1.size()==inliers2.size());
   DEBUG_MSG("match_features(): number of features matched: " << inliers1.size());
   if(inliers1.size()==0)
@@ -114,42 +229,66 @@ void match_features(Teuchos::RCP<Image> left_image,
   left_y.resize(inliers1.size(),0.0);
   right_x.resize(inliers1.size(),0.0);
   right_y.resize(inliers1.size(),0.0);
-  const scalar_t lox = left_image->offset_x();
-  const scalar_t loy = left_image->offset_y();
-  const scalar_t rox = right_image->offset_x();
-  const scalar_t roy = right_image->offset_y();
   for(unsigned i = 0; i < left_x.size(); i++) {
-    left_x[i] = inliers1[i].pt.x + lox;
-    left_y[i] = inliers1[i].pt.y + loy;
-    right_x[i] = inliers2[i].pt.x + rox;
-    right_y[i] = inliers2[i].pt.y + roy;
+    left_x[i] = inliers1[i].pt.x + left->offset_x;
+    left_y[i] = inliers1[i].pt.y + left->offset_y;
+    right_x[i] = inliers2[i].pt.x + right->offset_x;
+    right_y[i] = inliers2[i].pt.y + right->offset_y;
   }
   // draw results image if requested
-  if(result_image_name!=""){
+  if(result_image_name!=""&&!left->img.empty()&&!right->img.empty()){
     cv::Mat res;
-    cv::drawMatches(img1, inliers1, img2, inliers2, good_matches, res);
+    cv::drawMatches(left->img, inliers1, right->img, inliers2, good_matches, res);
     cv::imwrite(result_image_name.c_str(), res);
   }
+}
 
-  delete [] left_array;
+DICE_LIB_DLL_EXPORT
+void match_features(Teuchos::RCP<Image> left_image,
+  Teuchos::RCP<Image> right_image,
+  std::vector<scalar_t> & left_x,
+  std::vector<scalar_t> & left_y,
+  std::vector<scalar_t> & right_x,
+  std::vector<scalar_t> & right_y,
+  const float & feature_tol,
+  const std::string & result_image_name){
+  DEBUG_MSG("match_features(): detect and compute features");
+  Feature_Set left_features(left_image,feature_tol);
+  Feature_Set right_features(right_image,feature_tol);
+  match_features(left_features,right_features,left_x,left_y,right_x,right_y,BRUTE_FORCE_FEATURE_MATCHER,result_image_name);
 }
 
 void opencv_8UC1(Teuchos::RCP<Image> image, unsigned char * array){
+  opencv_8UC1(image,array,0,0,image->width(),image->height());
+}
+
+void opencv_8UC1(Teuchos::RCP<Image> image,
+  unsigned char * array,
+  const int_t x_begin,
+  const int_t y_begin,
+  const int_t width,
+  const int_t height){
+  TEUCHOS_TEST_FOR_EXCEPTION(x_begin<0||y_begin<0||x_begin+width>image->width()||y_begin+height>image->height(),std::invalid_argument,
+    "Error, the box to convert to 8 bit is outside the image");
   Teuchos::ArrayRCP<intensity_t> intensities = image->intensities();
   // need to scale the vaues to 0-255
   const int_t w = image->width();
-  const int_t h = image->height();
-  const int_t num_px = w*h;
   intensity_t max_intensity = -1.0E10;
   intensity_t min_intensity = 1.0E10;
-  for(int_t i=0; i<num_px; ++i){
-    if(intensities[i] > max_intensity) max_intensity = intensities[i];
-    if(intensities[i] < min_intensity) min_intensity = intensities[i];
+  for(int_t y=0; y<height; ++y){
+    const intensity_t * row = &intensities[(y+y_begin)*w+x_begin];
+    for(int_t x=0; x<width; ++x){
+      if(row[x] > max_intensity) max_intensity = row[x];
+      if(row[x] < min_intensity) min_intensity = row[x];
+    }
   }
   assert(max_intensity >= min_intensity);
   if(max_intensity <= 255 && min_intensity >=0){ // already in 8 bit range, no need to convert
-    for(int_t i=0; i<num_px; ++i)
-      array[i] = std::floor(intensities[i]);
+    for(int_t y=0; y<height; ++y){
+      const intensity_t * row = &intensities[(y+y_begin)*w+x_begin];
+      for(int_t x=0; x<width; ++x)
+        array[y*width+x] = std::floor(row[x]);
+    }
   }else{
     intensity_t fac = 1.0;
     if((max_intensity - min_intensity) != 0.0)
@@ -157,8 +296,11 @@ void opencv_8UC1(Teuchos::RCP<Image> image, unsigned char * array){
     DEBUG_MSG("opencv_8UC1(): max intensity: " << max_intensity << " min intensity: " << min_intensity << " converted max " << (std::floor((max_intensity-min_intensity)*fac)) <<
       " converted min " << (std::floor((min_intensity-min_intensity)*fac)));
     assert(std::floor((max_intensity-min_intensity)*fac)<=255);
-    for(int_t i=0; i<num_px; ++i)
-      array[i] = std::floor((intensities[i]-min_intensity)*fac);
+    for(int_t y=0; y<height; ++y){
+      const intensity_t * row = &intensities[(y+y_begin)*w+x_begin];
+      for(int_t x=0; x<width; ++x)
+        array[y*width+x] = std::floor((row[x]-min_intensity)*fac);
+    }
   }
 }
 
@@ -47,8 +47,67 @@
 
 #include <Teuchos_RCP.hpp>
 
+#include <vector>
+
 namespace DICe {
 
+/// opencv storage for the keypoints and descriptors (kept out of this header)
+struct Feature_Set_Data;
+
+/// \class DICe::Feature_Set
+/// \brief The AKAZE keypoints and descriptors detected in one image. A feature set
+/// can be matched against several others (for example the previous and next frames)
+/// without detecting the features again
+class DICE_LIB_DLL_EXPORT
+Feature_Set {
+public:
+  /// constructor that detects the features
+  /// \param image pointer to the image
+  /// \param feature_tol tolerance to use for AKAZE features
+  /// \param region only detect features inside this box in global image coordinates (x_min, y_min, x_max, y_max),
+  /// an empty vector uses the whole image
+  /// \param tile_size detect the features in square tiles of this size concurrently (0 detects the whole region at once)
+  /// \param max_features_per_tile keep only the strongest features in each tile (0 keeps all of them)
+  /// \param num_threads number of threads used to detect the features in the tiles
+  Feature_Set(Teuchos::RCP<Image> image,
+    const float & feature_tol=0.001f,
+    const std::vector<int_t> & region=std::vector<int_t>(),
+    const int_t tile_size=0,
+    const int_t max_features_per_tile=0,
+    const int_t num_threads=1);
+
+  /// returns the number of features detected
+  int_t num_features()const;
+
+  /// returns the opencv data (used by match_features)
+  const Feature_Set_Data * data()const{
+    return data_.get();
+  }
+
+private:
+  /// the opencv keypoints, descriptors and 8 bit image
+  Teuchos::RCP<Feature_Set_Data> data_;
+};
+
+/// Free function to match previously detected features
+/// \param left_features the features of the left image
+/// \param right_features the features of the right image
+/// \param left_x [out] image x coordinates in the left image for features
+/// \param left_y [out] image y coordinate in the left image for features
+/// \param right_x [out] image x coordinates in the right image for features
+/// \param right_y [out] image y coordinate in the right image for features
+/// \param matcher the descriptor matcher to use
+/// \param result_image_name output an image showing the matched features with this filename
+DICE_LIB_DLL_EXPORT
+void match_features(const Feature_Set & left_features,
+  const Feature_Set & right_features,
+  std::vector<scalar_t> & left_x,
+  std::vector<scalar_t> & left_y,
+  std::vector<scalar_t> & right_x,
+  std::vector<scalar_t> & right_y,
+  const Feature_Matcher matcher=BRUTE_FORCE_FEATURE_MATCHER,
+  const std::string & result_image_name="");
+
 /// Free function to match features from one DICe image to another
 /// \param left_image pointer to the left image
 /// \param right_image pointer to the right image
@@ -74,6 +133,21 @@ void match_features(Teuchos::RCP<Image> left_image,
 DICE_LIB_DLL_EXPORT
 void opencv_8UC1(Teuchos::RCP<Image> image, unsigned char * array);
 
+/// convert a box of a DICe Image to an opencv 8uc1 type array (the scaling uses the range of the box)
+/// \param image pointer to a DICe::Image
+/// \param array pointer to the value array (assumes already allocated to width*height)
+/// \param x_begin first column of the box (image pixel coordinates, not including the offset)
+/// \param y_begin first row of the box
+/// \param width number of columns in the box
+/// \param height number of rows in the box
+DICE_LIB_DLL_EXPORT
+void opencv_8UC1(Teuchos::RCP<Image> image,
+  unsigned char * array,
+  const int_t x_begin,
+  const int_t y_begin,
+  const int_t width,
+  const int_t height);
+
 
 
 }// End DICe Namespace
@@ -49,11 +49,22 @@
 
 #include <string>
 #include <algorithm>
+#include <exception>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <map>
+#include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 using namespace cv;
 using namespace std;
@@ -149,6 +160,87 @@ void project_grid_to_image(const Teuchos::SerialDenseMatrix<int_t,double> & proj
   yr = (proj_matrix(1,0)*xl + proj_matrix(1,1)*yl + proj_matrix(1,2))/(proj_matrix(2,0)*xl + proj_matrix(2,1)*yl + proj_matrix(2,2));
 }
 
+/// the cal target dots located in one image
+struct Cal_Detection{
+  /// return value of pre_process_cal_image()
+  int pre_code;
+  /// coordinates of the dots in image space
+  std::vector<Point2f> image_points;
+  /// coordinates of the dots on the board
+  std::vector<Point3f> object_points;
+  /// dimensions of the image
+  Size image_size;
+  Cal_Detection():pre_code(0){}
+};
+
+/// returns the key that identifies the dots located in an image with a set of pre-processing parameters,
+/// the key changes if the file is modified (empty if the file doesn't exist)
+/// \param file_name the name of the image file
+/// \param pre_params the pre-processing parameters
+std::string cal_detection_key(const std::string & file_name,
+  const Teuchos::ParameterList & pre_params){
+  struct stat file_stat;
+  if(stat(file_name.c_str(),&file_stat)!=0) return "";
+  std::stringstream key;
+  key.precision(12);
+  key << file_name << " | " << (long long)file_stat.st_mtime << " " << (long long)file_stat.st_size << " |";
+  key << " " << (pre_params.isParameter(cal_target_has_adaptive) ? pre_params.get<bool>(cal_target_has_adaptive) : false);
+  key << " " << (pre_params.isParameter(cal_target_is_inverted) ? pre_params.get<bool>(cal_target_is_inverted) : false);
+  key << " " << (pre_params.isParameter(cal_target_block_size) ? pre_params.get<double>(cal_target_block_size) : -1.0);
+  key << " " << (pre_params.isParameter(cal_target_binary_constant) ? pre_params.get<double>(cal_target_binary_constant) : -1.0);
+  key << " " << (pre_params.isParameter(cal_target_spacing_size) ? pre_params.get<double>(cal_target_spacing_size) : -1.0);
+  key << " " << (pre_params.isParameter(cal_target_downsample_factor) ? pre_params.get<int_t>(cal_target_downsample_factor) : 1);
+  return key.str();
+}
+
+/// reads the dots stored by write_cal_detections(), a missing or corrupt file leaves the map empty
+/// \param file_name the name of the detection cache file
+/// \param detections [out] the dots by key
+void read_cal_detections(const std::string & file_name,
+  std::map<std::string,Cal_Detection> & detections){
+  detections.clear();
+  std::ifstream in(file_name.c_str());
+  if(!in.good()) return;
+  std::string key;
+  while(std::getline(in,key)){
+    if(key.empty()) continue;
+    Cal_Detection det;
+    size_t num_points = 0;
+    in >> det.pre_code >> det.image_size.width >> det.image_size.height >> num_points;
+    det.image_points.resize(num_points);
+    det.object_points.resize(num_points);
+    for(size_t i=0;i<num_points;++i)
+      in >> det.image_points[i].x >> det.image_points[i].y >> det.object_points[i].x >> det.object_points[i].y >> det.object_points[i].z;
+    if(in.fail()){
+      DEBUG_MSG("read_cal_detections(): ignoring corrupt detection cache " << file_name);
+      detections.clear();
+      return;
+    }
+    in.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+    detections[key] = det;
+  }
+}
+
+/// writes the dots located in each image so they don't have to be located again
+/// \param file_name the name of the detection cache file
+/// \param detections the dots by key
+void write_cal_detections(const std::string & file_name,
+  const std::map<std::string,Cal_Detection> & detections){
+  std::ofstream out(file_name.c_str());
+  if(!out.good()){
+    std::cout << "warning, could not write the cal detection cache " << file_name << std::endl;
+    return;
+  }
+  out.precision(9);
+  for(std::map<std::string,Cal_Detection>::const_iterator it=detections.begin();it!=detections.end();++it){
+    const Cal_Detection & det = it->second;
+    out << it->first << "\n" << det.pre_code << " " << det.image_size.width << " " << det.image_size.height << " " << det.image_points.size() << "\n";
+    for(size_t i=0;i<det.image_points.size();++i)
+      out << det.image_points[i].x << " " << det.image_points[i].y << " "
+          << det.object_points[i].x << " " << det.object_points[i].y << " " << det.object_points[i].z << "\n";
+  }
+}
+
 DICE_LIB_DLL_EXPORT
 float
 StereoCalibDotTarget(Teuchos::RCP<Teuchos::ParameterList> pre_params,
@@ -180,48 +272,112 @@ StereoCalibDotTarget(Teuchos::RCP<Teuchos::ParameterList> pre_params,
   std::vector<std::vector<Point3f> > object_points;
   Size imageSize;
 
-  // iterate all the images in the set
+  // the dots located in each image are stored by file and target parameters so that re-running
+  // the calibration with other options doesn't have to locate them again
+  const std::string cache_file = pre_params->get<std::string>(DICe::cal_detection_cache,"cal_detections.txt");
+  std::map<std::string,Cal_Detection> cached_detections;
+  if(!cache_file.empty())
+    read_cal_detections(cache_file,cached_detections);
+  DEBUG_MSG("StereoCalibDotTarget(): " << cached_detections.size() << " cached detections in " << cache_file);
+
+  // gather the images that still need the dots located
+  std::vector<Cal_Detection> detections(num_images*2);
+  std::vector<std::string> detection_keys(num_images*2);
+  std::vector<int_t> to_detect;
+  int_t num_cached = 0;
   for(int_t i=0;i<num_images;++i){
     if(skip_ids.find(i)!=skip_ids.end()) continue;
-    std::vector<Point2f> pre_image_points_left;
-    std::vector<Point3f> pre_object_points_left;
-    std::vector<Point2f> pre_image_points_right;
-    std::vector<Point3f> pre_object_points_right;
+    for(int_t k=0;k<2;k++){
+      const int_t index = i*2+k;
+      detection_keys[index] = cache_file.empty() ? "" : cal_detection_key(imagelist[index],*pre_params);
+      std::map<std::string,Cal_Detection>::const_iterator it = detection_keys[index].empty() ? cached_detections.end() : cached_detections.find(detection_keys[index]);
+      if(it!=cached_detections.end()){
+        detections[index] = it->second;
+        num_cached++;
+      }
+      else
+        to_detect.push_back(index);
+    }
+  }
+
+  // locate the dots in the images concurrently, each thread gets its own copy of the
+  // parameters since pre_process_cal_image() adds the defaults to the list
+  int_t num_threads = 1;
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+  num_threads = pre_params->get<int_t>(DICe::num_threads,num_threads);
+  TEUCHOS_TEST_FOR_EXCEPTION(num_threads<1,std::runtime_error,"Error, num_threads must be greater than 0");
+  std::vector<Teuchos::RCP<Teuchos::ParameterList> > thread_params(num_threads);
+  for(int_t t=0;t<num_threads;++t)
+    thread_params[t] = Teuchos::rcp(new Teuchos::ParameterList(*pre_params));
+  std::cout << "locating the cal dots in " << to_detect.size() << " images (" << num_cached << " cached) using " << num_threads << " threads" << std::endl;
+  std::exception_ptr detection_error;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic,1) if(num_threads>1)
+#endif
+  for(int_t n=0;n<(int_t)to_detect.size();++n){
+    try{
+      int_t thread_id = 0;
+#ifdef _OPENMP
+      thread_id = omp_get_thread_num();
+#endif
+      Cal_Detection & det = detections[to_detect[n]];
+      det.pre_code = pre_process_cal_image(imagelist[to_detect[n]],"",thread_params[thread_id],det.image_points,det.object_points,det.image_size);
+    }
+    catch(...){
+#ifdef _OPENMP
+#pragma omp critical(dice_stereo_calib_error)
+#endif
+      {
+        if(!detection_error) detection_error = std::current_exception();
+      }
+    }
+  }
+  if(detection_error) std::rethrow_exception(detection_error);
+
+  if(!cache_file.empty()&&!to_detect.empty()){
+    for(size_t n=0;n<to_detect.size();++n){
+      // load failures and parameter errors are not stored so they are retried
+      const int pre_code = detections[to_detect[n]].pre_code;
+      if(detection_keys[to_detect[n]].empty()||pre_code==-1||pre_code==-4) continue;
+      cached_detections[detection_keys[to_detect[n]]] = detections[to_detect[n]];
+    }
+    write_cal_detections(cache_file,cached_detections);
+  }
 
+  // iterate all the images in the set
+  for(int_t i=0;i<num_images;++i){
+    if(skip_ids.find(i)!=skip_ids.end()) continue;
     for(int_t k=0;k<2;k++){ // k represents 0 for the left image 1 for the right
       const string& filename = imagelist[i*2+k];
       std::cout << "processing cal image " << filename << std::endl;
+      const Cal_Detection & det = detections[i*2+k];
+      if(det.image_size.width>0) imageSize = det.image_size;
 
-      // find the cal dot points and check show a preview of their locations
-      int pre_code = 0;
-
-      if(k==0)
-        pre_code = pre_process_cal_image(filename,"",pre_params,pre_image_points_left,pre_object_points_left,imageSize);
-      else
-        pre_code = pre_process_cal_image(filename,"",pre_params,pre_image_points_right,pre_object_points_right,imageSize);
-
-      DEBUG_MSG("pre_process_cal_image return value: " << pre_code);
-      if(pre_code!=0){
+      DEBUG_MSG("pre_process_cal_image return value: " << det.pre_code);
+      if(det.pre_code!=0){
         std::cout << "error, pre-processing image for cal dot locations failed" << std::endl;
         image_success[i] = false;
         break;
       }
-      if((k==0&&pre_object_points_left.size()<4)||(k==1&&pre_object_points_right.size()<4)){
+      if(det.object_points.size()<4){
         std::cout << "error, failed to locate enough dots" << std::endl;
         image_success[i] = false;
         break;
       }
       if(k==1){
+        const Cal_Detection & left = detections[i*2];
         image_points_left.resize(image_points_left.size()+1);
         image_points_right.resize(image_points_right.size()+1);
         object_points.resize(object_points.size()+1);
         // check for matching points between the two images and push those back on the accumulated set of points
-        for(size_t n=0;n<pre_object_points_left.size();++n){
-          for(size_t m=0;m<pre_object_points_right.size();++m){
-            if(pre_object_points_left[n]==pre_object_points_right[m]){
-                image_points_left[image_points_left.size()-1].push_back(pre_image_points_left[n]);
-                image_points_right[image_points_right.size()-1].push_back(pre_image_points_right[m]);
-                object_points[object_points.size()-1].push_back(pre_object_points_right[m]);
+        for(size_t n=0;n<left.object_points.size();++n){
+          for(size_t m=0;m<det.object_points.size();++m){
+            if(left.object_points[n]==det.object_points[m]){
+                image_points_left[image_points_left.size()-1].push_back(left.image_points[n]);
+                image_points_right[image_points_right.size()-1].push_back(det.image_points[m]);
+                object_points[object_points.size()-1].push_back(det.object_points[m]);
                 break;
             }
           } // loop over right image points
@@ -382,8 +538,90 @@ float compute_cal_matrices(std::vector<std::vector<Point3f> > & object_points,
   return rms;
 }
 
+/// moves the cal dots located in a downsampled image to their full resolution locations by thresholding
+/// a window of the full resolution image around each dot, returns false if a dot can't be found
+/// \param img the full resolution image
+/// \param has_adaptive true if an adaptive threshold is used
+/// \param filter_mode the adaptive threshold method
+/// \param inverted_mode the threshold type
+/// \param block_size the adaptive threshold block size in full resolution pixels
+/// \param binary_constant the threshold constant
+/// \param downsample the factor the image was downsampled by to locate the dots
+/// \param grid_spacing the approximate distance between dots in full resolution pixels
+/// \param num_markers the number of marker dots at the front of image_points (these have holes)
+/// \param image_points [in/out] the dot locations in downsampled coordinates on input and full resolution coordinates on output
+bool refine_cal_dots(const Mat & img,
+  const bool has_adaptive,
+  const int filter_mode,
+  const int inverted_mode,
+  const double block_size,
+  const double binary_constant,
+  const int_t downsample,
+  const float grid_spacing,
+  const size_t num_markers,
+  std::vector<Point2f> & image_points){
+  // the window is padded so the threshold in the middle is the same as for the whole image
+  const int half_width = std::max(3,(int)(0.5*grid_spacing));
+  const int pad = (int)(block_size/2) + 5;
+  const Rect image_rect(0,0,img.cols,img.rows);
+  for(size_t n=0;n<image_points.size();++n){
+    // center of the downsampled pixel in full resolution coordinates
+    const float px = (image_points[n].x + 0.5f)*downsample - 0.5f;
+    const float py = (image_points[n].y + 0.5f)*downsample - 0.5f;
+    const Rect window = Rect((int)px-half_width-pad,(int)py-half_width-pad,2*(half_width+pad)+1,2*(half_width+pad)+1) & image_rect;
+    if(window.area()==0) return false;
+    // the blur uses the pixels outside the window since img(window) is a view into the whole image
+    Mat binary_img;
+    GaussianBlur(img(window), binary_img, Size(9, 9), 2, 2 );
+    if(has_adaptive)
+      adaptiveThreshold(binary_img,binary_img,255,filter_mode,inverted_mode,block_size,binary_constant);
+    else
+      threshold(binary_img, binary_img, binary_constant, 255, inverted_mode);
+    std::vector<std::vector<Point> > contours;
+    std::vector<Vec4i> hierarchy;
+    findContours(binary_img, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_NONE, window.tl());
+    // take the closest contour with the same hierarchy as the dot in the downsampled image
+    const bool is_marker = n<num_markers;
+    float best_dist = (float)half_width*half_width;
+    bool found = false;
+    for(size_t idx=0;idx<contours.size();++idx){
+      if(hierarchy[idx][3]==-1||(hierarchy[idx][2]!=-1)!=is_marker||contours[idx].empty()) continue;
+      float cx = 0.0;
+      float cy = 0.0;
+      for(size_t i=0;i<contours[idx].size();++i){
+        cx += contours[idx][i].x;
+        cy += contours[idx][i].y;
+      }
+      cx /= (float)contours[idx].size();
+      cy /= (float)contours[idx].size();
+      const float dist = (cx-px)*(cx-px) + (cy-py)*(cy-py);
+      if(dist<best_dist){
+        best_dist = dist;
+        image_points[n] = Point2f(cx,cy);
+        found = true;
+      }
+    }
+    if(!found){
+      DEBUG_MSG("refine_cal_dots(): could not locate dot " << n << " near " << px << " " << py);
+      return false;
+    }
+  }
+  return true;
+}
+
 DICE_LIB_DLL_EXPORT
 int pre_process_cal_image(const std::string & image_filename,
+  const std::string & output_image_filename,
+  Teuchos::RCP<Teuchos::ParameterList> pre_process_params,
+  std::vector<Point2f> & image_points,
+  std::vector<Point3f> & object_points,
+  Size & imageSize){
+  // load the image as an openCV mat
+  Mat img = imread(image_filename, IMREAD_GRAYSCALE);
+  return pre_process_cal_image(img,output_image_filename,pre_process_params,image_points,object_points,imageSize);
+}
+
+int pre_process_cal_image(const Mat & img,
   const std::string & output_image_filename,
   Teuchos::RCP<Teuchos::ParameterList> pre_process_params,
   std::vector<Point2f> & image_points,
@@ -419,13 +657,13 @@ int pre_process_cal_image(const std::string & image_filename,
     return -1;
   }
   const double binaryConstant = pre_process_params->get<double>("cal_target_binary_constant");
+  // the target is located in an image downsampled by this factor and the dots are then refined at full resolution
+  const int_t downsample = pre_process_params->get<int_t>(DICe::cal_target_downsample_factor,1);
+  if(downsample<1){
+    std::cout << "error, cal_target_downsample_factor must be greater than 0" << std::endl;
+    return -1;
+  }
 
-  // load the image as an openCV mat
-  Mat img = imread(image_filename, IMREAD_GRAYSCALE);
-  Mat binary_img(img.size(),CV_8UC3);
-  Mat out_img(img.size(), CV_8UC3);
-  //Mat bi_copy_img(img.size(), CV_8UC3);
-  cvtColor(img, out_img, CV_GRAY2RGB);
   if(img.empty()){
     std::cout << "error, the image is empty" << std::endl;
     return -4;
@@ -435,12 +673,29 @@ int pre_process_cal_image(const std::string & image_filename,
     return -4;
   }
   imageSize = img.size();
-  // blur the image to remove noise
-  GaussianBlur(img, binary_img, Size(9, 9), 2, 2 );
+  // image used to locate the target and the matching pixel sizes
+  Mat work_img = img;
+  double work_block_size = blockSize;
+  float axis_tol = 10.0;
+  if(downsample>1){
+    resize(img, work_img, Size(), 1.0/downsample, 1.0/downsample, INTER_AREA);
+    // the adaptive block size has to stay odd and greater than one
+    work_block_size = 2*std::max(1,(int)(blockSize/downsample/2)) + 1;
+    axis_tol = std::max(2.0f,axis_tol/downsample);
+  }
+  Mat binary_img(work_img.size(),CV_8UC3);
+  Mat out_img(work_img.size(), CV_8UC3);
+  //Mat bi_copy_img(img.size(), CV_8UC3);
+  cvtColor(work_img, out_img, CV_GRAY2RGB);
+  // blur the image to remove noise (the downsampling already averages the pixels)
+  if(downsample>1)
+    GaussianBlur(work_img, binary_img, Size(0, 0), 2.0/downsample, 2.0/downsample );
+  else
+    GaussianBlur(work_img, binary_img, Size(9, 9), 2, 2 );
   //medianBlur ( median_img, median_img, 7 );
   // binary threshold to create black and white image
   if(has_adaptive)
-    adaptiveThreshold(binary_img,binary_img,255,filterMode,invertedMode,blockSize,binaryConstant);
+    adaptiveThreshold(binary_img,binary_img,255,filterMode,invertedMode,work_block_size,binaryConstant);
   else
     threshold(binary_img, binary_img, binaryConstant, 255, invertedMode);
   //threshold(binary_img, binary_img, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
@@ -686,7 +941,6 @@ int pre_process_cal_image(const std::string & image_filename,
   circle(out_img,Point(trimmed_dot_cx[opp_id],trimmed_dot_cy[opp_id]),20,Scalar(100,255,100),-1);
 
   // determine the pattern size
-  float axis_tol = 10.0;
   int pattern_width = 0;
   int pattern_height = 0;
   const float dist_xaxis_dot = dist_from_line(marker_dots[xaxis_id].pt.x,marker_dots[xaxis_id].pt.y,marker_dots[yaxis_id].pt.x,marker_dots[yaxis_id].pt.y,marker_dots[origin_id].pt.x,marker_dots[origin_id].pt.y);
@@ -763,7 +1017,7 @@ int pre_process_cal_image(const std::string & image_filename,
       float image_x = 0.0;
       float image_y = 0.0;
       project_grid_to_image(proj_matrix,grid_x,grid_y,image_x,image_y);
-      if(image_x<=5||image_y<=5||image_x>=img.cols-5||image_y>=img.rows-5) continue;
+      if(image_x<=5||image_y<=5||image_x>=work_img.cols-5||image_y>=work_img.rows-5) continue;
       // skip the axis and origin points
       if(i==0&&j==0) continue;
       if(i==pattern_width-1&&j==0) continue;
@@ -803,6 +1057,11 @@ int pre_process_cal_image(const std::string & image_filename,
     std::cout << "error, not enough points located" << std::endl;
     return -3;
   }
+  if(downsample>1&&!refine_cal_dots(img,has_adaptive,filterMode,invertedMode,blockSize,binaryConstant,downsample,
+    std::abs(rough_grid_spacing)*downsample,3,image_points)){
+    std::cout << "error, the dots could not be located in the full resolution image" << std::endl;
+    return -3;
+  }
   return 0;
 }
 
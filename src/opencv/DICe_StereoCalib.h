@@ -85,6 +85,22 @@ int pre_process_cal_image(const std::string & image_filename,
   std::vector<cv::Point3f> & object_points,
   cv::Size & imageSize);
 
+/// pre-processing for CalPreview on an image that has already been loaded (8 bit grayscale),
+/// see the file name version above for the details
+/// \param img the image to search for cal target points in (not modified)
+/// \param output_image_filename the name of the debugging output file that shows the location of the dots
+/// \param pre_process_params parameters that define the binary threshold, etc.
+/// \param image_points [out] returns the coordinates of the cal dots in image space
+/// \param object_points [out] returns the coordinates of the cal dots on the board (physical or model space)
+/// \param imageSize [out] returns the size of the images
+DICE_LIB_DLL_EXPORT
+int pre_process_cal_image(const cv::Mat & img,
+  const std::string & output_image_filename,
+  Teuchos::RCP<Teuchos::ParameterList> pre_process_params,
+  std::vector<cv::Point2f> & image_points,
+  std::vector<cv::Point3f> & object_points,
+  cv::Size & imageSize);
+
 /// free function to compute the calibration matrices
 /// \param object_points the cal target dot coordinates
 /// \param image_points_left the location of the dots in the left image
@@ -41,6 +41,10 @@
 
 #include <cassert>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <stdint.h>
 
 #include <DICe_ImageIO.h>
 #include <DICe_Rawi.h>
@@ -50,6 +54,7 @@
 
 #include <boost/gil/gil_all.hpp>
 #include <boost/gil/extension/io/tiff_dynamic_io.hpp>
+#include <tiffio.h>
 #if DICE_JPEG
   #include <boost/gil/extension/io/jpeg_dynamic_io.hpp>
 #endif
@@ -62,20 +67,49 @@
 namespace DICe{
 namespace utils{
 
-DICE_LIB_DLL_EXPORT
-std::string netcdf_file_name(const char * decorated_netcdf_file){
-  std::string netcdf_string(decorated_netcdf_file);
+/// returns the name of a file decorated with _frame_<index> before the extension
+/// \param decorated_file the decorated file name
+/// \param ext the file extension
+static std::string frame_file_name(const char * decorated_file,
+  const std::string & ext){
+  std::string file_string(decorated_file);
   // trim off the last underscore and the rest
-  size_t found = netcdf_string.find("_frame_");
+  size_t found = file_string.find("_frame_");
   if(found==std::string::npos){
-    return netcdf_string;
+    return file_string;
   }
-  std::string file_name = netcdf_string.substr(0,found);
-  // add the .cine extension back
-  file_name+=".nc";
+  std::string file_name = file_string.substr(0,found);
+  // add the extension back
+  file_name+=ext;
   return file_name;
 }
 
+/// returns the index from a file name decorated with _frame_<index> before the extension
+/// \param decorated_file the decorated file name
+/// \param ext the file extension
+static int_t frame_index(const char * decorated_file,
+  const std::string & ext){
+  std::string file_string(decorated_file);
+  // trim off the last underscore and the rest
+  size_t found = file_string.find("_frame_");
+  if(found==std::string::npos) return 0;
+  size_t found_underscore = file_string.find_last_of("_");
+  size_t found_ext = file_string.find(ext);
+  std::string first_num_str = file_string.substr(found_underscore+1,found_ext - found_underscore - 1);
+  DEBUG_MSG("frame_index(): " << first_num_str);
+  return std::strtol(first_num_str.c_str(),NULL,0);
+}
+
+DICE_LIB_DLL_EXPORT
+std::string netcdf_file_name(const char * decorated_netcdf_file){
+  return frame_file_name(decorated_netcdf_file,".nc");
+}
+
+DICE_LIB_DLL_EXPORT
+std::string rawv_file_name(const char * decorated_rawv_file){
+  return frame_file_name(decorated_rawv_file,".rawv");
+}
+
 DICE_LIB_DLL_EXPORT
 std::string cine_file_name(const char * decorated_cine_file){
   std::string cine_string(decorated_cine_file);
@@ -89,15 +123,12 @@ std::string cine_file_name(const char * decorated_cine_file){
 
 DICE_LIB_DLL_EXPORT
 int_t netcdf_index(const char * decorated_netcdf_file){
-  std::string netcdf_string(decorated_netcdf_file);
-  // trim off the last underscore and the rest
-  size_t found = netcdf_string.find("_frame_");
-  if(found==std::string::npos) return 0;
-  size_t found_underscore = netcdf_string.find_last_of("_");
-  size_t found_ext = netcdf_string.find(".nc");
-  std::string first_num_str = netcdf_string.substr(found_underscore+1,found_ext - found_underscore - 1);
-  DEBUG_MSG("netcdf_index(): " << first_num_str);
-  return std::strtol(first_num_str.c_str(),NULL,0);
+  return frame_index(decorated_netcdf_file,".nc");
+}
+
+DICE_LIB_DLL_EXPORT
+int_t rawv_index(const char * decorated_rawv_file){
+  return frame_index(decorated_rawv_file,".rawv");
 }
 
 DICE_LIB_DLL_EXPORT
@@ -142,6 +173,9 @@ Image_File_Type image_file_type(const char * file_name){
   const std::string rawi(".rawi");
   if(file_str.find(rawi)!=std::string::npos)
     return RAWI;
+  const std::string rawv(".rawv");
+  if(file_str.find(rawv)!=std::string::npos)
+    return RAWV;
   const std::string cine(".cine");
   if(file_str.find(cine)!=std::string::npos)
     return CINE;
@@ -168,6 +202,147 @@ Image_File_Type image_file_type(const char * file_name){
   return file_type;
 }
 
+/// closes a libtiff handle when it goes out of scope
+struct Tiff_Handle{
+  explicit Tiff_Handle(TIFF * tif):tif_(tif){};
+  ~Tiff_Handle(){if(tif_) TIFFClose(tif_);}
+  TIFF * tif_;
+};
+
+/// copy a block of decoded tiff samples into the intensity array
+/// (only the part of the block inside the requested region is copied)
+template <typename T>
+void copy_tiff_block(const T * block,
+  const int_t block_x,
+  const int_t block_y,
+  const int_t block_w,
+  const int_t block_h,
+  const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const bool convert_to_8_bit){
+  const int_t x_begin = std::max(block_x,offset_x);
+  const int_t x_end = std::min(block_x+block_w,offset_x+width);
+  const int_t y_begin = std::max(block_y,offset_y);
+  const int_t y_end = std::min(block_y+block_h,offset_y+height);
+  // 16 bit samples are scaled the same way boost gil converts them to 8 bit
+  const bool scale = convert_to_8_bit && sizeof(T)==2;
+  for(int_t y=y_begin;y<y_end;++y){
+    const T * src = block + (y-block_y)*block_w;
+    for(int_t x=x_begin;x<x_end;++x){
+      const T sample = src[x-block_x];
+      const intensity_t value = scale ? (intensity_t)((sample+128)/257) : (intensity_t)sample;
+      if(is_layout_right)
+        intensities[(y-offset_y)*width + x-offset_x] = value;
+      else
+        intensities[(x-offset_x)*height + y-offset_y] = value;
+    }
+  }
+}
+
+/// read a portion of a tiff file directly with libtiff, only the strips or tiles that intersect
+/// the region are decoded and the samples go straight into the intensity array (12 and 16 bit data
+/// is preserved unless convert_to_8_bit is set). Returns false if the file is not a single channel,
+/// unsigned 8 or 16 bit image, in which case the caller should fall back to boost gil
+/// \param file_name the name of the tiff file
+/// \param offset_x the upper left corner x-coordinate of the region
+/// \param offset_y the upper left corner y-coordinate of the region
+/// \param width width of the region (-1 reads to the right edge of the image)
+/// \param height height of the region (-1 reads to the bottom of the image)
+/// \param intensities [out] populated with the image intensities
+/// \param is_layout_right memory layout is LayoutRight (row-major)
+/// \param convert_to_8_bit if true 16 bit values will be scaled to fit in the 8 bit range (0-255)
+static bool read_tiff_region(const char * file_name,
+  const int_t offset_x,
+  const int_t offset_y,
+  int_t width,
+  int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const bool convert_to_8_bit){
+  TIFFSetWarningHandler(NULL);
+  Tiff_Handle handle(TIFFOpen(file_name,"r"));
+  TIFF * tif = handle.tif_;
+  if(!tif){
+    std::cerr << "Error, unable to open tiff file: " << file_name << "\n";
+    throw std::exception();
+  }
+  uint32_t img_w = 0, img_h = 0;
+  uint16_t bits_per_sample = 0, samples_per_pixel = 0, sample_format = 0, planar_config = 0, photometric = 0;
+  TIFFGetField(tif,TIFFTAG_IMAGEWIDTH,&img_w);
+  TIFFGetField(tif,TIFFTAG_IMAGELENGTH,&img_h);
+  TIFFGetFieldDefaulted(tif,TIFFTAG_BITSPERSAMPLE,&bits_per_sample);
+  TIFFGetFieldDefaulted(tif,TIFFTAG_SAMPLESPERPIXEL,&samples_per_pixel);
+  TIFFGetFieldDefaulted(tif,TIFFTAG_SAMPLEFORMAT,&sample_format);
+  TIFFGetFieldDefaulted(tif,TIFFTAG_PLANARCONFIG,&planar_config);
+  if(!TIFFGetField(tif,TIFFTAG_PHOTOMETRIC,&photometric))
+    return false;
+  if(samples_per_pixel!=1||(bits_per_sample!=8&&bits_per_sample!=16)||sample_format!=SAMPLEFORMAT_UINT
+      ||planar_config!=PLANARCONFIG_CONTIG||photometric!=PHOTOMETRIC_MINISBLACK){
+    DEBUG_MSG("read_tiff_region(): tiff layout not supported by the direct reader, bits per sample " << bits_per_sample <<
+      " samples per pixel " << samples_per_pixel << " photometric " << photometric);
+    return false;
+  }
+  if(width<0) width = (int_t)img_w - offset_x;
+  if(height<0) height = (int_t)img_h - offset_y;
+  if(offset_x<0||offset_y<0||width<=0||height<=0||offset_x+width>(int_t)img_w||offset_y+height>(int_t)img_h){
+    std::cerr << "Error, the requested region (" << offset_x << "," << offset_y << ") " << width << " x " << height <<
+      " is outside the image " << img_w << " x " << img_h << " for file: " << file_name << "\n";
+    throw std::exception();
+  }
+  const bool is_16_bit = bits_per_sample==16;
+  if(TIFFIsTiled(tif)){
+    uint32_t tile_w = 0, tile_h = 0;
+    TIFFGetField(tif,TIFFTAG_TILEWIDTH,&tile_w);
+    TIFFGetField(tif,TIFFTAG_TILELENGTH,&tile_h);
+    assert(tile_w>0&&tile_h>0);
+    std::vector<unsigned char> buffer(TIFFTileSize(tif));
+    const int_t tile_x_begin = (offset_x/tile_w)*tile_w;
+    const int_t tile_y_begin = (offset_y/tile_h)*tile_h;
+    for(int_t ty=tile_y_begin;ty<offset_y+height;ty+=tile_h){
+      for(int_t tx=tile_x_begin;tx<offset_x+width;tx+=tile_w){
+        if(TIFFReadEncodedTile(tif,TIFFComputeTile(tif,tx,ty,0,0),&buffer[0],(tsize_t)-1)<0){
+          std::cerr << "Error, unable to decode tile (" << tx << "," << ty << ") in tiff file: " << file_name << "\n";
+          throw std::exception();
+        }
+        // edge tiles are padded to the full tile size
+        if(is_16_bit)
+          copy_tiff_block(reinterpret_cast<const uint16_t*>(&buffer[0]),tx,ty,tile_w,tile_h,
+            offset_x,offset_y,width,height,intensities,is_layout_right,convert_to_8_bit);
+        else
+          copy_tiff_block(reinterpret_cast<const uint8_t*>(&buffer[0]),tx,ty,tile_w,tile_h,
+            offset_x,offset_y,width,height,intensities,is_layout_right,convert_to_8_bit);
+      }
+    }
+  }
+  else{
+    uint32_t rows_per_strip = 0;
+    TIFFGetFieldDefaulted(tif,TIFFTAG_ROWSPERSTRIP,&rows_per_strip);
+    if(rows_per_strip==0||rows_per_strip>img_h) rows_per_strip = img_h;
+    std::vector<unsigned char> buffer(TIFFStripSize(tif));
+    const int_t strip_begin = offset_y/rows_per_strip;
+    const int_t strip_end = (offset_y+height-1)/rows_per_strip;
+    for(int_t strip=strip_begin;strip<=strip_end;++strip){
+      if(TIFFReadEncodedStrip(tif,(uint32_t)strip,&buffer[0],(tsize_t)-1)<0){
+        std::cerr << "Error, unable to decode strip " << strip << " in tiff file: " << file_name << "\n";
+        throw std::exception();
+      }
+      const int_t strip_y = strip*rows_per_strip;
+      const int_t strip_h = std::min((int_t)rows_per_strip,(int_t)img_h-strip_y);
+      if(is_16_bit)
+        copy_tiff_block(reinterpret_cast<const uint16_t*>(&buffer[0]),0,strip_y,img_w,strip_h,
+          offset_x,offset_y,width,height,intensities,is_layout_right,convert_to_8_bit);
+      else
+        copy_tiff_block(reinterpret_cast<const uint8_t*>(&buffer[0]),0,strip_y,img_w,strip_h,
+          offset_x,offset_y,width,height,intensities,is_layout_right,convert_to_8_bit);
+    }
+  }
+  return true;
+}
+
 DICE_LIB_DLL_EXPORT
 void read_image_dimensions(const char * file_name,
   int_t & width,
@@ -183,6 +358,11 @@ void read_image_dimensions(const char * file_name,
   if(file_type==RAWI){
     read_rawi_image_dimensions(file_name,width,height);
   }
+  else if(file_type==RAWV){
+    Teuchos::RCP<Rawv_Reader> reader = Image_Reader_Cache::instance().rawv_reader(rawv_file_name(file_name));
+    width = reader->width();
+    height = reader->height();
+  }
   else if(file_type==CINE){
     const std::string cine_file = cine_file_name(file_name);
     DEBUG_MSG("read_image_dimensions(): cine file name: " << cine_file);
@@ -213,21 +393,21 @@ void read_image_dimensions(const char * file_name,
 #endif
 #if DICE_ENABLE_NETCDF
   else if(file_type==NETCDF){
-    netcdf::NetCDF_Reader netcdf_reader;
     int_t num_time_steps = 0;
     const std::string netcdf_file = netcdf_file_name(file_name);
     DEBUG_MSG("read_image_dimensions(): netcdf file name: " << netcdf_file);
-    netcdf_reader.get_image_dimensions(netcdf_file,width,height,num_time_steps);
+    std::lock_guard<std::mutex> reader_lock(Image_Reader_Cache::instance().reader_mutex(Image_Reader_Cache::netcdf_mutex_id()));
+    Image_Reader_Cache::instance().netcdf_reader(netcdf_file)->get_image_dimensions(netcdf_file,width,height,num_time_steps);
   }
 #endif
 }
 
-DICE_LIB_DLL_EXPORT
-void read_image(const char * file_name,
+/// read a whole image without checking the frame cache
+static void read_image_uncached(const char * file_name,
   intensity_t * intensities,
   const bool is_layout_right,
-    const bool convert_to_8_bit,
-    const bool filter_failed_pixels){
+  const bool convert_to_8_bit,
+  const bool filter_failed_pixels){
   // determine the file type based on the file_name
   Image_File_Type file_type = image_file_type(file_name);
   if(file_type==NO_SUCH_IMAGE_FILE_TYPE){
@@ -237,6 +417,9 @@ void read_image(const char * file_name,
   if(file_type==RAWI){
     read_rawi_image(file_name,intensities,is_layout_right);
   }
+  else if(file_type==RAWV){
+    Image_Reader_Cache::instance().rawv_reader(rawv_file_name(file_name))->read_frame(rawv_index(file_name),intensities,is_layout_right);
+  }
   else if(file_type==CINE){
     const std::string cine_file = cine_file_name(file_name);
     DEBUG_MSG("read_image(): cine file name: " << cine_file);
@@ -250,6 +433,7 @@ void read_image(const char * file_name,
     const int_t width = reader->width();
     const int_t height = reader->height();
     Image_Reader_Cache::instance().set_filter_failed_pixels(filter_failed_pixels);
+    std::lock_guard<std::mutex> reader_lock(Image_Reader_Cache::instance().reader_mutex(cine_file));
     if(start_index < reader->first_image_number() || start_index > reader->first_image_number() + reader->num_frames()){
       std::cerr << "Error, invalid start index " << start_index <<", less than first frame in cine file " << reader->first_image_number() <<
           " or greater than last frame " << reader->first_image_number() + reader->num_frames() << std::endl;
@@ -262,7 +446,8 @@ void read_image(const char * file_name,
     }
     if(is_avg){
       reader->get_average_frame(start_index-reader->first_image_number(),end_index-reader->first_image_number(),
-        0,0,width,height,intensities,is_layout_right,filter_failed_pixels,convert_to_8_bit);
+        0,0,width,height,intensities,is_layout_right,filter_failed_pixels,convert_to_8_bit,
+        Image_Reader_Cache::instance().num_threads());
     }else{
       reader->get_frame(0,0,width,height,intensities,is_layout_right,start_index-reader->first_image_number(),filter_failed_pixels,convert_to_8_bit);
     }
@@ -270,13 +455,16 @@ void read_image(const char * file_name,
 #ifdef DICE_ENABLE_NETCDF
   /// check if the file is a netcdf file
   else if(file_type==NETCDF){
-    netcdf::NetCDF_Reader netcdf_reader;
     const std::string netcdf_file = netcdf_file_name(file_name);
     const int_t index = netcdf_index(file_name);
-    netcdf_reader.read_netcdf_image(netcdf_file.c_str(),intensities,index,is_layout_right);
+    std::lock_guard<std::mutex> reader_lock(Image_Reader_Cache::instance().reader_mutex(Image_Reader_Cache::netcdf_mutex_id()));
+    Image_Reader_Cache::instance().netcdf_reader(netcdf_file)->read_netcdf_image(netcdf_file.c_str(),intensities,index,is_layout_right);
   }
 #endif
-  else if(file_type==TIFF||file_type==TIFF||file_type==JPEG||file_type==PNG){
+  else if(file_type==TIFF&&read_tiff_region(file_name,0,0,-1,-1,intensities,is_layout_right,convert_to_8_bit)){
+    DEBUG_MSG("read_image(): tiff file read directly with libtiff");
+  }
+  else if(file_type==TIFF||file_type==JPEG||file_type==PNG){
     boost::gil::gray8_image_t img;
     if(file_type==TIFF){
       TIFFSetWarningHandler(NULL);
@@ -313,8 +501,8 @@ void read_image(const char * file_name,
   }
 }
 
-DICE_LIB_DLL_EXPORT
-void read_image(const char * file_name,
+/// read a portion of an image without checking the frame cache
+static void read_image_uncached(const char * file_name,
   int_t offset_x,
   int_t offset_y,
   int_t width,
@@ -330,8 +518,11 @@ void read_image(const char * file_name,
     throw std::exception();
   }
   if(file_type==RAWI){
-    std::cerr << "Error, reading only a portion of an image is not supported for rawi, file name: " << file_name << "\n";
-    throw std::exception();
+    read_rawi_image(file_name,offset_x,offset_y,width,height,intensities,is_layout_right);
+  }
+  else if(file_type==RAWV){
+    Image_Reader_Cache::instance().rawv_reader(rawv_file_name(file_name))->read_frame(rawv_index(file_name),
+      offset_x,offset_y,width,height,intensities,is_layout_right);
   }
   else if(file_type==CINE){
     const std::string cine_file = cine_file_name(file_name);
@@ -343,9 +534,11 @@ void read_image(const char * file_name,
     // get the image dimensions
     Teuchos::RCP<DICe::cine::Cine_Reader> reader = Image_Reader_Cache::instance().cine_reader(cine_file);
     Image_Reader_Cache::instance().set_filter_failed_pixels(filter_failed_pixels);
+    std::lock_guard<std::mutex> reader_lock(Image_Reader_Cache::instance().reader_mutex(cine_file));
     if(is_avg){
       reader->get_average_frame(start_index-reader->first_image_number(),end_index-reader->first_image_number(),
-        offset_x,offset_y,width,height,intensities,is_layout_right,filter_failed_pixels,convert_to_8_bit);
+        offset_x,offset_y,width,height,intensities,is_layout_right,filter_failed_pixels,convert_to_8_bit,
+        Image_Reader_Cache::instance().num_threads());
     }else{
       reader->get_frame(offset_x,offset_y,width,height,intensities,is_layout_right,start_index-reader->first_image_number(),filter_failed_pixels,convert_to_8_bit);
     }
@@ -353,13 +546,16 @@ void read_image(const char * file_name,
 #ifdef DICE_ENABLE_NETCDF
   /// check if the file is a netcdf file
     else if(file_type==NETCDF){
-      netcdf::NetCDF_Reader netcdf_reader;
       const std::string netcdf_file = netcdf_file_name(file_name);
       const int_t index = netcdf_index(file_name);
-      netcdf_reader.read_netcdf_image(netcdf_file.c_str(),offset_x,offset_y,width,height,index,intensities,is_layout_right);
+      std::lock_guard<std::mutex> reader_lock(Image_Reader_Cache::instance().reader_mutex(Image_Reader_Cache::netcdf_mutex_id()));
+      Image_Reader_Cache::instance().netcdf_reader(netcdf_file)->read_netcdf_image(netcdf_file.c_str(),offset_x,offset_y,width,height,index,intensities,is_layout_right);
     }
 #endif
-  else if(file_type==TIFF||file_type==TIFF||file_type==JPEG||file_type==PNG){
+  else if(file_type==TIFF&&read_tiff_region(file_name,offset_x,offset_y,width,height,intensities,is_layout_right,convert_to_8_bit)){
+    DEBUG_MSG("read_image(): tiff region read directly with libtiff");
+  }
+  else if(file_type==TIFF||file_type==JPEG||file_type==PNG){
     boost::gil::gray8_image_t img;
     if(file_type==TIFF){
       TIFFSetWarningHandler(NULL);
@@ -396,6 +592,53 @@ void read_image(const char * file_name,
   }
 }
 
+DICE_LIB_DLL_EXPORT
+void read_image(const char * file_name,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const bool convert_to_8_bit,
+  const bool filter_failed_pixels){
+  Image_Reader_Cache & cache = Image_Reader_Cache::instance();
+  if(cache.frame_cache_budget()==0){
+    read_image_uncached(file_name,intensities,is_layout_right,convert_to_8_bit,filter_failed_pixels);
+    return;
+  }
+  int_t width = 0;
+  int_t height = 0;
+  read_image_dimensions(file_name,width,height);
+  const std::string key = Image_Reader_Cache::frame_key(file_name,0,0,width,height,is_layout_right,convert_to_8_bit,filter_failed_pixels);
+  if(cache.find_frame(key,width*height,intensities)){
+    DEBUG_MSG("read_image(): using cached frame " << key);
+    return;
+  }
+  read_image_uncached(file_name,intensities,is_layout_right,convert_to_8_bit,filter_failed_pixels);
+  cache.insert_frame(key,width*height,intensities);
+}
+
+DICE_LIB_DLL_EXPORT
+void read_image(const char * file_name,
+  int_t offset_x,
+  int_t offset_y,
+  int_t width,
+  int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const bool convert_to_8_bit,
+  const bool filter_failed_pixels){
+  Image_Reader_Cache & cache = Image_Reader_Cache::instance();
+  if(cache.frame_cache_budget()==0){
+    read_image_uncached(file_name,offset_x,offset_y,width,height,intensities,is_layout_right,convert_to_8_bit,filter_failed_pixels);
+    return;
+  }
+  const std::string key = Image_Reader_Cache::frame_key(file_name,offset_x,offset_y,width,height,is_layout_right,convert_to_8_bit,filter_failed_pixels);
+  if(cache.find_frame(key,width*height,intensities)){
+    DEBUG_MSG("read_image(): using cached frame " << key);
+    return;
+  }
+  read_image_uncached(file_name,offset_x,offset_y,width,height,intensities,is_layout_right,convert_to_8_bit,filter_failed_pixels);
+  cache.insert_frame(key,width*height,intensities);
+}
+
 DICE_LIB_DLL_EXPORT
 void write_color_overlap_image(const char * file_name,
   const int_t width,
@@ -440,7 +683,8 @@ void write_image(const char * file_name,
   const int_t height,
   intensity_t * intensities,
   const bool is_layout_right,
-  const bool scale_to_8_bit){
+  const bool scale_to_8_bit,
+  const bool compress_rawi){
   // determine the file type based on the file_name
   Image_File_Type file_type = image_file_type(file_name);
   if(file_type==NO_SUCH_IMAGE_FILE_TYPE){
@@ -449,7 +693,11 @@ void write_image(const char * file_name,
   }
   // rawi files are not scaled to the 8 bit range, because the file type holds double precision values
   if(file_type==RAWI){
-    write_rawi_image(file_name,width,height,intensities,is_layout_right);
+    write_rawi_image(file_name,width,height,intensities,is_layout_right,compress_rawi);
+  }
+  else if(file_type==RAWV){
+    std::cerr << "Error, single images can't be written to a rawv file (use Rawv_Writer to write a sequence of frames): " << file_name << "\n";
+    throw std::exception();
   }
   else if(file_type==TIFF||file_type==TIFF||file_type==JPEG||file_type==PNG){
     // rip through the intensity values and determine if they need to be scaled to 8-bit range (0-255):
@@ -505,8 +753,9 @@ void write_image(const char * file_name,
 
 Teuchos::RCP<DICe::cine::Cine_Reader>
 Image_Reader_Cache::cine_reader(const std::string & id){
+  std::lock_guard<std::mutex> lock(mutex_);
   if(cine_reader_map_.find(id)==cine_reader_map_.end()){
-    Teuchos::RCP<DICe::cine::Cine_Reader> cine_reader = Teuchos::rcp(new DICe::cine::Cine_Reader(id,NULL,filter_failed_pixels_));
+    Teuchos::RCP<DICe::cine::Cine_Reader> cine_reader = Teuchos::rcp(new DICe::cine::Cine_Reader(id,NULL,filter_failed_pixels_,true,find_cine_header(id)));
     cine_reader_map_.insert(std::pair<std::string,Teuchos::RCP<DICe::cine::Cine_Reader> >(id,cine_reader));
     return cine_reader;
   }
@@ -514,5 +763,181 @@ Image_Reader_Cache::cine_reader(const std::string & id){
     return cine_reader_map_.find(id)->second;
 }
 
+Teuchos::RCP<DICe::cine::Cine_Header>
+Image_Reader_Cache::cine_header(const std::string & file_name){
+  std::lock_guard<std::mutex> lock(mutex_);
+  return find_cine_header(file_name);
+}
+
+Teuchos::RCP<DICe::cine::Cine_Header>
+Image_Reader_Cache::find_cine_header(const std::string & file_name){
+  std::map<std::string,Teuchos::RCP<DICe::cine::Cine_Header> >::iterator it = cine_header_map_.find(file_name);
+  if(it==cine_header_map_.end())
+    it = cine_header_map_.insert(std::pair<std::string,Teuchos::RCP<DICe::cine::Cine_Header> >(file_name,
+      DICe::cine::read_cine_headers(file_name.c_str()))).first;
+  return it->second;
+}
+
+Teuchos::RCP<Rawv_Reader>
+Image_Reader_Cache::rawv_reader(const std::string & id){
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string,Teuchos::RCP<Rawv_Reader> >::iterator it = rawv_reader_map_.find(id);
+  if(it==rawv_reader_map_.end())
+    it = rawv_reader_map_.insert(std::pair<std::string,Teuchos::RCP<Rawv_Reader> >(id,Teuchos::rcp(new Rawv_Reader(id)))).first;
+  return it->second;
+}
+
+#if DICE_ENABLE_NETCDF
+Teuchos::RCP<DICe::netcdf::NetCDF_Reader>
+Image_Reader_Cache::netcdf_reader(const std::string & id){
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(netcdf_reader_map_.find(id)==netcdf_reader_map_.end()){
+    Teuchos::RCP<DICe::netcdf::NetCDF_Reader> netcdf_reader = Teuchos::rcp(new DICe::netcdf::NetCDF_Reader());
+    netcdf_reader_map_.insert(std::pair<std::string,Teuchos::RCP<DICe::netcdf::NetCDF_Reader> >(id,netcdf_reader));
+    return netcdf_reader;
+  }
+  else
+    return netcdf_reader_map_.find(id)->second;
+}
+#endif
+
+std::mutex &
+Image_Reader_Cache::reader_mutex(const std::string & id){
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string,Teuchos::RCP<std::mutex> >::iterator it = reader_mutex_map_.find(id);
+  if(it==reader_mutex_map_.end())
+    it = reader_mutex_map_.insert(std::pair<std::string,Teuchos::RCP<std::mutex> >(id,Teuchos::rcp(new std::mutex()))).first;
+  return *it->second;
+}
+
+void
+Image_Reader_Cache::set_frame_cache_budget(const size_t num_bytes){
+  std::lock_guard<std::mutex> lock(mutex_);
+  DEBUG_MSG("Image_Reader_Cache::set_frame_cache_budget(): " << num_bytes << " bytes");
+  frame_cache_budget_ = num_bytes;
+  trim_frame_cache();
+}
+
+size_t
+Image_Reader_Cache::frame_cache_budget()const{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frame_cache_budget_;
+}
+
+size_t
+Image_Reader_Cache::frame_cache_size()const{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frame_cache_size_;
+}
+
+size_t
+Image_Reader_Cache::num_cached_frames()const{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_.size();
+}
+
+void
+Image_Reader_Cache::clear_frame_cache(){
+  std::lock_guard<std::mutex> lock(mutex_);
+  frames_.clear();
+  lru_.clear();
+  frame_cache_size_ = 0;
+}
+
+bool
+Image_Reader_Cache::find_frame(const std::string & key,
+  const size_t num_values,
+  intensity_t * intensities){
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string,Cached_Frame>::iterator it = frames_.find(key);
+  if(it==frames_.end()||it->second.num_values_!=num_values)
+    return false;
+  const Cached_Frame & frame = it->second;
+  if(!frame.intensities_8_.empty()){
+    for(size_t i=0;i<num_values;++i)
+      intensities[i] = static_cast<intensity_t>(frame.intensities_8_[i]);
+  }else if(!frame.intensities_16_.empty()){
+    for(size_t i=0;i<num_values;++i)
+      intensities[i] = static_cast<intensity_t>(frame.intensities_16_[i]);
+  }else{
+    std::copy(frame.intensities_.begin(),frame.intensities_.end(),intensities);
+  }
+  // move this frame to the front of the recently used list
+  lru_.splice(lru_.begin(),lru_,it->second.lru_it_);
+  return true;
+}
+
+void
+Image_Reader_Cache::insert_frame(const std::string & key,
+  const size_t num_values,
+  const intensity_t * intensities){
+  // find the narrowest type that holds the values exactly (done before taking the lock)
+  bool whole_numbers = true;
+  intensity_t max_value = 0.0;
+  for(size_t i=0;i<num_values;++i){
+    const intensity_t & value = intensities[i];
+    if(value<0.0||value>65535.0||value!=static_cast<intensity_t>(static_cast<uint16_t>(value))){
+      whole_numbers = false;
+      break;
+    }
+    if(value>max_value) max_value = value;
+  }
+  const size_t value_size = !whole_numbers ? sizeof(intensity_t) : max_value<=255.0 ? sizeof(uint8_t) : sizeof(uint16_t);
+  const size_t num_bytes = num_values*value_size;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(num_bytes>frame_cache_budget_) return;
+  std::map<std::string,Cached_Frame>::iterator it = frames_.find(key);
+  if(it!=frames_.end()){
+    // another thread may have decoded the same frame in the meantime
+    frame_cache_size_ -= it->second.num_bytes_;
+    lru_.erase(it->second.lru_it_);
+    frames_.erase(it);
+  }
+  lru_.push_front(key);
+  Cached_Frame & frame = frames_[key];
+  if(value_size==sizeof(uint8_t)){
+    frame.intensities_8_.resize(num_values);
+    for(size_t i=0;i<num_values;++i)
+      frame.intensities_8_[i] = static_cast<uint8_t>(intensities[i]);
+  }else if(value_size==sizeof(uint16_t)){
+    frame.intensities_16_.resize(num_values);
+    for(size_t i=0;i<num_values;++i)
+      frame.intensities_16_[i] = static_cast<uint16_t>(intensities[i]);
+  }else{
+    frame.intensities_.assign(intensities,intensities+num_values);
+  }
+  frame.num_values_ = num_values;
+  frame.num_bytes_ = num_bytes;
+  frame.lru_it_ = lru_.begin();
+  frame_cache_size_ += num_bytes;
+  trim_frame_cache();
+}
+
+void
+Image_Reader_Cache::trim_frame_cache(){
+  while(frame_cache_size_>frame_cache_budget_&&!lru_.empty()){
+    std::map<std::string,Cached_Frame>::iterator it = frames_.find(lru_.back());
+    assert(it!=frames_.end());
+    frame_cache_size_ -= it->second.num_bytes_;
+    frames_.erase(it);
+    lru_.pop_back();
+  }
+}
+
+std::string
+Image_Reader_Cache::frame_key(const char * file_name,
+  const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height,
+  const bool is_layout_right,
+  const bool convert_to_8_bit,
+  const bool filter_failed_pixels){
+  std::stringstream key;
+  key << file_name << "|" << offset_x << "," << offset_y << "," << width << "x" << height << "|"
+      << is_layout_right << convert_to_8_bit << filter_failed_pixels;
+  return key.str();
+}
+
 } // end namespace utils
 } // end namespace DICe
@@ -44,11 +44,19 @@
 
 #include <DICe.h>
 #include <DICe_Cine.h>
+#include <DICe_Rawi.h>
+#if DICE_ENABLE_NETCDF
+  #include <DICe_NetCDF.h>
+#endif
 
 #include <Teuchos_RCP.hpp>
 
 #include <string>
 #include <map>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
 
 namespace DICe{
 /*!
@@ -68,6 +76,17 @@ std::string netcdf_file_name(const char * decorated_netcdf_file);
 DICE_LIB_DLL_EXPORT
 int_t netcdf_index(const char * decorated_netcdf_file);
 
+/// returns the name of a rawv file given a decorated file name string
+/// \param decorated_rawv_file the decorated string that contains the name
+/// The convention is the same as for netcdf files, stack_frame_3.rawv is frame 3 of stack.rawv
+DICE_LIB_DLL_EXPORT
+std::string rawv_file_name(const char * decorated_rawv_file);
+
+/// returns the frame index decyphered from the rawv file descriptor passed in
+/// \param decorated_rawv_file the descriptor that has the rawv name and index concatendated
+DICE_LIB_DLL_EXPORT
+int_t rawv_index(const char * decorated_rawv_file);
+
 /// returns the name of a file given a decorated file name string
 /// \param decorated_cine_file the decorated string that contains the name
 DICE_LIB_DLL_EXPORT
@@ -106,7 +125,7 @@ void read_image_dimensions(const char * file_name,
 /// \param file_name the name of the file
 /// \param intensities [out] populated with the pixel intensity values
 /// \param is_layout_right true if the arrays are row-major
-/// \param convert_to_8_bit if true the values will be scaled to fit in the 8 bit range (0-255)
+/// \param convert_to_8_bit if true the values will be scaled to fit in the 8 bit range (0-255), applies to cine and 16 bit tiff files
 /// \param filter failed pixels (only works for .cine file format) if true failed pixels will be replaced with neighbor values
 DICE_LIB_DLL_EXPORT
 void read_image(const char * file_name,
@@ -123,7 +142,7 @@ void read_image(const char * file_name,
 /// \param height height of the portion of the image to read (must be smaller than the global image height)
 /// \param intensities [out] populated with the image intensities
 /// \param is_layout_right [optional] memory layout is LayoutRight (row-major)
-/// \param convert_to_8_bit if true the values will be scaled to fit in the 8 bit range (0-255)
+/// \param convert_to_8_bit if true the values will be scaled to fit in the 8 bit range (0-255), applies to cine and 16 bit tiff files
 /// \param filter failed pixels (only works for .cine file format) if true failed pixels will be replaced with neighbor values
 DICE_LIB_DLL_EXPORT
 void read_image(const char * file_name,
@@ -147,13 +166,15 @@ void read_image(const char * file_name,
 /// \param intensities assumed to be an array of size width x height
 /// \param is_layout_right [optional] memory layout is LayoutRight (row-major)
 /// \param scale_to_8_bit scale the values to 8 bit range
+/// \param compress_rawi write a compressed .rawi file (ignored for the other formats, see DICe::utils::rawi_compression_enabled())
 DICE_LIB_DLL_EXPORT
 void write_image(const char * file_name,
   const int_t width,
   const int_t height,
   intensity_t * intensities,
   const bool is_layout_right = true,
-  const bool scale_to_8_bit = true);
+  const bool scale_to_8_bit = true,
+  const bool compress_rawi = false);
 
 
 /// write an image to disk with two base images overlayed with transparency
@@ -172,7 +193,9 @@ void write_color_overlap_image(const char * file_name,
 
 // singleton class to keep track of image readers from high speed video or netcdf files:
 /// \class Image_Reader_Cache
-/// used for file reads and getting image dimensions without having to reload the header every time
+/// used for file reads and getting image dimensions without having to reload the header every time.
+/// The cache also keeps a bounded set of decoded frames (least recently used frames are dropped first)
+/// so that frames that are read more than once are not decoded again. All methods are thread safe.
 DICE_LIB_DLL_EXPORT
 class Image_Reader_Cache{
 public:
@@ -184,29 +207,169 @@ public:
 
   /// filters failed pixels from the images
   void set_filter_failed_pixels(const bool flag){
+    std::lock_guard<std::mutex> lock(mutex_);
     filter_failed_pixels_ = flag;
   }
 
   /// filters failed pixels from the images
   bool filter_failed_pixels()const{
+    std::lock_guard<std::mutex> lock(mutex_);
     return filter_failed_pixels_;
   }
 
+  /// set the number of threads used to decode frames (for example when averaging video frames)
+  void set_num_threads(const int_t num_threads){
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_threads_ = num_threads<1 ? 1 : num_threads;
+  }
+
+  /// returns the number of threads used to decode frames
+  int_t num_threads()const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_threads_;
+  }
+
   /// add a cine reader to the map
   /// \param id the string name of the reader in case multiple headers are loaded (for example in stereo)
   /// if the reader doesn't exist, it gets created
   Teuchos::RCP<DICe::cine::Cine_Reader> cine_reader(const std::string & id);
+
+  /// \brief returns the parsed header of a cine file, the header is read once and shared by all of
+  /// the readers of the file (for example to get the number of frames without creating a reader)
+  /// \param file_name the name of the cine file
+  Teuchos::RCP<DICe::cine::Cine_Header> cine_header(const std::string & file_name);
+
+#if DICE_ENABLE_NETCDF
+  /// \brief returns a pointer to a netcdf reader, the reader keeps the file open between frames
+  /// \param id the name of the netcdf file
+  /// if the reader doesn't exist, it gets created
+  Teuchos::RCP<DICe::netcdf::NetCDF_Reader> netcdf_reader(const std::string & id);
+#endif
+
+  /// \brief returns a pointer to a rawv reader, the reader keeps the file mapped between frames
+  /// \param id the name of the rawv file
+  /// if the reader doesn't exist, it gets created (frames can be read without holding a reader_mutex())
+  Teuchos::RCP<Rawv_Reader> rawv_reader(const std::string & id);
+
+  /// returns the mutex that must be held while reading frames from a cine or netcdf reader
+  /// (the readers share one open file so reads from different threads have to take turns)
+  /// \param id the string name of the reader
+  std::mutex & reader_mutex(const std::string & id);
+
+  /// returns the reader_mutex() id used for all netcdf reads (the netcdf library is not thread safe)
+  static std::string netcdf_mutex_id(){
+    return "netcdf";
+  }
+
+  /// set the maximum number of bytes used to hold decoded frames (0 turns off the frame cache),
+  /// frames are dropped in least recently used order if the cache is over the budget
+  /// \param num_bytes the budget in bytes
+  void set_frame_cache_budget(const size_t num_bytes);
+
+  /// returns the maximum number of bytes used to hold decoded frames
+  size_t frame_cache_budget()const;
+
+  /// returns the number of bytes currently held by decoded frames
+  size_t frame_cache_size()const;
+
+  /// returns the number of decoded frames in the cache
+  size_t num_cached_frames()const;
+
+  /// remove all of the decoded frames from the cache
+  void clear_frame_cache();
+
+  /// copy a decoded frame out of the cache, returns false if the frame is not in the cache
+  /// \param key the frame key (see frame_key())
+  /// \param num_values the number of intensity values expected
+  /// \param intensities [out] populated with the cached values
+  bool find_frame(const std::string & key,
+    const size_t num_values,
+    intensity_t * intensities);
+
+  /// put a copy of a decoded frame in the cache (nothing is cached if the frame is bigger than the budget)
+  /// \param key the frame key (see frame_key())
+  /// \param num_values the number of intensity values
+  /// \param intensities the decoded values
+  void insert_frame(const std::string & key,
+    const size_t num_values,
+    const intensity_t * intensities);
+
+  /// returns the key used to identify a decoded frame in the cache
+  /// \param file_name the (decorated) file name, which includes the frame index for video files
+  /// \param offset_x the upper left corner x-coordinate of the region
+  /// \param offset_y the upper left corner y-coordinate of the region
+  /// \param width the width of the region
+  /// \param height the height of the region
+  /// \param is_layout_right memory layout is LayoutRight (row-major)
+  /// \param convert_to_8_bit true if the values were scaled to 8 bits
+  /// \param filter_failed_pixels true if the failed pixels were filtered
+  static std::string frame_key(const char * file_name,
+    const int_t offset_x,
+    const int_t offset_y,
+    const int_t width,
+    const int_t height,
+    const bool is_layout_right,
+    const bool convert_to_8_bit,
+    const bool filter_failed_pixels);
+
 private:
   /// constructor
-  Image_Reader_Cache():filter_failed_pixels_(false){};
+  Image_Reader_Cache():filter_failed_pixels_(false),num_threads_(1),frame_cache_budget_(0),frame_cache_size_(0){};
   /// copy constructor
   Image_Reader_Cache(Image_Reader_Cache const&);
   /// asignment operator
   void operator=(Image_Reader_Cache const &);
+  /// drop the least recently used frames until the cache fits in the budget
+  /// (the mutex must be held by the caller)
+  void trim_frame_cache();
+  /// returns the header of a cine file, reading it if it has not been read yet
+  /// (the mutex must be held by the caller)
+  Teuchos::RCP<DICe::cine::Cine_Header> find_cine_header(const std::string & file_name);
+  /// guards all of the members
+  mutable std::mutex mutex_;
   /// map of cine readers
   std::map<std::string,Teuchos::RCP<DICe::cine::Cine_Reader> > cine_reader_map_;
+  /// map of parsed cine headers
+  std::map<std::string,Teuchos::RCP<DICe::cine::Cine_Header> > cine_header_map_;
+#if DICE_ENABLE_NETCDF
+  /// map of netcdf readers
+  std::map<std::string,Teuchos::RCP<DICe::netcdf::NetCDF_Reader> > netcdf_reader_map_;
+#endif
+  /// map of rawv readers
+  std::map<std::string,Teuchos::RCP<Rawv_Reader> > rawv_reader_map_;
+  /// map of the mutexes that serialize reads from each reader
+  std::map<std::string,Teuchos::RCP<std::mutex> > reader_mutex_map_;
   /// filter failed pixels from images as they are loaded
   bool filter_failed_pixels_;
+  /// number of threads used to decode frames
+  int_t num_threads_;
+  /// a decoded frame and its position in the recently used list
+  ///
+  /// Frames from 8 or 16 bit cameras hold whole numbers, so they are kept in their native width
+  /// and converted back to intensity_t when they are copied out of the cache. Any other frame
+  /// (filtered or scaled values for example) is kept as intensity_t.
+  struct Cached_Frame{
+    /// the decoded values (empty if the frame is held in 8 or 16 bits)
+    std::vector<intensity_t> intensities_;
+    /// the decoded values of an 8 bit frame
+    std::vector<uint8_t> intensities_8_;
+    /// the decoded values of a 16 bit frame
+    std::vector<uint16_t> intensities_16_;
+    /// number of values in the frame
+    size_t num_values_;
+    /// number of bytes held by the frame
+    size_t num_bytes_;
+    /// position of this frame in the recently used list
+    std::list<std::string>::iterator lru_it_;
+  };
+  /// decoded frames by key
+  std::map<std::string,Cached_Frame> frames_;
+  /// frame keys, most recently used first
+  std::list<std::string> lru_;
+  /// maximum number of bytes held by decoded frames
+  size_t frame_cache_budget_;
+  /// number of bytes held by decoded frames
+  size_t frame_cache_size_;
 };
 
 
@@ -40,10 +40,21 @@
 // @HEADER
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
 #if defined(WIN32)
   #include <cstdint>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+#if DICE_ZLIB
+  #include <zlib.h>
 #endif
 
 #include <DICe_Rawi.h>
@@ -51,6 +62,313 @@
 namespace DICe{
 namespace utils{
 
+/// size of the rawi header (width, height and the number of bytes per value)
+static const size_t rawi_header_size = 3*sizeof(uint32_t);
+/// set in the bytes per value entry of the header if the intensity values are compressed
+static const uint32_t rawi_compressed_flag = 0x80000000;
+/// identifies a rawv file
+static const char rawv_magic[4] = {'R','A','W','V'};
+/// version of the rawv layout
+static const uint32_t rawv_version = 1;
+/// size of the rawv header (magic, version, width, height, number of frames and the offset of the frame index)
+static const size_t rawv_header_size = 4*sizeof(uint32_t) + 2*sizeof(uint64_t);
+
+/// \class DICe::utils::Mapped_File
+/// \brief Read-only view of the contents of a file
+///
+/// The file is memory mapped where possible so only the pages that are touched get read,
+/// otherwise the contents are read into memory
+class Mapped_File{
+public:
+  /// \brief constructor, opens the file
+  /// \param file_name the name of the file
+  Mapped_File(const char * file_name):
+  map_(NULL),
+  size_(0),
+  data_(NULL){
+#if defined(WIN32)
+    std::ifstream in_file(file_name, std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+    if (!in_file.is_open()){
+      std::cerr << "ERROR: Can't open the file: " + (std::string)file_name << std::endl;
+      exit(1);
+    }
+    size_ = in_file.tellg();
+    in_file.seekg(0);
+    buffer_.resize(size_);
+    if(size_>0)
+      in_file.read(&buffer_[0],size_);
+    in_file.close();
+    data_ = buffer_.empty() ? NULL : &buffer_[0];
+#else
+    const int fd = open(file_name,O_RDONLY);
+    if (fd<0){
+      std::cerr << "ERROR: Can't open the file: " + (std::string)file_name << std::endl;
+      exit(1);
+    }
+    struct stat file_stat;
+    if(fstat(fd,&file_stat)==0)
+      size_ = file_stat.st_size;
+    if(size_>0){
+      map_ = mmap(NULL,size_,PROT_READ,MAP_PRIVATE,fd,0);
+      if(map_==MAP_FAILED){
+        std::cerr << "ERROR: Can't map the file: " + (std::string)file_name << std::endl;
+        close(fd);
+        exit(1);
+      }
+    }
+    close(fd);
+    data_ = static_cast<const char *>(map_);
+#endif
+  }
+
+  /// destructor, unmaps the file
+  ~Mapped_File(){
+#if !defined(WIN32)
+    if(map_!=NULL)
+      munmap(map_,size_);
+#endif
+  }
+
+  /// start of the file contents
+  const char * data()const{return data_;}
+
+  /// size of the file in bytes
+  size_t size()const{return size_;}
+
+private:
+  /// not copyable
+  Mapped_File(const Mapped_File &);
+  /// not assignable
+  Mapped_File & operator=(const Mapped_File &);
+  /// start of the memory mapped file (NULL if not mapped)
+  void * map_;
+  /// size of the file
+  size_t size_;
+  /// file contents if the file could not be mapped
+  std::vector<char> buffer_;
+  /// start of the file contents
+  const char * data_;
+};
+
+/// \class DICe::utils::Rawi_Record
+/// \brief Decodes a rawi header and intensity values held in memory
+///
+/// This is the contents of a rawi file or one frame of a rawv file. The intensity values
+/// are copied straight out of the record unless they are compressed, in which case they
+/// are decompressed into memory first.
+class Rawi_Record{
+public:
+  /// \brief constructor, reads the header
+  /// \param contents start of the record
+  /// \param size size of the record in bytes
+  /// \param name name used in error messages
+  Rawi_Record(const char * contents,
+    const size_t size,
+    const std::string & name):
+  name_(name),
+  values_(NULL),
+  width_(0),
+  height_(0){
+    if(size<rawi_header_size){
+      std::cerr << "ERROR: Invalid rawi file (too short for the header): " + name_ << std::endl;
+      exit(1);
+    }
+    uint32_t w = 0;
+    uint32_t h = 0;
+    uint32_t num_bytes = 0;
+    std::memcpy(&w,contents,sizeof(uint32_t));
+    std::memcpy(&h,contents+sizeof(uint32_t),sizeof(uint32_t));
+    std::memcpy(&num_bytes,contents+2*sizeof(uint32_t),sizeof(uint32_t));
+    width_ = w;
+    height_ = h;
+    const bool compressed = (num_bytes & rawi_compressed_flag) != 0;
+    num_bytes &= ~rawi_compressed_flag;
+    // check that the byte size of the intensity values in the file is compatible with the current
+    // size used to store intensity_t values
+    if(num_bytes!=sizeof(intensity_t)){
+      std::cerr << "Can't open file because it was saved using a different basic type for intensity_t: " + name_ << std::endl;
+      exit(1);
+    }
+    const size_t num_values = (size_t)width_*(size_t)height_;
+    if(compressed){
+      decompress(contents + rawi_header_size,size - rawi_header_size,num_values);
+      values_ = &values_buffer_[0];
+    }
+    else{
+      if(size < rawi_header_size + num_values*sizeof(intensity_t)){
+        std::cerr << "ERROR: Invalid rawi file (too short for the image dimensions): " + name_ << std::endl;
+        exit(1);
+      }
+      values_ = contents + rawi_header_size;
+    }
+  }
+
+  /// image width
+  int_t width()const{return width_;}
+
+  /// image height
+  int_t height()const{return height_;}
+
+  /// \brief copy a portion of the image
+  /// \param offset_x offset of the portion in x
+  /// \param offset_y offset of the portion in y
+  /// \param width width of the portion
+  /// \param height height of the portion
+  /// \param intensities [out] array of size width x height
+  /// \param is_layout_right memory layout is LayoutRight (row-major)
+  void copy_region(const int_t offset_x,
+    const int_t offset_y,
+    const int_t width,
+    const int_t height,
+    intensity_t * intensities,
+    const bool is_layout_right)const{
+    if(offset_x<0||offset_y<0||width<=0||height<=0||offset_x+width>width_||offset_y+height>height_){
+      std::cerr << "ERROR: Invalid region of rawi file " << name_ << " offset " << offset_x << " " << offset_y <<
+          " dims " << width << " " << height << " image dims " << width_ << " " << height_ << std::endl;
+      exit(1);
+    }
+    for (int_t y=0; y<height; ++y) {
+      const char * row = values_ + ((size_t)(y+offset_y)*width_ + offset_x)*sizeof(intensity_t);
+      if(is_layout_right)
+        std::memcpy(&intensities[y*width],row,width*sizeof(intensity_t));
+      else // otherwise assume layout left
+        for (int_t x=0; x<width;++x){
+          std::memcpy(&intensities[x*height+y],row + x*sizeof(intensity_t),sizeof(intensity_t));
+        }
+    }
+  }
+
+private:
+  /// not copyable
+  Rawi_Record(const Rawi_Record &);
+  /// not assignable
+  Rawi_Record & operator=(const Rawi_Record &);
+
+  /// \brief inflate the compressed values and undo the byte shuffle
+  /// \param data the compressed data (following the header)
+  /// \param size the size of the compressed data in bytes
+  /// \param num_values the number of intensity values in the image
+  void decompress(const char * data,
+    const size_t size,
+    const size_t num_values){
+#if DICE_ZLIB
+    const size_t num_bytes = num_values*sizeof(intensity_t);
+    std::vector<char> shuffled(num_bytes);
+    uLongf dest_size = num_bytes;
+    const int error = num_bytes==0 ? Z_OK : uncompress(reinterpret_cast<Bytef*>(&shuffled[0]),&dest_size,reinterpret_cast<const Bytef*>(data),size);
+    if(error!=Z_OK||dest_size!=num_bytes){
+      std::cerr << "ERROR: Corrupt compressed rawi file: " + name_ << std::endl;
+      exit(1);
+    }
+    values_buffer_.resize(num_bytes);
+    // the file stores byte 0 of every value, then byte 1, etc.
+    for(size_t b=0;b<sizeof(intensity_t);++b)
+      for(size_t i=0;i<num_values;++i)
+        values_buffer_[i*sizeof(intensity_t)+b] = shuffled[b*num_values+i];
+#else
+    (void)data;
+    (void)size;
+    (void)num_values;
+    std::cerr << "ERROR: Can't read the compressed rawi file, DICe was built without zlib: " + name_ << std::endl;
+    exit(1);
+#endif
+  }
+
+  /// name used in error messages
+  std::string name_;
+  /// decompressed intensity values
+  std::vector<char> values_buffer_;
+  /// start of the intensity values
+  const char * values_;
+  /// image width
+  int_t width_;
+  /// image height
+  int_t height_;
+};
+
+/// \brief write a rawi header and the intensity values to a stream
+/// \param out the output stream
+/// \param name name used in error messages
+/// \param width the width of the image
+/// \param height the height of the image
+/// \param intensities array of size width x height
+/// \param is_layout_right memory layout is LayoutRight (row-major)
+/// \param compress store the values compressed
+static void write_rawi_record(std::ostream & out,
+  const std::string & name,
+  const int_t width,
+  const int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const bool compress){
+  assert(width > 0);
+  assert(height > 0);
+
+  // TODO make sure this cast is okay
+  uint32_t w = (uint32_t)width;
+  uint32_t h = (uint32_t)height;
+  uint32_t num_bytes = sizeof(intensity_t);
+#if !DICE_ZLIB
+  if(compress){
+    std::cerr << "ERROR: Can't write a compressed rawi file, DICe was built without zlib: " + name << std::endl;
+    exit(1);
+  }
+#endif
+  if(compress)
+    num_bytes |= rawi_compressed_flag;
+  // write the file details
+  out.write(reinterpret_cast<char*>(&w), sizeof(uint32_t));
+  out.write(reinterpret_cast<char*>(&h), sizeof(uint32_t));
+  out.write(reinterpret_cast<char*>(&num_bytes), sizeof(uint32_t));
+
+  const size_t num_values = (size_t)width*(size_t)height;
+  if(compress){
+#if DICE_ZLIB
+    // shuffle the bytes so that byte 0 of every value comes first, then byte 1, etc.
+    // (the sign and exponent bytes of neighboring pixels are similar so they compress well)
+    std::vector<char> shuffled(num_values*sizeof(intensity_t));
+    for (int_t y=0; y<height; ++y) {
+      for (int_t x=0; x<width;++x){
+        const char * value = reinterpret_cast<const char*>(is_layout_right ? &intensities[y*width + x] : &intensities[x*height+y]);
+        const size_t i = (size_t)y*width + x;
+        for(size_t b=0;b<sizeof(intensity_t);++b)
+          shuffled[b*num_values+i] = value[b];
+      }
+    }
+    uLongf compressed_size = compressBound(shuffled.size());
+    std::vector<char> compressed(compressed_size);
+    const int error = compress2(reinterpret_cast<Bytef*>(&compressed[0]),&compressed_size,
+      reinterpret_cast<const Bytef*>(&shuffled[0]),shuffled.size(),Z_DEFAULT_COMPRESSION);
+    if(error!=Z_OK){
+      std::cerr << "ERROR: Compressing the rawi file failed: " + name << std::endl;
+      exit(1);
+    }
+    out.write(&compressed[0],compressed_size);
+#endif
+  }
+  else if(is_layout_right){
+    // write the image data:
+    out.write(reinterpret_cast<char*>(intensities),num_values*sizeof(intensity_t));
+  }
+  else{ // otherwise assume layout left
+    std::vector<intensity_t> row(width);
+    for (int_t y=0; y<height; ++y) {
+      for (int_t x=0; x<width;++x)
+        row[x] = intensities[x*height+y];
+      out.write(reinterpret_cast<char*>(&row[0]),width*sizeof(intensity_t));
+    }
+  }
+}
+
+DICE_LIB_DLL_EXPORT
+bool rawi_compression_enabled(){
+#if DICE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
 DICE_LIB_DLL_EXPORT
 void read_rawi_image_dimensions(const char * file_name,
   int_t & width,
@@ -75,76 +393,178 @@ DICE_LIB_DLL_EXPORT
 void read_rawi_image(const char * file_name,
   intensity_t * intensities,
   const bool is_layout_right){
+  Mapped_File file(file_name);
+  Rawi_Record rawi(file.data(),file.size(),file_name);
+  rawi.copy_region(0,0,rawi.width(),rawi.height(),intensities,is_layout_right);
+}
 
-  std::ifstream rawi_file (file_name, std::ifstream::in | std::ifstream::binary);
+DICE_LIB_DLL_EXPORT
+void read_rawi_image(const char * file_name,
+  const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right){
+  Mapped_File file(file_name);
+  Rawi_Record rawi(file.data(),file.size(),file_name);
+  rawi.copy_region(offset_x,offset_y,width,height,intensities,is_layout_right);
+}
+
+DICE_LIB_DLL_EXPORT
+void write_rawi_image(const char * file_name,
+  const int_t width,
+  const int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const bool compress){
+  //create a new file:
+  std::ofstream rawi_file (file_name, std::ofstream::out | std::ofstream::binary);
   if (!rawi_file.is_open()){
     std::cerr << "ERROR: Can't open the file: " + (std::string)file_name << std::endl;
     exit(1);
   }
-  // read the file details
+  write_rawi_record(rawi_file,file_name,width,height,intensities,is_layout_right,compress);
+  rawi_file.close();
+}
+
+Rawv_Reader::Rawv_Reader(const std::string & file_name):
+  file_name_(file_name),
+  file_(new Mapped_File(file_name.c_str())),
+  frame_index_(NULL),
+  index_offset_(0),
+  num_frames_(0),
+  width_(0),
+  height_(0){
+  const char * contents = file_->data();
+  if(file_->size()<rawv_header_size||std::memcmp(contents,rawv_magic,sizeof(rawv_magic))!=0){
+    std::cerr << "ERROR: Invalid rawv file (missing header): " + file_name_ << std::endl;
+    exit(1);
+  }
+  uint32_t version = 0;
   uint32_t w = 0;
   uint32_t h = 0;
-  uint32_t num_bytes = 0;
-  rawi_file.read(reinterpret_cast<char*>(&w), sizeof(uint32_t));
-  rawi_file.read(reinterpret_cast<char*>(&h), sizeof(uint32_t));
-  rawi_file.read(reinterpret_cast<char*>(&num_bytes), sizeof(uint32_t));
-  // check that the byte size of the intensity values in the file is compatible with the current
-  // size used to store intensity_t values
-  if(num_bytes!=sizeof(intensity_t)){
-    std::cerr << "Can't open file because it was saved using a different basic type for intensity_t: " + (std::string)file_name << std::endl;
+  uint64_t num_frames = 0;
+  uint64_t index_offset = 0;
+  std::memcpy(&version,contents+sizeof(uint32_t),sizeof(uint32_t));
+  std::memcpy(&w,contents+2*sizeof(uint32_t),sizeof(uint32_t));
+  std::memcpy(&h,contents+3*sizeof(uint32_t),sizeof(uint32_t));
+  std::memcpy(&num_frames,contents+4*sizeof(uint32_t),sizeof(uint64_t));
+  std::memcpy(&index_offset,contents+4*sizeof(uint32_t)+sizeof(uint64_t),sizeof(uint64_t));
+  if(version!=rawv_version){
+    std::cerr << "ERROR: Unsupported rawv file version " << version << ": " + file_name_ << std::endl;
     exit(1);
   }
-  // read the image data:
-  for (uint32_t y=0; y<h; ++y) {
-    if(is_layout_right)
-      for (uint32_t x=0; x<w;++x){
-        rawi_file.read(reinterpret_cast<char*>(&intensities[y*w+x]),sizeof(intensity_t));
-      }
-    else // otherwise assume layout left
-      for (uint32_t x=0; x<w;++x){
-        rawi_file.read(reinterpret_cast<char*>(&intensities[x*h+y]),sizeof(intensity_t));
-      }
+  // a file that was not closed properly has no frame index
+  if(index_offset<rawv_header_size||index_offset+num_frames*sizeof(uint64_t)>file_->size()){
+    std::cerr << "ERROR: Invalid rawv file (missing or truncated frame index): " + file_name_ << std::endl;
+    exit(1);
   }
-  rawi_file.close();
+  width_ = w;
+  height_ = h;
+  num_frames_ = num_frames;
+  index_offset_ = index_offset;
+  frame_index_ = contents + index_offset;
 }
 
-DICE_LIB_DLL_EXPORT
-void write_rawi_image(const char * file_name,
+Rawv_Reader::~Rawv_Reader(){
+  delete file_;
+}
+
+void
+Rawv_Reader::read_frame(const int_t frame,
+  const int_t offset_x,
+  const int_t offset_y,
   const int_t width,
   const int_t height,
   intensity_t * intensities,
-  const bool is_layout_right){
-  assert(width > 0);
-  assert(height > 0);
+  const bool is_layout_right)const{
+  if(frame<0||frame>=num_frames_){
+    std::cerr << "ERROR: Invalid frame " << frame << " requested from rawv file " << file_name_ << " with " << num_frames_ << " frames" << std::endl;
+    exit(1);
+  }
+  // frames are stored back to back so a frame ends where the next one (or the index) starts
+  uint64_t begin = 0;
+  uint64_t end = index_offset_;
+  std::memcpy(&begin,frame_index_ + frame*sizeof(uint64_t),sizeof(uint64_t));
+  if(frame+1<num_frames_)
+    std::memcpy(&end,frame_index_ + (frame+1)*sizeof(uint64_t),sizeof(uint64_t));
+  if(begin<rawv_header_size||end<begin||end>index_offset_){
+    std::cerr << "ERROR: Invalid rawv file (corrupt frame index): " + file_name_ << std::endl;
+    exit(1);
+  }
+  std::stringstream name;
+  name << file_name_ << " frame " << frame;
+  Rawi_Record rawi(file_->data() + begin,end-begin,name.str());
+  rawi.copy_region(offset_x,offset_y,width,height,intensities,is_layout_right);
+}
 
-  // TODO make sure this cast is okay
-  uint32_t w = (uint32_t)width;
-  uint32_t h = (uint32_t)height;
-  uint32_t num_bytes = sizeof(intensity_t);
-  //create a new file:
-  std::ofstream rawi_file (file_name, std::ofstream::out | std::ofstream::binary);
-  if (!rawi_file.is_open()){
-    std::cerr << "ERROR: Can't open the file: " + (std::string)file_name << std::endl;
+Rawv_Writer::Rawv_Writer(const std::string & file_name):
+  file_name_(file_name),
+  width_(0),
+  height_(0){
+  file_.open(file_name.c_str(),std::ofstream::out | std::ofstream::binary);
+  if (!file_.is_open()){
+    std::cerr << "ERROR: Can't open the file: " + file_name_ << std::endl;
     exit(1);
   }
-  // write the file details
-  rawi_file.write(reinterpret_cast<char*>(&w), sizeof(uint32_t));
-  rawi_file.write(reinterpret_cast<char*>(&h), sizeof(uint32_t));
-  rawi_file.write(reinterpret_cast<char*>(&num_bytes), sizeof(uint32_t));
+  // the header is written again with the frame count and index offset when the file is closed
+  write_header(0);
+}
 
-  // write the image data:
-  for (int_t y=0; y<height; ++y) {
-    if(is_layout_right){
-      for (int_t x=0; x<width;++x){
-        rawi_file.write(reinterpret_cast<char*>(&intensities[y*width + x]),sizeof(intensity_t));
-      }
-    }
-    else // otherwise assume layout left
-      for (int_t x=0; x<width;++x){
-        rawi_file.write(reinterpret_cast<char*>(&intensities[x*height+y]),sizeof(intensity_t));
-      }
+Rawv_Writer::~Rawv_Writer(){
+  close();
+}
+
+void
+Rawv_Writer::write_header(const uint64_t index_offset){
+  uint32_t version = rawv_version;
+  uint32_t w = (uint32_t)width_;
+  uint32_t h = (uint32_t)height_;
+  uint64_t num_frames = frame_offsets_.size();
+  uint64_t offset = index_offset;
+  file_.write(rawv_magic,sizeof(rawv_magic));
+  file_.write(reinterpret_cast<char*>(&version),sizeof(uint32_t));
+  file_.write(reinterpret_cast<char*>(&w),sizeof(uint32_t));
+  file_.write(reinterpret_cast<char*>(&h),sizeof(uint32_t));
+  file_.write(reinterpret_cast<char*>(&num_frames),sizeof(uint64_t));
+  file_.write(reinterpret_cast<char*>(&offset),sizeof(uint64_t));
+}
+
+void
+Rawv_Writer::write_frame(const int_t width,
+  const int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right,
+  const bool compress){
+  if(!file_.is_open()){
+    std::cerr << "ERROR: Can't write a frame to a closed rawv file: " + file_name_ << std::endl;
+    exit(1);
   }
-  rawi_file.close();
+  if(frame_offsets_.empty()){
+    width_ = width;
+    height_ = height;
+  }
+  else if(width!=width_||height!=height_){
+    std::cerr << "ERROR: All frames in a rawv file must have the same dimensions, file " << file_name_ << " is " << width_ << " x " << height_ <<
+        " frame is " << width << " x " << height << std::endl;
+    exit(1);
+  }
+  frame_offsets_.push_back((uint64_t)file_.tellp());
+  std::stringstream name;
+  name << file_name_ << " frame " << frame_offsets_.size()-1;
+  write_rawi_record(file_,name.str(),width,height,intensities,is_layout_right,compress);
+}
+
+void
+Rawv_Writer::close(){
+  if(!file_.is_open()) return;
+  const uint64_t index_offset = file_.tellp();
+  if(!frame_offsets_.empty())
+    file_.write(reinterpret_cast<char*>(&frame_offsets_[0]),frame_offsets_.size()*sizeof(uint64_t));
+  file_.seekp(0);
+  write_header(index_offset);
+  file_.close();
 }
 
 } // end namespace utils
@@ -44,7 +44,10 @@
 
 #include <DICe.h>
 
+#include <cstdint>
+#include <fstream>
 #include <string>
+#include <vector>
 
 namespace DICe{
 namespace utils{
@@ -52,6 +55,16 @@ namespace utils{
 /// Raw Intensity Format (.rawi), allows saving decimal numbers
 /// as well as negative numbers, neither of which are enabled for
 /// standard image file formats
+///
+/// The file has a header with the width, height and number of bytes per value
+/// followed by the row-major intensity values. If DICe is built with zlib the values can
+/// also be stored compressed (byte shuffled then deflated), which is flagged in the header
+/// and handled automatically when the file is read. A sequence of images can be stored
+/// in one multi-frame file (.rawv), see Rawv_Reader and Rawv_Writer
+
+/// returns true if compressed rawi files can be read and written (DICe was built with zlib)
+DICE_LIB_DLL_EXPORT
+bool rawi_compression_enabled();
 
 /// read the image dimensions
 /// \param file_name the .rawi file name
@@ -71,18 +84,166 @@ void read_rawi_image(const char * file_name,
   intensity_t * intensities,
   const bool is_layout_right = true);
 
+/// Read a portion of an image into the host memory (only the rows of the portion are read from an uncompressed file)
+/// \param file_name the name of the .rawi file
+/// \param offset_x the upper left corner x-coordinate of the portion to read
+/// \param offset_y the upper left corner y-coordinate of the portion to read
+/// \param width the width of the portion to read
+/// \param height the height of the portion to read
+/// \param intensities [out] populated with the pixel intensity values (array of size width x height)
+/// \param is_layout_right [optional] memory layout is LayoutRight (row-major)
+DICE_LIB_DLL_EXPORT
+void read_rawi_image(const char * file_name,
+  const int_t offset_x,
+  const int_t offset_y,
+  const int_t width,
+  const int_t height,
+  intensity_t * intensities,
+  const bool is_layout_right = true);
+
 /// write an image to disk
 /// \param file_name the name of the .rawi file
 /// \param width the width of the image to write
 /// \param height the height of the image
 /// \param intensities assumed to be an array of size width x height
 /// \param is_layout_right [optional] memory layout is LayoutRight (row-major)
+/// \param compress [optional] store the values compressed (requires zlib, see rawi_compression_enabled())
 DICE_LIB_DLL_EXPORT
 void write_rawi_image(const char * file_name,
   const int_t width,
   const int_t height,
   intensity_t * intensities,
-  const bool is_layout_right = true);
+  const bool is_layout_right = true,
+  const bool compress = false);
+
+class Mapped_File;
+
+/// \class DICe::utils::Rawv_Reader
+/// \brief Reads frames from a multi-frame rawi file (.rawv)
+///
+/// A rawv file holds a sequence of images in one file: a header with the magic number, version,
+/// image dimensions, number of frames and the offset of the frame index, then each frame stored as a
+/// rawi record (header and values, optionally compressed), then the frame index (the byte offset of
+/// every frame). The file is memory mapped once so any frame can be read without parsing the others.
+/// Reading frames only touches read-only memory so frames can be read from several threads at once.
+class DICE_LIB_DLL_EXPORT
+Rawv_Reader{
+public:
+  /// \brief constructor, opens the file and reads the header and frame index
+  /// \param file_name the name of the .rawv file
+  Rawv_Reader(const std::string & file_name);
+
+  /// destructor
+  ~Rawv_Reader();
+
+  /// returns the number of frames in the file
+  int_t num_frames()const{return num_frames_;}
+
+  /// returns the width of the frames
+  int_t width()const{return width_;}
+
+  /// returns the height of the frames
+  int_t height()const{return height_;}
+
+  /// \brief read a frame
+  /// \param frame the zero based frame index
+  /// \param intensities [out] array of size width x height
+  /// \param is_layout_right [optional] memory layout is LayoutRight (row-major)
+  void read_frame(const int_t frame,
+    intensity_t * intensities,
+    const bool is_layout_right = true)const{
+    read_frame(frame,0,0,width_,height_,intensities,is_layout_right);
+  }
+
+  /// \brief read a portion of a frame
+  /// \param frame the zero based frame index
+  /// \param offset_x the upper left corner x-coordinate of the portion to read
+  /// \param offset_y the upper left corner y-coordinate of the portion to read
+  /// \param width the width of the portion to read
+  /// \param height the height of the portion to read
+  /// \param intensities [out] array of size width x height
+  /// \param is_layout_right [optional] memory layout is LayoutRight (row-major)
+  void read_frame(const int_t frame,
+    const int_t offset_x,
+    const int_t offset_y,
+    const int_t width,
+    const int_t height,
+    intensity_t * intensities,
+    const bool is_layout_right = true)const;
+
+private:
+  /// not copyable
+  Rawv_Reader(const Rawv_Reader &);
+  /// not assignable
+  Rawv_Reader & operator=(const Rawv_Reader &);
+  /// file name
+  std::string file_name_;
+  /// the mapped file
+  Mapped_File * file_;
+  /// start of the frame index in the mapped file
+  const char * frame_index_;
+  /// byte offset of the frame index (also the end of the last frame)
+  uint64_t index_offset_;
+  /// number of frames
+  int_t num_frames_;
+  /// frame width
+  int_t width_;
+  /// frame height
+  int_t height_;
+};
+
+/// \class DICe::utils::Rawv_Writer
+/// \brief Writes a multi-frame rawi file (.rawv) one frame at a time (see Rawv_Reader for the layout)
+///
+/// The frame index is written when the file is closed (or the writer is destroyed),
+/// a file that was not closed can't be read
+class DICE_LIB_DLL_EXPORT
+Rawv_Writer{
+public:
+  /// \brief constructor, creates the file
+  /// \param file_name the name of the .rawv file
+  Rawv_Writer(const std::string & file_name);
+
+  /// destructor, closes the file
+  ~Rawv_Writer();
+
+  /// \brief append a frame (all frames must have the same dimensions)
+  /// \param width the width of the frame
+  /// \param height the height of the frame
+  /// \param intensities assumed to be an array of size width x height
+  /// \param is_layout_right [optional] memory layout is LayoutRight (row-major)
+  /// \param compress [optional] store the values compressed (requires zlib, see rawi_compression_enabled())
+  void write_frame(const int_t width,
+    const int_t height,
+    intensity_t * intensities,
+    const bool is_layout_right = true,
+    const bool compress = false);
+
+  /// returns the number of frames written so far
+  int_t num_frames()const{return frame_offsets_.size();}
+
+  /// write the frame index and close the file
+  void close();
+
+private:
+  /// not copyable
+  Rawv_Writer(const Rawv_Writer &);
+  /// not assignable
+  Rawv_Writer & operator=(const Rawv_Writer &);
+  /// write the file header at the current position
+  /// \param index_offset the byte offset of the frame index
+  void write_header(const uint64_t index_offset);
+  /// file name
+  std::string file_name_;
+  /// output file
+  std::ofstream file_;
+  /// byte offset of each frame
+  std::vector<uint64_t> frame_offsets_;
+  /// frame width
+  int_t width_;
+  /// frame height
+  int_t height_;
+};
 
 } // end namespace utils
 } // end namespace DICe
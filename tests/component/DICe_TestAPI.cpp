@@ -54,6 +54,24 @@
 #include <Teuchos_RCP.hpp>
 
 #include <cassert>
+#include <vector>
+
+/// results collected by the streaming callback
+struct Stream_Results{
+  std::vector<int_t> frame_ids;
+  std::vector<int_t> status;
+  std::vector<scalar_t> u;
+  std::vector<scalar_t> v;
+};
+
+/// records the displacement of the first point of each streamed frame
+void stream_callback(int_t frame_id, const scalar_t points[], int_t n_points, int_t status, void * user_data){
+  Stream_Results * results = static_cast<Stream_Results*>(user_data);
+  results->frame_ids.push_back(frame_id);
+  results->status.push_back(status);
+  results->u.push_back(points!=0&&n_points>0 ? points[2] : -1.0);
+  results->v.push_back(points!=0&&n_points>0 ? points[3] : -1.0);
+}
 
 int main(int argc, char *argv[]) {
 
@@ -236,6 +254,170 @@ int main(int argc, char *argv[]) {
 
   } // image loop
 
+  *outStream << "correlating the same images with two independent handles" << std::endl;
+  // make sure the 8-bit conversion below is exact
+  for(int_t i=0;i<ref_w*ref_h;++i){
+    if(ref_img[i]!=(intensity_t)(unsigned char)ref_img[i]){
+      *outStream << "Error, the test images are expected to have 8-bit intensities" << std::endl;
+      errorFlag++;
+      break;
+    }
+  }
+  scalar_t * pointsHandles[2];
+  dice_handle handles[2];
+  for(int_t h=0;h<2;++h){
+    pointsHandles[h] = new scalar_t[(int_t)num_subsets*DICE_API_STRIDE];
+    for(int_t i=0;i<num_subsets*DICE_API_STRIDE;++i)
+      pointsHandles[h][i] = 0.0;
+    for(int_t subsetIt=0;subsetIt<num_subsets;++subsetIt){
+      pointsHandles[h][subsetIt*DICE_API_STRIDE + 0] = subset_centroids_x[subsetIt]; //x0
+      pointsHandles[h][subsetIt*DICE_API_STRIDE + 1] = subset_centroids_y[subsetIt]; //y0
+    }
+    // the first handle uses the default parameters, the second the user specified ones
+    handles[h] = dice_create(pointsHandles[h],num_subsets,subset_size,h==0 ? 0 : params.getRawPtr());
+    if(handles[h]==0 || dice_num_points(handles[h])!=num_subsets ||
+        dice_set_reference(handles[h],ref_img.get(),ref_w,ref_h)!=0){
+      *outStream << "Error, handle " << h << " could not be created" << std::endl;
+      errorFlag++;
+    }
+  }
+  // the images have to be the same size as the reference
+  if(handles[0]!=0 && dice_correlate_frame(handles[0],pointsHandles[0],ref_img.get(),ref_w-1,ref_h)==0){
+    *outStream << "Error, a frame of the wrong size should have been rejected" << std::endl;
+    errorFlag++;
+  }
+  for(size_t img=0;img<def_names.size()&&handles[0]!=0&&handles[1]!=0;++img){
+    Teuchos::RCP<DICe::Image> defImg = Teuchos::rcp( new DICe::Image(def_names[img].c_str()));
+    Teuchos::ArrayRCP<intensity_t> def_img = defImg->intensities();
+    // the second handle gets the frame as 8-bit pixels with padded rows
+    const int_t row_stride = ref_w + 3;
+    std::vector<unsigned char> def_pixels(row_stride*ref_h,0);
+    for(int_t y=0;y<ref_h;++y)
+      for(int_t x=0;x<ref_w;++x)
+        def_pixels[y*row_stride+x] = (unsigned char)def_img[y*ref_w+x];
+    for(int_t h=0;h<2;++h){
+      const int_t error_code = h==0 ? dice_correlate_frame(handles[h],pointsHandles[h],def_img.get(),ref_w,ref_h) :
+          dice_correlate_frame_buffer(handles[h],pointsHandles[h],&def_pixels[0],DICE_PIXEL_UINT8,ref_w,ref_h,row_stride);
+      if(error_code!=0){
+        *outStream << "Error, handle " << h << " failed to correlate image: " << img << std::endl;
+        errorFlag++;
+      }
+      for(int_t i=0;i<num_subsets;++i){
+        if ( std::abs(pointsHandles[h][i*DICE_API_STRIDE + 2] - img) > errtol ||
+            std::abs(pointsHandles[h][i*DICE_API_STRIDE + 3] - img) > errtol) {
+          *outStream << "Error, handle " << h << " displacement is not correct for image: " << img << std::endl;
+          errorFlag++;
+        }
+        if ( std::abs(pointsHandles[h][i*DICE_API_STRIDE + 8] - 1) > errtol) {
+          *outStream << "Error, handle " << h << " flag is not correct for image: " << img << std::endl;
+          errorFlag++;
+        }
+      }
+    }
+  }
+  for(int_t h=0;h<2;++h){
+    dice_destroy(handles[h]);
+    delete[] pointsHandles[h];
+  }
+
+  *outStream << "streaming the images to a handle" << std::endl;
+  std::vector<scalar_t> pointsStream(num_subsets*DICE_API_STRIDE,0.0);
+  for(int_t subsetIt=0;subsetIt<num_subsets;++subsetIt){
+    pointsStream[subsetIt*DICE_API_STRIDE + 0] = subset_centroids_x[subsetIt]; //x0
+    pointsStream[subsetIt*DICE_API_STRIDE + 1] = subset_centroids_y[subsetIt]; //y0
+  }
+  Stream_Results stream_results;
+  dice_handle stream_handle = dice_create(&pointsStream[0],num_subsets,subset_size);
+  // the queue holds all the frames so none are dropped
+  if(stream_handle==0 || dice_stream_start(stream_handle,&pointsStream[0],def_names.size(),0.0,stream_callback,&stream_results)==0 ||
+      dice_set_reference(stream_handle,ref_img.get(),ref_w,ref_h)!=0 ||
+      dice_stream_start(stream_handle,&pointsStream[0],def_names.size(),0.0,stream_callback,&stream_results)!=0){
+    *outStream << "Error, the stream could not be started (or was started without a reference)" << std::endl;
+    errorFlag++;
+  }
+  for(size_t img=0;img<def_names.size()&&stream_handle!=0;++img){
+    Teuchos::RCP<DICe::Image> defImg = Teuchos::rcp( new DICe::Image(def_names[img].c_str()));
+    if(dice_stream_push(stream_handle,img,defImg->intensities().get(),DICE_PIXEL_INTENSITY,ref_w,ref_h,0)!=0){
+      *outStream << "Error, image " << img << " could not be pushed" << std::endl;
+      errorFlag++;
+    }
+  }
+  if(stream_handle!=0 && dice_stream_stop(stream_handle,&pointsStream[0])!=0){
+    *outStream << "Error, the stream could not be stopped" << std::endl;
+    errorFlag++;
+  }
+  if(stream_results.frame_ids.size()!=def_names.size()){
+    *outStream << "Error, wrong number of streamed results " << stream_results.frame_ids.size() << std::endl;
+    errorFlag++;
+  }
+  for(size_t i=0;i<stream_results.frame_ids.size();++i){
+    if(stream_results.frame_ids[i]!=(int_t)i||stream_results.status[i]!=DICE_STREAM_OK||
+        std::abs(stream_results.u[i]-i)>errtol||std::abs(stream_results.v[i]-i)>errtol){
+      *outStream << "Error, the streamed result of frame " << i << " is not correct" << std::endl;
+      errorFlag++;
+    }
+  }
+  if(std::abs(pointsStream[2]-(def_names.size()-1))>errtol){
+    *outStream << "Error, the final streamed points are not correct" << std::endl;
+    errorFlag++;
+  }
+  dice_destroy(stream_handle);
+
+  *outStream << "adding, removing and moving the points of a handle between frames" << std::endl;
+  std::vector<scalar_t> pointsUpdate(num_subsets*DICE_API_STRIDE,0.0);
+  for(int_t subsetIt=0;subsetIt<num_subsets;++subsetIt){
+    pointsUpdate[subsetIt*DICE_API_STRIDE + 0] = subset_centroids_x[subsetIt]; //x0
+    pointsUpdate[subsetIt*DICE_API_STRIDE + 1] = subset_centroids_y[subsetIt]; //y0
+  }
+  dice_handle update_handle = dice_create(&pointsUpdate[0],num_subsets,subset_size);
+  if(update_handle==0 || dice_set_reference(update_handle,ref_img.get(),ref_w,ref_h)!=0){
+    *outStream << "Error, the handle for the point updates could not be created" << std::endl;
+    errorFlag++;
+  }
+  for(size_t img=0;img<def_names.size()&&update_handle!=0;++img){
+    if(img==2){
+      // remove the second point, the remaining points are compacted in order
+      const int_t remove_id = 1;
+      if(dice_remove_points(update_handle,&remove_id,1)!=0||dice_num_points(update_handle)!=num_subsets-1){
+        *outStream << "Error, the point could not be removed" << std::endl;
+        errorFlag++;
+      }
+      pointsUpdate.erase(pointsUpdate.begin()+DICE_API_STRIDE,pointsUpdate.begin()+2*DICE_API_STRIDE);
+    }
+    else if(img==3){
+      // add a point at the center that starts from the displacement of the others
+      std::vector<scalar_t> new_point(DICE_API_STRIDE,0.0);
+      new_point[0] = 49; new_point[1] = 49; new_point[2] = img-1; new_point[3] = img-1;
+      if(dice_add_points(update_handle,&new_point[0],1)!=0||dice_num_points(update_handle)!=num_subsets){
+        *outStream << "Error, the point could not be added" << std::endl;
+        errorFlag++;
+      }
+      pointsUpdate.insert(pointsUpdate.end(),new_point.begin(),new_point.end());
+    }
+    else if(img==4){
+      // move the first point two pixels to the right
+      const int_t move_id = 0;
+      pointsUpdate[0] += 2;
+      if(dice_move_points(update_handle,&move_id,&pointsUpdate[0],1)!=0){
+        *outStream << "Error, the point could not be moved" << std::endl;
+        errorFlag++;
+      }
+    }
+    Teuchos::RCP<DICe::Image> defImg = Teuchos::rcp( new DICe::Image(def_names[img].c_str()));
+    if(dice_correlate_frame(update_handle,&pointsUpdate[0],defImg->intensities().get(),ref_w,ref_h)!=0){
+      *outStream << "Error, the updated handle failed to correlate image: " << img << std::endl;
+      errorFlag++;
+    }
+    for(int_t i=0;i<dice_num_points(update_handle);++i){
+      if ( std::abs(pointsUpdate[i*DICE_API_STRIDE + 2] - img) > errtol ||
+          std::abs(pointsUpdate[i*DICE_API_STRIDE + 3] - img) > errtol) {
+        *outStream << "Error, updated handle displacement is not correct for point " << i << " image: " << img << std::endl;
+        errorFlag++;
+      }
+    }
+  }
+  dice_destroy(update_handle);
+
 
   if (errorFlag != 0)
     std::cout << "End Result: TEST FAILED\n";
@@ -48,6 +48,7 @@
 #include <Teuchos_ParameterList.hpp>
 
 #include <iostream>
+#include <vector>
 
 using namespace DICe;
 
@@ -136,6 +137,36 @@ int main(int argc, char *argv[]) {
       }
       *outStream << "intensity values have been checked" << std::endl;
     }
+
+    // the memory mapped reader should give the same intensities as the stream based reader
+    DICe::cine::Cine_Reader stream_reader(full_name.str(),outStream.getRawPtr(),false,false);
+    if(stream_reader.is_memory_mapped()||stream_reader.frame_data(0)!=NULL){
+      *outStream << "Error, the stream based reader should not be memory mapped" << std::endl;
+      errorFlag++;
+    }
+    *outStream << "cine reader is memory mapped: " << cine_reader.is_memory_mapped() << std::endl;
+    const int_t roi_x = 16;
+    const int_t roi_y = 24;
+    const int_t roi_w = 64;
+    const int_t roi_h = 40;
+    std::vector<intensity_t> mapped_intens(cine_reader.width()*cine_reader.height(),0.0);
+    std::vector<intensity_t> stream_intens(cine_reader.width()*cine_reader.height(),0.0);
+    bool mapped_value_error = false;
+    for(int_t frame=0;frame<cine_reader.num_frames();++frame){
+      cine_reader.get_frame(0,0,cine_reader.width(),cine_reader.height(),&mapped_intens[0],true,frame,false,false);
+      stream_reader.get_frame(0,0,cine_reader.width(),cine_reader.height(),&stream_intens[0],true,frame,false,false);
+      for(size_t j=0;j<mapped_intens.size();++j)
+        if(mapped_intens[j]!=stream_intens[j]) mapped_value_error = true;
+      cine_reader.get_frame(roi_x,roi_y,roi_w,roi_h,&mapped_intens[0],true,frame,false,true);
+      stream_reader.get_frame(roi_x,roi_y,roi_w,roi_h,&stream_intens[0],true,frame,false,true);
+      for(int_t j=0;j<roi_w*roi_h;++j)
+        if(mapped_intens[j]!=stream_intens[j]) mapped_value_error = true;
+    }
+    if(mapped_value_error){
+      *outStream << "Error, the memory mapped and stream based intensity values do not match" << std::endl;
+      errorFlag++;
+    }
+    *outStream << "memory mapped intensity values have been checked" << std::endl;
   }
 
   *outStream << "testing invalid cine file for an exception" << std::endl;
@@ -307,6 +338,24 @@ int main(int argc, char *argv[]) {
   }
   //img_cine_0->write("image_cine_-85.rawi");
 
+  *outStream << "testing the threaded frame average" << std::endl;
+  // the frames are split into chunks across the threads, the average should match the serial one
+  const int_t avg_w = cine_reader_16.width();
+  const int_t avg_h = cine_reader_16.height();
+  std::vector<intensity_t> serial_avg(avg_w*avg_h,0.0);
+  std::vector<intensity_t> threaded_avg(avg_w*avg_h,0.0);
+  cine_reader_16.get_average_frame(0,6,0,0,avg_w,avg_h,&serial_avg[0],true,false,true,1);
+  cine_reader_16.get_average_frame(0,6,0,0,avg_w,avg_h,&threaded_avg[0],true,false,true,4);
+  bool avg_error = false;
+  for(int_t i=0;i<avg_w*avg_h;++i){
+    if(std::abs(serial_avg[i]-threaded_avg[i]) > 1.0E-3)
+      avg_error = true;
+  }
+  if(avg_error){
+    *outStream << "Error, the threaded frame average does not match the serial one" << std::endl;
+    errorFlag++;
+  }
+
 
   *outStream << "--- End test ---" << std::endl;
 
@@ -133,10 +133,13 @@ int main(int argc, char *argv[]) {
   opt_methods.push_back(DICe::SIMPLEX_THEN_GRADIENT_BASED);
   opt_methods.push_back(DICe::GRADIENT_BASED);
   opt_methods.push_back(DICe::GRADIENT_BASED_THEN_SIMPLEX);
+  opt_methods.push_back(DICe::INVERSE_COMPOSITIONAL);
+  opt_methods.push_back(DICe::INVERSE_COMPOSITIONAL_THEN_SIMPLEX);
 
   std::vector<DICe::Interpolation_Method> interp_methods;
   interp_methods.push_back(DICe::BILINEAR);
   interp_methods.push_back(DICe::KEYS_FOURTH);
+  interp_methods.push_back(DICe::CUBIC_BSPLINE);
 
   // BEGIN PARAMS LOOP
 
@@ -201,6 +204,33 @@ int main(int argc, char *argv[]) {
   }
   // END PARAMS LOOP
 
+  *outStream << "testing the low contrast subset rejection" << std::endl;
+  params->set(DICe::optimization_method,DICe::GRADIENT_BASED);
+  params->set(DICe::low_contrast_recheck_interval,1);
+  // the first threshold is above the contrast of any image, the second one below it
+  const scalar_t contrast_thresholds[] = {1.0E6,1.0E-3};
+  for(int_t pass=0;pass<2;++pass){
+    params->set(DICe::low_contrast_threshold,contrast_thresholds[pass]);
+    schemaSquare->set_params(params);
+    schemaSquare->local_field_value(0,STATUS_FLAG_FS) = 0;
+    schemaSquare->local_field_value(0,SUBSET_DISPLACEMENT_X_FS) = u_exact - 0.25;
+    schemaSquare->local_field_value(0,SUBSET_DISPLACEMENT_Y_FS) = v_exact - 0.25;
+    schemaSquare->local_field_value(0,ROTATION_Z_FS) = t_exact - 0.05;
+    schemaSquare->local_field_value(0,NORMAL_STRETCH_XX_FS) = 0.0;
+    schemaSquare->local_field_value(0,NORMAL_STRETCH_YY_FS) = 0.0;
+    schemaSquare->local_field_value(0,SHEAR_STRETCH_XY_FS) = 0.0;
+    schemaSquare->execute_correlation();
+    const bool rejected = schemaSquare->local_field_value(0,STATUS_FLAG_FS)==DICe::SUBSET_REJECTED_DUE_TO_LOW_CONTRAST;
+    if(rejected!=(pass==0)){
+      *outStream << "Error, the low contrast rejection status is wrong for threshold " << contrast_thresholds[pass] << std::endl;
+      errorFlag++;
+    }
+    if(pass==0&&schemaSquare->local_field_value(0,SIGMA_FS)!=-1.0){
+      *outStream << "Error, a rejected subset should record a failed step" << std::endl;
+      errorFlag++;
+    }
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
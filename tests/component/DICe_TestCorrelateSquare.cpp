@@ -163,6 +163,30 @@ int main(int argc, char *argv[]) {
     errorFlag++;
   }
 
+  *outStream << "testing the same subsets correlated with multiple threads" << std::endl;
+  // (if OpenMP is not enabled the schema resets num_threads to 1 and this is a serial repeat)
+  Teuchos::RCP<Teuchos::ParameterList> threaded_params = rcp(new Teuchos::ParameterList(*params));
+  threaded_params->set(DICe::num_threads,4);
+  Teuchos::RCP<DICe::Schema> schemaThreaded = Teuchos::rcp(new DICe::Schema(roi_w,roi_h,multiple_step_size_x,multiple_step_size_y,multiple_subset_size,threaded_params));
+  schemaThreaded->set_ref_image("./images/refSpeckled.tif");
+  schemaThreaded->set_def_image("./images/defSpeckled.tif");
+  schemaThreaded->execute_correlation();
+  *outStream << "    Number of threads:      " << schemaThreaded->num_threads() << std::endl;
+  bool threaded_error = schemaThreaded->local_num_subsets()!=schemaMultiple->local_num_subsets();
+  for(int_t i=0;i<schemaMultiple->local_num_subsets()&&!threaded_error;++i){
+    const scalar_t diff_x = schemaThreaded->local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_X_FS) -
+        schemaMultiple->local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_X_FS);
+    const scalar_t diff_y = schemaThreaded->local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_Y_FS) -
+        schemaMultiple->local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_Y_FS);
+    if(std::abs(diff_x)>1.0E-6||std::abs(diff_y)>1.0E-6) threaded_error = true;
+    if(schemaThreaded->local_field_value(i,DICe::field_enums::STATUS_FLAG_FS)!=
+        schemaMultiple->local_field_value(i,DICe::field_enums::STATUS_FLAG_FS)) threaded_error = true;
+  }
+  if(threaded_error){
+    *outStream << "---> POSSIBLE ERROR ABOVE! Threaded results do not match the serial results." << std::endl;
+    errorFlag++;
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
@@ -51,6 +51,9 @@
 #include <Teuchos_XMLParameterListHelpers.hpp>
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <map>
 
 using namespace DICe;
 
@@ -118,6 +121,114 @@ int main(int argc, char *argv[]) {
     *outStream << "Error, wrong number of global subsets" << std::endl;
   }
 
+  *outStream << "testing the coordinate bisection partition" << std::endl;
+  // a 20 x 20 grid of points with the points on the right half three times as expensive as the left
+  const int_t grid_dim = 20;
+  const int_t num_points = grid_dim*grid_dim;
+  const int_t num_parts = 4;
+  Teuchos::ArrayRCP<scalar_t> coords_x(num_points,0.0);
+  Teuchos::ArrayRCP<scalar_t> coords_y(num_points,0.0);
+  Teuchos::ArrayRCP<scalar_t> weights(num_points,1.0);
+  for(int_t j=0;j<grid_dim;++j){
+    for(int_t i=0;i<grid_dim;++i){
+      coords_x[j*grid_dim+i] = 10.0*i;
+      coords_y[j*grid_dim+i] = 10.0*j;
+      if(i>=grid_dim/2) weights[j*grid_dim+i] = 3.0;
+    }
+  }
+  std::vector<int_t> part;
+  coordinate_bisection_partition(coords_x,coords_y,weights,num_parts,part);
+  std::vector<scalar_t> part_weight(num_parts,0.0);
+  std::vector<scalar_t> part_min_x(num_parts,1.0E10), part_max_x(num_parts,-1.0E10);
+  std::vector<scalar_t> part_min_y(num_parts,1.0E10), part_max_y(num_parts,-1.0E10);
+  for(int_t i=0;i<num_points;++i){
+    if(part[i]<0||part[i]>=num_parts){
+      errorFlag++;
+      *outStream << "Error, invalid part " << part[i] << " for point " << i << std::endl;
+      continue;
+    }
+    part_weight[part[i]] += weights[i];
+    part_min_x[part[i]] = std::min(part_min_x[part[i]],coords_x[i]);
+    part_max_x[part[i]] = std::max(part_max_x[part[i]],coords_x[i]);
+    part_min_y[part[i]] = std::min(part_min_y[part[i]],coords_y[i]);
+    part_max_y[part[i]] = std::max(part_max_y[part[i]],coords_y[i]);
+  }
+  const scalar_t total_weight = 2.0*num_points;
+  for(int_t p=0;p<num_parts;++p){
+    *outStream << "part " << p << " weight " << part_weight[p] << " x " << part_min_x[p] << " to " << part_max_x[p] <<
+        " y " << part_min_y[p] << " to " << part_max_y[p] << std::endl;
+    // each part should get a quarter of the work give or take a row of points
+    if(std::abs(part_weight[p] - total_weight/num_parts) > 3.0*grid_dim){
+      errorFlag++;
+      *outStream << "Error, the work is not balanced for part " << p << std::endl;
+    }
+  }
+  // the bounding boxes of the parts can touch where a cut goes through a column of points but should not overlap
+  for(int_t p=0;p<num_parts;++p){
+    for(int_t q=p+1;q<num_parts;++q){
+      if(part_min_x[p]<part_max_x[q]&&part_min_x[q]<part_max_x[p]&&part_min_y[p]<part_max_y[q]&&part_min_y[q]<part_max_y[p]){
+        errorFlag++;
+        *outStream << "Error, parts " << p << " and " << q << " overlap" << std::endl;
+      }
+    }
+  }
+
+  *outStream << "testing a spatial decomposition" << std::endl;
+  Teuchos::RCP<Teuchos::ParameterList> spatialParams = Teuchos::rcp(new Teuchos::ParameterList());
+  spatialParams->set(DICe::use_spatial_decomposition,true);
+  Teuchos::RCP<Decomp> spatial_decomp = Teuchos::rcp(new Decomp(coords_x,coords_y,Teuchos::null,Teuchos::null,spatialParams,weights));
+  if(!spatial_decomp->id_decomp_map()->is_one_to_one()||spatial_decomp->id_decomp_map()->get_num_global_elements()!=num_points){
+    errorFlag++;
+    *outStream << "Error, the spatial decomposition map is not valid" << std::endl;
+  }
+  // when run on four processors each processor should own one of the parts
+  const MultiField_Comm spatial_comm = spatial_decomp->id_decomp_map()->get_comm();
+  for(int_t i=0;i<spatial_decomp->id_decomp_map()->get_num_local_elements();++i){
+    const int_t gid = spatial_decomp->id_decomp_map()->get_global_element(i);
+    if(spatial_comm.get_size()==num_parts&&part[gid]!=spatial_comm.get_rank()){
+      errorFlag++;
+      *outStream << "Error, subset " << gid << " is on the wrong processor" << std::endl;
+    }
+  }
+
+  *outStream << "testing the obstruction grouping" << std::endl;
+  // 3 is blocked by 2 which is blocked by 1 which is blocked by 0 (three relations deep),
+  // 7 is blocked by 6 and 5, subset 4 has no relations
+  std::map<int_t,std::vector<int_t> > obstructions;
+  obstructions[3] = std::vector<int_t>(1,2);
+  obstructions[2] = std::vector<int_t>(1,1);
+  obstructions[1] = std::vector<int_t>(1,0);
+  obstructions[7].push_back(6);
+  obstructions[7].push_back(5);
+  std::vector<std::vector<int_t> > groups;
+  group_obstructed_subsets(8,obstructions,groups);
+  if(groups.size()!=2){
+    errorFlag++;
+    *outStream << "Error, there should be 2 obstruction groups, not " << groups.size() << std::endl;
+  }
+  else{
+    if(groups[0].size()!=4||groups[0][0]!=0||groups[0][3]!=3){
+      errorFlag++;
+      *outStream << "Error, the first obstruction group is wrong" << std::endl;
+    }
+    if(groups[1].size()!=3||groups[1][0]!=5||groups[1][2]!=7){
+      errorFlag++;
+      *outStream << "Error, the second obstruction group is wrong" << std::endl;
+    }
+  }
+  std::vector<int_t> obst_order;
+  for(int_t i=7;i>=0;--i)
+    obst_order.push_back(i);
+  order_by_obstructions(obstructions,obst_order);
+  std::vector<int_t> position(8,-1);
+  for(size_t i=0;i<obst_order.size();++i)
+    position[obst_order[i]] = i;
+  if(obst_order.size()!=8||position[0]>position[1]||position[1]>position[2]||position[2]>position[3]||
+      position[5]>position[7]||position[6]>position[7]){
+    errorFlag++;
+    *outStream << "Error, the subsets are not ordered after their blocking subsets" << std::endl;
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
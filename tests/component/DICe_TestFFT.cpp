@@ -47,6 +47,7 @@
 #include <Teuchos_oblackholestream.hpp>
 #include <Teuchos_ParameterList.hpp>
 
+#include <algorithm>
 #include <iostream>
 
 using namespace DICe;
@@ -122,6 +123,67 @@ int main(int argc, char *argv[]) {
 
   *outStream << "done testing high pass filter" << std::endl;
 
+  *outStream << "testing the real input fft against the complex fft" << std::endl;
+  // odd dimensions exercise the unpaired row and the conjugate symmetry of the columns
+  for(int_t dims=0;dims<2;++dims){
+    const int_t w = dims==0 ? 37 : 40;
+    const int_t h = dims==0 ? 23 : 18;
+    Teuchos::ArrayRCP<intensity_t> intens(w*h,0.0);
+    for(int_t i=0;i<w*h;++i)
+      intens[i] = 128.0 + 100.0*std::sin(0.37*i) + (i%7);
+    Teuchos::RCP<Image> small_img = Teuchos::rcp(new Image(w,h,intens));
+    for(int_t inverse=0;inverse<2;++inverse){
+      Teuchos::ArrayRCP<scalar_t> fft_r,fft_i;
+      image_fft(small_img,fft_r,fft_i,inverse,false);
+      Teuchos::ArrayRCP<scalar_t> full_r(w*h,0.0),full_i(w*h,0.0);
+      for(int_t i=0;i<w*h;++i)
+        full_r[i] = intens[i];
+      array_2d_fft_in_place(w,h,full_r,full_i,inverse);
+      scalar_t max_fft_diff = 0.0;
+      scalar_t max_fft_value = 0.0;
+      for(int_t i=0;i<w*h;++i){
+        max_fft_diff = std::max(max_fft_diff,std::max(std::abs(fft_r[i]-full_r[i]),std::abs(fft_i[i]-full_i[i])));
+        max_fft_value = std::max(max_fft_value,std::abs(full_r[i]));
+      }
+      *outStream << "fft " << w << " x " << h << " inverse " << inverse << " max diff between real and complex path " << max_fft_diff << std::endl;
+      if(max_fft_diff > 1.0E-4*max_fft_value){
+        *outStream << "Error, the real input fft does not match the complex fft" << std::endl;
+        errorFlag++;
+      }
+      // the threaded transforms should give the same values as the serial ones
+      Teuchos::ArrayRCP<scalar_t> thread_r,thread_i;
+      image_fft(small_img,thread_r,thread_i,inverse,false,4);
+      Teuchos::ArrayRCP<scalar_t> thread_full_r(w*h,0.0),thread_full_i(w*h,0.0);
+      for(int_t i=0;i<w*h;++i)
+        thread_full_r[i] = intens[i];
+      array_2d_fft_in_place(w,h,thread_full_r,thread_full_i,inverse,4);
+      scalar_t max_thread_diff = 0.0;
+      for(int_t i=0;i<w*h;++i){
+        max_thread_diff = std::max(max_thread_diff,std::max(std::abs(thread_r[i]-fft_r[i]),std::abs(thread_i[i]-fft_i[i])));
+        max_thread_diff = std::max(max_thread_diff,std::max(std::abs(thread_full_r[i]-full_r[i]),std::abs(thread_full_i[i]-full_i[i])));
+      }
+      if(max_thread_diff > 0.0){
+        *outStream << "Error, the threaded fft does not match the serial fft, max diff " << max_thread_diff << std::endl;
+        errorFlag++;
+      }
+    }
+  }
+
+  *outStream << "testing the fft plan cache" << std::endl;
+  clear_fft_plan_cache();
+  kiss_fft_cfg plan_a = fft_plan(64,0);
+  kiss_fft_cfg plan_b = fft_plan(64,0);
+  kiss_fft_cfg plan_c = fft_plan(64,1);
+  if(plan_a!=plan_b||plan_a==plan_c||fft_plan_cache_size()!=2){
+    *outStream << "Error, the fft plan cache did not reuse the configurations" << std::endl;
+    errorFlag++;
+  }
+  clear_fft_plan_cache();
+  if(fft_plan_cache_size()!=0){
+    *outStream << "Error, the fft plan cache was not cleared" << std::endl;
+    errorFlag++;
+  }
+
 #ifdef DICE_USE_DOUBLE
   // dont test the phase correlations for type double
 #else
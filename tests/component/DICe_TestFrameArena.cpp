@@ -0,0 +1,153 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_FrameArena.h>
+#include <DICe_MemoryTracker.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <iostream>
+#include <stdexcept>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "checking that arrays can only be allocated inside a scope" << std::endl;
+  bool exception_thrown = false;
+  try{
+    Frame_Arena::instance().allocate<scalar_t>(10);
+  }
+  catch(std::logic_error &){
+    exception_thrown = true;
+  }
+  if(!exception_thrown){
+    *outStream << "Error, an allocation outside of a scope should throw" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "checking that nested scopes release their arrays" << std::endl;
+  Frame_Arena & arena = Frame_Arena::instance();
+  {
+    Frame_Arena::Scope outer;
+    scalar_t * a = outer.arena().allocate<scalar_t>(100);
+    for(int_t i=0;i<100;++i)
+      a[i] = i;
+    const size_t outer_bytes = arena.bytes_in_use();
+    {
+      Frame_Arena::Scope inner;
+      // larger than the first block so a second block is added
+      intensity_t * b = inner.arena().allocate<intensity_t>(200000);
+      for(int_t i=0;i<200000;++i)
+        b[i] = 1.0;
+      if(arena.num_blocks()<2){
+        *outStream << "Error, the arena should have grown to two blocks, num blocks " << arena.num_blocks() << std::endl;
+        errorFlag++;
+      }
+    }
+    if(arena.bytes_in_use()!=outer_bytes){
+      *outStream << "Error, the inner scope did not release its arrays, bytes in use " << arena.bytes_in_use() << " expected " << outer_bytes << std::endl;
+      errorFlag++;
+    }
+    // the arrays of the inner scope must not have overwritten the outer array
+    for(int_t i=0;i<100;++i){
+      if(a[i]!=i){
+        *outStream << "Error, the outer array was overwritten at " << i << std::endl;
+        errorFlag++;
+        break;
+      }
+    }
+  }
+  if(arena.bytes_in_use()!=0){
+    *outStream << "Error, the arena should be empty after the outer scope closed" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "checking that the blocks are merged after the end of the frame" << std::endl;
+  const size_t capacity = arena.capacity();
+  Frame_Arena::end_frame();
+  {
+    Frame_Arena::Scope scope;
+    if(arena.num_blocks()!=1||arena.capacity()>capacity){
+      *outStream << "Error, the arena was not compacted: num blocks " << arena.num_blocks() << " capacity " << arena.capacity() << std::endl;
+      errorFlag++;
+    }
+    // the same work as the previous frame fits in the merged block
+    scope.arena().allocate<scalar_t>(100);
+    scope.arena().allocate<intensity_t>(200000);
+    if(arena.num_blocks()!=1){
+      *outStream << "Error, the merged block should hold the previous frame's arrays" << std::endl;
+      errorFlag++;
+    }
+  }
+  if(Memory_Tracker::current(MEMORY_CACHES)<(long long)arena.capacity()){
+    *outStream << "Error, the arena blocks are not counted by the memory tracker" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
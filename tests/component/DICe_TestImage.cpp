@@ -43,11 +43,15 @@
 #include <DICe_Image.h>
 #include <DICe_Shape.h>
 #include <DICe_LocalShapeFunction.h>
+#include <DICe_ImageIO.h>
+#include <DICe_SharedFrameCache.h>
 
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_oblackholestream.hpp>
 #include <Teuchos_ParameterList.hpp>
 
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 
 using namespace DICe;
@@ -140,6 +144,41 @@ int main(int argc, char *argv[]) {
     errorFlag+=1;
   }
 
+  // round trip through the rawi format and read a portion of the rawi file
+  *outStream << "writing and reading a rawi file" << std::endl;
+  img->write("rawi_round_trip.rawi");
+  Teuchos::RCP<Image> rawi_img = Teuchos::rcp(new Image("rawi_round_trip.rawi"));
+  if(rawi_img->diff(img) > mask_tol){
+    *outStream << "Error, the rawi image does not match the original image" << std::endl;
+    errorFlag++;
+  }
+  Image sub_rawi_img("rawi_round_trip.rawi",100,100,300,200);
+  intensity_match_error = sub_rawi_img.width()!=300 || sub_rawi_img.height()!=200;
+  for(int_t y=0;y<sub_rawi_img.height()&&!intensity_match_error;++y){
+    for(int_t x=0;x<sub_rawi_img.width();++x){
+      if(sub_rawi_img(x,y)!=(*img)(x+sub_rawi_img.offset_x(),y+sub_rawi_img.offset_y()))
+        intensity_match_error = true;
+    }
+  }
+  if(intensity_match_error){
+    *outStream << "Error, the intensities for the rawi sub image do not match the global image" << std::endl;
+    errorFlag++;
+  }
+  if(utils::rawi_compression_enabled()){
+    *outStream << "writing and reading a compressed rawi file" << std::endl;
+    img->write("rawi_round_trip_compressed.rawi",true,true);
+    Teuchos::RCP<Image> compressed_img = Teuchos::rcp(new Image("rawi_round_trip_compressed.rawi"));
+    if(compressed_img->diff(img) > mask_tol){
+      *outStream << "Error, the compressed rawi image does not match the original image" << std::endl;
+      errorFlag++;
+    }
+    Image sub_compressed_img("rawi_round_trip_compressed.rawi",100,100,300,200);
+    if(sub_compressed_img.diff(Teuchos::rcp(&sub_rawi_img,false)) > mask_tol){
+      *outStream << "Error, the compressed rawi sub image does not match the uncompressed one" << std::endl;
+      errorFlag++;
+    }
+  }
+
   *outStream << "creating a sub-image" << std::endl;
   // purposefully making the image extend beyond the bounds of the input image
   Teuchos::RCP<Image> portion = Teuchos::rcp(new Image(img,img->width()/2,img->height()/2,img->width(),img->height()));
@@ -579,6 +618,249 @@ int main(int argc, char *argv[]) {
     errorFlag++;
   }
 
+  *outStream << "testing the sum of squared differences" << std::endl;
+  const int_t ssd_w = 40;
+  const int_t ssd_h = 30;
+  const scalar_t ssd_tol = 1.0E-3;
+  Teuchos::ArrayRCP<intensity_t> ssd_a(ssd_w*ssd_h,0.0);
+  Teuchos::ArrayRCP<intensity_t> ssd_b(ssd_w*ssd_h,0.0);
+  for(int_t i=0;i<ssd_w*ssd_h;++i){
+    ssd_a[i] = (intensity_t)(i%17);
+    // every pixel differs by 2 so the sum is 4 per pixel
+    ssd_b[i] = ssd_a[i] + 2.0;
+  }
+  Teuchos::RCP<Image> ssd_img_a = Teuchos::rcp(new Image(ssd_w,ssd_h,ssd_a));
+  Teuchos::RCP<Image> ssd_img_b = Teuchos::rcp(new Image(ssd_w,ssd_h,ssd_b));
+  const scalar_t ssd_full = ssd_img_a->sum_squared_diff(ssd_img_b);
+  if(std::abs(ssd_full - 4.0*ssd_w*ssd_h) > ssd_tol){
+    *outStream << "Error, the sum of squared differences is " << ssd_full << " should be " << 4.0*ssd_w*ssd_h << std::endl;
+    errorFlag++;
+  }
+  const scalar_t ssd_border = ssd_img_a->sum_squared_diff(ssd_img_b,5);
+  if(std::abs(ssd_border - 4.0*(ssd_w-10)*(ssd_h-10)) > ssd_tol){
+    *outStream << "Error, the sum of squared differences with a border is " << ssd_border << std::endl;
+    errorFlag++;
+  }
+  // the strided sum is scaled to estimate the full sum
+  const scalar_t ssd_stride = ssd_img_a->sum_squared_diff(ssd_img_b,0,2);
+  if(std::abs(ssd_stride - ssd_full) > ssd_tol){
+    *outStream << "Error, the strided sum of squared differences is " << ssd_stride << " should be " << ssd_full << std::endl;
+    errorFlag++;
+  }
+  // the early exit stops once the threshold is passed
+  const scalar_t ssd_early = ssd_img_a->sum_squared_diff(ssd_img_b,0,1,100.0);
+  if(ssd_early <= 100.0 || ssd_early >= ssd_full){
+    *outStream << "Error, the early exit sum of squared differences is " << ssd_early << std::endl;
+    errorFlag++;
+  }
+  if(ssd_img_a->sum_squared_diff(ssd_img_a)!=0.0){
+    *outStream << "Error, the sum of squared differences of an image with itself should be zero" << std::endl;
+    errorFlag++;
+  }
+  // a 10x8 window with a border of 1 compares 8x6 pixels, the part of a window outside the image is skipped
+  const scalar_t ssd_window = ssd_img_a->sum_squared_diff_region(ssd_img_b,12,7,21,14,1);
+  const scalar_t ssd_clipped = ssd_img_a->sum_squared_diff_region(ssd_img_b,30,20,50,40);
+  if(std::abs(ssd_window - 4.0*8*6) > ssd_tol || std::abs(ssd_clipped - 4.0*10*10) > ssd_tol){
+    *outStream << "Error, the sum of squared differences of a window is " << ssd_window << " or " << ssd_clipped << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing threaded filtering and gradients" << std::endl;
+  Teuchos::RCP<Teuchos::ParameterList> serial_params = rcp(new Teuchos::ParameterList());
+  serial_params->set(DICe::gauss_filter_images,true);
+  serial_params->set(DICe::compute_image_gradients,true);
+  serial_params->set(DICe::gradient_method,CONVOLUTION_5_POINT);
+  Teuchos::RCP<Teuchos::ParameterList> threaded_params = rcp(new Teuchos::ParameterList(*serial_params));
+  threaded_params->set(DICe::num_threads,4);
+  Teuchos::RCP<Image> serial_img = Teuchos::rcp(new Image("./images/ImageB.tif",serial_params));
+  Teuchos::RCP<Image> threaded_img = Teuchos::rcp(new Image("./images/ImageB.tif",threaded_params));
+  // each row is computed the same way regardless of the thread that owns it
+  bool threaded_error = serial_img->sum_squared_diff(threaded_img)!=0.0;
+  Teuchos::ArrayRCP<scalar_t> serial_grad_x = serial_img->grad_x_array();
+  Teuchos::ArrayRCP<scalar_t> serial_grad_y = serial_img->grad_y_array();
+  Teuchos::ArrayRCP<scalar_t> threaded_grad_x = threaded_img->grad_x_array();
+  Teuchos::ArrayRCP<scalar_t> threaded_grad_y = threaded_img->grad_y_array();
+  for(int_t i=0;i<serial_img->num_pixels();++i){
+    if(serial_grad_x[i]!=threaded_grad_x[i]||serial_grad_y[i]!=threaded_grad_y[i])
+      threaded_error = true;
+  }
+  if(threaded_error){
+    *outStream << "Error, the threaded filter or gradients do not match the serial ones" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the fused filter and gradients" << std::endl;
+  // filtering and computing the gradients in separate passes should give the same result as the fused pass
+  Teuchos::RCP<Teuchos::ParameterList> fused_params = rcp(new Teuchos::ParameterList());
+  fused_params->set(DICe::gauss_filter_images,true);
+  fused_params->set(DICe::compute_image_gradients,true);
+  Teuchos::RCP<Image> fused_img = Teuchos::rcp(new Image("./images/ImageB.tif",fused_params));
+  Teuchos::RCP<Image> separate_img = Teuchos::rcp(new Image("./images/ImageB.tif"));
+  separate_img->gauss_filter(7);
+  separate_img->compute_gradients();
+  bool fused_error = !fused_img->has_gauss_filter() || !fused_img->has_gradients() || fused_img->sum_squared_diff(separate_img)!=0.0;
+  Teuchos::ArrayRCP<scalar_t> fused_grad_x = fused_img->grad_x_array();
+  Teuchos::ArrayRCP<scalar_t> fused_grad_y = fused_img->grad_y_array();
+  Teuchos::ArrayRCP<scalar_t> separate_grad_x = separate_img->grad_x_array();
+  Teuchos::ArrayRCP<scalar_t> separate_grad_y = separate_img->grad_y_array();
+  for(int_t i=0;i<fused_img->num_pixels();++i){
+    if(fused_grad_x[i]!=separate_grad_x[i]||fused_grad_y[i]!=separate_grad_y[i])
+      fused_error = true;
+  }
+  if(fused_error){
+    *outStream << "Error, the fused filter and gradients do not match the separate passes" << std::endl;
+    errorFlag++;
+  }
+
+#if !DICE_KOKKOS
+  *outStream << "testing the lazy gradients" << std::endl;
+  // the gradients computed one tile at a time should match the ones computed for the whole image
+  Teuchos::RCP<Teuchos::ParameterList> lazy_params = rcp(new Teuchos::ParameterList(*serial_params));
+  lazy_params->set(DICe::lazy_image_gradients,true);
+  Teuchos::RCP<Image> lazy_img = Teuchos::rcp(new Image("./images/ImageB.tif",lazy_params));
+  const int_t total_tiles = lazy_img->num_pending_gradient_tiles();
+  bool lazy_error = !lazy_img->has_gradients() || total_tiles==0;
+  lazy_img->compute_gradient_tiles(10,10,20,20);
+  if(lazy_img->num_pending_gradient_tiles()!=total_tiles-1)
+    lazy_error = true;
+  lazy_img->compute_gradient_tiles();
+  if(lazy_img->num_pending_gradient_tiles()!=0)
+    lazy_error = true;
+  Teuchos::ArrayRCP<scalar_t> lazy_grad_x = lazy_img->grad_x_array();
+  Teuchos::ArrayRCP<scalar_t> lazy_grad_y = lazy_img->grad_y_array();
+  for(int_t i=0;i<lazy_img->num_pixels();++i){
+    if(serial_grad_x[i]!=lazy_grad_x[i]||serial_grad_y[i]!=lazy_grad_y[i])
+      lazy_error = true;
+  }
+  if(lazy_error){
+    *outStream << "Error, the lazy gradients do not match the ones computed for the whole image" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the preprocessed image file" << std::endl;
+  // a raw image that reads the preprocessed file should match the filtered image with gradients
+  fused_img->write_preprocessed("preprocessed_test.dpi");
+  Teuchos::RCP<Image> restored_img = Teuchos::rcp(new Image("./images/ImageB.tif"));
+  bool preprocessed_error = !restored_img->read_preprocessed("preprocessed_test.dpi") || !restored_img->has_gauss_filter() ||
+      !restored_img->has_gradients() || restored_img->sum_squared_diff(fused_img)!=0.0;
+  Teuchos::ArrayRCP<scalar_t> restored_grad_x = restored_img->grad_x_array();
+  Teuchos::ArrayRCP<scalar_t> restored_grad_y = restored_img->grad_y_array();
+  for(int_t i=0;i<restored_img->num_pixels();++i){
+    if(fused_grad_x[i]!=restored_grad_x[i]||fused_grad_y[i]!=restored_grad_y[i])
+      preprocessed_error = true;
+  }
+  // an image of another size is left unchanged
+  Teuchos::RCP<Image> sub_img = Teuchos::rcp(new Image("./images/ImageB.tif",10,20,30,40));
+  if(sub_img->read_preprocessed("preprocessed_test.dpi")||sub_img->has_gauss_filter())
+    preprocessed_error = true;
+  std::remove("preprocessed_test.dpi");
+  if(preprocessed_error){
+    *outStream << "Error, the image restored from the preprocessed file does not match" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the analytic gradients" << std::endl;
+  // no gradients are stored and the interpolated gradients match central differences of the interpolant
+  Teuchos::RCP<Teuchos::ParameterList> analytic_params = rcp(new Teuchos::ParameterList());
+  analytic_params->set(DICe::compute_image_gradients,true);
+  analytic_params->set(DICe::analytic_def_gradients,true);
+  Teuchos::RCP<Image> analytic_img = Teuchos::rcp(new Image("./images/ImageB.tif",analytic_params));
+  bool analytic_error = !analytic_img->analytic_gradients() || analytic_img->has_gradients() || analytic_img->grad_x_array().size()!=0;
+  const scalar_t fd_step = 0.01;
+  const Interpolation_Method analytic_interps[3] = {BILINEAR,BICUBIC,KEYS_FOURTH};
+  for(int_t m=0;m<3;++m){
+    for(int_t pt=0;pt<10;++pt){
+      const scalar_t px = 10.3 + 2.1*pt;
+      const scalar_t py = 12.6 + 1.7*pt;
+      const scalar_t xs[5] = {px,px-fd_step,px+fd_step,px,px};
+      const scalar_t ys[5] = {py,py,py,py-fd_step,py+fd_step};
+      intensity_t values[5];
+      scalar_t gx[5];
+      scalar_t gy[5];
+      analytic_img->batch_interpolate(5,xs,ys,values,gx,gy,analytic_interps[m]);
+      const scalar_t fd_gx = (values[2]-values[1])/(2.0*fd_step);
+      const scalar_t fd_gy = (values[4]-values[3])/(2.0*fd_step);
+      if(std::abs(gx[0]-fd_gx)>0.1||std::abs(gy[0]-fd_gy)>0.1){
+        *outStream << "analytic gradient " << gx[0] << " " << gy[0] << " central difference " << fd_gx << " " << fd_gy << std::endl;
+        analytic_error = true;
+      }
+    }
+  }
+  if(analytic_error){
+    *outStream << "Error, the analytic gradients are not correct" << std::endl;
+    errorFlag++;
+  }
+#endif
+
+  *outStream << "testing the decoded frame cache" << std::endl;
+  utils::Image_Reader_Cache & frame_cache = utils::Image_Reader_Cache::instance();
+  Teuchos::RCP<Image> uncached_img = Teuchos::rcp(new Image("./images/ImageB.tif"));
+  // room for two copies of the frame, a third one pushes out the least recently used frame
+  // (the image is 8 bit so the cache holds one byte per pixel)
+  const size_t frame_bytes = uncached_img->num_pixels()*sizeof(uint8_t);
+  frame_cache.set_frame_cache_budget(2*frame_bytes);
+  Teuchos::RCP<Image> first_cached_img = Teuchos::rcp(new Image("./images/ImageB.tif"));
+  Teuchos::RCP<Image> second_cached_img = Teuchos::rcp(new Image("./images/ImageB.tif"));
+  bool frame_cache_error = frame_cache.num_cached_frames()!=1 || frame_cache.frame_cache_size()!=frame_bytes ||
+      first_cached_img->sum_squared_diff(uncached_img)!=0.0 || second_cached_img->sum_squared_diff(uncached_img)!=0.0;
+  Teuchos::RCP<Image> sub_cached_img = Teuchos::rcp(new Image("./images/ImageB.tif",10,20,30,40));
+  Teuchos::RCP<Image> other_cached_img = Teuchos::rcp(new Image("./images/ImageA.tif"));
+  std::vector<intensity_t> cached_values(uncached_img->num_pixels());
+  const std::string b_key = utils::Image_Reader_Cache::frame_key("./images/ImageB.tif",0,0,uncached_img->width(),uncached_img->height(),true,true,false);
+  if(frame_cache.num_cached_frames()!=2 || frame_cache.frame_cache_size()>frame_cache.frame_cache_budget() ||
+      frame_cache.find_frame(b_key,cached_values.size(),&cached_values[0]))
+    frame_cache_error = true;
+  frame_cache.clear_frame_cache();
+  // values that are not whole numbers are kept at full precision
+  std::vector<intensity_t> fractional_values(4,0.5);
+  fractional_values[3] = 70000.0;
+  frame_cache.insert_frame("fractional",fractional_values.size(),&fractional_values[0]);
+  std::vector<intensity_t> wide_values(4,300.0);
+  frame_cache.insert_frame("wide",wide_values.size(),&wide_values[0]);
+  if(frame_cache.frame_cache_size()!=4*sizeof(intensity_t)+4*sizeof(uint16_t))
+    frame_cache_error = true;
+  std::vector<intensity_t> found_values(4,0.0);
+  if(!frame_cache.find_frame("fractional",4,&found_values[0])||found_values!=fractional_values)
+    frame_cache_error = true;
+  if(!frame_cache.find_frame("wide",4,&found_values[0])||found_values!=wide_values)
+    frame_cache_error = true;
+  frame_cache.set_frame_cache_budget(0);
+  frame_cache.clear_frame_cache();
+  if(frame_cache_error){
+    *outStream << "Error, the decoded frame cache is not correct" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the shared preprocessed frames" << std::endl;
+  Teuchos::RCP<Teuchos::ParameterList> shared_params = rcp(new Teuchos::ParameterList());
+  shared_params->set(DICe::gauss_filter_images,true);
+  shared_params->set(DICe::compute_image_gradients,true);
+  Teuchos::RCP<Teuchos::ParameterList> other_shared_params = rcp(new Teuchos::ParameterList());
+  other_shared_params->set(DICe::gauss_filter_images,false);
+  other_shared_params->set(DICe::compute_image_gradients,true);
+  // off by default, every request reads its own frame
+  bool shared_frame_error = Shared_Frame_Cache::frame("./images/ImageB.tif",0,0,-1,-1,shared_params)==
+      Shared_Frame_Cache::frame("./images/ImageB.tif",0,0,-1,-1,shared_params);
+  Shared_Frame_Cache::set_capacity(2);
+  Teuchos::RCP<Image> shared_img = Shared_Frame_Cache::frame("./images/ImageB.tif",0,0,-1,-1,shared_params);
+  if(Shared_Frame_Cache::frame("./images/ImageB.tif",0,0,-1,-1,shared_params)!=shared_img||Shared_Frame_Cache::num_hits()!=1)
+    shared_frame_error = true;
+  // a different region or different preprocessing is a different frame
+  if(Shared_Frame_Cache::frame("./images/ImageB.tif",10,20,30,40,shared_params)==shared_img||
+      Shared_Frame_Cache::frame("./images/ImageB.tif",0,0,-1,-1,other_shared_params)==shared_img)
+    shared_frame_error = true;
+  // the first frame was the least recently used of the three
+  if(Shared_Frame_Cache::frame("./images/ImageB.tif",0,0,-1,-1,shared_params)==shared_img)
+    shared_frame_error = true;
+  Teuchos::RCP<Image> unshared_img = Teuchos::rcp(new Image("./images/ImageB.tif",shared_params));
+  if(shared_img->sum_squared_diff(unshared_img)!=0.0||!shared_img->has_gradients()||!shared_img->has_gauss_filter())
+    shared_frame_error = true;
+  Shared_Frame_Cache::set_capacity(0);
+  if(shared_frame_error){
+    *outStream << "Error, the shared preprocessed frames are not correct" << std::endl;
+    errorFlag++;
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
@@ -80,6 +80,35 @@ int main(int argc, char *argv[]) {
   Teuchos::RCP<SinCos_Image_Deformer> deformer = Teuchos::rcp(new SinCos_Image_Deformer(num_steps,true));
   Teuchos::RCP<Image> def_img = deformer->deform_image(ref_img);
   def_img->write("sincos_def.tif");
+
+  *outStream << "checking that the threaded and batched deformations match the serial one" << std::endl;
+  Teuchos::RCP<Image> def_img_threaded = deformer->deform_image(ref_img,4);
+  std::vector<Teuchos::RCP<Image_Deformer> > deformers;
+  deformers.push_back(Teuchos::rcp(new SinCos_Image_Deformer(50,0.5)));
+  deformers.push_back(deformer);
+  std::vector<Teuchos::RCP<Image> > def_imgs = deform_images(ref_img,deformers,3);
+  Teuchos::RCP<Image> def_img_variant = deformers[0]->deform_image(ref_img);
+  for(int_t i=0;i<ref_img->width()*ref_img->height();++i){
+    if(def_img_threaded->intensities()[i]!=def_img->intensities()[i]||def_imgs[1]->intensities()[i]!=def_img->intensities()[i]
+      ||def_imgs[0]->intensities()[i]!=def_img_variant->intensities()[i]){
+      *outStream << "Error, the deformed intensities do not match at pixel " << i << std::endl;
+      errorFlag++;
+      break;
+    }
+  }
+
+  *outStream << "checking that the synthetic speckles and noise do not depend on the number of threads" << std::endl;
+  Teuchos::RCP<Image> speckle_img = create_synthetic_speckle_image(101,67,3,5,7.0);
+  Teuchos::RCP<Image> speckle_img_threaded = create_synthetic_speckle_image(101,67,3,5,7.0,Teuchos::null,4);
+  add_noise_to_image(speckle_img,2.0,11);
+  add_noise_to_image(speckle_img_threaded,2.0,11,4);
+  for(int_t i=0;i<speckle_img->width()*speckle_img->height();++i){
+    if(speckle_img->intensities()[i]!=speckle_img_threaded->intensities()[i]){
+      *outStream << "Error, the noisy speckle intensities do not match at pixel " << i << std::endl;
+      errorFlag++;
+      break;
+    }
+  }
 #endif
 
   *outStream << "--- End test ---" << std::endl;
@@ -0,0 +1,159 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#include <DICe.h>
+#include <DICe_Image.h>
+#include <DICe_ImagePrefetcher.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <iostream>
+#include <vector>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  Teuchos::RCP<Teuchos::ParameterList> imgParams = Teuchos::rcp(new Teuchos::ParameterList());
+  imgParams->set(DICe::compute_image_gradients,true);
+  imgParams->set(DICe::gauss_filter_images,true);
+  imgParams->set(DICe::gauss_filter_mask_size,7);
+
+  // images loaded directly for comparison
+  Teuchos::RCP<Image> img_a = Teuchos::rcp(new Image("./images/ImageA.tif",imgParams));
+  Teuchos::RCP<Image> img_b = Teuchos::rcp(new Image("./images/ImageB.tif",imgParams));
+  Teuchos::RCP<Image> sub_img_a = Teuchos::rcp(new Image("./images/ImageA.tif",100,100,300,200,imgParams));
+  Teuchos::RCP<Image> big_sub_img_b = Teuchos::rcp(new Image("./images/ImageB.tif",50,50,350,250,imgParams));
+
+  *outStream << "queuing frames in the prefetcher" << std::endl;
+  Teuchos::RCP<Image_Prefetcher> prefetcher = Teuchos::rcp(new Image_Prefetcher(imgParams));
+  prefetcher->request("./images/ImageA.tif");
+  prefetcher->request("./images/ImageB.tif");
+  prefetcher->request("./images/ImageA.tif",100,100,300,200);
+  // this region will be too small when the frame is retrieved so it should get reloaded
+  prefetcher->request("./images/ImageB.tif",100,100,300,200);
+  prefetcher->request("./images/does_not_exist.tif");
+  if(prefetcher->num_pending()!=5){
+    *outStream << "Error, the number of pending frames should be 5, not " << prefetcher->num_pending() << std::endl;
+    errorFlag++;
+  }
+
+  std::vector<Teuchos::RCP<Image> > gold;
+  gold.push_back(img_a);
+  gold.push_back(img_b);
+  gold.push_back(sub_img_a);
+  gold.push_back(big_sub_img_b);
+  for(size_t i=0;i<gold.size();++i){
+    Teuchos::RCP<Image> img;
+    if(i==3)
+      img = prefetcher->next(50,50,350,250);
+    else if(i==2)
+      img = prefetcher->next(100,100,300,200);
+    else
+      img = prefetcher->next();
+    if(img->width()!=gold[i]->width()||img->height()!=gold[i]->height()||
+        img->offset_x()!=gold[i]->offset_x()||img->offset_y()!=gold[i]->offset_y()){
+      *outStream << "Error, prefetched frame " << i << " has the wrong dimensions or offsets" << std::endl;
+      errorFlag++;
+      continue;
+    }
+    const scalar_t diff = img->diff(gold[i]);
+    *outStream << "prefetched frame " << i << " diff from directly loaded image: " << diff << std::endl;
+    if(diff > 1.0E-3){
+      *outStream << "Error, prefetched frame " << i << " does not match the directly loaded image" << std::endl;
+      errorFlag++;
+    }
+    if(!img->has_gradients()||!img->has_gauss_filter()){
+      *outStream << "Error, prefetched frame " << i << " should have been filtered and have gradients" << std::endl;
+      errorFlag++;
+    }
+  }
+
+  *outStream << "testing that a failed background load throws when the frame is retrieved" << std::endl;
+  bool exception_thrown = false;
+  try{
+    Teuchos::RCP<Image> img = prefetcher->next();
+  }
+  catch(const std::exception & e){
+    exception_thrown = true;
+    *outStream << "exception thrown as expected" << std::endl;
+  }
+  if(!exception_thrown){
+    *outStream << "Error, an exception should have been thrown for a missing image file" << std::endl;
+    errorFlag++;
+  }
+  if(prefetcher->num_pending()!=0){
+    *outStream << "Error, there should not be any pending frames" << std::endl;
+    errorFlag++;
+  }
+
+  // destroying the prefetcher with frames still queued should stop the background thread cleanly
+  prefetcher->request("./images/ImageA.tif");
+  prefetcher->request("./images/ImageB.tif");
+  prefetcher = Teuchos::null;
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
@@ -173,6 +173,21 @@ int main(int argc, char *argv[]) {
     *outStream << "Error, the distance to this point is wrong" << std::endl;
     errorFlag++;
   }
+  *outStream << "testing the batch closest point function" << std::endl;
+  const size_t num_query_pts = 4;
+  scalar_t query_u[] = {10.0,100.0,450.0,60.0};
+  scalar_t query_v[] = {12.0,230.0,20.0,40.0};
+  scalar_t query_t[] = {0.01,456.0,0.0,0.2};
+  size_t batch_ids[num_query_pts];
+  scalar_t batch_dist[num_query_pts];
+  path.closest_triads(num_query_pts,query_u,query_v,query_t,batch_ids,batch_dist,2);
+  for(size_t i=0;i<num_query_pts;++i){
+    path.closest_triad(query_u[i],query_v[i],query_t[i],id,dist);
+    if(batch_ids[i]!=id||batch_dist[i]!=dist){
+      *outStream << "Error, the batch closest triad for point " << i << " does not match the single query" << std::endl;
+      errorFlag++;
+    }
+  }
 
   *outStream << "testing the initializers in a schema" << std::endl;
   const int_t num_subsets = 4;
@@ -48,6 +48,9 @@
 #include <Teuchos_ParameterList.hpp>
 
 #include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 
 using namespace DICe;
 
@@ -126,6 +129,144 @@ int main(int argc, char *argv[]) {
     errorFlag++;
   }
 
+  *outStream << "testing the B-spline interpolants" << std::endl;
+  const Interpolation_Method bspline_methods[] = {CUBIC_BSPLINE,QUINTIC_BSPLINE};
+  for(int_t method=0;method<2;++method){
+    Subset subset_spline(cx,cy,10,10);
+    subset_spline.initialize(array_img,DEF_INTENSITIES,shape_function,bspline_methods[method]);
+    scalar_t error_spline = 0.0;
+    for(int_t i=0;i<subset_spline.num_pixels();++i){
+      shape_function->map(subset_spline.x(i),subset_spline.y(i),cx,cy,px,py);
+      x_val = 255.0*px/(scalar_t)array_w;
+      y_val = 255.0*py/(scalar_t)array_h;
+      error_spline += std::abs(subset_spline.def_intensities(i) - x_val*y_val);
+    }
+    *outStream << interpolationMethodStrings[bspline_methods[method]] << " interp error: " << error_spline << std::endl;
+    // the quintic prefilter decays more slowly so the mirror boundary of this small image reaches further into the subset
+    const scalar_t spline_tol = bspline_methods[method]==CUBIC_BSPLINE ? 2.0 : 10.0;
+    if(error_spline > spline_tol){
+      *outStream << "Error, " << interpolationMethodStrings[bspline_methods[method]] << " interpolation failed simple translation" << std::endl;
+      errorFlag++;
+    }
+  }
+
+  *outStream << "testing the batch interpolation against the single point methods" << std::endl;
+  array_img->compute_gradients();
+  // the B-spline gradients are the derivatives of the spline so they are checked against the exact gradient
+  for(int_t method=0;method<2;++method){
+    const int_t num_grad_points = 25;
+    std::vector<scalar_t> grad_pts_x(num_grad_points);
+    std::vector<scalar_t> grad_pts_y(num_grad_points);
+    for(int_t i=0;i<num_grad_points;++i){
+      grad_pts_x[i] = 10.3 + 0.77*i;
+      grad_pts_y[i] = 8.6 + 0.51*i;
+    }
+    std::vector<intensity_t> spline_intensities(num_grad_points);
+    std::vector<scalar_t> spline_grad_x(num_grad_points);
+    std::vector<scalar_t> spline_grad_y(num_grad_points);
+    array_img->batch_interpolate(num_grad_points,&grad_pts_x[0],&grad_pts_y[0],&spline_intensities[0],
+      &spline_grad_x[0],&spline_grad_y[0],bspline_methods[method]);
+    scalar_t grad_error = 0.0;
+    for(int_t i=0;i<num_grad_points;++i){
+      const scalar_t exact_gx = 255.0*255.0*grad_pts_y[i]/(array_w*array_h);
+      const scalar_t exact_gy = 255.0*255.0*grad_pts_x[i]/(array_w*array_h);
+      grad_error = std::max(grad_error,std::abs(spline_grad_x[i]-exact_gx)/exact_gx);
+      grad_error = std::max(grad_error,std::abs(spline_grad_y[i]-exact_gy)/exact_gy);
+    }
+    *outStream << interpolationMethodStrings[bspline_methods[method]] << " max relative gradient error: " << grad_error << std::endl;
+    if(grad_error > 2.0E-3){
+      *outStream << "Error, " << interpolationMethodStrings[bspline_methods[method]] << " gradients are not accurate" << std::endl;
+      errorFlag++;
+    }
+  }
+  // the points sweep across the whole image so that the boundary fall backs are also exercised
+  const int_t num_batch_points = 200;
+  std::vector<scalar_t> batch_x(num_batch_points);
+  std::vector<scalar_t> batch_y(num_batch_points);
+  for(int_t i=0;i<num_batch_points;++i){
+    batch_x[i] = -1.0 + (array_w+1.0)*(scalar_t)i/(scalar_t)num_batch_points;
+    batch_y[i] = 0.25*array_h + 0.7*array_h*std::sin(0.37*i)*std::sin(0.37*i) - 1.3;
+  }
+  std::vector<intensity_t> batch_intensities(num_batch_points);
+  std::vector<scalar_t> batch_grad_x(num_batch_points);
+  std::vector<scalar_t> batch_grad_y(num_batch_points);
+  const Interpolation_Method batch_methods[] = {BILINEAR,BICUBIC,KEYS_FOURTH};
+  for(int_t method=0;method<3;++method){
+    const Interpolation_Method interp = batch_methods[method];
+    array_img->batch_interpolate(num_batch_points,&batch_x[0],&batch_y[0],&batch_intensities[0],&batch_grad_x[0],&batch_grad_y[0],interp);
+    scalar_t batch_error = 0.0;
+    for(int_t i=0;i<num_batch_points;++i){
+      intensity_t intens = 0.0;
+      scalar_t gx = 0.0, gy = 0.0;
+      if(interp==BILINEAR){
+        intens = array_img->interpolate_bilinear(batch_x[i],batch_y[i]);
+        gx = array_img->interpolate_grad_x_bilinear(batch_x[i],batch_y[i]);
+        gy = array_img->interpolate_grad_y_bilinear(batch_x[i],batch_y[i]);
+      }
+      else if(interp==BICUBIC){
+        intens = array_img->interpolate_bicubic(batch_x[i],batch_y[i]);
+        gx = array_img->interpolate_grad_x_bicubic(batch_x[i],batch_y[i]);
+        gy = array_img->interpolate_grad_y_bicubic(batch_x[i],batch_y[i]);
+      }
+      else{
+        intens = array_img->interpolate_keys_fourth(batch_x[i],batch_y[i]);
+        gx = array_img->interpolate_grad_x_keys_fourth(batch_x[i],batch_y[i]);
+        gy = array_img->interpolate_grad_y_keys_fourth(batch_x[i],batch_y[i]);
+      }
+      // relative to the intensity range (0 to ~65000) so the float rounding of the bicubic weights is tolerated
+      batch_error = std::max(batch_error,(scalar_t)std::abs(batch_intensities[i]-intens)/(1.0f+std::abs(intens)));
+      batch_error = std::max(batch_error,(scalar_t)std::abs(batch_grad_x[i]-gx)/(1.0f+std::abs(gx)));
+      batch_error = std::max(batch_error,(scalar_t)std::abs(batch_grad_y[i]-gy)/(1.0f+std::abs(gy)));
+    }
+    *outStream << "batch interpolation max relative error (" << interpolationMethodStrings[interp] << "): " << batch_error << std::endl;
+    if(batch_error > 1.0E-4){
+      *outStream << "Error, batch interpolation does not match the single point interpolation" << std::endl;
+      errorFlag++;
+    }
+  }
+  // the tiled layout holds the same values so the results should be identical
+  std::vector<intensity_t> row_major_intensities = batch_intensities;
+  array_img->batch_interpolate(num_batch_points,&batch_x[0],&batch_y[0],&row_major_intensities[0],&batch_grad_x[0],&batch_grad_y[0],KEYS_FOURTH);
+  std::vector<scalar_t> row_major_grad_x = batch_grad_x;
+  std::vector<scalar_t> row_major_grad_y = batch_grad_y;
+  array_img->compute_tiled_layout();
+  array_img->batch_interpolate(num_batch_points,&batch_x[0],&batch_y[0],&batch_intensities[0],&batch_grad_x[0],&batch_grad_y[0],KEYS_FOURTH);
+  if(batch_intensities!=row_major_intensities||batch_grad_x!=row_major_grad_x||batch_grad_y!=row_major_grad_y){
+    *outStream << "Error, the tiled image layout changes the interpolated values" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the quantized interpolation weights against the exact weights" << std::endl;
+  // rounding the sub-pixel offsets to the table moves the interpolated location by at most 1/512 pixel
+  // in each direction, so the error should be bounded by the exact gradient times that distance
+  const Interpolation_Method quantized_methods[] = {BICUBIC,KEYS_FOURTH};
+  for(int_t method=0;method<2;++method){
+    const Interpolation_Method interp = quantized_methods[method];
+    std::vector<intensity_t> exact_intensities(num_batch_points);
+    std::vector<scalar_t> exact_grad_x(num_batch_points);
+    std::vector<scalar_t> exact_grad_y(num_batch_points);
+    array_img->set_quantized_interpolation_weights(false);
+    array_img->batch_interpolate(num_batch_points,&batch_x[0],&batch_y[0],&exact_intensities[0],&exact_grad_x[0],&exact_grad_y[0],interp);
+    array_img->set_quantized_interpolation_weights(true);
+    array_img->batch_interpolate(num_batch_points,&batch_x[0],&batch_y[0],&batch_intensities[0],&batch_grad_x[0],&batch_grad_y[0],interp);
+    array_img->set_quantized_interpolation_weights(false);
+    scalar_t max_error = 0.0;
+    scalar_t max_error_ratio = 0.0;
+    for(int_t i=0;i<num_batch_points;++i){
+      const scalar_t error = std::abs(batch_intensities[i]-exact_intensities[i]);
+      const scalar_t bound = (std::abs(exact_grad_x[i])+std::abs(exact_grad_y[i]))/512.0;
+      max_error = std::max(max_error,error);
+      // a small allowance for the rounding of the weights in single precision
+      max_error_ratio = std::max(max_error_ratio,error/(bound + 1.0E-4*(1.0+std::abs(exact_intensities[i]))));
+    }
+    *outStream << "quantized weights max intensity error (" << interpolationMethodStrings[interp] << "): " << max_error
+        << " (" << max_error_ratio << " of the bound)" << std::endl;
+    if(max_error_ratio > 1.5){
+      *outStream << "Error, the quantized interpolation weights are not accurate enough" << std::endl;
+      errorFlag++;
+    }
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
@@ -0,0 +1,139 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_MemoryTracker.h>
+#include <DICe_Image.h>
+#include <DICe_Subset.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "checking the current and peak counters" << std::endl;
+  const long long caches_start = Memory_Tracker::current(MEMORY_CACHES);
+  Memory_Tracker::reset_peaks();
+  {
+    Tracked_Memory memory(MEMORY_CACHES,1000);
+    memory.set(4000);
+    memory.set(2000);
+    // a copy holds no bytes
+    Tracked_Memory copy(memory);
+    if(copy.bytes()!=0){
+      *outStream << "Error, a copy should not hold any bytes" << std::endl;
+      errorFlag++;
+    }
+    if(Memory_Tracker::current(MEMORY_CACHES)!=caches_start+2000||Memory_Tracker::peak(MEMORY_CACHES)!=caches_start+4000){
+      *outStream << "Error, wrong counters: current " << Memory_Tracker::current(MEMORY_CACHES) << " peak " << Memory_Tracker::peak(MEMORY_CACHES) << std::endl;
+      errorFlag++;
+    }
+  }
+  if(Memory_Tracker::current(MEMORY_CACHES)!=caches_start){
+    *outStream << "Error, the bytes were not released when the owner was destroyed" << std::endl;
+    errorFlag++;
+  }
+  Memory_Tracker::reset_peaks();
+  if(Memory_Tracker::peak(MEMORY_CACHES)!=caches_start){
+    *outStream << "Error, reset_peaks() should set the peak to the current value" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "checking that images and subsets are counted" << std::endl;
+  const long long images_start = Memory_Tracker::current(MEMORY_IMAGES);
+  const long long subsets_start = Memory_Tracker::current(MEMORY_SUBSETS);
+  {
+    Teuchos::RCP<Image> image = Teuchos::rcp(new Image(100,50,0.0));
+    if(Memory_Tracker::current(MEMORY_IMAGES)<images_start+100*50*(long long)sizeof(intensity_t)){
+      *outStream << "Error, the image pixels were not counted" << std::endl;
+      errorFlag++;
+    }
+    Subset subset(20,20,11,11);
+    if(Memory_Tracker::current(MEMORY_SUBSETS)<subsets_start+121*(long long)(2*sizeof(intensity_t)+2*sizeof(int_t))){
+      *outStream << "Error, the subset pixels were not counted" << std::endl;
+      errorFlag++;
+    }
+  }
+  if(Memory_Tracker::current(MEMORY_IMAGES)!=images_start||Memory_Tracker::current(MEMORY_SUBSETS)!=subsets_start){
+    *outStream << "Error, the image or subset bytes were not released" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "checking the frame line" << std::endl;
+  std::stringstream ss;
+  Memory_Tracker::write_frame(ss,3,true);
+  if(ss.str().find("FRAME IMAGES IMAGES_PEAK")!=0||ss.str().find("\n3 ")==std::string::npos){
+    *outStream << "Error, the frame line is not correct:\n" << ss.str() << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
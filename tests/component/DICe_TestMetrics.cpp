@@ -0,0 +1,150 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Metrics.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+using namespace DICe;
+
+/// read a whole file into a string
+std::string read_file(const std::string & file_name){
+  std::ifstream file(file_name.c_str());
+  return std::string((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  Frame_Metrics frame;
+  frame.frame_id = 3;
+  frame.num_subsets = 10;
+  frame.num_failed = 2;
+  frame.num_fallbacks = 1;
+  frame.frame_time = 0.5;
+  frame.image_bytes = 1000;
+  frame.prefetch_depth = 2;
+  frame.status_counts[CORRELATION_SUCCESSFUL] = 8;
+  frame.status_counts[FRAME_FAILED_DUE_TO_NEGATIVE_SIGMA] = 2;
+
+  *outStream << "writing a json lines sample for every frame" << std::endl;
+  {
+    Metrics_Sink sink("metrics_test.txt",0.0);
+    sink.record_frame(frame);
+    sink.record_frame(frame);
+    if(sink.num_samples()!=2){
+      *outStream << "Error, a sample should be written for each frame with a zero interval" << std::endl;
+      errorFlag++;
+    }
+  }
+  const std::string json = read_file("metrics_test.txt");
+  size_t num_lines = 0;
+  for(size_t i=0;i<json.size();++i)
+    if(json[i]=='\n') num_lines++;
+  if(num_lines!=2||json.find("\"subsets\":20")==std::string::npos||json.find("\"failure_rate\":0.2")==std::string::npos||
+      json.find("\"prefetch_queue_depth\":2")==std::string::npos||json.find(to_string(FRAME_FAILED_DUE_TO_NEGATIVE_SIGMA))==std::string::npos){
+    *outStream << "Error, the json lines file is not correct:\n" << json << std::endl;
+    errorFlag++;
+  }
+  std::remove("metrics_test.txt");
+
+  *outStream << "writing the last sample on destruction" << std::endl;
+  {
+    Metrics_Sink sink("metrics_test.txt",1.0E6);
+    sink.record_frame(frame);
+    if(sink.num_samples()!=0){
+      *outStream << "Error, no sample should be written before the interval has passed" << std::endl;
+      errorFlag++;
+    }
+  }
+  if(read_file("metrics_test.txt").find("\"frames\":1")==std::string::npos){
+    *outStream << "Error, the last sample was not written when the sink was destroyed" << std::endl;
+    errorFlag++;
+  }
+  std::remove("metrics_test.txt");
+
+  *outStream << "writing a prometheus text file" << std::endl;
+  {
+    Metrics_Sink sink("metrics_test.prom",0.0,1);
+    sink.record_frame(frame);
+    sink.record_frame(frame);
+  }
+  const std::string prom = read_file("metrics_test.prom");
+  if(prom.find("dice_frames_total{rank=\"1\"} 2")==std::string::npos||prom.find("dice_subset_failures_total{rank=\"1\"} 4")==std::string::npos||
+      prom.find("# TYPE dice_subsets_per_second gauge")==std::string::npos){
+    *outStream << "Error, the prometheus file is not correct:\n" << prom << std::endl;
+    errorFlag++;
+  }
+  std::remove("metrics_test.prom");
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
@@ -0,0 +1,172 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_PostProcessor.h>
+#include <DICe_Mesh.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <iostream>
+#include <cmath>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "creating a point mesh on a regular grid" << std::endl;
+  const int_t num_x = 12;
+  const int_t num_y = 10;
+  const scalar_t spacing = 5.0;
+  const int_t num_points = num_x*num_y;
+  Teuchos::ArrayRCP<scalar_t> coords_x(num_points,0.0);
+  Teuchos::ArrayRCP<scalar_t> coords_y(num_points,0.0);
+  Teuchos::ArrayRCP<int_t> node_map(num_points,0);
+  Teuchos::ArrayRCP<int_t> connectivity(num_points,0);
+  Teuchos::ArrayRCP<int_t> elem_map(num_points,0);
+  for(int_t j=0;j<num_y;++j){
+    for(int_t i=0;i<num_x;++i){
+      const int_t id = j*num_x + i;
+      coords_x[id] = 20.0 + i*spacing;
+      coords_y[id] = 30.0 + j*spacing;
+      node_map[id] = id;
+      connectivity[id] = id + 1; // exodus elem ids are 1-based
+      elem_map[id] = id;
+    }
+  }
+  std::vector<std::pair<int_t,int_t> > dirichlet_boundary_nodes;
+  std::set<int_t> neumann_boundary_nodes;
+  std::set<int_t> lagrange_boundary_nodes;
+  Teuchos::RCP<DICe::mesh::Mesh> mesh = DICe::mesh::create_point_or_tri_mesh(DICe::mesh::MESHLESS,
+    coords_x,coords_y,connectivity,node_map,elem_map,
+    dirichlet_boundary_nodes,neumann_boundary_nodes,lagrange_boundary_nodes,"neighborhood_cache.e");
+
+  Neighborhood_Cache cache(mesh);
+  const std::string coords_name = DICe::field_enums::INITIAL_COORDINATES_FS.get_name_label();
+  const scalar_t radius = 1.5*spacing;
+
+  *outStream << "checking the radius search against a brute force search" << std::endl;
+  Teuchos::RCP<Neighborhood> neigh = cache.neighborhood(coords_name,coords_name,radius);
+  if((int_t)neigh->neighbor_list.size()!=num_points){
+    *outStream << "Error, the neighbor list has the wrong size" << std::endl;
+    errorFlag++;
+  }
+  else{
+    for(int_t i=0;i<num_points;++i){
+      int_t num_brute_force = 0;
+      for(int_t j=0;j<num_points;++j){
+        const scalar_t dx = coords_x[j] - coords_x[i];
+        const scalar_t dy = coords_y[j] - coords_y[i];
+        if(dx*dx+dy*dy <= radius*radius) num_brute_force++;
+      }
+      if((int_t)neigh->neighbor_list[i].size()!=num_brute_force){
+        *outStream << "Error, point " << i << " has " << neigh->neighbor_list[i].size() << " neighbors, should be " << num_brute_force << std::endl;
+        errorFlag++;
+      }
+      for(size_t j=0;j<neigh->neighbor_list[i].size();++j){
+        const int_t id = neigh->neighbor_list[i][j];
+        if(std::abs(neigh->neighbor_dist_x[i][j] - (coords_x[id]-coords_x[i])) > 1.0E-5 ||
+            std::abs(neigh->neighbor_dist_y[i][j] - (coords_y[id]-coords_y[i])) > 1.0E-5){
+          *outStream << "Error, wrong neighbor distance for point " << i << std::endl;
+          errorFlag++;
+        }
+      }
+    }
+  }
+
+  *outStream << "checking that the kd-tree and neighbor lists are shared" << std::endl;
+  Teuchos::RCP<Neighborhood> neigh_same = cache.neighborhood(coords_name,coords_name,radius);
+  if(neigh_same.get()!=neigh.get()||cache.num_kd_tree_builds()!=1||cache.num_neighborhood_searches()!=1){
+    *outStream << "Error, the neighborhood for the same radius should have been reused" << std::endl;
+    errorFlag++;
+  }
+  Teuchos::RCP<Neighborhood> neigh_knn = cache.neighborhood(coords_name,coords_name,-4.0);
+  if(cache.num_kd_tree_builds()!=1||cache.num_neighborhood_searches()!=2){
+    *outStream << "Error, the kd-tree should have been reused for a new radius" << std::endl;
+    errorFlag++;
+  }
+  for(int_t i=0;i<num_points;++i){
+    if(neigh_knn->neighbor_list[i].size()!=4){
+      *outStream << "Error, the k-nearest search should give 4 neighbors for point " << i << std::endl;
+      errorFlag++;
+    }
+  }
+
+  *outStream << "checking that the neighborhoods are rebuilt if the coordinates change" << std::endl;
+  mesh->get_field(DICe::field_enums::INITIAL_COORDINATES_FS)->local_value(0) += 100.0;
+  Teuchos::RCP<Neighborhood> neigh_moved = cache.neighborhood(coords_name,coords_name,radius);
+  if(neigh_moved.get()==neigh.get()||cache.num_kd_tree_builds()!=2||cache.num_neighborhood_searches()!=3){
+    *outStream << "Error, the neighborhood should have been rebuilt for the new coordinates" << std::endl;
+    errorFlag++;
+  }
+  // the moved point is far from the grid so its only neighbor is itself
+  if(neigh_moved->neighbor_list[0].size()!=1){
+    *outStream << "Error, the moved point should only be its own neighbor" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
@@ -0,0 +1,164 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#include <DICe.h>
+#include <DICe_OutputWriter.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  const int_t max_pending = 2;
+  const int_t num_tasks = 20;
+  std::vector<int_t> order;
+  std::mutex order_mutex;
+
+  *outStream << "testing that the tasks run in order with a limited queue" << std::endl;
+  {
+    Output_Writer writer(max_pending);
+    for(int_t i=0;i<num_tasks;++i){
+      // the copy of i made here is what the task writes, like the copied field values
+      writer.submit([i,&order,&order_mutex](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(i);
+      });
+      if(writer.num_pending()>max_pending){
+        *outStream << "Error, the writer has more than " << max_pending << " pending tasks" << std::endl;
+        errorFlag++;
+      }
+    }
+    writer.flush();
+    if(writer.num_pending()!=0){
+      *outStream << "Error, there should be no pending tasks after flush" << std::endl;
+      errorFlag++;
+    }
+    if((int_t)order.size()!=num_tasks){
+      *outStream << "Error, the wrong number of tasks ran " << order.size() << " should be " << num_tasks << std::endl;
+      errorFlag++;
+    }
+    for(size_t i=0;i<order.size();++i){
+      if(order[i]!=(int_t)i){
+        *outStream << "Error, task " << order[i] << " ran in position " << i << std::endl;
+        errorFlag++;
+      }
+    }
+  }
+
+  *outStream << "testing that the destructor finishes the pending tasks" << std::endl;
+  order.clear();
+  {
+    Output_Writer writer(max_pending);
+    for(int_t i=0;i<4;++i){
+      writer.submit([i,&order,&order_mutex](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(i);
+      });
+    }
+  }
+  if(order.size()!=4){
+    *outStream << "Error, the destructor should wait for the pending tasks, " << order.size() << " of 4 ran" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing that task errors are reported" << std::endl;
+  {
+    Output_Writer writer(max_pending);
+    bool later_task_ran = false;
+    writer.submit([](){throw std::runtime_error("disk full");});
+    bool error_caught = false;
+    try{
+      writer.flush();
+    }
+    catch(std::exception & e){
+      *outStream << "caught expected error: " << e.what() << std::endl;
+      error_caught = true;
+    }
+    if(!error_caught){
+      *outStream << "Error, flush should report the failed task" << std::endl;
+      errorFlag++;
+    }
+    // the error is only reported once and the writer keeps working
+    writer.submit([&later_task_ran](){later_task_ran = true;});
+    writer.flush();
+    if(!later_task_ran){
+      *outStream << "Error, tasks submitted after an error should still run" << std::endl;
+      errorFlag++;
+    }
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
+
@@ -92,6 +92,19 @@ int main(int argc, char *argv[]) {
   }
   *outStream << "initialization method success " << std::endl;
 
+  for(int_t meth=0;meth<DICe::MAX_FEATURE_MATCHER;++meth){
+    std::string methStr = DICe::to_string(static_cast<DICe::Feature_Matcher>(meth));
+    assert(methStr == DICe::featureMatcherStrings[meth]);
+    // convert string to lower case to test toUpper:
+    DICe::stringToLower(methStr);
+    *outStream << "feature matcher: " << methStr << std::endl;
+    if(meth!=DICe::string_to_feature_matcher(methStr)){
+      *outStream << "Error, feature matcher is wrong" << std::endl;
+      errorFlag++;
+    }
+  }
+  *outStream << "feature matcher success " << std::endl;
+
   for(int_t meth=0;meth<DICe::MAX_OPTIMIZATION_METHOD;++meth){
     std::string methStr = DICe::to_string(static_cast<DICe::Optimization_Method>(meth));
     assert(methStr == DICe::optimizationMethodStrings[meth]);
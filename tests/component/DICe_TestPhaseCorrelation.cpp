@@ -211,6 +211,69 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  *outStream << "testing windowed phase correlation" << std::endl;
+  {
+    // synthetic speckle images where the left and right halves move differently
+    const int_t w = 120;
+    const int_t h = 100;
+    const int_t num_speckles = 900;
+    std::vector<scalar_t> speckle_x(num_speckles);
+    std::vector<scalar_t> speckle_y(num_speckles);
+    unsigned seed = 12345;
+    for(int_t i=0;i<num_speckles;++i){
+      seed = seed*1103515245u + 12345u;
+      speckle_x[i] = -10.0 + 140.0*(seed>>8)/(1<<24);
+      seed = seed*1103515245u + 12345u;
+      speckle_y[i] = -10.0 + 120.0*(seed>>8)/(1<<24);
+    }
+    const scalar_t left_u = 2.3, left_v = -1.6, right_u = -3.7, right_v = 0.4;
+    Teuchos::ArrayRCP<intensity_t> intens_a(w*h,20.0);
+    Teuchos::ArrayRCP<intensity_t> intens_b(w*h,20.0);
+    for(int_t y=0;y<h;++y){
+      for(int_t x=0;x<w;++x){
+        const scalar_t u = x < w/2 ? left_u : right_u;
+        const scalar_t v = x < w/2 ? left_v : right_v;
+        for(int_t i=0;i<num_speckles;++i){
+          const scalar_t dxa = x - speckle_x[i];
+          const scalar_t dya = y - speckle_y[i];
+          const scalar_t dxb = x - u - speckle_x[i];
+          const scalar_t dyb = y - v - speckle_y[i];
+          if(dxa*dxa+dya*dya<36.0) intens_a[y*w+x] += 150.0*std::exp(-(dxa*dxa+dya*dya)/4.0);
+          if(dxb*dxb+dyb*dyb<36.0) intens_b[y*w+x] += 150.0*std::exp(-(dxb*dxb+dyb*dyb)/4.0);
+        }
+      }
+    }
+    Teuchos::RCP<Image> img_a = Teuchos::rcp(new Image(w,h,intens_a));
+    Teuchos::RCP<Image> img_b = Teuchos::rcp(new Image(w,h,intens_b));
+    const scalar_t window_tol = 0.5;
+    scalar_t u_x = 0.0, u_y = 0.0;
+    scalar_t peak = phase_correlate_window(img_a,img_b,28,50,32,u_x,u_y);
+    *outStream << "left window peak: " << peak << " ux: " << u_x << " uy: " << u_y << std::endl;
+    if(peak<=0.0||std::abs(u_x-left_u)>window_tol||std::abs(u_y-left_v)>window_tol){
+      *outStream << "Error, the windowed phase correlation for the left window is not correct" << std::endl;
+      errorFlag++;
+    }
+    peak = phase_correlate_window(img_a,img_b,92,50,32,u_x,u_y);
+    *outStream << "right window peak: " << peak << " ux: " << u_x << " uy: " << u_y << std::endl;
+    if(peak<=0.0||std::abs(u_x-right_u)>window_tol||std::abs(u_y-right_v)>window_tol){
+      *outStream << "Error, the windowed phase correlation for the right window is not correct" << std::endl;
+      errorFlag++;
+    }
+    // windows near the edge are shifted to fit inside the image
+    peak = phase_correlate_window(img_a,img_b,2,98,32,u_x,u_y);
+    *outStream << "edge window peak: " << peak << " ux: " << u_x << " uy: " << u_y << std::endl;
+    if(peak<=0.0||std::abs(u_x-left_u)>window_tol||std::abs(u_y-left_v)>window_tol){
+      *outStream << "Error, the windowed phase correlation for the edge window is not correct" << std::endl;
+      errorFlag++;
+    }
+    // a window larger than the image can't be correlated
+    peak = phase_correlate_window(img_a,img_b,60,50,128,u_x,u_y);
+    if(peak!=-1.0){
+      *outStream << "Error, a window larger than the image should return -1" << std::endl;
+      errorFlag++;
+    }
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
@@ -0,0 +1,143 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Profiler.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+using namespace DICe;
+
+/// times a phase recursively to check that nested timers of the same phase are counted once
+void nested_phase(const int_t depth){
+  Scoped_Profile_Timer timer(PROFILE_SUBSET_INITIALIZE);
+  if(depth>0) nested_phase(depth-1);
+}
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "checking that nothing is recorded when the profiler is disabled" << std::endl;
+  Profiler::reset();
+  Profiler::set_enabled(false);
+  nested_phase(3);
+  if(Profiler::num_calls(PROFILE_SUBSET_INITIALIZE)!=0||Profiler::time(PROFILE_SUBSET_INITIALIZE)!=0.0){
+    *outStream << "Error, the disabled profiler recorded a call" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "checking the nested timers" << std::endl;
+  Profiler::set_enabled(true);
+  {
+    Scoped_Profile_Timer outer(PROFILE_SIMPLEX);
+    nested_phase(3);
+    nested_phase(0);
+  }
+  if(Profiler::num_calls(PROFILE_SUBSET_INITIALIZE)!=2){
+    *outStream << "Error, nested timers of the same phase should be counted once, calls: " <<
+        Profiler::num_calls(PROFILE_SUBSET_INITIALIZE) << std::endl;
+    errorFlag++;
+  }
+  if(Profiler::num_calls(PROFILE_SIMPLEX)!=1){
+    *outStream << "Error, the outer phase should have one call" << std::endl;
+    errorFlag++;
+  }
+  if(Profiler::time(PROFILE_SIMPLEX)<Profiler::time(PROFILE_SUBSET_INITIALIZE)){
+    *outStream << "Error, the outer phase should include the time of the nested phase" << std::endl;
+    errorFlag++;
+  }
+  if(Profiler::num_calls(PROFILE_LINEAR_SOLVE)!=0){
+    *outStream << "Error, a phase that was not timed has a call" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "checking the timing report" << std::endl;
+  Profiler::report(*outStream,"timing_phases_test.json");
+  std::ifstream json_file("timing_phases_test.json");
+  std::string json_contents((std::istreambuf_iterator<char>(json_file)),std::istreambuf_iterator<char>());
+  json_file.close();
+  for(int_t i=0;i<MAX_PROFILE_PHASE;++i){
+    if(json_contents.find(profilePhaseStrings[i])==std::string::npos){
+      *outStream << "Error, the timing file is missing phase " << profilePhaseStrings[i] << std::endl;
+      errorFlag++;
+    }
+  }
+  std::remove("timing_phases_test.json");
+
+  Profiler::reset();
+  Profiler::set_enabled(false);
+  if(Profiler::num_calls(PROFILE_SIMPLEX)!=0){
+    *outStream << "Error, reset did not clear the counters" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
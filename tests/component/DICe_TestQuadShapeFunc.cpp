@@ -141,6 +141,54 @@ int main(int argc, char *argv[]) {
     rot += 0.785398;
   }
 
+  // test that the batch map and residuals match the point by point versions
+  *outStream << "testing the batch map and residuals" << std::endl;
+  std::vector<Teuchos::RCP<Local_Shape_Function> > batch_funcs;
+  batch_funcs.push_back(shape_func);
+  for(int_t combo=0;combo<8;++combo)
+    batch_funcs.push_back(Teuchos::rcp(new Affine_Shape_Function(combo&1,combo&2,combo&4)));
+  const int_t num_batch_pts = 25;
+  std::vector<int_t> batch_x(num_batch_pts,0);
+  std::vector<int_t> batch_y(num_batch_pts,0);
+  std::vector<scalar_t> batch_gx(num_batch_pts,0.0);
+  std::vector<scalar_t> batch_gy(num_batch_pts,0.0);
+  for(int_t i=0;i<num_batch_pts;++i){
+    batch_x[i] = cx - 12 + i;
+    batch_y[i] = cy + 7 - 2*i;
+    batch_gx[i] = 0.5 + 0.1*i;
+    batch_gy[i] = -1.2 + 0.07*i;
+  }
+  for(size_t f=0;f<batch_funcs.size();++f){
+    Teuchos::RCP<Local_Shape_Function> func = batch_funcs[f];
+    const int_t N = func->num_params();
+    // give every parameter a non-trivial value
+    for(int_t i=0;i<N;++i)
+      (*func)(i) += 0.01*(i+1);
+    std::vector<scalar_t> out_x(num_batch_pts,0.0);
+    std::vector<scalar_t> out_y(num_batch_pts,0.0);
+    func->batch_map(num_batch_pts,&batch_x[0],&batch_y[0],cx,cy,&out_x[0],&out_y[0]);
+    for(int_t ref_grads=0;ref_grads<2;++ref_grads){
+      std::vector<scalar_t> batch_res(num_batch_pts*N,0.0);
+      std::vector<scalar_t> point_res(N,0.0);
+      func->batch_residuals(num_batch_pts,&batch_x[0],&batch_y[0],cx,cy,&batch_gx[0],&batch_gy[0],&batch_res[0],ref_grads==1);
+      for(int_t i=0;i<num_batch_pts;++i){
+        scalar_t px = 0.0, py = 0.0;
+        func->map(batch_x[i],batch_y[i],cx,cy,px,py);
+        if(std::abs(px-out_x[i])>errorTol||std::abs(py-out_y[i])>errorTol){
+          *outStream << "Error, batch map does not match the point map for shape function " << f << std::endl;
+          errorFlag++;
+        }
+        func->residuals(batch_x[i],batch_y[i],cx,cy,batch_gx[i],batch_gy[i],point_res,ref_grads==1);
+        for(int_t j=0;j<N;++j){
+          if(std::abs(point_res[j]-batch_res[i*N+j])>errorTol){
+            *outStream << "Error, batch residuals do not match the point residuals for shape function " << f << std::endl;
+            errorFlag++;
+          }
+        }
+      }
+    }
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
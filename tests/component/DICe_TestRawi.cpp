@@ -48,6 +48,8 @@
 #include <Teuchos_ParameterList.hpp>
 
 #include <iostream>
+#include <sstream>
+#include <vector>
 
 using namespace DICe;
 
@@ -106,6 +108,55 @@ int main(int argc, char *argv[]) {
   }
   *outStream << "checked the image intensity values " << std::endl;
 
+  *outStream << "writing a multi-frame .rawv file" << std::endl;
+  const int_t num_frames = 4;
+  std::vector<intensity_t> frame_intensities(array_w*array_h);
+  {
+    utils::Rawv_Writer writer("ArrayImg.rawv");
+    for(int_t frame=0;frame<num_frames;++frame){
+      for(int_t i=0;i<array_w*array_h;++i)
+        frame_intensities[i] = intensities[i] + frame;
+      // every other frame is compressed if the compression is available
+      writer.write_frame(array_w,array_h,&frame_intensities[0],true,frame%2==1&&utils::rawi_compression_enabled());
+    }
+  }
+  utils::Rawv_Reader reader("ArrayImg.rawv");
+  if(reader.num_frames()!=num_frames||reader.width()!=array_w||reader.height()!=array_h){
+    *outStream << "Error, the .rawv file has the wrong number of frames or dimensions" << std::endl;
+    errorFlag++;
+  }
+  // read the frames out of order to make sure each frame is found from the index
+  for(int_t frame=num_frames-1;frame>=0;--frame){
+    std::stringstream frame_name;
+    frame_name << "ArrayImg_frame_" << frame << ".rawv";
+    Image frame_img(frame_name.str().c_str());
+    intensity_value_error = frame_img.width()!=array_w||frame_img.height()!=array_h;
+    for(int_t y=0;y<array_h&&!intensity_value_error;++y){
+      for(int_t x=0;x<array_w;++x){
+        if(frame_img(x,y)!=array_img(x,y) + frame)
+          intensity_value_error = true;
+      }
+    }
+    if(intensity_value_error){
+      *outStream << "Error, the intensity values are not correct for rawv frame " << frame << std::endl;
+      errorFlag++;
+    }
+  }
+  *outStream << "reading a portion of a rawv frame" << std::endl;
+  Image portion_img("ArrayImg_frame_3.rawv",10,5,20,10);
+  intensity_value_error = portion_img.width()!=20||portion_img.height()!=10;
+  for(int_t y=0;y<portion_img.height()&&!intensity_value_error;++y){
+    for(int_t x=0;x<portion_img.width();++x){
+      if(portion_img(x,y)!=array_img(x+10,y+5) + 3)
+        intensity_value_error = true;
+    }
+  }
+  if(intensity_value_error){
+    *outStream << "Error, the intensity values are not correct for the portion of the rawv frame" << std::endl;
+    errorFlag++;
+  }
+  *outStream << "checked the rawv frames" << std::endl;
+
 
   *outStream << "--- End test ---" << std::endl;
 
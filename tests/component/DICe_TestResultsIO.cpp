@@ -0,0 +1,193 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#include <DICe.h>
+#include <DICe_ResultsIO.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  std::vector<std::string> field_names;
+  field_names.push_back("COORDINATE_X");
+  field_names.push_back("DISPLACEMENT_X");
+  field_names.push_back("SIGMA");
+  std::vector<int_t> subset_ids;
+  subset_ids.push_back(4);
+  subset_ids.push_back(0);
+  subset_ids.push_back(17);
+  subset_ids.push_back(9);
+  const int_t num_fields = field_names.size();
+  const int_t num_subsets = subset_ids.size();
+  const int_t num_frames = 5;
+  const int_t first_frame_id = 12;
+
+  *outStream << "writing the binary results file" << std::endl;
+  {
+    Binary_Results_Writer writer("test_results.dbr",field_names,subset_ids);
+    for(int_t frame=0;frame<num_frames;++frame){
+      std::vector<scalar_t> values(num_fields*num_subsets);
+      for(int_t i=0;i<num_fields*num_subsets;++i)
+        values[i] = frame*100.0 + i + 0.25;
+      writer.write_frame(first_frame_id+frame,values);
+    }
+  }
+
+  *outStream << "reading the binary results file" << std::endl;
+  Binary_Results_Reader reader("test_results.dbr");
+  if(reader.num_frames()!=num_frames||reader.num_fields()!=num_fields||reader.num_subsets()!=num_subsets){
+    *outStream << "Error, the binary results file dimensions are not correct" << std::endl;
+    errorFlag++;
+  }
+  for(int_t i=0;i<num_fields&&i<reader.num_fields();++i){
+    if(reader.field_names()[i]!=field_names[i]){
+      *outStream << "Error, field name " << i << " should be " << field_names[i] << " and is " << reader.field_names()[i] << std::endl;
+      errorFlag++;
+    }
+  }
+  for(int_t i=0;i<num_subsets&&i<reader.num_subsets();++i){
+    if(reader.subset_ids()[i]!=subset_ids[i]){
+      *outStream << "Error, subset id " << i << " should be " << subset_ids[i] << " and is " << reader.subset_ids()[i] << std::endl;
+      errorFlag++;
+    }
+  }
+  bool value_error = false;
+  for(int_t frame=0;frame<reader.num_frames();++frame){
+    int_t frame_id = -1;
+    std::vector<scalar_t> values;
+    reader.read_frame(frame,frame_id,values);
+    if(frame_id!=first_frame_id+frame||(int_t)values.size()!=num_fields*num_subsets)
+      value_error = true;
+    for(size_t i=0;i<values.size();++i)
+      if(values[i]!=frame*100.0 + i + 0.25) value_error = true;
+  }
+  if(value_error){
+    *outStream << "Error, the binary results frame values are not correct" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "reading a single field" << std::endl;
+  std::vector<scalar_t> sigma;
+  reader.read_field(3,"SIGMA",sigma);
+  bool field_error = (int_t)sigma.size()!=num_subsets;
+  for(int_t j=0;j<num_subsets&&!field_error;++j)
+    if(sigma[j]!=300.0 + 2*num_subsets + j + 0.25) field_error = true;
+  if(field_error){
+    *outStream << "Error, the binary results field values are not correct" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "writing the subset text files with fewer open files than subsets" << std::endl;
+  std::vector<std::string> text_file_names;
+  for(int_t j=0;j<num_subsets;++j){
+    std::stringstream name;
+    name << "test_results_subset_" << j << ".txt";
+    text_file_names.push_back(name.str());
+    std::FILE * file = fopen(name.str().c_str(),"w");
+    fclose(file);
+  }
+  {
+    // a small buffer so the rows are written several times during the frames
+    Subset_Text_Writer text_writer(text_file_names,2,64);
+    for(int_t frame=0;frame<num_frames;++frame){
+      for(int_t j=0;j<num_subsets;++j){
+        std::stringstream row;
+        row << first_frame_id+frame << " " << j << "\n";
+        text_writer.append(j,row.str());
+      }
+      if(text_writer.num_open_files()>2){
+        *outStream << "Error, the subset text writer has too many open files" << std::endl;
+        errorFlag++;
+      }
+    }
+  }
+  bool text_error = false;
+  for(int_t j=0;j<num_subsets;++j){
+    std::ifstream text_file(text_file_names[j].c_str());
+    int_t num_rows = 0;
+    int_t frame_id = 0;
+    int_t subset = 0;
+    while(text_file >> frame_id >> subset){
+      if(frame_id!=first_frame_id+num_rows||subset!=j) text_error = true;
+      num_rows++;
+    }
+    if(num_rows!=num_frames) text_error = true;
+  }
+  if(text_error){
+    *outStream << "Error, the subset text files are not correct" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
+
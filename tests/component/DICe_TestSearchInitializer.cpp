@@ -101,6 +101,37 @@ int main(int argc, char *argv[]) {
     errorFlag++;
   }
 
+  *outStream << "testing the image pyramid" << std::endl;
+  Teuchos::RCP<Image> def_img = schema->def_img();
+  Teuchos::RCP<Image> level_1 = def_img->pyramid_level(1);
+  Teuchos::RCP<Image> level_2 = def_img->pyramid_level(2);
+  if(level_1->width()!=def_img->width()/2||level_1->height()!=def_img->height()/2||
+      level_2->width()!=def_img->width()/4||level_2->height()!=def_img->height()/4||def_img->num_pyramid_levels()!=2){
+    *outStream << "Error, the pyramid level dimensions are not correct" << std::endl;
+    errorFlag++;
+  }
+  const scalar_t block_avg = 0.25*((*def_img)(20,14) + (*def_img)(21,14) + (*def_img)(20,15) + (*def_img)(21,15));
+  if(std::abs((*level_1)(10,7) - block_avg) > errorTol){
+    *outStream << "Error, the pyramid level intensity is not correct" << std::endl;
+    errorFlag++;
+  }
+  if(def_img->pyramid_level(1)!=level_1){
+    *outStream << "Error, the pyramid levels should be reused" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the coarse-to-fine search" << std::endl;
+  const int_t num_pyramid_levels = 3;
+  Search_Initializer pyramid_searcher(schema.getRawPtr(),subset,step_size_xy,search_dim_xy,step_size_xy,search_dim_xy,step_size_theta,search_dim_theta,num_pyramid_levels);
+  shape_function->clear();
+  pyramid_searcher.initial_guess(-1,shape_function);
+  shape_function->map_to_u_v_theta(subset->centroid_x(),subset->centroid_y(),out_u,out_v,out_t);
+  if(std::abs(out_u - u_exact) > errorTol || std::abs(out_v - v_exact) > errorTol){
+    *outStream << "Error, the coarse-to-fine initialized value is not correct" << std::endl;
+    *outStream << "       should be 138,-138 and is " << out_u << "," << out_v << std::endl;
+    errorFlag++;
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
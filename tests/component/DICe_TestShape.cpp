@@ -51,6 +51,7 @@
 #include <Teuchos_oblackholestream.hpp>
 
 #include <iostream>
+#include <algorithm>
 #include <cassert>
 
 using namespace DICe;
@@ -168,6 +169,109 @@ int main(int argc, char *argv[]) {
   DICe::Image small_skin_image(imgW,imgW,small_skin_intensities);
   small_skin_image.write("shape_small_skin.tif");
 
+  *outStream << "testing the pixel bitmaps against the owned pixel sets" << std::endl;
+  Teuchos::RCP<DICe::Circle> circle = Teuchos::rcp(new DICe::Circle(60,140,12.5));
+  Teuchos::RCP<DICe::Rectangle> rect = Teuchos::rcp(new DICe::Rectangle(150,50,21,14));
+  std::vector<Teuchos::RCP<DICe::Shape> > bitmap_shapes;
+  std::vector<Teuchos::RCP<Local_Shape_Function> > bitmap_maps;
+  std::vector<scalar_t> bitmap_skins;
+  bitmap_shapes.push_back(poly1); bitmap_maps.push_back(Teuchos::null); bitmap_skins.push_back(1.0);
+  bitmap_shapes.push_back(poly1); bitmap_maps.push_back(shape_function); bitmap_skins.push_back(large_skin_factor);
+  bitmap_shapes.push_back(circle); bitmap_maps.push_back(Teuchos::null); bitmap_skins.push_back(1.0);
+  bitmap_shapes.push_back(rect); bitmap_maps.push_back(Teuchos::null); bitmap_skins.push_back(1.0);
+  bitmap_shapes.push_back(rect); bitmap_maps.push_back(shape_function); bitmap_skins.push_back(small_skin_factor);
+  // all the shapes are also accumulated into one bitmap to exercise growing the bounding box
+  DICe::Pixel_Bitmap combined_bitmap;
+  std::set<std::pair<int_t,int_t> > combined_pixels;
+  for(size_t i=0;i<bitmap_shapes.size();++i){
+    std::set<std::pair<int_t,int_t> > owned = bitmap_shapes[i]->get_owned_pixels(bitmap_maps[i],cx,cy,bitmap_skins[i]);
+    DICe::Pixel_Bitmap bitmap;
+    bitmap_shapes[i]->rasterize(bitmap,bitmap_maps[i],cx,cy,bitmap_skins[i]);
+    bitmap_shapes[i]->rasterize(combined_bitmap,bitmap_maps[i],cx,cy,bitmap_skins[i]);
+    combined_pixels.insert(owned.begin(),owned.end());
+    bool bitmap_error = bitmap.size()!=(int_t)owned.size();
+    for(int_t y=0;y<imgW;++y){
+      for(int_t x=0;x<imgW;++x){
+        if(bitmap.contains(x,y)!=(owned.find(std::pair<int_t,int_t>(y,x))!=owned.end())) bitmap_error = true;
+      }
+    }
+    *outStream << "shape " << i << " has " << owned.size() << " owned pixels and " << bitmap.size() << " bitmap pixels" << std::endl;
+    if(bitmap_error){
+      *outStream << "Error, the bitmap for shape " << i << " does not match the owned pixels" << std::endl;
+      errorFlag++;
+    }
+  }
+  bool combined_error = combined_bitmap.size()!=(int_t)combined_pixels.size();
+  for(int_t y=-5;y<imgW+5;++y){
+    for(int_t x=-5;x<imgW+5;++x){
+      if(combined_bitmap.contains(x,y)!=(combined_pixels.find(std::pair<int_t,int_t>(y,x))!=combined_pixels.end())) combined_error = true;
+    }
+  }
+  if(combined_error){
+    *outStream << "Error, the combined bitmap does not match the union of the owned pixels" << std::endl;
+    errorFlag++;
+  }
+  combined_bitmap.clear();
+  if(!combined_bitmap.empty()||combined_bitmap.contains(100,100)){
+    *outStream << "Error, the bitmap was not cleared" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the scanline fill against the point in polygon test" << std::endl;
+  // concave polygon with horizontal edges, a repeated vertex and edges that pass exactly through pixels
+  std::vector<int_t> concave_x(9);
+  std::vector<int_t> concave_y(9);
+  concave_x[0] = 20; concave_y[0] = 20;
+  concave_x[1] = 80; concave_y[1] = 20;
+  concave_x[2] = 80; concave_y[2] = 20;
+  concave_x[3] = 50; concave_y[3] = 45;
+  concave_x[4] = 90; concave_y[4] = 70;
+  concave_x[5] = 60; concave_y[5] = 90;
+  concave_x[6] = 40; concave_y[6] = 60;
+  concave_x[7] = 25; concave_y[7] = 90;
+  concave_x[8] = 33; concave_y[8] = 47;
+  Teuchos::RCP<DICe::Polygon> concave = Teuchos::rcp(new DICe::Polygon(concave_x,concave_y));
+  const std::set<std::pair<int_t,int_t> > concave_pixels = concave->get_owned_pixels();
+  bool scanline_error = false;
+  int_t num_contained = 0;
+  for(int_t y=concave->min_y()-2;y<=concave->max_y()+2;++y){
+    for(int_t x=concave->min_x()-2;x<=concave->max_x()+2;++x){
+      const bool contained = polygon_contains(*concave->vertex_coordinates_x(),*concave->vertex_coordinates_y(),concave->num_vertices(),x,y);
+      if(contained) num_contained++;
+      if(contained!=(concave_pixels.find(std::pair<int_t,int_t>(y,x))!=concave_pixels.end())) scanline_error = true;
+    }
+  }
+  *outStream << "concave polygon has " << concave_pixels.size() << " owned pixels and " << num_contained << " contained pixels" << std::endl;
+  if(scanline_error||num_contained!=(int_t)concave_pixels.size()){
+    *outStream << "Error, the scanline fill does not match the point in polygon test" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "testing the cached reference pixels" << std::endl;
+  multi_shape cached_shapes;
+  cached_shapes.push_back(concave);
+  cached_shapes.push_back(rect);
+  cached_shapes.push_back(circle);
+  std::set<std::pair<int_t,int_t> > union_pixels;
+  for(size_t i=0;i<cached_shapes.size();++i){
+    const std::set<std::pair<int_t,int_t> > owned = cached_shapes[i]->get_owned_pixels();
+    union_pixels.insert(owned.begin(),owned.end());
+    // the second call returns the cached pixels
+    for(int_t call=0;call<2;++call){
+      const std::vector<std::pair<int_t,int_t> > & cached = cached_shapes[i]->reference_pixels();
+      if(cached.size()!=owned.size()||!std::equal(cached.begin(),cached.end(),owned.begin())){
+        *outStream << "Error, the cached reference pixels for shape " << i << " do not match the owned pixels" << std::endl;
+        errorFlag++;
+      }
+    }
+  }
+  std::vector<std::pair<int_t,int_t> > merged_pixels;
+  reference_pixels(cached_shapes,merged_pixels);
+  if(merged_pixels.size()!=union_pixels.size()||!std::equal(merged_pixels.begin(),merged_pixels.end(),union_pixels.begin())){
+    *outStream << "Error, the reference pixels of the multi_shape do not match the union of the owned pixels" << std::endl;
+    errorFlag++;
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
@@ -0,0 +1,128 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Simplex.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <iostream>
+#include <cmath>
+
+using namespace DICe;
+
+/// a quadratic bowl with a known minimum used to exercise the simplex
+class Bowl_Simplex : public Simplex {
+public:
+  Bowl_Simplex(const std::vector<scalar_t> & center):
+    Simplex(1000,1.0E-10),
+    center_(center){}
+  virtual scalar_t objective(Teuchos::RCP<std::vector<scalar_t> > variables){
+    scalar_t value = 1.0;
+    for(size_t i=0;i<center_.size();++i)
+      value += ((*variables)[i]-center_[i])*((*variables)[i]-center_[i]);
+    return value;
+  }
+private:
+  std::vector<scalar_t> center_;
+};
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  // 6 degrees of freedom uses the fixed size simplex, 3 uses the workspace
+  const int_t sizes[] = {6,3};
+  for(int_t s=0;s<2;++s){
+    const int_t num_dofs = sizes[s];
+    *outStream << "minimizing a quadratic bowl with " << num_dofs << " degrees of freedom" << std::endl;
+    std::vector<scalar_t> center(num_dofs);
+    for(int_t i=0;i<num_dofs;++i)
+      center[i] = 0.25*(i+1)*(i%2==0?1.0:-1.0);
+    Bowl_Simplex simplex(center);
+    // the same simplex is used twice to make sure the storage can be reused
+    for(int_t trial=0;trial<2;++trial){
+      Teuchos::RCP<std::vector<scalar_t> > variables = Teuchos::rcp(new std::vector<scalar_t>(num_dofs,0.0));
+      for(int_t i=0;i<num_dofs;++i)
+        (*variables)[i] = 0.1*(trial+1)*(i+1);
+      Teuchos::RCP<std::vector<scalar_t> > deltas = Teuchos::rcp(new std::vector<scalar_t>(num_dofs,0.5));
+      int_t num_iterations = 0;
+      const Status_Flag status = simplex.minimize(variables,deltas,num_iterations);
+      *outStream << "status " << status << " iterations " << num_iterations << std::endl;
+      if(status!=CORRELATION_SUCCESSFUL){
+        *outStream << "Error, the simplex did not converge" << std::endl;
+        errorFlag++;
+      }
+      for(int_t i=0;i<num_dofs;++i){
+        *outStream << "  variable " << i << " " << (*variables)[i] << " expected " << center[i] << std::endl;
+        if(std::abs((*variables)[i]-center[i])>1.0E-2){
+          *outStream << "Error, the simplex solution is not correct" << std::endl;
+          errorFlag++;
+        }
+      }
+    }
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
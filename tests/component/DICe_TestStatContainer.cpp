@@ -0,0 +1,172 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Schema.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "recording solves for three subsets" << std::endl;
+  Stat_Container stats;
+  stats.initialize_subset_profile(3);
+  stats.register_subset_solve(0,4,0.001,PRIMARY_SOLVE_PATH);
+  stats.register_subset_solve(0,6,0.002,PRIMARY_SOLVE_PATH);
+  stats.register_subset_solve(1,25,0.010,SEARCH_INITIALIZATION_PATH|BACKUP_OPTIMIZATION_PATH);
+  stats.register_subset_solve(2,-1,0.004,FAILED_SOLVE_PATH);
+  // out of range subsets are ignored
+  stats.register_subset_solve(3,1,1.0,PRIMARY_SOLVE_PATH);
+  if(stats.num_solves(0)!=2||stats.total_iterations(0)!=10||stats.max_iterations(0)!=6||
+      stats.num_path_solves(0,PRIMARY_SOLVE_PATH)!=2){
+    *outStream << "Error, the profile of subset 0 is wrong" << std::endl;
+    errorFlag++;
+  }
+  if(stats.num_path_solves(1,SEARCH_INITIALIZATION_PATH)!=1||stats.num_path_solves(1,BACKUP_OPTIMIZATION_PATH)!=1||
+      stats.last_solve_path(1)!=(SEARCH_INITIALIZATION_PATH|BACKUP_OPTIMIZATION_PATH)){
+    *outStream << "Error, the fallback paths of subset 1 are wrong" << std::endl;
+    errorFlag++;
+  }
+  if(stats.num_path_solves(2,FAILED_SOLVE_PATH)!=1||stats.total_iterations(2)!=0){
+    *outStream << "Error, the failed solve of subset 2 is wrong" << std::endl;
+    errorFlag++;
+  }
+  *outStream << "checking the most expensive subsets" << std::endl;
+  std::vector<int_t> costliest = stats.costliest_subsets(2);
+  if(costliest.size()!=2||costliest[0]!=1||costliest[1]!=2){
+    *outStream << "Error, the most expensive subsets are wrong" << std::endl;
+    errorFlag++;
+  }
+  *outStream << "checking that the profile is kept if the size doesn't change" << std::endl;
+  stats.initialize_subset_profile(3);
+  if(stats.num_solves(0)!=2){
+    *outStream << "Error, the profile was reset" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "writing the profile" << std::endl;
+  std::vector<int_t> gids(3);
+  gids[0] = 10; gids[1] = 11; gids[2] = 12;
+  stats.write_subset_profile("subset_profile_test.csv",gids);
+  std::ifstream csv_file("subset_profile_test.csv");
+  std::string line;
+  int_t num_lines = 0;
+  while(std::getline(csv_file,line)){
+    if(num_lines==2&&line.find("11,1,25,25,1,1,0,")!=0){
+      *outStream << "Error, wrong csv row for subset 11: " << line << std::endl;
+      errorFlag++;
+    }
+    num_lines++;
+  }
+  csv_file.close();
+  if(num_lines!=4){
+    *outStream << "Error, wrong number of lines in the csv profile " << num_lines << std::endl;
+    errorFlag++;
+  }
+  std::remove("subset_profile_test.csv");
+  stats.write_subset_profile("subset_profile_test.bin",gids,true);
+  std::FILE * bin_file = fopen("subset_profile_test.bin","rb");
+  int_t num_subsets = 0;
+  std::vector<int_t> bin_gids(3,0);
+  if(bin_file==NULL||fread(&num_subsets,sizeof(int_t),1,bin_file)!=1||num_subsets!=3||
+      fread(&bin_gids[0],sizeof(int_t),3,bin_file)!=3||bin_gids!=gids){
+    *outStream << "Error, the binary profile is wrong" << std::endl;
+    errorFlag++;
+  }
+  if(bin_file!=NULL) fclose(bin_file);
+  std::remove("subset_profile_test.bin");
+
+  *outStream << "checking that the stats survive a checkpoint" << std::endl;
+  stats.register_search_call(11,3);
+  stats.register_search_call(11,5);
+  stats.register_failed_init(12,4);
+  std::FILE * ckp_file = fopen("stat_container_test.ckp","wb");
+  stats.write_checkpoint(ckp_file);
+  fclose(ckp_file);
+  Stat_Container restarted_stats;
+  ckp_file = fopen("stat_container_test.ckp","rb");
+  if(!restarted_stats.read_checkpoint(ckp_file)){
+    *outStream << "Error, could not read the checkpoint" << std::endl;
+    errorFlag++;
+  }
+  fclose(ckp_file);
+  std::remove("stat_container_test.ckp");
+  if(restarted_stats.num_searches(11)!=2||restarted_stats.num_failed_inits(12)!=1||restarted_stats.subset_profile_size()!=3||
+      restarted_stats.total_iterations(1)!=25||restarted_stats.last_solve_path(2)!=FAILED_SOLVE_PATH||restarted_stats.solve_time(0)!=stats.solve_time(0)){
+    *outStream << "Error, the restarted stats do not match" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
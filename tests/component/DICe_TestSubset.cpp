@@ -127,6 +127,25 @@ int main(int argc, char *argv[]) {
     *outStream << "Error, the coordinates are not correct for the array subset" << std::endl;
   }
 
+  // test setting the pixel flags (the flags are packed so pick pixels on either side of a word boundary)
+  *outStream << "testing the pixel flags" << std::endl;
+  array.set_is_active(31,false);
+  array.set_is_deactivated_this_step(32,true);
+  if(array.is_active(31)||!array.is_active(30)||!array.is_active(32)||array.num_active_pixels()!=num_pts-2){
+    *outStream << "Error, the is_active flags are not correct" << std::endl;
+    errorFlag++;
+  }
+  if(!array.is_deactivated_this_step(32)||array.is_deactivated_this_step(31)||array.is_deactivated_this_step(33)){
+    *outStream << "Error, the is_deactivated_this_step flags are not correct" << std::endl;
+    errorFlag++;
+  }
+  array.reset_is_active();
+  array.reset_is_deactivated_this_step();
+  if(array.num_active_pixels()!=num_pts){
+    *outStream << "Error, the pixel flags were not reset" << std::endl;
+    errorFlag++;
+  }
+
   // test initializing the subset from an image:
   // create an image:
   Teuchos::RCP<Image> image = Teuchos::rcp(new Image("./images/ImageA.tif"));
@@ -144,6 +163,19 @@ int main(int argc, char *argv[]) {
     *outStream << "Error, the ref intensity values for the initialized square subset are wrong" << std::endl;
     errorFlag++;
   }
+  // the same values should come back if the subset reads them directly from the image
+  *outStream << "testing shared reference intensities" << std::endl;
+  Subset shared(square.centroid_x(),square.centroid_y(),w,h);
+  shared.share_ref_intensities(image);
+  bool shared_values_error = false;
+  for(int_t i=0;i<shared.num_pixels();++i){
+    if(shared.ref_intensities(i)!=square.ref_intensities(i))
+      shared_values_error = true;
+  }
+  if(shared_values_error||shared.mean(REF_INTENSITIES)!=square.mean(REF_INTENSITIES)){
+    *outStream << "Error, the shared ref intensity values are wrong" << std::endl;
+    errorFlag++;
+  }
   // initialize the deformed values
   *outStream << "constructing a simple deformed subset" << std::endl;
   Teuchos::RCP<Local_Shape_Function> shape_function = shape_function_factory();
@@ -200,6 +232,73 @@ int main(int argc, char *argv[]) {
     *outStream << "Error, the def intensity values for the keys initialized square subset are wrong" << std::endl;
     errorFlag++;
   }
+  *outStream << "checking the whole pixel shift detection" << std::endl;
+  int_t shift_x = 0, shift_y = 0;
+  if(!shape_function->integer_translation(shift_x,shift_y)||shift_x!=15||shift_y!=12){
+    *outStream << "Error, a whole pixel translation was not detected" << std::endl;
+    errorFlag++;
+  }
+  Teuchos::RCP<Local_Shape_Function> quad_shape_function = Teuchos::rcp(new Quadratic_Shape_Function());
+  quad_shape_function->insert_motion(-3.0,4.0);
+  if(!quad_shape_function->integer_translation(shift_x,shift_y)||shift_x!=-3||shift_y!=4){
+    *outStream << "Error, a whole pixel translation was not detected for the quadratic shape function" << std::endl;
+    errorFlag++;
+  }
+  Teuchos::RCP<Local_Shape_Function> sub_pixel_shape_function = shape_function_factory();
+  sub_pixel_shape_function->insert_motion(15.5,12.0);
+  if(sub_pixel_shape_function->integer_translation(shift_x,shift_y)){
+    *outStream << "Error, a sub-pixel translation was detected as a whole pixel shift" << std::endl;
+    errorFlag++;
+  }
+  sub_pixel_shape_function->insert_motion(15.0,12.0,0.01);
+  if(sub_pixel_shape_function->integer_translation(shift_x,shift_y)){
+    *outStream << "Error, a rotation was detected as a whole pixel shift" << std::endl;
+    errorFlag++;
+  }
+  if(image->has_gradients()){
+    // the shifted subset gradients are copied straight from the image
+    bool shift_grads_error = false;
+    for(int_t i=0;i<square.num_pixels();++i){
+      if(square.is_deactivated_this_step(i)) continue;
+      if(square.grad_x(i)!=image->grad_x(square.x(i)+15,square.y(i)+12)||square.grad_y(i)!=image->grad_y(square.x(i)+15,square.y(i)+12))
+        shift_grads_error = true;
+    }
+    if(shift_grads_error){
+      *outStream << "Error, the gradients of the whole pixel shifted subset are wrong" << std::endl;
+      errorFlag++;
+    }
+  }
+  *outStream << "checking the subset evolution" << std::endl;
+  Subset evolved(square.centroid_x(),square.centroid_y(),w,h);
+  evolved.initialize(image);
+  evolved.initialize(image,DEF_INTENSITIES,shape_function,KEYS_FOURTH);
+  // pixel 3 was hidden in the reference frame and is visible now, pixel 40 is still hidden
+  const intensity_t hidden_ref_value = evolved.ref_intensities(40);
+  evolved.set_is_active(3,false);
+  evolved.set_is_active(40,false);
+  evolved.set_is_deactivated_this_step(40,true);
+  evolved.turn_on_previously_obstructed_pixels();
+  if(!evolved.is_active(3)||evolved.ref_intensities(3)!=evolved.def_intensities(3)){
+    *outStream << "Error, the newly visible pixel was not evolved" << std::endl;
+    errorFlag++;
+  }
+  if(evolved.is_active(40)||evolved.ref_intensities(40)!=hidden_ref_value){
+    *outStream << "Error, a pixel that is still hidden was evolved" << std::endl;
+    errorFlag++;
+  }
+  *outStream << "checking the pixels blocked by other subsets" << std::endl;
+  // block the pixel that pixel 7 of the subset maps to
+  evolved.pixels_blocked_by_other_subsets()->insert(evolved.x(7)+15,evolved.y(7)+12);
+  evolved.turn_off_obstructed_pixels(shape_function);
+  bool blocked_error = false;
+  for(int_t i=0;i<evolved.num_pixels();++i){
+    if(evolved.is_deactivated_this_step(i)!=(i==7))
+      blocked_error = true;
+  }
+  if(blocked_error){
+    *outStream << "Error, the wrong pixels were turned off by the blocked pixel bitmap" << std::endl;
+    errorFlag++;
+  }
   *outStream << "checking the mean value of the reference intensities" << std::endl;
   scalar_t ref_mean = 0.0;
   scalar_t ref_sum = 0.0;
@@ -0,0 +1,191 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+#include <DICe.h>
+#include <DICe_Parser.h>
+#include <DICe_Shape.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace DICe;
+
+/// writes a subset file with num_subsets conformal subsets, the polygon vertices are shifted by offset
+void write_subset_file(const std::string & file_name,
+  const int_t num_subsets,
+  const int_t offset){
+  std::ofstream file(file_name.c_str());
+  file << "# test subset file\n";
+  file << "begin subset_coordinates\n";
+  for(int_t i=0;i<num_subsets;++i)
+    file << 50 + 10*i << "\t" << 60 + 5*i << "\n";
+  file << "end\n";
+  for(int_t i=0;i<num_subsets;++i){
+    file << "begin conformal_subset\n";
+    file << "  subset_id " << i << "\n";
+    file << "  begin boundary\n";
+    file << "    begin polygon\n";
+    file << "      begin vertices\n";
+    file << "        " << 40 + offset + 10*i << " 50\n";
+    file << "        " << 60 + offset + 10*i << " 50\n";
+    file << "        # comment in the vertices\n\n";
+    file << "        " << 60 + offset + 10*i << " 70\n";
+    file << "      end vertices\n";
+    file << "    end polygon\n";
+    file << "    begin circle\n";
+    file << "      center 100 100\n";
+    file << "      radius 12.5\n";
+    file << "    end circle\n";
+    file << "  end boundary\n";
+    file << "  begin excluded\n";
+    file << "    begin rectangle\n";
+    file << "      upper_left 90 90\n";
+    file << "      lower_right 110 104\n";
+    file << "    end rectangle\n";
+    file << "  end excluded\n";
+    if(i>0){
+      file << "  begin blocking_subsets\n";
+      file << "    " << i-1 << "\n";
+      file << "  end blocking_subsets\n";
+    }
+    file << "  begin seed\n";
+    file << "    displacement 1.5 -2.5\n";
+    file << "  end seed\n";
+    file << "end conformal_subset\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  const int_t num_subsets = 4;
+  const std::string file_name = "test_subset_file.txt";
+  const std::string cache_name = file_name + ".cache";
+  std::remove(cache_name.c_str());
+  write_subset_file(file_name,num_subsets,0);
+
+  *outStream << "reading the subset file" << std::endl;
+  Teuchos::RCP<Subset_File_Info> info = read_subset_file(file_name,500,500);
+  if(info->coordinates_vector->size()!=2*num_subsets||info->conformal_area_defs->size()!=num_subsets){
+    *outStream << "Error, the number of subsets read is not correct" << std::endl;
+    errorFlag++;
+  }
+  for(int_t i=0;i<num_subsets&&i<(int_t)info->coordinates_vector->size()/2;++i){
+    if((*info->coordinates_vector)[2*i]!=50+10*i||(*info->coordinates_vector)[2*i+1]!=60+5*i){
+      *outStream << "Error, the coordinates of subset " << i << " are not correct" << std::endl;
+      errorFlag++;
+    }
+  }
+  if(info->conformal_area_defs->find(2)!=info->conformal_area_defs->end()){
+    const Conformal_Area_Def & def = info->conformal_area_defs->find(2)->second;
+    Teuchos::RCP<Polygon> polygon = Teuchos::rcp_dynamic_cast<Polygon>((*def.boundary())[0]);
+    if(def.boundary()->size()!=2||polygon==Teuchos::null||polygon->num_vertices()!=3||(*polygon->vertex_coordinates_x())[1]!=80){
+      *outStream << "Error, the boundary of subset 2 is not correct" << std::endl;
+      errorFlag++;
+    }
+    if(!def.has_excluded_area()||def.has_obstructed_area()){
+      *outStream << "Error, the excluded area of subset 2 is not correct" << std::endl;
+      errorFlag++;
+    }
+  }
+  if(info->id_sets_map->find(2)==info->id_sets_map->end()||info->id_sets_map->find(2)->second.size()!=1
+      ||info->displacement_map->find(3)==info->displacement_map->end()||info->displacement_map->find(3)->second.second!=-2.5){
+    *outStream << "Error, the blocking subsets or seeds are not correct" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "packing and unpacking the subset file info" << std::endl;
+  std::vector<char> packed;
+  pack_subset_file_info(*info,packed);
+  std::vector<char> repacked;
+  pack_subset_file_info(*unpack_subset_file_info(packed),repacked);
+  if(packed!=repacked){
+    *outStream << "Error, the unpacked subset file info does not match the original" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "reading the subset file with the cache" << std::endl;
+  for(int_t pass=0;pass<2;++pass){
+    std::vector<char> cached;
+    pack_subset_file_info(*read_subset_file(file_name,500,500,false,true),cached);
+    std::ifstream cache_file(cache_name.c_str());
+    if(cached!=packed||!cache_file.good()){
+      *outStream << "Error, the subset file info read with the cache is not correct (pass " << pass << ")" << std::endl;
+      errorFlag++;
+    }
+  }
+  // the cache has to be ignored once the subset file changes
+  write_subset_file(file_name,num_subsets,1);
+  Teuchos::RCP<Subset_File_Info> changed_info = read_subset_file(file_name,500,500,false,true);
+  Teuchos::RCP<Polygon> changed_polygon = Teuchos::rcp_dynamic_cast<Polygon>((*changed_info->conformal_area_defs->find(2)->second.boundary())[0]);
+  if(changed_polygon==Teuchos::null||(*changed_polygon->vertex_coordinates_x())[1]!=81){
+    *outStream << "Error, an out of date cache file was used" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
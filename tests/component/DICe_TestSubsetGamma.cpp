@@ -48,6 +48,8 @@
 #include <Teuchos_ParameterList.hpp>
 
 #include <iostream>
+#include <cmath>
+#include <vector>
 
 using namespace DICe;
 
@@ -115,6 +117,32 @@ int main(int argc, char *argv[]) {
     }
   } // end shifts
 
+  *outStream << "checking that the batch gamma values match the single evaluations" << std::endl;
+  Teuchos::ArrayRCP<intensity_t> smooth_intensities(img_width*img_height,0.0);
+  for(int_t y=0;y<img_height;++y)
+    for(int_t x=0;x<img_width;++x)
+      smooth_intensities[y*img_width+x] = 128.0 + 60.0*std::sin(0.21*x)*std::cos(0.17*y) + 20.0*std::sin(0.05*x*y/img_width);
+  Teuchos::RCP<Image> smoothImg = Teuchos::rcp(new Image(img_width,img_height,smooth_intensities));
+  Subset smooth_subset(100,100,41,41);
+  smooth_subset.initialize(smoothImg);
+  const int_t num_trials = 5;
+  std::vector<Teuchos::RCP<Local_Shape_Function> > trials(num_trials);
+  for(int_t i=0;i<num_trials;++i){
+    trials[i] = shape_function_factory();
+    trials[i]->insert_motion(0.37*i,-0.52*i+0.1,0.01*i);
+  }
+  std::vector<scalar_t> batch_gammas(num_trials,0.0);
+  smooth_subset.batch_gamma(smoothImg,num_trials,&trials[0],&batch_gammas[0],KEYS_FOURTH,2);
+  for(int_t i=0;i<num_trials;++i){
+    smooth_subset.initialize(smoothImg,DEF_INTENSITIES,trials[i],KEYS_FOURTH);
+    const scalar_t single_gamma = smooth_subset.gamma();
+    *outStream << "trial " << i << " batch gamma " << batch_gammas[i] << " single gamma " << single_gamma << std::endl;
+    if(std::abs(batch_gammas[i]-single_gamma)>1.0E-10){
+      *outStream << "Error, the batch gamma does not match the single evaluation" << std::endl;
+      errorFlag++;
+    }
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
@@ -0,0 +1,120 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+#include <DICe.h>
+#include <DICe_ThroughputTuner.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <iostream>
+#include <vector>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  // throughput (subsets per second) and error (pixels) of a set of evaluated cases
+  const scalar_t throughput[] = {1000.0, 800.0, 600.0, 900.0, 400.0, 2000.0};
+  const scalar_t error[]      = {0.05,   0.02,  0.03,  0.06,  0.01,  -1.0};
+  // case 2 is slower and less accurate than case 1, case 3 than case 0, case 5 could not be evaluated
+  const bool on_front[]       = {true,   true,  false, false, true,  false};
+  std::vector<Throughput_Tuning_Case> cases;
+  for(int_t i=0;i<6;++i){
+    cases.push_back(Throughput_Tuning_Case(21,KEYS_FOURTH,false,1.0E-4));
+    cases.back().subsets_per_second_ = throughput[i];
+    cases.back().avg_error_ = error[i];
+  }
+
+  *outStream << "marking the pareto front" << std::endl;
+  mark_pareto_front(cases);
+  for(int_t i=0;i<6;++i){
+    if(cases[i].pareto_optimal_!=on_front[i]){
+      *outStream << "Error, case " << i << " pareto optimal should be " << on_front[i] << std::endl;
+      errorFlag++;
+    }
+  }
+
+  *outStream << "selecting the fastest case that meets the accuracy target" << std::endl;
+  if(select_tuning_case(cases,0.05)!=0){
+    *outStream << "Error, the fastest case within 0.05 px should be case 0" << std::endl;
+    errorFlag++;
+  }
+  if(select_tuning_case(cases,0.025)!=1){
+    *outStream << "Error, the fastest case within 0.025 px should be case 1" << std::endl;
+    errorFlag++;
+  }
+  // the most accurate case is selected if none meets the target or there is no target
+  if(select_tuning_case(cases,0.001)!=4||select_tuning_case(cases,-1.0)!=4){
+    *outStream << "Error, the most accurate case should be selected without a reachable target" << std::endl;
+    errorFlag++;
+  }
+  if(select_tuning_case(std::vector<Throughput_Tuning_Case>(),0.05)!=-1){
+    *outStream << "Error, no case should be selected from an empty set" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
+
@@ -0,0 +1,137 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Trace.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "checking that nothing is recorded before the recorder is started" << std::endl;
+  {
+    Scoped_Trace_Span span("not_recorded","test");
+  }
+  Trace_Recorder::start(8);
+  if(Trace_Recorder::num_events()!=0){
+    *outStream << "Error, a span was recorded while the recorder was off" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "recording a frame with nested subset spans" << std::endl;
+  {
+    Scoped_Trace_Span frame_span("frame","frame",1);
+    for(int_t i=0;i<3;++i){
+      Scoped_Trace_Span subset_span("subset","correlation",i);
+      // the status is set on the inner most span
+      Trace_Recorder::set_status(CORRELATION_SUCCESSFUL);
+    }
+  }
+  if(Trace_Recorder::num_events()!=4||Trace_Recorder::num_dropped()!=0){
+    *outStream << "Error, wrong number of spans recorded: " << Trace_Recorder::num_events() << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "checking the trace file" << std::endl;
+  Trace_Recorder::write("trace_test.json");
+  std::ifstream trace_file("trace_test.json");
+  std::string trace_contents((std::istreambuf_iterator<char>(trace_file)),std::istreambuf_iterator<char>());
+  trace_file.close();
+  if(trace_contents.find("\"traceEvents\"")==std::string::npos||trace_contents.find("\"name\": \"frame\"")==std::string::npos||
+      trace_contents.find("\"gid\": 2")==std::string::npos||trace_contents.find("\"status\"")==std::string::npos){
+    *outStream << "Error, the trace file is missing spans" << std::endl;
+    errorFlag++;
+  }
+  std::remove("trace_test.json");
+
+  *outStream << "checking that the ring buffer keeps the newest spans" << std::endl;
+  for(int_t i=0;i<10;++i){
+    Scoped_Trace_Span span("filler","test",i);
+  }
+  if(Trace_Recorder::num_events()!=8||Trace_Recorder::num_dropped()!=6){
+    *outStream << "Error, the ring buffer should hold 8 spans with 6 dropped, holds " << Trace_Recorder::num_events() <<
+        " dropped " << Trace_Recorder::num_dropped() << std::endl;
+    errorFlag++;
+  }
+  Trace_Recorder::stop();
+  {
+    Scoped_Trace_Span span("not_recorded","test");
+  }
+  if(Trace_Recorder::num_events()!=8){
+    *outStream << "Error, a span was recorded after the recorder was stopped" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
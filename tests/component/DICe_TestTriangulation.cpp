@@ -47,6 +47,7 @@
 #include <Teuchos_oblackholestream.hpp>
 #include <Teuchos_ParameterList.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -361,6 +362,99 @@ int main(int argc, char *argv[]) {
 
   *outStream << "triangulation of 3d points completed and tested" << std::endl;
 
+  *outStream << "testing bulk triangulation of a set of points" << std::endl;
+
+  // the calibration has no distortion coefficients, so add some to exercise the correction
+  Teuchos::RCP<Triangulation> tri_dist = Teuchos::rcp(new Triangulation("./cal/cal_b.xml"));
+  (*tri_dist->cal_intrinsics())[0][5] = 0.02;
+  (*tri_dist->cal_intrinsics())[1][5] = -0.015;
+  (*tri_dist->cal_intrinsics())[1][6] = 0.003;
+  const int_t num_bulk_pts = 257;
+  std::vector<scalar_t> bx0(num_bulk_pts),by0(num_bulk_pts),bx1(num_bulk_pts),by1(num_bulk_pts);
+  for(int_t i=0;i<num_bulk_pts;++i){
+    bx0[i] = x_0 + (i%17)*3.1 - 20.0;
+    by0[i] = y_0 + (i/17)*2.7 - 15.0;
+    bx1[i] = bx0[i] + (x_1 - x_0) + 0.01*(i%5);
+    by1[i] = by0[i] + (y_1 - y_0) - 0.02*(i%3);
+  }
+  for(int_t dist=0;dist<2;++dist){
+    Teuchos::RCP<Triangulation> tri_b = dist==0 ? tri : tri_dist;
+    std::vector<scalar_t> bxc(num_bulk_pts),byc(num_bulk_pts),bzc(num_bulk_pts);
+    std::vector<scalar_t> bxw(num_bulk_pts),byw(num_bulk_pts),bzw(num_bulk_pts),bm(num_bulk_pts);
+    tri_b->triangulate(num_bulk_pts,&bx0[0],&by0[0],&bx1[0],&by1[0],&bxc[0],&byc[0],&bzc[0],
+      &bxw[0],&byw[0],&bzw[0],&bm[0],dist==1,4);
+    int_t num_bulk_errors = 0;
+    for(int_t i=0;i<num_bulk_pts;++i){
+      const scalar_t max_m_single = tri_b->triangulate(bx0[i],by0[i],bx1[i],by1[i],xc_out,yc_out,zc_out,xw_out,yw_out,zw_out,dist==1);
+      // relative tolerance since z is of order 1e3-1e4
+      const scalar_t tol = errorTol*std::max((scalar_t)1.0,std::abs(zc_out)*(scalar_t)1.0E-3);
+      if(std::abs(bxc[i]-xc_out)>tol||std::abs(byc[i]-yc_out)>tol||std::abs(bzc[i]-zc_out)>tol
+          ||std::abs(bxw[i]-xw_out)>tol||std::abs(byw[i]-yw_out)>tol||std::abs(bzw[i]-zw_out)>tol
+          ||std::abs(bm[i]-max_m_single)>tol){
+        num_bulk_errors++;
+        *outStream << "Error, bulk triangulation of point " << i << " (distortion " << dist << ") does not match: bulk "
+            << bxw[i] << " " << byw[i] << " " << bzw[i] << " single " << xw_out << " " << yw_out << " " << zw_out << std::endl;
+      }
+    }
+    // the point cloud version must give the same world coordinates
+    Point_Cloud_3D<scalar_t> world_pts;
+    tri_b->triangulate(num_bulk_pts,&bx0[0],&by0[0],&bx1[0],&by1[0],world_pts,NULL,dist==1,4);
+    if((int_t)world_pts.pts.size()!=num_bulk_pts){
+      num_bulk_errors++;
+      *outStream << "Error, the point cloud has the wrong number of points " << world_pts.pts.size() << std::endl;
+    }
+    else{
+      for(int_t i=0;i<num_bulk_pts;++i){
+        if(world_pts.pts[i].x!=bxw[i]||world_pts.pts[i].y!=byw[i]||world_pts.pts[i].z!=bzw[i]){
+          num_bulk_errors++;
+          *outStream << "Error, point cloud triangulation of point " << i << " (distortion " << dist << ") does not match the arrays" << std::endl;
+        }
+      }
+    }
+    if(num_bulk_errors>0) errorFlag++;
+  }
+
+  *outStream << "bulk triangulation completed and tested" << std::endl;
+
+  *outStream << "testing the lens distortion lookup table" << std::endl;
+
+  std::vector<scalar_t> ux(num_bulk_pts),uy(num_bulk_pts);
+  for(int_t i=0;i<num_bulk_pts;++i){
+    ux[i] = bx1[i];
+    uy[i] = by1[i];
+    tri_dist->correct_lens_distortion_radial(ux[i],uy[i],1);
+  }
+  const scalar_t map_error = tri_dist->build_lens_distortion_map(800,600,0.25);
+  *outStream << "lens distortion map max error " << map_error << std::endl;
+  if(!tri_dist->has_lens_distortion_map()||map_error>1.0E-3){
+    errorFlag++;
+    *outStream << "Error, the lens distortion map was not built or is not accurate enough" << std::endl;
+  }
+  int_t num_map_errors = 0;
+  for(int_t i=0;i<num_bulk_pts;++i){
+    scalar_t mx = bx1[i];
+    scalar_t my = by1[i];
+    tri_dist->correct_lens_distortion_radial(mx,my,1);
+    if(std::abs(mx-ux[i])>1.0E-3||std::abs(my-uy[i])>1.0E-3){
+      num_map_errors++;
+      *outStream << "Error, lens distortion map correction for point " << i << " is " << mx << " " << my
+          << " should be " << ux[i] << " " << uy[i] << std::endl;
+    }
+  }
+  // points outside the table fall back to the model
+  scalar_t ox = -10.0, oy = 700.0;
+  scalar_t ox_gold = ox, oy_gold = oy;
+  tri_dist->correct_lens_distortion_radial(ox,oy,0);
+  tri_dist->clear_lens_distortion_map();
+  tri_dist->correct_lens_distortion_radial(ox_gold,oy_gold,0);
+  if(std::abs(ox-ox_gold)>1.0E-5||std::abs(oy-oy_gold)>1.0E-5||tri_dist->has_lens_distortion_map()){
+    num_map_errors++;
+    *outStream << "Error, lens distortion correction outside the map should use the model" << std::endl;
+  }
+  if(num_map_errors>0) errorFlag++;
+
+  *outStream << "lens distortion lookup table completed and tested" << std::endl;
+
   *outStream << "testing projective transforms" << std::endl;
 
   Teuchos::RCP<Triangulation> proj_tri = Teuchos::rcp(new Triangulation());
@@ -504,6 +598,48 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  *outStream << "testing the robust projection estimate with mismatched points" << std::endl;
+  {
+    // a known projection with every fourth match replaced by a point that does not belong
+    const scalar_t H_gold[9] = {1.02,0.01,5.0,-0.02,0.98,-3.0,1.0E-5,2.0E-5,1.0};
+    std::vector<scalar_t> rxl, ryl, rxr, ryr;
+    for(int_t j=0;j<8;++j){
+      for(int_t i=0;i<8;++i){
+        const scalar_t x = 50.0 + 110.0*i + 7.0*j;
+        const scalar_t y = 40.0 + 120.0*j + 3.0*i;
+        const scalar_t d = H_gold[6]*x + H_gold[7]*y + H_gold[8];
+        rxl.push_back(x);
+        ryl.push_back(y);
+        if((i+j*8)%4==0){
+          rxr.push_back(900.0 - 0.7*x + 0.3*y);
+          ryr.push_back(25.0 + 0.5*x);
+        }
+        else{
+          rxr.push_back((H_gold[0]*x + H_gold[1]*y + H_gold[2])/d);
+          ryr.push_back((H_gold[3]*x + H_gold[4]*y + H_gold[5])/d);
+        }
+      }
+    }
+    std::vector<bool> inliers;
+    Teuchos::SerialDenseMatrix<int_t,double> H = compute_robust_affine_matrix(rxl,ryl,rxr,ryr,inliers);
+    for(size_t i=0;i<rxl.size();++i){
+      if(inliers[i]!=(i%4!=0)){
+        *outStream << "Error, point " << i << " has the wrong inlier flag" << std::endl;
+        errorFlag++;
+      }
+      const scalar_t d = H(2,0)*rxl[i] + H(2,1)*ryl[i] + H(2,2);
+      const scalar_t x = (H(0,0)*rxl[i] + H(0,1)*ryl[i] + H(0,2))/d;
+      const scalar_t y = (H(1,0)*rxl[i] + H(1,1)*ryl[i] + H(1,2))/d;
+      const scalar_t gd = H_gold[6]*rxl[i] + H_gold[7]*ryl[i] + H_gold[8];
+      const scalar_t gx = (H_gold[0]*rxl[i] + H_gold[1]*ryl[i] + H_gold[2])/gd;
+      const scalar_t gy = (H_gold[3]*rxl[i] + H_gold[4]*ryl[i] + H_gold[5])/gd;
+      if(std::abs(x-gx)>errorTol||std::abs(y-gy)>errorTol){
+        *outStream << "Error, robust projection of point " << i << " is " << x << " " << y << " should be " << gx << " " << gy << std::endl;
+        errorFlag++;
+      }
+    }
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
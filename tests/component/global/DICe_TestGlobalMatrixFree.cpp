@@ -0,0 +1,203 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Global.h>
+#include <DICe_MatrixFreeOperator.h>
+#include <DICe_Preconditioner.h>
+#include <DICe_Image.h>
+#include <DICe_Schema.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+
+using namespace DICe;
+using namespace DICe::global;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "generating the correlation and input params" << std::endl;
+  Teuchos::RCP<Teuchos::ParameterList> input_params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<Teuchos::ParameterList> corr_params = Teuchos::rcp(new Teuchos::ParameterList());
+  input_params->set(DICe::subset_file,"matrix_free_roi.txt");
+  input_params->set(DICe::output_folder,"");
+  input_params->set(DICe::output_prefix,"matrix_free");
+  input_params->set(DICe::image_folder,"");
+  input_params->set(DICe::mesh_size,400.0);
+  corr_params->set(DICe::use_global_dic,true);
+  corr_params->set(DICe::global_solver,CG_SOLVER);
+  corr_params->set(DICe::global_formulation,HORN_SCHUNCK);
+  corr_params->set(DICe::global_regularization_alpha,0.5);
+  corr_params->set(DICe::global_element_type,"TRI6");
+  corr_params->set(DICe::num_image_integration_points,10);
+
+  *outStream << "creating the image set" << std::endl;
+  const int_t w = 200;
+  const int_t h = 200;
+  Teuchos::ArrayRCP<intensity_t> ref_intens(w*h,0.0);
+  Teuchos::ArrayRCP<intensity_t> def_intens(w*h,0.0);
+  for(int_t y=0;y<h;++y){
+    for(int_t x=0;x<w;++x){
+      ref_intens[y*w+x] = 100.0 + 50.0*std::sin(0.2*x)*std::cos(0.15*y);
+      def_intens[y*w+x] = 100.0 + 50.0*std::sin(0.2*(x-0.3))*std::cos(0.15*(y-0.2));
+    }
+  }
+  Teuchos::RCP<Image> ref = Teuchos::rcp(new Image(w,h,ref_intens));
+  ref->write("ref_matrix_free.tif");
+  Teuchos::RCP<Image> def = Teuchos::rcp(new Image(w,h,def_intens));
+  def->write("def_matrix_free.tif");
+  input_params->set(DICe::reference_image,"ref_matrix_free.tif");
+  Teuchos::ParameterList def_img_params;
+  def_img_params.set("def_matrix_free.tif",true);
+  input_params->set(DICe::deformed_images,def_img_params);
+
+  *outStream << "creating the global roi file" << std::endl;
+  std::ofstream roi_file;
+  std::string roi_file_name = "matrix_free_roi.txt";
+  roi_file.open(roi_file_name);
+  roi_file << "begin region_of_interest\n";
+  roi_file << "  begin boundary\n";
+  roi_file << "    begin polygon\n";
+  roi_file << "      begin vertices\n";
+  roi_file << "        20 20\n";
+  roi_file << "        180 20\n";
+  roi_file << "        180 180\n";
+  roi_file << "        20 180\n";
+  roi_file << "      end vertices\n";
+  roi_file << "    end polygon\n";
+  roi_file << "  end boundary\n";
+  roi_file << "  dirichlet_bc boundary 0 0 1 2 0.0\n";
+  roi_file << "  dirichlet_bc boundary 0 2 3 2 0.0\n";
+  roi_file << "end region_of_interest\n";
+  roi_file.close();
+
+  *outStream << "constructing a schema" << std::endl;
+  Teuchos::RCP<DICe::Schema> schema = Teuchos::rcp(new DICe::Schema(input_params,corr_params));
+  schema->set_ref_image(ref);
+  schema->set_def_image(def);
+  Teuchos::RCP<Global_Algorithm> alg = schema->global_algorithm();
+  alg->pre_execution_tasks();
+
+  *outStream << "assembling the tangent" << std::endl;
+  Teuchos::RCP<DICe::MultiField_Matrix> tangent = alg->compute_tangent(true);
+
+  *outStream << "creating the matrix free operator" << std::endl;
+  Matrix_Free_Operator op(alg.get());
+  op.update(true);
+
+  // apply both operators to the same vector
+  Teuchos::RCP<MultiField> lhs = alg->mesh()->get_field(field_enums::LHS_FS);
+  Epetra_Vector x(lhs->get()->Map());
+  Epetra_Vector y_assembled(lhs->get()->Map());
+  Epetra_Vector y_matrix_free(lhs->get()->Map());
+  for(int_t i=0;i<x.MyLength();++i)
+    x[i] = std::cos(0.37*x.Map().GID(i));
+  tangent->get()->Apply(x,y_assembled);
+  op.Apply(x,y_matrix_free);
+  double norm_assembled = 0.0;
+  y_assembled.Norm2(&norm_assembled);
+  scalar_t max_diff = 0.0;
+  for(int_t i=0;i<x.MyLength();++i)
+    max_diff = std::max(max_diff,(scalar_t)std::abs(y_assembled[i]-y_matrix_free[i]));
+  *outStream << "norm of A*x " << norm_assembled << " max difference " << max_diff << std::endl;
+  if(norm_assembled <= 0.0 || max_diff > 1.0E-4*norm_assembled){
+    *outStream << "Error, the matrix free operator does not match the assembled tangent" << std::endl;
+    errorFlag++;
+  }
+
+  // the diagonals should match too
+  Epetra_Vector diag_assembled(lhs->get()->Map());
+  Epetra_Vector diag_matrix_free(lhs->get()->Map());
+  tangent->get()->ExtractDiagonalCopy(diag_assembled);
+  op.extract_diagonal(diag_matrix_free);
+  scalar_t max_diag_diff = 0.0;
+  for(int_t i=0;i<x.MyLength();++i)
+    max_diag_diff = std::max(max_diag_diff,(scalar_t)(std::abs(diag_assembled[i]-diag_matrix_free[i])/std::max(1.0,std::abs(diag_assembled[i]))));
+  *outStream << "max relative diagonal difference " << max_diag_diff << std::endl;
+  if(max_diag_diff > 1.0E-4){
+    *outStream << "Error, the matrix free diagonal does not match the assembled tangent" << std::endl;
+    errorFlag++;
+  }
+
+  // the Jacobi preconditioner should invert the diagonal
+  Preconditioner_Factory factory;
+  Teuchos::RCP<Diagonal_Preconditioner> jacobi = factory.create_jacobi(diag_matrix_free);
+  Epetra_Vector z(lhs->get()->Map());
+  jacobi->ApplyInverse(diag_matrix_free,z);
+  scalar_t max_jacobi_diff = 0.0;
+  for(int_t i=0;i<z.MyLength();++i)
+    max_jacobi_diff = std::max(max_jacobi_diff,(scalar_t)std::abs(diag_matrix_free[i]==0.0 ? z[i] : z[i]-1.0));
+  if(max_jacobi_diff > 1.0E-6){
+    *outStream << "Error, the Jacobi preconditioner did not invert the diagonal" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
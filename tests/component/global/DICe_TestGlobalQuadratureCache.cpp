@@ -0,0 +1,206 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Global.h>
+#include <DICe_QuadratureCache.h>
+#include <DICe_Image.h>
+#include <DICe_Schema.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+
+using namespace DICe;
+using namespace DICe::global;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  int_t iprint     = argc - 1;
+  int_t errorFlag  = 0;
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (iprint > 0)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin test ---" << std::endl;
+
+  *outStream << "generating the correlation and input params" << std::endl;
+  Teuchos::RCP<Teuchos::ParameterList> input_params = Teuchos::rcp(new Teuchos::ParameterList());
+  Teuchos::RCP<Teuchos::ParameterList> corr_params = Teuchos::rcp(new Teuchos::ParameterList());
+  input_params->set(DICe::subset_file,"quadrature_cache_roi.txt");
+  input_params->set(DICe::output_folder,"");
+  input_params->set(DICe::output_prefix,"quadrature_cache");
+  input_params->set(DICe::image_folder,"");
+  input_params->set(DICe::mesh_size,400.0);
+  corr_params->set(DICe::use_global_dic,true);
+  corr_params->set(DICe::global_solver,CG_SOLVER);
+  corr_params->set(DICe::global_formulation,HORN_SCHUNCK);
+  corr_params->set(DICe::global_regularization_alpha,0.5);
+  corr_params->set(DICe::global_element_type,"TRI6");
+  corr_params->set(DICe::num_image_integration_points,10);
+
+  *outStream << "creating the image set" << std::endl;
+  const int_t w = 200;
+  const int_t h = 200;
+  Teuchos::ArrayRCP<intensity_t> ref_intens(w*h,0.0);
+  Teuchos::ArrayRCP<intensity_t> def_intens(w*h,0.0);
+  for(int_t y=0;y<h;++y){
+    for(int_t x=0;x<w;++x){
+      ref_intens[y*w+x] = 100.0 + 50.0*std::sin(0.2*x)*std::cos(0.15*y);
+      def_intens[y*w+x] = 100.0 + 50.0*std::sin(0.2*(x-0.3))*std::cos(0.15*(y-0.2));
+    }
+  }
+  Teuchos::RCP<Image> ref = Teuchos::rcp(new Image(w,h,ref_intens));
+  ref->write("ref_quadrature_cache.tif");
+  Teuchos::RCP<Image> def = Teuchos::rcp(new Image(w,h,def_intens));
+  def->write("def_quadrature_cache.tif");
+  input_params->set(DICe::reference_image,"ref_quadrature_cache.tif");
+  Teuchos::ParameterList def_img_params;
+  def_img_params.set("def_quadrature_cache.tif",true);
+  input_params->set(DICe::deformed_images,def_img_params);
+
+  *outStream << "creating the global roi file" << std::endl;
+  std::ofstream roi_file;
+  std::string roi_file_name = "quadrature_cache_roi.txt";
+  roi_file.open(roi_file_name);
+  roi_file << "begin region_of_interest\n";
+  roi_file << "  begin boundary\n";
+  roi_file << "    begin polygon\n";
+  roi_file << "      begin vertices\n";
+  roi_file << "        20 20\n";
+  roi_file << "        180 20\n";
+  roi_file << "        180 180\n";
+  roi_file << "        20 180\n";
+  roi_file << "      end vertices\n";
+  roi_file << "    end polygon\n";
+  roi_file << "  end boundary\n";
+  roi_file << "  dirichlet_bc boundary 0 0 1 2 0.0\n";
+  roi_file << "  dirichlet_bc boundary 0 2 3 2 0.0\n";
+  roi_file << "end region_of_interest\n";
+  roi_file.close();
+
+  *outStream << "constructing a schema" << std::endl;
+  Teuchos::RCP<DICe::Schema> schema = Teuchos::rcp(new DICe::Schema(input_params,corr_params));
+  schema->set_ref_image(ref);
+  schema->set_def_image(def);
+  Teuchos::RCP<Global_Algorithm> alg = schema->global_algorithm();
+  alg->pre_execution_tasks();
+
+  *outStream << "checking the cached integration point data" << std::endl;
+  Quadrature_Cache quad(alg.get());
+  // the weighted jacobians should integrate to the area of the region of interest
+  const scalar_t roi_area = 160.0*160.0;
+  scalar_t area = 0.0;
+  scalar_t image_area = 0.0;
+  for(int_t elem=0;elem<quad.num_elem();++elem){
+    for(int_t gp=0;gp<quad.num_gps();++gp)
+      area += quad.gp_weight(gp)*quad.J(elem,gp);
+    for(int_t gp=0;gp<quad.num_image_gps();++gp)
+      image_area += quad.image_gp_weight(gp)*quad.image_J(elem,gp);
+  }
+  *outStream << "integrated area " << area << " image integrated area " << image_area << " roi area " << roi_area << std::endl;
+  if(std::abs(area-roi_area)/roi_area > 1.0E-4 || std::abs(image_area-roi_area)/roi_area > 1.0E-4){
+    *outStream << "Error, the cached jacobians do not integrate to the roi area" << std::endl;
+    errorFlag++;
+  }
+  // the cached reference image values should match the images interpolated at the integration points
+  if(!quad.has_reference_image_values()){
+    *outStream << "Error, the reference image values should have been cached" << std::endl;
+    errorFlag++;
+  }
+  else{
+    scalar_t max_phi_diff = 0.0;
+    for(int_t elem=0;elem<quad.num_elem();++elem){
+      for(int_t gp=0;gp<quad.num_image_gps();++gp){
+        const scalar_t x = quad.image_x(elem,gp);
+        const scalar_t y = quad.image_y(elem,gp);
+        max_phi_diff = std::max(max_phi_diff,(scalar_t)std::abs(quad.phi_0(elem,gp)-alg->ref_img()->interpolate_bicubic(x,y)));
+        max_phi_diff = std::max(max_phi_diff,(scalar_t)std::abs(quad.grad_phi_x(elem,gp)-alg->grad_x()->interpolate_bicubic(x,y)));
+        max_phi_diff = std::max(max_phi_diff,(scalar_t)std::abs(quad.grad_phi_y(elem,gp)-alg->grad_y()->interpolate_bicubic(x,y)));
+      }
+    }
+    *outStream << "max cached image value diff " << max_phi_diff << std::endl;
+    if(max_phi_diff > 1.0E-6){
+      *outStream << "Error, the cached reference image values are not correct" << std::endl;
+      errorFlag++;
+    }
+  }
+
+  // with a zero displacement field the fixed point terms (evaluated on the fly) and the
+  // cached terms are evaluated at the same points so the residual and tangent should match
+  *outStream << "comparing the cached and fixed point residual and tangent" << std::endl;
+  const scalar_t residual_norm = alg->compute_residual(false);
+  const scalar_t fixed_point_residual_norm = alg->compute_residual(true);
+  *outStream << "residual norm " << residual_norm << " fixed point residual norm " << fixed_point_residual_norm << std::endl;
+  if(residual_norm <= 0.0 || std::abs(residual_norm-fixed_point_residual_norm) > 1.0E-6*residual_norm){
+    *outStream << "Error, the cached residual does not match the fixed point residual" << std::endl;
+    errorFlag++;
+  }
+  const scalar_t tangent_norm = alg->compute_tangent(false)->get()->NormFrobenius();
+  const scalar_t fixed_point_tangent_norm = alg->compute_tangent(true)->get()->NormFrobenius();
+  *outStream << "tangent norm " << tangent_norm << " fixed point tangent norm " << fixed_point_tangent_norm << std::endl;
+  if(tangent_norm <= 0.0 || std::abs(tangent_norm-fixed_point_tangent_norm) > 1.0E-6*tangent_norm){
+    *outStream << "Error, the cached tangent does not match the fixed point tangent" << std::endl;
+    errorFlag++;
+  }
+
+  *outStream << "--- End test ---" << std::endl;
+
+  DICe::finalize();
+
+  if (errorFlag != 0)
+    std::cout << "End Result: TEST FAILED\n";
+  else
+    std::cout << "End Result: TEST PASSED\n";
+
+  return 0;
+
+}
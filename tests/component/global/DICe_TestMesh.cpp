@@ -50,6 +50,8 @@
 #include <Teuchos_ParameterList.hpp>
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 using namespace DICe;
 
@@ -126,6 +128,35 @@ int main(int argc, char *argv[]) {
   }
   *outStream << "coordinate fields have been checked" << std::endl;
 
+  *outStream << "checking the flat connectivity and coordinate arrays" << std::endl;
+  const DICe::mesh::Flat_Mesh_Data & flat = mesh->get_flat_data();
+  if(flat.num_elem()!=(int_t)mesh->num_elem()){
+    *outStream << "Error, the number of elements in the flat arrays is not correct" << std::endl;
+    errorFlag++;
+  }
+  else{
+    Teuchos::ArrayRCP<const scalar_t> coords_values = mesh->get_overlap_field(field_enums::INITIAL_COORDINATES_FS)->get_1d_view();
+    bool flat_error = false;
+    for(int_t elem=0;elem<flat.num_elem();++elem){
+      const DICe::mesh::connectivity_vector & connectivity = *(*mesh->get_element_set())[elem]->connectivity();
+      if(flat.num_elem_nodes(elem)!=(int_t)connectivity.size()){
+        flat_error = true;
+        continue;
+      }
+      for(size_t nd=0;nd<connectivity.size();++nd){
+        const int_t overlap_id = connectivity[nd]->overlap_local_id();
+        if(flat.elem_nodes(elem)[nd]!=overlap_id||flat.elem_node_gids(elem)[nd]!=connectivity[nd]->global_id()
+            ||flat.node_x[overlap_id]!=coords_values[overlap_id*2+0]||flat.node_y[overlap_id]!=coords_values[overlap_id*2+1])
+          flat_error = true;
+      }
+    }
+    if(flat_error){
+      *outStream << "Error, the flat arrays do not match the element connectivity or coordinates" << std::endl;
+      errorFlag++;
+    }
+  }
+  *outStream << "the flat arrays have been checked" << std::endl;
+
   *outStream << "checking the boundary conditions on the input mesh" << std::endl;
   DICe::mesh::side_set_info & ss_info = *mesh->get_side_set_info();
   int_t num_side_sets = ss_info.ids.size();
@@ -167,9 +198,23 @@ int main(int argc, char *argv[]) {
   DICe::mesh::create_exodus_output_variable_names(mesh);
   DICe::mesh::create_face_edge_output_variable_names(mesh);
 
-  *outStream << "writing an output step" << std::endl;
+  *outStream << "writing buffered output steps" << std::endl;
+  // three steps are held in memory before they are written, the last step is written by close_exodus_output()
+  const int_t num_output_steps = 4;
+  mesh->set_output_buffer_size(3);
+  for(int_t step=1;step<=num_output_steps;++step){
+    for(size_t i=0;i<mesh->num_nodes();++i){
+      phi.local_value(i) = coords_values[i]*10.0*step;
+    }
+    DICe::mesh::exodus_output_dump(mesh,step,step-1);
+    const int_t num_buffered = step%3;
+    if((int_t)mesh->get_output_buffer()->size()!=num_buffered){
+      *outStream << "Error, the output buffer should have " << num_buffered << " steps after step " << step
+          << " but has " << mesh->get_output_buffer()->size() << std::endl;
+      errorFlag++;
+    }
+  }
   scalar_t time = 0.0;
-  DICe::mesh::exodus_output_dump(mesh,1,time);
   DICe::mesh::exodus_face_edge_output_dump(mesh,1,time);
 
   *outStream << "closing the exodus output files" << std::endl;
@@ -195,6 +240,47 @@ int main(int argc, char *argv[]) {
     errorFlag++;
   }
   *outStream << "output mesh properties have been checked" << std::endl;
+
+  *outStream << "checking the buffered output steps" << std::endl;
+  if(DICe::mesh::read_exodus_num_steps(mesh_output_file_name)!=num_output_steps){
+    *outStream << "Error, the output file should have " << num_output_steps << " steps" << std::endl;
+    errorFlag++;
+  }
+  else{
+    scalar_t max_step_1 = 0.0;
+    for(int_t step=1;step<=num_output_steps;++step){
+      std::vector<scalar_t> phi_out = DICe::mesh::read_exodus_field(mesh_output_file_name,"FIELD_1",step);
+      scalar_t max_value = 0.0;
+      for(size_t i=0;i<phi_out.size();++i)
+        max_value = std::max(max_value,std::abs(phi_out[i]));
+      if(step==1) max_step_1 = max_value;
+      // each step scales the field by the step number
+      if(max_value<=0.0||std::abs(max_value - step*max_step_1) > 1.0E-3*max_value){
+        *outStream << "Error, the values written for step " << step << " are not correct" << std::endl;
+        errorFlag++;
+      }
+    }
+    *outStream << "checking the bulk read of the field history" << std::endl;
+    std::vector<std::string> history_fields(1,"FIELD_1");
+    std::vector<scalar_t> history = DICe::mesh::read_exodus_field_history(mesh_output_file_name,history_fields);
+    const int_t num_out_nodes = mesh_out->num_nodes();
+    if((int_t)history.size()!=num_output_steps*num_out_nodes){
+      *outStream << "Error, the field history is the wrong size" << std::endl;
+      errorFlag++;
+    }
+    else{
+      for(int_t step=1;step<=num_output_steps;++step){
+        std::vector<scalar_t> phi_out = DICe::mesh::read_exodus_field(mesh_output_file_name,"FIELD_1",step);
+        for(int_t i=0;i<num_out_nodes;++i){
+          if(history[(step-1)*num_out_nodes+i]!=phi_out[i]){
+            *outStream << "Error, the field history does not match the single step read for step " << step << std::endl;
+            errorFlag++;
+            break;
+          }
+        }
+      }
+    }
+  }
 // TODO test the fields in the output mesh
 //  *outStream << "checking the output file for correct fields" << std::endl;
 //  MultiField & phi_out = *mesh_out->get_field(field_enums::FIELD_1_FS);
@@ -133,6 +133,16 @@ int main(int argc, char *argv[]) {
     errorFlag++;
   }
 
+  *outStream << " checking that a cached mesh matches the generated mesh" << std::endl;
+  // the first call writes the cache file and the second one reads it back
+  for(int_t pass=0;pass<2;++pass){
+    Teuchos::RCP<DICe::mesh::Mesh> cached_mesh = generate_tri_mesh(DICe::mesh::TRI6,file_name,max_size_constraint,"triangle_cache_test_mesh.e",".");
+    if(cached_mesh->num_elem()!=mesh->num_elem()||cached_mesh->num_nodes()!=mesh->num_nodes()||cached_mesh->num_node_sets()!=mesh->num_node_sets()){
+      *outStream << "Error, the mesh from pass " << pass << " with the cache enabled does not match" << std::endl;
+      errorFlag++;
+    }
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
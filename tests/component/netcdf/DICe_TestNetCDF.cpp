@@ -95,6 +95,25 @@ int main(int argc, char *argv[]) {
     *outStream << "Error, the NetCDF sub image was not read correctly" << std::endl;
   }
 
+  // a persistent reader keeps the file open, the region read as a hyperslab should match the full frame
+  DICe::netcdf::NetCDF_Reader netcdf_reader;
+  const int_t roi_x = 1235, roi_y = 491, roi_w = 496, roi_h = 370;
+  std::vector<intensity_t> roi_intens(roi_w*roi_h,0.0);
+  netcdf_reader.read_netcdf_image("../images/goes14.2016.222.215844.BAND_01.nc",roi_x,roi_y,roi_w,roi_h,0,&roi_intens[0]);
+  std::vector<intensity_t> full_intens(img->width()*img->height(),0.0);
+  netcdf_reader.read_netcdf_image("../images/goes14.2016.222.215844.BAND_01.nc",&full_intens[0],0);
+  bool roi_error = false;
+  for(int_t y=0;y<roi_h;++y){
+    for(int_t x=0;x<roi_w;++x){
+      if(roi_intens[y*roi_w+x]!=full_intens[(y+roi_y)*img->width()+x+roi_x]||roi_intens[y*roi_w+x]!=subImg(x,y))
+        roi_error = true;
+    }
+  }
+  if(roi_error){
+    errorFlag++;
+    *outStream << "Error, the NetCDF region read does not match the full frame" << std::endl;
+  }
+
   // test writing fields out to a netcdf file:
   int_t img_w = gold_sub_img->width();
   int_t img_h = gold_sub_img->height();
@@ -121,6 +140,32 @@ int main(int argc, char *argv[]) {
   }
 
 
+#ifdef NC_NETCDF4
+  *outStream << "testing compressed output appended one time step at a time" << std::endl;
+  Teuchos::RCP<DICe::netcdf::NetCDF_Writer> compressed_writer =
+      Teuchos::rcp(new DICe::netcdf::NetCDF_Writer("test_compressed.nc",img_w,img_h,2,var_names,false,4));
+  std::vector<float> shifted_vec(data_vec);
+  for(size_t i=0;i<shifted_vec.size();++i)
+    shifted_vec[i] += 1.0f;
+  compressed_writer->append_float_array("data",data_vec);
+  compressed_writer->append_float_array("data",shifted_vec);
+  compressed_writer->close();
+  Teuchos::RCP<Image> compressed_img_0 = Teuchos::rcp(new Image("./test_compressed_frame_0.nc"));
+  Teuchos::RCP<Image> compressed_img_1 = Teuchos::rcp(new Image("./test_compressed_frame_1.nc"));
+  const scalar_t compressed_diff = compressed_img_0->diff(gold_sub_img);
+  bool compressed_error = std::abs(compressed_diff) > errorTol;
+  for(int_t j=0;j<img_h;++j){
+    for(int_t i=0;i<img_w;++i){
+      if(std::abs((*compressed_img_1)(i,j) - data_vec[j*img_w+i] - 1.0) > errorTol)
+        compressed_error = true;
+    }
+  }
+  if(compressed_error){
+    errorFlag++;
+    *outStream << "Error, the compressed NetCDF file was not read correctly" << std::endl;
+  }
+#endif
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
@@ -99,6 +99,38 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  *outStream << "matching previously detected features" << std::endl;
+  Feature_Set left_features(left_img,tol);
+  Feature_Set right_features(right_img,tol);
+  std::vector<scalar_t> set_left_x;
+  std::vector<scalar_t> set_left_y;
+  std::vector<scalar_t> set_right_x;
+  std::vector<scalar_t> set_right_y;
+  match_features(left_features,right_features,set_left_x,set_left_y,set_right_x,set_right_y);
+  if((int_t)set_left_x.size()!=num_matches){
+    errorFlag++;
+    *outStream << "Error, the feature set matches should be the same as the image matches" << std::endl;
+  }
+  // the same features can be matched again with a different matcher
+  match_features(left_features,right_features,set_left_x,set_left_y,set_right_x,set_right_y,FLANN_LSH_FEATURE_MATCHER);
+  const int_t num_lsh_matches = set_left_x.size();
+  *outStream << "number of features matched with lsh: " << num_lsh_matches << std::endl;
+  // the lsh search is approximate so not all of the brute force matches are found
+  if(num_lsh_matches < num_matches/2){
+    errorFlag++;
+    *outStream << "Error, too few features matched with the lsh matcher" << std::endl;
+  }
+  int_t num_lsh_errors = 0;
+  for(int_t i=0;i<num_lsh_matches;++i){
+    if(std::abs(set_right_x[i] - set_left_x[i] - 160) > errorTol || std::abs(set_right_y[i] - set_left_y[i] - 140) > errorTol)
+      num_lsh_errors++;
+  }
+  // a few outliers are allowed since the approximate neighbors can pass the ratio test
+  if(num_lsh_errors > num_lsh_matches/100){
+    errorFlag++;
+    *outStream << "Error, " << num_lsh_errors << " lsh matches have the wrong displacement" << std::endl;
+  }
+
   *outStream << "--- End test ---" << std::endl;
 
   DICe::finalize();
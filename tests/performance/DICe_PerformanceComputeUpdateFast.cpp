@@ -0,0 +1,177 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Schema.h>
+#include <DICe_Objective.h>
+#include <DICe_LocalShapeFunction.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_ArrayRCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+#include <Teuchos_SerialDenseMatrix.hpp>
+
+#include <boost/timer/timer.hpp>
+
+#include <iostream>
+#include <cmath>
+
+using namespace DICe;
+using namespace boost::timer;
+
+// Usage DICe_PerformanceComputeUpdateFast [<num_time_samples> <subset_size>]
+
+/// synthetic speckle-like intensity pattern (smooth so the gradients are well defined)
+intensity_t pattern(const scalar_t & x, const scalar_t & y){
+  return 128.0 + 40.0*std::sin(0.31*x)*std::cos(0.23*y) + 30.0*std::sin(0.17*x + 0.41*y) + 20.0*std::cos(0.53*x - 0.11*y);
+}
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  Teuchos::oblackholestream bhs; // outputs nothing
+  Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&bhs, false);
+  if(argc>1) // anything but the default cases, writes output to screen
+    outStream = Teuchos::rcp(&std::cout, false);
+
+  *outStream << "--- Begin performance test ---" << std::endl;
+
+  int_t num_time_samples = 5;
+  if(argc>1) num_time_samples = std::strtol(argv[1],NULL,0);
+  int_t subset_size = 31;
+  if(argc>2) subset_size = std::strtol(argv[2],NULL,0);
+  assert(num_time_samples>0);
+  assert(subset_size>0);
+
+  // create the images
+  const int_t width = 500;
+  const int_t height = 300;
+  const scalar_t ux = 0.35;
+  const scalar_t uy = -0.62;
+  Teuchos::ArrayRCP<intensity_t> ref_intens(width*height,0.0);
+  Teuchos::ArrayRCP<intensity_t> def_intens(width*height,0.0);
+  for(int_t y=0;y<height;++y){
+    for(int_t x=0;x<width;++x){
+      ref_intens[y*width+x] = pattern(x,y);
+      def_intens[y*width+x] = pattern(x-ux,y-uy);
+    }
+  }
+  Teuchos::RCP<Teuchos::ParameterList> params = rcp(new Teuchos::ParameterList());
+  params->set(DICe::interpolation_method,DICe::KEYS_FOURTH);
+  Schema schema(width,height,subset_size,subset_size,subset_size,params);
+  schema.set_ref_image(width,height,ref_intens);
+  schema.set_def_image(width,height,def_intens);
+
+  // set up the objectives for a grid of subsets
+  std::vector<Teuchos::RCP<Objective> > objectives;
+  const int_t buffer = subset_size;
+  for(int_t y=buffer;y<height-buffer;y+=subset_size)
+    for(int_t x=buffer;x<width-buffer;x+=subset_size)
+      objectives.push_back(Teuchos::rcp(new Objective_ZNSSD(&schema,x,y)));
+  const int_t num_objectives = objectives.size();
+  *outStream << "image dims:               " << width << " x " << height << std::endl;
+  *outStream << "subset size:              " << subset_size << std::endl;
+  *outStream << "number of subsets:        " << num_objectives << std::endl;
+  *outStream << "number of time samples:   " << num_time_samples << std::endl;
+
+  std::vector<Teuchos::RCP<Local_Shape_Function> > shape_functions(num_objectives);
+  for(int_t i=0;i<num_objectives;++i)
+    shape_functions[i] = shape_function_factory(&schema);
+  const int_t N = shape_functions[0]->num_params();
+
+  scalar_t cold_time = 0.0;
+  scalar_t warm_time = 0.0;
+  scalar_t alloc_time = 0.0;
+  int_t total_its = 0;
+  int_t num_failed = 0;
+  for(int_t time_sample=0;time_sample<num_time_samples;++time_sample){
+    // the first call on this thread sizes the workspace, every call after that reuses it
+    for(int_t i=0;i<num_objectives;++i){
+      shape_functions[i]->clear();
+      int_t num_its = 0;
+      cpu_timer update_timer;
+      update_timer.start();
+      const Status_Flag status = objectives[i]->computeUpdateFast(shape_functions[i],num_its);
+      update_timer.stop();
+      const scalar_t elapsed = (scalar_t)(update_timer.elapsed().wall)/1000000000;
+      if(time_sample==0&&i==0) cold_time = elapsed;
+      else warm_time += elapsed;
+      total_its += num_its + 1;
+      if(status!=CORRELATION_SUCCESSFUL) num_failed++;
+    }
+    // the storage that used to be allocated and freed on every call
+    cpu_timer alloc_timer;
+    alloc_timer.start();
+    for(int_t i=0;i<num_objectives;++i){
+      int * IPIV = new int[N+1];
+      double * WORK = new double[N*N];
+      Teuchos::SerialDenseMatrix<int_t,double> H(N,N,true);
+      Teuchos::ArrayRCP<double> q(N,0.0);
+      std::vector<scalar_t> residuals(N,0.0);
+      std::vector<scalar_t> def_old(N,0.0);
+      std::vector<scalar_t> def_update(N,0.0);
+      IPIV[0] = 0; WORK[0] = H(0,0) + q[0] + residuals[0] + def_old[0] + def_update[0];
+      delete [] WORK;
+      delete [] IPIV;
+    }
+    alloc_timer.stop();
+    alloc_time += (scalar_t)(alloc_timer.elapsed().wall)/1000000000;
+  }
+  const int_t num_warm_calls = num_objectives*num_time_samples - 1;
+  *outStream << "total solver iterations:  " << total_its << std::endl;
+  *outStream << "failed solves:            " << num_failed << std::endl;
+  *outStream << "first call time:          " << cold_time << " (includes sizing the workspace)" << std::endl;
+  if(num_warm_calls>0)
+    *outStream << "avg time per call:        " << warm_time/num_warm_calls << std::endl;
+  if(total_its>0)
+    *outStream << "avg time per iteration:   " << (warm_time + cold_time)/total_its << std::endl;
+  *outStream << "per call allocation cost removed from the inner loop: " << alloc_time/(num_objectives*num_time_samples) << std::endl;
+
+  *outStream << "--- End performance test ---" << std::endl;
+
+  DICe::finalize();
+
+  return 0;
+}
+
@@ -0,0 +1,288 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Schema.h>
+#include <DICe_ImageUtils.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <boost/timer/timer.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace DICe;
+using namespace boost::timer;
+
+// Usage DICe_PerformanceCorrelation [<results_file (.json or .csv)> [<num_repeats> [<1: full sweep>]]]
+//
+// Times complete correlations of synthetic speckle images deformed with a sin()*cos() displacement
+// field. The images are analytical so every run of the benchmark correlates exactly the same workload.
+
+/// shape functions exercised by the benchmark
+enum Benchmark_Shape_Function{
+  TRANSLATION_ONLY=0,
+  AFFINE,
+  QUADRATIC
+};
+
+/// names of the benchmark shape functions
+const static char * benchmarkShapeFunctionStrings[] = {
+  "TRANSLATION_ONLY",
+  "AFFINE",
+  "QUADRATIC"
+};
+
+/// one workload of the benchmark
+struct Benchmark_Case{
+  int_t image_size;
+  int_t subset_size;
+  Benchmark_Shape_Function shape_function;
+  Interpolation_Method interpolation_method;
+  Optimization_Method optimization_method;
+};
+
+/// timings and solution quality of one workload
+struct Benchmark_Result{
+  int_t num_subsets;
+  int_t num_failed;
+  scalar_t time;
+  scalar_t subsets_per_second;
+  scalar_t iterations_per_subset;
+  scalar_t ns_per_pixel_iteration;
+  scalar_t avg_error;
+};
+
+/// run one workload num_repeats times and keep the fastest correlation
+Benchmark_Result run_case(const Benchmark_Case & bench_case,
+  const int_t num_repeats){
+  const int_t w = bench_case.image_size;
+  const int_t h = bench_case.image_size;
+  const scalar_t speckle_size = 5.0;
+  Teuchos::RCP<Teuchos::ParameterList> img_params = Teuchos::rcp(new Teuchos::ParameterList());
+  img_params->set(DICe::compute_image_gradients,true);
+  Teuchos::RCP<Image> ref_img = create_synthetic_speckle_image(w,h,0,0,speckle_size,img_params);
+  // two pixel amplitude over a period of half the image
+  SinCos_Image_Deformer deformer(w/2,2.0);
+  Teuchos::RCP<Image> def_img = deformer.deform_image(ref_img);
+
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  params->set(DICe::correlation_routine,DICe::GENERIC_ROUTINE);
+  params->set(DICe::initialization_method,DICe::USE_FIELD_VALUES);
+  params->set(DICe::interpolation_method,bench_case.interpolation_method);
+  params->set(DICe::optimization_method,bench_case.optimization_method);
+  params->set(DICe::enable_translation,true);
+  if(bench_case.shape_function==AFFINE){
+    params->set(DICe::enable_rotation,true);
+    params->set(DICe::enable_normal_strain,true);
+    params->set(DICe::enable_shear_strain,true);
+  }
+  else if(bench_case.shape_function==QUADRATIC){
+    params->set(DICe::enable_quadratic_shape_function,true);
+  }
+  const int_t step_size = bench_case.subset_size;
+
+  Benchmark_Result result;
+  result.time = std::numeric_limits<scalar_t>::max();
+  for(int_t repeat=0;repeat<num_repeats;++repeat){
+    Schema schema(w,h,step_size,step_size,bench_case.subset_size,params);
+    schema.set_ref_image(ref_img);
+    schema.set_def_image(def_img);
+    cpu_timer corr_timer;
+    corr_timer.start();
+    schema.execute_correlation();
+    corr_timer.stop();
+    const scalar_t time = (scalar_t)(corr_timer.elapsed().wall)/1000000000;
+    if(time>=result.time) continue;
+    result.time = time;
+    result.num_subsets = schema.local_num_subsets();
+    result.num_failed = 0;
+    scalar_t total_its = 0.0;
+    scalar_t total_error = 0.0;
+    for(int_t i=0;i<result.num_subsets;++i){
+      total_its += schema.local_field_value(i,DICe::field_enums::ITERATIONS_FS);
+      if(schema.local_field_value(i,DICe::field_enums::SIGMA_FS)<0.0){
+        result.num_failed++;
+        continue;
+      }
+      scalar_t error_x = 0.0;
+      scalar_t error_y = 0.0;
+      deformer.compute_displacement_error(schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_X_FS),
+        schema.local_field_value(i,DICe::field_enums::SUBSET_COORDINATES_Y_FS),
+        schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_X_FS),
+        schema.local_field_value(i,DICe::field_enums::SUBSET_DISPLACEMENT_Y_FS),
+        error_x,error_y,true,false);
+      total_error += std::sqrt(error_x + error_y);
+    }
+    const int_t num_passed = result.num_subsets - result.num_failed;
+    const scalar_t pixels_per_subset = bench_case.subset_size*bench_case.subset_size;
+    result.subsets_per_second = time > 0.0 ? result.num_subsets/time : 0.0;
+    result.iterations_per_subset = result.num_subsets > 0 ? total_its/result.num_subsets : 0.0;
+    result.ns_per_pixel_iteration = total_its > 0.0 ? time*1.0E9/(total_its*pixels_per_subset) : 0.0;
+    result.avg_error = num_passed > 0 ? total_error/num_passed : 0.0;
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  Teuchos::oblackholestream bhs; // outputs nothing
+  Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&bhs, false);
+  if(argc>1) // anything but the default cases, writes output to screen
+    outStream = Teuchos::rcp(&std::cout, false);
+
+  *outStream << "--- Begin performance test ---" << std::endl;
+
+  std::string results_file = "";
+  if(argc>1) results_file = argv[1];
+  int_t num_repeats = 3;
+  if(argc>2) num_repeats = std::strtol(argv[2],NULL,0);
+  bool full_sweep = false;
+  if(argc>3) full_sweep = std::strtol(argv[3],NULL,0)==1;
+  TEUCHOS_TEST_FOR_EXCEPTION(num_repeats<1,std::runtime_error,"Error, the number of repeats must be at least 1");
+  const bool write_json = results_file.size() > 5 && results_file.substr(results_file.size()-5)==".json";
+  const bool write_csv = results_file.size() > 4 && results_file.substr(results_file.size()-4)==".csv";
+  TEUCHOS_TEST_FOR_EXCEPTION(!results_file.empty()&&!write_json&&!write_csv,std::runtime_error,
+    "Error, the results file must end in .json or .csv: " << results_file);
+
+  // set up the workloads, the default sweep is small enough to run on every build
+  std::vector<int_t> image_sizes;
+  std::vector<int_t> subset_sizes;
+  std::vector<Benchmark_Shape_Function> shape_functions;
+  std::vector<Interpolation_Method> interpolation_methods;
+  std::vector<Optimization_Method> optimization_methods;
+  image_sizes.push_back(256);
+  subset_sizes.push_back(21);
+  shape_functions.push_back(AFFINE);
+  interpolation_methods.push_back(KEYS_FOURTH);
+  optimization_methods.push_back(GRADIENT_BASED);
+  optimization_methods.push_back(SIMPLEX);
+  if(full_sweep){
+    image_sizes.push_back(512);
+    image_sizes.push_back(1024);
+    subset_sizes.push_back(41);
+    shape_functions.push_back(TRANSLATION_ONLY);
+    shape_functions.push_back(QUADRATIC);
+    interpolation_methods.push_back(BILINEAR);
+    interpolation_methods.push_back(BICUBIC);
+  }
+  std::vector<Benchmark_Case> cases;
+  for(size_t i=0;i<image_sizes.size();++i)
+    for(size_t s=0;s<subset_sizes.size();++s)
+      for(size_t sf=0;sf<shape_functions.size();++sf)
+        for(size_t in=0;in<interpolation_methods.size();++in)
+          for(size_t opt=0;opt<optimization_methods.size();++opt){
+            Benchmark_Case bench_case;
+            bench_case.image_size = image_sizes[i];
+            bench_case.subset_size = subset_sizes[s];
+            bench_case.shape_function = shape_functions[sf];
+            bench_case.interpolation_method = interpolation_methods[in];
+            bench_case.optimization_method = optimization_methods[opt];
+            cases.push_back(bench_case);
+          }
+  *outStream << "number of workloads:      " << cases.size() << std::endl;
+  *outStream << "number of repeats:        " << num_repeats << " (the fastest is reported)" << std::endl;
+
+  std::vector<Benchmark_Result> results(cases.size());
+  for(size_t i=0;i<cases.size();++i){
+    results[i] = run_case(cases[i],num_repeats);
+    *outStream << "image " << cases[i].image_size << " subset " << cases[i].subset_size <<
+        " " << benchmarkShapeFunctionStrings[cases[i].shape_function] <<
+        " " << interpolationMethodStrings[cases[i].interpolation_method] <<
+        " " << optimizationMethodStrings[cases[i].optimization_method] <<
+        ": subsets/s " << results[i].subsets_per_second <<
+        " its/subset " << results[i].iterations_per_subset <<
+        " ns/pixel-it " << results[i].ns_per_pixel_iteration <<
+        " failed " << results[i].num_failed << "/" << results[i].num_subsets <<
+        " avg error " << results[i].avg_error << std::endl;
+  }
+
+  if(!results_file.empty()){
+    *outStream << "writing results to " << results_file << std::endl;
+    std::ofstream out(results_file.c_str());
+    TEUCHOS_TEST_FOR_EXCEPTION(!out.good(),std::runtime_error,"Error, could not open results file " << results_file);
+    if(write_csv)
+      out << "image_size,subset_size,shape_function,interpolation_method,optimization_method,num_subsets,num_failed,"
+          "time,subsets_per_second,iterations_per_subset,ns_per_pixel_iteration,avg_error" << std::endl;
+    else
+      out << "[" << std::endl;
+    for(size_t i=0;i<cases.size();++i){
+      const Benchmark_Case & c = cases[i];
+      const Benchmark_Result & r = results[i];
+      if(write_csv){
+        out << c.image_size << "," << c.subset_size << "," << benchmarkShapeFunctionStrings[c.shape_function] << ","
+            << interpolationMethodStrings[c.interpolation_method] << "," << optimizationMethodStrings[c.optimization_method] << ","
+            << r.num_subsets << "," << r.num_failed << "," << r.time << "," << r.subsets_per_second << ","
+            << r.iterations_per_subset << "," << r.ns_per_pixel_iteration << "," << r.avg_error << std::endl;
+      }
+      else{
+        out << "  {\"image_size\": " << c.image_size << ", \"subset_size\": " << c.subset_size
+            << ", \"shape_function\": \"" << benchmarkShapeFunctionStrings[c.shape_function]
+            << "\", \"interpolation_method\": \"" << interpolationMethodStrings[c.interpolation_method]
+            << "\", \"optimization_method\": \"" << optimizationMethodStrings[c.optimization_method]
+            << "\", \"num_subsets\": " << r.num_subsets << ", \"num_failed\": " << r.num_failed
+            << ", \"time\": " << r.time << ", \"subsets_per_second\": " << r.subsets_per_second
+            << ", \"iterations_per_subset\": " << r.iterations_per_subset
+            << ", \"ns_per_pixel_iteration\": " << r.ns_per_pixel_iteration
+            << ", \"avg_error\": " << r.avg_error << "}" << (i+1<cases.size() ? "," : "") << std::endl;
+      }
+    }
+    if(write_json)
+      out << "]" << std::endl;
+    out.close();
+  }
+
+  *outStream << "--- End performance test ---" << std::endl;
+
+  DICe::finalize();
+
+  return 0;
+}
@@ -0,0 +1,196 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_FFT.h>
+#include <DICe_Image.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+
+#include <boost/timer/timer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace DICe;
+using namespace boost::timer;
+
+/// reference 2d transform that allocates the kiss_fft configurations and
+/// buffers on every call and transforms one column at a time (the original implementation)
+void reference_fft(const int_t w,
+  const int_t h,
+  Teuchos::ArrayRCP<scalar_t> & real,
+  Teuchos::ArrayRCP<scalar_t> & complex){
+  kiss_fft_cpx * img_row = new kiss_fft_cpx[w];
+  kiss_fft_cpx * img_col = new kiss_fft_cpx[h];
+  kiss_fft_cfg cfg_ffx = kiss_fft_alloc(w,0,0,0);
+  kiss_fft_cfg cfg_ffy = kiss_fft_alloc(h,0,0,0);
+  for(int_t y=0;y<h;++y){
+    for(int_t x=0;x<w;++x){
+      img_row[x].r=real[y*w+x];
+      img_row[x].i=complex[y*w+x];
+    }
+    kiss_fft(cfg_ffx,img_row,img_row);
+    for(int_t x=0;x<w;++x){
+      real[y*w+x] = img_row[x].r;
+      complex[y*w+x] = img_row[x].i;
+    }
+  }
+  for(int_t x=0;x<w;++x){
+    for(int_t y=0;y<h;++y){
+      img_col[y].r=real[y*w+x];
+      img_col[y].i=complex[y*w+x];
+    }
+    kiss_fft(cfg_ffy,img_col,img_col);
+    for(int_t y=0;y<h;++y){
+      real[y*w+x] = img_col[y].r;
+      complex[y*w+x] = img_col[y].i;
+    }
+  }
+  free(cfg_ffx);
+  free(cfg_ffy);
+  delete[] img_row;
+  delete[] img_col;
+}
+
+int main(int argc, char *argv[]) {
+
+  if(argc!=5){
+    std::cerr << "Usage: DICe_PerformanceFFT <width> <height> <num_reps> <1 or 0>, (1=verbose)" << std::endl;
+    return 1;
+  }
+
+  DICe::initialize(argc, argv);
+
+  Teuchos::RCP<std::ostream> outStream;
+  Teuchos::oblackholestream bhs; // outputs nothing
+  if (std::strtol(argv[4],NULL,0) == 1)
+    outStream = Teuchos::rcp(&std::cout, false);
+  else
+    outStream = Teuchos::rcp(&bhs, false);
+
+  *outStream << "--- Begin performance test ---" << std::endl;
+
+  const int_t w = std::strtol(argv[1],NULL,0);
+  const int_t h = std::strtol(argv[2],NULL,0);
+  const int_t num_reps = std::strtol(argv[3],NULL,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(w<2||h<2||num_reps<1,std::runtime_error,"Error, invalid arguments");
+  int_t num_threads = 1;
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+  *outStream << "image size:        " << w << " x " << h << std::endl;
+  *outStream << "repetitions:       " << num_reps << std::endl;
+  *outStream << "fft backend:       " << fft_backend() << std::endl;
+  *outStream << "threads:           " << num_threads << std::endl;
+
+  // synthetic speckle-like pattern
+  Teuchos::ArrayRCP<intensity_t> intens(w*h,0.0);
+  for(int_t y=0;y<h;++y)
+    for(int_t x=0;x<w;++x)
+      intens[y*w+x] = 128.0 + 60.0*std::sin(0.21*x)*std::cos(0.13*y) + 40.0*std::sin(0.057*(x+2*y));
+  Teuchos::RCP<Image> image = Teuchos::rcp(new Image(w,h,intens));
+  Teuchos::RCP<Image> image_shifted = Teuchos::rcp(new Image(w,h,intens));
+  Teuchos::ArrayRCP<intensity_t> shifted_intens = image_shifted->intensities();
+  for(int_t y=0;y<h;++y)
+    for(int_t x=0;x<w;++x)
+      shifted_intens[y*w+x] = intens[y*w+std::min(x+3,w-1)];
+
+  Teuchos::ArrayRCP<scalar_t> ref_r(w*h,0.0),ref_i(w*h,0.0);
+  cpu_timer reference_timer;
+  for(int_t rep=0;rep<num_reps;++rep){
+    if(rep>0) reference_timer.resume();
+    for(int_t i=0;i<w*h;++i){
+      ref_r[i] = intens[i];
+      ref_i[i] = 0.0;
+    }
+    reference_fft(w,h,ref_r,ref_i);
+    reference_timer.stop();
+  }
+
+  Teuchos::ArrayRCP<scalar_t> fft_r,fft_i;
+  cpu_timer serial_timer;
+  for(int_t rep=0;rep<num_reps;++rep){
+    if(rep>0) serial_timer.resume();
+    image_fft(image,fft_r,fft_i,0,false,1);
+    serial_timer.stop();
+  }
+  scalar_t max_diff = 0.0;
+  scalar_t max_value = 0.0;
+  for(int_t i=0;i<w*h;++i){
+    max_diff = std::max(max_diff,std::max(std::abs(fft_r[i]-ref_r[i]),std::abs(fft_i[i]-ref_i[i])));
+    max_value = std::max(max_value,std::abs(ref_r[i]));
+  }
+
+  cpu_timer threaded_timer;
+  for(int_t rep=0;rep<num_reps;++rep){
+    if(rep>0) threaded_timer.resume();
+    image_fft(image,fft_r,fft_i,0,false,num_threads);
+    threaded_timer.stop();
+  }
+
+  scalar_t u_x = 0.0, u_y = 0.0;
+  cpu_timer phase_timer;
+  for(int_t rep=0;rep<num_reps;++rep){
+    if(rep>0) phase_timer.resume();
+    phase_correlate_x_y(image,image_shifted,u_x,u_y,false,num_threads);
+    phase_timer.stop();
+  }
+
+  *outStream << "max diff from the reference fft " << max_diff << " (max value " << max_value << ")" << std::endl;
+  *outStream << "phase correlation displacement " << u_x << " " << u_y << std::endl;
+  *outStream << "** reference kiss_fft time" << reference_timer.format();
+  *outStream << "** image_fft serial time" << serial_timer.format();
+  *outStream << "** image_fft threaded time" << threaded_timer.format();
+  *outStream << "** phase_correlate_x_y time" << phase_timer.format();
+
+  *outStream << "--- End performance test ---" << std::endl;
+
+  DICe::finalize();
+
+  return 0;
+}
@@ -50,13 +50,83 @@
 
 #include <boost/timer/timer.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
+#include <string>
+#include <vector>
 
 using namespace DICe;
 using namespace boost::timer;
 
 // Usage DICe_PerformanceFunctors [<num_image_sizes> <num_time_samples> <num_thread_teams>]
 
+/// names of the subset level kernels timed in the subset size sweep
+const static char * subsetKernelStrings[] = {
+  "init bilinear",
+  "init keys",
+  "mean",
+  "gamma"
+};
+const static int_t num_subset_kernels = 4;
+
+/// serial reference for the subset initialization: map each pixel and interpolate it from the image
+void host_subset_init(Teuchos::RCP<Subset> subset,
+  Teuchos::RCP<Image> img,
+  Teuchos::RCP<Local_Shape_Function> map,
+  const Interpolation_Method interp,
+  std::vector<intensity_t> & values){
+  const scalar_t cx = subset->centroid_x();
+  const scalar_t cy = subset->centroid_y();
+  scalar_t mapped_x = 0.0;
+  scalar_t mapped_y = 0.0;
+  for(int_t i=0;i<subset->num_pixels();++i){
+    map->map(subset->x(i),subset->y(i),cx,cy,mapped_x,mapped_y);
+    values[i] = interp==BILINEAR ? img->interpolate_bilinear(mapped_x,mapped_y) : img->interpolate_keys_fourth(mapped_x,mapped_y);
+  }
+}
+
+/// serial reference for the mean and the sum of the intensities minus the mean
+scalar_t host_subset_mean(Teuchos::RCP<Subset> subset,
+  const std::vector<intensity_t> & values,
+  scalar_t & sum){
+  scalar_t mean = 0.0;
+  int_t num_active = 0;
+  for(int_t i=0;i<subset->num_pixels();++i){
+    if(subset->is_active(i)&!subset->is_deactivated_this_step(i)){
+      mean += values[i];
+      num_active++;
+    }
+  }
+  mean = num_active > 0 ? mean/num_active : 0.0;
+  sum = 0.0;
+  for(int_t i=0;i<subset->num_pixels();++i)
+    if(subset->is_active(i)&!subset->is_deactivated_this_step(i))
+      sum += (values[i]-mean)*(values[i]-mean);
+  sum = std::sqrt(sum);
+  return mean;
+}
+
+/// serial reference for the ZNSSD gamma value
+scalar_t host_subset_gamma(Teuchos::RCP<Subset> subset,
+  const std::vector<intensity_t> & ref_values,
+  const std::vector<intensity_t> & def_values){
+  scalar_t mean_sum_r = 0.0;
+  scalar_t mean_sum_d = 0.0;
+  const scalar_t mean_r = host_subset_mean(subset,ref_values,mean_sum_r);
+  const scalar_t mean_d = host_subset_mean(subset,def_values,mean_sum_d);
+  if(mean_sum_r==0.0||mean_sum_d==0.0) return -1.0;
+  scalar_t gamma = 0.0;
+  for(int_t i=0;i<subset->num_pixels();++i){
+    if(subset->is_active(i)&!subset->is_deactivated_this_step(i)){
+      const scalar_t value = (def_values[i]-mean_d)/mean_sum_d - (ref_values[i]-mean_r)/mean_sum_r;
+      gamma += value*value;
+    }
+  }
+  return gamma;
+}
+
 int main(int argc, char *argv[]) {
 
   DICe::initialize(argc, argv);
@@ -279,6 +349,93 @@ int main(int argc, char *argv[]) {
         std::endl;
   }
 
+  // time the subset level kernels over a range of subset sizes, the subset methods use the
+  // Kokkos functors on the default execution space and are compared to serial host loops
+  // to find the subset size above which the functors are faster
+  *outStream << "\n\nSubset kernel sweep: " << std::endl;
+#if DICE_KOKKOS
+  *outStream << "functor execution space:  " << device_space::name() << std::endl;
+#else
+  *outStream << "Kokkos is not enabled, the subset methods are also serial so no crossover is expected" << std::endl;
+#endif
+  Teuchos::RCP<Image> sweep_img = Teuchos::rcp(new Image(file_name.c_str()));
+  std::vector<int_t> subset_sizes;
+  for(int_t size=11;size<=321&&size+2*subset_edge_buffer<std::min(width,height);size=2*size-1)
+    subset_sizes.push_back(size);
+  // the kernels are repeated so that each timing covers at least this many pixels
+  const int_t min_pixels_per_timing = 1000000;
+  std::vector<std::vector<scalar_t> > functor_times(num_subset_kernels,std::vector<scalar_t>(subset_sizes.size(),0.0));
+  std::vector<std::vector<scalar_t> > host_times(num_subset_kernels,std::vector<scalar_t>(subset_sizes.size(),0.0));
+  scalar_t check_sum = 0.0;
+  for(size_t size_it=0;size_it<subset_sizes.size();++size_it){
+    const int_t size = subset_sizes[size_it];
+    Teuchos::RCP<Subset> sweep_subset = Teuchos::rcp(new Subset(width/2,height/2,size,size));
+    sweep_subset->initialize(sweep_img);
+    const int_t num_pixels = sweep_subset->num_pixels();
+    const int_t num_reps = std::max(1,min_pixels_per_timing/num_pixels);
+    std::vector<intensity_t> ref_values(num_pixels,0.0);
+    std::vector<intensity_t> def_values(num_pixels,0.0);
+    for(int_t i=0;i<num_pixels;++i)
+      ref_values[i] = sweep_subset->ref_intensities(i);
+    for(int_t kernel=0;kernel<num_subset_kernels;++kernel){
+      const Interpolation_Method interp = kernel==1 ? KEYS_FOURTH : BILINEAR;
+      for(int_t time_sample=0;time_sample<num_time_samples;++time_sample){
+        cpu_timer functor_timer;
+        for(int_t rep=0;rep<num_reps;++rep){
+          if(kernel<2)
+            sweep_subset->initialize(sweep_img,DEF_INTENSITIES,map,interp);
+          else if(kernel==2)
+            check_sum += sweep_subset->mean(REF_INTENSITIES);
+          else
+            check_sum += sweep_subset->gamma();
+        }
+#if DICE_KOKKOS
+        Kokkos::fence();
+#endif
+        functor_timer.stop();
+        cpu_timer host_timer;
+        for(int_t rep=0;rep<num_reps;++rep){
+          if(kernel<2)
+            host_subset_init(sweep_subset,sweep_img,map,interp,def_values);
+          else if(kernel==2){
+            scalar_t sum = 0.0;
+            check_sum += host_subset_mean(sweep_subset,ref_values,sum);
+          }
+          else
+            check_sum += host_subset_gamma(sweep_subset,ref_values,def_values);
+        }
+        host_timer.stop();
+        // the time per call
+        functor_times[kernel][size_it] += ((scalar_t)(functor_timer.elapsed().wall)/1000000000)/(num_time_samples*num_reps);
+        host_times[kernel][size_it] += ((scalar_t)(host_timer.elapsed().wall)/1000000000)/(num_time_samples*num_reps);
+      }
+    }
+  }
+  *outStream << "(check sum " << check_sum << ")" << std::endl;
+  *outStream << std::setw(15) << "subset size" << std::setw(15) << "pixels";
+  for(int_t kernel=0;kernel<num_subset_kernels;++kernel)
+    *outStream << std::setw(22) << std::string(subsetKernelStrings[kernel]) + " functor" << std::setw(22) << std::string(subsetKernelStrings[kernel]) + " host";
+  *outStream << std::endl;
+  for(size_t size_it=0;size_it<subset_sizes.size();++size_it){
+    *outStream << std::setw(15) << subset_sizes[size_it] << std::setw(15) << subset_sizes[size_it]*subset_sizes[size_it];
+    for(int_t kernel=0;kernel<num_subset_kernels;++kernel)
+      *outStream << std::setw(22) << functor_times[kernel][size_it] << std::setw(22) << host_times[kernel][size_it];
+    *outStream << std::endl;
+  }
+  // the crossover is the smallest subset size from which the functors stay faster than the host loops
+  for(int_t kernel=0;kernel<num_subset_kernels;++kernel){
+    int_t crossover = -1;
+    for(int_t size_it=subset_sizes.size()-1;size_it>=0;--size_it){
+      if(functor_times[kernel][size_it]>=host_times[kernel][size_it]) break;
+      crossover = subset_sizes[size_it];
+    }
+    *outStream << "crossover for " << std::setw(15) << subsetKernelStrings[kernel] << ": ";
+    if(crossover>0)
+      *outStream << "functors are faster for subsets of size " << crossover << " and larger" << std::endl;
+    else
+      *outStream << "functors are not faster for any of the subset sizes" << std::endl;
+  }
+
   std::cout << "End Result: TEST PASSED\n";
 
   *outStream << "--- End performance test ---" << std::endl;
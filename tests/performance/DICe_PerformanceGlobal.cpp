@@ -0,0 +1,266 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#ifdef DICE_ENABLE_GLOBAL
+  #include <DICe_Global.h>
+  #include <DICe_ParameterUtilities.h>
+#endif
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <boost/timer/timer.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace DICe;
+using namespace boost::timer;
+
+// Usage DICe_PerformanceGlobal [<results_file (.json or .csv)> [<num_repeats> [<1: full sweep>]]]
+//
+// Times Global_Algorithm::execute() for the method of manufactured solutions problems over a
+// range of mesh sizes. The assembly, preconditioner and Belos solve times are reported along with
+// the MMS error so that changes to global DIC can be checked for speed and accuracy together.
+
+#ifdef DICE_ENABLE_GLOBAL
+
+/// one workload of the benchmark
+struct Benchmark_Case{
+  std::string problem_name;
+  Global_Formulation formulation;
+  scalar_t alpha;
+  scalar_t mesh_size;
+};
+
+/// timings and error of one workload
+struct Benchmark_Result{
+  int_t num_nodes;
+  int_t nonlinear_iterations;
+  int_t linear_iterations;
+  scalar_t setup_time;
+  scalar_t assembly_time;
+  scalar_t preconditioner_time;
+  scalar_t solve_time;
+  scalar_t total_time;
+  scalar_t error_x;
+  scalar_t error_y;
+  scalar_t error_lambda;
+};
+
+/// run one workload num_repeats times and keep the fastest execution
+Benchmark_Result run_case(const Benchmark_Case & bench_case,
+  const int_t num_repeats){
+  Teuchos::RCP<Teuchos::ParameterList> global_params = Teuchos::rcp(new Teuchos::ParameterList());
+  global_params->set(DICe::global_solver,GMRES_SOLVER);
+  global_params->set(DICe::output_folder,"");
+  global_params->set(DICe::output_prefix,"performance_global");
+  global_params->set(DICe::mesh_size,bench_case.mesh_size);
+  global_params->set(DICe::global_element_type,"TRI6");
+  global_params->set(DICe::global_regularization_alpha,bench_case.alpha);
+  global_params->set(DICe::global_formulation,bench_case.formulation);
+  Teuchos::ParameterList mms_sublist;
+  mms_sublist.set(DICe::problem_name,bench_case.problem_name);
+  mms_sublist.set(DICe::phi_coeff,10.0);
+  // the settings below follow the component tests of each problem
+  if(bench_case.problem_name=="patch_test"){
+    mms_sublist.set(DICe::parser_displacement,5.0);
+  }
+  else{
+    global_params->set(DICe::global_stabilization_tau,0.0);
+    global_params->set(DICe::parser_use_regular_grid,true);
+    if(bench_case.problem_name=="div_curl_modulator"){
+      mms_sublist.set(DICe::b_coeff,2.0);
+      global_params->set(DICe::parser_enforce_lagrange_bc,true);
+      global_params->set(DICe::num_image_integration_points,75);
+    }
+    else{
+      mms_sublist.set(DICe::b_coeff,bench_case.alpha);
+      mms_sublist.set(DICe::parser_enforce_lagrange_bc,true);
+    }
+  }
+  global_params->set(DICe::mms_spec,mms_sublist);
+
+  Benchmark_Result result;
+  result.total_time = std::numeric_limits<scalar_t>::max();
+  for(int_t repeat=0;repeat<num_repeats;++repeat){
+    cpu_timer setup_timer;
+    Teuchos::RCP<DICe::global::Global_Algorithm> global_alg = Teuchos::rcp(new DICe::global::Global_Algorithm(global_params));
+    setup_timer.stop();
+    cpu_timer timer;
+    global_alg->execute();
+    timer.stop();
+    const scalar_t total_time = timer.elapsed().wall*1.0E-9;
+    if(total_time >= result.total_time) continue;
+    result.total_time = total_time;
+    result.setup_time = setup_timer.elapsed().wall*1.0E-9;
+    result.num_nodes = global_alg->mesh()->get_scalar_node_dist_map()->get_num_global_elements();
+    result.nonlinear_iterations = global_alg->num_nonlinear_iterations();
+    result.linear_iterations = global_alg->total_linear_iterations();
+    result.assembly_time = global_alg->assembly_time();
+    result.preconditioner_time = global_alg->preconditioner_time();
+    result.solve_time = global_alg->linear_solve_time();
+    scalar_t max_error_x = 0.0;
+    scalar_t max_error_y = 0.0;
+    scalar_t max_error_lambda = 0.0;
+    result.error_x = 0.0;
+    result.error_y = 0.0;
+    result.error_lambda = 0.0;
+    global_alg->evaluate_mms_error(result.error_x,result.error_y,result.error_lambda,max_error_x,max_error_y,max_error_lambda);
+  }
+  return result;
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  Teuchos::oblackholestream bhs; // outputs nothing
+  Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&bhs, false);
+  if(argc>1) // anything but the default cases, writes output to screen
+    outStream = Teuchos::rcp(&std::cout, false);
+
+  *outStream << "--- Begin performance test ---" << std::endl;
+
+#ifdef DICE_ENABLE_GLOBAL
+  std::string results_file = "";
+  if(argc>1) results_file = argv[1];
+  int_t num_repeats = 3;
+  if(argc>2) num_repeats = std::strtol(argv[2],NULL,0);
+  bool full_sweep = false;
+  if(argc>3) full_sweep = std::strtol(argv[3],NULL,0)==1;
+  TEUCHOS_TEST_FOR_EXCEPTION(num_repeats<1,std::runtime_error,"Error, the number of repeats must be at least 1");
+  const bool write_json = results_file.size() > 5 && results_file.substr(results_file.size()-5)==".json";
+  const bool write_csv = results_file.size() > 4 && results_file.substr(results_file.size()-4)==".csv";
+  TEUCHOS_TEST_FOR_EXCEPTION(!results_file.empty()&&!write_json&&!write_csv,std::runtime_error,
+    "Error, the results file must end in .json or .csv: " << results_file);
+
+  // set up the workloads, the mesh size is the max element area
+  std::vector<Benchmark_Case> problems;
+  Benchmark_Case problem;
+  problem.problem_name = "patch_test"; problem.formulation = HORN_SCHUNCK; problem.alpha = 1.0;
+  problems.push_back(problem);
+  problem.problem_name = "simple_hs"; problem.formulation = HORN_SCHUNCK; problem.alpha = 1.0;
+  problems.push_back(problem);
+  problem.problem_name = "simple_hs_mixed"; problem.formulation = MIXED_HORN_SCHUNCK; problem.alpha = 1.0;
+  problems.push_back(problem);
+  problem.problem_name = "simple_lm_mixed"; problem.formulation = LEHOUCQ_TURNER; problem.alpha = 1.0;
+  problems.push_back(problem);
+  problem.problem_name = "div_curl_modulator"; problem.formulation = HORN_SCHUNCK; problem.alpha = 1.0;
+  problems.push_back(problem);
+  std::vector<scalar_t> mesh_sizes;
+  mesh_sizes.push_back(100.0);
+  mesh_sizes.push_back(25.0);
+  if(full_sweep){
+    mesh_sizes.push_back(10.0);
+    mesh_sizes.push_back(5.0);
+  }
+  std::vector<Benchmark_Case> cases;
+  for(size_t p=0;p<problems.size();++p){
+    for(size_t m=0;m<mesh_sizes.size();++m){
+      Benchmark_Case bench_case = problems[p];
+      bench_case.mesh_size = mesh_sizes[m];
+      cases.push_back(bench_case);
+    }
+  }
+  *outStream << "number of workloads:      " << cases.size() << std::endl;
+  *outStream << "number of repeats:        " << num_repeats << " (the fastest is reported)" << std::endl;
+
+  std::vector<Benchmark_Result> results(cases.size());
+  for(size_t i=0;i<cases.size();++i){
+    results[i] = run_case(cases[i],num_repeats);
+    *outStream << cases[i].problem_name << " " << to_string(cases[i].formulation) << " mesh size " << cases[i].mesh_size <<
+        " nodes " << results[i].num_nodes << ": total " << results[i].total_time << " s assembly " << results[i].assembly_time <<
+        " s preconditioner " << results[i].preconditioner_time << " s solve " << results[i].solve_time <<
+        " s (" << results[i].linear_iterations << " linear its in " << results[i].nonlinear_iterations << " nonlinear its)" <<
+        " error x " << results[i].error_x << " y " << results[i].error_y << " lambda " << results[i].error_lambda << std::endl;
+  }
+
+  if(!results_file.empty()){
+    *outStream << "writing results to " << results_file << std::endl;
+    std::ofstream out(results_file.c_str());
+    TEUCHOS_TEST_FOR_EXCEPTION(!out.good(),std::runtime_error,"Error, could not open results file " << results_file);
+    if(write_csv)
+      out << "problem,formulation,mesh_size,num_nodes,nonlinear_iterations,linear_iterations,setup_time,assembly_time,"
+          "preconditioner_time,solve_time,total_time,error_x,error_y,error_lambda" << std::endl;
+    else
+      out << "[" << std::endl;
+    for(size_t i=0;i<cases.size();++i){
+      const Benchmark_Case & c = cases[i];
+      const Benchmark_Result & r = results[i];
+      if(write_csv){
+        out << c.problem_name << "," << to_string(c.formulation) << "," << c.mesh_size << "," << r.num_nodes << ","
+            << r.nonlinear_iterations << "," << r.linear_iterations << "," << r.setup_time << "," << r.assembly_time << ","
+            << r.preconditioner_time << "," << r.solve_time << "," << r.total_time << "," << r.error_x << ","
+            << r.error_y << "," << r.error_lambda << std::endl;
+      }
+      else{
+        out << "  {\"problem\": \"" << c.problem_name << "\", \"formulation\": \"" << to_string(c.formulation)
+            << "\", \"mesh_size\": " << c.mesh_size << ", \"num_nodes\": " << r.num_nodes
+            << ", \"nonlinear_iterations\": " << r.nonlinear_iterations << ", \"linear_iterations\": " << r.linear_iterations
+            << ", \"setup_time\": " << r.setup_time << ", \"assembly_time\": " << r.assembly_time
+            << ", \"preconditioner_time\": " << r.preconditioner_time << ", \"solve_time\": " << r.solve_time
+            << ", \"total_time\": " << r.total_time << ", \"error_x\": " << r.error_x << ", \"error_y\": " << r.error_y
+            << ", \"error_lambda\": " << r.error_lambda << "}" << (i+1<cases.size() ? "," : "") << std::endl;
+      }
+    }
+    if(write_json)
+      out << "]" << std::endl;
+    out.close();
+  }
+#else
+  *outStream << "global DIC is not enabled, nothing to time" << std::endl;
+#endif
+
+  *outStream << "--- End performance test ---" << std::endl;
+
+  DICe::finalize();
+
+  return 0;
+}
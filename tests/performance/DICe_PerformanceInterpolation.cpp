@@ -0,0 +1,346 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Image.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_ArrayRCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <boost/timer/timer.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DICe;
+using namespace boost::timer;
+
+// Usage DICe_PerformanceInterpolation [<results_file (.json or .csv)> [<num_repeats> [<1: full sweep>]]]
+//
+// Times the image interpolants for the intensity alone and the intensity plus gradients, either one
+// point at a time through the single point methods or through Image::batch_interpolate. The sample
+// points are either scattered randomly over the image or ordered the way a deformed subset is read.
+// The reported bandwidth counts the values in each stencil (not cache traffic), so it can be compared
+// to the memory bandwidth of the machine once the image no longer fits in cache.
+
+/// order in which the sample points are visited
+enum Access_Pattern{
+  RANDOM_ACCESS=0,
+  SUBSET_ACCESS
+};
+
+/// names of the access patterns
+const static char * accessPatternStrings[] = {
+  "RANDOM",
+  "SUBSET"
+};
+
+/// one workload of the benchmark
+struct Benchmark_Case{
+  int_t image_size;
+  Interpolation_Method interpolation_method;
+  Access_Pattern access_pattern;
+  bool gradients;
+  bool batched;
+};
+
+/// timings of one workload
+struct Benchmark_Result{
+  int_t num_samples;
+  scalar_t time;
+  scalar_t ns_per_sample;
+  scalar_t bytes_per_sample;
+  scalar_t bandwidth;
+  scalar_t checksum;
+};
+
+/// width of the interpolation stencil in pixels
+int_t stencil_width(const Interpolation_Method method){
+  switch(method){
+  case BILINEAR: return 2;
+  case BICUBIC: return 4;
+  case KEYS_FOURTH: return 6;
+  case CUBIC_BSPLINE: return 4;
+  case QUINTIC_BSPLINE: return 6;
+  default: break;
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, unknown interpolation method");
+  return 0;
+}
+
+/// create an image with a speckle-like pattern made of a few superimposed waves
+Teuchos::RCP<Image> create_image(const int_t size){
+  Teuchos::ArrayRCP<intensity_t> intensities(size*size,0.0);
+  for(int_t y=0;y<size;++y){
+    for(int_t x=0;x<size;++x){
+      intensities[y*size+x] = 128.0 + 40.0*std::sin(0.9*x)*std::cos(1.1*y) + 30.0*std::sin(0.37*x+0.53*y)
+        + 20.0*std::cos(0.21*x-0.77*y);
+    }
+  }
+  Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+  params->set(DICe::compute_image_gradients,true);
+  return Teuchos::rcp(new Image(size,size,intensities,params));
+}
+
+/// fill the sample coordinates for the given access pattern
+void create_samples(const int_t image_size,
+  const Access_Pattern pattern,
+  const int_t num_samples,
+  std::vector<scalar_t> & local_x,
+  std::vector<scalar_t> & local_y){
+  local_x.resize(num_samples);
+  local_y.resize(num_samples);
+  // stay away from the border where the interpolants fall back to bilinear
+  const scalar_t margin = 5.0;
+  const scalar_t extent = image_size - 2.0*margin - 1.0;
+  std::mt19937 eng(1234);
+  std::uniform_real_distribution<scalar_t> distr(0.0,1.0);
+  if(pattern==RANDOM_ACCESS){
+    for(int_t i=0;i<num_samples;++i){
+      local_x[i] = margin + distr(eng)*extent;
+      local_y[i] = margin + distr(eng)*extent;
+    }
+    return;
+  }
+  // subsets are read row by row with a small sub-pixel affine warp, the subset
+  // centers are scattered over the image like the subsets of an analysis
+  const int_t subset_size = 41;
+  const scalar_t center_extent = extent - subset_size - 4.0;
+  int_t i = 0;
+  while(i<num_samples){
+    const scalar_t cx = margin + 0.5*subset_size + 2.0 + distr(eng)*center_extent;
+    const scalar_t cy = margin + 0.5*subset_size + 2.0 + distr(eng)*center_extent;
+    const scalar_t u = distr(eng) - 0.5;
+    const scalar_t v = distr(eng) - 0.5;
+    const scalar_t du = 0.02*(distr(eng) - 0.5);
+    const scalar_t dv = 0.02*(distr(eng) - 0.5);
+    for(int_t sy=0;sy<subset_size&&i<num_samples;++sy){
+      for(int_t sx=0;sx<subset_size&&i<num_samples;++sx,++i){
+        const scalar_t dx = sx - subset_size/2;
+        const scalar_t dy = sy - subset_size/2;
+        local_x[i] = cx + dx + u + du*dx;
+        local_y[i] = cy + dy + v + dv*dy;
+      }
+    }
+  }
+}
+
+/// interpolate all the samples num_repeats times and keep the fastest pass
+Benchmark_Result run_case(const Benchmark_Case & bench_case,
+  Teuchos::RCP<Image> image,
+  const std::vector<scalar_t> & local_x,
+  const std::vector<scalar_t> & local_y,
+  const int_t num_repeats){
+  const int_t num_samples = local_x.size();
+  const Interpolation_Method method = bench_case.interpolation_method;
+  std::vector<intensity_t> values(num_samples,0.0);
+  std::vector<scalar_t> grad_x(num_samples,0.0);
+  std::vector<scalar_t> grad_y(num_samples,0.0);
+  // the spline coefficients are computed once per image so they are not part of the timing
+  if(method==CUBIC_BSPLINE) image->compute_bspline_coefficients(3);
+  if(method==QUINTIC_BSPLINE) image->compute_bspline_coefficients(5);
+  scalar_t best_time = std::numeric_limits<scalar_t>::max();
+  for(int_t repeat=0;repeat<num_repeats;++repeat){
+    cpu_timer timer;
+    if(bench_case.batched){
+      image->batch_interpolate(num_samples,&local_x[0],&local_y[0],&values[0],
+        bench_case.gradients ? &grad_x[0] : NULL,bench_case.gradients ? &grad_y[0] : NULL,method);
+    }
+    else if(method==BILINEAR){
+      for(int_t i=0;i<num_samples;++i){
+        values[i] = image->interpolate_bilinear(local_x[i],local_y[i]);
+        if(bench_case.gradients){
+          grad_x[i] = image->interpolate_grad_x_bilinear(local_x[i],local_y[i]);
+          grad_y[i] = image->interpolate_grad_y_bilinear(local_x[i],local_y[i]);
+        }
+      }
+    }
+    else if(method==BICUBIC){
+      for(int_t i=0;i<num_samples;++i){
+        values[i] = image->interpolate_bicubic(local_x[i],local_y[i]);
+        if(bench_case.gradients){
+          grad_x[i] = image->interpolate_grad_x_bicubic(local_x[i],local_y[i]);
+          grad_y[i] = image->interpolate_grad_y_bicubic(local_x[i],local_y[i]);
+        }
+      }
+    }
+    else if(method==KEYS_FOURTH){
+      for(int_t i=0;i<num_samples;++i){
+        values[i] = image->interpolate_keys_fourth(local_x[i],local_y[i]);
+        if(bench_case.gradients){
+          grad_x[i] = image->interpolate_grad_x_keys_fourth(local_x[i],local_y[i]);
+          grad_y[i] = image->interpolate_grad_y_keys_fourth(local_x[i],local_y[i]);
+        }
+      }
+    }
+    timer.stop();
+    best_time = std::min(best_time,static_cast<scalar_t>(timer.elapsed().wall*1.0E-9));
+  }
+  Benchmark_Result result;
+  result.num_samples = num_samples;
+  result.time = best_time;
+  result.ns_per_sample = best_time*1.0E9/num_samples;
+  // the splines read only the coefficient image, the other interpolants also read the gradient images
+  const int_t stencil = stencil_width(method);
+  const int_t num_arrays = bench_case.gradients && method!=CUBIC_BSPLINE && method!=QUINTIC_BSPLINE ? 3 : 1;
+  result.bytes_per_sample = stencil*stencil*num_arrays*sizeof(scalar_t);
+  result.bandwidth = best_time > 0.0 ? result.bytes_per_sample*num_samples/best_time*1.0E-9 : 0.0;
+  // keeps the compiler from dropping the interpolation
+  result.checksum = 0.0;
+  for(int_t i=0;i<num_samples;++i)
+    result.checksum += values[i] + grad_x[i] + grad_y[i];
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  // only print output if args are given (for testing the output is quiet)
+  Teuchos::oblackholestream bhs; // outputs nothing
+  Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&bhs, false);
+  if(argc>1) // anything but the default cases, writes output to screen
+    outStream = Teuchos::rcp(&std::cout, false);
+
+  *outStream << "--- Begin performance test ---" << std::endl;
+
+  std::string results_file = "";
+  if(argc>1) results_file = argv[1];
+  int_t num_repeats = 3;
+  if(argc>2) num_repeats = std::strtol(argv[2],NULL,0);
+  bool full_sweep = false;
+  if(argc>3) full_sweep = std::strtol(argv[3],NULL,0)==1;
+  TEUCHOS_TEST_FOR_EXCEPTION(num_repeats<1,std::runtime_error,"Error, the number of repeats must be at least 1");
+  const bool write_json = results_file.size() > 5 && results_file.substr(results_file.size()-5)==".json";
+  const bool write_csv = results_file.size() > 4 && results_file.substr(results_file.size()-4)==".csv";
+  TEUCHOS_TEST_FOR_EXCEPTION(!results_file.empty()&&!write_json&&!write_csv,std::runtime_error,
+    "Error, the results file must end in .json or .csv: " << results_file);
+
+  // with the gradients the default sizes fit in L2 and in L3 respectively on most
+  // machines, the full sweep adds an image that is much larger than the last level cache
+  std::vector<int_t> image_sizes;
+  image_sizes.push_back(128);
+  image_sizes.push_back(1024);
+  if(full_sweep){
+    image_sizes.push_back(4096);
+  }
+  const int_t num_samples = full_sweep ? 1<<22 : 1<<20;
+  *outStream << "number of samples:        " << num_samples << std::endl;
+  *outStream << "number of repeats:        " << num_repeats << " (the fastest is reported)" << std::endl;
+
+  std::vector<Benchmark_Case> cases;
+  std::vector<Benchmark_Result> results;
+  for(size_t s=0;s<image_sizes.size();++s){
+    Teuchos::RCP<Image> image = create_image(image_sizes[s]);
+    for(int_t pattern=0;pattern<=SUBSET_ACCESS;++pattern){
+      std::vector<scalar_t> local_x;
+      std::vector<scalar_t> local_y;
+      create_samples(image_sizes[s],static_cast<Access_Pattern>(pattern),num_samples,local_x,local_y);
+      for(int_t method=0;method<MAX_INTERPOLATION_METHOD;++method){
+        for(int_t batched=0;batched<2;++batched){
+          // the splines are only available through the batched interpolation
+          if(!batched&&(method==CUBIC_BSPLINE||method==QUINTIC_BSPLINE)) continue;
+          for(int_t gradients=0;gradients<2;++gradients){
+            Benchmark_Case bench_case;
+            bench_case.image_size = image_sizes[s];
+            bench_case.interpolation_method = static_cast<Interpolation_Method>(method);
+            bench_case.access_pattern = static_cast<Access_Pattern>(pattern);
+            bench_case.gradients = gradients==1;
+            bench_case.batched = batched==1;
+            const Benchmark_Result result = run_case(bench_case,image,local_x,local_y,num_repeats);
+            *outStream << "image " << bench_case.image_size << " " << accessPatternStrings[bench_case.access_pattern] <<
+                " " << interpolationMethodStrings[bench_case.interpolation_method] <<
+                (bench_case.batched ? " batched" : " single") << (bench_case.gradients ? " intensity+gradients" : " intensity") <<
+                ": ns/sample " << result.ns_per_sample << " GB/s " << result.bandwidth <<
+                " (checksum " << result.checksum << ")" << std::endl;
+            cases.push_back(bench_case);
+            results.push_back(result);
+          }
+        }
+      }
+    }
+  }
+
+  if(!results_file.empty()){
+    *outStream << "writing results to " << results_file << std::endl;
+    std::ofstream out(results_file.c_str());
+    TEUCHOS_TEST_FOR_EXCEPTION(!out.good(),std::runtime_error,"Error, could not open results file " << results_file);
+    if(write_csv)
+      out << "image_size,access_pattern,interpolation_method,batched,gradients,num_samples,time,ns_per_sample,"
+          "bytes_per_sample,bandwidth_GBs" << std::endl;
+    else
+      out << "[" << std::endl;
+    for(size_t i=0;i<cases.size();++i){
+      const Benchmark_Case & c = cases[i];
+      const Benchmark_Result & r = results[i];
+      if(write_csv){
+        out << c.image_size << "," << accessPatternStrings[c.access_pattern] << ","
+            << interpolationMethodStrings[c.interpolation_method] << "," << c.batched << "," << c.gradients << ","
+            << r.num_samples << "," << r.time << "," << r.ns_per_sample << "," << r.bytes_per_sample << ","
+            << r.bandwidth << std::endl;
+      }
+      else{
+        out << "  {\"image_size\": " << c.image_size << ", \"access_pattern\": \"" << accessPatternStrings[c.access_pattern]
+            << "\", \"interpolation_method\": \"" << interpolationMethodStrings[c.interpolation_method]
+            << "\", \"batched\": " << (c.batched ? "true" : "false") << ", \"gradients\": " << (c.gradients ? "true" : "false")
+            << ", \"num_samples\": " << r.num_samples << ", \"time\": " << r.time
+            << ", \"ns_per_sample\": " << r.ns_per_sample << ", \"bytes_per_sample\": " << r.bytes_per_sample
+            << ", \"bandwidth_GBs\": " << r.bandwidth << "}" << (i+1<cases.size() ? "," : "") << std::endl;
+      }
+    }
+    if(write_json)
+      out << "]" << std::endl;
+    out.close();
+  }
+
+  *outStream << "--- End performance test ---" << std::endl;
+
+  DICe::finalize();
+
+  return 0;
+}
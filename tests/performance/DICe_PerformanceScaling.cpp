@@ -0,0 +1,289 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+#include <DICe.h>
+#include <DICe_Schema.h>
+#include <DICe_ImageUtils.h>
+#include <DICe_PostProcessor.h>
+#include <DICe_Profiler.h>
+
+#include <Teuchos_RCP.hpp>
+#include <Teuchos_oblackholestream.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <boost/timer/timer.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace DICe;
+using namespace boost::timer;
+
+// Usage DICe_PerformanceScaling <results_file (.csv)> [<strong or weak> [<max_threads> [<num_repeats>]]]
+//
+// Correlates a synthetic speckle image with a sin()*cos() displacement field and appends one row
+// per thread count to the results table. The subsets are distributed with a Decomp and the VSG strain
+// post processor is enabled so the overlap maps and the halo exchange are part of the timing. For
+// strong scaling the image size is fixed, for weak scaling the image height grows with the number of
+// processors so each processor keeps the same number of subsets. The processor counts are swept by
+// running the driver once per count, for example:
+//
+//   for p in 1 2 4 8; do mpiexec -np $p ./DICe_PerformanceScaling scaling.csv strong 8; done
+//
+// The speedup and efficiency columns are relative to the row with 1 processor and 1 thread for the
+// same mode that is already in the table (or written by this run), so run the serial case first.
+
+/// names of the columns of the results table
+const static char * scalingColumnStrings[] = {
+  "mode",
+  "num_procs",
+  "num_threads",
+  "image_width",
+  "image_height",
+  "num_subsets",
+  "min_local_subsets",
+  "max_local_subsets",
+  "time",
+  "speedup",
+  "efficiency"
+};
+const static int_t num_scaling_columns = 11;
+
+/// returns the max of a value over all processors
+double max_over_procs(const double & value){
+  double global_value = value;
+#if DICE_MPI
+  MPI_Allreduce(&value,&global_value,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+#endif
+  return global_value;
+}
+
+/// returns the min of a value over all processors
+int_t min_over_procs(const int_t value){
+  int_t global_value = value;
+#if DICE_MPI
+  MPI_Allreduce(&value,&global_value,1,MPI_INT,MPI_MIN,MPI_COMM_WORLD);
+#endif
+  return global_value;
+}
+
+/// returns the time of the serial run for the given mode in an existing results table (-1 if there isn't one)
+scalar_t find_baseline_time(const std::string & results_file,
+  const std::string & mode){
+  std::ifstream in(results_file.c_str());
+  if(!in.good()) return -1.0;
+  std::string line;
+  std::getline(in,line); // header
+  while(std::getline(in,line)){
+    std::stringstream ss(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while(std::getline(ss,token,','))
+      tokens.push_back(token);
+    if(tokens.size()<9) continue;
+    if(tokens[0]==mode&&tokens[1]=="1"&&tokens[2]=="1")
+      return std::strtod(tokens[8].c_str(),NULL);
+  }
+  return -1.0;
+}
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  Teuchos::RCP<MultiField_Comm> comm = Teuchos::rcp(new MultiField_Comm());
+  const int_t proc_rank = comm->get_rank();
+  const int_t num_procs = comm->get_size();
+
+  // only print output if args are given (for testing the output is quiet)
+  Teuchos::oblackholestream bhs; // outputs nothing
+  Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&bhs, false);
+  if(argc>1&&proc_rank==0)
+    outStream = Teuchos::rcp(&std::cout, false);
+
+  if(argc<2){
+    if(proc_rank==0)
+      std::cerr << "Usage: DICe_PerformanceScaling <results_file (.csv)> [<strong or weak> [<max_threads> [<num_repeats>]]]" << std::endl;
+    DICe::finalize();
+    return 1;
+  }
+
+  *outStream << "--- Begin performance test ---" << std::endl;
+
+  const std::string results_file = argv[1];
+  const std::string mode = argc>2 ? argv[2] : "strong";
+  TEUCHOS_TEST_FOR_EXCEPTION(mode!="strong"&&mode!="weak",std::runtime_error,"Error, the mode must be strong or weak: " << mode);
+  int_t max_threads = 1;
+  if(argc>3) max_threads = std::strtol(argv[3],NULL,0);
+  int_t num_repeats = 3;
+  if(argc>4) num_repeats = std::strtol(argv[4],NULL,0);
+  TEUCHOS_TEST_FOR_EXCEPTION(max_threads<1,std::runtime_error,"Error, the number of threads must be at least 1");
+  TEUCHOS_TEST_FOR_EXCEPTION(num_repeats<1,std::runtime_error,"Error, the number of repeats must be at least 1");
+#ifndef _OPENMP
+  if(max_threads>1)
+    *outStream << "*** Warning: OpenMP is not enabled, only 1 thread will be used" << std::endl;
+  max_threads = 1;
+#endif
+
+  // the workload
+  const int_t subset_size = 25;
+  const int_t step_size = 15;
+  const int_t image_width = 1024;
+  const int_t image_height = mode=="weak" ? 256*num_procs : 1024;
+  *outStream << "mode:                     " << mode << std::endl;
+  *outStream << "number of processors:     " << num_procs << std::endl;
+  *outStream << "image dimensions:         " << image_width << " x " << image_height << std::endl;
+  Teuchos::RCP<Teuchos::ParameterList> img_params = Teuchos::rcp(new Teuchos::ParameterList());
+  img_params->set(DICe::compute_image_gradients,true);
+  Teuchos::RCP<Image> ref_img = create_synthetic_speckle_image(image_width,image_height,0,0,5.0,img_params);
+  SinCos_Image_Deformer deformer(256,2.0);
+  Teuchos::RCP<Image> def_img = deformer.deform_image(ref_img);
+
+  std::vector<int_t> thread_counts;
+  for(int_t threads=1;threads<max_threads;threads*=2)
+    thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+
+  scalar_t baseline_time = -1.0;
+  if(proc_rank==0)
+    baseline_time = find_baseline_time(results_file,mode);
+  std::vector<std::string> rows;
+  std::vector<std::vector<scalar_t> > phase_times;
+  for(size_t t=0;t<thread_counts.size();++t){
+    Teuchos::RCP<Teuchos::ParameterList> params = Teuchos::rcp(new Teuchos::ParameterList());
+    params->set(DICe::correlation_routine,DICe::GENERIC_ROUTINE);
+    params->set(DICe::initialization_method,DICe::USE_FIELD_VALUES);
+    params->set(DICe::interpolation_method,DICe::KEYS_FOURTH);
+    params->set(DICe::optimization_method,DICe::GRADIENT_BASED);
+    params->set(DICe::enable_translation,true);
+    params->set(DICe::enable_rotation,true);
+    params->set(DICe::enable_normal_strain,true);
+    params->set(DICe::enable_shear_strain,true);
+    params->set(DICe::num_threads,thread_counts[t]);
+    Teuchos::ParameterList vsg_sublist;
+    vsg_sublist.set(DICe::strain_window_size_in_pixels,3*step_size);
+    params->set(DICe::post_process_vsg_strain,vsg_sublist);
+
+    scalar_t best_time = std::numeric_limits<scalar_t>::max();
+    int_t num_subsets = 0;
+    int_t min_local_subsets = 0;
+    int_t max_local_subsets = 0;
+    std::vector<scalar_t> best_phase_times(MAX_PROFILE_PHASE,0.0);
+    for(int_t repeat=0;repeat<num_repeats;++repeat){
+      Schema schema(image_width,image_height,step_size,step_size,subset_size,params);
+      schema.set_ref_image(ref_img);
+      schema.set_def_image(def_img);
+      Profiler::reset();
+      Profiler::set_enabled(true);
+#if DICE_MPI
+      MPI_Barrier(MPI_COMM_WORLD);
+#endif
+      cpu_timer corr_timer;
+      schema.execute_correlation();
+      schema.execute_post_processors();
+      corr_timer.stop();
+      Profiler::set_enabled(false);
+      // the slowest processor sets the time
+      const scalar_t time = max_over_procs(corr_timer.elapsed().wall*1.0E-9);
+      std::vector<scalar_t> times(MAX_PROFILE_PHASE,0.0);
+      for(int_t phase=0;phase<MAX_PROFILE_PHASE;++phase)
+        times[phase] = max_over_procs(Profiler::time(static_cast<Profile_Phase>(phase)));
+      if(time>=best_time) continue;
+      best_time = time;
+      best_phase_times = times;
+      num_subsets = schema.global_num_subsets();
+      min_local_subsets = min_over_procs(schema.local_num_subsets());
+      max_local_subsets = -min_over_procs(-schema.local_num_subsets());
+    }
+    if(num_procs*thread_counts[t]==1&&baseline_time<0.0)
+      baseline_time = best_time;
+    const scalar_t speedup = baseline_time > 0.0 ? baseline_time/best_time : 0.0;
+    // for weak scaling the ideal time stays the same as the serial time
+    const scalar_t efficiency = mode=="weak" ? speedup : speedup/(num_procs*thread_counts[t]);
+    std::stringstream values;
+    values << mode << "," << num_procs << "," << thread_counts[t] << "," << image_width << "," << image_height << ","
+        << num_subsets << "," << min_local_subsets << "," << max_local_subsets << "," << best_time << ",";
+    if(baseline_time > 0.0)
+      values << speedup << "," << efficiency;
+    else
+      values << ",";
+    rows.push_back(values.str());
+    phase_times.push_back(best_phase_times);
+    *outStream << "processors " << num_procs << " threads " << thread_counts[t] << ": subsets " << num_subsets <<
+        " (" << min_local_subsets << " to " << max_local_subsets << " per processor) time " << best_time << " s";
+    if(baseline_time > 0.0)
+      *outStream << " speedup " << speedup << " efficiency " << efficiency;
+    *outStream << std::endl;
+  }
+
+  if(proc_rank==0){
+    // the header is only written if the table is new
+    const bool new_file = !std::ifstream(results_file.c_str()).good();
+    std::ofstream out(results_file.c_str(),std::ios::app);
+    TEUCHOS_TEST_FOR_EXCEPTION(!out.good(),std::runtime_error,"Error, could not open results file " << results_file);
+    if(new_file){
+      for(int_t i=0;i<num_scaling_columns;++i)
+        out << (i>0 ? "," : "") << scalingColumnStrings[i];
+      // the phase times are summed over the threads of the slowest processor
+      for(int_t phase=0;phase<MAX_PROFILE_PHASE;++phase)
+        out << "," << profilePhaseStrings[phase];
+      out << std::endl;
+    }
+    for(size_t i=0;i<rows.size();++i){
+      out << rows[i];
+      for(int_t phase=0;phase<MAX_PROFILE_PHASE;++phase)
+        out << "," << phase_times[i][phase];
+      out << std::endl;
+    }
+    out.close();
+    *outStream << "appended " << rows.size() << " rows to " << results_file << std::endl;
+  }
+
+  *outStream << "--- End performance test ---" << std::endl;
+
+  DICe::finalize();
+
+  return 0;
+}
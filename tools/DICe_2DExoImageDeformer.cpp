@@ -60,6 +60,10 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace DICe;
 
@@ -115,6 +119,13 @@ int main(int argc, char *argv[]) {
   const scalar_t plot_thresh = params->get<double>("plot_disp_threshold");
   TEUCHOS_TEST_FOR_EXCEPTION(!params->isParameter("convert_to_eulerian"),std::runtime_error,"");
   const bool convert_to_eulerian = params->get<bool>("convert_to_eulerian");
+  int_t num_threads = 1;
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+  if(params->isParameter("num_threads"))
+    num_threads = params->get<int_t>("num_threads");
+  TEUCHOS_TEST_FOR_EXCEPTION(num_threads<1,std::runtime_error,"Error, num_threads must be greater than 0");
 
   // read the exodus file to get the displacement field and coordinates
 
@@ -169,22 +180,91 @@ int main(int argc, char *argv[]) {
   kd_tree->buildIndex();
   DEBUG_MSG("kd-tree completed");
 
-  // perform a pass to size the neighbor lists
-  std::vector<std::vector<int_t> > neighbor_list(num_px);
-  std::vector<std::vector<scalar_t> > neighbor_dist_x(num_px);
-  std::vector<std::vector<scalar_t> > neighbor_dist_y(num_px);
-  scalar_t query_pt[2];
-  std::vector<size_t> ret_index(num_neigh);
-  std::vector<scalar_t> out_dist_sqr(num_neigh);
-  const int_t N = 3;
-  int *IPIV = new int[N+1];
-  int LWORK = N*N;
-  int INFO = 0;
-  double *WORK = new double[LWORK];
-  double *GWORK = new double[10*N];
-  int *IWORK = new int[LWORK];
-  // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
-  Teuchos::LAPACK<int,double> lapack;
+  // the least squares fit for each pixel is independent so the rows of the image are split among threads,
+  // the displacements are stored so the image point csv file can be written afterwards in pixel order
+  std::vector<scalar_t> img_bx(num_px,0.0);
+  std::vector<scalar_t> img_by(num_px,0.0);
+#pragma omp parallel num_threads(num_threads)
+  {
+    // temp storage
+    scalar_t query_pt[2];
+    std::vector<size_t> ret_index(num_neigh);
+    std::vector<scalar_t> out_dist_sqr(num_neigh);
+    std::vector<scalar_t> sample_x(img_w);
+    std::vector<scalar_t> sample_y(img_w);
+    std::vector<intensity_t> sample_intens(img_w);
+    const int_t N = 3;
+    std::vector<int> IPIV(N+1);
+    int LWORK = N*N;
+    int INFO = 0;
+    std::vector<double> WORK(LWORK);
+    // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
+    Teuchos::LAPACK<int,double> lapack;
+    std::vector<double> u_x(num_neigh,0.0);
+    std::vector<double> u_y(num_neigh,0.0);
+    double X_t_u_x[N];
+    double X_t_u_y[N];
+    Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_neigh, true);
+    Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
+#pragma omp for schedule(dynamic,4)
+    for(int_t py=0;py<img_h;++py){
+      for(int_t px=0;px<img_w;++px){
+        // compute the model location for this pixel:
+        // remove the model offsets and scale the positions
+        scalar_t mx = (px - ox)*scale_factor;
+        scalar_t my = (oy - py)*scale_factor; // y pixel has to be flipped to match the model coordiantes which are y up instead of y down like the image
+        query_pt[0] = mx;
+        query_pt[1] = my;
+        kd_tree->knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
+        X_t.putScalar(0.0);
+        X_t_X.putScalar(0.0);
+        for(int_t j=0;j<num_neigh;++j){
+          const int_t neigh_id = ret_index[j];
+          u_x[j] = exo_ux[neigh_id];
+          u_y[j] = exo_uy[neigh_id];
+          X_t(0,j) = 1.0;
+          X_t(1,j) = point_cloud->pts[neigh_id].x - mx;
+          X_t(2,j) = point_cloud->pts[neigh_id].y - my;
+        }
+        // set up X^T*X
+        for(int_t k=0;k<N;++k){
+          for(int_t m=0;m<N;++m){
+            for(int_t j=0;j<num_neigh;++j){
+              X_t_X(k,m) += X_t(k,j)*X_t(m,j);
+            }
+          }
+        }
+        // Invert X^T*X
+        lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),&IPIV[0],&INFO);
+        lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),&IPIV[0],&WORK[0],LWORK,&INFO);
+        // compute X^T*u
+        for(int_t i=0;i<N;++i){
+          X_t_u_x[i] = 0.0;
+          X_t_u_y[i] = 0.0;
+          for(int_t j=0;j<num_neigh;++j){
+            X_t_u_x[i] += X_t(i,j)*u_x[j];
+            X_t_u_y[i] += X_t(i,j)*u_y[j];
+          }
+        }
+        // only the constant coefficient of the fit is needed
+        scalar_t ls_ux = 0.0;
+        scalar_t ls_uy = 0.0;
+        for(int_t j=0;j<N;++j){
+          ls_ux += X_t_X(0,j)*X_t_u_x[j];
+          ls_uy += X_t_X(0,j)*X_t_u_y[j];
+        }
+        img_bx[py*img_w+px] = ls_ux;
+        img_by[py*img_w+px] = ls_uy;
+        // convert the displacement back to image coordinates
+        sample_x[px] = px - ls_ux / scale_factor;
+        sample_y[px] = py - ls_uy / scale_factor;
+      } // end px
+      // apply the displacement to the image for the whole row at once
+      ref_img->batch_interpolate(img_w,&sample_x[0],&sample_y[0],&sample_intens[0],NULL,NULL,KEYS_FOURTH);
+      for(int_t px=0;px<img_w;++px)
+        def_intens[py*img_w+px] = sample_intens[px] > 0.0 ? sample_intens[px] : 0.0;
+    } // end py
+  }
 
   // output a csv file with the image points
   std::stringstream img_pts_filename;
@@ -192,86 +272,23 @@ int main(int argc, char *argv[]) {
 
   std::FILE * imgFilePtr = fopen(img_pts_filename.str().c_str(),"w");
   fprintf(imgFilePtr,"X,Y,Z,U,V\n");
-
   for(int_t py=0;py<img_h;++py){
     for(int_t px=0;px<img_w;++px){
-      // compute the model location for this pixel:
-      // remove the model offsets and scale the positions
-      scalar_t mx = (px - ox)*scale_factor;
-      scalar_t my = (oy - py)*scale_factor; // y pixel has to be flipped to match the model coordiantes which are y up instead of y down like the image
-      query_pt[0] = mx;
-      query_pt[1] = my;
-      kd_tree->knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
-      scalar_t ls_ux = 0.0;
-      scalar_t ls_uy = 0.0;
-      Teuchos::ArrayRCP<double> u_x(num_neigh,0.0);
-      Teuchos::ArrayRCP<double> u_y(num_neigh,0.0);
-      Teuchos::ArrayRCP<double> X_t_u_x(N,0.0);
-      Teuchos::ArrayRCP<double> X_t_u_y(N,0.0);
-      Teuchos::ArrayRCP<double> coeffs_x(N,0.0);
-      Teuchos::ArrayRCP<double> coeffs_y(N,0.0);
-      Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_neigh, true);
-      Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
-      for(int_t j=0;j<num_neigh;++j){
-        const int_t neigh_id = ret_index[j];
-        u_x[j] = exo_ux[neigh_id];
-        u_y[j] = exo_uy[neigh_id];
-        X_t(0,j) = 1.0;
-        X_t(1,j) = point_cloud->pts[neigh_id].x - mx;
-        X_t(2,j) = point_cloud->pts[neigh_id].y - my;
-      }
-      // set up X^T*X
-      for(int_t k=0;k<N;++k){
-        for(int_t m=0;m<N;++m){
-          for(int_t j=0;j<num_neigh;++j){
-            X_t_X(k,m) += X_t(k,j)*X_t(m,j);
-          }
-        }
-      }
-      //X_t_X.print(std::cout);
-      // Invert X^T*X
-      lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),IPIV,&INFO);
-      lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),IPIV,WORK,LWORK,&INFO);
-      // compute X^T*u
-      for(int_t i=0;i<N;++i){
-        for(int_t j=0;j<num_neigh;++j){
-          X_t_u_x[i] += X_t(i,j)*u_x[j];
-          X_t_u_y[i] += X_t(i,j)*u_y[j];
-        }
-      }
-      // compute the coeffs
-      for(int_t i=0;i<N;++i){
-        for(int_t j=0;j<N;++j){
-          coeffs_x[i] += X_t_X(i,j)*X_t_u_x[j];
-          coeffs_y[i] += X_t_X(i,j)*X_t_u_y[j];
-        }
-      }
-      ls_ux = coeffs_x[0];
-      ls_uy = coeffs_y[0];
-      // convert the displacement back to image coordinates
-      const scalar_t bx = ls_ux / scale_factor;
-      const scalar_t by = ls_uy / scale_factor;
+      const scalar_t mx = (px - ox)*scale_factor;
+      const scalar_t my = (oy - py)*scale_factor;
+      const scalar_t ls_ux = img_bx[py*img_w+px];
+      const scalar_t ls_uy = img_by[py*img_w+px];
       scalar_t out_bx = std::abs(ls_ux) < plot_thresh ? ls_ux : 0.0;
       scalar_t out_by = std::abs(ls_uy) < plot_thresh ? ls_uy : 0.0;
       fprintf(imgFilePtr,"%4.4E,%4.4E,%4.4E,%4.4E,%4.4E\n",mx,my,0.0,out_bx,out_by);
-
-      // apply the displacement to the image
-      const intensity_t intens = ref_img->interpolate_keys_fourth(px-bx,py-by);
-      def_intens[py*img_w+px] = intens > 0.0 ? intens : 0.0;
-    } // end px
-  } // end py
-
+    }
+  }
   fclose(imgFilePtr);
 
   // output the deformed image:
   Teuchos::RCP<Image> def_img = Teuchos::rcp(new Image(img_w,img_h,def_intens));
   def_img->write(output_image_name,false);
 
-  delete [] WORK;
-  delete [] GWORK;
-  delete [] IWORK;
-  delete [] IPIV;
-
   DICe::finalize();
 
   return 0;
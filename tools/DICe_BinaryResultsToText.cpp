@@ -0,0 +1,113 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+/*! \file  DICe_BinaryResultsToText.cpp
+    \brief Utility for converting a binary results file to text files (one file per frame)
+*/
+
+#include <DICe.h>
+#include <DICe_ResultsIO.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  if(argc!=3&&argc!=4&&argc!=5){
+    std::cout << " DICe_BinaryResultsToText (converts a binary results file to text files, one per frame) " << std::endl;
+    std::cout << " Syntax: DICe_BinaryResultsToText <binary_file_name> <output_prefix> [first_frame_index] [last_frame_index]" << std::endl;
+    std::cout << " Each frame is written to <output_prefix>_<frame_id>.txt with one row per subset" << std::endl;
+    exit(-1);
+  }
+  const std::string binary_name = argv[1];
+  const std::string output_prefix = argv[2];
+
+  Binary_Results_Reader reader(binary_name);
+  const int_t num_frames = reader.num_frames();
+  const int_t first_index = argc>=4 ? std::strtol(argv[3],NULL,0) : 0;
+  const int_t last_index = argc==5 ? std::strtol(argv[4],NULL,0) : num_frames-1;
+  std::cout << "binary results file: " << binary_name << std::endl;
+  std::cout << "num frames:          " << num_frames << std::endl;
+  std::cout << "num subsets:         " << reader.num_subsets() << std::endl;
+  std::cout << "num fields:          " << reader.num_fields() << std::endl;
+  TEUCHOS_TEST_FOR_EXCEPTION(first_index<0||last_index>=num_frames||first_index>last_index,std::runtime_error,
+    "Error, invalid frame range " << first_index << " to " << last_index);
+
+  const std::vector<std::string> & field_names = reader.field_names();
+  const std::vector<int_t> & subset_ids = reader.subset_ids();
+  const int_t num_subsets = reader.num_subsets();
+  std::vector<scalar_t> values;
+  for(int_t frame=first_index;frame<=last_index;++frame){
+    int_t frame_id = 0;
+    reader.read_frame(frame,frame_id,values);
+    std::stringstream fName;
+    fName << output_prefix << "_" << frame_id << ".txt";
+    std::FILE * filePtr = fopen(fName.str().c_str(),"w");
+    TEUCHOS_TEST_FOR_EXCEPTION(filePtr==NULL,std::runtime_error,"Error, could not create output file " << fName.str());
+    // same layout as the text output written by Schema::write_output
+    fprintf(filePtr,"SUBSET_ID");
+    for(size_t i=0;i<field_names.size();++i)
+      fprintf(filePtr," %s",field_names[i].c_str());
+    fprintf(filePtr,"\n");
+    for(int_t j=0;j<num_subsets;++j){
+      fprintf(filePtr,"%i",subset_ids[j]);
+      for(size_t i=0;i<field_names.size();++i)
+        fprintf(filePtr," %4.4E",values[i*num_subsets+j]);
+      fprintf(filePtr,"\n");
+    }
+    fclose(filePtr);
+  }
+
+  DICe::finalize();
+
+  return 0;
+}
+
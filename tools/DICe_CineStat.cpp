@@ -39,24 +39,83 @@
 // ************************************************************************
 // @HEADER
 
-/*! \file  DICe_CineToTiff.cpp
-    \brief Utility for exporting cine files to tiff files
+/*! \file  DICe_CineStat.cpp
+    \brief Utility for writing the frame range and intensity statistics of a cine file
 */
 
 #include <DICe.h>
 #include <DICe_Parser.h>
+#include <DICe_ImageIO.h>
 #include <DICe_Cine.h>
 
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_oblackholestream.hpp>
 
-#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace DICe;
 
+/// running statistics for a contiguous block of frames, each pixel is accumulated over time
+/// with Welford's update and the blocks are merged with Chan's pairwise formula
+struct Pixel_Stats{
+  /// number of frames accumulated (the same for every pixel)
+  int_t count;
+  /// running temporal mean of each pixel
+  std::vector<double> mean;
+  /// running sum of squared differences from the mean of each pixel
+  std::vector<double> m2;
+  /// number of frames in which each pixel failed
+  std::vector<int_t> failed;
+  /// constructor
+  Pixel_Stats(const size_t num_pixels):
+    count(0),
+    mean(num_pixels,0.0),
+    m2(num_pixels,0.0),
+    failed(num_pixels,0){}
+  /// add the statistics of another block of frames to this one
+  void merge(const Pixel_Stats & other){
+    if(other.count==0) return;
+    if(count==0){
+      *this = other;
+      return;
+    }
+    const double n_a = count;
+    const double n_b = other.count;
+    const double n = n_a + n_b;
+    for(size_t i=0;i<mean.size();++i){
+      const double delta = other.mean[i] - mean[i];
+      mean[i] += delta*n_b/n;
+      m2[i] += other.m2[i] + delta*delta*n_a*n_b/n;
+      failed[i] += other.failed[i];
+    }
+    count += other.count;
+  }
+};
+
+/// statistics of a single frame
+struct Frame_Stats{
+  /// mean intensity
+  double mean;
+  /// standard deviation of the intensity
+  double std_dev;
+  /// minimum intensity
+  double min;
+  /// maximum intensity
+  double max;
+  /// number of failed pixels
+  int_t failed;
+};
+
 int main(int argc, char *argv[]) {
 
-  /// usage ./DICe_CineToTiff <cine_file_name> <start_index> <end_index> <output_prefix>
+  /// usage ./DICe_CineStat <cine_file_name> [options]
 
   DICe::initialize(argc, argv);
 
@@ -64,21 +123,60 @@ int main(int argc, char *argv[]) {
   Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&std::cout, false);
   std::string delimiter = " ,\r";
 
-  if(argc>=2){
-    std::string help = argv[1];
-    if(help=="-h"||argc>2){
-      std::cout << " DICe_CineStat (writes a file with the cine index range) " << std::endl;
-      std::cout << " Syntax: DICe_CineStat <cine_file_name>" << std::endl;
-      exit(0);
-    }
+  if(argc<2||std::string(argv[1])=="-h"){
+    std::cout << " DICe_CineStat (writes a file with the cine index range and optionally the intensity statistics) " << std::endl;
+    std::cout << " Syntax: DICe_CineStat <cine_file_name> [options]" << std::endl;
+    std::cout << " Options:" << std::endl;
+    std::cout << "  -stats              also compute the per frame and per pixel intensity statistics" << std::endl;
+    std::cout << "  -threads <n>        number of threads used for the statistics (default 1)" << std::endl;
+    std::cout << "  -start <index>      first frame included in the statistics (default is the first frame)" << std::endl;
+    std::cout << "  -end <index>        last frame included in the statistics (default is the last frame)" << std::endl;
+    std::cout << "  -prefix <prefix>    prefix for the statistics output files (default cine)" << std::endl;
+    std::cout << " Output:" << std::endl;
+    std::cout << "  cine_stats.dat                  number of frames, first frame, last frame" << std::endl;
+    std::cout << "  <prefix>_frame_stats.dat        frame, mean, std dev, min, max, number of failed pixels (-stats only)" << std::endl;
+    std::cout << "  <prefix>_pixel_mean.rawi        temporal mean of each pixel (-stats only)" << std::endl;
+    std::cout << "  <prefix>_pixel_variance.rawi    temporal variance of each pixel (-stats only)" << std::endl;
+    std::cout << "  <prefix>_failed_pixels.rawi     number of frames in which each pixel failed (-stats only)" << std::endl;
+    std::cout << " The statistics are computed from the raw cine values, a pixel fails if it is at or above the" << std::endl;
+    std::cout << " value the cine reader filters as a failed pixel (250 for 8 bit, 65500 for 16 bit, 4090 for 10 bit packed)" << std::endl;
+    exit(0);
   }
-  TEUCHOS_TEST_FOR_EXCEPTION(argc!=2,std::runtime_error,"Error, wrong number of input arguments");
 
   DEBUG_MSG("User specified " << argc << " arguments");
   for(int_t i=0;i<argc;++i){
     DEBUG_MSG(argv[i]);
   }
   std::string fileName = argv[1];
+  bool compute_stats = false;
+  int_t num_threads = 1;
+  int_t start_frame = std::numeric_limits<int_t>::min();
+  int_t end_frame = std::numeric_limits<int_t>::max();
+  std::string prefix = "cine";
+  for(int_t i=2;i<argc;++i){
+    const std::string arg = argv[i];
+    if(arg=="-stats") compute_stats = true;
+    else if(arg=="-threads"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+1>=argc,std::invalid_argument,"Error, -threads needs a value");
+      num_threads = std::stoi(argv[++i]);
+      TEUCHOS_TEST_FOR_EXCEPTION(num_threads<1,std::invalid_argument,"Error, -threads must be at least 1");
+    }
+    else if(arg=="-start"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+1>=argc,std::invalid_argument,"Error, -start needs a value");
+      start_frame = std::stoi(argv[++i]);
+    }
+    else if(arg=="-end"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+1>=argc,std::invalid_argument,"Error, -end needs a value");
+      end_frame = std::stoi(argv[++i]);
+    }
+    else if(arg=="-prefix"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+1>=argc,std::invalid_argument,"Error, -prefix needs a value");
+      prefix = argv[++i];
+    }
+    else{
+      TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,"Error, unknown option " << arg << " (see -h)");
+    }
+  }
   *outStream << "Cine file name: " << fileName << std::endl;
   Teuchos::RCP<DICe::cine::Cine_Reader> cine_reader  =  Teuchos::rcp(new DICe::cine::Cine_Reader(fileName,outStream.getRawPtr()));
   *outStream << "\nCine read successfully\n" << std::endl;
@@ -96,8 +194,119 @@ int main(int argc, char *argv[]) {
   fprintf(filePtr,"%i %i %i\n",num_images,first_frame,last_frame);
   fclose(filePtr);
 
+  if(!compute_stats){
+    DICe::finalize();
+    return 0;
+  }
+
+  start_frame = std::max(start_frame,first_frame);
+  end_frame = std::min(end_frame,last_frame);
+  TEUCHOS_TEST_FOR_EXCEPTION(end_frame<start_frame,std::invalid_argument,
+    "Error, the frame range " << start_frame << " to " << end_frame << " is empty");
+  const int_t num_stat_frames = end_frame - start_frame + 1;
+  const int_t width = cine_reader->width();
+  const int_t height = cine_reader->height();
+  const size_t num_pixels = (size_t)width*height;
+  intensity_t failed_value = 250.0;
+  if(cine_reader->bit_depth()==DICe::cine::BIT_DEPTH_16) failed_value = 65500.0;
+  else if(cine_reader->bit_depth()==DICe::cine::BIT_DEPTH_10_PACKED) failed_value = 4090.0;
+  const int_t num_workers = std::min(num_threads,num_stat_frames);
+  *outStream << "Stats frames:   " << start_frame << " to " << end_frame << std::endl;
+  *outStream << "Threads:        " << num_workers << std::endl;
+
+  // each thread accumulates a contiguous block of frames so the blocks can be merged in frame order
+  std::vector<Pixel_Stats> block_stats(num_workers,Pixel_Stats(num_pixels));
+  std::vector<Frame_Stats> frame_stats(num_stat_frames);
+  std::mutex mutex;
+  std::exception_ptr first_exception;
+
+  auto accumulate_frames = [&](const int_t block){
+    try{
+      // each thread decodes with its own reader so the reads are not serialized
+      DICe::cine::Cine_Reader reader(fileName);
+      Pixel_Stats & stats = block_stats[block];
+      std::vector<intensity_t> intensities(num_pixels);
+      const int_t block_begin = start_frame + (int_t)((int64_t)num_stat_frames*block/num_workers);
+      const int_t block_end = start_frame + (int_t)((int64_t)num_stat_frames*(block+1)/num_workers);
+      for(int_t frame=block_begin;frame<block_end;++frame){
+        // raw values, unfiltered, so the failed pixels can be counted
+        reader.get_frame(0,0,width,height,&intensities[0],true,frame-first_frame,false,false);
+        stats.count++;
+        const double inv_count = 1.0/stats.count;
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        intensity_t min_intens = intensities[0];
+        intensity_t max_intens = intensities[0];
+        int_t failed = 0;
+        for(size_t i=0;i<num_pixels;++i){
+          const intensity_t value = intensities[i];
+          sum += value;
+          sum_sq += (double)value*value;
+          if(value<min_intens) min_intens = value;
+          if(value>max_intens) max_intens = value;
+          if(value>=failed_value){
+            failed++;
+            stats.failed[i]++;
+          }
+          const double delta = value - stats.mean[i];
+          stats.mean[i] += delta*inv_count;
+          stats.m2[i] += delta*(value - stats.mean[i]);
+        }
+        Frame_Stats & fs = frame_stats[frame-start_frame];
+        fs.mean = sum/num_pixels;
+        fs.std_dev = std::sqrt(std::max(0.0,sum_sq/num_pixels - fs.mean*fs.mean));
+        fs.min = min_intens;
+        fs.max = max_intens;
+        fs.failed = failed;
+      }
+    }
+    catch(...){
+      std::lock_guard<std::mutex> lock(mutex);
+      if(!first_exception) first_exception = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for(int_t t=1;t<num_workers;++t)
+    workers.push_back(std::thread(accumulate_frames,t));
+  accumulate_frames(0);
+  for(size_t t=0;t<workers.size();++t)
+    workers[t].join();
+  if(first_exception)
+    std::rethrow_exception(first_exception);
+  for(int_t t=1;t<num_workers;++t)
+    block_stats[0].merge(block_stats[t]);
+  const Pixel_Stats & stats = block_stats[0];
+
+  std::stringstream frame_stats_name;
+  frame_stats_name << prefix << "_frame_stats.dat";
+  *outStream << "Writing frame statistics to " << frame_stats_name.str() << std::endl;
+  filePtr = fopen(frame_stats_name.str().c_str(),"w");
+  TEUCHOS_TEST_FOR_EXCEPTION(filePtr==NULL,std::runtime_error,"Error, could not open " << frame_stats_name.str());
+  fprintf(filePtr,"# frame mean std_dev min max failed_pixels\n");
+  for(int_t i=0;i<num_stat_frames;++i){
+    const Frame_Stats & fs = frame_stats[i];
+    fprintf(filePtr,"%i %f %f %f %f %i\n",start_frame+i,fs.mean,fs.std_dev,fs.min,fs.max,fs.failed);
+  }
+  fclose(filePtr);
+
+  // the pixel maps keep the raw cine range
+  std::vector<intensity_t> pixel_map(num_pixels);
+  for(size_t i=0;i<num_pixels;++i)
+    pixel_map[i] = stats.mean[i];
+  utils::write_image((prefix + "_pixel_mean.rawi").c_str(),width,height,&pixel_map[0],true,false);
+  for(size_t i=0;i<num_pixels;++i)
+    pixel_map[i] = stats.count > 1 ? stats.m2[i]/(stats.count-1) : 0.0;
+  utils::write_image((prefix + "_pixel_variance.rawi").c_str(),width,height,&pixel_map[0],true,false);
+  int_t num_failed_pixels = 0;
+  for(size_t i=0;i<num_pixels;++i){
+    pixel_map[i] = stats.failed[i];
+    if(stats.failed[i]>0) num_failed_pixels++;
+  }
+  utils::write_image((prefix + "_failed_pixels.rawi").c_str(),width,height,&pixel_map[0],true,false);
+  *outStream << "Pixels that failed in at least one frame: " << num_failed_pixels << std::endl;
+
   DICe::finalize();
 
   return 0;
 }
-
@@ -46,18 +46,53 @@
 #include <DICe.h>
 #include <DICe_Parser.h>
 #include <DICe_Image.h>
+#include <DICe_ImageIO.h>
+#include <DICe_Rawi.h>
 #include <DICe_Cine.h>
 
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_oblackholestream.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace DICe;
 
+/// rotate a row major frame by 90, 180 or 270 degrees the same way Image::apply_rotation does,
+/// the width and height are swapped for 90 and 270
+void rotate_frame(const int_t rotation,
+  int_t & width,
+  int_t & height,
+  std::vector<intensity_t> & intensities,
+  std::vector<intensity_t> & scratch){
+  if(rotation!=90&&rotation!=180&&rotation!=270) return;
+  scratch.resize(intensities.size());
+  for(int_t y=0;y<height;++y){
+    for(int_t x=0;x<width;++x){
+      if(rotation==90)
+        scratch[(width-1-x)*height+y] = intensities[y*width+x];
+      else if(rotation==180)
+        scratch[y*width+x] = intensities[(height-1-y)*width+width-1-x];
+      else
+        scratch[x*height+(height-1-y)] = intensities[y*width+x];
+    }
+  }
+  intensities.swap(scratch);
+  if(rotation!=180) std::swap(width,height);
+}
+
 int main(int argc, char *argv[]) {
 
-  /// usage ./DICe_CineToTiff <cine_file_name> <start_index> <end_index> <output_prefix>
+  /// usage ./DICe_CineToTiff <cine_file_name> <start_index> <end_index> <output_prefix> [options]
 
   DICe::initialize(argc, argv);
 
@@ -71,14 +106,21 @@ int main(int argc, char *argv[]) {
     if(help=="-h"){
       std::cout << " DICe_CineToTiff (exports cine images to tiffs) " << std::endl;
       std::cout << " Syntax: DICe_CineToTiff <cine_file_name> <start_index (zero based)> "
-          "<end_index (zero based)> <output_prefix> [rotation, (90,180,or270, other values ignored)]" << std::endl;
+          "<end_index (zero based)> <output_prefix> [output_suffix] [rotation, (90,180,or270, other values ignored)] [options]" << std::endl;
+      std::cout << " Options:" << std::endl;
+      std::cout << "  -threads <n>        number of frames decoded and written at the same time (default 1)" << std::endl;
+      std::cout << "  -roi <x> <y> <w> <h> only export this region of the frames (applied before the rotation)" << std::endl;
+      std::cout << "  -rawi               write each frame as a .rawi file instead of a tiff" << std::endl;
+      std::cout << "  -rawv               write all of the frames to one multi-frame file <output_prefix>.rawv" << std::endl;
+      std::cout << "  -c                  compress the rawi or rawv frames (requires zlib)" << std::endl;
+      std::cout << "  -r                  keep the full range of the cine values in rawi or rawv output instead of scaling to 8 bits" << std::endl;
       exit(0);
     }
   }
 
   if(argc < 5) {
-      printf("four input arguments are required, last two are optional "
-          "<cine_file_name> <start_index> <end_index> <output_prefix> [output_suffix] [rotation]\n");
+      printf("four input arguments are required, the rest are optional "
+          "<cine_file_name> <start_index> <end_index> <output_prefix> [output_suffix] [rotation] [options, see -h]\n");
       exit(0);
   }
 
@@ -87,25 +129,50 @@ int main(int argc, char *argv[]) {
     DEBUG_MSG(argv[i]);
   }
   std::string fileName = argv[1];
-  std::string stripped_fileName = fileName;
-  stripped_fileName.erase(stripped_fileName.length()-5,5);
-  *outStream << "Cine file base name: " << stripped_fileName << std::endl;
   std::string prefix = argv[4];
-  *outStream << "Tiff prefix: " << prefix << std::endl;
+  *outStream << "Output prefix: " << prefix << std::endl;
   std::string suffix = "";
   int_t rotation = 0;
-  if(argc>5){
-    for(int_t i=5;i<argc;++i){
-      if(is_number(argv[i])){
-        rotation = std::stoi(argv[5]);
-        *outStream << "User requested image roation by " << rotation << " degrees" << std::endl;
-      }
-      else{
-        suffix = argv[i];
-        *outStream << "Tiff suffix: " << suffix << std::endl;
-      }
+  int_t num_threads = 1;
+  int_t roi_x = 0, roi_y = 0, roi_w = -1, roi_h = -1;
+  bool write_rawi = false;
+  bool write_rawv = false;
+  bool compress = false;
+  bool convert_to_8_bit = true;
+  for(int_t i=5;i<argc;++i){
+    const std::string arg = argv[i];
+    if(arg=="-threads"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+1>=argc,std::invalid_argument,"Error, -threads needs a value");
+      num_threads = std::stoi(argv[++i]);
+      TEUCHOS_TEST_FOR_EXCEPTION(num_threads<1,std::invalid_argument,"Error, -threads must be at least 1");
+    }
+    else if(arg=="-roi"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+4>=argc,std::invalid_argument,"Error, -roi needs four values <x> <y> <w> <h>");
+      roi_x = std::stoi(argv[++i]);
+      roi_y = std::stoi(argv[++i]);
+      roi_w = std::stoi(argv[++i]);
+      roi_h = std::stoi(argv[++i]);
+    }
+    else if(arg=="-rawi") write_rawi = true;
+    else if(arg=="-rawv") write_rawv = true;
+    else if(arg=="-c") compress = true;
+    else if(arg=="-r") convert_to_8_bit = false;
+    else if(is_number(arg)){
+      rotation = std::stoi(arg);
+      *outStream << "User requested image roation by " << rotation << " degrees" << std::endl;
+      if(rotation!=90&&rotation!=180&&rotation!=270)
+        std::cout << "WARNING: user requested invalid rotation: " << rotation << " must be 90, 180 or 270. Skipping image rotation" << std::endl;
+    }
+    else{
+      suffix = arg;
+      *outStream << "Output suffix: " << suffix << std::endl;
     }
   }
+  TEUCHOS_TEST_FOR_EXCEPTION(write_rawi&&write_rawv,std::invalid_argument,"Error, -rawi and -rawv cannot both be used");
+  TEUCHOS_TEST_FOR_EXCEPTION(compress&&!utils::rawi_compression_enabled(),std::runtime_error,
+    "Error, compressed frames require DICe to be built with zlib");
+  // tiffs always hold 8 bit values
+  if(!write_rawi&&!write_rawv) convert_to_8_bit = true;
 
   Teuchos::RCP<DICe::cine::Cine_Reader> cine_reader  =  Teuchos::rcp(new DICe::cine::Cine_Reader(fileName,outStream.getRawPtr()));
 
@@ -114,68 +181,129 @@ int main(int argc, char *argv[]) {
   const int_t num_images = cine_reader->num_frames();
   const int_t image_width = cine_reader->width();
   const int_t image_height = cine_reader->height();
+  const int_t first_image = cine_reader->first_image_number();
 
   *outStream << "Num frames:     " << num_images << std::endl;
   *outStream << "Width:          " << image_width << std::endl;
   *outStream << "Height:         " << image_height << std::endl;
 
+  if(roi_w<0) roi_w = image_width;
+  if(roi_h<0) roi_h = image_height;
+  TEUCHOS_TEST_FOR_EXCEPTION(roi_x<0||roi_y<0||roi_w<=0||roi_h<=0||roi_x+roi_w>image_width||roi_y+roi_h>image_height,
+    std::invalid_argument,"Error, the region " << roi_x << " " << roi_y << " " << roi_w << " " << roi_h << " is not inside the frames");
+  if(roi_w!=image_width||roi_h!=image_height)
+    *outStream << "Region:         " << roi_x << " " << roi_y << " " << roi_w << " x " << roi_h << std::endl;
+
   const int_t start_frame = std::stoi(argv[2]);
   const int_t end_frame = std::stoi(argv[3]);
-  assert(start_frame>=cine_reader->first_image_number());
-  assert(start_frame<=cine_reader->first_image_number()+num_images);
+  assert(start_frame>=first_image);
+  assert(start_frame<=first_image+num_images);
   assert(end_frame>=start_frame);
-  assert(end_frame<=cine_reader->first_image_number()+num_images);
+  assert(end_frame<=first_image+num_images);
+  const int_t num_output_frames = end_frame-start_frame+1;
   *outStream << "Start frame:    " << start_frame << std::endl;
   *outStream << "End frame:      " << end_frame << std::endl;
-  *outStream << "Output frames:  " << end_frame-start_frame+1 << std::endl;
+  *outStream << "Output frames:  " << num_output_frames << std::endl;
+  *outStream << "Threads:        " << num_threads << std::endl;
   const std::string tif("tif");
   const std::string tiff("tiff");
   bool full_output_name_given = false;
-  if((prefix.find(tif)!=std::string::npos||prefix.find(tiff)!=std::string::npos)&&end_frame-start_frame+1==1){
+  if((prefix.find(tif)!=std::string::npos||prefix.find(tiff)!=std::string::npos)&&num_output_frames==1&&!write_rawi&&!write_rawv){
     full_output_name_given = true;
     *outStream << "Full output filename given " << std::endl;
   }
+  int_t num_digits_total = 0;
+  int_t decrement_total = num_images;
+  while (decrement_total){decrement_total /= 10; num_digits_total++;}
 
-  for(int_t i=start_frame;i<=end_frame;++i){
-    int_t num_digits_total = 0;
-    int_t decrement_total = num_images;
-    int_t num_digits_frame = 0;
-    int_t decrement_subset = i;
-    while (decrement_total){decrement_total /= 10; num_digits_total++;}
-    if(i==0) num_digits_frame = 1;
-    else
-      while (decrement_subset){decrement_subset /= 10; num_digits_frame++;}
-    int_t num_zeros = num_digits_total - num_digits_frame;
-    // determine the file name for this subset
-
-    std::stringstream fName;
-    fName << prefix;
-    if(!full_output_name_given){
-      for(int_t j=0;j<num_zeros;++j)
-        fName << "0";
-      fName << i << suffix << ".tif";
-    }
-    std::stringstream cName;
-    cName << stripped_fileName << "_" << i << ".cine";
-    Teuchos::RCP<DICe::Image> image = Teuchos::rcp(new Image(cName.str().c_str()));//cine_reader->get_frame(i);
-    if(rotation!=0){
-      if(rotation==90){
-        image = image->apply_rotation(NINTY_DEGREES);
-      }else if(rotation==180){
-        image = image->apply_rotation(ONE_HUNDRED_EIGHTY_DEGREES);
-      }else if(rotation==270){
-        image = image->apply_rotation(TWO_HUNDRED_SEVENTY_DEGREES);
-      }
-      else{
-        if(i==start_frame)
-          std::cout << "WARNING: user requested invalid rotation: " << rotation << " must be 90, 180 or 270. Skipping image rotation" << std::endl;
+  // the multi-frame file has to be written in frame order so the decoded frames wait in a
+  // bounded window until the frames before them have been written
+  std::unique_ptr<utils::Rawv_Writer> rawv_writer;
+  if(write_rawv){
+    std::stringstream rawv_name;
+    rawv_name << prefix << suffix << ".rawv";
+    *outStream << "Output file:    " << rawv_name.str() << std::endl;
+    rawv_writer.reset(new utils::Rawv_Writer(rawv_name.str()));
+  }
+  const int_t rawv_window = 2*num_threads;
+  std::map<int_t,std::vector<intensity_t> > pending_frames;
+  int_t next_rawv_frame = start_frame;
+  int_t rawv_width = 0;
+  int_t rawv_height = 0;
+
+  std::atomic<int_t> next_frame(start_frame);
+  std::mutex mutex;
+  std::condition_variable frame_written;
+  std::exception_ptr first_exception;
+  std::atomic<bool> failed(false);
+
+  auto convert_frames = [&](){
+    try{
+      // each thread decodes with its own reader so the reads are not serialized
+      DICe::cine::Cine_Reader reader(fileName);
+      std::vector<intensity_t> intensities;
+      std::vector<intensity_t> scratch;
+      for(int_t i=next_frame++;i<=end_frame&&!failed;i=next_frame++){
+        int_t width = roi_w;
+        int_t height = roi_h;
+        intensities.resize((size_t)width*height);
+        reader.get_frame(roi_x,roi_y,width,height,&intensities[0],true,i-first_image,false,convert_to_8_bit);
+        rotate_frame(rotation,width,height,intensities,scratch);
+        if(write_rawv){
+          std::unique_lock<std::mutex> lock(mutex);
+          frame_written.wait(lock,[&](){return failed||i<next_rawv_frame+rawv_window;});
+          if(failed) break;
+          rawv_width = width;
+          rawv_height = height;
+          pending_frames[i].swap(intensities);
+          // whichever thread completes the next frame in order writes it and any that were waiting on it
+          while(!pending_frames.empty()&&pending_frames.begin()->first==next_rawv_frame){
+            rawv_writer->write_frame(rawv_width,rawv_height,&pending_frames.begin()->second[0],true,compress);
+            pending_frames.erase(pending_frames.begin());
+            next_rawv_frame++;
+          }
+          frame_written.notify_all();
+          continue;
+        }
+        std::stringstream fName;
+        fName << prefix;
+        if(!full_output_name_given){
+          int_t num_digits_frame = 0;
+          int_t decrement_subset = i;
+          if(i==0) num_digits_frame = 1;
+          else
+            while (decrement_subset){decrement_subset /= 10; num_digits_frame++;}
+          const int_t num_zeros = num_digits_total - num_digits_frame;
+          for(int_t j=0;j<num_zeros;++j)
+            fName << "0";
+          fName << i << suffix << (write_rawi ? ".rawi" : ".tif");
+        }
+        utils::write_image(fName.str().c_str(),width,height,&intensities[0],true,!write_rawi,compress);
       }
     }
-    image->write(fName.str());
+    catch(...){
+      std::lock_guard<std::mutex> lock(mutex);
+      if(!first_exception) first_exception = std::current_exception();
+      failed = true;
+      frame_written.notify_all();
+    }
+  };
+
+  const int_t num_workers = std::min(num_threads,num_output_frames);
+  std::vector<std::thread> workers;
+  for(int_t t=1;t<num_workers;++t)
+    workers.push_back(std::thread(convert_frames));
+  convert_frames();
+  for(size_t t=0;t<workers.size();++t)
+    workers[t].join();
+  if(first_exception)
+    std::rethrow_exception(first_exception);
+  if(rawv_writer){
+    assert(pending_frames.empty());
+    rawv_writer->close();
   }
 
   DICe::finalize();
 
   return 0;
 }
-
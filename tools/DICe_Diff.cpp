@@ -50,15 +50,371 @@
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_oblackholestream.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <exception>
 #include <map>
+#include <mutex>
 #include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
 
 using namespace DICe;
 
+/// the masthead line will have a different git sha1 for each file so skip it
+const std::string masthead = "DIGITAL";
+
+/// number of lines read from each file before the lines are compared
+const size_t diff_chunk_size = 8192;
+
+/// options that apply to every comparison
+struct Diff_Options{
+  /// constructor
+  Diff_Options():
+    rel_tol(1.0E-6),
+    floor(0.0),
+    use_floor(false),
+    numerical_values_only(false),
+    num_procs(1),
+    num_threads(1),
+    stop_on_failure(false),
+    delimiter(" ,\r"){}
+  /// relative tolerance
+  scalar_t rel_tol;
+  /// values below the floor in the gold file are not tested
+  scalar_t floor;
+  /// true if the floor is active
+  bool use_floor;
+  /// only compare the numerical values
+  bool numerical_values_only;
+  /// number of processors the second file was split over
+  int_t num_procs;
+  /// number of threads
+  int_t num_threads;
+  /// stop at the first difference
+  bool stop_on_failure;
+  /// token delimiters
+  std::string delimiter;
+};
+
+/// result of comparing one line
+enum Line_Result{
+  LINE_SAME=0,
+  LINE_DIFF,
+  /// the lines can't be compared, no more lines of the file are compared after this one
+  LINE_INCOMPATIBLE
+};
+
+/// \brief compares the tokens of two lines, returns true if they differ
+/// \param tokensA tokens from the gold file
+/// \param tokensB tokens from the file being tested (same number of tokens as tokensA)
+/// \param options the comparison options
+/// \param parallel_file true if tokensB is from one of the files of a parallel run (the difference and floor are evaluated the way the parallel comparison always has)
+/// \param badTokenIds [out] ids of the tokens that differ
+/// \param badTokenTypes [out] type of each of the tokens that differ ("n" numeric, "s" string)
+bool tokens_differ(const std::vector<std::string> & tokensA,
+  const std::vector<std::string> & tokensB,
+  const Diff_Options & options,
+  const bool parallel_file,
+  std::vector<int_t> & badTokenIds,
+  std::vector<std::string> & badTokenTypes){
+  bool line_diff = false;
+  for(size_t i=0;i<tokensA.size();++i){
+    // number
+    if(DICe::is_number(tokensA[i])){
+      assert(DICe::is_number(tokensB[i]));
+      scalar_t valA = strtod(tokensA[i].c_str(),NULL);
+      scalar_t valB = strtod(tokensB[i].c_str(),NULL);
+      scalar_t diff = parallel_file && valA != 0.0 ? std::abs(valA - valB) : std::abs((valA - valB)/valA);
+      const bool tiny = (std::abs(valA) + std::abs(valB) < 1.0E-8);
+      const bool below_floor = std::abs(valA) < options.floor && (!parallel_file || valA!=0.0);
+      if(!below_floor||!options.use_floor){
+        if(!tiny && diff > options.rel_tol){
+          line_diff = true;
+          badTokenIds.push_back(i);
+          badTokenTypes.push_back("n");
+        }
+      }
+    }
+    // string
+    else{
+      assert(!DICe::is_number(tokensB[i]));
+      if(tokensA[i]!=tokensB[i] && !options.numerical_values_only)
+        line_diff = true;
+      badTokenIds.push_back(i);
+      badTokenTypes.push_back("s");
+    }
+  }
+  return line_diff;
+}
+
+/// writes the two versions of a line that differs
+void print_line_diff(std::ostream & out,
+  const int_t line,
+  const std::vector<std::string> & tokensA,
+  const std::vector<std::string> & tokensB,
+  const std::vector<int_t> & badTokenIds,
+  const std::vector<std::string> & badTokenTypes){
+  out << "< " << line << " (";
+  for(size_t i=0;i<badTokenIds.size();++i){
+    out << badTokenIds[i] << "[" << badTokenTypes[i] << "] ";
+  }
+  out  << "): ";
+  for(size_t i=0;i<tokensA.size();++i)
+    out << tokensA[i] << " ";
+  out << "\n";
+  out << "> " << line << " (";
+  for(size_t i=0;i<badTokenIds.size();++i){
+    out << badTokenIds[i] << "[" << badTokenTypes[i] << "] ";
+  }
+  out  << "): ";
+  for(size_t i=0;i<tokensB.size();++i)
+    out << tokensB[i] << " ";
+  out << "\n";
+}
+
+/// compares one line of two serial files, the message is only set if the lines differ
+Line_Result compare_line(const std::string & lineA,
+  const std::string & lineB,
+  const Diff_Options & options,
+  const int_t line,
+  std::string & message){
+  std::vector<std::string> tokensA = DICe::tokenize_line(lineA,options.delimiter);
+  std::vector<std::string> tokensB = DICe::tokenize_line(lineB,options.delimiter);
+  if(tokensA.size()>=2){
+    if(tokensA[1].find(masthead)!=std::string::npos){ // skip the masthead
+      return LINE_SAME;
+    }
+  }
+  if(tokensA.size()!=tokensB.size()){
+    std::stringstream ss;
+    ss << "Error, Different number of tokens per line A:" << tokensA.size() << " B: " << tokensB.size() << "\n";
+    message = ss.str();
+    return LINE_INCOMPATIBLE;
+  }
+  std::vector<int_t> badTokenIds;
+  std::vector<std::string> badTokenTypes;
+  if(!tokens_differ(tokensA,tokensB,options,false,badTokenIds,badTokenTypes))
+    return LINE_SAME;
+  std::stringstream ss;
+  print_line_diff(ss,line,tokensA,tokensB,badTokenIds,badTokenTypes);
+  message = ss.str();
+  return LINE_DIFF;
+}
+
+/// \brief compares two serial files line by line and returns the number of errors
+///
+/// The files are streamed a chunk of lines at a time. Reading is sequential, the lines of a chunk are
+/// split and compared on num_threads threads and the differences are reported in line order.
+/// (white space is ignored)
+int_t diff_serial_files(const std::string & fileA,
+  const std::string & fileB,
+  const Diff_Options & options,
+  const int_t num_threads,
+  std::ostream & out,
+  std::atomic<bool> & stop){
+  std::fstream dataFileA(fileA.c_str(), std::ios_base::in | std::ios_base::binary);
+  assert(dataFileA.good());
+  std::fstream dataFileB(fileB.c_str(), std::ios_base::in | std::ios_base::binary);
+  assert(dataFileB.good());
+
+  int_t errorFlag = 0;
+  int_t line = 0;
+  bool done = false;
+  bool b_is_short = false;
+  std::vector<std::string> linesA;
+  std::vector<std::string> linesB;
+  std::vector<Line_Result> results;
+  std::vector<std::string> messages;
+  while(!done&&!dataFileA.eof()&&!stop){
+    // read the next chunk of lines
+    linesA.clear();
+    linesB.clear();
+    while(linesA.size()<diff_chunk_size&&!dataFileA.eof()){
+      if(dataFileB.eof()){
+        b_is_short = true;
+        break;
+      }
+      linesA.push_back(std::string());
+      linesB.push_back(std::string());
+      DICe::safeGetline(dataFileA,linesA.back());
+      DICe::safeGetline(dataFileB,linesB.back());
+    }
+    const int_t num_lines = linesA.size();
+    results.assign(num_lines,LINE_SAME);
+    messages.assign(num_lines,std::string());
+    auto compare_lines = [&](const int_t begin, const int_t end){
+      for(int_t i=begin;i<end;++i)
+        results[i] = compare_line(linesA[i],linesB[i],options,line+i,messages[i]);
+    };
+    const int_t num_workers = std::max(1,std::min(num_threads,num_lines/64));
+    std::vector<std::thread> workers;
+    for(int_t t=1;t<num_workers;++t)
+      workers.push_back(std::thread(compare_lines,(int_t)((int64_t)num_lines*t/num_workers),(int_t)((int64_t)num_lines*(t+1)/num_workers)));
+    compare_lines(0,num_lines/num_workers);
+    for(size_t t=0;t<workers.size();++t)
+      workers[t].join();
+    // report the differences in order
+    for(int_t i=0;i<num_lines;++i){
+      if(results[i]==LINE_SAME) continue;
+      out << messages[i];
+      errorFlag++;
+      if(results[i]==LINE_INCOMPATIBLE||options.stop_on_failure){
+        done = true;
+        break;
+      }
+    }
+    line += num_lines;
+  }
+  if(b_is_short&&!done){
+    out << "Error, File A has more lines than FileB " << std::endl;
+    errorFlag++;
+  }
+  dataFileA.close();
+  dataFileB.close();
+  if(errorFlag>0&&options.stop_on_failure) stop = true;
+  return errorFlag;
+}
+
+/// \brief compares a serial file with the files written by each processor of a parallel run and returns the number of errors
+///
+/// The first file is assumed to be serial (contains all data points), the second name is the base name of the files
+/// that are split among the processors. Each processor's file is compared on its own thread.
+int_t diff_parallel_files(const std::string & fileA,
+  const std::string & fileB,
+  const Diff_Options & options,
+  const int_t num_threads,
+  std::ostream & out,
+  std::atomic<bool> & stop){
+  int_t errorFlag  = 0;
+  const int_t num_procs = options.num_procs;
+  // read all of the number line from A and store in a map
+  std::map<int_t,std::vector<std::string> > fileASolutions;
+  std::fstream dataFileA(fileA.c_str(), std::ios_base::in | std::ios_base::binary);
+  while (!dataFileA.eof())
+  {
+    std::vector<std::string> tokens = DICe::tokenize_line(dataFileA,options.delimiter);
+    if(tokens.size()==0) continue;
+    if(!DICe::is_number(tokens[0])) continue;
+    // check that the first number is an integer (presumed an id)
+    // if ids have been omitted this will fail
+    const scalar_t remainder = strtod(tokens[0].c_str(),NULL) - std::floor(strtod(tokens[0].c_str(),NULL));
+    TEUCHOS_TEST_FOR_EXCEPTION(remainder!=0.0,std::runtime_error,
+      "Error, first column in the output file must be the subset or node id "
+      "(cannot ommit the id in the output parameters to compare parallel files)");
+    fileASolutions.insert(std::pair<int_t,std::vector<std::string> >(std::strtol(tokens[0].c_str(),NULL,0),tokens));
+  }
+  dataFileA.close();
+  // now that the offsets are set up, compare the files one processor chunk at a time
+  std::vector<std::set<int_t> > proc_compared_ids(num_procs);
+  std::vector<std::stringstream> proc_out(num_procs);
+  std::vector<int_t> proc_errors(num_procs,0);
+  std::atomic<int_t> next_proc(0);
+  std::mutex mutex;
+  std::exception_ptr first_exception;
+  auto compare_procs = [&](){
+    try{
+      for(int_t proc=next_proc++;proc<num_procs&&!stop;proc=next_proc++){
+        std::ostream & proc_stream = proc_out[proc];
+        std::stringstream name;
+        name << fileB << "." << num_procs << "." << proc << ".txt";
+        // read the number of lines in each file:
+        std::fstream dataFileB(name.str().c_str(), std::ios_base::in | std::ios_base::binary);
+        assert(dataFileB.good());
+        int_t par_line = 0;
+        while (!dataFileB.eof()&&!stop)
+        {
+          std::vector<int_t> badTokenIds;
+          std::vector<std::string> badTokenTypes;
+          std::vector<std::string> tokensB = DICe::tokenize_line(dataFileB,options.delimiter);
+          if(tokensB.size()==0) continue;
+          if(!DICe::is_number(tokensB[0])) continue;
+          const scalar_t remainder = strtod(tokensB[0].c_str(),NULL) - std::floor(strtod(tokensB[0].c_str(),NULL));
+          TEUCHOS_TEST_FOR_EXCEPTION(remainder!=0.0,std::runtime_error,
+            "Error, first column in the parallel output file must be the subset or node id "
+            "(cannot ommit the id in the output parameters to compare parallel files)");
+          const int_t subset_id = std::strtol(tokensB[0].c_str(),NULL,0);
+          // find that row in the saved data:
+          TEUCHOS_TEST_FOR_EXCEPTION(fileASolutions.find(subset_id)==fileASolutions.end(),std::runtime_error,
+            "Error could not find parallel subset " << subset_id << " in serial file");
+          const std::vector<std::string> & tokensA = fileASolutions.find(subset_id)->second;
+          proc_compared_ids[proc].insert(subset_id);
+          assert(tokensA.size()!=0);
+          if(tokensA.size()!=tokensB.size()){
+            proc_stream << "Error, output files are not compatible (read error)" << std::endl;
+            proc_errors[proc]++;
+            break;
+          }
+          if(tokens_differ(tokensA,tokensB,options,true,badTokenIds,badTokenTypes)){
+            proc_errors[proc]++;
+            print_line_diff(proc_stream,par_line,tokensA,tokensB,badTokenIds,badTokenTypes);
+            if(options.stop_on_failure){
+              stop = true;
+              break;
+            }
+          } // end line diff
+          par_line++;
+        } // end dataFileB.eof() loop
+        proc_stream << "proc " << proc << " number of lines compared " << par_line << std::endl;
+        assert(par_line>0||stop);
+        dataFileB.close();
+      }
+    }
+    catch(...){
+      std::lock_guard<std::mutex> lock(mutex);
+      if(!first_exception) first_exception = std::current_exception();
+      stop = true;
+    }
+  };
+  const int_t num_workers = std::max(1,std::min(num_threads,num_procs));
+  std::vector<std::thread> workers;
+  for(int_t t=1;t<num_workers;++t)
+    workers.push_back(std::thread(compare_procs));
+  compare_procs();
+  for(size_t t=0;t<workers.size();++t)
+    workers[t].join();
+  if(first_exception)
+    std::rethrow_exception(first_exception);
+  std::set<int_t> compared_ids;
+  for(int_t proc=0;proc<num_procs;++proc){
+    out << proc_out[proc].str();
+    errorFlag += proc_errors[proc];
+    compared_ids.insert(proc_compared_ids[proc].begin(),proc_compared_ids[proc].end());
+  }
+  if(errorFlag>0&&options.stop_on_failure) return errorFlag;
+  // check that all the ids were compared
+  std::map<int_t,std::vector<std::string> >::iterator it=fileASolutions.begin();
+  std::map<int_t,std::vector<std::string> >::iterator it_end=fileASolutions.end();
+  bool missing_value = false;
+  for(;it!=it_end;++it){
+    if(compared_ids.find(it->first)==compared_ids.end())missing_value = true;
+  }
+  if(missing_value){
+    out << "Error, some ids in the serial output file were not present in any of the parallel output files" << std::endl;
+    errorFlag++;
+    if(options.stop_on_failure) stop = true;
+  }
+  return errorFlag;
+}
+
+/// compares two files (or a serial file and a set of parallel files) and returns the number of errors
+int_t diff_files(const std::string & fileA,
+  const std::string & fileB,
+  const Diff_Options & options,
+  const int_t num_threads,
+  std::ostream & out,
+  std::atomic<bool> & stop){
+  if(options.num_procs > 1)
+    return diff_parallel_files(fileA,fileB,options,num_threads,out,stop);
+  return diff_serial_files(fileA,fileB,options,num_threads,out,stop);
+}
+
 int main(int argc, char *argv[]) {
 
-  /// usage ./DICe_Diff <infileA> <infileB or base name for parallel> [-t <tol>] [-f <value>] [-v] [-n] [-p <count>]
+  /// usage ./DICe_Diff <infileA> <infileB or base name for parallel> [-t <tol>] [-f <value>] [-v] [-n] [-p <count>] [-j <count>] [-x]
+  ///    or ./DICe_Diff -l <list_file> [options]
   /// Note: if this is a parallel comparison, this exec assumes that the first file is serail (contains all data points)
   /// the second file listed is the one that is split among several processors so only the base name is specified and the
   /// rest of the name is determined based on the number of procs
@@ -68,23 +424,23 @@ int main(int argc, char *argv[]) {
   Teuchos::oblackholestream bhs; // outputs nothing
   Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&bhs, false);
   int_t errorFlag  = 0;
-  scalar_t relTol = 1.0E-6;
-  scalar_t floor = 0.0;
-  bool use_floor = false;
-  std::string delimiter = " ,\r";
-  bool numerical_values_only = false;
+  Diff_Options options;
 
   if(argc==2){
     std::string help = argv[1];
     if(help=="-h"){
       std::cout << " DICe_Diff (compares two DICe output files, numerical and string values) " << std::endl;
       std::cout << " Syntax: DICe_Diff <fileA> <fileB> [options] " << std::endl;
+      std::cout << "     or: DICe_Diff -l <list_file> [options] " << std::endl;
+      std::cout << "         (each line of the list file has the names of a gold file and a file to compare with it)" << std::endl;
       std::cout << " Options: -h show help message " << std::endl;
       std::cout << "          -v verbose " << std::endl;
       std::cout << "          -t <tol> relative tolerance " << std::endl;
       std::cout << "          -f <value> floor, values below the floor in the gold file will not be tested" << std::endl;
       std::cout << "          -n numerical values only" << std::endl;
       std::cout << "          -p <count> parallel output number of processors" << std::endl;
+      std::cout << "          -j <count> number of threads (files of a list, or chunks of lines of a single file, are compared at the same time)" << std::endl;
+      std::cout << "          -x stop at the first difference" << std::endl;
       exit(0);
     }
   }
@@ -99,11 +455,8 @@ int main(int argc, char *argv[]) {
     DEBUG_MSG(argv[i]);
   }
 
-  std::string masthead = "DIGITAL"; // the masthead line will have a different git sha1 for each file so skip it
-
   // TODO add delimeter option
 
-  int_t num_procs = 1;
   for(int_t i=3;i<argc;++i){
     char safe_argv[MAX_BUFFER_SIZE];
     safe_buffer_copy(argv[i],safe_argv);
@@ -111,28 +464,39 @@ int main(int argc, char *argv[]) {
       outStream = Teuchos::rcp(&std::cout, false);
     }
     else if(strcmp(safe_argv,"-n")==0){
-      numerical_values_only = true;
+      options.numerical_values_only = true;
+    }
+    else if(strcmp(safe_argv,"-x")==0){
+      options.stop_on_failure = true;
     }
     else if(strcmp(safe_argv,"-t")==0){
       assert(argc>i+1 && "Error, tolerance must be specified for -t option");
       char safe_argv_p1[MAX_BUFFER_SIZE];
       safe_buffer_copy(argv[i+1],safe_argv_p1);
-      relTol = strtod(safe_argv_p1,NULL);
+      options.rel_tol = strtod(safe_argv_p1,NULL);
       i++;
     }
     else if(strcmp(safe_argv,"-p")==0){
       assert(argc>i+1 && "Error, count must be specified for -p option");
       char safe_argv_p1[MAX_BUFFER_SIZE];
       safe_buffer_copy(argv[i+1],safe_argv_p1);
-      num_procs = strtol(safe_argv_p1,NULL,0);
+      options.num_procs = strtol(safe_argv_p1,NULL,0);
+      i++;
+    }
+    else if(strcmp(safe_argv,"-j")==0){
+      assert(argc>i+1 && "Error, count must be specified for -j option");
+      char safe_argv_p1[MAX_BUFFER_SIZE];
+      safe_buffer_copy(argv[i+1],safe_argv_p1);
+      options.num_threads = strtol(safe_argv_p1,NULL,0);
+      TEUCHOS_TEST_FOR_EXCEPTION(options.num_threads<1,std::runtime_error,"Error, the number of threads must be at least 1");
       i++;
     }
     else if(strcmp(safe_argv,"-f")==0){
       assert(argc>i+1 && "Error, floor value must be specified for -f option");
       char safe_argv_p1[MAX_BUFFER_SIZE];
       safe_buffer_copy(argv[i+1],safe_argv_p1);
-      floor = strtod(safe_argv_p1,NULL);
-      use_floor = true;
+      options.floor = strtod(safe_argv_p1,NULL);
+      options.use_floor = true;
       i++;
     }
     else{
@@ -140,217 +504,79 @@ int main(int argc, char *argv[]) {
       TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, unrecognized option");
     }
   }
-  std::string fileA = argv[1];
-  std::string fileB = argv[2];
-  *outStream << "File A:                " << fileA << std::endl;
-  *outStream << "File B (or base name): " << fileB << std::endl;
-  *outStream << "Relative Tol:          " << relTol << std::endl;
-  *outStream << "Floor value:           " << floor << " active " << use_floor << std::endl;
-  *outStream << "Number of processors:  " << num_procs << std::endl;
 
-  if(num_procs > 1){
-    // read all of the number line from A and store in a map
-    std::map<int_t,std::vector<std::string> > fileASolutions;
-    std::fstream dataFileA(fileA.c_str(), std::ios_base::in | std::ios_base::binary);
-    while (!dataFileA.eof())
-    {
-      std::vector<std::string> tokens = DICe::tokenize_line(dataFileA,delimiter);
+  // pairs of files to compare
+  std::vector<std::pair<std::string,std::string> > pairs;
+  const bool list_mode = std::string(argv[1])=="-l";
+  if(list_mode){
+    std::fstream list_file(argv[2], std::ios_base::in);
+    TEUCHOS_TEST_FOR_EXCEPTION(!list_file.good(),std::runtime_error,"Error, could not open the list file " << argv[2]);
+    while(!list_file.eof()){
+      std::vector<std::string> tokens = DICe::tokenize_line(list_file," \t\r",false);
       if(tokens.size()==0) continue;
-      if(!DICe::is_number(tokens[0])) continue;
-      // check that the first number is an integer (presumed an id)
-      // if ids have been omitted this will fail
-      const scalar_t remainder = strtod(tokens[0].c_str(),NULL) - std::floor(strtod(tokens[0].c_str(),NULL));
-      TEUCHOS_TEST_FOR_EXCEPTION(remainder!=0.0,std::runtime_error,
-        "Error, first column in the output file must be the subset or node id "
-        "(cannot ommit the id in the output parameters to compare parallel files)");
-      fileASolutions.insert(std::pair<int_t,std::vector<std::string> >(std::strtol(tokens[0].c_str(),NULL,0),tokens));
-    }
-    dataFileA.close();
-    // now that the offsets are set up, compare the files one processor chunk at a time
-    std::set<int_t> compared_ids;
-    for(int_t i=0;i<num_procs;++i){
-      std::stringstream name;
-      name << fileB << "." << num_procs << "." << i << ".txt";
-      // read the number of lines in each file:
-      std::fstream dataFileB(name.str().c_str(), std::ios_base::in | std::ios_base::binary);
-      assert(dataFileB.good());
-      int_t par_line = 0;
-      while (!dataFileB.eof())
-      {
-        bool line_diff = false;
-        std::vector<int_t> badTokenIds;
-        std::vector<std::string> badTokenTypes;
-        std::vector<std::string> tokensB = DICe::tokenize_line(dataFileB,delimiter);
-        if(tokensB.size()==0) continue;
-        if(!DICe::is_number(tokensB[0])) continue;
-        const scalar_t remainder = strtod(tokensB[0].c_str(),NULL) - std::floor(strtod(tokensB[0].c_str(),NULL));
-        TEUCHOS_TEST_FOR_EXCEPTION(remainder!=0.0,std::runtime_error,
-          "Error, first column in the parallel output file must be the subset or node id "
-          "(cannot ommit the id in the output parameters to compare parallel files)");
-        const int_t subset_id = std::strtol(tokensB[0].c_str(),NULL,0);
-        // find that row in the saved data:
-        TEUCHOS_TEST_FOR_EXCEPTION(fileASolutions.find(subset_id)==fileASolutions.end(),std::runtime_error,
-          "Error could not find parallel subset " << subset_id << " in serial file");
-        std::vector<std::string> tokensA = fileASolutions.find(subset_id)->second;
-        compared_ids.insert(subset_id);
-        if(tokensB.size()==0) break;
-        bool read_error = false;
-        assert(tokensA.size()!=0);
-        assert(tokensB.size()!=0);
-        read_error = !DICe::is_number(tokensA[0]);
-        read_error = !DICe::is_number(tokensB[0]);
-        read_error = tokensA.size()!=tokensB.size();
-        if(read_error){
-          *outStream << "Error, output files are not compatible (read error)" << std::endl;
-          errorFlag++;
-          break;
-        }
-        for(size_t i=0;i<tokensA.size();++i){
-          // number
-          if(DICe::is_number(tokensA[i])){
-            assert(DICe::is_number(tokensB[i]));
-            scalar_t valA = strtod(tokensA[i].c_str(),NULL);
-            scalar_t valB = strtod(tokensB[i].c_str(),NULL);
-            scalar_t diff = valA == 0.0 ? std::abs((valA - valB)/valA) : std::abs(valA - valB);
-            const bool tiny = (std::abs(valA) + std::abs(valB) < 1.0E-8);
-            const bool below_floor = std::abs(valA) < floor && valA!=0.0;
-            if(!below_floor||!use_floor){
-              if(!tiny && diff > relTol){
-                line_diff = true;
-                badTokenIds.push_back(i);
-                badTokenTypes.push_back("n");
-              }
-            }
-          }
-          // string
-          else{
-            assert(!DICe::is_number(tokensB[i]));
-            if(tokensA[i]!=tokensB[i] && !numerical_values_only)
-              line_diff = true;
-            badTokenIds.push_back(i);
-            badTokenTypes.push_back("s");
-          }
-        } // end token iteration
-        if(line_diff){
-          errorFlag++;
-          *outStream << "< " << par_line << " (";
-          for(size_t i=0;i<badTokenIds.size();++i){
-            *outStream << badTokenIds[i] << "[" << badTokenTypes[i] << "] ";
-          }
-          *outStream  << "): ";
-          for(size_t i=0;i<tokensA.size();++i)
-            *outStream << tokensA[i] << " ";
-          *outStream << std::endl;
-          *outStream << "> " << par_line << " (";
-          for(size_t i=0;i<badTokenIds.size();++i){
-            *outStream << badTokenIds[i] << "[" << badTokenTypes[i] << "] ";
-          }
-          *outStream  << "): ";
-          for(size_t i=0;i<tokensB.size();++i)
-            *outStream << tokensB[i] << " ";
-          *outStream << std::endl;
-        } // end line diff
-        par_line++;
-      } // end dataFileB.eof() loop
-      *outStream << "proc " << i << " number of lines compared " << par_line << std::endl;
-      assert(par_line>0);
-      dataFileB.close();
-    } // end of parallel loop
-    // check that all the ids were compared
-    std::map<int_t,std::vector<std::string> >::iterator it=fileASolutions.begin();
-    std::map<int_t,std::vector<std::string> >::iterator it_end=fileASolutions.end();
-    bool missing_value = false;
-    for(;it!=it_end;++it){
-      if(compared_ids.find(it->first)==compared_ids.end())missing_value = true;
-    }
-    if(missing_value){
-      *outStream << "Error, some ids in the serial output file were not present in any of the parallel output files" << std::endl;
-      errorFlag++;
+      TEUCHOS_TEST_FOR_EXCEPTION(tokens.size()!=2,std::runtime_error,"Error, each line of the list file must have two file names");
+      pairs.push_back(std::pair<std::string,std::string>(tokens[0],tokens[1]));
     }
+    *outStream << "List file:             " << argv[2] << std::endl;
+    *outStream << "Number of comparisons: " << pairs.size() << std::endl;
   }
   else{
-    // read the two files line by line and compare both
-    // (white space is ignored)
-    std::fstream dataFileA(fileA.c_str(), std::ios_base::in | std::ios_base::binary);
-    assert(dataFileA.good());
-    std::fstream dataFileB(fileB.c_str(), std::ios_base::in | std::ios_base::binary);
-    assert(dataFileB.good());
+    pairs.push_back(std::pair<std::string,std::string>(argv[1],argv[2]));
+    *outStream << "File A:                " << pairs[0].first << std::endl;
+    *outStream << "File B (or base name): " << pairs[0].second << std::endl;
+  }
+  *outStream << "Relative Tol:          " << options.rel_tol << std::endl;
+  *outStream << "Floor value:           " << options.floor << " active " << options.use_floor << std::endl;
+  *outStream << "Number of processors:  " << options.num_procs << std::endl;
+  *outStream << "Number of threads:     " << options.num_threads << std::endl;
 
-    // read each line of the file
-    int_t line = 0;
-    while (!dataFileA.eof())
-    {
-      bool line_diff = false;
-      std::vector<int_t> badTokenIds;
-      std::vector<std::string> badTokenTypes;
-      if(dataFileB.eof()) {
-        *outStream << "Error, File A has more lines than FileB " << std::endl;
-        errorFlag++;
-        break;
-      }
-      std::vector<std::string> tokensA = DICe::tokenize_line(dataFileA,delimiter);
-      std::vector<std::string> tokensB = DICe::tokenize_line(dataFileB,delimiter);
-      if(tokensA.size()>=2){
-        if(tokensA[1].find(masthead)!=std::string::npos){ // skip the masthead
-          line++;
-          continue;
-        }
-      }
-      if(tokensA.size()!=tokensB.size()){
-        *outStream << "Error, Different number of tokens per line A:" << tokensA.size() << " B: " << tokensB.size() << std::endl;
-        errorFlag++;
-        break;
+  // the files are spread over the threads, any threads left over go to the chunks of each file
+  const int_t num_pairs = pairs.size();
+  const int_t num_workers = std::max(1,std::min(options.num_threads,num_pairs));
+  const int_t threads_per_pair = std::max(1,options.num_threads/std::max(1,num_pairs));
+  std::vector<std::stringstream> pair_out(num_pairs);
+  std::vector<int_t> pair_errors(num_pairs,0);
+  std::vector<bool> pair_compared(num_pairs,false);
+  std::atomic<int_t> next_pair(0);
+  std::atomic<bool> stop(false);
+  std::mutex mutex;
+  std::exception_ptr first_exception;
+  auto compare_pairs = [&](){
+    try{
+      for(int_t i=next_pair++;i<num_pairs&&!stop;i=next_pair++){
+        pair_errors[i] = diff_files(pairs[i].first,pairs[i].second,options,threads_per_pair,pair_out[i],stop);
+        pair_compared[i] = true;
       }
-      for(size_t i=0;i<tokensA.size();++i){
-        // number
-        if(DICe::is_number(tokensA[i])){
-          assert(DICe::is_number(tokensB[i]));
-          scalar_t valA = strtod(tokensA[i].c_str(),NULL);
-          scalar_t valB = strtod(tokensB[i].c_str(),NULL);
-          scalar_t diff = std::abs((valA - valB)/valA);
-          const bool tiny = (std::abs(valA) + std::abs(valB) < 1.0E-8);
-          const bool below_floor = std::abs(valA) < floor;
-          if(!below_floor||!use_floor){
-            if(!tiny && diff > relTol){
-              line_diff = true;
-              badTokenIds.push_back(i);
-              badTokenTypes.push_back("n");
-            }
-          }
-        }
-        // string
-        else{
-          assert(!DICe::is_number(tokensB[i]));
-          if(tokensA[i]!=tokensB[i] && !numerical_values_only)
-            line_diff = true;
-          badTokenIds.push_back(i);
-          badTokenTypes.push_back("s");
-        }
-      }
-      if(line_diff){
-        errorFlag++;
-        *outStream << "< " << line << " (";
-        for(size_t i=0;i<badTokenIds.size();++i){
-          *outStream << badTokenIds[i] << "[" << badTokenTypes[i] << "] ";
-        }
-        *outStream  << "): ";
-        for(size_t i=0;i<tokensA.size();++i)
-          *outStream << tokensA[i] << " ";
-        *outStream << std::endl;
-        *outStream << "> " << line << " (";
-        for(size_t i=0;i<badTokenIds.size();++i){
-          *outStream << badTokenIds[i] << "[" << badTokenTypes[i] << "] ";
-        }
-        *outStream  << "): ";
-        for(size_t i=0;i<tokensB.size();++i)
-          *outStream << tokensB[i] << " ";
-        *outStream << std::endl;
-      }
-      line++;
     }
-    dataFileA.close();
-    dataFileB.close();
-  } // end serial comparison
+    catch(...){
+      std::lock_guard<std::mutex> lock(mutex);
+      if(!first_exception) first_exception = std::current_exception();
+      stop = true;
+    }
+  };
+  std::vector<std::thread> workers;
+  for(int_t t=1;t<num_workers;++t)
+    workers.push_back(std::thread(compare_pairs));
+  compare_pairs();
+  for(size_t t=0;t<workers.size();++t)
+    workers[t].join();
+  if(first_exception)
+    std::rethrow_exception(first_exception);
+
+  for(int_t i=0;i<num_pairs;++i){
+    if(list_mode){
+      *outStream << "File A: " << pairs[i].first << std::endl;
+      *outStream << "File B: " << pairs[i].second << std::endl;
+    }
+    *outStream << pair_out[i].str();
+    errorFlag += pair_errors[i];
+    if(list_mode){
+      if(!pair_compared[i])
+        std::cout << "Not compared: " << pairs[i].first << " " << pairs[i].second << std::endl;
+      else if(pair_errors[i]!=0)
+        std::cout << "Failed:       " << pairs[i].first << " " << pairs[i].second << std::endl;
+    }
+  }
   DICe::finalize();
 
   if (errorFlag != 0){
@@ -363,4 +589,3 @@ int main(int argc, char *argv[]) {
   return 0;
 
 }
-
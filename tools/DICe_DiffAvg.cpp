@@ -39,7 +39,13 @@
 // ************************************************************************
 // @HEADER
 
+/*! \file  DICe_DiffAvg.cpp
+    \brief Utility for averaging a column of one or more results files and diffing the averages against a command file
+*/
+
 #include <DICe.h>
+#include <DICe_ResultsIO.h>
+
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_oblackholestream.hpp>
 #include <Teuchos_ParameterList.hpp>
@@ -47,14 +53,170 @@
 
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <cassert>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 using namespace DICe;
 
+/// running statistics of the values that share a coordinate
+struct Coord_Stats{
+  /// constructor
+  Coord_Stats():
+    num_values(0),
+    sum(0.0),
+    m2(0.0),
+    min_value(0.0),
+    max_value(0.0){}
+  /// add a value
+  void add(const scalar_t & value){
+    if(num_values==0){
+      min_value = value;
+      max_value = value;
+    }
+    if(value < min_value) min_value = value;
+    if(value > max_value) max_value = value;
+    const scalar_t delta = num_values==0 ? 0.0 : value - sum/num_values;
+    num_values++;
+    sum += value;
+    m2 += delta*(value - sum/num_values);
+  }
+  /// merge the statistics of another set of values
+  void merge(const Coord_Stats & other){
+    if(other.num_values==0) return;
+    if(num_values==0){
+      *this = other;
+      return;
+    }
+    const scalar_t delta = other.sum/other.num_values - sum/num_values;
+    const int_t total = num_values + other.num_values;
+    m2 += other.m2 + delta*delta*num_values*other.num_values/total;
+    num_values = total;
+    sum += other.sum;
+    if(other.min_value < min_value) min_value = other.min_value;
+    if(other.max_value > max_value) max_value = other.max_value;
+  }
+  /// number of values
+  int_t num_values;
+  /// sum of the values
+  scalar_t sum;
+  /// sum of the squared differences from the mean
+  scalar_t m2;
+  /// minimum value
+  scalar_t min_value;
+  /// maximum value
+  scalar_t max_value;
+};
+
+/// \brief splits a comma separated line into fields (the record is reused to avoid allocations)
+/// \param line the line to split
+/// \param record [out] the fields
+void split_record(const string & line,
+  vector<string> & record){
+  size_t num_fields = 0;
+  size_t start = 0;
+  while(start<line.size()){
+    size_t end = line.find(',',start);
+    if(end==string::npos) end = line.size();
+    if(record.size()<=num_fields) record.resize(num_fields+1);
+    record[num_fields].assign(line,start,end-start);
+    num_fields++;
+    start = end + 1;
+  }
+  record.resize(num_fields);
+}
+
+/// returns true if the file is a binary results file written by Binary_Results_Writer
+bool is_binary_results_file(const string & file_name){
+  return file_name.size()>4&&file_name.substr(file_name.size()-4)==".dbr";
+}
+
+/// \brief streams a comma separated text file and accumulates the values of one column for each coordinate
+/// \param file_name the name of the file
+/// \param num_header_rows the number of rows to skip
+/// \param coord_col the coordinate column
+/// \param data_col the data column
+/// \param stats [out] the statistics for each coordinate
+/// returns the number of rows read
+int_t accumulate_text_file(const string & file_name,
+  const int_t num_header_rows,
+  const int_t coord_col,
+  const int_t data_col,
+  map<int_t,Coord_Stats> & stats){
+  ifstream file(file_name.c_str());
+  TEUCHOS_TEST_FOR_EXCEPTION(!file.good(),std::runtime_error,"Error, could not open file " << file_name);
+  // get rid of the header rows:
+  string s;
+  for(int_t i=0;i<num_header_rows;++i){
+    getline(file,s);
+  }
+  // read the data one row at a time
+  vector<string> record;
+  int_t num_rows = 0;
+  while(getline(file,s)){
+    if(s.empty()||s=="\r") continue;
+    split_record(s,record);
+    TEUCHOS_TEST_FOR_EXCEPTION((int_t)record.size()<=coord_col||(int_t)record.size()<=data_col,std::runtime_error,
+      "Error, row " << num_rows << " of file " << file_name << " has only " << record.size() << " columns");
+    const int_t coord = static_cast<int_t>(strtod(record[coord_col].c_str(),NULL));
+    stats[coord].add(strtod(record[data_col].c_str(),NULL));
+    num_rows++;
+  }
+  if(!file.eof()){
+    cerr << "EOF Error Ocurred in file " << file_name << "\n";
+  }
+  return num_rows;
+}
+
+/// \brief accumulates the values of one column of a frame of a binary results file for each coordinate
+///
+/// the columns are numbered as in the text output (column 0 is SUBSET_ID, column i is field i-1)
+/// \param file_name the name of the file
+/// \param frame_index the frame to read (negative counts back from the last frame, -1 is the last frame)
+/// \param coord_col the coordinate column
+/// \param data_col the data column
+/// \param stats [out] the statistics for each coordinate
+/// returns the number of rows read
+int_t accumulate_binary_file(const string & file_name,
+  const int_t frame_index,
+  const int_t coord_col,
+  const int_t data_col,
+  map<int_t,Coord_Stats> & stats){
+  Binary_Results_Reader reader(file_name);
+  const int_t num_frames = reader.num_frames();
+  const int_t frame = frame_index < 0 ? num_frames + frame_index : frame_index;
+  TEUCHOS_TEST_FOR_EXCEPTION(frame<0||frame>=num_frames,std::runtime_error,
+    "Error, frame index " << frame_index << " is not valid for file " << file_name << " which has " << num_frames << " frames");
+  TEUCHOS_TEST_FOR_EXCEPTION(coord_col<0||coord_col>reader.num_fields()||data_col<0||data_col>reader.num_fields(),std::runtime_error,
+    "Error, invalid column for file " << file_name << " which has " << reader.num_fields() + 1 << " columns");
+  const int_t num_subsets = reader.num_subsets();
+  const vector<string> & field_names = reader.field_names();
+  vector<scalar_t> coord_values(num_subsets);
+  vector<scalar_t> data_values(num_subsets);
+  if(coord_col==0)
+    for(int_t i=0;i<num_subsets;++i) coord_values[i] = reader.subset_ids()[i];
+  else
+    reader.read_field(frame,field_names[coord_col-1],coord_values);
+  if(data_col==0)
+    for(int_t i=0;i<num_subsets;++i) data_values[i] = reader.subset_ids()[i];
+  else
+    reader.read_field(frame,field_names[data_col-1],data_values);
+  for(int_t i=0;i<num_subsets;++i){
+    // the text output is rounded to "%4.4E" so round the same way to get the same coordinates
+    char buffer[32];
+    snprintf(buffer,sizeof(buffer),"%4.4E",coord_values[i]);
+    stats[static_cast<int_t>(strtod(buffer,NULL))].add(data_values[i]);
+  }
+  return num_subsets;
+}
+
 int main(int argc, char *argv[]) {
 
   DICe::initialize(argc, argv);
@@ -76,8 +238,16 @@ int main(int argc, char *argv[]) {
   assert(params!=Teuchos::null);
 
   // check that all the required params are given:
-  assert(params->isParameter("input_file"));
-  const std::string input_file = params->get<std::string>("input_file");
+  // the input is either one file (input_file) or a list of files (the input_files sublist) whose values are averaged together
+  assert(params->isParameter("input_file")||params->isSublist("input_files"));
+  std::vector<std::string> input_files;
+  if(params->isParameter("input_file"))
+    input_files.push_back(params->get<std::string>("input_file"));
+  if(params->isSublist("input_files")){
+    Teuchos::ParameterList input_files_list = params->sublist("input_files");
+    for(Teuchos::ParameterList::ConstIterator it=input_files_list.begin();it!=input_files_list.end();++it)
+      input_files.push_back(input_files_list.get<std::string>(it->first));
+  }
   assert(params->isParameter("num_header_rows"));
   const int_t num_header_rows = params->get<int_t>("num_header_rows");
   assert(params->isParameter("collect_averages_for_unique_values_in_column"));
@@ -99,6 +269,14 @@ int main(int argc, char *argv[]) {
     outStream = Teuchos::rcp(&std::cout, false);
   const double rel_tol = params->get<double>("relative_tolerance",1.0E-6);
   const double compare_factor = params->get<double>("compare_factor",1.0);
+  // frame of the binary results files to average (negative counts back from the last frame)
+  const int_t binary_frame_index = params->get<int_t>("binary_frame_index",-1);
+  int_t num_threads = 1;
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+  num_threads = params->get<int_t>("num_threads",num_threads);
+  TEUCHOS_TEST_FOR_EXCEPTION(num_threads<1,std::runtime_error,"Error, num_threads must be greater than 0");
 
   params->print(*outStream);
 
@@ -106,8 +284,12 @@ int main(int argc, char *argv[]) {
   // the values will be summed over all y values for the given x and divided by the number of y values
   // The command data can have more points than the input data, but values should
   // be available in the command data at every point that is in the input data (TODO add interpolation)
+  // The files are streamed one row at a time so only the running statistics for each coordinate are held in memory.
+  // Files ending in .dbr are read as binary results files, the columns are numbered as in the text output
 
-  *outStream << "File name " << input_file << std::endl;
+  *outStream << "Num input files: " << input_files.size() << std::endl;
+  for(size_t i=0;i<input_files.size();++i)
+    *outStream << "File name " << input_files[i] << std::endl;
   *outStream << "Command File name " << command_file_name << std::endl;
   *outStream << "Num header rows: " << num_header_rows << std::endl;
   *outStream << "Num command header rows: " << command_num_header_rows << std::endl;
@@ -115,137 +297,97 @@ int main(int argc, char *argv[]) {
   *outStream << "Data column: " << data_col << std::endl;
   *outStream << "Command coord column: " << command_coord_col << std::endl;
   *outStream << "Command data column: " << command_data_col << std::endl;
-  vector <vector <string> > results;
-  ifstream file(input_file.c_str());
-  assert(file.good());
-  // get rid of the header rows:
-  string s;
-  for(int_t i=0;i<num_header_rows;++i){
-    getline(file,s);
-  }
-  // read the data
-  while (file)
-  {
-    if (!getline( file, s )) break;
-    istringstream ss( s );
-    vector <string> record;
-    while (ss)
-    {
-      string s;
-      if (!getline( ss, s, ',' )) break;
-      record.push_back( s );
+  *outStream << "Num threads: " << num_threads << std::endl;
+
+  // the files are read concurrently, each into its own statistics, then merged in file order
+  const int_t num_files = input_files.size();
+  std::vector<std::map<int_t,Coord_Stats> > file_stats(num_files);
+  std::vector<int_t> file_rows(num_files,0);
+  std::vector<std::string> file_errors(num_files);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic,1)
+  for(int_t i=0;i<num_files;++i){
+    try{
+      if(is_binary_results_file(input_files[i]))
+        file_rows[i] = accumulate_binary_file(input_files[i],binary_frame_index,coord_col,data_col,file_stats[i]);
+      else
+        file_rows[i] = accumulate_text_file(input_files[i],num_header_rows,coord_col,data_col,file_stats[i]);
+    }
+    catch(std::exception & e){
+      file_errors[i] = e.what();
     }
-    results.push_back( record );
   }
-  if (!file.eof())
-  {
-    cerr << "EOF Error Ocurred !\n";
+  std::map<int_t,Coord_Stats> sortedMap;
+  int_t num_rows = 0;
+  for(int_t i=0;i<num_files;++i){
+    TEUCHOS_TEST_FOR_EXCEPTION(!file_errors[i].empty(),std::runtime_error,file_errors[i]);
+    *outStream << "Number of rows in data for file " << input_files[i] << ": " << file_rows[i] << std::endl;
+    num_rows += file_rows[i];
+    for(std::map<int_t,Coord_Stats>::const_iterator it=file_stats[i].begin();it!=file_stats[i].end();++it)
+      sortedMap[it->first].merge(it->second);
+    // release the memory for this file as soon as it is merged
+    std::map<int_t,Coord_Stats>().swap(file_stats[i]);
   }
-  *outStream << "Number of columns in data: " << results[0].size() << std::endl;
-  *outStream << "Number of rows in data: " << results.size() << std::endl;
-  file.close();
-
+  TEUCHOS_TEST_FOR_EXCEPTION(num_rows==0,std::runtime_error,"Error, no data rows were read from the input files");
+  *outStream << "Number of rows in data: " << num_rows << std::endl;
 
-  // sort the data according to either x or y:
-  std::map<int_t,std::vector<scalar_t> > sortedMap;
-  for(size_t row=0;row<results.size();++row){
-    scalar_t coordReal = strtod(results[row][coord_col].c_str(),NULL);
-    int_t coord = static_cast<int_t>(coordReal);
-    //int_t coord = strtol(results[row][coord_col].c_str(),NULL,0);
-    scalar_t value = strtod(results[row][data_col].c_str(),NULL);
-    if(sortedMap.find(coord)==sortedMap.end()){
-      std::vector<scalar_t> tmp_vec;
-      sortedMap.insert(std::pair<int_t,std::vector<scalar_t> >(coord,tmp_vec));
-    }
-    sortedMap.find(coord)->second.push_back(value);
-  }
   // average the values
   std::vector<int_t> coords;
   std::vector<scalar_t> avg_values;
   std::vector<scalar_t> std_dev_values;
   std::vector<scalar_t> max_values;
   std::vector<scalar_t> min_values;
-  std::map<int_t,std::vector<scalar_t> > ::iterator map_it = sortedMap.begin();
-  for(;map_it!=sortedMap.end();++map_it){
-    int_t num_values = map_it->second.size();
-    assert(num_values!=0);
-    int_t coord = map_it->first;
-    scalar_t avg_value = 0.0;
-    for(int_t i=0;i<num_values;++i){
-      avg_value += map_it->second[i];
-    }
-    avg_value /= num_values;
-    coords.push_back(coord);
-    avg_values.push_back(avg_value*compare_factor);
-  }
-
-  map_it = sortedMap.begin();
-  int_t v_index = 0;
+  std::map<int_t,Coord_Stats>::const_iterator map_it = sortedMap.begin();
   for(;map_it!=sortedMap.end();++map_it){
-    int_t num_values = map_it->second.size();
-    scalar_t std_dev = 0.0;
-    scalar_t min_value = map_it->second[0];
-    scalar_t max_value = map_it->second[0];
-    for(int_t i=0;i<num_values;++i){
-      if(map_it->second[i] > max_value)
-        max_value = map_it->second[i];
-      if(map_it->second[i] < min_value)
-        min_value = map_it->second[i];
-      std_dev += (map_it->second[i] - avg_values[v_index])*(map_it->second[i] - avg_values[v_index]);
-    }
-    std_dev /= num_values;
-    std_dev = std::sqrt(std_dev);
-    std_dev_values.push_back(std_dev);
-    max_values.push_back(max_value);
-    min_values.push_back(min_value);
-    v_index++;
+    const Coord_Stats & stats = map_it->second;
+    assert(stats.num_values!=0);
+    const scalar_t mean = stats.sum/stats.num_values;
+    const scalar_t avg_value = mean*compare_factor;
+    coords.push_back(map_it->first);
+    avg_values.push_back(avg_value);
+    // the deviation is measured from the scaled average
+    std_dev_values.push_back(std::sqrt(stats.m2/stats.num_values + (mean - avg_value)*(mean - avg_value)));
+    max_values.push_back(stats.max_value);
+    min_values.push_back(stats.min_value);
   }
   TEUCHOS_TEST_FOR_EXCEPTION(std_dev_values.size()!=avg_values.size(),std::runtime_error,"Error, these two vectors should be the same size.");
 
   // command data
 
-  vector <vector <string> > command;
   ifstream command_file(command_file_name.c_str());
   assert(command_file.good());
   // get rid of the header rows:
+  string s;
   for(int_t i=0;i<command_num_header_rows;++i){
     getline(command_file,s);
   }
-  // read the data
-  while (command_file)
-  {
-    if (!getline( command_file, s )) break;
-    istringstream ss( s );
-    vector <string> record;
-    while (ss)
-    {
-      string s;
-      if (!getline( ss, s, ',' )) break;
-      record.push_back( s );
-    }
-    command.push_back( record );
+  // read the data and sort it according to either x or y:
+  std::map<int_t,scalar_t> commandMap;
+  vector<string> record;
+  size_t num_command_cols = 0;
+  int_t num_command_rows = 0;
+  while(getline(command_file,s)){
+    if(s.empty()||s=="\r") continue;
+    split_record(s,record);
+    if(num_command_rows==0) num_command_cols = record.size();
+    TEUCHOS_TEST_FOR_EXCEPTION((int_t)record.size()<=command_coord_col||(int_t)record.size()<=command_data_col,std::runtime_error,
+      "Error, row " << num_command_rows << " of the command file has only " << record.size() << " columns");
+    scalar_t coordReal = strtod(record[command_coord_col].c_str(),NULL);
+    int_t coord = static_cast<int_t>(coordReal);
+    scalar_t value = strtod(record[command_data_col].c_str(),NULL);
+    commandMap.insert(std::pair<int_t,scalar_t >(coord,value));
+    num_command_rows++;
   }
   if (!command_file.eof())
   {
     cerr << "Command EOF Error Ocurred !\n";
   }
-  *outStream << "Number of columns in command: " << command[0].size() << std::endl;
-  *outStream << "Number of rows in command: " << command.size() << std::endl;
-  if(command[0].size()!=command[command.size()-1].size()){
+  *outStream << "Number of columns in command: " << num_command_cols << std::endl;
+  *outStream << "Number of rows in command: " << num_command_rows << std::endl;
+  if(num_command_rows==0||num_command_cols!=record.size()){
     cerr << "The last row does not have the right number of columns" << std::endl;
     assert(false);
   }
   command_file.close();
-
-  // sort the data according to either x or y:
-  std::map<int_t,scalar_t> commandMap;
-  for(size_t row=0;row<command.size();++row){
-    scalar_t coordReal = strtod(command[row][command_coord_col].c_str(),NULL);
-    int_t coord = static_cast<int_t>(coordReal);
-    //int_t coord = strtol(command[row][command_coord_col].c_str(),NULL,0);
-    scalar_t value = strtod(command[row][command_data_col].c_str(),NULL);
-    commandMap.insert(std::pair<int_t,scalar_t >(coord,value));
-  }
   *outStream << " The command map has " << commandMap.size() << " entries" << std::endl;
 
   // test the values:
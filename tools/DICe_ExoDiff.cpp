@@ -61,14 +61,16 @@ using namespace DICe;
 int main(int argc, char *argv[]) {
 
   // config_file format: 2 columns field_name tolerance, one row for each field to check (must be a valid field), no commas, just a space separator
+  // an optional -x after the config file stops the comparison at the first field and step that is over the tolerance
 
   DICe::initialize(argc, argv);
 
   Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&std::cout, false);
   int_t errorFlag = 0;
 
-  if(argc!=4){
-    *outStream << "Invalid number of command line parameters. Usage: ./DICe_ExoDiff <exodus_file_A> <exodus_file_B> <config_file>" << std::endl;
+  const bool stop_on_failure = argc==5&&std::string(argv[4])=="-x";
+  if(argc!=4&&!stop_on_failure){
+    *outStream << "Invalid number of command line parameters. Usage: ./DICe_ExoDiff <exodus_file_A> <exodus_file_B> <config_file> [-x]" << std::endl;
     std::cout << "End Result: TEST FAILED\n";
     return 1;
   }
@@ -146,8 +148,14 @@ int main(int argc, char *argv[]) {
   *outStream << std::left << std::setw(5) <<"Step";
   *outStream << std::left << std::setw(15) <<"Error" << std::endl;
 
+  // keep both files open while streaming the fields step by step
+  DICe::mesh::Exodus_Field_Reader reader_a(file_a_name);
+  DICe::mesh::Exodus_Field_Reader reader_b(file_b_name);
+  std::vector<scalar_t> a_field;
+  std::vector<scalar_t> b_field;
+
   // check that the fields are valid for both meshes
-  for(size_t i=0;i<field_names.size();++i){
+  for(size_t i=0;i<field_names.size()&&!(stop_on_failure&&errorFlag>0);++i){
     bool field_found_in_a = false;
     bool field_found_in_b = false;
     int_t var_index_a = 0;
@@ -169,8 +177,8 @@ int main(int argc, char *argv[]) {
 
     // iterate all steps in the file
     for(int_t time_step=1;time_step<=num_steps_a;++time_step){
-      std::vector<scalar_t> a_field = DICe::mesh::read_exodus_field(mesh_a,var_index_a,time_step);
-      std::vector<scalar_t> b_field = DICe::mesh::read_exodus_field(mesh_b,var_index_b,time_step);
+      reader_a.read(var_index_a,time_step,a_field);
+      reader_b.read(var_index_b,time_step,b_field);
 
       scalar_t error = 0.0;
       for(int_t node=0;node<num_nodes_a;++node){
@@ -183,6 +191,7 @@ int main(int argc, char *argv[]) {
       if(error > tols[i]){
         *outStream << "Error, difference is greater than the tolerance for field: " << field_names[i] << " step " << time_step << " error " << error << std::endl;
         errorFlag++;
+        if(stop_on_failure) break;
       }
     }
   }
@@ -62,14 +62,198 @@
 #include "opencv2/imgproc.hpp"
 #include "opencv2/photo.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <string>
 #include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace cv;
 
 using namespace DICe;
 
+/// \brief maps the field values of one step onto the pixels, fills in the gaps, takes the fft and checks the power spectra
+/// returns false if the step failed (the output for the step is written to out)
+/// \param step the step number
+/// \param values the field values at the nodes
+/// \param on_part true for the pixels that are near the nodes
+/// \param stencil_ids for each pixel on the part, the ids of its num_neigh neighbors
+/// \param stencil_weights the weight of each neighbor in the projected value of the pixel
+/// \param num_neigh the number of neighbors of each pixel
+/// \param img_w the image width
+/// \param img_h the image height
+/// \param min_value the minimum value of the field over all steps
+/// \param counts_per_unit conversion factor from field values to intensity counts
+/// \param freq_thresh the frequency threshold for a step to pass
+/// \param output_debug_images true if the images and ffts should be written
+/// \param num_fft_threads the number of threads to use for the fft
+/// \param out the output stream for this step
+bool process_step(const int_t step,
+  const std::vector<scalar_t> & values,
+  const std::vector<char> & on_part,
+  const std::vector<int_t> & stencil_ids,
+  const std::vector<scalar_t> & stencil_weights,
+  const int_t num_neigh,
+  const int_t img_w,
+  const int_t img_h,
+  const scalar_t min_value,
+  const scalar_t counts_per_unit,
+  const scalar_t freq_thresh,
+  const bool output_debug_images,
+  const int_t num_fft_threads,
+  std::ostream & out){
+  out << "*** processing step: " << step << std::endl;
+  // check for a null field
+  scalar_t field_sum = 0.0;
+  for(size_t i=0;i<values.size();++i)
+    field_sum += values[i];
+  if(field_sum==0.0){
+    out << "*** NULL STEP" << std::endl;
+    return true;
+  }
+
+  // populate the image values near the nodes (excluding gaps)
+  std::vector<scalar_t> projected_values(img_w*img_h,0.0);
+  for(int_t px=0;px<img_w*img_h;++px){
+    if(!on_part[px]) continue;
+    const size_t offset = (size_t)px*num_neigh;
+    scalar_t value = 0.0;
+    for(int_t j=0;j<num_neigh;++j)
+      value += stencil_weights[offset+j]*values[stencil_ids[offset+j]];
+    projected_values[px] = value;
+  }
+
+  Teuchos::RCP<DICe::Image> image = Teuchos::rcp(new DICe::Image(img_w,img_h,0.0));
+  Teuchos::ArrayRCP<intensity_t> intensities = image->intensities();
+
+  Mat cv_img, cv_mask, cv_inpainted;
+  cv_img.create(img_h, img_w, CV_8UC(1));
+  cv_mask.create(img_h, img_w, CV_8UC(1));
+  cv_inpainted.create(img_h, img_w, CV_8UC(1));
+
+  // step two is to convert the projected values of the field to image intensity values
+  // populate the image values:
+  for(int_t px_j=0;px_j<img_h;++px_j){
+    for(int_t px_i=0;px_i<img_w;++px_i){
+      // convert the value to counts and put it in the image:
+      intensity_t count_value = (projected_values[px_j*img_w+px_i] - min_value)*counts_per_unit;
+      if(on_part[px_j*img_w+px_i])
+        intensities[px_j*img_w+px_i] = count_value;
+      cv_img.at<uchar>(px_j,px_i) = count_value;
+      cv_mask.at<uchar>(px_j,px_i) = 0;
+      if(!on_part[px_j*img_w+px_i]){
+        cv_mask.at<uchar>(px_j,px_i) = 255;
+      }
+    }
+  }
+
+  //int_t largest_dim = img_w > img_h ? img_w : img_h;
+  //inpaint(cv_img,cv_mask,cv_inpainted,largest_dim/16,INPAINT_TELEA);
+  inpaint(cv_img,cv_mask,cv_inpainted,31,INPAINT_TELEA);
+
+  for(int_t px_j=0;px_j<img_h;++px_j){
+    for(int_t px_i=0;px_i<img_w;++px_i){
+      if(!on_part[px_j*img_w+px_i])
+        intensities[px_j*img_w+px_i] = cv_inpainted.at<uchar>(px_j,px_i);
+    }
+  }
+  // filter to remove interpolation artifacts
+  image->gauss_filter(13);
+  image->gauss_filter(13);
+  //image->gauss_filter(13);
+
+  // window the time to exclude the boundary:
+  const int_t buffer = 10; //px
+  const int_t buf_img_w = img_w - 2*buffer;
+  const int_t buf_img_h = img_h - 2*buffer;
+  assert(buf_img_h!=0);
+  assert(buf_img_w!=0);
+  Teuchos::RCP<DICe::Image> buf_image = Teuchos::rcp(new DICe::Image(buf_img_w,buf_img_h,0.0));
+  Teuchos::ArrayRCP<intensity_t> buf_intensities = buf_image->intensities();
+  for(int_t px_j=0;px_j<buf_img_h;++px_j){
+    for(int_t px_i=0;px_i<buf_img_w;++px_i){
+      buf_intensities[px_j*buf_img_w+px_i] = intensities[(px_j+buffer)*img_w+px_i+buffer];
+    }
+  }
+
+  std::stringstream out_name;
+  out_name << "step_" << step << ".tif";
+  //imwrite("cv_field.tif",cv_img);
+  //imwrite("cv_field_mask.tif",cv_mask);
+  //imwrite("cv_field_inpaint.tif",cv_inpainted);
+  if(output_debug_images)
+    buf_image->write(out_name.str());
+//    image->write(out_name.str());
+  Teuchos::RCP<Image> image_fft = DICe::image_fft(buf_image,true,true,100.0,true,false,num_fft_threads);
+  Teuchos::ArrayRCP<intensity_t> fft_intensities = image_fft->intensities();
+  std::stringstream out_name_fft;
+  out_name_fft << "fft_step_" << step << ".tif";
+  if(output_debug_images)
+    image_fft->write(out_name_fft.str());
+
+  // compute how much of the power spectra is below the threshold
+  std::stringstream power_x_name;
+  std::stringstream power_y_name;
+  power_x_name << "fft_power_x_" << step << ".txt";
+  power_y_name << "fft_power_y_" << step << ".txt";
+  std::FILE * powerXFilePtr = fopen(power_x_name.str().c_str(),"w");
+  std::FILE * powerYFilePtr = fopen(power_y_name.str().c_str(),"w");
+  scalar_t max_power_x = 0.0;
+  scalar_t max_freq_x = 0.0;
+  scalar_t max_power_y = 0.0;
+  scalar_t max_freq_y = 0.0;
+
+  scalar_t total_power = 0.0;
+  for(int_t px_j=buf_img_h/2;px_j<buf_img_h;++px_j){
+    for(int_t px_i=buf_img_w/2;px_i<buf_img_w;++px_i){
+      total_power += fft_intensities[px_j*buf_img_w+px_i];
+    }
+  }
+  if(total_power==0.0) total_power = 1.0;
+
+  for(int_t px_j=buf_img_h/2;px_j<buf_img_h;++px_j){
+    scalar_t power_y = 0.0;
+    scalar_t freq = 0.5 * (px_j-buf_img_h/2)*2.0/buf_img_h;
+    for(int_t px_i=buf_img_w/2;px_i<buf_img_w;++px_i){
+      power_y += fft_intensities[px_j*buf_img_w+px_i];
+    }
+    if(power_y > max_power_y){
+      max_power_y = power_y;
+      max_freq_y = freq;
+    }
+    fprintf(powerYFilePtr,"%f,%f\n",freq,power_y/total_power);
+  }
+  for(int_t px_i=buf_img_w/2;px_i<buf_img_w;++px_i){
+    scalar_t power_x = 0.0;
+    scalar_t freq = 0.5 * (px_i-buf_img_w/2)*2.0/buf_img_w;
+    for(int_t px_j=buf_img_h/2;px_j<buf_img_h;++px_j){
+      power_x += fft_intensities[px_j*buf_img_w+px_i];
+    }
+    if(power_x > max_power_x){
+      max_power_x = power_x;
+      max_freq_x = freq;
+    }
+    fprintf(powerXFilePtr,"%f,%f\n",freq,power_x/total_power);
+  }
+  fclose(powerXFilePtr);
+  fclose(powerYFilePtr);
+
+  out << "*** max power x: " << max_power_x/total_power << " at freq " << max_freq_x << " to " << max_freq_x + 1.0/buf_img_w << std::endl;
+  out << "*** max power y: " << max_power_y/total_power << " at freq " << max_freq_y << " to " << max_freq_y + 1.0/buf_img_h << std::endl;
+
+  if(max_freq_x < freq_thresh && max_freq_y < freq_thresh){
+    out << "*** STEP PASSED! ***" << std::endl;
+    return true;
+  }
+  out << "*** STEP FAILED! ***" << std::endl;
+  return false;
+}
+
 int main(int argc, char *argv[]) {
 
   DICe::initialize(argc, argv);
@@ -187,6 +371,10 @@ int main(int argc, char *argv[]) {
   std::cout << "max z: " << max_z << std::endl;
   std::cout << "avg z: " << avg_z << std::endl;
 
+  // keep the exodus file open while streaming the field values step by step
+  DICe::mesh::Exodus_Field_Reader field_reader(exo_name);
+  const int_t field_var_index = field_reader.var_index(field_name);
+
   // iterate the field values to get the stats:
   scalar_t min_value = std::numeric_limits<scalar_t>::max();
   scalar_t max_value = std::numeric_limits<scalar_t>::min();
@@ -195,7 +383,7 @@ int main(int argc, char *argv[]) {
     final_step = num_time_steps;
 
   for(int_t step=1;step<=num_time_steps;++step){
-    values = mesh::read_exodus_field(exo_name,field_name,step);
+    field_reader.read(field_var_index,step,values);
     if(values.size()<=0){
       std::cout << "Error, reading field failed" << std::endl;
       exit(-1);
@@ -292,62 +480,33 @@ int main(int argc, char *argv[]) {
 
   std::FILE * resultsFilePtr = fopen("results.txt","w");
 
-  // create an image to store the values for each step
-
-  scalar_t query_pt[3];
-  std::vector<size_t> ret_index(num_neigh);
-  std::vector<scalar_t> out_dist_sqr(num_neigh);
-  const int_t N = 3;
-  int *IPIV = new int[N+1];
-  int LWORK = N*N;
-  int INFO = 0;
-  double *WORK = new double[LWORK];
-  // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
-  Teuchos::LAPACK<int,double> lapack;
-
-  Teuchos::ArrayRCP<double> u(num_neigh,0.0);
-  Teuchos::ArrayRCP<double> X_t_u(N,0.0);
-  Teuchos::ArrayRCP<double> coeffs(N,0.0);
-  Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_neigh, true);
-  Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
-
-  // break the image mapping up into two steps
-  // the first populates the portions of an image that are near the nodes (excluding gaps)
-
-  std::vector<scalar_t> projected_values(img_w*img_h,0.0);
-  std::vector<bool> on_part(img_w*img_h,false);
-
-  bool all_steps_passed = true;
-  //for(int_t step=50;step<=50;++step){
-  for(int_t step=1;step<=final_step;++step){
-    std::cout << "*** processing step: " << step << std::endl;
-    values = mesh::read_exodus_field(exo_name,field_name,step);
-    if(values.size()<=0){
-      std::cout << "Error, reading field failed" << std::endl;
-      exit(-1);
-    }
-    if((int_t)values.size()!=num_nodes){
-      std::cout << "Error, values vector is the wrong size" << std::endl;
-      exit(-1);
-    }
-    // check for a null field
-    scalar_t field_sum = 0.0;
-    for(size_t i=0;i<values.size();++i)
-      field_sum += values[i];
-    if(field_sum==0.0){
-      std::cout << "*** NULL STEP" << std::endl;
-      continue;
-    }
-
-    // populate the image values:
+  // the nodes don't move from step to step so the neighbors and the least squares fit of each pixel are
+  // only computed once: the projected value of a pixel is the constant term of the fit, which is a
+  // weighted sum of the neighbor values. Pixels that are not near the nodes (gaps) are not on the part.
+  const int_t num_pixels = img_w*img_h;
+  std::vector<char> on_part(num_pixels,0);
+  std::vector<int_t> stencil_ids((size_t)num_pixels*num_neigh,0);
+  std::vector<scalar_t> stencil_weights((size_t)num_pixels*num_neigh,0.0);
+  std::cout << "computing the node to pixel mapping" << std::endl;
+#pragma omp parallel
+  {
+    scalar_t query_pt[3];
+    std::vector<size_t> ret_index(num_neigh);
+    std::vector<scalar_t> out_dist_sqr(num_neigh);
+    const int_t N = 3;
+    std::vector<int> IPIV(N+1);
+    int LWORK = N*N;
+    int INFO = 0;
+    std::vector<double> WORK(LWORK);
+    // Note, LAPACK does not allow templating on long int or scalar_t...must use int and double
+    Teuchos::LAPACK<int,double> lapack;
+    Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_neigh, true);
+    Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
+#pragma omp for schedule(dynamic,8)
     for(int_t px_j=0;px_j<img_h;++px_j){
       for(int_t px_i=0;px_i<img_w;++px_i){
         // clear the storage
         X_t_X.putScalar(0.0);
-        for(int_t i=0;i<N;++i){
-          X_t_u[i] = 0.0;
-          coeffs[i] = 0.0;
-        }
         scalar_t my_x = min_i + px_i*mm_per_pixel;
         scalar_t my_y = min_j + (img_h-px_j-1)*mm_per_pixel; // flipped because image coords are from the top down
         query_pt[0] = my_x;
@@ -358,10 +517,9 @@ int main(int argc, char *argv[]) {
         // check if the nearest neighbor is more than the node spacing away
         if(std::sqrt(out_dist_sqr[0]) > avg_dist_between_nodes*1.1) continue;
 
-        // iterate the neighbors and fit the data
+        // iterate the neighbors and set up the fit
         for(int_t neigh = 0;neigh<num_neigh; ++neigh){
           const int_t neigh_id = ret_index[neigh];
-          u[neigh] = values[neigh_id];
           // set up the X^T matrix
           X_t(0,neigh) = 1.0;
           X_t(1,neigh) = coords_x[neigh_id] - my_x;
@@ -375,153 +533,81 @@ int main(int argc, char *argv[]) {
             }
           }
         }
-        lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),IPIV,&INFO);
-        lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),IPIV,WORK,LWORK,&INFO);
-        // compute X^T*u
-        for(int_t i=0;i<N;++i){
-          for(int_t j=0;j<num_neigh;++j){
-            X_t_u[i] += X_t(i,j)*u[j];
-          }
-        }
-        // compute the coeffs
-        for(int_t i=0;i<N;++i){
-          for(int_t j=0;j<N;++j){
-            coeffs[i] += X_t_X(i,j)*X_t_u[j];
-          }
+        lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),&IPIV[0],&INFO);
+        lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),&IPIV[0],&WORK[0],LWORK,&INFO);
+        // the constant coefficient is the first row of (X^T*X)^-1*X^T times the neighbor values
+        const size_t offset = ((size_t)px_j*img_w+px_i)*num_neigh;
+        for(int_t j=0;j<num_neigh;++j){
+          scalar_t weight = 0.0;
+          for(int_t i=0;i<N;++i)
+            weight += X_t_X(0,i)*X_t(i,j);
+          stencil_ids[offset+j] = ret_index[j];
+          stencil_weights[offset+j] = weight;
         }
-        projected_values[px_j*img_w+px_i] = coeffs[0];
-        on_part[px_j*img_w+px_i] = true;
+        on_part[px_j*img_w+px_i] = 1;
       } // end image i
     } // end image j
+  }
 
-    Teuchos::RCP<DICe::Image> image = Teuchos::rcp(new DICe::Image(img_w,img_h,0.0));
-    Teuchos::ArrayRCP<intensity_t> intensities = image->intensities();
-
-    Mat cv_img, cv_mask, cv_inpainted;
-    cv_img.create(img_h, img_w, CV_8UC(1));
-    cv_mask.create(img_h, img_w, CV_8UC(1));
-    cv_inpainted.create(img_h, img_w, CV_8UC(1));
-
-    // step two is to convert the projected values of the field to image intensity values
-    // populate the image values:
-    for(int_t px_j=0;px_j<img_h;++px_j){
-      for(int_t px_i=0;px_i<img_w;++px_i){
-        // convert the value to counts and put it in the image:
-        intensity_t count_value = (projected_values[px_j*img_w+px_i] - min_value)*counts_per_unit;
-        if(on_part[px_j*img_w+px_i])
-          intensities[px_j*img_w+px_i] = count_value;
-        cv_img.at<uchar>(px_j,px_i) = count_value;
-        cv_mask.at<uchar>(px_j,px_i) = 0;
-        if(!on_part[px_j*img_w+px_i]){
-          cv_mask.at<uchar>(px_j,px_i) = 255;
-        }
-      }
-    }
-
-    //int_t largest_dim = img_w > img_h ? img_w : img_h;
-    //inpaint(cv_img,cv_mask,cv_inpainted,largest_dim/16,INPAINT_TELEA);
-    inpaint(cv_img,cv_mask,cv_inpainted,31,INPAINT_TELEA);
-
-    for(int_t px_j=0;px_j<img_h;++px_j){
-      for(int_t px_i=0;px_i<img_w;++px_i){
-        if(!on_part[px_j*img_w+px_i])
-          intensities[px_j*img_w+px_i] = cv_inpainted.at<uchar>(px_j,px_i);
-      }
-    }
-    // filter to remove interpolation artifacts
-    image->gauss_filter(13);
-    image->gauss_filter(13);
-    //image->gauss_filter(13);
-
-    // window the time to exclude the boundary:
-    const int_t buffer = 10; //px
-    const int_t buf_img_w = img_w - 2*buffer;
-    const int_t buf_img_h = img_h - 2*buffer;
-    assert(buf_img_h!=0);
-    assert(buf_img_w!=0);
-    Teuchos::RCP<DICe::Image> buf_image = Teuchos::rcp(new DICe::Image(buf_img_w,buf_img_h,0.0));
-    Teuchos::ArrayRCP<intensity_t> buf_intensities = buf_image->intensities();
-    for(int_t px_j=0;px_j<buf_img_h;++px_j){
-      for(int_t px_i=0;px_i<buf_img_w;++px_i){
-        buf_intensities[px_j*buf_img_w+px_i] = intensities[(px_j+buffer)*img_w+px_i+buffer];
-      }
-    }
-
-    std::stringstream out_name;
-    out_name << "step_" << step << ".tif";
-    //imwrite("cv_field.tif",cv_img);
-    //imwrite("cv_field_mask.tif",cv_mask);
-    //imwrite("cv_field_inpaint.tif",cv_inpainted);
-    if(output_debug_images)
-      buf_image->write(out_name.str());
-//    image->write(out_name.str());
-    Teuchos::RCP<Image> image_fft = DICe::image_fft(buf_image);
-    Teuchos::ArrayRCP<intensity_t> fft_intensities = image_fft->intensities();
-    std::stringstream out_name_fft;
-    out_name_fft << "fft_step_" << step << ".tif";
-    if(output_debug_images)
-      image_fft->write(out_name_fft.str());
-
-    // compute how much of the power spectra is below the threshold
-    std::stringstream power_x_name;
-    std::stringstream power_y_name;
-    power_x_name << "fft_power_x_" << step << ".txt";
-    power_y_name << "fft_power_y_" << step << ".txt";
-    std::FILE * powerXFilePtr = fopen(power_x_name.str().c_str(),"w");
-    std::FILE * powerYFilePtr = fopen(power_y_name.str().c_str(),"w");
-    scalar_t max_power_x = 0.0;
-    scalar_t max_freq_x = 0.0;
-    scalar_t max_power_y = 0.0;
-    scalar_t max_freq_y = 0.0;
-
-    scalar_t total_power = 0.0;
-    for(int_t px_j=buf_img_h/2;px_j<buf_img_h;++px_j){
-      for(int_t px_i=buf_img_w/2;px_i<buf_img_w;++px_i){
-        total_power += fft_intensities[px_j*buf_img_w+px_i];
-      }
-    }
-    if(total_power==0.0) total_power = 1.0;
+  // the steps are processed in batches, one step per thread, so only one batch of
+  // field values is held in memory at a time. The exodus reads are not thread safe so they are done
+  // up front for each batch and the output of each step is buffered and printed in step order.
+  int_t num_step_threads = 1;
+#ifdef _OPENMP
+  num_step_threads = omp_get_max_threads();
+#endif
+  num_step_threads = std::max(1,std::min(num_step_threads,final_step));
+  // if the steps are not split across the threads, the image ffts are threaded across all available cores
+  // (the fft plans come from the process wide plan cache so steps of the same size share them)
+  int_t num_fft_threads = 1;
+#ifdef _OPENMP
+  if(num_step_threads==1) num_fft_threads = omp_get_max_threads();
+#endif
+  std::cout << "steps processed at the same time: " << num_step_threads << std::endl;
 
-    for(int_t px_j=buf_img_h/2;px_j<buf_img_h;++px_j){
-      scalar_t power_y = 0.0;
-      scalar_t freq = 0.5 * (px_j-buf_img_h/2)*2.0/buf_img_h;
-      for(int_t px_i=buf_img_w/2;px_i<buf_img_w;++px_i){
-        power_y += fft_intensities[px_j*buf_img_w+px_i];
+  bool all_steps_passed = true;
+  std::vector<int_t> batch_steps;
+  std::vector<std::vector<scalar_t> > batch_values;
+  std::vector<std::stringstream> batch_out(num_step_threads);
+  std::vector<char> batch_passed(num_step_threads);
+  int_t step = 1;
+  while(step<=final_step){
+    // read the next batch of steps
+    batch_steps.clear();
+    batch_values.clear();
+    for(;step<=final_step&&(int_t)batch_steps.size()<num_step_threads;++step){
+      field_reader.read(field_var_index,step,values);
+      if(values.size()<=0){
+        std::cout << "Error, reading field failed" << std::endl;
+        exit(-1);
       }
-      if(power_y > max_power_y){
-        max_power_y = power_y;
-        max_freq_y = freq;
+      if((int_t)values.size()!=num_nodes){
+        std::cout << "Error, values vector is the wrong size" << std::endl;
+        exit(-1);
       }
-      fprintf(powerYFilePtr,"%f,%f\n",freq,power_y/total_power);
+      batch_steps.push_back(step);
+      batch_values.push_back(values);
     }
-    for(int_t px_i=buf_img_w/2;px_i<buf_img_w;++px_i){
-      scalar_t power_x = 0.0;
-      scalar_t freq = 0.5 * (px_i-buf_img_w/2)*2.0/buf_img_w;
-      for(int_t px_j=buf_img_h/2;px_j<buf_img_h;++px_j){
-        power_x += fft_intensities[px_j*buf_img_w+px_i];
+    const int_t batch_size = batch_steps.size();
+    std::string batch_error;
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_step_threads)
+    for(int_t b=0;b<batch_size;++b){
+      try{
+        batch_out[b].str("");
+        batch_passed[b] = process_step(batch_steps[b],batch_values[b],on_part,stencil_ids,stencil_weights,num_neigh,img_w,img_h,
+          min_value,counts_per_unit,freq_thresh,output_debug_images,num_fft_threads,batch_out[b]) ? 1 : 0;
       }
-      if(power_x > max_power_x){
-        max_power_x = power_x;
-        max_freq_x = freq;
+      catch(std::exception & e){
+#pragma omp critical
+        batch_error = e.what();
       }
-      fprintf(powerXFilePtr,"%f,%f\n",freq,power_x/total_power);
     }
-    fclose(powerXFilePtr);
-    fclose(powerYFilePtr);
-
-    std::cout << "*** max power x: " << max_power_x/total_power << " at freq " << max_freq_x << " to " << max_freq_x + 1.0/buf_img_w << std::endl;
-    std::cout << "*** max power y: " << max_power_y/total_power << " at freq " << max_freq_y << " to " << max_freq_y + 1.0/buf_img_h << std::endl;
-
-    if(max_freq_x < freq_thresh && max_freq_y < freq_thresh)
-      std::cout << "*** STEP PASSED! ***" << std::endl;
-    else{
-      std::cout << "*** STEP FAILED! ***" << std::endl;
-      all_steps_passed = false;
+    TEUCHOS_TEST_FOR_EXCEPTION(!batch_error.empty(),std::runtime_error,"Error, processing a step failed: " << batch_error);
+    for(int_t b=0;b<batch_size;++b){
+      std::cout << batch_out[b].str();
+      if(!batch_passed[b]) all_steps_passed = false;
     }
-
   } // end step loop
-  delete [] WORK;
-  delete [] IPIV;
 
   fclose(resultsFilePtr);
 
@@ -62,7 +62,7 @@ using namespace DICe;
 
 int main(int argc, char *argv[]) {
 
-  /// usage 1: ./DICe_ExoToNetCDF <exo_file_name> <input_netcdf_file> <netcdf_output_file_name> <number of neighbors>
+  /// usage 1: ./DICe_ExoToNetCDF <exo_file_name> <input_netcdf_file> <netcdf_output_file_name> <number of neighbors> [compression level]
   /// only works for serial exo file, only converts nodal variables
 
 
@@ -72,20 +72,23 @@ int main(int argc, char *argv[]) {
   std::string delimiter = " ,\r";
 
   // determine if the second argument is help, file name or folder name
-  if(argc!=5){
+  if(argc!=5&&argc!=6){
     std::cout << " DICe_ExoToNetCDF (exports a serial exodus file to NetCDF) " << std::endl;
-    std::cout << " Syntax: DICe_ExoToNetCDF <exodus_file_name> <netcdf_file_name> <output_file_name> <num_neighbors>" << std::endl;
+    std::cout << " Syntax: DICe_ExoToNetCDF <exodus_file_name> <netcdf_file_name> <output_file_name> <num_neighbors> [compression_level]" << std::endl;
+    std::cout << " compression_level (optional) 1 to 9 writes a compressed NetCDF-4 file, 0 (default) writes an uncompressed file" << std::endl;
     exit(-1);
   }
   std::string exo_name = argv[1];
   std::string netcdf_input_name = argv[2];
   std::string output_name = argv[3];
   const int_t num_neigh = std::strtol(argv[4],NULL,0);
+  const int_t compression_level = argc==6 ? std::strtol(argv[5],NULL,0) : 0;
 
   *outStream << "exodus input file:          " << exo_name << std::endl;
   *outStream << "netcdf input file:          " << netcdf_input_name << std::endl;
   *outStream << "output file:                " << output_name << std::endl;
   *outStream << "num neighbors to use for surface fit: " << num_neigh << std::endl;
+  *outStream << "compression level:          " << compression_level << std::endl;
 
   // read the properties of the exodus file:
   Teuchos::RCP<DICe::mesh::Mesh> mesh = DICe::mesh::read_exodus_mesh(exo_name,"dummy_output_name.e");
@@ -143,9 +146,17 @@ int main(int argc, char *argv[]) {
   if(has_uncertainty)
     output_field_names.push_back("UNCERTAINTY");
 
+  // keep the exodus file open while streaming the fields step by step
+  DICe::mesh::Exodus_Field_Reader field_reader(exo_name);
+  std::vector<int_t> field_var_indices(output_field_names.size()-1);
+  for(size_t j=0;j<field_var_indices.size();++j)
+    field_var_indices[j] = field_reader.var_index(output_field_names[j+1]);
+
   // read the subset coordinates:
-  std::vector<scalar_t> subset_coords_x = DICe::mesh::read_exodus_field(exo_name,"SUBSET_COORDINATES_X",1);
-  std::vector<scalar_t> subset_coords_y = DICe::mesh::read_exodus_field(exo_name,"SUBSET_COORDINATES_Y",1);
+  std::vector<scalar_t> subset_coords_x;
+  std::vector<scalar_t> subset_coords_y;
+  field_reader.read(field_reader.var_index("SUBSET_COORDINATES_X"),1,subset_coords_x);
+  field_reader.read(field_reader.var_index("SUBSET_COORDINATES_Y"),1,subset_coords_y);
   const int_t num_nodes = subset_coords_x.size();
   *outStream << "num subset coorindates: " << num_nodes << std::endl;
   // determine the extents of the subset coordinates
@@ -176,21 +187,85 @@ int main(int argc, char *argv[]) {
   kd_tree->buildIndex();
   *outStream << "kd-tree completed" << std::endl;
 
-  // temp storage
-  scalar_t query_pt[2];
-  std::vector<size_t> ret_index(num_neigh);
-  std::vector<scalar_t> out_dist_sqr(num_neigh);
-  const int_t N = 3;
-  int *IPIV = new int[N+1];
-  int LWORK = N*N;
-  int INFO = 0;
-  double *WORK = new double[LWORK];
-  double *GWORK = new double[10*N];
-  int *IWORK = new int[LWORK];
-  Teuchos::LAPACK<int,double> lapack;
+  // the pixels don't move from step to step so the neighbors and the least squares fit of each pixel
+  // are only computed once and stored as a stencil of weights: the value at a pixel is the weighted sum
+  // of its neighbors' values (the constant term of the linear fit). Pixels outside the domain have an
+  // empty stencil. The first neighbor of each stencil is the nearest one.
+  const int_t num_pixels = img_w*img_h;
+  std::vector<int_t> stencil_offsets(num_pixels+1,0);
+  for(int_t y=0;y<img_h;++y){
+    for(int_t x=0;x<img_w;++x){
+      const bool inside = !(x < min_x || x > max_x || y < min_y || y > max_y);
+      stencil_offsets[y*img_w+x+1] = inside ? num_neigh : 0;
+    }
+  }
+  for(int_t i=0;i<num_pixels;++i)
+    stencil_offsets[i+1] += stencil_offsets[i];
+  std::vector<int_t> stencil_ids(stencil_offsets[num_pixels]);
+  std::vector<scalar_t> stencil_weights(stencil_offsets[num_pixels]);
+  *outStream << "computing the interpolation stencils" << std::endl;
+#pragma omp parallel
+  {
+    // temp storage
+    scalar_t query_pt[2];
+    std::vector<size_t> ret_index(num_neigh);
+    std::vector<scalar_t> out_dist_sqr(num_neigh);
+    const int_t N = 3;
+    std::vector<int> IPIV(N+1);
+    int LWORK = N*N;
+    int INFO = 0;
+    std::vector<double> WORK(LWORK);
+    Teuchos::LAPACK<int,double> lapack;
+    Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_neigh, true);
+    Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
+#pragma omp for schedule(dynamic,16)
+    for(int_t y=0;y<img_h;++y){
+      for(int_t x=0;x<img_w;++x){
+        const int_t offset = stencil_offsets[y*img_w+x];
+        if(stencil_offsets[y*img_w+x+1]==offset) continue;
+        // determine the nearest num_neigh points to this pixel:
+        query_pt[0] = x;
+        query_pt[1] = y;
+        kd_tree->knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
+
+        X_t.putScalar(0.0);
+        X_t_X.putScalar(0.0);
+        for(int_t j=0;j<num_neigh;++j){
+          const int_t neigh_id = ret_index[j];
+          X_t(0,j) = 1.0;
+          X_t(1,j) = subset_coords_x[neigh_id] - x;
+          X_t(2,j) = subset_coords_y[neigh_id] - y;
+        }
+        // set up X^T*X
+        for(int_t k=0;k<N;++k){
+          for(int_t m=0;m<N;++m){
+            for(int_t j=0;j<num_neigh;++j){
+              X_t_X(k,m) += X_t(k,j)*X_t(m,j);
+            }
+          }
+        }
+        // Invert X^T*X
+        lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),&IPIV[0],&INFO);
+        lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),&IPIV[0],&WORK[0],LWORK,&INFO);
+
+        // the constant coefficient of the fit is the first row of (X^T*X)^-1*X^T times the neighbor values
+        for(int_t j=0;j<num_neigh;++j){
+          scalar_t weight = 0.0;
+          for(int_t i=0;i<N;++i)
+            weight += X_t_X(0,i)*X_t(i,j);
+          stencil_ids[offset+j] = ret_index[j];
+          stencil_weights[offset+j] = weight;
+        }
+      } // end x pixel loop
+    } // end y pixel loop
+  }
+  *outStream << "stencils completed" << std::endl;
 
   Teuchos::RCP<DICe::netcdf::NetCDF_Writer> netcdf_writer =
-      Teuchos::rcp(new DICe::netcdf::NetCDF_Writer(output_name.c_str(),img_w,img_h,num_netcdf_time_steps,output_field_names));
+      Teuchos::rcp(new DICe::netcdf::NetCDF_Writer(output_name.c_str(),img_w,img_h,num_netcdf_time_steps,output_field_names,false,compression_level));
+
+  // the field buffers are reused for each step
+  std::vector<std::vector<scalar_t> > exo_fields(output_field_names.size()-1);
 
   // iterate each step in the exodus file:
   for(int_t step=0;step<num_time_steps;++step){
@@ -208,86 +283,41 @@ int main(int argc, char *argv[]) {
     netcdf_writer->write_float_array("data",step,intens_float);
 
     // get each of the fields from the exodus mesh
-    std::vector<std::vector<scalar_t> > exo_fields(output_field_names.size()-1);
     std::vector<std::vector<float> > pixel_fields(output_field_names.size()-1,std::vector<float>(img_w*img_h));
     for(size_t j=0;j<exo_fields.size();++j)
-      exo_fields[j] = DICe::mesh::read_exodus_field(exo_name,output_field_names[j+1],step+1);
-
-    // iterate each pixel
-    for(int_t y=0;y<img_h;++y){
-      for(int_t x=0;x<img_w;++x){
+      field_reader.read(field_var_indices[j],step+1,exo_fields[j]);
+
+    // apply the stencils to each field
+    for(size_t f=0;f<exo_fields.size();++f){
+      // sigma get the nearest neighbor's value with no interpolation
+      const bool nearest_only = output_field_names[f+1]=="SIGMA";
+      const std::vector<scalar_t> & field = exo_fields[f];
+      std::vector<float> & pixel_field = pixel_fields[f];
+#pragma omp parallel for
+      for(int_t i=0;i<num_pixels;++i){
+        const int_t begin = stencil_offsets[i];
+        const int_t end = stencil_offsets[i+1];
         // pixels outside the domain get set to zero
-        if(x < min_x || x > max_x || y < min_y || y > max_y){
-          for(size_t f=0;f<exo_fields.size();++f){
-            pixel_fields[f][y*img_w+x] = 0.0;
-          }
+        if(begin==end){
+          pixel_field[i] = 0.0;
           continue;
         }
-        // determine the nearest num_neigh points to this pixel:
-        query_pt[0] = x;
-        query_pt[1] = y;
-        kd_tree->knnSearch(&query_pt[0], num_neigh, &ret_index[0], &out_dist_sqr[0]);
-
-        Teuchos::SerialDenseMatrix<int_t,double> X_t(N,num_neigh, true);
-        Teuchos::SerialDenseMatrix<int_t,double> X_t_X(N,N,true);
-        for(int_t j=0;j<num_neigh;++j){
-          const int_t neigh_id = ret_index[j];
-          X_t(0,j) = 1.0;
-          X_t(1,j) = subset_coords_x[neigh_id] - x;
-          X_t(2,j) = subset_coords_y[neigh_id] - y;
-        }
-        // set up X^T*X
-        for(int_t k=0;k<N;++k){
-          for(int_t m=0;m<N;++m){
-            for(int_t j=0;j<num_neigh;++j){
-              X_t_X(k,m) += X_t(k,j)*X_t(m,j);
-            }
-          }
+        if(nearest_only){
+          pixel_field[i] = field[stencil_ids[begin]];
+          continue;
         }
-        //X_t_X.print(std::cout);
-        // Invert X^T*X
-        lapack.GETRF(X_t_X.numRows(),X_t_X.numCols(),X_t_X.values(),X_t_X.numRows(),IPIV,&INFO);
-        lapack.GETRI(X_t_X.numRows(),X_t_X.values(),X_t_X.numRows(),IPIV,WORK,LWORK,&INFO);
-
-        // iterate over the fields and compute the projected values at the pixels
-        for(size_t f=0;f<exo_fields.size();++f){
-          Teuchos::ArrayRCP<double> u(num_neigh,0.0);
-          if(output_field_names[f+1]=="SIGMA"){ // sigma get the nearest neighbor's value with no interpolation
-            pixel_fields[f][y*img_w+x] = exo_fields[f][ret_index[0]];
-            continue;
-          }
-          for(int_t j=0;j<num_neigh;++j){
-            const int_t neigh_id = ret_index[j];
-            u[j] = exo_fields[f][neigh_id];
-          }
-          Teuchos::ArrayRCP<double> X_t_u(N,0.0);
-          for(int_t i=0;i<N;++i){
-            for(int_t j=0;j<num_neigh;++j){
-              X_t_u[i] += X_t(i,j)*u[j];
-            }
-          }
-          // compute the coeffs
-          Teuchos::ArrayRCP<double> coeffs(N,0.0);
-          for(int_t i=0;i<N;++i){
-            for(int_t j=0;j<N;++j){
-              coeffs[i] += X_t_X(i,j)*X_t_u[j];
-            }
-          }
-          pixel_fields[f][y*img_w+x] = (float)coeffs[0];
-        } // end field loop
-      } // end x pixel loop
-    } // end y pixel loop
+        scalar_t value = 0.0;
+        for(int_t j=begin;j<end;++j)
+          value += stencil_weights[j]*field[stencil_ids[j]];
+        pixel_field[i] = (float)value;
+      }
+    } // end field loop
     // save off the resulting pixel values
     for(size_t f=0;f<pixel_fields.size();++f){
       netcdf_writer->write_float_array(output_field_names[f+1],step,pixel_fields[f]);
     }
   } // end step loop
 
-  delete [] WORK;
-  delete [] GWORK;
-  delete [] IWORK;
-  delete [] IPIV;
-
   DICe::finalize();
 
   return 0;
@@ -0,0 +1,110 @@
+// @HEADER
+// ************************************************************************
+//
+//               Digital Image Correlation Engine (DICe)
+//                 Copyright 2015 National Technology & Engineering Solutions of Sandia, LLC (NTESS).
+//
+// Under the terms of Contract DE-NA0003525 with NTESS,
+// the U.S. Government retains certain rights in this software.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the Corporation nor the names of the
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY NTESS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL NTESS OR THE
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Questions? Contact: Dan Turner (dzturne@sandia.gov)
+//
+// ************************************************************************
+// @HEADER
+
+/*! \file  DICe_ImageToRawv.cpp
+    \brief Utility for converting a sequence of image files to one multi-frame rawi file (.rawv)
+*/
+
+#include <DICe.h>
+#include <DICe_ImageIO.h>
+#include <DICe_Rawi.h>
+
+#include <Teuchos_TestForException.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace DICe;
+
+int main(int argc, char *argv[]) {
+
+  DICe::initialize(argc, argv);
+
+  std::vector<std::string> image_files;
+  std::string rawv_name;
+  bool compress = false;
+  bool convert_to_8_bit = true;
+  for(int_t i=1;i<argc;++i){
+    const std::string arg = argv[i];
+    if(arg=="-c") compress = true;
+    else if(arg=="-r") convert_to_8_bit = false;
+    else if(rawv_name.empty()) rawv_name = arg;
+    else image_files.push_back(arg);
+  }
+  if(rawv_name.empty()||image_files.empty()){
+    std::cout << " DICe_ImageToRawv (converts a sequence of images to one multi-frame rawi file) " << std::endl;
+    std::cout << " Syntax: DICe_ImageToRawv [-c] [-r] <output_file_name.rawv> <image_file_0> [image_file_1 ...]" << std::endl;
+    std::cout << " The images are stored as frames 0, 1, ... in the order given" << std::endl;
+    std::cout << " -c compress the frames (requires zlib), -r keep the full range of 16 bit images instead of scaling to 8 bits" << std::endl;
+    exit(-1);
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(utils::image_file_type(rawv_name.c_str())!=RAWV,std::runtime_error,
+    "Error, the output file name must have the .rawv extension: " << rawv_name);
+  TEUCHOS_TEST_FOR_EXCEPTION(compress&&!utils::rawi_compression_enabled(),std::runtime_error,
+    "Error, compressed frames require DICe to be built with zlib");
+
+  int_t width = 0;
+  int_t height = 0;
+  utils::read_image_dimensions(image_files[0].c_str(),width,height);
+  std::cout << "output file:   " << rawv_name << std::endl;
+  std::cout << "num frames:    " << image_files.size() << std::endl;
+  std::cout << "dimensions:    " << width << " x " << height << std::endl;
+  std::cout << "compressed:    " << compress << std::endl;
+
+  std::vector<intensity_t> intensities((size_t)width*height);
+  utils::Rawv_Writer writer(rawv_name);
+  for(size_t i=0;i<image_files.size();++i){
+    int_t frame_width = 0;
+    int_t frame_height = 0;
+    utils::read_image_dimensions(image_files[i].c_str(),frame_width,frame_height);
+    TEUCHOS_TEST_FOR_EXCEPTION(frame_width!=width||frame_height!=height,std::runtime_error,
+      "Error, all images must have the same dimensions, " << image_files[i] << " is " << frame_width << " x " << frame_height);
+    utils::read_image(image_files[i].c_str(),&intensities[0],true,convert_to_8_bit);
+    writer.write_frame(width,height,&intensities[0],true,compress);
+  }
+  writer.close();
+
+  DICe::finalize();
+
+  return 0;
+}
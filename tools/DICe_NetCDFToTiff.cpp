@@ -46,13 +46,24 @@
 #include <DICe.h>
 #include <DICe_Image.h>
 #include <DICe_NetCDF.h>
+#include <DICe_ImageIO.h>
+#include <DICe_Rawi.h>
 
 #include <Teuchos_RCP.hpp>
 #include <Teuchos_oblackholestream.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #ifndef   DICE_DISABLE_BOOST_FILESYSTEM
 #include    <boost/filesystem.hpp>
@@ -73,17 +84,42 @@ int main(int argc, char *argv[]) {
   std::string delimiter = " ,\r";
 
   // determine if the second argument is help, file name or folder name
-  if(argc!=2){
+  if(argc<2){
     std::cout << " DICe_NetCDFToTiff (exports NetCDF satellite images to tiffs) " << std::endl;
-    std::cout << " Syntax: DICe_NetCDFToTiff <file_name or folder_name>" << std::endl;
+    std::cout << " Syntax: DICe_NetCDFToTiff <file_name or folder_name> [options]" << std::endl;
     exit(-1);
   }
   std::string name = argv[1];
   if(name=="-h"){
     std::cout << " DICe_NetCDFToTiff (exports NetCDF satellite images to tiffs) " << std::endl;
-    std::cout << " Syntax: DICe_NetCDFToTiff <file_name or folder_name>" << std::endl;
+    std::cout << " Syntax: DICe_NetCDFToTiff <file_name or folder_name> [options]" << std::endl;
+    std::cout << " Options (folder only):" << std::endl;
+    std::cout << "  -threads <n>        number of files converted at the same time (default 1)" << std::endl;
+    std::cout << "  -rawv <file_name>   write all of the files to one multi-frame file in file name order instead of tiffs" << std::endl;
+    std::cout << "  -c                  compress the rawv frames (requires zlib)" << std::endl;
     exit(0);
   }
+  int_t num_threads = 1;
+  std::string rawv_name;
+  bool compress = false;
+  for(int_t i=2;i<argc;++i){
+    const std::string arg = argv[i];
+    if(arg=="-threads"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+1>=argc,std::invalid_argument,"Error, -threads needs a value");
+      num_threads = std::stoi(argv[++i]);
+      TEUCHOS_TEST_FOR_EXCEPTION(num_threads<1,std::invalid_argument,"Error, -threads must be at least 1");
+    }
+    else if(arg=="-rawv"){
+      TEUCHOS_TEST_FOR_EXCEPTION(i+1>=argc,std::invalid_argument,"Error, -rawv needs a file name");
+      rawv_name = argv[++i];
+    }
+    else if(arg=="-c") compress = true;
+    else{
+      TEUCHOS_TEST_FOR_EXCEPTION(true,std::invalid_argument,"Error, unknown option " << arg);
+    }
+  }
+  TEUCHOS_TEST_FOR_EXCEPTION(compress&&!utils::rawi_compression_enabled(),std::runtime_error,
+    "Error, compressed frames require DICe to be built with zlib");
   // determine if this is a file or folder
   const size_t len = name.length();
   bool is_file_name = false;
@@ -157,19 +193,100 @@ int main(int argc, char *argv[]) {
       std::cout << "Directory does not exist: " << name << std::endl;
       exit(-1);
     }
+    // sorted so the frames of the multi-frame file are in file name (time stamp) order
+    std::vector<std::string> file_names;
     boost::filesystem::directory_iterator end_itr; // default construction yields past-the-end
     for ( boost::filesystem::directory_iterator itr( dir_path );itr != end_itr;++itr){
       std::string file_name = itr->path().filename().string();
       std::cout << "found file " << file_name << std::endl;
       const size_t name_len = file_name.length();
-      std::string substr = file_name.substr(name_len-3,name_len);
-      if(strcmp(substr.c_str(),".nc")==0){
-        Teuchos::RCP<Image> img = Teuchos::rcp(new Image(file_name.c_str()));//netcdf_reader->get_image(file_name);
-        std::string old_name = file_name;
-        file_name.replace(name_len-3,3,".tif");
-        DEBUG_MSG("Converting file: " << old_name << " to " << file_name);
-        img->write(file_name);
+      if(name_len>3&&file_name.substr(name_len-3)==".nc")
+        file_names.push_back(itr->path().string());
+    }
+    std::sort(file_names.begin(),file_names.end());
+    const int_t num_files = file_names.size();
+    *outStream << "NetCDF files:   " << num_files << std::endl;
+    *outStream << "Threads:        " << num_threads << std::endl;
+
+    // the multi-frame file has to be written in file order so the converted frames wait in a
+    // bounded window until the frames before them have been written
+    std::unique_ptr<utils::Rawv_Writer> rawv_writer;
+    if(!rawv_name.empty()){
+      *outStream << "Output file:    " << rawv_name << std::endl;
+      rawv_writer.reset(new utils::Rawv_Writer(rawv_name));
+    }
+    const int_t rawv_window = 2*num_threads;
+    std::map<int_t,std::pair<std::pair<int_t,int_t>,std::vector<intensity_t> > > pending_frames; // (width, height), intensities
+    int_t next_rawv_frame = 0;
+
+    std::atomic<int_t> next_file(0);
+    std::mutex mutex;
+    // the netcdf library is not thread safe so only the reads are serialized
+    std::mutex netcdf_mutex;
+    std::condition_variable frame_written;
+    std::exception_ptr first_exception;
+    std::atomic<bool> failed(false);
+
+    auto convert_files = [&](){
+      try{
+        // each thread keeps its own reader (only one file open at a time) and reuses its intensity buffer
+        netcdf::NetCDF_Reader reader;
+        std::vector<intensity_t> intensities;
+        for(int_t i=next_file++;i<num_files&&!failed;i=next_file++){
+          const std::string & file_name = file_names[i];
+          int_t width = 0;
+          int_t height = 0;
+          {
+            std::lock_guard<std::mutex> netcdf_lock(netcdf_mutex);
+            int_t num_time_steps = 0;
+            reader.get_image_dimensions(file_name,width,height,num_time_steps);
+            intensities.resize((size_t)width*height);
+            reader.read_netcdf_image(file_name.c_str(),&intensities[0],0);
+            reader.close();
+          }
+          if(rawv_writer){
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_written.wait(lock,[&](){return failed||i<next_rawv_frame+rawv_window;});
+            if(failed) break;
+            pending_frames[i].first = std::pair<int_t,int_t>(width,height);
+            pending_frames[i].second.swap(intensities);
+            // whichever thread completes the next frame in order writes it and any that were waiting on it
+            while(!pending_frames.empty()&&pending_frames.begin()->first==next_rawv_frame){
+              const std::pair<int_t,int_t> & dims = pending_frames.begin()->second.first;
+              DEBUG_MSG("Converting file: " << file_names[next_rawv_frame] << " to frame " << next_rawv_frame << " of " << rawv_name);
+              rawv_writer->write_frame(dims.first,dims.second,&pending_frames.begin()->second.second[0],true,compress);
+              pending_frames.erase(pending_frames.begin());
+              next_rawv_frame++;
+            }
+            frame_written.notify_all();
+            continue;
+          }
+          std::string tif_name = file_name;
+          tif_name.replace(tif_name.length()-3,3,".tif");
+          DEBUG_MSG("Converting file: " << file_name << " to " << tif_name);
+          utils::write_image(tif_name.c_str(),width,height,&intensities[0]);
+        }
+      }
+      catch(...){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!first_exception) first_exception = std::current_exception();
+        failed = true;
+        frame_written.notify_all();
       }
+    };
+
+    const int_t num_workers = std::max(1,std::min(num_threads,num_files));
+    std::vector<std::thread> workers;
+    for(int_t t=1;t<num_workers;++t)
+      workers.push_back(std::thread(convert_files));
+    convert_files();
+    for(size_t t=0;t<workers.size();++t)
+      workers[t].join();
+    if(first_exception)
+      std::rethrow_exception(first_exception);
+    if(rawv_writer){
+      assert(pending_frames.empty());
+      rawv_writer->close();
     }
 #else
     TEUCHOS_TEST_FOR_EXCEPTION(true,std::runtime_error,"Error, boost filesystem required to convert all images in a directory");
@@ -61,25 +61,186 @@
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgproc.hpp"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <cassert>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
 
 using namespace cv;
 using namespace DICe;
 
-int main(int argc, char *argv[]) {
+/// \brief images and cal previews kept in memory between the commands of a persistent server
+///
+/// An entry is only reused if the file on disk still has the same modification time and size,
+/// otherwise it is read again. When the cache is disabled (single command mode) nothing is stored.
+class Server_Cache{
+public:
+  /// constructor
+  /// \param enabled true if entries should be kept between commands
+  /// \param max_images the maximum number of images to keep in memory
+  Server_Cache(const bool enabled,
+    const size_t max_images=32):
+    enabled_(enabled),
+    max_images_(max_images),
+    use_count_(0){}
 
-  /// usage ./DICe_OpenCVServer <image1> <image2> ... <Filter:filter1> <args> <Filter:filter2> <args>
+  /// returns the image as an 8 bit grayscale mat (empty if the image could not be read),
+  /// the returned mat shares its data with the cache so it must be cloned before it is modified
+  /// \param file_name the name of the image file
+  Mat image(const std::string & file_name){
+    const std::string stamp = file_stamp(file_name);
+    if(!enabled_||stamp.empty())
+      return imread(file_name, IMREAD_GRAYSCALE);
+    std::map<std::string,Cached_Image>::iterator it = images_.find(file_name);
+    if(it!=images_.end()&&it->second.stamp==stamp){
+      DEBUG_MSG("Server_Cache::image(): using cached image " << file_name);
+      it->second.last_use = ++use_count_;
+      return it->second.img;
+    }
+    Cached_Image & entry = images_[file_name];
+    entry.img = imread(file_name, IMREAD_GRAYSCALE);
+    entry.stamp = stamp;
+    entry.last_use = ++use_count_;
+    const Mat img = entry.img;
+    // drop the least recently used images
+    while(images_.size()>max_images_){
+      std::map<std::string,Cached_Image>::iterator oldest = images_.begin();
+      for(it=images_.begin();it!=images_.end();++it)
+        if(it->second.last_use<oldest->second.last_use) oldest = it;
+      images_.erase(oldest);
+    }
+    return img;
+  }
 
-  DICe::initialize(argc, argv);
+  /// returns the key that identifies a cal preview of this image with these settings (empty if it can't be cached)
+  /// \param file_name the name of the image file
+  /// \param preview_params the pre-processing parameters
+  std::string cal_preview_key(const std::string & file_name,
+    const Teuchos::RCP<Teuchos::ParameterList> & preview_params)const{
+    const std::string stamp = file_stamp(file_name);
+    if(!enabled_||stamp.empty()) return "";
+    std::stringstream key;
+    key << file_name << "\n" << stamp << "\n";
+    preview_params->print(key);
+    return key.str();
+  }
+
+  /// writes a previously computed cal preview to the output image and returns true if there was one
+  /// \param key the key from cal_preview_key()
+  /// \param output_image_filename the name of the preview image to write
+  /// \param pre_code [out] the return value of pre_process_cal_image() for this preview
+  bool cal_preview(const std::string & key,
+    const std::string & output_image_filename,
+    int & pre_code)const{
+    if(key.empty()) return false;
+    std::map<std::string,Cal_Preview>::const_iterator it = cal_previews_.find(key);
+    if(it==cal_previews_.end()) return false;
+    if(!it->second.preview.empty()){
+      std::ofstream out(output_image_filename.c_str(),std::ios::binary);
+      if(!out.good()) return false;
+      out.write(&it->second.preview[0],it->second.preview.size());
+    }
+    DEBUG_MSG("Server_Cache::cal_preview(): using cached cal preview for " << output_image_filename);
+    pre_code = it->second.pre_code;
+    return true;
+  }
 
-  //Teuchos::oblackholestream bhs; // outputs nothing
-  Teuchos::RCP<std::ostream> outStream = Teuchos::rcp(&std::cout, false);
-  std::string delimiter = " ,\r";
+  /// stores the cal preview that was just written so the same request can be answered without locating the dots again
+  /// \param key the key from cal_preview_key()
+  /// \param output_image_filename the name of the preview image that was written
+  /// \param pre_code the return value of pre_process_cal_image()
+  void store_cal_preview(const std::string & key,
+    const std::string & output_image_filename,
+    const int pre_code){
+    // load failures and parameter errors are not stored so they are retried
+    if(key.empty()||pre_code==-1||pre_code==-4) return;
+    if(cal_previews_.size()>=max_images_) cal_previews_.clear();
+    Cal_Preview & entry = cal_previews_[key];
+    entry.pre_code = pre_code;
+    std::ifstream in(output_image_filename.c_str(),std::ios::binary);
+    entry.preview.assign(std::istreambuf_iterator<char>(in),std::istreambuf_iterator<char>());
+  }
+
+  /// removes all the entries
+  void clear(){
+    images_.clear();
+    cal_previews_.clear();
+  }
 
-  DEBUG_MSG("User specified " << argc << " arguments");
-  //for(int_t i=0;i<argc;++i){
-  //  DEBUG_MSG(argv[i]);
-  //}
+private:
+  /// returns a string that changes if the file is modified (empty if the file doesn't exist)
+  static std::string file_stamp(const std::string & file_name){
+    struct stat file_stat;
+    if(stat(file_name.c_str(),&file_stat)!=0) return "";
+    std::stringstream stamp;
+    stamp << (long long)file_stat.st_mtime << " " << (long long)file_stat.st_size;
+    return stamp.str();
+  }
+  /// an image held in memory
+  struct Cached_Image{
+    /// the grayscale image
+    Mat img;
+    /// modification stamp of the file when it was read
+    std::string stamp;
+    /// counter value when the image was last used
+    size_t last_use;
+  };
+  /// the result of a cal preview
+  struct Cal_Preview{
+    /// return value of pre_process_cal_image()
+    int pre_code;
+    /// the encoded preview image
+    std::vector<char> preview;
+  };
+  /// true if entries are kept between commands
+  bool enabled_;
+  /// maximum number of images (and cal previews) to keep
+  size_t max_images_;
+  /// counter used to find the least recently used image
+  size_t use_count_;
+  /// images by file name
+  std::map<std::string,Cached_Image> images_;
+  /// cal previews by key
+  std::map<std::string,Cal_Preview> cal_previews_;
+};
+
+/// splits a server command line into arguments, double quotes can be used around arguments with spaces
+std::vector<std::string> tokenize_command(const std::string & line){
+  std::vector<std::string> tokens;
+  std::string token;
+  bool in_quotes = false;
+  bool has_token = false;
+  for(size_t i=0;i<line.size();++i){
+    const char c = line[i];
+    if(c=='"'){
+      in_quotes = !in_quotes;
+      has_token = true;
+    }
+    else if(!in_quotes&&(c==' '||c=='\t'||c=='\r'||c=='\n')){
+      if(has_token) tokens.push_back(token);
+      token.clear();
+      has_token = false;
+    }
+    else{
+      token += c;
+      has_token = true;
+    }
+  }
+  if(has_token) tokens.push_back(token);
+  return tokens;
+}
+
+/// process one set of images and filters, the arguments are the same as the command line arguments
+/// (including the executable name) and the return value is the exit code of the single command mode
+int process_command(const std::vector<std::string> & args,
+  Server_Cache & cache){
+
+  const int_t num_args = args.size();
+  DEBUG_MSG("User specified " << num_args << " arguments");
 
   int error_code = 0;
 
@@ -90,8 +251,8 @@ int main(int argc, char *argv[]) {
   std::vector<std::string> output_images;
   int_t end_images = 0;
   bool i_o_flag = true;
-  for(int_t i=1;i<argc;++i){
-    std::string arg = argv[i];
+  for(int_t i=1;i<num_args;++i){
+    std::string arg = args[i];
     if(arg.find('.')!=std::string::npos&&!std::isdigit(arg[0])&&(arg.find(':')==std::string::npos||arg.find(':')==1)){ // on win there is a ':' in the file path!
       if(i_o_flag){
         input_images.push_back(arg);
@@ -120,18 +281,18 @@ int main(int argc, char *argv[]) {
   std::vector<std::vector <scalar_t> > filter_params;
   // read the list of filters:
   // (for now only one filter allowed: binary thresholding)
-  for(int_t i=end_images;i<argc;++i){
-    std::string arg = argv[i];
+  for(int_t i=end_images;i<num_args;++i){
+    std::string arg = args[i];
     if(arg.find("Filter")!=std::string::npos){
       // read all the parameters for this filter
       filter_params.push_back(std::vector<scalar_t>());
       filters.push_back(arg);
-      for(int_t ii=i+1;ii<argc;++ii){
-        std::string argi = argv[ii];
+      for(int_t ii=i+1;ii<num_args;++ii){
+        std::string argi = args[ii];
         if(argi.find("Filter")!=std::string::npos){
           break;
         }else{
-          filter_params[filter_params.size()-1].push_back(std::strtod(argv[ii],NULL));
+          filter_params[filter_params.size()-1].push_back(std::strtod(args[ii].c_str(),NULL));
           i++;
         }
       }
@@ -270,8 +431,14 @@ int main(int argc, char *argv[]) {
       std::vector<Point3f> object_points;
       Size imageSize;
       // find the cal dot points and check show a preview of their locations
-      const int pre_code = pre_process_cal_image(input_images[image_it],output_images[image_it],preview_params,
-        image_points,object_points,imageSize);
+      // (a preview of the same image with the same settings is reused)
+      int pre_code = 0;
+      const std::string cal_key = cache.cal_preview_key(input_images[image_it],preview_params);
+      if(!cache.cal_preview(cal_key,output_images[image_it],pre_code)){
+        pre_code = pre_process_cal_image(cache.image(input_images[image_it]),output_images[image_it],preview_params,
+          image_points,object_points,imageSize);
+        cache.store_cal_preview(cal_key,output_images[image_it],pre_code);
+      }
       DEBUG_MSG("pre_process_cal_image return value: " << pre_code);
       if(pre_code==-1)
         return -1;
@@ -296,8 +463,8 @@ int main(int argc, char *argv[]) {
       } // pre_code != 0
     } // end is cal
     else{
-      // load the image as an openCV mat
-      Mat img = imread(input_images[image_it], IMREAD_GRAYSCALE);
+      // load the image as an openCV mat (copied since the filters work in place on the image)
+      Mat img = cache.image(input_images[image_it]).clone();
 //      Mat binary_img(img.size(),CV_8UC3);
 //      //Mat contour_img(img.size(), CV_8UC3,Scalar::all(255));
 //      Mat out_img(img.size(), CV_8UC3);
@@ -742,6 +909,53 @@ int main(int argc, char *argv[]) {
 //    } // end is_cal
   } // end images
 
+  return error_code;
+}
+
+int main(int argc, char *argv[]) {
+
+  /// usage ./DICe_OpenCVServer <image1> <image2> ... <Filter:filter1> <args> <Filter:filter2> <args>
+  /// or    ./DICe_OpenCVServer -server
+  ///
+  /// In server mode the process stays alive and reads one command per line from stdin. A command has
+  /// the same arguments as the single command mode (without the executable name). After each command
+  /// the line "DICe_OpenCVServer::return_code <code>" is written to stdout, the code is the exit code the
+  /// single command mode would have returned. The command "clear" empties the image cache and "exit" stops the server.
+
+  DICe::initialize(argc, argv);
+
+  int error_code = 0;
+  if(argc==2&&std::string(argv[1])=="-server"){
+    Server_Cache cache(true);
+    std::string line;
+    while(std::getline(std::cin,line)){
+      const std::vector<std::string> tokens = tokenize_command(line);
+      if(tokens.empty()) continue;
+      if(tokens[0]=="exit"||tokens[0]=="quit") break;
+      if(tokens[0]=="clear"){
+        cache.clear();
+        error_code = 0;
+      }
+      else{
+        std::vector<std::string> args(1,argv[0]);
+        args.insert(args.end(),tokens.begin(),tokens.end());
+        try{
+          error_code = process_command(args,cache);
+        }
+        catch(std::exception & e){
+          std::cout << "error, " << e.what() << std::endl;
+          error_code = -1;
+        }
+      }
+      std::cout << "DICe_OpenCVServer::return_code " << error_code << std::endl;
+    }
+    error_code = 0;
+  }
+  else{
+    Server_Cache cache(false);
+    error_code = process_command(std::vector<std::string>(argv,argv+argc),cache);
+  }
+
   DICe::finalize();
 
   return error_code;